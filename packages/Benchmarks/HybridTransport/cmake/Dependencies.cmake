@@ -3,4 +3,7 @@ TRIBITS_PACKAGE_DEFINE_DEPENDENCIES(
   DataTransferKitUtils
   Kokkos
   Teuchos
+  TEST_REQUIRED_PACKAGES
+  DataTransferKitMeshfree
+  DataTransferKitMapFactory
   )
@@ -0,0 +1,480 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include "DTK_Benchmark_DeterministicMesh.hpp"
+#include "DTK_Benchmark_MonteCarloMesh.hpp"
+
+#include <DTK_CellTypes.h>
+#include <DTK_ConsistentInterpolationOperator.hpp>
+#include <DTK_FETypes.h>
+#include <DTK_MovingLeastSquaresOperator_decl.hpp>
+#include <DTK_MovingLeastSquaresOperator_def.hpp>
+#include <DTK_NearestNeighborOperator_decl.hpp>
+#include <DTK_NearestNeighborOperator_def.hpp>
+#include <DTK_PointCloudOperator.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Kokkos_DefaultNode.hpp>
+#include <Teuchos_CommHelpers.hpp>
+#include <Teuchos_CommandLineProcessor.hpp>
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_ParameterList.hpp>
+#include <Teuchos_StandardCatchMacros.hpp>
+#include <Teuchos_Time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using DataTransferKit::Benchmark::CartesianMesh;
+
+// The meshes of the hybrid transport benchmark live in the default memory
+// space, the operators are benchmarked on the node selected on the command
+// line.
+template <typename DeviceType>
+struct Mesh
+{
+    std::string name;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> nodes;
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<DataTransferKit::LocalOrdinal *, DeviceType> cell_dof_ids;
+    Kokkos::View<double *, DeviceType> values;
+};
+
+// The field is linear so that all the operators reproduce it exactly on the
+// nodes of the other decomposition.
+double f( double const x, double const y, double const z )
+{
+    return 1. + x + 2. * y + 3. * z;
+}
+
+// The degrees of freedom of the trilinear field are the nodes of the hex-8
+// cells.
+template <typename DeviceType>
+Mesh<DeviceType> makeMesh( std::string const &name,
+                           CartesianMesh const &cartesian_mesh )
+{
+    auto nodes = cartesian_mesh.localNodeCoordinates();
+    auto nodes_host = Kokkos::create_mirror_view( nodes );
+    Kokkos::deep_copy( nodes_host, nodes );
+    auto connectivity = cartesian_mesh.localCellConnectivity();
+    auto connectivity_host = Kokkos::create_mirror_view( connectivity );
+    Kokkos::deep_copy( connectivity_host, connectivity );
+
+    int const n_nodes = nodes.extent( 0 );
+    int const dim = nodes.extent( 1 );
+    int const n_cells = connectivity.extent( 0 );
+    int const n_nodes_per_cell = connectivity.extent( 1 );
+
+    Mesh<DeviceType> mesh;
+    mesh.name = name;
+    mesh.nodes = Kokkos::View<DataTransferKit::Coordinate **, DeviceType>(
+        "nodes", n_nodes, dim );
+    mesh.values = Kokkos::View<double *, DeviceType>( "values", n_nodes );
+    auto mesh_nodes_host = Kokkos::create_mirror_view( mesh.nodes );
+    auto values_host = Kokkos::create_mirror_view( mesh.values );
+    for ( int i = 0; i < n_nodes; ++i )
+    {
+        for ( int d = 0; d < dim; ++d )
+            mesh_nodes_host( i, d ) = nodes_host( i, d );
+        values_host( i ) =
+            f( nodes_host( i, 0 ), nodes_host( i, 1 ), nodes_host( i, 2 ) );
+    }
+    Kokkos::deep_copy( mesh.nodes, mesh_nodes_host );
+    Kokkos::deep_copy( mesh.values, values_host );
+
+    mesh.cell_topologies = Kokkos::View<DTK_CellTopology *, DeviceType>(
+        "cell_topologies", n_cells );
+    Kokkos::deep_copy( mesh.cell_topologies, DTK_HEX_8 );
+    mesh.cells = Kokkos::View<unsigned int *, DeviceType>(
+        "cells", n_cells * n_nodes_per_cell );
+    mesh.cell_dof_ids =
+        Kokkos::View<DataTransferKit::LocalOrdinal *, DeviceType>(
+            "cell_dof_ids", n_cells * n_nodes_per_cell );
+    auto cells_host = Kokkos::create_mirror_view( mesh.cells );
+    for ( int c = 0; c < n_cells; ++c )
+        for ( int n = 0; n < n_nodes_per_cell; ++n )
+            cells_host( c * n_nodes_per_cell + n ) = connectivity_host( c, n );
+    Kokkos::deep_copy( mesh.cells, cells_host );
+    Kokkos::deep_copy( mesh.cell_dof_ids, mesh.cells );
+
+    return mesh;
+}
+
+// Split the blocks of a set in the three directions so that they are as
+// close as possible to cubes.
+std::array<int, 3> factorBlocks( int const num_blocks )
+{
+    std::array<int, 3> blocks = {{1, 1, 1}};
+    int remaining = num_blocks;
+    for ( int d = 0; d < 3; ++d )
+    {
+        int b = std::round( std::pow( remaining, 1. / ( 3 - d ) ) );
+        while ( remaining % b != 0 )
+            --b;
+        blocks[d] = b;
+        remaining /= b;
+    }
+    return blocks;
+}
+
+// Evenly spaced boundaries of the Monte Carlo blocks. The first and last
+// boundaries lie half a cell outside of the grid.
+std::vector<double> makeBoundaryMesh( int const num_cells, double const delta,
+                                      int const num_blocks )
+{
+    double const length = num_cells * delta;
+    std::vector<double> bnd_mesh( num_blocks + 1 );
+    for ( int n = 0; n < num_blocks + 1; ++n )
+        bnd_mesh[n] = n * length / num_blocks;
+    bnd_mesh.front() -= 0.5 * delta;
+    bnd_mesh.back() += 0.5 * delta;
+    return bnd_mesh;
+}
+
+// Minimum, average, and maximum over the ranks. The imbalance is the ratio
+// of the maximum to the average.
+template <typename T>
+std::array<double, 3> reduceOverRanks( Teuchos::Comm<int> const &comm,
+                                       T const local )
+{
+    T min;
+    T max;
+    T sum;
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_MIN, local,
+                        Teuchos::outArg( min ) );
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_MAX, local,
+                        Teuchos::outArg( max ) );
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_SUM, local,
+                        Teuchos::outArg( sum ) );
+    return {{static_cast<double>( min ),
+             static_cast<double>( sum ) / comm.getSize(),
+             static_cast<double>( max )}};
+}
+
+long long bytesSent( DataTransferKit::Statistics const &stats )
+{
+    auto const &counts = stats.getCounts();
+    auto const it = counts.find( "bytes sent" );
+    return it != counts.end() ? it->second : 0;
+}
+
+void printHeader( std::ostream &os )
+{
+    os << std::left << std::setw( 44 ) << "operator" << std::setw( 8 )
+       << "phase" << std::right << std::setw( 12 ) << "avg [s]"
+       << std::setw( 12 ) << "max [s]" << std::setw( 10 ) << "imbalance"
+       << std::setw( 14 ) << "bytes sent" << std::setw( 10 ) << "imbalance"
+       << "\n";
+}
+
+void printRow( std::ostream &os, std::string const &label,
+               std::string const &phase, std::array<double, 3> const &time,
+               std::array<double, 3> const &bytes, int const n_ranks )
+{
+    auto imbalance = []( std::array<double, 3> const &x ) {
+        return x[1] > 0. ? x[2] / x[1] : 1.;
+    };
+    os << std::left << std::setw( 44 ) << label << std::setw( 8 ) << phase
+       << std::right << std::scientific << std::setprecision( 3 )
+       << std::setw( 12 ) << time[1] << std::setw( 12 ) << time[2]
+       << std::fixed << std::setprecision( 2 ) << std::setw( 10 )
+       << imbalance( time ) << std::setw( 14 )
+       << static_cast<long long>( bytes[1] * n_ranks ) << std::setw( 10 )
+       << imbalance( bytes ) << "\n";
+}
+
+// Set up the operator from the source to the target mesh and apply it. The
+// time and the bytes sent are reported for each phase, the apply phase is
+// averaged over the applications.
+template <typename DeviceType>
+void benchmark(
+    Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
+    std::string const &name, Mesh<DeviceType> const &source,
+    Mesh<DeviceType> const &target,
+    std::function<
+        std::unique_ptr<DataTransferKit::PointCloudOperator<DeviceType>>()>
+        make_operator,
+    int const n_applies, std::ostream &os )
+{
+    int const rank = comm->getRank();
+    int const n_ranks = comm->getSize();
+    std::string const label = name + " " + source.name + " -> " + target.name;
+
+    DataTransferKit::Statistics stats;
+    std::unique_ptr<DataTransferKit::PointCloudOperator<DeviceType>> op;
+    Teuchos::Time setup_timer( "setup" );
+    comm->barrier();
+    {
+        DataTransferKit::StatisticsScope statistics_scope( stats );
+        setup_timer.start();
+        op = make_operator();
+        Kokkos::fence();
+        setup_timer.stop();
+    }
+    auto const setup_time =
+        reduceOverRanks( *comm, setup_timer.totalElapsedTime() );
+    auto const setup_bytes = reduceOverRanks( *comm, bytesSent( stats ) );
+
+    stats.clear();
+    Kokkos::View<double *, DeviceType> target_values(
+        "target_values", target.values.extent( 0 ) );
+    Teuchos::Time apply_timer( "apply" );
+    comm->barrier();
+    {
+        DataTransferKit::StatisticsScope statistics_scope( stats );
+        apply_timer.start();
+        for ( int i = 0; i < n_applies; ++i )
+            op->apply( source.values, target_values );
+        Kokkos::fence();
+        apply_timer.stop();
+    }
+    auto const apply_time = reduceOverRanks(
+        *comm, apply_timer.totalElapsedTime() / n_applies );
+    auto const apply_bytes = reduceOverRanks(
+        *comm, static_cast<double>( bytesSent( stats ) ) / n_applies );
+
+    // The field is reproduced exactly so the error only checks that the
+    // operator is sane, it is not part of the measurements.
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    auto target_ref_host = Kokkos::create_mirror_view( target.values );
+    Kokkos::deep_copy( target_ref_host, target.values );
+    double local_error = 0.;
+    for ( unsigned int i = 0; i < target_values.extent( 0 ); ++i )
+        local_error =
+            std::max( local_error, std::abs( target_values_host( i ) -
+                                             target_ref_host( i ) ) /
+                                       std::abs( target_ref_host( i ) ) );
+    auto const error = reduceOverRanks( *comm, local_error );
+
+    if ( rank == 0 )
+    {
+        printRow( os, label, "setup", setup_time, setup_bytes, n_ranks );
+        printRow( os, label, "apply", apply_time, apply_bytes, n_ranks );
+        os << std::left << std::setw( 44 ) << label << std::setw( 8 )
+           << "error" << std::right << std::scientific
+           << std::setprecision( 3 ) << std::setw( 12 ) << error[2] << "\n";
+    }
+}
+
+template <class NO>
+int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
+{
+    using DeviceType = typename NO::device_type;
+
+    int num_cells_i = 32;
+    int num_cells_j = 32;
+    int num_cells_k = 16;
+    double delta = 1.;
+    int num_sets = 1;
+    int n_applies = 10;
+    double radius = 2.5;
+
+    clp.setOption( "cells_i", &num_cells_i,
+                   "number of cells of the global grid in the x direction" );
+    clp.setOption( "cells_j", &num_cells_j,
+                   "number of cells of the global grid in the y direction" );
+    clp.setOption( "cells_k", &num_cells_k,
+                   "number of cells of the global grid in the z direction" );
+    clp.setOption( "delta", &delta, "size of the cells in all directions" );
+    clp.setOption( "sets", &num_sets,
+                   "number of sets of the Monte Carlo decomposition. The "
+                   "number of MPI ranks must be a multiple of it, the blocks "
+                   "of a set are the ranks divided by the number of sets" );
+    clp.setOption( "applies", &n_applies,
+                   "number of applications of each operator" );
+    clp.setOption( "radius", &radius,
+                   "support radius of moving least squares in number of "
+                   "cells" );
+
+    clp.recogniseAllOptions( true );
+    switch ( clp.parse( argc, argv ) )
+    {
+    case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+        return EXIT_SUCCESS;
+    case Teuchos::CommandLineProcessor::PARSE_ERROR:
+    case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+        return EXIT_FAILURE;
+    case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+        break;
+    }
+
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const rank = comm->getRank();
+    int const n_ranks = comm->getSize();
+    if ( num_sets < 1 || n_ranks % num_sets != 0 )
+        throw std::runtime_error(
+            "the number of MPI ranks must be a multiple of the number of "
+            "sets" );
+
+    // The deterministic decomposition blocks the grid in x and y over all
+    // the ranks. The Monte Carlo decomposition replicates the grid over the
+    // sets and blocks it in all directions within a set.
+    DataTransferKit::Benchmark::DeterministicMesh deterministic_mesh(
+        comm, num_cells_i, num_cells_j, num_cells_k, delta, delta, delta );
+    auto const blocks = factorBlocks( n_ranks / num_sets );
+    DataTransferKit::Benchmark::MonteCarloMesh monte_carlo_mesh(
+        comm, num_sets, num_cells_i, num_cells_j, num_cells_k, delta, delta,
+        delta, makeBoundaryMesh( num_cells_i, delta, blocks[0] ),
+        makeBoundaryMesh( num_cells_j, delta, blocks[1] ),
+        makeBoundaryMesh( num_cells_k, delta, blocks[2] ) );
+
+    std::vector<Mesh<DeviceType>> meshes = {
+        makeMesh<DeviceType>( "deterministic",
+                              *deterministic_mesh.cartesianMesh() ),
+        makeMesh<DeviceType>( "monte carlo",
+                              *monte_carlo_mesh.cartesianMesh() )};
+
+    std::ostream &os = std::cout;
+    if ( rank == 0 )
+        os << "ranks: " << n_ranks << "\nsets: " << num_sets
+           << "\nblocks per set: " << blocks[0] << " x " << blocks[1]
+           << " x " << blocks[2] << "\n";
+    for ( auto const &mesh : meshes )
+    {
+        int const local_n_nodes = mesh.nodes.extent( 0 );
+        auto const n_nodes = reduceOverRanks( *comm, local_n_nodes );
+        if ( rank == 0 )
+            os << mesh.name << " nodes per rank: min " << n_nodes[0]
+               << " avg " << n_nodes[1] << " max " << n_nodes[2] << "\n";
+    }
+    if ( rank == 0 )
+        printHeader( os );
+
+    using PointCloudOperator = DataTransferKit::PointCloudOperator<DeviceType>;
+    Teuchos::ParameterList params;
+    params.set( "Support Radius", radius * delta );
+    for ( int s = 0; s < 2; ++s )
+    {
+        auto const &source = meshes[s];
+        auto const &target = meshes[1 - s];
+
+        benchmark<DeviceType>(
+            comm, "nearest neighbor", source, target,
+            [&]() {
+                return std::unique_ptr<PointCloudOperator>(
+                    new DataTransferKit::NearestNeighborOperator<DeviceType>(
+                        comm, source.nodes, target.nodes ) );
+            },
+            n_applies, os );
+
+        benchmark<DeviceType>(
+            comm, "moving least squares", source, target,
+            [&]() {
+                return std::unique_ptr<PointCloudOperator>(
+                    new DataTransferKit::MovingLeastSquaresOperator<
+                        DeviceType>( comm, source.nodes, target.nodes,
+                                     params ) );
+            },
+            n_applies, os );
+
+        benchmark<DeviceType>(
+            comm, "interpolation", source, target,
+            [&]() {
+                return std::unique_ptr<PointCloudOperator>(
+                    new DataTransferKit::ConsistentInterpolationOperator<
+                        DeviceType>( comm, source.cell_topologies,
+                                     source.cells, source.nodes,
+                                     source.cell_dof_ids, DTK_HGRAD,
+                                     target.nodes ) );
+            },
+            n_applies, os );
+    }
+
+    return 0;
+}
+
+int main( int argc, char *argv[] )
+{
+    MPI_Init( &argc, &argv );
+    Kokkos::initialize( argc, argv );
+
+    bool success = true;
+    bool verbose = true;
+
+    try
+    {
+        const bool throwExceptions = false;
+
+        Teuchos::CommandLineProcessor clp( throwExceptions );
+
+        std::string node = "";
+        clp.setOption( "node", &node, "node type (serial | openmp | cuda)" );
+
+        clp.recogniseAllOptions( false );
+        switch ( clp.parse( argc, argv, NULL ) )
+        {
+        case Teuchos::CommandLineProcessor::PARSE_ERROR:
+            success = false;
+        case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+        case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+        case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+            break;
+        }
+
+        if ( !success )
+        {
+            // do nothing, just skip other if clauses
+        }
+        else if ( node == "" )
+        {
+            typedef KokkosClassic::DefaultNode::DefaultNodeType Node;
+            main_<Node>( clp, argc, argv );
+        }
+        else if ( node == "serial" )
+        {
+#ifdef KOKKOS_ENABLE_SERIAL
+            typedef Kokkos::Compat::KokkosSerialWrapperNode Node;
+            main_<Node>( clp, argc, argv );
+#else
+            throw std::runtime_error( "Serial node type is disabled" );
+#endif
+        }
+        else if ( node == "openmp" )
+        {
+#ifdef KOKKOS_ENABLE_OPENMP
+            typedef Kokkos::Compat::KokkosOpenMPWrapperNode Node;
+            main_<Node>( clp, argc, argv );
+#else
+            throw std::runtime_error( "OpenMP node type is disabled" );
+#endif
+        }
+        else if ( node == "cuda" )
+        {
+#ifdef KOKKOS_ENABLE_CUDA
+            typedef Kokkos::Compat::KokkosCudaWrapperNode Node;
+            main_<Node>( clp, argc, argv );
+#else
+            throw std::runtime_error( "CUDA node type is disabled" );
+#endif
+        }
+        else
+        {
+            throw std::runtime_error( "Unrecognized node type" );
+        }
+    }
+    TEUCHOS_STANDARD_CATCH_STATEMENTS( verbose, std::cerr, success );
+
+    Kokkos::finalize();
+
+    MPI_Finalize();
+
+    return ( success ? EXIT_SUCCESS : EXIT_FAILURE );
+}
@@ -0,0 +1,579 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_Box.hpp>
+#include <DTK_Interpolation.hpp>
+#include <DTK_PointInCell.hpp>
+#include <DTK_PointSearch.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Kokkos_DefaultNode.hpp>
+#include <Teuchos_CommandLineProcessor.hpp>
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_GlobalMPISession.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <MeshGenerator.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+enum class MeshType
+{
+    structured,
+    mixed
+};
+
+// Number of subdivisions of the mesh of each process along each direction
+// and number of points per process for the small problems.  The large ones
+// have twice as many subdivisions.
+int subdivisions_2d = 100;
+int subdivisions_3d = 20;
+int points_per_rank = 10000;
+
+template <typename DeviceType>
+using Mesh =
+    std::tuple<Kokkos::View<DTK_CellTopology *, DeviceType>,
+               Kokkos::View<unsigned int *, DeviceType>,
+               Kokkos::View<DataTransferKit::Coordinate **, DeviceType>>;
+
+// Put the cells of the second mesh after the ones of the first mesh, which
+// it is moved next to along the x-axis.
+template <typename DeviceType>
+Mesh<DeviceType> mergeMeshes( Mesh<DeviceType> const &a,
+                              Mesh<DeviceType> const &b, double shift )
+{
+    auto const topologies_a = Kokkos::create_mirror_view( std::get<0>( a ) );
+    Kokkos::deep_copy( topologies_a, std::get<0>( a ) );
+    auto const cells_a = Kokkos::create_mirror_view( std::get<1>( a ) );
+    Kokkos::deep_copy( cells_a, std::get<1>( a ) );
+    auto const coordinates_a = Kokkos::create_mirror_view( std::get<2>( a ) );
+    Kokkos::deep_copy( coordinates_a, std::get<2>( a ) );
+    auto const topologies_b = Kokkos::create_mirror_view( std::get<0>( b ) );
+    Kokkos::deep_copy( topologies_b, std::get<0>( b ) );
+    auto const cells_b = Kokkos::create_mirror_view( std::get<1>( b ) );
+    Kokkos::deep_copy( cells_b, std::get<1>( b ) );
+    auto const coordinates_b = Kokkos::create_mirror_view( std::get<2>( b ) );
+    Kokkos::deep_copy( coordinates_b, std::get<2>( b ) );
+
+    unsigned int const n_cells_a = topologies_a.extent( 0 );
+    unsigned int const n_cells_b = topologies_b.extent( 0 );
+    unsigned int const n_cell_nodes_a = cells_a.extent( 0 );
+    unsigned int const n_cell_nodes_b = cells_b.extent( 0 );
+    unsigned int const n_nodes_a = coordinates_a.extent( 0 );
+    unsigned int const n_nodes_b = coordinates_b.extent( 0 );
+    unsigned int const dim = coordinates_a.extent( 1 );
+
+    Kokkos::View<DTK_CellTopology *, DeviceType> topologies(
+        "cell_topologies", n_cells_a + n_cells_b );
+    Kokkos::View<unsigned int *, DeviceType> cells(
+        "cells", n_cell_nodes_a + n_cell_nodes_b );
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> coordinates(
+        "coordinates", n_nodes_a + n_nodes_b, dim );
+    auto topologies_host = Kokkos::create_mirror_view( topologies );
+    auto cells_host = Kokkos::create_mirror_view( cells );
+    auto coordinates_host = Kokkos::create_mirror_view( coordinates );
+    for ( unsigned int i = 0; i < n_cells_a; ++i )
+        topologies_host( i ) = topologies_a( i );
+    for ( unsigned int i = 0; i < n_cells_b; ++i )
+        topologies_host( n_cells_a + i ) = topologies_b( i );
+    for ( unsigned int i = 0; i < n_cell_nodes_a; ++i )
+        cells_host( i ) = cells_a( i );
+    for ( unsigned int i = 0; i < n_cell_nodes_b; ++i )
+        cells_host( n_cell_nodes_a + i ) = n_nodes_a + cells_b( i );
+    for ( unsigned int i = 0; i < n_nodes_a; ++i )
+        for ( unsigned int d = 0; d < dim; ++d )
+            coordinates_host( i, d ) = coordinates_a( i, d );
+    for ( unsigned int i = 0; i < n_nodes_b; ++i )
+        for ( unsigned int d = 0; d < dim; ++d )
+            coordinates_host( n_nodes_a + i, d ) =
+                coordinates_b( i, d ) + ( d == 0 ? shift : 0. );
+    Kokkos::deep_copy( topologies, topologies_host );
+    Kokkos::deep_copy( cells, cells_host );
+    Kokkos::deep_copy( coordinates, coordinates_host );
+    return std::make_tuple( topologies, cells, coordinates );
+}
+
+// Generate the mesh of the calling process.  The meshes of the processes are
+// stacked along the last direction.  A mixed mesh is made of a structured
+// mesh of quadrilaterals or hexahedra next to a mesh of triangles or
+// tetrahedra along the x-axis.
+template <typename DeviceType>
+Mesh<DeviceType> makeMesh( Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
+                           unsigned int dim, MeshType mesh_type,
+                           unsigned int n_sub )
+{
+    // The simplex mesh needs an even number of subdivisions in 3D.
+    if ( mesh_type == MeshType::mixed && n_sub % 2 == 1 )
+        ++n_sub;
+    std::vector<unsigned int> n_subdivisions( dim, n_sub );
+    auto const structured_mesh =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+    if ( mesh_type == MeshType::structured )
+        return structured_mesh;
+    auto const simplex_mesh =
+        buildSimplexMesh<DeviceType>( comm, n_subdivisions );
+    return mergeMeshes<DeviceType>( structured_mesh, simplex_mesh, n_sub );
+}
+
+// Generate random points in the mesh of the next process so that all of them
+// are found on another process.
+template <typename DeviceType>
+Kokkos::View<DataTransferKit::Coordinate **, DeviceType>
+makePoints( Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
+            unsigned int dim, MeshType mesh_type, unsigned int n_sub,
+            int n_points )
+{
+    if ( mesh_type == MeshType::mixed && n_sub % 2 == 1 )
+        ++n_sub;
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+    double const length_x =
+        ( mesh_type == MeshType::mixed ? 2. : 1. ) * n_sub;
+    double const offset = ( ( comm_rank + 1 ) % comm_size ) * n_sub;
+
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> points(
+        "points", n_points, dim );
+    auto points_host = Kokkos::create_mirror_view( points );
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( 0., 1. );
+    for ( int i = 0; i < n_points; ++i )
+    {
+        points_host( i, 0 ) = length_x * distribution( generator );
+        for ( unsigned int d = 1; d < dim; ++d )
+            points_host( i, d ) = n_sub * distribution( generator );
+        points_host( i, dim - 1 ) += offset;
+    }
+    Kokkos::deep_copy( points, points_host );
+    return points;
+}
+
+std::string topologyName( DTK_CellTopology topology )
+{
+    switch ( topology )
+    {
+    case DTK_TRI_3:
+        return "TRI_3";
+    case DTK_QUAD_4:
+        return "QUAD_4";
+    case DTK_TET_4:
+        return "TET_4";
+    case DTK_HEX_8:
+        return "HEX_8";
+    default:
+        return std::to_string( topology );
+    }
+}
+
+// Report the time spent in each phase of the operations, averaged over the
+// iterations, as counters of the benchmark.
+void setCounters( benchmark::State &state,
+                  std::map<std::string, double> const &times )
+{
+    for ( auto const &phase : times )
+        state.counters[phase.first] = phase.second / state.iterations();
+}
+
+template <class DeviceType>
+void BM_point_search_setup( benchmark::State &state )
+{
+    unsigned int const dim = state.range( 0 );
+    MeshType const mesh_type = static_cast<MeshType>( state.range( 1 ) );
+    unsigned int const n_sub = state.range( 2 );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        makeMesh<DeviceType>( comm, dim, mesh_type, n_sub );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        DataTransferKit::PointSearch<DeviceType> point_search(
+            comm, cell_topologies, cells, coordinates );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+template <class DeviceType>
+void BM_point_search( benchmark::State &state )
+{
+    unsigned int const dim = state.range( 0 );
+    MeshType const mesh_type = static_cast<MeshType>( state.range( 1 ) );
+    unsigned int const n_sub = state.range( 2 );
+    int const n_points = state.range( 3 );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        makeMesh<DeviceType>( comm, dim, mesh_type, n_sub );
+    auto const points =
+        makePoints<DeviceType>( comm, dim, mesh_type, n_sub, n_points );
+    DataTransferKit::PointSearch<DeviceType> point_search(
+        comm, cell_topologies, cells, coordinates );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        point_search.search( points );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+// Run the phases of the setup and of the search one by one with the public
+// building blocks of PointSearch so that each of them can be timed, the
+// point-in-cell test of each topology on its own.
+template <class DeviceType>
+void BM_point_search_phases( benchmark::State &state )
+{
+    unsigned int const dim = state.range( 0 );
+    MeshType const mesh_type = static_cast<MeshType>( state.range( 1 ) );
+    unsigned int const n_sub = state.range( 2 );
+    int const n_points = state.range( 3 );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        makeMesh<DeviceType>( comm, dim, mesh_type, n_sub );
+    auto const points =
+        makePoints<DeviceType>( comm, dim, mesh_type, n_sub, n_points );
+    DataTransferKit::PointSearch<DeviceType> point_search(
+        comm, cell_topologies, cells, coordinates );
+
+    unsigned int const n_cells = cell_topologies.extent( 0 );
+    auto cell_topologies_host = Kokkos::create_mirror_view( cell_topologies );
+    Kokkos::deep_copy( cell_topologies_host, cell_topologies );
+    std::array<unsigned int, DTK_N_TOPO> n_cells_per_topo;
+    n_cells_per_topo.fill( 0 );
+    for ( unsigned int i = 0; i < n_cells; ++i )
+        ++n_cells_per_topo[cell_topologies_host( i )];
+
+    // The distributed search is done in 3D.
+    Kokkos::View<double **, DeviceType> points_3d( "points_3d", n_points, 3 );
+    Kokkos::deep_copy(
+        Kokkos::subview( points_3d, Kokkos::ALL, std::make_pair( 0u, dim ) ),
+        points );
+
+    std::map<std::string, double> times;
+    for ( auto _ : state )
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto lap = [&times, &start]( std::string const &phase ) -> double {
+            Kokkos::fence();
+            auto const now = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed_seconds = now - start;
+            times[phase] += elapsed_seconds.count();
+            start = now;
+            return elapsed_seconds.count();
+        };
+        double elapsed = 0.;
+
+        std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO>
+            block_cells;
+        std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+            block_connectivities;
+        Kokkos::View<DataTransferKit::Box *, DeviceType> bounding_boxes(
+            "bounding_boxes", n_cells );
+        Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell(
+            "bounding_box_to_cell", n_cells, DTK_N_TOPO );
+        Kokkos::deep_copy( bounding_box_to_cell,
+                           static_cast<unsigned int>( -1 ) );
+        point_search.convertMesh( n_cells_per_topo, cell_topologies, cells,
+                                  coordinates, false, block_cells,
+                                  block_connectivities, bounding_boxes,
+                                  bounding_box_to_cell );
+        elapsed += lap( "convert mesh" );
+
+        Kokkos::View<DataTransferKit::Point *, DeviceType> imported_points(
+            "imported_points", 0 );
+        Kokkos::View<int *, DeviceType> imported_query_ids(
+            "imported_query_ids", 0 );
+        Kokkos::View<int *, DeviceType> imported_cell_indices(
+            "imported_indices", 0 );
+        Kokkos::View<int *, DeviceType> ranks( "ranks", 0 );
+        point_search.performDistributedSearch(
+            points_3d, imported_points, imported_query_ids,
+            imported_cell_indices, ranks );
+        elapsed += lap( "distributed search" );
+
+        // Gather the candidates of each topology, which is not timed.
+        unsigned int const n_imports = imported_points.extent( 0 );
+        auto imported_points_host =
+            Kokkos::create_mirror_view( imported_points );
+        Kokkos::deep_copy( imported_points_host, imported_points );
+        auto imported_cell_indices_host =
+            Kokkos::create_mirror_view( imported_cell_indices );
+        Kokkos::deep_copy( imported_cell_indices_host, imported_cell_indices );
+        auto bounding_box_to_cell_host =
+            Kokkos::create_mirror_view( bounding_box_to_cell );
+        Kokkos::deep_copy( bounding_box_to_cell_host, bounding_box_to_cell );
+        std::array<std::vector<unsigned int>, DTK_N_TOPO> candidates;
+        for ( unsigned int i = 0; i < n_imports; ++i )
+            candidates[cell_topologies_host( imported_cell_indices_host( i ) )]
+                .push_back( i );
+
+        for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+        {
+            unsigned int const n_candidates = candidates[topo_id].size();
+            if ( n_candidates == 0 )
+                continue;
+            Kokkos::View<double **, DeviceType> candidate_points(
+                "candidate_points", n_candidates, dim );
+            Kokkos::View<int *, DeviceType> candidate_cells( "candidate_cells",
+                                                             n_candidates );
+            auto candidate_points_host =
+                Kokkos::create_mirror_view( candidate_points );
+            auto candidate_cells_host =
+                Kokkos::create_mirror_view( candidate_cells );
+            for ( unsigned int i = 0; i < n_candidates; ++i )
+            {
+                unsigned int const j = candidates[topo_id][i];
+                for ( unsigned int d = 0; d < dim; ++d )
+                    candidate_points_host( i, d ) =
+                        imported_points_host( j )[d];
+                candidate_cells_host( i ) = bounding_box_to_cell_host(
+                    imported_cell_indices_host( j ), topo_id );
+            }
+            Kokkos::deep_copy( candidate_points, candidate_points_host );
+            Kokkos::deep_copy( candidate_cells, candidate_cells_host );
+            Kokkos::View<double **, DeviceType> reference_points(
+                "reference_points", n_candidates, dim );
+            Kokkos::View<bool *, DeviceType> point_in_cell( "point_in_cell",
+                                                            n_candidates );
+            lap( "gather candidates" );
+
+            auto const topo = static_cast<DTK_CellTopology>( topo_id );
+            DataTransferKit::PointInCell<DeviceType>::search(
+                candidate_points, block_cells[topo_id], candidate_cells, topo,
+                reference_points, point_in_cell );
+            elapsed += lap( "point in cell " + topologyName( topo ) );
+        }
+
+        state.SetIterationTime( elapsed );
+    }
+    // The candidates are gathered on the host for the benchmark only.
+    times.erase( "gather candidates" );
+    setCounters( state, times );
+}
+
+template <class DeviceType>
+void BM_interpolation_apply( benchmark::State &state )
+{
+    unsigned int const dim = state.range( 0 );
+    MeshType const mesh_type = static_cast<MeshType>( state.range( 1 ) );
+    unsigned int const n_sub = state.range( 2 );
+    int const n_points = state.range( 3 );
+    unsigned int const n_fields = state.range( 4 );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        makeMesh<DeviceType>( comm, dim, mesh_type, n_sub );
+    auto const points =
+        makePoints<DeviceType>( comm, dim, mesh_type, n_sub, n_points );
+
+    // The dofs of the lowest order elements are the nodes.
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<DataTransferKit::LocalOrdinal *, DeviceType> cell_dofs_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "cell_dofs_ids" ),
+        cells.extent( 0 ) );
+    Kokkos::parallel_for(
+        "mesh_driver:make_cell_dofs_ids",
+        Kokkos::RangePolicy<ExecutionSpace>( 0, cells.extent( 0 ) ),
+        KOKKOS_LAMBDA( int const i ) { cell_dofs_ids( i ) = cells( i ); } );
+    Kokkos::fence();
+    DataTransferKit::Interpolation<DeviceType> interpolation(
+        comm, cell_topologies, cells, coordinates, points, cell_dofs_ids,
+        DTK_HGRAD );
+
+    unsigned int const n_dofs = coordinates.extent( 0 );
+    Kokkos::View<double **, DeviceType> X(
+        Kokkos::ViewAllocateWithoutInitializing( "X" ), n_dofs, n_fields );
+    Kokkos::parallel_for( "mesh_driver:make_values",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_dofs ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              for ( unsigned int k = 0; k < n_fields; ++k )
+                                  X( i, k ) = ( i + k ) % 7;
+                          } );
+    Kokkos::fence();
+    Kokkos::View<double **, DeviceType> Y( "Y", n_points, n_fields );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        interpolation.apply( X, Y );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+// Small and large structured and mixed meshes in 2D and 3D.  The large ones
+// have as many points per cell as the small ones.
+std::vector<std::array<int, 4>> meshProblems()
+{
+    std::vector<std::array<int, 4>> problems;
+    for ( int dim : {2, 3} )
+        for ( MeshType mesh_type : {MeshType::structured, MeshType::mixed} )
+            for ( int scale : {1, 2} )
+            {
+                int const n_sub =
+                    scale * ( dim == 2 ? subdivisions_2d : subdivisions_3d );
+                int n_pts = points_per_rank;
+                for ( int d = 0; d < dim; ++d )
+                    n_pts *= scale;
+                problems.push_back(
+                    {{dim, static_cast<int>( mesh_type ), n_sub, n_pts}} );
+            }
+    return problems;
+}
+
+void meshArguments( benchmark::internal::Benchmark *benchmark )
+{
+    for ( auto const &p : meshProblems() )
+        benchmark->Args( {p[0], p[1], p[2], p[3]} );
+}
+
+// Same problems with 1, 3, and 8 fields interpolated at once.
+void interpolationArguments( benchmark::internal::Benchmark *benchmark )
+{
+    for ( auto const &p : meshProblems() )
+        for ( int n_fields : {1, 3, 8} )
+            benchmark->Args( {p[0], p[1], p[2], p[3], n_fields} );
+}
+
+class KokkosScopeGuard
+{
+  public:
+    KokkosScopeGuard( int &argc, char *argv[] )
+    {
+        Kokkos::initialize( argc, argv );
+    }
+    ~KokkosScopeGuard() { Kokkos::finalize(); }
+};
+
+#define REGISTER_BENCHMARK( DeviceType )                                       \
+    BENCHMARK_TEMPLATE( BM_point_search_setup, DeviceType )                    \
+        ->Apply( meshArguments )                                               \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_point_search, DeviceType )                          \
+        ->Apply( meshArguments )                                               \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_point_search_phases, DeviceType )                   \
+        ->Apply( meshArguments )                                               \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_interpolation_apply, DeviceType )                   \
+        ->Apply( interpolationArguments )                                      \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );
+
+int main( int argc, char *argv[] )
+{
+    Teuchos::GlobalMPISession mpi_session( &argc, &argv );
+    KokkosScopeGuard guard( argc, argv );
+
+    bool const throw_exceptions = false;
+    bool const recognise_all_options = false;
+    Teuchos::CommandLineProcessor clp( throw_exceptions,
+                                       recognise_all_options );
+    clp.setOption( "subdivisions-2d", &subdivisions_2d,
+                   "number of subdivisions along each direction of the 2D "
+                   "mesh of each MPI rank for the small problem (the large "
+                   "one has twice as many)" );
+    clp.setOption( "subdivisions-3d", &subdivisions_3d,
+                   "number of subdivisions along each direction of the 3D "
+                   "mesh of each MPI rank for the small problem (the large "
+                   "one has twice as many)" );
+    clp.setOption( "points", &points_per_rank,
+                   "number of points searched for per MPI rank for the small "
+                   "problem (the large one has as many points per cell)" );
+
+    switch ( clp.parse( argc, argv, NULL ) )
+    {
+    case Teuchos::CommandLineProcessor::PARSE_ERROR:
+        return EXIT_FAILURE;
+    case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+    case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+        clp.printHelpMessage( "benchmark", std::cout );
+    case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+        break;
+    }
+
+    // benchmark::Initialize() calls exit(0) when `--help` so register
+    // Kokkos::finalize() to be called on normal program termination.
+    std::atexit( Kokkos::finalize );
+    // The results, including the time of each phase, are written as JSON
+    // with --benchmark_out=<file> --benchmark_out_format=json.
+    benchmark::Initialize( &argc, argv );
+
+    // Throw if an option is not recognised
+    clp.throwExceptions( true );
+    clp.recogniseAllOptions( true );
+    switch ( clp.parse( argc, argv, NULL ) )
+    {
+    case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+    case Teuchos::CommandLineProcessor::PARSE_ERROR:
+        return EXIT_FAILURE;
+    case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+    case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+        break;
+    }
+
+#ifdef KOKKOS_ENABLE_SERIAL
+    using Serial = Kokkos::Compat::KokkosSerialWrapperNode::device_type;
+    REGISTER_BENCHMARK( Serial );
+#endif
+
+#ifdef KOKKOS_ENABLE_OPENMP
+    using OpenMP = Kokkos::Compat::KokkosOpenMPWrapperNode::device_type;
+    REGISTER_BENCHMARK( OpenMP );
+#endif
+
+#ifdef KOKKOS_ENABLE_CUDA
+    using Cuda = Kokkos::Compat::KokkosCudaWrapperNode::device_type;
+    REGISTER_BENCHMARK( Cuda );
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    return EXIT_SUCCESS;
+}
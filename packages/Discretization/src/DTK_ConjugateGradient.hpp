@@ -0,0 +1,147 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_CONJUGATE_GRADIENT_HPP
+#define DTK_CONJUGATE_GRADIENT_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsUtils.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <cmath>
+
+namespace DataTransferKit
+{
+namespace internal
+{
+/**
+ * Compute y = A x where A is a sparse matrix in compressed row storage.
+ */
+template <typename DeviceType, typename ColumnType, typename ValueType,
+          typename XView, typename YView>
+void spmv( Kokkos::View<unsigned int *, DeviceType> offset,
+           Kokkos::View<ColumnType *, DeviceType> columns,
+           Kokkos::View<ValueType *, DeviceType> values, XView x, YView y )
+{
+    DTK_REQUIRE( offset.extent( 0 ) == y.extent( 0 ) + 1 );
+
+    using Scalar = typename YView::non_const_value_type;
+    unsigned int const n_rows = y.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for( DTK_MARK_REGION( "spmv" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              Scalar sum = 0;
+                              for ( unsigned int j = offset( i );
+                                    j < offset( i + 1 ); ++j )
+                                  sum += values( j ) * x( columns( j ) );
+                              y( i ) = sum;
+                          } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType, typename XView, typename YView>
+typename XView::non_const_value_type dot( XView x, YView y )
+{
+    DTK_REQUIRE( x.extent( 0 ) == y.extent( 0 ) );
+
+    using Scalar = typename XView::non_const_value_type;
+    unsigned int const n = x.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Scalar result = 0;
+    Kokkos::parallel_reduce( DTK_MARK_REGION( "dot" ),
+                             Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                             KOKKOS_LAMBDA( int const i, Scalar &sum ) {
+                                 sum += x( i ) * y( i );
+                             },
+                             result );
+    return result;
+}
+
+/**
+ * Solve A x = b with the conjugate gradient method preconditioned by the
+ * inverse of the diagonal of A, starting from x = 0. A must be symmetric
+ * positive definite. Iterate until the norm of the residual is smaller than
+ * tolerance times the norm of b. Return the number of iterations.
+ */
+template <typename DeviceType, typename BView, typename XView>
+unsigned int conjugateGradient(
+    Kokkos::View<unsigned int *, DeviceType> offset,
+    Kokkos::View<LocalOrdinal *, DeviceType> columns,
+    Kokkos::View<double *, DeviceType> values,
+    Kokkos::View<double *, DeviceType> inv_diagonal, BView b, XView x,
+    double tolerance, unsigned int max_iterations )
+{
+    DTK_REQUIRE( inv_diagonal.extent( 0 ) == b.extent( 0 ) );
+    DTK_REQUIRE( x.extent( 0 ) == b.extent( 0 ) );
+
+    using Scalar = typename XView::non_const_value_type;
+    unsigned int const n = b.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<Scalar *, DeviceType> r(
+        Kokkos::ViewAllocateWithoutInitializing( "r" ), n );
+    Kokkos::View<Scalar *, DeviceType> z(
+        Kokkos::ViewAllocateWithoutInitializing( "z" ), n );
+    Kokkos::View<Scalar *, DeviceType> p(
+        Kokkos::ViewAllocateWithoutInitializing( "p" ), n );
+    Kokkos::View<Scalar *, DeviceType> q(
+        Kokkos::ViewAllocateWithoutInitializing( "q" ), n );
+
+    Kokkos::parallel_for( DTK_MARK_REGION( "cg_initialize" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              x( i ) = 0;
+                              r( i ) = b( i );
+                              z( i ) = inv_diagonal( i ) * b( i );
+                              p( i ) = z( i );
+                          } );
+    Kokkos::fence();
+
+    double const b_norm = std::sqrt( dot<DeviceType>( b, b ) );
+    if ( b_norm == 0. )
+        return 0;
+
+    Scalar rz = dot<DeviceType>( r, z );
+    for ( unsigned int iteration = 1; iteration <= max_iterations;
+          ++iteration )
+    {
+        spmv( offset, columns, values, p, q );
+        Scalar const alpha = rz / dot<DeviceType>( p, q );
+        Kokkos::parallel_for( DTK_MARK_REGION( "cg_update_solution" ),
+                              Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                              KOKKOS_LAMBDA( int const i ) {
+                                  x( i ) += alpha * p( i );
+                                  r( i ) -= alpha * q( i );
+                                  z( i ) = inv_diagonal( i ) * r( i );
+                              } );
+        Kokkos::fence();
+
+        if ( std::sqrt( dot<DeviceType>( r, r ) ) <= tolerance * b_norm )
+            return iteration;
+
+        Scalar const rz_new = dot<DeviceType>( r, z );
+        Scalar const beta = rz_new / rz;
+        rz = rz_new;
+        Kokkos::parallel_for( DTK_MARK_REGION( "cg_update_direction" ),
+                              Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                              KOKKOS_LAMBDA( int const i ) {
+                                  p( i ) = z( i ) + beta * p( i );
+                              } );
+        Kokkos::fence();
+    }
+
+    return max_iterations;
+}
+} // namespace internal
+} // namespace DataTransferKit
+
+#endif
@@ -12,6 +12,9 @@
 #ifndef DTK_INTERPOLATION_FUNCTOR_HPP
 #define DTK_INTERPOLATION_FUNCTOR_HPP
 
+#include <DTK_NativeBasis.hpp>
+
+#include <Kokkos_Core.hpp>
 #include <Kokkos_Macros.hpp>
 #include <Kokkos_View.hpp>
 
@@ -19,25 +22,26 @@ namespace DataTransferKit
 {
 namespace Functor
 {
-template <typename Scalar, typename BasisType, typename DeviceType>
-class Interpolation
+/**
+ * Compute the interpolation weights of vector-valued basis functions at the
+ * reference points. The value of the field is the sum of the components
+ * of the basis functions weighted by the dof values.
+ */
+template <typename BasisType, typename DeviceType>
+class InterpolationWeights
 {
   public:
-    Interpolation( unsigned int const dim,
-                   Kokkos::View<Coordinate **, DeviceType> reference_points,
-                   Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
-                   Kokkos::View<Scalar **, DeviceType> dof_values,
-                   Kokkos::View<Scalar **, DeviceType> output )
+    InterpolationWeights(
+        unsigned int const dim,
+        Kokkos::View<Coordinate **, DeviceType> reference_points,
+        Kokkos::View<Coordinate **, DeviceType> weights )
         : _dim( dim )
-        , _n_basis( cell_dofs_ids.extent( 1 ) )
-        , _n_fields( dof_values.extent( 1 ) )
-        , _basis_values( "basis_values", output.extent( 0 ), _n_basis, dim )
+        , _n_basis( weights.extent( 1 ) )
+        , _basis_values( "basis_values", weights.extent( 0 ), _n_basis, dim )
         , _reference_points( reference_points )
-        , _cell_dofs_ids( cell_dofs_ids )
-        , _dof_values( dof_values )
-        , _output( output )
+        , _weights( weights )
     {
-        DTK_REQUIRE( _output.extent( 1 ) == dof_values.extent( 1 ) );
+        DTK_REQUIRE( _weights.extent( 0 ) == _reference_points.extent( 0 ) );
     }
 
     KOKKOS_INLINE_FUNCTION
@@ -49,64 +53,175 @@ class Interpolation
         BasisType::getValues( basis_values, ref_point );
 
         for ( unsigned int j = 0; j < _n_basis; ++j )
+        {
+            _weights( i, j ) = 0.;
             for ( unsigned int d = 0; d < _dim; ++d )
-                for ( unsigned int k = 0; k < _n_fields; ++k )
-                    _output( i, k ) += basis_values( j, d ) *
-                                       _dof_values( _cell_dofs_ids( i, j ), k );
+                _weights( i, j ) += basis_values( j, d );
+        }
     }
 
   private:
     unsigned int const _dim;
     unsigned int const _n_basis;
-    unsigned int const _n_fields;
     Kokkos::DynRankView<Coordinate, DeviceType> _basis_values;
     Kokkos::View<Coordinate **, DeviceType> _reference_points;
-    Kokkos::View<LocalOrdinal **, DeviceType> _cell_dofs_ids;
-    Kokkos::View<Scalar **, DeviceType> _dof_values;
-    Kokkos::View<Scalar **, DeviceType> _output;
+    Kokkos::View<Coordinate **, DeviceType> _weights;
+};
+
+/**
+ * Compute the interpolation weights of scalar basis functions at the
+ * reference points, i.e., the values of the basis functions.
+ */
+template <typename BasisType, typename DeviceType>
+class HgradInterpolationWeights
+{
+  public:
+    HgradInterpolationWeights(
+        Kokkos::View<Coordinate **, DeviceType> reference_points,
+        Kokkos::View<Coordinate **, DeviceType> weights )
+        : _reference_points( reference_points )
+        , _weights( weights )
+    {
+        DTK_REQUIRE( _weights.extent( 0 ) == _reference_points.extent( 0 ) );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        auto ref_point = Kokkos::subview( _reference_points, i, Kokkos::ALL() );
+        auto weights = Kokkos::subview( _weights, i, Kokkos::ALL() );
+        BasisType::getValues( weights, ref_point );
+    }
+
+  private:
+    Kokkos::View<Coordinate **, DeviceType> _reference_points;
+    // The weights must have the same type as the reference points because
+    // of a check in Basis_HGRAD_PYR_C1_FEM.
+    Kokkos::View<Coordinate **, DeviceType> _weights;
 };
 
-template <typename Scalar, typename BasisType, typename DeviceType>
-class HgradInterpolation
+/**
+ * Same as HgradInterpolationWeights for the bases that DTK evaluates itself
+ * (see Details::NativeBasis).  The reference point and the values of the
+ * basis functions are kept in local arrays instead of strided subviews.
+ */
+template <typename FEOpType, typename DeviceType>
+class NativeHgradInterpolationWeights
 {
   public:
-    HgradInterpolation(
+    using Basis = Details::NativeBasis<FEOpType>;
+
+    NativeHgradInterpolationWeights(
         Kokkos::View<Coordinate **, DeviceType> reference_points,
-        Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
+        Kokkos::View<Coordinate **, DeviceType> weights )
+        : _reference_points( reference_points )
+        , _weights( weights )
+    {
+        DTK_REQUIRE( _weights.extent( 0 ) == _reference_points.extent( 0 ) );
+        DTK_REQUIRE( _reference_points.extent_int( 1 ) == Basis::dim );
+        DTK_REQUIRE( _weights.extent_int( 1 ) == Basis::cardinality );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        Coordinate ref_point[Basis::dim];
+        for ( int d = 0; d < Basis::dim; ++d )
+            ref_point[d] = _reference_points( i, d );
+        Coordinate values[Basis::cardinality];
+        Basis::getValues( ref_point, values );
+        for ( int j = 0; j < Basis::cardinality; ++j )
+            _weights( i, j ) = values[j];
+    }
+
+  private:
+    Kokkos::View<Coordinate **, DeviceType> _reference_points;
+    Kokkos::View<Coordinate **, DeviceType> _weights;
+};
+
+/**
+ * Functor that computes the weights of the scalar basis functions whose
+ * Intrepid2 serial operator is FEOpType: the native evaluation when there is
+ * one and Intrepid2 otherwise.
+ */
+template <typename FEOpType, typename DeviceType,
+          bool = Details::NativeBasis<FEOpType>::is_native>
+struct HgradWeightsFunctor
+{
+    using type = HgradInterpolationWeights<FEOpType, DeviceType>;
+};
+
+template <typename FEOpType, typename DeviceType>
+struct HgradWeightsFunctor<FEOpType, DeviceType, true>
+{
+    using type = NativeHgradInterpolationWeights<FEOpType, DeviceType>;
+};
+
+/**
+ * Interpolate a block of n_block consecutive fields at the reference points
+ * using their interpolation stencils in compressed row storage. Each team
+ * takes care of one reference point and each thread of the team of n_block
+ * fields, so that the dofs and the weights of the stencil are loaded once
+ * for all the fields of the block.
+ */
+template <typename Scalar, int n_block, typename DeviceType>
+class BlockedInterpolation
+{
+  public:
+    using member_type = typename Kokkos::TeamPolicy<
+        typename DeviceType::execution_space>::member_type;
+
+    BlockedInterpolation(
+        unsigned int const first_field, unsigned int const n_blocks,
+        Kokkos::View<unsigned int *, DeviceType> stencil_offset,
+        Kokkos::View<LocalOrdinal *, DeviceType> stencil_dofs,
+        Kokkos::View<Coordinate *, DeviceType> stencil_weights,
         Kokkos::View<Scalar **, DeviceType> dof_values,
         Kokkos::View<Scalar **, DeviceType> output )
-        : _n_basis( cell_dofs_ids.extent( 1 ) )
-        , _n_fields( dof_values.extent( 1 ) )
-        , _basis_values( "basis_values", output.extent( 0 ), _n_basis )
-        , _reference_points( reference_points )
-        , _cell_dofs_ids( cell_dofs_ids )
+        : _first_field( first_field )
+        , _n_blocks( n_blocks )
+        , _stencil_offset( stencil_offset )
+        , _stencil_dofs( stencil_dofs )
+        , _stencil_weights( stencil_weights )
         , _dof_values( dof_values )
         , _output( output )
     {
         DTK_REQUIRE( _output.extent( 1 ) == dof_values.extent( 1 ) );
+        DTK_REQUIRE( _first_field + _n_blocks * n_block <=
+                     _output.extent( 1 ) );
     }
 
     KOKKOS_INLINE_FUNCTION
-    void operator()( int const i ) const
+    void operator()( member_type const &team ) const
     {
-        auto ref_point = Kokkos::subview( _reference_points, i, Kokkos::ALL() );
-        auto basis_values = Kokkos::subview( _basis_values, i, Kokkos::ALL() );
-        BasisType::getValues( basis_values, ref_point );
-
-        for ( unsigned int j = 0; j < _n_basis; ++j )
-            for ( unsigned int k = 0; k < _n_fields; ++k )
-                _output( i, k ) += basis_values( j ) *
-                                   _dof_values( _cell_dofs_ids( i, j ), k );
+        int const i = team.league_rank();
+        unsigned int const first = _stencil_offset( i );
+        unsigned int const last = _stencil_offset( i + 1 );
+        Kokkos::parallel_for(
+            Kokkos::TeamThreadRange( team, _n_blocks ), [&]( int const b ) {
+                unsigned int const first_field = _first_field + b * n_block;
+                Scalar values[n_block];
+                for ( int k = 0; k < n_block; ++k )
+                    values[k] = 0;
+                for ( unsigned int j = first; j < last; ++j )
+                {
+                    Coordinate const weight = _stencil_weights( j );
+                    LocalOrdinal const dof = _stencil_dofs( j );
+                    for ( int k = 0; k < n_block; ++k )
+                        values[k] +=
+                            weight * _dof_values( dof, first_field + k );
+                }
+                for ( int k = 0; k < n_block; ++k )
+                    _output( i, first_field + k ) = values[k];
+            } );
     }
 
   private:
-    unsigned int _n_basis;
-    unsigned int _n_fields;
-    // We cannot use Scalar because in Basis_HGRAD_PYR_C1_FEM there is a
-    // check that basis_values and ref_point have the same type.
-    Kokkos::View<Coordinate **, DeviceType> _basis_values;
-    Kokkos::View<Coordinate **, DeviceType> _reference_points;
-    Kokkos::View<LocalOrdinal **, DeviceType> _cell_dofs_ids;
+    unsigned int const _first_field;
+    unsigned int const _n_blocks;
+    Kokkos::View<unsigned int *, DeviceType> _stencil_offset;
+    Kokkos::View<LocalOrdinal *, DeviceType> _stencil_dofs;
+    Kokkos::View<Coordinate *, DeviceType> _stencil_weights;
     Kokkos::View<Scalar **, DeviceType> _dof_values;
     Kokkos::View<Scalar **, DeviceType> _output;
 };
@@ -23,7 +23,6 @@
 #include <DTK_Topology.hpp>
 
 #include <Intrepid2_FunctionSpaceTools.hpp>
-#include <Tpetra_Distributor.hpp>
 
 #include <string>
 
@@ -73,47 +72,95 @@ class Interpolation
     apply( Kokkos::View<Scalar **, DeviceType> X,
            Kokkos::View<Scalar **, DeviceType> Y );
 
+    /**
+     * Compute the interpolation stencil of each local reference point.
+     *
+     * @note This function should be <b>private</b> but lambda functions can
+     * only be called from a public function in CUDA.
+     */
+    void buildStencils(
+        std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO> const
+            &dofs_ids );
+
+    /**
+     * Select the reference points that are evaluated, i.e. a single one for
+     * each point found in several cells, and compute which of the imported
+     * values is returned for each point that has been found.
+     *
+     * @note This function should be <b>private</b> but lambda functions can
+     * only be called from a public function in CUDA.
+     */
+    void buildImportMap();
+
   private:
     void filter_dofs_ids(
         Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
         Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids,
-        DTK_FEType fe_type );
+        DTK_FEType fe_type,
+        std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO>
+            &dofs_ids );
 
     /**
-     * Helper function that calls Functor::Interpolation.
+     * Helper function that calls Functor::InterpolationWeights.
      */
-    template <typename Scalar, typename FEOpType>
-    void interpolate( Kokkos::View<Coordinate **, DeviceType> ref_points,
-                      Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
-                      Kokkos::View<Scalar **, DeviceType> X,
-                      Kokkos::View<Scalar **, DeviceType> Y );
+    template <typename FEOpType>
+    void computeWeights( Kokkos::View<Coordinate **, DeviceType> ref_points,
+                         Kokkos::View<Coordinate **, DeviceType> weights );
 
     /**
-     * Helper function that calls Functor::HgradInterpolation.
+     * Helper function that calls Functor::HgradInterpolationWeights, or
+     * Functor::NativeHgradInterpolationWeights when DTK evaluates the basis
+     * itself.
      */
-    template <typename Scalar, typename FEOpType>
+    template <typename FEOpType>
     void
-    hgradInterpolate( Kokkos::View<Coordinate **, DeviceType> ref_points,
-                      Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
-                      Kokkos::View<Scalar **, DeviceType> X,
-                      Kokkos::View<Scalar **, DeviceType> Y );
+    hgradComputeWeights( Kokkos::View<Coordinate **, DeviceType> ref_points,
+                         Kokkos::View<Coordinate **, DeviceType> weights );
 
-    template <typename Scalar>
-    void interpolateDispatch( FE fe, unsigned int fe_id,
-                              Kokkos::View<Scalar **, DeviceType> X,
-                              Kokkos::View<Scalar **, DeviceType> Y_fe );
+    /**
+     * Interpolate as many blocks of n_block fields as possible, starting at
+     * field first_field, using Functor::BlockedInterpolation. first_field is
+     * updated to the first field that has not been interpolated.
+     */
+    template <typename Scalar, int n_block>
+    void interpolateBlocks( Kokkos::View<Scalar **, DeviceType> X,
+                            Kokkos::View<Scalar **, DeviceType> Y_buffer,
+                            unsigned int &first_field );
+
+    void
+    computeWeightsDispatch( FE fe, unsigned int topo_id,
+                            Kokkos::View<Coordinate **, DeviceType> weights );
 
     PointSearch<DeviceType> _point_search;
 
     /**
-     * Dofs ids associated to each node of the cells.
+     * Plan of the exchange of the interpolated values. Only the values of
+     * the reference points that are kept are sent.
      */
-    std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO> _dofs_ids;
+    Details::Distributor _value_distributor;
 
     /**
      * Map between the finite element index and the finite element basis.
      */
     std::array<FE, DTK_N_TOPO> _finite_elements;
+
+    /**
+     * Interpolation stencil of the local reference points in compressed row
+     * storage: the value at reference point i is the sum of the dof values
+     * of _stencil_dofs weighted by _stencil_weights between
+     * _stencil_offset(i) and _stencil_offset(i+1). The reference points are
+     * in the order in which their values are sent.
+     */
+    Kokkos::View<unsigned int *, DeviceType> _stencil_offset;
+    Kokkos::View<LocalOrdinal *, DeviceType> _stencil_dofs;
+    Kokkos::View<Coordinate *, DeviceType> _stencil_weights;
+
+    /**
+     * Index of the imported value returned for each point that has been
+     * found, by increasing query id, and the query ids themselves.
+     */
+    Kokkos::View<unsigned int *, DeviceType> _query_imports;
+    Kokkos::View<int *, DeviceType> _found_query_ids;
 };
 
 template <typename DeviceType>
@@ -124,304 +171,74 @@ Interpolation<DeviceType>::apply( Kokkos::View<Scalar **, DeviceType> X,
 {
     // Check that the input and the output have the same number of fields
     DTK_REQUIRE( X.extent( 1 ) == Y.extent( 1 ) );
+    DTK_REQUIRE( Y.extent( 0 ) >= _found_query_ids.extent( 0 ) );
     using ExecutionSpace = typename DeviceType::execution_space;
     unsigned int const n_fields = X.extent( 1 );
-    // Allocate a View that will be used as buffer for the MPI communication
-    unsigned int n_local_ref_pts = 0;
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-        n_local_ref_pts += _point_search._reference_points[topo_id].extent( 0 );
-    Kokkos::View<Scalar **, DeviceType> Y_buffer( "Y_buffer", n_local_ref_pts,
-                                                  n_fields );
-
-    unsigned int offset = 0;
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-    {
-        unsigned int const n_ref_points =
-            _point_search._reference_points[topo_id].extent( 0 );
-
-        if ( n_ref_points != 0 )
-        {
-            // Perform the interpolation itself
-            Kokkos::View<Scalar **, DeviceType> Y_fe(
-                "Y_fe_" + std::to_string( topo_id ), n_ref_points, n_fields );
-            interpolateDispatch( _finite_elements[topo_id], topo_id, X, Y_fe );
 
-            // Put Y_fe in the right place in the buffer
-            Kokkos::parallel_for(
-                DTK_MARK_REGION( "fill_buffer" ),
-                Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
-                KOKKOS_LAMBDA( int const i ) {
-                    for ( unsigned int j = 0; j < n_fields; ++j )
-                        Y_buffer( offset + i, j ) = Y_fe( i, j );
-                } );
-            Kokkos::fence();
-            offset += n_ref_points;
-        }
-    }
-
-    // Communicate the results, i.e, Y and the associated query ids
-    Kokkos::View<unsigned int *, DeviceType> query_ids( "query_ids",
-                                                        n_local_ref_pts );
-    unsigned int n_copied_pts = 0;
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-    {
-        unsigned int const size = _point_search._query_ids[topo_id].extent( 0 );
-        auto topo_query_ids = _point_search._query_ids[topo_id];
-        Kokkos::parallel_for( DTK_MARK_REGION( "query_ids" ),
-                              Kokkos::RangePolicy<ExecutionSpace>( 0, size ),
-                              KOKKOS_LAMBDA( int const i ) {
-                                  query_ids( i + n_copied_pts ) =
-                                      topo_query_ids( i );
-                              } );
-        Kokkos::fence();
-
-        n_copied_pts += size;
-    }
-    unsigned int n_imports =
-        _point_search._target_to_source_distributor.getTotalReceiveLength();
-    Kokkos::View<unsigned int *, DeviceType> imported_query_ids(
-        "imported_query_ids", n_imports );
-    Kokkos::View<Scalar **, DeviceType> imported_Y( "imported_Y", n_imports,
-                                                    n_fields );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _point_search._target_to_source_distributor, query_ids,
-        imported_query_ids );
+    // Perform the interpolation itself. The result is written directly in the
+    // buffer used for the MPI communication. The fields are processed by
+    // blocks whose size is known at compile time, the largest blocks first.
+    unsigned int const n_local_ref_pts = _stencil_offset.extent( 0 ) - 1;
+    Kokkos::View<Scalar **, DeviceType> Y_buffer(
+        Kokkos::ViewAllocateWithoutInitializing( "Y_buffer" ), n_local_ref_pts,
+        n_fields );
+    unsigned int first_field = 0;
+    interpolateBlocks<Scalar, 8>( X, Y_buffer, first_field );
+    interpolateBlocks<Scalar, 4>( X, Y_buffer, first_field );
+    interpolateBlocks<Scalar, 3>( X, Y_buffer, first_field );
+    interpolateBlocks<Scalar, 1>( X, Y_buffer, first_field );
+    DTK_CHECK( first_field == n_fields );
+
+    // Communicate the results
+    unsigned int n_imports = _value_distributor.getTotalReceiveLength();
+    Kokkos::View<Scalar **, DeviceType> imported_Y(
+        Kokkos::ViewAllocateWithoutInitializing( "imported_Y" ), n_imports,
+        n_fields );
     Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _point_search._target_to_source_distributor, Y_buffer, imported_Y );
+        _value_distributor, Y_buffer, imported_Y );
 
+    // Put the values back in the order of the query ids
     Kokkos::View<int *, DeviceType> found_query_ids( "found_query_ids",
                                                      Y.extent( 0 ) );
     Kokkos::deep_copy( found_query_ids, -1 );
-
-    if ( n_imports != 0 )
-    {
-        // Because of the MPI communications and the sorting by topologies, all
-        // the queries have been reordered. So we put them back in the initial
-        // order using the query ids.
-        Details::DistributedSearchTreeImpl<DeviceType>::sortResults(
-            imported_query_ids, imported_query_ids, imported_Y );
-
-        // We have finally all the values in the right order but before we can
-        // finally return the values we need to filter the data one more time.
-        // Some points are correctly found on multiple cells, e.g., point on
-        // vertices, so we need to get rid of the duplicates.
-        Kokkos::View<unsigned int *, DeviceType> mask( "mask", n_imports );
-        Kokkos::deep_copy( mask, 1 );
-        Kokkos::parallel_for(
-            DTK_MARK_REGION( "compute_mask" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 1, n_imports ),
-            KOKKOS_LAMBDA( int const i ) {
-                if ( imported_query_ids( i - 1 ) == imported_query_ids( i ) )
-                    mask( i ) = 0;
-            } );
-        Kokkos::fence();
-
-        Kokkos::View<unsigned int *, DeviceType> query_offset( "query_offset",
-                                                               n_imports );
-        exclusivePrefixSum( mask, query_offset );
-
-        Kokkos::parallel_for(
-            DTK_MARK_REGION( "fill_Y" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
-            KOKKOS_LAMBDA( int const i ) {
-                if ( ( i == 0 ) || ( imported_query_ids( i - 1 ) !=
-                                     imported_query_ids( i ) ) )
-                {
-                    unsigned int k = query_offset( i );
-                    for ( unsigned int j = 0; j < n_fields; ++j )
-                        Y( k, j ) = imported_Y( i, j );
-                    found_query_ids( k ) = imported_query_ids( i );
-                }
-            } );
-        Kokkos::fence();
-    }
+    unsigned int const n_found = _found_query_ids.extent( 0 );
+    auto query_imports = _query_imports;
+    auto cached_query_ids = _found_query_ids;
+    Kokkos::parallel_for( DTK_MARK_REGION( "fill_Y" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_found ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              unsigned int const j = query_imports( i );
+                              for ( unsigned int k = 0; k < n_fields; ++k )
+                                  Y( i, k ) = imported_Y( j, k );
+                              found_query_ids( i ) = cached_query_ids( i );
+                          } );
+    Kokkos::fence();
 
     return found_query_ids;
 }
 
 template <typename DeviceType>
-template <typename Scalar, typename FEOpType>
-void Interpolation<DeviceType>::interpolate(
-    Kokkos::View<Coordinate **, DeviceType> ref_points,
-    Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
+template <typename Scalar, int n_block>
+void Interpolation<DeviceType>::interpolateBlocks(
     Kokkos::View<Scalar **, DeviceType> X,
-    Kokkos::View<Scalar **, DeviceType> Y_fe )
+    Kokkos::View<Scalar **, DeviceType> Y_buffer, unsigned int &first_field )
 {
-    using ExecutionSpace = typename DeviceType::execution_space;
-    Functor::Interpolation<Scalar, FEOpType, DeviceType> interpolation_functor(
-        _point_search._dim, ref_points, cell_dofs_ids, X, Y_fe );
-    Kokkos::parallel_for(
-        DTK_MARK_REGION( "interpolate" ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, ref_points.extent( 0 ) ),
-        interpolation_functor );
-}
+    unsigned int const n_blocks = ( X.extent( 1 ) - first_field ) / n_block;
+    if ( n_blocks == 0 )
+        return;
 
-template <typename DeviceType>
-template <typename Scalar, typename FEOpType>
-void Interpolation<DeviceType>::hgradInterpolate(
-    Kokkos::View<Coordinate **, DeviceType> ref_points,
-    Kokkos::View<LocalOrdinal **, DeviceType> cell_dofs_ids,
-    Kokkos::View<Scalar **, DeviceType> X,
-    Kokkos::View<Scalar **, DeviceType> Y_fe )
-{
     using ExecutionSpace = typename DeviceType::execution_space;
-    Functor::HgradInterpolation<Scalar, FEOpType, DeviceType>
-        interpolation_functor( ref_points, cell_dofs_ids, X, Y_fe );
+    Functor::BlockedInterpolation<Scalar, n_block, DeviceType>
+        interpolation_functor( first_field, n_blocks, _stencil_offset,
+                               _stencil_dofs, _stencil_weights, X, Y_buffer );
     Kokkos::parallel_for(
-        DTK_MARK_REGION( "interpolate" ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, ref_points.extent( 0 ) ),
+        DTK_MARK_REGION( "interpolate_" + std::to_string( n_block ) ),
+        Kokkos::TeamPolicy<ExecutionSpace>( Y_buffer.extent( 0 ),
+                                            Kokkos::AUTO ),
         interpolation_functor );
-}
-
-template <typename DeviceType>
-template <typename Scalar>
-void Interpolation<DeviceType>::interpolateDispatch(
-    FE fe, unsigned int topo_id, Kokkos::View<Scalar **, DeviceType> X,
-    Kokkos::View<Scalar **, DeviceType> Y_fe )
-{
-
-    switch ( fe )
-    {
-    case FE::HEX_HCURL_1:
-    {
-        interpolate<Scalar, HEX_HCURL_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::HEX_HDIV_1:
-    {
-        interpolate<Scalar, HEX_HDIV_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::HEX_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, HEX_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::HEX_HGRAD_2:
-    {
-        hgradInterpolate<Scalar, HEX_HGRAD_2::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::PYR_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, PYR_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::QUAD_HCURL_1:
-    {
-        interpolate<Scalar, QUAD_HCURL_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::QUAD_HDIV_1:
-    {
-        interpolate<Scalar, QUAD_HDIV_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::QUAD_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, QUAD_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::QUAD_HGRAD_2:
-    {
-        hgradInterpolate<Scalar, QUAD_HGRAD_2::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TET_HCURL_1:
-    {
-        interpolate<Scalar, TET_HCURL_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TET_HDIV_1:
-    {
-        interpolate<Scalar, TET_HDIV_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TET_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, TET_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TET_HGRAD_2:
-    {
-        hgradInterpolate<Scalar, TET_HGRAD_2::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TRI_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, TRI_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::TRI_HGRAD_2:
-    {
-        hgradInterpolate<Scalar, TRI_HGRAD_2::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::WEDGE_HGRAD_1:
-    {
-        hgradInterpolate<Scalar, WEDGE_HGRAD_1::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    case FE::WEDGE_HGRAD_2:
-    {
-        hgradInterpolate<Scalar, WEDGE_HGRAD_2::feop_type>(
-            _point_search._reference_points[topo_id], _dofs_ids[topo_id], X,
-            Y_fe );
-
-        break;
-    }
-    default:
-        throw DataTransferKitNotImplementedException();
-    }
     Kokkos::fence();
+
+    first_field += n_blocks * n_block;
 }
 } // namespace DataTransferKit
 
@@ -14,6 +14,7 @@
 
 #include <DTK_FE.hpp>
 #include <DTK_PointInCell.hpp>
+#include <DTK_Statistics.hpp>
 
 namespace DataTransferKit
 {
@@ -27,20 +28,32 @@ Interpolation<DeviceType>::Interpolation(
     Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids, DTK_FEType fe_type )
     : _point_search( comm, cell_topologies, cells, nodes_coordinates,
                      points_coordinates )
+    , _value_distributor( comm )
 {
+    ScopedTimer timer( "stencils" );
+
     // Fill up _finite_element, i.e., fill up a map between topo_id and FE
     Topologies topologies;
     for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
         _finite_elements[topo_id] = getFE( topologies[topo_id].topo, fe_type );
 
     // Change the format of cell_dofs_ids
-    filter_dofs_ids( cell_topologies, cell_dof_ids, fe_type );
+    std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO> dofs_ids;
+    filter_dofs_ids( cell_topologies, cell_dof_ids, fe_type, dofs_ids );
+
+    // The reference points are fixed after the search so the interpolation
+    // weights, the reference points that are evaluated, and the order of the
+    // imported values are computed once for all the calls to apply().
+    buildStencils( dofs_ids );
+    buildImportMap();
 }
 
 template <typename DeviceType>
 void Interpolation<DeviceType>::filter_dofs_ids(
     Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-    Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids, DTK_FEType fe_type )
+    Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids, DTK_FEType fe_type,
+    std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO>
+        &dofs_ids )
 {
     // We need to filter the dof_ids and only keep the cells where a point
     // was found. Because multiple points may be in the same cells, the
@@ -70,13 +83,21 @@ void Interpolation<DeviceType>::filter_dofs_ids(
         unsigned int const n_dofs_per_cell =
             getCardinality<DeviceType>( _finite_elements[topo_id] );
 
+        auto cell_indices_host =
+            Kokkos::create_mirror_view( _point_search._cell_indices[topo_id] );
+        Kokkos::deep_copy( cell_indices_host,
+                           _point_search._cell_indices[topo_id] );
+        auto cell_indices_map_host = Kokkos::create_mirror_view(
+            _point_search._cell_indices_map[topo_id] );
+        Kokkos::deep_copy( cell_indices_map_host,
+                           _point_search._cell_indices_map[topo_id] );
+
         // For each cell which contains a target point, we reformat cell_dof_ids
-        for ( unsigned int i = 0;
-              i < _point_search._query_ids[topo_id].extent( 0 ); ++i )
+        unsigned int const n_found = cell_indices_host.extent( 0 );
+        for ( unsigned int i = 0; i < n_found; ++i )
         {
             unsigned int const cell_id =
-                _point_search._cell_indices_map
-                    [topo_id][_point_search._cell_indices[topo_id]( i )];
+                cell_indices_map_host( cell_indices_host( i ) );
             unsigned int const offset = dof_offset[cell_id];
             std::vector<unsigned int> current_cell_dof_ids( n_dofs_per_cell );
             for ( unsigned int j = 0; j < n_dofs_per_cell; ++j )
@@ -91,15 +112,400 @@ void Interpolation<DeviceType>::filter_dofs_ids(
         unsigned int const fe_n_cells = filtered_dof_ids[topo_id].size();
         unsigned int const n_dofs_per_cell =
             ( fe_n_cells > 0 ) ? filtered_dof_ids[topo_id][0].size() : 0;
-        _dofs_ids[topo_id] = Kokkos::View<LocalOrdinal **, DeviceType>(
+        dofs_ids[topo_id] = Kokkos::View<LocalOrdinal **, DeviceType>(
             "cell_dofs_ids_" + std::to_string( topo_id ), fe_n_cells,
             n_dofs_per_cell );
-        auto dofs_ids_host = Kokkos::create_mirror_view( _dofs_ids[topo_id] );
+        auto dofs_ids_host = Kokkos::create_mirror_view( dofs_ids[topo_id] );
         for ( unsigned int i = 0; i < fe_n_cells; ++i )
             for ( unsigned int j = 0; j < n_dofs_per_cell; ++j )
                 dofs_ids_host( i, j ) = filtered_dof_ids[topo_id][i][j];
-        Kokkos::deep_copy( _dofs_ids[topo_id], dofs_ids_host );
+        Kokkos::deep_copy( dofs_ids[topo_id], dofs_ids_host );
+    }
+}
+
+template <typename DeviceType>
+void Interpolation<DeviceType>::buildStencils(
+    std::array<Kokkos::View<LocalOrdinal **, DeviceType>, DTK_N_TOPO> const
+        &dofs_ids )
+{
+    // The stencils of the reference points of a given topology all have the
+    // same size so the offsets are computed on the host.
+    unsigned int n_local_ref_pts = 0;
+    unsigned int n_entries = 0;
+    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+    {
+        unsigned int const n_ref_points =
+            _point_search._reference_points[topo_id].extent( 0 );
+        n_local_ref_pts += n_ref_points;
+        n_entries += n_ref_points * dofs_ids[topo_id].extent( 1 );
+    }
+    _stencil_offset = Kokkos::View<unsigned int *, DeviceType>(
+        "stencil_offset", n_local_ref_pts + 1 );
+    _stencil_dofs = Kokkos::View<LocalOrdinal *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "stencil_dofs" ), n_entries );
+    _stencil_weights = Kokkos::View<Coordinate *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "stencil_weights" ),
+        n_entries );
+
+    auto stencil_offset_host = Kokkos::create_mirror_view( _stencil_offset );
+    stencil_offset_host( 0 ) = 0;
+    unsigned int point_offset = 0;
+    unsigned int entry_offset = 0;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+    {
+        unsigned int const n_ref_points =
+            _point_search._reference_points[topo_id].extent( 0 );
+        if ( n_ref_points == 0 )
+            continue;
+
+        unsigned int const n_basis = dofs_ids[topo_id].extent( 1 );
+        for ( unsigned int i = 0; i < n_ref_points; ++i )
+            stencil_offset_host( point_offset + i + 1 ) =
+                entry_offset + ( i + 1 ) * n_basis;
+
+        Kokkos::View<Coordinate **, DeviceType> weights(
+            Kokkos::ViewAllocateWithoutInitializing(
+                "weights_" + std::to_string( topo_id ) ),
+            n_ref_points, n_basis );
+        computeWeightsDispatch( _finite_elements[topo_id], topo_id, weights );
+
+        // Put the weights and the dofs in the right place in the stencils
+        auto topo_dofs_ids = dofs_ids[topo_id];
+        auto stencil_dofs = _stencil_dofs;
+        auto stencil_weights = _stencil_weights;
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "fill_stencils" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
+            KOKKOS_LAMBDA( int const i ) {
+                for ( unsigned int j = 0; j < n_basis; ++j )
+                {
+                    unsigned int const k = entry_offset + i * n_basis + j;
+                    stencil_dofs( k ) = topo_dofs_ids( i, j );
+                    stencil_weights( k ) = weights( i, j );
+                }
+            } );
+        Kokkos::fence();
+
+        point_offset += n_ref_points;
+        entry_offset += n_ref_points * n_basis;
+    }
+    Kokkos::deep_copy( _stencil_offset, stencil_offset_host );
+}
+
+template <typename DeviceType>
+void Interpolation<DeviceType>::buildImportMap()
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using DistributedSearchTreeImpl =
+        Details::DistributedSearchTreeImpl<DeviceType>;
+
+    // Communicate the query ids associated to the local reference points
+    // along with the indices of the reference points.
+    unsigned int const n_local_ref_pts = _stencil_offset.extent( 0 ) - 1;
+    Kokkos::View<int **, DeviceType> exported_ids( "exported_ids",
+                                                   n_local_ref_pts, 2 );
+    unsigned int n_copied_pts = 0;
+    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+    {
+        unsigned int const size = _point_search._query_ids[topo_id].extent( 0 );
+        auto topo_query_ids = _point_search._query_ids[topo_id];
+        Kokkos::parallel_for( DTK_MARK_REGION( "query_ids" ),
+                              Kokkos::RangePolicy<ExecutionSpace>( 0, size ),
+                              KOKKOS_LAMBDA( int const i ) {
+                                  exported_ids( i + n_copied_pts, 0 ) =
+                                      topo_query_ids( i );
+                                  exported_ids( i + n_copied_pts, 1 ) =
+                                      i + n_copied_pts;
+                              } );
+        Kokkos::fence();
+
+        n_copied_pts += size;
+    }
+    unsigned int const n_imports =
+        _point_search._target_to_source_distributor.getTotalReceiveLength();
+    Kokkos::View<int **, DeviceType> imported_ids( "imported_ids", n_imports,
+                                                   2 );
+    DistributedSearchTreeImpl::sendAcrossNetwork(
+        _point_search._target_to_source_distributor, exported_ids,
+        imported_ids );
+    Kokkos::View<int *, DeviceType> imported_ranks =
+        DistributedSearchTreeImpl::getImportRanks(
+            _point_search._target_to_source_distributor );
+    Kokkos::View<int *, DeviceType> imported_query_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "imported_query_ids" ),
+        n_imports );
+    Kokkos::View<int *, DeviceType> imported_ref_pts(
+        Kokkos::ViewAllocateWithoutInitializing( "imported_ref_pts" ),
+        n_imports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "unpack_ids" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              imported_query_ids( i ) = imported_ids( i, 0 );
+                              imported_ref_pts( i ) = imported_ids( i, 1 );
+                          } );
+    Kokkos::fence();
+
+    // Some points are correctly found on multiple cells, e.g., point on
+    // vertices. Only the first of them is kept once the imports are sorted by
+    // query id and the processors that own the cells are told which
+    // reference points to keep so that the duplicates are neither evaluated
+    // nor sent.
+    DistributedSearchTreeImpl::sortResults(
+        imported_query_ids, imported_query_ids, imported_ref_pts,
+        imported_ranks );
+    Kokkos::View<unsigned int *, DeviceType> query_offset( "query_offset",
+                                                           n_imports + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_mask" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( ( i == 0 ) ||
+                 ( imported_query_ids( i - 1 ) != imported_query_ids( i ) ) )
+                query_offset( i ) = 1;
+        } );
+    Kokkos::fence();
+    unsigned int const n_found = exclusivePrefixSum( query_offset );
+
+    Kokkos::View<int *, DeviceType> found_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "found_ranks" ), n_found );
+    Kokkos::View<int *, DeviceType> found_ref_pts(
+        Kokkos::ViewAllocateWithoutInitializing( "found_ref_pts" ), n_found );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "fill_found_ref_pts" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( ( i == 0 ) ||
+                 ( imported_query_ids( i - 1 ) != imported_query_ids( i ) ) )
+            {
+                unsigned int const k = query_offset( i );
+                found_ranks( k ) = imported_ranks( i );
+                found_ref_pts( k ) = imported_ref_pts( i );
+            }
+        } );
+    Kokkos::fence();
+
+    auto found_ranks_host = Kokkos::create_mirror_view( found_ranks );
+    Kokkos::deep_copy( found_ranks_host, found_ranks );
+    Details::Distributor source_distributor( _point_search._comm );
+    unsigned int const n_kept = source_distributor.createFromSends(
+        Teuchos::ArrayView<int const>( found_ranks_host.data(),
+                                       found_ranks_host.extent( 0 ) ) );
+    Kokkos::View<int *, DeviceType> kept_ref_pts(
+        Kokkos::ViewAllocateWithoutInitializing( "kept_ref_pts" ), n_kept );
+    DistributedSearchTreeImpl::sendAcrossNetwork(
+        source_distributor, found_ref_pts, kept_ref_pts );
+    Kokkos::View<int *, DeviceType> kept_ranks =
+        DistributedSearchTreeImpl::getImportRanks( source_distributor );
+
+    // Only keep the stencils of the reference points that are evaluated, in
+    // the order in which their values are sent.
+    auto stencil_offset = _stencil_offset;
+    auto stencil_dofs = _stencil_dofs;
+    auto stencil_weights = _stencil_weights;
+    Kokkos::View<unsigned int *, DeviceType> kept_offset( "stencil_offset",
+                                                          n_kept + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_kept_stencils" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_kept ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              int const j = kept_ref_pts( i );
+                              kept_offset( i ) = stencil_offset( j + 1 ) -
+                                                 stencil_offset( j );
+                          } );
+    Kokkos::fence();
+    unsigned int const n_entries = exclusivePrefixSum( kept_offset );
+
+    Kokkos::View<LocalOrdinal *, DeviceType> kept_dofs(
+        Kokkos::ViewAllocateWithoutInitializing( "stencil_dofs" ), n_entries );
+    Kokkos::View<Coordinate *, DeviceType> kept_weights(
+        Kokkos::ViewAllocateWithoutInitializing( "stencil_weights" ),
+        n_entries );
+    Kokkos::View<int *, DeviceType> kept_query_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "kept_query_ids" ), n_kept );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "fill_kept_stencils" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_kept ),
+        KOKKOS_LAMBDA( int const i ) {
+            int const j = kept_ref_pts( i );
+            unsigned int const first = stencil_offset( j );
+            unsigned int const n = kept_offset( i + 1 ) - kept_offset( i );
+            for ( unsigned int k = 0; k < n; ++k )
+            {
+                kept_dofs( kept_offset( i ) + k ) = stencil_dofs( first + k );
+                kept_weights( kept_offset( i ) + k ) =
+                    stencil_weights( first + k );
+            }
+            kept_query_ids( i ) = exported_ids( j, 0 );
+        } );
+    Kokkos::fence();
+    _stencil_offset = kept_offset;
+    _stencil_dofs = kept_dofs;
+    _stencil_weights = kept_weights;
+
+    // Build the plan of the exchange of the values and compute the
+    // permutation that puts them back in the order of the query ids.
+    auto kept_ranks_host = Kokkos::create_mirror_view( kept_ranks );
+    Kokkos::deep_copy( kept_ranks_host, kept_ranks );
+    unsigned int const n_values = _value_distributor.createFromSends(
+        Teuchos::ArrayView<int const>( kept_ranks_host.data(),
+                                       kept_ranks_host.extent( 0 ) ) );
+    DTK_CHECK( n_values == n_found );
+    _found_query_ids = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "found_query_ids" ),
+        n_values );
+    DistributedSearchTreeImpl::sendAcrossNetwork(
+        _value_distributor, kept_query_ids, _found_query_ids );
+    _query_imports = Kokkos::View<unsigned int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "query_imports" ), n_values );
+    iota( _query_imports );
+    DistributedSearchTreeImpl::sortResults( _found_query_ids, _found_query_ids,
+                                            _query_imports );
+}
+
+template <typename DeviceType>
+template <typename FEOpType>
+void Interpolation<DeviceType>::computeWeights(
+    Kokkos::View<Coordinate **, DeviceType> ref_points,
+    Kokkos::View<Coordinate **, DeviceType> weights )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Functor::InterpolationWeights<FEOpType, DeviceType> weights_functor(
+        _point_search._dim, ref_points, weights );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_weights" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, ref_points.extent( 0 ) ),
+        weights_functor );
+}
+
+template <typename DeviceType>
+template <typename FEOpType>
+void Interpolation<DeviceType>::hgradComputeWeights(
+    Kokkos::View<Coordinate **, DeviceType> ref_points,
+    Kokkos::View<Coordinate **, DeviceType> weights )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    typename Functor::HgradWeightsFunctor<FEOpType, DeviceType>::type
+        weights_functor( ref_points, weights );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_weights" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, ref_points.extent( 0 ) ),
+        weights_functor );
+}
+
+template <typename DeviceType>
+void Interpolation<DeviceType>::computeWeightsDispatch(
+    FE fe, unsigned int topo_id,
+    Kokkos::View<Coordinate **, DeviceType> weights )
+{
+    auto ref_points = _point_search._reference_points[topo_id];
+    switch ( fe )
+    {
+    case FE::HEX_HCURL_1:
+    {
+        computeWeights<HEX_HCURL_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::HEX_HDIV_1:
+    {
+        computeWeights<HEX_HDIV_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::HEX_HGRAD_1:
+    {
+        hgradComputeWeights<HEX_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::HEX_HGRAD_2:
+    {
+        hgradComputeWeights<HEX_HGRAD_2::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::PYR_HGRAD_1:
+    {
+        hgradComputeWeights<PYR_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::QUAD_HCURL_1:
+    {
+        computeWeights<QUAD_HCURL_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::QUAD_HDIV_1:
+    {
+        computeWeights<QUAD_HDIV_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::QUAD_HGRAD_1:
+    {
+        hgradComputeWeights<QUAD_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::QUAD_HGRAD_2:
+    {
+        hgradComputeWeights<QUAD_HGRAD_2::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TET_HCURL_1:
+    {
+        computeWeights<TET_HCURL_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TET_HDIV_1:
+    {
+        computeWeights<TET_HDIV_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TET_HGRAD_1:
+    {
+        hgradComputeWeights<TET_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TET_HGRAD_2:
+    {
+        hgradComputeWeights<TET_HGRAD_2::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TRI_HGRAD_1:
+    {
+        hgradComputeWeights<TRI_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::TRI_HGRAD_2:
+    {
+        hgradComputeWeights<TRI_HGRAD_2::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::WEDGE_HGRAD_1:
+    {
+        hgradComputeWeights<WEDGE_HGRAD_1::feop_type>( ref_points, weights );
+
+        break;
+    }
+    case FE::WEDGE_HGRAD_2:
+    {
+        hgradComputeWeights<WEDGE_HGRAD_2::feop_type>( ref_points, weights );
+
+        break;
+    }
+    default:
+        throw DataTransferKitNotImplementedException();
     }
+    Kokkos::fence();
 }
 
 } // namespace DataTransferKit
@@ -0,0 +1,197 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_L2_PROJECTION_DECL_HPP
+#define DTK_L2_PROJECTION_DECL_HPP
+
+#include "DTK_ConfigDefs.hpp"
+#include <DTK_CellTypes.h>
+#include <DTK_ConjugateGradient.hpp>
+#include <DTK_FETypes.h>
+#include <DTK_Interpolation.hpp>
+
+#include <Kokkos_View.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <algorithm>
+
+namespace DataTransferKit
+{
+/**
+ * This class performs a conservative transfer of fields from a source mesh to
+ * a target mesh by L2 projection. The target fields are discretized with the
+ * HGRAD finite elements of the target cells and their dofs are local to each
+ * processor, i.e., the projection is done independently on each processor.
+ *
+ * The quadrature points of the target cells are located in the source mesh
+ * once with PointSearch. The constructor also assembles the mass matrix of
+ * the target mesh and the weighted values of the target basis functions at
+ * the quadrature points. apply() then interpolates the source fields at the
+ * quadrature points, computes the right-hand side with one sparse
+ * matrix-vector product, and solves the mass system with the conjugate
+ * gradient method preconditioned by the diagonal of the mass matrix.
+ */
+template <typename DeviceType>
+class L2Projection
+{
+  public:
+    /**
+     * Constructor.
+     * @param comm
+     * @param source_cell_topologies (n source cells)
+     * @param source_cells vertices associated to each source cell (n source
+     * cells * n vertices per cell)
+     * @param source_nodes_coordinates coordinates of all the nodes in the
+     * source mesh (n source vertices, dim)
+     * @param source_cell_dof_ids degrees of freedom indices associated to each
+     * source cell (n source cells * n dofs per cell)
+     * @param source_fe_type type of the finite element of the source fields
+     * (DTK_HGRAD, DTK_HDIV, or DTK_CURL)
+     * @param target_cell_topologies (n target cells)
+     * @param target_cells vertices associated to each target cell (n target
+     * cells * n vertices per cell)
+     * @param target_nodes_coordinates coordinates of all the nodes in the
+     * target mesh (n target vertices, dim)
+     * @param target_cell_dof_ids degrees of freedom indices associated to each
+     * target cell (n target cells * n vertices per cell)
+     * @param cubature_degree polynomial degree integrated exactly by the
+     * quadrature of the target cells
+     * @param tolerance relative tolerance on the residual of the mass system
+     * @param max_iterations maximum number of iterations of the solver
+     */
+    L2Projection(
+        Teuchos::RCP<const Teuchos::Comm<int>> comm,
+        Kokkos::View<DTK_CellTopology *, DeviceType> source_cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> source_cells,
+        Kokkos::View<double **, DeviceType> source_nodes_coordinates,
+        Kokkos::View<LocalOrdinal *, DeviceType> source_cell_dof_ids,
+        DTK_FEType source_fe_type,
+        Kokkos::View<DTK_CellTopology *, DeviceType> target_cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> target_cells,
+        Kokkos::View<double **, DeviceType> target_nodes_coordinates,
+        Kokkos::View<LocalOrdinal *, DeviceType> target_cell_dof_ids,
+        unsigned int cubature_degree = 4, double tolerance = 1e-12,
+        unsigned int max_iterations = 1000 );
+
+    /**
+     * This function performs the projection. The quadrature points that are
+     * not found in the source mesh do not contribute to the projection.
+     * @param [in] X (n source dofs, n fields)
+     * @param [out] Y (n target dofs, n fields)
+     */
+    template <typename Scalar>
+    void apply( Kokkos::View<Scalar **, DeviceType> X,
+                Kokkos::View<Scalar **, DeviceType> Y );
+
+    /**
+     * Return the largest number of iterations of the solver over the fields
+     * during the last call to apply(). It is equal to max_iterations if the
+     * solver did not converge.
+     */
+    unsigned int getNumberOfIterations() const { return _n_iterations; }
+
+  private:
+    /**
+     * Compute the quadrature points of the target cells, the mass matrix of
+     * the target mesh, and the operator that maps the values at the
+     * quadrature points to the right-hand side of the mass system.
+     */
+    Kokkos::View<double **, DeviceType> assemble(
+        Kokkos::View<DTK_CellTopology *, DeviceType> target_cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> target_cells,
+        Kokkos::View<double **, DeviceType> target_nodes_coordinates,
+        Kokkos::View<LocalOrdinal *, DeviceType> target_cell_dof_ids,
+        unsigned int cubature_degree );
+
+    double _tolerance;
+    unsigned int _max_iterations;
+    unsigned int _n_iterations = 0;
+    unsigned int _n_target_dofs = 0;
+    unsigned int _n_quadrature_points = 0;
+
+    /**
+     * Interpolation of the source fields at the quadrature points.
+     */
+    Teuchos::RCP<Interpolation<DeviceType>> _interpolation;
+
+    /**
+     * Mass matrix of the target mesh in compressed row storage and the
+     * inverse of its diagonal.
+     */
+    Kokkos::View<unsigned int *, DeviceType> _mass_offset;
+    Kokkos::View<LocalOrdinal *, DeviceType> _mass_columns;
+    Kokkos::View<double *, DeviceType> _mass_values;
+    Kokkos::View<double *, DeviceType> _inv_diagonal;
+
+    /**
+     * Operator in compressed row storage that maps the values at the
+     * quadrature points to the right-hand side of the mass system. The
+     * entries are the values of the target basis functions weighted by the
+     * quadrature weights.
+     */
+    Kokkos::View<unsigned int *, DeviceType> _rhs_offset;
+    Kokkos::View<unsigned int *, DeviceType> _rhs_columns;
+    Kokkos::View<double *, DeviceType> _rhs_values;
+};
+
+template <typename DeviceType>
+template <typename Scalar>
+void L2Projection<DeviceType>::apply( Kokkos::View<Scalar **, DeviceType> X,
+                                      Kokkos::View<Scalar **, DeviceType> Y )
+{
+    // Check that the input and the output have the same number of fields
+    DTK_REQUIRE( X.extent( 1 ) == Y.extent( 1 ) );
+    DTK_REQUIRE( Y.extent( 0 ) == _n_target_dofs );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    unsigned int const n_fields = X.extent( 1 );
+
+    // Interpolate the source fields at the quadrature points. The values are
+    // returned by increasing query id for the points that have been found.
+    Kokkos::View<Scalar **, DeviceType> found_values(
+        Kokkos::ViewAllocateWithoutInitializing( "found_values" ),
+        _n_quadrature_points, n_fields );
+    Kokkos::View<int *, DeviceType> found_query_ids =
+        _interpolation->apply( X, found_values );
+
+    // The quadrature points that have not been found contribute zero
+    Kokkos::View<Scalar **, DeviceType> qp_values( "qp_values",
+                                                   _n_quadrature_points,
+                                                   n_fields );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "scatter_qp_values" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, _n_quadrature_points ),
+        KOKKOS_LAMBDA( int const i ) {
+            int const query_id = found_query_ids( i );
+            if ( query_id >= 0 )
+                for ( unsigned int k = 0; k < n_fields; ++k )
+                    qp_values( query_id, k ) = found_values( i, k );
+        } );
+    Kokkos::fence();
+
+    // Solve the mass system of each field
+    Kokkos::View<Scalar *, DeviceType> rhs(
+        Kokkos::ViewAllocateWithoutInitializing( "rhs" ), _n_target_dofs );
+    _n_iterations = 0;
+    for ( unsigned int k = 0; k < n_fields; ++k )
+    {
+        internal::spmv( _rhs_offset, _rhs_columns, _rhs_values,
+                        Kokkos::subview( qp_values, Kokkos::ALL, k ), rhs );
+        unsigned int const n_iterations = internal::conjugateGradient(
+            _mass_offset, _mass_columns, _mass_values, _inv_diagonal, rhs,
+            Kokkos::subview( Y, Kokkos::ALL, k ), _tolerance,
+            _max_iterations );
+        _n_iterations = std::max( _n_iterations, n_iterations );
+    }
+}
+} // namespace DataTransferKit
+
+#endif
@@ -0,0 +1,651 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_L2_PROJECTION_DEF_HPP
+#define DTK_L2_PROJECTION_DEF_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsUtils.hpp>
+#include <DTK_Statistics.hpp>
+#include <DTK_Topology.hpp>
+
+#include <Intrepid2_DefaultCubatureFactory.hpp>
+#include <Shards_CellTopology.hpp>
+
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace internal
+{
+KOKKOS_INLINE_FUNCTION double determinant( double const ( &m )[2][2] )
+{
+    return m[0][0] * m[1][1] - m[0][1] * m[1][0];
+}
+
+KOKKOS_INLINE_FUNCTION double determinant( double const ( &m )[3][3] )
+{
+    return m[0][0] * ( m[1][1] * m[2][2] - m[1][2] * m[2][1] ) -
+           m[0][1] * ( m[1][0] * m[2][2] - m[1][2] * m[2][0] ) +
+           m[0][2] * ( m[1][0] * m[2][1] - m[1][1] * m[2][0] );
+}
+
+/**
+ * Weights of the quadrature points of the reference cell of a topology, and
+ * values and gradients of the basis functions at these points.
+ */
+template <typename DeviceType>
+struct ReferenceCell
+{
+    int dim;
+    unsigned int n_nodes;
+    unsigned int n_qp;
+    Kokkos::View<double *, DeviceType> weights;
+    Kokkos::View<double **, DeviceType> values;
+    Kokkos::View<double ***, DeviceType> grads;
+};
+
+/**
+ * Entries of a sparse matrix in coordinate format, in no particular order
+ * and with duplicates.
+ */
+template <typename ColumnType, typename DeviceType>
+struct Triplets
+{
+    Kokkos::View<LocalOrdinal *, DeviceType> rows;
+    Kokkos::View<ColumnType *, DeviceType> columns;
+    Kokkos::View<double *, DeviceType> values;
+};
+
+/**
+ * Compute the reference cell of a given topology. The cubature and the basis
+ * functions are evaluated on the host, once per topology, and the result is
+ * copied to the device.
+ */
+template <typename CellType, typename DeviceType>
+ReferenceCell<DeviceType>
+makeReferenceCell( CellTopologyData const *topology_data,
+                   unsigned int topo_id, unsigned int cubature_degree )
+{
+    int constexpr dim = CellType::dim;
+    using Basis = typename CellType::basis_type;
+    using HostExecutionSpace = Kokkos::DefaultHostExecutionSpace;
+    using UnmanagedView1D =
+        Kokkos::View<double *, Kokkos::LayoutRight, HostExecutionSpace,
+                     Kokkos::MemoryUnmanaged>;
+
+    shards::CellTopology const shards_topology( topology_data );
+    auto cubature =
+        Intrepid2::DefaultCubatureFactory::create<HostExecutionSpace, double,
+                                                  double>( shards_topology,
+                                                           cubature_degree );
+    unsigned int const n_qp = cubature->getNumPoints();
+    Kokkos::DynRankView<double, HostExecutionSpace> cubature_points(
+        "cubature_points", n_qp, dim );
+    Kokkos::DynRankView<double, HostExecutionSpace> cubature_weights(
+        "cubature_weights", n_qp );
+    cubature->getCubature( cubature_points, cubature_weights );
+
+    Topologies topologies;
+    unsigned int const n_nodes = topologies[topo_id].n_nodes;
+    Kokkos::View<double **, Kokkos::LayoutRight, HostExecutionSpace> values(
+        "values", n_qp, n_nodes );
+    Kokkos::View<double ***, Kokkos::LayoutRight, HostExecutionSpace> grads(
+        "grads", n_qp, n_nodes, dim );
+    for ( unsigned int q = 0; q < n_qp; ++q )
+    {
+        double ref_point_buffer[dim];
+        UnmanagedView1D ref_point( ref_point_buffer, dim );
+        for ( int d = 0; d < dim; ++d )
+            ref_point( d ) = cubature_points( q, d );
+        Basis::template Serial<Intrepid2::OPERATOR_VALUE>::getValues(
+            Kokkos::subview( values, q, Kokkos::ALL ), ref_point );
+        Basis::template Serial<Intrepid2::OPERATOR_GRAD>::getValues(
+            Kokkos::subview( grads, q, Kokkos::ALL, Kokkos::ALL ),
+            ref_point );
+    }
+
+    ReferenceCell<DeviceType> reference_cell;
+    reference_cell.dim = dim;
+    reference_cell.n_nodes = n_nodes;
+    reference_cell.n_qp = n_qp;
+    reference_cell.weights =
+        Kokkos::View<double *, DeviceType>( "weights", n_qp );
+    reference_cell.values =
+        Kokkos::View<double **, DeviceType>( "values", n_qp, n_nodes );
+    reference_cell.grads =
+        Kokkos::View<double ***, DeviceType>( "grads", n_qp, n_nodes, dim );
+    auto weights_host = Kokkos::create_mirror_view( reference_cell.weights );
+    auto values_host = Kokkos::create_mirror_view( reference_cell.values );
+    auto grads_host = Kokkos::create_mirror_view( reference_cell.grads );
+    for ( unsigned int q = 0; q < n_qp; ++q )
+    {
+        weights_host( q ) = cubature_weights( q );
+        for ( unsigned int n = 0; n < n_nodes; ++n )
+        {
+            values_host( q, n ) = values( q, n );
+            for ( int d = 0; d < dim; ++d )
+                grads_host( q, n, d ) = grads( q, n, d );
+        }
+    }
+    Kokkos::deep_copy( reference_cell.weights, weights_host );
+    Kokkos::deep_copy( reference_cell.values, values_host );
+    Kokkos::deep_copy( reference_cell.grads, grads_host );
+
+    return reference_cell;
+}
+
+template <typename DeviceType>
+ReferenceCell<DeviceType> makeReferenceCell( unsigned int topo_id,
+                                             unsigned int cubature_degree )
+{
+    switch ( topo_id )
+    {
+    case DTK_HEX_8:
+        return makeReferenceCell<HEX_8, DeviceType>(
+            shards::getCellTopologyData<shards::Hexahedron<8>>(), topo_id,
+            cubature_degree );
+    case DTK_HEX_27:
+        return makeReferenceCell<HEX_27, DeviceType>(
+            shards::getCellTopologyData<shards::Hexahedron<27>>(), topo_id,
+            cubature_degree );
+    case DTK_PYRAMID_5:
+        return makeReferenceCell<PYRAMID_5, DeviceType>(
+            shards::getCellTopologyData<shards::Pyramid<5>>(), topo_id,
+            cubature_degree );
+    case DTK_QUAD_4:
+        return makeReferenceCell<QUAD_4, DeviceType>(
+            shards::getCellTopologyData<shards::Quadrilateral<4>>(), topo_id,
+            cubature_degree );
+    case DTK_QUAD_9:
+        return makeReferenceCell<QUAD_9, DeviceType>(
+            shards::getCellTopologyData<shards::Quadrilateral<9>>(), topo_id,
+            cubature_degree );
+    case DTK_TET_4:
+        return makeReferenceCell<TET_4, DeviceType>(
+            shards::getCellTopologyData<shards::Tetrahedron<4>>(), topo_id,
+            cubature_degree );
+    case DTK_TET_10:
+        return makeReferenceCell<TET_10, DeviceType>(
+            shards::getCellTopologyData<shards::Tetrahedron<10>>(), topo_id,
+            cubature_degree );
+    case DTK_TRI_3:
+        return makeReferenceCell<TRI_3, DeviceType>(
+            shards::getCellTopologyData<shards::Triangle<3>>(), topo_id,
+            cubature_degree );
+    case DTK_TRI_6:
+        return makeReferenceCell<TRI_6, DeviceType>(
+            shards::getCellTopologyData<shards::Triangle<6>>(), topo_id,
+            cubature_degree );
+    case DTK_WEDGE_6:
+        return makeReferenceCell<WEDGE_6, DeviceType>(
+            shards::getCellTopologyData<shards::Wedge<6>>(), topo_id,
+            cubature_degree );
+    case DTK_WEDGE_18:
+        return makeReferenceCell<WEDGE_18, DeviceType>(
+            shards::getCellTopologyData<shards::Wedge<18>>(), topo_id,
+            cubature_degree );
+    default:
+        throw DataTransferKitNotImplementedException();
+    }
+}
+
+/**
+ * Compute the offset of the nodes of each cell and count the cells of each
+ * topology. Return the total number of nodes.
+ */
+template <typename DeviceType>
+unsigned int computeCellOffset(
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> cell_offset,
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_topology_cells )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    Topologies topologies;
+    Kokkos::Array<unsigned int, DTK_N_TOPO> n_nodes;
+    for ( int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+        n_nodes[topo_id] = topologies[topo_id].n_nodes;
+
+    unsigned int const n_cells = cell_topologies.extent( 0 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_cell_offset" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+        KOKKOS_LAMBDA( int const i ) {
+            cell_offset( i ) = n_nodes[cell_topologies( i )];
+            Kokkos::atomic_increment(
+                &n_topology_cells( cell_topologies( i ) ) );
+        } );
+    Kokkos::fence();
+
+    return exclusivePrefixSum( cell_offset );
+}
+
+/**
+ * Compute the quadrature points of the given cells, which share the same
+ * topology, and the entries of their element mass matrices and right-hand
+ * side operators. Each cell is done by a thread. The quadrature points of
+ * the k-th cell start at qp_begin + k * n_qp, its mass triplets at
+ * mass_begin + k * n_nodes * n_nodes, and its right-hand side triplets at
+ * rhs_begin + k * n_qp * n_nodes. The HGRAD dofs of the cells are
+ * associated to their nodes so cell_offset is used for both cells and
+ * cell_dof_ids.
+ */
+template <int dim, typename DeviceType>
+void assembleCells(
+    ReferenceCell<DeviceType> const &reference_cell,
+    Kokkos::View<int *, DeviceType> topology_cells,
+    Kokkos::View<unsigned int *, DeviceType> cell_offset,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<double **, DeviceType> nodes_coordinates,
+    Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids,
+    unsigned int qp_begin, Kokkos::View<double **, DeviceType> qp_coordinates,
+    unsigned int mass_begin, Triplets<LocalOrdinal, DeviceType> const &mass,
+    unsigned int rhs_begin, Triplets<unsigned int, DeviceType> const &rhs )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    unsigned int const n_nodes = reference_cell.n_nodes;
+    unsigned int const n_qp = reference_cell.n_qp;
+    auto weights = reference_cell.weights;
+    auto values = reference_cell.values;
+    auto grads = reference_cell.grads;
+    auto mass_rows = mass.rows;
+    auto mass_columns = mass.columns;
+    auto mass_values = mass.values;
+    auto rhs_rows = rhs.rows;
+    auto rhs_columns = rhs.columns;
+    auto rhs_values = rhs.values;
+    unsigned int const n_cells = topology_cells.extent( 0 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "assemble_cells" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+        KOKKOS_LAMBDA( int const k ) {
+            unsigned int const offset = cell_offset( topology_cells( k ) );
+            unsigned int const mass_cell = mass_begin + k * n_nodes * n_nodes;
+            for ( unsigned int i = 0; i < n_nodes; ++i )
+                for ( unsigned int j = 0; j < n_nodes; ++j )
+                {
+                    unsigned int const t = mass_cell + i * n_nodes + j;
+                    mass_rows( t ) = cell_dof_ids( offset + i );
+                    mass_columns( t ) = cell_dof_ids( offset + j );
+                    mass_values( t ) = 0.;
+                }
+
+            for ( unsigned int q = 0; q < n_qp; ++q )
+            {
+                // Physical coordinates of the quadrature point and Jacobian
+                // of the reference map
+                double phys_point[dim];
+                double jacobian[dim][dim];
+                for ( int d = 0; d < dim; ++d )
+                {
+                    phys_point[d] = 0.;
+                    for ( int e = 0; e < dim; ++e )
+                        jacobian[d][e] = 0.;
+                }
+                for ( unsigned int n = 0; n < n_nodes; ++n )
+                {
+                    unsigned int const node = cells( offset + n );
+                    for ( int d = 0; d < dim; ++d )
+                    {
+                        phys_point[d] +=
+                            values( q, n ) * nodes_coordinates( node, d );
+                        for ( int e = 0; e < dim; ++e )
+                            jacobian[d][e] += nodes_coordinates( node, d ) *
+                                              grads( q, n, e );
+                    }
+                }
+                double const det = determinant( jacobian );
+                double const weight = weights( q ) * ( det < 0. ? -det : det );
+
+                unsigned int const qp_id = qp_begin + k * n_qp + q;
+                for ( int d = 0; d < dim; ++d )
+                    qp_coordinates( qp_id, d ) = phys_point[d];
+
+                for ( unsigned int i = 0; i < n_nodes; ++i )
+                {
+                    unsigned int const r =
+                        rhs_begin + ( k * n_qp + q ) * n_nodes + i;
+                    rhs_rows( r ) = cell_dof_ids( offset + i );
+                    rhs_columns( r ) = qp_id;
+                    rhs_values( r ) = weight * values( q, i );
+                    for ( unsigned int j = 0; j < n_nodes; ++j )
+                        mass_values( mass_cell + i * n_nodes + j ) +=
+                            weight * values( q, i ) * values( q, j );
+                }
+            }
+        } );
+    Kokkos::fence();
+}
+
+/**
+ * Sum the duplicate triplets and store the matrix in the CRS format. The
+ * triplets of each row are sorted by column, and by index for the same
+ * column, so that the sums do not depend on the order in which the threads
+ * bucket them. If identity is true, the empty rows get a one on the
+ * diagonal.
+ */
+template <typename ColumnType, typename DeviceType>
+void compressTriplets( Triplets<ColumnType, DeviceType> const &triplets,
+                       unsigned int n_rows, bool identity,
+                       Kokkos::View<unsigned int *, DeviceType> &offset,
+                       Kokkos::View<ColumnType *, DeviceType> &columns,
+                       Kokkos::View<double *, DeviceType> &values )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    auto triplet_rows = triplets.rows;
+    auto triplet_columns = triplets.columns;
+    auto triplet_values = triplets.values;
+    unsigned int const n_triplets = triplet_rows.extent( 0 );
+
+    // Bucket the triplets by row
+    Kokkos::View<unsigned int *, DeviceType> row_offset( "row_offset",
+                                                         n_rows + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_triplets" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_triplets ),
+                          KOKKOS_LAMBDA( int const t ) {
+                              Kokkos::atomic_increment(
+                                  &row_offset( triplet_rows( t ) ) );
+                          } );
+    Kokkos::fence();
+    exclusivePrefixSum( row_offset );
+    auto cursor = clone( row_offset );
+    Kokkos::View<unsigned int *, DeviceType> permutation(
+        Kokkos::ViewAllocateWithoutInitializing( "permutation" ),
+        n_triplets );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "bucket_triplets" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_triplets ),
+        KOKKOS_LAMBDA( int const t ) {
+            permutation( Kokkos::atomic_fetch_add(
+                &cursor( triplet_rows( t ) ), 1u ) ) = t;
+        } );
+    Kokkos::fence();
+
+    // Sort the triplets of each row and count the distinct columns
+    Kokkos::View<unsigned int *, DeviceType> crs_offset( "offset",
+                                                         n_rows + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "sort_triplets" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int const r ) {
+            unsigned int const begin = row_offset( r );
+            unsigned int const end = row_offset( r + 1 );
+            for ( unsigned int i = begin + 1; i < end; ++i )
+            {
+                unsigned int const t = permutation( i );
+                unsigned int j = i;
+                for ( ; j > begin; --j )
+                {
+                    unsigned int const u = permutation( j - 1 );
+                    if ( triplet_columns( u ) < triplet_columns( t ) ||
+                         ( triplet_columns( u ) == triplet_columns( t ) &&
+                           u < t ) )
+                        break;
+                    permutation( j ) = u;
+                }
+                permutation( j ) = t;
+            }
+
+            unsigned int n_columns = 0;
+            for ( unsigned int i = begin; i < end; ++i )
+                if ( i == begin ||
+                     triplet_columns( permutation( i ) ) !=
+                         triplet_columns( permutation( i - 1 ) ) )
+                    ++n_columns;
+            if ( n_columns == 0 && identity )
+                n_columns = 1;
+            crs_offset( r ) = n_columns;
+        } );
+    Kokkos::fence();
+    unsigned int const n_entries = exclusivePrefixSum( crs_offset );
+
+    // Sum the duplicates
+    Kokkos::View<ColumnType *, DeviceType> crs_columns(
+        Kokkos::ViewAllocateWithoutInitializing( "columns" ), n_entries );
+    Kokkos::View<double *, DeviceType> crs_values(
+        Kokkos::ViewAllocateWithoutInitializing( "values" ), n_entries );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "sum_triplets" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int const r ) {
+            unsigned int const begin = row_offset( r );
+            unsigned int const end = row_offset( r + 1 );
+            unsigned int k = crs_offset( r );
+            if ( begin == end && identity )
+            {
+                crs_columns( k ) = r;
+                crs_values( k ) = 1.;
+            }
+            for ( unsigned int i = begin; i < end; ++i )
+            {
+                unsigned int const t = permutation( i );
+                if ( i == begin ||
+                     triplet_columns( t ) !=
+                         triplet_columns( permutation( i - 1 ) ) )
+                {
+                    crs_columns( k ) = triplet_columns( t );
+                    crs_values( k ) = 0.;
+                    ++k;
+                }
+                crs_values( k - 1 ) += triplet_values( t );
+            }
+        } );
+    Kokkos::fence();
+
+    offset = crs_offset;
+    columns = crs_columns;
+    values = crs_values;
+}
+
+/**
+ * Compute the inverse of the diagonal of a matrix in the CRS format, or one
+ * for the rows without a diagonal entry.
+ */
+template <typename DeviceType>
+Kokkos::View<double *, DeviceType>
+invertDiagonal( Kokkos::View<unsigned int *, DeviceType> offset,
+                Kokkos::View<LocalOrdinal *, DeviceType> columns,
+                Kokkos::View<double *, DeviceType> values )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    unsigned int const n_rows = offset.extent( 0 ) - 1;
+    Kokkos::View<double *, DeviceType> inv_diagonal(
+        Kokkos::ViewAllocateWithoutInitializing( "inv_diagonal" ), n_rows );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "invert_diagonal" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int const r ) {
+            inv_diagonal( r ) = 1.;
+            for ( unsigned int k = offset( r ); k < offset( r + 1 ); ++k )
+                if ( columns( k ) == r )
+                    inv_diagonal( r ) = 1. / values( k );
+        } );
+    Kokkos::fence();
+
+    return inv_diagonal;
+}
+
+/**
+ * Select the cells of a given topology.
+ */
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType>
+selectCells( Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+             DTK_CellTopology topology )
+{
+    return selectIndices<DeviceType>(
+        "topology_cells", cell_topologies.extent( 0 ),
+        KOKKOS_LAMBDA( int const i ) {
+            return cell_topologies( i ) == topology;
+        } );
+}
+} // namespace internal
+
+template <typename DeviceType>
+L2Projection<DeviceType>::L2Projection(
+    Teuchos::RCP<const Teuchos::Comm<int>> comm,
+    Kokkos::View<DTK_CellTopology *, DeviceType> source_cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> source_cells,
+    Kokkos::View<double **, DeviceType> source_nodes_coordinates,
+    Kokkos::View<LocalOrdinal *, DeviceType> source_cell_dof_ids,
+    DTK_FEType source_fe_type,
+    Kokkos::View<DTK_CellTopology *, DeviceType> target_cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> target_cells,
+    Kokkos::View<double **, DeviceType> target_nodes_coordinates,
+    Kokkos::View<LocalOrdinal *, DeviceType> target_cell_dof_ids,
+    unsigned int cubature_degree, double tolerance,
+    unsigned int max_iterations )
+    : _tolerance( tolerance )
+    , _max_iterations( max_iterations )
+{
+    DTK_REQUIRE( tolerance > 0. );
+    DTK_REQUIRE( source_nodes_coordinates.extent( 1 ) ==
+                 target_nodes_coordinates.extent( 1 ) );
+
+    Kokkos::View<double **, DeviceType> qp_coordinates =
+        assemble( target_cell_topologies, target_cells,
+                  target_nodes_coordinates, target_cell_dof_ids,
+                  cubature_degree );
+
+    // The quadrature points are searched once, the interpolation stencils
+    // are cached by Interpolation.
+    _interpolation = Teuchos::rcp( new Interpolation<DeviceType>(
+        comm, source_cell_topologies, source_cells, source_nodes_coordinates,
+        qp_coordinates, source_cell_dof_ids, source_fe_type ) );
+}
+
+template <typename DeviceType>
+Kokkos::View<double **, DeviceType> L2Projection<DeviceType>::assemble(
+    Kokkos::View<DTK_CellTopology *, DeviceType> target_cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> target_cells,
+    Kokkos::View<double **, DeviceType> target_nodes_coordinates,
+    Kokkos::View<LocalOrdinal *, DeviceType> target_cell_dof_ids,
+    unsigned int cubature_degree )
+{
+    ScopedTimer timer( "assembly" );
+
+    // The target fields use the HGRAD elements so each cell has as many dofs
+    // as nodes.
+    unsigned int const n_cells = target_cell_topologies.extent( 0 );
+    Kokkos::View<unsigned int *, DeviceType> cell_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "cell_offset" ),
+        n_cells + 1 );
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_topology_cells(
+        "n_topology_cells" );
+    unsigned int const n_nodes = internal::computeCellOffset(
+        target_cell_topologies, cell_offset, n_topology_cells );
+    DTK_REQUIRE( n_nodes == target_cells.extent( 0 ) );
+    DTK_REQUIRE( n_nodes == target_cell_dof_ids.extent( 0 ) );
+    auto n_topology_cells_host =
+        Kokkos::create_mirror_view( n_topology_cells );
+    Kokkos::deep_copy( n_topology_cells_host, n_topology_cells );
+
+    _n_target_dofs = 0;
+    if ( n_nodes > 0 )
+        _n_target_dofs = max( target_cell_dof_ids ) + 1;
+
+    // The triplets of each topology follow those of the previous ones so the
+    // number of quadrature points and of entries is computed first.
+    std::vector<unsigned int> present_topologies;
+    std::vector<internal::ReferenceCell<DeviceType>> reference_cells;
+    unsigned int n_mass_triplets = 0;
+    unsigned int n_rhs_triplets = 0;
+    _n_quadrature_points = 0;
+    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+    {
+        unsigned int const n = n_topology_cells_host( topo_id );
+        if ( n == 0 )
+            continue;
+
+        present_topologies.push_back( topo_id );
+        reference_cells.push_back( internal::makeReferenceCell<DeviceType>(
+            topo_id, cubature_degree ) );
+        auto const &reference_cell = reference_cells.back();
+        _n_quadrature_points += n * reference_cell.n_qp;
+        n_mass_triplets += n * reference_cell.n_nodes * reference_cell.n_nodes;
+        n_rhs_triplets += n * reference_cell.n_qp * reference_cell.n_nodes;
+    }
+
+    unsigned int const dim = target_nodes_coordinates.extent( 1 );
+    Kokkos::View<double **, DeviceType> qp_coordinates(
+        Kokkos::ViewAllocateWithoutInitializing( "qp_coordinates" ),
+        _n_quadrature_points, dim );
+    internal::Triplets<LocalOrdinal, DeviceType> mass{
+        Kokkos::View<LocalOrdinal *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "mass_rows" ),
+            n_mass_triplets ),
+        Kokkos::View<LocalOrdinal *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "mass_columns" ),
+            n_mass_triplets ),
+        Kokkos::View<double *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "mass_values" ),
+            n_mass_triplets )};
+    internal::Triplets<unsigned int, DeviceType> rhs{
+        Kokkos::View<LocalOrdinal *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "rhs_rows" ),
+            n_rhs_triplets ),
+        Kokkos::View<unsigned int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "rhs_columns" ),
+            n_rhs_triplets ),
+        Kokkos::View<double *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "rhs_values" ),
+            n_rhs_triplets )};
+
+    // The quadrature points are numbered by topology, then by cell.
+    unsigned int qp_begin = 0;
+    unsigned int mass_begin = 0;
+    unsigned int rhs_begin = 0;
+    for ( unsigned int i = 0; i < present_topologies.size(); ++i )
+    {
+        auto const &reference_cell = reference_cells[i];
+        auto const topology_cells = internal::selectCells(
+            target_cell_topologies,
+            static_cast<DTK_CellTopology>( present_topologies[i] ) );
+        if ( reference_cell.dim == 2 )
+            internal::assembleCells<2>(
+                reference_cell, topology_cells, cell_offset, target_cells,
+                target_nodes_coordinates, target_cell_dof_ids, qp_begin,
+                qp_coordinates, mass_begin, mass, rhs_begin, rhs );
+        else
+            internal::assembleCells<3>(
+                reference_cell, topology_cells, cell_offset, target_cells,
+                target_nodes_coordinates, target_cell_dof_ids, qp_begin,
+                qp_coordinates, mass_begin, mass, rhs_begin, rhs );
+
+        unsigned int const n = topology_cells.extent( 0 );
+        qp_begin += n * reference_cell.n_qp;
+        mass_begin += n * reference_cell.n_nodes * reference_cell.n_nodes;
+        rhs_begin += n * reference_cell.n_qp * reference_cell.n_nodes;
+    }
+
+    // Compress the mass matrix and the right-hand side operator. A dof that
+    // does not belong to any cell has an empty row: its equation is replaced
+    // by the identity so that its value is zero.
+    internal::compressTriplets( mass, _n_target_dofs, true, _mass_offset,
+                                _mass_columns, _mass_values );
+    internal::compressTriplets( rhs, _n_target_dofs, false, _rhs_offset,
+                                _rhs_columns, _rhs_values );
+    _inv_diagonal =
+        internal::invertDiagonal( _mass_offset, _mass_columns, _mass_values );
+
+    return qp_coordinates;
+}
+} // namespace DataTransferKit
+
+// Explicit instantiation macro
+#define DTK_L2PROJECTION_INSTANT( NODE )                                       \
+    template class L2Projection<typename NODE::device_type>;
+
+#endif
@@ -0,0 +1,151 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_MESH_WALK_DECL_HPP
+#define DTK_MESH_WALK_DECL_HPP
+
+#include "DTK_ConfigDefs.hpp"
+#include <DTK_CellTypes.h>
+#include <DTK_PointSearch.hpp>
+#include <DTK_Types.h>
+
+#include <Kokkos_View.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <tuple>
+
+namespace DataTransferKit
+{
+/**
+ * This class locates points that move little between two searches, e.g.
+ * particles or the nodes of a deforming mesh, by walking through the local
+ * cells from the cell where each point was last found. At each step, the
+ * reference coordinates of the point in the current cell tell through which
+ * face it left the cell and the walk goes on in the cell on the other side
+ * of that face, as given by the adjacency list of the mesh. The points for
+ * which the walk leaves the local cells are looked for with a PointSearch
+ * over the same mesh.
+ */
+template <typename DeviceType>
+class MeshWalk
+{
+  public:
+    /**
+     * Constructor. The neighbor of each cell across each of its faces is
+     * computed from the adjacency list, and the PointSearch used when the
+     * walk fails is built.
+     * @param comm
+     * @param cell_topologies
+     * @param cells vertices associated to each cell
+     * @param cell_nodes_coordinates coordinates of all the nodes in the mesh
+     * @param cell_global_ids global ids of the cells
+     * @param adjacent_cells global ids of the cells adjacent to each cell
+     * @param adjacencies_per_cell number of cells adjacent to each cell
+     * For a more detailed documentation on these arguments see the
+     * documentation of CellList. Two local cells are neighbors across a face
+     * if they are adjacent and share the vertices of that face. The faces
+     * shared with cells of other processors are treated as the boundary of
+     * the local cells.
+     */
+    MeshWalk(
+        Teuchos::RCP<const Teuchos::Comm<int>> comm,
+        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> cells,
+        Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
+        Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids,
+        Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells,
+        Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell );
+
+    /**
+     * Locate the points by walking from the cells where they were. The
+     * points that are not found in the local cells are then looked for with
+     * the PointSearch, whose results are returned by getPointSearch(). This
+     * must be called as a collective.
+     * @param points_coordinates coordinates in the physical frame of the
+     * points that we are looking for.
+     * @param cell_indices on input, the local index of the cell where each
+     * point starts its walk, or -1 if it is not known. On output, the local
+     * index of the cell where the point has been found, or -1 if the point
+     * has been passed to the PointSearch.
+     * @param reference_points on output, the coordinates of the points in the
+     * frame of reference of the cells where they have been found.
+     */
+    void walk( Kokkos::View<double **, DeviceType> points_coordinates,
+               Kokkos::View<int *, DeviceType> cell_indices,
+               Kokkos::View<double **, DeviceType> reference_points );
+
+    /**
+     * Return the indices of the points that the last walk passed to the
+     * PointSearch. The query ids of the results of the PointSearch are
+     * positions in this View on the processor that owns the points.
+     */
+    Kokkos::View<int *, DeviceType> getLostPoints() const
+    {
+        return _lost_points;
+    }
+
+    /**
+     * Return the PointSearch that looked for the points lost by the last
+     * walk.
+     */
+    PointSearch<DeviceType> &getPointSearch() { return _point_search; }
+
+    /**
+     * Return the local index of the cell on the other side of each face of
+     * each cell, or -1 if there is no such local cell. The faces of cell i
+     * are given by the positions face_offset(i) to face_offset(i+1).
+     */
+    std::tuple<Kokkos::View<int *, DeviceType>, Kokkos::View<int *, DeviceType>>
+    getFaceNeighbors() const
+    {
+        return std::make_tuple( _face_offset, _face_neighbors );
+    }
+
+    /**
+     * Maximum number of cells that a point goes through before it is passed
+     * to the PointSearch.
+     */
+    static int max_steps;
+
+  private:
+    /**
+     * Compute the neighbor of each cell across each of its faces.
+     */
+    void buildFaceNeighbors(
+        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> cells,
+        Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids,
+        Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells,
+        Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell );
+
+    /**
+     * Test whether the points are in the cells given by their topology and
+     * their index in the block of that topology.
+     */
+    void pointInCell( Kokkos::View<double **, DeviceType> physical_points,
+                      Kokkos::View<int *, DeviceType> block_cell_indices,
+                      Kokkos::View<DTK_CellTopology *, DeviceType> topologies,
+                      Kokkos::View<double **, DeviceType> reference_points,
+                      Kokkos::View<bool *, DeviceType> point_in_cell );
+
+    PointSearch<DeviceType> _point_search;
+    Kokkos::View<DTK_CellTopology *, DeviceType> _cell_topologies;
+    Kokkos::View<int *, DeviceType> _face_offset;
+    Kokkos::View<int *, DeviceType> _face_neighbors;
+    Kokkos::View<int *, DeviceType> _lost_points;
+};
+
+template <typename DeviceType>
+int MeshWalk<DeviceType>::max_steps = 100;
+} // namespace DataTransferKit
+
+#endif
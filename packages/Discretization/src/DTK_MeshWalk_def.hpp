@@ -0,0 +1,417 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_MESH_WALK_DEF_HPP
+#define DTK_MESH_WALK_DEF_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsUtils.hpp>
+#include <DTK_PointInCell.hpp>
+#include <DTK_Statistics.hpp>
+#include <DTK_Topology.hpp>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace internal
+{
+/**
+ * Vertices of the faces of the cells of a given topology, in the order of
+ * the faces of the canonical cell topology. Only the vertices are needed to
+ * match the faces of two cells so the cells of second order share the faces
+ * of their first-order counterparts.
+ */
+inline std::vector<std::vector<unsigned int>>
+faceVertices( DTK_CellTopology topo )
+{
+    switch ( topo )
+    {
+    case DTK_TRI_3:
+    case DTK_TRI_6:
+        return {{0, 1}, {1, 2}, {2, 0}};
+    case DTK_QUAD_4:
+    case DTK_QUAD_9:
+        return {{0, 1}, {1, 2}, {2, 3}, {3, 0}};
+    case DTK_TET_4:
+    case DTK_TET_10:
+        return {{0, 1, 3}, {1, 2, 3}, {0, 3, 2}, {0, 2, 1}};
+    case DTK_HEX_8:
+    case DTK_HEX_27:
+        return {{0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6},
+                {0, 4, 7, 3}, {0, 3, 2, 1}, {4, 5, 6, 7}};
+    case DTK_PYRAMID_5:
+        return {{0, 1, 4}, {1, 2, 4}, {2, 3, 4}, {3, 0, 4}, {0, 3, 2, 1}};
+    case DTK_WEDGE_6:
+    case DTK_WEDGE_18:
+        return {{0, 1, 4, 3}, {1, 2, 5, 4}, {0, 3, 5, 2}, {0, 2, 1}, {3, 4, 5}};
+    default:
+        throw DataTransferKitNotImplementedException();
+    }
+}
+
+/**
+ * Face through which a point leaves a cell given its coordinates in the
+ * reference frame of the cell. Each face of the reference cell lies on a
+ * plane and the point is on the outer side of the faces for which the
+ * signed distance to the plane, up to a factor, is positive. The face that
+ * is chosen is the one that the point is the farthest from. The faces are
+ * numbered as in faceVertices().
+ */
+KOKKOS_INLINE_FUNCTION
+int exitFace( DTK_CellTopology topo, double const x[3] )
+{
+    int constexpr max_n_faces = 6;
+    double distances[max_n_faces];
+    int n_faces = 0;
+    switch ( topo )
+    {
+    case DTK_TRI_3:
+    case DTK_TRI_6:
+        distances[n_faces++] = -x[1];
+        distances[n_faces++] = x[0] + x[1] - 1.;
+        distances[n_faces++] = -x[0];
+        break;
+    case DTK_QUAD_4:
+    case DTK_QUAD_9:
+        distances[n_faces++] = -1. - x[1];
+        distances[n_faces++] = x[0] - 1.;
+        distances[n_faces++] = x[1] - 1.;
+        distances[n_faces++] = -1. - x[0];
+        break;
+    case DTK_TET_4:
+    case DTK_TET_10:
+        distances[n_faces++] = -x[1];
+        distances[n_faces++] = x[0] + x[1] + x[2] - 1.;
+        distances[n_faces++] = -x[0];
+        distances[n_faces++] = -x[2];
+        break;
+    case DTK_HEX_8:
+    case DTK_HEX_27:
+        distances[n_faces++] = -1. - x[1];
+        distances[n_faces++] = x[0] - 1.;
+        distances[n_faces++] = x[1] - 1.;
+        distances[n_faces++] = -1. - x[0];
+        distances[n_faces++] = -1. - x[2];
+        distances[n_faces++] = x[2] - 1.;
+        break;
+    case DTK_PYRAMID_5:
+        distances[n_faces++] = x[2] - x[1] - 1.;
+        distances[n_faces++] = x[2] + x[0] - 1.;
+        distances[n_faces++] = x[2] + x[1] - 1.;
+        distances[n_faces++] = x[2] - x[0] - 1.;
+        distances[n_faces++] = -x[2];
+        break;
+    case DTK_WEDGE_6:
+    case DTK_WEDGE_18:
+        distances[n_faces++] = -x[1];
+        distances[n_faces++] = x[0] + x[1] - 1.;
+        distances[n_faces++] = -x[0];
+        distances[n_faces++] = -1. - x[2];
+        distances[n_faces++] = x[2] - 1.;
+        break;
+    default:
+        return -1;
+    }
+    int face = 0;
+    for ( int f = 1; f < n_faces; ++f )
+        if ( distances[f] > distances[face] )
+            face = f;
+    return face;
+}
+} // namespace internal
+
+template <typename DeviceType>
+MeshWalk<DeviceType>::MeshWalk(
+    Teuchos::RCP<const Teuchos::Comm<int>> comm,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
+    Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids,
+    Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells,
+    Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell )
+    : _point_search( comm, cell_topologies, cells, cell_nodes_coordinates )
+    , _cell_topologies( cell_topologies )
+    , _lost_points( "lost_points", 0 )
+{
+    DTK_REQUIRE( cell_global_ids.extent( 0 ) == cell_topologies.extent( 0 ) );
+    DTK_REQUIRE( adjacencies_per_cell.extent( 0 ) ==
+                 cell_topologies.extent( 0 ) );
+
+    buildFaceNeighbors( cell_topologies, cells, cell_global_ids,
+                        adjacent_cells, adjacencies_per_cell );
+}
+
+template <typename DeviceType>
+void MeshWalk<DeviceType>::buildFaceNeighbors(
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids,
+    Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells,
+    Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell )
+{
+    ScopedTimer timer( "mesh walk setup" );
+
+    // This is done once for all the walks so it is done on the host
+    auto cell_topologies_host = Kokkos::create_mirror_view( cell_topologies );
+    Kokkos::deep_copy( cell_topologies_host, cell_topologies );
+    auto cells_host = Kokkos::create_mirror_view( cells );
+    Kokkos::deep_copy( cells_host, cells );
+    auto cell_global_ids_host = Kokkos::create_mirror_view( cell_global_ids );
+    Kokkos::deep_copy( cell_global_ids_host, cell_global_ids );
+    auto adjacent_cells_host = Kokkos::create_mirror_view( adjacent_cells );
+    Kokkos::deep_copy( adjacent_cells_host, adjacent_cells );
+    auto adjacencies_per_cell_host =
+        Kokkos::create_mirror_view( adjacencies_per_cell );
+    Kokkos::deep_copy( adjacencies_per_cell_host, adjacencies_per_cell );
+
+    unsigned int const n_cells = cell_topologies.extent( 0 );
+    Topologies topologies;
+    std::unordered_map<GlobalOrdinal, int> local_indices;
+    std::vector<unsigned int> node_offset( n_cells + 1, 0 );
+    for ( unsigned int i = 0; i < n_cells; ++i )
+    {
+        local_indices[cell_global_ids_host( i )] = i;
+        node_offset[i + 1] =
+            node_offset[i] + topologies[cell_topologies_host( i )].n_nodes;
+    }
+    DTK_REQUIRE( node_offset[n_cells] == cells.extent( 0 ) );
+
+    // Two cells are neighbors across a face if they share all its vertices
+    std::vector<int> face_offset( n_cells + 1, 0 );
+    std::vector<int> face_neighbors;
+    unsigned int adjacency_offset = 0;
+    for ( unsigned int i = 0; i < n_cells; ++i )
+    {
+        unsigned int const n_adjacencies = adjacencies_per_cell_host( i );
+        for ( auto const &face :
+              internal::faceVertices( cell_topologies_host( i ) ) )
+        {
+            int neighbor = -1;
+            for ( unsigned int a = adjacency_offset;
+                  a < adjacency_offset + n_adjacencies; ++a )
+            {
+                auto const j = local_indices.find( adjacent_cells_host( a ) );
+                if ( j == local_indices.end() )
+                    continue;
+                unsigned int const *first =
+                    cells_host.data() + node_offset[j->second];
+                unsigned int const *last =
+                    cells_host.data() + node_offset[j->second + 1];
+                bool const shares_face = std::all_of(
+                    face.begin(), face.end(), [&]( unsigned int v ) {
+                        unsigned int const node =
+                            cells_host( node_offset[i] + v );
+                        return std::find( first, last, node ) != last;
+                    } );
+                if ( shares_face )
+                {
+                    neighbor = j->second;
+                    break;
+                }
+            }
+            face_neighbors.push_back( neighbor );
+        }
+        face_offset[i + 1] = face_neighbors.size();
+        adjacency_offset += n_adjacencies;
+    }
+    DTK_REQUIRE( adjacency_offset == adjacent_cells.extent( 0 ) );
+
+    _face_offset = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "face_offset" ), n_cells + 1 );
+    Kokkos::deep_copy( _face_offset,
+                       Kokkos::View<int *, Kokkos::HostSpace,
+                                    Kokkos::MemoryUnmanaged>(
+                           face_offset.data(), face_offset.size() ) );
+    _face_neighbors = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "face_neighbors" ),
+        face_neighbors.size() );
+    Kokkos::deep_copy( _face_neighbors,
+                       Kokkos::View<int *, Kokkos::HostSpace,
+                                    Kokkos::MemoryUnmanaged>(
+                           face_neighbors.data(), face_neighbors.size() ) );
+}
+
+template <typename DeviceType>
+void MeshWalk<DeviceType>::walk(
+    Kokkos::View<double **, DeviceType> points_coordinates,
+    Kokkos::View<int *, DeviceType> cell_indices,
+    Kokkos::View<double **, DeviceType> reference_points )
+{
+    ScopedTimer timer( "mesh walk" );
+
+    unsigned int const dim = _point_search._dim;
+    DTK_REQUIRE( points_coordinates.extent( 1 ) == dim );
+    DTK_REQUIRE( cell_indices.extent( 0 ) == points_coordinates.extent( 0 ) );
+    DTK_REQUIRE( reference_points.extent( 0 ) ==
+                 points_coordinates.extent( 0 ) );
+    DTK_REQUIRE( reference_points.extent( 1 ) == dim );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_points = points_coordinates.extent( 0 );
+    int const n_cells = _cell_topologies.extent( 0 );
+
+    // The points that start from an unknown cell are lost right away
+    Kokkos::View<int *, DeviceType> walking( "walking", n_points );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "start_walk" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( cell_indices( i ) < 0 || cell_indices( i ) >= n_cells )
+                cell_indices( i ) = -1;
+            else
+                walking( i ) = 1;
+        } );
+    Kokkos::fence();
+
+    // We cannot use private member in a lambda function with CUDA
+    auto cell_topologies = _cell_topologies;
+    auto bounding_box_to_cell = _point_search._bounding_box_to_cell;
+    auto face_offset = _face_offset;
+    auto face_neighbors = _face_neighbors;
+
+    // The walks advance by one cell at a time, all together, so that the
+    // points in cells of different topologies are tested by a single
+    // point-in-cell kernel at each step.
+    Kokkos::View<int *, DeviceType> offset(
+        Kokkos::ViewAllocateWithoutInitializing( "offset" ), n_points + 1 );
+    for ( int step = 0; step < max_steps; ++step )
+    {
+        auto const active = selectIndices<DeviceType>(
+            "active", n_points,
+            KOKKOS_LAMBDA( int const i ) { return walking( i ) != 0; } );
+        int const n_active = active.extent( 0 );
+        if ( n_active == 0 )
+            break;
+
+        Kokkos::View<double **, DeviceType> points(
+            Kokkos::ViewAllocateWithoutInitializing( "points" ), n_active,
+            dim );
+        Kokkos::View<int *, DeviceType> block_cell_indices(
+            Kokkos::ViewAllocateWithoutInitializing( "block_cell_indices" ),
+            n_active );
+        Kokkos::View<DTK_CellTopology *, DeviceType> topologies(
+            Kokkos::ViewAllocateWithoutInitializing( "topologies" ),
+            n_active );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "gather_walking_points" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_active ),
+            KOKKOS_LAMBDA( int const i ) {
+                int const p = active( i );
+                int const cell = cell_indices( p );
+                DTK_CellTopology const topo = cell_topologies( cell );
+                topologies( i ) = topo;
+                block_cell_indices( i ) = bounding_box_to_cell( cell, topo );
+                for ( unsigned int d = 0; d < dim; ++d )
+                    points( i, d ) = points_coordinates( p, d );
+            } );
+        Kokkos::fence();
+
+        Kokkos::View<double **, DeviceType> step_reference_points(
+            Kokkos::ViewAllocateWithoutInitializing( "reference_points" ),
+            n_active, dim );
+        Kokkos::View<bool *, DeviceType> point_in_cell(
+            Kokkos::ViewAllocateWithoutInitializing( "point_in_cell" ),
+            n_active );
+        pointInCell( points, block_cell_indices, topologies,
+                     step_reference_points, point_in_cell );
+
+        // The points that are not in their current cell move on to the
+        // neighbor across the face through which they leave it.
+        bool const last_step = ( step == max_steps - 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "walk_step" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_active ),
+            KOKKOS_LAMBDA( int const i ) {
+                int const p = active( i );
+                if ( point_in_cell( i ) )
+                {
+                    for ( unsigned int d = 0; d < dim; ++d )
+                        reference_points( p, d ) =
+                            step_reference_points( i, d );
+                    walking( p ) = 0;
+                    return;
+                }
+                double x[3] = {0., 0., 0.};
+                for ( unsigned int d = 0; d < dim; ++d )
+                    x[d] = step_reference_points( i, d );
+                int const cell = cell_indices( p );
+                int const face = internal::exitFace( topologies( i ), x );
+                int const next =
+                    ( face < 0 || last_step )
+                        ? -1
+                        : face_neighbors( face_offset( cell ) + face );
+                cell_indices( p ) = next;
+                if ( next < 0 )
+                    walking( p ) = 0;
+            } );
+        Kokkos::fence();
+    }
+
+    // Look for the lost points in the whole mesh
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_lost_points" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              offset( i ) = ( cell_indices( i ) < 0 ) ? 1 : 0;
+                          } );
+    Kokkos::fence();
+    int const n_lost = exclusivePrefixSum( offset );
+    _lost_points = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "lost_points" ), n_lost );
+    Kokkos::View<double **, DeviceType> lost_points_coordinates(
+        Kokkos::ViewAllocateWithoutInitializing( "lost_points_coordinates" ),
+        n_lost, dim );
+    auto lost_points = _lost_points;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "gather_lost_points" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( cell_indices( i ) < 0 )
+            {
+                lost_points( offset( i ) ) = i;
+                for ( unsigned int d = 0; d < dim; ++d )
+                    lost_points_coordinates( offset( i ), d ) =
+                        points_coordinates( i, d );
+            }
+        } );
+    Kokkos::fence();
+
+    _point_search.search( lost_points_coordinates );
+}
+
+template <typename DeviceType>
+void MeshWalk<DeviceType>::pointInCell(
+    Kokkos::View<double **, DeviceType> physical_points,
+    Kokkos::View<int *, DeviceType> block_cell_indices,
+    Kokkos::View<DTK_CellTopology *, DeviceType> topologies,
+    Kokkos::View<double **, DeviceType> reference_points,
+    Kokkos::View<bool *, DeviceType> point_in_cell )
+{
+    if ( _point_search._index_nodes )
+        PointInCell<DeviceType>::search(
+            physical_points, _point_search._block_connectivities,
+            _point_search._coordinates, _point_search._inverse_maps,
+            block_cell_indices, topologies, reference_points, point_in_cell );
+    else
+        PointInCell<DeviceType>::search(
+            physical_points, _point_search._block_cells,
+            _point_search._inverse_maps, block_cell_indices, topologies,
+            reference_points, point_in_cell );
+}
+} // namespace DataTransferKit
+
+// Explicit instantiation macro
+#define DTK_MESHWALK_INSTANT( NODE )                                           \
+    template class MeshWalk<typename NODE::device_type>;
+
+#endif
@@ -0,0 +1,245 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_NATIVE_BASIS_HPP
+#define DTK_NATIVE_BASIS_HPP
+
+#include <DTK_FE.hpp>
+#include <DTK_Types.h>
+
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/**
+ * Values at a reference point of the H-grad basis functions whose Intrepid2
+ * serial operator is FEOpType, evaluated without going through views.  The
+ * reference point and the values live in local arrays so that the
+ * evaluation is unrolled at compile time.  The basis functions are numbered
+ * as in Intrepid2.  Only the lowest order bases of the elements that are
+ * most commonly used are provided; is_native is false for the other ones,
+ * which are left to Intrepid2 (see Functor::HgradWeightsFunctor).
+ */
+template <typename FEOpType>
+struct NativeBasis
+{
+    static constexpr bool is_native = false;
+};
+
+// One-dimensional quadratic Lagrange polynomials on [-1, 1] at the nodes -1,
+// 0, and 1, which the quadratic bases on quadrilaterals and hexahedra are
+// the tensor products of.
+KOKKOS_INLINE_FUNCTION
+void quadraticLagrange( Coordinate const x, Coordinate ( &l )[3] )
+{
+    l[0] = 0.5 * x * ( x - 1. );
+    l[1] = ( 1. - x ) * ( 1. + x );
+    l[2] = 0.5 * x * ( x + 1. );
+}
+
+template <>
+struct NativeBasis<HEX_HGRAD_1::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 3;
+    static constexpr int cardinality = 8;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        Coordinate const xm = 1. - x[0];
+        Coordinate const xp = 1. + x[0];
+        Coordinate const ym = 1. - x[1];
+        Coordinate const yp = 1. + x[1];
+        Coordinate const zm = 0.125 * ( 1. - x[2] );
+        Coordinate const zp = 0.125 * ( 1. + x[2] );
+        values[0] = xm * ym * zm;
+        values[1] = xp * ym * zm;
+        values[2] = xp * yp * zm;
+        values[3] = xm * yp * zm;
+        values[4] = xm * ym * zp;
+        values[5] = xp * ym * zp;
+        values[6] = xp * yp * zp;
+        values[7] = xm * yp * zp;
+    }
+};
+
+template <>
+struct NativeBasis<HEX_HGRAD_2::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 3;
+    static constexpr int cardinality = 27;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        // Position of the nodes along each direction: 0, 1, and 2 stand for
+        // -1, 0, and 1.  The vertices come first, followed by the midpoints
+        // of the edges, the center, and the centers of the faces z = -1,
+        // z = 1, x = -1, x = 1, y = -1, and y = 1.
+        int const nodes[cardinality][dim] = {
+            {0, 0, 0}, {2, 0, 0}, {2, 2, 0}, {0, 2, 0}, {0, 0, 2}, {2, 0, 2},
+            {2, 2, 2}, {0, 2, 2}, {1, 0, 0}, {2, 1, 0}, {1, 2, 0}, {0, 1, 0},
+            {0, 0, 1}, {2, 0, 1}, {2, 2, 1}, {0, 2, 1}, {1, 0, 2}, {2, 1, 2},
+            {1, 2, 2}, {0, 1, 2}, {1, 1, 1}, {1, 1, 0}, {1, 1, 2}, {0, 1, 1},
+            {2, 1, 1}, {1, 0, 1}, {1, 2, 1}};
+        Coordinate lx[3];
+        Coordinate ly[3];
+        Coordinate lz[3];
+        quadraticLagrange( x[0], lx );
+        quadraticLagrange( x[1], ly );
+        quadraticLagrange( x[2], lz );
+        for ( int i = 0; i < cardinality; ++i )
+            values[i] =
+                lx[nodes[i][0]] * ly[nodes[i][1]] * lz[nodes[i][2]];
+    }
+};
+
+template <>
+struct NativeBasis<QUAD_HGRAD_1::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 2;
+    static constexpr int cardinality = 4;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        Coordinate const xm = 1. - x[0];
+        Coordinate const xp = 1. + x[0];
+        Coordinate const ym = 0.25 * ( 1. - x[1] );
+        Coordinate const yp = 0.25 * ( 1. + x[1] );
+        values[0] = xm * ym;
+        values[1] = xp * ym;
+        values[2] = xp * yp;
+        values[3] = xm * yp;
+    }
+};
+
+template <>
+struct NativeBasis<QUAD_HGRAD_2::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 2;
+    static constexpr int cardinality = 9;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        // Same numbering as the bottom face of HEX_HGRAD_2: the vertices,
+        // the midpoints of the edges, and the center.
+        int const nodes[cardinality][dim] = {{0, 0}, {2, 0}, {2, 2},
+                                             {0, 2}, {1, 0}, {2, 1},
+                                             {1, 2}, {0, 1}, {1, 1}};
+        Coordinate lx[3];
+        Coordinate ly[3];
+        quadraticLagrange( x[0], lx );
+        quadraticLagrange( x[1], ly );
+        for ( int i = 0; i < cardinality; ++i )
+            values[i] = lx[nodes[i][0]] * ly[nodes[i][1]];
+    }
+};
+
+template <>
+struct NativeBasis<TET_HGRAD_1::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 3;
+    static constexpr int cardinality = 4;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        values[0] = 1. - x[0] - x[1] - x[2];
+        values[1] = x[0];
+        values[2] = x[1];
+        values[3] = x[2];
+    }
+};
+
+template <>
+struct NativeBasis<TET_HGRAD_2::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 3;
+    static constexpr int cardinality = 10;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        // The vertices come first, followed by the midpoints of the edges
+        // 0-1, 1-2, 0-2, 0-3, 1-3, and 2-3.
+        Coordinate const t = 1. - x[0] - x[1] - x[2];
+        values[0] = t * ( 2. * t - 1. );
+        values[1] = x[0] * ( 2. * x[0] - 1. );
+        values[2] = x[1] * ( 2. * x[1] - 1. );
+        values[3] = x[2] * ( 2. * x[2] - 1. );
+        values[4] = 4. * t * x[0];
+        values[5] = 4. * x[0] * x[1];
+        values[6] = 4. * t * x[1];
+        values[7] = 4. * t * x[2];
+        values[8] = 4. * x[0] * x[2];
+        values[9] = 4. * x[1] * x[2];
+    }
+};
+
+template <>
+struct NativeBasis<TRI_HGRAD_1::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 2;
+    static constexpr int cardinality = 3;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        values[0] = 1. - x[0] - x[1];
+        values[1] = x[0];
+        values[2] = x[1];
+    }
+};
+
+template <>
+struct NativeBasis<TRI_HGRAD_2::feop_type>
+{
+    static constexpr bool is_native = true;
+    static constexpr int dim = 2;
+    static constexpr int cardinality = 6;
+
+    KOKKOS_INLINE_FUNCTION
+    static void getValues( Coordinate const ( &x )[dim],
+                           Coordinate ( &values )[cardinality] )
+    {
+        // The vertices come first, followed by the midpoints of the edges
+        // 0-1, 1-2, and 2-0.
+        Coordinate const t = 1. - x[0] - x[1];
+        values[0] = t * ( 2. * t - 1. );
+        values[1] = x[0] * ( 2. * x[0] - 1. );
+        values[2] = x[1] * ( 2. * x[1] - 1. );
+        values[3] = 4. * t * x[0];
+        values[4] = 4. * x[0] * x[1];
+        values[5] = 4. * t * x[1];
+    }
+};
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
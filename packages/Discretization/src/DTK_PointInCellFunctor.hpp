@@ -12,30 +12,219 @@
 #ifndef DTK_POINT_IN_CELL_FUNCTOR_HPP
 #define DTK_POINT_IN_CELL_FUNCTOR_HPP
 
-#include <Intrepid2_CellTools_Serial.hpp>
+#include <DTK_CellTypes.h>
+#include <DTK_KokkosHelpers.hpp>
+#include <DTK_PointInCellNewton.hpp>
+#include <DTK_PointInCellPreRejection.hpp>
+#include <DTK_Topology.hpp>
+
 #include <Kokkos_Macros.hpp>
 #include <Kokkos_View.hpp>
 
+#include <array>
+
 namespace DataTransferKit
 {
 namespace Functor
 {
+/**
+ * Nodes of a cell given by its connectivity in a mesh whose node coordinates
+ * are not duplicated. It is accessed like the (n_nodes, dim) subview of a
+ * block of cells but the coordinates are gathered on the fly.
+ */
+template <typename DeviceType>
+class IndexedNodes
+{
+  public:
+    KOKKOS_INLINE_FUNCTION
+    IndexedNodes( Kokkos::View<unsigned int **, DeviceType> connectivity,
+                  Kokkos::View<Coordinate **, DeviceType> coordinates,
+                  int const cell_index )
+        : _connectivity( connectivity )
+        , _coordinates( coordinates )
+        , _cell_index( cell_index )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Coordinate operator()( int const node, int const d ) const
+    {
+        return _coordinates( _connectivity( _cell_index, node ), d );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    size_t extent( int const r ) const
+    {
+        return ( r == 0 ) ? _connectivity.extent( 1 )
+                          : _coordinates.extent( 1 );
+    }
+
+  private:
+    Kokkos::View<unsigned int **, DeviceType> _connectivity;
+    Kokkos::View<Coordinate **, DeviceType> _coordinates;
+    int _cell_index;
+};
+
+/**
+ * Compute the coordinates in the reference frame of the i-th physical point
+ * and return true if the point is inside the cell whose nodes (n_nodes, dim)
+ * are given. The number of Newton iterations, zero if the solve was not
+ * needed, is written in \p n_iterations and \p converged is set to false if
+ * the solve did not converge.
+ */
+template <typename CellType, typename DeviceType, typename NodesView>
+KOKKOS_INLINE_FUNCTION bool
+mapToReferenceFrame( double threshold, NewtonParameters const &newton,
+                     unsigned int const i,
+                     Kokkos::View<Coordinate **, DeviceType> physical_points,
+                     NodesView const &nodes,
+                     Kokkos::View<Coordinate **, DeviceType> reference_points,
+                     int &n_iterations, bool &converged )
+{
+    // Get the subviews corresponding the reference point (dim) and the
+    // physical point (dim)
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<Coordinate *, Kokkos::LayoutStride, ExecutionSpace> ref_point(
+        reference_points, i, Kokkos::ALL() );
+    Kokkos::View<Coordinate *, Kokkos::LayoutStride, ExecutionSpace>
+        phys_point( physical_points, i, Kokkos::ALL() );
+
+    // Skip the Newton solve for the candidates that are obviously not in the
+    // cell. The test is exact for affine cells.
+    PreRejectionResult const result =
+        PreRejectionTraits<CellType>::type::classify( threshold, phys_point,
+                                                      nodes, ref_point );
+    if ( result != PreRejectionResult::unknown )
+    {
+        n_iterations = 0;
+        converged = true;
+        return result == PreRejectionResult::inside;
+    }
+
+    // Compute the reference point and return true if the
+    // point is inside the cell
+    converged = newtonSolve<CellType, ExecutionSpace>(
+        newton, phys_point, nodes, ref_point, n_iterations );
+    return CellType::topo_type::checkPointInclusion( ref_point, threshold );
+}
+
+/**
+ * Same as above for affine simplices whose inverse map has been computed
+ * beforehand by InverseMap.
+ */
+template <typename CellType, typename DeviceType>
+KOKKOS_INLINE_FUNCTION bool mapToReferenceFrameWithInverseMap(
+    double threshold, unsigned int const i,
+    Kokkos::View<Coordinate **, DeviceType> physical_points,
+    Kokkos::View<Coordinate ***, DeviceType> inverse_maps, int const cell_index,
+    Kokkos::View<Coordinate **, DeviceType> reference_points )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<Coordinate *, Kokkos::LayoutStride, ExecutionSpace> ref_point(
+        reference_points, i, Kokkos::ALL() );
+
+    // The first vertex of the reference simplex is the origin.
+    int const dim = physical_points.extent( 1 );
+    for ( int d = 0; d < dim; ++d )
+    {
+        ref_point( d ) = 0.;
+        for ( int k = 0; k < dim; ++k )
+            ref_point( d ) += inverse_maps( cell_index, d, k ) *
+                              ( physical_points( i, k ) -
+                                inverse_maps( cell_index, k, dim ) );
+    }
+    return CellType::topo_type::checkPointInclusion( ref_point, threshold );
+}
+
+/**
+ * Compute the inverse of the reference map of affine simplices. The inverse
+ * map of the i-th cell is stored in inverse_maps(i, :, 0:dim) and its first
+ * vertex in inverse_maps(i, :, dim). The map of degenerate cells is filled
+ * with infinity so that no point is found inside of them. The nodes of the
+ * cells are given either as a block of cells or, if \p cells is empty, as
+ * the connectivity of the cells and the coordinates of the nodes.
+ */
+template <typename CellType, typename DeviceType>
+class InverseMap
+{
+  public:
+    using Vertices = typename PreRejectionTraits<CellType>::type::vertices;
+    static_assert( PreRejectionTraits<CellType>::type::simplex,
+                   "Only the map of linear simplices is affine" );
+
+    InverseMap( Kokkos::View<Coordinate ***, DeviceType> cells,
+                Kokkos::View<unsigned int **, DeviceType> connectivity,
+                Kokkos::View<Coordinate **, DeviceType> coordinates,
+                Kokkos::View<Coordinate ***, DeviceType> inverse_maps )
+        : _cells( cells )
+        , _connectivity( connectivity )
+        , _coordinates( coordinates )
+        , _inverse_maps( inverse_maps )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( unsigned int const i ) const
+    {
+        using ExecutionSpace = typename DeviceType::execution_space;
+        if ( _cells.extent( 0 ) > 0 )
+            compute( i,
+                     Kokkos::View<Coordinate **, Kokkos::LayoutStride,
+                                  ExecutionSpace>( _cells, i, Kokkos::ALL(),
+                                                   Kokkos::ALL() ) );
+        else
+            compute( i, IndexedNodes<DeviceType>( _connectivity, _coordinates,
+                                                  i ) );
+    }
+
+  private:
+    template <typename NodesView>
+    KOKKOS_INLINE_FUNCTION void compute( unsigned int const i,
+                                         NodesView const &nodes ) const
+    {
+        int constexpr dim = Vertices::dim;
+        double inv[dim][dim];
+        bool const invertible =
+            PreRejectionTraits<CellType>::type::computeInverseMap( nodes,
+                                                                   inv );
+        for ( int d = 0; d < dim; ++d )
+        {
+            for ( int k = 0; k < dim; ++k )
+                _inverse_maps( i, d, k ) =
+                    invertible
+                        ? inv[d][k]
+                        : KokkosHelpers::ArithTraits<double>::infinity();
+            _inverse_maps( i, d, dim ) = nodes( 0, d );
+        }
+    }
+
+    Kokkos::View<Coordinate ***, DeviceType> _cells;
+    Kokkos::View<unsigned int **, DeviceType> _connectivity;
+    Kokkos::View<Coordinate **, DeviceType> _coordinates;
+    Kokkos::View<Coordinate ***, DeviceType> _inverse_maps;
+};
+
 template <typename CellType, typename DeviceType>
 class PointInCell
 {
   public:
-    PointInCell( double threshold,
+    PointInCell( double threshold, NewtonParameters const &newton,
                  Kokkos::View<Coordinate **, DeviceType> physical_points,
                  Kokkos::View<Coordinate ***, DeviceType> cells,
                  Kokkos::View<int *, DeviceType> coarse_search_output_cells,
                  Kokkos::View<Coordinate **, DeviceType> reference_points,
-                 Kokkos::View<bool *, DeviceType> point_in_cell )
+                 Kokkos::View<bool *, DeviceType> point_in_cell,
+                 Kokkos::View<int *, DeviceType> newton_iterations,
+                 Kokkos::View<bool *, DeviceType> newton_converged )
         : _threshold( threshold )
+        , _newton( newton )
         , _physical_points( physical_points )
         , _cells( cells )
         , _coarse_search_output_cells( coarse_search_output_cells )
         , _reference_points( reference_points )
         , _point_in_cell( point_in_cell )
+        , _newton_iterations( newton_iterations )
+        , _newton_converged( newton_converged )
     {
     }
 
@@ -44,31 +233,188 @@ class PointInCell
     {
         // Extract the indices computed by the coarse search
         int const cell_index = _coarse_search_output_cells( i );
-        // Get the subviews corresponding the reference point (dim), the
-        // physical point (dim), the current cell (nodes, dim)
         using ExecutionSpace = typename DeviceType::execution_space;
-        Kokkos::View<Coordinate *, Kokkos::LayoutStride, ExecutionSpace>
-            ref_point( _reference_points, i, Kokkos::ALL() );
-        Kokkos::View<Coordinate *, Kokkos::LayoutStride, ExecutionSpace>
-            phys_point( _physical_points, i, Kokkos::ALL() );
         Kokkos::View<Coordinate **, Kokkos::LayoutStride, ExecutionSpace> nodes(
             _cells, cell_index, Kokkos::ALL(), Kokkos::ALL() );
-
-        // Compute the reference point and return true if the
-        // point is inside the cell
-        Intrepid2::Impl::CellTools::Serial::mapToReferenceFrame<
-            typename CellType::basis_type>( ref_point, phys_point, nodes );
-        _point_in_cell[i] =
-            CellType::topo_type::checkPointInclusion( ref_point, _threshold );
+        int n_iterations;
+        bool converged;
+        _point_in_cell[i] = mapToReferenceFrame<CellType, DeviceType>(
+            _threshold, _newton, i, _physical_points, nodes, _reference_points,
+            n_iterations, converged );
+        // The Newton statistics are optional
+        if ( _newton_iterations.extent( 0 ) > 0 )
+            _newton_iterations( i ) = n_iterations;
+        if ( _newton_converged.extent( 0 ) > 0 )
+            _newton_converged( i ) = converged;
     }
 
   private:
     double _threshold;
+    NewtonParameters _newton;
     Kokkos::View<Coordinate **, DeviceType> _physical_points;
     Kokkos::View<Coordinate ***, DeviceType> _cells;
     Kokkos::View<int *, DeviceType> _coarse_search_output_cells;
     Kokkos::View<Coordinate **, DeviceType> _reference_points;
     Kokkos::View<bool *, DeviceType> _point_in_cell;
+    Kokkos::View<int *, DeviceType> _newton_iterations;
+    Kokkos::View<bool *, DeviceType> _newton_converged;
+};
+/**
+ * Same as above for candidate cells of different topologies. The candidates
+ * are processed by a single kernel which dispatches on the topology of each
+ * cell. Sorting the candidates by topology beforehand keeps the threads of a
+ * warp on the same branch. The nodes of the cells of a given topology are
+ * either a block of cells or, if that block is empty, the connectivity of the
+ * cells and the coordinates of the nodes shared by all the topologies. The
+ * inverse maps of the simplices are used if they are given, i.e. if the
+ * corresponding view is not empty.
+ */
+template <typename DeviceType>
+class MultiTopologyPointInCell
+{
+  public:
+    MultiTopologyPointInCell(
+        double threshold, NewtonParameters const &newton,
+        Kokkos::View<Coordinate **, DeviceType> physical_points,
+        std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+            &cells,
+        std::array<Kokkos::View<unsigned int **, DeviceType>,
+                   DTK_N_TOPO> const &connectivities,
+        Kokkos::View<Coordinate **, DeviceType> coordinates,
+        std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+            &inverse_maps,
+        Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+        Kokkos::View<Coordinate **, DeviceType> reference_points,
+        Kokkos::View<bool *, DeviceType> point_in_cell,
+        Kokkos::View<int *, DeviceType> newton_iterations,
+        Kokkos::View<bool *, DeviceType> newton_converged )
+        : _threshold( threshold )
+        , _newton( newton )
+        , _physical_points( physical_points )
+        , _cells( cells )
+        , _connectivities( connectivities )
+        , _coordinates( coordinates )
+        , _inverse_maps( inverse_maps )
+        , _coarse_search_output_cells( coarse_search_output_cells )
+        , _cell_topologies( cell_topologies )
+        , _reference_points( reference_points )
+        , _point_in_cell( point_in_cell )
+        , _newton_iterations( newton_iterations )
+        , _newton_converged( newton_converged )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( unsigned int const i ) const
+    {
+        switch ( _cell_topologies( i ) )
+        {
+        case DTK_HEX_8:
+            _point_in_cell[i] = apply<HEX_8>( i, DTK_HEX_8 );
+            break;
+        case DTK_HEX_27:
+            _point_in_cell[i] = apply<HEX_27>( i, DTK_HEX_27 );
+            break;
+        case DTK_PYRAMID_5:
+            _point_in_cell[i] = apply<PYRAMID_5>( i, DTK_PYRAMID_5 );
+            break;
+        case DTK_QUAD_4:
+            _point_in_cell[i] = apply<QUAD_4>( i, DTK_QUAD_4 );
+            break;
+        case DTK_QUAD_9:
+            _point_in_cell[i] = apply<QUAD_9>( i, DTK_QUAD_9 );
+            break;
+        case DTK_TET_4:
+            _point_in_cell[i] = applySimplex<TET_4>( i, DTK_TET_4 );
+            break;
+        case DTK_TET_10:
+            _point_in_cell[i] = apply<TET_10>( i, DTK_TET_10 );
+            break;
+        case DTK_TRI_3:
+            _point_in_cell[i] = applySimplex<TRI_3>( i, DTK_TRI_3 );
+            break;
+        case DTK_TRI_6:
+            _point_in_cell[i] = apply<TRI_6>( i, DTK_TRI_6 );
+            break;
+        case DTK_WEDGE_6:
+            _point_in_cell[i] = apply<WEDGE_6>( i, DTK_WEDGE_6 );
+            break;
+        case DTK_WEDGE_18:
+            _point_in_cell[i] = apply<WEDGE_18>( i, DTK_WEDGE_18 );
+            break;
+        default:
+            // Unsupported topologies are rejected on the host
+            _point_in_cell[i] = false;
+            record( i, 0, true );
+        }
+    }
+
+  private:
+    template <typename CellType>
+    KOKKOS_INLINE_FUNCTION bool apply( unsigned int const i,
+                                       DTK_CellTopology const topo ) const
+    {
+        using ExecutionSpace = typename DeviceType::execution_space;
+        int const cell_index = _coarse_search_output_cells( i );
+        int n_iterations;
+        bool converged;
+        bool const in_cell =
+            ( _cells[topo].extent( 0 ) > 0 )
+                ? mapToReferenceFrame<CellType, DeviceType>(
+                      _threshold, _newton, i, _physical_points,
+                      Kokkos::View<Coordinate **, Kokkos::LayoutStride,
+                                   ExecutionSpace>( _cells[topo], cell_index,
+                                                    Kokkos::ALL(),
+                                                    Kokkos::ALL() ),
+                      _reference_points, n_iterations, converged )
+                : mapToReferenceFrame<CellType, DeviceType>(
+                      _threshold, _newton, i, _physical_points,
+                      IndexedNodes<DeviceType>( _connectivities[topo],
+                                                _coordinates, cell_index ),
+                      _reference_points, n_iterations, converged );
+        record( i, n_iterations, converged );
+        return in_cell;
+    }
+
+    template <typename CellType>
+    KOKKOS_INLINE_FUNCTION bool
+    applySimplex( unsigned int const i, DTK_CellTopology const topo ) const
+    {
+        if ( _inverse_maps[topo].extent( 0 ) == 0 )
+            return apply<CellType>( i, topo );
+        record( i, 0, true );
+        return mapToReferenceFrameWithInverseMap<CellType, DeviceType>(
+            _threshold, i, _physical_points, _inverse_maps[topo],
+            _coarse_search_output_cells( i ), _reference_points );
+    }
+
+    // The Newton statistics are optional
+    KOKKOS_INLINE_FUNCTION void record( unsigned int const i,
+                                        int const n_iterations,
+                                        bool const converged ) const
+    {
+        if ( _newton_iterations.extent( 0 ) > 0 )
+            _newton_iterations( i ) = n_iterations;
+        if ( _newton_converged.extent( 0 ) > 0 )
+            _newton_converged( i ) = converged;
+    }
+
+    double _threshold;
+    NewtonParameters _newton;
+    Kokkos::View<Coordinate **, DeviceType> _physical_points;
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> _cells;
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+        _connectivities;
+    Kokkos::View<Coordinate **, DeviceType> _coordinates;
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO>
+        _inverse_maps;
+    Kokkos::View<int *, DeviceType> _coarse_search_output_cells;
+    Kokkos::View<DTK_CellTopology *, DeviceType> _cell_topologies;
+    Kokkos::View<Coordinate **, DeviceType> _reference_points;
+    Kokkos::View<bool *, DeviceType> _point_in_cell;
+    Kokkos::View<int *, DeviceType> _newton_iterations;
+    Kokkos::View<bool *, DeviceType> _newton_converged;
 };
 } // namespace Functor
 } // namespace DataTransferKit
@@ -0,0 +1,115 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_POINT_IN_CELL_NEWTON_HPP
+#define DTK_POINT_IN_CELL_NEWTON_HPP
+
+#include <DTK_PointInCellPreRejection.hpp>
+
+#include <Intrepid2_Types.hpp>
+#include <Kokkos_Macros.hpp>
+#include <Kokkos_View.hpp>
+
+namespace DataTransferKit
+{
+namespace Functor
+{
+/**
+ * Parameters of the Newton solve that inverts the reference map.
+ */
+struct NewtonParameters
+{
+    // The solve has converged when no component of the update is larger than
+    // tolerance in the reference frame.
+    double tolerance;
+    int max_iterations;
+};
+
+/**
+ * Invert the reference map of a cell with Newton's method, starting from the
+ * reference point given in \p ref_point. The result is written in \p
+ * ref_point and the number of iterations in \p n_iterations. Return true if
+ * the solve has converged within the maximum number of iterations.
+ */
+template <typename CellType, typename ExecutionSpace, typename PointView,
+          typename NodesView, typename RefPointView>
+KOKKOS_INLINE_FUNCTION bool
+newtonSolve( NewtonParameters const &parameters, PointView const &phys_point,
+             NodesView const &nodes, RefPointView const &ref_point,
+             int &n_iterations )
+{
+    int constexpr dim = CellType::dim;
+    // The largest supported cells, HEX_27, have 27 nodes.
+    int constexpr max_n_nodes = 27;
+    using Basis = typename CellType::basis_type;
+    using UnmanagedView1D =
+        Kokkos::View<double *, Kokkos::LayoutRight, ExecutionSpace,
+                     Kokkos::MemoryUnmanaged>;
+    using UnmanagedView2D =
+        Kokkos::View<double **, Kokkos::LayoutRight, ExecutionSpace,
+                     Kokkos::MemoryUnmanaged>;
+
+    int const n_nodes = nodes.extent( 0 );
+    double values_buffer[max_n_nodes];
+    double grads_buffer[max_n_nodes * dim];
+    UnmanagedView1D values( values_buffer, n_nodes );
+    UnmanagedView2D grads( grads_buffer, n_nodes, dim );
+
+    for ( n_iterations = 1; n_iterations <= parameters.max_iterations;
+          ++n_iterations )
+    {
+        Basis::template Serial<Intrepid2::OPERATOR_VALUE>::getValues(
+            values, ref_point );
+        Basis::template Serial<Intrepid2::OPERATOR_GRAD>::getValues(
+            grads, ref_point );
+
+        // Residual and Jacobian of the reference map at the current point
+        double residual[dim];
+        double jacobian[dim][dim];
+        for ( int d = 0; d < dim; ++d )
+        {
+            residual[d] = -phys_point( d );
+            for ( int e = 0; e < dim; ++e )
+                jacobian[d][e] = 0.;
+            for ( int n = 0; n < n_nodes; ++n )
+            {
+                residual[d] += values( n ) * nodes( n, d );
+                for ( int e = 0; e < dim; ++e )
+                    jacobian[d][e] += nodes( n, d ) * grads( n, e );
+            }
+        }
+        double inverse_jacobian[dim][dim];
+        if ( !invert( jacobian, inverse_jacobian ) )
+            return false;
+
+        double update_norm = 0.;
+        for ( int d = 0; d < dim; ++d )
+        {
+            double update = 0.;
+            for ( int e = 0; e < dim; ++e )
+                update += inverse_jacobian[d][e] * residual[e];
+            ref_point( d ) -= update;
+            if ( update > update_norm )
+                update_norm = update;
+            else if ( -update > update_norm )
+                update_norm = -update;
+        }
+        if ( update_norm < parameters.tolerance )
+            return true;
+    }
+    n_iterations = parameters.max_iterations;
+
+    return false;
+}
+} // namespace Functor
+} // namespace DataTransferKit
+
+#endif
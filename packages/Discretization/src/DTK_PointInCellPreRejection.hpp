@@ -0,0 +1,374 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_POINT_IN_CELL_PRE_REJECTION_HPP
+#define DTK_POINT_IN_CELL_PRE_REJECTION_HPP
+
+#include <DTK_Topology.hpp>
+
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+namespace Functor
+{
+/**
+ * Coordinates of the vertices of the reference cells, along with the linear
+ * cell type of the same shape. Vertex 0 and the vertices given by frame()
+ * span the reference cell: vertex frame(d) only differs from vertex 0 along
+ * direction d.
+ */
+struct TriangleVertices
+{
+    using cell_type = TRI_3;
+    static int constexpr dim = 2;
+    static int constexpr n_vertices = 3;
+    KOKKOS_INLINE_FUNCTION static double coordinate( int k, int d )
+    {
+        return ( k == d + 1 ) ? 1. : 0.;
+    }
+    KOKKOS_INLINE_FUNCTION static int frame( int d ) { return d + 1; }
+};
+
+struct TetrahedronVertices
+{
+    using cell_type = TET_4;
+    static int constexpr dim = 3;
+    static int constexpr n_vertices = 4;
+    KOKKOS_INLINE_FUNCTION static double coordinate( int k, int d )
+    {
+        return ( k == d + 1 ) ? 1. : 0.;
+    }
+    KOKKOS_INLINE_FUNCTION static int frame( int d ) { return d + 1; }
+};
+
+struct QuadrilateralVertices
+{
+    using cell_type = QUAD_4;
+    static int constexpr dim = 2;
+    static int constexpr n_vertices = 4;
+    KOKKOS_INLINE_FUNCTION static double coordinate( int k, int d )
+    {
+        return ( d == 0 ) ? ( ( k == 1 || k == 2 ) ? 1. : -1. )
+                          : ( ( k >= 2 ) ? 1. : -1. );
+    }
+    KOKKOS_INLINE_FUNCTION static int frame( int d )
+    {
+        return ( d == 0 ) ? 1 : 3;
+    }
+};
+
+struct HexahedronVertices
+{
+    using cell_type = HEX_8;
+    static int constexpr dim = 3;
+    static int constexpr n_vertices = 8;
+    KOKKOS_INLINE_FUNCTION static double coordinate( int k, int d )
+    {
+        return ( d == 2 ) ? ( ( k >= 4 ) ? 1. : -1. )
+                          : QuadrilateralVertices::coordinate( k % 4, d );
+    }
+    KOKKOS_INLINE_FUNCTION static int frame( int d )
+    {
+        return ( d == 2 ) ? 4 : QuadrilateralVertices::frame( d );
+    }
+};
+
+struct WedgeVertices
+{
+    using cell_type = WEDGE_6;
+    static int constexpr dim = 3;
+    static int constexpr n_vertices = 6;
+    KOKKOS_INLINE_FUNCTION static double coordinate( int k, int d )
+    {
+        return ( d == 2 ) ? ( ( k >= 3 ) ? 1. : -1. )
+                          : TriangleVertices::coordinate( k % 3, d );
+    }
+    KOKKOS_INLINE_FUNCTION static int frame( int d ) { return d + 1; }
+};
+
+KOKKOS_INLINE_FUNCTION
+bool invert( double const ( &m )[2][2], double ( &inv )[2][2] )
+{
+    double const det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    if ( det == 0. )
+        return false;
+    inv[0][0] = m[1][1] / det;
+    inv[0][1] = -m[0][1] / det;
+    inv[1][0] = -m[1][0] / det;
+    inv[1][1] = m[0][0] / det;
+    return true;
+}
+
+KOKKOS_INLINE_FUNCTION
+bool invert( double const ( &m )[3][3], double ( &inv )[3][3] )
+{
+    double const det = m[0][0] * ( m[1][1] * m[2][2] - m[1][2] * m[2][1] ) -
+                       m[0][1] * ( m[1][0] * m[2][2] - m[1][2] * m[2][0] ) +
+                       m[0][2] * ( m[1][0] * m[2][1] - m[1][1] * m[2][0] );
+    if ( det == 0. )
+        return false;
+    for ( int i = 0; i < 3; ++i )
+        for ( int j = 0; j < 3; ++j )
+        {
+            // The cofactors are computed with cyclic indices so that no sign
+            // correction is needed.
+            int const i1 = ( j + 1 ) % 3;
+            int const i2 = ( j + 2 ) % 3;
+            int const j1 = ( i + 1 ) % 3;
+            int const j2 = ( i + 2 ) % 3;
+            inv[i][j] =
+                ( m[i1][j1] * m[i2][j2] - m[i1][j2] * m[i2][j1] ) / det;
+        }
+    return true;
+}
+
+/**
+ * Outcome of the test performed before the Newton solve. The reference point
+ * is exact when the point is known to be inside or outside of the cell.
+ */
+enum class PreRejectionResult
+{
+    outside,
+    inside,
+    unknown
+};
+
+/**
+ * Cheap test performed before the Newton solve of the point-in-cell search.
+ * The physical point and the nodes of the cell are mapped to the frame
+ * spanned by the edges of the cell that start at its first vertex. This is
+ * the inverse of the reference map when the cell is affine, i.e. when the
+ * cell only has vertices and they all land on the vertices of the reference
+ * cell, in which case the test is exact and the Newton solve is not needed.
+ * Linear simplices are always affine so the nodes are not even looked at.
+ * Otherwise, the point is rejected if it is outside of the bounding box of
+ * the nodes in that frame, grown by margin in every direction. Since the cell
+ * is usually much better aligned with that frame than with the axes, this is
+ * much tighter than the bounding box of the coarse search. Like the coarse
+ * search, it assumes that the cell does not bulge out of the convex hull of
+ * its nodes by more than margin.
+ */
+template <typename Vertices, bool linear>
+struct PreRejection
+{
+    using vertices = Vertices;
+    static bool constexpr simplex =
+        linear && ( Vertices::n_vertices == Vertices::dim + 1 );
+
+    KOKKOS_INLINE_FUNCTION static constexpr double margin() { return 0.1; }
+
+    /**
+     * Compute the matrix that maps the physical space to the frame of the
+     * cell. Return false if the cell is degenerate.
+     */
+    template <typename NodesView>
+    KOKKOS_INLINE_FUNCTION static bool
+    computeInverseMap( NodesView const &nodes,
+                       double ( &inv )[Vertices::dim][Vertices::dim] )
+    {
+        int constexpr dim = Vertices::dim;
+
+        // The columns of m are the edges of the frame, scaled by their length
+        // in the reference cell.
+        double m[dim][dim];
+        for ( int d = 0; d < dim; ++d )
+        {
+            int const v = Vertices::frame( d );
+            double const length =
+                Vertices::coordinate( v, d ) - Vertices::coordinate( 0, d );
+            for ( int k = 0; k < dim; ++k )
+                m[k][d] = ( nodes( v, k ) - nodes( 0, k ) ) / length;
+        }
+        return invert( m, inv );
+    }
+
+    /**
+     * Return whether the point is inside the cell, outside of it, or if the
+     * Newton solve is needed to tell. The coordinates of the point in the
+     * frame of the cell are written in ref_point, which is the exact
+     * reference point for affine cells and the initial guess of the Newton
+     * solve otherwise.
+     */
+    template <typename PointView, typename NodesView, typename RefPointView>
+    KOKKOS_INLINE_FUNCTION static PreRejectionResult
+    classify( double threshold, PointView const &phys_point,
+              NodesView const &nodes, RefPointView const &ref_point )
+    {
+        int constexpr dim = Vertices::dim;
+
+        double inv[dim][dim];
+        if ( !computeInverseMap( nodes, inv ) )
+        {
+            // Start the Newton solve from the centroid of the vertices
+            for ( int d = 0; d < dim; ++d )
+            {
+                ref_point( d ) = 0.;
+                for ( int k = 0; k < Vertices::n_vertices; ++k )
+                    ref_point( d ) +=
+                        Vertices::coordinate( k, d ) / Vertices::n_vertices;
+            }
+            return PreRejectionResult::unknown;
+        }
+
+        for ( int d = 0; d < dim; ++d )
+        {
+            ref_point( d ) = Vertices::coordinate( 0, d );
+            for ( int k = 0; k < dim; ++k )
+                ref_point( d ) +=
+                    inv[d][k] * ( phys_point( k ) - nodes( 0, k ) );
+        }
+
+        if ( simplex )
+            return inside( threshold, ref_point );
+
+        // Map the nodes to the frame. For linear cells, check whether the
+        // vertices land on the vertices of the reference cell.
+        double min_corner[dim];
+        double max_corner[dim];
+        for ( int d = 0; d < dim; ++d )
+        {
+            min_corner[d] = Vertices::coordinate( 0, d );
+            max_corner[d] = Vertices::coordinate( 0, d );
+        }
+        bool affine = linear;
+        int const n_nodes = nodes.extent( 0 );
+        for ( int i = 1; i < n_nodes; ++i )
+            for ( int d = 0; d < dim; ++d )
+            {
+                double u = Vertices::coordinate( 0, d );
+                for ( int k = 0; k < dim; ++k )
+                    u += inv[d][k] * ( nodes( i, k ) - nodes( 0, k ) );
+                if ( u < min_corner[d] )
+                    min_corner[d] = u;
+                if ( u > max_corner[d] )
+                    max_corner[d] = u;
+                if ( linear && i < Vertices::n_vertices )
+                {
+                    double const error = u - Vertices::coordinate( i, d );
+                    if ( error > 1e-10 || error < -1e-10 )
+                        affine = false;
+                }
+            }
+
+        if ( affine )
+            return inside( threshold, ref_point );
+
+        for ( int d = 0; d < dim; ++d )
+            if ( ref_point( d ) < min_corner[d] - margin() ||
+                 ref_point( d ) > max_corner[d] + margin() )
+                return PreRejectionResult::outside;
+        return PreRejectionResult::unknown;
+    }
+
+  private:
+    template <typename RefPointView>
+    KOKKOS_INLINE_FUNCTION static PreRejectionResult
+    inside( double threshold, RefPointView const &ref_point )
+    {
+        return Vertices::cell_type::topo_type::checkPointInclusion( ref_point,
+                                                                    threshold )
+                   ? PreRejectionResult::inside
+                   : PreRejectionResult::outside;
+    }
+};
+
+/**
+ * Cells without a frame, e.g. pyramids whose apex is not aligned with the
+ * edges of the base, are never rejected. The Newton solve starts from the
+ * origin of the reference cell.
+ */
+struct NoPreRejection
+{
+    template <typename PointView, typename NodesView, typename RefPointView>
+    KOKKOS_INLINE_FUNCTION static PreRejectionResult
+    classify( double, PointView const &, NodesView const &,
+              RefPointView const &ref_point )
+    {
+        int const dim = ref_point.extent( 0 );
+        for ( int d = 0; d < dim; ++d )
+            ref_point( d ) = 0.;
+        return PreRejectionResult::unknown;
+    }
+};
+
+template <typename CellType>
+struct PreRejectionTraits;
+
+template <>
+struct PreRejectionTraits<HEX_8>
+{
+    using type = PreRejection<HexahedronVertices, true>;
+};
+
+template <>
+struct PreRejectionTraits<HEX_27>
+{
+    using type = PreRejection<HexahedronVertices, false>;
+};
+
+template <>
+struct PreRejectionTraits<PYRAMID_5>
+{
+    using type = NoPreRejection;
+};
+
+template <>
+struct PreRejectionTraits<QUAD_4>
+{
+    using type = PreRejection<QuadrilateralVertices, true>;
+};
+
+template <>
+struct PreRejectionTraits<QUAD_9>
+{
+    using type = PreRejection<QuadrilateralVertices, false>;
+};
+
+template <>
+struct PreRejectionTraits<TET_4>
+{
+    using type = PreRejection<TetrahedronVertices, true>;
+};
+
+template <>
+struct PreRejectionTraits<TET_10>
+{
+    using type = PreRejection<TetrahedronVertices, false>;
+};
+
+template <>
+struct PreRejectionTraits<TRI_3>
+{
+    using type = PreRejection<TriangleVertices, true>;
+};
+
+template <>
+struct PreRejectionTraits<TRI_6>
+{
+    using type = PreRejection<TriangleVertices, false>;
+};
+
+template <>
+struct PreRejectionTraits<WEDGE_6>
+{
+    using type = PreRejection<WedgeVertices, true>;
+};
+
+template <>
+struct PreRejectionTraits<WEDGE_18>
+{
+    using type = PreRejection<WedgeVertices, false>;
+};
+} // namespace Functor
+} // namespace DataTransferKit
+
+#endif
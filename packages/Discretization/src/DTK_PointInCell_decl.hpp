@@ -18,6 +18,10 @@
 
 #include <Kokkos_View.hpp>
 
+#include <array>
+#include <limits>
+#include <vector>
+
 namespace DataTransferKit
 {
 template <typename DeviceType>
@@ -33,9 +37,16 @@ class PointInCell
      * coarse search (coarse_output_size)
      *    @param[in] cell_topo Topology of the cells in \p cells
      *    @param[out] reference_points The coordinates of the points in the
-     * reference space (coarse_output_size, dim)
+     * reference space (coarse_output_size, dim). They are only approximate
+     * for points that are rejected without the Newton solve in cells that
+     * are not affine.
      *    @param[out] point_in_cell Booleans with value true if the point is in
      * the cell and false otherwise (coarse_output_size)
+     *    @param[out] newton_iterations Optional number of Newton iterations
+     * for each point, zero if the solve was not needed (coarse_output_size)
+     *    @param[out] newton_converged Optional booleans with value false if
+     * the Newton solve did not converge. The reference point and the result
+     * of the test are then unreliable (coarse_output_size)
      */
     static void
     search( Kokkos::View<Coordinate **, DeviceType> physical_points,
@@ -43,8 +54,120 @@ class PointInCell
             Kokkos::View<int *, DeviceType> coarse_search_output_cells,
             DTK_CellTopology cell_topo,
             Kokkos::View<Coordinate **, DeviceType> reference_points,
+            Kokkos::View<bool *, DeviceType> point_in_cell,
+            Kokkos::View<int *, DeviceType> newton_iterations =
+                Kokkos::View<int *, DeviceType>(),
+            Kokkos::View<bool *, DeviceType> newton_converged =
+                Kokkos::View<bool *, DeviceType>() );
+
+    /**
+     * Performs the local search for candidate cells of different topologies
+     * with a single kernel.
+     *    @param[in] physical_points The coordinates of the points in the
+     * physical space (coarse_output_size, dim)
+     *    @param[in] cells Cells owned by the processor, one block per topology
+     * (n_cells, n_nodes, dim). The blocks of unused topologies may be empty.
+     *    @param[in] coarse_search_output_cells Indices of the cells from the
+     * coarse search in the block of their topology (coarse_output_size)
+     *    @param[in] cell_topologies Topology of the cells from the coarse
+     * search (coarse_output_size)
+     *    @param[out] reference_points The coordinates of the points in the
+     * reference space (coarse_output_size, dim). They are only approximate
+     * for points that are rejected without the Newton solve in cells that
+     * are not affine.
+     *    @param[out] point_in_cell Booleans with value true if the point is in
+     * the cell and false otherwise (coarse_output_size)
+     */
+    static void
+    search( Kokkos::View<Coordinate **, DeviceType> physical_points,
+            std::array<Kokkos::View<Coordinate ***, DeviceType>,
+                       DTK_N_TOPO> const &cells,
+            Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+            Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+            Kokkos::View<Coordinate **, DeviceType> reference_points,
             Kokkos::View<bool *, DeviceType> point_in_cell );
 
+    /**
+     * Same function as above. The inverse maps of the affine simplices,
+     * computed by computeInverseMaps(), are used instead of the nodes of the
+     * cells for the topologies whose block of \p inverse_maps is not empty.
+     * The optional Newton statistics are the same as for the search of cells
+     * of a single topology.
+     */
+    static void
+    search( Kokkos::View<Coordinate **, DeviceType> physical_points,
+            std::array<Kokkos::View<Coordinate ***, DeviceType>,
+                       DTK_N_TOPO> const &cells,
+            std::array<Kokkos::View<Coordinate ***, DeviceType>,
+                       DTK_N_TOPO> const &inverse_maps,
+            Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+            Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+            Kokkos::View<Coordinate **, DeviceType> reference_points,
+            Kokkos::View<bool *, DeviceType> point_in_cell,
+            Kokkos::View<int *, DeviceType> newton_iterations =
+                Kokkos::View<int *, DeviceType>(),
+            Kokkos::View<bool *, DeviceType> newton_converged =
+                Kokkos::View<bool *, DeviceType>() );
+
+    /**
+     * Same function as above for cells whose nodes are not duplicated. The
+     * coordinates of the nodes are gathered on the fly, which saves the
+     * memory of the blocks of cells.
+     *    @param[in] connectivities Indices of the nodes of the cells owned by
+     * the processor in \p coordinates, one block per topology (n_cells,
+     * n_nodes). The blocks of unused topologies may be empty.
+     *    @param[in] coordinates Coordinates of the nodes (n_nodes, dim)
+     */
+    static void
+    search( Kokkos::View<Coordinate **, DeviceType> physical_points,
+            std::array<Kokkos::View<unsigned int **, DeviceType>,
+                       DTK_N_TOPO> const &connectivities,
+            Kokkos::View<Coordinate **, DeviceType> coordinates,
+            std::array<Kokkos::View<Coordinate ***, DeviceType>,
+                       DTK_N_TOPO> const &inverse_maps,
+            Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+            Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+            Kokkos::View<Coordinate **, DeviceType> reference_points,
+            Kokkos::View<bool *, DeviceType> point_in_cell,
+            Kokkos::View<int *, DeviceType> newton_iterations =
+                Kokkos::View<int *, DeviceType>(),
+            Kokkos::View<bool *, DeviceType> newton_converged =
+                Kokkos::View<bool *, DeviceType>() );
+
+    /**
+     * Compute the inverse of the reference map of each cell. This is only
+     * possible for the simplices whose map is affine, i.e. DTK_TRI_3 and
+     * DTK_TET_4. The result can be reused for all the searches in the same
+     * cells.
+     *    @param[in] cells Cells owned by the processor (n_cells, n_nodes, dim)
+     *    @param[in] cell_topo Topology of the cells in \p cells
+     *    @return The inverse maps (n_cells, dim, dim + 1)
+     */
+    static Kokkos::View<Coordinate ***, DeviceType>
+    computeInverseMaps( Kokkos::View<Coordinate ***, DeviceType> cells,
+                        DTK_CellTopology cell_topo );
+
+    /**
+     * Same function as above for cells given by their connectivity
+     * (n_cells, n_nodes) and the coordinates of the nodes (n_nodes, dim).
+     */
+    static Kokkos::View<Coordinate ***, DeviceType>
+    computeInverseMaps( Kokkos::View<unsigned int **, DeviceType> connectivity,
+                        Kokkos::View<Coordinate **, DeviceType> coordinates,
+                        DTK_CellTopology cell_topo );
+
+    /**
+     * Count the points that needed a given number of Newton iterations.
+     *    @param[in] newton_iterations Number of iterations of each point
+     *    @param[in] newton_converged Convergence of the solve of each point
+     *    @return The histogram. Bin k, for k <= newton_max_iterations, is
+     * the number of points that converged in k iterations and the last bin
+     * is the number of points that did not converge.
+     */
+    static std::vector<unsigned int>
+    computeNewtonHistogram( Kokkos::View<int *, DeviceType> newton_iterations,
+                            Kokkos::View<bool *, DeviceType> newton_converged );
+
     /**
      * Same function as above. However, the function is virtual so that the user
      * can provide their own implementation. If the function is not overriden,
@@ -79,6 +202,14 @@ class PointInCell
     }
 
     static double threshold;
+
+    /**
+     * The Newton solve of the non-affine cells stops when no component of the
+     * update of the reference point is larger than newton_tolerance or after
+     * newton_max_iterations iterations.
+     */
+    static double newton_tolerance;
+    static int newton_max_iterations;
 };
 
 // Default value for threshold matches the inclusion tolerance in DTK-2.0 which
@@ -86,6 +217,13 @@ class PointInCell
 // https://github.com/ORNL-CEES/DataTransferKit/blob/dtk-2.0/packages/Adapters/Libmesh/src/DTK_LibmeshEntityLocalMap.cpp#L58
 template <typename DeviceType>
 double PointInCell<DeviceType>::threshold = 1e-6;
+
+// Default values for the Newton solve match the ones used by Intrepid2.
+template <typename DeviceType>
+double PointInCell<DeviceType>::newton_tolerance =
+    100 * std::numeric_limits<double>::epsilon();
+template <typename DeviceType>
+int PointInCell<DeviceType>::newton_max_iterations = 15;
 } // namespace DataTransferKit
 
 #endif
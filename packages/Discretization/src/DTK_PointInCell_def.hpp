@@ -14,6 +14,7 @@
 
 #include <DTK_DBC.hpp>
 #include <DTK_PointInCellFunctor.hpp>
+#include <DTK_Statistics.hpp>
 #include <DTK_Topology.hpp>
 
 namespace DataTransferKit
@@ -23,23 +24,112 @@ namespace DataTransferKit
 namespace internal
 {
 template <typename CellType, typename DeviceType>
-void pointInCell( double threshold,
+void pointInCell( double threshold, Functor::NewtonParameters const &newton,
                   Kokkos::View<Coordinate **, DeviceType> physical_points,
                   Kokkos::View<Coordinate ***, DeviceType> cells,
                   Kokkos::View<int *, DeviceType> coarse_search_output_cells,
                   Kokkos::View<Coordinate **, DeviceType> reference_points,
-                  Kokkos::View<bool *, DeviceType> point_in_cell )
+                  Kokkos::View<bool *, DeviceType> point_in_cell,
+                  Kokkos::View<int *, DeviceType> newton_iterations,
+                  Kokkos::View<bool *, DeviceType> newton_converged )
 {
     using ExecutionSpace = typename DeviceType::execution_space;
     int const n_ref_pts = reference_points.extent( 0 );
 
     Functor::PointInCell<CellType, DeviceType> search_functor(
-        threshold, physical_points, cells, coarse_search_output_cells,
-        reference_points, point_in_cell );
+        threshold, newton, physical_points, cells, coarse_search_output_cells,
+        reference_points, point_in_cell, newton_iterations, newton_converged );
     Kokkos::parallel_for( DTK_MARK_REGION( "point_in_cell" ),
                           Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_pts ),
                           search_functor );
 }
+
+template <typename DeviceType>
+void multiTopologyPointInCell(
+    double threshold, Functor::NewtonParameters const &newton,
+    Kokkos::View<Coordinate **, DeviceType> physical_points,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &cells,
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO> const
+        &connectivities,
+    Kokkos::View<Coordinate **, DeviceType> coordinates,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &inverse_maps,
+    Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<Coordinate **, DeviceType> reference_points,
+    Kokkos::View<bool *, DeviceType> point_in_cell,
+    Kokkos::View<int *, DeviceType> newton_iterations,
+    Kokkos::View<bool *, DeviceType> newton_converged )
+{
+    ScopedTimer timer( "point in cell" );
+
+    // Check the size of the Views
+    DTK_REQUIRE( reference_points.extent( 0 ) == point_in_cell.extent( 0 ) );
+    DTK_REQUIRE( reference_points.extent( 0 ) == physical_points.extent( 0 ) );
+    DTK_REQUIRE( reference_points.extent( 1 ) == physical_points.extent( 1 ) );
+    DTK_REQUIRE( reference_points.extent( 0 ) ==
+                 coarse_search_output_cells.extent( 0 ) );
+    DTK_REQUIRE( reference_points.extent( 0 ) == cell_topologies.extent( 0 ) );
+    DTK_REQUIRE( newton_iterations.extent( 0 ) == 0 ||
+                 newton_iterations.extent( 0 ) == point_in_cell.extent( 0 ) );
+    DTK_REQUIRE( newton_converged.extent( 0 ) == 0 ||
+                 newton_converged.extent( 0 ) == point_in_cell.extent( 0 ) );
+    DTK_REQUIRE( newton.max_iterations > 0 );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_ref_pts = reference_points.extent( 0 );
+
+    Functor::MultiTopologyPointInCell<DeviceType> search_functor(
+        threshold, newton, physical_points, cells, connectivities, coordinates,
+        inverse_maps, coarse_search_output_cells, cell_topologies,
+        reference_points, point_in_cell, newton_iterations, newton_converged );
+    Kokkos::parallel_for( DTK_MARK_REGION( "multi_topology_point_in_cell" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_pts ),
+                          search_functor );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+Kokkos::View<Coordinate ***, DeviceType> computeInverseMaps(
+    Kokkos::View<Coordinate ***, DeviceType> cells,
+    Kokkos::View<unsigned int **, DeviceType> connectivity,
+    Kokkos::View<Coordinate **, DeviceType> coordinates, int const n_cells,
+    int const dim, DTK_CellTopology cell_topo )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<Coordinate ***, DeviceType> inverse_maps(
+        Kokkos::ViewAllocateWithoutInitializing( "inverse_maps" ), n_cells,
+        dim, dim + 1 );
+    switch ( cell_topo )
+    {
+    case DTK_TET_4:
+    {
+        Functor::InverseMap<TET_4, DeviceType> inverse_map_functor(
+            cells, connectivity, coordinates, inverse_maps );
+        Kokkos::parallel_for( DTK_MARK_REGION( "compute_inverse_maps" ),
+                              Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+                              inverse_map_functor );
+        break;
+    }
+    case DTK_TRI_3:
+    {
+        Functor::InverseMap<TRI_3, DeviceType> inverse_map_functor(
+            cells, connectivity, coordinates, inverse_maps );
+        Kokkos::parallel_for( DTK_MARK_REGION( "compute_inverse_maps" ),
+                              Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+                              inverse_map_functor );
+        break;
+    }
+    default:
+    {
+        throw DataTransferKitNotImplementedException();
+    }
+    }
+    Kokkos::fence();
+
+    return inverse_maps;
+}
 } // namespace internal
 
 template <typename DeviceType>
@@ -49,96 +139,115 @@ void PointInCell<DeviceType>::search(
     Kokkos::View<int *, DeviceType> coarse_search_output_cells,
     DTK_CellTopology cell_topo,
     Kokkos::View<Coordinate **, DeviceType> reference_points,
-    Kokkos::View<bool *, DeviceType> point_in_cell )
+    Kokkos::View<bool *, DeviceType> point_in_cell,
+    Kokkos::View<int *, DeviceType> newton_iterations,
+    Kokkos::View<bool *, DeviceType> newton_converged )
 {
+    ScopedTimer timer( "point in cell" );
+
     // Check the size of the Views
     DTK_REQUIRE( reference_points.extent( 0 ) == point_in_cell.extent( 0 ) );
     DTK_REQUIRE( reference_points.extent( 0 ) == physical_points.extent( 0 ) );
     DTK_REQUIRE( reference_points.extent( 1 ) == physical_points.extent( 1 ) );
     DTK_REQUIRE( reference_points.extent( 1 ) == cells.extent( 2 ) );
+    DTK_REQUIRE( newton_iterations.extent( 0 ) == 0 ||
+                 newton_iterations.extent( 0 ) == point_in_cell.extent( 0 ) );
+    DTK_REQUIRE( newton_converged.extent( 0 ) == 0 ||
+                 newton_converged.extent( 0 ) == point_in_cell.extent( 0 ) );
+    DTK_REQUIRE( newton_max_iterations > 0 );
 
     // Perform the point in cell search. We hide the template parameters used by
     // Intrepid2, using the CellType template.
-    // Note that if the Newton solver does not converge, Intrepid2 will just
-    // return the last results and there is no way to know that the coordinates
-    // in the reference frames where not found.
+    Functor::NewtonParameters const newton = {newton_tolerance,
+                                              newton_max_iterations};
     switch ( cell_topo )
     {
     case DTK_HEX_8:
     {
         internal::pointInCell<HEX_8, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_HEX_27:
     {
         internal::pointInCell<HEX_27, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_PYRAMID_5:
     {
         internal::pointInCell<PYRAMID_5, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_QUAD_4:
     {
         internal::pointInCell<QUAD_4, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_QUAD_9:
     {
         internal::pointInCell<QUAD_9, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_TET_4:
     {
         internal::pointInCell<TET_4, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_TET_10:
     {
         internal::pointInCell<TET_10, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_TRI_3:
     {
         internal::pointInCell<TRI_3, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_TRI_6:
     {
         internal::pointInCell<TRI_6, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_WEDGE_6:
     {
         internal::pointInCell<WEDGE_6, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     case DTK_WEDGE_18:
     {
         internal::pointInCell<WEDGE_18, DeviceType>(
-            threshold, physical_points, cells, coarse_search_output_cells,
-            reference_points, point_in_cell );
+            threshold, newton, physical_points, cells,
+            coarse_search_output_cells, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
         break;
     }
     default:
@@ -148,6 +257,135 @@ void PointInCell<DeviceType>::search(
     }
     Kokkos::fence();
 }
+
+template <typename DeviceType>
+void PointInCell<DeviceType>::search(
+    Kokkos::View<Coordinate **, DeviceType> physical_points,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &cells,
+    Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<Coordinate **, DeviceType> reference_points,
+    Kokkos::View<bool *, DeviceType> point_in_cell )
+{
+    search( physical_points, cells,
+            std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO>(),
+            coarse_search_output_cells, cell_topologies, reference_points,
+            point_in_cell );
+}
+
+template <typename DeviceType>
+void PointInCell<DeviceType>::search(
+    Kokkos::View<Coordinate **, DeviceType> physical_points,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &cells,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &inverse_maps,
+    Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<Coordinate **, DeviceType> reference_points,
+    Kokkos::View<bool *, DeviceType> point_in_cell,
+    Kokkos::View<int *, DeviceType> newton_iterations,
+    Kokkos::View<bool *, DeviceType> newton_converged )
+{
+    for ( unsigned int topo = 0; topo < DTK_N_TOPO; ++topo )
+        DTK_REQUIRE( inverse_maps[topo].extent( 0 ) == 0 ||
+                     inverse_maps[topo].extent( 0 ) ==
+                         cells[topo].extent( 0 ) );
+
+    internal::multiTopologyPointInCell(
+        threshold, {newton_tolerance, newton_max_iterations}, physical_points,
+        cells,
+        std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>(),
+        Kokkos::View<Coordinate **, DeviceType>(), inverse_maps,
+        coarse_search_output_cells, cell_topologies, reference_points,
+        point_in_cell, newton_iterations, newton_converged );
+}
+
+template <typename DeviceType>
+void PointInCell<DeviceType>::search(
+    Kokkos::View<Coordinate **, DeviceType> physical_points,
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO> const
+        &connectivities,
+    Kokkos::View<Coordinate **, DeviceType> coordinates,
+    std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO> const
+        &inverse_maps,
+    Kokkos::View<int *, DeviceType> coarse_search_output_cells,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<Coordinate **, DeviceType> reference_points,
+    Kokkos::View<bool *, DeviceType> point_in_cell,
+    Kokkos::View<int *, DeviceType> newton_iterations,
+    Kokkos::View<bool *, DeviceType> newton_converged )
+{
+    DTK_REQUIRE( reference_points.extent( 1 ) == coordinates.extent( 1 ) );
+    for ( unsigned int topo = 0; topo < DTK_N_TOPO; ++topo )
+        DTK_REQUIRE( inverse_maps[topo].extent( 0 ) == 0 ||
+                     inverse_maps[topo].extent( 0 ) ==
+                         connectivities[topo].extent( 0 ) );
+
+    internal::multiTopologyPointInCell(
+        threshold, {newton_tolerance, newton_max_iterations}, physical_points,
+        std::array<Kokkos::View<Coordinate ***, DeviceType>, DTK_N_TOPO>(),
+        connectivities, coordinates, inverse_maps, coarse_search_output_cells,
+        cell_topologies, reference_points, point_in_cell, newton_iterations,
+        newton_converged );
+}
+
+template <typename DeviceType>
+Kokkos::View<Coordinate ***, DeviceType>
+PointInCell<DeviceType>::computeInverseMaps(
+    Kokkos::View<Coordinate ***, DeviceType> cells, DTK_CellTopology cell_topo )
+{
+    return internal::computeInverseMaps(
+        cells, Kokkos::View<unsigned int **, DeviceType>(),
+        Kokkos::View<Coordinate **, DeviceType>(), cells.extent( 0 ),
+        cells.extent( 2 ), cell_topo );
+}
+
+template <typename DeviceType>
+Kokkos::View<Coordinate ***, DeviceType>
+PointInCell<DeviceType>::computeInverseMaps(
+    Kokkos::View<unsigned int **, DeviceType> connectivity,
+    Kokkos::View<Coordinate **, DeviceType> coordinates,
+    DTK_CellTopology cell_topo )
+{
+    return internal::computeInverseMaps(
+        Kokkos::View<Coordinate ***, DeviceType>(), connectivity, coordinates,
+        connectivity.extent( 0 ), coordinates.extent( 1 ), cell_topo );
+}
+
+
+template <typename DeviceType>
+std::vector<unsigned int> PointInCell<DeviceType>::computeNewtonHistogram(
+    Kokkos::View<int *, DeviceType> newton_iterations,
+    Kokkos::View<bool *, DeviceType> newton_converged )
+{
+    DTK_REQUIRE( newton_iterations.extent( 0 ) ==
+                 newton_converged.extent( 0 ) );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_points = newton_iterations.extent( 0 );
+    int const max_iterations = newton_max_iterations;
+    Kokkos::View<unsigned int *, DeviceType> histogram( "newton_histogram",
+                                                        max_iterations + 2 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_newton_histogram" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+        KOKKOS_LAMBDA( int const i ) {
+            int const bin = newton_converged( i )
+                                ? KokkosHelpers::min( newton_iterations( i ),
+                                                      max_iterations )
+                                : max_iterations + 1;
+            Kokkos::atomic_increment( &histogram( bin ) );
+        } );
+    Kokkos::fence();
+
+    auto histogram_host = Kokkos::create_mirror_view( histogram );
+    Kokkos::deep_copy( histogram_host, histogram );
+
+    return std::vector<unsigned int>(
+        histogram_host.data(), histogram_host.data() + histogram_host.size() );
+}
 } // namespace DataTransferKit
 
 // Explicit instantiation macro
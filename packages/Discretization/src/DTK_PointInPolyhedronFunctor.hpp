@@ -0,0 +1,126 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_POINT_IN_POLYHEDRON_FUNCTOR_HPP
+#define DTK_POINT_IN_POLYHEDRON_FUNCTOR_HPP
+
+#include <DTK_Types.h>
+
+#include <Kokkos_Macros.hpp>
+#include <Kokkos_View.hpp>
+
+#include <cmath>
+
+namespace DataTransferKit
+{
+namespace Functor
+{
+/**
+ * Test whether the i-th point is in the i-th candidate polyhedron. The
+ * polyhedra are given in compressed row storage: the faces of cell c are
+ * faces(cell_offset(c)) to faces(cell_offset(c+1)-1), along with their
+ * orientation, and the nodes of face f are nodes(face_offset(f)) to
+ * nodes(face_offset(f+1)-1).
+ *
+ * The point is inside if it is on the inner side of the plane of every face,
+ * up to the threshold relative to the size of the face. The normal of a face
+ * is computed with Newell's method, which is robust to slightly non-planar
+ * faces, and the plane goes through the centroid of its nodes. The test is
+ * exact for convex polyhedra with planar faces.
+ */
+template <typename DeviceType>
+class PointInPolyhedron
+{
+  public:
+    PointInPolyhedron( double threshold,
+                       Kokkos::View<Coordinate **, DeviceType> coordinates,
+                       Kokkos::View<unsigned int *, DeviceType> nodes,
+                       Kokkos::View<unsigned int *, DeviceType> face_offset,
+                       Kokkos::View<unsigned int *, DeviceType> faces,
+                       Kokkos::View<int *, DeviceType> face_orientation,
+                       Kokkos::View<unsigned int *, DeviceType> cell_offset,
+                       Kokkos::View<Coordinate **, DeviceType> physical_points,
+                       Kokkos::View<int *, DeviceType> cell_indices,
+                       Kokkos::View<bool *, DeviceType> point_in_cell )
+        : _threshold( threshold )
+        , _coordinates( coordinates )
+        , _nodes( nodes )
+        , _face_offset( face_offset )
+        , _faces( faces )
+        , _face_orientation( face_orientation )
+        , _cell_offset( cell_offset )
+        , _physical_points( physical_points )
+        , _cell_indices( cell_indices )
+        , _point_in_cell( point_in_cell )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        int const cell = _cell_indices( i );
+        bool inside = true;
+        for ( unsigned int k = _cell_offset( cell );
+              inside && k < _cell_offset( cell + 1 ); ++k )
+        {
+            unsigned int const face = _faces( k );
+            unsigned int const first = _face_offset( face );
+            unsigned int const last = _face_offset( face + 1 );
+            double normal[3] = {0., 0., 0.};
+            double centroid[3] = {0., 0., 0.};
+            for ( unsigned int n = first; n < last; ++n )
+            {
+                unsigned int const a = _nodes( n );
+                unsigned int const b = _nodes( n + 1 < last ? n + 1 : first );
+                for ( int d = 0; d < 3; ++d )
+                {
+                    int const d1 = ( d + 1 ) % 3;
+                    int const d2 = ( d + 2 ) % 3;
+                    normal[d] += ( _coordinates( a, d1 ) -
+                                   _coordinates( b, d1 ) ) *
+                                 ( _coordinates( a, d2 ) +
+                                   _coordinates( b, d2 ) );
+                    centroid[d] += _coordinates( a, d );
+                }
+            }
+            // The norm of the Newell vector is twice the area of the face.
+            double norm = 0.;
+            double distance = 0.;
+            for ( int d = 0; d < 3; ++d )
+            {
+                centroid[d] /= ( last - first );
+                norm += normal[d] * normal[d];
+                distance += normal[d] * ( _physical_points( i, d ) -
+                                          centroid[d] );
+            }
+            norm = std::sqrt( norm );
+            distance *= _face_orientation( k ) / norm;
+            inside = ( distance <= _threshold * std::sqrt( 0.5 * norm ) );
+        }
+        _point_in_cell( i ) = inside;
+    }
+
+  private:
+    double _threshold;
+    Kokkos::View<Coordinate **, DeviceType> _coordinates;
+    Kokkos::View<unsigned int *, DeviceType> _nodes;
+    Kokkos::View<unsigned int *, DeviceType> _face_offset;
+    Kokkos::View<unsigned int *, DeviceType> _faces;
+    Kokkos::View<int *, DeviceType> _face_orientation;
+    Kokkos::View<unsigned int *, DeviceType> _cell_offset;
+    Kokkos::View<Coordinate **, DeviceType> _physical_points;
+    Kokkos::View<int *, DeviceType> _cell_indices;
+    Kokkos::View<bool *, DeviceType> _point_in_cell;
+};
+} // namespace Functor
+} // namespace DataTransferKit
+
+#endif
@@ -15,14 +15,16 @@
 #include "DTK_ConfigDefs.hpp"
 #include <DTK_Box.hpp>
 #include <DTK_CellTypes.h>
+#include <DTK_DetailsDistributor.hpp>
+#include <DTK_DistributedSearchTree.hpp>
 #include <DTK_Point.hpp>
 
 #include <Kokkos_View.hpp>
 #include <Teuchos_Comm.hpp>
 #include <Teuchos_RCP.hpp>
-#include <Tpetra_Distributor.hpp>
 
 #include <tuple>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -35,6 +37,29 @@ template <typename DeviceType>
 class PointSearch
 {
   public:
+    /**
+     * Constructor. Only the mesh is processed: the cells are converted to the
+     * format used by Intrepid2 and the distributed tree of their bounding
+     * boxes is built. The points are looked for by calling search().
+     * @param comm
+     * @param cell_topologies
+     * @param cells vertices associated to each cell
+     * @param cell_nodes_coordinates coordinates of all the nodes in the mesh
+     * @param cache_inverse_maps if true, the inverse of the reference map of
+     * the affine simplices (DTK_TRI_3 and DTK_TET_4) is computed here once
+     * instead of for every candidate of every search.
+     * @param index_nodes if true, the cells are stored as the indices of their
+     * nodes in \p cell_nodes_coordinates, which is kept, instead of a copy of
+     * the coordinates of their nodes. This saves memory when the nodes are
+     * shared by many cells at the cost of an indirection in the search. \p
+     * cell_nodes_coordinates must not be modified while the object is in use.
+     */
+    PointSearch( Teuchos::RCP<const Teuchos::Comm<int>> comm,
+                 Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+                 Kokkos::View<unsigned int *, DeviceType> cells,
+                 Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
+                 bool cache_inverse_maps = false, bool index_nodes = false );
+
     /**
      * Constructor. The search of the points is done in the constructor but
      * the results is not send back to the calling processor.
@@ -53,6 +78,15 @@ class PointSearch
                  Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
                  Kokkos::View<double **, DeviceType> points_coordinates );
 
+    /**
+     * Search for a new set of points in the mesh given to the constructor.
+     * The results of the previous search are discarded. This must be called
+     * as a collective.
+     * @param points_coordinates coordinates in the physical frame of the points
+     * that we are looking for.
+     */
+    void search( Kokkos::View<double **, DeviceType> points_coordinates );
+
     /**
      * Return the result of the search. The tuple contains the rank where the
      * points are found, the cell indices associated to the points (local IDs),
@@ -60,62 +94,26 @@ class PointSearch
      * ids associated to each point.
      */
     // Note that this function cannot be const because
-    // Tpetra::Distributor::doPostsAndWaits is not const
+    // Details::Distributor::doPostsAndWaits is not const
     std::tuple<Kokkos::View<int *, DeviceType>, Kokkos::View<int *, DeviceType>,
                Kokkos::View<Point *, DeviceType>,
                Kokkos::View<unsigned int *, DeviceType>>
     getSearchResults();
 
     /**
-     * Create the cells in the format used by Intrepid2.
-     *
-     * @note This function should be <b>private</b> but lambda functions can
-     * only be called from a public function in CUDA.
+     * Return the histogram of the number of Newton iterations needed by the
+     * candidates of the last search that were processed on this processor.
+     * See PointInCell::computeNewtonHistogram() for the meaning of the bins.
      */
-    void buildBlockCells(
-        unsigned int topo_id,
-        std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> const
-            &block_cells,
-        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-        Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_nodes_per_topo,
-        Kokkos::View<unsigned int *, DeviceType> node_offset,
-        Kokkos::View<unsigned int *, DeviceType> cells,
-        Kokkos::View<unsigned int *, DeviceType> offset,
-        Kokkos::View<double **, DeviceType> coordinates );
-
-    /**
-     * Build the bounding boxes associated to the cell
-     *
-     * @note This function should be <b>private</b> but lambda functions can
-     * only be called from a public function in CUDA.
-     */
-    void buildBoundingBoxes(
-        unsigned int topo_id,
-        std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> const
-            &block_cells,
-        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-        Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_nodes_per_topo,
-        Kokkos::View<unsigned int *, DeviceType> node_offset,
-        Kokkos::View<unsigned int *, DeviceType> cells,
-        Kokkos::View<unsigned int *, DeviceType> offset,
-        Kokkos::View<double **, DeviceType> coordinates,
-        Kokkos::View<Box *, DeviceType> bounding_boxes );
-
-    /**
-     * Build the map between the bounding boxes and the flat array of cells.
-     *
-     * @note This function should be <b>private</b> but lambda functions can
-     * only be called from a public function in CUDA.
-     */
-    void buildBoundingBoxesToBlockCells(
-        unsigned int topo_id,
-        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-        Kokkos::View<unsigned int *, DeviceType> offset,
-        Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell );
+    std::vector<unsigned int> const &getNewtonHistogram() const
+    {
+        return _newton_histogram;
+    }
 
     /**
      * Convert the 1D Kokkos View cells and coordinates to arrays of 3D Kokkos
-     * Views more suitable for Intrepid2.
+     * Views more suitable for Intrepid2, or to arrays of 2D Kokkos Views of
+     * node indices if \p index_nodes is true.
      *
      * @note This function should be <b>private</b> but lambda functions can
      * only be called from a public function in CUDA.
@@ -124,64 +122,43 @@ class PointSearch
         std::array<unsigned int, DTK_N_TOPO> const &n_cells_per_topo,
         Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
         Kokkos::View<unsigned int *, DeviceType> cells,
-        Kokkos::View<double **, DeviceType> coordinates,
+        Kokkos::View<double **, DeviceType> coordinates, bool index_nodes,
         std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO>
             &block_cells,
+        std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+            &block_connectivities,
         Kokkos::View<Box *, DeviceType> bounding_boxes,
         Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell );
 
     /**
-     * Perform the distributed search and sends the points and the cell indices
-     * to the processors owning the cells.
+     * Perform the distributed search. The points and the candidate cell
+     * indices are returned on the processors owning the cells, along with
+     * the query ids and the ranks of the processors that own the points.
      *
      * @note This function should be <b>private</b> but lambda functions can
      * only be called from a public function in CUDA.
      */
     void performDistributedSearch(
         Kokkos::View<double **, DeviceType> points_coord,
-        Kokkos::View<Box *, DeviceType> bounding_boxes,
         Kokkos::View<Point *, DeviceType> &imported_points,
         Kokkos::View<int *, DeviceType> &imported_query_ids,
         Kokkos::View<int *, DeviceType> &imported_cell_indices,
         Kokkos::View<int *, DeviceType> &ranks );
 
-    /**
-     * Keep cell_indices, points, query_ids, and ranks that satisfy a given
-     * topology.
-     *
-     * @note This function should be <b>private</b> but lambda functions can
-     * only be called from a public function in CUDA.
-     */
-    void filterTopology(
-        Kokkos::View<unsigned int *, DeviceType> topo, unsigned int topo_id,
-        Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell,
-        Kokkos::View<int *, DeviceType> cell_indices,
-        Kokkos::View<Point *, DeviceType> points,
-        Kokkos::View<int *, DeviceType> query_ids,
-        Kokkos::View<int *, DeviceType> ranks,
-        Kokkos::View<int *, DeviceType> filtered_cell_indices,
-        Kokkos::View<double **, DeviceType> filtered_points,
-        Kokkos::View<int *, DeviceType> filtered_query_ids,
-        Kokkos::View<int *, DeviceType> filtered_ranks );
-
     /**
      * Keep data corresponding to points found inside the reference cell.
+     * The candidates must be sorted by topology.
      *
      * @note This function should be <b>private</b> but lambda functions can
      * only be called from a public function in CUDA.
      */
-    void filterInCell(
-        std::array<Kokkos::View<bool *, DeviceType>, DTK_N_TOPO> const
-            &filtered_per_topo_point_in_cell,
-        std::array<Kokkos::View<double **, DeviceType>, DTK_N_TOPO> const
-            &filtered_per_topo_reference_points,
-        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
-            &filtered_per_topo_cell_indices,
-        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
-            &filtered_per_topo_query_ids,
-        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const &ranks,
-        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
-            &filtered_ranks );
+    void filterInCell( Kokkos::View<bool *, DeviceType> point_in_cell,
+                       Kokkos::View<double **, DeviceType> reference_points,
+                       Kokkos::View<int *, DeviceType> cell_indices,
+                       Kokkos::View<int *, DeviceType> query_ids,
+                       Kokkos::View<int *, DeviceType> ranks,
+                       Kokkos::View<unsigned int *, DeviceType> topo,
+                       Kokkos::View<int *, DeviceType> &filtered_ranks );
 
   private:
     /**
@@ -190,42 +167,35 @@ class PointSearch
     std::array<unsigned int, DTK_N_TOPO> computeNCellsPerTopology(
         Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies );
 
-    /**
-     * Compute the position in the reference frame of candidates found by the
-     * search.
-     */
-    void performPointInCell(
-        Kokkos::View<double ***, DeviceType> cells,
-        Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell,
-        Kokkos::View<int *, DeviceType> imported_cell_indices,
-        Kokkos::View<Point *, DeviceType> imported_points,
-        Kokkos::View<int *, DeviceType> imported_query_ids,
-        Kokkos::View<int *, DeviceType> imported_ranks,
-        Kokkos::View<unsigned int *, DeviceType> topo, unsigned int topo_id,
-        Kokkos::View<double **, DeviceType> filtered_points,
-        Kokkos::View<int *, DeviceType> filtered_cell_indices,
-        Kokkos::View<int *, DeviceType> filtered_query_ids,
-        Kokkos::View<double **, DeviceType> reference_points,
-        Kokkos::View<bool *, DeviceType> point_in_cell,
-        Kokkos::View<int *, DeviceType> ranks );
-
     /**
      * Build the target-to-source distributor.
      */
-    void build_distributor( std::array<Kokkos::View<int *, DeviceType>,
-                                       DTK_N_TOPO> const &filtered_ranks );
+    void build_distributor( Kokkos::View<int *, DeviceType> filtered_ranks );
 
     template <typename T>
     friend class Interpolation;
 
+    template <typename T>
+    friend class MeshWalk;
+
     Teuchos::RCP<const Teuchos::Comm<int>> _comm;
-    Tpetra::Distributor _target_to_source_distributor;
+    Details::Distributor _target_to_source_distributor;
     unsigned int _dim;
+    bool _index_nodes;
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> _block_cells;
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+        _block_connectivities;
+    Kokkos::View<double **, DeviceType> _coordinates;
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> _inverse_maps;
+    Kokkos::View<unsigned int **, DeviceType> _bounding_box_to_cell;
+    Teuchos::RCP<DistributedSearchTree<DeviceType>> _distributed_tree;
     std::array<Kokkos::View<Coordinate **, DeviceType>, DTK_N_TOPO>
         _reference_points;
     std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> _query_ids;
     std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> _cell_indices;
-    std::array<std::vector<unsigned int>, DTK_N_TOPO> _cell_indices_map;
+    std::array<Kokkos::View<unsigned int *, DeviceType>, DTK_N_TOPO>
+        _cell_indices_map;
+    std::vector<unsigned int> _newton_histogram;
 };
 } // namespace DataTransferKit
 
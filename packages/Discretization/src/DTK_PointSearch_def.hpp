@@ -14,9 +14,10 @@
 
 #include <DTK_DBC.hpp>
 #include <DTK_DetailsTeuchosSerializationTraits.hpp>
+#include <DTK_DetailsRadixSort.hpp>
 #include <DTK_DetailsUtils.hpp>
-#include <DTK_DistributedSearchTree.hpp>
 #include <DTK_PointInCell.hpp>
+#include <DTK_Statistics.hpp>
 #include <DTK_Topology.hpp>
 
 namespace DataTransferKit
@@ -44,36 +45,45 @@ buildBlockCells( unsigned int const dim, int const i,
     }
 }
 
+template <typename DeviceType>
+KOKKOS_FUNCTION void buildBlockConnectivities(
+    int const i, unsigned int const n_nodes, unsigned int const node_offset,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<unsigned int *, DeviceType> offset,
+    Kokkos::View<unsigned int **, DeviceType> block_connectivities )
+{
+    unsigned int const k = offset( i );
+    for ( unsigned int node = 0; node < n_nodes; ++node )
+        block_connectivities( k, node ) = cells( node_offset + node );
+}
+
 template <typename DeviceType>
 KOKKOS_FUNCTION void
 buildBoundingBoxes( unsigned int const dim, int const i,
                     unsigned int const n_nodes, unsigned int const node_offset,
                     Kokkos::View<unsigned int *, DeviceType> cells,
-                    unsigned int const offset,
                     Kokkos::View<double **, DeviceType> coordinates,
-                    Kokkos::View<double ***, DeviceType> block_cells,
                     Kokkos::View<Box *, DeviceType> bounding_boxes )
 {
     Box bounding_box;
-    // If dim == 2, we need to set bounding_box.minCorner()[2] and
-    // bounding_box.maxCorner[2].
+    // If dim == 2, the boxes lie in the plane z = 0 of the points. The scene
+    // is then flat and the tree is built with 2D Morton codes.
     if ( dim == 2 )
     {
         bounding_box.minCorner()[2] = 0;
-        bounding_box.maxCorner()[2] = 1;
+        bounding_box.maxCorner()[2] = 0;
     }
     for ( unsigned int node = 0; node < n_nodes; ++node )
     {
         unsigned int const n = node_offset + node;
         for ( unsigned int d = 0; d < dim; ++d )
         {
-            // Copy the coordinated in block_cells
-            block_cells( offset, node, d ) = coordinates( cells( n ), d );
             // Build the bounding box.
-            if ( block_cells( offset, node, d ) < bounding_box.minCorner()[d] )
-                bounding_box.minCorner()[d] = block_cells( offset, node, d );
-            if ( block_cells( offset, node, d ) > bounding_box.maxCorner()[d] )
-                bounding_box.maxCorner()[d] = block_cells( offset, node, d );
+            double const x = coordinates( cells( n ), d );
+            if ( x < bounding_box.minCorner()[d] )
+                bounding_box.minCorner()[d] = x;
+            if ( x > bounding_box.maxCorner()[d] )
+                bounding_box.maxCorner()[d] = x;
         }
     }
     bounding_boxes( i ) = bounding_box;
@@ -215,6 +225,224 @@ void computeNodeOffset(
     // Check that we didn't overflow node_offset
     checkOffsetOverflow( node_offset );
 }
+
+/**
+ * Compute the position of each cell in the block of the cells that have the
+ * same topology, i.e. the position of the cell among the cells of its
+ * topology. A single stable sort of the topologies replaces one mask and one
+ * prefix sum per topology.
+ */
+template <typename DeviceType>
+void computeTopologyOffset(
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    std::array<unsigned int, DTK_N_TOPO> const &n_cells_per_topo,
+    Kokkos::View<unsigned int *, DeviceType> offset )
+{
+    DTK_REQUIRE( cell_topologies.extent( 0 ) == offset.extent( 0 ) );
+
+    unsigned int const n_cells = cell_topologies.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<unsigned int *, DeviceType> topo(
+        Kokkos::ViewAllocateWithoutInitializing( "topo" ), n_cells );
+    Kokkos::parallel_for( DTK_MARK_REGION( "copy_cell_topologies" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              topo( i ) = cell_topologies( i );
+                          } );
+    Kokkos::fence();
+
+    // The sort is stable so the cells of a given topology keep their order.
+    auto const permute = Details::RadixSort<DeviceType>::sort( topo );
+
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> topo_begin(
+        "topo_begin" );
+    auto topo_begin_host = Kokkos::create_mirror_view( topo_begin );
+    unsigned int begin = 0;
+    for ( int i = 0; i < DTK_N_TOPO; ++i )
+    {
+        topo_begin_host( i ) = begin;
+        begin += n_cells_per_topo[i];
+    }
+    DTK_REQUIRE( begin == n_cells );
+    Kokkos::deep_copy( topo_begin, topo_begin_host );
+
+    Kokkos::parallel_for( DTK_MARK_REGION( "compute_topology_offset" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              offset( permute( i ) ) =
+                                  i - topo_begin( topo( i ) );
+                          } );
+    Kokkos::fence();
+}
+
+/**
+ * Build the block of cells, or the block of connectivities, and the bounding
+ * box of every cell together with the map between the bounding boxes and the
+ * blocks. All the topologies are handled by the same kernel.
+ */
+template <typename DeviceType>
+class ConvertMesh
+{
+  public:
+    ConvertMesh(
+        unsigned int dim, bool index_nodes,
+        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+        Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_nodes_per_topo,
+        Kokkos::View<unsigned int *, DeviceType> node_offset,
+        Kokkos::View<unsigned int *, DeviceType> cells,
+        Kokkos::View<unsigned int *, DeviceType> offset,
+        Kokkos::View<double **, DeviceType> coordinates,
+        std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> const
+            &block_cells,
+        std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO> const
+            &block_connectivities,
+        Kokkos::View<Box *, DeviceType> bounding_boxes,
+        Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell )
+        : _dim( dim )
+        , _index_nodes( index_nodes )
+        , _cell_topologies( cell_topologies )
+        , _n_nodes_per_topo( n_nodes_per_topo )
+        , _node_offset( node_offset )
+        , _cells( cells )
+        , _offset( offset )
+        , _coordinates( coordinates )
+        , _block_cells( block_cells )
+        , _block_connectivities( block_connectivities )
+        , _bounding_boxes( bounding_boxes )
+        , _bounding_box_to_cell( bounding_box_to_cell )
+    {
+        DTK_REQUIRE( offset.extent( 0 ) == cell_topologies.extent( 0 ) );
+        DTK_REQUIRE( node_offset.extent( 0 ) == cell_topologies.extent( 0 ) );
+        DTK_REQUIRE( bounding_boxes.extent( 0 ) ==
+                     cell_topologies.extent( 0 ) );
+        DTK_REQUIRE( bounding_box_to_cell.extent( 0 ) ==
+                     cell_topologies.extent( 0 ) );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        unsigned int const topo_id = _cell_topologies( i );
+        unsigned int const n_nodes = _n_nodes_per_topo( topo_id );
+        if ( _index_nodes )
+            buildBlockConnectivities( i, n_nodes, _node_offset( i ), _cells,
+                                      _offset, _block_connectivities[topo_id] );
+        else
+            buildBlockCells( _dim, i, n_nodes, _node_offset( i ), _cells,
+                             _offset, _coordinates, _block_cells[topo_id] );
+        buildBoundingBoxes( _dim, i, n_nodes, _node_offset( i ), _cells,
+                            _coordinates, _bounding_boxes );
+        _bounding_box_to_cell( i, topo_id ) = _offset( i );
+    }
+
+  private:
+    unsigned int _dim;
+    bool _index_nodes;
+    Kokkos::View<DTK_CellTopology *, DeviceType> _cell_topologies;
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> _n_nodes_per_topo;
+    Kokkos::View<unsigned int *, DeviceType> _node_offset;
+    Kokkos::View<unsigned int *, DeviceType> _cells;
+    Kokkos::View<unsigned int *, DeviceType> _offset;
+    Kokkos::View<double **, DeviceType> _coordinates;
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> _block_cells;
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+        _block_connectivities;
+    Kokkos::View<Box *, DeviceType> _bounding_boxes;
+    Kokkos::View<unsigned int **, DeviceType> _bounding_box_to_cell;
+};
+
+template <typename DeviceType>
+void buildCellIndicesMap(
+    unsigned int topo_id,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell,
+    Kokkos::View<unsigned int *, DeviceType> cell_indices_map )
+{
+    DTK_REQUIRE( bounding_box_to_cell.extent( 0 ) ==
+                 cell_topologies.extent( 0 ) );
+
+    unsigned int const n_cells = cell_topologies.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "build_cell_indices_map_" +
+                         std::to_string( topo_id ) ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( cell_topologies( i ) == topo_id )
+                cell_indices_map( bounding_box_to_cell( i, topo_id ) ) = i;
+        } );
+    Kokkos::fence();
+}
+
+/**
+ * Result of the local search sent back to the process that owns the point.
+ * The rank of the process that owns the cell is given by the communication
+ * plan.
+ */
+struct SearchResultPacket
+{
+    Point ref_pt;
+    int cell_index;
+    unsigned int query_id;
+};
+
+/**
+ * Concatenate the results of the local search, which are stored by topology,
+ * into the packets that are sent back. Packet i belongs to the topology
+ * topo_id such that topo_offset[topo_id] <= i < topo_offset[topo_id+1].
+ */
+template <typename DeviceType>
+class FlattenSearchResults
+{
+  public:
+    FlattenSearchResults(
+        unsigned int dim,
+        Kokkos::View<unsigned int[DTK_N_TOPO + 1], DeviceType> topo_offset,
+        std::array<Kokkos::View<Coordinate **, DeviceType>, DTK_N_TOPO> const
+            &reference_points,
+        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
+            &query_ids,
+        std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
+            &cell_indices,
+        std::array<Kokkos::View<unsigned int *, DeviceType>, DTK_N_TOPO> const
+            &cell_indices_map,
+        Kokkos::View<SearchResultPacket *, DeviceType> packets )
+        : _dim( dim )
+        , _topo_offset( topo_offset )
+        , _reference_points( reference_points )
+        , _query_ids( query_ids )
+        , _cell_indices( cell_indices )
+        , _cell_indices_map( cell_indices_map )
+        , _packets( packets )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        unsigned int topo_id = 0;
+        while ( static_cast<unsigned int>( i ) >= _topo_offset( topo_id + 1 ) )
+            ++topo_id;
+        unsigned int const k = i - _topo_offset( topo_id );
+
+        for ( unsigned int d = 0; d < _dim; ++d )
+            _packets( i ).ref_pt[d] = _reference_points[topo_id]( k, d );
+        _packets( i ).cell_index =
+            _cell_indices_map[topo_id]( _cell_indices[topo_id]( k ) );
+        _packets( i ).query_id = _query_ids[topo_id]( k );
+    }
+
+  private:
+    unsigned int _dim;
+    Kokkos::View<unsigned int[DTK_N_TOPO + 1], DeviceType> _topo_offset;
+    std::array<Kokkos::View<Coordinate **, DeviceType>, DTK_N_TOPO>
+        _reference_points;
+    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> _query_ids;
+    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> _cell_indices;
+    std::array<Kokkos::View<unsigned int *, DeviceType>, DTK_N_TOPO>
+        _cell_indices_map;
+    Kokkos::View<SearchResultPacket *, DeviceType> _packets;
+};
 } // namespace internal
 
 template <typename DeviceType>
@@ -223,32 +451,95 @@ PointSearch<DeviceType>::PointSearch(
     Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
     Kokkos::View<unsigned int *, DeviceType> cells,
     Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
-    Kokkos::View<double **, DeviceType> points_coordinates )
+    bool cache_inverse_maps, bool index_nodes )
     : _comm( comm )
     , _target_to_source_distributor( _comm )
+    , _index_nodes( index_nodes )
 {
-    DTK_REQUIRE( points_coordinates.extent( 1 ) ==
-                 cell_nodes_coordinates.extent( 1 ) );
+    ScopedTimer timer( "mesh setup" );
 
-    // Initialize bounding_box_to_cell to an invalid state
-    Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell(
+    // Initialize _bounding_box_to_cell to an invalid state
+    _bounding_box_to_cell = Kokkos::View<unsigned int **, DeviceType>(
         "bounding_box_to_cell", cell_topologies.extent( 0 ), DTK_N_TOPO );
-    Kokkos::deep_copy( bounding_box_to_cell, static_cast<unsigned int>( -1 ) );
+    Kokkos::deep_copy( _bounding_box_to_cell, static_cast<unsigned int>( -1 ) );
 
     // Compute the number of cells of each of the supported topologies.
     std::array<unsigned int, DTK_N_TOPO> n_cells_per_topo =
         computeNCellsPerTopology( cell_topologies );
 
-    // Convert the cells and cell_nodes_coordinates View to block_cells
-    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> block_cells;
+    // Convert the cells and cell_nodes_coordinates View to block_cells, or
+    // to block connectivities if the nodes are not duplicated
     Kokkos::View<Box *, DeviceType> bounding_boxes(
         "bounding_boxes", cell_topologies.extent( 0 ) );
     convertMesh( n_cells_per_topo, cell_topologies, cells,
-                 cell_nodes_coordinates, block_cells, bounding_boxes,
-                 bounding_box_to_cell );
+                 cell_nodes_coordinates, _index_nodes, _block_cells,
+                 _block_connectivities, bounding_boxes, _bounding_box_to_cell );
+    if ( _index_nodes )
+        _coordinates = cell_nodes_coordinates;
+
+    // The inverse maps of the affine simplices only depend on the mesh so
+    // they can be computed once for all the searches.
+    if ( cache_inverse_maps )
+        for ( DTK_CellTopology topo : {DTK_TET_4, DTK_TRI_3} )
+            if ( n_cells_per_topo[topo] > 0 )
+                _inverse_maps[topo] =
+                    _index_nodes
+                        ? PointInCell<DeviceType>::computeInverseMaps(
+                              _block_connectivities[topo], _coordinates, topo )
+                        : PointInCell<DeviceType>::computeInverseMaps(
+                              _block_cells[topo], topo );
+
+    // The tree only depends on the mesh so it is shared by all the searches
+    _distributed_tree = Teuchos::rcp(
+        new DistributedSearchTree<DeviceType>( _comm, bounding_boxes ) );
+
+    // The cells of Cartesian meshes are located from the edges of the grid
+    // rather than by traversing the local tree.
+    if ( n_cells_per_topo[DTK_HEX_8] == cell_topologies.extent( 0 ) )
+    {
+        auto const grid =
+            StructuredGrid<DeviceType>::fromBoxes( bounding_boxes );
+        if ( !grid.empty() )
+            _distributed_tree->setStructuredGrid( grid );
+    }
+
+    // Build a map between the cell_indices sorted by topology and the flat View
+    // given to the constructor
+    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
+    {
+        _cell_indices_map[topo_id] = Kokkos::View<unsigned int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing(
+                "cell_indices_map_" + std::to_string( topo_id ) ),
+            n_cells_per_topo[topo_id] );
+        if ( n_cells_per_topo[topo_id] > 0 )
+            internal::buildCellIndicesMap( topo_id, cell_topologies,
+                                           _bounding_box_to_cell,
+                                           _cell_indices_map[topo_id] );
+    }
+}
+
+template <typename DeviceType>
+PointSearch<DeviceType>::PointSearch(
+    Teuchos::RCP<const Teuchos::Comm<int>> comm,
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<double **, DeviceType> cell_nodes_coordinates,
+    Kokkos::View<double **, DeviceType> points_coordinates )
+    : PointSearch( comm, cell_topologies, cells, cell_nodes_coordinates )
+{
+    DTK_REQUIRE( points_coordinates.extent( 1 ) ==
+                 cell_nodes_coordinates.extent( 1 ) );
+
+    search( points_coordinates );
+}
+
+template <typename DeviceType>
+void PointSearch<DeviceType>::search(
+    Kokkos::View<double **, DeviceType> points_coordinates )
+{
+    ScopedTimer timer( "point search" );
 
     // Perform the distributed search
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> per_topo_ranks;
     Kokkos::View<Point *, DeviceType> imported_points( "imported_points", 0 );
     Kokkos::View<int *, DeviceType> imported_query_ids( "imported_query_ids",
                                                         0 );
@@ -265,93 +556,93 @@ PointSearch<DeviceType>::PointSearch(
         internal::convertPointDim<DeviceType>( points_coordinates,
                                                points_coord_3d );
 
-        performDistributedSearch( points_coord_3d, bounding_boxes,
-                                  imported_points, imported_query_ids,
-                                  imported_cell_indices, ranks );
+        performDistributedSearch( points_coord_3d, imported_points,
+                                  imported_query_ids, imported_cell_indices,
+                                  ranks );
     }
     else
     {
-        performDistributedSearch( points_coordinates, bounding_boxes,
-                                  imported_points, imported_query_ids,
-                                  imported_cell_indices, ranks );
+        performDistributedSearch( points_coordinates, imported_points,
+                                  imported_query_ids, imported_cell_indices,
+                                  ranks );
     }
 
-    // We need to separate the data for the different topologies because of
-    // Intrepid2. Because a point can be found in multiple cells, we need to
-    // compute the number of cells of each topology.
+    // Because a point can be found in cells of different topologies, we
+    // compute the topology of each candidate and sort the candidates by
+    // topology. The candidates of a given topology are then contiguous and
+    // they are all processed by a single point-in-cell kernel.
     unsigned int const n_imports = imported_points.extent( 0 );
     Kokkos::View<unsigned int *, DeviceType> topo( "topo", n_imports );
     Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> topo_size( "topo_size" );
-    internal::buildTopo( imported_cell_indices, bounding_box_to_cell, topo,
+    internal::buildTopo( imported_cell_indices, _bounding_box_to_cell, topo,
                          topo_size );
-    auto topo_size_host = Kokkos::create_mirror_view( topo_size );
-    Kokkos::deep_copy( topo_size_host, topo_size );
-
-    // Now that we know the size, allocate all the Views.
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
-        filtered_per_topo_cell_indices;
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
-        filtered_per_topo_query_ids;
-    std::array<Kokkos::View<double **, DeviceType>, DTK_N_TOPO>
-        filtered_per_topo_reference_points;
-    std::array<Kokkos::View<bool *, DeviceType>, DTK_N_TOPO>
-        filtered_per_topo_point_in_cell;
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
-        filtered_per_topo_ranks;
-    for ( unsigned int i = 0; i < DTK_N_TOPO; ++i )
-    {
-        filtered_per_topo_cell_indices[i] = Kokkos::View<int *, DeviceType>(
-            "filtered_per_topo_cell_indices_" + std::to_string( i ),
-            topo_size_host( i ) );
-        filtered_per_topo_query_ids[i] = Kokkos::View<int *, DeviceType>(
-            "filtered_per_topo_query_ids_" + std::to_string( i ),
-            topo_size_host( i ) );
-        filtered_per_topo_reference_points[i] =
-            Kokkos::View<double **, DeviceType>(
-                "filtered_per_topo_reference_points_" + std::to_string( i ),
-                topo_size_host( i ), _dim );
-        filtered_per_topo_point_in_cell[i] = Kokkos::View<bool *, DeviceType>(
-            "filtered_per_topo_point_in_cell_" + std::to_string( i ),
-            topo_size_host( i ) );
-        filtered_per_topo_ranks[i] = Kokkos::View<int *, DeviceType>(
-            "filtered_per_topo_ranks_" + std::to_string( i ),
-            topo_size_host( i ) );
-    }
+    auto const permute = Details::RadixSort<DeviceType>::sort( topo );
+
+    // Gather the candidates in the sorted order. Also transform 3D points
+    // back to 2D points.
+    Kokkos::View<double **, DeviceType> points(
+        Kokkos::ViewAllocateWithoutInitializing( "points" ), n_imports, _dim );
+    Kokkos::View<int *, DeviceType> cell_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "cell_indices" ), n_imports );
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies(
+        Kokkos::ViewAllocateWithoutInitializing( "cell_topologies" ),
+        n_imports );
+    Kokkos::View<int *, DeviceType> query_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "query_ids" ), n_imports );
+    Kokkos::View<int *, DeviceType> sorted_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "ranks" ), n_imports );
+    // We cannot use private member in a lambda function with CUDA
+    auto bounding_box_to_cell = _bounding_box_to_cell;
+    unsigned int dim = _dim;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "sort_candidates_by_topology" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+        KOKKOS_LAMBDA( int const i ) {
+            int const j = permute( i );
+            unsigned int const topo_id = topo( i );
+            cell_indices( i ) =
+                bounding_box_to_cell( imported_cell_indices( j ), topo_id );
+            cell_topologies( i ) = static_cast<DTK_CellTopology>( topo_id );
+            for ( unsigned int d = 0; d < dim; ++d )
+                points( i, d ) = imported_points( j )[d];
+            query_ids( i ) = imported_query_ids( j );
+            sorted_ranks( i ) = ranks( j );
+        } );
+    Kokkos::fence();
 
     // Check if the points are in the cells
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-        if ( block_cells[topo_id].extent( 0 ) != 0 )
-        {
-            Kokkos::View<double **, DeviceType> filtered_points(
-                "filtered_points", topo_size_host( topo_id ), _dim );
-            performPointInCell( block_cells[topo_id], bounding_box_to_cell,
-                                imported_cell_indices, imported_points,
-                                imported_query_ids, ranks, topo, topo_id,
-                                filtered_points,
-                                filtered_per_topo_cell_indices[topo_id],
-                                filtered_per_topo_query_ids[topo_id],
-                                filtered_per_topo_reference_points[topo_id],
-                                filtered_per_topo_point_in_cell[topo_id],
-                                filtered_per_topo_ranks[topo_id] );
-        }
+    Kokkos::View<double **, DeviceType> reference_points(
+        Kokkos::ViewAllocateWithoutInitializing( "reference_points" ),
+        n_imports, _dim );
+    Kokkos::View<bool *, DeviceType> point_in_cell(
+        Kokkos::ViewAllocateWithoutInitializing( "point_in_cell" ), n_imports );
+    Kokkos::View<int *, DeviceType> newton_iterations(
+        Kokkos::ViewAllocateWithoutInitializing( "newton_iterations" ),
+        n_imports );
+    Kokkos::View<bool *, DeviceType> newton_converged(
+        Kokkos::ViewAllocateWithoutInitializing( "newton_converged" ),
+        n_imports );
+    if ( _index_nodes )
+        PointInCell<DeviceType>::search(
+            points, _block_connectivities, _coordinates, _inverse_maps,
+            cell_indices, cell_topologies, reference_points, point_in_cell,
+            newton_iterations, newton_converged );
+    else
+        PointInCell<DeviceType>::search(
+            points, _block_cells, _inverse_maps, cell_indices, cell_topologies,
+            reference_points, point_in_cell, newton_iterations,
+            newton_converged );
+    _newton_histogram = PointInCell<DeviceType>::computeNewtonHistogram(
+        newton_iterations, newton_converged );
 
     // Filter the points. Only keep the points that are in cell
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> filtered_ranks;
-    filterInCell( filtered_per_topo_point_in_cell,
-                  filtered_per_topo_reference_points,
-                  filtered_per_topo_cell_indices, filtered_per_topo_query_ids,
-                  filtered_per_topo_ranks, filtered_ranks );
+    Kokkos::View<int *, DeviceType> filtered_ranks( "filtered_ranks" );
+    filterInCell( point_in_cell, reference_points, cell_indices, query_ids,
+                  sorted_ranks, topo, filtered_ranks );
 
     // Build the _source_to_target_distributor
     build_distributor( filtered_ranks );
-
-    // Build a map between the cell_indices sorted by topology and the flat View
-    // given to the constructor
-    auto cell_topologies_host = Kokkos::create_mirror_view( cell_topologies );
-    Kokkos::deep_copy( cell_topologies_host, cell_topologies );
-    unsigned int const size = cell_topologies_host.extent( 0 );
-    for ( unsigned int i = 0; i < size; ++i )
-        _cell_indices_map[cell_topologies_host( i )].push_back( i );
 }
 
 template <typename DeviceType>
@@ -360,81 +651,59 @@ std::tuple<Kokkos::View<int *, DeviceType>, Kokkos::View<int *, DeviceType>,
            Kokkos::View<unsigned int *, DeviceType>>
 PointSearch<DeviceType>::getSearchResults()
 {
-    // Flatten the results
+    // Flatten the results. The results of each topology are contiguous in
+    // the packets and their offsets tell a kernel thread which topology it
+    // is working on.
     using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int n_ref_pts = 0;
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-        n_ref_pts += _reference_points[topo_id].extent( 0 );
-
-    Kokkos::View<int *, DeviceType> ranks( "ranks", n_ref_pts );
-    Kokkos::deep_copy( ranks, _comm->getRank() );
-    Kokkos::View<int *, DeviceType> cell_indices( "cell_indices", n_ref_pts );
-    auto cell_indices_host = Kokkos::create_mirror_view( cell_indices );
-    Kokkos::View<unsigned int *, DeviceType> query_ids( "query_ids",
-                                                        n_ref_pts );
-    Kokkos::View<Point *, DeviceType> ref_pts( "ref_pts", n_ref_pts );
-    unsigned int n_copied_pts = 0;
+    Kokkos::View<unsigned int[DTK_N_TOPO + 1], DeviceType> topo_offset(
+        "topo_offset" );
+    auto topo_offset_host = Kokkos::create_mirror_view( topo_offset );
+    topo_offset_host( 0 ) = 0;
     for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-    {
-        unsigned int const size = _query_ids[topo_id].extent( 0 );
-
-        // First fill cell_indices. This has to be done on the host because
-        // _cell_indices_map only exists on the host.
-        auto topo_cell_indices_host =
-            Kokkos::create_mirror_view( _cell_indices[topo_id] );
-        Kokkos::deep_copy( topo_cell_indices_host, _cell_indices[topo_id] );
-        for ( unsigned int i = 0; i < size; ++i )
-        {
-            cell_indices_host( i + n_copied_pts ) =
-                _cell_indices_map[topo_id][topo_cell_indices_host( i )];
-        }
+        topo_offset_host( topo_id + 1 ) =
+            topo_offset_host( topo_id ) + _query_ids[topo_id].extent( 0 );
+    Kokkos::deep_copy( topo_offset, topo_offset_host );
+    unsigned int const n_ref_pts = topo_offset_host( DTK_N_TOPO );
 
-        // Fill query_ids
-        auto topo_query_ids = _query_ids[topo_id];
-        Kokkos::parallel_for( DTK_MARK_REGION( "query_ids" ),
-                              Kokkos::RangePolicy<ExecutionSpace>( 0, size ),
-                              KOKKOS_LAMBDA( int const i ) {
-                                  query_ids( i + n_copied_pts ) =
-                                      topo_query_ids( i );
-                              } );
-        Kokkos::fence();
-
-        // Fill ref_pts
-        unsigned int dim = _dim;
-        auto topo_ref_pts = _reference_points[topo_id];
-        Kokkos::parallel_for( DTK_MARK_REGION( "fill_ref_pts" ),
-                              Kokkos::RangePolicy<ExecutionSpace>( 0, size ),
-                              KOKKOS_LAMBDA( int const i ) {
-                                  for ( unsigned int d = 0; d < dim; ++d )
-                                      ref_pts( i + n_copied_pts )[d] =
-                                          topo_ref_pts( i, d );
-                              } );
-        Kokkos::fence();
-
-        n_copied_pts += size;
-    }
-    Kokkos::deep_copy( cell_indices, cell_indices_host );
+    Kokkos::View<internal::SearchResultPacket *, DeviceType> exports(
+        Kokkos::ViewAllocateWithoutInitializing( "exports" ), n_ref_pts );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "flatten_search_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_pts ),
+        internal::FlattenSearchResults<DeviceType>(
+            _dim, topo_offset, _reference_points, _query_ids, _cell_indices,
+            _cell_indices_map, exports ) );
+    Kokkos::fence();
 
-    // Communicate the results
+    // Communicate the results. The ranks of the processes that own the cells
+    // are given by the communication plan.
     unsigned int n_imports =
         _target_to_source_distributor.getTotalReceiveLength();
-    Kokkos::View<int *, DeviceType> imported_ranks( "imported_ranks",
-                                                    n_imports );
+    Kokkos::View<internal::SearchResultPacket *, DeviceType> imports(
+        Kokkos::ViewAllocateWithoutInitializing( "imports" ), n_imports );
+    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
+        _target_to_source_distributor, exports, imports );
+
+    Kokkos::View<int *, DeviceType> imported_ranks =
+        Details::DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+            _target_to_source_distributor );
     Kokkos::View<int *, DeviceType> imported_cell_indices(
-        "imported_cell_indices", n_imports );
+        Kokkos::ViewAllocateWithoutInitializing( "imported_cell_indices" ),
+        n_imports );
     Kokkos::View<Point *, DeviceType> imported_ref_pts( "imported_ref_pts",
                                                         n_imports );
     Kokkos::View<unsigned int *, DeviceType> imported_query_ids(
-        "imported_query_ids", n_imports );
-
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _target_to_source_distributor, ranks, imported_ranks );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _target_to_source_distributor, cell_indices, imported_cell_indices );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _target_to_source_distributor, ref_pts, imported_ref_pts );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        _target_to_source_distributor, query_ids, imported_query_ids );
+        Kokkos::ViewAllocateWithoutInitializing( "imported_query_ids" ),
+        n_imports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "unpack_search_results" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              imported_ref_pts( i ) = imports( i ).ref_pt;
+                              imported_cell_indices( i ) =
+                                  imports( i ).cell_index;
+                              imported_query_ids( i ) = imports( i ).query_id;
+                          } );
+    Kokkos::fence();
 
     Details::DistributedSearchTreeImpl<DeviceType>::sortResults(
         imported_query_ids, imported_query_ids, imported_cell_indices,
@@ -464,110 +733,15 @@ PointSearch<DeviceType>::getSearchResults()
                             imported_ref_pts, imported_query_ids );
 }
 
-template <typename DeviceType>
-void PointSearch<DeviceType>::buildBlockCells(
-    unsigned int topo_id,
-    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> const
-        &block_cells,
-    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_nodes_per_topo,
-    Kokkos::View<unsigned int *, DeviceType> node_offset,
-    Kokkos::View<unsigned int *, DeviceType> cells,
-    Kokkos::View<unsigned int *, DeviceType> offset,
-    Kokkos::View<double **, DeviceType> coordinates )
-{
-    DTK_REQUIRE( offset.extent( 0 ) == cell_topologies.extent( 0 ) );
-    DTK_REQUIRE( topo_id < DTK_N_TOPO );
-    DTK_REQUIRE( block_cells[topo_id].extent( 2 ) == coordinates.extent( 1 ) );
-
-    using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int const dim = _dim;
-    unsigned int const n_cells = cell_topologies.extent( 0 );
-    Kokkos::View<double ***, DeviceType> block_cells_topo =
-        block_cells[topo_id];
-    Kokkos::parallel_for(
-        DTK_MARK_REGION( "build_block_cells_" + std::to_string( topo_id ) ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
-        KOKKOS_LAMBDA( int const i ) {
-            if ( cell_topologies( i ) == topo_id )
-            {
-                internal::buildBlockCells( dim, i, n_nodes_per_topo( topo_id ),
-                                           node_offset( i ), cells, offset,
-                                           coordinates, block_cells_topo );
-            }
-        } );
-    Kokkos::fence();
-}
-
-template <typename DeviceType>
-void PointSearch<DeviceType>::buildBoundingBoxes(
-    unsigned int topo_id,
-    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> const
-        &block_cells,
-    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> n_nodes_per_topo,
-    Kokkos::View<unsigned int *, DeviceType> node_offset,
-    Kokkos::View<unsigned int *, DeviceType> cells,
-    Kokkos::View<unsigned int *, DeviceType> offset,
-    Kokkos::View<double **, DeviceType> coordinates,
-    Kokkos::View<Box *, DeviceType> bounding_boxes )
-{
-    DTK_REQUIRE( offset.extent( 0 ) == cell_topologies.extent( 0 ) );
-    DTK_REQUIRE( node_offset.extent( 0 ) == cell_topologies.extent( 0 ) );
-    DTK_REQUIRE( topo_id < DTK_N_TOPO );
-    DTK_REQUIRE( bounding_boxes.extent( 0 ) == cell_topologies.extent( 0 ) );
-
-    using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int const dim = _dim;
-    unsigned int const n_cells = cell_topologies.extent( 0 );
-    Kokkos::View<double ***, DeviceType> block_cells_topo =
-        block_cells[topo_id];
-    Kokkos::parallel_for(
-        DTK_MARK_REGION( "build_bounding_boxes_" + std::to_string( topo_id ) ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
-        KOKKOS_LAMBDA( int const i ) {
-            if ( cell_topologies( i ) == topo_id )
-            {
-                internal::buildBoundingBoxes(
-                    dim, i, n_nodes_per_topo( topo_id ), node_offset( i ),
-                    cells, offset( i ), coordinates, block_cells_topo,
-                    bounding_boxes );
-            }
-        } );
-    Kokkos::fence();
-}
-
-template <typename DeviceType>
-void PointSearch<DeviceType>::buildBoundingBoxesToBlockCells(
-    unsigned int topo_id,
-    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
-    Kokkos::View<unsigned int *, DeviceType> offset,
-    Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell )
-{
-    DTK_REQUIRE( bounding_box_to_cell.extent( 0 ) == offset.extent( 0 ) );
-
-    using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int const n_cells = cell_topologies.extent( 0 );
-    Kokkos::parallel_for(
-        DTK_MARK_REGION( "build_bounding_boxes_to_block_cells_" +
-                         std::to_string( topo_id ) ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
-        KOKKOS_LAMBDA( int const i ) {
-            if ( cell_topologies( i ) == topo_id )
-            {
-                bounding_box_to_cell( i, topo_id ) = offset( i );
-            }
-        } );
-    Kokkos::fence();
-}
-
 template <typename DeviceType>
 void PointSearch<DeviceType>::convertMesh(
     std::array<unsigned int, DTK_N_TOPO> const &n_cells_per_topo,
     Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
     Kokkos::View<unsigned int *, DeviceType> cells,
-    Kokkos::View<double **, DeviceType> coordinates,
+    Kokkos::View<double **, DeviceType> coordinates, bool index_nodes,
     std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> &block_cells,
+    std::array<Kokkos::View<unsigned int **, DeviceType>, DTK_N_TOPO>
+        &block_connectivities,
     Kokkos::View<Box *, DeviceType> bounding_boxes,
     Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell )
 {
@@ -585,9 +759,14 @@ void PointSearch<DeviceType>::convertMesh(
     // cells with the same topology
     for ( int i = 0; i < DTK_N_TOPO; ++i )
     {
-        block_cells[i] = Kokkos::View<double ***, DeviceType>(
-            "block_cells_" + std::to_string( i ), n_cells_per_topo[i],
-            n_nodes_per_topo_host( i ), _dim );
+        if ( index_nodes )
+            block_connectivities[i] = Kokkos::View<unsigned int **, DeviceType>(
+                "block_connectivities_" + std::to_string( i ),
+                n_cells_per_topo[i], n_nodes_per_topo_host( i ) );
+        else
+            block_cells[i] = Kokkos::View<double ***, DeviceType>(
+                "block_cells_" + std::to_string( i ), n_cells_per_topo[i],
+                n_nodes_per_topo_host( i ), _dim );
     }
 
     // Compute the offset associated to each cell in the coordinates
@@ -600,33 +779,33 @@ void PointSearch<DeviceType>::convertMesh(
     internal::computeNodeOffset( cell_topologies, n_nodes_per_topo,
                                  nodes_per_cell, node_offset );
 
-    Kokkos::View<unsigned int *, DeviceType> offset( "offset", n_cells );
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-    {
-        // Compute the relative position of each cell of a given
-        // topology
-        internal::computeOffset( cell_topologies, topo_id, offset );
-
-        // Build BlockCells
-        buildBlockCells( topo_id, block_cells, cell_topologies,
-                         n_nodes_per_topo, node_offset, cells, offset,
-                         coordinates );
-
-        // Build BoundingBoxes
-        buildBoundingBoxes( topo_id, block_cells, cell_topologies,
-                            n_nodes_per_topo, node_offset, cells, offset,
-                            coordinates, bounding_boxes );
-
-        // Build map between BoundingBoxes and BlockCells
-        buildBoundingBoxesToBlockCells( topo_id, cell_topologies, offset,
-                                        bounding_box_to_cell );
-    }
+    // Compute the relative position of each cell in the block of its
+    // topology
+    Kokkos::View<unsigned int *, DeviceType> offset(
+        Kokkos::ViewAllocateWithoutInitializing( "offset" ), n_cells );
+    internal::computeTopologyOffset( cell_topologies, n_cells_per_topo,
+                                     offset );
+
+    // Build the BlockCells or the BlockConnectivities, the BoundingBoxes, and
+    // the map between them for all the topologies at once. The blocks are
+    // independent and could be built concurrently on separate execution
+    // space instances, but most meshes have one or two topologies and a
+    // single launch over all the cells keeps the load balanced without any
+    // extra synchronization.
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "convert_mesh" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+        internal::ConvertMesh<DeviceType>(
+            _dim, index_nodes, cell_topologies, n_nodes_per_topo, node_offset,
+            cells, offset, coordinates, block_cells, block_connectivities,
+            bounding_boxes, bounding_box_to_cell ) );
+    Kokkos::fence();
 }
 
 template <typename DeviceType>
 void PointSearch<DeviceType>::performDistributedSearch(
     Kokkos::View<double **, DeviceType> points_coord,
-    Kokkos::View<Box *, DeviceType> bounding_boxes,
     Kokkos::View<Point *, DeviceType> &imported_points,
     Kokkos::View<int *, DeviceType> &imported_query_ids,
     Kokkos::View<int *, DeviceType> &imported_cell_indices,
@@ -634,8 +813,6 @@ void PointSearch<DeviceType>::performDistributedSearch(
 {
     DTK_REQUIRE( points_coord.extent( 1 ) == 3 );
 
-    DistributedSearchTree<DeviceType> distributed_tree( _comm, bounding_boxes );
-
     unsigned int const n_points = points_coord.extent( 0 );
 
     // Build the queries
@@ -651,184 +828,118 @@ void PointSearch<DeviceType>::performDistributedSearch(
                           } );
     Kokkos::fence();
 
-    // Perform the distributed search
-    Kokkos::View<int *, DeviceType> indices( "indices" );
+    // Perform the distributed search. The candidates are kept on the
+    // processors owning the cells, which is where the point-in-cell test is
+    // done, so that they do not need to be sent back and forth.
+    Kokkos::View<Within *, DeviceType> fwd_queries( "fwd_queries" );
     Kokkos::View<int *, DeviceType> offset( "offset" );
-    distributed_tree.query( queries, indices, offset, ranks );
-
-    // Create the source to target distributor
-    auto ranks_host = Kokkos::create_mirror_view( ranks );
-    Kokkos::deep_copy( ranks_host, ranks );
-    Tpetra::Distributor source_to_target_distributor( _comm );
-    unsigned int const n_imports = source_to_target_distributor.createFromSends(
-        Teuchos::ArrayView<int const>( ranks_host.data(),
-                                       ranks_host.extent( 0 ) ) );
-
-    // Communicate cell indices
-    Kokkos::realloc( imported_cell_indices, n_imports );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        source_to_target_distributor, indices, imported_cell_indices );
-    // Duplicate the points_coord for the communication. Duplicating the points
-    // allows us to use the same distributor.
-    unsigned int const indices_size = indices.extent( 0 );
-    Kokkos::View<Point *, DeviceType> exported_points( "exported_points",
-                                                       indices_size );
-    Kokkos::View<int *, DeviceType> exported_query_ids( "exported_query_ids",
-                                                        indices_size );
+    Kokkos::View<int *, DeviceType> fwd_query_ids( "fwd_query_ids" );
+    Kokkos::View<int *, DeviceType> fwd_ranks( "fwd_ranks" );
+    _distributed_tree->queryOnOwners( queries, fwd_queries,
+                                      imported_cell_indices, offset,
+                                      fwd_query_ids, fwd_ranks );
+
+    // Duplicate the points, the query_ids, and the ranks of the sending
+    // processors for each candidate cell. The query_ids keep track of which
+    // point is associated to which query and the ranks will be used to build
+    // the _target_to_source_distributor.
+    unsigned int const n_imports = imported_cell_indices.extent( 0 );
+    Kokkos::realloc( imported_points, n_imports );
+    Kokkos::realloc( imported_query_ids, n_imports );
+    Kokkos::realloc( ranks, n_imports );
     // This line should not be necessary but there is problem with the
     // lambda capture on CUDA otherwise.
     unsigned int dim = _dim;
     Kokkos::parallel_for(
-        "duplicate_points",
-        Kokkos::RangePolicy<ExecutionSpace>( 0, offset.extent( 0 ) - 1 ),
+        DTK_MARK_REGION( "duplicate_points" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, fwd_queries.extent( 0 ) ),
         KOKKOS_LAMBDA( int const i ) {
+            Point const &point = fwd_queries( i )._geometry.centroid();
             for ( int j = offset( i ); j < offset( i + 1 ); ++j )
             {
-                exported_query_ids( j ) = i;
+                imported_query_ids( j ) = fwd_query_ids( i );
+                ranks( j ) = fwd_ranks( i );
                 for ( unsigned int k = 0; k < dim; ++k )
-                    exported_points( j )[k] = points_coord( i, k );
+                    imported_points( j )[k] = point[k];
             }
         } );
     Kokkos::fence();
-
-    // Communicate the points
-    Kokkos::realloc( imported_points, n_imports );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        source_to_target_distributor, exported_points, imported_points );
-
-    // Communicate the query_ids. We communicate the query_ids to keep track of
-    // which points is associated to which query.
-    Kokkos::realloc( imported_query_ids, n_imports );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        source_to_target_distributor, exported_query_ids, imported_query_ids );
-
-    // Communicate the ranks of the sending processors. This will be used to
-    // build the _target_to_source_distributor.
-    Kokkos::realloc( ranks, n_imports );
-    Kokkos::View<int *, DeviceType> exported_ranks( "exported_ranks",
-                                                    indices_size );
-    Kokkos::deep_copy( exported_ranks, _comm->getRank() );
-    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-        source_to_target_distributor, exported_ranks, ranks );
 }
 
 template <typename DeviceType>
-void PointSearch<DeviceType>::filterTopology(
-    Kokkos::View<unsigned int *, DeviceType> topo, unsigned int topo_id,
-    Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell,
+void PointSearch<DeviceType>::filterInCell(
+    Kokkos::View<bool *, DeviceType> point_in_cell,
+    Kokkos::View<double **, DeviceType> reference_points,
     Kokkos::View<int *, DeviceType> cell_indices,
-    Kokkos::View<Point *, DeviceType> points,
     Kokkos::View<int *, DeviceType> query_ids,
     Kokkos::View<int *, DeviceType> ranks,
-    Kokkos::View<int *, DeviceType> filtered_cell_indices,
-    Kokkos::View<double **, DeviceType> filtered_points,
-    Kokkos::View<int *, DeviceType> filtered_query_ids,
-    Kokkos::View<int *, DeviceType> filtered_ranks )
+    Kokkos::View<unsigned int *, DeviceType> topo,
+    Kokkos::View<int *, DeviceType> &filtered_ranks )
 {
-    DTK_REQUIRE( topo.extent( 0 ) == ranks.extent( 0 ) );
-    DTK_REQUIRE( query_ids.extent( 0 ) == ranks.extent( 0 ) );
-    DTK_REQUIRE( bounding_box_to_cell.extent( 1 ) > topo_id );
+    DTK_REQUIRE( point_in_cell.extent( 0 ) == topo.extent( 0 ) );
 
     using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int const n_imports = topo.extent( 0 );
-    Kokkos::View<unsigned int *, DeviceType> offset( "offset", n_imports );
-    internal::computeOffset( topo, topo_id, offset );
-
-    // Create Kokkos::View with the points and the cell indices associated
-    // with cells of topo_id topology. Also transform 3D points back to 2D
-    // points.
-    unsigned int dim = _dim;
+    unsigned int const n_ref_points = point_in_cell.extent( 0 );
+
+    // We are only interested in points that belong to the cells. So we need
+    // to filter out all the points that were false positive of the
+    // distributed search. Since the candidates are sorted by topology, the
+    // position of a point among the ones of its topology is its position
+    // among all the points that are kept minus the number of points kept for
+    // the previous topologies.
+    Kokkos::View<unsigned int *, DeviceType> offset( "offset", n_ref_points );
+    internal::computeOffset( point_in_cell, true, offset );
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> topo_size( "topo_size" );
     Kokkos::parallel_for(
-        "filter_data", Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+        DTK_MARK_REGION( "count_points_in_cell" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
         KOKKOS_LAMBDA( int const i ) {
-            if ( topo( i ) == topo_id )
-            {
-                unsigned int const k = offset( i );
-                filtered_cell_indices( k ) =
-                    bounding_box_to_cell( cell_indices( i ), topo_id );
-                for ( unsigned int j = 0; j < dim; ++j )
-                    filtered_points( k, j ) = points( i )[j];
-                filtered_query_ids( k ) = query_ids( i );
-                filtered_ranks( k ) = ranks( i );
-            }
+            if ( point_in_cell( i ) )
+                Kokkos::atomic_increment( &topo_size( topo( i ) ) );
         } );
     Kokkos::fence();
-}
-
-template <typename DeviceType>
-void PointSearch<DeviceType>::filterInCell(
-    std::array<Kokkos::View<bool *, DeviceType>, DTK_N_TOPO> const
-        &filtered_per_topo_point_in_cell,
-    std::array<Kokkos::View<double **, DeviceType>, DTK_N_TOPO> const
-        &filtered_per_topo_reference_points,
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
-        &filtered_per_topo_cell_indices,
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
-        &filtered_per_topo_query_ids,
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const &ranks,
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> &filtered_ranks )
-{
-    using ExecutionSpace = typename DeviceType::execution_space;
-    unsigned int dim = _dim;
+    Kokkos::View<unsigned int[DTK_N_TOPO], DeviceType> topo_offset(
+        "topo_offset" );
+    exclusivePrefixSum( topo_size, topo_offset );
+    auto topo_size_host = Kokkos::create_mirror_view( topo_size );
+    Kokkos::deep_copy( topo_size_host, topo_size );
 
+    unsigned int n_filtered_ref_points = 0;
     for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
     {
-        unsigned int n_ref_points =
-            filtered_per_topo_point_in_cell[topo_id].extent( 0 );
-        if ( n_ref_points != 0 )
-        {
-            int n_filtered_ref_points = 0;
-            Kokkos::View<bool *, DeviceType> pt_in_cell =
-                filtered_per_topo_point_in_cell[topo_id];
-            Kokkos::parallel_reduce(
-                DTK_MARK_REGION( "compute_n_ref_pts" ),
-                Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
-                KOKKOS_LAMBDA( int i, int &partial_sum ) {
-                    if ( pt_in_cell[i] == true )
-                        partial_sum += 1;
-                },
-                n_filtered_ref_points );
-
-            // We are only interested in points that belong to the cells. So we
-            // need to filter out all the points that were false positive of
-            // the distributed search.
-            Kokkos::realloc( _reference_points[topo_id], n_filtered_ref_points,
-                             _dim );
-            Kokkos::realloc( _query_ids[topo_id], n_filtered_ref_points );
-            Kokkos::realloc( _cell_indices[topo_id], n_filtered_ref_points );
-            Kokkos::realloc( filtered_ranks[topo_id], n_filtered_ref_points );
-
-            // We cannot use private member in a lambda function with CUDA
-            Kokkos::View<Coordinate **, DeviceType> ref_points =
-                _reference_points[topo_id];
-            Kokkos::View<int *, DeviceType> query_ids = _query_ids[topo_id];
-            Kokkos::View<int *, DeviceType> cell_indices =
-                _cell_indices[topo_id];
-
-            Kokkos::View<unsigned int *, DeviceType> offset( "offset",
-                                                             n_ref_points );
-            internal::computeOffset( pt_in_cell, true, offset );
-            Kokkos::parallel_for(
-                DTK_MARK_REGION( "filter" ),
-                Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
-                KOKKOS_LAMBDA( int const i ) {
-                    if ( pt_in_cell[i] )
-                    {
-                        unsigned int k = offset( i );
-                        for ( unsigned int d = 0; d < dim; ++d )
-                            ref_points( k, d ) =
-                                filtered_per_topo_reference_points[topo_id](
-                                    i, d );
-                        query_ids( k ) =
-                            filtered_per_topo_query_ids[topo_id]( i );
-                        cell_indices( k ) =
-                            filtered_per_topo_cell_indices[topo_id]( i );
-                        filtered_ranks[topo_id]( k ) = ranks[topo_id]( i );
-                    }
-                } );
-            Kokkos::fence();
-        }
+        Kokkos::realloc( _reference_points[topo_id], topo_size_host( topo_id ),
+                         _dim );
+        Kokkos::realloc( _query_ids[topo_id], topo_size_host( topo_id ) );
+        Kokkos::realloc( _cell_indices[topo_id], topo_size_host( topo_id ) );
+        n_filtered_ref_points += topo_size_host( topo_id );
     }
+    Kokkos::realloc( filtered_ranks, n_filtered_ref_points );
+
+    // We cannot use private member in a lambda function with CUDA
+    std::array<Kokkos::View<Coordinate **, DeviceType>, DTK_N_TOPO>
+        filtered_reference_points = _reference_points;
+    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
+        filtered_query_ids = _query_ids;
+    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO>
+        filtered_cell_indices = _cell_indices;
+    unsigned int dim = _dim;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "filter" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_ref_points ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( point_in_cell( i ) )
+            {
+                unsigned int const topo_id = topo( i );
+                unsigned int const k = offset( i ) - topo_offset( topo_id );
+                for ( unsigned int d = 0; d < dim; ++d )
+                    filtered_reference_points[topo_id]( k, d ) =
+                        reference_points( i, d );
+                filtered_query_ids[topo_id]( k ) = query_ids( i );
+                filtered_cell_indices[topo_id]( k ) = cell_indices( i );
+                filtered_ranks( offset( i ) ) = ranks( i );
+            }
+        } );
+    Kokkos::fence();
 }
 
 template <typename DeviceType>
@@ -882,52 +993,16 @@ PointSearch<DeviceType>::computeNCellsPerTopology(
     return n_cells_per_topo;
 }
 
-template <typename DeviceType>
-void PointSearch<DeviceType>::performPointInCell(
-    Kokkos::View<double ***, DeviceType> cells,
-    Kokkos::View<unsigned int **, DeviceType> bounding_box_to_cell,
-    Kokkos::View<int *, DeviceType> imported_cell_indices,
-    Kokkos::View<Point *, DeviceType> imported_points,
-    Kokkos::View<int *, DeviceType> imported_query_ids,
-    Kokkos::View<int *, DeviceType> imported_ranks,
-    Kokkos::View<unsigned int *, DeviceType> topo, unsigned int topo_id,
-    Kokkos::View<double **, DeviceType> filtered_points,
-    Kokkos::View<int *, DeviceType> filtered_cell_indices,
-    Kokkos::View<int *, DeviceType> filtered_query_ids,
-    Kokkos::View<double **, DeviceType> reference_points,
-    Kokkos::View<bool *, DeviceType> point_in_cell,
-    Kokkos::View<int *, DeviceType> filtered_ranks )
-{
-    filterTopology( topo, topo_id, bounding_box_to_cell, imported_cell_indices,
-                    imported_points, imported_query_ids, imported_ranks,
-                    filtered_cell_indices, filtered_points, filtered_query_ids,
-                    filtered_ranks );
-
-    // Perform the PointInCell search
-    Topologies topologies;
-    PointInCell<DeviceType>::search(
-        filtered_points, cells, filtered_cell_indices, topologies[topo_id].topo,
-        reference_points, point_in_cell );
-}
-
 template <typename DeviceType>
 void PointSearch<DeviceType>::build_distributor(
-    std::array<Kokkos::View<int *, DeviceType>, DTK_N_TOPO> const
-        &filtered_ranks )
+    Kokkos::View<int *, DeviceType> filtered_ranks )
 {
-    // Flatten the filtered ranks to be used by the distributor
-    std::vector<int> flatten_ranks;
-    for ( unsigned int topo_id = 0; topo_id < DTK_N_TOPO; ++topo_id )
-    {
-        auto rank_host = Kokkos::create_mirror_view( filtered_ranks[topo_id] );
-        Kokkos::deep_copy( rank_host, filtered_ranks[topo_id] );
-        unsigned int const rank_host_size = rank_host.size();
-        for ( unsigned int i = 0; i < rank_host_size; ++i )
-            flatten_ranks.push_back( rank_host( i ) );
-    }
+    auto ranks_host = Kokkos::create_mirror_view( filtered_ranks );
+    Kokkos::deep_copy( ranks_host, filtered_ranks );
 
     _target_to_source_distributor.createFromSends(
-        Teuchos::ArrayView<int const>( flatten_ranks ) );
+        Teuchos::ArrayView<int const>( ranks_host.data(),
+                                       ranks_host.extent( 0 ) ) );
 }
 } // namespace DataTransferKit
 
@@ -0,0 +1,99 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_POLYHEDRON_SEARCH_DECL_HPP
+#define DTK_POLYHEDRON_SEARCH_DECL_HPP
+
+#include "DTK_ConfigDefs.hpp"
+#include <DTK_DetailsDistributor.hpp>
+#include <DTK_DistributedSearchTree.hpp>
+#include <DTK_Types.h>
+
+#include <Kokkos_View.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <tuple>
+
+namespace DataTransferKit
+{
+/**
+ * This class performs the search of a set of given points in a mesh of
+ * polyhedral cells, given as in PolyhedronList, and returns the cell(s) on
+ * which each point has been found. The distributed search is the same as for
+ * PointSearch but the point-in-cell test is done against the planes of the
+ * faces of the cells, so that the cells do not need to be split in
+ * tetrahedra. The cells must be convex.
+ */
+template <typename DeviceType>
+class PolyhedronSearch
+{
+  public:
+    /**
+     * Constructor. The offsets of the faces and of the cells are computed and
+     * the distributed tree of the bounding boxes of the cells is built. The
+     * points are looked for by calling search().
+     * @param comm
+     * @param coordinates coordinates of all the nodes in the mesh
+     * @param faces nodes associated to each face
+     * @param nodes_per_face number of nodes of each face
+     * @param cells faces associated to each cell
+     * @param faces_per_cell number of faces of each cell
+     * @param face_orientation orientation of each face of each cell: 1 if the
+     * normal given by the right-hand rule points outward, -1 otherwise
+     * For a more detailed documentation on these arguments see the
+     * documentation of PolyhedronList. The Views are kept and must not be
+     * modified while the object is in use.
+     */
+    PolyhedronSearch( Teuchos::RCP<const Teuchos::Comm<int>> comm,
+                      Kokkos::View<double **, DeviceType> coordinates,
+                      Kokkos::View<unsigned int *, DeviceType> faces,
+                      Kokkos::View<unsigned int *, DeviceType> nodes_per_face,
+                      Kokkos::View<unsigned int *, DeviceType> cells,
+                      Kokkos::View<unsigned int *, DeviceType> faces_per_cell,
+                      Kokkos::View<int *, DeviceType> face_orientation );
+
+    /**
+     * Look for the points in the cells. The results are kept on the
+     * processors that own the cells until getSearchResults() is called. This
+     * must be called as a collective.
+     * @param points_coordinates coordinates in the physical frame of the
+     * points that we are looking for.
+     */
+    void search( Kokkos::View<double **, DeviceType> points_coordinates );
+
+    /**
+     * Return the result of the search. The tuple contains the rank where the
+     * points are found, the cell indices associated to the points (local IDs),
+     * and the query ids associated to each point.
+     */
+    // Note that this function cannot be const because
+    // Details::Distributor::doPostsAndWaits is not const
+    std::tuple<Kokkos::View<int *, DeviceType>, Kokkos::View<int *, DeviceType>,
+               Kokkos::View<unsigned int *, DeviceType>>
+    getSearchResults();
+
+  private:
+    Teuchos::RCP<const Teuchos::Comm<int>> _comm;
+    Details::Distributor _target_to_source_distributor;
+    Kokkos::View<double **, DeviceType> _coordinates;
+    Kokkos::View<unsigned int *, DeviceType> _faces;
+    Kokkos::View<unsigned int *, DeviceType> _face_offset;
+    Kokkos::View<unsigned int *, DeviceType> _cells;
+    Kokkos::View<unsigned int *, DeviceType> _cell_offset;
+    Kokkos::View<int *, DeviceType> _face_orientation;
+    Teuchos::RCP<DistributedSearchTree<DeviceType>> _distributed_tree;
+    Kokkos::View<int *, DeviceType> _query_ids;
+    Kokkos::View<int *, DeviceType> _cell_indices;
+};
+} // namespace DataTransferKit
+
+#endif
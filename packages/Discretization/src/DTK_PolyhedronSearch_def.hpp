@@ -0,0 +1,286 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_POLYHEDRON_SEARCH_DEF_HPP
+#define DTK_POLYHEDRON_SEARCH_DEF_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp> // expand
+#include <DTK_DetailsTeuchosSerializationTraits.hpp>
+#include <DTK_DetailsUtils.hpp>
+#include <DTK_PointInCell.hpp>
+#include <DTK_PointInPolyhedronFunctor.hpp>
+#include <DTK_Statistics.hpp>
+
+namespace DataTransferKit
+{
+namespace internal
+{
+/**
+ * Compute the offsets of a compressed row storage from the number of entries
+ * of each row. The returned View has one more element than \p counts.
+ */
+template <typename DeviceType>
+Kokkos::View<unsigned int *, DeviceType>
+computeCRSOffset( Kokkos::View<unsigned int *, DeviceType> counts,
+                  std::string const &label )
+{
+    int const n = counts.extent( 0 );
+    Kokkos::View<unsigned int *, DeviceType> offset( label, n + 1 );
+    Kokkos::deep_copy( Kokkos::subview( offset, Kokkos::make_pair( 0, n ) ),
+                       counts );
+    exclusivePrefixSum( offset );
+    return offset;
+}
+
+/**
+ * Result of the local search sent back to the process that owns the point.
+ * The rank of the process that owns the cell is given by the communication
+ * plan.
+ */
+struct PolyhedronSearchResultPacket
+{
+    int cell_index;
+    unsigned int query_id;
+};
+} // namespace internal
+
+template <typename DeviceType>
+PolyhedronSearch<DeviceType>::PolyhedronSearch(
+    Teuchos::RCP<const Teuchos::Comm<int>> comm,
+    Kokkos::View<double **, DeviceType> coordinates,
+    Kokkos::View<unsigned int *, DeviceType> faces,
+    Kokkos::View<unsigned int *, DeviceType> nodes_per_face,
+    Kokkos::View<unsigned int *, DeviceType> cells,
+    Kokkos::View<unsigned int *, DeviceType> faces_per_cell,
+    Kokkos::View<int *, DeviceType> face_orientation )
+    : _comm( comm )
+    , _target_to_source_distributor( _comm )
+    , _coordinates( coordinates )
+    , _faces( faces )
+    , _cells( cells )
+    , _face_orientation( face_orientation )
+{
+    ScopedTimer timer( "polyhedral mesh setup" );
+
+    // The faces are only tested against their plane in 3D.
+    DTK_REQUIRE( coordinates.extent( 1 ) == 3 );
+    DTK_REQUIRE( face_orientation.extent( 0 ) == cells.extent( 0 ) );
+
+    _face_offset = internal::computeCRSOffset( nodes_per_face, "face_offset" );
+    _cell_offset = internal::computeCRSOffset( faces_per_cell, "cell_offset" );
+    DTK_REQUIRE( lastElement( _face_offset ) == faces.extent( 0 ) );
+    DTK_REQUIRE( lastElement( _cell_offset ) == cells.extent( 0 ) );
+
+    // Bound each cell by the nodes of its faces.
+    unsigned int const n_cells = faces_per_cell.extent( 0 );
+    Kokkos::View<Box *, DeviceType> bounding_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "bounding_boxes" ), n_cells );
+    auto face_offset = _face_offset;
+    auto cell_offset = _cell_offset;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "build_polyhedron_bounding_boxes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+        KOKKOS_LAMBDA( int const i ) {
+            Box bounding_box;
+            for ( unsigned int k = cell_offset( i ); k < cell_offset( i + 1 );
+                  ++k )
+                for ( unsigned int n = face_offset( cells( k ) );
+                      n < face_offset( cells( k ) + 1 ); ++n )
+                {
+                    unsigned int const node = faces( n );
+                    Details::expand( bounding_box,
+                                     Point{{coordinates( node, 0 ),
+                                            coordinates( node, 1 ),
+                                            coordinates( node, 2 )}} );
+                }
+            bounding_boxes( i ) = bounding_box;
+        } );
+    Kokkos::fence();
+
+    // The tree only depends on the mesh so it is shared by all the searches
+    _distributed_tree = Teuchos::rcp(
+        new DistributedSearchTree<DeviceType>( _comm, bounding_boxes ) );
+}
+
+template <typename DeviceType>
+void PolyhedronSearch<DeviceType>::search(
+    Kokkos::View<double **, DeviceType> points_coordinates )
+{
+    ScopedTimer timer( "polyhedron search" );
+
+    DTK_REQUIRE( points_coordinates.extent( 1 ) == 3 );
+
+    // Build the queries
+    unsigned int const n_points = points_coordinates.extent( 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<Within *, DeviceType> queries( "queries", n_points );
+    Kokkos::parallel_for( DTK_MARK_REGION( "register_queries" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+                          KOKKOS_LAMBDA( int i ) {
+                              queries( i ) = within(
+                                  {{points_coordinates( i, 0 ),
+                                    points_coordinates( i, 1 ),
+                                    points_coordinates( i, 2 )}},
+                                  0. );
+                          } );
+    Kokkos::fence();
+
+    // Perform the distributed search. As in PointSearch, the candidates are
+    // kept on the processors owning the cells, where they are tested.
+    Kokkos::View<Within *, DeviceType> fwd_queries( "fwd_queries" );
+    Kokkos::View<int *, DeviceType> cell_indices( "cell_indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> fwd_query_ids( "fwd_query_ids" );
+    Kokkos::View<int *, DeviceType> fwd_ranks( "fwd_ranks" );
+    _distributed_tree->queryOnOwners( queries, fwd_queries, cell_indices,
+                                      offset, fwd_query_ids, fwd_ranks );
+
+    // Duplicate the points, the query ids, and the ranks of the sending
+    // processors for each candidate cell.
+    unsigned int const n_candidates = cell_indices.extent( 0 );
+    Kokkos::View<double **, DeviceType> points(
+        Kokkos::ViewAllocateWithoutInitializing( "points" ), n_candidates, 3 );
+    Kokkos::View<int *, DeviceType> query_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "query_ids" ), n_candidates );
+    Kokkos::View<int *, DeviceType> ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "ranks" ), n_candidates );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "duplicate_points" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, fwd_queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int const i ) {
+            Point const &point = fwd_queries( i )._geometry.centroid();
+            for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+            {
+                query_ids( j ) = fwd_query_ids( i );
+                ranks( j ) = fwd_ranks( i );
+                for ( int d = 0; d < 3; ++d )
+                    points( j, d ) = point[d];
+            }
+        } );
+    Kokkos::fence();
+
+    // Check if the points are in the cells
+    Kokkos::View<bool *, DeviceType> point_in_cell(
+        Kokkos::ViewAllocateWithoutInitializing( "point_in_cell" ),
+        n_candidates );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "point_in_polyhedron" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_candidates ),
+        Functor::PointInPolyhedron<DeviceType>(
+            PointInCell<DeviceType>::threshold, _coordinates, _faces,
+            _face_offset, _cells, _face_orientation, _cell_offset, points,
+            cell_indices, point_in_cell ) );
+    Kokkos::fence();
+
+    // Filter out the false positives of the distributed search
+    Kokkos::View<unsigned int *, DeviceType> filtered_offset(
+        "filtered_offset", n_candidates + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_mask" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_candidates ),
+        KOKKOS_LAMBDA( int const i ) {
+            filtered_offset( i ) = point_in_cell( i ) ? 1 : 0;
+        } );
+    Kokkos::fence();
+    unsigned int const n_filtered = exclusivePrefixSum( filtered_offset );
+
+    Kokkos::realloc( _query_ids, n_filtered );
+    Kokkos::realloc( _cell_indices, n_filtered );
+    Kokkos::View<int *, DeviceType> filtered_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "filtered_ranks" ),
+        n_filtered );
+    // We cannot use private member in a lambda function with CUDA
+    auto filtered_query_ids = _query_ids;
+    auto filtered_cell_indices = _cell_indices;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "filter" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_candidates ),
+        KOKKOS_LAMBDA( int const i ) {
+            if ( point_in_cell( i ) )
+            {
+                unsigned int const k = filtered_offset( i );
+                filtered_query_ids( k ) = query_ids( i );
+                filtered_cell_indices( k ) = cell_indices( i );
+                filtered_ranks( k ) = ranks( i );
+            }
+        } );
+    Kokkos::fence();
+
+    // Build the _target_to_source_distributor
+    auto ranks_host = Kokkos::create_mirror_view( filtered_ranks );
+    Kokkos::deep_copy( ranks_host, filtered_ranks );
+    _target_to_source_distributor.createFromSends(
+        Teuchos::ArrayView<int const>( ranks_host.data(),
+                                       ranks_host.extent( 0 ) ) );
+}
+
+template <typename DeviceType>
+std::tuple<Kokkos::View<int *, DeviceType>, Kokkos::View<int *, DeviceType>,
+           Kokkos::View<unsigned int *, DeviceType>>
+PolyhedronSearch<DeviceType>::getSearchResults()
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    unsigned int const n_exports = _query_ids.extent( 0 );
+    Kokkos::View<internal::PolyhedronSearchResultPacket *, DeviceType> exports(
+        Kokkos::ViewAllocateWithoutInitializing( "exports" ), n_exports );
+    auto query_ids = _query_ids;
+    auto cell_indices = _cell_indices;
+    Kokkos::parallel_for( DTK_MARK_REGION( "pack_search_results" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              exports( i ).cell_index = cell_indices( i );
+                              exports( i ).query_id = query_ids( i );
+                          } );
+    Kokkos::fence();
+
+    // Communicate the results. The ranks of the processes that own the cells
+    // are given by the communication plan.
+    unsigned int const n_imports =
+        _target_to_source_distributor.getTotalReceiveLength();
+    Kokkos::View<internal::PolyhedronSearchResultPacket *, DeviceType> imports(
+        Kokkos::ViewAllocateWithoutInitializing( "imports" ), n_imports );
+    Details::DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
+        _target_to_source_distributor, exports, imports );
+
+    Kokkos::View<int *, DeviceType> imported_ranks =
+        Details::DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+            _target_to_source_distributor );
+    Kokkos::View<int *, DeviceType> imported_cell_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "imported_cell_indices" ),
+        n_imports );
+    Kokkos::View<unsigned int *, DeviceType> imported_query_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "imported_query_ids" ),
+        n_imports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "unpack_search_results" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              imported_cell_indices( i ) =
+                                  imports( i ).cell_index;
+                              imported_query_ids( i ) = imports( i ).query_id;
+                          } );
+    Kokkos::fence();
+
+    Details::DistributedSearchTreeImpl<DeviceType>::sortResults(
+        imported_query_ids, imported_query_ids, imported_cell_indices,
+        imported_ranks );
+
+    return std::make_tuple( imported_ranks, imported_cell_indices,
+                            imported_query_ids );
+}
+} // namespace DataTransferKit
+
+// Explicit instantiation macro
+#define DTK_POLYHEDRONSEARCH_INSTANT( NODE )                                   \
+    template class PolyhedronSearch<typename NODE::device_type>;
+
+#endif
@@ -77,66 +77,77 @@ struct HEX_8
 {
     typedef Intrepid2::Impl::Basis_HGRAD_HEX_C1_FEM basis_type;
     typedef Intrepid2::Impl::Hexahedron<8> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct HEX_27
 {
     typedef Intrepid2::Impl::Basis_HGRAD_HEX_C2_FEM basis_type;
     typedef Intrepid2::Impl::Hexahedron<27> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct PYRAMID_5
 {
     typedef Intrepid2::Impl::Basis_HGRAD_PYR_C1_FEM basis_type;
     typedef Intrepid2::Impl::Pyramid<5> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct QUAD_4
 {
     typedef Intrepid2::Impl::Basis_HGRAD_QUAD_C1_FEM basis_type;
     typedef Intrepid2::Impl::Quadrilateral<4> topo_type;
+    static int constexpr dim = 2;
 };
 
 struct QUAD_9
 {
     typedef Intrepid2::Impl::Basis_HGRAD_QUAD_C2_FEM basis_type;
     typedef Intrepid2::Impl::Quadrilateral<9> topo_type;
+    static int constexpr dim = 2;
 };
 
 struct TET_4
 {
     typedef Intrepid2::Impl::Basis_HGRAD_TET_C1_FEM basis_type;
     typedef Intrepid2::Impl::Tetrahedron<4> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct TET_10
 {
     typedef Intrepid2::Impl::Basis_HGRAD_TET_C2_FEM basis_type;
     typedef Intrepid2::Impl::Tetrahedron<10> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct TRI_3
 {
     typedef Intrepid2::Impl::Basis_HGRAD_TRI_C1_FEM basis_type;
     typedef Intrepid2::Impl::Triangle<3> topo_type;
+    static int constexpr dim = 2;
 };
 
 struct TRI_6
 {
     typedef Intrepid2::Impl::Basis_HGRAD_TRI_C2_FEM basis_type;
     typedef Intrepid2::Impl::Triangle<6> topo_type;
+    static int constexpr dim = 2;
 };
 
 struct WEDGE_6
 {
     typedef Intrepid2::Impl::Basis_HGRAD_WEDGE_C1_FEM basis_type;
     typedef Intrepid2::Impl::Wedge<6> topo_type;
+    static int constexpr dim = 3;
 };
 
 struct WEDGE_18
 {
     typedef Intrepid2::Impl::Basis_HGRAD_WEDGE_C2_FEM basis_type;
     typedef Intrepid2::Impl::Wedge<18> topo_type;
+    static int constexpr dim = 3;
 };
 } // namespace DataTransferKit
 
@@ -11,11 +11,15 @@
 
 #include "MeshGenerator.hpp"
 #include <DTK_Interpolation.hpp>
+#include <DTK_NativeBasis.hpp>
 #include <DTK_Types.h>
 
 #include <Teuchos_DefaultComm.hpp>
 #include <Teuchos_UnitTestHarness.hpp>
 
+#include <array>
+#include <vector>
+
 template <typename DeviceType>
 Kokkos::View<double *[3], DeviceType>
 getPointsCoord3D( Teuchos::RCP<const Teuchos::Comm<int>> comm ) {
@@ -299,6 +303,24 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Interpolation, one_topo_one_fe_three_dim,
     {
         TEST_EQUALITY( Y.extent( 0 ), 0 );
     }
+
+    // The interpolation stencils are reused when the field changes. We set
+    // X = 2 * (x + y + z)
+    Kokkos::parallel_for( "double_X",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_dofs ),
+                          KOKKOS_LAMBDA( int const i ) { X( i, 0 ) *= 2.; } );
+    Kokkos::fence();
+    interpolation.apply( X, Y );
+    if ( comm_rank == 0 )
+    {
+        std::array<double, 5> ref_sol = {{3., 14.5, 16.0, 15., 12.}};
+        checkFieldValue<dim, 5>( ref_sol, Y, success, out );
+    }
+    else if ( comm_rank == 1 )
+    {
+        std::array<double, 5> ref_sol = {{9., 20.5, 22.0, 21., 18.}};
+        checkFieldValue<dim, 5>( ref_sol, Y, success, out );
+    }
 }
 
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Interpolation, two_topo_two_dim, DeviceType )
@@ -509,6 +531,121 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Interpolation,
     }
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Interpolation, many_fields, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    unsigned int constexpr dim = 3;
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    Kokkos::View<double * [3], DeviceType> points_coord;
+    std::vector<unsigned int> n_subdivisions = {{5, 5, 3}};
+    std::tie( cell_topologies, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+    points_coord = getPointsCoord3D<DeviceType>( comm );
+    unsigned int const n_points = points_coord.extent( 0 );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    unsigned int const n_dofs = coordinates.extent( 0 );
+    // The fields are split in blocks of 8, 4, and 3 fields
+    unsigned int const n_fields = 15;
+    Kokkos::View<DataTransferKit::LocalOrdinal *, DeviceType> cell_dofs_ids(
+        "cell_dofs_ids", cells.extent( 0 ) );
+
+    Kokkos::parallel_for(
+        "initialize_cell_dofs_ids",
+        Kokkos::RangePolicy<ExecutionSpace>( 0, cells.extent( 0 ) ),
+        KOKKOS_LAMBDA( int const i ) { cell_dofs_ids( i ) = cells( i ); } );
+    Kokkos::fence();
+
+    DataTransferKit::Interpolation<DeviceType> interpolation(
+        comm, cell_topologies, cells, coordinates, points_coord, cell_dofs_ids,
+        DTK_HGRAD );
+
+    // We set X = x + y + z + 3*field_id
+    Kokkos::View<double **, DeviceType> X( "X", n_dofs, n_fields );
+    Kokkos::parallel_for( "initialize_X",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_dofs ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              for ( unsigned int d = 0; d < dim; ++d )
+                                  for ( unsigned int j = 0; j < n_fields; ++j )
+                                      X( i, j ) += j + coordinates( i, d );
+                          } );
+    Kokkos::fence();
+
+    Kokkos::View<double **, DeviceType> Y( "Y", n_points, n_fields );
+    interpolation.apply( X, Y );
+    if ( comm_rank == 0 )
+    {
+        std::array<double, 5> ref_sol = {{1.5, 7.25, 8.0, 7.5, 6.}};
+        checkFieldValue<dim, 5>( ref_sol, Y, success, out );
+    }
+    else if ( comm_rank == 1 )
+    {
+        std::array<double, 5> ref_sol = {{4.5, 10.25, 11.0, 10.5, 9}};
+        checkFieldValue<dim, 5>( ref_sol, Y, success, out );
+    }
+    else
+    {
+        TEST_EQUALITY( Y.extent( 0 ), 0 );
+    }
+}
+
+// Compare the native evaluation of a basis to the one of Intrepid2 at points
+// inside of the reference cell.
+template <typename FEOpType>
+void checkNativeBasis( std::vector<std::array<double, 3>> const &points,
+                       bool &success, Teuchos::FancyOStream &out )
+{
+    using Basis = DataTransferKit::Details::NativeBasis<FEOpType>;
+    int const dim = Basis::dim;
+    int const cardinality = Basis::cardinality;
+    Kokkos::View<double *, Kokkos::HostSpace> ref_point( "ref_point", dim );
+    Kokkos::View<double *, Kokkos::HostSpace> ref_values( "ref_values",
+                                                          cardinality );
+    for ( auto const &point : points )
+    {
+        double x[Basis::dim];
+        for ( int d = 0; d < dim; ++d )
+            x[d] = ref_point( d ) = point[d];
+        double values[Basis::cardinality];
+        Basis::getValues( x, values );
+        FEOpType::getValues( ref_values, ref_point );
+        for ( int i = 0; i < cardinality; ++i )
+            TEST_FLOATING_EQUALITY( values[i] + 1., ref_values( i ) + 1.,
+                                    1e-14 );
+    }
+}
+
+TEUCHOS_UNIT_TEST( Interpolation, native_basis )
+{
+    using namespace DataTransferKit;
+
+    std::vector<std::array<double, 3>> cube_points = {
+        {{0., 0., 0.}},
+        {{-1., -1., -1.}},
+        {{0.5, -0.25, 0.75}},
+        {{-0.9, 0.3, 1.}},
+        {{1., 0., -0.6}}};
+    std::vector<std::array<double, 3>> simplex_points = {
+        {{0., 0., 0.}},
+        {{0.25, 0.25, 0.25}},
+        {{0.1, 0.6, 0.2}},
+        {{0.5, 0.5, 0.}},
+        {{0., 0.3, 0.7}}};
+
+    checkNativeBasis<HEX_HGRAD_1::feop_type>( cube_points, success, out );
+    checkNativeBasis<HEX_HGRAD_2::feop_type>( cube_points, success, out );
+    checkNativeBasis<QUAD_HGRAD_1::feop_type>( cube_points, success, out );
+    checkNativeBasis<QUAD_HGRAD_2::feop_type>( cube_points, success, out );
+    checkNativeBasis<TET_HGRAD_1::feop_type>( simplex_points, success, out );
+    checkNativeBasis<TET_HGRAD_2::feop_type>( simplex_points, success, out );
+    checkNativeBasis<TRI_HGRAD_1::feop_type>( simplex_points, success, out );
+    checkNativeBasis<TRI_HGRAD_2::feop_type>( simplex_points, success, out );
+}
+
 // Include the test macros.
 #include "DataTransferKitDiscretization_ETIHelperMacros.h"
 
@@ -523,7 +660,9 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Interpolation,
         Interpolation, one_topo_one_fe_three_dim_hdiv, DeviceType##NODE )      \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         Interpolation, one_topo_one_fe_three_dim_point_not_found,              \
-        DeviceType##NODE )
+        DeviceType##NODE )                                                     \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( Interpolation, many_fields,          \
+                                          DeviceType##NODE )
 
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
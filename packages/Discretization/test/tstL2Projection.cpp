@@ -0,0 +1,90 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include "MeshGenerator.hpp"
+#include <DTK_L2Projection.hpp>
+#include <DTK_Types.h>
+
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <cmath>
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( L2Projection, linear_field, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    unsigned int constexpr dim = 3;
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    std::vector<unsigned int> n_subdivisions = {{5, 5, 3}};
+    std::tie( cell_topologies, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    unsigned int const n_dofs = coordinates.extent( 0 );
+    unsigned int const n_fields = 2;
+    Kokkos::View<DataTransferKit::LocalOrdinal *, DeviceType> cell_dofs_ids(
+        "cell_dofs_ids", cells.extent( 0 ) );
+    Kokkos::parallel_for(
+        "initialize_cell_dofs_ids",
+        Kokkos::RangePolicy<ExecutionSpace>( 0, cells.extent( 0 ) ),
+        KOKKOS_LAMBDA( int const i ) { cell_dofs_ids( i ) = cells( i ); } );
+    Kokkos::fence();
+
+    // The source and the target meshes are the same
+    DataTransferKit::L2Projection<DeviceType> l2_projection(
+        comm, cell_topologies, cells, coordinates, cell_dofs_ids, DTK_HGRAD,
+        cell_topologies, cells, coordinates, cell_dofs_ids );
+
+    // We set X = x + y + z + 3*field_id
+    Kokkos::View<double **, DeviceType> X( "X", n_dofs, n_fields );
+    Kokkos::parallel_for( "initialize_X",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_dofs ),
+                          KOKKOS_LAMBDA( int const i ) {
+                              for ( unsigned int d = 0; d < dim; ++d )
+                                  for ( unsigned int j = 0; j < n_fields; ++j )
+                                      X( i, j ) += j + coordinates( i, d );
+                          } );
+    Kokkos::fence();
+
+    // The field belongs to the target space so the projection is exact
+    Kokkos::View<double **, DeviceType> Y( "Y", n_dofs, n_fields );
+    l2_projection.apply( X, Y );
+    TEST_COMPARE( l2_projection.getNumberOfIterations(), >, 0 );
+    TEST_COMPARE( l2_projection.getNumberOfIterations(), <, 1000 );
+
+    auto X_host = Kokkos::create_mirror_view( X );
+    Kokkos::deep_copy( X_host, X );
+    auto Y_host = Kokkos::create_mirror_view( Y );
+    Kokkos::deep_copy( Y_host, Y );
+    double const tol = 1e-10;
+    for ( unsigned int i = 0; i < n_dofs; ++i )
+        for ( unsigned int j = 0; j < n_fields; ++j )
+            TEST_COMPARE( std::abs( Y_host( i, j ) - X_host( i, j ) ), <,
+                          tol );
+}
+
+// Include the test macros.
+#include "DataTransferKitDiscretization_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( L2Projection, linear_field,          \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
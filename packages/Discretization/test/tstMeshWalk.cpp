@@ -0,0 +1,264 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include "MeshGenerator.hpp"
+#include <DTK_MeshWalk.hpp>
+
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Build the adjacency list of the structured mesh of buildStructuredMesh().
+// The cells across the faces at the bottom and at the top of the slab of a
+// processor belong to the processors below and above it.
+template <typename DeviceType>
+std::tuple<Kokkos::View<GlobalOrdinal *, DeviceType>,
+           Kokkos::View<GlobalOrdinal *, DeviceType>,
+           Kokkos::View<unsigned int *, DeviceType>>
+buildAdjacencyList( Teuchos::RCP<const Teuchos::Comm<int>> comm,
+                    std::vector<unsigned int> const &n_subdivisions )
+{
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+    int const nx = n_subdivisions[0];
+    int const ny = n_subdivisions[1];
+    int const nz = n_subdivisions[2];
+    int const n_cells = nx * ny * nz;
+
+    std::vector<GlobalOrdinal> global_ids;
+    std::vector<GlobalOrdinal> adjacent_cells;
+    std::vector<unsigned int> adjacencies_per_cell;
+    for ( int i = 0; i < nz; ++i )
+        for ( int j = 0; j < ny; ++j )
+            for ( int k = 0; k < nx; ++k )
+            {
+                // Position of the cell in the global mesh
+                int const z = comm_rank * nz + i;
+                auto const id = [=]( int kk, int jj, int zz ) {
+                    return static_cast<GlobalOrdinal>(
+                        ( zz / nz ) * n_cells + kk + jj * nx +
+                        ( zz % nz ) * nx * ny );
+                };
+                global_ids.push_back( id( k, j, z ) );
+                unsigned int const n_adjacent_cells = adjacent_cells.size();
+                if ( k > 0 )
+                    adjacent_cells.push_back( id( k - 1, j, z ) );
+                if ( k < nx - 1 )
+                    adjacent_cells.push_back( id( k + 1, j, z ) );
+                if ( j > 0 )
+                    adjacent_cells.push_back( id( k, j - 1, z ) );
+                if ( j < ny - 1 )
+                    adjacent_cells.push_back( id( k, j + 1, z ) );
+                if ( z > 0 )
+                    adjacent_cells.push_back( id( k, j, z - 1 ) );
+                if ( z < comm_size * nz - 1 )
+                    adjacent_cells.push_back( id( k, j, z + 1 ) );
+                adjacencies_per_cell.push_back( adjacent_cells.size() -
+                                                n_adjacent_cells );
+            }
+
+    Kokkos::View<GlobalOrdinal *, DeviceType> global_ids_view(
+        "cell_global_ids", global_ids.size() );
+    Kokkos::deep_copy(
+        global_ids_view,
+        Kokkos::View<GlobalOrdinal *, Kokkos::HostSpace,
+                     Kokkos::MemoryUnmanaged>( global_ids.data(),
+                                               global_ids.size() ) );
+    Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells_view(
+        "adjacent_cells", adjacent_cells.size() );
+    Kokkos::deep_copy(
+        adjacent_cells_view,
+        Kokkos::View<GlobalOrdinal *, Kokkos::HostSpace,
+                     Kokkos::MemoryUnmanaged>( adjacent_cells.data(),
+                                               adjacent_cells.size() ) );
+    Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell_view(
+        "adjacencies_per_cell", adjacencies_per_cell.size() );
+    Kokkos::deep_copy(
+        adjacencies_per_cell_view,
+        Kokkos::View<unsigned int *, Kokkos::HostSpace,
+                     Kokkos::MemoryUnmanaged>( adjacencies_per_cell.data(),
+                                               adjacencies_per_cell.size() ) );
+
+    return std::make_tuple( global_ids_view, adjacent_cells_view,
+                            adjacencies_per_cell_view );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( MeshWalk, face_neighbors, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    std::vector<unsigned int> n_subdivisions = {{4, 4, 2}};
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+    Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids;
+    Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells;
+    Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell;
+    std::tie( cell_global_ids, adjacent_cells, adjacencies_per_cell ) =
+        buildAdjacencyList<DeviceType>( comm, n_subdivisions );
+
+    DataTransferKit::MeshWalk<DeviceType> mesh_walk(
+        comm, cell_topologies, cells, coordinates, cell_global_ids,
+        adjacent_cells, adjacencies_per_cell );
+
+    Kokkos::View<int *, DeviceType> face_offset;
+    Kokkos::View<int *, DeviceType> face_neighbors;
+    std::tie( face_offset, face_neighbors ) = mesh_walk.getFaceNeighbors();
+    auto face_offset_host = Kokkos::create_mirror_view( face_offset );
+    Kokkos::deep_copy( face_offset_host, face_offset );
+    auto face_neighbors_host = Kokkos::create_mirror_view( face_neighbors );
+    Kokkos::deep_copy( face_neighbors_host, face_neighbors );
+
+    // Faces at y = -1, x = 1, y = 1, x = -1, z = -1, and z = 1 in the
+    // reference frame. The cells of the other processors are not neighbors.
+    TEST_EQUALITY( face_offset_host.extent( 0 ), 33 );
+    std::vector<int> face_neighbors_ref = {-1, 1, 4, -1, -1, 16};
+    for ( int f = 0; f < 6; ++f )
+        TEST_EQUALITY( face_neighbors_host( face_offset_host( 0 ) + f ),
+                       face_neighbors_ref[f] );
+    face_neighbors_ref = {27, -1, -1, 30, 15, -1};
+    for ( int f = 0; f < 6; ++f )
+        TEST_EQUALITY( face_neighbors_host( face_offset_host( 31 ) + f ),
+                       face_neighbors_ref[f] );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( MeshWalk, walk, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+    std::vector<unsigned int> n_subdivisions = {{4, 4, 2}};
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    std::tie( cell_topologies, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+    Kokkos::View<GlobalOrdinal *, DeviceType> cell_global_ids;
+    Kokkos::View<GlobalOrdinal *, DeviceType> adjacent_cells;
+    Kokkos::View<unsigned int *, DeviceType> adjacencies_per_cell;
+    std::tie( cell_global_ids, adjacent_cells, adjacencies_per_cell ) =
+        buildAdjacencyList<DeviceType>( comm, n_subdivisions );
+
+    DataTransferKit::MeshWalk<DeviceType> mesh_walk(
+        comm, cell_topologies, cells, coordinates, cell_global_ids,
+        adjacent_cells, adjacencies_per_cell );
+
+    // The first three points walk from the first cell to cells of the slab
+    // of the processor. The fourth one does not know where to start and the
+    // last one is in the slab of the next processor.
+    double const z = 2. * comm_rank;
+    std::vector<std::array<double, 3>> points = {{{3.25, 2.75, z + 1.5}},
+                                                 {{0.5, 3.5, z + 0.25}},
+                                                 {{1.75, 0.25, z + 1.9}},
+                                                 {{2.5, 1.5, z + 0.5}}};
+    if ( comm_size > 1 )
+        points.push_back( {{0.5, 0.5, 2. * ( ( comm_rank + 1 ) % comm_size ) +
+                                          0.5}} );
+    int const n_points = points.size();
+    Kokkos::View<double **, DeviceType> points_coordinates( "points",
+                                                            n_points, 3 );
+    Kokkos::View<int *, DeviceType> cell_indices( "cell_indices", n_points );
+    auto points_coordinates_host =
+        Kokkos::create_mirror_view( points_coordinates );
+    auto cell_indices_host = Kokkos::create_mirror_view( cell_indices );
+    for ( int i = 0; i < n_points; ++i )
+    {
+        for ( int d = 0; d < 3; ++d )
+            points_coordinates_host( i, d ) = points[i][d];
+        cell_indices_host( i ) = ( i == 3 ) ? -1 : 0;
+    }
+    Kokkos::deep_copy( points_coordinates, points_coordinates_host );
+    Kokkos::deep_copy( cell_indices, cell_indices_host );
+
+    Kokkos::View<double **, DeviceType> reference_points( "reference_points",
+                                                          n_points, 3 );
+    mesh_walk.walk( points_coordinates, cell_indices, reference_points );
+
+    Kokkos::deep_copy( cell_indices_host, cell_indices );
+    auto reference_points_host = Kokkos::create_mirror_view( reference_points );
+    Kokkos::deep_copy( reference_points_host, reference_points );
+    std::vector<int> cell_indices_ref = {27, 12, 17, -1, -1};
+    for ( int i = 0; i < n_points; ++i )
+        TEST_EQUALITY( cell_indices_host( i ), cell_indices_ref[i] );
+    for ( int i = 0; i < 3; ++i )
+        for ( int d = 0; d < 3; ++d )
+        {
+            double const x = points[i][d];
+            TEST_FLOATING_EQUALITY( reference_points_host( i, d ) + 2.,
+                                    2. * ( x - std::floor( x ) ) + 1., 1e-14 );
+        }
+
+    auto lost_points = mesh_walk.getLostPoints();
+    auto lost_points_host = Kokkos::create_mirror_view( lost_points );
+    Kokkos::deep_copy( lost_points_host, lost_points );
+    TEST_EQUALITY( lost_points_host.extent_int( 0 ), n_points - 3 );
+    for ( int i = 3; i < n_points; ++i )
+        TEST_EQUALITY( lost_points_host( i - 3 ), i );
+
+    // The lost points are found at the center of the cells by the search in
+    // the whole mesh.
+    Kokkos::View<int *, DeviceType> ranks;
+    Kokkos::View<int *, DeviceType> found_cell_indices;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> found_reference_points;
+    Kokkos::View<unsigned int *, DeviceType> query_ids;
+    std::tie( ranks, found_cell_indices, found_reference_points, query_ids ) =
+        mesh_walk.getPointSearch().getSearchResults();
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    Kokkos::deep_copy( ranks_host, ranks );
+    auto found_cell_indices_host =
+        Kokkos::create_mirror_view( found_cell_indices );
+    Kokkos::deep_copy( found_cell_indices_host, found_cell_indices );
+    auto found_reference_points_host =
+        Kokkos::create_mirror_view( found_reference_points );
+    Kokkos::deep_copy( found_reference_points_host, found_reference_points );
+    auto query_ids_host = Kokkos::create_mirror_view( query_ids );
+    Kokkos::deep_copy( query_ids_host, query_ids );
+    TEST_EQUALITY( ranks_host.extent_int( 0 ), n_points - 3 );
+    for ( int i = 0; i < ranks_host.extent_int( 0 ); ++i )
+    {
+        if ( ranks_host( i ) == comm_rank )
+        {
+            TEST_EQUALITY( query_ids_host( i ), 0 );
+            TEST_EQUALITY( found_cell_indices_host( i ), 6 );
+        }
+        else
+        {
+            TEST_EQUALITY( ranks_host( i ),
+                           ( comm_rank + comm_size - 1 ) % comm_size );
+            TEST_EQUALITY( query_ids_host( i ), 1 );
+            TEST_EQUALITY( found_cell_indices_host( i ), 0 );
+        }
+        for ( int d = 0; d < 3; ++d )
+            TEST_FLOATING_EQUALITY( found_reference_points_host( i )[d] + 1.,
+                                    1., 1e-14 );
+    }
+}
+
+// Include the test macros.
+#include "DataTransferKitDiscretization_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( MeshWalk, face_neighbors,            \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( MeshWalk, walk, DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -14,9 +14,10 @@
 #include <Kokkos_Core.hpp>
 #include <Teuchos_UnitTestHarness.hpp>
 
-// We only test DTK_HEX_8 and DTK_QUAD_4. Testing all the topologies would
-// require a lot of code (need to create a bunch of meshes) and the only
-// difference in the search is the template parameters in the Functor.
+// We only test DTK_HEX_8, DTK_QUAD_4, DTK_TET_4, and DTK_TRI_3. Testing all the
+// topologies would require a lot of code (need to create a bunch of meshes)
+// and the only difference in the search is the template parameters in the
+// Functor.
 
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, hex_8, DeviceType )
 {
@@ -241,6 +242,235 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, quad_4, DeviceType )
     }
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, mixed_topologies, DeviceType )
+{
+    unsigned int constexpr dim = 2;
+    unsigned int constexpr n_ref_pts = 4;
+
+    Kokkos::View<double * [dim], DeviceType> reference_points( "ref_pts",
+                                                               n_ref_pts );
+    Kokkos::View<bool *, DeviceType> point_in_cell( "pt_in_cell", n_ref_pts );
+    // Physical points are (0.5, 0.5) and (1.25, 0.25). Each point is a
+    // candidate for both cells.
+    Kokkos::View<double * [dim], DeviceType> physical_points( "phys_pts",
+                                                              n_ref_pts );
+    physical_points( 0, 0 ) = 0.5;
+    physical_points( 0, 1 ) = 0.5;
+    physical_points( 1, 0 ) = 1.25;
+    physical_points( 1, 1 ) = 0.25;
+    physical_points( 2, 0 ) = 1.25;
+    physical_points( 2, 1 ) = 0.25;
+    physical_points( 3, 0 ) = 0.5;
+    physical_points( 3, 1 ) = 0.5;
+    // Vertices of the cells: one quadrilateral and one triangle
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> cells;
+    cells[DTK_QUAD_4] =
+        Kokkos::View<double ***, DeviceType>( "quad_nodes", 1, 4, dim );
+    cells[DTK_QUAD_4]( 0, 0, 0 ) = 0.;
+    cells[DTK_QUAD_4]( 0, 0, 1 ) = 0.;
+    cells[DTK_QUAD_4]( 0, 1, 0 ) = 1.;
+    cells[DTK_QUAD_4]( 0, 1, 1 ) = 0.;
+    cells[DTK_QUAD_4]( 0, 2, 0 ) = 1.;
+    cells[DTK_QUAD_4]( 0, 2, 1 ) = 1.;
+    cells[DTK_QUAD_4]( 0, 3, 0 ) = 0.;
+    cells[DTK_QUAD_4]( 0, 3, 1 ) = 1.;
+    cells[DTK_TRI_3] =
+        Kokkos::View<double ***, DeviceType>( "tri_nodes", 1, 3, dim );
+    cells[DTK_TRI_3]( 0, 0, 0 ) = 1.;
+    cells[DTK_TRI_3]( 0, 0, 1 ) = 0.;
+    cells[DTK_TRI_3]( 0, 1, 0 ) = 2.;
+    cells[DTK_TRI_3]( 0, 1, 1 ) = 0.;
+    cells[DTK_TRI_3]( 0, 2, 0 ) = 1.;
+    cells[DTK_TRI_3]( 0, 2, 1 ) = 1.;
+    // Coarse search output: cells and their topologies
+    Kokkos::View<int *, DeviceType> coarse_srch_cells( "coarse_srch_cells",
+                                                       n_ref_pts );
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies(
+        "cell_topologies", n_ref_pts );
+    coarse_srch_cells( 0 ) = 0;
+    cell_topologies( 0 ) = DTK_QUAD_4;
+    coarse_srch_cells( 1 ) = 0;
+    cell_topologies( 1 ) = DTK_TRI_3;
+    coarse_srch_cells( 2 ) = 0;
+    cell_topologies( 2 ) = DTK_QUAD_4;
+    coarse_srch_cells( 3 ) = 0;
+    cell_topologies( 3 ) = DTK_TRI_3;
+
+    DataTransferKit::PointInCell<DeviceType>::search(
+        physical_points, cells, coarse_srch_cells, cell_topologies,
+        reference_points, point_in_cell );
+
+    auto reference_points_host = Kokkos::create_mirror_view( reference_points );
+    Kokkos::deep_copy( reference_points_host, reference_points );
+    auto point_in_cell_host = Kokkos::create_mirror_view( point_in_cell );
+    Kokkos::deep_copy( point_in_cell_host, point_in_cell );
+
+    std::vector<std::array<double, dim>> reference_points_ref = {
+        {{0., 0.}}, {{0.25, 0.25}}, {{1.5, -0.5}}, {{-0.5, 0.5}}};
+    std::vector<bool> point_in_cell_ref = {true, true, false, false};
+
+    double const tol = 1e-14;
+    for ( unsigned int i = 0; i < n_ref_pts; ++i )
+    {
+        for ( unsigned int j = 0; j < dim; ++j )
+            TEST_ASSERT( std::abs( reference_points_host( i, j ) -
+                                   reference_points_ref[i][j] ) < tol );
+        TEST_EQUALITY( point_in_cell_host( i ), point_in_cell_ref[i] );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, tet_4, DeviceType )
+{
+    unsigned int constexpr dim = 3;
+    unsigned int constexpr n_ref_pts = 2;
+
+    // Physical points are (0.5, 0.25, 1.) and (1., 0.5, 2.)
+    Kokkos::View<double * [dim], DeviceType> physical_points( "phys_pts",
+                                                              n_ref_pts );
+    physical_points( 0, 0 ) = 0.5;
+    physical_points( 0, 1 ) = 0.25;
+    physical_points( 0, 2 ) = 1.;
+    physical_points( 1, 0 ) = 1.;
+    physical_points( 1, 1 ) = 0.5;
+    physical_points( 1, 2 ) = 2.;
+    // Vertices of the cell
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> cells;
+    cells[DTK_TET_4] =
+        Kokkos::View<double ***, DeviceType>( "tet_nodes", 1, 4, dim );
+    Kokkos::deep_copy( cells[DTK_TET_4], 0. );
+    cells[DTK_TET_4]( 0, 1, 0 ) = 2.;
+    cells[DTK_TET_4]( 0, 2, 1 ) = 1.;
+    cells[DTK_TET_4]( 0, 3, 2 ) = 4.;
+    // Coarse search output: cells and their topologies
+    Kokkos::View<int *, DeviceType> coarse_srch_cells( "coarse_srch_cells",
+                                                       n_ref_pts );
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies(
+        "cell_topologies", n_ref_pts );
+    for ( unsigned int i = 0; i < n_ref_pts; ++i )
+    {
+        coarse_srch_cells( i ) = 0;
+        cell_topologies( i ) = DTK_TET_4;
+    }
+
+    std::vector<std::array<double, dim>> reference_points_ref = {
+        {{0.25, 0.25, 0.25}}, {{0.5, 0.5, 0.5}}};
+    std::vector<bool> point_in_cell_ref = {true, false};
+
+    // Search with the nodes of the cell and with its inverse map
+    std::array<Kokkos::View<double ***, DeviceType>, DTK_N_TOPO> inverse_maps;
+    inverse_maps[DTK_TET_4] =
+        DataTransferKit::PointInCell<DeviceType>::computeInverseMaps(
+            cells[DTK_TET_4], DTK_TET_4 );
+    for ( bool const use_inverse_maps : {false, true} )
+    {
+        Kokkos::View<double * [dim], DeviceType> reference_points(
+            "ref_pts", n_ref_pts );
+        Kokkos::View<bool *, DeviceType> point_in_cell( "pt_in_cell",
+                                                        n_ref_pts );
+        if ( use_inverse_maps )
+            DataTransferKit::PointInCell<DeviceType>::search(
+                physical_points, cells, inverse_maps, coarse_srch_cells,
+                cell_topologies, reference_points, point_in_cell );
+        else
+            DataTransferKit::PointInCell<DeviceType>::search(
+                physical_points, cells[DTK_TET_4], coarse_srch_cells,
+                DTK_TET_4, reference_points, point_in_cell );
+
+        auto reference_points_host =
+            Kokkos::create_mirror_view( reference_points );
+        Kokkos::deep_copy( reference_points_host, reference_points );
+        auto point_in_cell_host = Kokkos::create_mirror_view( point_in_cell );
+        Kokkos::deep_copy( point_in_cell_host, point_in_cell );
+
+        double const tol = 1e-14;
+        for ( unsigned int i = 0; i < n_ref_pts; ++i )
+        {
+            for ( unsigned int j = 0; j < dim; ++j )
+                TEST_ASSERT( std::abs( reference_points_host( i, j ) -
+                                       reference_points_ref[i][j] ) < tol );
+            TEST_EQUALITY( point_in_cell_host( i ), point_in_cell_ref[i] );
+        }
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, newton, DeviceType )
+{
+    using PointInCell = DataTransferKit::PointInCell<DeviceType>;
+    unsigned int constexpr dim = 2;
+    unsigned int constexpr n_ref_pts = 1;
+
+    // Physical point is the center of a trapezoid. The cell is not affine so
+    // the Newton solve is needed.
+    Kokkos::View<double * [dim], DeviceType> physical_points( "phys_pts",
+                                                              n_ref_pts );
+    physical_points( 0, 0 ) = 1.;
+    physical_points( 0, 1 ) = 0.5;
+    Kokkos::View<double * * [dim], DeviceType> cells( "cell_nodes", 1, 4 );
+    cells( 0, 0, 0 ) = 0.;
+    cells( 0, 0, 1 ) = 0.;
+    cells( 0, 1, 0 ) = 2.;
+    cells( 0, 1, 1 ) = 0.;
+    cells( 0, 2, 0 ) = 1.5;
+    cells( 0, 2, 1 ) = 1.;
+    cells( 0, 3, 0 ) = 0.5;
+    cells( 0, 3, 1 ) = 1.;
+    Kokkos::View<int *, DeviceType> coarse_srch_cells( "coarse_srch_cells",
+                                                       n_ref_pts );
+    coarse_srch_cells( 0 ) = 0;
+
+    Kokkos::View<double * [dim], DeviceType> reference_points( "ref_pts",
+                                                               n_ref_pts );
+    Kokkos::View<bool *, DeviceType> point_in_cell( "pt_in_cell", n_ref_pts );
+    Kokkos::View<int *, DeviceType> newton_iterations( "newton_iterations",
+                                                       n_ref_pts );
+    Kokkos::View<bool *, DeviceType> newton_converged( "newton_converged",
+                                                       n_ref_pts );
+    PointInCell::search( physical_points, cells, coarse_srch_cells,
+                         DTK_QUAD_4, reference_points, point_in_cell,
+                         newton_iterations, newton_converged );
+
+    auto reference_points_host = Kokkos::create_mirror_view( reference_points );
+    Kokkos::deep_copy( reference_points_host, reference_points );
+    auto point_in_cell_host = Kokkos::create_mirror_view( point_in_cell );
+    Kokkos::deep_copy( point_in_cell_host, point_in_cell );
+    auto newton_iterations_host =
+        Kokkos::create_mirror_view( newton_iterations );
+    Kokkos::deep_copy( newton_iterations_host, newton_iterations );
+    auto newton_converged_host = Kokkos::create_mirror_view( newton_converged );
+    Kokkos::deep_copy( newton_converged_host, newton_converged );
+
+    double const tol = 1e-14;
+    for ( unsigned int j = 0; j < dim; ++j )
+        TEST_ASSERT( std::abs( reference_points_host( 0, j ) ) < tol );
+    TEST_ASSERT( point_in_cell_host( 0 ) );
+    TEST_ASSERT( newton_converged_host( 0 ) );
+    int const n_iterations = newton_iterations_host( 0 );
+    TEST_ASSERT( n_iterations > 1 );
+    TEST_ASSERT( n_iterations <= PointInCell::newton_max_iterations );
+    std::vector<unsigned int> histogram = PointInCell::computeNewtonHistogram(
+        newton_iterations, newton_converged );
+    TEST_EQUALITY( histogram.size(),
+                   static_cast<size_t>( PointInCell::newton_max_iterations +
+                                        2 ) );
+    TEST_EQUALITY( histogram[n_iterations], 1u );
+
+    // The solve cannot converge in a single iteration
+    int const max_iterations = PointInCell::newton_max_iterations;
+    PointInCell::newton_max_iterations = 1;
+    PointInCell::search( physical_points, cells, coarse_srch_cells,
+                         DTK_QUAD_4, reference_points, point_in_cell,
+                         newton_iterations, newton_converged );
+    Kokkos::deep_copy( newton_iterations_host, newton_iterations );
+    Kokkos::deep_copy( newton_converged_host, newton_converged );
+    TEST_EQUALITY( newton_iterations_host( 0 ), 1 );
+    TEST_ASSERT( !newton_converged_host( 0 ) );
+    histogram = PointInCell::computeNewtonHistogram( newton_iterations,
+                                                     newton_converged );
+    TEST_EQUALITY( histogram.size(), 3u );
+    TEST_EQUALITY( histogram.back(), 1u );
+    PointInCell::newton_max_iterations = max_iterations;
+}
+
 // Include the test macros.
 #include "DataTransferKitDiscretization_ETIHelperMacros.h"
 
@@ -251,6 +481,12 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointInCell, quad_4, DeviceType )
                                           DeviceType##NODE )                   \
     using DeviceType##NODE = typename NODE::device_type;                       \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointInCell, quad_4,                 \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointInCell, mixed_topologies,       \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointInCell, tet_4,                  \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointInCell, newton,                 \
                                           DeviceType##NODE )
 
 // Demangle the types
@@ -437,6 +437,145 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointSearch, two_topo_two_dim, DeviceType )
                                            success, out );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointSearch, reuse_mesh, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    unsigned int constexpr dim = 3;
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies_view;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    std::vector<unsigned int> n_subdivisions = {{5, 5, 3}};
+    std::tie( cell_topologies_view, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+
+    // The mesh is processed once and searched twice
+    DataTransferKit::PointSearch<DeviceType> pt_search(
+        comm, cell_topologies_view, cells, coordinates );
+
+    Kokkos::View<double * [dim], DeviceType> far_points_coord(
+        "far_points_coord", 1 );
+    Kokkos::deep_copy( far_points_coord, 10000. );
+    pt_search.search( far_points_coord );
+
+    Kokkos::View<int *, DeviceType> ranks;
+    Kokkos::View<int *, DeviceType> cell_indices;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> reference_points;
+    Kokkos::View<unsigned int *, DeviceType> query_ids;
+    std::tie( ranks, cell_indices, reference_points, query_ids ) =
+        pt_search.getSearchResults();
+    TEST_EQUALITY( query_ids.extent( 0 ), 0 );
+
+    Kokkos::View<double * [dim], DeviceType> points_coord =
+        getPointsCoord3D<DeviceType>( comm );
+    pt_search.search( points_coord );
+    std::tie( ranks, cell_indices, reference_points, query_ids ) =
+        pt_search.getSearchResults();
+
+    // Compare with a search done from scratch. The same operations are
+    // performed in the same order so the results must match exactly.
+    DataTransferKit::PointSearch<DeviceType> ref_pt_search(
+        comm, cell_topologies_view, cells, coordinates, points_coord );
+    Kokkos::View<int *, DeviceType> ref_ranks;
+    Kokkos::View<int *, DeviceType> ref_cell_indices;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> ref_reference_points;
+    Kokkos::View<unsigned int *, DeviceType> ref_query_ids;
+    std::tie( ref_ranks, ref_cell_indices, ref_reference_points,
+              ref_query_ids ) = ref_pt_search.getSearchResults();
+
+    auto toVector =
+        []( Kokkos::View<int *, DeviceType> v ) -> std::vector<int> {
+        auto v_host = Kokkos::create_mirror_view( v );
+        Kokkos::deep_copy( v_host, v );
+        return std::vector<int>( v_host.data(), v_host.data() + v.extent( 0 ) );
+    };
+    TEST_COMPARE_ARRAYS( toVector( ranks ), toVector( ref_ranks ) );
+    TEST_COMPARE_ARRAYS( toVector( cell_indices ),
+                         toVector( ref_cell_indices ) );
+
+    auto query_ids_host = Kokkos::create_mirror_view( query_ids );
+    Kokkos::deep_copy( query_ids_host, query_ids );
+    auto ref_query_ids_host = Kokkos::create_mirror_view( ref_query_ids );
+    Kokkos::deep_copy( ref_query_ids_host, ref_query_ids );
+    auto reference_points_host = Kokkos::create_mirror_view( reference_points );
+    Kokkos::deep_copy( reference_points_host, reference_points );
+    auto ref_reference_points_host =
+        Kokkos::create_mirror_view( ref_reference_points );
+    Kokkos::deep_copy( ref_reference_points_host, ref_reference_points );
+    TEST_EQUALITY( query_ids_host.extent( 0 ), ref_query_ids_host.extent( 0 ) );
+    for ( unsigned int i = 0; i < query_ids_host.extent( 0 ); ++i )
+    {
+        TEST_EQUALITY( query_ids_host( i ), ref_query_ids_host( i ) );
+        for ( unsigned int d = 0; d < dim; ++d )
+            TEST_EQUALITY( reference_points_host( i )[d],
+                           ref_reference_points_host( i )[d] );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointSearch, index_nodes, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    unsigned int constexpr dim = 3;
+    Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies_view;
+    Kokkos::View<unsigned int *, DeviceType> cells;
+    Kokkos::View<double **, DeviceType> coordinates;
+    std::vector<unsigned int> n_subdivisions = {{5, 5, 3}};
+    std::tie( cell_topologies_view, cells, coordinates ) =
+        buildStructuredMesh<DeviceType>( comm, n_subdivisions );
+    Kokkos::View<double * [dim], DeviceType> points_coord =
+        getPointsCoord3D<DeviceType>( comm );
+
+    // The nodes of the cells are gathered on the fly instead of being copied
+    // but the computations are the same so the results must match exactly.
+    DataTransferKit::PointSearch<DeviceType> pt_search(
+        comm, cell_topologies_view, cells, coordinates, false, true );
+    pt_search.search( points_coord );
+    Kokkos::View<int *, DeviceType> ranks;
+    Kokkos::View<int *, DeviceType> cell_indices;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> reference_points;
+    Kokkos::View<unsigned int *, DeviceType> query_ids;
+    std::tie( ranks, cell_indices, reference_points, query_ids ) =
+        pt_search.getSearchResults();
+
+    DataTransferKit::PointSearch<DeviceType> ref_pt_search(
+        comm, cell_topologies_view, cells, coordinates, points_coord );
+    Kokkos::View<int *, DeviceType> ref_ranks;
+    Kokkos::View<int *, DeviceType> ref_cell_indices;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> ref_reference_points;
+    Kokkos::View<unsigned int *, DeviceType> ref_query_ids;
+    std::tie( ref_ranks, ref_cell_indices, ref_reference_points,
+              ref_query_ids ) = ref_pt_search.getSearchResults();
+
+    auto toVector =
+        []( Kokkos::View<int *, DeviceType> v ) -> std::vector<int> {
+        auto v_host = Kokkos::create_mirror_view( v );
+        Kokkos::deep_copy( v_host, v );
+        return std::vector<int>( v_host.data(), v_host.data() + v.extent( 0 ) );
+    };
+    TEST_COMPARE_ARRAYS( toVector( ranks ), toVector( ref_ranks ) );
+    TEST_COMPARE_ARRAYS( toVector( cell_indices ),
+                         toVector( ref_cell_indices ) );
+
+    auto query_ids_host = Kokkos::create_mirror_view( query_ids );
+    Kokkos::deep_copy( query_ids_host, query_ids );
+    auto ref_query_ids_host = Kokkos::create_mirror_view( ref_query_ids );
+    Kokkos::deep_copy( ref_query_ids_host, ref_query_ids );
+    auto reference_points_host = Kokkos::create_mirror_view( reference_points );
+    Kokkos::deep_copy( reference_points_host, reference_points );
+    auto ref_reference_points_host =
+        Kokkos::create_mirror_view( ref_reference_points );
+    Kokkos::deep_copy( ref_reference_points_host, ref_reference_points );
+    TEST_EQUALITY( query_ids_host.extent( 0 ), ref_query_ids_host.extent( 0 ) );
+    for ( unsigned int i = 0; i < query_ids_host.extent( 0 ); ++i )
+    {
+        TEST_EQUALITY( query_ids_host( i ), ref_query_ids_host( i ) );
+        for ( unsigned int d = 0; d < dim; ++d )
+            TEST_EQUALITY( reference_points_host( i )[d],
+                           ref_reference_points_host( i )[d] );
+    }
+}
+
 // Include the test macros.
 #include "DataTransferKitDiscretization_ETIHelperMacros.h"
 
@@ -448,6 +587,10 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PointSearch, two_topo_two_dim, DeviceType )
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         PointSearch, one_topo_three_dim_no_point_found, DeviceType##NODE )     \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointSearch, two_topo_two_dim,       \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointSearch, reuse_mesh,             \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PointSearch, index_nodes,            \
                                           DeviceType##NODE )
 
 // Demangle the types
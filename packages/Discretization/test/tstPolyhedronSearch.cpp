@@ -0,0 +1,132 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_PolyhedronSearch.hpp>
+
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <array>
+#include <vector>
+
+template <typename T, typename DeviceType>
+Kokkos::View<T *, DeviceType> toView( std::vector<T> const &v,
+                                      std::string const &label )
+{
+    Kokkos::View<T *, DeviceType> view( label, v.size() );
+    auto view_host = Kokkos::create_mirror_view( view );
+    for ( unsigned int i = 0; i < v.size(); ++i )
+        view_host( i ) = v[i];
+    Kokkos::deep_copy( view, view_host );
+    return view;
+}
+
+template <typename DeviceType>
+Kokkos::View<double **, DeviceType>
+toCoordinatesView( std::vector<std::array<double, 3>> const &v,
+                   std::string const &label )
+{
+    Kokkos::View<double **, DeviceType> view( label, v.size(), 3 );
+    auto view_host = Kokkos::create_mirror_view( view );
+    for ( unsigned int i = 0; i < v.size(); ++i )
+        for ( int d = 0; d < 3; ++d )
+            view_host( i, d ) = v[i][d];
+    Kokkos::deep_copy( view, view_host );
+    return view;
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( PolyhedronSearch, search, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+
+    // Each processor owns a unit cube and a triangular prism in the slab
+    // comm_rank < z < comm_rank + 1. They share the face x = 1 which is
+    // oriented outward for the cube and inward for the prism.
+    double const z = comm_rank;
+    std::vector<std::array<double, 3>> coordinates = {
+        {{0., 0., z}},      {{1., 0., z}},      {{1., 1., z}},
+        {{0., 1., z}},      {{2., 0., z}},      {{0., 0., z + 1.}},
+        {{1., 0., z + 1.}}, {{1., 1., z + 1.}}, {{0., 1., z + 1.}},
+        {{2., 0., z + 1.}}};
+    std::vector<unsigned int> faces = {0, 3, 2, 1, 5, 6, 7, 8, 0, 5, 8, 3,
+                                       0, 1, 6, 5, 3, 8, 7, 2, 1, 2, 7, 6,
+                                       1, 2, 4, 6, 9, 7, 1, 4, 9, 6, 4, 2,
+                                       7, 9};
+    std::vector<unsigned int> nodes_per_face = {4, 4, 4, 4, 4, 4, 3, 3, 4, 4};
+    std::vector<unsigned int> cells = {0, 1, 2, 3, 4, 5, 5, 6, 7, 8, 9};
+    std::vector<unsigned int> faces_per_cell = {6, 5};
+    std::vector<int> face_orientation = {1, 1, 1, 1, 1, 1, -1, 1, 1, 1, 1};
+
+    DataTransferKit::PolyhedronSearch<DeviceType> polyhedron_search(
+        comm, toCoordinatesView<DeviceType>( coordinates, "coordinates" ),
+        toView<unsigned int, DeviceType>( faces, "faces" ),
+        toView<unsigned int, DeviceType>( nodes_per_face, "nodes_per_face" ),
+        toView<unsigned int, DeviceType>( cells, "cells" ),
+        toView<unsigned int, DeviceType>( faces_per_cell, "faces_per_cell" ),
+        toView<int, DeviceType>( face_orientation, "face_orientation" ) );
+
+    // The first two points are in the cube and in the prism, the third one is
+    // in the bounding box of the prism but not in the prism, the fourth one
+    // is in the cube of the next processor and the last one is outside of
+    // the mesh.
+    std::vector<std::array<double, 3>> points = {
+        {{0.5, 0.5, z + 0.5}},
+        {{1.25, 0.25, z + 0.5}},
+        {{1.75, 0.75, z + 0.5}},
+        {{0.5, 0.5, ( comm_rank + 1 ) % comm_size + 0.5}},
+        {{3., 3., z + 0.5}}};
+    polyhedron_search.search(
+        toCoordinatesView<DeviceType>( points, "points" ) );
+
+    Kokkos::View<int *, DeviceType> ranks;
+    Kokkos::View<int *, DeviceType> cell_indices;
+    Kokkos::View<unsigned int *, DeviceType> query_ids;
+    std::tie( ranks, cell_indices, query_ids ) =
+        polyhedron_search.getSearchResults();
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    Kokkos::deep_copy( ranks_host, ranks );
+    auto cell_indices_host = Kokkos::create_mirror_view( cell_indices );
+    Kokkos::deep_copy( cell_indices_host, cell_indices );
+    auto query_ids_host = Kokkos::create_mirror_view( query_ids );
+    Kokkos::deep_copy( query_ids_host, query_ids );
+
+    std::vector<int> ranks_ref = {comm_rank, comm_rank,
+                                  ( comm_rank + 1 ) % comm_size};
+    std::vector<int> cell_indices_ref = {0, 1, 0};
+    std::vector<unsigned int> query_ids_ref = {0, 1, 3};
+    TEST_EQUALITY( ranks_host.extent_int( 0 ), 3 );
+    TEST_EQUALITY( cell_indices_host.extent_int( 0 ), 3 );
+    TEST_EQUALITY( query_ids_host.extent_int( 0 ), 3 );
+    for ( int i = 0; i < 3; ++i )
+    {
+        TEST_EQUALITY( ranks_host( i ), ranks_ref[i] );
+        TEST_EQUALITY( cell_indices_host( i ), cell_indices_ref[i] );
+        TEST_EQUALITY( query_ids_host( i ), query_ids_ref[i] );
+    }
+}
+
+// Include the test macros.
+#include "DataTransferKitDiscretization_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( PolyhedronSearch, search,            \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -56,6 +56,39 @@ void NodeListDataFunctionWrapper( std::shared_ptr<void> user_data,
     u.first( u.second, coordinates.data() );
 }
 
+void NodeListViewFunctionWrapper( std::shared_ptr<void> user_data,
+                                  Coordinate *&coordinates, unsigned &space_dim,
+                                  size_t &local_num_nodes, size_t &node_stride,
+                                  size_t &dim_stride )
+{
+    auto u = get_function<DTK_NodeListViewFunction>( user_data );
+    u.first( u.second, &coordinates, &space_dim, &local_num_nodes,
+             &node_stride, &dim_stride );
+}
+
+// Storage registered with DTK_setNodeListStorage().
+struct DTK_NodeListStorage
+{
+    Coordinate *coordinates;
+    unsigned space_dim;
+    size_t local_num_nodes;
+    size_t node_stride;
+    size_t dim_stride;
+};
+
+void NodeListStorageFunction( std::shared_ptr<void> user_data,
+                              Coordinate *&coordinates, unsigned &space_dim,
+                              size_t &local_num_nodes, size_t &node_stride,
+                              size_t &dim_stride )
+{
+    auto storage = std::static_pointer_cast<DTK_NodeListStorage>( user_data );
+    coordinates = storage->coordinates;
+    space_dim = storage->space_dim;
+    local_num_nodes = storage->local_num_nodes;
+    node_stride = storage->node_stride;
+    dim_stride = storage->dim_stride;
+}
+
 void BoundingVolumeListSizeFunctionWrapper( std::shared_ptr<void> user_data,
                                             unsigned &space_dim,
                                             size_t &local_num_volumes )
@@ -360,6 +393,10 @@ void DTK_setUserFunction( DTK_UserApplicationHandle handle,
             dtk->_registry->setNodeListDataFunction(
                 NodeListDataFunctionWrapper, data );
             break;
+        case DTK_NODE_LIST_VIEW_FUNCTION:
+            dtk->_registry->setNodeListViewFunction(
+                NodeListViewFunctionWrapper, data );
+            break;
         case DTK_BOUNDING_VOLUME_LIST_SIZE_FUNCTION:
             dtk->_registry->setBoundingVolumeListSizeFunction(
                 BoundingVolumeListSizeFunctionWrapper, data );
@@ -439,6 +476,64 @@ void DTK_setUserFunction( DTK_UserApplicationHandle handle,
     }
 }
 
+void DTK_setNodeListStorage( DTK_UserApplicationHandle handle,
+                             Coordinate *coordinates, unsigned space_dim,
+                             size_t local_num_nodes, size_t node_stride,
+                             size_t dim_stride )
+{
+    errno = DTK_SUCCESS;
+
+    using namespace DataTransferKit;
+
+    if ( !DTK_isValidUserApplication( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    try
+    {
+        auto dtk = reinterpret_cast<DTK_Registry *>( handle );
+        auto storage = std::make_shared<DTK_NodeListStorage>(
+            DTK_NodeListStorage{coordinates, space_dim, local_num_nodes,
+                                node_stride, dim_stride} );
+        dtk->_registry->setNodeListViewFunction( NodeListStorageFunction,
+                                                 storage );
+    }
+    catch ( ... )
+    {
+        errno = DTK_UNKNOWN;
+    }
+}
+
+void DTK_setFieldStorage( DTK_UserApplicationHandle handle,
+                          const char *field_name, double *field_dofs,
+                          size_t local_num_dofs, unsigned field_dimension,
+                          size_t stride )
+{
+    errno = DTK_SUCCESS;
+
+    using namespace DataTransferKit;
+
+    if ( !DTK_isValidUserApplication( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    try
+    {
+        auto dtk = reinterpret_cast<DTK_Registry *>( handle );
+        dtk->_registry->setFieldStorage( field_name, field_dofs,
+                                         local_num_dofs, field_dimension,
+                                         stride );
+    }
+    catch ( ... )
+    {
+        errno = DTK_UNKNOWN;
+    }
+}
+
 const char *DTK_error( int err )
 {
     errno = DTK_SUCCESS;
@@ -70,8 +70,16 @@ extern const char *DTK_gitCommitHash();
  */
 typedef struct _DTK_UserApplicationHandle *DTK_UserApplicationHandle;
 
-/** \brief Memory space (where memory is allocated) */
-typedef enum { DTK_HOST_SPACE, DTK_CUDAUVM_SPACE } DTK_MemorySpace;
+/** \brief Memory space (where memory is allocated)
+ *
+ *  The callback functions of a user application created in DTK_CUDA_SPACE
+ *  receive pointers to device memory. They are not accessible from the host.
+ */
+typedef enum {
+    DTK_HOST_SPACE,
+    DTK_CUDAUVM_SPACE,
+    DTK_CUDA_SPACE
+} DTK_MemorySpace;
 
 /** \brief Execution space (where functions execute) */
 typedef enum { DTK_SERIAL, DTK_OPENMP, DTK_CUDA } DTK_ExecutionSpace;
@@ -141,13 +149,44 @@ typedef struct _DTK_MapHandle *DTK_MapHandle;
  *                        "\"OptionBarDouble\": 1.32 }";
  *  \endcode
  *
+ *  The "Moving Least Squares" map selects its radial basis function with the
+ *  "RBF" option, one of "Wendland0" (default), "Wendland2", "Wendland4",
+ *  "Wendland6", "Wu2", "Wu4", "Buhmann2", "Buhmann3", or "Buhmann4", and
+ *  its polynomial basis with the "Order" option, "Linear" (default) or
+ *  "Quadratic". The neighborhood of a target node is made of its "Number of
+ *  Neighbors" closest source nodes or, if "Support Radius" is given, of the
+ *  source nodes within that distance.
+ *
+ *  The "Consistent Interpolation" map evaluates a finite element field of the
+ *  source at the nodes of the target. It reads the cell list and the
+ *  degree-of-freedom map of the source instead of its node list. The
+ *  "Finite Element Type" option is one of "HGRAD" (default), "HDIV", or
+ *  "HCURL". Target nodes that are outside of the source mesh are set to zero.
+ *
+ *  While a map from the same source application over the same communicator
+ *  exists, a new map reuses its source node coordinates and its search tree
+ *  over the source nodes instead of calling the node list callbacks of the
+ *  source again. Set the boolean option "Reuse Geometry" to false to read the
+ *  geometry again, e.g., after the nodes have moved.
+ *
+ *  The source and the target may be held by different processes, e.g., by
+ *  two programs coupled in an MPMD job, in which case comm may be an
+ *  inter-communicator between them. A process passes a null handle for the
+ *  application it does not hold. The processes that hold neither
+ *  application only take part in the creation of the map: they are left out
+ *  of all the later communication, and applying the map does nothing there.
+ *
  *  \param space Execution space where the map will execute.
  *
- *  \param[in] comm The MPI communicator over which to build the map.
+ *  \param[in] comm The MPI communicator over which to build the map. It may
+ *  be an inter-communicator, in which case the map is built over both of its
+ *  groups.
  *
- *  \param[in] source Handle to the source application.
+ *  \param[in] source Handle to the source application, or null if the
+ *  process does not hold it.
  *
- *  \param[in,out] target Handle to the target application.
+ *  \param[in,out] target Handle to the target application, or null if the
+ *  process does not hold it.
  *
  *  \param[in] options Options string for building the map.
  *
@@ -158,6 +197,34 @@ extern DTK_MapHandle DTK_createMap( DTK_ExecutionSpace space, MPI_Comm comm,
                                     DTK_UserApplicationHandle target,
                                     const char *options );
 
+/** \brief Create a DTK handle to a map without setting it up.
+ *
+ *  Same as DTK_createMap() but only the options are checked and the group
+ *  of processes of the map is set up. The map is set up in two phases, each
+ *  of which may be started separately with DTK_setupMapGeometryAsync() and
+ *  DTK_setupMapOperatorAsync(). The phases that have not been done when the
+ *  map is first applied are done then. The creation itself is a collective
+ *  call over comm but it does not call the application.
+ *
+ *  \param space Execution space where the map will execute.
+ *
+ *  \param[in] comm The MPI communicator over which to build the map. The map
+ *  works over a communicator of its own so comm may be freed afterwards.
+ *
+ *  \param[in] source Handle to the source application, or null.
+ *
+ *  \param[in,out] target Handle to the target application, or null.
+ *
+ *  \param[in] options Options string for building the map.
+ *
+ *  \return DTK_createMapDeferred returns a handle for the map.
+ */
+extern DTK_MapHandle DTK_createMapDeferred( DTK_ExecutionSpace space,
+                                            MPI_Comm comm,
+                                            DTK_UserApplicationHandle source,
+                                            DTK_UserApplicationHandle target,
+                                            const char *options );
+
 /** \brief Indicates whether a DTK handle to a map is valid.
  *
  *  A handle is valid if it was created by DTK_create() and has not yet been
@@ -180,6 +247,163 @@ extern bool DTK_isValidMap( DTK_MapHandle handle );
 extern void DTK_applyMap( DTK_MapHandle handle, const char *source_field,
                           const char *target_field );
 
+/** \brief Apply the DTK map to several fields at once.
+ *
+ *  All the fields are transferred with a single application of the map so
+ *  that their values are communicated together. The i-th source field is
+ *  transferred to the i-th target field and both must have the same
+ *  dimension.
+ *
+ *  \param[in] handle Map handle.
+ *
+ *  \param[in] num_fields Number of fields to transfer.
+ *
+ *  \param[in] source_fields Names of the fields in the source application.
+ *
+ *  \param[in] target_fields Names of the fields in the target application.
+ */
+extern void DTK_applyMapFields( DTK_MapHandle handle, int num_fields,
+                                const char **source_fields,
+                                const char **target_fields );
+
+/** \brief Apply several DTK maps at once.
+ *
+ *  The source values of all the maps are communicated with a single
+ *  exchange instead of one per map, so that the latency is paid once for
+ *  all of them. The i-th map transfers the i-th source field to the i-th
+ *  target field. The maps must have been created over the same group of
+ *  processes. The maps whose operator cannot be part of the combined
+ *  exchange, i.e. consistent interpolations, are applied on their own.
+ *
+ *  \param[in] num_maps Number of maps to apply.
+ *
+ *  \param[in] handles Map handles.
+ *
+ *  \param[in] source_fields Names of the fields in the source applications.
+ *
+ *  \param[in] target_fields Names of the fields in the target applications.
+ */
+extern void DTK_applyMapGroup( int num_maps, DTK_MapHandle *handles,
+                               const char **source_fields,
+                               const char **target_fields );
+
+/** \brief DTK request handle to a pending map application.
+ *
+ *  Returned by DTK_applyMapAsync(), DTK_setupMapGeometryAsync(), and
+ *  DTK_setupMapOperatorAsync() and completed by DTK_waitMap() or
+ *  DTK_testMap(), which reset it to NULL.
+ */
+typedef struct _DTK_MapRequest *DTK_MapRequest;
+
+/** \brief Start applying the DTK map to the given fields.
+ *
+ *  The source field is read before the function returns so the source
+ *  application may modify it right away. The target field is only written
+ *  when the request completes. When MPI provides MPI_THREAD_MULTIPLE, the
+ *  operator is applied in the background and its communications overlap
+ *  with the work of the application. Otherwise, it is applied when the
+ *  request is completed. In the meantime, the map must neither be applied
+ *  nor destroyed and the application must not launch work in the execution
+ *  space of the map.
+ *
+ *  \param[in] handle Map handle.
+ *
+ *  \param[in] source_field Name of the field in the source application.
+ *
+ *  \param[in] target_field Name of the field in the target application.
+ *
+ *  \param[out] request Handle to the pending map application.
+ */
+extern void DTK_applyMapAsync( DTK_MapHandle handle, const char *source_field,
+                               const char *target_field,
+                               DTK_MapRequest *request );
+
+/** \brief Wait for a map application started by DTK_applyMapAsync().
+ *
+ *  The target field is pushed to the target application before the function
+ *  returns. The request is reset to NULL. Waiting on a NULL request returns
+ *  immediately.
+ *
+ *  \param[in,out] request Handle to the pending map application.
+ */
+extern void DTK_waitMap( DTK_MapRequest *request );
+
+/** \brief Test whether a map application started by DTK_applyMapAsync() is
+ *  complete.
+ *
+ *  If it is, the target field is pushed to the target application and the
+ *  request is reset to NULL, as in DTK_waitMap().
+ *
+ *  \param[in,out] request Handle to the pending map application.
+ *
+ *  \return true if the map application is complete; false otherwise.
+ */
+extern bool DTK_testMap( DTK_MapRequest *request );
+
+/** \brief Start the geometry phase of the setup of a map created by
+ *  DTK_createMapDeferred().
+ *
+ *  The coordinates of the source nodes are read and the search tree over
+ *  them is built. Only the callbacks of the source application are called,
+ *  e.g., this may overlap with the initialization of the target
+ *  application. The phase runs in the background under the same conditions
+ *  as DTK_applyMapAsync() and with the same restrictions until the request
+ *  completes. It is completed with DTK_waitMap() or DTK_testMap(). This is a
+ *  collective call.
+ *
+ *  \param[in] handle Map handle.
+ *
+ *  \param[out] request Handle to the pending setup.
+ */
+extern void DTK_setupMapGeometryAsync( DTK_MapHandle handle,
+                                       DTK_MapRequest *request );
+
+/** \brief Start the operator phase of the setup of a map created by
+ *  DTK_createMapDeferred().
+ *
+ *  The coordinates of the target nodes are read, their neighbors are
+ *  searched, and the operator, e.g., the coefficients of a moving least
+ *  squares map, is computed. The geometry phase is done first if it has not
+ *  been already. Otherwise, same as DTK_setupMapGeometryAsync(). This is a
+ *  collective call.
+ *
+ *  \param[in] handle Map handle.
+ *
+ *  \param[out] request Handle to the pending setup.
+ */
+extern void DTK_setupMapOperatorAsync( DTK_MapHandle handle,
+                                       DTK_MapRequest *request );
+
+/** \brief Get the time spent in each phase of the map and its communication
+ *  counters.
+ *
+ *  The statistics are accumulated on the calling process since the creation
+ *  of the map and are returned as a JSON object of the form
+ *  <tt>{"times": {"search": 0.1, ...}, "counts": {"bytes sent": 1024,
+ *  ...}}</tt>. Times are in seconds and exclusive: the time spent in a nested
+ *  phase, e.g. the communication during the search, is only counted in the
+ *  innermost phase. The phases are:
+ *   - "create map", "apply operator": the remainder of DTK_createMap() and of
+ *     the application of the operator
+ *   - "read coordinates", "pull source field", "push target field": the
+ *     exchanges with the applications, including the user functions
+ *   - "tree construction", "search": building and querying the search tree
+ *   - "coefficients": the computation of the coefficients of a moving least
+ *     squares map, including the pseudo-inverse of the moment matrices
+ *   - "interpolation": the local application of the coefficients
+ *   - "communication": the exchanges between processes
+ *
+ *  The counters are "bytes sent", "messages sent", "forwarded queries", and
+ *  "operator applications".
+ *
+ *  \param[in] handle Map handle.
+ *
+ *  \return The statistics. The string is owned by the map and is valid until
+ *  the next call to this function or until the map is destroyed. NULL if the
+ *  handle is not valid.
+ */
+extern const char *DTK_getMapStatistics( DTK_MapHandle handle );
+
 /** \brief Destroy a DTK handle to a map.
  *
  *  \param[in,out] handle map handle.
@@ -188,6 +412,125 @@ extern void DTK_destroyMap( DTK_MapHandle handle );
 
 /**@}*/
 
+/**
+ * \defgroup c_interface_to_search Interface to the distributed search.
+ * @{
+ */
+
+/** \brief DTK search tree handle.
+ *
+ *  Must be created using DTK_createSearchTree() to be a valid handle.
+ *
+ *  <!--
+ *  Use incomplete types to differentiate between handles.
+ *  We never define the incomplete structs.
+ *  -->
+ */
+typedef struct _DTK_SearchTreeHandle *DTK_SearchTreeHandle;
+
+/** \brief Create a distributed search tree over points.
+ *
+ *  The coordinates are read where they are, without being copied, so they
+ *  must be accessible from the execution space, e.g., a NumPy array for
+ *  DTK_SERIAL or DTK_OPENMP and a CuPy array for DTK_CUDA. Coordinate d of
+ *  point n is coordinates[n * point_stride + d * dim_stride]. They are only
+ *  read during this call. This is a collective call.
+ *
+ *  \param space Execution space where the search will execute.
+ *
+ *  \param[in] comm The MPI communicator over which to build the tree. It must
+ *  remain valid until the tree is destroyed.
+ *
+ *  \param[in] coordinates Coordinates of the points owned by this process.
+ *
+ *  \param[in] space_dim Spatial dimension, 2 or 3.
+ *
+ *  \param[in] local_num_points Number of points owned by this process.
+ *
+ *  \param[in] point_stride Distance between two consecutive points.
+ *
+ *  \param[in] dim_stride Distance between two consecutive coordinates of a
+ *  point.
+ *
+ *  \return DTK_createSearchTree returns a handle for the tree.
+ */
+extern DTK_SearchTreeHandle
+DTK_createSearchTree( DTK_ExecutionSpace space, MPI_Comm comm,
+                      Coordinate const *coordinates, unsigned space_dim,
+                      size_t local_num_points, size_t point_stride,
+                      size_t dim_stride );
+
+/** \brief Indicates whether a DTK handle to a search tree is valid.
+ *
+ *  \param[in] handle The DTK search tree handle to check.
+ *
+ *  \return true if the given search tree handle is valid; false otherwise.
+ */
+extern bool DTK_isValidSearchTree( DTK_SearchTreeHandle handle );
+
+/** \brief Search the k closest points in the tree of each query point.
+ *
+ *  The query points have the dimension of the tree and are read as in
+ *  DTK_createSearchTree(). The results are kept by the tree until
+ *  DTK_getSearchResults() is called. This is a collective call.
+ *
+ *  \param[in] handle Search tree handle.
+ *
+ *  \param[in] points Coordinates of the query points.
+ *
+ *  \param[in] num_points Number of query points.
+ *
+ *  \param[in] point_stride Distance between two consecutive query points.
+ *
+ *  \param[in] dim_stride Distance between two consecutive coordinates of a
+ *  query point.
+ *
+ *  \param[in] k Number of neighbors to search.
+ *
+ *  \param[out] num_results Total number of neighbors found.
+ */
+extern void DTK_searchNearest( DTK_SearchTreeHandle handle,
+                               Coordinate const *points, size_t num_points,
+                               size_t point_stride, size_t dim_stride,
+                               unsigned k, size_t *num_results );
+
+/** \brief Search the points in the tree within a radius of each query point.
+ *
+ *  Same as DTK_searchNearest() with the points closer than \p radius instead
+ *  of the k closest ones.
+ */
+extern void DTK_searchWithin( DTK_SearchTreeHandle handle,
+                              Coordinate const *points, size_t num_points,
+                              size_t point_stride, size_t dim_stride,
+                              double radius, size_t *num_results );
+
+/** \brief Get the results of the last search.
+ *
+ *  The results of query point q are stored from offset[q] to offset[q+1]-1.
+ *  They are written directly into the given arrays, which must be accessible
+ *  from the execution space of the tree.
+ *
+ *  \param[in] handle Search tree handle.
+ *
+ *  \param[out] offset Array of num_points + 1 offsets.
+ *
+ *  \param[out] indices Array of num_results local indices of the points found
+ *  on the process that owns them.
+ *
+ *  \param[out] ranks Array of num_results ranks of the processes that own the
+ *  points found.
+ */
+extern void DTK_getSearchResults( DTK_SearchTreeHandle handle, int *offset,
+                                  int *indices, int *ranks );
+
+/** \brief Destroy a DTK handle to a search tree.
+ *
+ *  \param[in,out] handle search tree handle.
+ */
+extern void DTK_destroySearchTree( DTK_SearchTreeHandle handle );
+
+/**@}*/
+
 /**
  * \defgroup c_interface_to_dtk_core Initialize/finalize DTK
  * @{
@@ -290,6 +633,7 @@ typedef enum {
     DTK_PULL_FIELD_DATA_FUNCTION /** See DTK_PullFieldDataFunction() */,
     DTK_PUSH_FIELD_DATA_FUNCTION /** See DTK_PushFieldDataFunction() */,
     DTK_EVALUATE_FIELD_FUNCTION /** See DTK_EvaluateFieldFunction() */,
+    DTK_NODE_LIST_VIEW_FUNCTION /** See DTK_NodeListViewFunction() */,
 } DTK_FunctionType;
 // clang-format on
 
@@ -308,6 +652,53 @@ extern void DTK_setUserFunction( DTK_UserApplicationHandle handle,
                                  DTK_FunctionType type, void ( *f )(),
                                  void *user_data );
 
+/** \brief Register the storage of the coordinates of the nodes.
+ *
+ *  The maps read the coordinates from the registered storage directly, as
+ *  with a DTK_NodeListViewFunction(), instead of calling the node list size
+ *  and data callback functions. Coordinate d of node n is
+ *  coordinates[n * node_stride + d * dim_stride], e.g., node_stride = 1 and
+ *  dim_stride = local_num_nodes for a Fortran array dimensioned
+ *  (local_num_nodes, space_dim). The storage must be allocated in the memory
+ *  space of the user application and must remain valid until the maps that
+ *  use it have been created.
+ *
+ *  \param[in,out] handle User application handle.
+ *  \param[in] coordinates Coordinates of the nodes owned by this process.
+ *  \param[in] space_dim Spatial dimension.
+ *  \param[in] local_num_nodes Number of nodes owned by this process.
+ *  \param[in] node_stride Distance between two consecutive nodes.
+ *  \param[in] dim_stride Distance between two consecutive coordinates of a
+ *             node.
+ */
+extern void DTK_setNodeListStorage( DTK_UserApplicationHandle handle,
+                                    Coordinate *coordinates,
+                                    unsigned space_dim, size_t local_num_nodes,
+                                    size_t node_stride, size_t dim_stride );
+
+/** \brief Register the storage of a field.
+ *
+ *  The maps read the source fields from and write the target fields into the
+ *  registered storage directly. The size, pull, and push callback functions
+ *  are not called for this field. The storage must be allocated in the
+ *  memory space of the user application and must outlive the maps that use
+ *  it.
+ *
+ *  \param[in,out] handle User application handle.
+ *  \param[in] field_name Name of the field.
+ *  \param[in] field_dofs Degrees of freedom for that field. Component d of
+ *             dof n is field_dofs[d * stride + n].
+ *  \param[in] local_num_dofs Number of degrees of freedom owned by this
+ *             process.
+ *  \param[in] field_dimension Dimension of the field.
+ *  \param[in] stride Distance between two components of a dof. It must be at
+ *             least local_num_dofs.
+ */
+extern void DTK_setFieldStorage( DTK_UserApplicationHandle handle,
+                                 const char *field_name, double *field_dofs,
+                                 size_t local_num_dofs,
+                                 unsigned field_dimension, size_t stride );
+
 /**
  * \defgroup c_interface_callbacks Prototype declaration of the callback
  * functions.
@@ -339,6 +730,34 @@ typedef void ( *DTK_NodeListSizeFunction )( void *user_data,
 typedef void ( *DTK_NodeListDataFunction )( void *user_data,
                                             Coordinate *coordinates );
 
+/** \brief Prototype function to get a view of the node coordinates stored by
+ *  the application.
+ *
+ *  Register with a user application using DTK_setUserFunction() by passing
+ *  DTK_NODE_LIST_VIEW_FUNCTION as the \p type argument. When it is
+ *  registered, DTK uses the coordinates in place instead of calling the
+ *  DTK_NodeListSizeFunction() and DTK_NodeListDataFunction() callbacks. The
+ *  storage must be allocated in the memory space of the user application and
+ *  must remain valid until the maps that use it have been created.
+ *
+ *  \param[in] user_data Pointer to custom user data.
+ *  \param[out] coordinates Node coordinates. Coordinate d of node n is
+ *              coordinates[n * node_stride + d * dim_stride], e.g.,
+ *              node_stride = space_dim and dim_stride = 1 for interleaved
+ *              coordinates.
+ *  \param[out] space_dim Spatial dimension.
+ *  \param[out] local_num_nodes Number of nodes.
+ *  \param[out] node_stride Distance between two consecutive nodes.
+ *  \param[out] dim_stride Distance between two consecutive coordinates of a
+ *              node.
+ */
+typedef void ( *DTK_NodeListViewFunction )( void *user_data,
+                                            Coordinate **coordinates,
+                                            unsigned *space_dim,
+                                            size_t *local_num_nodes,
+                                            size_t *node_stride,
+                                            size_t *dim_stride );
+
 /** \brief Prototype function to get the size parameters for building a bounding
  *  volume list.
  *
@@ -234,6 +234,10 @@ template <typename T> T SwigValueInit() {
   std::string DTK_string_git_commit_hash() {
     return std::string(DTK_gitCommitHash());
   }
+  std::string DTK_string_map_statistics(DTK_MapHandle handle) {
+    const char *statistics = DTK_getMapStatistics(handle);
+    return statistics ? std::string(statistics) : std::string();
+  }
 
 
 #include <stdlib.h>
@@ -298,6 +302,24 @@ SWIGEXPORT SwigArrayWrapper _wrap_DTK_git_commit_hash() {
 }
 
 
+SWIGEXPORT SwigArrayWrapper _wrap_DTK_get_map_statistics(void *farg1) {
+  SwigArrayWrapper fresult ;
+  DTK_MapHandle arg1 = (DTK_MapHandle) 0 ;
+  std::string result;
+
+  arg1 = (DTK_MapHandle)(farg1);
+  result = DTK_string_map_statistics(arg1);
+  fresult.size = (&result)->size();
+  if (fresult.size > 0) {
+    fresult.data = malloc(fresult.size);
+    memcpy(fresult.data, (&result)->c_str(), fresult.size);
+  } else {
+    fresult.data = NULL;
+  }
+  return fresult;
+}
+
+
 #ifdef __cplusplus
 }
 #endif
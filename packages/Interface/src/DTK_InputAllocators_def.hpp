@@ -20,6 +20,7 @@
 #include <DTK_CellList.hpp>
 #include <DTK_CellTypes.h>
 #include <DTK_PolyhedronList.hpp>
+#include <DTK_UnifiedMemoryHints.hpp>
 
 #include <Kokkos_Core.hpp>
 
@@ -202,6 +203,11 @@ InputAllocators<ViewProperties...>::allocateField(
     field.dofs = Kokkos::View<Scalar **, ViewProperties...>(
         "dofs", local_num_dofs, field_dimension );
 
+    // The field is written and read by the kernels at every transfer and
+    // only visits the host in the callbacks.
+    using MemorySpace = typename decltype( field.dofs )::memory_space;
+    UnifiedMemoryHints<MemorySpace>::setPreferredLocationDevice( field.dofs );
+
     return field;
 }
 
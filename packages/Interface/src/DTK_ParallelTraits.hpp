@@ -37,6 +37,11 @@ using HostSpace = Kokkos::HostSpace;
 using CudaUVMSpace = Kokkos::CudaUVMSpace;
 #endif
 
+// Cuda device memory
+#if defined( KOKKOS_ENABLE_CUDA )
+using CudaSpace = Kokkos::CudaSpace;
+#endif
+
 //---------------------------------------------------------------------------//
 // Parallel execution space aliases.
 
@@ -0,0 +1,178 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file DTK_UnifiedMemoryHints.hpp
+ * \brief Migration hints for user data in unified memory.
+ */
+//---------------------------------------------------------------------------//
+
+#ifndef DTK_UNIFIEDMEMORYHINTS_HPP
+#define DTK_UNIFIEDMEMORYHINTS_HPP
+
+#include <Kokkos_Core.hpp>
+
+#if defined( KOKKOS_ENABLE_CUDA )
+#include <cuda_runtime_api.h>
+#endif
+
+#include <cstddef>
+
+namespace DataTransferKit
+{
+//---------------------------------------------------------------------------//
+/*!
+ * \class UnifiedMemoryHints
+ *
+ * \brief Hints for the driver about where the views of user data are about
+ * to be accessed.
+ *
+ * The data that the user callbacks fill or read are accessed on the host by
+ * the application and then on the device by DTK, or the other way around.
+ * In unified memory, the pages would otherwise be migrated one fault at a
+ * time on the first access from the other side.  The hints move them in
+ * bulk instead.  They do nothing in the other memory spaces, and they only
+ * affect the performance, never the results.
+ */
+template <class MemorySpace>
+struct UnifiedMemoryHints
+{
+    // Move the views to the host before the application accesses them.
+    template <class... Views>
+    static void prefetchToHost( Views const &... )
+    {
+    }
+
+    // Move the views to the device before the kernels access them.
+    template <class... Views>
+    static void prefetchToDevice( Views const &... )
+    {
+    }
+
+    // Let the host and the device each keep a copy of the views, which are
+    // read but seldom written, e.g. the geometry.
+    template <class... Views>
+    static void setReadMostly( Views const &... )
+    {
+    }
+
+    // Keep the views on the device unless the host needs them, e.g. the
+    // buffers of the fields that are read and written by the kernels.
+    template <class... Views>
+    static void setPreferredLocationDevice( Views const &... )
+    {
+    }
+};
+
+#if defined( KOKKOS_ENABLE_CUDA )
+template <>
+struct UnifiedMemoryHints<Kokkos::CudaUVMSpace>
+{
+    template <class... Views>
+    static void prefetchToHost( Views const &... views )
+    {
+        if ( !isSupported() )
+            return;
+        int dummy[] = {0, ( prefetch( views, cudaCpuDeviceId ), 0 )...};
+        (void)dummy;
+        // The application must not touch the pages while they move.
+        Kokkos::fence();
+    }
+
+    template <class... Views>
+    static void prefetchToDevice( Views const &... views )
+    {
+        if ( !isSupported() )
+            return;
+        // The prefetches are in the default stream, before the kernels.
+        int dummy[] = {0, ( prefetch( views, device() ), 0 )...};
+        (void)dummy;
+    }
+
+    template <class... Views>
+    static void setReadMostly( Views const &... views )
+    {
+        if ( !isSupported() )
+            return;
+        int dummy[] = {
+            0, ( advise( views, cudaMemAdviseSetReadMostly, device() ), 0 )...};
+        (void)dummy;
+    }
+
+    template <class... Views>
+    static void setPreferredLocationDevice( Views const &... views )
+    {
+        if ( !isSupported() )
+            return;
+        int dummy[] = {
+            0, ( advise( views, cudaMemAdviseSetPreferredLocation, device() ),
+                 0 )...};
+        (void)dummy;
+    }
+
+  private:
+    static int device() { return Kokkos::Cuda().cuda_device(); }
+
+    // Prefetching needs a device that accesses unified memory concurrently
+    // with the host, which is not the case before Pascal or on Windows.
+    static bool isSupported()
+    {
+        static bool const supported = []() {
+            int value = 0;
+            cudaDeviceGetAttribute( &value,
+                                    cudaDevAttrConcurrentManagedAccess,
+                                    Kokkos::Cuda().cuda_device() );
+            return value != 0;
+        }();
+        return supported;
+    }
+
+    template <class View>
+    static std::size_t bytes( View const &view )
+    {
+        return view.span() * sizeof( typename View::value_type );
+    }
+
+    // The hints are only advisory.  Their errors are cleared so that they
+    // are not reported by the next kernel launch.
+    template <class View>
+    static void prefetch( View const &view, int destination )
+    {
+        if ( bytes( view ) == 0 )
+            return;
+        if ( cudaMemPrefetchAsync( view.data(), bytes( view ), destination ) !=
+             cudaSuccess )
+            cudaGetLastError();
+    }
+
+    template <class View>
+    static void advise( View const &view, cudaMemoryAdvise advice,
+                        int destination )
+    {
+        if ( bytes( view ) == 0 )
+            return;
+        if ( cudaMemAdvise( view.data(), bytes( view ), advice,
+                            destination ) != cudaSuccess )
+            cudaGetLastError();
+    }
+};
+#endif
+
+//---------------------------------------------------------------------------//
+
+} // namespace DataTransferKit
+
+//---------------------------------------------------------------------------//
+
+#endif // end DTK_UNIFIEDMEMORYHINTS_HPP
+
+//---------------------------------------------------------------------------//
+// end DTK_UnifiedMemoryHints.hpp
+//---------------------------------------------------------------------------//
@@ -25,6 +25,7 @@
 #include "DTK_NodeList.hpp"
 #include "DTK_ParallelTraits.hpp"
 #include "DTK_PolyhedronList.hpp"
+#include "DTK_UnifiedMemoryHints.hpp"
 #include "DTK_UserFunctionRegistry.hpp"
 #include "DTK_View.hpp"
 
@@ -70,6 +71,13 @@ class UserApplication
     //! Get a node list from the application.
     NodeList<Kokkos::LayoutLeft, MemorySpace> getNodeList();
 
+    //! Whether the application provides a view of its node coordinates.
+    bool hasNodeListView() const;
+
+    //! Get a node list that wraps the coordinates stored by the application.
+    NodeList<Kokkos::LayoutStride, MemorySpace, Kokkos::MemoryUnmanaged>
+    getNodeListView();
+
     //! Get a bounding volume list from the application.
     BoundingVolumeList<Kokkos::LayoutLeft, MemorySpace> getBoundingVolumeList();
 
@@ -91,6 +99,10 @@ class UserApplication
     DOFMap<Kokkos::LayoutLeft, MemorySpace>
     getDOFMap( std::string &discretization_type );
 
+    //! Get the size of a field with a given name from the application.
+    void getFieldSize( const std::string &field_name, unsigned &field_dim,
+                       size_t &local_num_dofs );
+
     //! Get a field with a given name from the application.
     Field<Scalar, Kokkos::LayoutLeft, MemorySpace>
     getField( const std::string &field_name );
@@ -104,13 +116,36 @@ class UserApplication
     pushField( const std::string &field_name,
                const Field<Scalar, Kokkos::LayoutLeft, MemorySpace> field );
 
+    //! Whether the storage of a field with a given name has been registered.
+    bool hasFieldStorage( const std::string &field_name ) const;
+
+    //! Get the registered storage of a field with a given name.
+    Kokkos::View<Scalar **, Kokkos::LayoutStride, MemorySpace,
+                 Kokkos::MemoryUnmanaged>
+    getFieldStorage( const std::string &field_name );
+
     //! Ask the application to evaluate a field with a given name.
     void evaluateField(
         const std::string &field_name,
         const EvaluationSet<Kokkos::LayoutLeft, MemorySpace> eval_set,
         Field<Scalar, Kokkos::LayoutLeft, MemorySpace> field );
 
+    //! Evaluate a field with a functor called inline in the execution space
+    //! of the application instead of a callback on the host. The functor is
+    //! called for each evaluation point i as
+    //! evaluator( object_ids( i ), point, values ) where point and values are
+    //! the rank-1 subviews of row i of the evaluation points and of the field.
+    template <class Evaluator>
+    void evaluateField(
+        const Evaluator &evaluator,
+        const EvaluationSet<Kokkos::LayoutLeft, MemorySpace> eval_set,
+        Field<Scalar, Kokkos::LayoutLeft, MemorySpace> field ) const;
+
   private:
+    // Migration hints around the user callbacks, which access the views on
+    // the host.
+    using Hints = UnifiedMemoryHints<MemorySpace>;
+
     // User function registry for this application.
     std::shared_ptr<UserFunctionRegistry<Scalar>> _user_functions;
 };
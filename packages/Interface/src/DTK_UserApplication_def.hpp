@@ -17,6 +17,7 @@
 #ifndef DTK_USERAPPLICATION_DEF_HPP
 #define DTK_USERAPPLICATION_DEF_HPP
 
+#include "DTK_ConfigDefs.hpp"
 #include "DTK_InputAllocators.hpp"
 #include "DTK_View.hpp"
 
@@ -50,7 +51,44 @@ auto UserApplication<Scalar, ParallelModel>::getNodeList()
 
     // Fill the list with user data.
     View<Coordinate> coordinates( node_list.coordinates );
+    Hints::prefetchToHost( node_list.coordinates );
     callUserFunction( _user_functions->_node_list_data_func, coordinates );
+    Hints::setReadMostly( node_list.coordinates );
+    Hints::prefetchToDevice( node_list.coordinates );
+
+    return node_list;
+}
+
+//---------------------------------------------------------------------------//
+// Whether the application provides a view of its node coordinates.
+template <class Scalar, class ParallelModel>
+bool UserApplication<Scalar, ParallelModel>::hasNodeListView() const
+{
+    return static_cast<bool>( _user_functions->_node_list_view_func.first );
+}
+
+//---------------------------------------------------------------------------//
+// Get a node list that wraps the coordinates stored by the application.
+template <class Scalar, class ParallelModel>
+auto UserApplication<Scalar, ParallelModel>::getNodeListView()
+    -> NodeList<Kokkos::LayoutStride, MemorySpace, Kokkos::MemoryUnmanaged>
+{
+    Coordinate *data = nullptr;
+    unsigned space_dim;
+    size_t local_num_nodes;
+    size_t node_stride;
+    size_t dim_stride;
+    callUserFunction( _user_functions->_node_list_view_func, data, space_dim,
+                      local_num_nodes, node_stride, dim_stride );
+    DTK_REQUIRE( data != nullptr || local_num_nodes == 0 );
+
+    NodeList<Kokkos::LayoutStride, MemorySpace, Kokkos::MemoryUnmanaged>
+        node_list;
+    Kokkos::LayoutStride layout( local_num_nodes, node_stride, space_dim,
+                                 dim_stride );
+    node_list.coordinates = Kokkos::View<Coordinate **, Kokkos::LayoutStride,
+                                         MemorySpace, Kokkos::MemoryUnmanaged>(
+        data, layout );
 
     return node_list;
 }
@@ -73,7 +111,10 @@ auto UserApplication<Scalar, ParallelModel>::getBoundingVolumeList()
 
     // Fill the list with user data.
     View<Coordinate> bounding_volumes( bv_list.bounding_volumes );
+    Hints::prefetchToHost( bv_list.bounding_volumes );
     callUserFunction( _user_functions->_bv_list_data_func, bounding_volumes );
+    Hints::setReadMostly( bv_list.bounding_volumes );
+    Hints::prefetchToDevice( bv_list.bounding_volumes );
 
     return bv_list;
 }
@@ -108,8 +149,20 @@ auto UserApplication<Scalar, ParallelModel>::getPolyhedronList()
     View<LocalOrdinal> cells( poly_list.cells );
     View<unsigned> faces_per_cell( poly_list.faces_per_cell );
     View<int> face_orientation( poly_list.face_orientation );
+    Hints::prefetchToHost( poly_list.coordinates, poly_list.faces,
+                           poly_list.nodes_per_face, poly_list.cells,
+                           poly_list.faces_per_cell,
+                           poly_list.face_orientation );
     callUserFunction( _user_functions->_poly_list_data_func, coordinates, faces,
                       nodes_per_face, cells, faces_per_cell, face_orientation );
+    Hints::setReadMostly( poly_list.coordinates, poly_list.faces,
+                          poly_list.nodes_per_face, poly_list.cells,
+                          poly_list.faces_per_cell,
+                          poly_list.face_orientation );
+    Hints::prefetchToDevice( poly_list.coordinates, poly_list.faces,
+                             poly_list.nodes_per_face, poly_list.cells,
+                             poly_list.faces_per_cell,
+                             poly_list.face_orientation );
 
     return poly_list;
 }
@@ -137,8 +190,14 @@ auto UserApplication<Scalar, ParallelModel>::getCellList()
     View<Coordinate> coordinates( cell_list.coordinates );
     View<LocalOrdinal> cells( cell_list.cells );
     View<DTK_CellTopology> cell_topologies( cell_list.cell_topologies );
+    Hints::prefetchToHost( cell_list.coordinates, cell_list.cells,
+                           cell_list.cell_topologies );
     callUserFunction( _user_functions->_cell_list_data_func, coordinates, cells,
                       cell_topologies );
+    Hints::setReadMostly( cell_list.coordinates, cell_list.cells,
+                          cell_list.cell_topologies );
+    Hints::prefetchToDevice( cell_list.coordinates, cell_list.cells,
+                             cell_list.cell_topologies );
 
     return cell_list;
 }
@@ -160,8 +219,12 @@ void UserApplication<Scalar, ParallelModel>::getBoundary( ListType &list )
     // Fill the boundary with user data.
     View<LocalOrdinal> boundary_cells( list.boundary_cells );
     View<unsigned> cell_faces_on_boundary( list.cell_faces_on_boundary );
+    Hints::prefetchToHost( list.boundary_cells, list.cell_faces_on_boundary );
     callUserFunction( _user_functions->_boundary_data_func, boundary_cells,
                       cell_faces_on_boundary );
+    Hints::setReadMostly( list.boundary_cells, list.cell_faces_on_boundary );
+    Hints::prefetchToDevice( list.boundary_cells,
+                             list.cell_faces_on_boundary );
 }
 
 //---------------------------------------------------------------------------//
@@ -183,9 +246,15 @@ void UserApplication<Scalar, ParallelModel>::getAdjacencyList( ListType &list )
     View<GlobalOrdinal> cell_global_ids( list.cell_global_ids );
     View<GlobalOrdinal> adjacent_cell_global_ids( list.adjacent_cells );
     View<unsigned> adjacencies_per_cell( list.adjacencies_per_cell );
+    Hints::prefetchToHost( list.cell_global_ids, list.adjacent_cells,
+                           list.adjacencies_per_cell );
     callUserFunction( _user_functions->_adjacency_list_data_func,
                       cell_global_ids, adjacent_cell_global_ids,
                       adjacencies_per_cell );
+    Hints::setReadMostly( list.cell_global_ids, list.adjacent_cells,
+                          list.adjacencies_per_cell );
+    Hints::prefetchToDevice( list.cell_global_ids, list.adjacent_cells,
+                             list.adjacencies_per_cell );
 }
 
 //---------------------------------------------------------------------------//
@@ -219,6 +288,8 @@ auto UserApplication<Scalar, ParallelModel>::getDOFMap(
         // Fill the map with user data.
         View<GlobalOrdinal> global_dof_ids( dof_map.global_dof_ids );
         View<LocalOrdinal> object_dof_ids( dof_map.object_dof_ids );
+        Hints::prefetchToHost( dof_map.global_dof_ids,
+                               dof_map.object_dof_ids );
         callUserFunction( _user_functions->_dof_map_data_func, global_dof_ids,
                           object_dof_ids, discretization_type );
     }
@@ -243,14 +314,31 @@ auto UserApplication<Scalar, ParallelModel>::getDOFMap(
         View<GlobalOrdinal> global_dof_ids( dof_map.global_dof_ids );
         View<LocalOrdinal> object_dof_ids( dof_map.object_dof_ids );
         View<unsigned> dofs_per_object( dof_map.dofs_per_object );
+        Hints::prefetchToHost( dof_map.global_dof_ids, dof_map.object_dof_ids,
+                               dof_map.dofs_per_object );
         callUserFunction( _user_functions->_mt_dof_map_data_func,
                           global_dof_ids, object_dof_ids, dofs_per_object,
                           discretization_type );
     }
+    Hints::setReadMostly( dof_map.global_dof_ids, dof_map.object_dof_ids,
+                          dof_map.dofs_per_object );
+    Hints::prefetchToDevice( dof_map.global_dof_ids, dof_map.object_dof_ids,
+                             dof_map.dofs_per_object );
 
     return dof_map;
 }
 
+//---------------------------------------------------------------------------//
+// Get the size of a field with a given name from the application.
+template <class Scalar, class ParallelModel>
+void UserApplication<Scalar, ParallelModel>::getFieldSize(
+    const std::string &field_name, unsigned &field_dim,
+    size_t &local_num_dofs )
+{
+    callUserFunction( _user_functions->_field_size_func, field_name, field_dim,
+                      local_num_dofs );
+}
+
 //---------------------------------------------------------------------------//
 // Get a field with a given name from the application.
 template <class Scalar, class ParallelModel>
@@ -261,9 +349,7 @@ auto UserApplication<Scalar, ParallelModel>::getField(
     // Get the size of the field.
     unsigned field_dim;
     size_t local_num_dofs;
-
-    callUserFunction( _user_functions->_field_size_func, field_name, field_dim,
-                      local_num_dofs );
+    getFieldSize( field_name, field_dim, local_num_dofs );
 
     // Allocate the field.
     auto field = InputAllocators<Kokkos::LayoutLeft, MemorySpace>::
@@ -281,8 +367,10 @@ void UserApplication<Scalar, ParallelModel>::pullField(
 {
     // Get the field from the user.
     View<Scalar> field_dofs( field.dofs );
+    Hints::prefetchToHost( field.dofs );
     callUserFunction( _user_functions->_pull_field_func, field_name,
                       field_dofs );
+    Hints::prefetchToDevice( field.dofs );
 }
 
 //---------------------------------------------------------------------------//
@@ -294,10 +382,38 @@ void UserApplication<Scalar, ParallelModel>::pushField(
 {
     // Give the field to the user.
     View<Scalar> field_dofs( field.dofs );
+    Hints::prefetchToHost( field.dofs );
     callUserFunction( _user_functions->_push_field_func, field_name,
                       field_dofs );
 }
 
+//---------------------------------------------------------------------------//
+// Whether the storage of a field with a given name has been registered.
+template <class Scalar, class ParallelModel>
+bool UserApplication<Scalar, ParallelModel>::hasFieldStorage(
+    const std::string &field_name ) const
+{
+    return _user_functions->_field_storage.count( field_name ) > 0;
+}
+
+//---------------------------------------------------------------------------//
+// Get the registered storage of a field with a given name.
+template <class Scalar, class ParallelModel>
+auto UserApplication<Scalar, ParallelModel>::getFieldStorage(
+    const std::string &field_name )
+    -> Kokkos::View<Scalar **, Kokkos::LayoutStride, MemorySpace,
+                    Kokkos::MemoryUnmanaged>
+{
+    DTK_REQUIRE( hasFieldStorage( field_name ) );
+
+    // The components of the field are separated by the stride.
+    auto const &storage = _user_functions->_field_storage.at( field_name );
+    Kokkos::LayoutStride layout( storage.local_num_dofs, 1, storage.field_dim,
+                                 storage.stride );
+    return Kokkos::View<Scalar **, Kokkos::LayoutStride, MemorySpace,
+                        Kokkos::MemoryUnmanaged>( storage.data, layout );
+}
+
 //---------------------------------------------------------------------------//
 // Ask the application to evaluate a field with a given name.
 template <class Scalar, class ParallelModel>
@@ -310,8 +426,41 @@ void UserApplication<Scalar, ParallelModel>::evaluateField(
     View<Coordinate> evaluation_points( eval_set.evaluation_points );
     View<LocalOrdinal> object_ids( eval_set.object_ids );
     View<Scalar> values( field.dofs );
+    Hints::prefetchToHost( eval_set.evaluation_points, eval_set.object_ids,
+                           field.dofs );
     callUserFunction( _user_functions->_eval_field_func, field_name,
                       evaluation_points, object_ids, values );
+    Hints::prefetchToDevice( field.dofs );
+}
+
+//---------------------------------------------------------------------------//
+// Evaluate a field with a functor on the device.
+template <class Scalar, class ParallelModel>
+template <class Evaluator>
+void UserApplication<Scalar, ParallelModel>::evaluateField(
+    const Evaluator &evaluator,
+    const EvaluationSet<Kokkos::LayoutLeft, MemorySpace> eval_set,
+    Field<Scalar, Kokkos::LayoutLeft, MemorySpace> field ) const
+{
+    using ExecutionSpace = typename MemorySpace::execution_space;
+
+    auto const n_evals = eval_set.object_ids.extent( 0 );
+    DTK_REQUIRE( eval_set.evaluation_points.extent( 0 ) == n_evals );
+    DTK_REQUIRE( field.dofs.extent( 0 ) == n_evals );
+
+    // The lambda does not properly capture class data so extract it.
+    auto evaluation_points = eval_set.evaluation_points;
+    auto object_ids = eval_set.object_ids;
+    auto dofs = field.dofs;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "evaluate_field" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_evals ),
+        KOKKOS_LAMBDA( const size_t i ) {
+            evaluator( object_ids( i ),
+                       Kokkos::subview( evaluation_points, i, Kokkos::ALL ),
+                       Kokkos::subview( dofs, i, Kokkos::ALL ) );
+        } );
+    Kokkos::fence();
 }
 
 //---------------------------------------------------------------------------//
@@ -70,6 +70,18 @@ using NodeListSizeFunction =
 using NodeListDataFunction = std::function<void(
     std::shared_ptr<void> user_data, View<Coordinate> coordinates )>;
 
+//---------------------------------------------------------------------------//
+/*!
+ * \brief Get a view of the coordinates of the nodes stored by the
+ * application. Coordinate d of node n is coordinates[n * node_stride + d *
+ * dim_stride]. DTK uses the storage directly instead of building a node list
+ * with the size and data functions.
+ */
+using NodeListViewFunction = std::function<void(
+    std::shared_ptr<void> user_data, Coordinate *&coordinates,
+    unsigned &space_dim, size_t &local_num_nodes, size_t &node_stride,
+    size_t &dim_stride )>;
+
 //---------------------------------------------------------------------------//
 /*!
  * \brief Get the size parameters for building a bounding volume list.
@@ -80,6 +80,11 @@ class UserFunctionRegistry
     void setNodeListDataFunction( NodeListDataFunction &&func,
                                   std::shared_ptr<void> user_data = nullptr );
 
+    //! Node list view function. The storage it points to must remain valid
+    //! until the maps that use the node list have been created.
+    void setNodeListViewFunction( NodeListViewFunction &&func,
+                                  std::shared_ptr<void> user_data = nullptr );
+
     //! Bounding volume list size function.
     void setBoundingVolumeListSizeFunction(
         BoundingVolumeListSizeFunction &&func,
@@ -167,6 +172,15 @@ class UserFunctionRegistry
     //! Evaluate field.
     void setEvaluateFieldFunction( EvaluateFieldFunction<Scalar> &&func,
                                    std::shared_ptr<void> user_data = nullptr );
+
+    //! Field storage. The field is dimensioned (local_num_dofs, field_dim)
+    //! and component d of dof n is data[d * stride + n]. The storage lives in
+    //! the memory space of the application and is read and written directly
+    //! by the maps: the field size, pull, and push functions are not called
+    //! for this field. The storage must outlive the maps that use it.
+    void setFieldStorage( const std::string &field_name, Scalar *data,
+                          size_t local_num_dofs, unsigned field_dim,
+                          size_t stride );
     //@}
 
   private:
@@ -179,6 +193,9 @@ class UserFunctionRegistry
     //! Node list data function.
     UserImpl<NodeListDataFunction> _node_list_data_func;
 
+    //! Node list view function.
+    UserImpl<NodeListViewFunction> _node_list_view_func;
+
     //! Bounding volume size function.
     UserImpl<BoundingVolumeListSizeFunction> _bv_list_size_func;
 
@@ -241,6 +258,22 @@ class UserFunctionRegistry
     //! Field evaluate data function.
     UserImpl<EvaluateFieldFunction<Scalar>> _eval_field_func;
     //@}
+
+    //@{
+    //! User Field storage.
+
+    //! Registered storage of a field.
+    struct FieldStorage
+    {
+        Scalar *data;
+        size_t local_num_dofs;
+        unsigned field_dim;
+        size_t stride;
+    };
+
+    //! Registered field storage indexed by field name.
+    std::unordered_map<std::string, FieldStorage> _field_storage;
+    //@}
 };
 
 //---------------------------------------------------------------------------//
@@ -37,6 +37,15 @@ void UserFunctionRegistry<Scalar>::setNodeListDataFunction(
     _node_list_data_func = std::make_pair( func, user_data );
 }
 
+//---------------------------------------------------------------------------//
+// Node list view function.
+template <class Scalar>
+void UserFunctionRegistry<Scalar>::setNodeListViewFunction(
+    NodeListViewFunction &&func, std::shared_ptr<void> user_data )
+{
+    _node_list_view_func = std::make_pair( func, user_data );
+}
+
 //---------------------------------------------------------------------------//
 // Bounding volume list size function.
 template <class Scalar>
@@ -199,6 +208,19 @@ void UserFunctionRegistry<Scalar>::setEvaluateFieldFunction(
     _eval_field_func = std::make_pair( func, user_data );
 }
 
+//---------------------------------------------------------------------------//
+// Field storage.
+template <class Scalar>
+void UserFunctionRegistry<Scalar>::setFieldStorage(
+    const std::string &field_name, Scalar *data, size_t local_num_dofs,
+    unsigned field_dim, size_t stride )
+{
+    DTK_REQUIRE( nullptr != data || 0 == local_num_dofs * field_dim );
+    DTK_REQUIRE( stride >= local_num_dofs );
+    _field_storage[field_name] =
+        FieldStorage{data, local_num_dofs, field_dim, stride};
+}
+
 //---------------------------------------------------------------------------//
 
 } // namespace DataTransferKit
@@ -38,6 +38,8 @@ namespace DataTransferKit
  * application in any manner on and off device. If the Kokkos::View lives on
  * the device, the DTK view will provide a raw pointer to that device data and
  * the length of the view under that pointer.
+ * For CudaSpace memory, the pointer is only valid on the device and the
+ * application is responsible for any copy to or from the host.
  *
  * The view is copyable to device and provides a device-accessible element
  * accessor to facilitate user implementation.
@@ -88,13 +90,6 @@ class View
         static_assert( std::is_same<typename KokkosViewType::array_layout,
                                     Kokkos::LayoutLeft>::value,
                        "Kokkos View layout must be LayoutLeft" );
-
-#ifdef KOKKOS_ENABLE_CUDA
-        static_assert( std::is_same<typename KokkosViewType::memory_space,
-                                    Kokkos::CudaSpace>::value == false,
-                       "DTK for CUDA currently does not support CudaSpace "
-                       "memory. Please use CudaUVM memory space instead." );
-#endif
     }
 
     // Get size of the view.
@@ -45,16 +45,34 @@
 %rename DTK_destroyUserApplication DTK_destroy_user_application;
 
 %rename DTK_createMap DTK_create_map;
+%rename DTK_createMapDeferred DTK_create_map_deferred;
 %rename DTK_isValidMap DTK_is_valid_map;
 %rename DTK_applyMap DTK_apply_map;
+%rename DTK_applyMapFields DTK_apply_map_fields;
+%rename DTK_applyMapGroup DTK_apply_map_group;
+%rename DTK_applyMapAsync DTK_apply_map_async;
+%rename DTK_waitMap DTK_wait_map;
+%rename DTK_testMap DTK_test_map;
+%rename DTK_setupMapGeometryAsync DTK_setup_map_geometry_async;
+%rename DTK_setupMapOperatorAsync DTK_setup_map_operator_async;
 %rename DTK_destroyMap DTK_destroy_map;
 
+%rename DTK_createSearchTree DTK_create_search_tree;
+%rename DTK_isValidSearchTree DTK_is_valid_search_tree;
+%rename DTK_searchNearest DTK_search_nearest;
+%rename DTK_searchWithin DTK_search_within;
+%rename DTK_getSearchResults DTK_get_search_results;
+%rename DTK_destroySearchTree DTK_destroy_search_tree;
+
 %rename DTK_setUserFunction DTK_set_user_function;
+%rename DTK_setNodeListStorage DTK_set_node_list_storage;
+%rename DTK_setFieldStorage DTK_set_field_storage;
 
 %include <std_string.i>
 
 %rename DTK_string_version DTK_version;
 %rename DTK_string_git_commit_hash DTK_git_commit_hash;
+%rename DTK_string_map_statistics DTK_get_map_statistics;
 %inline %{
   std::string DTK_string_version() {
     return std::string(DTK_version());
@@ -62,9 +80,14 @@
   std::string DTK_string_git_commit_hash() {
     return std::string(DTK_gitCommitHash());
   }
+  std::string DTK_string_map_statistics(DTK_MapHandle handle) {
+    const char *statistics = DTK_getMapStatistics(handle);
+    return statistics ? std::string(statistics) : std::string();
+  }
 %}
 %ignore DTK_version;
-%ignore DTK_gitCommitHash;;
+%ignore DTK_gitCommitHash;
+%ignore DTK_getMapStatistics;
 
 %include "DTK_CellTypes.h"
 %include "DTK_C_API.h"
@@ -389,4 +389,42 @@ void test_too_many_functions( UserApplication &user_app,
     TEST_ASSERT( caught_exception );
 }
 
+template <class UserApplication>
+void test_node_list_storage( UserApplication &user_app,
+                             Teuchos::FancyOStream &out, bool &success )
+{
+    TEST_ASSERT( user_app.hasNodeListView() );
+
+    // The node list wraps the storage of the application.
+    auto node_list = user_app.getNodeListView();
+    TEST_EQUALITY( node_list.coordinates.extent( 0 ), SIZE_1 );
+    TEST_EQUALITY( node_list.coordinates.extent( 1 ), SPACE_DIM );
+    auto host_coordinates = Kokkos::create_mirror_view( node_list.coordinates );
+    Kokkos::deep_copy( host_coordinates, node_list.coordinates );
+    for ( unsigned i = 0; i < SIZE_1; ++i )
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            TEST_EQUALITY( host_coordinates( i, d ), i + d + OFFSET );
+}
+
+template <class UserApplication>
+void test_field_storage( UserApplication &user_app, Teuchos::FancyOStream &out,
+                         bool &success )
+{
+    TEST_ASSERT( user_app.hasFieldStorage( FIELD_NAME ) );
+
+    // Read the storage of the application and write into it.
+    auto field_dofs = user_app.getFieldStorage( FIELD_NAME );
+    TEST_EQUALITY( field_dofs.extent( 0 ), SIZE_1 );
+    TEST_EQUALITY( field_dofs.extent( 1 ), SPACE_DIM );
+    auto host_dofs = Kokkos::create_mirror_view( field_dofs );
+    Kokkos::deep_copy( host_dofs, field_dofs );
+    for ( unsigned i = 0; i < SIZE_1; ++i )
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+        {
+            TEST_EQUALITY( host_dofs( i, d ), i + d + OFFSET );
+            host_dofs( i, d ) = i + d;
+        }
+    Kokkos::deep_copy( field_dofs, host_dofs );
+}
+
 #endif // DTK_TESTAPPLICATIONHELPERS_HPP
@@ -37,6 +37,10 @@ int test( const std::string &test_name, UserApplication &user_app )
             test_field_push_pull( user_app, out, success );
         else if ( test_name == "test_field_eval" )
             test_field_eval( user_app, out, success );
+        else if ( test_name == "test_node_list_storage" )
+            test_node_list_storage( user_app, out, success );
+        else if ( test_name == "test_field_storage" )
+            test_field_storage( user_app, out, success );
         else if ( test_name == "test_missing_function" )
             test_missing_function( user_app, out, success );
         else if ( test_name == "test_too_many_functions" )
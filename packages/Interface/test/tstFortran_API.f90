@@ -662,6 +662,55 @@ contains
     rv = check_registry( "test_field_eval"//C_NULL_CHAR, dtk_handle )
   end function
 
+  function test_node_list_storage(dtk_handle, u) result(rv)
+    type(c_ptr), value :: dtk_handle
+    type(UserTestClass), target :: u
+    integer :: rv
+
+    real(c_double), dimension(:,:), allocatable, target :: coordinates
+    integer :: i, d
+
+    allocate(coordinates(u%size_1, u%space_dim))
+    do d = 1, u%space_dim
+      do i = 1, int(u%size_1)
+        coordinates(i, d) = i + d - 2 + u%offset
+      enddo
+    enddo
+
+    call DTK_set_node_list_storage( dtk_handle, coordinates )
+
+    rv = check_registry( "test_node_list_storage"//C_NULL_CHAR, dtk_handle )
+    deallocate(coordinates)
+  end function
+
+  function test_field_storage(dtk_handle, u) result(rv)
+    type(c_ptr), value :: dtk_handle
+    type(UserTestClass), target :: u
+    integer :: rv
+
+    real(c_double), dimension(:,:), allocatable, target :: field_dofs
+    integer :: i, d
+
+    allocate(field_dofs(u%size_1, u%space_dim))
+    do d = 1, u%space_dim
+      do i = 1, int(u%size_1)
+        field_dofs(i, d) = i + d - 2 + u%offset
+      enddo
+    enddo
+
+    call DTK_set_field_storage( dtk_handle, "test_field", field_dofs )
+
+    rv = check_registry( "test_field_storage"//C_NULL_CHAR, dtk_handle )
+
+    ! The values written by DTK are in the array.
+    do d = 1, u%space_dim
+      do i = 1, int(u%size_1)
+        if ( field_dofs(i, d) /= i + d - 2 ) rv = 1
+      enddo
+    enddo
+    deallocate(field_dofs)
+  end function
+
   function test_missing_function(dtk_handle, u) result(rv)
     type(c_ptr), value :: dtk_handle
     type(UserTestClass), target :: u
@@ -721,6 +770,7 @@ program main
   type(c_ptr) :: dtk_handle_7, dtk_handle_8, dtk_handle_9
   type(c_ptr) :: dtk_handle_10, dtk_handle_11, dtk_handle_12
   type(c_ptr) :: dtk_handle_13, dtk_handle_14
+  type(c_ptr) :: dtk_handle_15, dtk_handle_16
 
   rv = 0
 
@@ -854,6 +904,16 @@ program main
     rv = ior(rv, test_too_many_functions( dtk_handle_14, u ))
     call DTK_destroy_user_application( dtk_handle_14 )
   !}
+  !{
+    dtk_handle_15 = DTK_create_user_application( memory_space )
+    rv = ior(rv, test_node_list_storage( dtk_handle_15, u ))
+    call DTK_destroy_user_application( dtk_handle_15 )
+  !}
+  !{
+    dtk_handle_16 = DTK_create_user_application( memory_space )
+    rv = ior(rv, test_field_storage( dtk_handle_16, u ))
+    call DTK_destroy_user_application( dtk_handle_16 )
+  !}
 
   call DTK_finalize()
 
@@ -521,6 +521,20 @@ void evaluateField(
     Kokkos::fence();
 }
 
+//---------------------------------------------------------------------------//
+// Same as evaluateField() for a single point, called on the device.
+struct FieldEvaluator
+{
+    template <class Point, class Values>
+    KOKKOS_INLINE_FUNCTION void
+    operator()( const DataTransferKit::LocalOrdinal object_id,
+                const Point &point, const Values &values ) const
+    {
+        for ( unsigned d = 0; d < point.extent( 0 ); ++d )
+            values( d ) = point( d ) + object_id;
+    }
+};
+
 //---------------------------------------------------------------------------//
 
 } // namespace UserAppTest
@@ -813,6 +827,156 @@ TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, field_eval, SC, DeviceType )
 }
 
 //---------------------------------------------------------------------------//
+TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, field_eval_functor, SC,
+                                   DeviceType )
+{
+    // Test types.
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Scalar = SC;
+
+    // Create the test class.
+    auto u =
+        std::make_shared<UserAppTest::UserTestClass<Scalar, ExecutionSpace>>();
+
+    // Only the size of the field is given by a callback.
+    auto registry =
+        std::make_shared<DataTransferKit::UserFunctionRegistry<Scalar>>();
+    registry->setFieldSizeFunction(
+        UserAppTest::fieldSize<Scalar, ExecutionSpace>, u );
+
+    // Create the user application.
+    DataTransferKit::UserApplication<Scalar, ExecutionSpace> user_app(
+        registry );
+
+    // Create an evaluation set.
+    auto eval_set = DataTransferKit::InputAllocators<
+        Kokkos::LayoutLeft, ExecutionSpace>::allocateEvaluationSet( SIZE_1,
+                                                                    SPACE_DIM );
+    auto fill_eval_set = KOKKOS_LAMBDA( const size_t i )
+    {
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            eval_set.evaluation_points( i, d ) = i + d;
+        eval_set.object_ids( i ) = i;
+    };
+    Kokkos::parallel_for( Kokkos::RangePolicy<ExecutionSpace>( 0, SIZE_1 ),
+                          fill_eval_set );
+    Kokkos::fence();
+
+    // Evaluate the field.
+    auto field = user_app.getField( FIELD_NAME );
+    user_app.evaluateField( UserAppTest::FieldEvaluator(), eval_set, field );
+
+    // Check the evaluation.
+    auto host_dofs = Kokkos::create_mirror_view( field.dofs );
+    Kokkos::deep_copy( host_dofs, field.dofs );
+    for ( unsigned i = 0; i < SIZE_1; ++i )
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            TEST_EQUALITY( host_dofs( i, d ), 2 * i + d );
+}
+
+//---------------------------------------------------------------------------//
+TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, node_list_view, SC,
+                                   DeviceType )
+{
+    // Test types.
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Scalar = SC;
+
+    // Store the coordinates interleaved.
+    Kokkos::View<DataTransferKit::Coordinate *, ExecutionSpace> storage(
+        "storage", SIZE_1 * SPACE_DIM );
+    auto fill_storage = KOKKOS_LAMBDA( const size_t i )
+    {
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            storage( i * SPACE_DIM + d ) = i + d;
+    };
+    Kokkos::parallel_for( Kokkos::RangePolicy<ExecutionSpace>( 0, SIZE_1 ),
+                          fill_storage );
+    Kokkos::fence();
+
+    // Register the view function.
+    auto registry =
+        std::make_shared<DataTransferKit::UserFunctionRegistry<Scalar>>();
+    DataTransferKit::UserApplication<Scalar, ExecutionSpace> user_app(
+        registry );
+    TEST_ASSERT( !user_app.hasNodeListView() );
+    DataTransferKit::Coordinate *data = storage.data();
+    registry->setNodeListViewFunction(
+        [data]( std::shared_ptr<void>, DataTransferKit::Coordinate *&coords,
+                unsigned &space_dim, size_t &local_num_nodes,
+                size_t &node_stride, size_t &dim_stride ) {
+            coords = data;
+            space_dim = SPACE_DIM;
+            local_num_nodes = SIZE_1;
+            node_stride = SPACE_DIM;
+            dim_stride = 1;
+        } );
+    TEST_ASSERT( user_app.hasNodeListView() );
+
+    // The node list wraps the storage.
+    auto node_list = user_app.getNodeListView();
+    TEST_EQUALITY( node_list.coordinates.data(), data );
+    TEST_EQUALITY( node_list.coordinates.extent( 0 ), SIZE_1 );
+    TEST_EQUALITY( node_list.coordinates.extent( 1 ), SPACE_DIM );
+
+    // Check the coordinates.
+    Kokkos::View<DataTransferKit::Coordinate **, Kokkos::LayoutLeft,
+                 ExecutionSpace>
+        coordinates( "coordinates", SIZE_1, SPACE_DIM );
+    Kokkos::deep_copy( coordinates, node_list.coordinates );
+    auto host_coordinates = Kokkos::create_mirror_view( coordinates );
+    Kokkos::deep_copy( host_coordinates, coordinates );
+    for ( unsigned i = 0; i < SIZE_1; ++i )
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            TEST_EQUALITY( host_coordinates( i, d ), i + d );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, field_storage, SC,
+                                   DeviceType )
+{
+    // Test types.
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Scalar = SC;
+
+    // Allocate the storage of the field with some padding between the
+    // components.
+    size_t const stride = SIZE_1 + 3;
+    Kokkos::View<Scalar *, ExecutionSpace> storage( "storage",
+                                                    stride * SPACE_DIM );
+
+    // Register the storage.
+    auto registry =
+        std::make_shared<DataTransferKit::UserFunctionRegistry<Scalar>>();
+    registry->setFieldStorage( FIELD_NAME, storage.data(), SIZE_1, SPACE_DIM,
+                               stride );
+
+    // Create the user application.
+    DataTransferKit::UserApplication<Scalar, ExecutionSpace> user_app(
+        registry );
+    TEST_ASSERT( user_app.hasFieldStorage( FIELD_NAME ) );
+    TEST_ASSERT( !user_app.hasFieldStorage( "not_registered" ) );
+
+    // Write in the storage through the view.
+    auto field_dofs = user_app.getFieldStorage( FIELD_NAME );
+    TEST_EQUALITY( field_dofs.extent( 0 ), SIZE_1 );
+    TEST_EQUALITY( field_dofs.extent( 1 ), SPACE_DIM );
+    auto fill_field = KOKKOS_LAMBDA( const size_t i )
+    {
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            field_dofs( i, d ) = i + d;
+    };
+    Kokkos::parallel_for( Kokkos::RangePolicy<ExecutionSpace>( 0, SIZE_1 ),
+                          fill_field );
+    Kokkos::fence();
+
+    // Check the storage.
+    auto host_storage = Kokkos::create_mirror_view( storage );
+    Kokkos::deep_copy( host_storage, storage );
+    for ( unsigned i = 0; i < SIZE_1; ++i )
+        for ( unsigned d = 0; d < SPACE_DIM; ++d )
+            TEST_EQUALITY( host_storage( d * stride + i ), i + d );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, missing_function, SC,
                                    DeviceType )
 {
@@ -900,6 +1064,12 @@ TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( UserApplication, too_many_functions, SC,
                                           SCALAR, DeviceType##NODE )           \
     TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, field_eval, SCALAR, \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, field_eval_functor, \
+                                          SCALAR, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, node_list_view,     \
+                                          SCALAR, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, field_storage,      \
+                                          SCALAR, DeviceType##NODE )           \
     TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, missing_function,   \
                                           SCALAR, DeviceType##NODE )           \
     TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( UserApplication, too_many_functions, \
@@ -2,6 +2,7 @@ TRIBITS_PACKAGE_DEFINE_DEPENDENCIES(
   LIB_REQUIRED_PACKAGES
   DataTransferKitUtils
   DataTransferKitInterface
+  DataTransferKitDiscretization
   DataTransferKitMeshfree
   Kokkos
   LIB_REQUIRED_TPLS
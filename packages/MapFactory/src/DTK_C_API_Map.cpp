@@ -13,7 +13,12 @@
 #include <DTK_C_API_Map.hpp>
 
 #include <cerrno>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <set>
+#include <string>
+#include <vector>
 
 //---------------------------------------------------------------------------//
 namespace DataTransferKit
@@ -21,6 +26,80 @@ namespace DataTransferKit
 
 // We store the reinterpret_cast versions of pointers
 static std::set<void *> valid_map_handles;
+static std::set<void *> valid_map_requests;
+
+// Whether the transfer of the request is running in another thread.
+static bool isRunning( void *request )
+{
+    return reinterpret_cast<DTK_MapRequestImpl *>( request )->transfer.wait_for(
+               std::chrono::seconds( 0 ) ) == std::future_status::timeout;
+}
+
+// Wait for the operator to be applied, push the target field, and release the
+// request.
+static void completeMapRequest( DTK_MapRequest *request )
+{
+    auto impl = reinterpret_cast<DTK_MapRequestImpl *>( *request );
+    valid_map_requests.erase( *request );
+    // A deferred transfer is applied by the calling thread. It must not
+    // exchange messages while a transfer of another thread does, they could
+    // use the same communicator, e.g. that of a shared source geometry.
+    if ( impl->transfer.wait_for( std::chrono::seconds( 0 ) ) ==
+         std::future_status::deferred )
+        for ( void *other : valid_map_requests )
+            if ( isRunning( other ) )
+                reinterpret_cast<DTK_MapRequestImpl *>( other )
+                    ->transfer.wait();
+    *request = nullptr;
+    std::unique_ptr<DTK_MapRequestImpl> guard( impl );
+    impl->transfer.get();
+    if ( impl->push_target )
+        impl->map->pushTarget( impl->target_field_name );
+}
+
+// The map communicates so it can only work in another thread if MPI is fully
+// thread-safe. It must also run on a device since the kernels of a host
+// execution space cannot be launched from another thread. A single transfer
+// runs in another thread at a time, so that no two transfers exchange
+// messages on the same communicator. Otherwise, the work is done when the
+// request is completed.
+static std::launch mapRequestPolicy( DTK_Map const *map )
+{
+    if ( !map->runsOnDevice() )
+        return std::launch::deferred;
+    int thread_level;
+    MPI_Query_thread( &thread_level );
+    if ( thread_level != MPI_THREAD_MULTIPLE )
+        return std::launch::deferred;
+    for ( void *request : valid_map_requests )
+        if ( isRunning( request ) )
+            return std::launch::deferred;
+    return std::launch::async;
+}
+
+// Start setting up a map.
+template <typename Setup>
+static void startMapSetup( DTK_MapHandle handle, DTK_MapRequest *request,
+                           Setup setup )
+{
+    *request = nullptr;
+    if ( !DTK_isValidMap( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    auto map = reinterpret_cast<DTK_Map *>( handle );
+    auto impl = new DTK_MapRequestImpl{
+        map, false, std::string(),
+        std::async( mapRequestPolicy( map ),
+                    [map, setup]() { setup( map ); } )};
+
+    *request = reinterpret_cast<DTK_MapRequest>( impl );
+    valid_map_requests.insert( *request );
+
+    errno = DTK_SUCCESS;
+}
 
 //---------------------------------------------------------------------------//
 
@@ -42,7 +121,29 @@ DTK_MapHandle DTK_createMap( DTK_ExecutionSpace space, MPI_Comm comm,
         return nullptr;
     }
 
-    // For demonstration purposes just use the nearest neighbor map.
+    std::unique_ptr<DataTransferKit::DTK_Map> map(
+        DataTransferKit::createMap( space, comm, source, target, options ) );
+    map->setupOperator();
+    auto handle = reinterpret_cast<DTK_MapHandle>( map.release() );
+    DataTransferKit::valid_map_handles.insert( handle );
+
+    errno = DTK_SUCCESS;
+
+    return handle;
+}
+
+//---------------------------------------------------------------------------//
+DTK_MapHandle DTK_createMapDeferred( DTK_ExecutionSpace space, MPI_Comm comm,
+                                     DTK_UserApplicationHandle source,
+                                     DTK_UserApplicationHandle target,
+                                     const char *options )
+{
+    if ( !DTK_isInitialized() )
+    {
+        errno = DTK_UNINITIALIZED;
+        return nullptr;
+    }
+
     auto handle = reinterpret_cast<DTK_MapHandle>(
         DataTransferKit::createMap( space, comm, source, target, options ) );
     DataTransferKit::valid_map_handles.insert( handle );
@@ -52,6 +153,22 @@ DTK_MapHandle DTK_createMap( DTK_ExecutionSpace space, MPI_Comm comm,
     return handle;
 }
 
+//---------------------------------------------------------------------------//
+void DTK_setupMapGeometryAsync( DTK_MapHandle handle, DTK_MapRequest *request )
+{
+    DataTransferKit::startMapSetup(
+        handle, request,
+        []( DataTransferKit::DTK_Map *map ) { map->setupGeometry(); } );
+}
+
+//---------------------------------------------------------------------------//
+void DTK_setupMapOperatorAsync( DTK_MapHandle handle, DTK_MapRequest *request )
+{
+    DataTransferKit::startMapSetup(
+        handle, request,
+        []( DataTransferKit::DTK_Map *map ) { map->setupOperator(); } );
+}
+
 //---------------------------------------------------------------------------//
 bool DTK_isValidMap( DTK_MapHandle handle )
 {
@@ -75,6 +192,148 @@ void DTK_applyMap( DTK_MapHandle handle, const char *source_field,
     errno = DTK_SUCCESS;
 }
 
+//---------------------------------------------------------------------------//
+void DTK_applyMapFields( DTK_MapHandle handle, int num_fields,
+                         const char **source_fields,
+                         const char **target_fields )
+{
+    if ( !DTK_isValidMap( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    std::vector<std::string> source_field_names;
+    std::vector<std::string> target_field_names;
+    for ( int i = 0; i < num_fields; ++i )
+    {
+        source_field_names.emplace_back( source_fields[i] );
+        target_field_names.emplace_back( target_fields[i] );
+    }
+    reinterpret_cast<DataTransferKit::DTK_Map *>( handle )->applyFields(
+        source_field_names, target_field_names );
+
+    errno = DTK_SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+void DTK_applyMapGroup( int num_maps, DTK_MapHandle *handles,
+                        const char **source_fields,
+                        const char **target_fields )
+{
+    std::vector<DataTransferKit::DTK_Map *> maps;
+    std::vector<std::string> source_field_names;
+    std::vector<std::string> target_field_names;
+    for ( int i = 0; i < num_maps; ++i )
+    {
+        if ( !DTK_isValidMap( handles[i] ) )
+        {
+            errno = DTK_INVALID_HANDLE;
+            return;
+        }
+        maps.push_back(
+            reinterpret_cast<DataTransferKit::DTK_Map *>( handles[i] ) );
+        source_field_names.emplace_back( source_fields[i] );
+        target_field_names.emplace_back( target_fields[i] );
+    }
+    DataTransferKit::applyMapGroup( maps, source_field_names,
+                                    target_field_names );
+
+    errno = DTK_SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+void DTK_applyMapAsync( DTK_MapHandle handle, const char *source_field,
+                        const char *target_field, DTK_MapRequest *request )
+{
+    *request = nullptr;
+    if ( !DTK_isValidMap( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    auto map = reinterpret_cast<DataTransferKit::DTK_Map *>( handle );
+    std::string const source_field_name( source_field );
+    std::string const target_field_name( target_field );
+    map->pullSource( source_field_name, target_field_name );
+
+    auto impl = new DataTransferKit::DTK_MapRequestImpl{
+        map, true, target_field_name,
+        std::async( DataTransferKit::mapRequestPolicy( map ),
+                    [map, source_field_name, target_field_name]() {
+                        map->applyOperator( source_field_name,
+                                            target_field_name );
+                    } )};
+
+    *request = reinterpret_cast<DTK_MapRequest>( impl );
+    DataTransferKit::valid_map_requests.insert( *request );
+
+    errno = DTK_SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+void DTK_waitMap( DTK_MapRequest *request )
+{
+    if ( *request == nullptr )
+    {
+        errno = DTK_SUCCESS;
+        return;
+    }
+    if ( !DataTransferKit::valid_map_requests.count( *request ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    DataTransferKit::completeMapRequest( request );
+
+    errno = DTK_SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+bool DTK_testMap( DTK_MapRequest *request )
+{
+    if ( *request == nullptr )
+    {
+        errno = DTK_SUCCESS;
+        return true;
+    }
+    if ( !DataTransferKit::valid_map_requests.count( *request ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return false;
+    }
+
+    // A deferred transfer is not running so it is applied right away.
+    if ( DataTransferKit::isRunning( *request ) )
+    {
+        errno = DTK_SUCCESS;
+        return false;
+    }
+
+    DataTransferKit::completeMapRequest( request );
+
+    errno = DTK_SUCCESS;
+    return true;
+}
+
+//---------------------------------------------------------------------------//
+const char *DTK_getMapStatistics( DTK_MapHandle handle )
+{
+    if ( !DTK_isValidMap( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return nullptr;
+    }
+
+    auto map = reinterpret_cast<DataTransferKit::DTK_Map *>( handle );
+    map->statistics_json = map->statistics.toJSON();
+
+    errno = DTK_SUCCESS;
+    return map->statistics_json.c_str();
+}
+
 //---------------------------------------------------------------------------//
 void DTK_destroyMap( DTK_MapHandle handle )
 {
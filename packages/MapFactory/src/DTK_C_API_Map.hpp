@@ -17,11 +17,13 @@
 
 #include <DTK_C_API.h>
 #include <DTK_C_API.hpp>
+#include <DTK_ConsistentInterpolationOperator.hpp>
 #include <DTK_DBC.hpp>
-#include <DTK_MovingLeastSquaresOperator.hpp>
-#include <DTK_NearestNeighborOperator.hpp>
+#include <DTK_InputAllocators.hpp>
 #include <DTK_ParallelTraits.hpp>
 #include <DTK_PointCloudOperator.hpp>
+#include <DTK_PointCloudOperatorRegistry.hpp>
+#include <DTK_Statistics.hpp>
 #include <DTK_UserApplication.hpp>
 
 #include <Teuchos_DefaultMpiComm.hpp>
@@ -31,9 +33,15 @@
 
 #include <mpi.h>
 
+#include <future>
+#include <map>
 #include <memory>
 #include <string>
 #include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -44,12 +52,91 @@ namespace DataTransferKit
 // calling the C interface and we don't need to - the apply function
 // implementation details will dispatch to the correct device type based on
 // the construction.
+//
+// apply() is split in three steps so that the C interface can apply the
+// operator asynchronously between reading the source field and writing the
+// target field.
 struct DTK_Map
 {
     virtual ~DTK_Map() = default;
 
-    virtual void apply( const std::string &source_field_name,
-                        const std::string &target_field_name ) = 0;
+    void apply( const std::string &source_field_name,
+                const std::string &target_field_name )
+    {
+        pullSource( source_field_name, target_field_name );
+        applyOperator( source_field_name, target_field_name );
+        pushTarget( target_field_name );
+    }
+
+    // Read the coordinates of the source and build the search tree over
+    // them. This is a collective call.
+    virtual void setupGeometry() = 0;
+
+    // Read the coordinates of the target, search their neighbors, and
+    // compute the operator. The geometry is set up first if it was not
+    // already. This is a collective call.
+    virtual void setupOperator() = 0;
+
+    // Copy the source field to the memory space of the map.
+    virtual void pullSource( const std::string &source_field_name,
+                             const std::string &target_field_name ) = 0;
+
+    // Apply the operator. This involves communication.
+    virtual void applyOperator( const std::string &source_field_name,
+                                const std::string &target_field_name ) = 0;
+
+    // Copy the transferred field back to the target application.
+    virtual void pushTarget( const std::string &target_field_name ) = 0;
+
+    // Apply the map to several fields with a single application of the
+    // operator.
+    virtual void
+    applyFields( const std::vector<std::string> &source_field_names,
+                 const std::vector<std::string> &target_field_names ) = 0;
+
+    // Communicator of the processes that take part in the map, see
+    // DTK_MapImpl::makeParticipantComm(). It is MPI_COMM_NULL on the other
+    // processes.
+    virtual MPI_Comm getComm() const = 0;
+
+    // Whether the kernels of the map run on a device. The kernels of a host
+    // execution space must be launched from the thread that initialized
+    // Kokkos.
+    virtual bool runsOnDevice() const = 0;
+
+    // First step of applyMapGroup(): pull the source field and pack the
+    // values the operator sends to other processes. Return false, without
+    // pulling the source field, if the operator does not fetch the source
+    // values with a plan and cannot be part of a combined exchange.
+    virtual bool beginGroupApply( const std::string &source_field_name,
+                                  const std::string &target_field_name,
+                                  Details::CombinedExchangePart &part ) = 0;
+
+    // Last step of applyMapGroup(): compute the target field from the
+    // values the combined exchange received and push it.
+    virtual void
+    endGroupApply( const std::string &target_field_name,
+                   Details::CombinedExchangePart const &part ) = 0;
+
+    // Time spent in each phase of the creation and of the applications of
+    // the map, and communication counters.
+    Statistics statistics;
+
+    // Storage of the string returned by DTK_getMapStatistics().
+    std::string statistics_json;
+};
+
+//---------------------------------------------------------------------------//
+// Map application started by DTK_applyMapAsync(). The operator is applied by
+// the transfer, either in a separate thread or when the request is completed.
+// The setup of a map started by DTK_setupMapGeometryAsync() or
+// DTK_setupMapOperatorAsync() has no target field to push.
+struct DTK_MapRequestImpl
+{
+    DTK_Map *map;
+    bool push_target;
+    std::string target_field_name;
+    std::future<void> transfer;
 };
 
 //---------------------------------------------------------------------------//
@@ -58,112 +145,729 @@ struct DTK_MapImpl : public DTK_Map
 {
     using map_device_type = typename MapExecSpace::device_type;
 
+    // Coordinates of the source in the memory space of the map and search
+    // tree over them. They are shared by the maps from the same source so
+    // that the geometry is only read and the tree only built once.
+    struct Geometry
+    {
+        Geometry( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                  Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                               map_device_type>
+                      source_coordinates )
+            : source_points( source_coordinates )
+            , search_tree(
+                  Details::NearestNeighborOperatorImpl<map_device_type>::
+                      makeDistributedSearchTree( comm, source_coordinates ) )
+        {
+        }
+
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                     map_device_type>
+            source_points;
+        DistributedSearchTree<map_device_type> search_tree;
+    };
+
+    // Check the options and set up the group of processes of the map. The
+    // map is set up by setupGeometry() and setupOperator(). The source or the
+    // target is null on the processes that do not hold it.
+    // NOTE: This is a collective call.
     DTK_MapImpl( MPI_Comm comm, DTK_UserApplicationHandle source,
                  DTK_UserApplicationHandle target,
                  boost::property_tree::ptree const &ptree )
-        : _source( reinterpret_cast<DTK_Registry *>( source )->_registry )
-        , _target( reinterpret_cast<DTK_Registry *>( target )->_registry )
-    {
-        // Create a Teuchos comm from the MPI comm.
-        auto teuchos_comm = Teuchos::rcp( new Teuchos::MpiComm<int>( comm ) );
-
-        // FOR NOW JUST CREATE A NEAREST NEIGHBOR OPERATOR FOR DEMONSTRATION
-        // PURPOSES. THIS WILL BE REPLACED BY A PROPER FACTORY.
-
-        // Get coordinates from the source and target.
-        auto source_nodes = _source.getNodeList().coordinates;
-        auto target_nodes = _target.getNodeList().coordinates;
-
-        // For now things are layout left in the interface so copy to a
-        // matching layout that is compatible with the operator.
-        Kokkos::View<Coordinate **, map_device_type> source_nodes_copy(
-            "src_nodes_copy", source_nodes.extent( 0 ),
-            source_nodes.extent( 1 ) );
-        Kokkos::deep_copy( source_nodes_copy, source_nodes );
-        Kokkos::View<Coordinate **, map_device_type> target_nodes_copy(
-            "tgt_nodes_copy", target_nodes.extent( 0 ),
-            target_nodes.extent( 1 ) );
-        Kokkos::deep_copy( target_nodes_copy, target_nodes );
+        : _comm( makeParticipantComm( comm, source != nullptr ||
+                                                 target != nullptr ) )
+        , _source_handle( source )
+        , _has_source( source != nullptr )
+        , _has_target( target != nullptr )
+        , _options( ptree )
+        , _source( getRegistry( source ) )
+        , _target( getRegistry( target ) )
+    {
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "create map" );
+
+        if ( _comm != MPI_COMM_NULL )
+            _teuchos_comm = Teuchos::createMpiComm<int>(
+                Teuchos::opaqueWrapper( _comm, freeParticipantComm ) );
 
         auto const which_map =
             ptree.get<std::string>( "Map Type", "Undefined" );
         if ( which_map == "Undefined" )
             throw DataTransferKitException(
                 R"(Field "Map Type" is not defined in options string argument for map creation)" );
-        else if ( which_map == "Nearest Neighbor" || which_map == "NN" )
-            _map = std::unique_ptr<NearestNeighborOperator<map_device_type>>(
-                new NearestNeighborOperator<map_device_type>(
-                    teuchos_comm, source_nodes_copy, target_nodes_copy ) );
-        else if ( which_map == "Moving Least Squares" || which_map == "MLS" )
+
+        if ( isConsistentInterpolation() )
         {
-            // NOTE if field "Order" is misspelled (for instance first letter
-            // not capitalized), the default value (linear polynomials) will be
-            // picked up without a warning or an error being raised.
-            auto const order = ptree.get<std::string>( "Order", "Linear" );
-            if ( order == "Linear" || order == "1" )
-                _map = std::unique_ptr<MovingLeastSquaresOperator<
-                    map_device_type, Wendland<0>,
-                    MultivariatePolynomialBasis<Linear, 3>>>(
-                    new MovingLeastSquaresOperator<
-                        map_device_type, Wendland<0>,
-                        MultivariatePolynomialBasis<Linear, 3>>(
-                        teuchos_comm, source_nodes_copy, target_nodes_copy ) );
-            else if ( order == "Quadratic" || order == "2" )
-                _map = std::unique_ptr<MovingLeastSquaresOperator<
-                    map_device_type, Wendland<0>,
-                    MultivariatePolynomialBasis<Quadratic, 3>>>(
-                    new MovingLeastSquaresOperator<
-                        map_device_type, Wendland<0>,
-                        MultivariatePolynomialBasis<Quadratic, 3>>(
-                        teuchos_comm, source_nodes_copy, target_nodes_copy ) );
-            else
+            getFEType( ptree );
+            if ( _has_target && !_has_source )
                 throw DataTransferKitException(
-                    "Invalid order \"" + order +
-                    "\" for creating a moving least squares map" );
+                    "A consistent interpolation map requires the source "
+                    "mesh on every process that holds the target" );
+        }
+        else
+        {
+            PointCloudOperatorRegistry<map_device_type>::validate( ptree );
         }
+    }
+
+    void setupGeometry() override
+    {
+        // The source of a consistent interpolation is a mesh so it does not
+        // need the nodes of the source and their search tree.
+        if ( _geometry || isConsistentInterpolation() || !isParticipant() )
+            return;
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "create map" );
+
+        // Get coordinates from the source and build the search tree, unless
+        // another map from the same source already did.
+        _geometry =
+            getGeometry( _options.get<bool>( "Reuse Geometry", true ) );
+    }
+
+    void setupOperator() override
+    {
+        if ( _map || !isParticipant() )
+            return;
+        setupGeometry();
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "create map" );
+
+        if ( isConsistentInterpolation() )
+            _map = makeConsistentInterpolationOperator( _teuchos_comm,
+                                                        _options );
         else
-            throw DataTransferKitException( "Invalid map type \"" + which_map +
-                                            "\"" );
+            _map = PointCloudOperatorRegistry<map_device_type>::create(
+                _options, _teuchos_comm, _geometry->search_tree,
+                _geometry->source_points,
+                _has_target ? getCoordinates( _target ) : noCoordinates() );
     }
 
-    void apply( const std::string &source_field_name,
-                const std::string &target_field_name ) override
-    {
-        // Create fields.
-        auto source_field = _source.getField( source_field_name );
-        auto target_field = _target.getField( target_field_name );
-
-        // Pull the data from the source.
-        _source.pullField( source_field_name, source_field );
-
-        // Copy to a compatible layout. Nearest neighbor operator needs a
-        // compatible layout and only 1 dimension
-        int num_src = source_field.dofs.extent( 0 );
-        Kokkos::View<double *, map_device_type> source_field_copy(
-            "source_field_copy", num_src );
-        Kokkos::deep_copy(
-            source_field_copy,
-            Kokkos::subview( source_field.dofs, Kokkos::ALL, 0 ) );
-        int num_tgt = target_field.dofs.extent( 0 );
-        Kokkos::View<double *, map_device_type> target_field_copy(
-            "target_field_copy", num_tgt );
-
-        // Apply the map.
-        _map->apply( source_field_copy, target_field_copy );
+    void pullSource( const std::string &source_field_name,
+                     const std::string &target_field_name ) override
+    {
+        if ( !isParticipant() )
+            return;
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "pull source field" );
+
+        // Get the buffers of the fields. They are only allocated when the
+        // size of a field changes. A process that does not hold one of the
+        // applications owns no dofs of its field, which has as many
+        // components as the other field.
+        auto &source_buffers = _source_buffers[source_field_name];
+        if ( _has_source )
+            updateFieldBuffers( _source, source_field_name, source_buffers );
+        auto &target_buffers = _target_buffers[target_field_name];
+        if ( _has_target )
+            updateFieldBuffers( _target, target_field_name, target_buffers );
+        if ( !_has_source )
+            resizeMapField( source_field_name, 0,
+                            target_buffers.map_field.extent( 1 ),
+                            source_buffers );
+        if ( !_has_target )
+            resizeMapField( target_field_name, 0,
+                            source_buffers.map_field.extent( 1 ),
+                            target_buffers );
+        if ( !_has_source )
+            return;
+
+        // Copy the source field to a layout compatible with the operator.
+        // All the components of the field are transferred at once. A
+        // registered field storage is read directly, otherwise the field is
+        // pulled from the application.
+        if ( _source.hasFieldStorage( source_field_name ) )
+        {
+            Kokkos::deep_copy( source_buffers.map_field,
+                               _source.getFieldStorage( source_field_name ) );
+        }
+        else
+        {
+            _source.pullField( source_field_name, source_buffers.field );
+            Kokkos::deep_copy( source_buffers.map_field,
+                               source_buffers.field.dofs );
+        }
+    }
+
+    void applyOperator( const std::string &source_field_name,
+                        const std::string &target_field_name ) override
+    {
+        // The map may not have been set up yet if it was created with
+        // DTK_createMapDeferred().
+        setupOperator();
+        if ( !isParticipant() )
+            return;
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "apply operator" );
+
+        statistics.addCount( "operator applications", 1 );
+        // The buffers have been set up by pullSource().
+        _map->applyComponents(
+            _source_buffers.at( source_field_name ).map_field,
+            _target_buffers.at( target_field_name ).map_field );
+    }
+
+    void pushTarget( const std::string &target_field_name ) override
+    {
+        if ( !isParticipant() || !_has_target )
+            return;
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "push target field" );
+
+        auto &target_buffers = _target_buffers.at( target_field_name );
 
         // Copy the transferred field back to the original target layout.
-        Kokkos::deep_copy( Kokkos::subview( target_field.dofs, Kokkos::ALL, 0 ),
-                           target_field_copy );
+        if ( _target.hasFieldStorage( target_field_name ) )
+        {
+            Kokkos::deep_copy( _target.getFieldStorage( target_field_name ),
+                               target_buffers.map_field );
+        }
+        else
+        {
+            Kokkos::deep_copy( target_buffers.field.dofs,
+                               target_buffers.map_field );
+
+            // Push the data to the target.
+            _target.pushField( target_field_name, target_buffers.field );
+        }
+    }
+
+    void
+    applyFields( const std::vector<std::string> &source_field_names,
+                 const std::vector<std::string> &target_field_names ) override
+    {
+        setupOperator();
+        if ( !isParticipant() )
+            return;
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "apply operator" );
+
+        statistics.addCount( "operator applications", 1 );
+        DTK_REQUIRE( source_field_names.size() == target_field_names.size() );
+        size_t const n_fields = source_field_names.size();
+        if ( n_fields == 0 )
+            return;
+
+        for ( size_t i = 0; i < n_fields; ++i )
+            pullSource( source_field_names[i], target_field_names[i] );
+
+        // Gather the components of all the fields in a single view so that
+        // the operator communicates them at once.
+        size_t const n_source_dofs =
+            _source_buffers.at( source_field_names[0] ).map_field.extent( 0 );
+        size_t const n_target_dofs =
+            _target_buffers.at( target_field_names[0] ).map_field.extent( 0 );
+        size_t n_components = 0;
+        for ( size_t i = 0; i < n_fields; ++i )
+        {
+            auto const &source_field =
+                _source_buffers.at( source_field_names[i] ).map_field;
+            auto const &target_field =
+                _target_buffers.at( target_field_names[i] ).map_field;
+            DTK_REQUIRE( source_field.extent( 0 ) == n_source_dofs );
+            DTK_REQUIRE( target_field.extent( 0 ) == n_target_dofs );
+            DTK_REQUIRE( source_field.extent( 1 ) == target_field.extent( 1 ) );
+            n_components += source_field.extent( 1 );
+        }
+        if ( _batched_source_field.extent( 0 ) != n_source_dofs ||
+             _batched_source_field.extent( 1 ) != n_components )
+            _batched_source_field = Kokkos::View<double **, map_device_type>(
+                "batched_source_field", n_source_dofs, n_components );
+        if ( _batched_target_field.extent( 0 ) != n_target_dofs ||
+             _batched_target_field.extent( 1 ) != n_components )
+            _batched_target_field = Kokkos::View<double **, map_device_type>(
+                "batched_target_field", n_target_dofs, n_components );
+
+        size_t first_component = 0;
+        for ( size_t i = 0; i < n_fields; ++i )
+        {
+            auto const &source_field =
+                _source_buffers.at( source_field_names[i] ).map_field;
+            auto const components = std::make_pair(
+                first_component, first_component + source_field.extent( 1 ) );
+            Kokkos::deep_copy( Kokkos::subview( _batched_source_field,
+                                                Kokkos::ALL, components ),
+                               source_field );
+            first_component = components.second;
+        }
+
+        _map->applyComponents( _batched_source_field, _batched_target_field );
+
+        first_component = 0;
+        for ( size_t i = 0; i < n_fields; ++i )
+        {
+            auto const &target_field =
+                _target_buffers.at( target_field_names[i] ).map_field;
+            auto const components = std::make_pair(
+                first_component, first_component + target_field.extent( 1 ) );
+            Kokkos::deep_copy( target_field,
+                               Kokkos::subview( _batched_target_field,
+                                                Kokkos::ALL, components ) );
+            first_component = components.second;
+            pushTarget( target_field_names[i] );
+        }
+    }
+
+    MPI_Comm getComm() const override { return _comm; }
+
+    bool runsOnDevice() const override
+    {
+#if defined( KOKKOS_ENABLE_CUDA )
+        return std::is_same<MapExecSpace, Kokkos::Cuda>::value;
+#else
+        return false;
+#endif
+    }
+
+    bool beginGroupApply( const std::string &source_field_name,
+                          const std::string &target_field_name,
+                          Details::CombinedExchangePart &part ) override
+    {
+        setupOperator();
+        auto const plan = _map->getFetchPlan();
+        if ( plan == nullptr )
+            return false;
+
+        pullSource( source_field_name, target_field_name );
+
+        StatisticsScope statistics_scope( statistics );
+        ScopedTimer timer( "apply operator" );
+
+        statistics.addCount( "operator applications", 1 );
+        using Impl = Details::NearestNeighborOperatorImpl<map_device_type>;
+        part = Impl::makeCombinedExchangePart(
+            *plan, _source_buffers.at( source_field_name ).map_field );
+        return true;
+    }
+
+    void endGroupApply( const std::string &target_field_name,
+                        Details::CombinedExchangePart const &part ) override
+    {
+        {
+            StatisticsScope statistics_scope( statistics );
+            ScopedTimer timer( "apply operator" );
+
+            using Impl =
+                Details::NearestNeighborOperatorImpl<map_device_type>;
+            auto const &plan = *_map->getFetchPlan();
+            int const n_imports = plan.import_indices.extent( 0 );
+            Kokkos::View<double **, Kokkos::LayoutRight, map_device_type>
+                imports( Kokkos::ViewAllocateWithoutInitializing( "imports" ),
+                         n_imports, part.n_components );
+            Kokkos::deep_copy(
+                imports,
+                Kokkos::View<double const **, Kokkos::LayoutRight,
+                             Kokkos::HostSpace, Kokkos::MemoryUnmanaged>(
+                    part.imports.data(), n_imports, part.n_components ) );
+            _map->applyFetched( Impl::unpackImports( plan, imports ),
+                                _target_buffers.at( target_field_name )
+                                    .map_field );
+        }
+        pushTarget( target_field_name );
+    }
+
+    // Buffers of a field that are reused across the calls to apply(): the
+    // field exchanged with the application and its copy in the layout of the
+    // operator.
+    template <class MemSpace>
+    struct FieldBuffers
+    {
+        Field<double, Kokkos::LayoutLeft, MemSpace> field;
+        Kokkos::View<double **, map_device_type> map_field;
+    };
+
+    // Reallocate the buffers of a field if its size has changed since the
+    // last call. The application field is not needed when the storage of the
+    // field has been registered.
+    template <class MemSpace>
+    static void updateFieldBuffers( UserApplication<double, MemSpace> &app,
+                                    const std::string &field_name,
+                                    FieldBuffers<MemSpace> &buffers )
+    {
+        unsigned field_dim;
+        size_t local_num_dofs;
+        bool const has_storage = app.hasFieldStorage( field_name );
+        if ( has_storage )
+        {
+            auto storage = app.getFieldStorage( field_name );
+            local_num_dofs = storage.extent( 0 );
+            field_dim = storage.extent( 1 );
+        }
+        else
+        {
+            app.getFieldSize( field_name, field_dim, local_num_dofs );
+        }
+
+        if ( !has_storage &&
+             ( buffers.field.dofs.extent( 0 ) != local_num_dofs ||
+               buffers.field.dofs.extent( 1 ) != field_dim ) )
+            buffers.field = InputAllocators<Kokkos::LayoutLeft, MemSpace>::
+                template allocateField<double>( local_num_dofs, field_dim );
+
+        resizeMapField( field_name, local_num_dofs, field_dim, buffers );
+    }
+
+    template <class MemSpace>
+    static void resizeMapField( const std::string &field_name,
+                                size_t local_num_dofs, unsigned field_dim,
+                                FieldBuffers<MemSpace> &buffers )
+    {
+        if ( buffers.map_field.extent( 0 ) != local_num_dofs ||
+             buffers.map_field.extent( 1 ) != field_dim )
+            buffers.map_field = Kokkos::View<double **, map_device_type>(
+                "map_field_" + field_name, local_num_dofs, field_dim );
+    }
 
-        // Push the data to the target.
-        _target.pushField( target_field_name, target_field );
+    // Get the geometry shared by the maps from the same source over the same
+    // group of processes. It is released when the last of these maps is
+    // destroyed. It keeps the communicator of the map that created it.
+    // NOTE: This is a collective call when the geometry is not reused.
+    std::shared_ptr<Geometry> getGeometry( bool reuse_geometry )
+    {
+        static std::map<DTK_UserApplicationHandle,
+                        std::pair<MPI_Comm, std::weak_ptr<Geometry>>>
+            geometries;
+
+        if ( reuse_geometry )
+        {
+            auto const entry = geometries.find( _source_handle );
+            if ( entry != geometries.end() )
+            {
+                auto geometry = entry->second.second.lock();
+                int comparison = MPI_UNEQUAL;
+                if ( geometry )
+                    MPI_Comm_compare( entry->second.first, _comm,
+                                      &comparison );
+                if ( comparison == MPI_IDENT || comparison == MPI_CONGRUENT )
+                    return geometry;
+            }
+        }
+
+        auto geometry = std::make_shared<Geometry>(
+            _teuchos_comm,
+            _has_source ? getCoordinates( _source ) : noCoordinates() );
+        if ( reuse_geometry )
+            geometries[_source_handle] = std::make_pair( _comm, geometry );
+        return geometry;
+    }
+
+    // Group the processes that take part in the map, out of the processes of
+    // comm or, if it is an inter-communicator, of both of its groups, e.g.
+    // the processes of two programs coupled in an MPMD job. The processes
+    // that hold neither the source nor the target get MPI_COMM_NULL and are
+    // left out of all the communication of the map.
+    // NOTE: This is a collective call.
+    static MPI_Comm makeParticipantComm( MPI_Comm comm, bool participates )
+    {
+        int is_inter_comm;
+        MPI_Comm_test_inter( comm, &is_inter_comm );
+        MPI_Comm intra_comm = comm;
+        if ( is_inter_comm )
+            MPI_Intercomm_merge( comm, 0, &intra_comm );
+
+        int comm_rank;
+        MPI_Comm_rank( intra_comm, &comm_rank );
+        MPI_Comm participant_comm;
+        MPI_Comm_split( intra_comm, participates ? 0 : MPI_UNDEFINED,
+                        comm_rank, &participant_comm );
+
+        if ( is_inter_comm )
+            MPI_Comm_free( &intra_comm );
+        return participant_comm;
+    }
+
+    // Free a communicator created by makeParticipantComm() when the last
+    // operator or geometry that uses it is released.
+    static void freeParticipantComm( MPI_Comm *comm )
+    {
+        int finalized;
+        MPI_Finalized( &finalized );
+        if ( !finalized )
+            MPI_Comm_free( comm );
+    }
+
+    bool isParticipant() const { return !_teuchos_comm.is_null(); }
+
+    // The processes that do not hold an application read it as an empty one.
+    static std::shared_ptr<UserFunctionRegistry<double>>
+    getRegistry( DTK_UserApplicationHandle handle )
+    {
+        if ( handle == nullptr )
+            return std::make_shared<UserFunctionRegistry<double>>();
+        return reinterpret_cast<DTK_Registry *>( handle )->_registry;
+    }
+
+    bool isConsistentInterpolation() const
+    {
+        auto const which_map = _options.get<std::string>( "Map Type" );
+        return which_map == "Consistent Interpolation" || which_map == "CI";
+    }
+
+    static DTK_FEType getFEType( boost::property_tree::ptree const &ptree )
+    {
+        auto const fe_type_name =
+            ptree.get<std::string>( "Finite Element Type", "HGRAD" );
+        if ( fe_type_name == "HGRAD" )
+            return DTK_HGRAD;
+        if ( fe_type_name == "HDIV" )
+            return DTK_HDIV;
+        if ( fe_type_name == "HCURL" )
+            return DTK_HCURL;
+        throw DataTransferKitException(
+            "Invalid finite element type \"" + fe_type_name +
+            "\" for creating a consistent interpolation map" );
+    }
+
+    // Get the coordinates of the nodes of an application. The operators
+    // accept strided coordinates so the coordinates are only copied when they
+    // do not live in the memory space of the map. The storage of the
+    // application is used directly when it provides a view of it.
+    template <class MemSpace>
+    static Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                        map_device_type>
+    getCoordinates( UserApplication<double, MemSpace> &app )
+    {
+        ScopedTimer timer( "read coordinates" );
+
+        using is_map_memory_space =
+            std::is_same<MemSpace, typename map_device_type::memory_space>;
+        if ( app.hasNodeListView() )
+            return mapCoordinates( app.getNodeListView().coordinates,
+                                   is_map_memory_space() );
+        return mapCoordinates( app.getNodeList().coordinates,
+                               is_map_memory_space() );
+    }
+
+    // Coordinates of the nodes of an application that the process does not
+    // hold.
+    static Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                        map_device_type>
+    noCoordinates()
+    {
+        return Kokkos::View<Coordinate **, Kokkos::LayoutLeft, map_device_type>(
+            "coordinates", 0, 3 );
+    }
+
+    // Coordinates that already live in the memory space of the map are used
+    // as they are.
+    template <class View>
+    static Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                        map_device_type>
+    mapCoordinates( View coordinates, std::true_type )
+    {
+        return coordinates;
+    }
+
+    // Otherwise, they are copied to the memory space of the map with the
+    // same layout.
+    template <class MemSpace>
+    static Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                        map_device_type>
+    mapCoordinates(
+        Kokkos::View<Coordinate **, Kokkos::LayoutLeft, MemSpace> coordinates,
+        std::false_type )
+    {
+        Kokkos::View<Coordinate **, Kokkos::LayoutLeft, map_device_type>
+            coordinates_copy( "map_" + coordinates.label(),
+                              coordinates.extent( 0 ),
+                              coordinates.extent( 1 ) );
+        Kokkos::deep_copy( coordinates_copy, coordinates );
+        return coordinates_copy;
+    }
+
+    // Strided coordinates cannot be copied across memory spaces so they are
+    // made contiguous in their memory space first.
+    template <class MemSpace>
+    static Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                        map_device_type>
+    mapCoordinates( Kokkos::View<Coordinate **, Kokkos::LayoutStride, MemSpace,
+                                 Kokkos::MemoryUnmanaged>
+                        coordinates,
+                    std::false_type )
+    {
+        Kokkos::View<Coordinate **, Kokkos::LayoutLeft, MemSpace>
+            coordinates_left( "coordinates", coordinates.extent( 0 ),
+                              coordinates.extent( 1 ) );
+        Kokkos::deep_copy( coordinates_left, coordinates );
+        return mapCoordinates( coordinates_left, std::false_type() );
+    }
+
+    // Build the consistent interpolation from the cell list and the dof map
+    // of the source to the nodes of the target. NOTE: This is a collective
+    // call.
+    std::unique_ptr<PointCloudOperator<map_device_type>>
+    makeConsistentInterpolationOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &teuchos_comm,
+        boost::property_tree::ptree const &ptree )
+    {
+        auto const fe_type = getFEType( ptree );
+
+        using is_source_map_memory_space =
+            std::is_same<SourceMemSpace,
+                         typename map_device_type::memory_space>;
+        Kokkos::View<Coordinate **, map_device_type> nodes_coordinates;
+        Kokkos::View<DTK_CellTopology *, map_device_type> cell_topologies;
+        Kokkos::View<LocalOrdinal *, map_device_type> cells;
+        Kokkos::View<LocalOrdinal *, map_device_type> cell_dof_ids;
+        {
+            ScopedTimer timer( "read mesh" );
+
+            auto cell_list = _source.getCellList();
+            nodes_coordinates = copyCoordinates( mapCoordinates(
+                cell_list.coordinates, is_source_map_memory_space() ) );
+            cell_topologies = copyToMapSpace( cell_list.cell_topologies );
+            cells = copyToMapSpace( cell_list.cells );
+
+            std::string discretization_type;
+            auto dof_map = _source.getDOFMap( discretization_type );
+            auto const &object_dof_ids = dof_map.object_dof_ids;
+            Kokkos::View<LocalOrdinal *, Kokkos::LayoutLeft, SourceMemSpace>
+                dof_ids( object_dof_ids.data(), object_dof_ids.size() );
+            cell_dof_ids = copyToMapSpace( dof_ids );
+            if ( object_dof_ids.rank() == 2 )
+                cell_dof_ids = numberDofsByCell( cell_dof_ids,
+                                                 object_dof_ids.extent( 0 ),
+                                                 object_dof_ids.extent( 1 ) );
+        }
+        auto target_points = copyCoordinates(
+            _has_target ? getCoordinates( _target ) : noCoordinates() );
+
+        return std::unique_ptr<
+            ConsistentInterpolationOperator<map_device_type>>(
+            new ConsistentInterpolationOperator<map_device_type>(
+                teuchos_comm, cell_topologies, cells, nodes_coordinates,
+                cell_dof_ids, fe_type, target_points ) );
+    }
+
+    // The mesh-based operators expect views with the default layout of the
+    // memory space of the map.
+    static Kokkos::View<Coordinate **, map_device_type> copyCoordinates(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride,
+                     map_device_type>
+            coordinates )
+    {
+        Kokkos::View<Coordinate **, map_device_type> coordinates_copy(
+            Kokkos::ViewAllocateWithoutInitializing( coordinates.label() ),
+            coordinates.extent( 0 ), coordinates.extent( 1 ) );
+        Kokkos::deep_copy( coordinates_copy, coordinates );
+        return coordinates_copy;
+    }
+
+    template <class T, class MemSpace>
+    static Kokkos::View<T *, map_device_type>
+    copyToMapSpace( Kokkos::View<T *, Kokkos::LayoutLeft, MemSpace> view )
+    {
+        Kokkos::View<T *, map_device_type> view_copy(
+            Kokkos::ViewAllocateWithoutInitializing( "map_" + view.label() ),
+            view.extent( 0 ) );
+        Kokkos::deep_copy( view_copy, view );
+        return view_copy;
+    }
+
+    // Reorder the dofs of a rank-2 dof map, which are stored dof by dof, so
+    // that the dofs of a cell are contiguous.
+    static Kokkos::View<LocalOrdinal *, map_device_type>
+    numberDofsByCell( Kokkos::View<LocalOrdinal *, map_device_type> dof_ids,
+                      unsigned int const n_cells,
+                      unsigned int const n_dofs_per_cell )
+    {
+        Kokkos::View<LocalOrdinal *, map_device_type> cell_dof_ids(
+            Kokkos::ViewAllocateWithoutInitializing( "cell_dof_ids" ),
+            dof_ids.extent( 0 ) );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "number_dofs_by_cell" ),
+            Kokkos::RangePolicy<MapExecSpace>( 0, n_cells ),
+            KOKKOS_LAMBDA( int const i ) {
+                for ( unsigned int j = 0; j < n_dofs_per_cell; ++j )
+                    cell_dof_ids( i * n_dofs_per_cell + j ) =
+                        dof_ids( j * n_cells + i );
+            } );
+        Kokkos::fence();
+        return cell_dof_ids;
     }
 
+    // The communicator is owned by _teuchos_comm, which is null on the
+    // processes that do not take part in the map.
+    MPI_Comm _comm;
+    Teuchos::RCP<Teuchos::Comm<int> const> _teuchos_comm;
+    DTK_UserApplicationHandle _source_handle;
+    bool _has_source;
+    bool _has_target;
+    boost::property_tree::ptree _options;
     UserApplication<double, SourceMemSpace> _source;
     UserApplication<double, TargetMemSpace> _target;
+    std::shared_ptr<Geometry> _geometry;
+    std::unordered_map<std::string, FieldBuffers<SourceMemSpace>>
+        _source_buffers;
+    std::unordered_map<std::string, FieldBuffers<TargetMemSpace>>
+        _target_buffers;
+    Kokkos::View<double **, map_device_type> _batched_source_field;
+    Kokkos::View<double **, map_device_type> _batched_target_field;
     std::unique_ptr<PointCloudOperator<map_device_type>> _map;
 };
 
+//---------------------------------------------------------------------------//
+// Apply several maps, the i-th one from the i-th source field to the i-th
+// target field, with a single exchange of the source values instead of one
+// per map. The maps whose operator does not fetch the source values with a
+// plan, e.g. consistent interpolations, are applied on their own. All the
+// maps must have been created over the same group of processes and with the
+// same processes holding an application. The other processes do nothing.
+// NOTE: This is a collective call.
+void applyMapGroup( const std::vector<DTK_Map *> &maps,
+                    const std::vector<std::string> &source_field_names,
+                    const std::vector<std::string> &target_field_names )
+{
+    DTK_REQUIRE( source_field_names.size() == maps.size() );
+    DTK_REQUIRE( target_field_names.size() == maps.size() );
+    if ( maps.empty() )
+        return;
+
+    MPI_Comm const comm = maps[0]->getComm();
+    if ( comm == MPI_COMM_NULL )
+    {
+        for ( auto map : maps )
+            DTK_INSIST( map->getComm() == MPI_COMM_NULL );
+        return;
+    }
+    std::vector<size_t> grouped_maps;
+    std::vector<Details::CombinedExchangePart> parts;
+    for ( size_t i = 0; i < maps.size(); ++i )
+    {
+        DTK_INSIST( maps[i]->getComm() != MPI_COMM_NULL );
+        int comparison;
+        MPI_Comm_compare( comm, maps[i]->getComm(), &comparison );
+        DTK_INSIST( comparison == MPI_IDENT || comparison == MPI_CONGRUENT );
+
+        Details::CombinedExchangePart part;
+        if ( maps[i]->beginGroupApply( source_field_names[i],
+                                       target_field_names[i], part ) )
+        {
+            grouped_maps.push_back( i );
+            parts.push_back( std::move( part ) );
+        }
+        else
+        {
+            maps[i]->apply( source_field_names[i], target_field_names[i] );
+        }
+    }
+    if ( grouped_maps.empty() )
+        return;
+
+    Details::exchangeCombined(
+        Teuchos::rcp( new Teuchos::MpiComm<int>( comm ) ), parts );
+
+    for ( size_t k = 0; k < grouped_maps.size(); ++k )
+        maps[grouped_maps[k]]->endGroupApply(
+            target_field_names[grouped_maps[k]], parts[k] );
+}
+
 //---------------------------------------------------------------------------//
 // Execution space validation.
 bool validExecutionSpace( DTK_ExecutionSpace space )
@@ -222,6 +926,14 @@ bool validMemorySpace( DTK_MemorySpace space )
 #else
         return false;
         break;
+#endif
+    case DTK_CUDA_SPACE:
+#if defined( KOKKOS_ENABLE_CUDA )
+        return true;
+        break;
+#else
+        return false;
+        break;
 #endif
     default:
         return false;
@@ -229,10 +941,16 @@ bool validMemorySpace( DTK_MemorySpace space )
     }
 }
 
-// Map space validation.
+// Map space validation. Device memory is not accessible from the host so
+// applications in CudaSpace can only be used with a map executing on the
+// device.
 bool validMapSpaces( DTK_ExecutionSpace map_space, DTK_MemorySpace source_space,
                      DTK_MemorySpace target_space )
 {
+    if ( ( source_space == DTK_CUDA_SPACE || target_space == DTK_CUDA_SPACE ) &&
+         map_space != DTK_CUDA )
+        return false;
+
     return validExecutionSpace( map_space ) &&
            validMemorySpace( source_space ) && validMemorySpace( target_space );
 }
@@ -258,11 +976,25 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
             "map creation" );
     }
 
-    // Get the user source and target memory spaces.
-    DTK_MemorySpace src_space =
-        reinterpret_cast<DataTransferKit::DTK_Registry *>( source )->_space;
-    DTK_MemorySpace tgt_space =
-        reinterpret_cast<DataTransferKit::DTK_Registry *>( target )->_space;
+    // Get the user source and target memory spaces. A process that does not
+    // hold one of the applications reads it as an empty one in the memory
+    // space of the other application.
+    auto const source_registry =
+        reinterpret_cast<DataTransferKit::DTK_Registry *>( source );
+    auto const target_registry =
+        reinterpret_cast<DataTransferKit::DTK_Registry *>( target );
+    DTK_MemorySpace const default_space =
+        ( map_space == DTK_CUDA ) ? DTK_CUDAUVM_SPACE : DTK_HOST_SPACE;
+    DTK_MemorySpace src_space = default_space;
+    DTK_MemorySpace tgt_space = default_space;
+    if ( source_registry )
+        src_space = tgt_space = source_registry->_space;
+    if ( target_registry )
+    {
+        tgt_space = target_registry->_space;
+        if ( !source_registry )
+            src_space = tgt_space;
+    }
 
     // Check up front that we have been asked for execution and memory spaces
     // that are available in the kokkos build. This lets use a little cleaner
@@ -291,6 +1023,10 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                     comm, source, target, ptree );
 #endif
                 break;
+
+            case DTK_CUDA_SPACE:
+                // Rejected by validMapSpaces().
+                break;
             }
             break;
 
@@ -307,9 +1043,17 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                 map = new DTK_MapImpl<Serial, CudaUVMSpace, CudaUVMSpace>(
                     comm, source, target, ptree );
                 break;
+
+            case DTK_CUDA_SPACE:
+                // Rejected by validMapSpaces().
+                break;
             }
 #endif
             break;
+
+        case DTK_CUDA_SPACE:
+            // Rejected by validMapSpaces().
+            break;
         }
 #endif
         break;
@@ -332,6 +1076,10 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                     comm, source, target, ptree );
 #endif
                 break;
+
+            case DTK_CUDA_SPACE:
+                // Rejected by validMapSpaces().
+                break;
             }
             break;
 
@@ -348,9 +1096,17 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                 map = new DTK_MapImpl<OpenMP, CudaUVMSpace, CudaUVMSpace>(
                     comm, source, target, ptree );
                 break;
+
+            case DTK_CUDA_SPACE:
+                // Rejected by validMapSpaces().
+                break;
             }
 #endif
             break;
+
+        case DTK_CUDA_SPACE:
+            // Rejected by validMapSpaces().
+            break;
         }
 #endif
         break;
@@ -372,6 +1128,11 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                 map = new DTK_MapImpl<Cuda, HostSpace, CudaUVMSpace>(
                     comm, source, target, ptree );
                 break;
+
+            case DTK_CUDA_SPACE:
+                map = new DTK_MapImpl<Cuda, HostSpace, CudaSpace>(
+                    comm, source, target, ptree );
+                break;
             }
 #endif
             break;
@@ -389,6 +1150,30 @@ DTK_Map *createMap( DTK_ExecutionSpace map_space, MPI_Comm comm,
                 map = new DTK_MapImpl<Cuda, CudaUVMSpace, CudaUVMSpace>(
                     comm, source, target, ptree );
                 break;
+            case DTK_CUDA_SPACE:
+                map = new DTK_MapImpl<Cuda, CudaUVMSpace, CudaSpace>(
+                    comm, source, target, ptree );
+                break;
+            }
+            break;
+
+        case DTK_CUDA_SPACE:
+            switch ( tgt_space )
+            {
+            case DTK_HOST_SPACE:
+#if defined( KOKKOS_ENABLE_SERIAL ) || defined( KOKKOS_ENABLE_OPENMP )
+                map = new DTK_MapImpl<Cuda, CudaSpace, HostSpace>(
+                    comm, source, target, ptree );
+#endif
+                break;
+            case DTK_CUDAUVM_SPACE:
+                map = new DTK_MapImpl<Cuda, CudaSpace, CudaUVMSpace>(
+                    comm, source, target, ptree );
+                break;
+            case DTK_CUDA_SPACE:
+                map = new DTK_MapImpl<Cuda, CudaSpace, CudaSpace>(
+                    comm, source, target, ptree );
+                break;
             }
             break;
         }
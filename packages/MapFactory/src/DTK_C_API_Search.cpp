@@ -0,0 +1,156 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_C_API.h>
+#include <DTK_C_API_Search.hpp>
+
+#include <cerrno>
+#include <memory>
+#include <set>
+
+//---------------------------------------------------------------------------//
+namespace DataTransferKit
+{
+
+// We store the reinterpret_cast versions of pointers
+static std::set<void *> valid_search_tree_handles;
+
+// Run a search on a valid tree and report its number of results.
+template <typename Search>
+static void search( DTK_SearchTreeHandle handle, size_t *num_results,
+                    Search run )
+{
+    if ( !DTK_isValidSearchTree( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    try
+    {
+        auto tree = reinterpret_cast<DTK_SearchTree *>( handle );
+        run( tree );
+        *num_results = tree->getNumResults();
+        errno = DTK_SUCCESS;
+    }
+    catch ( ... )
+    {
+        errno = DTK_UNKNOWN;
+    }
+}
+
+//---------------------------------------------------------------------------//
+
+} // end namespace DataTransferKit
+
+//---------------------------------------------------------------------------//
+
+extern "C" {
+
+//---------------------------------------------------------------------------//
+DTK_SearchTreeHandle DTK_createSearchTree( DTK_ExecutionSpace space,
+                                           MPI_Comm comm,
+                                           Coordinate const *coordinates,
+                                           unsigned space_dim,
+                                           size_t local_num_points,
+                                           size_t point_stride,
+                                           size_t dim_stride )
+{
+    if ( !DTK_isInitialized() )
+    {
+        errno = DTK_UNINITIALIZED;
+        return nullptr;
+    }
+
+    try
+    {
+        auto handle = reinterpret_cast<DTK_SearchTreeHandle>(
+            DataTransferKit::createSearchTree( space, comm, coordinates,
+                                               space_dim, local_num_points,
+                                               point_stride, dim_stride ) );
+        DataTransferKit::valid_search_tree_handles.insert( handle );
+        errno = DTK_SUCCESS;
+        return handle;
+    }
+    catch ( ... )
+    {
+        errno = DTK_UNKNOWN;
+        return nullptr;
+    }
+}
+
+//---------------------------------------------------------------------------//
+bool DTK_isValidSearchTree( DTK_SearchTreeHandle handle )
+{
+    errno = DTK_SUCCESS;
+    return DataTransferKit::valid_search_tree_handles.count( handle );
+}
+
+//---------------------------------------------------------------------------//
+void DTK_searchNearest( DTK_SearchTreeHandle handle, Coordinate const *points,
+                        size_t num_points, size_t point_stride,
+                        size_t dim_stride, unsigned k, size_t *num_results )
+{
+    DataTransferKit::search(
+        handle, num_results, [=]( DataTransferKit::DTK_SearchTree *tree ) {
+            tree->searchNearest( points, num_points, point_stride, dim_stride,
+                                 k );
+        } );
+}
+
+//---------------------------------------------------------------------------//
+void DTK_searchWithin( DTK_SearchTreeHandle handle, Coordinate const *points,
+                       size_t num_points, size_t point_stride,
+                       size_t dim_stride, double radius, size_t *num_results )
+{
+    DataTransferKit::search(
+        handle, num_results, [=]( DataTransferKit::DTK_SearchTree *tree ) {
+            tree->searchWithin( points, num_points, point_stride, dim_stride,
+                                radius );
+        } );
+}
+
+//---------------------------------------------------------------------------//
+void DTK_getSearchResults( DTK_SearchTreeHandle handle, int *offset,
+                           int *indices, int *ranks )
+{
+    if ( !DTK_isValidSearchTree( handle ) )
+    {
+        errno = DTK_INVALID_HANDLE;
+        return;
+    }
+
+    auto tree = reinterpret_cast<DataTransferKit::DTK_SearchTree *>( handle );
+    tree->getResults( offset, indices, ranks );
+
+    errno = DTK_SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+void DTK_destroySearchTree( DTK_SearchTreeHandle handle )
+{
+    if ( DataTransferKit::valid_search_tree_handles.count( handle ) )
+    {
+        auto tree =
+            reinterpret_cast<DataTransferKit::DTK_SearchTree *>( handle );
+        delete tree;
+        DataTransferKit::valid_search_tree_handles.erase( handle );
+        errno = DTK_SUCCESS;
+    }
+    else
+    {
+        errno = DTK_INVALID_HANDLE;
+    }
+}
+
+//---------------------------------------------------------------------------//
+
+} // end extern "C"
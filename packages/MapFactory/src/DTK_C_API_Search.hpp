@@ -0,0 +1,213 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief C adapter to the distributed search.
+ */
+#ifndef DTK_C_API_SEARCH_HPP
+#define DTK_C_API_SEARCH_HPP
+
+#include <DTK_C_API.h>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp>
+#include <DTK_DistributedSearchTree.hpp>
+#include <DTK_ParallelTraits.hpp>
+
+#include <Teuchos_DefaultMpiComm.hpp>
+
+#include <mpi.h>
+
+namespace DataTransferKit
+{
+//---------------------------------------------------------------------------//
+// Search tree interface base class. As for DTK_Map, it hides the device type
+// of the tree from the C interface.
+struct DTK_SearchTree
+{
+    virtual ~DTK_SearchTree() = default;
+
+    // Search the k nearest points of each query point. This is a collective
+    // call.
+    virtual void searchNearest( Coordinate const *points, size_t num_points,
+                                size_t point_stride, size_t dim_stride,
+                                unsigned k ) = 0;
+
+    // Search the points within a radius of each query point. This is a
+    // collective call.
+    virtual void searchWithin( Coordinate const *points, size_t num_points,
+                               size_t point_stride, size_t dim_stride,
+                               double radius ) = 0;
+
+    // Number of points found by the last search.
+    virtual size_t getNumResults() const = 0;
+
+    // Write the results of the last search into the arrays of the caller.
+    virtual void getResults( int *offset, int *indices, int *ranks ) const = 0;
+};
+
+//---------------------------------------------------------------------------//
+// The arrays of the caller are wrapped in unmanaged views of the memory
+// space of the tree so that they are neither copied nor allocated again.
+template <class ExecSpace>
+struct DTK_SearchTreeImpl : public DTK_SearchTree
+{
+    using device_type = typename ExecSpace::device_type;
+    using Coordinates =
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, device_type,
+                     Kokkos::MemoryUnmanaged>;
+
+    DTK_SearchTreeImpl( MPI_Comm comm, Coordinate const *coordinates,
+                        unsigned space_dim, size_t local_num_points,
+                        size_t point_stride, size_t dim_stride )
+        : _space_dim( space_dim )
+        , _tree( Details::NearestNeighborOperatorImpl<device_type>::
+                     makeDistributedSearchTree(
+                         Teuchos::rcp( new Teuchos::MpiComm<int>( comm ) ),
+                         wrap( coordinates, local_num_points, point_stride,
+                               dim_stride ) ) )
+    {
+    }
+
+    void searchNearest( Coordinate const *points, size_t num_points,
+                        size_t point_stride, size_t dim_stride,
+                        unsigned k ) override
+    {
+        auto query_points =
+            makeQueryPoints( wrap( points, num_points, point_stride,
+                                   dim_stride ) );
+        Kokkos::View<Nearest<Point> *, device_type> queries(
+            Kokkos::ViewAllocateWithoutInitializing( "queries" ), num_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "setup_nearest_queries" ),
+            Kokkos::RangePolicy<ExecSpace>( 0, num_points ),
+            KOKKOS_LAMBDA( int i ) {
+                queries( i ) = nearest( query_points( i ), k );
+            } );
+        Kokkos::fence();
+        _tree.query( queries, _indices, _offset, _ranks );
+    }
+
+    void searchWithin( Coordinate const *points, size_t num_points,
+                       size_t point_stride, size_t dim_stride,
+                       double radius ) override
+    {
+        auto query_points =
+            makeQueryPoints( wrap( points, num_points, point_stride,
+                                   dim_stride ) );
+        Kokkos::View<Within *, device_type> queries(
+            Kokkos::ViewAllocateWithoutInitializing( "queries" ), num_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "setup_within_queries" ),
+            Kokkos::RangePolicy<ExecSpace>( 0, num_points ),
+            KOKKOS_LAMBDA( int i ) {
+                queries( i ) = within( query_points( i ), radius );
+            } );
+        Kokkos::fence();
+        _tree.query( queries, _indices, _offset, _ranks );
+    }
+
+    size_t getNumResults() const override { return _indices.extent( 0 ); }
+
+    void getResults( int *offset, int *indices, int *ranks ) const override
+    {
+        using Results =
+            Kokkos::View<int *, device_type, Kokkos::MemoryUnmanaged>;
+        Kokkos::deep_copy( Results( offset, _offset.extent( 0 ) ), _offset );
+        Kokkos::deep_copy( Results( indices, _indices.extent( 0 ) ),
+                           _indices );
+        Kokkos::deep_copy( Results( ranks, _ranks.extent( 0 ) ), _ranks );
+    }
+
+    Coordinates wrap( Coordinate const *coordinates, size_t num_points,
+                      size_t point_stride, size_t dim_stride ) const
+    {
+        DTK_REQUIRE( coordinates != nullptr || num_points == 0 );
+        Kokkos::LayoutStride layout( num_points, point_stride, _space_dim,
+                                     dim_stride );
+        return Coordinates( coordinates, layout );
+    }
+
+    // The search only deals with three-dimensional geometry so points in
+    // lower dimension are embedded with zeros for the missing coordinates.
+    static Kokkos::View<Point *, device_type>
+    makeQueryPoints( Coordinates coordinates )
+    {
+        int const n_points = coordinates.extent( 0 );
+        int const dim = coordinates.extent( 1 );
+        Kokkos::View<Point *, device_type> points(
+            Kokkos::ViewAllocateWithoutInitializing( "query_points" ),
+            n_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "setup_query_points" ),
+            Kokkos::RangePolicy<ExecSpace>( 0, n_points ),
+            KOKKOS_LAMBDA( int i ) {
+                Point p = {{0., 0., 0.}};
+                for ( int d = 0; d < dim; ++d )
+                    p[d] = coordinates( i, d );
+                points( i ) = p;
+            } );
+        Kokkos::fence();
+        return points;
+    }
+
+    unsigned _space_dim;
+    DistributedSearchTree<device_type> _tree;
+    Kokkos::View<int *, device_type> _indices;
+    Kokkos::View<int *, device_type> _offset;
+    Kokkos::View<int *, device_type> _ranks;
+};
+
+//---------------------------------------------------------------------------//
+// Create a search tree in the given execution space.
+inline DTK_SearchTree *
+createSearchTree( DTK_ExecutionSpace space, MPI_Comm comm,
+                  Coordinate const *coordinates, unsigned space_dim,
+                  size_t local_num_points, size_t point_stride,
+                  size_t dim_stride )
+{
+    DTK_INSIST( space_dim == 2 || space_dim == 3 );
+
+    switch ( space )
+    {
+    case DTK_SERIAL:
+#if defined( KOKKOS_ENABLE_SERIAL )
+        return new DTK_SearchTreeImpl<Serial>( comm, coordinates, space_dim,
+                                               local_num_points, point_stride,
+                                               dim_stride );
+#endif
+        break;
+
+    case DTK_OPENMP:
+#if defined( KOKKOS_ENABLE_OPENMP )
+        return new DTK_SearchTreeImpl<OpenMP>( comm, coordinates, space_dim,
+                                               local_num_points, point_stride,
+                                               dim_stride );
+#endif
+        break;
+
+    case DTK_CUDA:
+#if defined( KOKKOS_ENABLE_CUDA )
+        return new DTK_SearchTreeImpl<Cuda>( comm, coordinates, space_dim,
+                                             local_num_points, point_stride,
+                                             dim_stride );
+#endif
+        break;
+    }
+
+    throw DataTransferKitException(
+        "Execution space of the search tree is not enabled" );
+}
+
+//---------------------------------------------------------------------------//
+
+} // namespace DataTransferKit
+
+#endif // DTK_C_API_SEARCH_HPP
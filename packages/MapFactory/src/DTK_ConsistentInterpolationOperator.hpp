@@ -0,0 +1,129 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief Consistent interpolation of a finite element field as a map
+ * operator.
+ */
+#ifndef DTK_CONSISTENT_INTERPOLATION_OPERATOR_HPP
+#define DTK_CONSISTENT_INTERPOLATION_OPERATOR_HPP
+
+#include <DTK_ConfigDefs.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_FETypes.h>
+#include <DTK_Interpolation.hpp>
+#include <DTK_PointCloudOperator.hpp>
+
+#include <Kokkos_Core.hpp>
+#include <Teuchos_RCP.hpp>
+
+namespace DataTransferKit
+{
+
+/**
+ * Evaluate a finite element field of the source mesh at the target points.
+ * The degrees of freedom of the source field are the rows of the source
+ * values. Target points that are not found in the source mesh are set to
+ * zero.
+ */
+template <typename DeviceType>
+class ConsistentInterpolationOperator : public PointCloudOperator<DeviceType>
+{
+  public:
+    /**
+     * Constructor. This is a collective call.
+     * @param comm
+     * @param cell_topologies (n cells)
+     * @param cells vertices associated to each cell (n cells * n vertices per
+     * cell)
+     * @param nodes_coordinates coordinates of all the nodes in the source
+     * mesh (n vertices, dim)
+     * @param cell_dof_ids degrees of freedom indices associated to each cell
+     * (n cells * n dofs per cell)
+     * @param fe_type type of the finite element (DTK_HGRAD, DTK_HDIV, or
+     * DTK_HCURL)
+     * @param target_points coordinates of the target points (n points, dim)
+     */
+    ConsistentInterpolationOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<DTK_CellTopology *, DeviceType> cell_topologies,
+        Kokkos::View<unsigned int *, DeviceType> cells,
+        Kokkos::View<double **, DeviceType> nodes_coordinates,
+        Kokkos::View<LocalOrdinal *, DeviceType> cell_dof_ids,
+        DTK_FEType fe_type,
+        Kokkos::View<double **, DeviceType> target_points )
+        : _n_target_points( target_points.extent( 0 ) )
+        , _interpolation( new Interpolation<DeviceType>(
+              comm, cell_topologies, cells, nodes_coordinates, target_points,
+              cell_dof_ids, fe_type ) )
+    {
+    }
+
+    // Applying the operator to a subset of the target points is not
+    // supported.
+    using PointCloudOperator<DeviceType>::apply;
+    using PointCloudOperator<DeviceType>::applyComponents;
+
+    void
+    apply( Kokkos::View<double const *, DeviceType> source_values,
+           Kokkos::View<double *, DeviceType> target_values ) const override
+    {
+        applyComponents( Kokkos::View<double const **, DeviceType>(
+                             source_values.data(), source_values.extent( 0 ),
+                             1 ),
+                         Kokkos::View<double **, DeviceType>(
+                             target_values.data(), target_values.extent( 0 ),
+                             1 ) );
+    }
+
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const override
+    {
+        DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+        DTK_REQUIRE( target_values.extent( 0 ) == _n_target_points );
+
+        // Interpolation::apply() does not modify the source values.
+        Kokkos::View<double **, DeviceType> source_dofs(
+            const_cast<double *>( source_values.data() ),
+            source_values.layout() );
+
+        // The values of the points that have been found come first, in
+        // increasing order of the point ids.
+        unsigned int const n_components = target_values.extent( 1 );
+        Kokkos::View<double **, DeviceType> found_values(
+            Kokkos::ViewAllocateWithoutInitializing( "found_values" ),
+            _n_target_points, n_components );
+        auto found_point_ids =
+            _interpolation->apply( source_dofs, found_values );
+
+        using ExecutionSpace = typename DeviceType::execution_space;
+        Kokkos::deep_copy( target_values, 0. );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "scatter_found_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, _n_target_points ),
+            KOKKOS_LAMBDA( int const i ) {
+                int const point_id = found_point_ids( i );
+                if ( point_id >= 0 )
+                    for ( unsigned int k = 0; k < n_components; ++k )
+                        target_values( point_id, k ) = found_values( i, k );
+            } );
+        Kokkos::fence();
+    }
+
+  private:
+    unsigned int _n_target_points;
+    Teuchos::RCP<Interpolation<DeviceType>> _interpolation;
+};
+
+} // end namespace DataTransferKit
+
+#endif
@@ -0,0 +1,273 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief Registry of the point cloud operators that maps can be built with.
+ */
+#ifndef DTK_POINT_CLOUD_OPERATOR_REGISTRY_HPP
+#define DTK_POINT_CLOUD_OPERATOR_REGISTRY_HPP
+
+#include <DTK_CompactlySupportedRadialBasisFunctions.hpp>
+#include <DTK_ConfigDefs.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DistributedSearchTree.hpp>
+#include <DTK_MovingLeastSquaresOperator.hpp>
+#include <DTK_MultivariatePolynomialBasis.hpp>
+#include <DTK_NearestNeighborOperator.hpp>
+#include <DTK_PointCloudOperator.hpp>
+
+#include <Teuchos_ParameterList.hpp>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+template <typename... Types>
+struct TypeList
+{
+};
+
+// Names of the radial basis functions and of the polynomial orders in the
+// options of the maps.
+template <typename T>
+struct OptionName;
+
+#define DTK_OPTION_NAME( TYPE, NAME )                                          \
+    template <>                                                                \
+    struct OptionName<TYPE>                                                    \
+    {                                                                          \
+        static char const *value() { return NAME; }                           \
+    }
+
+DTK_OPTION_NAME( Wendland<0>, "Wendland0" );
+DTK_OPTION_NAME( Wendland<2>, "Wendland2" );
+DTK_OPTION_NAME( Wendland<4>, "Wendland4" );
+DTK_OPTION_NAME( Wendland<6>, "Wendland6" );
+DTK_OPTION_NAME( Wu<2>, "Wu2" );
+DTK_OPTION_NAME( Wu<4>, "Wu4" );
+DTK_OPTION_NAME( Buhmann<2>, "Buhmann2" );
+DTK_OPTION_NAME( Buhmann<3>, "Buhmann3" );
+DTK_OPTION_NAME( Buhmann<4>, "Buhmann4" );
+DTK_OPTION_NAME( Linear, "Linear" );
+DTK_OPTION_NAME( Quadratic, "Quadratic" );
+
+#undef DTK_OPTION_NAME
+
+// The moving least squares operators that are explicitly instantiated.
+using RadialBasisFunctions =
+    TypeList<Wendland<0>, Wendland<2>, Wendland<4>, Wendland<6>, Wu<2>, Wu<4>,
+             Buhmann<2>, Buhmann<3>, Buhmann<4>>;
+using PolynomialOrders = TypeList<Linear, Quadratic>;
+
+} // namespace Details
+
+/**
+ * Factories of the point cloud operators indexed by the options selecting
+ * them.  Every combination of radial basis function and polynomial order of
+ * the moving least squares operator is registered at compile time so that
+ * the options choose among specialized operators and the kernels do not
+ * dispatch at run time.
+ */
+template <typename DeviceType>
+class PointCloudOperatorRegistry
+{
+  public:
+    using Factory = std::unique_ptr<PointCloudOperator<DeviceType>> ( * )(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &,
+        DistributedSearchTree<DeviceType> const &,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>,
+        Teuchos::ParameterList const & );
+
+    /**
+     * Build the operator selected by the options:
+     *  - "Map Type": "Nearest Neighbor" ("NN") or "Moving Least Squares"
+     *    ("MLS").
+     *  - "RBF" (default "Wendland0"): radial basis function of the moving
+     *    least squares, one of "Wendland0", "Wendland2", "Wendland4",
+     *    "Wendland6", "Wu2", "Wu4", "Buhmann2", "Buhmann3", or "Buhmann4".
+     *  - "Order" (default "Linear"): "Linear" ("1") or "Quadratic" ("2").
+     *  - "Number of Neighbors", "Support Radius", "Adaptive Radius", and
+     *    "Maximum Radius Refinements" are the parameters of the moving least
+     *    squares operator.
+     */
+    static std::unique_ptr<PointCloudOperator<DeviceType>>
+    create( boost::property_tree::ptree const &options,
+            Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+            DistributedSearchTree<DeviceType> const &search_tree,
+            Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+                source_points,
+            Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+                target_points )
+    {
+        Teuchos::ParameterList params;
+        auto const factory = getFactory( options, params );
+        return factory( comm, search_tree, source_points, target_points,
+                        params );
+    }
+
+    /**
+     * Throw if the options do not select an operator, without building it.
+     */
+    static void validate( boost::property_tree::ptree const &options )
+    {
+        Teuchos::ParameterList params;
+        getFactory( options, params );
+    }
+
+  private:
+    PointCloudOperatorRegistry()
+    {
+        _factories["Nearest Neighbor"] = &makeNearestNeighborOperator;
+        registerMovingLeastSquaresOperators( Details::RadialBasisFunctions(),
+                                             Details::PolynomialOrders() );
+    }
+
+    static PointCloudOperatorRegistry const &instance()
+    {
+        static PointCloudOperatorRegistry const registry;
+        return registry;
+    }
+
+    // Find the factory selected by the options and translate them into the
+    // parameters of the operator.
+    static Factory getFactory( boost::property_tree::ptree const &options,
+                               Teuchos::ParameterList &params )
+    {
+        auto const &registry = instance();
+
+        auto map_type = options.get<std::string>( "Map Type" );
+        if ( map_type == "NN" )
+            map_type = "Nearest Neighbor";
+        else if ( map_type == "MLS" )
+            map_type = "Moving Least Squares";
+
+        std::string key = map_type;
+        if ( map_type == "Moving Least Squares" )
+        {
+            // NOTE if field "Order" is misspelled (for instance first letter
+            // not capitalized), the default value (linear polynomials) will be
+            // picked up without a warning or an error being raised.
+            auto order = options.get<std::string>( "Order", "Linear" );
+            if ( order == "1" )
+                order = "Linear";
+            else if ( order == "2" )
+                order = "Quadratic";
+            if ( !registry._orders.count( order ) )
+                throw DataTransferKitException(
+                    "Invalid order \"" + order +
+                    "\" for creating a moving least squares map" );
+
+            auto const rbf = options.get<std::string>( "RBF", "Wendland0" );
+            if ( !registry._radial_basis_functions.count( rbf ) )
+                throw DataTransferKitException(
+                    "Invalid radial basis function \"" + rbf +
+                    "\" for creating a moving least squares map" );
+
+            key += '/' + rbf + '/' + order;
+
+            if ( auto n_neighbors =
+                     options.get_optional<int>( "Number of Neighbors" ) )
+                params.set( "Number of Neighbors", *n_neighbors );
+            // Radius-based neighborhoods are used instead of the nearest
+            // neighbors if field "Support Radius" is present.
+            if ( auto radius =
+                     options.get_optional<double>( "Support Radius" ) )
+                params.set( "Support Radius", *radius );
+            if ( auto adaptive =
+                     options.get_optional<bool>( "Adaptive Radius" ) )
+                params.set( "Adaptive Radius", *adaptive );
+            if ( auto max_refinements = options.get_optional<int>(
+                     "Maximum Radius Refinements" ) )
+                params.set( "Maximum Radius Refinements", *max_refinements );
+        }
+
+        auto const factory = registry._factories.find( key );
+        if ( factory == registry._factories.end() )
+            throw DataTransferKitException( "Invalid map type \"" + map_type +
+                                            "\"" );
+        return factory->second;
+    }
+
+    template <typename... RBFs, typename Orders>
+    void registerMovingLeastSquaresOperators( Details::TypeList<RBFs...>,
+                                              Orders orders )
+    {
+        int expand[] = {0, ( registerRadialBasisFunction<RBFs>( orders ),
+                             0 )...};
+        (void)expand;
+    }
+
+    template <typename RBF, typename... Orders>
+    void registerRadialBasisFunction( Details::TypeList<Orders...> )
+    {
+        std::string const rbf = Details::OptionName<RBF>::value();
+        _radial_basis_functions.insert( rbf );
+        std::string const orders[] = {Details::OptionName<Orders>::value()...};
+        Factory const factories[] = {
+            &makeMovingLeastSquaresOperator<RBF, Orders>...};
+        for ( unsigned int i = 0; i < sizeof...( Orders ); ++i )
+        {
+            _orders.insert( orders[i] );
+            _factories["Moving Least Squares/" + rbf + '/' + orders[i]] =
+                factories[i];
+        }
+    }
+
+    static std::unique_ptr<PointCloudOperator<DeviceType>>
+    makeNearestNeighborOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const & )
+    {
+        return std::unique_ptr<NearestNeighborOperator<DeviceType>>(
+            new NearestNeighborOperator<DeviceType>( comm, search_tree,
+                                                     source_points,
+                                                     target_points ) );
+    }
+
+    template <typename RBF, typename Order>
+    static std::unique_ptr<PointCloudOperator<DeviceType>>
+    makeMovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
+    {
+        using Operator =
+            MovingLeastSquaresOperator<DeviceType, RBF,
+                                       MultivariatePolynomialBasis<Order, 3>>;
+        return std::unique_ptr<Operator>( new Operator(
+            comm, search_tree, source_points, target_points, params ) );
+    }
+
+    std::map<std::string, Factory> _factories;
+    std::set<std::string> _radial_basis_functions;
+    std::set<std::string> _orders;
+};
+
+} // end namespace DataTransferKit
+
+#endif
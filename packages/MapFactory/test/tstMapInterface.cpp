@@ -25,7 +25,11 @@
 
 #include <Kokkos_Core.hpp>
 
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <vector>
 
 //---------------------------------------------------------------------------//
 // User implementation
@@ -34,10 +38,12 @@ struct TestUserData
 {
     Kokkos::View<double * [3], Space> coords;
     Kokkos::View<double *, Space> field;
+    int node_list_calls;
 
     TestUserData( const int size )
         : coords( "coords", size )
         , field( "field", size )
+        , node_list_calls( 0 )
     {
     }
 };
@@ -55,6 +61,7 @@ template <class Space>
 void nodeListData( void *user_data, Coordinate *coords )
 {
     TestUserData<Space> *data = static_cast<TestUserData<Space> *>( user_data );
+    ++data->node_list_calls;
     int num_node = data->coords.extent( 0 );
     for ( unsigned n = 0; n < data->coords.extent( 0 ); ++n )
         for ( unsigned d = 0; d < data->coords.extent( 1 ); ++d )
@@ -85,6 +92,54 @@ void pushField( void *user_data, const char *, const double *field_dofs )
         data->field( i ) = field_dofs[i];
 }
 
+// The nodes of the user data are the vertices of a single hexahedron and
+// carry one dof each.
+template <class Space>
+void cellListSize( void *user_data, unsigned *space_dim,
+                   size_t *local_num_nodes, size_t *local_num_cells,
+                   size_t *total_cell_nodes )
+{
+    TestUserData<Space> *data = static_cast<TestUserData<Space> *>( user_data );
+    *space_dim = data->coords.extent( 1 );
+    *local_num_nodes = data->coords.extent( 0 );
+    *local_num_cells = 1;
+    *total_cell_nodes = data->coords.extent( 0 );
+}
+
+template <class Space>
+void cellListData( void *user_data, Coordinate *coords, LocalOrdinal *cells,
+                   DTK_CellTopology *cell_topologies )
+{
+    nodeListData<Space>( user_data, coords );
+    TestUserData<Space> *data = static_cast<TestUserData<Space> *>( user_data );
+    for ( unsigned n = 0; n < data->coords.extent( 0 ); ++n )
+        cells[n] = n;
+    cell_topologies[0] = DTK_HEX_8;
+}
+
+template <class Space>
+void dofMapSize( void *user_data, size_t *local_num_dofs,
+                 size_t *local_num_objects, unsigned *dofs_per_object )
+{
+    TestUserData<Space> *data = static_cast<TestUserData<Space> *>( user_data );
+    *local_num_dofs = data->field.extent( 0 );
+    *local_num_objects = 1;
+    *dofs_per_object = data->field.extent( 0 );
+}
+
+template <class Space>
+void dofMapData( void *user_data, GlobalOrdinal *global_dof_ids,
+                 LocalOrdinal *object_dof_ids, char *discretization_type )
+{
+    TestUserData<Space> *data = static_cast<TestUserData<Space> *>( user_data );
+    for ( unsigned i = 0; i < data->field.extent( 0 ); ++i )
+    {
+        global_dof_ids[i] = i;
+        object_dof_ids[i] = i;
+    }
+    std::strcpy( discretization_type, "HGRAD" );
+}
+
 //---------------------------------------------------------------------------//
 // Test execution space enumeration selector.
 template <class Space>
@@ -141,6 +196,23 @@ void test( bool &success, Teuchos::FancyOStream &out )
     DTK_MapHandle bad_handle = nullptr;
     DTK_applyMap( bad_handle, "bad", "bad" );
     TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_applyMapFields( bad_handle, 0, nullptr, nullptr );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    const char *bad_fields[] = {"bad"};
+    DTK_applyMapGroup( 1, &bad_handle, bad_fields, bad_fields );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_MapRequest bad_request;
+    DTK_applyMapAsync( bad_handle, "bad", "bad", &bad_request );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    TEST_ASSERT( bad_request == nullptr );
+    TEST_ASSERT( DTK_getMapStatistics( bad_handle ) == nullptr );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_setupMapGeometryAsync( bad_handle, &bad_request );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    TEST_ASSERT( bad_request == nullptr );
+    DTK_setupMapOperatorAsync( bad_handle, &bad_request );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    TEST_ASSERT( bad_request == nullptr );
     DTK_destroyMap( bad_handle );
     TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
 
@@ -225,6 +297,13 @@ void test( bool &success, Teuchos::FancyOStream &out )
                                                       // double quoted
               R"({ "Map Type": "MLS", "Order": "Quadratic" })",
               R"({ "Map Type": "MLS", "Order": "2" })",
+              R"({ "Map Type": "MLS", "Support Radius": 2.5 })",
+              R"({ "Map Type": "MLS", "Support Radius": 0.1,
+                   "Adaptive Radius": true })",
+              R"({ "Map Type": "MLS", "RBF": "Wendland6" })",
+              R"({ "Map Type": "MLS", "RBF": "Wu4", "Order": "Quadratic" })",
+              R"({ "Map Type": "MLS", "RBF": "Buhmann3",
+                   "Number of Neighbors": 8 })",
           } )
     {
         auto map_handle =
@@ -258,6 +337,9 @@ void test( bool &success, Teuchos::FancyOStream &out )
             R"({ "Map Type": "Is Not Defined Anywhere" })", // invalid value
             R"({ "Map Type": "MLS", "Order": 3 })", // order 3 not available
             R"({ "Map Type": "MLS", "Order": "Invalid" })",
+            R"({ "Map Type": "MLS", "RBF": "Wendland1" })", // not available
+            R"({ "Map Type": "MLS", "RBF": "wu2" })", // first letter not
+                                                      // capitalized
         } )
     {
         TEST_THROW( DTK_createMap( SpaceSelector<MapSpace>::value(), comm,
@@ -269,6 +351,7 @@ void test( bool &success, Teuchos::FancyOStream &out )
     for ( std::string const options : {
               R"({ "Map Type": "Nearest Neighbor" })",
               R"({ "Map Type": "Moving Least Squares" })",
+              R"({ "Map Type": "MLS", "RBF": "Wu2" })",
           } )
     {
         auto map_handle =
@@ -276,12 +359,424 @@ void test( bool &success, Teuchos::FancyOStream &out )
                            tgt_handle, options.c_str() );
         TEST_EQUALITY( errno, DTK_SUCCESS );
 
+        // The second application reuses the field buffers of the map.
+        for ( int application = 0; application < 2; ++application )
+        {
+            for ( int p = 0; p < num_point; ++p )
+                tgt_data->field( p ) = 0.0;
+
+            DTK_applyMap( map_handle, "dummy", "dummy" );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+
+            double const relative_tolerance = 1e-14;
+            // NOTE adding the same value to both lhs and rhs to resolve
+            // floating point comparison issues with zero using Teuchos
+            // assertion macro
+            double const shift_from_zero = 3.14;
+            for ( int p = 0; p < num_point; ++p )
+            {
+                TEST_FLOATING_EQUALITY( tgt_data->field( p ) + shift_from_zero,
+                                        1.0 * p + inverse_rank * num_point +
+                                            shift_from_zero,
+                                        relative_tolerance );
+            }
+        }
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check map apply with registered field storage
+    DTK_setFieldStorage( src_handle, "registered", src_data->field.data(),
+                         num_point, 1, num_point );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    DTK_setFieldStorage( tgt_handle, "registered", tgt_data->field.data(),
+                         num_point, 1, num_point );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    {
+        auto map_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                         comm, src_handle, tgt_handle,
+                                         R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        for ( int p = 0; p < num_point; ++p )
+            tgt_data->field( p ) = 0.0;
+
+        DTK_applyMap( map_handle, "registered", "registered" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+        for ( int p = 0; p < num_point; ++p )
+        {
+            TEST_FLOATING_EQUALITY( tgt_data->field( p ) + shift_from_zero,
+                                    1.0 * p + inverse_rank * num_point +
+                                        shift_from_zero,
+                                    relative_tolerance );
+        }
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check asynchronous map apply
+    {
+        auto map_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                         comm, src_handle, tgt_handle,
+                                         R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+
+        // Complete the first request by waiting and the second one by
+        // testing.
+        for ( bool const wait : {true, false} )
+        {
+            for ( int p = 0; p < num_point; ++p )
+                tgt_data->field( p ) = 0.0;
+
+            DTK_MapRequest request;
+            DTK_applyMapAsync( map_handle, "dummy", "dummy", &request );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+            TEST_ASSERT( request != nullptr );
+            if ( wait )
+                DTK_waitMap( &request );
+            else
+                while ( !DTK_testMap( &request ) )
+                    TEST_EQUALITY( errno, DTK_SUCCESS );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+            TEST_ASSERT( request == nullptr );
+
+            // A completed request stays complete.
+            TEST_ASSERT( DTK_testMap( &request ) );
+            DTK_waitMap( &request );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+
+            for ( int p = 0; p < num_point; ++p )
+            {
+                TEST_FLOATING_EQUALITY(
+                    tgt_data->field( p ) + shift_from_zero,
+                    1.0 * p + inverse_rank * num_point + shift_from_zero,
+                    relative_tolerance );
+            }
+        }
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check map apply to several fields at once
+    {
+        auto map_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                         comm, src_handle, tgt_handle,
+                                         R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        for ( int p = 0; p < num_point; ++p )
+            tgt_data->field( p ) = 0.0;
+
+        // Both fields read and write the same data, once through the
+        // callbacks and once through the registered storage.
+        const char *source_fields[] = {"dummy", "registered"};
+        const char *target_fields[] = {"dummy", "registered"};
+        DTK_applyMapFields( map_handle, 2, source_fields, target_fields );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+        for ( int p = 0; p < num_point; ++p )
+        {
+            TEST_FLOATING_EQUALITY( tgt_data->field( p ) + shift_from_zero,
+                                    1.0 * p + inverse_rank * num_point +
+                                        shift_from_zero,
+                                    relative_tolerance );
+        }
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check the application of several maps with a single exchange
+    {
+        DTK_MapHandle map_handles[] = {
+            DTK_createMap( SpaceSelector<MapSpace>::value(), comm, src_handle,
+                           tgt_handle, R"({ "Map Type": "NN" })" ),
+            DTK_createMap( SpaceSelector<MapSpace>::value(), comm, src_handle,
+                           tgt_handle, R"({ "Map Type": "MLS" })" )};
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+        // The second application reuses the field buffers of the maps.
+        for ( int application = 0; application < 2; ++application )
+        {
+            for ( int p = 0; p < num_point; ++p )
+                tgt_data->field( p ) = 0.0;
+
+            // Both maps read and write the same data, once through the
+            // callbacks and once through the registered storage.
+            const char *source_fields[] = {"dummy", "registered"};
+            const char *target_fields[] = {"dummy", "registered"};
+            DTK_applyMapGroup( 2, map_handles, source_fields, target_fields );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+
+            for ( int p = 0; p < num_point; ++p )
+            {
+                TEST_FLOATING_EQUALITY(
+                    tgt_data->field( p ) + shift_from_zero,
+                    1.0 * p + inverse_rank * num_point + shift_from_zero,
+                    relative_tolerance );
+            }
+        }
+
+        for ( auto map_handle : map_handles )
+        {
+            DTK_destroyMap( map_handle );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+        }
+    }
+
+    // Check the statistics of a map
+    {
+        auto map_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                         comm, src_handle, tgt_handle,
+                                         R"({ "Map Type": "MLS" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        DTK_applyMap( map_handle, "dummy", "dummy" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        std::string const statistics = DTK_getMapStatistics( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        out << statistics << "\n";
+        TEST_EQUALITY( statistics.find( "{\"times\": {" ), 0 );
+        TEST_INEQUALITY( statistics.find( "\"search\": " ), std::string::npos );
+        TEST_INEQUALITY( statistics.find( "\"coefficients\": " ),
+                         std::string::npos );
+        TEST_INEQUALITY( statistics.find( "\"communication\": " ),
+                         std::string::npos );
+        TEST_INEQUALITY( statistics.find( "\"operator applications\": 1" ),
+                         std::string::npos );
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check that maps between the same applications share their geometry
+    {
+        int const src_node_list_calls = src_data->node_list_calls;
+        auto nn_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                        comm, src_handle, tgt_handle,
+                                        R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        auto mls_handle = DTK_createMap( SpaceSelector<MapSpace>::value(),
+                                         comm, src_handle, tgt_handle,
+                                         R"({ "Map Type": "MLS" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_EQUALITY( src_data->node_list_calls, src_node_list_calls + 1 );
+
+        // The geometry is read again on demand.
+        auto new_handle = DTK_createMap(
+            SpaceSelector<MapSpace>::value(), comm, src_handle, tgt_handle,
+            R"({ "Map Type": "NN", "Reuse Geometry": false })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_EQUALITY( src_data->node_list_calls, src_node_list_calls + 2 );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+        for ( auto map_handle : {nn_handle, mls_handle, new_handle} )
+        {
+            for ( int p = 0; p < num_point; ++p )
+                tgt_data->field( p ) = 0.0;
+
+            DTK_applyMap( map_handle, "dummy", "dummy" );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+
+            for ( int p = 0; p < num_point; ++p )
+            {
+                TEST_FLOATING_EQUALITY(
+                    tgt_data->field( p ) + shift_from_zero,
+                    1.0 * p + inverse_rank * num_point + shift_from_zero,
+                    relative_tolerance );
+            }
+
+            DTK_destroyMap( map_handle );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+        }
+    }
+
+    // Check map setup in separate phases
+    {
+        int const src_node_list_calls = src_data->node_list_calls;
+        int const tgt_node_list_calls = tgt_data->node_list_calls;
+
+        // Invalid options are still rejected at creation.
+        TEST_THROW( DTK_createMapDeferred(
+                        SpaceSelector<MapSpace>::value(), comm, src_handle,
+                        tgt_handle, R"({ "Map Type": "MLS", "Order": 3 })" ),
+                    DataTransferKit::DataTransferKitException );
+
+        auto map_handle = DTK_createMapDeferred(
+            SpaceSelector<MapSpace>::value(), comm, src_handle, tgt_handle,
+            R"({ "Map Type": "MLS", "Reuse Geometry": false })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_EQUALITY( src_data->node_list_calls, src_node_list_calls );
+
+        // The geometry only reads the source.
+        DTK_MapRequest request;
+        DTK_setupMapGeometryAsync( map_handle, &request );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_waitMap( &request );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_ASSERT( request == nullptr );
+        TEST_EQUALITY( src_data->node_list_calls, src_node_list_calls + 1 );
+        TEST_EQUALITY( tgt_data->node_list_calls, tgt_node_list_calls );
+
+        DTK_setupMapOperatorAsync( map_handle, &request );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        while ( !DTK_testMap( &request ) )
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        TEST_EQUALITY( src_data->node_list_calls, src_node_list_calls + 1 );
+        TEST_EQUALITY( tgt_data->node_list_calls, tgt_node_list_calls + 1 );
+
+        // A map that has not been set up is set up when it is applied.
+        auto lazy_handle = DTK_createMapDeferred(
+            SpaceSelector<MapSpace>::value(), comm, src_handle, tgt_handle,
+            R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-14;
+        double const shift_from_zero = 3.14;
+        for ( auto handle : {map_handle, lazy_handle} )
+        {
+            for ( int p = 0; p < num_point; ++p )
+                tgt_data->field( p ) = 0.0;
+
+            DTK_applyMap( handle, "dummy", "dummy" );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+
+            for ( int p = 0; p < num_point; ++p )
+            {
+                TEST_FLOATING_EQUALITY(
+                    tgt_data->field( p ) + shift_from_zero,
+                    1.0 * p + inverse_rank * num_point + shift_from_zero,
+                    relative_tolerance );
+            }
+
+            DTK_destroyMap( handle );
+            TEST_EQUALITY( errno, DTK_SUCCESS );
+        }
+    }
+
+    // Check a map between two groups of processes over an
+    // inter-communicator, the even ranks holding the source and the odd ranks
+    // the target. The target points of an odd rank are the source points of
+    // an even rank when the number of processes is even.
+    if ( teuchos_comm->getSize() % 2 == 0 )
+    {
+        int const color = comm_rank % 2;
+        MPI_Comm local_comm;
+        MPI_Comm_split( comm, color, comm_rank, &local_comm );
+        MPI_Comm inter_comm;
+        MPI_Intercomm_create( local_comm, 0, comm, 1 - color, 0,
+                              &inter_comm );
+
+        auto map_handle = DTK_createMap(
+            SpaceSelector<MapSpace>::value(), inter_comm,
+            ( color == 0 ) ? src_handle : nullptr,
+            ( color == 1 ) ? tgt_handle : nullptr, R"({ "Map Type": "NN" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        // The map does not need the communicators any more.
+        MPI_Comm_free( &inter_comm );
+        MPI_Comm_free( &local_comm );
+
+        for ( int p = 0; p < num_point; ++p )
+            tgt_data->field( p ) = 0.0;
+
         DTK_applyMap( map_handle, "dummy", "dummy" );
         TEST_EQUALITY( errno, DTK_SUCCESS );
 
         double const relative_tolerance = 1e-14;
-        // NOTE adding the same value to both lhs and rhs to resolve floating
-        // point comparison issues with zero using Teuchos assertion macro
+        double const shift_from_zero = 3.14;
+        for ( int p = 0; p < num_point; ++p )
+        {
+            double const expected =
+                ( color == 1 ) ? 1.0 * p + inverse_rank * num_point : 0.0;
+            TEST_FLOATING_EQUALITY( tgt_data->field( p ) + shift_from_zero,
+                                    expected + shift_from_zero,
+                                    relative_tolerance );
+        }
+
+        DTK_destroyMap( map_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+    }
+
+    // Check consistent interpolation from a mesh. Each process owns a
+    // hexahedron that contains its part of the diagonal of the target points.
+    {
+        auto mesh_data = std::make_shared<TestUserData<SourceSpace>>( 8 );
+        double const hex_vertices[8][3] = {{0., 0., 0.}, {1., 0., 0.},
+                                           {1., 1., 0.}, {0., 1., 0.},
+                                           {0., 0., 1.}, {1., 0., 1.},
+                                           {1., 1., 1.}, {0., 1., 1.}};
+        for ( int n = 0; n < 8; ++n )
+        {
+            for ( int d = 0; d < 3; ++d )
+                mesh_data->coords( n, d ) =
+                    ( comm_rank + hex_vertices[n][d] ) * num_point - 0.5;
+            // The field f(x, y, z) = x is interpolated exactly.
+            mesh_data->field( n ) = mesh_data->coords( n, 0 );
+        }
+
+        auto mesh_handle =
+            DTK_createUserApplication( SpaceSelector<SourceSpace>::value() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_CELL_LIST_SIZE_FUNCTION,
+                             ( void ( * )() ) & cellListSize<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_CELL_LIST_DATA_FUNCTION,
+                             ( void ( * )() ) & cellListData<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_DOF_MAP_SIZE_FUNCTION,
+                             ( void ( * )() ) & dofMapSize<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_DOF_MAP_DATA_FUNCTION,
+                             ( void ( * )() ) & dofMapData<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_FIELD_SIZE_FUNCTION,
+                             ( void ( * )() ) & fieldSize<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_setUserFunction( mesh_handle, DTK_PULL_FIELD_DATA_FUNCTION,
+                             ( void ( * )() ) & pullField<SourceSpace>,
+                             mesh_data.get() );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        TEST_THROW(
+            DTK_createMap( SpaceSelector<MapSpace>::value(), comm,
+                           mesh_handle, tgt_handle,
+                           R"({ "Map Type": "Consistent Interpolation",
+                                "Finite Element Type": "Invalid" })" ),
+            DataTransferKit::DataTransferKitException );
+
+        auto map_handle = DTK_createMap(
+            SpaceSelector<MapSpace>::value(), comm, mesh_handle, tgt_handle,
+            R"({ "Map Type": "Consistent Interpolation" })" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        for ( int p = 0; p < num_point; ++p )
+            tgt_data->field( p ) = 0.0;
+
+        DTK_applyMap( map_handle, "dummy", "dummy" );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
+
+        double const relative_tolerance = 1e-10;
         double const shift_from_zero = 3.14;
         for ( int p = 0; p < num_point; ++p )
         {
@@ -293,6 +788,8 @@ void test( bool &success, Teuchos::FancyOStream &out )
 
         DTK_destroyMap( map_handle );
         TEST_EQUALITY( errno, DTK_SUCCESS );
+        DTK_destroyUserApplication( mesh_handle );
+        TEST_EQUALITY( errno, DTK_SUCCESS );
     }
 
     DTK_destroyUserApplication( src_handle );
@@ -303,6 +800,96 @@ void test( bool &success, Teuchos::FancyOStream &out )
     TEST_EQUALITY( errno, DTK_SUCCESS );
 }
 
+//---------------------------------------------------------------------------//
+// Search points owned by the user in an execution space on the host.
+template <class SearchSpace>
+void testSearch( bool &success, Teuchos::FancyOStream &out )
+{
+    DTK_initialize();
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+
+    // Check error handling on a bad tree.
+    DTK_SearchTreeHandle bad_handle = nullptr;
+    size_t num_results = 0;
+    DTK_searchNearest( bad_handle, nullptr, 0, 3, 1, 1, &num_results );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_searchWithin( bad_handle, nullptr, 0, 3, 1, 1., &num_results );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_getSearchResults( bad_handle, nullptr, nullptr, nullptr );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+    DTK_destroySearchTree( bad_handle );
+    TEST_EQUALITY( errno, DTK_INVALID_HANDLE );
+
+    auto teuchos_comm = Teuchos::DefaultComm<int>::getComm();
+    auto comm = Teuchos::getRawMpiComm( *teuchos_comm );
+    int const comm_rank = teuchos_comm->getRank();
+    int const next_rank = ( comm_rank + 1 ) % teuchos_comm->getSize();
+
+    // Each process owns points on a line and queries the points of the next
+    // process. The coordinates of the points are interleaved and the
+    // coordinates of the queries are not.
+    int const num_points = 10;
+    std::vector<double> points( 3 * num_points );
+    std::vector<double> queries( 3 * num_points );
+    for ( int p = 0; p < num_points; ++p )
+    {
+        points[3 * p] = p;
+        points[3 * p + 1] = 0.;
+        points[3 * p + 2] = 10. * comm_rank;
+        queries[p] = p + 0.25;
+        queries[num_points + p] = 0.;
+        queries[2 * num_points + p] = 10. * next_rank;
+    }
+
+    auto tree = DTK_createSearchTree( SpaceSelector<SearchSpace>::value(),
+                                      comm, points.data(), 3, num_points, 3,
+                                      1 );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    TEST_ASSERT( DTK_isValidSearchTree( tree ) );
+
+    std::vector<int> offset( num_points + 1 );
+    DTK_searchNearest( tree, queries.data(), num_points, 1, num_points, 1,
+                       &num_results );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    TEST_EQUALITY( num_results, static_cast<size_t>( num_points ) );
+    std::vector<int> indices( num_results );
+    std::vector<int> ranks( num_results );
+    DTK_getSearchResults( tree, offset.data(), indices.data(), ranks.data() );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    for ( int p = 0; p < num_points; ++p )
+    {
+        TEST_EQUALITY( offset[p], p );
+        TEST_EQUALITY( indices[p], p );
+        TEST_EQUALITY( ranks[p], next_rank );
+    }
+
+    // The points at both ends of the line have one neighbor less.
+    DTK_searchWithin( tree, queries.data(), num_points, 1, num_points, 1.5,
+                      &num_results );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    TEST_EQUALITY( num_results, static_cast<size_t>( 3 * num_points - 2 ) );
+    indices.resize( num_results );
+    ranks.resize( num_results );
+    DTK_getSearchResults( tree, offset.data(), indices.data(), ranks.data() );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    for ( int p = 0; p < num_points; ++p )
+    {
+        int const n_neighbors = ( p == 0 || p == num_points - 1 ) ? 2 : 3;
+        TEST_EQUALITY( offset[p + 1] - offset[p], n_neighbors );
+        for ( int j = offset[p]; j < offset[p + 1]; ++j )
+        {
+            TEST_ASSERT( std::abs( indices[j] - p ) <= 1 );
+            TEST_EQUALITY( ranks[j], next_rank );
+        }
+    }
+
+    DTK_destroySearchTree( tree );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    TEST_ASSERT( !DTK_isValidSearchTree( tree ) );
+    DTK_finalize();
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+}
+
 //---------------------------------------------------------------------------//
 // TESTS
 //---------------------------------------------------------------------------//
@@ -314,6 +901,51 @@ TEUCHOS_UNIT_TEST( MapInterface, Serial )
 }
 #endif
 
+//---------------------------------------------------------------------------//
+#if defined( KOKKOS_ENABLE_SERIAL )
+TEUCHOS_UNIT_TEST( SearchInterface, Serial )
+{
+    testSearch<DataTransferKit::Serial>( success, out );
+}
+#endif
+
+//---------------------------------------------------------------------------//
+#if defined( KOKKOS_ENABLE_OPENMP )
+TEUCHOS_UNIT_TEST( SearchInterface, OpenMP )
+{
+    testSearch<DataTransferKit::OpenMP>( success, out );
+}
+#endif
+
+//---------------------------------------------------------------------------//
+#if defined( KOKKOS_ENABLE_SERIAL )
+TEUCHOS_UNIT_TEST( MapInterface, DeviceMemoryOnHost )
+{
+    DTK_initialize();
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+
+    // Device memory is not accessible from a map executing on the host.
+    auto src_handle = DTK_createUserApplication( DTK_CUDA_SPACE );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    auto tgt_handle = DTK_createUserApplication( DTK_HOST_SPACE );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    auto comm = Teuchos::getRawMpiComm( *Teuchos::DefaultComm<int>::getComm() );
+    TEST_THROW( DTK_createMap( DTK_SERIAL, comm, src_handle, tgt_handle,
+                               R"({ "Map Type": "NN" })" ),
+                DataTransferKit::DataTransferKitException );
+    TEST_THROW( DTK_createMap( DTK_SERIAL, comm, tgt_handle, src_handle,
+                               R"({ "Map Type": "NN" })" ),
+                DataTransferKit::DataTransferKitException );
+
+    DTK_destroyUserApplication( src_handle );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    DTK_destroyUserApplication( tgt_handle );
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+    DTK_finalize();
+    TEST_EQUALITY( errno, DTK_SUCCESS );
+}
+#endif
+
 //---------------------------------------------------------------------------//
 #if defined( KOKKOS_ENABLE_OPENMP )
 TEUCHOS_UNIT_TEST( MapInterface, OpenMP )
@@ -0,0 +1,463 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_CompactlySupportedRadialBasisFunctions.hpp>
+#include <DTK_DetailsMovingLeastSquaresOperatorImpl.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp>
+#include <DTK_MovingLeastSquaresOperator_decl.hpp>
+#include <DTK_MovingLeastSquaresOperator_def.hpp>
+#include <DTK_MultivariatePolynomialBasis.hpp>
+#include <DTK_NearestNeighborOperator_decl.hpp>
+#include <DTK_NearestNeighborOperator_def.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Kokkos_DefaultNode.hpp>
+#include <Teuchos_CommandLineProcessor.hpp>
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_GlobalMPISession.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <point_clouds.hpp>
+
+#include <chrono>
+#include <cmath> // cbrt
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+
+using Wendland0 = DataTransferKit::Wendland<0>;
+using Wendland2 = DataTransferKit::Wendland<2>;
+using Linear3 =
+    DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Linear, 3>;
+using Quadratic3 =
+    DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Quadratic,
+                                                 3>;
+
+// Whether the point clouds are generated in parallel in the memory space of
+// the device rather than on the host.
+bool parallel_point_clouds = false;
+
+// Generate the points of a cloud whose edge length is chosen such that the
+// density of the points remains constant as the problem size is changed.  The
+// clouds of the processes are placed next to each other along the x-axis.
+template <typename DeviceType>
+Kokkos::View<DataTransferKit::Coordinate **, DeviceType>
+makePoints( int n_points, int n_values, PointCloudType point_cloud_type )
+{
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    Kokkos::View<DataTransferKit::Point *, DeviceType> random_points(
+        Kokkos::ViewAllocateWithoutInitializing( "random_points" ), n_points );
+    auto const a = std::cbrt( n_values );
+    if ( parallel_point_clouds )
+        generatePointCloudInParallel( point_cloud_type, a, random_points,
+                                      comm->getRank() );
+    else
+        generatePointCloud( point_cloud_type, a, random_points );
+
+    double const offset = 2. * a * comm->getRank();
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<DataTransferKit::Coordinate **, DeviceType> points(
+        Kokkos::ViewAllocateWithoutInitializing( "points" ), n_points, 3 );
+    Kokkos::parallel_for( "meshfree_driver:make_points",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+                          KOKKOS_LAMBDA( int i ) {
+                              points( i, 0 ) = random_points( i )[0] + offset;
+                              points( i, 1 ) = random_points( i )[1];
+                              points( i, 2 ) = random_points( i )[2];
+                          } );
+    Kokkos::fence();
+    return points;
+}
+
+template <typename DeviceType>
+Kokkos::View<double *, DeviceType> makeValues( int n_points )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<double *, DeviceType> values(
+        Kokkos::ViewAllocateWithoutInitializing( "values" ), n_points );
+    Kokkos::parallel_for( "meshfree_driver:make_values",
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+                          KOKKOS_LAMBDA( int i ) { values( i ) = i % 7; } );
+    Kokkos::fence();
+    return values;
+}
+
+// Report the time spent in each phase of the operations, averaged over the
+// iterations, as counters of the benchmark.
+void setCounters( benchmark::State &state,
+                  std::map<std::string, double> const &times )
+{
+    for ( auto const &phase : times )
+        state.counters[phase.first] = phase.second / state.iterations();
+}
+
+template <class DeviceType>
+void BM_nearest_neighbor_setup( benchmark::State &state )
+{
+    int const n_values = state.range( 0 );
+    int const n_queries = state.range( 1 );
+    PointCloudType const source_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 2 ) );
+    PointCloudType const target_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 3 ) );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    auto const source_points = makePoints<DeviceType>(
+        n_values, n_values, source_point_cloud_type );
+    auto const target_points = makePoints<DeviceType>(
+        n_queries, n_values, target_point_cloud_type );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+            comm, source_points, target_points );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+template <class DeviceType>
+void BM_nearest_neighbor_apply( benchmark::State &state )
+{
+    int const n_values = state.range( 0 );
+    int const n_queries = state.range( 1 );
+    PointCloudType const source_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 2 ) );
+    PointCloudType const target_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 3 ) );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    auto const source_points = makePoints<DeviceType>(
+        n_values, n_values, source_point_cloud_type );
+    auto const target_points = makePoints<DeviceType>(
+        n_queries, n_values, target_point_cloud_type );
+    DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+        comm, source_points, target_points );
+    auto const source_values = makeValues<DeviceType>( n_values );
+    Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                      n_queries );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        nnop.apply( source_values, target_values );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+template <class DeviceType, class RBF, class PolynomialBasis>
+void BM_moving_least_squares_setup( benchmark::State &state )
+{
+    int const n_values = state.range( 0 );
+    int const n_queries = state.range( 1 );
+    PointCloudType const source_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 2 ) );
+    PointCloudType const target_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 3 ) );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    auto const source_points = makePoints<DeviceType>(
+        n_values, n_values, source_point_cloud_type );
+    auto const target_points = makePoints<DeviceType>(
+        n_queries, n_values, target_point_cloud_type );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        DataTransferKit::MovingLeastSquaresOperator<DeviceType, RBF,
+                                                    PolynomialBasis>
+            mlsop( comm, source_points, target_points );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+template <class DeviceType, class RBF, class PolynomialBasis>
+void BM_moving_least_squares_apply( benchmark::State &state )
+{
+    int const n_values = state.range( 0 );
+    int const n_queries = state.range( 1 );
+    PointCloudType const source_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 2 ) );
+    PointCloudType const target_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 3 ) );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    auto const source_points = makePoints<DeviceType>(
+        n_values, n_values, source_point_cloud_type );
+    auto const target_points = makePoints<DeviceType>(
+        n_queries, n_values, target_point_cloud_type );
+    DataTransferKit::MovingLeastSquaresOperator<DeviceType, RBF,
+                                                PolynomialBasis>
+        mlsop( comm, source_points, target_points );
+    auto const source_values = makeValues<DeviceType>( n_values );
+    Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                      n_queries );
+
+    DataTransferKit::Statistics stats;
+    for ( auto _ : state )
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        auto const start = std::chrono::high_resolution_clock::now();
+        mlsop.apply( source_values, target_values );
+        auto const end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end - start;
+        state.SetIterationTime( elapsed_seconds.count() );
+    }
+    setCounters( state, stats.getTimes() );
+}
+
+// The operator computes the coefficients in a single fused kernel.  Run the
+// phases one by one with the unfused building blocks instead so that each of
+// them can be timed.
+template <class DeviceType, class RBF, class PolynomialBasis>
+void BM_moving_least_squares_phases( benchmark::State &state )
+{
+    int const n_values = state.range( 0 );
+    int const n_queries = state.range( 1 );
+    PointCloudType const source_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 2 ) );
+    PointCloudType const target_point_cloud_type =
+        static_cast<PointCloudType>( state.range( 3 ) );
+
+    auto const comm = Teuchos::DefaultComm<int>::getComm();
+    auto const source_points = makePoints<DeviceType>(
+        n_values, n_values, source_point_cloud_type );
+    auto const target_points = makePoints<DeviceType>(
+        n_queries, n_values, target_point_cloud_type );
+    int constexpr size_polynomial_basis = PolynomialBasis::size();
+
+    using NNImpl = DataTransferKit::Details::NearestNeighborOperatorImpl<
+        DeviceType>;
+    using MLSImpl = DataTransferKit::Details::MovingLeastSquaresOperatorImpl<
+        DeviceType>;
+    auto const search_tree =
+        NNImpl::makeDistributedSearchTree( comm, source_points );
+
+    std::map<std::string, double> times;
+    for ( auto _ : state )
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto lap = [&times, &start]( std::string const &phase ) -> double {
+            Kokkos::fence();
+            auto const now = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed_seconds = now - start;
+            times[phase] += elapsed_seconds.count();
+            start = now;
+            return elapsed_seconds.count();
+        };
+        double elapsed = 0.;
+
+        Kokkos::View<int *, DeviceType> indices( "indices" );
+        Kokkos::View<int *, DeviceType> offset( "offset" );
+        Kokkos::View<int *, DeviceType> ranks( "ranks" );
+        auto const queries = MLSImpl::template makeKNNQueries<3>(
+            target_points, size_polynomial_basis );
+        search_tree.query( queries, indices, offset, ranks );
+        elapsed += lap( "search" );
+
+        Kokkos::View<DataTransferKit::Coordinate const **, DeviceType>
+            neighbor_points = NNImpl::fetch(
+                NNImpl::makeFetchPlan( comm, ranks, indices ), source_points );
+        elapsed += lap( "fetch" );
+
+        auto const transformed_points = MLSImpl::transformSourceCoordinates(
+            neighbor_points, offset, target_points );
+        elapsed += lap( "transform" );
+
+        auto const p = MLSImpl::computeVandermonde( transformed_points,
+                                                    PolynomialBasis() );
+        elapsed += lap( "vandermonde" );
+
+        auto const radius =
+            MLSImpl::computeRadius( transformed_points, offset );
+        auto const phi =
+            MLSImpl::computeWeights( transformed_points, radius, RBF() );
+        elapsed += lap( "weights" );
+
+        auto const a = MLSImpl::computeMoments( offset, p, phi );
+        elapsed += lap( "moments" );
+
+        auto const inv_a = std::get<0>(
+            MLSImpl::invertMoments( a, size_polynomial_basis, 1 ) );
+        elapsed += lap( "svd" );
+
+        auto const coeffs = MLSImpl::computePolynomialCoefficients(
+            offset, inv_a, p, phi, size_polynomial_basis );
+        elapsed += lap( "coefficients" );
+
+        state.SetIterationTime( elapsed );
+    }
+    setCounters( state, times );
+}
+
+class KokkosScopeGuard
+{
+  public:
+    KokkosScopeGuard( int &argc, char *argv[] )
+    {
+        Kokkos::initialize( argc, argv );
+    }
+    ~KokkosScopeGuard() { Kokkos::finalize(); }
+};
+
+#define REGISTER_MOVING_LEAST_SQUARES_BENCHMARK( DeviceType, RBF, Basis )      \
+    BENCHMARK_TEMPLATE( BM_moving_least_squares_setup, DeviceType, RBF,        \
+                        Basis )                                                \
+        ->Args( {n_values, n_queries, source_point_cloud_type,                 \
+                 target_point_cloud_type} )                                    \
+        ->Args( {10 * n_values, 10 * n_queries, source_point_cloud_type,       \
+                 target_point_cloud_type} )                                    \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_moving_least_squares_apply, DeviceType, RBF,        \
+                        Basis )                                                \
+        ->Args( {n_values, n_queries, source_point_cloud_type,                 \
+                 target_point_cloud_type} )                                    \
+        ->Args( {10 * n_values, 10 * n_queries, source_point_cloud_type,       \
+                 target_point_cloud_type} )                                    \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_moving_least_squares_phases, DeviceType, RBF,       \
+                        Basis )                                                \
+        ->Args( {n_values, n_queries, source_point_cloud_type,                 \
+                 target_point_cloud_type} )                                    \
+        ->Args( {10 * n_values, 10 * n_queries, source_point_cloud_type,       \
+                 target_point_cloud_type} )                                    \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );
+
+#define REGISTER_BENCHMARK( DeviceType )                                       \
+    BENCHMARK_TEMPLATE( BM_nearest_neighbor_setup, DeviceType )                \
+        ->Args( {n_values, n_queries, source_point_cloud_type,                 \
+                 target_point_cloud_type} )                                    \
+        ->Args( {10 * n_values, 10 * n_queries, source_point_cloud_type,       \
+                 target_point_cloud_type} )                                    \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    BENCHMARK_TEMPLATE( BM_nearest_neighbor_apply, DeviceType )                \
+        ->Args( {n_values, n_queries, source_point_cloud_type,                 \
+                 target_point_cloud_type} )                                    \
+        ->Args( {10 * n_values, 10 * n_queries, source_point_cloud_type,       \
+                 target_point_cloud_type} )                                    \
+        ->UseManualTime()                                                      \
+        ->Unit( benchmark::kMicrosecond );                                     \
+    REGISTER_MOVING_LEAST_SQUARES_BENCHMARK( DeviceType, Wendland0, Linear3 )  \
+    REGISTER_MOVING_LEAST_SQUARES_BENCHMARK( DeviceType, Wendland0,            \
+                                             Quadratic3 )                      \
+    REGISTER_MOVING_LEAST_SQUARES_BENCHMARK( DeviceType, Wendland2, Linear3 )  \
+    REGISTER_MOVING_LEAST_SQUARES_BENCHMARK( DeviceType, Wendland2, Quadratic3 )
+
+int main( int argc, char *argv[] )
+{
+    Teuchos::GlobalMPISession mpi_session( &argc, &argv );
+    KokkosScopeGuard guard( argc, argv );
+
+    bool const throw_exceptions = false;
+    bool const recognise_all_options = false;
+    Teuchos::CommandLineProcessor clp( throw_exceptions,
+                                       recognise_all_options );
+    int n_values = 10000;
+    int n_queries = 10000;
+    std::string source_pt_cloud = "filled_box";
+    std::string target_pt_cloud = "filled_box";
+    clp.setOption( "values", &n_values,
+                   "number of source points per MPI rank for the small "
+                   "problem (the large one is ten times bigger)" );
+    clp.setOption( "queries", &n_queries,
+                   "number of target points per MPI rank for the small "
+                   "problem (the large one is ten times bigger)" );
+    clp.setOption( "source-point-cloud-type", &source_pt_cloud,
+                   "shape of the source point cloud" );
+    clp.setOption( "target-point-cloud-type", &target_pt_cloud,
+                   "shape of the target point cloud" );
+    clp.setOption( "parallel-point-clouds", "serial-point-clouds",
+                   &parallel_point_clouds,
+                   "generate the point clouds in parallel on the device, "
+                   "with a different seed on each MPI rank" );
+
+    // Google benchmark only supports integer arguments (see
+    // https://github.com/google/benchmark/issues/387), so we map the string to
+    // an enum.
+    std::map<std::string, PointCloudType> to_point_cloud_enum;
+    to_point_cloud_enum["filled_box"] = PointCloudType::filled_box;
+    to_point_cloud_enum["hollow_box"] = PointCloudType::hollow_box;
+    to_point_cloud_enum["filled_sphere"] = PointCloudType::filled_sphere;
+    to_point_cloud_enum["hollow_sphere"] = PointCloudType::hollow_sphere;
+
+    switch ( clp.parse( argc, argv, NULL ) )
+    {
+    case Teuchos::CommandLineProcessor::PARSE_ERROR:
+        return EXIT_FAILURE;
+    case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+    case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+        clp.printHelpMessage( "benchmark", std::cout );
+    case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+        break;
+    }
+    int source_point_cloud_type = to_point_cloud_enum.at( source_pt_cloud );
+    int target_point_cloud_type = to_point_cloud_enum.at( target_pt_cloud );
+
+    // benchmark::Initialize() calls exit(0) when `--help` so register
+    // Kokkos::finalize() to be called on normal program termination.
+    std::atexit( Kokkos::finalize );
+    // The results, including the time of each phase, are written as JSON
+    // with --benchmark_out=<file> --benchmark_out_format=json.
+    benchmark::Initialize( &argc, argv );
+
+    // Throw if an option is not recognised
+    clp.throwExceptions( true );
+    clp.recogniseAllOptions( true );
+    switch ( clp.parse( argc, argv, NULL ) )
+    {
+    case Teuchos::CommandLineProcessor::PARSE_UNRECOGNIZED_OPTION:
+    case Teuchos::CommandLineProcessor::PARSE_ERROR:
+        return EXIT_FAILURE;
+    case Teuchos::CommandLineProcessor::PARSE_HELP_PRINTED:
+    case Teuchos::CommandLineProcessor::PARSE_SUCCESSFUL:
+        break;
+    }
+
+#ifdef KOKKOS_ENABLE_SERIAL
+    using Serial = Kokkos::Compat::KokkosSerialWrapperNode::device_type;
+    REGISTER_BENCHMARK( Serial );
+#endif
+
+#ifdef KOKKOS_ENABLE_OPENMP
+    using OpenMP = Kokkos::Compat::KokkosOpenMPWrapperNode::device_type;
+    REGISTER_BENCHMARK( OpenMP );
+#endif
+
+#ifdef KOKKOS_ENABLE_CUDA
+    using Cuda = Kokkos::Compat::KokkosCudaWrapperNode::device_type;
+    REGISTER_BENCHMARK( Cuda );
+#endif
+
+    benchmark::RunSpecifiedBenchmarks();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_COMPOSED_OPERATOR_DECL_HPP
+#define DTK_COMPOSED_OPERATOR_DECL_HPP
+
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // FetchPlan
+#include <DTK_PointCloudOperator.hpp>
+
+#include <Kokkos_View.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+
+namespace DataTransferKit
+{
+
+/**
+ * Product of two operators, e.g. a nearest neighbor map from particles to an
+ * intermediate grid followed by a moving least squares map from the grid to
+ * a mesh.  The rows of the product are computed once from the local matrices
+ * of the two operators (see PointCloudOperator::getLocalMatrix()), so
+ * applying it takes a single exchange of the source values and no
+ * intermediate field.  The source values that a row combines are fetched
+ * once per coefficient of the row, and the coefficients that multiply the
+ * same source value are not merged.
+ */
+template <typename DeviceType>
+class ComposedOperator : public PointCloudOperator<DeviceType>
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+  public:
+    /**
+     * Build the operator that applies first and then second, i.e. the target
+     * points of first are the source points of second, distributed the same
+     * way.  The operators can be freed afterwards.
+     *
+     * NOTE: This is a collective call.
+     */
+    ComposedOperator( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                      PointCloudOperator<DeviceType> const &first,
+                      PointCloudOperator<DeviceType> const &second );
+
+    void
+    apply( Kokkos::View<double const *, DeviceType> source_values,
+           Kokkos::View<double *, DeviceType> target_values ) const override;
+
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const override;
+
+    using PointCloudOperator<DeviceType>::apply;
+    using PointCloudOperator<DeviceType>::applyComponents;
+
+    typename PointCloudOperator<DeviceType>::FetchPlan const *
+    getFetchPlan() const override
+    {
+        return &_fetch_plan;
+    }
+
+    void
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values )
+        const override;
+
+    // The product itself, so that it can be composed in turn.
+    typename PointCloudOperator<DeviceType>::LocalMatrix
+    getLocalMatrix() const override;
+
+    using PointCloudOperator<DeviceType>::applyTranspose;
+
+    void
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values,
+                    TransposeMerge merge ) const override;
+
+  private:
+    Teuchos::RCP<Teuchos::Comm<int> const> _comm;
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _fetch_plan;
+    // Sends the contributions of the rows back to the source points in
+    // applyTranspose().
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _transpose_plan;
+    // Target point of each row, empty if the rows are in the order of the
+    // target points, see PointCloudOperator::LocalMatrix.
+    Kokkos::View<size_t const *, DeviceType> _rows;
+    Kokkos::View<int *, DeviceType> _offset;
+    Kokkos::View<double *, DeviceType> _coeffs;
+};
+
+} // namespace DataTransferKit
+
+#endif
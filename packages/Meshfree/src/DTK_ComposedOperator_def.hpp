@@ -0,0 +1,226 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_COMPOSED_OPERATOR_DEF_HPP
+#define DTK_COMPOSED_OPERATOR_DEF_HPP
+
+#include <DTK_DetailsMovingLeastSquaresOperatorImpl.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp>
+#include <DTK_DetailsUtils.hpp>
+
+namespace DataTransferKit
+{
+
+template <typename DeviceType>
+ComposedOperator<DeviceType>::ComposedOperator(
+    Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+    PointCloudOperator<DeviceType> const &first,
+    PointCloudOperator<DeviceType> const &second )
+    : _comm( comm )
+{
+    using NNImpl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    auto const a = first.getLocalMatrix();
+    auto const b = second.getLocalMatrix();
+    DTK_REQUIRE( a.plan != nullptr && b.plan != nullptr );
+    int const comm_rank = comm->getRank();
+
+    // Label the source values read by the first operator with their rank and
+    // local index and bring the labels to its coefficients.  Only the values
+    // up to the largest index read need a label.
+    auto const a_export_indices = a.plan->export_indices;
+    int const n_a_exports = a_export_indices.extent( 0 );
+    int n_sources = 0;
+    if ( n_a_exports > 0 )
+    {
+        Kokkos::Experimental::Max<int> reducer( n_sources );
+        Kokkos::parallel_reduce(
+            DTK_MARK_REGION( "count_source_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_a_exports ),
+            KOKKOS_LAMBDA( int i, int &update ) {
+                if ( a_export_indices( i ) >= update )
+                    update = a_export_indices( i ) + 1;
+            },
+            reducer );
+    }
+    Kokkos::View<int **, DeviceType> source_labels(
+        Kokkos::ViewAllocateWithoutInitializing( "source_labels" ), n_sources,
+        2 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "label_source_values" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_sources ),
+        KOKKOS_LAMBDA( int i ) {
+            source_labels( i, 0 ) = comm_rank;
+            source_labels( i, 1 ) = i;
+        } );
+    Kokkos::fence();
+    auto const a_columns = NNImpl::fetch( *a.plan, source_labels );
+
+    // The intermediate points are the target points of the first operator
+    // and the source points of the second one.  Describe the row of each of
+    // them, i.e. where its coefficients are and how many there are, and
+    // bring the descriptions to the coefficients of the second operator.
+    auto const a_rows = a.rows;
+    auto const a_offset = a.offset;
+    int const n_a_rows = a_offset.extent( 0 ) - 1;
+    Kokkos::View<int **, DeviceType> row_labels(
+        Kokkos::ViewAllocateWithoutInitializing( "row_labels" ), n_a_rows, 3 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "label_intermediate_points" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_a_rows ),
+        KOKKOS_LAMBDA( int i ) {
+            int const m = a_rows.extent( 0 ) > 0 ? a_rows( i ) : i;
+            row_labels( m, 0 ) = comm_rank;
+            row_labels( m, 1 ) = a_offset( i );
+            row_labels( m, 2 ) = a_offset( i + 1 ) - a_offset( i );
+        } );
+    Kokkos::fence();
+    auto const b_columns = NNImpl::fetch( *b.plan, row_labels );
+
+    // Expand each coefficient of the second operator into the row of the
+    // first operator that it multiplies.
+    auto const b_offset = b.offset;
+    auto const b_coeffs = b.coeffs;
+    int const n_rows = b_offset.extent( 0 ) - 1;
+    _offset = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "offset" ), n_rows + 1 );
+    auto const offset = _offset;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_entries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int i ) {
+            int n_entries = 0;
+            for ( int j = b_offset( i ); j < b_offset( i + 1 ); ++j )
+                n_entries += b_columns( j, 2 );
+            offset( i ) = n_entries;
+        } );
+    Kokkos::fence();
+    int const n_entries = exclusivePrefixSum( offset );
+
+    Kokkos::View<int *, DeviceType> ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "ranks" ), n_entries );
+    Kokkos::View<int *, DeviceType> indices(
+        Kokkos::ViewAllocateWithoutInitializing( "indices" ), n_entries );
+    Kokkos::View<double *, DeviceType> coeffs(
+        Kokkos::ViewAllocateWithoutInitializing( "coeffs" ), n_entries );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "expand_entries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int i ) {
+            int e = offset( i );
+            for ( int j = b_offset( i ); j < b_offset( i + 1 ); ++j )
+                for ( int k = 0; k < b_columns( j, 2 ); ++k )
+                {
+                    ranks( e ) = b_columns( j, 0 );
+                    indices( e ) = b_columns( j, 1 ) + k;
+                    coeffs( e ) = b_coeffs( j );
+                    ++e;
+                }
+        } );
+    Kokkos::fence();
+
+    // Fetch the coefficients of the first operator with the labels of the
+    // source values they multiply, and form the products.
+    auto const entries_plan = NNImpl::makeFetchPlan( comm, ranks, indices );
+    auto const a_coeffs = NNImpl::fetch( entries_plan, a.coeffs );
+    auto const labels = NNImpl::fetch( entries_plan, a_columns );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "multiply_entries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_entries ),
+        KOKKOS_LAMBDA( int e ) {
+            coeffs( e ) *= a_coeffs( e );
+            ranks( e ) = labels( e, 0 );
+            indices( e ) = labels( e, 1 );
+        } );
+    Kokkos::fence();
+
+    _coeffs = coeffs;
+    _rows = b.rows;
+    _fetch_plan = NNImpl::makeFetchPlan( comm, ranks, indices );
+    _transpose_plan = NNImpl::makeTransposePlan( comm, _fetch_plan );
+}
+
+template <typename DeviceType>
+void ComposedOperator<DeviceType>::apply(
+    Kokkos::View<double const *, DeviceType> source_values,
+    Kokkos::View<double *, DeviceType> target_values ) const
+{
+    applyComponents( Kokkos::View<double const **, DeviceType>(
+                         source_values.data(), source_values.extent( 0 ), 1 ),
+                     Kokkos::View<double **, DeviceType>(
+                         target_values.data(), target_values.extent( 0 ), 1 ) );
+}
+
+template <typename DeviceType>
+void ComposedOperator<DeviceType>::applyComponents(
+    Kokkos::View<double const **, DeviceType> source_values,
+    Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the source and target are properly sized
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    applyFetched( Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+                      _fetch_plan, source_values ),
+                  target_values );
+}
+
+template <typename DeviceType>
+void ComposedOperator<DeviceType>::applyFetched(
+    Kokkos::View<double const **, DeviceType> fetched_values,
+    Kokkos::View<double **, DeviceType> target_values ) const
+{
+    DTK_REQUIRE( fetched_values.extent( 0 ) == _coeffs.extent( 0 ) );
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( fetched_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    auto const values =
+        Impl::computeTargetValues( _offset, _coeffs, fetched_values );
+    Impl::copyToUserOrder( _rows, values, target_values );
+}
+
+template <typename DeviceType>
+typename PointCloudOperator<DeviceType>::LocalMatrix
+ComposedOperator<DeviceType>::getLocalMatrix() const
+{
+    typename PointCloudOperator<DeviceType>::LocalMatrix matrix;
+    matrix.plan = &_fetch_plan;
+    matrix.rows = _rows;
+    matrix.offset = _offset;
+    matrix.coeffs = _coeffs;
+    return matrix;
+}
+
+template <typename DeviceType>
+void ComposedOperator<DeviceType>::applyTranspose(
+    Kokkos::View<double const **, DeviceType> target_values,
+    Kokkos::View<double **, DeviceType> source_values,
+    TransposeMerge merge ) const
+{
+    // Precondition: check that the source and target are properly sized
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    auto const row_values = Impl::copyFromUserOrder( _rows, target_values );
+    auto const contributions =
+        Impl::computeTransposeValues( _offset, _coeffs, row_values );
+    this->mergeTransposed( _transpose_plan, contributions, source_values,
+                           merge );
+}
+
+} // namespace DataTransferKit
+
+// Explicit instantiation macro
+#define DTK_COMPOSED_OPERATOR_INSTANT( NODE )                                  \
+    template class ComposedOperator<typename NODE::device_type>;
+
+#endif
@@ -0,0 +1,155 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_CHOLESKY_IMPL_HPP
+#define DTK_DETAILS_CHOLESKY_IMPL_HPP
+
+#include <DTK_KokkosHelpers.hpp>
+
+#include <Kokkos_Core.hpp>
+
+#include <cmath>
+#include <type_traits>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+// Batched Cholesky factorization of symmetric positive definite matrices.
+// Like SVDFunctor, the matrices are given in a flat 1D array and each of them
+// is handled by a team of threads.  Unlike SVDFunctor, they may be of
+// different sizes: matrix m is of size n x n with n = offset(m+1) - offset(m)
+// and is stored row by row starting at matrix_offset(m).  The matrices may be
+// too large for the team scratch memory, so they are factorized in place in
+// global memory.  On exit, the lower triangle holds L such that A = L L^T and
+// the upper triangle is left untouched.
+template <typename DeviceType>
+struct CholeskyFunctor
+{
+  public:
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using matrices_type = Kokkos::View<double *, DeviceType>;
+    using team_member =
+        typename Kokkos::TeamPolicy<ExecutionSpace>::member_type;
+
+  public:
+    CholeskyFunctor( Kokkos::View<int const *, DeviceType> offset,
+                     Kokkos::View<int const *, DeviceType> matrix_offset,
+                     matrices_type As )
+        : _offset( offset )
+        , _matrix_offset( matrix_offset )
+        , _As( As )
+    {
+    }
+
+    // Number of threads per team.  The rows below the diagonal are updated
+    // in parallel so there is no point in having more threads than rows.
+    static int teamSize( int n )
+    {
+#if defined( KOKKOS_ENABLE_CUDA )
+        if ( std::is_same<ExecutionSpace, Kokkos::Cuda>::value )
+            return KokkosHelpers::max( 1, KokkosHelpers::min( n, 32 ) );
+#endif
+        (void)n;
+        return 1;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( team_member const &thread, size_t &num_failed ) const
+    {
+        int const matrix_id = thread.league_rank();
+        int const n = _offset( matrix_id + 1 ) - _offset( matrix_id );
+        auto A = Kokkos::subview(
+            _As, Kokkos::make_pair(
+                     static_cast<size_t>( _matrix_offset( matrix_id ) ),
+                     static_cast<size_t>( _matrix_offset( matrix_id ) +
+                                          n * n ) ) );
+
+        bool const failed = factorize( thread, A, n );
+
+        // Only one thread of the team reports the matrix.
+        if ( thread.team_rank() == 0 && failed )
+            num_failed += 1;
+    }
+
+    // Factorize the n x n matrix stored row by row in A, one column at a
+    // time.  Returns true if the matrix is not numerically positive definite.
+    // In that case, the factorization goes on with a unit pivot so that the
+    // result stays finite but it must not be used.
+    template <typename Matrix>
+    KOKKOS_INLINE_FUNCTION bool factorize( team_member const &thread, Matrix A,
+                                           int n ) const
+    {
+        bool failed = false;
+        for ( int j = 0; j < n; ++j )
+        {
+            // Every thread computes the diagonal entry so that they all agree
+            // on the pivot.  Make sure that they are all done reading it
+            // before it is overwritten.
+            double diagonal = A( j * n + j );
+            for ( int k = 0; k < j; ++k )
+                diagonal -= A( j * n + k ) * A( j * n + k );
+            if ( !( diagonal > 0. ) )
+            {
+                failed = true;
+                diagonal = 1.;
+            }
+            double const l_jj = std::sqrt( diagonal );
+            thread.team_barrier();
+            if ( thread.team_rank() == 0 )
+                A( j * n + j ) = l_jj;
+
+            Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, j + 1, n ),
+                                  [&]( int i ) {
+                                      double value = A( i * n + j );
+                                      for ( int k = 0; k < j; ++k )
+                                          value -= A( i * n + k ) *
+                                                   A( j * n + k );
+                                      A( i * n + j ) = value / l_jj;
+                                  } );
+            thread.team_barrier();
+        }
+        return failed;
+    }
+
+    // Solve A x = b in place with the factor L returned by factorize(), i.e.
+    // L y = b followed by L^T x = y.  This is done by a single thread.
+    template <typename Matrix, typename Vector>
+    KOKKOS_INLINE_FUNCTION static void solve( Matrix const &L, int n,
+                                              Vector &b )
+    {
+        for ( int i = 0; i < n; ++i )
+        {
+            double value = b( i );
+            for ( int k = 0; k < i; ++k )
+                value -= L( i * n + k ) * b( k );
+            b( i ) = value / L( i * n + i );
+        }
+        for ( int i = n - 1; i >= 0; --i )
+        {
+            double value = b( i );
+            for ( int k = i + 1; k < n; ++k )
+                value -= L( k * n + i ) * b( k );
+            b( i ) = value / L( i * n + i );
+        }
+    }
+
+  private:
+    Kokkos::View<int const *, DeviceType> _offset;
+    Kokkos::View<int const *, DeviceType> _matrix_offset;
+    matrices_type _As;
+};
+
+} // end namespace Details
+} // end namespace DataTransferKit
+
+#endif
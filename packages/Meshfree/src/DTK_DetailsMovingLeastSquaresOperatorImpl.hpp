@@ -14,12 +14,21 @@
 
 #include <DTK_Box.hpp>
 #include <DTK_CompactlySupportedRadialBasisFunctions.hpp>
+#include <DTK_DetailsBatchedQueries.hpp> // sortQueriesAlongCurve
 #include <DTK_DetailsSVDImpl.hpp>
-#include <DTK_DetailsUtils.hpp> // lastElement
+#include <DTK_DetailsPointCloudHelpers.hpp>
+#include <DTK_DetailsUtils.hpp> // exclusivePrefixSum, lastElement, minMax
+#include <DTK_DistributedSearchTree.hpp>
 #include <DTK_Point.hpp>
 #include <DTK_Predicates.hpp>
+#include <DTK_Statistics.hpp>
+#include <DTK_Tuning.hpp>
 
 #include <Kokkos_ArithTraits.hpp>
+#include <Teuchos_CommHelpers.hpp>
+
+#include <string>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -30,10 +39,12 @@ struct MovingLeastSquaresOperatorImpl
 {
     using ExecutionSpace = typename DeviceType::execution_space;
 
+    template <int DIM>
     static Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType>
-    makeKNNQueries( typename Kokkos::View<Coordinate **, DeviceType>::const_type
-                        target_points,
-                    unsigned int n_neighbors )
+    makeKNNQueries(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        unsigned int n_neighbors )
     {
         auto const n_points = target_points.extent( 0 );
         Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType> queries(
@@ -42,23 +53,572 @@ struct MovingLeastSquaresOperatorImpl
             DTK_MARK_REGION( "setup_queries" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
             KOKKOS_LAMBDA( int i ) {
-                queries( i ) = nearest(
-                    Point{{target_points( i, 0 ), target_points( i, 1 ),
-                           target_points( i, 2 )}},
-                    n_neighbors );
+                queries( i ) =
+                    nearest( makePoint<DIM>( target_points, i ), n_neighbors );
+            } );
+        Kokkos::fence();
+        return queries;
+    }
+
+    template <int DIM>
+    static Kokkos::View<Within *, DeviceType>
+    makeWithinQueries(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Kokkos::View<double const *, DeviceType> radius )
+    {
+        auto const n_points = target_points.extent( 0 );
+        DTK_REQUIRE( radius.extent( 0 ) == n_points );
+        Kokkos::View<Within *, DeviceType> queries( "queries", n_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "setup_queries" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+            KOKKOS_LAMBDA( int i ) {
+                queries( i ) =
+                    within( makePoint<DIM>( target_points, i ), radius( i ) );
             } );
         Kokkos::fence();
         return queries;
     }
 
+    // Permutation that sorts the target points along the given space-filling
+    // curve over their bounding box.  The codes are the ones BatchedQueries
+    // assigns to queries, so any query on the points will do.  They are made
+    // on demand rather than stored.
+    template <int DIM, typename Curve>
+    static Kokkos::View<size_t *, DeviceType> sortAlongCurve(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Curve curve )
+    {
+        auto const n_points = target_points.extent( 0 );
+        Box bounding_box( {{0., 0., 0.}}, {{0., 0., 0.}} );
+        if ( n_points > 0 )
+            for ( int d = 0; d < DIM; ++d )
+            {
+                auto const bounds =
+                    minMax( Kokkos::subview( target_points, Kokkos::ALL, d ) );
+                bounding_box.minCorner()[d] = bounds.first;
+                bounding_box.maxCorner()[d] = bounds.second;
+            }
+        return BatchedQueries<DeviceType>::sortQueriesAlongCurve(
+            bounding_box,
+            KOKKOS_LAMBDA( int i ) {
+                return nearest( makePoint<DIM>( target_points, i ), 1 );
+            },
+            n_points, curve );
+    }
+
+    static Kokkos::View<Coordinate **, DeviceType> permutePoints(
+        Kokkos::View<size_t const *, DeviceType> permute,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            points )
+    {
+        auto const n_points = points.extent_int( 0 );
+        auto const dim = points.extent_int( 1 );
+        DTK_REQUIRE( permute.extent_int( 0 ) == n_points );
+        Kokkos::View<Coordinate **, DeviceType> permuted_points(
+            Kokkos::ViewAllocateWithoutInitializing( "permuted_points" ),
+            n_points, dim );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "permute_points" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int d = 0; d < dim; ++d )
+                    permuted_points( i, d ) = points( permute( i ), d );
+            } );
+        Kokkos::fence();
+        return permuted_points;
+    }
+
+    // Permutation that groups the target points by size class, i.e. by
+    // number of neighbors rounded up to a power of two, the classes being
+    // sorted by size.  class_offset is set on the host to the offset of each
+    // class in the permutation.  The order of the target points within a
+    // class is unspecified.
+    static Kokkos::View<int *, DeviceType>
+    groupBySizeClass( Kokkos::View<int const *, DeviceType> offset,
+                      std::vector<int> &class_offset )
+    {
+        int const n_target_points = offset.extent_int( 0 ) - 1;
+        int constexpr n_classes = 32;
+
+        auto const size_class = KOKKOS_LAMBDA( int i )
+        {
+            int const n_neighbors = offset( i + 1 ) - offset( i );
+            int c = 0;
+            while ( ( 1 << c ) < n_neighbors )
+                ++c;
+            return c;
+        };
+        Kokkos::View<int *, DeviceType> class_counts( "class_counts",
+                                                      n_classes );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "count_targets_per_size_class" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                Kokkos::atomic_increment( &class_counts( size_class( i ) ) );
+            } );
+        Kokkos::fence();
+
+        auto class_counts_host = Kokkos::create_mirror_view( class_counts );
+        Kokkos::deep_copy( class_counts_host, class_counts );
+        class_offset.assign( n_classes + 1, 0 );
+        for ( int c = 0; c < n_classes; ++c )
+            class_offset[c + 1] = class_offset[c] + class_counts_host( c );
+
+        // Reuse the counts as cursors into the permutation.
+        for ( int c = 0; c < n_classes; ++c )
+            class_counts_host( c ) = class_offset[c];
+        Kokkos::deep_copy( class_counts, class_counts_host );
+        Kokkos::View<int *, DeviceType> permutation(
+            Kokkos::ViewAllocateWithoutInitializing( "size_class_permutation" ),
+            n_target_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "group_targets_by_size_class" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                permutation( Kokkos::atomic_fetch_add(
+                    &class_counts( size_class( i ) ), 1 ) ) = i;
+            } );
+        Kokkos::fence();
+        return permutation;
+    }
+
+    // Store the values computed for the sorted target points in the order of
+    // the user, i.e. value i belongs to target point permute(i).  An empty
+    // permutation is the identity.
+    static void
+    copyToUserOrder( Kokkos::View<size_t const *, DeviceType> permute,
+                     Kokkos::View<double const *, DeviceType> values,
+                     Kokkos::View<double *, DeviceType> target_values )
+    {
+        auto const n = values.extent_int( 0 );
+        DTK_REQUIRE( target_values.extent_int( 0 ) == n );
+        if ( permute.extent( 0 ) == 0 )
+        {
+            Kokkos::deep_copy( target_values, values );
+            return;
+        }
+        DTK_REQUIRE( permute.extent_int( 0 ) == n );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "restore_target_order" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) {
+                target_values( permute( i ) ) = values( i );
+            } );
+        Kokkos::fence();
+    }
+
+    static void
+    copyToUserOrder( Kokkos::View<size_t const *, DeviceType> permute,
+                     Kokkos::View<double const **, DeviceType> values,
+                     Kokkos::View<double **, DeviceType> target_values )
+    {
+        auto const n = values.extent_int( 0 );
+        auto const n_components = values.extent_int( 1 );
+        DTK_REQUIRE( target_values.extent_int( 0 ) == n );
+        DTK_REQUIRE( target_values.extent_int( 1 ) == n_components );
+        if ( permute.extent( 0 ) == 0 )
+        {
+            Kokkos::deep_copy( target_values, values );
+            return;
+        }
+        DTK_REQUIRE( permute.extent_int( 0 ) == n );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "restore_target_order" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int k = 0; k < n_components; ++k )
+                    target_values( permute( i ), k ) = values( i, k );
+            } );
+        Kokkos::fence();
+    }
+
+    // Inverse of copyToUserOrder(): the value of sorted target point i is the
+    // one of target point permute(i).
+    static Kokkos::View<double **, DeviceType>
+    copyFromUserOrder( Kokkos::View<size_t const *, DeviceType> permute,
+                       Kokkos::View<double const **, DeviceType> target_values )
+    {
+        auto const n = target_values.extent_int( 0 );
+        auto const n_components = target_values.extent_int( 1 );
+        Kokkos::View<double **, DeviceType> values(
+            Kokkos::ViewAllocateWithoutInitializing( target_values.label() ),
+            n, n_components );
+        if ( permute.extent( 0 ) == 0 )
+        {
+            Kokkos::deep_copy( values, target_values );
+            return values;
+        }
+        DTK_REQUIRE( permute.extent_int( 0 ) == n );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "sort_target_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int k = 0; k < n_components; ++k )
+                    values( i, k ) = target_values( permute( i ), k );
+            } );
+        Kokkos::fence();
+        return values;
+    }
+
+    // Double the support radius of the target points that have fewer than
+    // n_min neighbors and search again for these only, until every target
+    // point has enough neighbors or the maximum number of refinements is
+    // reached.  The results of the search are updated in place.
+    // NOTE: This is a collective call.
+    template <int DIM>
+    static void widenUnderdeterminedNeighborhoods(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        int n_min, int max_refinements,
+        Kokkos::View<double *, DeviceType> radius,
+        Kokkos::View<int *, DeviceType> &indices,
+        Kokkos::View<int *, DeviceType> &offset,
+        Kokkos::View<int *, DeviceType> &ranks )
+    {
+        auto const n_target_points = target_points.extent_int( 0 );
+        DTK_REQUIRE( radius.extent_int( 0 ) == n_target_points );
+        DTK_REQUIRE( offset.extent_int( 0 ) == n_target_points + 1 );
+
+        for ( int refinement = 0; refinement < max_refinements; ++refinement )
+        {
+            // Position of the underdetermined target points in the new batch
+            // of queries.
+            Kokkos::View<int *, DeviceType> position( "position",
+                                                      n_target_points + 1 );
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "find_underdetermined" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+                KOKKOS_LAMBDA( int i ) {
+                    position( i ) =
+                        ( offset( i + 1 ) - offset( i ) < n_min ) ? 1 : 0;
+                } );
+            Kokkos::fence();
+            int const n_underdetermined = exclusivePrefixSum( position );
+
+            int n_global = 0;
+            Teuchos::reduceAll( *comm, Teuchos::REDUCE_SUM, n_underdetermined,
+                                Teuchos::ptrFromRef( n_global ) );
+            if ( n_global == 0 )
+                break;
+
+            Kokkos::View<Within *, DeviceType> queries( "queries",
+                                                        n_underdetermined );
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "widen_neighborhoods" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+                KOKKOS_LAMBDA( int i ) {
+                    if ( position( i + 1 ) > position( i ) )
+                    {
+                        radius( i ) *= 2.;
+                        queries( position( i ) ) = within(
+                            makePoint<DIM>( target_points, i ), radius( i ) );
+                    }
+                } );
+            Kokkos::fence();
+
+            Kokkos::View<int *, DeviceType> new_indices( "indices" );
+            Kokkos::View<int *, DeviceType> new_offset( "offset" );
+            Kokkos::View<int *, DeviceType> new_ranks( "ranks" );
+            search_tree.query( queries, new_indices, new_offset, new_ranks );
+
+            // Replace the results for the target points that were searched
+            // again and keep the others.
+            Kokkos::View<int *, DeviceType> merged_offset(
+                "offset", n_target_points + 1 );
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "count_merged_results" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+                KOKKOS_LAMBDA( int i ) {
+                    int const j = position( i );
+                    merged_offset( i ) =
+                        ( position( i + 1 ) > j )
+                            ? new_offset( j + 1 ) - new_offset( j )
+                            : offset( i + 1 ) - offset( i );
+                } );
+            Kokkos::fence();
+            int const n_results = exclusivePrefixSum( merged_offset );
+
+            Kokkos::View<int *, DeviceType> merged_indices(
+                Kokkos::ViewAllocateWithoutInitializing( "indices" ),
+                n_results );
+            Kokkos::View<int *, DeviceType> merged_ranks(
+                Kokkos::ViewAllocateWithoutInitializing( "ranks" ), n_results );
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "merge_results" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+                KOKKOS_LAMBDA( int i ) {
+                    int const j = position( i );
+                    bool const searched_again = position( i + 1 ) > j;
+                    int const first =
+                        searched_again ? new_offset( j ) : offset( i );
+                    for ( int k = merged_offset( i );
+                          k < merged_offset( i + 1 ); ++k )
+                    {
+                        int const l = first + k - merged_offset( i );
+                        merged_indices( k ) =
+                            searched_again ? new_indices( l ) : indices( l );
+                        merged_ranks( k ) =
+                            searched_again ? new_ranks( l ) : ranks( l );
+                    }
+                } );
+            Kokkos::fence();
+
+            indices = merged_indices;
+            offset = merged_offset;
+            ranks = merged_ranks;
+        }
+    }
+
+    // Fused version of transformSourceCoordinates(), computeVandermonde(),
+    // computeRadius(), computeWeights(), computeMoments(), invertMoments(),
+    // and computePolynomialCoefficients().  Each target point is handled by a
+    // team that keeps P, phi, and A in scratch memory so that only the
+    // coefficients are written to global memory.  The support radius of the
+    // radial basis function is given for each target point in radius.  If
+    // radius is empty, it is derived from the farthest neighbor instead (see
+    // computeRadius()).  If gradient_coeffs is not empty, the coefficients of
+    // the gradient of the fitted polynomial at the target points are written
+    // to it (number of neighbors, spatial dimension).  They are the rows of
+    // the pseudo-inverse that follow the first one, i.e. those of the linear
+    // terms of the basis.  If mixed_precision is true, the moment matrices are
+    // still accumulated in double precision but they are scaled to a unit
+    // diagonal and decomposed in single precision.  The rows of the inverse
+    // are then recovered to double precision by iterative refinement with
+    // residuals computed in double precision.  The matrices that are too ill
+    // conditioned for the refinement to converge are decomposed again in
+    // double precision.
+    template <typename RBF, typename PolynomialBasis>
+    static Kokkos::View<double *, DeviceType> computeCoefficients(
+        Kokkos::View<int const *, DeviceType> offset,
+        Kokkos::View<Coordinate const **, DeviceType> source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Kokkos::View<double const *, DeviceType> radius, RBF const &,
+        PolynomialBasis const &polynomial_basis,
+        Kokkos::View<double **, DeviceType> gradient_coeffs =
+            Kokkos::View<double **, DeviceType>(),
+        bool mixed_precision = false )
+    {
+        // NOTE: This includes the pseudo-inverse of the moment matrices.
+        ScopedTimer timer( "coefficients" );
+
+        auto const n_target_points = target_points.extent_int( 0 );
+
+        // The dimension of the point clouds is the one of the polynomial basis.
+        int constexpr spatial_dim = PolynomialBasis::dimension();
+        DTK_REQUIRE( source_points.extent_int( 1 ) == spatial_dim );
+        DTK_REQUIRE( target_points.extent_int( 1 ) == spatial_dim );
+        DTK_REQUIRE( offset.extent_int( 0 ) == n_target_points + 1 );
+        bool const user_radius = radius.extent( 0 ) > 0;
+        DTK_REQUIRE( !user_radius ||
+                     radius.extent_int( 0 ) == n_target_points );
+        bool const with_gradient = gradient_coeffs.extent( 0 ) > 0;
+        DTK_REQUIRE( !with_gradient ||
+                     ( PolynomialBasis::size() > spatial_dim &&
+                       gradient_coeffs.extent( 0 ) ==
+                           source_points.extent( 0 ) &&
+                       gradient_coeffs.extent_int( 1 ) == spatial_dim ) );
+        int const n_rows = with_gradient ? 1 + spatial_dim : 1;
+
+        Kokkos::View<double *, DeviceType> coeffs(
+            Kokkos::ViewAllocateWithoutInitializing( "polynomial_coeffs" ),
+            source_points.extent( 0 ) );
+        if ( n_target_points == 0 )
+            return coeffs;
+
+        // Group the target points by size class and launch the classes one
+        // after the other.  The teams of each class only request the scratch
+        // memory that the largest neighborhood of the class needs, instead
+        // of the largest of all, and have about the same amount of work.
+        std::vector<int> class_offset;
+        auto const permutation = groupBySizeClass( offset, class_offset );
+
+        using SVD = SVDFunctor<DeviceType>;
+        using ScratchMatrix = typename SVD::shared_matrix;
+        using ScratchVector = typename SVD::shared_vector;
+        using ScratchIndexVector = typename SVD::shared_index_vector;
+        using MixedSVD = SVDFunctor<DeviceType, float>;
+        using MixedScratchMatrix = typename MixedSVD::shared_matrix;
+        using MixedScratchVector = typename MixedSVD::shared_vector;
+        int constexpr size_polynomial_basis = PolynomialBasis::size();
+        int constexpr size_polynomial_basis_squared =
+            size_polynomial_basis * size_polynomial_basis;
+        SVD const svd( size_polynomial_basis, typename SVD::matrices_type(),
+                       typename SVD::matrices_type() );
+        MixedSVD const mixed_svd( size_polynomial_basis,
+                                  typename MixedSVD::matrices_type(),
+                                  typename MixedSVD::matrices_type() );
+        using TeamPolicy = Kokkos::TeamPolicy<ExecutionSpace>;
+        using MemberType = typename TeamPolicy::member_type;
+        for ( int c = 0; c + 1 < static_cast<int>( class_offset.size() ); ++c )
+        {
+            int const class_begin = class_offset[c];
+            int const n_class_targets = class_offset[c + 1] - class_begin;
+            if ( n_class_targets == 0 )
+                continue;
+
+            int const max_n_neighbors = 1 << c;
+            size_t scratch_size =
+                ScratchMatrix::shmem_size( max_n_neighbors,
+                                           size_polynomial_basis ) + // P
+                ScratchVector::shmem_size( max_n_neighbors ) +       // phi
+                ScratchVector::shmem_size(
+                    n_rows * size_polynomial_basis ) + // rows of A^+
+                SVD::shmemSize( size_polynomial_basis );
+            if ( mixed_precision )
+                scratch_size += MixedSVD::shmemSize( size_polynomial_basis ) +
+                                ScratchMatrix::shmem_size(
+                                    4, size_polynomial_basis ); // refinement
+
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "compute_polynomial_coeffs" ),
+                TeamPolicy( n_class_targets,
+                            SVD::teamSize( size_polynomial_basis ) )
+                    .set_scratch_size( 0, Kokkos::PerTeam( scratch_size ) ),
+                KOKKOS_LAMBDA( MemberType const &thread ) {
+                    int const i =
+                        permutation( class_begin + thread.league_rank() );
+                    int const first = offset( i );
+                    int const n_neighbors = offset( i + 1 ) - first;
+
+                    ScratchMatrix p( thread.team_shmem(), n_neighbors,
+                                     size_polynomial_basis );
+                    ScratchVector phi( thread.team_shmem(), n_neighbors );
+                    ScratchVector inv_a( thread.team_shmem(),
+                                         n_rows * size_polynomial_basis );
+                    ScratchMatrix e( thread.team_shmem(), size_polynomial_basis,
+                                     size_polynomial_basis );
+                    ScratchMatrix u( thread.team_shmem(), size_polynomial_basis,
+                                     size_polynomial_basis );
+                    ScratchMatrix v( thread.team_shmem(), size_polynomial_basis,
+                                     size_polynomial_basis );
+                    ScratchVector row_max( thread.team_shmem(),
+                                           size_polynomial_basis );
+                    ScratchIndexVector row_argmax( thread.team_shmem(),
+                                                   size_polynomial_basis );
+
+                    // Express the source points relative to the target point,
+                    // evaluate the polynomial basis, and store the distances to
+                    // the target in phi for now.
+                    Kokkos::parallel_for(
+                        Kokkos::TeamThreadRange( thread, n_neighbors ),
+                        [&]( int j ) {
+                            Point x = makePoint<spatial_dim>( source_points,
+                                                              first + j );
+                            for ( int d = 0; d < spatial_dim; ++d )
+                                x[d] -= target_points( i, d );
+                            auto const tmp = polynomial_basis( x );
+                            for ( int k = 0; k < size_polynomial_basis; ++k )
+                                p( j, k ) = tmp[k];
+                            phi( j ) =
+                                Details::distance( x, Point{{0., 0., 0.}} );
+                        } );
+                    thread.team_barrier();
+
+                    // See computeRadius() for the minimal value and the safety
+                    // factor.
+                    double distance =
+                        10. * Kokkos::ArithTraits<double>::epsilon();
+                    for ( int j = 0; j < n_neighbors; ++j )
+                        if ( phi( j ) > distance )
+                            distance = phi( j );
+                    RadialBasisFunction<RBF> rbf(
+                        user_radius ? radius( i ) : 1.1 * distance );
+                    thread.team_barrier();
+
+                    Kokkos::parallel_for(
+                        Kokkos::TeamThreadRange( thread, n_neighbors ),
+                        [&]( int j ) { phi( j ) = rbf( phi( j ) ); } );
+                    thread.team_barrier();
+
+                    // Build A (moment matrix)
+                    Kokkos::parallel_for(
+                        Kokkos::TeamThreadRange(
+                            thread, size_polynomial_basis_squared ),
+                        [&]( int jk ) {
+                            int const j = jk / size_polynomial_basis;
+                            int const k = jk % size_polynomial_basis;
+                            double tmp = 0.;
+                            for ( int l = 0; l < n_neighbors; ++l )
+                                tmp += p( l, j ) * phi( l ) * p( l, k );
+                            e( j, k ) = tmp;
+                        } );
+                    thread.team_barrier();
+
+                    // Only the first row of the pseudo-inverse is needed, and
+                    // the rows of the linear terms for the gradient.
+                    bool refined = false;
+                    if ( mixed_precision )
+                    {
+                        MixedScratchMatrix e_single( thread.team_shmem(),
+                                                     size_polynomial_basis,
+                                                     size_polynomial_basis );
+                        MixedScratchMatrix u_single( thread.team_shmem(),
+                                                     size_polynomial_basis,
+                                                     size_polynomial_basis );
+                        MixedScratchMatrix v_single( thread.team_shmem(),
+                                                     size_polynomial_basis,
+                                                     size_polynomial_basis );
+                        MixedScratchVector row_max_single(
+                            thread.team_shmem(), size_polynomial_basis );
+                        ScratchMatrix work( thread.team_shmem(), 4,
+                                            size_polynomial_basis );
+                        refined = mixed_svd.refinedInverse(
+                            thread, e, e_single, u_single, v_single,
+                            row_max_single, row_argmax, work, inv_a, n_rows );
+                    }
+                    if ( !refined )
+                    {
+                        svd.decompose( thread, e, u, v, row_max, row_argmax );
+                        svd.pseudoInverse( thread, e, u, v, inv_a, n_rows );
+                    }
+                    thread.team_barrier();
+
+                    // coeffs = [1 0 ... 0] * a_inv * p^T * phi
+                    Kokkos::parallel_for(
+                        Kokkos::TeamThreadRange( thread, n_neighbors ),
+                        [&]( int k ) {
+                            for ( int r = 0; r < n_rows; ++r )
+                            {
+                                double tmp = 0.;
+                                for ( int j = 0; j < size_polynomial_basis;
+                                      ++j )
+                                    tmp += inv_a( r * size_polynomial_basis +
+                                                  j ) *
+                                           p( k, j ) * phi( k );
+                                if ( r == 0 )
+                                    coeffs( first + k ) = tmp;
+                                else
+                                    gradient_coeffs( first + k, r - 1 ) = tmp;
+                            }
+                        } );
+                } );
+        }
+        Kokkos::fence();
+
+        return coeffs;
+    }
+
+    // NOTE: The coefficients may be stored in single precision, the values
+    // are accumulated in double precision either way.
+    template <typename Coefficients>
     static Kokkos::View<double *, DeviceType> computeTargetValues(
         Kokkos::View<int const *, DeviceType> offset,
-        Kokkos::View<double const *, DeviceType> polynomial_coeffs,
+        Coefficients polynomial_coeffs,
         Kokkos::View<double const *, DeviceType> source_values )
     {
+        ScopedTimer timer( "interpolation" );
+
         auto const n_target_points = offset.extent_int( 0 ) - 1;
         Kokkos::View<double *, DeviceType> target_values(
-            std::string( "target_" ) + source_values.label(), n_target_points );
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "target_" ) + source_values.label() ),
+            n_target_points );
 
         Kokkos::parallel_for(
             DTK_MARK_REGION( "compute_values" ),
@@ -74,6 +634,196 @@ struct MovingLeastSquaresOperatorImpl
         return target_values;
     }
 
+    template <typename Coefficients>
+    static Kokkos::View<double **, DeviceType> computeTargetValues(
+        Kokkos::View<int const *, DeviceType> offset,
+        Coefficients polynomial_coeffs,
+        Kokkos::View<double const **, DeviceType> source_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        auto const n_components = source_values.extent_int( 1 );
+        Kokkos::View<double **, DeviceType> target_values(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "target_" ) + source_values.label() ),
+            n_target_points, n_components );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                for ( int k = 0; k < n_components; ++k )
+                    target_values( i, k ) = 0.;
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    for ( int k = 0; k < n_components; ++k )
+                        target_values( i, k ) +=
+                            polynomial_coeffs( j ) * source_values( j, k );
+            } );
+        Kokkos::fence();
+
+        return target_values;
+    }
+
+    // Same as computeTargetValues() followed by copyToUserOrder() but the
+    // source values are read in the buffer received by the fetch plan: the
+    // j-th fetched value is imports(import_positions(j)).  An application
+    // then takes a single kernel after the exchange and no intermediate
+    // buffer.
+    template <typename Coefficients>
+    static void computeTargetValuesFromImports(
+        Kokkos::View<int const *, DeviceType> offset,
+        Coefficients polynomial_coeffs,
+        Kokkos::View<int const *, DeviceType> import_positions,
+        Kokkos::View<double const **, DeviceType> imports,
+        Kokkos::View<size_t const *, DeviceType> permute,
+        Kokkos::View<double **, DeviceType> target_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        auto const n_components = imports.extent_int( 1 );
+        DTK_REQUIRE( import_positions.extent( 0 ) == imports.extent( 0 ) );
+        DTK_REQUIRE( target_values.extent_int( 0 ) == n_target_points );
+        DTK_REQUIRE( target_values.extent_int( 1 ) == n_components );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_values_from_imports" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                size_t const t = permute.extent( 0 ) > 0 ? permute( i ) : i;
+                for ( int k = 0; k < n_components; ++k )
+                    target_values( t, k ) = 0.;
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    for ( int k = 0; k < n_components; ++k )
+                        target_values( t, k ) +=
+                            polynomial_coeffs( j ) *
+                            imports( import_positions( j ), k );
+            } );
+        Kokkos::fence();
+    }
+
+    // Same as above for the given rows only.  The source values of their
+    // neighbors have been fetched next to each other, row after row, and the
+    // ones of rows(i) start at fetched_offset(i).
+    template <typename Coefficients>
+    static Kokkos::View<double **, DeviceType> computeTargetValues(
+        Kokkos::View<int const *, DeviceType> offset,
+        Coefficients polynomial_coeffs,
+        Kokkos::View<int const *, DeviceType> rows,
+        Kokkos::View<int const *, DeviceType> fetched_offset,
+        Kokkos::View<double const **, DeviceType> source_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_rows = rows.extent_int( 0 );
+        auto const n_components = source_values.extent_int( 1 );
+        DTK_REQUIRE( fetched_offset.extent_int( 0 ) == n_rows + 1 );
+        Kokkos::View<double **, DeviceType> target_values(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "target_" ) + source_values.label() ),
+            n_rows, n_components );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_active_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+            KOKKOS_LAMBDA( const int i ) {
+                int const first = offset( rows( i ) );
+                int const shift = fetched_offset( i ) - first;
+                for ( int k = 0; k < n_components; ++k )
+                    target_values( i, k ) = 0.;
+                for ( int j = first; j < offset( rows( i ) + 1 ); ++j )
+                    for ( int k = 0; k < n_components; ++k )
+                        target_values( i, k ) += polynomial_coeffs( j ) *
+                                                 source_values( j + shift, k );
+            } );
+        Kokkos::fence();
+
+        return target_values;
+    }
+
+    // Gradient of the field at the target points (number of target points,
+    // spatial dimension) from the values of the neighbors.
+    static Kokkos::View<double **, DeviceType> computeTargetGradients(
+        Kokkos::View<int const *, DeviceType> offset,
+        Kokkos::View<double const **, DeviceType> gradient_coeffs,
+        Kokkos::View<double const *, DeviceType> source_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        auto const spatial_dim = gradient_coeffs.extent_int( 1 );
+        DTK_REQUIRE( gradient_coeffs.extent( 0 ) == source_values.extent( 0 ) );
+        Kokkos::View<double **, DeviceType> target_gradients(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "gradient_" ) + source_values.label() ),
+            n_target_points, spatial_dim );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_gradients" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                for ( int d = 0; d < spatial_dim; ++d )
+                    target_gradients( i, d ) = 0.;
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    for ( int d = 0; d < spatial_dim; ++d )
+                        target_gradients( i, d ) +=
+                            gradient_coeffs( j, d ) * source_values( j );
+            } );
+        Kokkos::fence();
+
+        return target_gradients;
+    }
+
+    // Copy values into a view of another value type, e.g. to store them in
+    // single precision.
+    template <typename T, typename Values>
+    static Kokkos::View<T *, DeviceType> convertValues( Values values )
+    {
+        int const n = values.extent( 0 );
+        Kokkos::View<T *, DeviceType> converted(
+            Kokkos::ViewAllocateWithoutInitializing( values.label() ), n );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "convert_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) { converted( i ) = values( i ); } );
+        Kokkos::fence();
+        return converted;
+    }
+
+    // Transpose of computeTargetValues(): the contribution of each target
+    // value to the values of the source points in its neighborhood, in the
+    // order of the fetched source values.
+    template <typename Coefficients>
+    static Kokkos::View<double **, DeviceType> computeTransposeValues(
+        Kokkos::View<int const *, DeviceType> offset,
+        Coefficients polynomial_coeffs,
+        Kokkos::View<double const **, DeviceType> target_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        auto const n_components = target_values.extent_int( 1 );
+        DTK_REQUIRE( target_values.extent_int( 0 ) == n_target_points );
+        Kokkos::View<double **, DeviceType> source_values(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "source_" ) + target_values.label() ),
+            polynomial_coeffs.extent( 0 ), n_components );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_transpose_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    for ( int k = 0; k < n_components; ++k )
+                        source_values( j, k ) =
+                            polynomial_coeffs( j ) * target_values( i, k );
+            } );
+        Kokkos::fence();
+
+        return source_values;
+    }
+
     static Kokkos::View<Coordinate **, DeviceType> transformSourceCoordinates(
         Kokkos::View<Coordinate const **, DeviceType> source_points,
         Kokkos::View<int const *, DeviceType> offset,
@@ -158,7 +908,9 @@ struct MovingLeastSquaresOperatorImpl
         // The argument of rbf is a distance because we have changed the
         // coordinate system such the target point is the origin of the new
         // coordinate system.
-        Kokkos::View<double *, DeviceType> phi( "weights", n_source_points );
+        Kokkos::View<double *, DeviceType> phi(
+            Kokkos::ViewAllocateWithoutInitializing( "weights" ),
+            n_source_points );
         Kokkos::parallel_for(
             DTK_MARK_REGION( "compute_weights" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_source_points ),
@@ -181,7 +933,8 @@ struct MovingLeastSquaresOperatorImpl
         auto const n_points = points.extent( 0 );
         auto constexpr size_polynomial_basis = PolynomialBasis::size();
         Kokkos::View<double *, DeviceType> p(
-            "vandermonde", n_points * size_polynomial_basis );
+            Kokkos::ViewAllocateWithoutInitializing( "vandermonde" ),
+            n_points * size_polynomial_basis );
         Kokkos::parallel_for(
             DTK_MARK_REGION( "compute_polynomial_basis" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
@@ -208,7 +961,8 @@ struct MovingLeastSquaresOperatorImpl
         auto const size_polynomial_basis_squared =
             size_polynomial_basis * size_polynomial_basis;
         Kokkos::View<double *, DeviceType> a(
-            "moments", n_target_points * size_polynomial_basis_squared );
+            Kokkos::ViewAllocateWithoutInitializing( "moments" ),
+            n_target_points * size_polynomial_basis_squared );
         Kokkos::parallel_for(
             DTK_MARK_REGION( "compute_moments" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
@@ -243,30 +997,59 @@ struct MovingLeastSquaresOperatorImpl
 
     // Matrix pseudo-inversion using SVD
     // Takes in a 1D array of matrices of size NxN, and returns a 1D array of
-    // matrices of the same size containing corresponding pseudo-inverses
+    // matrices of size n_rowsxN containing the first n_rows rows of the
+    // corresponding pseudo-inverses
     static std::tuple<Kokkos::View<double *, DeviceType>, size_t>
     invertMoments( Kokkos::View<double const *, DeviceType> a,
-                   const int size_polynomial_basis )
+                   const int size_polynomial_basis, const int n_rows )
     {
-        Kokkos::View<double *, DeviceType> inv_a( "inv_a", a.extent( 0 ) );
+        DTK_REQUIRE( n_rows > 0 && n_rows <= size_polynomial_basis );
 
         auto num_matrices =
             a.extent( 0 ) / ( size_polynomial_basis * size_polynomial_basis );
 
-        // TODO: right now, we hardcode the team size to 1. More information is
-        // available in the comments in SVDFunctor.
-        const int team_size = 1;
+        Kokkos::View<double *, DeviceType> inv_a(
+            Kokkos::ViewAllocateWithoutInitializing( "inv_a" ),
+            num_matrices * n_rows * size_polynomial_basis );
+
+        int team_size =
+            SVDFunctor<DeviceType>::teamSize( size_polynomial_basis );
+        std::string key;
+        if ( Tuning::enabled() )
+        {
+            key = Tuning::key( "svd_team_size_" +
+                                   std::to_string( size_polynomial_basis ),
+                               ExecutionSpace::name(), num_matrices );
+            team_size = Tuning::select(
+                key, SVDFunctor<DeviceType>::teamSizeCandidates(
+                         size_polynomial_basis ) );
+        }
 
-        SVDFunctor<DeviceType> svdFunctor( size_polynomial_basis, a, inv_a );
+        SVDFunctor<DeviceType> svdFunctor( size_polynomial_basis, a, inv_a,
+                                           n_rows );
         size_t num_underdetermined = 0;
+        Kokkos::Timer timer;
         Kokkos::parallel_reduce(
             DTK_MARK_REGION( "compute_svd_inverse" ),
             Kokkos::TeamPolicy<ExecutionSpace>( num_matrices, team_size ),
             svdFunctor, num_underdetermined );
+        if ( Tuning::enabled() )
+            Tuning::report( key, team_size, timer.seconds() );
 
         return std::make_tuple( inv_a, num_underdetermined );
     }
 
+    static std::tuple<Kokkos::View<double *, DeviceType>, size_t>
+    invertMoments( Kokkos::View<double const *, DeviceType> a,
+                   const int size_polynomial_basis )
+    {
+        return invertMoments( a, size_polynomial_basis,
+                              size_polynomial_basis );
+    }
+
+    // Only the first row of the pseudo-inverse of the moment matrix enters in
+    // the coefficients so inv_a is expected to be a 1D array of the first rows
+    // of the pseudo-inverses as returned by invertMoments( a, size, 1 ).
     static Kokkos::View<double *, DeviceType> computePolynomialCoefficients(
         Kokkos::View<int const *, DeviceType> offset,
         Kokkos::View<double const *, DeviceType> inv_a,
@@ -274,13 +1057,11 @@ struct MovingLeastSquaresOperatorImpl
         Kokkos::View<double const *, DeviceType> phi,
         const int size_polynomial_basis )
     {
-        auto const size_polynomial_basis_squared =
-            size_polynomial_basis * size_polynomial_basis;
-
-        auto num_matrices = inv_a.extent( 0 ) / size_polynomial_basis_squared;
+        auto num_matrices = inv_a.extent( 0 ) / size_polynomial_basis;
 
-        Kokkos::View<double *, DeviceType> coeffs( "polynomial_coeffs",
-                                                   phi.extent( 0 ) );
+        Kokkos::View<double *, DeviceType> coeffs(
+            Kokkos::ViewAllocateWithoutInitializing( "polynomial_coeffs" ),
+            phi.extent( 0 ) );
 
         Kokkos::parallel_for(
             DTK_MARK_REGION( "compute_polynomial_coeffs" ),
@@ -293,9 +1074,9 @@ struct MovingLeastSquaresOperatorImpl
                 auto phi_i = Kokkos::subview(
                     phi, Kokkos::make_pair( offset( i ), offset( i + 1 ) ) );
                 auto inv_a_i = Kokkos::subview(
-                    inv_a, Kokkos::make_pair(
-                               i * size_polynomial_basis_squared,
-                               ( i + 1 ) * size_polynomial_basis_squared ) );
+                    inv_a,
+                    Kokkos::make_pair( i * size_polynomial_basis,
+                                       ( i + 1 ) * size_polynomial_basis ) );
                 auto coeffs_i = Kokkos::subview(
                     coeffs, Kokkos::make_pair( offset( i ), offset( i + 1 ) ) );
 
@@ -304,9 +1085,9 @@ struct MovingLeastSquaresOperatorImpl
                 {
                     coeffs_i( k ) = 0.;
                     for ( int j = 0; j < size_polynomial_basis; j++ )
-                        coeffs_i( k ) +=
-                            inv_a_i( 0 * size_polynomial_basis + j ) *
-                            p_i( k * size_polynomial_basis + j ) * phi_i( k );
+                        coeffs_i( k ) += inv_a_i( j ) *
+                                         p_i( k * size_polynomial_basis + j ) *
+                                         phi_i( k );
                 }
             } );
         return coeffs;
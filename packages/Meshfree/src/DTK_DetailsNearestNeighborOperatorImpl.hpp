@@ -12,43 +12,110 @@
 #ifndef DTK_DETAILS_NEAREST_NEIGHBOR_OPERATOR_IMPL_HPP
 #define DTK_DETAILS_NEAREST_NEIGHBOR_OPERATOR_IMPL_HPP
 
+#include <DTK_DetailsAlgorithms.hpp> // distance
+#include <DTK_DetailsCachingAllocator.hpp>
 #include <DTK_DetailsDistributedSearchTreeImpl.hpp> // sendAcrossNetwork()
+#include <DTK_DetailsDistributor.hpp>
+#include <DTK_DetailsOneSidedFetch.hpp>
+#include <DTK_DetailsPointCloudHelpers.hpp>
 #include <DTK_DistributedSearchTree.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Teuchos_RCP.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <numeric> // accumulate
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace DataTransferKit
 {
 namespace Details
 {
 
+// Values moved with one of the fetch plans of a combined exchange.  They are
+// stored on the host with their n_components values next to each other.
+struct CombinedExchangePart
+{
+    // Processes the exports go to and the imports come from, by increasing
+    // rank, with the number of values exchanged with each of them.  These
+    // are the segments of the distributor of the plan.
+    std::vector<int> destination_procs;
+    std::vector<size_t> destination_lengths;
+    std::vector<int> source_procs;
+    std::vector<size_t> source_lengths;
+    int n_components;
+    // Grouped by destination in the order of the segments.
+    std::vector<double> exports;
+    // Filled by exchangeCombined() in the order of the imports of the plan.
+    std::vector<double> imports;
+};
+
 template <typename DeviceType>
 struct NearestNeighborOperatorImpl
 {
     using ExecutionSpace = typename DeviceType::execution_space;
 
     // NOTE: The tree construction will be common to all point cloud operators.
-    // Ideally, I would rather have trees directly accept other objects than
-    // boxes in their constructors.
+    // The tree is built directly from the coordinates of the source points,
+    // without copying them into an array of points first.
     static DistributedSearchTree<DeviceType> makeDistributedSearchTree(
         Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
-        Kokkos::View<Coordinate const **, DeviceType> source_points )
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points )
+    {
+        int const dim = source_points.extent_int( 1 );
+        DTK_REQUIRE( dim == 2 || dim == 3 );
+        return DistributedSearchTree<DeviceType>( comm, source_points );
+    }
+
+    // Local indices of the source points that this process owns, as opposed
+    // to the ghosts of points owned by other processes.
+    static Kokkos::View<int *, DeviceType>
+    makeOwnedIndices( Kokkos::View<bool const *, DeviceType> source_owned )
     {
-        int const n_source_points = source_points.extent( 0 );
-        Kokkos::View<Box *, DeviceType> boxes( "boxes", n_source_points );
+        return selectIndices<DeviceType>(
+            "owned_indices", source_owned.extent( 0 ),
+            KOKKOS_LAMBDA( int i ) { return source_owned( i ); } );
+    }
+
+    // Coordinates of the source points that this process owns, in the order
+    // of makeOwnedIndices().
+    static Kokkos::View<Coordinate **, DeviceType> makeOwnedPoints(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<bool const *, DeviceType> source_owned )
+    {
+        DTK_REQUIRE( source_owned.extent( 0 ) == source_points.extent( 0 ) );
+        auto const owned_indices = makeOwnedIndices( source_owned );
+        int const n_owned = owned_indices.extent( 0 );
+        int const dim = source_points.extent( 1 );
+        Kokkos::View<Coordinate **, DeviceType> owned_points(
+            Kokkos::ViewAllocateWithoutInitializing( "owned_points" ), n_owned,
+            dim );
         Kokkos::parallel_for(
-            DTK_MARK_REGION( "make_boxes" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_source_points ),
+            DTK_MARK_REGION( "fill_owned_points" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_owned ),
             KOKKOS_LAMBDA( int i ) {
-                Details::expand( boxes( i ), Point{{source_points( i, 0 ),
-                                                    source_points( i, 1 ),
-                                                    source_points( i, 2 )}} );
+                for ( int d = 0; d < dim; ++d )
+                    owned_points( i, d ) =
+                        source_points( owned_indices( i ), d );
             } );
         Kokkos::fence();
-        return DistributedSearchTree<DeviceType>( comm, boxes );
+        return owned_points;
     }
 
+    template <int DIM>
     static Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType>
     makeNearestNeighborQueries(
-        Kokkos::View<Coordinate const **, DeviceType> target_points )
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points )
     {
         int const n_target_points = target_points.extent( 0 );
         Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType>
@@ -57,139 +124,1147 @@ struct NearestNeighborOperatorImpl
             DTK_MARK_REGION( "setup_queries" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
             KOKKOS_LAMBDA( int i ) {
-                nearest_queries( i ) = nearest(
-                    Point{{target_points( i, 0 ), target_points( i, 1 ),
-                           target_points( i, 2 )}} );
+                nearest_queries( i ) =
+                    nearest( makePoint<DIM>( target_points, i ) );
             } );
         Kokkos::fence();
         return nearest_queries;
     }
 
-    template <typename View>
-    static void
-    pullSourceValues( Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
-                      View source_values,
-                      Kokkos::View<int *, DeviceType> &buffer_indices,
-                      Kokkos::View<int *, DeviceType> &buffer_ranks,
-                      typename View::non_const_type &buffer_values )
+    // Same as above with the nearest neighbor of each target point bounded
+    // by its distance to a point known to be close, e.g. its nearest neighbor
+    // before the points moved.  The search only keeps the neighbors strictly
+    // closer than the bound, hence the bound is grown by a few ulps, and
+    // kept positive when the points coincide, so that the known point is
+    // always found if nothing closer is.
+    template <int DIM>
+    static Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType>
+    makeBoundedNearestNeighborQueries(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Kokkos::View<Coordinate const **, DeviceType> neighbor_points )
     {
-        static_assert(
-            View::rank <= 2,
-            "pullSourceValues() requires rank-1 or rank-2 view arguments" );
-        int const n_exports = buffer_indices.extent( 0 );
-        Tpetra::Distributor distributor( comm );
-        int const n_imports =
-            distributor.createFromSends( Teuchos::ArrayView<int>(
-                buffer_ranks.data(), buffer_ranks.extent( 0 ) ) );
-
-        Kokkos::View<int *, DeviceType> export_target_indices( "target_indices",
-                                                               n_exports );
-        iota( export_target_indices );
-        Kokkos::View<int *, DeviceType> import_target_indices( "target_indices",
-                                                               n_imports );
+        DTK_REQUIRE( neighbor_points.extent( 0 ) ==
+                     target_points.extent( 0 ) );
+        int const n_target_points = target_points.extent( 0 );
+        double const growth =
+            1. + 4. * std::numeric_limits<double>::epsilon();
+        double const tiny = std::numeric_limits<double>::min();
+        Kokkos::View<Nearest<DataTransferKit::Point> *, DeviceType>
+            nearest_queries( "nearest", n_target_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "setup_bounded_queries" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                Point const point = makePoint<DIM>( target_points, i );
+                double const bound =
+                    distance( point, makePoint<DIM>( neighbor_points, i ) );
+                nearest_queries( i ) =
+                    nearest( point, 1, bound * growth + tiny );
+            } );
+        Kokkos::fence();
+        return nearest_queries;
+    }
+
+    // Communication plan to fetch values from other processes.  It only
+    // depends on the ranks and indices of the values to fetch so it can be
+    // built once and reused every time the values change.
+    struct FetchPlan
+    {
+        // NOTE: The distributor is held through a reference-counted pointer
+        // because Distributor::doPostsAndWaits() is not const.
+        Teuchos::RCP<Distributor> distributor;
+        // Local indices of the values to send to other processes.
+        Kokkos::View<int *, DeviceType> export_indices;
+        // Where to write the values received from other processes.
+        Kokkos::View<int *, DeviceType> import_indices;
+        // The received values grouped by the index they are written to, for
+        // mergeTransposed(): the values received at positions merge_order(i)
+        // for merge_offset(s) <= i < merge_offset(s+1) go to the same place.
+        // Only set for the transpose plans.
+        Kokkos::View<int *, DeviceType> merge_order;
+        Kokkos::View<int *, DeviceType> merge_offset;
+        // Reads the values for fetch() with one-sided communication instead
+        // of the distributor if set, see isOneSidedFetch().
+        std::shared_ptr<OneSidedFetch> one_sided;
+        // Keeps the buffers of fetch() for the next calls.
+        std::shared_ptr<CachingAllocator<typename DeviceType::memory_space>>
+            allocator = std::make_shared<
+                CachingAllocator<typename DeviceType::memory_space>>();
+    };
+
+    static FetchPlan
+    makeFetchPlan( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                   Kokkos::View<int const *, DeviceType> ranks,
+                   Kokkos::View<int const *, DeviceType> indices )
+    {
+        DTK_REQUIRE( ranks.extent( 0 ) == indices.extent( 0 ) );
+
+        // Let the processes that own the values know what indices are
+        // requested and where the values will be written.
+        int const n_requests = ranks.extent( 0 );
+        Distributor requests_distributor( comm );
+        int const n_imported_requests = requests_distributor.createFromSends(
+            Teuchos::ArrayView<int const>( ranks.data(), n_requests ) );
+
+        Kokkos::View<int **, Kokkos::LayoutRight, DeviceType> export_requests(
+            "requests", n_requests, 2 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "fill_requests" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_requests ),
+            KOKKOS_LAMBDA( int i ) {
+                export_requests( i, 0 ) = i;
+                export_requests( i, 1 ) = indices( i );
+            } );
+        Kokkos::fence();
+        Kokkos::View<int **, Kokkos::LayoutRight, DeviceType> import_requests(
+            "requests", n_imported_requests, 2 );
         DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-            distributor, export_target_indices, import_target_indices );
+            requests_distributor, export_requests, import_requests );
+
+        Kokkos::View<int *, DeviceType> export_source_indices(
+            Kokkos::ViewAllocateWithoutInitializing( "source_indices" ),
+            n_imported_requests );
+        Kokkos::View<int *, DeviceType> export_target_indices(
+            Kokkos::ViewAllocateWithoutInitializing( "target_indices" ),
+            n_imported_requests );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "unpack_requests" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imported_requests ),
+            KOKKOS_LAMBDA( int i ) {
+                export_target_indices( i ) = import_requests( i, 0 );
+                export_source_indices( i ) = import_requests( i, 1 );
+            } );
+        Kokkos::fence();
+
+        // The values are sent back to the processes that requested them.
+        // Ranks can be inferred from the communication plan.
+        auto const import_ranks =
+            DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+                requests_distributor );
+        FetchPlan plan;
+        plan.export_indices = export_source_indices;
+        plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_imports =
+            plan.distributor->createFromSends( Teuchos::ArrayView<int const>(
+                import_ranks.data(), import_ranks.extent( 0 ) ) );
+        DTK_CHECK( n_imports == n_requests );
 
-        Kokkos::View<int *, DeviceType> export_source_indices = buffer_indices;
-        Kokkos::View<int *, DeviceType> import_source_indices( "source_indices",
-                                                               n_imports );
+        plan.import_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "target_indices" ),
+            n_imports );
         DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-            distributor, export_source_indices, import_source_indices );
+            *plan.distributor, export_target_indices, plan.import_indices );
 
-        Kokkos::View<int *, DeviceType> export_ranks( "ranks", n_exports );
-        Kokkos::View<int *, DeviceType> import_ranks( "ranks", n_imports );
-        int const comm_rank = comm->getRank();
-        Kokkos::deep_copy( export_ranks, comm_rank );
+        // The values may also be read directly with the ranks and indices
+        // requested.  Only the values that are requested by some process
+        // need to be exposed.
+        if ( isOneSidedFetch() )
+        {
+            int n_exposed = 0;
+            if ( n_imported_requests > 0 )
+            {
+                Kokkos::Experimental::Max<int> reducer( n_exposed );
+                Kokkos::parallel_reduce(
+                    DTK_MARK_REGION( "count_exposed_values" ),
+                    Kokkos::RangePolicy<ExecutionSpace>( 0,
+                                                         n_imported_requests ),
+                    KOKKOS_LAMBDA( int i, int &update ) {
+                        if ( export_source_indices( i ) >= update )
+                            update = export_source_indices( i ) + 1;
+                    },
+                    reducer );
+            }
+            auto ranks_host = Kokkos::create_mirror_view( ranks );
+            Kokkos::deep_copy( ranks_host, ranks );
+            auto indices_host = Kokkos::create_mirror_view( indices );
+            Kokkos::deep_copy( indices_host, indices );
+            plan.one_sided = std::make_shared<OneSidedFetch>(
+                comm,
+                Teuchos::ArrayView<int const>( ranks_host.data(), n_requests ),
+                Teuchos::ArrayView<int const>( indices_host.data(),
+                                               n_requests ),
+                n_exposed );
+        }
+
+        return plan;
+    }
+
+    // Plans to send the values of the local points to the given ranks and to
+    // bring the values computed there back.  The first one lays the values
+    // out on the destination in the order in which they are received and the
+    // second one puts the values sent back in the order of the local points.
+    static std::pair<FetchPlan, FetchPlan>
+    makeMigrationPlans( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                        Kokkos::View<int const *, DeviceType> ranks )
+    {
+        int const n_points = ranks.extent( 0 );
+        FetchPlan migration_plan;
+        migration_plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_imports = migration_plan.distributor->createFromSends(
+            Teuchos::ArrayView<int const>( ranks.data(), n_points ) );
+        migration_plan.export_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "point_indices" ),
+            n_points );
+        iota( migration_plan.export_indices );
+        migration_plan.import_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "migrated_indices" ),
+            n_imports );
+        iota( migration_plan.import_indices );
+
+        // The values go back to the processes the points came from, where
+        // their position is the index that was sent with them.
+        FetchPlan return_plan;
+        return_plan.export_indices = migration_plan.import_indices;
+        auto const import_ranks =
+            DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+                *migration_plan.distributor );
+        return_plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_returns =
+            return_plan.distributor->createFromSends(
+                Teuchos::ArrayView<int const>( import_ranks.data(),
+                                               n_imports ) );
+        DTK_CHECK( n_returns == n_points );
+        auto const point_indices =
+            fetch( migration_plan, migration_plan.export_indices );
+        return_plan.import_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "point_indices" ),
+            n_points );
         DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-            distributor, export_ranks, import_ranks );
+            *return_plan.distributor, point_indices,
+            return_plan.import_indices );
+
+        return std::make_pair( migration_plan, return_plan );
+    }
+
+    // Plan to send values back along another plan, i.e. from where the plan
+    // writes the values to where it reads them.  The imports of the
+    // distributor are laid out by increasing rank of their origin and, for a
+    // given origin, in the order they were exported, so the plan is built
+    // without communication.
+    static FetchPlan
+    makeTransposePlan( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                       FetchPlan const &plan )
+    {
+        auto const destination_ranks = getSourceRanks( plan );
+        auto const source_ranks = getDestinationRanks( plan );
+
+        FetchPlan transpose_plan;
+        transpose_plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_imports =
+            transpose_plan.distributor->createFromSendsAndRecvs(
+                Teuchos::ArrayView<int const>( destination_ranks.data(),
+                                               destination_ranks.size() ),
+                Teuchos::ArrayView<int const>( source_ranks.data(),
+                                               source_ranks.size() ) );
+        int const n_exports = plan.export_indices.extent( 0 );
+        DTK_CHECK( n_imports == n_exports );
+        transpose_plan.export_indices = plan.import_indices;
+
+        // The values sent back by a process come in the order that process
+        // received them, i.e. in the order of the send buffer of the plan.
+        transpose_plan.import_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "source_indices" ),
+            n_imports );
+        auto const permute_host = plan.distributor->getPermutation();
+        if ( permute_host.empty() )
+        {
+            Kokkos::deep_copy( transpose_plan.import_indices,
+                               plan.export_indices );
+        }
+        else
+        {
+            Kokkos::View<int *, DeviceType> permute(
+                Kokkos::ViewAllocateWithoutInitializing( "permute" ),
+                n_exports );
+            Kokkos::deep_copy(
+                permute, Kokkos::View<int const *, Kokkos::HostSpace,
+                                      Kokkos::MemoryUnmanaged>(
+                             permute_host.getRawPtr(), n_exports ) );
+            auto const export_indices = plan.export_indices;
+            auto const import_indices = transpose_plan.import_indices;
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "transpose_indices" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+                KOKKOS_LAMBDA( int i ) {
+                    import_indices( permute( i ) ) = export_indices( i );
+                } );
+            Kokkos::fence();
+        }
+
+        groupImportsByIndex( transpose_plan );
+        return transpose_plan;
+    }
+
+    // Sort the imports of a plan by the index they are written to, with a
+    // stable sort, and find where the imports of each index begin, see
+    // FetchPlan::merge_order.  The grouping survives mapSourceIndices()
+    // since the indices are mapped one-to-one.
+    static void groupImportsByIndex( FetchPlan &plan )
+    {
+        int const n_imports = plan.import_indices.extent( 0 );
+        auto const import_indices = plan.import_indices;
+        Kokkos::View<unsigned int *, DeviceType> keys(
+            Kokkos::ViewAllocateWithoutInitializing( "keys" ), n_imports );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "copy_import_indices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+            KOKKOS_LAMBDA( int i ) { keys( i ) = import_indices( i ); } );
+        Kokkos::fence();
+        auto const permute = RadixSort<DeviceType>::sort( keys );
 
-        buffer_indices = import_target_indices;
-        buffer_ranks = import_ranks;
-        Kokkos::realloc( buffer_values, n_imports,
-                         source_values.dimension_1() );
+        // Flag the first import of each index.  The exclusive scan then
+        // yields the group of each import and the number of groups.
+        Kokkos::View<int *, DeviceType> group( "group", n_imports + 1 );
+        Kokkos::View<int *, DeviceType> merge_order(
+            Kokkos::ViewAllocateWithoutInitializing( "merge_order" ),
+            n_imports );
         Kokkos::parallel_for(
-            DTK_MARK_REGION( "get_source_values" ),
+            DTK_MARK_REGION( "flag_first_imports" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
             KOKKOS_LAMBDA( int i ) {
-                for ( int j = 0; j < (int)source_values.dimension_1(); ++j )
-                    buffer_values( i, j ) =
-                        source_values( import_source_indices( i ), j );
+                merge_order( i ) = permute( i );
+                group( i ) = ( i == 0 || keys( i ) != keys( i - 1 ) ) ? 1 : 0;
             } );
         Kokkos::fence();
+        int const n_groups = exclusivePrefixSum( group );
+
+        Kokkos::View<int *, DeviceType> merge_offset(
+            Kokkos::ViewAllocateWithoutInitializing( "merge_offset" ),
+            n_groups + 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "find_first_imports" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+            KOKKOS_LAMBDA( int i ) {
+                if ( group( i + 1 ) > group( i ) )
+                    merge_offset( group( i ) ) = i;
+            } );
+        Kokkos::fence();
+        Kokkos::deep_copy( Kokkos::subview( merge_offset, n_groups ),
+                           n_imports );
+
+        plan.merge_order = merge_order;
+        plan.merge_offset = merge_offset;
     }
 
-    template <typename View>
+    // Map the indices of the values that a plan and its transpose read, e.g.
+    // the indices of the owned points in a search tree built over these only,
+    // to the local indices given by source_indices.  The one-sided reads
+    // address the values with the indices that were requested so the plan
+    // falls back on the distributor.  This must be called on all processes.
     static void
-    pushTargetValues( Teuchos::RCP<const Teuchos::Comm<int>> const &comm,
-                      Kokkos::View<int *, DeviceType> const &buffer_indices,
-                      Kokkos::View<int *, DeviceType> const &buffer_ranks,
-                      View const &buffer_values, View target_values )
+    mapSourceIndices( FetchPlan &plan, FetchPlan &transpose_plan,
+                      Kokkos::View<int const *, DeviceType> source_indices )
     {
-        static_assert(
-            View::rank <= 2,
-            "pushTargetValues() requires rank-1 or rank-2 view arguments" );
-        Tpetra::Distributor distributor( comm );
-        int const n_imports =
-            distributor.createFromSends( Teuchos::ArrayView<int>(
-                buffer_ranks.data(), buffer_ranks.extent( 0 ) ) );
+        auto const export_indices = plan.export_indices;
+        auto const import_indices = transpose_plan.import_indices;
+        int const n_exports = export_indices.extent( 0 );
+        DTK_REQUIRE( import_indices.extent_int( 0 ) == n_exports );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "map_source_indices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+            KOKKOS_LAMBDA( int i ) {
+                export_indices( i ) = source_indices( export_indices( i ) );
+                import_indices( i ) = source_indices( import_indices( i ) );
+            } );
+        Kokkos::fence();
+        plan.one_sided.reset();
+    }
+
+    // Plan that only fetches the values that plan writes to the indices
+    // flagged in active, e.g. the target points that need to be updated on a
+    // given step.  The values are written next to each other in the order of
+    // the flagged indices.  Setting it up only exchanges the positions of
+    // the values to keep in the plan, so that the communication scales with
+    // their number, but this must be called on all processes.
+    static FetchPlan
+    makeSubsetPlan( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                    FetchPlan const &plan,
+                    Kokkos::View<bool const *, DeviceType> active )
+    {
+        auto const import_indices = plan.import_indices;
+        int const n_imports = import_indices.extent( 0 );
+        int const n_indices = active.extent( 0 );
+
+        // Where the value of each flagged index goes and which imports are
+        // kept.
+        Kokkos::View<int *, DeviceType> compact_indices( "compact_indices",
+                                                         n_indices + 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "flag_active_indices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_indices ),
+            KOKKOS_LAMBDA( int i ) {
+                compact_indices( i ) = active( i ) ? 1 : 0;
+            } );
+        Kokkos::fence();
+        exclusivePrefixSum( compact_indices );
+        Kokkos::View<bool *, DeviceType> active_imports(
+            Kokkos::ViewAllocateWithoutInitializing( "active_imports" ),
+            n_imports );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "flag_active_imports" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+            KOKKOS_LAMBDA( int i ) {
+                active_imports( i ) = active( import_indices( i ) );
+            } );
+        Kokkos::fence();
+        auto const kept_imports = makeOwnedIndices( active_imports );
+        int const n_kept = kept_imports.extent( 0 );
+        auto kept_imports_host = Kokkos::create_mirror_view( kept_imports );
+        Kokkos::deep_copy( kept_imports_host, kept_imports );
 
-        View export_source_values = buffer_values;
-        View import_source_values( "source_values", n_imports,
-                                   target_values.dimension_1() );
+        // Ask the processes the kept imports come from to send them, given
+        // their position among the imports from that process.  The imports
+        // are grouped by increasing rank of their origin.
+        Distributor const &distributor = *plan.distributor;
+        auto const procs_from = distributor.getProcsFrom();
+        auto const lengths_from = distributor.getLengthsFrom();
+        std::vector<int> from_offset( procs_from.size() + 1, 0 );
+        for ( int i = 0; i < procs_from.size(); ++i )
+            from_offset[i + 1] = from_offset[i] + lengths_from[i];
+        std::vector<int> request_ranks( n_kept );
+        std::vector<int> request_positions( n_kept );
+        for ( int k = 0; k < n_kept; ++k )
+        {
+            int const i = kept_imports_host( k );
+            int const origin =
+                std::upper_bound( from_offset.begin(), from_offset.end(), i ) -
+                from_offset.begin() - 1;
+            request_ranks[k] = procs_from[origin];
+            request_positions[k] = i - from_offset[origin];
+        }
+        Distributor requests_distributor( comm );
+        int const n_requests = requests_distributor.createFromSends(
+            Teuchos::ArrayView<int const>( request_ranks.data(), n_kept ) );
+        Kokkos::View<int *, DeviceType> export_positions(
+            Kokkos::ViewAllocateWithoutInitializing( "positions" ), n_kept );
+        Kokkos::deep_copy(
+            export_positions,
+            Kokkos::View<int const *, Kokkos::HostSpace,
+                         Kokkos::MemoryUnmanaged>( request_positions.data(),
+                                                   n_kept ) );
+        Kokkos::View<int *, DeviceType> import_positions(
+            Kokkos::ViewAllocateWithoutInitializing( "positions" ),
+            n_requests );
         DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-            distributor, export_source_values, import_source_values );
+            requests_distributor, export_positions, import_positions );
+
+        // The requested value is the one at that position among the exports
+        // to the requesting process in the send buffer of the plan, which
+        // holds the exports grouped by increasing rank of their destination.
+        auto const procs_to = distributor.getProcsTo();
+        auto const lengths_to = distributor.getLengthsTo();
+        std::vector<int> to_offset_host( comm->getSize(), 0 );
+        int n_sent = 0;
+        for ( int i = 0; i < procs_to.size(); ++i )
+        {
+            to_offset_host[procs_to[i]] = n_sent;
+            n_sent += lengths_to[i];
+        }
+        Kokkos::View<int *, DeviceType> to_offset(
+            Kokkos::ViewAllocateWithoutInitializing( "offset" ),
+            to_offset_host.size() );
+        Kokkos::deep_copy(
+            to_offset,
+            Kokkos::View<int const *, Kokkos::HostSpace,
+                         Kokkos::MemoryUnmanaged>( to_offset_host.data(),
+                                                   to_offset_host.size() ) );
+        int const n_exports = plan.export_indices.extent( 0 );
+        Kokkos::View<int *, DeviceType> buffer_exports(
+            Kokkos::ViewAllocateWithoutInitializing( "exports" ), n_exports );
+        auto const permute_host = distributor.getPermutation();
+        if ( permute_host.empty() )
+        {
+            iota( buffer_exports );
+        }
+        else
+        {
+            Kokkos::View<int *, DeviceType> permute(
+                Kokkos::ViewAllocateWithoutInitializing( "permute" ),
+                n_exports );
+            Kokkos::deep_copy(
+                permute, Kokkos::View<int const *, Kokkos::HostSpace,
+                                      Kokkos::MemoryUnmanaged>(
+                             permute_host.getRawPtr(), n_exports ) );
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "invert_permutation" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+                KOKKOS_LAMBDA( int i ) {
+                    buffer_exports( permute( i ) ) = i;
+                } );
+            Kokkos::fence();
+        }
+        auto const requesting_ranks =
+            DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+                requests_distributor );
+
+        FetchPlan subset_plan;
+        subset_plan.export_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "source_indices" ),
+            n_requests );
+        auto const export_indices = plan.export_indices;
+        auto const subset_export_indices = subset_plan.export_indices;
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "find_requested_exports" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_requests ),
+            KOKKOS_LAMBDA( int k ) {
+                subset_export_indices( k ) = export_indices( buffer_exports(
+                    to_offset( requesting_ranks( k ) ) +
+                    import_positions( k ) ) );
+            } );
+        Kokkos::fence();
+
+        // The requests came grouped by increasing rank and the values go back
+        // the same way, hence in the order of the kept imports.
+        auto requesting_ranks_host =
+            Kokkos::create_mirror_view( requesting_ranks );
+        Kokkos::deep_copy( requesting_ranks_host, requesting_ranks );
+        subset_plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_subset_imports =
+            subset_plan.distributor->createFromSendsAndRecvs(
+                Teuchos::ArrayView<int const>( requesting_ranks_host.data(),
+                                               n_requests ),
+                Teuchos::ArrayView<int const>( request_ranks.data(),
+                                               n_kept ) );
+        DTK_CHECK( n_subset_imports == n_kept );
+
+        subset_plan.import_indices = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "target_indices" ),
+            n_kept );
+        auto const subset_import_indices = subset_plan.import_indices;
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compact_import_indices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_kept ),
+            KOKKOS_LAMBDA( int k ) {
+                subset_import_indices( k ) =
+                    compact_indices( import_indices( kept_imports( k ) ) );
+            } );
+        Kokkos::fence();
+
+        return subset_plan;
+    }
 
-        Kokkos::View<int *, DeviceType> export_target_indices = buffer_indices;
-        Kokkos::View<int *, DeviceType> import_target_indices( "target_indices",
-                                                               n_imports );
+    // NOTE: The values are returned in a view with the default layout so
+    // that strided inputs, e.g. user-provided coordinates, can be fetched.
+    template <typename View>
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
+    fetch( FetchPlan const &plan, View values )
+    {
+        using ValuesOut =
+            Kokkos::View<typename View::non_const_data_type, DeviceType>;
+        static_assert( View::rank <= 2,
+                       "fetch() requires rank-1 or rank-2 view arguments" );
+
+        if ( plan.one_sided )
+            return fetchOneSided( plan, values );
+
+        CachingAllocatorScope<typename DeviceType::memory_space>
+            allocator_scope( *plan.allocator );
+        TemporaryViews<DeviceType> temporaries;
+        return unpackImports( plan, exchange( plan, values, temporaries ) );
+    }
+
+    // Same as above but the values are written into values_out, e.g. the
+    // target values of the caller, instead of a new view.
+    template <typename View, typename ValuesOut>
+    static void fetch( FetchPlan const &plan, View values,
+                       ValuesOut values_out )
+    {
+        static_assert( View::rank <= 2,
+                       "fetch() requires rank-1 or rank-2 view arguments" );
+        DTK_REQUIRE( values_out.extent( 0 ) ==
+                     plan.import_indices.extent( 0 ) );
+        DTK_REQUIRE( values_out.extent( 1 ) == values.extent( 1 ) );
+
+        if ( plan.one_sided )
+        {
+            Kokkos::deep_copy( values_out, fetchOneSided( plan, values ) );
+            return;
+        }
+
+        CachingAllocatorScope<typename DeviceType::memory_space>
+            allocator_scope( *plan.allocator );
+        TemporaryViews<DeviceType> temporaries;
+        copyImports( plan, exchange( plan, values, temporaries ), values_out );
+    }
+
+    // Send the values that a plan exports, e.g. back along the transpose of
+    // another plan (see makeTransposePlan()), and return the values received
+    // in the order of the imports of the plan.  The buffers are stored in
+    // temporaries.  The caller must have set up the scope of the allocator
+    // of the plan.
+    template <typename View>
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
+    exchange( FetchPlan const &plan, View values,
+              TemporaryViews<DeviceType> &temporaries )
+    {
+        using Values =
+            Kokkos::View<typename View::non_const_data_type, DeviceType>;
+        auto exports = temporaries.template view<typename Values::data_type>(
+            values.label(), plan.export_indices.extent( 0 ),
+            values.extent( 1 ) );
+        copyExports( plan, values, exports );
+        auto imports = temporaries.template view<typename Values::data_type>(
+            values.label(), plan.import_indices.extent( 0 ),
+            values.extent( 1 ) );
         DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-            distributor, export_target_indices, import_target_indices );
+            *plan.distributor, exports, imports );
+        return imports;
+    }
+
+    // Position of each fetched value in the values received by exchange(),
+    // i.e. the inverse of FetchPlan::import_indices, for the operators that
+    // read the received values in place.
+    static Kokkos::View<int *, DeviceType>
+    makeImportPositions( FetchPlan const &plan )
+    {
+        auto const import_indices = plan.import_indices;
+        int const n_imports = import_indices.extent( 0 );
+        Kokkos::View<int *, DeviceType> import_positions(
+            Kokkos::ViewAllocateWithoutInitializing( "import_positions" ),
+            n_imports );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "invert_import_indices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+            KOKKOS_LAMBDA( int i ) {
+                import_positions( import_indices( i ) ) = i;
+            } );
+        Kokkos::fence();
+        return import_positions;
+    }
+
+    // Send the values back along the transpose of a plan and add them to the
+    // values the plan reads, i.e. apply the transpose of fetch().  A value
+    // that the plan sends to several places gets the sum of what comes back
+    // from all of them.  The sums are accumulated into values_out, which is
+    // not reset.
+    template <typename View, typename ValuesOut>
+    static void addTransposed( FetchPlan const &transpose_plan, View values,
+                               ValuesOut values_out )
+    {
+        static_assert(
+            View::rank <= 2,
+            "addTransposed() requires rank-1 or rank-2 view arguments" );
+        DTK_REQUIRE( values.extent( 1 ) == values_out.extent( 1 ) );
+
+        CachingAllocatorScope<typename DeviceType::memory_space>
+            allocator_scope( *transpose_plan.allocator );
+        TemporaryViews<DeviceType> temporaries;
+        auto const imports = exchange( transpose_plan, values, temporaries );
+
+        auto const import_indices = transpose_plan.import_indices;
+        int const n_imports = import_indices.extent( 0 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "add_source_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int j = 0; j < (int)imports.extent( 1 ); ++j )
+                    Kokkos::atomic_add( &values_out( import_indices( i ), j ),
+                                        imports( i, j ) );
+            } );
+        Kokkos::fence();
+    }
+
+    // Same as addTransposed() but the values that come back to the same place
+    // are combined with the reducer (see DTK_Reducers.hpp), one place per
+    // thread, in the order in which they were received.  No atomics are
+    // needed and the result does not depend on the scheduling of the
+    // threads.  The combined values replace the ones in values_out, the
+    // values that receive nothing are left untouched.
+    template <typename View, typename ValuesOut, typename Reducer>
+    static void mergeTransposed( FetchPlan const &transpose_plan, View values,
+                                 ValuesOut values_out, Reducer const &reducer )
+    {
+        static_assert(
+            View::rank <= 2,
+            "mergeTransposed() requires rank-1 or rank-2 view arguments" );
+        DTK_REQUIRE( values.extent( 1 ) == values_out.extent( 1 ) );
+        DTK_REQUIRE( transpose_plan.merge_order.extent( 0 ) ==
+                     transpose_plan.import_indices.extent( 0 ) );
+
+        CachingAllocatorScope<typename DeviceType::memory_space>
+            allocator_scope( *transpose_plan.allocator );
+        TemporaryViews<DeviceType> temporaries;
+        auto const imports = exchange( transpose_plan, values, temporaries );
+
+        auto const import_indices = transpose_plan.import_indices;
+        auto const merge_order = transpose_plan.merge_order;
+        auto const merge_offset = transpose_plan.merge_offset;
+        int const n_groups = merge_offset.extent_int( 0 ) - 1;
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "merge_source_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_groups ),
+            KOKKOS_LAMBDA( int g ) {
+                int const index =
+                    import_indices( merge_order( merge_offset( g ) ) );
+                for ( int j = 0; j < (int)imports.extent( 1 ); ++j )
+                {
+                    typename Reducer::value_type value;
+                    reducer.init( value );
+                    for ( int i = merge_offset( g ); i < merge_offset( g + 1 );
+                          ++i )
+                        reducer.join( value, imports( merge_order( i ), j ) );
+                    values_out( index, j ) = value;
+                }
+            } );
+        Kokkos::fence();
+    }
+
+    // Same as fetch() with one-sided communication.  The values are staged
+    // through the host, contiguously.
+    template <typename View>
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
+    fetchOneSided( FetchPlan const &plan, View values )
+    {
+        using ValuesOut =
+            Kokkos::View<typename View::non_const_data_type, DeviceType>;
+        using ValueType = typename View::non_const_value_type;
+        using Buffer = Kokkos::View<ValueType **, Kokkos::LayoutRight,
+                                    typename DeviceType::memory_space>;
+
+        OneSidedFetch &one_sided = *plan.one_sided;
+        int const n_exposed = one_sided.getNumberOfExposedValues();
+        int const n_components = values.extent( 1 );
+        DTK_REQUIRE( values.extent_int( 0 ) >= n_exposed );
+
+        Buffer exposed( Kokkos::ViewAllocateWithoutInitializing( "exposed" ),
+                        n_exposed, n_components );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "expose_source_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_exposed ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int j = 0; j < n_components; ++j )
+                    exposed( i, j ) = values( i, j );
+            } );
+        Kokkos::fence();
+        auto exposed_host = Kokkos::create_mirror_view( exposed );
+        Kokkos::deep_copy( exposed_host, exposed );
+
+        int const n_requests = one_sided.getNumberOfRequests();
+        Buffer fetched( Kokkos::ViewAllocateWithoutInitializing( "fetched" ),
+                        n_requests, n_components );
+        auto fetched_host = Kokkos::create_mirror_view( fetched );
+        one_sided.fetch( exposed_host.data(),
+                         n_components * sizeof( ValueType ),
+                         fetched_host.data() );
+        Kokkos::deep_copy( fetched, fetched_host );
+
+        ValuesOut values_out( values.label(), n_requests, n_components );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "set_target_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_requests ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int j = 0; j < n_components; ++j )
+                    values_out( i, j ) = fetched( i, j );
+            } );
+        Kokkos::fence();
+
+        return values_out;
+    }
+
+    // Values to send to other processes, in the order of the exports of the
+    // plan.  This is the first step of fetch(), which is exposed so that the
+    // exchanges of several plans can be combined.
+    template <typename View>
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
+    packExports( FetchPlan const &plan, View values )
+    {
+        using ValuesOut =
+            Kokkos::View<typename View::non_const_data_type, DeviceType>;
+
+        ValuesOut exports( values.label(), plan.export_indices.extent( 0 ),
+                           values.extent( 1 ) );
+        copyExports( plan, values, exports );
+
+        return exports;
+    }
+
+    // Write the values to send to other processes into exports.
+    template <typename View, typename ValuesOut>
+    static void copyExports( FetchPlan const &plan, View values,
+                             ValuesOut exports )
+    {
+        auto const export_indices = plan.export_indices;
+        int const n_exports = export_indices.extent( 0 );
+        DTK_REQUIRE( exports.extent_int( 0 ) == n_exports );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "get_source_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int j = 0; j < (int)values.extent( 1 ); ++j )
+                    exports( i, j ) = values( export_indices( i ), j );
+            } );
+        Kokkos::fence();
+    }
+
+    // Put the values received from other processes, in the order of the
+    // imports of the plan, where they were requested.  This is the last step
+    // of fetch().
+    template <typename View>
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
+    unpackImports( FetchPlan const &plan, View imports )
+    {
+        using ValuesOut =
+            Kokkos::View<typename View::non_const_data_type, DeviceType>;
+
+        ValuesOut values_out( imports.label(), plan.import_indices.extent( 0 ),
+                              imports.extent( 1 ) );
+        copyImports( plan, imports, values_out );
+
+        return values_out;
+    }
+
+    // Write the values received from other processes into values_out.
+    template <typename View, typename ValuesOut>
+    static void copyImports( FetchPlan const &plan, View imports,
+                             ValuesOut values_out )
+    {
+        auto const import_indices = plan.import_indices;
+        int const n_imports = import_indices.extent( 0 );
+        DTK_REQUIRE( imports.extent_int( 0 ) == n_imports );
+        DTK_REQUIRE( values_out.extent_int( 0 ) == n_imports );
 
         Kokkos::parallel_for(
             DTK_MARK_REGION( "set_target_values" ),
             Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
             KOKKOS_LAMBDA( int i ) {
-                for ( int j = 0; j < (int)target_values.dimension_1(); ++j )
-                    target_values( import_target_indices( i ), j ) =
-                        import_source_values( i, j );
+                for ( int j = 0; j < (int)imports.extent( 1 ); ++j )
+                    values_out( import_indices( i ), j ) = imports( i, j );
             } );
         Kokkos::fence();
     }
 
+    // Part of a combined exchange that moves the values with the plan, see
+    // exchangeCombined().  The exports are laid out in the send buffer of
+    // the distributor so that its segments describe them as they are.
+    template <typename View>
+    static CombinedExchangePart
+    makeCombinedExchangePart( FetchPlan const &plan, View values )
+    {
+        Distributor const &distributor = *plan.distributor;
+        int const n_exports = plan.export_indices.extent( 0 );
+        int const n_components = values.extent( 1 );
+
+        Kokkos::View<double **, Kokkos::LayoutRight, DeviceType> exports(
+            Kokkos::ViewAllocateWithoutInitializing( "exports" ), n_exports,
+            n_components );
+        copyExports( plan, values, exports );
+        auto const exports_host = Kokkos::create_mirror_view( exports );
+        Kokkos::deep_copy( exports_host, exports );
+
+        CombinedExchangePart part;
+        auto const procs_to = distributor.getProcsTo();
+        auto const lengths_to = distributor.getLengthsTo();
+        auto const procs_from = distributor.getProcsFrom();
+        auto const lengths_from = distributor.getLengthsFrom();
+        part.destination_procs.assign( procs_to.begin(), procs_to.end() );
+        part.destination_lengths.assign( lengths_to.begin(),
+                                         lengths_to.end() );
+        part.source_procs.assign( procs_from.begin(), procs_from.end() );
+        part.source_lengths.assign( lengths_from.begin(),
+                                    lengths_from.end() );
+        part.n_components = n_components;
+        part.exports.resize( n_exports * n_components );
+        auto const permute = distributor.getPermutation();
+        for ( int i = 0; i < n_exports; ++i )
+            std::copy( exports_host.data() + i * n_components,
+                       exports_host.data() + ( i + 1 ) * n_components,
+                       part.exports.begin() +
+                           ( permute.empty() ? i : permute[i] ) *
+                               n_components );
+        return part;
+    }
+
+    // Rank of the process each export of the plan goes to, in the order of
+    // the exports.  The exports are grouped by destination in the send
+    // buffer.
+    static std::vector<int> getDestinationRanks( FetchPlan const &plan )
+    {
+        Distributor const &distributor = *plan.distributor;
+        auto const procs_to = distributor.getProcsTo();
+        auto const lengths_to = distributor.getLengthsTo();
+        std::vector<int> send_buffer_ranks;
+        for ( int i = 0; i < procs_to.size(); ++i )
+            send_buffer_ranks.insert( send_buffer_ranks.end(), lengths_to[i],
+                                      procs_to[i] );
+        auto const permute = distributor.getPermutation();
+        std::vector<int> destination_ranks( send_buffer_ranks.size() );
+        for ( size_t i = 0; i < destination_ranks.size(); ++i )
+            destination_ranks[i] =
+                send_buffer_ranks[permute.empty() ? i : permute[i]];
+        return destination_ranks;
+    }
+
+    // Rank of the process each import of the plan comes from, in the order
+    // of the imports.
+    static std::vector<int> getSourceRanks( FetchPlan const &plan )
+    {
+        Distributor const &distributor = *plan.distributor;
+        auto const procs_from = distributor.getProcsFrom();
+        auto const lengths_from = distributor.getLengthsFrom();
+        std::vector<int> source_ranks;
+        for ( int i = 0; i < procs_from.size(); ++i )
+            source_ranks.insert( source_ranks.end(), lengths_from[i],
+                                 procs_from[i] );
+        return source_ranks;
+    }
+
     template <typename View>
-    static typename View::non_const_type
+    static Kokkos::View<typename View::non_const_data_type, DeviceType>
     fetch( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
            Kokkos::View<int const *, DeviceType> ranks,
            Kokkos::View<int const *, DeviceType> indices, View values )
     {
-        DTK_REQUIRE( ranks.extent( 0 ) == indices.extent( 0 ) );
+        auto values_out =
+            fetch( makeFetchPlan( comm, ranks, indices ), values );
+
+        DTK_ENSURE( ( values_out.extent( 0 ) == ranks.extent( 0 ) ) &&
+                    ( values_out.extent( 1 ) == values.extent( 1 ) ) );
+
+        return values_out;
+    }
 
-        Kokkos::View<int *, DeviceType> buffer_ranks =
-            Kokkos::create_mirror( DeviceType(), ranks );
-        Kokkos::deep_copy( buffer_ranks, ranks );
+    // Checksum of the coordinates of a point cloud.  Each coordinate is mixed
+    // with its position and the results are summed so that the value does not
+    // depend on the order of the reduction.
+    static std::uint64_t hashPoints(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            points )
+    {
+        int const n_points = points.extent( 0 );
+        int const dim = points.extent( 1 );
+        unsigned long long hash = 0;
+        Kokkos::parallel_reduce(
+            DTK_MARK_REGION( "hash_points" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+            KOKKOS_LAMBDA( int i, unsigned long long &sum ) {
+                for ( int d = 0; d < dim; ++d )
+                {
+                    union {
+                        Coordinate value;
+                        std::uint64_t bits;
+                    } coordinate;
+                    coordinate.value = points( i, d );
+                    // splitmix64 finalizer
+                    std::uint64_t z = coordinate.bits +
+                                      0x9e3779b97f4a7c15ULL *
+                                          ( std::uint64_t( i ) * dim + d + 1 );
+                    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+                    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+                    sum += z ^ ( z >> 31 );
+                }
+            },
+            hash );
+        return hash;
+    }
 
-        Kokkos::View<int *, DeviceType> buffer_indices =
-            Kokkos::create_mirror( DeviceType(), indices );
-        Kokkos::deep_copy( buffer_indices, indices );
+    template <typename T>
+    static void writeArray( std::ostream &stream, T const *data, size_t size )
+    {
+        std::uint64_t const n = size;
+        stream.write( reinterpret_cast<char const *>( &n ), sizeof( n ) );
+        stream.write( reinterpret_cast<char const *>( data ),
+                      size * sizeof( T ) );
+    }
 
-        typename View::non_const_type buffer_values( values.label() );
+    template <typename T>
+    static std::vector<T> readArray( std::istream &stream )
+    {
+        std::uint64_t n = 0;
+        stream.read( reinterpret_cast<char *>( &n ), sizeof( n ) );
+        DTK_INSIST( stream.good() );
+        std::vector<T> data( n );
+        stream.read( reinterpret_cast<char *>( data.data() ), n * sizeof( T ) );
+        DTK_INSIST( stream.good() );
+        return data;
+    }
 
-        pullSourceValues( comm, values, buffer_indices, buffer_ranks,
-                          buffer_values );
+    template <typename T>
+    static void writeView( std::ostream &stream,
+                           Kokkos::View<T *, DeviceType> view )
+    {
+        auto view_host = Kokkos::create_mirror_view( view );
+        Kokkos::deep_copy( view_host, view );
+        writeArray( stream, view_host.data(), view_host.extent( 0 ) );
+    }
 
-        typename View::non_const_type values_out(
-            values.label(), ranks.extent( 0 ), values.extent( 1 ) );
+    template <typename T>
+    static Kokkos::View<T *, DeviceType> readView( std::istream &stream,
+                                                   std::string const &label )
+    {
+        auto data = readArray<T>( stream );
+        Kokkos::View<T *, DeviceType> view(
+            Kokkos::ViewAllocateWithoutInitializing( label ), data.size() );
+        Kokkos::deep_copy(
+            view, Kokkos::View<T *, Kokkos::HostSpace,
+                               Kokkos::MemoryUnmanaged>( data.data(),
+                                                         data.size() ) );
+        return view;
+    }
 
-        pushTargetValues( comm, buffer_indices, buffer_ranks, buffer_values,
-                          values_out );
+    // Write the communication plan to a binary stream.  Only the local part
+    // of the plan is written, i.e. each process writes its own stream.
+    static void saveFetchPlan( std::ostream &stream, FetchPlan const &plan )
+    {
+        // The ranks involved are recovered from the distributor.
+        auto const destination_ranks = getDestinationRanks( plan );
+        auto const source_ranks = getSourceRanks( plan );
 
-        DTK_ENSURE( ( values_out.extent( 0 ) == ranks.extent( 0 ) ) &&
-                    ( values_out.extent( 1 ) == values.extent( 1 ) ) );
+        writeArray( stream, destination_ranks.data(),
+                    destination_ranks.size() );
+        writeArray( stream, source_ranks.data(), source_ranks.size() );
+        writeView( stream, plan.export_indices );
+        writeView( stream, plan.import_indices );
+    }
 
-        return values_out;
+    // Read a communication plan written by saveFetchPlan().  Since both the
+    // destination and the source ranks are known, this is not a collective.
+    static FetchPlan
+    loadFetchPlan( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                   std::istream &stream )
+    {
+        auto const destination_ranks = readArray<int>( stream );
+        auto const source_ranks = readArray<int>( stream );
+
+        FetchPlan plan;
+        plan.distributor = Teuchos::rcp( new Distributor( comm ) );
+        int const n_imports = plan.distributor->createFromSendsAndRecvs(
+            Teuchos::ArrayView<int const>( destination_ranks.data(),
+                                           destination_ranks.size() ),
+            Teuchos::ArrayView<int const>( source_ranks.data(),
+                                           source_ranks.size() ) );
+        plan.export_indices = readView<int>( stream, "source_indices" );
+        plan.import_indices = readView<int>( stream, "target_indices" );
+        DTK_INSIST( plan.export_indices.extent_int( 0 ) ==
+                    static_cast<int>( destination_ranks.size() ) );
+        DTK_INSIST( plan.import_indices.extent_int( 0 ) == n_imports );
+
+        return plan;
     }
 };
 
+// Move the values of several fetch plans with a single round of messages
+// instead of one per plan, e.g. to apply several operators at once.  The
+// ranks of both sides are known from the plans so no collective is needed
+// to set up the exchange, and they come grouped by rank from the
+// distributors of the plans so nothing is counted or sorted.  The plans must
+// have been built over the same communicator.
+inline void
+exchangeCombined( Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+                  std::vector<CombinedExchangePart> &parts )
+{
+    ScopedTimer timer( "communication" );
+
+    int const comm_size = comm->getSize();
+    size_t const n_parts = parts.size();
+
+    // Every value is a packet of its own so that the parts may have
+    // different numbers of components.  The segments of the parts add up to
+    // those of the combined plan.
+    std::vector<size_t> send_lengths( comm_size, 0 );
+    std::vector<size_t> receive_lengths( comm_size, 0 );
+    for ( auto const &part : parts )
+    {
+        DTK_REQUIRE( part.destination_procs.size() ==
+                     part.destination_lengths.size() );
+        DTK_REQUIRE( part.source_procs.size() == part.source_lengths.size() );
+        size_t n_exports = 0;
+        for ( size_t i = 0; i < part.destination_procs.size(); ++i )
+        {
+            send_lengths[part.destination_procs[i]] +=
+                part.destination_lengths[i] * part.n_components;
+            n_exports += part.destination_lengths[i];
+        }
+        DTK_REQUIRE( part.exports.size() == n_exports * part.n_components );
+        for ( size_t i = 0; i < part.source_procs.size(); ++i )
+            receive_lengths[part.source_procs[i]] +=
+                part.source_lengths[i] * part.n_components;
+    }
+    std::vector<int> procs_to;
+    std::vector<size_t> lengths_to;
+    std::vector<int> procs_from;
+    std::vector<size_t> lengths_from;
+    for ( int rank = 0; rank < comm_size; ++rank )
+    {
+        if ( send_lengths[rank] > 0 )
+        {
+            procs_to.push_back( rank );
+            lengths_to.push_back( send_lengths[rank] );
+        }
+        if ( receive_lengths[rank] > 0 )
+        {
+            procs_from.push_back( rank );
+            lengths_from.push_back( receive_lengths[rank] );
+        }
+    }
+
+    Distributor distributor( comm );
+    size_t const n_imports = distributor.createFromLengths(
+        Teuchos::ArrayView<int const>( procs_to.data(), procs_to.size() ),
+        Teuchos::ArrayView<size_t const>( lengths_to.data(),
+                                          lengths_to.size() ),
+        Teuchos::ArrayView<int const>( procs_from.data(), procs_from.size() ),
+        Teuchos::ArrayView<size_t const>( lengths_from.data(),
+                                          lengths_from.size() ) );
+
+    // The message to a process holds the values of the parts that go there
+    // one part after the other.  The segments of each part are visited in
+    // order so the values of a part are read and written contiguously.
+    std::vector<size_t> segments( n_parts, 0 );
+    std::vector<size_t> offsets( n_parts, 0 );
+    std::vector<double> exports;
+    exports.reserve( distributor.getTotalSendLength() );
+    for ( int rank : procs_to )
+        for ( size_t k = 0; k < n_parts; ++k )
+        {
+            auto const &part = parts[k];
+            size_t &segment = segments[k];
+            if ( segment == part.destination_procs.size() ||
+                 part.destination_procs[segment] != rank )
+                continue;
+            size_t const count =
+                part.destination_lengths[segment] * part.n_components;
+            exports.insert( exports.end(),
+                            part.exports.begin() + offsets[k],
+                            part.exports.begin() + offsets[k] + count );
+            offsets[k] += count;
+            ++segment;
+        }
+    std::vector<double> imports( n_imports );
+    distributor.doPostsAndWaits( exports.data(), 1, imports.data() );
+
+    // The values of a part received from a process are in the order of the
+    // imports of its plan since both are laid out by increasing rank of
+    // their origin.
+    std::fill( segments.begin(), segments.end(), 0 );
+    std::fill( offsets.begin(), offsets.end(), 0 );
+    for ( auto &part : parts )
+        part.imports.resize(
+            std::accumulate( part.source_lengths.begin(),
+                             part.source_lengths.end(), size_t( 0 ) ) *
+            part.n_components );
+    size_t offset = 0;
+    for ( int rank : procs_from )
+        for ( size_t k = 0; k < n_parts; ++k )
+        {
+            auto &part = parts[k];
+            size_t &segment = segments[k];
+            if ( segment == part.source_procs.size() ||
+                 part.source_procs[segment] != rank )
+                continue;
+            size_t const count =
+                part.source_lengths[segment] * part.n_components;
+            std::copy( imports.begin() + offset,
+                       imports.begin() + offset + count,
+                       part.imports.begin() + offsets[k] );
+            offset += count;
+            offsets[k] += count;
+            ++segment;
+        }
+    DTK_ENSURE( offset == n_imports );
+}
+
 } // namespace Details
 } // namespace DataTransferKit
 
@@ -0,0 +1,461 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_PARTITION_OF_UNITY_OPERATOR_IMPL_HPP
+#define DTK_DETAILS_PARTITION_OF_UNITY_OPERATOR_IMPL_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp> // distance
+#include <DTK_DetailsCholeskyImpl.hpp>
+#include <DTK_DetailsPointCloudHelpers.hpp>
+#include <DTK_DetailsUtils.hpp> // exclusivePrefixSum, lastElement, minMax
+#include <DTK_KokkosHelpers.hpp>
+#include <DTK_Point.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Kokkos_Array.hpp>
+#include <Kokkos_Core.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+template <typename DeviceType>
+struct PartitionOfUnityOperatorImpl
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    // Regular grid of patch centers.  The cells are numbered with the first
+    // dimension running fastest.  Missing dimensions have a single center.
+    struct PatchGrid
+    {
+        Kokkos::Array<double, 3> origin;
+        Kokkos::Array<int, 3> n_centers;
+        double spacing;
+    };
+
+    // Lay out the patch centers over the bounding box of the target points.
+    // Every point of the box is within spacing * sqrt(DIM) / 2 of a center.
+    template <int DIM>
+    static PatchGrid makePatchGrid(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        double spacing )
+    {
+        DTK_REQUIRE( spacing > 0. );
+        PatchGrid grid;
+        grid.spacing = spacing;
+        for ( int d = 0; d < 3; ++d )
+        {
+            grid.origin[d] = 0.;
+            grid.n_centers[d] = 1;
+        }
+        if ( target_points.extent( 0 ) == 0 )
+        {
+            grid.n_centers[0] = 0;
+            return grid;
+        }
+
+        long n_cells = 1;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            auto const bounds =
+                minMax( Kokkos::subview( target_points, Kokkos::ALL, d ) );
+            grid.origin[d] = bounds.first;
+            grid.n_centers[d] =
+                static_cast<int>(
+                    std::ceil( ( bounds.second - bounds.first ) / spacing ) ) +
+                1;
+            n_cells *= grid.n_centers[d];
+        }
+        DTK_INSIST( n_cells <= std::numeric_limits<int>::max() );
+
+        return grid;
+    }
+
+    // Call f( cell, distance ) for every patch whose center is closer than
+    // radius to the point x.
+    template <int DIM, typename Functor>
+    KOKKOS_INLINE_FUNCTION static void
+    forEachCoveringPatch( PatchGrid const &grid, double radius, Point const &x,
+                          Functor const &f )
+    {
+        int lo[3] = {0, 0, 0};
+        int hi[3] = {0, 0, 0};
+        for ( int d = 0; d < DIM; ++d )
+        {
+            lo[d] = KokkosHelpers::max(
+                0, static_cast<int>( std::ceil(
+                       ( x[d] - grid.origin[d] - radius ) / grid.spacing ) ) );
+            hi[d] = KokkosHelpers::min(
+                grid.n_centers[d] - 1,
+                static_cast<int>( std::floor(
+                    ( x[d] - grid.origin[d] + radius ) / grid.spacing ) ) );
+        }
+        for ( int k = lo[2]; k <= hi[2]; ++k )
+            for ( int j = lo[1]; j <= hi[1]; ++j )
+                for ( int i = lo[0]; i <= hi[0]; ++i )
+                {
+                    int const index[3] = {i, j, k};
+                    double distance_squared = 0.;
+                    for ( int d = 0; d < DIM; ++d )
+                    {
+                        double const delta =
+                            x[d] - grid.origin[d] - index[d] * grid.spacing;
+                        distance_squared += delta * delta;
+                    }
+                    int const cell =
+                        i + grid.n_centers[0] * ( j + grid.n_centers[1] * k );
+                    if ( distance_squared < radius * radius )
+                        f( cell, std::sqrt( distance_squared ) );
+                }
+    }
+
+    // For each target point, list the patches that cover it, i.e. the pairs
+    // (target point, patch), and the distance to the centers of the patches.
+    // The patches are identified by their cell in the grid.
+    template <int DIM>
+    static void findCoveringPatches(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        PatchGrid const &grid, double patch_radius,
+        Kokkos::View<int *, DeviceType> &pair_offset,
+        Kokkos::View<int *, DeviceType> &pair_patches,
+        Kokkos::View<double *, DeviceType> &pair_distances )
+    {
+        auto const n_target_points = target_points.extent_int( 0 );
+        pair_offset = Kokkos::View<int *, DeviceType>( "pair_offset",
+                                                       n_target_points + 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "count_covering_patches" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                int count = 0;
+                forEachCoveringPatch<DIM>(
+                    grid, patch_radius, makePoint<DIM>( target_points, i ),
+                    [&]( int, double ) { ++count; } );
+                pair_offset( i ) = count;
+            } );
+        Kokkos::fence();
+        int const n_pairs = exclusivePrefixSum( pair_offset );
+
+        pair_patches = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "pair_patches" ),
+            n_pairs );
+        pair_distances = Kokkos::View<double *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "pair_distances" ),
+            n_pairs );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "find_covering_patches" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                int p = pair_offset( i );
+                forEachCoveringPatch<DIM>(
+                    grid, patch_radius, makePoint<DIM>( target_points, i ),
+                    [&]( int cell, double distance ) {
+                        pair_patches( p ) = cell;
+                        pair_distances( p ) = distance;
+                        ++p;
+                    } );
+            } );
+        Kokkos::fence();
+    }
+
+    // Number the patches that cover at least one target point contiguously,
+    // replace the cells in pair_patches with these numbers, and return the
+    // centers of the patches.
+    template <int DIM>
+    static Kokkos::View<Coordinate **, DeviceType>
+    compactPatches( PatchGrid const &grid,
+                    Kokkos::View<int *, DeviceType> pair_patches )
+    {
+        int const n_cells =
+            grid.n_centers[0] * grid.n_centers[1] * grid.n_centers[2];
+        auto const n_pairs = pair_patches.extent_int( 0 );
+
+        // NOTE: Concurrent writes store the same value.
+        Kokkos::View<int *, DeviceType> patch_index( "patch_index",
+                                                     n_cells + 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "mark_covering_patches" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_pairs ),
+            KOKKOS_LAMBDA( int p ) { patch_index( pair_patches( p ) ) = 1; } );
+        Kokkos::fence();
+        int const n_patches = exclusivePrefixSum( patch_index );
+
+        Kokkos::View<Coordinate **, DeviceType> patch_centers(
+            Kokkos::ViewAllocateWithoutInitializing( "patch_centers" ),
+            n_patches, DIM );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_patch_centers" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_cells ),
+            KOKKOS_LAMBDA( int cell ) {
+                int const m = patch_index( cell );
+                if ( patch_index( cell + 1 ) == m )
+                    return;
+                int const index[3] = {
+                    cell % grid.n_centers[0],
+                    ( cell / grid.n_centers[0] ) % grid.n_centers[1],
+                    cell / ( grid.n_centers[0] * grid.n_centers[1] )};
+                for ( int d = 0; d < DIM; ++d )
+                    patch_centers( m, d ) =
+                        grid.origin[d] + index[d] * grid.spacing;
+            } );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "number_covering_patches" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_pairs ),
+            KOKKOS_LAMBDA( int p ) {
+                pair_patches( p ) = patch_index( pair_patches( p ) );
+            } );
+        Kokkos::fence();
+
+        return patch_centers;
+    }
+
+    // The radial basis functions do not vanish outside of their support so
+    // they are clamped here.
+    template <typename RBF>
+    KOKKOS_INLINE_FUNCTION static double evaluate( RBF const &rbf,
+                                                   double distance,
+                                                   double radius )
+    {
+        return distance < radius ? rbf( distance / radius ) : 0.;
+    }
+
+    // Build the rows of the operator.  The interpolation matrix of each patch
+    // (the radial basis function evaluated between all pairs of source points
+    // in the patch) is factorized with a batched Cholesky.  For each target
+    // point x, the interpolant of every covering patch that contains source
+    // points is expressed in terms of the values at these points, A^{-1}
+    // phi(x), and weighted by the partition of unity.  The entries of row i
+    // are in [offset(i), offset(i+1)) and the columns are positions in the
+    // source values fetched for all the patches.
+    template <int DIM, typename RBF>
+    static void computeCoefficients(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Kokkos::View<Coordinate const **, DeviceType> patch_points,
+        Kokkos::View<int const *, DeviceType> patch_offset,
+        Kokkos::View<int const *, DeviceType> pair_offset,
+        Kokkos::View<int const *, DeviceType> pair_patches,
+        Kokkos::View<double const *, DeviceType> pair_distances,
+        double patch_radius, double support_radius, RBF const &rbf,
+        Kokkos::View<int *, DeviceType> &offset,
+        Kokkos::View<int *, DeviceType> &columns,
+        Kokkos::View<double *, DeviceType> &coeffs )
+    {
+        // NOTE: This includes the factorization of the interpolation matrices.
+        ScopedTimer timer( "coefficients" );
+
+        auto const n_target_points = target_points.extent_int( 0 );
+        auto const n_patches = patch_offset.extent_int( 0 ) - 1;
+        auto const n_pairs = pair_patches.extent_int( 0 );
+        DTK_REQUIRE( pair_offset.extent_int( 0 ) == n_target_points + 1 );
+        DTK_REQUIRE( pair_distances.extent_int( 0 ) == n_pairs );
+
+        // Assemble the interpolation matrices one after the other.
+        Kokkos::View<int *, DeviceType> matrix_offset( "matrix_offset",
+                                                       n_patches + 1 );
+        int max_n_points = 0;
+        Kokkos::Experimental::Max<int> reducer( max_n_points );
+        Kokkos::parallel_reduce(
+            DTK_MARK_REGION( "size_patch_matrices" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_patches ),
+            KOKKOS_LAMBDA( int m, int &update ) {
+                int const n = patch_offset( m + 1 ) - patch_offset( m );
+                matrix_offset( m ) = n * n;
+                if ( n > update )
+                    update = n;
+            },
+            reducer );
+        exclusivePrefixSum( matrix_offset );
+        Kokkos::View<double *, DeviceType> matrices(
+            Kokkos::ViewAllocateWithoutInitializing( "patch_matrices" ),
+            lastElement( matrix_offset ) );
+
+        using Cholesky = CholeskyFunctor<DeviceType>;
+        using TeamPolicy = Kokkos::TeamPolicy<ExecutionSpace>;
+        int const team_size = Cholesky::teamSize( max_n_points );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "fill_patch_matrices" ),
+            TeamPolicy( n_patches, team_size ),
+            KOKKOS_LAMBDA( typename TeamPolicy::member_type const &thread ) {
+                int const m = thread.league_rank();
+                int const first = patch_offset( m );
+                int const n = patch_offset( m + 1 ) - first;
+                int const shift = matrix_offset( m );
+                Kokkos::parallel_for(
+                    Kokkos::TeamThreadRange( thread, n ), [&]( int i ) {
+                        Point const x_i =
+                            makePoint<DIM>( patch_points, first + i );
+                        for ( int j = 0; j < n; ++j )
+                        {
+                            Point const x_j =
+                                makePoint<DIM>( patch_points, first + j );
+                            matrices( shift + i * n + j ) = evaluate(
+                                rbf, distance( x_i, x_j ), support_radius );
+                        }
+                    } );
+            } );
+        Kokkos::fence();
+
+        size_t n_failed = 0;
+        Kokkos::parallel_reduce(
+            DTK_MARK_REGION( "factorize_patch_matrices" ),
+            TeamPolicy( n_patches, team_size ),
+            Cholesky( patch_offset, matrix_offset, matrices ), n_failed );
+        if ( n_failed > 0 )
+            throw DataTransferKitException(
+                "The interpolation matrices of " + std::to_string( n_failed ) +
+                " patches are not positive definite" );
+
+        // Each pair contributes one entry per source point in its patch.
+        Kokkos::View<int *, DeviceType> pair_first( "pair_first", n_pairs + 1 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "size_pairs" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_pairs ),
+            KOKKOS_LAMBDA( int p ) {
+                int const m = pair_patches( p );
+                pair_first( p ) = patch_offset( m + 1 ) - patch_offset( m );
+            } );
+        Kokkos::fence();
+        int const n_entries = exclusivePrefixSum( pair_first );
+
+        offset = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "offset" ),
+            n_target_points + 1 );
+        columns = Kokkos::View<int *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "columns" ), n_entries );
+        coeffs = Kokkos::View<double *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "pum_coefficients" ),
+            n_entries );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_offset" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points + 1 ),
+            KOKKOS_LAMBDA( int i ) {
+                offset( i ) = pair_first( pair_offset( i ) );
+            } );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_pum_coeffs" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( int i ) {
+                Point const x = makePoint<DIM>( target_points, i );
+
+                // Patches without source points do not take part in the
+                // partition of unity.
+                double sum_weights = 0.;
+                for ( int p = pair_offset( i ); p < pair_offset( i + 1 ); ++p )
+                    if ( pair_first( p + 1 ) > pair_first( p ) )
+                        sum_weights +=
+                            evaluate( rbf, pair_distances( p ), patch_radius );
+
+                for ( int p = pair_offset( i ); p < pair_offset( i + 1 ); ++p )
+                {
+                    int const m = pair_patches( p );
+                    int const first = patch_offset( m );
+                    int const n = patch_offset( m + 1 ) - first;
+                    int const e = pair_first( p );
+                    if ( n == 0 )
+                        continue;
+                    double const weight =
+                        evaluate( rbf, pair_distances( p ), patch_radius ) /
+                        sum_weights;
+
+                    for ( int j = 0; j < n; ++j )
+                    {
+                        Point const x_j =
+                            makePoint<DIM>( patch_points, first + j );
+                        columns( e + j ) = first + j;
+                        coeffs( e + j ) =
+                            evaluate( rbf, distance( x, x_j ), support_radius );
+                    }
+                    auto const l = Kokkos::subview(
+                        matrices,
+                        Kokkos::make_pair( matrix_offset( m ),
+                                           matrix_offset( m ) + n * n ) );
+                    auto b = Kokkos::subview( coeffs,
+                                              Kokkos::make_pair( e, e + n ) );
+                    Cholesky::solve( l, n, b );
+                    for ( int j = 0; j < n; ++j )
+                        coeffs( e + j ) *= weight;
+                }
+            } );
+        Kokkos::fence();
+    }
+
+    static Kokkos::View<double *, DeviceType> computeTargetValues(
+        Kokkos::View<int const *, DeviceType> offset,
+        Kokkos::View<int const *, DeviceType> columns,
+        Kokkos::View<double const *, DeviceType> coeffs,
+        Kokkos::View<double const *, DeviceType> source_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        Kokkos::View<double *, DeviceType> target_values(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "target_" ) + source_values.label() ),
+            n_target_points );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                target_values( i ) = 0.;
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    target_values( i ) +=
+                        coeffs( j ) * source_values( columns( j ) );
+            } );
+        Kokkos::fence();
+
+        return target_values;
+    }
+
+    static Kokkos::View<double **, DeviceType> computeTargetValues(
+        Kokkos::View<int const *, DeviceType> offset,
+        Kokkos::View<int const *, DeviceType> columns,
+        Kokkos::View<double const *, DeviceType> coeffs,
+        Kokkos::View<double const **, DeviceType> source_values )
+    {
+        ScopedTimer timer( "interpolation" );
+
+        auto const n_target_points = offset.extent_int( 0 ) - 1;
+        auto const n_components = source_values.extent_int( 1 );
+        Kokkos::View<double **, DeviceType> target_values(
+            Kokkos::ViewAllocateWithoutInitializing(
+                std::string( "target_" ) + source_values.label() ),
+            n_target_points, n_components );
+
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "compute_values" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_target_points ),
+            KOKKOS_LAMBDA( const int i ) {
+                for ( int k = 0; k < n_components; ++k )
+                    target_values( i, k ) = 0.;
+                for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                    for ( int k = 0; k < n_components; ++k )
+                        target_values( i, k ) +=
+                            coeffs( j ) * source_values( columns( j ), k );
+            } );
+        Kokkos::fence();
+
+        return target_values;
+    }
+};
+
+} // end namespace Details
+} // end namespace DataTransferKit
+
+#endif
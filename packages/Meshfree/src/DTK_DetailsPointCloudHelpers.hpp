@@ -0,0 +1,43 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_POINT_CLOUD_HELPERS_HPP
+#define DTK_DETAILS_POINT_CLOUD_HELPERS_HPP
+
+#include <DTK_Point.hpp>
+
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+// Return the i-th point of a point cloud stored in a (n_points, DIM) view.
+// The search only deals with three-dimensional geometry so points in lower
+// dimension are embedded in 3D space with zeros for the missing coordinates.
+// Having the dimension known at compile time lets the compiler unroll the
+// loop and avoids reading coordinates that do not exist.
+template <int DIM, typename View>
+KOKKOS_INLINE_FUNCTION Point makePoint( View const &points, int i )
+{
+    static_assert( DIM >= 1 && DIM <= 3,
+                   "Point clouds must be one, two, or three dimensional" );
+    Point p = {{0., 0., 0.}};
+    for ( int d = 0; d < DIM; ++d )
+        p[d] = points( i, d );
+    return p;
+}
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
@@ -18,6 +18,8 @@
 #include <Kokkos_Core.hpp>
 
 #include <cmath>
+#include <type_traits>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -27,8 +29,12 @@ namespace Details
 // The original version of this functor was taken from Trilinos mini-tensor
 // package. It was adapted to work in a batched mode where matrices are given
 // in a flat 1D array. It also explicitly solves 2x2 singular-value
-// decomposition (svd) problems.
-template <typename DeviceType>
+// decomposition (svd) problems. Each matrix is handled by a team of threads
+// that cooperate on the Jacobi sweeps: the Givens rotations are applied to the
+// rows and columns in parallel.  The decomposition is carried out in the
+// precision given by Scalar while the matrices and their pseudo-inverses are
+// always stored in double precision.
+template <typename DeviceType, typename Scalar = double>
 struct SVDFunctor
 {
   public:
@@ -39,46 +45,100 @@ struct SVDFunctor
     // sized matrices, or using some batching.
     using matrices_type = Kokkos::View<double *, DeviceType>;
     using shared_matrix =
+        Kokkos::View<Scalar **, typename ExecutionSpace::scratch_memory_space,
+                     Kokkos::MemoryUnmanaged>;
+    using shared_vector =
+        Kokkos::View<Scalar *, typename ExecutionSpace::scratch_memory_space,
+                     Kokkos::MemoryUnmanaged>;
+    using shared_double_matrix =
         Kokkos::View<double **, typename ExecutionSpace::scratch_memory_space,
                      Kokkos::MemoryUnmanaged>;
-    using matrix_2x2_type = Kokkos::Array<Kokkos::Array<double, 2>, 2>;
+    using shared_index_vector =
+        Kokkos::View<int *, typename ExecutionSpace::scratch_memory_space,
+                     Kokkos::MemoryUnmanaged>;
+    using matrix_2x2_type = Kokkos::Array<Kokkos::Array<Scalar, 2>, 2>;
+    using team_member =
+        typename Kokkos::TeamPolicy<ExecutionSpace>::member_type;
 
   public:
+    // Only the first n_rows rows of the pseudo-inverses are computed and
+    // stored in pseudoAs, i.e. each of them is of size n_rows x n.  This is
+    // cheaper when the caller is not interested in the whole pseudo-inverse.
     SVDFunctor( int n, typename matrices_type::const_type As,
-                matrices_type pseudoAs )
+                matrices_type pseudoAs, int n_rows )
         : _n( n )
+        , _n_rows( n_rows )
         , _As( As )
         , _pseudoAs( pseudoAs )
     {
     }
 
+    SVDFunctor( int n, typename matrices_type::const_type As,
+                matrices_type pseudoAs )
+        : SVDFunctor( n, As, pseudoAs, n )
+    {
+    }
+
+    // Number of threads per team.  The matrices are small (e.g. 10x10 for a
+    // quadratic basis in 3D) so there is no point in having more threads than
+    // rows.  On the host, a single thread per team performs better.
+    static int teamSize( int n )
+    {
+#if defined( KOKKOS_ENABLE_CUDA )
+        if ( std::is_same<ExecutionSpace, Kokkos::Cuda>::value )
+            return KokkosHelpers::min( n, 32 );
+#endif
+        (void)n;
+        return 1;
+    }
+
+    // Team sizes that are tried when the team size is tuned, the default one
+    // first.  Smaller teams leave fewer threads idle on small matrices but
+    // hold more matrices in the scratch memory of a block, which one pays off
+    // depends on the device.
+    static std::vector<int> teamSizeCandidates( int n )
+    {
+        std::vector<int> candidates = {teamSize( n )};
+#if defined( KOKKOS_ENABLE_CUDA )
+        if ( std::is_same<ExecutionSpace, Kokkos::Cuda>::value )
+            for ( int team_size : {16, 8, 4} )
+                if ( team_size < candidates.front() )
+                    candidates.push_back( team_size );
+#endif
+        return candidates;
+    }
+
+    // NOTE: The Givens rotations below are distributed over the threads of
+    // the team.  It is the responsibility of the caller to synchronize the
+    // team before the updated matrix is used.
     KOKKOS_INLINE_FUNCTION
-    void givens_left( shared_matrix &A, double c, double s, int i, int k ) const
+    void givens_left( team_member const &thread, shared_matrix &A, Scalar c,
+                      Scalar s, int i, int k ) const
     {
         auto n = A.extent_int( 0 );
 
-        for ( int j = 0; j < n; j++ )
-        {
-            auto aij = A( i, j );
-            auto akj = A( k, j );
-            A( i, j ) = c * aij - s * akj;
-            A( k, j ) = s * aij + c * akj;
-        }
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int j ) {
+                                  auto aij = A( i, j );
+                                  auto akj = A( k, j );
+                                  A( i, j ) = c * aij - s * akj;
+                                  A( k, j ) = s * aij + c * akj;
+                              } );
     }
 
     KOKKOS_INLINE_FUNCTION
-    void givens_right( shared_matrix &A, double c, double s, int i,
-                       int k ) const
+    void givens_right( team_member const &thread, shared_matrix &A, Scalar c,
+                       Scalar s, int i, int k ) const
     {
         auto n = A.extent_int( 0 );
 
-        for ( int j = 0; j < n; ++j )
-        {
-            auto aji = A( j, i );
-            auto ajk = A( j, k );
-            A( j, i ) = c * aji - s * ajk;
-            A( j, k ) = s * aji + c * ajk;
-        }
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int j ) {
+                                  auto aji = A( j, i );
+                                  auto ajk = A( j, k );
+                                  A( j, i ) = c * aji - s * ajk;
+                                  A( j, k ) = s * aji + c * ajk;
+                              } );
     }
 
     KOKKOS_INLINE_FUNCTION
@@ -117,25 +177,28 @@ struct SVDFunctor
         mult_2x2( At, A, AtA );
 
         // Find U such that U*A*A’*U’ = diag
-        auto phi = 0.5 * atan2( AAt[0][1] + AAt[1][0], AAt[0][0] - AAt[1][1] );
-        auto cphi = cos( phi );
-        auto sphi = sin( phi );
+        Scalar const phi =
+            0.5 * atan2( AAt[0][1] + AAt[1][0], AAt[0][0] - AAt[1][1] );
+        Scalar const cphi = cos( phi );
+        Scalar const sphi = sin( phi );
 
         U = {{{{cphi, -sphi}}, {{sphi, cphi}}}};
 
         // Find W such that W’*A’*A*W = diag
-        auto theta =
+        Scalar const theta =
             0.5 * atan2( AtA[0][1] + AtA[1][0], AtA[0][0] - AtA[1][1] );
-        auto ctheta = cos( theta );
-        auto stheta = sin( theta );
+        Scalar const ctheta = cos( theta );
+        Scalar const stheta = sin( theta );
         matrix_2x2_type W = {{{{ctheta, -stheta}}, {{stheta, ctheta}}}};
 
         // Find the singular values from U
-        auto sum = AAt[0][0] + AAt[1][1];
-        auto dif = sqrt( ( AAt[0][0] - AAt[1][1] ) * ( AAt[0][0] - AAt[1][1] ) +
-                         4 * AAt[0][1] * AAt[1][0] );
-        E = {{{{sqrt( 0.5 * ( sum + dif ) ), 0.}},
-              {{0., sqrt( 0.5 * ( sum - dif ) )}}}};
+        Scalar const sum = AAt[0][0] + AAt[1][1];
+        Scalar const dif =
+            sqrt( ( AAt[0][0] - AAt[1][1] ) * ( AAt[0][0] - AAt[1][1] ) +
+                  4 * AAt[0][1] * AAt[1][0] );
+        Scalar const e0 = sqrt( 0.5 * ( sum + dif ) );
+        Scalar const e1 = sqrt( 0.5 * ( sum - dif ) );
+        E = {{{{e0, 0}}, {{0, e1}}}};
 
         // Find the correction matrix for the right side (S = U'*A*W)
         matrix_2x2_type Ut, AW, S;
@@ -146,63 +209,81 @@ struct SVDFunctor
         // We need copysign here to work with singular systems. Using the
         // regular sgn will produce a singular C which would lead to singular
         // V.
-        matrix_2x2_type C = {{{{std::copysign( 1., S[0][0] ), 0.0}},
-                              {{0.0, std::copysign( 1., S[1][1] )}}}};
+        Scalar const c0 = std::copysign( Scalar( 1 ), S[0][0] );
+        Scalar const c1 = std::copysign( Scalar( 1 ), S[1][1] );
+        matrix_2x2_type C = {{{{c0, 0}}, {{0, c1}}}};
 
         mult_2x2( W, C, V );
     }
 
+    // Each thread of the team looks for the largest entry on some of the
+    // rows and then every thread scans the row maxima so that they all end up
+    // with the same p and q.
     KOKKOS_INLINE_FUNCTION
-    void argmax_off_diagonal( typename shared_matrix::const_type A, int &p,
+    void argmax_off_diagonal( team_member const &thread,
+                              typename shared_matrix::const_type A,
+                              shared_vector row_max,
+                              shared_index_vector row_argmax, int &p,
                               int &q ) const
     {
         const auto n = A.extent_int( 0 );
 
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int i ) {
+                                  Scalar max = -1;
+                                  int arg = -1;
+                                  for ( int j = 0; j < n; j++ )
+                                      if ( i != j &&
+                                           std::abs( A( i, j ) ) > max )
+                                      {
+                                          arg = j;
+                                          max = std::abs( A( i, j ) );
+                                      }
+                                  row_max( i ) = max;
+                                  row_argmax( i ) = arg;
+                              } );
+        thread.team_barrier();
+
         p = -1;
         q = -1;
-        double max = -1;
+        Scalar max = -1;
 
         for ( int i = 0; i < n; i++ )
-            for ( int j = 0; j < n; j++ )
-                if ( i != j && std::abs( A( i, j ) ) > max )
-                {
-                    p = i;
-                    q = j;
-                    max = std::abs( A( i, j ) );
-                }
+            if ( row_max( i ) > max )
+            {
+                p = i;
+                q = row_argmax( i );
+                max = row_max( i );
+            }
     }
 
+    // The result of the reduction is available to all threads of the team.
     KOKKOS_INLINE_FUNCTION
-    double norm_F_wo_diag( typename shared_matrix::const_type A ) const
+    double norm_F_wo_diag( team_member const &thread,
+                           typename shared_matrix::const_type A ) const
     {
         const auto n = A.extent_int( 0 );
 
         double norm = 0.0;
-        for ( int i = 0; i < n; i++ )
-            for ( int j = 0; j < n; j++ )
-                norm += ( ( i != j ) ? A( i, j ) * A( i, j ) : 0 );
+        Kokkos::parallel_reduce(
+            Kokkos::TeamThreadRange( thread, n ),
+            [&]( int i, double &partial_norm ) {
+                for ( int j = 0; j < n; j++ )
+                    partial_norm += ( ( i != j ) ? A( i, j ) * A( i, j ) : 0 );
+            },
+            norm );
 
         return std::sqrt( norm );
     }
 
     KOKKOS_INLINE_FUNCTION
-    void operator()(
-        const typename Kokkos::TeamPolicy<ExecutionSpace>::member_type &thread,
-        size_t &num_underdetermined ) const
+    void operator()( team_member const &thread,
+                     size_t &num_underdetermined ) const
     {
-        // FIXME: The current version only works when team size is 1.
-        // We need to be able to create temporary views outside of stack. There
-        // are 3 ways to do that: multilevel parallelism with shared memory,
-        // allocation outside of parallel region, or experimental memory pool.
-        // First one seems to be the easiest. However, creating 3 matrices for
-        // each thread seems to require too much memory for GPU. Thus, we run
-        // this kernel only for a team_size = 1, which is equivalent to single
-        // level parallelism but allowing access to shared memory.
-        if ( thread.team_size() != 1 )
-            Kokkos::abort( "Team size must be 1" );
-
-        int matrix_id =
-            thread.league_rank() * thread.team_size() + thread.team_rank();
+        // Each team computes the decomposition of a single matrix.  The three
+        // matrices (E, U, V) are allocated in the team scratch memory and
+        // shared among the threads of the team.
+        int matrix_id = thread.league_rank();
 
         // TODO: This code (for getting A and pseudoA) can be updated later
         // to work with offsets so that we can solve for matrices of
@@ -216,36 +297,63 @@ struct SVDFunctor
         auto pseudoA = Kokkos::subview(
             _pseudoAs,
             Kokkos::make_pair(
-                static_cast<size_t>( matrix_id * _n * _n ),
-                static_cast<size_t>( ( matrix_id + 1 ) * _n * _n ) ) );
+                static_cast<size_t>( matrix_id * _n_rows * _n ),
+                static_cast<size_t>( ( matrix_id + 1 ) * _n_rows * _n ) ) );
 
         // Allocate (from scratch) and initialize.
-        // Right now, there is a single thread in a team, so we don't need to
-        // worry about sharing.
         shared_matrix E( thread.team_shmem(), _n, _n );
         shared_matrix U( thread.team_shmem(), _n, _n );
         shared_matrix V( thread.team_shmem(), _n, _n );
+        shared_vector row_max( thread.team_shmem(), _n );
+        shared_index_vector row_argmax( thread.team_shmem(), _n );
 
-        for ( int i = 0; i < _n; i++ )
-            for ( int j = 0; j < _n; j++ )
-            {
-                E( i, j ) = A( i * _n + j );
-            }
-        for ( int i = 0; i < _n; i++ )
-            for ( int j = 0; j < _n; j++ )
-            {
-                U( i, j ) = ( i == j ? 1.0 : 0.0 );
-                V( i, j ) = ( i == j ? 1.0 : 0.0 );
-            }
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, _n ),
+                              [&]( int i ) {
+                                  for ( int j = 0; j < _n; j++ )
+                                      E( i, j ) = A( i * _n + j );
+                              } );
+        thread.team_barrier();
 
-        auto norm = norm_F_wo_diag( E );
-        auto tol = Kokkos::ArithTraits<double>::epsilon();
+        decompose( thread, E, U, V, row_max, row_argmax );
 
+        size_t local_undetermined =
+            pseudoInverse( thread, E, U, V, pseudoA, _n_rows );
+
+        // The contributions of all threads are summed up so only one of them
+        // reports the matrix.
+        if ( thread.team_rank() == 0 )
+            num_underdetermined += local_undetermined;
+    }
+
+    // Compute the singular-value decomposition of the matrix stored in E with
+    // Jacobi sweeps.  On exit, E is diagonal and holds the singular values, U
+    // and V the singular vectors.  The sweeps stop when the Frobenius norm of
+    // the off-diagonal part of E falls below tol.  The team must be
+    // synchronized before calling this function.
+    KOKKOS_INLINE_FUNCTION
+    void decompose( team_member const &thread, shared_matrix E, shared_matrix U,
+                    shared_matrix V, shared_vector row_max,
+                    shared_index_vector row_argmax,
+                    double tol = Kokkos::ArithTraits<Scalar>::epsilon() ) const
+    {
+        auto const n = E.extent_int( 0 );
+
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int i ) {
+                                  for ( int j = 0; j < n; j++ )
+                                  {
+                                      U( i, j ) = ( i == j ? 1.0 : 0.0 );
+                                      V( i, j ) = ( i == j ? 1.0 : 0.0 );
+                                  }
+                              } );
+        thread.team_barrier();
+
+        auto norm = norm_F_wo_diag( thread, E );
         while ( norm > tol )
         {
             // Find largest off-diagonal entry
             int p, q;
-            argmax_off_diagonal( E, p, q );
+            argmax_off_diagonal( thread, E, row_max, row_argmax, p, q );
             assert( p != -1 && q != -1 );
             // TODO: it is unclear whether this permutation is necessary.
             if ( p > q )
@@ -270,55 +378,223 @@ struct SVDFunctor
                           ? -R[0][1]
                           : R[0][1];
 
+            // Make sure that all threads are done reading E before updating
+            // it.
+            thread.team_barrier();
+
             // Apply both Givens rotations to matrices that are converging to
-            // singular values and singular vectors
-            givens_left( E, cl, sl, p, q );
-            givens_right( E, cr, sr, p, q );
+            // singular values and singular vectors.  The left rotation of E
+            // and the updates of U and V are independent from each other but
+            // the right rotation of E must wait for the left one.
+            givens_left( thread, E, cl, sl, p, q );
+            givens_right( thread, U, cl, sl, p, q );
+            givens_left( thread, V, cr, sr, p, q );
+            thread.team_barrier();
+            givens_right( thread, E, cr, sr, p, q );
+            thread.team_barrier();
+
+            norm = norm_F_wo_diag( thread, E );
+        }
+    }
 
-            givens_right( U, cl, sl, p, q );
-            givens_left( V, cr, sr, p, q );
+    // Compute the first n_rows rows of the pseudo-inverse from the
+    // decomposition returned by decompose() and store them in pseudoA.
+    // Returns 1 if the matrix is rank deficient and 0 otherwise.
+    template <typename PseudoInverse>
+    KOKKOS_INLINE_FUNCTION size_t pseudoInverse(
+        team_member const &thread, typename shared_matrix::const_type E,
+        typename shared_matrix::const_type U,
+        typename shared_matrix::const_type V, PseudoInverse pseudoA,
+        int n_rows ) const
+    {
+        auto const n = E.extent_int( 0 );
+        Scalar const tol = Kokkos::ArithTraits<Scalar>::epsilon();
 
-            norm = norm_F_wo_diag( E );
-        }
+        // TODO: We use machine tolerance here to indicate that all diagonal
+        // values less than that are considered to be 0. It is unclear the
+        // numerical implications of such approach for matrices where singular
+        // values are small nonzeros.
+        size_t local_undetermined = 0;
+        for ( int k = 0; k < n; k++ )
+            if ( std::abs( E( k, k ) ) < tol )
+                local_undetermined = 1;
 
         // Compute pseudo-inverse (pseudoA = V pseudoE U^T)
         // NOTE: the V stored above is actually V^T, but we don't explicitly
         // transpose it. Instead, we modify the MxM loop below to do (pseudoA =
         // V^T pseudoE U^T)
-        size_t local_undetermined = 0;
-        for ( int i = 0; i < _n; i++ )
-            for ( int j = 0; j < _n; j++ )
-            {
+        // Only the requested rows are formed.
+        Kokkos::parallel_for(
+            Kokkos::TeamThreadRange( thread, n_rows * n ), [&]( int ij ) {
+                int const i = ij / n;
+                int const j = ij % n;
                 double value = 0;
-                for ( int k = 0; k < _n; k++ )
-                {
-                    // TODO: We use machine tolerance here to indicate that all
-                    // diagonal values less than that are considered to be 0. It
-                    // is unclear the numerical implications of such approach
-                    // for matrices where singular values are small nonzeros.
+                for ( int k = 0; k < n; k++ )
                     if ( std::abs( E( k, k ) ) >= tol )
                         value += V( k, i ) * U( j, k ) / E( k, k );
-                    else
-                        local_undetermined = 1;
-                }
-                pseudoA( i * _n + j ) = value;
+                pseudoA( i * n + j ) = value;
+            } );
+
+        return local_undetermined;
+    }
+
+    // Compute the first n_rows rows of the inverse of the symmetric matrix A,
+    // which is kept in double precision and left untouched, and store them in
+    // pseudoA.  A is scaled to a unit diagonal, S A S, and decomposed in the
+    // precision given by Scalar into E, U, and V.  The rows are then refined
+    // with residuals computed from A in double precision until they are
+    // accurate to double precision.  Returns false without writing pseudoA if
+    // S A S is too ill conditioned for the refinement to converge, in which
+    // case the caller must fall back to decompose() in double precision.  The
+    // work array must be of size 4 x n.  The team must be synchronized before
+    // calling this function.
+    template <typename PseudoInverse>
+    KOKKOS_INLINE_FUNCTION bool
+    refinedInverse( team_member const &thread,
+                    typename shared_double_matrix::const_type A,
+                    shared_matrix E, shared_matrix U, shared_matrix V,
+                    shared_vector row_max, shared_index_vector row_argmax,
+                    shared_double_matrix work, PseudoInverse pseudoA,
+                    int n_rows ) const
+    {
+        auto const n = A.extent_int( 0 );
+        auto scale = Kokkos::subview( work, 0, Kokkos::ALL() );
+        auto z = Kokkos::subview( work, 1, Kokkos::ALL() );
+        auto residual = Kokkos::subview( work, 2, Kokkos::ALL() );
+        auto w = Kokkos::subview( work, 3, Kokkos::ALL() );
+
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int j ) {
+                                  scale( j ) = ( A( j, j ) > 0. )
+                                                   ? 1. / std::sqrt( A( j, j ) )
+                                                   : 1.;
+                              } );
+        thread.team_barrier();
+        Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                              [&]( int j ) {
+                                  for ( int k = 0; k < n; ++k )
+                                      E( j, k ) =
+                                          scale( j ) * A( j, k ) * scale( k );
+                              } );
+        thread.team_barrier();
+
+        // The decomposition only needs to be accurate enough for the
+        // refinement to converge.  Each step of the refinement reduces the
+        // error by about epsilon times the condition number.
+        double const epsilon = Kokkos::ArithTraits<Scalar>::epsilon();
+        decompose( thread, E, U, V, row_max, row_argmax, 100. * n * epsilon );
+        if ( reciprocalConditionNumber( E ) < std::sqrt( epsilon ) )
+            return false;
+
+        double const double_epsilon = Kokkos::ArithTraits<double>::epsilon();
+        int const max_refinements = 10;
+        for ( int r = 0; r < n_rows; ++r )
+        {
+            // Solve S A S z = S e_r.  Since A is symmetric, S z is the r-th
+            // row of its inverse.
+            Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                                  [&]( int j ) {
+                                      z( j ) = 0.;
+                                      residual( j ) = ( j == r ) ? scale( r )
+                                                                 : 0.;
+                                  } );
+            thread.team_barrier();
+
+            for ( int refinement = 0; refinement < max_refinements;
+                  ++refinement )
+            {
+                // Apply the approximate inverse to the residual (see
+                // pseudoInverse() for the storage of V).
+                Kokkos::parallel_for( Kokkos::TeamThreadRange( thread, n ),
+                                      [&]( int k ) {
+                                          double tmp = 0.;
+                                          for ( int j = 0; j < n; ++j )
+                                              tmp += U( j, k ) * residual( j );
+                                          w( k ) = tmp / E( k, k );
+                                      } );
+                thread.team_barrier();
+                double correction = 0.;
+                Kokkos::parallel_reduce(
+                    Kokkos::TeamThreadRange( thread, n ),
+                    [&]( int i, double &update ) {
+                        double dz = 0.;
+                        for ( int k = 0; k < n; ++k )
+                            dz += V( k, i ) * w( k );
+                        z( i ) += dz;
+                        update += dz * dz;
+                    },
+                    correction );
+                thread.team_barrier();
+
+                // Update the residual in double precision.
+                double norm = 0.;
+                Kokkos::parallel_reduce(
+                    Kokkos::TeamThreadRange( thread, n ),
+                    [&]( int i, double &update ) {
+                        double tmp = ( i == r ) ? scale( r ) : 0.;
+                        for ( int k = 0; k < n; ++k )
+                            tmp -= scale( i ) * A( i, k ) * scale( k ) * z( k );
+                        residual( i ) = tmp;
+                        update += z( i ) * z( i );
+                    },
+                    norm );
+                thread.team_barrier();
+
+                if ( correction <= double_epsilon * double_epsilon * norm )
+                    break;
             }
-        // TODO: when the kernel is switched to multiple threads per team, this
-        // should be fixed. For example, could be an atomic update (as local
-        // counts are not shared).
-        num_underdetermined += local_undetermined;
+
+            Kokkos::parallel_for(
+                Kokkos::TeamThreadRange( thread, n ),
+                [&]( int j ) { pseudoA( r * n + j ) = scale( j ) * z( j ); } );
+            thread.team_barrier();
+        }
+
+        return true;
+    }
+
+    // Ratio of the smallest to the largest singular value in the
+    // decomposition returned by decompose(), i.e. the reciprocal of the
+    // condition number of the matrix.  It is zero for a rank deficient matrix.
+    KOKKOS_INLINE_FUNCTION
+    static double
+    reciprocalConditionNumber( typename shared_matrix::const_type E )
+    {
+        auto const n = E.extent_int( 0 );
+        if ( n == 0 )
+            return 1.;
+        double min = std::abs( E( 0, 0 ) );
+        double max = min;
+        for ( int k = 1; k < n; ++k )
+        {
+            double const e = std::abs( E( k, k ) );
+            if ( e < min )
+                min = e;
+            if ( e > max )
+                max = e;
+        }
+        return ( max > 0. ) ? min / max : 0.;
+    }
+
+    // amount of scratch memory needed by decompose() for a matrix of size
+    // n x n
+    static size_t shmemSize( int n )
+    {
+        return 3 * shared_matrix::shmem_size( n, n ) + // U, E, V
+               shared_vector::shmem_size( n ) +
+               shared_index_vector::shmem_size( n );
     }
 
     // amount of shared memory
-    size_t team_shmem_size( int team_size ) const
+    size_t team_shmem_size( int /*team_size*/ ) const
     {
-        // If each thread of a team gets its own matrix, we multiply by
-        // team_size
-        return team_size * 3 * shared_matrix::shmem_size( _n, _n ); // U, E, V
+        // The matrices are shared by all the threads of a team
+        return shmemSize( _n );
     }
 
   private:
     int _n;
+    int _n_rows;
     typename matrices_type::const_type _As;
     matrices_type _pseudoAs;
 };
@@ -13,10 +13,19 @@
 #define DTK_MOVING_LEAST_SQUARES_OPERATOR_DECL_HPP
 
 #include <DTK_CompactlySupportedRadialBasisFunctions.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // FetchPlan
+#include <DTK_DistributedSearchTree.hpp>
 #include <DTK_MultivariatePolynomialBasis.hpp>
 #include <DTK_PointCloudOperator.hpp>
+#include <DTK_Types.h> // GlobalOrdinal
 
+#include <Kokkos_DefaultNode.hpp>
 #include <Teuchos_ParameterList.hpp>
+#include <Tpetra_CrsMatrix.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -29,22 +38,260 @@ class MovingLeastSquaresOperator : public PointCloudOperator<DeviceType>
     using ExecutionSpace = typename DeviceType::execution_space;
 
   public:
+    using Node = Kokkos::Compat::KokkosDeviceWrapperNode<
+        ExecutionSpace, typename DeviceType::memory_space>;
+    using CrsMatrix = Tpetra::CrsMatrix<double, int, GlobalOrdinal, Node>;
+
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points );
+
+    /**
+     * By default, the neighborhood of each target point is made of the
+     * PolynomialBasis::size() closest source points.
+     *  - "Number of Neighbors" (int): number of closest source points
+     *    instead, at least PolynomialBasis::size().
+     *
+     * The following parameters select radius-based neighborhoods instead:
+     *  - "Support Radius" (double): search the source points within that
+     *    distance of each target point.  It is also the support of the radial
+     *    basis function.
+     *  - "Adaptive Radius" (bool, default false): double the radius of the
+     *    target points that have fewer neighbors than the size of the
+     *    polynomial basis and search again for these only.
+     *  - "Maximum Radius Refinements" (int, default 10): maximum number of
+     *    times the radius may be doubled.
+     *
+     * Independently of the neighborhoods:
+     *  - "Compute Gradient" (bool, default false): also compute the
+     *    coefficients of the gradient of the fit at the target points so
+     *    that applyWithGradient() may be called.  The polynomial basis must
+     *    include the linear terms.
+     *  - "Spatial Reordering" (bool, default false): handle the target
+     *    points along the Z-order curve internally so that the values of
+     *    consecutive rows are fetched from nearby source points.  The target
+     *    values are permuted back to the order of the target points at the
+     *    end of apply().
+     *  - "Space Filling Curve" (string, default "Z-Order"): curve along
+     *    which the target points are reordered, either "Z-Order" or
+     *    "Hilbert".  Consecutive points along the Hilbert curve are closer
+     *    to each other.
+     *  - "Mixed Precision" (bool, default false): decompose the moment
+     *    matrices in single precision and refine their inverses to double
+     *    precision.  The matrices that are too ill conditioned for the
+     *    refinement are decomposed in double precision as usual.
+     *  - "Single Precision Coefficients" (bool, default false): store the
+     *    coefficients of the operator in single precision, which halves the
+     *    memory of the operator and the coefficients read by apply().  The
+     *    target values are still accumulated in double precision but their
+     *    relative accuracy is limited to about 1e-7.  The coefficients are
+     *    written in double precision by save().
+     *  - "Repartition Targets" (bool, default false): first send each target
+     *    point to the process whose source points are the closest to it,
+     *    according to the top tree of the search, when the partitions of the
+     *    source and target points are unrelated.  The search, the fetch of
+     *    the source values, and the computation of the target values then
+     *    mostly stay on that process and apply() sends the target values
+     *    back.  The operator may then not be saved nor exported as a matrix.
+     */
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params );
+
+    /**
+     * Same as above for source points that include ghosts, i.e. copies of
+     * points owned by other processes.  Only the points flagged in
+     * source_owned are searched, so that a neighborhood never holds a point
+     * and its ghosts.  The source values are still given for all the local
+     * points.
+     */
     MovingLeastSquaresOperator(
         Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
-        Kokkos::View<Coordinate const **, DeviceType> source_points,
-        Kokkos::View<Coordinate const **, DeviceType> target_points );
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<bool const *, DeviceType> source_owned,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params = Teuchos::ParameterList() );
+
+    /**
+     * Same as above but the search tree over the source points has already
+     * been built, e.g., by another operator over the same points.
+     */
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params );
+
+    /**
+     * Read an operator written by save() instead of building it, i.e. skip
+     * the search and the computation of the coefficients.  The points must be
+     * the ones the saved operator was built with, on the same number of
+     * processes and with the same partition; this is checked against the
+     * size and a checksum of the local point clouds stored in the file.
+     * The gradient coefficients are not saved, i.e. applyWithGradient() may
+     * not be called on an operator read from disk.
+     *
+     * NOTE: This is not a collective call.
+     */
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        std::string const &filename,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points );
+
+    /**
+     * Write the operator to disk so that it can be reused, e.g. at restart.
+     * Each process writes its own part of the operator to the binary file
+     * filename.<rank>.
+     */
+    void save( std::string const &filename ) const;
 
     void
     apply( Kokkos::View<double const *, DeviceType> source_values,
            Kokkos::View<double *, DeviceType> target_values ) const override;
 
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const override;
+
+    using PointCloudOperator<DeviceType>::apply;
+
+    /**
+     * Only the rows of the active target points are evaluated.  The target
+     * points must not have been repartitioned.
+     */
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values,
+        Kokkos::View<bool const *, DeviceType> active_targets ) const override;
+
+    /**
+     * Interpolate the source values and recover the gradient of the field at
+     * the target points (number of target points, spatial dimension) with a
+     * single exchange of the source values.  The operator must have been
+     * built with "Compute Gradient" set to true.
+     */
+    void applyWithGradient(
+        Kokkos::View<double const *, DeviceType> source_values,
+        Kokkos::View<double *, DeviceType> target_values,
+        Kokkos::View<double **, DeviceType> target_gradients ) const;
+
+    typename PointCloudOperator<DeviceType>::FetchPlan const *
+    getFetchPlan() const override
+    {
+        return &_fetch_plan;
+    }
+
+    void
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values )
+        const override;
+
+    /**
+     * The coefficients are returned in double precision.  The target points
+     * must not have been repartitioned.
+     */
+    typename PointCloudOperator<DeviceType>::LocalMatrix
+    getLocalMatrix() const override;
+
+    using PointCloudOperator<DeviceType>::applyTranspose;
+
+    /**
+     * The contribution of each target value to the source points of its
+     * neighborhood goes back along the plan that fetches the source values,
+     * after the target values have been brought to the rows of the operator
+     * if the target points were repartitioned.
+     */
+    void
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values,
+                    TransposeMerge merge ) const override;
+
+    /**
+     * Export the operator as a distributed sparse matrix.  Source and target
+     * points are numbered contiguously across processes in the order they were
+     * passed to the constructor, i.e. the domain map of the matrix matches the
+     * distribution of the source values and its range map the distribution of
+     * the target values.  Applying the matrix is equivalent to calling apply()
+     * but lets the user rely on Tpetra's kernels, compose the operator with
+     * others, or transpose it (e.g. with Tpetra::RowMatrixTransposer) to go
+     * back from the target to the source without redoing the search.
+     *
+     * NOTE: This is a collective call.
+     */
+    Teuchos::RCP<CrsMatrix> getCrsMatrix() const;
+
   private:
+    // Apply the coefficients to the source values fetched for the rows of
+    // the operator, in the precision the coefficients are stored in.
+    template <typename FetchedValues>
+    Kokkos::View<typename FetchedValues::non_const_data_type, DeviceType>
+    computeRowValues( FetchedValues fetched_values ) const;
+
+    // Coefficients of the operator in double precision.
+    Kokkos::View<double *, DeviceType> getCoefficients() const;
+
+    // Number of target points passed to the constructor on this process.  It
+    // is the number of rows of the operator unless they were repartitioned.
+    size_t getTargetSize() const;
+
+    // Store the values computed for the rows of the operator in the target
+    // values, in the order of the user and on the process the target points
+    // came from.
+    template <typename Values, typename TargetValues>
+    void copyToTargets( Values values, TargetValues target_values ) const;
+
+    // Identify the operator and the point clouds it was built with when it is
+    // written to disk.
+    std::vector<std::uint64_t> makeFileHeader(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points ) const;
+
     Teuchos::RCP<Teuchos::Comm<int> const> _comm;
-    unsigned int const _n_source_points;
+    unsigned int _n_source_points;
     Kokkos::View<int *, DeviceType> _offset;
-    Kokkos::View<int *, DeviceType> _ranks;
-    Kokkos::View<int *, DeviceType> _indices;
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _fetch_plan;
+    // Sends the contributions of the rows back to the source points in
+    // applyTranspose().
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _transpose_plan;
+    // Where each fetched source value is in the values received by the plan
+    // above, so that applyComponents() reads them in place.
+    Kokkos::View<int *, DeviceType> _import_positions;
     Kokkos::View<double *, DeviceType> _coeffs;
+    // The coefficients when they are stored in single precision, in which
+    // case _coeffs is empty.
+    Kokkos::View<float *, DeviceType> _single_coeffs;
+    Kokkos::View<double **, DeviceType> _gradient_coeffs;
+    // Target point of each row of the operator, empty if the rows are in the
+    // order of the target points.
+    Kokkos::View<size_t *, DeviceType> _target_permutation;
+    // Brings the target values back to the processes the target points came
+    // from, without distributor if they were not repartitioned.
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _return_plan;
+    // Sends the target points to the processes where the rows are, i.e. the
+    // transpose of the plan above.
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _migration_plan;
+    std::vector<std::uint64_t> _file_header;
 };
 
 } // end namespace DataTransferKit
@@ -17,6 +17,11 @@
 #include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // makeDistributedSearchTree, fetch
 #include <DTK_DistributedSearchTree.hpp>
 
+#include <Teuchos_CommHelpers.hpp>
+#include <Teuchos_OrdinalTraits.hpp>
+
+#include <fstream>
+
 namespace DataTransferKit
 {
 
@@ -26,89 +31,298 @@ MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
                            PolynomialBasis>::
     MovingLeastSquaresOperator(
         Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
-        Kokkos::View<Coordinate const **, DeviceType> source_points,
-        Kokkos::View<Coordinate const **, DeviceType> target_points )
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points )
+    : MovingLeastSquaresOperator( comm, source_points, target_points,
+                                  Teuchos::ParameterList() )
+{
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
+    : MovingLeastSquaresOperator(
+          comm,
+          Details::NearestNeighborOperatorImpl<
+              DeviceType>::makeDistributedSearchTree( comm, source_points ),
+          source_points, target_points, params )
+{
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<bool const *, DeviceType> source_owned,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
+    : MovingLeastSquaresOperator(
+          comm,
+          Details::NearestNeighborOperatorImpl<DeviceType>::makeOwnedPoints(
+              source_points, source_owned ),
+          target_points, params )
+{
+    // The operator was built over the owned points only.  Map their indices
+    // back to the local points.
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    Impl::mapSourceIndices( _fetch_plan, _transpose_plan,
+                            Impl::makeOwnedIndices( source_owned ) );
+    _n_source_points = source_points.extent( 0 );
+    _file_header = makeFileHeader( source_points, target_points );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
     : _comm( comm )
     , _n_source_points( source_points.extent( 0 ) )
     , _offset( "offset" )
-    , _ranks( "ranks" )
-    , _indices( "indices" )
     , _coeffs( "polynomial_coefficients" )
+    , _target_permutation( "target_permutation" )
 {
-    DTK_REQUIRE( source_points.extent_int( 1 ) ==
-                 target_points.extent_int( 1 ) );
-    // FIXME for now let's assume 3D
-    DTK_REQUIRE( source_points.extent_int( 1 ) == 3 );
-
-    // Build distributed search tree over the source points.
-    auto search_tree = Details::NearestNeighborOperatorImpl<
-        DeviceType>::makeDistributedSearchTree( _comm, source_points );
+    // The dimension of the point clouds is the one of the polynomial basis.
+    int constexpr dim = PolynomialBasis::dimension();
+    DTK_REQUIRE( source_points.extent_int( 1 ) == dim );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == dim );
     DTK_CHECK( !search_tree.empty() );
 
-    // For each target point, query the n_neighbors points closest to the
-    // target.
-    auto queries =
-        Details::MovingLeastSquaresOperatorImpl<DeviceType>::makeKNNQueries(
-            target_points, PolynomialBasis::size() );
+    // The file header identifies the points in the order of the user.
+    _file_header = makeFileHeader( source_points, target_points );
+
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    if ( params.isParameter( "Repartition Targets" ) &&
+         params.get<bool>( "Repartition Targets" ) )
+    {
+        // Handle the target points on the processes that own the source
+        // points nearby from now on, so that most of their neighbors are
+        // local.  The target values are sent back at the end of apply().
+        using NNImpl = Details::NearestNeighborOperatorImpl<DeviceType>;
+        auto const home_ranks = search_tree.findNearestRanks(
+            Impl::template makeKNNQueries<dim>( target_points, 1 ) );
+        auto const plans = NNImpl::makeMigrationPlans( _comm, home_ranks );
+        _migration_plan = plans.first;
+        _return_plan = plans.second;
+        target_points = NNImpl::fetch( plans.first, target_points );
+    }
+    if ( params.isParameter( "Spatial Reordering" ) &&
+         params.get<bool>( "Spatial Reordering" ) )
+    {
+        // Handle the target points along a space-filling curve from now on
+        // so that consecutive rows of the operator have nearby
+        // neighborhoods.  The values are put back in the order of the user at
+        // the end of apply().
+        std::string const curve =
+            params.isParameter( "Space Filling Curve" )
+                ? params.get<std::string>( "Space Filling Curve" )
+                : "Z-Order";
+        DTK_REQUIRE( curve == "Z-Order" || curve == "Hilbert" );
+        _target_permutation =
+            ( curve == "Hilbert" )
+                ? Impl::template sortAlongCurve<dim>( target_points,
+                                                      HilbertCurveTag{} )
+                : Impl::template sortAlongCurve<dim>( target_points,
+                                                      ZOrderCurveTag{} );
+        target_points =
+            Impl::permutePoints( _target_permutation, target_points );
+    }
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    Kokkos::View<double *, DeviceType> radius( "radius" );
+    if ( params.isParameter( "Support Radius" ) )
+    {
+        // For each target point, query the source points within the support
+        // radius of the target.
+        double const support_radius = params.get<double>( "Support Radius" );
+        DTK_REQUIRE( support_radius > 0. );
+        radius = Kokkos::View<double *, DeviceType>(
+            "radius", target_points.extent( 0 ) );
+        Kokkos::deep_copy( radius, support_radius );
+        auto queries =
+            Impl::template makeWithinQueries<dim>( target_points, radius );
+        search_tree.query( queries, indices, _offset, ranks );
 
-    // Perform the actual search.
-    search_tree.query( queries, _indices, _offset, _ranks );
+        if ( params.isParameter( "Adaptive Radius" ) &&
+             params.get<bool>( "Adaptive Radius" ) )
+        {
+            int const max_refinements =
+                params.isParameter( "Maximum Radius Refinements" )
+                    ? params.get<int>( "Maximum Radius Refinements" )
+                    : 10;
+            Impl::template widenUnderdeterminedNeighborhoods<dim>(
+                _comm, search_tree, target_points, PolynomialBasis::size(),
+                max_refinements, radius, indices, _offset, ranks );
+        }
+    }
+    else
+    {
+        // For each target point, query the n_neighbors points closest to the
+        // target.
+        int const n_neighbors =
+            params.isParameter( "Number of Neighbors" )
+                ? params.get<int>( "Number of Neighbors" )
+                : PolynomialBasis::size();
+        DTK_REQUIRE( n_neighbors >= PolynomialBasis::size() );
+        auto queries =
+            Impl::template makeKNNQueries<dim>( target_points, n_neighbors );
+        search_tree.query( queries, indices, _offset, ranks );
+    }
 
-    // Retrieve the coordinates of all source points that met the predicates.
+    // Build the communication plan that is reused in apply() and retrieve the
+    // coordinates of all source points that met the predicates.
     // NOTE: This is the last collective.
-    source_points = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
-        _comm, _ranks, _indices, source_points );
-
-    // Transform source points
-    source_points = Details::MovingLeastSquaresOperatorImpl<
-        DeviceType>::transformSourceCoordinates( source_points, _offset,
-                                                 target_points );
-    target_points = Kokkos::View<double **, DeviceType>( "empty" );
-
-    // Build P (vandermonde matrix)
-    // P is a single 1D storage for multiple P_i matrices. Each matrix is of
-    // size (#source_points_for_specific_target_point, basis_size)
-    auto p =
-        Details::MovingLeastSquaresOperatorImpl<DeviceType>::computeVandermonde(
-            source_points, PolynomialBasis() );
-
-    // To build the radial basis function, we need to define the radius of the
-    // radial basis function. Since we use kNN, we need to compute the radius.
-    // We only need the coordinates of the source points because of the
-    // transformation of the coordinates.
-    auto radius =
-        Details::MovingLeastSquaresOperatorImpl<DeviceType>::computeRadius(
-            source_points, _offset );
-
-    // Build phi (weight matrix)
-    auto phi =
-        Details::MovingLeastSquaresOperatorImpl<DeviceType>::computeWeights(
-            source_points, radius, CompactlySupportedRadialBasisFunction() );
-
-    // Build A (moment matrix)
-    auto a =
-        Details::MovingLeastSquaresOperatorImpl<DeviceType>::computeMoments(
-            _offset, p, phi );
-
-    // TODO: it is computationally unnecessary to compute the pseudo-inverse as
-    // MxM (U*E^+*V) as it will later be just used to do MxV. We could instead
-    // return the (U,E^+,V) and do the MxV multiplication. But for now, it's OK.
-    auto t = Details::MovingLeastSquaresOperatorImpl<DeviceType>::invertMoments(
-        a, PolynomialBasis::size() );
-    auto inv_a = std::get<0>( t );
-
-    // std::get<1>(t) returns the number of undetermined system. However, this
-    // is not enough to know if we will lose order of accuracy. For example, if
-    // all the points are aligned, the system will be underdetermined. However
-    // this is not a problem if we found at least three points since this is
-    // enough to define a quadratic function. Therefore, not only we need to
-    // know the rank deficiency but also the dimension of the problem.
+    _fetch_plan = Details::NearestNeighborOperatorImpl<
+        DeviceType>::makeFetchPlan( _comm, ranks, indices );
+    _transpose_plan = Details::NearestNeighborOperatorImpl<
+        DeviceType>::makeTransposePlan( _comm, _fetch_plan );
+    _import_positions = Details::NearestNeighborOperatorImpl<
+        DeviceType>::makeImportPositions( _fetch_plan );
+    Kokkos::View<Coordinate const **, DeviceType> neighbor_points =
+        Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+            _fetch_plan, source_points );
 
+    // Compute the coefficients for each target point in a single kernel:
+    // transform the source points relative to the target, build P
+    // (vandermonde matrix), phi (weight matrix), and A (moment matrix), and
+    // invert A.
     // NOTE: This assumes that the polynomial basis evaluated at {0,0,0} is
     // going to be [1, 0, 0, ..., 0]^T.
-    _coeffs = Details::MovingLeastSquaresOperatorImpl<
-        DeviceType>::computePolynomialCoefficients( _offset, inv_a, p, phi,
-                                                    PolynomialBasis::size() );
+    if ( params.isParameter( "Compute Gradient" ) &&
+         params.get<bool>( "Compute Gradient" ) )
+    {
+        // The gradient at the target is given by the coefficients of the
+        // linear terms that follow the constant one in the basis.
+        DTK_REQUIRE( PolynomialBasis::size() > dim );
+        _gradient_coeffs = Kokkos::View<double **, DeviceType>(
+            "gradient_coefficients", neighbor_points.extent( 0 ), dim );
+    }
+    bool const mixed_precision = params.isParameter( "Mixed Precision" ) &&
+                                 params.get<bool>( "Mixed Precision" );
+    _coeffs = Impl::computeCoefficients(
+        _offset, neighbor_points, target_points, radius,
+        CompactlySupportedRadialBasisFunction(), PolynomialBasis(),
+        _gradient_coeffs, mixed_precision );
+    if ( params.isParameter( "Single Precision Coefficients" ) &&
+         params.get<bool>( "Single Precision Coefficients" ) )
+    {
+        _single_coeffs = Impl::template convertValues<float>( _coeffs );
+        _coeffs =
+            Kokkos::View<double *, DeviceType>( "polynomial_coefficients" );
+    }
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    MovingLeastSquaresOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        std::string const &filename,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points )
+    : _comm( comm )
+    , _n_source_points( source_points.extent( 0 ) )
+    , _offset( "offset" )
+    , _coeffs( "polynomial_coefficients" )
+    , _target_permutation( "target_permutation" )
+{
+    int constexpr dim = PolynomialBasis::dimension();
+    DTK_REQUIRE( source_points.extent_int( 1 ) == dim );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == dim );
+
+    std::ifstream file( filename + "." + std::to_string( _comm->getRank() ),
+                        std::ios::binary );
+    DTK_INSIST( file.is_open() );
+
+    // Refuse operators built with other points or another partition.
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    _file_header = makeFileHeader( source_points, target_points );
+    DTK_INSIST( Impl::template readArray<std::uint64_t>( file ) ==
+                _file_header );
+
+    _offset = Impl::template readView<int>( file, "offset" );
+    _fetch_plan = Impl::loadFetchPlan( _comm, file );
+    _transpose_plan = Impl::makeTransposePlan( _comm, _fetch_plan );
+    _import_positions = Impl::makeImportPositions( _fetch_plan );
+    _coeffs =
+        Impl::template readView<double>( file, "polynomial_coefficients" );
+    _target_permutation =
+        Impl::template readView<size_t>( file, "target_permutation" );
+    DTK_INSIST( _offset.extent_int( 0 ) == target_points.extent_int( 0 ) + 1 );
+    DTK_INSIST( _coeffs.extent( 0 ) == _fetch_plan.import_indices.extent( 0 ) );
+    DTK_INSIST( _target_permutation.extent( 0 ) == 0 ||
+                _target_permutation.extent( 0 ) == target_points.extent( 0 ) );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+std::vector<std::uint64_t>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    makeFileHeader(
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points ) const
+{
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    std::uint64_t const magic = 0x44544b4d4c533032ULL; // "DTKMLS02"
+    return {magic,
+            static_cast<std::uint64_t>( _comm->getSize() ),
+            static_cast<std::uint64_t>( _comm->getRank() ),
+            static_cast<std::uint64_t>( PolynomialBasis::dimension() ),
+            static_cast<std::uint64_t>( PolynomialBasis::size() ),
+            source_points.extent( 0 ),
+            target_points.extent( 0 ),
+            Impl::hashPoints( source_points ),
+            Impl::hashPoints( target_points )};
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction,
+    PolynomialBasis>::save( std::string const &filename ) const
+{
+    std::ofstream file( filename + "." + std::to_string( _comm->getRank() ),
+                        std::ios::binary );
+    DTK_INSIST( file.is_open() );
+    // The plan to send the target values back is not saved.
+    DTK_INSIST( _return_plan.distributor.is_null() );
+
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    Impl::writeArray( file, _file_header.data(), _file_header.size() );
+    Impl::writeView( file, _offset );
+    Impl::saveFetchPlan( file, _fetch_plan );
+    Impl::writeView( file, getCoefficients() );
+    Impl::writeView( file, _target_permutation );
+    DTK_INSIST( file.good() );
 }
 
 template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
@@ -120,26 +334,419 @@ void MovingLeastSquaresOperator<
 {
     // Precondition: check that the source and the target are properly sized
     DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
-    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
 
     // Retrieve values for all source points
     source_values = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
-        _comm, _ranks, _indices, source_values );
+        _fetch_plan, source_values );
 
     // Apply A-1 (P^T phi)
-    auto new_target_values = Details::MovingLeastSquaresOperatorImpl<
-        DeviceType>::computeTargetValues( _offset, _coeffs, source_values );
+    auto new_target_values = computeRowValues( source_values );
+
+    copyToTargets( new_target_values, target_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction, PolynomialBasis>::
+    applyWithGradient(
+        Kokkos::View<double const *, DeviceType> source_values,
+        Kokkos::View<double *, DeviceType> target_values,
+        Kokkos::View<double **, DeviceType> target_gradients ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( target_gradients.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( target_gradients.extent_int( 1 ) ==
+                 PolynomialBasis::dimension() );
+    // The gradient coefficients are only computed on request.
+    // NOTE: _coeffs or _single_coeffs is empty.
+    DTK_INSIST( _gradient_coeffs.extent( 0 ) ==
+                _coeffs.extent( 0 ) + _single_coeffs.extent( 0 ) );
+
+    // Retrieve values for all source points once for both the values and the
+    // gradient
+    source_values = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_values );
+
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    auto new_target_values = computeRowValues( source_values );
+    auto new_target_gradients = Impl::computeTargetGradients(
+        _offset, _gradient_coeffs, source_values );
+
+    copyToTargets( new_target_values, target_values );
+    copyToTargets( new_target_gradients, target_gradients );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction, PolynomialBasis>::
+    applyComponents( Kokkos::View<double const **, DeviceType> source_values,
+                     Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    // Apply A-1 (P^T phi) to all components at once straight from the values
+    // received, unless they are read with one-sided communication or the
+    // target values must be sent back.  This saves the kernels and the
+    // buffers of the intermediate steps.
+    using NNImpl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    if ( !_fetch_plan.one_sided && _return_plan.distributor.is_null() )
+    {
+        Details::CachingAllocatorScope<typename DeviceType::memory_space>
+            allocator_scope( *_fetch_plan.allocator );
+        Details::TemporaryViews<DeviceType> temporaries;
+        auto const imports =
+            NNImpl::exchange( _fetch_plan, source_values, temporaries );
+        using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+        if ( _single_coeffs.extent( 0 ) > 0 )
+            Impl::computeTargetValuesFromImports(
+                _offset, _single_coeffs, _import_positions, imports,
+                _target_permutation, target_values );
+        else
+            Impl::computeTargetValuesFromImports(
+                _offset, _coeffs, _import_positions, imports,
+                _target_permutation, target_values );
+        return;
+    }
+
+    // Retrieve values for all source points
+    source_values = NNImpl::fetch( _fetch_plan, source_values );
+
+    // Apply A-1 (P^T phi) to all components at once
+    auto new_target_values = computeRowValues( source_values );
 
-    Kokkos::deep_copy( target_values, new_target_values );
+    copyToTargets( new_target_values, target_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction, PolynomialBasis>::
+    applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values,
+        Kokkos::View<bool const *, DeviceType> active_targets ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+    DTK_REQUIRE( active_targets.extent( 0 ) == getTargetSize() );
+    // The flags would have to follow the target points.
+    DTK_INSIST( _return_plan.distributor.is_null() );
+
+    // Flag the rows of the active target points and the neighbors in these
+    // rows, whose source values are fetched row after row.
+    auto const offset = _offset;
+    auto const target_permutation = _target_permutation;
+    int const n_rows = offset.extent( 0 ) - 1;
+    Kokkos::View<bool *, DeviceType> active_rows(
+        Kokkos::ViewAllocateWithoutInitializing( "active_rows" ), n_rows );
+    Kokkos::View<bool *, DeviceType> active_neighbors(
+        Kokkos::ViewAllocateWithoutInitializing( "active_neighbors" ),
+        _fetch_plan.import_indices.extent( 0 ) );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "flag_active_rows" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_rows ),
+        KOKKOS_LAMBDA( int i ) {
+            bool const active = active_targets(
+                target_permutation.extent( 0 ) > 0 ? target_permutation( i )
+                                                   : i );
+            active_rows( i ) = active;
+            for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                active_neighbors( j ) = active;
+        } );
+    Kokkos::fence();
+
+    using NNImpl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    auto const rows = NNImpl::makeOwnedIndices( active_rows );
+    int const n_active = rows.extent( 0 );
+    Kokkos::View<int *, DeviceType> fetched_offset( "offset", n_active + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_active_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_active ),
+        KOKKOS_LAMBDA( int i ) {
+            fetched_offset( i ) = offset( rows( i ) + 1 ) - offset( rows( i ) );
+        } );
+    Kokkos::fence();
+    exclusivePrefixSum( fetched_offset );
+
+    auto const fetched_values = NNImpl::fetch(
+        NNImpl::makeSubsetPlan( _comm, _fetch_plan, active_neighbors ),
+        source_values );
+
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    auto const values =
+        ( _single_coeffs.extent( 0 ) > 0 )
+            ? Impl::computeTargetValues( offset, _single_coeffs, rows,
+                                         fetched_offset, fetched_values )
+            : Impl::computeTargetValues( offset, _coeffs, rows,
+                                         fetched_offset, fetched_values );
+
+    int const n_components = values.extent( 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "set_active_target_values" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_active ),
+        KOKKOS_LAMBDA( int i ) {
+            int const target = target_permutation.extent( 0 ) > 0
+                                   ? target_permutation( rows( i ) )
+                                   : rows( i );
+            for ( int k = 0; k < n_components; ++k )
+                target_values( target, k ) = values( i, k );
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction, PolynomialBasis>::
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the fetched and the target values are
+    // properly sized
+    DTK_REQUIRE( fetched_values.extent( 0 ) ==
+                 _coeffs.extent( 0 ) + _single_coeffs.extent( 0 ) );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( fetched_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    auto new_target_values = computeRowValues( fetched_values );
+
+    copyToTargets( new_target_values, target_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction, PolynomialBasis>::
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values,
+                    TransposeMerge merge ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == getTargetSize() );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    // Bring the target values to the rows of the operator
+    using NNImpl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    if ( !_return_plan.distributor.is_null() )
+        target_values = NNImpl::fetch( _migration_plan, target_values );
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    auto const row_values =
+        Impl::copyFromUserOrder( _target_permutation, target_values );
+
+    // Apply (A-1 (P^T phi))^T and combine the contributions of all the rows
+    // in which each source point appears
+    auto const contributions =
+        ( _single_coeffs.extent( 0 ) > 0 )
+            ? Impl::computeTransposeValues( _offset, _single_coeffs,
+                                            row_values )
+            : Impl::computeTransposeValues( _offset, _coeffs, row_values );
+    this->mergeTransposed( _transpose_plan, contributions, source_values,
+                           merge );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+template <typename FetchedValues>
+Kokkos::View<typename FetchedValues::non_const_data_type, DeviceType>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::
+    computeRowValues( FetchedValues fetched_values ) const
+{
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    if ( _single_coeffs.extent( 0 ) > 0 )
+        return Impl::computeTargetValues( _offset, _single_coeffs,
+                                          fetched_values );
+    return Impl::computeTargetValues( _offset, _coeffs, fetched_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+Kokkos::View<double *, DeviceType>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::getCoefficients() const
+{
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    if ( _single_coeffs.extent( 0 ) > 0 )
+        return Impl::template convertValues<double>( _single_coeffs );
+    return _coeffs;
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+size_t MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction,
+    PolynomialBasis>::getTargetSize() const
+{
+    return _return_plan.distributor.is_null()
+               ? _offset.extent( 0 ) - 1
+               : _return_plan.import_indices.extent( 0 );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+template <typename Values, typename TargetValues>
+void MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction,
+    PolynomialBasis>::copyToTargets( Values values,
+                                     TargetValues target_values ) const
+{
+    using Impl = Details::MovingLeastSquaresOperatorImpl<DeviceType>;
+    if ( _return_plan.distributor.is_null() )
+    {
+        Impl::copyToUserOrder( _target_permutation, values, target_values );
+        return;
+    }
+
+    // Put the values in the order in which the target points were received
+    // and send them back.
+    typename TargetValues::non_const_type migrated_values(
+        Kokkos::ViewAllocateWithoutInitializing( target_values.label() ),
+        values.extent( 0 ), values.extent( 1 ) );
+    Impl::copyToUserOrder( _target_permutation, values, migrated_values );
+    Kokkos::deep_copy(
+        target_values,
+        Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+            _return_plan, migrated_values ) );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+typename PointCloudOperator<DeviceType>::LocalMatrix
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::getLocalMatrix() const
+{
+    // The rows would be on the processes the target points were sent to.
+    DTK_INSIST( _return_plan.distributor.is_null() );
+
+    typename PointCloudOperator<DeviceType>::LocalMatrix matrix;
+    matrix.plan = &_fetch_plan;
+    matrix.rows = _target_permutation;
+    matrix.offset = _offset;
+    matrix.coeffs = getCoefficients();
+    return matrix;
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          typename PolynomialBasis>
+Teuchos::RCP<typename MovingLeastSquaresOperator<
+    DeviceType, CompactlySupportedRadialBasisFunction,
+    PolynomialBasis>::CrsMatrix>
+MovingLeastSquaresOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                           PolynomialBasis>::getCrsMatrix() const
+{
+    using Map = Tpetra::Map<int, GlobalOrdinal, Node>;
+
+    // The rows would be on the processes the target points were sent to.
+    DTK_INSIST( _return_plan.distributor.is_null() );
+
+    int const n_source_points = _n_source_points;
+    int const n_target_points = _offset.extent( 0 ) - 1;
+
+    // Number the points contiguously across processes.
+    auto const invalid =
+        Teuchos::OrdinalTraits<Tpetra::global_size_t>::invalid();
+    Teuchos::RCP<Map const> domain_map =
+        Teuchos::rcp( new Map( invalid, n_source_points, 0, _comm ) );
+    Teuchos::RCP<Map const> range_map =
+        Teuchos::rcp( new Map( invalid, n_target_points, 0, _comm ) );
+
+    GlobalOrdinal n_source_points_scan = 0;
+    Teuchos::scan( *_comm, Teuchos::REDUCE_SUM,
+                   static_cast<GlobalOrdinal>( n_source_points ),
+                   Teuchos::ptrFromRef( n_source_points_scan ) );
+    GlobalOrdinal const first_source_gid =
+        n_source_points_scan - n_source_points;
+
+    // Retrieve the global ids of the source points that are in the
+    // neighborhood of each target point with the same plan that is used to
+    // fetch the source values in apply().  They are the column indices.
+    Kokkos::View<GlobalOrdinal *, DeviceType> source_gids(
+        Kokkos::ViewAllocateWithoutInitializing( "source_global_ids" ),
+        n_source_points );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "number_source_points" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_source_points ),
+        KOKKOS_LAMBDA( int i ) { source_gids( i ) = first_source_gid + i; } );
+    Kokkos::fence();
+    auto columns = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_gids );
+
+    auto offset = Kokkos::create_mirror_view( _offset );
+    Kokkos::deep_copy( offset, _offset );
+    auto columns_host = Kokkos::create_mirror_view( columns );
+    Kokkos::deep_copy( columns_host, columns );
+    auto const coeffs_device = getCoefficients();
+    auto coeffs = Kokkos::create_mirror_view( coeffs_device );
+    Kokkos::deep_copy( coeffs, coeffs_device );
+    auto target_permutation = Kokkos::create_mirror_view( _target_permutation );
+    Kokkos::deep_copy( target_permutation, _target_permutation );
+    bool const reordered = target_permutation.extent( 0 ) > 0;
+
+    // The rows of the matrix are in the order of the user.
+    Teuchos::ArrayRCP<size_t> n_entries_per_row( n_target_points );
+    for ( int i = 0; i < n_target_points; ++i )
+        n_entries_per_row[reordered ? target_permutation( i ) : i] =
+            offset( i + 1 ) - offset( i );
+
+    auto matrix = Teuchos::rcp( new CrsMatrix(
+        range_map, n_entries_per_row.getConst(), Tpetra::StaticProfile ) );
+    for ( int i = 0; i < n_target_points; ++i )
+    {
+        int const row = reordered ? target_permutation( i ) : i;
+        int const n_entries = n_entries_per_row[row];
+        if ( n_entries == 0 )
+            continue;
+        matrix->insertGlobalValues(
+            range_map->getGlobalElement( row ),
+            Teuchos::ArrayView<GlobalOrdinal const>(
+                columns_host.data() + offset( i ), n_entries ),
+            Teuchos::ArrayView<double const>( coeffs.data() + offset( i ),
+                                              n_entries ) );
+    }
+    matrix->fillComplete( domain_map, range_map );
+
+    return matrix;
 }
 
 } // end namespace DataTransferKit
 
-// Explicit instantiation macro
+// Explicit instantiation macros. In three dimensions, the operators are
+// instantiated for every radial basis function so that the map factory can
+// select any of them at run time.
+#define DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, RBF )             \
+    template class MovingLeastSquaresOperator<                                 \
+        typename NODE::device_type, RBF,                                       \
+        MultivariatePolynomialBasis<Linear, 3>>;                               \
+    template class MovingLeastSquaresOperator<                                 \
+        typename NODE::device_type, RBF,                                       \
+        MultivariatePolynomialBasis<Quadratic, 3>>;
+
 #define DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT( NODE )                      \
-    template class MovingLeastSquaresOperator<typename NODE::device_type>;     \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wendland<0> )         \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wendland<2> )         \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wendland<4> )         \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wendland<6> )         \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wu<2> )               \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Wu<4> )               \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Buhmann<2> )          \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Buhmann<3> )          \
+    DTK_MOVING_LEAST_SQUARES_OPERATOR_INSTANT_RBF( NODE, Buhmann<4> )          \
     template class MovingLeastSquaresOperator<                                 \
         typename NODE::device_type, Wendland<0>,                               \
-        MultivariatePolynomialBasis<Quadratic, 3>>;
+        MultivariatePolynomialBasis<Linear, 2>>;                               \
+    template class MovingLeastSquaresOperator<                                 \
+        typename NODE::device_type, Wendland<0>,                               \
+        MultivariatePolynomialBasis<Quadratic, 2>>;
 
 #endif
@@ -84,6 +84,7 @@ struct MultivariatePolynomialBasis
     {
         return Details::Traits<Basis, DIM>::size();
     }
+    static KOKKOS_INLINE_FUNCTION int constexpr dimension() { return DIM; }
     template <typename Point>
     KOKKOS_INLINE_FUNCTION Kokkos::Array<double, size()>
     operator()( Point const &p ) const;
@@ -12,6 +12,8 @@
 #ifndef DTK_NEAREST_NEIGHBOR_OPERATOR_DECL_HPP
 #define DTK_NEAREST_NEIGHBOR_OPERATOR_DECL_HPP
 
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // FetchPlan
+#include <DTK_DistributedSearchTree.hpp>
 #include <DTK_PointCloudOperator.hpp>
 
 namespace DataTransferKit
@@ -25,17 +27,102 @@ class NearestNeighborOperator : public PointCloudOperator<DeviceType>
   public:
     NearestNeighborOperator(
         Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
-        Kokkos::View<Coordinate const **, DeviceType> source_points,
-        Kokkos::View<Coordinate const **, DeviceType> target_points );
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points );
+
+    /**
+     * Same as above for source points that include ghosts, i.e. copies of
+     * points owned by other processes.  Only the points flagged in
+     * source_owned are searched, so that the ghosts are never found in place
+     * of the points they copy.  The source values are still given for all
+     * the local points.
+     */
+    NearestNeighborOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<bool const *, DeviceType> source_owned,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points );
+
+    /**
+     * Same as above but the search tree over the source points has already
+     * been built, e.g., by another operator over the same points.
+     */
+    NearestNeighborOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points );
+
+    /**
+     * Same as above for points that moved since the operator previous was
+     * built, e.g. between two iterations of a coupling, with the same source
+     * and target points distributed the same way.  The distance of each
+     * target point to its previous neighbor bounds the search, which then
+     * only has to confirm that neighbor or find a closer one.
+     */
+    NearestNeighborOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        NearestNeighborOperator const &previous );
 
     void
     apply( Kokkos::View<double const *, DeviceType> source_values,
            Kokkos::View<double *, DeviceType> target_values ) const override;
 
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const override;
+
+    using PointCloudOperator<DeviceType>::apply;
+
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values,
+        Kokkos::View<bool const *, DeviceType> active_targets ) const override;
+
+    typename PointCloudOperator<DeviceType>::FetchPlan const *
+    getFetchPlan() const override
+    {
+        return &_fetch_plan;
+    }
+
+    void
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values )
+        const override;
+
+    // Each row has a single coefficient, equal to one.
+    typename PointCloudOperator<DeviceType>::LocalMatrix
+    getLocalMatrix() const override;
+
+    using PointCloudOperator<DeviceType>::applyTranspose;
+
+    void
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values,
+                    TransposeMerge merge ) const override;
+
   private:
+    void setupFetchPlan(
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Nearest<Point> *, DeviceType> nearest_queries );
+
     Teuchos::RCP<Teuchos::Comm<int> const> _comm;
-    Kokkos::View<int *, DeviceType> _indices;
-    Kokkos::View<int *, DeviceType> _ranks;
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _fetch_plan;
+    // Sends the target values back to the source points for applyTranspose().
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _transpose_plan;
     int const _size;
 };
 
@@ -21,28 +21,129 @@ namespace DataTransferKit
 template <typename DeviceType>
 NearestNeighborOperator<DeviceType>::NearestNeighborOperator(
     Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
-    Kokkos::View<Coordinate const **, DeviceType> source_points,
-    Kokkos::View<Coordinate const **, DeviceType> target_points )
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        source_points,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        target_points )
+    : NearestNeighborOperator(
+          comm,
+          Details::NearestNeighborOperatorImpl<
+              DeviceType>::makeDistributedSearchTree( comm, source_points ),
+          source_points, target_points )
+{
+}
+
+template <typename DeviceType>
+NearestNeighborOperator<DeviceType>::NearestNeighborOperator(
+    Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        source_points,
+    Kokkos::View<bool const *, DeviceType> source_owned,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        target_points )
+    : _comm( comm )
+    , _size( source_points.extent_int( 0 ) )
+{
+    int const dim = source_points.extent_int( 1 );
+    DTK_REQUIRE( dim == 2 || dim == 3 );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == dim );
+    DTK_REQUIRE( source_owned.extent_int( 0 ) == _size );
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+
+    // The tree is built over the owned points only and the indices it
+    // returns are mapped back to the local points once the plan is built.
+    auto const search_tree = Impl::makeDistributedSearchTree(
+        comm, Impl::makeOwnedPoints( source_points, source_owned ) );
+    DTK_CHECK( !search_tree.empty() );
+
+    auto nearest_queries =
+        ( dim == 2 )
+            ? Impl::template makeNearestNeighborQueries<2>( target_points )
+            : Impl::template makeNearestNeighborQueries<3>( target_points );
+
+    setupFetchPlan( search_tree, nearest_queries );
+    Impl::mapSourceIndices( _fetch_plan, _transpose_plan,
+                            Impl::makeOwnedIndices( source_owned ) );
+}
+
+template <typename DeviceType>
+NearestNeighborOperator<DeviceType>::NearestNeighborOperator(
+    Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+    DistributedSearchTree<DeviceType> const &search_tree,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        source_points,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        target_points )
     : _comm( comm )
-    , _indices( "indices" )
-    , _ranks( "ranks" )
     , _size( source_points.extent_int( 0 ) )
 {
     // NOTE: instead of checking the pre-condition that there is at least one
     // source point passed to one of the rank, we let the tree handle the
     // communication and just check that the tree is not empty.
 
-    // Build distributed search tree over the source points.
-    auto search_tree = Details::NearestNeighborOperatorImpl<
-        DeviceType>::makeDistributedSearchTree( _comm, source_points );
+    // The dimension is only known at runtime but the helpers are specialized
+    // for two- and three-dimensional point clouds.
+    int const dim = source_points.extent_int( 1 );
+    DTK_REQUIRE( dim == 2 || dim == 3 );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == dim );
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
 
     // Tree must have at least one leaf, otherwise it makes little sense to
     // perform the search for nearest neighbors.
     DTK_CHECK( !search_tree.empty() );
 
     // Query nearest neighbor for all target points.
-    auto nearest_queries = Details::NearestNeighborOperatorImpl<
-        DeviceType>::makeNearestNeighborQueries( target_points );
+    auto nearest_queries =
+        ( dim == 2 )
+            ? Impl::template makeNearestNeighborQueries<2>( target_points )
+            : Impl::template makeNearestNeighborQueries<3>( target_points );
+
+    setupFetchPlan( search_tree, nearest_queries );
+}
+
+template <typename DeviceType>
+NearestNeighborOperator<DeviceType>::NearestNeighborOperator(
+    Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+    DistributedSearchTree<DeviceType> const &search_tree,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        source_points,
+    Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+        target_points,
+    NearestNeighborOperator const &previous )
+    : _comm( comm )
+    , _size( source_points.extent_int( 0 ) )
+{
+    int const dim = source_points.extent_int( 1 );
+    DTK_REQUIRE( dim == 2 || dim == 3 );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == dim );
+    // The previous neighbors are only meaningful for the same points.
+    DTK_REQUIRE( previous._size == _size );
+    DTK_REQUIRE( previous._fetch_plan.import_indices.extent( 0 ) ==
+                 target_points.extent( 0 ) );
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+
+    DTK_CHECK( !search_tree.empty() );
+
+    // Where the previous neighbors of the target points are now.
+    auto const neighbor_points =
+        Impl::fetch( previous._fetch_plan, source_points );
+
+    auto nearest_queries =
+        ( dim == 2 )
+            ? Impl::template makeBoundedNearestNeighborQueries<2>(
+                  target_points, neighbor_points )
+            : Impl::template makeBoundedNearestNeighborQueries<3>(
+                  target_points, neighbor_points );
+
+    setupFetchPlan( search_tree, nearest_queries );
+}
+
+template <typename DeviceType>
+void NearestNeighborOperator<DeviceType>::setupFetchPlan(
+    DistributedSearchTree<DeviceType> const &search_tree,
+    Kokkos::View<Nearest<Point> *, DeviceType> nearest_queries )
+{
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
 
     // Perform the actual search.
     Kokkos::View<int *, DeviceType> indices( "indices" );
@@ -52,13 +153,14 @@ NearestNeighborOperator<DeviceType>::NearestNeighborOperator(
 
     // Check post-condition that we did find a nearest neighbor to all target
     // points.
-    DTK_ENSURE( lastElement( offset ) == target_points.extent_int( 0 ) );
+    DTK_ENSURE( lastElement( offset ) == nearest_queries.extent_int( 0 ) );
 
-    // Save results.
+    // Build the communication plan once and for all so that apply() only
+    // has to move the values.
     // NOTE: we don't bother keeping `offset` around since it is just `[0, 1, 2,
     // ..., n_target_poins]`
-    _indices = indices;
-    _ranks = ranks;
+    _fetch_plan = Impl::makeFetchPlan( _comm, ranks, indices );
+    _transpose_plan = Impl::makeTransposePlan( _comm, _fetch_plan );
 }
 
 template <typename DeviceType>
@@ -67,13 +169,111 @@ void NearestNeighborOperator<DeviceType>::apply(
     Kokkos::View<double *, DeviceType> target_values ) const
 {
     // Precondition: check that the source and target are properly sized
-    DTK_REQUIRE( _indices.extent( 0 ) == target_values.extent( 0 ) );
+    DTK_REQUIRE( _fetch_plan.import_indices.extent( 0 ) ==
+                 target_values.extent( 0 ) );
+    DTK_REQUIRE( _size == source_values.extent_int( 0 ) );
+
+    // The fetched values are the target values.
+    Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_values, target_values );
+}
+
+template <typename DeviceType>
+void NearestNeighborOperator<DeviceType>::applyComponents(
+    Kokkos::View<double const **, DeviceType> source_values,
+    Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the source and target are properly sized
+    DTK_REQUIRE( _fetch_plan.import_indices.extent( 0 ) ==
+                 target_values.extent( 0 ) );
+    DTK_REQUIRE( _size == source_values.extent_int( 0 ) );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_values, target_values );
+}
+
+template <typename DeviceType>
+void NearestNeighborOperator<DeviceType>::applyComponents(
+    Kokkos::View<double const **, DeviceType> source_values,
+    Kokkos::View<double **, DeviceType> target_values,
+    Kokkos::View<bool const *, DeviceType> active_targets ) const
+{
+    // Precondition: check that the source and target are properly sized
+    DTK_REQUIRE( _fetch_plan.import_indices.extent( 0 ) ==
+                 target_values.extent( 0 ) );
     DTK_REQUIRE( _size == source_values.extent_int( 0 ) );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+    DTK_REQUIRE( active_targets.extent( 0 ) == target_values.extent( 0 ) );
 
-    auto values = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
-        _comm, _ranks, _indices, source_values );
+    // The values of the active target points come in the order of these.
+    using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+    auto const values = Impl::fetch(
+        Impl::makeSubsetPlan( _comm, _fetch_plan, active_targets ),
+        source_values );
+    auto const active_indices = Impl::makeOwnedIndices( active_targets );
+    int const n_active = active_indices.extent( 0 );
+    int const n_components = values.extent( 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "set_active_target_values" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_active ),
+        KOKKOS_LAMBDA( int i ) {
+            for ( int j = 0; j < n_components; ++j )
+                target_values( active_indices( i ), j ) = values( i, j );
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void NearestNeighborOperator<DeviceType>::applyFetched(
+    Kokkos::View<double const **, DeviceType> fetched_values,
+    Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // The fetched values are the values of the target points.
+    DTK_REQUIRE( _fetch_plan.import_indices.extent( 0 ) ==
+                 target_values.extent( 0 ) );
+    DTK_REQUIRE( fetched_values.extent( 0 ) == target_values.extent( 0 ) );
+    DTK_REQUIRE( fetched_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    Kokkos::deep_copy( target_values, fetched_values );
+}
+
+template <typename DeviceType>
+typename PointCloudOperator<DeviceType>::LocalMatrix
+NearestNeighborOperator<DeviceType>::getLocalMatrix() const
+{
+    int const n_target_points = _fetch_plan.import_indices.extent( 0 );
+    Kokkos::View<int *, DeviceType> offset(
+        Kokkos::ViewAllocateWithoutInitializing( "offset" ),
+        n_target_points + 1 );
+    iota( offset );
+    Kokkos::View<double *, DeviceType> coeffs(
+        Kokkos::ViewAllocateWithoutInitializing( "coeffs" ), n_target_points );
+    Kokkos::deep_copy( coeffs, 1. );
+
+    typename PointCloudOperator<DeviceType>::LocalMatrix matrix;
+    matrix.plan = &_fetch_plan;
+    matrix.offset = offset;
+    matrix.coeffs = coeffs;
+    return matrix;
+}
+
+template <typename DeviceType>
+void NearestNeighborOperator<DeviceType>::applyTranspose(
+    Kokkos::View<double const **, DeviceType> target_values,
+    Kokkos::View<double **, DeviceType> source_values,
+    TransposeMerge merge ) const
+{
+    // Precondition: check that the source and target are properly sized
+    DTK_REQUIRE( _fetch_plan.import_indices.extent( 0 ) ==
+                 target_values.extent( 0 ) );
+    DTK_REQUIRE( _size == source_values.extent_int( 0 ) );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
 
-    Kokkos::deep_copy( target_values, values );
+    // Source points that are the nearest neighbor of several target points
+    // get the combination of their values.
+    this->mergeTransposed( _transpose_plan, target_values, source_values,
+                           merge );
 }
 
 } // namespace DataTransferKit
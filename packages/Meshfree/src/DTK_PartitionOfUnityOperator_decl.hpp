@@ -0,0 +1,116 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_PARTITION_OF_UNITY_OPERATOR_DECL_HPP
+#define DTK_PARTITION_OF_UNITY_OPERATOR_DECL_HPP
+
+#include <DTK_CompactlySupportedRadialBasisFunctions.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // FetchPlan
+#include <DTK_DistributedSearchTree.hpp>
+#include <DTK_PointCloudOperator.hpp>
+
+#include <Teuchos_ParameterList.hpp>
+
+namespace DataTransferKit
+{
+
+/**
+ * Partition of unity interpolation with radial basis functions.  The target
+ * points are covered with overlapping spherical patches centered on a regular
+ * grid.  The source values are interpolated on each patch by a radial basis
+ * function interpolant, i.e. a small dense system is solved per patch, and
+ * the local interpolants are blended with compactly supported weights (the
+ * radial basis function scaled to the patch radius) that sum up to one.
+ * Source values are reproduced exactly at the source points and the accuracy
+ * approaches the one of global radial basis function interpolation without
+ * the global dense solve.
+ */
+template <typename DeviceType,
+          typename CompactlySupportedRadialBasisFunction = Wendland<0>,
+          int DIM = 3>
+class PartitionOfUnityOperator : public PointCloudOperator<DeviceType>
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+  public:
+    /**
+     * The patches are set up with the following parameters:
+     *  - "Patch Spacing" (double, required): distance between the centers of
+     *    two neighboring patches along each axis.
+     *  - "Patch Radius" (double, default spacing * sqrt(DIM)): radius of the
+     *    patches.  It must exceed spacing * sqrt(DIM) / 2 for the patches to
+     *    cover the target points.
+     *  - "Support Radius" (double, default twice the patch radius): support of
+     *    the radial basis function in the local interpolants.
+     *
+     * The radial basis function must be positive definite in DIM dimensions
+     * for the local systems to be solved with a Cholesky factorization.
+     */
+    PartitionOfUnityOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params );
+
+    /**
+     * Same as above but the search tree over the source points has already
+     * been built, e.g., by another operator over the same points.
+     */
+    PartitionOfUnityOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params );
+
+    void
+    apply( Kokkos::View<double const *, DeviceType> source_values,
+           Kokkos::View<double *, DeviceType> target_values ) const override;
+
+    void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const override;
+
+    // Applying the operator to a subset of the target points is not
+    // supported.
+    using PointCloudOperator<DeviceType>::apply;
+    using PointCloudOperator<DeviceType>::applyComponents;
+
+    typename PointCloudOperator<DeviceType>::FetchPlan const *
+    getFetchPlan() const override
+    {
+        return &_fetch_plan;
+    }
+
+    void
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values )
+        const override;
+
+  private:
+    Teuchos::RCP<Teuchos::Comm<int> const> _comm;
+    unsigned int const _n_source_points;
+    typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan
+        _fetch_plan;
+    // Sparse rows of the operator over the source values fetched for all the
+    // patches.
+    Kokkos::View<int *, DeviceType> _offset;
+    Kokkos::View<int *, DeviceType> _columns;
+    Kokkos::View<double *, DeviceType> _coeffs;
+};
+
+} // end namespace DataTransferKit
+
+#endif
@@ -0,0 +1,203 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_PARTITION_OF_UNITY_OPERATOR_DEF_HPP
+#define DTK_PARTITION_OF_UNITY_OPERATOR_DEF_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsMovingLeastSquaresOperatorImpl.hpp> // makeWithinQueries
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // makeDistributedSearchTree, fetch
+#include <DTK_DetailsPartitionOfUnityOperatorImpl.hpp>
+#include <DTK_DistributedSearchTree.hpp>
+
+#include <cmath>
+
+namespace DataTransferKit
+{
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          int DIM>
+PartitionOfUnityOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                         DIM>::
+    PartitionOfUnityOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
+    : PartitionOfUnityOperator(
+          comm,
+          Details::NearestNeighborOperatorImpl<
+              DeviceType>::makeDistributedSearchTree( comm, source_points ),
+          source_points, target_points, params )
+{
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          int DIM>
+PartitionOfUnityOperator<DeviceType, CompactlySupportedRadialBasisFunction,
+                         DIM>::
+    PartitionOfUnityOperator(
+        Teuchos::RCP<Teuchos::Comm<int> const> const &comm,
+        DistributedSearchTree<DeviceType> const &search_tree,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            source_points,
+        Kokkos::View<Coordinate const **, Kokkos::LayoutStride, DeviceType>
+            target_points,
+        Teuchos::ParameterList const &params )
+    : _comm( comm )
+    , _n_source_points( source_points.extent( 0 ) )
+    , _offset( "offset" )
+    , _columns( "columns" )
+    , _coeffs( "pum_coefficients" )
+{
+    DTK_REQUIRE( source_points.extent_int( 1 ) == DIM );
+    DTK_REQUIRE( target_points.extent_int( 1 ) == DIM );
+    DTK_CHECK( !search_tree.empty() );
+
+    DTK_REQUIRE( params.isParameter( "Patch Spacing" ) );
+    double const spacing = params.get<double>( "Patch Spacing" );
+    DTK_REQUIRE( spacing > 0. );
+    double const sqrt_dim = std::sqrt( static_cast<double>( DIM ) );
+    double const patch_radius = params.isParameter( "Patch Radius" )
+                                    ? params.get<double>( "Patch Radius" )
+                                    : spacing * sqrt_dim;
+    DTK_REQUIRE( patch_radius > 0.5 * spacing * sqrt_dim );
+    double const support_radius = params.isParameter( "Support Radius" )
+                                      ? params.get<double>( "Support Radius" )
+                                      : 2. * patch_radius;
+    DTK_REQUIRE( support_radius > 0. );
+
+    // Cover the target points with patches and find, for each of them, the
+    // patches it belongs to.
+    using Impl = Details::PartitionOfUnityOperatorImpl<DeviceType>;
+    auto const grid =
+        Impl::template makePatchGrid<DIM>( target_points, spacing );
+    Kokkos::View<int *, DeviceType> pair_offset( "pair_offset" );
+    Kokkos::View<int *, DeviceType> pair_patches( "pair_patches" );
+    Kokkos::View<double *, DeviceType> pair_distances( "pair_distances" );
+    Impl::template findCoveringPatches<DIM>( target_points, grid, patch_radius,
+                                             pair_offset, pair_patches,
+                                             pair_distances );
+    auto patch_centers =
+        Impl::template compactPatches<DIM>( grid, pair_patches );
+
+    // For each patch, query the source points within the patch radius.
+    Kokkos::View<double *, DeviceType> radius( "radius",
+                                               patch_centers.extent( 0 ) );
+    Kokkos::deep_copy( radius, patch_radius );
+    auto queries = Details::MovingLeastSquaresOperatorImpl<
+        DeviceType>::template makeWithinQueries<DIM>( patch_centers, radius );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> patch_offset( "patch_offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    search_tree.query( queries, indices, patch_offset, ranks );
+
+    // Build the communication plan that is reused in apply() and retrieve the
+    // coordinates of the source points in all patches.
+    // NOTE: This is the last collective.
+    _fetch_plan = Details::NearestNeighborOperatorImpl<
+        DeviceType>::makeFetchPlan( _comm, ranks, indices );
+    Kokkos::View<Coordinate const **, DeviceType> patch_points =
+        Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+            _fetch_plan, source_points );
+
+    Impl::template computeCoefficients<DIM>(
+        target_points, patch_points, patch_offset, pair_offset, pair_patches,
+        pair_distances, patch_radius, support_radius,
+        CompactlySupportedRadialBasisFunction(), _offset, _columns, _coeffs );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          int DIM>
+void PartitionOfUnityOperator<DeviceType,
+                              CompactlySupportedRadialBasisFunction, DIM>::
+    apply( Kokkos::View<double const *, DeviceType> source_values,
+           Kokkos::View<double *, DeviceType> target_values ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+
+    // Retrieve values for all source points in the patches
+    source_values = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_values );
+
+    auto new_target_values = Details::PartitionOfUnityOperatorImpl<
+        DeviceType>::computeTargetValues( _offset, _columns, _coeffs,
+                                          source_values );
+
+    Kokkos::deep_copy( target_values, new_target_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          int DIM>
+void PartitionOfUnityOperator<DeviceType,
+                              CompactlySupportedRadialBasisFunction, DIM>::
+    applyComponents( Kokkos::View<double const **, DeviceType> source_values,
+                     Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the source and the target are properly sized
+    DTK_REQUIRE( source_values.extent( 0 ) == _n_source_points );
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( source_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    // Retrieve values for all source points in the patches
+    source_values = Details::NearestNeighborOperatorImpl<DeviceType>::fetch(
+        _fetch_plan, source_values );
+
+    auto new_target_values = Details::PartitionOfUnityOperatorImpl<
+        DeviceType>::computeTargetValues( _offset, _columns, _coeffs,
+                                          source_values );
+
+    Kokkos::deep_copy( target_values, new_target_values );
+}
+
+template <typename DeviceType, typename CompactlySupportedRadialBasisFunction,
+          int DIM>
+void PartitionOfUnityOperator<DeviceType,
+                              CompactlySupportedRadialBasisFunction, DIM>::
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values ) const
+{
+    // Precondition: check that the fetched and the target values are
+    // properly sized
+    DTK_REQUIRE( fetched_values.extent( 0 ) ==
+                 _fetch_plan.import_indices.extent( 0 ) );
+    DTK_REQUIRE( target_values.extent( 0 ) == _offset.extent( 0 ) - 1 );
+    DTK_REQUIRE( fetched_values.extent( 1 ) == target_values.extent( 1 ) );
+
+    auto new_target_values = Details::PartitionOfUnityOperatorImpl<
+        DeviceType>::computeTargetValues( _offset, _columns, _coeffs,
+                                          fetched_values );
+
+    Kokkos::deep_copy( target_values, new_target_values );
+}
+
+} // end namespace DataTransferKit
+
+// Explicit instantiation macro.  The local systems are solved with a Cholesky
+// factorization so only the radial basis functions that are positive definite
+// in three dimensions are instantiated.
+#define DTK_PARTITION_OF_UNITY_OPERATOR_INSTANT( NODE )                        \
+    template class PartitionOfUnityOperator<typename NODE::device_type,        \
+                                            Wendland<0>, 3>;                   \
+    template class PartitionOfUnityOperator<typename NODE::device_type,        \
+                                            Wendland<2>, 3>;                   \
+    template class PartitionOfUnityOperator<typename NODE::device_type,        \
+                                            Wendland<4>, 3>;                   \
+    template class PartitionOfUnityOperator<typename NODE::device_type,        \
+                                            Wendland<6>, 3>;                   \
+    template class PartitionOfUnityOperator<typename NODE::device_type,        \
+                                            Wendland<0>, 2>;
+
+#endif
@@ -13,6 +13,9 @@
 #define DTK_POINT_CLOUD_OPERATOR_DECL_HPP
 
 #include <DTK_ConfigDefs.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsNearestNeighborOperatorImpl.hpp> // FetchPlan
+#include <DTK_Reducers.hpp>
 
 #include <Kokkos_View.hpp>
 #include <Teuchos_Comm.hpp>
@@ -20,6 +23,19 @@
 namespace DataTransferKit
 {
 
+// How applyTranspose() combines the values that come back to the same source
+// point.  atomic_sum adds them with atomics.  The other modes combine them
+// one source point per thread after the values have been grouped by source
+// point once and for all when the operator is built, which does not depend
+// on the scheduling of the threads.
+enum class TransposeMerge
+{
+    atomic_sum,
+    sum,
+    min,
+    max
+};
+
 template <typename DeviceType>
 class PointCloudOperator
 {
@@ -29,6 +45,150 @@ class PointCloudOperator
     virtual void
     apply( Kokkos::View<double const *, DeviceType> source_values,
            Kokkos::View<double *, DeviceType> target_values ) const = 0;
+
+    // Transfer multiple components at once, e.g. all the components of a
+    // vector field or several fields stacked together, with a single
+    // exchange.  Views are dimensioned (number of points, number of
+    // components).
+    // NOTE: This is not an overload of apply() on purpose.  Calls with
+    // non-const views would be ambiguous since the converting constructor of
+    // Kokkos::View is not constrained.
+    virtual void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values ) const = 0;
+
+    using FetchPlan =
+        typename Details::NearestNeighborOperatorImpl<DeviceType>::FetchPlan;
+
+    // Plan with which applyComponents() fetches the source values from other
+    // processes, or nullptr if the operator does not work this way.  Going
+    // through the plan and applyFetched() lets the exchanges of several
+    // operators be combined into a single one.
+    virtual FetchPlan const *getFetchPlan() const { return nullptr; }
+
+    // Compute the target values from the source values that have been
+    // fetched with the plan above, i.e. the second half of
+    // applyComponents().
+    virtual void
+    applyFetched( Kokkos::View<double const **, DeviceType> fetched_values,
+                  Kokkos::View<double **, DeviceType> target_values ) const
+    {
+        (void)fetched_values;
+        (void)target_values;
+        throw DataTransferKitException(
+            "The operator does not fetch the source values with a plan" );
+    }
+
+    // The operator as a sparse matrix over the source values it fetches.
+    // Row i computes the target value rows(i), or i if rows is empty, as the
+    // sum of coeffs(j) times the j-th value fetched with plan for
+    // offset(i) <= j < offset(i + 1).  The rows are on the processes of the
+    // target points.  This is what ComposedOperator multiplies.
+    struct LocalMatrix
+    {
+        FetchPlan const *plan = nullptr;
+        Kokkos::View<size_t const *, DeviceType> rows;
+        Kokkos::View<int const *, DeviceType> offset;
+        Kokkos::View<double const *, DeviceType> coeffs;
+    };
+
+    // The views are shared with the operator or computed on the fly, and the
+    // plan belongs to the operator, which must outlive the matrix.
+    virtual LocalMatrix getLocalMatrix() const
+    {
+        throw DataTransferKitException(
+            "The operator cannot be expressed as a local matrix" );
+    }
+
+    // Apply the operator to the target points flagged in active_targets
+    // only, e.g. the ones near a moving front in adaptive or multi-rate
+    // couplings.  Only the source values these target points depend on are
+    // fetched, with the subset of the plan of apply() set up for the flags,
+    // and the other target values are left untouched.  This must be called
+    // on all processes.
+    void apply( Kokkos::View<double const *, DeviceType> source_values,
+                Kokkos::View<double *, DeviceType> target_values,
+                Kokkos::View<bool const *, DeviceType> active_targets ) const
+    {
+        applyComponents(
+            Kokkos::View<double const **, DeviceType>(
+                source_values.data(), source_values.extent( 0 ), 1 ),
+            Kokkos::View<double **, DeviceType>(
+                target_values.data(), target_values.extent( 0 ), 1 ),
+            active_targets );
+    }
+
+    // Same as above for multiple components, see applyComponents().
+    virtual void applyComponents(
+        Kokkos::View<double const **, DeviceType> source_values,
+        Kokkos::View<double **, DeviceType> target_values,
+        Kokkos::View<bool const *, DeviceType> active_targets ) const
+    {
+        (void)source_values;
+        (void)target_values;
+        (void)active_targets;
+        throw DataTransferKitException(
+            "The operator cannot be applied to a subset of the target points" );
+    }
+
+    // Apply the transpose of the operator, i.e. send the target values back
+    // to the source points they were computed from and sum them there, e.g.
+    // for two-way coupling or conservative corrections.  The plans built for
+    // apply() are reused in reverse.  Views are dimensioned as for
+    // applyComponents().
+    void
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values ) const
+    {
+        applyTranspose( target_values, source_values,
+                        TransposeMerge::atomic_sum );
+    }
+
+    // Same as above with the values that come back to the same source point
+    // combined as given by merge instead of summed with atomics.  Source
+    // points that receive nothing are set to zero.
+    virtual void
+    applyTranspose( Kokkos::View<double const **, DeviceType> target_values,
+                    Kokkos::View<double **, DeviceType> source_values,
+                    TransposeMerge merge ) const
+    {
+        (void)target_values;
+        (void)source_values;
+        (void)merge;
+        throw DataTransferKitException(
+            "The operator does not implement its transpose" );
+    }
+
+  protected:
+    // Send the values back along the transpose plan and combine them into
+    // source_values, which is reset first.
+    template <typename View>
+    static void
+    mergeTransposed( FetchPlan const &transpose_plan, View values,
+                     Kokkos::View<double **, DeviceType> source_values,
+                     TransposeMerge merge )
+    {
+        using Impl = Details::NearestNeighborOperatorImpl<DeviceType>;
+        Kokkos::deep_copy( source_values, 0. );
+        switch ( merge )
+        {
+        case TransposeMerge::atomic_sum:
+            Impl::addTransposed( transpose_plan, values, source_values );
+            break;
+        case TransposeMerge::sum:
+            Impl::mergeTransposed( transpose_plan, values, source_values,
+                                   SumReducer<double>() );
+            break;
+        case TransposeMerge::min:
+            Impl::mergeTransposed( transpose_plan, values, source_values,
+                                   MinReducer<double>() );
+            break;
+        case TransposeMerge::max:
+            Impl::mergeTransposed( transpose_plan, values, source_values,
+                                   MaxReducer<double>() );
+            break;
+        }
+    }
 };
 
 } // end namespace DataTransferKit
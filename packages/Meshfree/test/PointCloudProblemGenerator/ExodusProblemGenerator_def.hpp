@@ -204,7 +204,7 @@ void ExodusProblemGenerator<Scalar, SourceDevice, TargetDevice>::
                                   : _comm->getSize() - 1;
         }
     }
-    Tpetra::Distributor distributor( _comm );
+    Details::Distributor distributor( _comm );
     int num_node_import = distributor.createFromSends( export_ranks() );
 
     // Send the coordinates to their new owning rank.
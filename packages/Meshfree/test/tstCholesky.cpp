@@ -0,0 +1,168 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsCholeskyImpl.hpp>
+
+#include <Kokkos_View.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Cholesky, factorize_and_solve, DeviceType )
+{
+    // Matrices of different sizes, including an empty one.
+    std::vector<int> const sizes = {3, 1, 0, 17, 32};
+    int const n_matrices = sizes.size();
+    Kokkos::View<int *, DeviceType> offset( "offset", n_matrices + 1 );
+    Kokkos::View<int *, DeviceType> matrix_offset( "matrix_offset",
+                                                   n_matrices + 1 );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    auto matrix_offset_host = Kokkos::create_mirror_view( matrix_offset );
+    offset_host( 0 ) = 0;
+    matrix_offset_host( 0 ) = 0;
+    for ( int m = 0; m < n_matrices; ++m )
+    {
+        offset_host( m + 1 ) = offset_host( m ) + sizes[m];
+        matrix_offset_host( m + 1 ) =
+            matrix_offset_host( m ) + sizes[m] * sizes[m];
+    }
+    Kokkos::deep_copy( offset, offset_host );
+    Kokkos::deep_copy( matrix_offset, matrix_offset_host );
+
+    // Fill the matrices with B B^T + n I, which is symmetric positive
+    // definite.
+    int const size = matrix_offset_host( n_matrices );
+    Kokkos::View<double *, DeviceType> matrices( "matrices", size );
+    auto matrices_host = Kokkos::create_mirror_view( matrices );
+    std::default_random_engine random_engine;
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    for ( int m = 0; m < n_matrices; ++m )
+    {
+        int const n = sizes[m];
+        std::vector<double> b( n * n );
+        for ( auto &x : b )
+            x = distribution( random_engine );
+        for ( int i = 0; i < n; ++i )
+            for ( int j = 0; j < n; ++j )
+            {
+                double value = ( i == j ) ? n : 0.;
+                for ( int k = 0; k < n; ++k )
+                    value += b[i * n + k] * b[j * n + k];
+                matrices_host( matrix_offset_host( m ) + i * n + j ) = value;
+            }
+    }
+    Kokkos::deep_copy( matrices, matrices_host );
+    auto original_matrices_host = Kokkos::create_mirror( matrices );
+    Kokkos::deep_copy( original_matrices_host, matrices );
+
+    using Cholesky = DataTransferKit::Details::CholeskyFunctor<DeviceType>;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    size_t n_failed = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "factorize" ),
+        Kokkos::TeamPolicy<ExecutionSpace>( n_matrices,
+                                            Cholesky::teamSize( 32 ) ),
+        Cholesky( offset, matrix_offset, matrices ), n_failed );
+    TEST_EQUALITY( n_failed, 0u );
+
+    // Check that L L^T is the original matrix.  Some of the entries are
+    // close to zero so they are compared with an offset.
+    Kokkos::deep_copy( matrices_host, matrices );
+    double const relative_tolerance = 1e-12;
+    for ( int m = 0; m < n_matrices; ++m )
+    {
+        int const n = sizes[m];
+        int const shift = matrix_offset_host( m );
+        for ( int i = 0; i < n; ++i )
+            for ( int j = 0; j < n; ++j )
+            {
+                double value = 0.;
+                for ( int k = 0; k <= std::min( i, j ); ++k )
+                    value += matrices_host( shift + i * n + k ) *
+                             matrices_host( shift + j * n + k );
+                TEST_FLOATING_EQUALITY(
+                    value - original_matrices_host( shift + i * n + j ) + 1.,
+                    1., relative_tolerance );
+            }
+    }
+
+    // Solve A x = A 1 with the factors.
+    for ( int m = 0; m < n_matrices; ++m )
+    {
+        int const n = sizes[m];
+        int const shift = matrix_offset_host( m );
+        std::vector<double> x( n, 0. );
+        for ( int i = 0; i < n; ++i )
+            for ( int j = 0; j < n; ++j )
+                x[i] += original_matrices_host( shift + i * n + j );
+        auto l = Kokkos::subview(
+            matrices_host, Kokkos::make_pair( shift, shift + n * n ) );
+        Kokkos::View<double *, Kokkos::HostSpace, Kokkos::MemoryUnmanaged> b(
+            x.data(), n );
+        Cholesky::solve( l, n, b );
+        for ( int i = 0; i < n; ++i )
+            TEST_FLOATING_EQUALITY( x[i], 1., 1e-10 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( Cholesky, not_positive_definite,
+                                   DeviceType )
+{
+    // The second matrix is symmetric but indefinite.
+    Kokkos::View<int *, DeviceType> offset( "offset", 3 );
+    Kokkos::View<int *, DeviceType> matrix_offset( "matrix_offset", 3 );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    auto matrix_offset_host = Kokkos::create_mirror_view( matrix_offset );
+    offset_host( 0 ) = 0;
+    offset_host( 1 ) = 2;
+    offset_host( 2 ) = 4;
+    matrix_offset_host( 0 ) = 0;
+    matrix_offset_host( 1 ) = 4;
+    matrix_offset_host( 2 ) = 8;
+    Kokkos::deep_copy( offset, offset_host );
+    Kokkos::deep_copy( matrix_offset, matrix_offset_host );
+
+    Kokkos::View<double *, DeviceType> matrices( "matrices", 8 );
+    auto matrices_host = Kokkos::create_mirror_view( matrices );
+    std::vector<double> const values = {2., 1., 1., 2., 1., 2., 2., 1.};
+    for ( int i = 0; i < 8; ++i )
+        matrices_host( i ) = values[i];
+    Kokkos::deep_copy( matrices, matrices_host );
+
+    using Cholesky = DataTransferKit::Details::CholeskyFunctor<DeviceType>;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    size_t n_failed = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "factorize" ),
+        Kokkos::TeamPolicy<ExecutionSpace>( 2, Cholesky::teamSize( 2 ) ),
+        Cholesky( offset, matrix_offset, matrices ), n_failed );
+    TEST_EQUALITY( n_failed, 1u );
+}
+
+// Include the test macros.
+#include "DataTransferKitMeshfree_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( Cholesky, factorize_and_solve,       \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( Cholesky, not_positive_definite,     \
+                                          DeviceType##NODE )
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -14,7 +14,10 @@
 
 #include <Teuchos_DefaultComm.hpp>
 #include <Teuchos_UnitTestHarness.hpp>
-#include <Tpetra_Distributor.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 template <
     typename View,
@@ -58,7 +61,7 @@ struct Helper
                             View2 const &v_ref, bool &success,
                             Teuchos::FancyOStream &out )
     {
-        Tpetra::Distributor distributor( comm );
+        DataTransferKit::Details::Distributor distributor( comm );
         distributor.createFromSends( toArray( ranks ) );
 
         // NOTE here we assume that the reference solution is sized properly
@@ -81,10 +84,22 @@ struct Helper
                             View2 const &v_exp, View2 const &v_ref,
                             bool &success, Teuchos::FancyOStream &out )
     {
-        auto v_imp = DataTransferKit::Details::NearestNeighborOperatorImpl<
-            DeviceType>::fetch( comm, ranks, indices, v_exp );
+        using NearestNeighborOperatorImpl =
+            DataTransferKit::Details::NearestNeighborOperatorImpl<DeviceType>;
+
+        auto v_imp = NearestNeighborOperatorImpl::fetch( comm, ranks, indices,
+                                                         v_exp );
 
         TEST_COMPARE_ARRAYS( toArray( v_imp ), toArray( v_ref ) );
+
+        // the communication plan can be reused
+        auto const plan =
+            NearestNeighborOperatorImpl::makeFetchPlan( comm, ranks, indices );
+        for ( int i = 0; i < 2; ++i )
+        {
+            v_imp = NearestNeighborOperatorImpl::fetch( plan, v_exp );
+            TEST_COMPARE_ARRAYS( toArray( v_imp ), toArray( v_ref ) );
+        }
     }
 };
 
@@ -220,6 +235,144 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsNearestNeighborOperatorImpl, fetch,
                                     out );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsNearestNeighborOperatorImpl,
+                                   exchange_combined, DeviceType )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using NearestNeighborOperatorImpl =
+        DataTransferKit::Details::NearestNeighborOperatorImpl<DeviceType>;
+
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+
+    // The first plan fetches from the same process, the second one from all
+    // the processes.
+    Kokkos::View<int *, DeviceType> ranks( "ranks", comm_size );
+    Kokkos::View<int *, DeviceType> indices( "indices", comm_size );
+    Kokkos::parallel_for( Kokkos::RangePolicy<ExecutionSpace>( 0, comm_size ),
+                          KOKKOS_LAMBDA( int i ) {
+                              ranks( i ) = comm_rank;
+                              indices( i ) = comm_size - 1 - i;
+                          } );
+    Kokkos::fence();
+    Kokkos::View<int *, DeviceType> all_ranks( "all_ranks", comm_size );
+    DataTransferKit::iota( all_ranks, 0 );
+
+    using Plan = typename NearestNeighborOperatorImpl::FetchPlan;
+    std::vector<Plan> const plans = {
+        NearestNeighborOperatorImpl::makeFetchPlan( comm, ranks, indices ),
+        NearestNeighborOperatorImpl::makeFetchPlan( comm, all_ranks,
+                                                    indices )};
+
+    // The parts have a different number of components.
+    std::vector<Kokkos::View<double **, DeviceType>> values;
+    std::vector<DataTransferKit::Details::CombinedExchangePart> parts;
+    for ( int k = 0; k < 2; ++k )
+    {
+        int const n_components = k + 1;
+        Kokkos::View<double **, DeviceType> v( "v", comm_size, n_components );
+        Kokkos::parallel_for(
+            Kokkos::RangePolicy<ExecutionSpace>( 0, comm_size ),
+            KOKKOS_LAMBDA( int i ) {
+                for ( int j = 0; j < n_components; ++j )
+                    v( i, j ) = comm_rank * comm_size + i + 0.5 * j;
+            } );
+        Kokkos::fence();
+        values.push_back( v );
+
+        parts.push_back(
+            NearestNeighborOperatorImpl::makeCombinedExchangePart( plans[k],
+                                                                  v ) );
+    }
+
+    DataTransferKit::Details::exchangeCombined( comm, parts );
+
+    // The combined exchange moves the same values as separate fetches.
+    for ( int k = 0; k < 2; ++k )
+    {
+        int const n_components = k + 1;
+        Kokkos::View<double **, Kokkos::LayoutRight, Kokkos::HostSpace>
+            imports_host( "imports", comm_size, n_components );
+        TEST_EQUALITY( parts[k].imports.size(), imports_host.size() );
+        std::copy( parts[k].imports.begin(), parts[k].imports.end(),
+                   imports_host.data() );
+        Kokkos::View<double **, Kokkos::LayoutRight, DeviceType> imports(
+            "imports", comm_size, n_components );
+        Kokkos::deep_copy( imports, imports_host );
+
+        auto v_imp =
+            NearestNeighborOperatorImpl::unpackImports( plans[k], imports );
+        auto v_ref = NearestNeighborOperatorImpl::fetch( plans[k], values[k] );
+        TEST_COMPARE_ARRAYS( toArray( v_imp ), toArray( v_ref ) );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsNearestNeighborOperatorImpl,
+                                   one_sided_fetch, DeviceType )
+{
+    using NearestNeighborOperatorImpl =
+        DataTransferKit::Details::NearestNeighborOperatorImpl<DeviceType>;
+
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+
+    // Every process reads values from all the processes, some of them
+    // several times, and not in the order of the ranks.
+    int const n_values = 5;
+    int const n_requests = 2 * comm_size + 1;
+    std::vector<int> ranks_host( n_requests );
+    std::vector<int> indices_host( n_requests );
+    for ( int i = 0; i < n_requests; ++i )
+    {
+        ranks_host[i] = ( comm_rank + 3 * i ) % comm_size;
+        indices_host[i] = ( 2 * i + comm_rank ) % n_values;
+    }
+    Kokkos::View<int *, DeviceType> ranks( "ranks", n_requests );
+    Kokkos::deep_copy( ranks, Kokkos::View<int *, Kokkos::HostSpace,
+                                           Kokkos::MemoryUnmanaged>(
+                                  ranks_host.data(), n_requests ) );
+    Kokkos::View<int *, DeviceType> indices( "indices", n_requests );
+    Kokkos::deep_copy( indices, Kokkos::View<int *, Kokkos::HostSpace,
+                                             Kokkos::MemoryUnmanaged>(
+                                    indices_host.data(), n_requests ) );
+
+    auto plan = NearestNeighborOperatorImpl::makeFetchPlan( comm, ranks,
+                                                            indices );
+    auto one_sided_plan = plan;
+    one_sided_plan.one_sided =
+        std::make_shared<DataTransferKit::Details::OneSidedFetch>(
+            comm, Teuchos::ArrayView<int const>( ranks_host ),
+            Teuchos::ArrayView<int const>( indices_host ), n_values );
+
+    Kokkos::View<int *, DeviceType> v( "v", n_values );
+    DataTransferKit::iota( v, comm_rank * n_values );
+    Kokkos::View<double **, DeviceType> w( "w", n_values, 3 );
+    auto w_host = Kokkos::create_mirror_view( w );
+    for ( int i = 0; i < n_values; ++i )
+        for ( int j = 0; j < 3; ++j )
+            w_host( i, j ) = comm_rank + 0.1 * i + 0.01 * j;
+    Kokkos::deep_copy( w, w_host );
+
+    // The values are the same as with the distributor, also when the window
+    // of a given size is reused.
+    for ( int k = 0; k < 2; ++k )
+    {
+        auto v_ref = NearestNeighborOperatorImpl::fetch( plan, v );
+        auto v_one_sided =
+            NearestNeighborOperatorImpl::fetch( one_sided_plan, v );
+        TEST_COMPARE_ARRAYS( toArray( v_one_sided ), toArray( v_ref ) );
+        auto w_ref = NearestNeighborOperatorImpl::fetch( plan, w );
+        auto w_one_sided =
+            NearestNeighborOperatorImpl::fetch( one_sided_plan, w );
+        TEST_COMPARE_ARRAYS( toArray( w_one_sided ), toArray( w_ref ) );
+        Kokkos::deep_copy( v, -1 );
+    }
+}
+
 // Include the test macros.
 #include "DataTransferKitSearch_ETIHelperMacros.h"
 
@@ -230,7 +383,12 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsNearestNeighborOperatorImpl, fetch,
                                           send_across_network,                 \
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsNearestNeighborOperatorImpl,  \
-                                          fetch, DeviceType##NODE )
+                                          fetch, DeviceType##NODE )            \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        DetailsNearestNeighborOperatorImpl, exchange_combined,                 \
+        DeviceType##NODE )                                                     \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsNearestNeighborOperatorImpl,  \
+                                          one_sided_fetch, DeviceType##NODE )
 
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
@@ -15,14 +15,18 @@
 #include <DTK_MovingLeastSquaresOperator_decl.hpp>
 #include <DTK_MovingLeastSquaresOperator_def.hpp>
 #include <Kokkos_Core.hpp>
+#include <Teuchos_CommHelpers.hpp>
 #include <Teuchos_DefaultComm.hpp>
 #include <Teuchos_ParameterList.hpp>
+#include <Tpetra_MultiVector.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <memory>
 #include <numeric>
 #include <random>
+#include <string>
 #include <vector>
 
 int constexpr DIM = 3;
@@ -422,6 +426,803 @@ TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
         TEST_ASSERT( std::isfinite( target_values_host[i] ) );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator, crs_matrix,
+                                   DeviceType, RadialBasisFunction,
+                                   PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+    using Vector = Tpetra::MultiVector<double, int, GlobalOrdinal,
+                                       typename Operator::Node>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    // Shift the target points so that some of their neighbors live on the
+    // next process.
+    std::array<int, DIM> n_source_points_grid = {10, 10, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {9, 9, 1};
+    offset = {0.5, 0.5,
+              static_cast<double>( ( comm_rank + 1 ) % comm_size ) - 0.25};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = 4 + 2 * source_points_arr[i][0] +
+                               3 * source_points_arr[i][1] -
+                               2 * source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+
+    Operator mlsop( comm, source_points, target_points );
+    mlsop.apply( source_values, target_values );
+
+    auto matrix = mlsop.getCrsMatrix();
+    TEST_EQUALITY( matrix->getDomainMap()->getNodeNumElements(),
+                   n_source_points );
+    TEST_EQUALITY( matrix->getRangeMap()->getNodeNumElements(),
+                   n_target_points );
+
+    // Applying the matrix must give the same result as applying the operator.
+    Vector x( matrix->getDomainMap(), 1 );
+    {
+        auto x_data = x.getDataNonConst( 0 );
+        for ( unsigned int i = 0; i < n_source_points; ++i )
+            x_data[i] = source_values_arr[i];
+    }
+    Vector y( matrix->getRangeMap(), 1 );
+    matrix->apply( x, y );
+
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( y.getData( 0 ), target_values_host, 1e-11 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator, save_and_load,
+                                   DeviceType, RadialBasisFunction,
+                                   PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    // Shift the target points so that some of their neighbors live on the
+    // next process and the saved communication plan is not trivial.
+    std::array<int, DIM> n_source_points_grid = {10, 10, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {9, 9, 1};
+    offset = {0.5, 0.5,
+              static_cast<double>( ( comm_rank + 1 ) % comm_size ) - 0.25};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = 4 + 2 * source_points_arr[i][0] +
+                               3 * source_points_arr[i][1] -
+                               2 * source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+    Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                      n_target_points );
+
+    std::string const filename = "mls_operator";
+    Operator mlsop( comm, source_points, target_points );
+    mlsop.apply( source_values, target_values );
+    mlsop.save( filename );
+    comm->barrier();
+
+    // The operator read from disk must give the same result.
+    Operator loaded_mlsop( comm, filename, source_points, target_points );
+    Kokkos::View<double *, DeviceType> loaded_target_values(
+        "loaded_target_values", n_target_points );
+    loaded_mlsop.apply( source_values, loaded_target_values );
+
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    auto loaded_target_values_host =
+        Kokkos::create_mirror_view( loaded_target_values );
+    Kokkos::deep_copy( loaded_target_values_host, loaded_target_values );
+    TEST_COMPARE_ARRAYS( loaded_target_values_host, target_values_host );
+
+    // The operator cannot be reused if the points have moved.
+    target_points_arr[0][0] += 0.1;
+    auto moved_target_points =
+        Helper<DeviceType>::makePoints( target_points_arr );
+    TEST_THROW( Operator( comm, filename, source_points, moved_target_points ),
+                DataTransferKitException );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   support_radius, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    std::array<int, DIM> n_source_points_grid = {40, 40, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {3, 3, 1};
+    offset = {18.5, 18.5, static_cast<double>( comm_rank )};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    std::vector<double> target_values_ref( n_target_points );
+
+    auto f = []( std::array<double, DIM> p ) -> double {
+        return 4 + 2 * p[0] + 3 * p[1] - 2 * p[2];
+    };
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = f( source_points_arr[i] );
+    for ( unsigned int i = 0; i < n_target_points; ++i )
+        target_values_ref[i] = f( target_points_arr[i] );
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    // Fixed radius that is large enough for all target points and a radius
+    // that is too small and must be widened.
+    Teuchos::ParameterList fixed_radius;
+    fixed_radius.set( "Support Radius", 2.5 );
+    Teuchos::ParameterList adaptive_radius;
+    adaptive_radius.set( "Support Radius", 0.1 );
+    adaptive_radius.set( "Adaptive Radius", true );
+    for ( auto const &params : {fixed_radius, adaptive_radius} )
+    {
+        MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                   PolynomialBasis>
+            mlsop( comm, source_points, target_points, params );
+
+        auto target_values =
+            Helper<DeviceType>::makeValues( target_values_arr );
+        mlsop.apply( source_values, target_values );
+
+        auto target_values_host = Kokkos::create_mirror_view( target_values );
+        Kokkos::deep_copy( target_values_host, target_values );
+        TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref,
+                                      1e-11 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator, gradient,
+                                   DeviceType, RadialBasisFunction,
+                                   PolynomialBasis )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    // Each process owns its own cube of source points so that the
+    // neighborhoods of the target points span the three dimensions.
+    std::array<int, DIM> n_source_points_grid = {10, 10, 10};
+    std::array<double, DIM> offset = {0., 0.,
+                                      static_cast<double>( 20 * comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {2, 2, 2};
+    offset = {4.5, 4.5, static_cast<double>( 20 * comm_rank ) + 4.5};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    std::vector<double> target_values_ref( n_target_points );
+    std::vector<double> target_gradients_ref( DIM * n_target_points );
+
+    // Linear functions are reproduced exactly by the fit, so is their
+    // gradient.
+    auto f = []( std::array<double, DIM> p ) -> double {
+        return 4 + 2 * p[0] + 3 * p[1] - 2 * p[2];
+    };
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = f( source_points_arr[i] );
+    for ( unsigned int i = 0; i < n_target_points; ++i )
+    {
+        target_values_ref[i] = f( target_points_arr[i] );
+        target_gradients_ref[DIM * i + 0] = 2.;
+        target_gradients_ref[DIM * i + 1] = 3.;
+        target_gradients_ref[DIM * i + 2] = -2.;
+    }
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    using Operator =
+        MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                   PolynomialBasis>;
+    Teuchos::ParameterList params;
+    params.set( "Support Radius", 2.5 );
+    params.set( "Compute Gradient", true );
+    Operator mlsop( comm, source_points, target_points, params );
+
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    Kokkos::View<double **, DeviceType> target_gradients(
+        "target_gradients", n_target_points, DIM );
+    mlsop.applyWithGradient( source_values, target_values, target_gradients );
+
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref,
+                                  1e-11 );
+
+    auto target_gradients_host =
+        Kokkos::create_mirror_view( target_gradients );
+    Kokkos::deep_copy( target_gradients_host, target_gradients );
+    std::vector<double> target_gradients_arr( DIM * n_target_points );
+    for ( unsigned int i = 0; i < n_target_points; ++i )
+        for ( int d = 0; d < DIM; ++d )
+            target_gradients_arr[DIM * i + d] = target_gradients_host( i, d );
+    TEST_COMPARE_FLOATING_ARRAYS( target_gradients_arr, target_gradients_ref,
+                                  1e-10 );
+
+    // The gradient coefficients are only computed on request.
+    params.set( "Compute Gradient", false );
+    Operator no_gradient( comm, source_points, target_points, params );
+    TEST_THROW( no_gradient.applyWithGradient( source_values, target_values,
+                                               target_gradients ),
+                DataTransferKitException );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   spatial_reordering, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+    using Vector = Tpetra::MultiVector<double, int, GlobalOrdinal,
+                                       typename Operator::Node>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    std::array<int, DIM> n_source_points_grid = {10, 10, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    // Scramble the target points so that the order of the user is far from
+    // the Z-order curve.
+    std::array<int, DIM> n_target_points_grid = {9, 9, 1};
+    offset = {0.5, 0.5,
+              static_cast<double>( ( comm_rank + 1 ) % comm_size ) - 0.25};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+    std::shuffle( target_points_arr.begin(), target_points_arr.end(),
+                  std::default_random_engine( comm_rank ) );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = std::cos( source_points_arr[i][0] ) +
+                               std::sin( source_points_arr[i][1] ) +
+                               source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    // The reordering only changes the order in which the rows are computed
+    // so the target values must be the same as without it.
+    Operator reference( comm, source_points, target_points );
+    auto target_values_ref =
+        Helper<DeviceType>::makeValues( target_values_arr );
+    reference.apply( source_values, target_values_ref );
+    auto target_values_ref_host =
+        Kokkos::create_mirror_view( target_values_ref );
+    Kokkos::deep_copy( target_values_ref_host, target_values_ref );
+
+    Teuchos::ParameterList params;
+    params.set( "Spatial Reordering", true );
+    Operator mlsop( comm, source_points, target_points, params );
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    mlsop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-12 );
+
+    // So must the rows of the matrix.
+    auto matrix = mlsop.getCrsMatrix();
+    Vector x( matrix->getDomainMap(), 1 );
+    {
+        auto x_data = x.getDataNonConst( 0 );
+        for ( unsigned int i = 0; i < n_source_points; ++i )
+            x_data[i] = source_values_arr[i];
+    }
+    Vector y( matrix->getRangeMap(), 1 );
+    matrix->apply( x, y );
+    TEST_COMPARE_FLOATING_ARRAYS( y.getData( 0 ), target_values_ref_host,
+                                  1e-11 );
+
+    // And the permutation is saved along with the coefficients.
+    std::string const filename = "mls_operator_reordered";
+    mlsop.save( filename );
+    comm->barrier();
+    Operator loaded( comm, filename, source_points, target_points );
+    Kokkos::deep_copy( target_values, 0. );
+    loaded.apply( source_values, target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-12 );
+
+    // Reordering along the Hilbert curve does not change the values either.
+    params.set( "Space Filling Curve", std::string( "Hilbert" ) );
+    Operator hilbert( comm, source_points, target_points, params );
+    Kokkos::deep_copy( target_values, 0. );
+    hilbert.apply( source_values, target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-12 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   repartition_targets, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    std::array<int, DIM> n_source_points_grid = {10, 10, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    // The target points of a process are next to the source points of the
+    // next one.
+    std::array<int, DIM> n_target_points_grid = {9, 9, 1};
+    offset = {0.5, 0.5,
+              static_cast<double>( ( comm_rank + 1 ) % comm_size ) - 0.25};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = std::cos( source_points_arr[i][0] ) +
+                               std::sin( source_points_arr[i][1] ) +
+                               source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    // The rows are computed on other processes but the target values must be
+    // the same as without repartitioning.
+    Operator reference( comm, source_points, target_points );
+    auto target_values_ref =
+        Helper<DeviceType>::makeValues( target_values_arr );
+    reference.apply( source_values, target_values_ref );
+    auto target_values_ref_host =
+        Kokkos::create_mirror_view( target_values_ref );
+    Kokkos::deep_copy( target_values_ref_host, target_values_ref );
+
+    Teuchos::ParameterList params;
+    params.set( "Repartition Targets", true );
+    Operator mlsop( comm, source_points, target_points, params );
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    mlsop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-12 );
+
+    // Along with the reordering of the rows that were received.
+    params.set( "Spatial Reordering", true );
+    Operator reordered( comm, source_points, target_points, params );
+    Kokkos::deep_copy( target_values, 0. );
+    reordered.apply( source_values, target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-12 );
+
+    // The rows are not where the matrix would expect them.
+    TEST_THROW( mlsop.getCrsMatrix(), DataTransferKitException );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator, transpose,
+                                   DeviceType, RadialBasisFunction,
+                                   PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    // Same point clouds as in repartition_targets, the neighborhoods overlap
+    // and straddle two processes.
+    std::array<int, DIM> n_source_points_grid = {10, 10, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points = Helper<DeviceType>::makePoints(
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset ) );
+    std::array<int, DIM> n_target_points_grid = {9, 9, 1};
+    offset = {0.5, 0.5,
+              static_cast<double>( ( comm_rank + 1 ) % comm_size ) - 0.25};
+    auto target_points = Helper<DeviceType>::makePoints(
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset ) );
+
+    int const n_source_points = source_points.extent( 0 );
+    int const n_target_points = target_points.extent( 0 );
+    int const n_components = 2;
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    Kokkos::View<double **, DeviceType> x( "x", n_source_points,
+                                           n_components );
+    auto x_host = Kokkos::create_mirror_view( x );
+    for ( int i = 0; i < n_source_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            x_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( x, x_host );
+    Kokkos::View<double **, DeviceType> y( "y", n_target_points,
+                                           n_components );
+    auto y_host = Kokkos::create_mirror_view( y );
+    for ( int i = 0; i < n_target_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            y_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( y, y_host );
+
+    // <A x, y> = <x, A^T y> whether the rows are where the target points are
+    // or not.
+    Teuchos::ParameterList params;
+    Operator reference( comm, source_points, target_points );
+    params.set( "Repartition Targets", true );
+    params.set( "Spatial Reordering", true );
+    Operator repartitioned( comm, source_points, target_points, params );
+    Kokkos::View<double **, DeviceType> aty_ref( "aty_ref", n_source_points,
+                                                 n_components );
+    reference.applyTranspose( y, aty_ref );
+    auto aty_ref_host = Kokkos::create_mirror_view( aty_ref );
+    Kokkos::deep_copy( aty_ref_host, aty_ref );
+    for ( Operator const *mlsop : {&reference, &repartitioned} )
+    {
+        Kokkos::View<double **, DeviceType> ax( "ax", n_target_points,
+                                                n_components );
+        mlsop->applyComponents( x, ax );
+        Kokkos::View<double **, DeviceType> aty( "aty", n_source_points,
+                                                 n_components );
+        mlsop->applyTranspose( y, aty );
+
+        auto ax_host = Kokkos::create_mirror_view( ax );
+        Kokkos::deep_copy( ax_host, ax );
+        auto aty_host = Kokkos::create_mirror_view( aty );
+        Kokkos::deep_copy( aty_host, aty );
+        double local_products[2] = {0., 0.};
+        for ( int j = 0; j < n_components; ++j )
+        {
+            for ( int i = 0; i < n_target_points; ++i )
+                local_products[0] += ax_host( i, j ) * y_host( i, j );
+            for ( int i = 0; i < n_source_points; ++i )
+                local_products[1] += x_host( i, j ) * aty_host( i, j );
+        }
+        double products[2] = {0., 0.};
+        Teuchos::reduceAll( *comm, Teuchos::REDUCE_SUM, 2, local_products,
+                            products );
+        TEST_FLOATING_EQUALITY( products[1], products[0], 1e-12 );
+
+        // The values are shifted away from zero for the relative tolerance.
+        for ( int i = 0; i < n_source_points; ++i )
+            for ( int j = 0; j < n_components; ++j )
+                TEST_FLOATING_EQUALITY( aty_host( i, j ) + 10.,
+                                        aty_ref_host( i, j ) + 10., 1e-12 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator, components,
+                                   DeviceType, RadialBasisFunction,
+                                   PolynomialBasis )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    std::array<int, DIM> n_source_points_grid = {6, 6, 1};
+    std::array<double, DIM> offset = {0., 0., static_cast<double>( comm_rank )};
+    auto source_points = Helper<DeviceType>::makePoints(
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset ) );
+    std::array<int, DIM> n_target_points_grid = {5, 5, 1};
+    offset = {0.5, 0.5, static_cast<double>( comm_rank )};
+    auto target_points = Helper<DeviceType>::makePoints(
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset ) );
+
+    int const n_source_points = source_points.extent( 0 );
+    int const n_target_points = target_points.extent( 0 );
+    int const n_components = 3;
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    Kokkos::View<double **, DeviceType> source_components(
+        "source_components", n_source_points, n_components );
+    auto source_components_host =
+        Kokkos::create_mirror_view( source_components );
+    for ( int i = 0; i < n_source_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            source_components_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( source_components, source_components_host );
+
+    MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                               PolynomialBasis>
+        mlsop( comm, source_points, target_points );
+
+    Kokkos::View<double **, DeviceType> target_components(
+        "target_components", n_target_points, n_components );
+    mlsop.applyComponents( source_components, target_components );
+    auto target_components_host =
+        Kokkos::create_mirror_view( target_components );
+    Kokkos::deep_copy( target_components_host, target_components );
+
+    // All the components at once give the same values as each of them on
+    // its own.
+    for ( int j = 0; j < n_components; ++j )
+    {
+        std::vector<double> source_values_arr( n_source_points );
+        for ( int i = 0; i < n_source_points; ++i )
+            source_values_arr[i] = source_components_host( i, j );
+        auto source_values =
+            Helper<DeviceType>::makeValues( source_values_arr );
+        Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                          n_target_points );
+        mlsop.apply( source_values, target_values );
+        auto target_values_host = Kokkos::create_mirror_view( target_values );
+        Kokkos::deep_copy( target_values_host, target_values );
+
+        // The values are shifted away from zero for the relative tolerance.
+        for ( int i = 0; i < n_target_points; ++i )
+            TEST_FLOATING_EQUALITY( target_components_host( i, j ) + 10.,
+                                    target_values_host( i ) + 10., 1e-12 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   mixed_precision, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    std::array<int, DIM> n_source_points_grid = {8, 8, 8};
+    std::array<double, DIM> offset = {0., 0.,
+                                      static_cast<double>( 20 * comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {5, 5, 5};
+    offset = {1.3, 1.6, static_cast<double>( 20 * comm_rank ) + 1.1};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = 2. +
+                               std::cos( source_points_arr[i][0] ) *
+                                   std::sin( source_points_arr[i][1] ) +
+                               0.1 * source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    Teuchos::ParameterList params;
+    params.set( "Support Radius", 2.5 );
+    Operator reference( comm, source_points, target_points, params );
+    auto target_values_ref =
+        Helper<DeviceType>::makeValues( target_values_arr );
+    reference.apply( source_values, target_values_ref );
+    auto target_values_ref_host =
+        Kokkos::create_mirror_view( target_values_ref );
+    Kokkos::deep_copy( target_values_ref_host, target_values_ref );
+
+    // The inverses are refined to double precision so the result must not
+    // be distinguishable from the one of the double precision setup.
+    params.set( "Mixed Precision", true );
+    Operator mlsop( comm, source_points, target_points, params );
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    mlsop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-10 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   single_precision_coefficients, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+    using Operator = MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                                                PolynomialBasis>;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    std::array<int, DIM> n_source_points_grid = {8, 8, 8};
+    std::array<double, DIM> offset = {0., 0.,
+                                      static_cast<double>( 20 * comm_rank )};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_source_points_grid, offset );
+
+    std::array<int, DIM> n_target_points_grid = {5, 5, 5};
+    offset = {1.3, 1.6, static_cast<double>( 20 * comm_rank ) + 1.1};
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_target_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = 2. +
+                               std::cos( source_points_arr[i][0] ) *
+                                   std::sin( source_points_arr[i][1] ) +
+                               0.1 * source_points_arr[i][2];
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    Teuchos::ParameterList params;
+    Operator reference( comm, source_points, target_points, params );
+    auto target_values_ref =
+        Helper<DeviceType>::makeValues( target_values_arr );
+    reference.apply( source_values, target_values_ref );
+    auto target_values_ref_host =
+        Kokkos::create_mirror_view( target_values_ref );
+    Kokkos::deep_copy( target_values_ref_host, target_values_ref );
+
+    // Only the rounding of the coefficients to single precision makes a
+    // difference.
+    params.set( "Single Precision Coefficients", true );
+    Operator mlsop( comm, source_points, target_points, params );
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    mlsop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref_host,
+                                  1e-6 );
+
+    // The operator can still be exported as a matrix.
+    auto matrix = mlsop.getCrsMatrix();
+    TEST_EQUALITY( matrix->getGlobalNumEntries(),
+                   reference.getCrsMatrix()->getGlobalNumEntries() );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_3_DECL( MovingLeastSquaresOperator,
+                                   two_dimensional, DeviceType,
+                                   RadialBasisFunction, PolynomialBasis )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    // The point clouds are two-dimensional.  Each process owns a strip of the
+    // source grid and the target points straddle two strips.
+    int const dim = 2;
+    int const n_source_points_per_direction = 10;
+    int const n_source_points =
+        n_source_points_per_direction * n_source_points_per_direction;
+    Kokkos::View<double **, DeviceType> source_points( "source_points",
+                                                       n_source_points, dim );
+    Kokkos::View<double *, DeviceType> source_values( "source_values",
+                                                      n_source_points );
+    auto source_points_host = Kokkos::create_mirror_view( source_points );
+    auto source_values_host = Kokkos::create_mirror_view( source_values );
+
+    // Arbitrary function of the specified order
+    std::function<double( double, double )> f;
+    switch ( PolynomialBasis::size() )
+    {
+    case 3: // linear
+        f = []( double x, double y ) { return 4 + 2 * x - 3 * y; };
+        break;
+    case 6: // quadratic
+        f = []( double x, double y ) {
+            return 2 + 3 * x - 5 * y + 3 * x * x + 4 * x * y - y * y;
+        };
+        break;
+    default:
+        throw;
+    };
+
+    for ( int i = 0; i < n_source_points_per_direction; ++i )
+        for ( int j = 0; j < n_source_points_per_direction; ++j )
+        {
+            int const k = i * n_source_points_per_direction + j;
+            source_points_host( k, 0 ) =
+                i + comm_rank * n_source_points_per_direction;
+            source_points_host( k, 1 ) = j;
+            source_values_host( k ) =
+                f( source_points_host( k, 0 ), source_points_host( k, 1 ) );
+        }
+    Kokkos::deep_copy( source_points, source_points_host );
+    Kokkos::deep_copy( source_values, source_values_host );
+
+    int const n_target_points = n_source_points_per_direction - 1;
+    Kokkos::View<double **, DeviceType> target_points( "target_points",
+                                                       n_target_points, dim );
+    Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                      n_target_points );
+    auto target_points_host = Kokkos::create_mirror_view( target_points );
+    std::vector<double> target_values_ref( n_target_points );
+    for ( int i = 0; i < n_target_points; ++i )
+    {
+        target_points_host( i, 0 ) =
+            ( comm_rank + 1 ) * n_source_points_per_direction - 0.5;
+        target_points_host( i, 1 ) = i + 0.5;
+        target_values_ref[i] =
+            f( target_points_host( i, 0 ), target_points_host( i, 1 ) );
+    }
+    Kokkos::deep_copy( target_points, target_points_host );
+
+    MovingLeastSquaresOperator<DeviceType, RadialBasisFunction,
+                               PolynomialBasis>
+        mlsop( comm, source_points, target_points );
+    mlsop.apply( source_values, target_values );
+
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref,
+                                  1e-11 );
+}
+
 // Include the test macros.
 #include "DataTransferKitMeshfree_ETIHelperMacros.h"
 
@@ -434,6 +1235,10 @@ using Linear3 =
     DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Linear, 3>;
 using Quadratic3 =
     DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Quadratic, 3>;
+using Linear2 =
+    DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Linear, 2>;
+using Quadratic2 =
+    DataTransferKit::MultivariatePolynomialBasis<DataTransferKit::Quadratic, 2>;
 
 // Create the test group
 #define UNIT_TEST_GROUP( NODE )                                                \
@@ -473,7 +1278,52 @@ using Quadratic3 =
         Wendland0, Linear3 )                                                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT(                                      \
         MovingLeastSquaresOperator, single_point_in_radius, DeviceType##NODE,  \
-        Wendland0, Quadratic3 )
+        Wendland0, Quadratic3 )                                                \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          crs_matrix, DeviceType##NODE,        \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          save_and_load, DeviceType##NODE,     \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          support_radius, DeviceType##NODE,    \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          gradient, DeviceType##NODE,          \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          gradient, DeviceType##NODE,          \
+                                          Wendland0, Quadratic3 )              \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT(                                      \
+        MovingLeastSquaresOperator, spatial_reordering, DeviceType##NODE,      \
+        Wendland0, Linear3 )                                                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT(                                      \
+        MovingLeastSquaresOperator, repartition_targets, DeviceType##NODE,     \
+        Wendland0, Linear3 )                                                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          transpose, DeviceType##NODE,         \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          mixed_precision, DeviceType##NODE,   \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          mixed_precision, DeviceType##NODE,   \
+                                          Wendland0, Quadratic3 )              \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT(                                      \
+        MovingLeastSquaresOperator, single_precision_coefficients,             \
+        DeviceType##NODE, Wendland0, Linear3 )                                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          two_dimensional, DeviceType##NODE,   \
+                                          Wendland0, Linear2 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          two_dimensional, DeviceType##NODE,   \
+                                          Wendland0, Quadratic2 )              \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          components, DeviceType##NODE,        \
+                                          Wendland0, Linear3 )                 \
+    TEUCHOS_UNIT_TEST_TEMPLATE_3_INSTANT( MovingLeastSquaresOperator,          \
+                                          components, DeviceType##NODE,        \
+                                          Wendland0, Quadratic3 )
 
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
@@ -11,15 +11,18 @@
 
 #include <Teuchos_UnitTestHarness.hpp>
 
+#include <DTK_ComposedOperator.hpp>
 #include <DTK_DBC.hpp> // DataTransferKitException
 #include <DTK_NearestNeighborOperator.hpp>
 #include <Kokkos_Core.hpp>
+#include <Teuchos_CommHelpers.hpp>
 #include <Teuchos_DefaultComm.hpp>
 #include <Tpetra_CrsMatrix.hpp>
 #include <Tpetra_Distributor.hpp>
 #include <Tpetra_Map.hpp>
 
 #include <array>
+#include <cmath>
 #include <numeric>
 #include <random>
 #include <vector>
@@ -206,6 +209,19 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, structured_clouds,
     for ( unsigned int i = 0; i < n_points; ++i )
         TEST_FLOATING_EQUALITY( target_values_host( i ),
                                 target_points_host( i, 0 ), 1e-14 );
+
+    // Transfer all the coordinates at once
+    Kokkos::View<double **, DeviceType> target_components(
+        "target_components", n_points, 3 );
+    nnop.applyComponents( source_points, target_components );
+
+    auto target_components_host =
+        Kokkos::create_mirror_view( target_components );
+    Kokkos::deep_copy( target_components_host, target_components );
+    for ( unsigned int i = 0; i < n_points; ++i )
+        for ( int d = 0; d < 3; ++d )
+            TEST_FLOATING_EQUALITY( target_components_host( i, d ),
+                                    target_points_host( i, d ), 1e-14 );
 }
 
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, mixed_clouds,
@@ -269,6 +285,477 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, mixed_clouds,
     }
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, layout_left_points,
+                                   DeviceType )
+{
+    // Same as structured_clouds but the coordinates are stored in LayoutLeft
+    // views and passed to the operator without any copy.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    unsigned int const comm_size = comm->getSize();
+    unsigned int const comm_rank = comm->getRank();
+
+    double const Lx = 2.;
+    double const Ly = 3.;
+    double const Lz = 5.;
+    unsigned int const nx = 7;
+    unsigned int const ny = 11;
+    unsigned int const nz = 13;
+    unsigned int const next_rank = ( comm_rank + 1 ) % comm_size;
+
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( Lx, Ly, Lz, nx, ny, nz, comm_rank * Lx,
+                             comm_rank * Ly, comm_rank * Lz ),
+        source_points );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( Lx, Ly, Lz, nx, ny, nz, next_rank * Lx,
+                             next_rank * Ly, next_rank * Lz ),
+        target_points );
+
+    unsigned int const n_points = source_points.extent( 0 );
+    Kokkos::View<double **, Kokkos::LayoutLeft, DeviceType> source_points_left(
+        "source_points_left", n_points, 3 );
+    Kokkos::deep_copy( source_points_left, source_points );
+    Kokkos::View<double **, Kokkos::LayoutLeft, DeviceType> target_points_left(
+        "target_points_left", n_points, 3 );
+    Kokkos::deep_copy( target_points_left, target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+        comm, source_points_left, target_points_left );
+
+    Kokkos::View<double *, DeviceType> source_values( "source_values",
+                                                      n_points );
+    Kokkos::deep_copy( source_values,
+                       Kokkos::subview( source_points, Kokkos::ALL, 0 ) );
+    Kokkos::View<double *, DeviceType> target_values( "target_values",
+                                                      n_points );
+    nnop.apply( source_values, target_values );
+
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    auto target_points_host = Kokkos::create_mirror_view( target_points );
+    Kokkos::deep_copy( target_points_host, target_points );
+    for ( unsigned int i = 0; i < n_points; ++i )
+        TEST_FLOATING_EQUALITY( target_values_host( i ),
+                                target_points_host( i, 0 ), 1e-14 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, warm_start,
+                                   DeviceType )
+{
+    // The target points move a bit after the first operator is built.  The
+    // operator built from the previous one must find the same neighbors as
+    // one built from scratch, whether they changed or not.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 5;
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L ), source_points );
+
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm->getSize() * L, L, L, 100, comm_rank ),
+        target_points );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> search_tree(
+        comm, source_points );
+    DataTransferKit::NearestNeighborOperator<DeviceType> previous(
+        comm, search_tree, source_points, target_points );
+
+    // Move the points by less than the spacing of the grid, so that some but
+    // not all of them get a new nearest neighbor, and put one of them on a
+    // source point.
+    int const n_points = target_points.extent( 0 );
+    auto target_points_host = Kokkos::create_mirror_view( target_points );
+    Kokkos::deep_copy( target_points_host, target_points );
+    for ( int i = 0; i < n_points; ++i )
+        for ( int d = 0; d < 3; ++d )
+            target_points_host( i, d ) += ( ( i + d ) % 3 - 1 ) * 0.07 * L;
+    for ( int d = 0; d < 3; ++d )
+        target_points_host( 0, d ) = comm_rank * L * ( d == 0 ) + L / n;
+    Kokkos::deep_copy( target_points, target_points_host );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> warm_started(
+        comm, search_tree, source_points, target_points, previous );
+    DataTransferKit::NearestNeighborOperator<DeviceType> from_scratch(
+        comm, search_tree, source_points, target_points );
+
+    // Identify the neighbors found by their global index.
+    Kokkos::View<double *, DeviceType> source_values(
+        "source_values", source_points.extent( 0 ) );
+    auto source_values_host = Kokkos::create_mirror_view( source_values );
+    for ( unsigned int i = 0; i < source_values_host.extent( 0 ); ++i )
+        source_values_host( i ) = comm_rank * n * n * n + i;
+    Kokkos::deep_copy( source_values, source_values_host );
+
+    Kokkos::View<double *, DeviceType> warm_values( "warm_values",
+                                                    n_points );
+    warm_started.apply( source_values, warm_values );
+    Kokkos::View<double *, DeviceType> values( "values", n_points );
+    from_scratch.apply( source_values, values );
+
+    auto warm_values_host = Kokkos::create_mirror_view( warm_values );
+    Kokkos::deep_copy( warm_values_host, warm_values );
+    auto values_host = Kokkos::create_mirror_view( values );
+    Kokkos::deep_copy( values_host, values );
+    TEST_COMPARE_ARRAYS( warm_values_host, values_host );
+
+    // The previous operator must be for the same points.
+    Kokkos::View<double **, DeviceType> other_points( "other_points",
+                                                      n_points + 1, 3 );
+    TEST_THROW( DataTransferKit::NearestNeighborOperator<DeviceType>(
+                    comm, search_tree, source_points, other_points, previous ),
+                DataTransferKit::DataTransferKitException );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, transpose,
+                                   DeviceType )
+{
+    // The transpose must satisfy <A x, y> = <x, A^T y> for any source values
+    // x and target values y.  Several target points share their nearest
+    // neighbor, possibly on another process.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_size = comm->getSize();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 4;
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L ), source_points );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 200, comm_rank ),
+        target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+        comm, source_points, target_points );
+
+    int const n_source_points = source_points.extent( 0 );
+    int const n_target_points = target_points.extent( 0 );
+    int const n_components = 2;
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    Kokkos::View<double **, DeviceType> x( "x", n_source_points,
+                                           n_components );
+    auto x_host = Kokkos::create_mirror_view( x );
+    for ( int i = 0; i < n_source_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            x_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( x, x_host );
+    Kokkos::View<double **, DeviceType> y( "y", n_target_points,
+                                           n_components );
+    auto y_host = Kokkos::create_mirror_view( y );
+    for ( int i = 0; i < n_target_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            y_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( y, y_host );
+
+    Kokkos::View<double **, DeviceType> ax( "ax", n_target_points,
+                                            n_components );
+    nnop.applyComponents( x, ax );
+    // The source values are overwritten.
+    Kokkos::View<double **, DeviceType> aty( "aty", n_source_points,
+                                             n_components );
+    Kokkos::deep_copy( aty, 1. );
+    nnop.applyTranspose( y, aty );
+
+    auto ax_host = Kokkos::create_mirror_view( ax );
+    Kokkos::deep_copy( ax_host, ax );
+    auto aty_host = Kokkos::create_mirror_view( aty );
+    Kokkos::deep_copy( aty_host, aty );
+    double local_products[2] = {0., 0.};
+    for ( int j = 0; j < n_components; ++j )
+    {
+        for ( int i = 0; i < n_target_points; ++i )
+            local_products[0] += ax_host( i, j ) * y_host( i, j );
+        for ( int i = 0; i < n_source_points; ++i )
+            local_products[1] += x_host( i, j ) * aty_host( i, j );
+    }
+    double products[2] = {0., 0.};
+    Teuchos::reduceAll( *comm, Teuchos::REDUCE_SUM, 2, local_products,
+                        products );
+    TEST_FLOATING_EQUALITY( products[1], products[0], 1e-12 );
+
+    // Every target value ends up on exactly one source point.
+    double local_sums[2] = {0., 0.};
+    for ( int i = 0; i < n_target_points; ++i )
+        local_sums[0] += y_host( i, 0 );
+    for ( int i = 0; i < n_source_points; ++i )
+        local_sums[1] += aty_host( i, 0 );
+    double sums[2] = {0., 0.};
+    Teuchos::reduceAll( *comm, Teuchos::REDUCE_SUM, 2, local_sums, sums );
+    TEST_FLOATING_EQUALITY( sums[1], sums[0], 1e-12 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, transpose_merge,
+                                   DeviceType )
+{
+    // Several target points share their nearest neighbor, possibly on
+    // another process.  Applying the operator to the merged values gives
+    // each target point the combination of the values of all the target
+    // points that share its neighbor.
+    using DataTransferKit::TransposeMerge;
+
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_size = comm->getSize();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 4;
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L ), source_points );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 200, comm_rank ),
+        target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+        comm, source_points, target_points );
+
+    int const n_source_points = source_points.extent( 0 );
+    int const n_target_points = target_points.extent( 0 );
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    Kokkos::View<double **, DeviceType> y( "y", n_target_points, 1 );
+    auto y_host = Kokkos::create_mirror_view( y );
+    for ( int i = 0; i < n_target_points; ++i )
+        y_host( i, 0 ) = distribution( generator );
+    Kokkos::deep_copy( y, y_host );
+
+    std::array<TransposeMerge, 4> const merges = {
+        {TransposeMerge::atomic_sum, TransposeMerge::sum, TransposeMerge::min,
+         TransposeMerge::max}};
+    std::array<std::vector<double>, 4> values;
+    for ( int m = 0; m < 4; ++m )
+    {
+        Kokkos::View<double **, DeviceType> aty( "aty", n_source_points, 1 );
+        nnop.applyTranspose( y, aty, merges[m] );
+        Kokkos::View<double **, DeviceType> a_aty( "a_aty", n_target_points,
+                                                   1 );
+        nnop.applyComponents( aty, a_aty );
+        auto a_aty_host = Kokkos::create_mirror_view( a_aty );
+        Kokkos::deep_copy( a_aty_host, a_aty );
+        for ( int i = 0; i < n_target_points; ++i )
+            values[m].push_back( a_aty_host( i, 0 ) );
+    }
+
+    for ( int i = 0; i < n_target_points; ++i )
+    {
+        // The sums only differ by the order of the additions.
+        TEST_COMPARE( std::abs( values[1][i] - values[0][i] ), <=, 1e-12 );
+        TEST_COMPARE( values[2][i], <=, y_host( i, 0 ) );
+        TEST_COMPARE( values[3][i], >=, y_host( i, 0 ) );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, ghosted_sources,
+                                   DeviceType )
+{
+    // Each process also holds copies of the source points of the next one.
+    // The ghosts must never be found in place of the points they copy, so
+    // the operator gives the same values as one built without them even
+    // though the values of the ghosts are wrong.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_size = comm->getSize();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 4;
+    auto const owned_cloud =
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L );
+    auto const ghost_cloud = makeStructuredCloud(
+        L, L, L, n, n, n, ( ( comm_rank + 1 ) % comm_size ) * L );
+    std::vector<std::array<double, 3>> cloud = owned_cloud;
+    cloud.insert( cloud.end(), ghost_cloud.begin(), ghost_cloud.end() );
+    int const n_owned = owned_cloud.size();
+    int const n_source_points = cloud.size();
+
+    Kokkos::View<double **, DeviceType> owned_points( "owned_points" );
+    copyPointsFromCloud<DeviceType>( owned_cloud, owned_points );
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>( cloud, source_points );
+    Kokkos::View<bool *, DeviceType> source_owned( "source_owned",
+                                                   n_source_points );
+    Kokkos::deep_copy(
+        Kokkos::subview( source_owned, std::make_pair( 0, n_owned ) ), true );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 100, comm_rank ),
+        target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> ghosted(
+        comm, source_points, source_owned, target_points );
+    DataTransferKit::NearestNeighborOperator<DeviceType> reference(
+        comm, owned_points, target_points );
+
+    Kokkos::View<double *, DeviceType> source_values( "source_values",
+                                                      n_source_points );
+    auto source_values_host = Kokkos::create_mirror_view( source_values );
+    for ( int i = 0; i < n_source_points; ++i )
+        source_values_host( i ) = ( i < n_owned ) ? comm_rank * n_owned + i
+                                                  : -1.;
+    Kokkos::deep_copy( source_values, source_values_host );
+    Kokkos::View<double *, DeviceType> owned_values( "owned_values", n_owned );
+    Kokkos::deep_copy(
+        owned_values,
+        Kokkos::subview( source_values, std::make_pair( 0, n_owned ) ) );
+
+    int const n_target_points = target_points.extent( 0 );
+    Kokkos::View<double *, DeviceType> values( "values", n_target_points );
+    ghosted.apply( source_values, values );
+    Kokkos::View<double *, DeviceType> values_ref( "values_ref",
+                                                   n_target_points );
+    reference.apply( owned_values, values_ref );
+
+    auto values_host = Kokkos::create_mirror_view( values );
+    Kokkos::deep_copy( values_host, values );
+    auto values_ref_host = Kokkos::create_mirror_view( values_ref );
+    Kokkos::deep_copy( values_ref_host, values_ref );
+    TEST_COMPARE_ARRAYS( values_host, values_ref_host );
+
+    // The transpose only sends values to the owned points.
+    Kokkos::View<double **, DeviceType> y( "y", n_target_points, 1 );
+    Kokkos::deep_copy( y, 1. );
+    Kokkos::View<double **, DeviceType> aty( "aty", n_source_points, 1 );
+    ghosted.applyTranspose( y, aty );
+    auto aty_host = Kokkos::create_mirror_view( aty );
+    Kokkos::deep_copy( aty_host, aty );
+    for ( int i = n_owned; i < n_source_points; ++i )
+        TEST_EQUALITY( aty_host( i, 0 ), 0. );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, active_targets,
+                                   DeviceType )
+{
+    // Only every third target point is updated.  The others keep their
+    // previous values.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_size = comm->getSize();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 4;
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L ), source_points );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 100, comm_rank ),
+        target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> nnop(
+        comm, source_points, target_points );
+
+    int const n_source_points = source_points.extent( 0 );
+    Kokkos::View<double *, DeviceType> source_values( "source_values",
+                                                      n_source_points );
+    auto source_values_host = Kokkos::create_mirror_view( source_values );
+    for ( int i = 0; i < n_source_points; ++i )
+        source_values_host( i ) = comm_rank * n_source_points + i;
+    Kokkos::deep_copy( source_values, source_values_host );
+
+    int const n_target_points = target_points.extent( 0 );
+    Kokkos::View<bool *, DeviceType> active_targets( "active_targets",
+                                                     n_target_points );
+    auto active_targets_host = Kokkos::create_mirror_view( active_targets );
+    for ( int i = 0; i < n_target_points; ++i )
+        active_targets_host( i ) = ( i % 3 == 0 );
+    Kokkos::deep_copy( active_targets, active_targets_host );
+
+    Kokkos::View<double *, DeviceType> values( "values", n_target_points );
+    Kokkos::deep_copy( values, -1. );
+    nnop.apply( source_values, values, active_targets );
+    Kokkos::View<double *, DeviceType> values_ref( "values_ref",
+                                                   n_target_points );
+    nnop.apply( source_values, values_ref );
+
+    auto values_host = Kokkos::create_mirror_view( values );
+    Kokkos::deep_copy( values_host, values );
+    auto values_ref_host = Kokkos::create_mirror_view( values_ref );
+    Kokkos::deep_copy( values_ref_host, values_ref );
+    for ( int i = 0; i < n_target_points; ++i )
+        TEST_EQUALITY( values_host( i ),
+                       active_targets_host( i ) ? values_ref_host( i ) : -1. );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, composition,
+                                   DeviceType )
+{
+    // Map the source values to an intermediate cloud and from there to the
+    // target points, in one go and in two steps.  The nearest neighbors of
+    // the target points may be on other processes at both steps.
+    Teuchos::RCP<Teuchos::Comm<int> const> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_size = comm->getSize();
+    int const comm_rank = comm->getRank();
+
+    double const L = 1.;
+    int const n = 4;
+    Kokkos::View<double **, DeviceType> source_points( "source_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeStructuredCloud( L, L, L, n, n, n, comm_rank * L ), source_points );
+    Kokkos::View<double **, DeviceType> intermediate_points(
+        "intermediate_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 50, comm_rank ),
+        intermediate_points );
+    Kokkos::View<double **, DeviceType> target_points( "target_points" );
+    copyPointsFromCloud<DeviceType>(
+        makeRandomCloud( comm_size * L, L, L, 200, comm_size + comm_rank ),
+        target_points );
+
+    DataTransferKit::NearestNeighborOperator<DeviceType> first(
+        comm, source_points, intermediate_points );
+    DataTransferKit::NearestNeighborOperator<DeviceType> second(
+        comm, intermediate_points, target_points );
+    DataTransferKit::ComposedOperator<DeviceType> composed( comm, first,
+                                                            second );
+
+    int const n_source_points = source_points.extent( 0 );
+    int const n_intermediate_points = intermediate_points.extent( 0 );
+    int const n_target_points = target_points.extent( 0 );
+    int const n_components = 2;
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -1., 1. );
+    Kokkos::View<double **, DeviceType> x( "x", n_source_points,
+                                           n_components );
+    auto x_host = Kokkos::create_mirror_view( x );
+    for ( int i = 0; i < n_source_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            x_host( i, j ) = distribution( generator );
+    Kokkos::deep_copy( x, x_host );
+
+    Kokkos::View<double **, DeviceType> y( "y", n_intermediate_points,
+                                           n_components );
+    first.applyComponents( x, y );
+    Kokkos::View<double **, DeviceType> z( "z", n_target_points,
+                                           n_components );
+    second.applyComponents( y, z );
+    Kokkos::View<double **, DeviceType> z_composed(
+        "z_composed", n_target_points, n_components );
+    composed.applyComponents( x, z_composed );
+
+    auto z_host = Kokkos::create_mirror_view( z );
+    Kokkos::deep_copy( z_host, z );
+    auto z_composed_host = Kokkos::create_mirror_view( z_composed );
+    Kokkos::deep_copy( z_composed_host, z_composed );
+    for ( int i = 0; i < n_target_points; ++i )
+        for ( int j = 0; j < n_components; ++j )
+            TEST_EQUALITY( z_composed_host( i, j ), z_host( i, j ) );
+}
+
 // Include the test macros.
 #include "DataTransferKitMeshfree_ETIHelperMacros.h"
 
@@ -280,7 +767,21 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( NearestNeighborOperator, mixed_clouds,
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         NearestNeighborOperator, structured_clouds, DeviceType##NODE )         \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( NearestNeighborOperator,             \
-                                          mixed_clouds, DeviceType##NODE )
+                                          mixed_clouds, DeviceType##NODE )     \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        NearestNeighborOperator, layout_left_points, DeviceType##NODE )        \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( NearestNeighborOperator,             \
+                                          warm_start, DeviceType##NODE )       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( NearestNeighborOperator,             \
+                                          transpose, DeviceType##NODE )        \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        NearestNeighborOperator, transpose_merge, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        NearestNeighborOperator, ghosted_sources, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        NearestNeighborOperator, active_targets, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( NearestNeighborOperator,             \
+                                          composition, DeviceType##NODE )
 
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
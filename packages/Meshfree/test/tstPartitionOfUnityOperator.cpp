@@ -0,0 +1,212 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <DTK_PartitionOfUnityOperator_decl.hpp>
+#include <DTK_PartitionOfUnityOperator_def.hpp>
+#include <Kokkos_Core.hpp>
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_ParameterList.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+int constexpr DIM = 3;
+
+template <typename DeviceType>
+struct Helper
+{
+    static Kokkos::View<double **, DeviceType>
+    makePoints( std::vector<std::array<double, DIM>> const &in )
+    {
+        int const n = in.size();
+        Kokkos::View<double **, DeviceType> out( "points", n, DIM );
+        auto out_host = Kokkos::create_mirror_view( out );
+        for ( int i = 0; i < n; ++i )
+            for ( int j = 0; j < DIM; ++j )
+                out_host( i, j ) = in[i][j];
+        Kokkos::deep_copy( out, out_host );
+        return out;
+    }
+
+    static Kokkos::View<double *, DeviceType>
+    makeValues( std::vector<double> const &in )
+    {
+        int const n = in.size();
+        Kokkos::View<double *, DeviceType> out( "values", n );
+        auto out_host = Kokkos::create_mirror_view( out );
+        for ( int i = 0; i < n; ++i )
+            out_host( i ) = in[i];
+        Kokkos::deep_copy( out, out_host );
+        return out;
+    }
+
+    static std::vector<std::array<double, DIM>>
+    makeGridPoints( std::array<int, DIM> const &n_points,
+                    std::array<double, DIM> const &offset )
+    {
+        std::vector<std::array<double, DIM>> grid_points;
+        for ( int i = 0; i < n_points[0]; ++i )
+            for ( int j = 0; j < n_points[1]; ++j )
+                for ( int k = 0; k < n_points[2]; ++k )
+                    grid_points.push_back(
+                        {{offset[0] + i, offset[1] + j, offset[2] + k}} );
+        return grid_points;
+    }
+};
+
+double f( std::array<double, DIM> const &p )
+{
+    return 2. + std::sin( 0.3 * p[0] ) * std::cos( 0.2 * p[1] ) + 0.1 * p[2];
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( PartitionOfUnityOperator,
+                                   interpolation_at_source_points, DeviceType,
+                                   RadialBasisFunction )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+    auto const comm_size = comm->getSize();
+
+    // Each process owns a block of the source grid and its target points are
+    // the source points of the next process so that the patches are filled
+    // with points from another process.
+    std::array<int, DIM> const n_points_grid = {{6, 6, 6}};
+    std::array<double, DIM> offset = {
+        {0., 0., static_cast<double>( 10 * comm_rank )}};
+    auto source_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_points_grid, offset );
+    offset[2] = 10 * ( ( comm_rank + 1 ) % comm_size );
+    auto target_points_arr =
+        Helper<DeviceType>::makeGridPoints( n_points_grid, offset );
+
+    unsigned int const n_source_points = source_points_arr.size();
+    unsigned int const n_target_points = target_points_arr.size();
+    std::vector<double> source_values_arr( n_source_points );
+    std::vector<double> target_values_arr( n_target_points );
+    std::vector<double> target_values_ref( n_target_points );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+        source_values_arr[i] = f( source_points_arr[i] );
+    for ( unsigned int i = 0; i < n_target_points; ++i )
+        target_values_ref[i] = f( target_points_arr[i] );
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    // The patch radius is chosen so that no grid point lies on the boundary
+    // of a patch.
+    Teuchos::ParameterList params;
+    params.set( "Patch Spacing", 2. );
+    params.set( "Patch Radius", 3.3 );
+    params.set( "Support Radius", 3. );
+    PartitionOfUnityOperator<DeviceType, RadialBasisFunction> pumop(
+        comm, source_points, target_points, params );
+
+    // Every patch that covers a target point contains it and the local
+    // interpolants reproduce the source values so the blend does too.
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    pumop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_COMPARE_FLOATING_ARRAYS( target_values_host, target_values_ref,
+                                  1e-9 );
+
+    // Transfer a second component with twice the values at the same time.
+    Kokkos::View<double **, DeviceType> source_components(
+        "source_components", n_source_points, 2 );
+    Kokkos::View<double **, DeviceType> target_components(
+        "target_components", n_target_points, 2 );
+    auto source_components_host =
+        Kokkos::create_mirror_view( source_components );
+    for ( unsigned int i = 0; i < n_source_points; ++i )
+    {
+        source_components_host( i, 0 ) = source_values_arr[i];
+        source_components_host( i, 1 ) = 2. * source_values_arr[i];
+    }
+    Kokkos::deep_copy( source_components, source_components_host );
+    pumop.applyComponents( source_components, target_components );
+    auto target_components_host =
+        Kokkos::create_mirror_view( target_components );
+    Kokkos::deep_copy( target_components_host, target_components );
+    for ( unsigned int i = 0; i < n_target_points; ++i )
+    {
+        TEST_FLOATING_EQUALITY( target_components_host( i, 0 ),
+                                target_values_host( i ), 1e-12 );
+        TEST_FLOATING_EQUALITY( target_components_host( i, 1 ),
+                                2. * target_values_host( i ), 1e-12 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_2_DECL( PartitionOfUnityOperator, empty_patches,
+                                   DeviceType, RadialBasisFunction )
+{
+    using namespace DataTransferKit;
+
+    auto comm = Teuchos::DefaultComm<int>::getComm();
+    auto const comm_rank = comm->getRank();
+
+    // The source points are on a line and the second target point is too
+    // far away for any of its patches to contain source points.
+    std::vector<std::array<double, DIM>> source_points_arr;
+    for ( int i = 0; i < 5; ++i )
+        source_points_arr.push_back(
+            {{static_cast<double>( i ), 0., 10. * comm_rank}} );
+    std::vector<std::array<double, DIM>> target_points_arr = {
+        {{2., 0., 10. * comm_rank}}, {{2., 50., 10. * comm_rank}}};
+    std::vector<double> source_values_arr( source_points_arr.size(), 3. );
+    std::vector<double> target_values_arr( target_points_arr.size(), -1. );
+
+    auto source_points = Helper<DeviceType>::makePoints( source_points_arr );
+    auto source_values = Helper<DeviceType>::makeValues( source_values_arr );
+    auto target_points = Helper<DeviceType>::makePoints( target_points_arr );
+
+    Teuchos::ParameterList params;
+    params.set( "Patch Spacing", 1.5 );
+    PartitionOfUnityOperator<DeviceType, RadialBasisFunction> pumop(
+        comm, source_points, target_points, params );
+
+    auto target_values = Helper<DeviceType>::makeValues( target_values_arr );
+    pumop.apply( source_values, target_values );
+    auto target_values_host = Kokkos::create_mirror_view( target_values );
+    Kokkos::deep_copy( target_values_host, target_values );
+    TEST_FLOATING_EQUALITY( target_values_host( 0 ), 3., 1e-9 );
+    TEST_EQUALITY( target_values_host( 1 ), 0. );
+}
+
+// Include the test macros.
+#include "DataTransferKitMeshfree_ETIHelperMacros.h"
+
+using Wendland0 = DataTransferKit::Wendland<0>;
+using Wendland2 = DataTransferKit::Wendland<2>;
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( PartitionOfUnityOperator,            \
+                                          interpolation_at_source_points,      \
+                                          DeviceType##NODE, Wendland0 )        \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( PartitionOfUnityOperator,            \
+                                          interpolation_at_source_points,      \
+                                          DeviceType##NODE, Wendland2 )        \
+    TEUCHOS_UNIT_TEST_TEMPLATE_2_INSTANT( PartitionOfUnityOperator,            \
+                                          empty_patches, DeviceType##NODE,     \
+                                          Wendland0 )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -141,6 +141,86 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( SVD, rank_deficient, DeviceType )
                   rank_deficiency, out, success );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( SVD, first_row, DeviceType )
+{
+    int const n_matrices = 10;
+    int const matrix_size = 10;
+    int const size = n_matrices * matrix_size * matrix_size;
+    Kokkos::View<double *, DeviceType> matrices( "matrices", size );
+    Kokkos::View<double *, DeviceType> inv_matrices( "inv_matrices", size );
+    Kokkos::View<double *, DeviceType> inv_first_rows(
+        "inv_first_rows", n_matrices * matrix_size );
+
+    // Fill the matrices
+    auto matrices_host = Kokkos::create_mirror_view( matrices );
+    std::default_random_engine random_engine;
+    std::uniform_real_distribution<double> distribution( -1000, 1000 );
+    for ( int i = 0; i < size; ++i )
+        matrices_host( i ) = distribution( random_engine );
+    Kokkos::deep_copy( matrices, matrices_host );
+
+    using ExecutionSpace = typename DeviceType::execution_space;
+    size_t n_underdetermined = 0;
+    DataTransferKit::Details::SVDFunctor<DeviceType> svd_functor(
+        matrix_size, matrices, inv_matrices );
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "compute_svd_inverse" ),
+        Kokkos::TeamPolicy<ExecutionSpace>( n_matrices, 1 ), svd_functor,
+        n_underdetermined );
+    DataTransferKit::Details::SVDFunctor<DeviceType> svd_first_row_functor(
+        matrix_size, matrices, inv_first_rows, 1 );
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "compute_svd_inverse_first_row" ),
+        Kokkos::TeamPolicy<ExecutionSpace>( n_matrices, 1 ),
+        svd_first_row_functor, n_underdetermined );
+    TEST_EQUALITY( n_underdetermined, 0 );
+
+    // The first rows must match the ones of the full pseudo-inverses.
+    auto inv_matrices_host = Kokkos::create_mirror_view( inv_matrices );
+    Kokkos::deep_copy( inv_matrices_host, inv_matrices );
+    auto inv_first_rows_host = Kokkos::create_mirror_view( inv_first_rows );
+    Kokkos::deep_copy( inv_first_rows_host, inv_first_rows );
+    for ( int m = 0; m < n_matrices; ++m )
+        for ( int j = 0; j < matrix_size; ++j )
+            TEST_EQUALITY(
+                inv_first_rows_host( m * matrix_size + j ),
+                inv_matrices_host( m * matrix_size * matrix_size + j ) );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( SVD, team, DeviceType )
+{
+    int const n_matrices = 10;
+    int const matrix_size = 10;
+    int const size = n_matrices * matrix_size * matrix_size;
+    Kokkos::View<double *, DeviceType> matrices( "matrices", size );
+    Kokkos::View<double *, DeviceType> inv_matrices( "inv_matrices", size );
+
+    // Fill the matrices
+    auto matrices_host = Kokkos::create_mirror_view( matrices );
+    std::default_random_engine random_engine;
+    std::uniform_real_distribution<double> distribution( -1000, 1000 );
+    for ( int i = 0; i < size; ++i )
+        matrices_host( i ) = distribution( random_engine );
+    Kokkos::deep_copy( matrices, matrices_host );
+
+    // Use the team size selected for the execution space
+    using SVDFunctor = DataTransferKit::Details::SVDFunctor<DeviceType>;
+    SVDFunctor svd_functor( matrix_size, matrices, inv_matrices );
+    size_t n_underdetermined = 0;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "compute_svd_inverse" ),
+        Kokkos::TeamPolicy<ExecutionSpace>(
+            n_matrices, SVDFunctor::teamSize( matrix_size ) ),
+        svd_functor, n_underdetermined );
+    TEST_EQUALITY( n_underdetermined, 0 );
+
+    std::set<int> rank_deficiency;
+
+    check_result( matrices, inv_matrices, n_matrices, matrix_size,
+                  rank_deficiency, out, success );
+}
+
 // Include the test macros.
 #include "DataTransferKitMeshfree_ETIHelperMacros.h"
 
@@ -149,7 +229,9 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( SVD, rank_deficient, DeviceType )
     using DeviceType##NODE = typename NODE::device_type;                       \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( SVD, full_rank, DeviceType##NODE )   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( SVD, rank_deficient,                 \
-                                          DeviceType##NODE )
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( SVD, first_row, DeviceType##NODE )   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( SVD, team, DeviceType##NODE )
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
 
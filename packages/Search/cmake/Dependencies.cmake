@@ -4,6 +4,10 @@ TRIBITS_PACKAGE_DEFINE_DEPENDENCIES(
   Kokkos
   Teuchos
   Tpetra
+
+  LIB_REQUIRED_TPLS
+  MPI
+
   TEST_OPTIONAL_TPLS
   BoostOrg
   )
@@ -22,6 +22,25 @@
 #include <cmath> // cbrt
 #include <cstdlib>
 #include <random>
+#include <string>
+
+// Binary point cloud that the source points are read from, if any, instead
+// of being generated.
+std::string source_point_cloud_file;
+
+// Whether the point clouds are generated in parallel in the memory space of
+// the device rather than on the host.
+bool parallel_point_clouds = false;
+
+template <typename DeviceType>
+void makePointCloud( PointCloudType point_cloud_type, double length,
+                     Kokkos::View<DataTransferKit::Point *, DeviceType> points )
+{
+    if ( parallel_point_clouds )
+        generatePointCloudInParallel( point_cloud_type, length, points );
+    else
+        generatePointCloud( point_cloud_type, length, points );
+}
 
 template <typename DeviceType>
 Kokkos::View<DataTransferKit::Box *, DeviceType>
@@ -29,12 +48,22 @@ constructBoxes( int n_values, PointCloudType point_cloud_type )
 {
     Kokkos::View<DataTransferKit::Point *, DeviceType> random_points(
         Kokkos::ViewAllocateWithoutInitializing( "random_points" ), n_values );
-    // Generate random points uniformely distributed within a box.  The edge
-    // length of the box chosen such that object density (here objects will be
-    // boxes 2x2x2 centered around a random point) will remain constant as
-    // problem size is changed.
-    auto const a = std::cbrt( n_values );
-    generatePointCloud( point_cloud_type, a, random_points );
+    if ( !source_point_cloud_file.empty() )
+    {
+        MappedPointCloud const cloud( source_point_cloud_file );
+        DTK_REQUIRE( cloud.numberOfPoints() ==
+                     static_cast<std::size_t>( n_values ) );
+        Kokkos::deep_copy( random_points, cloud.points() );
+    }
+    else
+    {
+        // Generate random points uniformely distributed within a box.  The
+        // edge length of the box chosen such that object density (here
+        // objects will be boxes 2x2x2 centered around a random point) will
+        // remain constant as problem size is changed.
+        auto const a = std::cbrt( n_values );
+        makePointCloud( point_cloud_type, a, random_points );
+    }
 
     using ExecutionSpace = typename DeviceType::execution_space;
     Kokkos::View<DataTransferKit::Box *, DeviceType> bounding_boxes(
@@ -59,7 +88,7 @@ makeNearestQueries( int n_values, int n_queries, int n_neighbors,
     Kokkos::View<DataTransferKit::Point *, DeviceType> random_points(
         Kokkos::ViewAllocateWithoutInitializing( "random_points" ), n_queries );
     auto const a = std::cbrt( n_values );
-    generatePointCloud( target_point_cloud_type, a, random_points );
+    makePointCloud( target_point_cloud_type, a, random_points );
 
     Kokkos::View<DataTransferKit::Nearest<DataTransferKit::Point> *, DeviceType>
         queries( Kokkos::ViewAllocateWithoutInitializing( "queries" ),
@@ -84,7 +113,7 @@ makeSpatialQueries( int n_values, int n_queries, int n_neighbors,
     Kokkos::View<DataTransferKit::Point *, DeviceType> random_points(
         Kokkos::ViewAllocateWithoutInitializing( "random_points" ), n_queries );
     auto const a = std::cbrt( n_values );
-    generatePointCloud( target_point_cloud_type, a, random_points );
+    makePointCloud( target_point_cloud_type, a, random_points );
 
     Kokkos::View<DataTransferKit::Within *, DeviceType> queries(
         Kokkos::ViewAllocateWithoutInitializing( "queries" ), n_queries );
@@ -105,28 +134,140 @@ makeSpatialQueries( int n_values, int n_queries, int n_neighbors,
     return queries;
 }
 
+// Time the kernels of a phase on the device.  On CUDA, events are recorded
+// in the stream of the execution space, so that the time does not include
+// the latency of the launch of the first kernel nor the final fence.  On the
+// host, the execution space is fenced around the phase.
+template <typename ExecutionSpace>
+class PhaseTimer
+{
+  public:
+    void start()
+    {
+        ExecutionSpace().fence();
+        _start = std::chrono::steady_clock::now();
+    }
+    // Return the time in seconds since start().
+    double stop()
+    {
+        ExecutionSpace().fence();
+        std::chrono::duration<double> const elapsed_seconds =
+            std::chrono::steady_clock::now() - _start;
+        return elapsed_seconds.count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+#ifdef KOKKOS_ENABLE_CUDA
+template <>
+class PhaseTimer<Kokkos::Cuda>
+{
+  public:
+    PhaseTimer()
+    {
+        cudaEventCreate( &_start );
+        cudaEventCreate( &_stop );
+    }
+    ~PhaseTimer()
+    {
+        cudaEventDestroy( _start );
+        cudaEventDestroy( _stop );
+    }
+    PhaseTimer( PhaseTimer const & ) = delete;
+    PhaseTimer &operator=( PhaseTimer const & ) = delete;
+
+    void start() { cudaEventRecord( _start, Kokkos::Cuda().cuda_stream() ); }
+    double stop()
+    {
+        cudaEventRecord( _stop, Kokkos::Cuda().cuda_stream() );
+        cudaEventSynchronize( _stop );
+        float milliseconds = 0.f;
+        cudaEventElapsedTime( &milliseconds, _start, _stop );
+        return 1e-3 * milliseconds;
+    }
+
+  private:
+    cudaEvent_t _start;
+    cudaEvent_t _stop;
+};
+#endif
+
+// Time of each phase, averaged over the iterations, along with the derived
+// metrics of the traversal.  The traffic is an estimate of the bytes touched
+// per query: the nodes visited, the query itself, and the indices and offset
+// of its results.  Together with the rate of queries, it places the
+// traversal on a roofline.
+template <typename DeviceType, typename Query>
+void setTraversalCounters( benchmark::State &state,
+                           DataTransferKit::BVH<DeviceType> const &bvh,
+                           Kokkos::View<Query *, DeviceType> queries,
+                           double sort_time, double traversal_time,
+                           double results_per_query )
+{
+    int const n_queries = queries.extent( 0 );
+    Kokkos::View<DataTransferKit::TraversalStatistics *, DeviceType>
+        statistics( "statistics" );
+    bvh.queryStatistics( queries, statistics );
+    auto const statistics_host =
+        Kokkos::create_mirror_view_and_copy( Kokkos::HostSpace(), statistics );
+    double nodes_visited = 0.;
+    for ( int i = 0; i < n_queries; ++i )
+        nodes_visited += statistics_host( i ).nodes_visited;
+    double const nodes_visited_per_query =
+        n_queries > 0 ? nodes_visited / n_queries : 0.;
+
+    using Node = typename DataTransferKit::BVH<DeviceType>::node_type;
+    double const bytes_per_query = nodes_visited_per_query * sizeof( Node ) +
+                                   sizeof( Query ) + sizeof( int ) +
+                                   results_per_query * sizeof( int );
+
+    double const n_iterations = state.iterations();
+    double const traversal_seconds = traversal_time / n_iterations;
+    state.counters["sort queries [s]"] = sort_time / n_iterations;
+    state.counters["traversal [s]"] = traversal_seconds;
+    state.counters["queries per second"] =
+        traversal_seconds > 0. ? n_queries / traversal_seconds : 0.;
+    state.counters["nodes visited per query"] = nodes_visited_per_query;
+    state.counters["bytes touched per query"] = bytes_per_query;
+    state.counters["bytes touched per second"] =
+        traversal_seconds > 0. ? n_queries * bytes_per_query / traversal_seconds
+                               : 0.;
+}
+
 template <class DeviceType>
 void BM_construction( benchmark::State &state )
 {
+    using ExecutionSpace = typename DeviceType::execution_space;
     int const n_values = state.range( 0 );
     PointCloudType point_cloud_type =
         static_cast<PointCloudType>( state.range( 1 ) );
     auto bounding_boxes =
         constructBoxes<DeviceType>( n_values, point_cloud_type );
 
+    PhaseTimer<ExecutionSpace> timer;
+    double construction_time = 0.;
     for ( auto _ : state )
     {
-        auto const start = std::chrono::high_resolution_clock::now();
+        timer.start();
         DataTransferKit::BVH<DeviceType> bvh( bounding_boxes );
-        auto const end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_seconds = end - start;
-        state.SetIterationTime( elapsed_seconds.count() );
+        double const elapsed_seconds = timer.stop();
+        construction_time += elapsed_seconds;
+        state.SetIterationTime( elapsed_seconds );
     }
+
+    double const construction_seconds = construction_time / state.iterations();
+    state.counters["construction [s]"] = construction_seconds;
+    state.counters["leaves per second"] =
+        construction_seconds > 0. ? n_values / construction_seconds : 0.;
 }
 
 template <class DeviceType>
 void BM_knn_search( benchmark::State &state )
 {
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Query = DataTransferKit::Nearest<DataTransferKit::Point>;
     int const n_values = state.range( 0 );
     int const n_queries = state.range( 1 );
     int const n_neighbors = state.range( 2 );
@@ -140,21 +281,33 @@ void BM_knn_search( benchmark::State &state )
     auto const queries = makeNearestQueries<DeviceType>(
         n_values, n_queries, n_neighbors, target_point_cloud_type );
 
+    PhaseTimer<ExecutionSpace> timer;
+    double sort_time = 0.;
+    double traversal_time = 0.;
     for ( auto _ : state )
     {
         Kokkos::View<int *, DeviceType> offset( "offset" );
         Kokkos::View<int *, DeviceType> indices( "indices" );
-        auto const start = std::chrono::high_resolution_clock::now();
-        bvh.query( queries, indices, offset );
-        auto const end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_seconds = end - start;
-        state.SetIterationTime( elapsed_seconds.count() );
+        timer.start();
+        DataTransferKit::QueryOrdering<DeviceType, Query> const ordering(
+            queries, bvh.bounds() );
+        double const sort_seconds = timer.stop();
+        timer.start();
+        bvh.query( ordering, indices, offset );
+        double const traversal_seconds = timer.stop();
+        sort_time += sort_seconds;
+        traversal_time += traversal_seconds;
+        state.SetIterationTime( sort_seconds + traversal_seconds );
     }
+    setTraversalCounters( state, bvh, queries, sort_time, traversal_time,
+                          n_neighbors );
 }
 
 template <class DeviceType>
 void BM_radius_search( benchmark::State &state )
 {
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Query = DataTransferKit::Within;
     int const n_values = state.range( 0 );
     int const n_queries = state.range( 1 );
     int const n_neighbors = state.range( 2 );
@@ -169,16 +322,25 @@ void BM_radius_search( benchmark::State &state )
     auto const queries = makeSpatialQueries<DeviceType>(
         n_values, n_queries, n_neighbors, target_point_cloud_type );
 
+    PhaseTimer<ExecutionSpace> timer;
+    double sort_time = 0.;
+    double traversal_time = 0.;
+    double average_number_of_neighbors = 0.;
     bool first_pass = true;
     for ( auto _ : state )
     {
         Kokkos::View<int *, DeviceType> offset( "offset" );
         Kokkos::View<int *, DeviceType> indices( "indices" );
-        auto const start = std::chrono::high_resolution_clock::now();
-        bvh.query( queries, indices, offset, buffer_size );
-        auto const end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed_seconds = end - start;
-        state.SetIterationTime( elapsed_seconds.count() );
+        timer.start();
+        DataTransferKit::QueryOrdering<DeviceType, Query> const ordering(
+            queries, bvh.bounds() );
+        double const sort_seconds = timer.stop();
+        timer.start();
+        bvh.query( ordering, indices, offset, buffer_size );
+        double const traversal_seconds = timer.stop();
+        sort_time += sort_seconds;
+        traversal_time += traversal_seconds;
+        state.SetIterationTime( sort_seconds + traversal_seconds );
 
         if ( first_pass )
         {
@@ -197,9 +359,48 @@ void BM_radius_search( benchmark::State &state )
             os << "max number of neighbors " << max << "\n";
             os << "avg number of neighbors " << avg << "\n";
 
+            average_number_of_neighbors = avg;
             first_pass = false;
         }
     }
+    setTraversalCounters( state, bvh, queries, sort_time, traversal_time,
+                          average_number_of_neighbors );
+}
+
+// Values of the arguments of the benchmarks.  The numbers of values and of
+// neighbors are swept over, multiplying the former by 8 and doubling the
+// latter at each step.  The radius of the spatial queries grows with the
+// number of neighbors.
+int n_values;
+int n_queries;
+int n_neighbors;
+int buffer_size;
+int source_point_cloud_type;
+int target_point_cloud_type;
+int values_steps = 1;
+int neighbors_steps = 1;
+
+void constructionArguments( benchmark::internal::Benchmark *benchmark )
+{
+    for ( int i = 0, n = n_values; i < values_steps; ++i, n *= 8 )
+        benchmark->Args( {n, source_point_cloud_type} );
+}
+
+void knnSearchArguments( benchmark::internal::Benchmark *benchmark )
+{
+    for ( int i = 0, n = n_values; i < values_steps; ++i, n *= 8 )
+        for ( int j = 0, k = n_neighbors; j < neighbors_steps; ++j, k *= 2 )
+            benchmark->Args( {n, n_queries, k, source_point_cloud_type,
+                              target_point_cloud_type} );
+}
+
+void radiusSearchArguments( benchmark::internal::Benchmark *benchmark )
+{
+    for ( int i = 0, n = n_values; i < values_steps; ++i, n *= 8 )
+        for ( int j = 0, k = n_neighbors; j < neighbors_steps; ++j, k *= 2 )
+            benchmark->Args( {n, n_queries, k, buffer_size,
+                              source_point_cloud_type,
+                              target_point_cloud_type} );
 }
 
 class KokkosScopeGuard
@@ -214,17 +415,15 @@ class KokkosScopeGuard
 
 #define REGISTER_BENCHMARK( DeviceType )                                       \
     BENCHMARK_TEMPLATE( BM_construction, DeviceType )                          \
-        ->Args( {n_values, source_point_cloud_type} )                          \
+        ->Apply( constructionArguments )                                       \
         ->UseManualTime()                                                      \
         ->Unit( benchmark::kMicrosecond );                                     \
     BENCHMARK_TEMPLATE( BM_knn_search, DeviceType )                            \
-        ->Args( {n_values, n_queries, n_neighbors, source_point_cloud_type,    \
-                 target_point_cloud_type} )                                    \
+        ->Apply( knnSearchArguments )                                          \
         ->UseManualTime()                                                      \
         ->Unit( benchmark::kMicrosecond );                                     \
     BENCHMARK_TEMPLATE( BM_radius_search, DeviceType )                         \
-        ->Args( {n_values, n_queries, n_neighbors, buffer_size,                \
-                 source_point_cloud_type, target_point_cloud_type} )           \
+        ->Apply( radiusSearchArguments )                                       \
         ->UseManualTime()                                                      \
         ->Unit( benchmark::kMicrosecond );
 
@@ -236,10 +435,10 @@ int main( int argc, char *argv[] )
     bool const recognise_all_options = false;
     Teuchos::CommandLineProcessor clp( throw_exceptions,
                                        recognise_all_options );
-    int n_values = 50000;
-    int n_queries = 20000;
-    int n_neighbors = 10;
-    int buffer_size = 0;
+    n_values = 50000;
+    n_queries = 20000;
+    n_neighbors = 10;
+    buffer_size = 0;
     std::string source_pt_cloud = "filled_box";
     std::string target_pt_cloud = "filled_box";
     clp.setOption( "values", &n_values, "number of indexable values (source)" );
@@ -252,6 +451,18 @@ int main( int argc, char *argv[] )
                    "shape of the source point cloud" );
     clp.setOption( "target-point-cloud-type", &target_pt_cloud,
                    "shape of the target point cloud" );
+    clp.setOption( "source-point-cloud-file", &source_point_cloud_file,
+                   "binary point cloud to read the source points from, "
+                   "which overrides the number of values and the shape" );
+    clp.setOption( "values-steps", &values_steps,
+                   "number of tree sizes to sweep over, multiplying the "
+                   "number of values by 8 at each step" );
+    clp.setOption( "neighbors-steps", &neighbors_steps,
+                   "number of numbers of neighbors (and radii) to sweep "
+                   "over, doubling the number of neighbors at each step" );
+    clp.setOption( "parallel-point-clouds", "serial-point-clouds",
+                   &parallel_point_clouds,
+                   "generate the point clouds in parallel on the device" );
 
     // Google benchmark only supports integer arguments (see
     // https://github.com/google/benchmark/issues/387), so we map the string to
@@ -261,8 +472,8 @@ int main( int argc, char *argv[] )
     to_point_cloud_enum["hollow_box"] = PointCloudType::hollow_box;
     to_point_cloud_enum["filled_sphere"] = PointCloudType::filled_sphere;
     to_point_cloud_enum["hollow_sphere"] = PointCloudType::hollow_sphere;
-    int source_point_cloud_type = to_point_cloud_enum.at( source_pt_cloud );
-    int target_point_cloud_type = to_point_cloud_enum.at( target_pt_cloud );
+    source_point_cloud_type = to_point_cloud_enum.at( source_pt_cloud );
+    target_point_cloud_type = to_point_cloud_enum.at( target_pt_cloud );
 
     switch ( clp.parse( argc, argv, NULL ) )
     {
@@ -293,6 +504,9 @@ int main( int argc, char *argv[] )
         break;
     }
 
+    if ( !source_point_cloud_file.empty() )
+        n_values = MappedPointCloud( source_point_cloud_file ).numberOfPoints();
+
 #ifdef KOKKOS_ENABLE_SERIAL
     using Serial = Kokkos::Compat::KokkosSerialWrapperNode::device_type;
     REGISTER_BENCHMARK( Serial );
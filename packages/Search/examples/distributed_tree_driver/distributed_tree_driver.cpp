@@ -10,16 +10,81 @@
  ****************************************************************************/
 
 #include <DTK_DistributedSearchTree.hpp>
+#include <DTK_Statistics.hpp>
 
 #include <Kokkos_DefaultNode.hpp>
+#include <Teuchos_CommHelpers.hpp>
 #include <Teuchos_CommandLineProcessor.hpp>
 #include <Teuchos_DefaultComm.hpp>
 #include <Teuchos_StandardCatchMacros.hpp>
 #include <Teuchos_Time.hpp>
 #include <Teuchos_TimeMonitor.hpp>
 
+#include <array>
 #include <cmath> // cbrt
+#include <iomanip>
 #include <random>
+#include <string>
+#include <vector>
+
+// Phases of the distributed search, in the order they occur.  The timers are
+// exclusive so the time spent moving data between the processes is only
+// reported under "communication" and what is left of the search under
+// "search".
+std::vector<std::string> const phases = {
+    "top tree query", "forward queries", "local query",   "return results",
+    "sort results",   "communication",   "search"};
+
+// Minimum, average, and maximum of a value over all the processes.
+std::array<double, 3> reduceOverRanks( Teuchos::Comm<int> const &comm,
+                                       double const local )
+{
+    double min;
+    double max;
+    double sum;
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_MIN, local,
+                        Teuchos::outArg( min ) );
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_MAX, local,
+                        Teuchos::outArg( max ) );
+    Teuchos::reduceAll( comm, Teuchos::REDUCE_SUM, local,
+                        Teuchos::outArg( sum ) );
+    return {{min, sum / comm.getSize(), max}};
+}
+
+// Report the time of each phase of an operation followed by its total time.
+// With csv, each line starts with the description of the run so that the
+// output of several runs can be concatenated and compared.
+void report( Teuchos::Comm<int> const &comm, std::ostream &os,
+             std::string const &operation,
+             DataTransferKit::Statistics const &stats, double total_time,
+             bool csv, std::string const &run )
+{
+    std::vector<std::pair<std::string, std::array<double, 3>>> rows;
+    auto const &times = stats.getTimes();
+    for ( auto const &phase : phases )
+    {
+        auto const it = times.find( phase );
+        double const local = ( it != times.end() ) ? it->second : 0.;
+        rows.emplace_back( phase, reduceOverRanks( comm, local ) );
+    }
+    rows.emplace_back( "total", reduceOverRanks( comm, total_time ) );
+
+    if ( comm.getRank() != 0 )
+        return;
+    for ( auto const &row : rows )
+    {
+        if ( csv )
+            os << run << ',' << operation << ',' << row.first << ','
+               << std::scientific << std::setprecision( 6 ) << row.second[0]
+               << ',' << row.second[1] << ',' << row.second[2] << "\n";
+        else
+            os << std::left << std::setw( 12 ) << operation << std::setw( 18 )
+               << row.first << std::right << std::scientific
+               << std::setprecision( 3 ) << std::setw( 12 ) << row.second[0]
+               << std::setw( 12 ) << row.second[1] << std::setw( 12 )
+               << row.second[2] << "\n";
+    }
+}
 
 template <class NO>
 int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
@@ -35,6 +100,10 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
     int n_neighbors = 10;
     double overlap = 0.;
     int partition_dim = 3;
+    std::string partition = "";
+    std::string scaling = "weak";
+    std::string output = "table";
+    std::string label = "";
     bool perform_knn_search = true;
     bool perform_radius_search = true;
 
@@ -52,7 +121,24 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
     clp.setOption( "partition_dim", &partition_dim,
                    "number of dimension used by the partitioning of the global "
                    "point cloud. 1 -> local clouds are aligned on a line, 2 -> "
-                   "local clouds form a board, 3 -> local clouds form a box" );
+                   "local clouds form a board, 3 -> local clouds form a box, "
+                   "0 -> no partitioning, the local clouds fill the same box" );
+    clp.setOption( "partition", &partition,
+                   "shape of the local domains, overrides partition_dim. "
+                   "slab -> local clouds are aligned on a line, cube -> local "
+                   "clouds form a box, random -> all the local clouds fill "
+                   "the same box so that every process owns points "
+                   "everywhere" );
+    clp.setOption( "scaling", &scaling,
+                   "weak -> the numbers of values and queries are per MPI "
+                   "rank, strong -> they are split among the MPI ranks" );
+    clp.setOption( "output", &output,
+                   "table -> summary tables, csv -> one line per operation "
+                   "and phase with the minimum, average, and maximum time "
+                   "over the MPI ranks" );
+    clp.setOption( "label", &label,
+                   "name of the run written at the beginning of the csv "
+                   "lines, e.g. a commit hash" );
     clp.setOption( "perform-knn-search", "do-not-perform-knn-search",
                    &perform_knn_search,
                    "whether or not to perform kNN search" );
@@ -75,6 +161,37 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
     Teuchos::RCP<const Teuchos::Comm<int>> comm =
         Teuchos::DefaultComm<int>::getComm();
     int rank = Teuchos::rank( *comm );
+    int const n_procs = Teuchos::size( *comm );
+
+    if ( partition == "slab" )
+        partition_dim = 1;
+    else if ( partition == "cube" )
+        partition_dim = 3;
+    else if ( partition == "random" )
+        partition_dim = 0;
+    else if ( partition != "" )
+        throw std::runtime_error( "partition should be slab, cube, or random" );
+
+    if ( scaling == "strong" )
+    {
+        // Split the global numbers as evenly as possible.
+        n_values = n_values / n_procs + ( rank < n_values % n_procs ? 1 : 0 );
+        n_queries =
+            n_queries / n_procs + ( rank < n_queries % n_procs ? 1 : 0 );
+    }
+    else if ( scaling != "weak" )
+        throw std::runtime_error( "scaling should be weak or strong" );
+
+    bool const csv = ( output == "csv" );
+    if ( !csv && output != "table" )
+        throw std::runtime_error( "output should be table or csv" );
+    std::string const run =
+        label + ',' + std::to_string( n_procs ) + ',' +
+        std::to_string( n_values ) + ',' + std::to_string( n_queries ) + ',' +
+        ( partition != "" ? partition
+                          : "dim" + std::to_string( partition_dim ) ) +
+        ',' + scaling;
+
     Kokkos::View<DataTransferKit::Point *, DeviceType> random_points(
         "random_points" );
     {
@@ -99,9 +216,19 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         double offset_z = 0.;
         // Change the geometry of the problem. In 1D, all the point clouds are
         // aligned on a line. In 2D, the point clouds create a board and in 3D,
-        // they create a box.
+        // they create a box.  Without partitioning, every process draws its
+        // points in the box that all the clouds would form in 3D.
         switch ( partition_dim )
         {
+        case 0:
+        {
+            double const scale = std::cbrt( n_procs );
+            distribution = std::uniform_real_distribution<double>(
+                -a * scale, +a * scale );
+            generator.seed( rank );
+
+            break;
+        }
         case 1:
         {
             offset_x = 2. * ( 1. - overlap ) * a * rank;
@@ -110,7 +237,6 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         }
         case 2:
         {
-            int n_procs = Teuchos::size( *comm );
             int i_max = std::ceil( std::sqrt( n_procs ) );
             int i = rank % i_max;
             int j = rank / i_max;
@@ -121,7 +247,6 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         }
         case 3:
         {
-            int n_procs = Teuchos::size( *comm );
             int i_max = std::ceil( std::cbrt( n_procs ) );
             int j_max = i_max;
             int i = rank % i_max;
@@ -135,7 +260,8 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         }
         default:
         {
-            throw std::runtime_error( "partition_dim should be 1, 2, or 3" );
+            throw std::runtime_error(
+                "partition_dim should be 0, 1, 2, or 3" );
         }
         }
 
@@ -160,15 +286,26 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
                           } );
     Kokkos::fence();
 
+    // The phases of each operation are recorded separately.
+    DataTransferKit::Statistics construction_stats;
+    DataTransferKit::Statistics knn_stats;
+    DataTransferKit::Statistics radius_stats;
+    double knn_time = 0.;
+    double radius_time = 0.;
+
     auto construction = time_monitor.getNewTimer( "construction" );
     comm->barrier();
     construction->start();
-    DataTransferKit::DistributedSearchTree<DeviceType> distributed_tree(
-        comm, bounding_boxes );
+    auto const distributed_tree = [&]() {
+        DataTransferKit::StatisticsScope construction_scope(
+            construction_stats );
+        return DataTransferKit::DistributedSearchTree<DeviceType>(
+            comm, bounding_boxes );
+    }();
     construction->stop();
 
     std::ostream &os = std::cout;
-    if ( rank == 0 )
+    if ( rank == 0 && !csv )
         os << "contruction done\n";
 
     if ( perform_knn_search )
@@ -193,10 +330,14 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         auto knn = time_monitor.getNewTimer( "knn" );
         comm->barrier();
         knn->start();
-        distributed_tree.query( queries, indices, offset, ranks );
+        {
+            DataTransferKit::StatisticsScope knn_scope( knn_stats );
+            distributed_tree.query( queries, indices, offset, ranks );
+        }
         knn->stop();
+        knn_time = knn->totalElapsedTime();
 
-        if ( rank == 0 )
+        if ( rank == 0 && !csv )
             os << "knn done\n";
     }
 
@@ -226,13 +367,36 @@ int main_( Teuchos::CommandLineProcessor &clp, int argc, char *argv[] )
         auto radius = time_monitor.getNewTimer( "radius" );
         comm->barrier();
         radius->start();
-        distributed_tree.query( queries, indices, offset, ranks );
+        {
+            DataTransferKit::StatisticsScope radius_scope( radius_stats );
+            distributed_tree.query( queries, indices, offset, ranks );
+        }
         radius->stop();
+        radius_time = radius->totalElapsedTime();
 
-        if ( rank == 0 )
+        if ( rank == 0 && !csv )
             os << "radius done\n";
     }
-    time_monitor.summarize( comm.ptr() );
+
+    if ( rank == 0 )
+    {
+        if ( csv )
+            os << "label,ranks,values,queries,partition,scaling,operation,"
+                  "phase,min,avg,max\n";
+        else
+            os << std::left << std::setw( 12 ) << "operation"
+               << std::setw( 18 ) << "phase" << std::right << std::setw( 12 )
+               << "min [s]" << std::setw( 12 ) << "avg [s]" << std::setw( 12 )
+               << "max [s]" << "\n";
+    }
+    report( *comm, os, "construction", construction_stats,
+            construction->totalElapsedTime(), csv, run );
+    if ( perform_knn_search )
+        report( *comm, os, "knn", knn_stats, knn_time, csv, run );
+    if ( perform_radius_search )
+        report( *comm, os, "radius", radius_stats, radius_time, csv, run );
+    if ( !csv )
+        time_monitor.summarize( comm.ptr() );
 
     return 0;
 }
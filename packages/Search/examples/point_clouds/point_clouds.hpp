@@ -11,10 +11,22 @@
 
 #include <DTK_DBC.hpp>
 
+#include <Kokkos_Random.hpp>
 #include <Kokkos_View.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // memcmp, memcpy
 #include <fstream>
 #include <random>
+#include <stdexcept>
+#include <string>
+#include <utility> // make_pair
+
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
 
 enum PointCloudType { filled_box, hollow_box, filled_sphere, hollow_sphere };
 
@@ -217,3 +229,225 @@ void generatePointCloud(
     }
     Kokkos::deep_copy( random_points, random_points_host );
 }
+
+// Same shapes as generatePointCloud() but the points are generated in
+// parallel, directly in the memory space of the view, with the random number
+// generators of a Kokkos::Random_XorShift64_Pool.  This spares the serial
+// generation on the host and the copy, which dominate the setup of large
+// clouds.  The points are not the same as those of generatePointCloud().
+// Give each process its own seed, e.g. its rank, for the processes to
+// generate different points.
+template <typename DeviceType>
+void generatePointCloudInParallel(
+    PointCloudType const point_cloud_type, double const length,
+    Kokkos::View<DataTransferKit::Point *, DeviceType> random_points,
+    std::uint64_t seed = 0 )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    if ( point_cloud_type != PointCloudType::filled_box &&
+         point_cloud_type != PointCloudType::hollow_box &&
+         point_cloud_type != PointCloudType::filled_sphere &&
+         point_cloud_type != PointCloudType::hollow_sphere )
+        throw DataTransferKit::DataTransferKitNotImplementedException();
+
+    // The state of the generators must not be zero.
+    Kokkos::Random_XorShift64_Pool<ExecutionSpace> pool( seed + 1 );
+    Kokkos::parallel_for(
+        "generate_point_cloud",
+        Kokkos::RangePolicy<ExecutionSpace>( 0, random_points.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            auto generator = pool.get_state();
+            auto random = [&generator]( double const half_edge ) {
+                return generator.drand( -half_edge, half_edge );
+            };
+            DataTransferKit::Point point;
+            if ( point_cloud_type == PointCloudType::filled_box )
+            {
+                point = {{random( length ), random( length ),
+                          random( length )}};
+            }
+            else if ( point_cloud_type == PointCloudType::hollow_box )
+            {
+                point = {{random( length ), random( length ),
+                          random( length )}};
+                int const face = i % 6;
+                point[face / 2] = ( face % 2 == 0 ? -length : length );
+            }
+            else if ( point_cloud_type == PointCloudType::filled_sphere )
+            {
+                // Only accept points that are in the sphere
+                do
+                {
+                    point = {{random( length ), random( length ),
+                              random( length )}};
+                } while ( point[0] * point[0] + point[1] * point[1] +
+                              point[2] * point[2] >
+                          length * length );
+            }
+            else
+            {
+                double const x = random( 1. );
+                double const y = random( 1. );
+                double const z = random( 1. );
+                double const norm = std::sqrt( x * x + y * y + z * z );
+                point = {{length * x / norm, length * y / norm,
+                          length * z / norm}};
+            }
+            random_points( i ) = point;
+            pool.free_state( generator );
+        } );
+    Kokkos::fence();
+}
+
+// Binary point clouds start with this header.  The coordinates of the points
+// follow, three doubles per point, and then the connectivity of the cells if
+// any, as ints.  The numbers are stored in the byte order of the machine that
+// wrote them.
+struct BinaryPointCloudHeader
+{
+    char magic[8];
+    std::uint64_t n_points;
+    std::uint64_t n_cells;
+    std::uint64_t nodes_per_cell;
+};
+
+static char const binary_point_cloud_magic[8] = {'D', 'T', 'K', 'P',
+                                                 'C', 'L', 'D', '1'};
+
+template <typename Layout, typename DeviceType>
+void writeBinaryPointCloud(
+    Kokkos::View<DataTransferKit::Point *, Layout, DeviceType> points,
+    std::string const &filename,
+    Kokkos::View<int const **, Kokkos::LayoutRight, Kokkos::HostSpace>
+        connectivity =
+            Kokkos::View<int const **, Kokkos::LayoutRight,
+                         Kokkos::HostSpace>() )
+{
+    static_assert(
+        Kokkos::Impl::MemorySpaceAccess<
+            Kokkos::HostSpace, typename DeviceType::memory_space>::accessible,
+        "The View should be accessible on the Host" );
+    std::ofstream file( filename, std::ios::binary );
+    if ( !file.is_open() )
+        throw std::runtime_error( "Cannot open " + filename );
+    BinaryPointCloudHeader header;
+    std::memcpy( header.magic, binary_point_cloud_magic, 8 );
+    header.n_points = points.extent( 0 );
+    header.n_cells = connectivity.extent( 0 );
+    header.nodes_per_cell = connectivity.extent( 1 );
+    file.write( reinterpret_cast<char const *>( &header ), sizeof( header ) );
+    for ( unsigned int i = 0; i < header.n_points; ++i )
+        file.write( reinterpret_cast<char const *>( &points( i )[0] ),
+                    3 * sizeof( double ) );
+    file.write( reinterpret_cast<char const *>( connectivity.data() ),
+                connectivity.size() * sizeof( int ) );
+    if ( !file )
+        throw std::runtime_error( "Cannot write " + filename );
+}
+
+/** Binary point cloud mapped into memory.  The views point directly into the
+ *  mapping, so that nothing is read before it is accessed and the pages are
+ *  only loaded as they are touched, e.g. by the threads of the deep copy of
+ *  the part of the points given to the calling process.  The views must not
+ *  outlive this object.
+ */
+class MappedPointCloud
+{
+  public:
+    using PointsView =
+        Kokkos::View<DataTransferKit::Point const *, Kokkos::HostSpace,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+    using ConnectivityView =
+        Kokkos::View<int const **, Kokkos::LayoutRight, Kokkos::HostSpace,
+                     Kokkos::MemoryTraits<Kokkos::Unmanaged>>;
+
+    explicit MappedPointCloud( std::string const &filename )
+    {
+        int const fd = open( filename.c_str(), O_RDONLY );
+        if ( fd == -1 )
+            throw std::runtime_error( "Cannot open " + filename );
+        struct stat file_status;
+        if ( fstat( fd, &file_status ) == -1 ||
+             static_cast<std::size_t>( file_status.st_size ) <
+                 sizeof( BinaryPointCloudHeader ) )
+        {
+            close( fd );
+            throw std::runtime_error( filename + " is not a point cloud" );
+        }
+        _size = file_status.st_size;
+        _data = mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        close( fd );
+        if ( _data == MAP_FAILED )
+            throw std::runtime_error( "Cannot map " + filename );
+
+        std::memcpy( &_header, _data, sizeof( _header ) );
+        std::size_t const expected_size =
+            sizeof( _header ) + _header.n_points * 3 * sizeof( double ) +
+            _header.n_cells * _header.nodes_per_cell * sizeof( int );
+        if ( std::memcmp( _header.magic, binary_point_cloud_magic, 8 ) != 0 ||
+             _size != expected_size )
+        {
+            munmap( _data, _size );
+            throw std::runtime_error( filename + " is not a point cloud" );
+        }
+    }
+
+    ~MappedPointCloud() { munmap( _data, _size ); }
+
+    MappedPointCloud( MappedPointCloud const & ) = delete;
+    MappedPointCloud &operator=( MappedPointCloud const & ) = delete;
+
+    std::size_t numberOfPoints() const { return _header.n_points; }
+
+    std::size_t numberOfCells() const { return _header.n_cells; }
+
+    PointsView points() const
+    {
+        return PointsView(
+            reinterpret_cast<DataTransferKit::Point const *>(
+                static_cast<char const *>( _data ) + sizeof( _header ) ),
+            _header.n_points );
+    }
+
+    // Points of the ith of n_parts contiguous parts of about the same size,
+    // e.g. those of the process of rank i.  The kernel is advised to read
+    // them ahead.
+    PointsView points( int i, int n_parts ) const
+    {
+        DTK_REQUIRE( i >= 0 && i < n_parts );
+        std::size_t const n = _header.n_points;
+        std::size_t const begin = n * i / n_parts;
+        std::size_t const end = n * ( i + 1 ) / n_parts;
+        auto const part =
+            Kokkos::subview( points(), std::make_pair( begin, end ) );
+        adviseWillNeed( part.data(), part.size() * 3 * sizeof( double ) );
+        return part;
+    }
+
+    // Nodes of each cell, one row per cell.
+    ConnectivityView connectivity() const
+    {
+        return ConnectivityView(
+            reinterpret_cast<int const *>(
+                static_cast<char const *>( _data ) + sizeof( _header ) +
+                _header.n_points * 3 * sizeof( double ) ),
+            _header.n_cells, _header.nodes_per_cell );
+    }
+
+  private:
+    void adviseWillNeed( void const *ptr, std::size_t size ) const
+    {
+        // madvise() wants an address aligned to a page.
+        auto const page =
+            static_cast<std::uintptr_t>( sysconf( _SC_PAGESIZE ) );
+        auto const address = reinterpret_cast<std::uintptr_t>( ptr );
+        auto const aligned = address - address % page;
+        madvise( reinterpret_cast<void *>( aligned ), size + address - aligned,
+                 MADV_WILLNEED );
+    }
+
+    void *_data = nullptr;
+    std::size_t _size = 0;
+    BinaryPointCloudHeader _header;
+};
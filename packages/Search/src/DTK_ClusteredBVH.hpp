@@ -0,0 +1,288 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_CLUSTERED_BVH_HPP
+#define DTK_CLUSTERED_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsStack.hpp>
+#include <DTK_DetailsStackTraversal.hpp>
+#include <DTK_DetailsTreeConstruction.hpp> // assignMortonCodes, sortObjects
+#include <DTK_DetailsTreeTraversal.hpp>
+#include <DTK_LinearBVH.hpp>
+
+#include <Kokkos_Pair.hpp>
+#include <Kokkos_View.hpp>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+template <typename DeviceType>
+struct ClusteredTreeTraversal
+{
+    using Traversal = TreeTraversal<DeviceType>;
+
+    // The objects of a cluster are contiguous in memory and tested one after
+    // the other once the box of the cluster satisfies the predicate.
+    template <typename Predicate, typename Insert>
+    KOKKOS_FUNCTION int spatialQuery( Predicate const &pred,
+                                      Insert const &insert ) const
+    {
+        int count = 0;
+        Details::spatialQuery(
+            _clusters, pred, [this, &pred, &insert, &count]( int cluster ) {
+                Node leaf;
+                int const end = lastObjectOfCluster( cluster );
+                for ( int i = firstObjectOfCluster( cluster ); i < end; ++i )
+                {
+                    leaf.bounding_box = _boxes( i );
+                    if ( pred( &leaf ) )
+                    {
+                        insert( _indices( i ) );
+                        ++count;
+                    }
+                }
+            } );
+        return count;
+    }
+
+    // See stackTraversalQuery().  Descends into the closest child first and
+    // computes the distances to every object of the clusters that are closer
+    // than the current radius.
+    KOKKOS_FUNCTION int nearestQuery( Point const &point, int k,
+                                      double max_distance_squared,
+                                      Kokkos::pair<int, double> *buffer ) const
+    {
+        NearestHeap heap(
+            UnmanagedStaticVector<Kokkos::pair<int, double>>( buffer, k ) );
+        double radius = max_distance_squared;
+
+        using PairNodePtrDistance = Kokkos::pair<Node const *, double>;
+        Stack<PairNodePtrDistance> stack;
+        Node const *root = Traversal::getRoot( _clusters );
+        stack.emplace( root, distanceSquared( point, root->bounding_box ) );
+        while ( !stack.empty() )
+        {
+            Node const *node = stack.top().first;
+            double const node_distance = stack.top().second;
+            stack.pop();
+            if ( !( node_distance < radius ) )
+                continue;
+
+            if ( Traversal::isLeaf( node ) )
+            {
+                int const cluster = Traversal::getIndex( node );
+                int const end = lastObjectOfCluster( cluster );
+                for ( int i = firstObjectOfCluster( cluster ); i < end; ++i )
+                {
+                    double const distance =
+                        distanceSquared( point, _boxes( i ) );
+                    if ( distance < radius )
+                        insertNearest( heap, radius, k, _indices( i ),
+                                       distance );
+                }
+                continue;
+            }
+
+            Node const *left_child = Traversal::getLeftChild( _clusters, node );
+            double const left_child_distance =
+                distanceSquared( point, left_child->bounding_box );
+            Node const *right_child =
+                Traversal::getRightChild( _clusters, node );
+            double const right_child_distance =
+                distanceSquared( point, right_child->bounding_box );
+            // Make sure that the closest child ends on top of the stack.
+            if ( left_child_distance < right_child_distance )
+            {
+                stack.emplace( right_child, right_child_distance );
+                stack.emplace( left_child, left_child_distance );
+            }
+            else
+            {
+                stack.emplace( left_child, left_child_distance );
+                stack.emplace( right_child, right_child_distance );
+            }
+        }
+        return sortNearest( heap );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    int firstObjectOfCluster( int cluster ) const
+    {
+        return cluster * _leaf_size;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    int lastObjectOfCluster( int cluster ) const
+    {
+        int const end = ( cluster + 1 ) * _leaf_size;
+        int const n = _boxes.extent( 0 );
+        return end < n ? end : n;
+    }
+
+    BVH<DeviceType> _clusters;
+    Kokkos::View<Box const *, DeviceType> _boxes;
+    Kokkos::View<int const *, DeviceType> _indices;
+    int _leaf_size;
+};
+} // namespace Details
+
+/** Hierarchy whose leaves hold clusters of up to leaf_size objects instead of
+ *  a single one.  The objects are sorted along the Z-order curve and grouped
+ *  by consecutive runs, and a binary hierarchy is built over the bounds of
+ *  the clusters.  This divides the number of nodes by about the leaf size
+ *  and replaces the last levels of the traversal, that hardly prune anything
+ *  when the objects are small, e.g. points, by a loop over boxes that are
+ *  contiguous in memory.  Leaf sizes from 4 to 16 are a good compromise
+ *  between the two.
+ *
+ *  The results are the same as those of a BoundingVolumeHierarchy over all
+ *  the objects.
+ */
+template <typename DeviceType>
+class ClusteredBVH
+{
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+
+    ClusteredBVH() = default; // build an empty tree
+    ClusteredBVH( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                  int leaf_size = 8 );
+
+    /** Same as BoundingVolumeHierarchy::query() with views of results.  The
+     *  spatial predicates may not be modified by FirstHit or CountOnly, and
+     *  the objects intersected by rays or segments are reported in no
+     *  particular order.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances ) const;
+
+    Box bounds() const { return _clusters.bounds(); }
+
+    SizeType size() const { return _indices.extent( 0 ); }
+
+    bool empty() const { return size() == 0; }
+
+    int numberOfClusters() const { return _clusters.size(); }
+
+  private:
+    using Traversal = Details::ClusteredTreeTraversal<DeviceType>;
+
+    Traversal traversal() const
+    {
+        return {_clusters, _boxes, _indices, _leaf_size};
+    }
+
+    int _leaf_size = 1;
+    BVH<DeviceType> _clusters;
+    // Boxes and indices of the objects sorted along the Z-order curve.
+    Kokkos::View<Box *, DeviceType> _boxes;
+    Kokkos::View<int *, DeviceType> _indices;
+};
+
+template <typename DeviceType>
+ClusteredBVH<DeviceType>::ClusteredBVH(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, int leaf_size )
+    : _leaf_size( leaf_size )
+    , _boxes( Kokkos::ViewAllocateWithoutInitializing( "sorted_boxes" ),
+              bounding_boxes.extent( 0 ) )
+    , _indices( Kokkos::ViewAllocateWithoutInitializing( "sorted_indices" ),
+                bounding_boxes.extent( 0 ) )
+{
+    DTK_REQUIRE( leaf_size > 0 );
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using TreeConstruction = Details::TreeConstruction<DeviceType>;
+
+    int const n = bounding_boxes.extent( 0 );
+    if ( n == 0 )
+        return;
+
+    Box scene_bounding_box;
+    TreeConstruction::calculateBoundingBoxOfTheScene( bounding_boxes,
+                                                      scene_bounding_box );
+    Kokkos::View<unsigned int *, DeviceType> morton_codes(
+        Kokkos::ViewAllocateWithoutInitializing( "morton_codes" ), n );
+    TreeConstruction::assignMortonCodes( bounding_boxes, morton_codes,
+                                         scene_bounding_box );
+    auto const permutation_indices =
+        TreeConstruction::sortObjects( morton_codes );
+
+    auto boxes = _boxes;
+    auto indices = _indices;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "clustered_bvh:sort_objects" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        KOKKOS_LAMBDA( int i ) {
+            int const index = permutation_indices( i );
+            boxes( i ) = bounding_boxes( index );
+            indices( i ) = index;
+        } );
+    Kokkos::fence();
+
+    int const n_clusters = ( n + leaf_size - 1 ) / leaf_size;
+    Kokkos::View<Box *, DeviceType> cluster_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "cluster_boxes" ),
+        n_clusters );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "clustered_bvh:bound_clusters" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_clusters ),
+        KOKKOS_LAMBDA( int c ) {
+            int const end =
+                ( c + 1 ) * leaf_size < n ? ( c + 1 ) * leaf_size : n;
+            Box box;
+            for ( int i = c * leaf_size; i < end; ++i )
+                Details::expand( box, boxes( i ) );
+            cluster_boxes( c ) = box;
+        } );
+    Kokkos::fence();
+
+    _clusters = BVH<DeviceType>( cluster_boxes );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void ClusteredBVH<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    Details::stackTraversalQuery( traversal(), bounds(), size(), queries,
+                                  indices, offset );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void ClusteredBVH<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    Details::stackTraversalQuery( traversal(), bounds(), size(), queries,
+                                  indices, offset, distances );
+}
+
+} // namespace DataTransferKit
+
+#endif
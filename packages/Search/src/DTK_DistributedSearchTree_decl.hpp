@@ -15,18 +15,52 @@
 #include <Kokkos_View.hpp>
 
 #include <Teuchos_Comm.hpp>
+#include <Teuchos_CommHelpers.hpp>
 #include <Teuchos_RCP.hpp>
 
 #include <DTK_DBC.hpp>
+#include <DTK_DetailsCachingAllocator.hpp>
 #include <DTK_DetailsDistributedSearchTreeImpl.hpp>
 #include <DTK_LinearBVH.hpp>
+#include <DTK_Statistics.hpp>
+#include <DTK_HashGrid.hpp>
+#include <DTK_StructuredGrid.hpp>
 
 #include "DTK_ConfigDefs.hpp"
 
+#include <algorithm> // min
+#include <memory>
+#include <vector>
+
 namespace DataTransferKit
 {
 
+template <typename DeviceType, typename Query>
+class DistributedQueryRequest;
+
 /** \brief Distributed search tree
+ *
+ *  Each process holds a local (bottom) tree of its objects and a replicated
+ *  top tree that tells which processes queries must be forwarded to.  Rather
+ *  than a single box per process, the leaves of the top tree are the upper
+ *  nodes of the local trees, i.e. the nodes at depth upper_levels_depth and
+ *  the leaves above them.  This describes non-convex or disconnected local
+ *  domains much more tightly at the price of a few more boxes per process.
+ *
+ *  By default, every process holds the upper nodes of all the local trees,
+ *  which takes memory and construction time proportional to the number of
+ *  processes.  Alternatively, the processes may be split into groups of
+ *  consecutive ranks.  Each process then only holds the upper nodes of the
+ *  local trees in its own group, along with a single box per other group.
+ *  Queries that reach one of these boxes are forwarded to all the processes
+ *  in that group.  This pays off on large communicators when consecutive
+ *  ranks own nearby parts of the domain.
+ *
+ *  The local tree lives in the memory space of DeviceType, i.e. on the single
+ *  device that Kokkos was initialized with on this process.  Nodes with
+ *  several GPUs should run one process per GPU, and the processes of a node
+ *  may then form a group of consecutive ranks, so that the top tree still
+ *  describes the node as a whole to the other groups.
  *
  *  \note size() and empty() must be called as collectives over all processes
  *  in the communicator passed to the constructor.
@@ -35,9 +69,44 @@ template <typename DeviceType>
 class DistributedSearchTree
 {
   public:
+    /** \param[in] ranks_per_group Number of consecutive ranks in each group
+     *  (see above).  Zero, the default, means a single group with all the
+     *  processes.  It must be the same on all processes.
+     */
+    DistributedSearchTree( Teuchos::RCP<Teuchos::Comm<int> const> comm,
+                           Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                           int ranks_per_group = 0 );
+
+    //! Same as above but the local objects are points.
+    DistributedSearchTree( Teuchos::RCP<Teuchos::Comm<int> const> comm,
+                           Kokkos::View<Point const *, DeviceType> points,
+                           int ranks_per_group = 0 );
+
+    //! Same as above but the local points are given by their coordinates.
     DistributedSearchTree(
         Teuchos::RCP<Teuchos::Comm<int> const> comm,
-        Kokkos::View<Box const *, DeviceType> bounding_boxes );
+        Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType>
+            coordinates,
+        int ranks_per_group = 0 );
+
+    /** Update the tree after the local objects moved, without reconstructing
+     *  it.  The local tree is refitted and only the processes whose local
+     *  bounds changed send them to the others before the top tree gets
+     *  refitted in turn.  With several groups of ranks, the bounds are
+     *  exchanged again within each group and between the groups.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \param[in] bounding_boxes New bounding boxes of the local objects, in
+     *  the same order and in the same number as those used to construct the
+     *  tree.
+     *
+     *  \return The largest quality ratio of the local trees over all
+     *  processes (see BVH::refit()).  Since it is the same on all processes,
+     *  it can be used to decide collectively when to rebuild the tree.
+     */
+    double refit( Kokkos::View<Box const *, DeviceType> bounding_boxes );
 
     /** Returns the smallest axis-aligned box able to contain all the objects
      *  stored in the tree or an invalid box if the tree is empty.
@@ -95,13 +164,397 @@ class DistributedSearchTree
            Kokkos::View<int *, DeviceType> &ranks,
            Kokkos::View<double *, DeviceType> &distances ) const;
 
+    /** \brief Perform spatial queries but leave the results on the
+     *  processes that own the matching objects
+     *
+     *  The queries are forwarded and searched in the local trees as in
+     *  query() but nothing is sent back.  This lets the caller refine the
+     *  candidates where the objects live, e.g. with an exact geometric test,
+     *  and only communicate what it needs afterwards.  Work sharing (see
+     *  shareWork()) is not used.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \param[in] queries Collection of spatial predicates.
+     *  \param[out] fwd_queries Queries received by this process.
+     *  \param[out] indices Local indices of the objects that satisfy the
+     *  received queries, in compressed row storage format.
+     *  \param[out] offset Array of received query offsets.
+     *  \param[out] ids Position of each received query on the process it
+     *  comes from.
+     *  \param[out] ranks Rank of the process each received query comes from.
+     */
+    template <typename Query>
+    typename std::enable_if<
+        std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+        void>::type
+    queryOnOwners( Kokkos::View<Query *, DeviceType> queries,
+                   Kokkos::View<Query *, DeviceType> &fwd_queries,
+                   Kokkos::View<int *, DeviceType> &indices,
+                   Kokkos::View<int *, DeviceType> &offset,
+                   Kokkos::View<int *, DeviceType> &ids,
+                   Kokkos::View<int *, DeviceType> &ranks ) const;
+
+    /** \brief Reduce the values of the objects that satisfy each spatial
+     *  predicate
+     *
+     *  This is the distributed counterpart of BVH::reduce().  The queries are
+     *  forwarded to the processes whose local domains they intersect, which
+     *  reduce the values of their matching objects, and a single partial value
+     *  per query and process is sent back to be combined.  No result list is
+     *  allocated nor communicated.  Work sharing (see shareWork()) and the
+     *  grids are not used.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \param[in] queries Collection of spatial predicates.
+     *  \param[in] values Value of each local object, as values( index ).
+     *  \param[in] reducer Combines the values, e.g. SumReducer, MinReducer or
+     *  MaxReducer.
+     *  \param[out] results Value of each query, the identity of the reduction
+     *  if no object satisfies it.
+     */
+    template <typename Query, typename Values, typename Reducer>
+    void reduce(
+        Kokkos::View<Query *, DeviceType> queries, Values const &values,
+        Reducer const &reducer,
+        Kokkos::View<typename Reducer::value_type *, DeviceType> &results )
+        const;
+
+    /** \brief Find the pairs of objects, one from each tree, whose bounding
+     *  boxes intersect
+     *
+     *  This gives the same results as query() with one Overlap predicate per
+     *  local object of the other tree, but the objects are not forwarded
+     *  through the top tree one by one.  The leaves of the top tree that
+     *  intersect the local bounds of the other tree are joined with its local
+     *  objects, each object is sent to the processes whose local domains it
+     *  intersects and the local tree is joined there with the objects it
+     *  received.  Communication is then proportional to the interface between
+     *  the two partitions rather than to the number of objects.  Work sharing
+     *  (see shareWork()) and the grids are not used.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.  Both trees must be
+     *  distributed over communicators of the same size, with the same ranks.
+     *
+     *  \param[in] other Tree whose local objects are the queries.
+     *  \param[out] indices Local indices of the objects of this tree that
+     *  intersect the ith local object of \c other, stored from \c offset(i)
+     *  to <code>offset(i+1) - 1</code>, in no particular order.
+     *  \param[out] offset Array of offsets, one per local object of \c other
+     *  plus one.
+     *  \param[out] ranks Process ranks that own the objects.
+     */
+    void join( DistributedSearchTree const &other,
+               Kokkos::View<int *, DeviceType> &indices,
+               Kokkos::View<int *, DeviceType> &offset,
+               Kokkos::View<int *, DeviceType> &ranks ) const;
+
+    /** \brief Non-blocking counterpart of query() for spatial predicates
+     *
+     *  The queries are split into chunks that are processed as a pipeline
+     *  (see DistributedQueryRequest).  The first chunk is forwarded before
+     *  returning.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.  The tree must outlive the
+     *  request.
+     *
+     *  \param[in] queries Collection of spatial predicates.
+     *  \param[in] chunk_size Number of queries per chunk on this process.
+     *  Processes with fewer chunks than the others send empty ones.
+     */
+    template <typename Query>
+    typename std::enable_if<
+        std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+        DistributedQueryRequest<DeviceType, Query>>::type
+    queryAsync( Kokkos::View<Query *, DeviceType> queries,
+                int chunk_size ) const;
+
+    /** \brief Measure how unevenly a batch of spatial queries loads the
+     *  processes
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \return The largest number of (query, process) pairs that a process
+     *  receives divided by the average over all processes, or one if there
+     *  are none.  Work sharing (see shareWork()) is taken into account.
+     */
+    template <typename Query>
+    double imbalance( Kokkos::View<Query *, DeviceType> queries ) const;
+
+    /** \brief Let the least loaded processes answer part of the queries
+     *  bound for the overloaded ones
+     *
+     *  The processes that would receive more than \c max_imbalance times
+     *  the average number of queries of the given batch send a copy of their
+     *  local objects to some of the processes that receive no more than the
+     *  average.  The spatial queries bound for an overloaded process are
+     *  then dealt between it and its helpers, which report the results as
+     *  if they came from the owner.  This pays off when similar batches are
+     *  queried repeatedly, e.g. when targets cluster near a front.  Nearest
+     *  queries and queryAsync() are not affected.  Any previous work sharing
+     *  is discarded first and refit() discards it as well.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \return The imbalance of the given batch once work is shared.
+     */
+    template <typename Query>
+    double shareWork( Kokkos::View<Query *, DeviceType> queries,
+                      double max_imbalance = 2. );
+
+    /** \brief Find the process whose local domain is the closest to each
+     *  query
+     *
+     *  Only the replicated top tree is searched, with the centroid of the
+     *  geometry of the queries, so that no communication is needed.  The
+     *  results of a query are likely to be found mostly on that process,
+     *  e.g. to migrate the queries there beforehand when the partition of
+     *  the queries is unrelated to the one of the tree.  This is the calling
+     *  process if the tree is empty.
+     */
+    template <typename Query>
+    Kokkos::View<int *, DeviceType>
+    findNearestRanks( Kokkos::View<Query *, DeviceType> queries ) const;
+
+    /** \brief Gather the objects of the other processes that lie within a
+     *  given distance of the local ones
+     *
+     *  Once the halo is built, nearest queries are sent to the process that
+     *  owns the closest leaf of the top tree and answered there in a single
+     *  round trip whenever the k nearest neighbors it finds among its own
+     *  objects and the halo are provably the right ones.  The other queries
+     *  fall back on the usual two passes.  A width comparable to the
+     *  distance to the kth neighbor lets most queries near the boundaries of
+     *  the local domains be resolved.  refit() rebuilds the halo with the
+     *  same width.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     *
+     *  \param[in] halo_width Distance by which the local bounds are grown.
+     *  It must be the same on all processes.
+     */
+    void buildHalo( double halo_width );
+
+    /** \brief Forward each query to a single process among those that hold
+     *  the same objects
+     *
+     *  The processes that pass the same non-negative \c replica_group declare
+     *  that their local objects are identical, e.g. the copies of a block of
+     *  a grid that is replicated over several sets.  Queries are then
+     *  forwarded to one member of each group rather than to all of them: the
+     *  querying process itself if it belongs to the group, otherwise a member
+     *  dealt according to its rank and the query index so that the load is
+     *  spread over the group.  The results are reported on that member, i.e.
+     *  duplicates due to the replication are never returned.  This divides
+     *  the number of forwarded queries and of results by the size of the
+     *  groups.  A negative \c replica_group means that the local objects are
+     *  not replicated.  The groups survive refit() as long as the replicas
+     *  are moved the same way.
+     *
+     *  \note This must be called as a collective over all processes in the
+     *  communicator passed to the constructor.
+     */
+    void setReplicaGroup( int replica_group );
+
+    /** \brief Search the local objects with a structured grid rather than
+     *  the local tree
+     *
+     *  When the local objects are the cells of a rectilinear grid, e.g. as
+     *  recognized by StructuredGrid::fromBoxes(), the spatial queries
+     *  forwarded to this process locate the matching objects directly from
+     *  the edges of the grid.  The top tree, nearest queries, and the halo
+     *  still rely on the local tree.  The grid must hold the objects used to
+     *  construct the tree, with the same indices.  refit() discards it.
+     */
+    void setStructuredGrid( StructuredGrid<DeviceType> const &grid );
+
+    /** \brief Search the local objects with a hash grid rather than the
+     *  local tree
+     *
+     *  For point clouds of uniform density, the spatial and nearest queries
+     *  forwarded to this process are answered by binning the local objects
+     *  into a uniform grid (see HashGrid).  The top tree and the halo still
+     *  rely on the local tree, and a structured grid takes precedence for
+     *  spatial queries.  The grid must hold the objects used to construct
+     *  the tree, with the same indices.  refit() discards it.
+     */
+    void setHashGrid( HashGrid<DeviceType> const &grid );
+
   private:
     friend struct Details::DistributedSearchTreeImpl<DeviceType>;
+    template <typename, typename>
+    friend class DistributedQueryRequest;
+    // Gather the upper nodes of the local trees once the bottom tree has been
+    // built.
+    void buildTopTree( int ranks_per_group );
+    // Exchange the bounds of the upper nodes of the local trees, padded to
+    // 2^upper_levels_depth entries, within the group and the summaries of
+    // the groups among them.  The leaves of the top tree are returned in the
+    // order they are stored.
+    void gatherTopTreeLeaves( std::vector<Box> const &local_bounds,
+                              std::vector<int> const &local_sizes,
+                              std::vector<Box> &leaf_bounds,
+                              std::vector<int> &leaf_ranks,
+                              std::vector<int> &leaf_n_ranks,
+                              std::vector<int> &leaf_sizes ) const;
+    // Pick the helpers of the overloaded processes given the number of
+    // queries each process receives and send them the local objects.
+    void replicateLocalTrees( std::vector<int> const &loads,
+                              double max_imbalance );
+    void clearWorkSharing();
+    double refitTrees( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+    // Copy the leaves of the top tree to _host_top_tree if they are few
+    // enough, clear it otherwise.
+    void updateHostTopTree();
+    static double computeImbalance( std::vector<int> const &loads );
+    // At most 2^upper_levels_depth boxes per process.
+    static int constexpr upper_levels_depth = 3;
+    // Largest top tree that is queried on the host (see _host_top_tree).
+    static int constexpr max_host_top_tree_leaves = 4096;
+    using HostDeviceType =
+        Kokkos::Device<Kokkos::DefaultHostExecutionSpace, Kokkos::HostSpace>;
     Teuchos::RCP<Teuchos::Comm<int> const> _comm;
+    // Processes in the same group and, on the first process of each group,
+    // the first processes of all the groups.  The latter is null elsewhere or
+    // if there is a single group.
+    int _ranks_per_group;
+    Teuchos::RCP<Teuchos::Comm<int> const> _group_comm;
+    Teuchos::RCP<Teuchos::Comm<int> const> _leaders_comm;
     BVH<DeviceType> _top_tree;    // replicated
     BVH<DeviceType> _bottom_tree; // local
+    // Same leaves as the top tree, in host memory.  It is only kept when the
+    // kernels of DeviceType do not run on the host and the top tree has at
+    // most max_host_top_tree_leaves leaves, in which case it is queried
+    // instead of the top tree: the traversal of so few leaves costs less
+    // than the kernel launches and the readbacks of the device, and only
+    // the results are copied to DeviceType.
+    BVH<HostDeviceType> _host_top_tree;
     SizeType _top_tree_size;
-    Kokkos::View<SizeType *, DeviceType> _bottom_tree_sizes;
+    // Positions of the upper nodes in the local tree and number of objects
+    // below them, padded with zeros to 2^upper_levels_depth entries.
+    Kokkos::View<int *, DeviceType> _bottom_tree_upper_nodes;
+    std::vector<int> _bottom_tree_upper_nodes_sizes;
+    // Bounding box, owning ranks, and number of objects of each leaf of the
+    // top tree.  A leaf is owned by _top_tree_leaf_n_ranks consecutive ranks
+    // starting at _top_tree_leaf_ranks, which is more than one only for the
+    // summaries of the other groups.  With a single group, the leaves of a
+    // given rank are stored contiguously, from _top_tree_leaf_offsets[rank]
+    // to _top_tree_leaf_offsets[rank + 1] - 1.  Processes without objects
+    // contribute no leaf.
+    Kokkos::View<Box *, DeviceType> _top_tree_leaf_bounds;
+    Kokkos::View<int *, DeviceType> _top_tree_leaf_ranks;
+    Kokkos::View<int *, DeviceType> _top_tree_leaf_n_ranks;
+    Kokkos::View<int *, DeviceType> _top_tree_leaf_sizes;
+    std::vector<int> _top_tree_leaf_offsets;
+    // Work sharing.  The helpers of rank r are stored from
+    // _helpers_offset(r) to _helpers_offset(r + 1) - 1, which is empty if
+    // work is not shared.  _helped_ranks gives the process that each one
+    // helps, or -1.  A helper holds a copy of the local objects of that
+    // process along with their indices there.
+    Kokkos::View<int *, DeviceType> _helpers_offset;
+    Kokkos::View<int *, DeviceType> _helpers;
+    Kokkos::View<int *, DeviceType> _helped_ranks;
+    BVH<DeviceType> _replica_tree;
+    Kokkos::View<int *, DeviceType> _replica_indices;
+    // Halo.  A negative width means there is none.  The extended tree holds
+    // the local objects, sorted by index, followed by the ones of the other
+    // processes that lie within _halo_bounds, the local bounds grown by the
+    // width.  _extended_ranks and _extended_indices tell where each of its
+    // objects comes from.
+    double _halo_width = -1.;
+    Box _halo_bounds;
+    BVH<DeviceType> _extended_tree;
+    Kokkos::View<int *, DeviceType> _extended_ranks;
+    Kokkos::View<int *, DeviceType> _extended_indices;
+    // Replica groups.  The members of group g are stored in increasing order
+    // from _replica_group_offset(g) to _replica_group_offset(g + 1) - 1 and
+    // _replica_groups gives the group of each rank, or -1.  The views are
+    // empty if no process is replicated.
+    Kokkos::View<int *, DeviceType> _replica_groups;
+    Kokkos::View<int *, DeviceType> _replica_group_offset;
+    Kokkos::View<int *, DeviceType> _replica_group_ranks;
+    // Answers the spatial queries in place of the local tree unless empty.
+    StructuredGrid<DeviceType> _structured_grid;
+    // Answers the spatial and nearest queries in place of the local tree
+    // unless empty.
+    HashGrid<DeviceType> _hash_grid;
+    // Keeps the temporaries of the queries for the next ones.  It is shared
+    // by the copies of the tree.
+    using CachingAllocator =
+        Details::CachingAllocator<typename DeviceType::memory_space>;
+    using CachingAllocatorScope =
+        Details::CachingAllocatorScope<typename DeviceType::memory_space>;
+    std::shared_ptr<CachingAllocator> _caching_allocator =
+        std::make_shared<CachingAllocator>();
+};
+
+/** \brief Spatial queries in flight, as returned by
+ *  DistributedSearchTree::queryAsync()
+ *
+ *  The local search for chunk i is performed while the queries of chunk i+1
+ *  are in flight and while the results for chunk i-1 are sent back.  Each
+ *  call to progress() advances the pipeline by one chunk so that the
+ *  application can do its own work in between.  wait() completes the
+ *  remaining chunks.
+ *
+ *  \note progress() and wait() must be called as collectives over all
+ *  processes in the communicator of the tree.
+ */
+template <typename DeviceType, typename Query>
+class DistributedQueryRequest
+{
+  public:
+    /** Forward the next chunk of queries, search the current one, and
+     *  receive the results of the previous one.
+     *
+     *  \return Whether all the results have been received.
+     */
+    bool progress();
+
+    //! Indicates whether all the results have been received.
+    inline bool done() const { return _step > _n_chunks; }
+
+    /** Complete the pipeline and return the results in the same format as
+     *  DistributedSearchTree::query().
+     */
+    void wait( Kokkos::View<int *, DeviceType> &indices,
+               Kokkos::View<int *, DeviceType> &offset,
+               Kokkos::View<int *, DeviceType> &ranks );
+
+  private:
+    friend class DistributedSearchTree<DeviceType>;
+    DistributedQueryRequest( DistributedSearchTree<DeviceType> const &tree,
+                             Kokkos::View<Query *, DeviceType> queries,
+                             int chunk_size );
+    Kokkos::View<Query *, DeviceType> getChunk( int chunk ) const;
+    DistributedSearchTree<DeviceType> const *_tree;
+    Kokkos::View<Query *, DeviceType> _queries;
+    int _chunk_size;
+    int _n_chunks;
+    int _step;
+    // Queries and results travel on their own communicators so that the
+    // messages of successive chunks never get mixed up.
+    Teuchos::RCP<Teuchos::Comm<int> const> _query_comm;
+    Teuchos::RCP<Teuchos::Comm<int> const> _result_comm;
+    using QueryExchange =
+        Details::PendingExchange<DeviceType, Details::QueryPacket<Query>>;
+    using ResultExchange =
+        Details::PendingExchange<DeviceType, Details::ResultPacket>;
+    std::vector<QueryExchange> _query_exchanges;
+    std::vector<ResultExchange> _result_exchanges;
+    // Results received for each chunk.  The query ids are relative to the
+    // chunk.
+    std::vector<Kokkos::View<int *, DeviceType>> _indices;
+    std::vector<Kokkos::View<int *, DeviceType>> _ids;
+    std::vector<Kokkos::View<int *, DeviceType>> _ranks;
 };
 
 template <typename DeviceType>
@@ -112,6 +565,8 @@ void DistributedSearchTree<DeviceType>::query(
     Kokkos::View<int *, DeviceType> &offset,
     Kokkos::View<int *, DeviceType> &ranks ) const
 {
+    ScopedTimer timer( "search" );
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
     using Tag = typename Query::Tag;
     Details::DistributedSearchTreeImpl<DeviceType>::queryDispatch(
         *this, queries, indices, offset, ranks, Tag{} );
@@ -129,11 +584,237 @@ DistributedSearchTree<DeviceType>::query(
     Kokkos::View<int *, DeviceType> &ranks,
     Kokkos::View<double *, DeviceType> &distances ) const
 {
+    ScopedTimer timer( "search" );
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
     using Tag = typename Query::Tag;
     Details::DistributedSearchTreeImpl<DeviceType>::queryDispatch(
         *this, queries, indices, offset, ranks, Tag{}, &distances );
 }
 
+template <typename DeviceType>
+template <typename Query>
+typename std::enable_if<
+    std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+    void>::type
+DistributedSearchTree<DeviceType>::queryOnOwners(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<Query *, DeviceType> &fwd_queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ids,
+    Kokkos::View<int *, DeviceType> &ranks ) const
+{
+    ScopedTimer timer( "search" );
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
+    Details::DistributedSearchTreeImpl<DeviceType>::performQueriesOnOwners(
+        *this, queries, fwd_queries, indices, offset, ids, ranks );
+}
+
+template <typename DeviceType>
+template <typename Query, typename Values, typename Reducer>
+void DistributedSearchTree<DeviceType>::reduce(
+    Kokkos::View<Query *, DeviceType> queries, Values const &values,
+    Reducer const &reducer,
+    Kokkos::View<typename Reducer::value_type *, DeviceType> &results ) const
+{
+    static_assert(
+        std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+        "Only spatial predicates can be reduced across processes" );
+    ScopedTimer timer( "reduce" );
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
+    Details::DistributedSearchTreeImpl<DeviceType>::performReductions(
+        *this, queries, values, reducer, results );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::join(
+    DistributedSearchTree const &other,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks ) const
+{
+    ScopedTimer timer( "join" );
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
+    Details::DistributedSearchTreeImpl<DeviceType>::performJoin(
+        *this, other, indices, offset, ranks );
+}
+
+template <typename DeviceType>
+template <typename Query>
+typename std::enable_if<
+    std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+    DistributedQueryRequest<DeviceType, Query>>::type
+DistributedSearchTree<DeviceType>::queryAsync(
+    Kokkos::View<Query *, DeviceType> queries, int chunk_size ) const
+{
+    return DistributedQueryRequest<DeviceType, Query>( *this, queries,
+                                                       chunk_size );
+}
+
+template <typename DeviceType>
+template <typename Query>
+double DistributedSearchTree<DeviceType>::imbalance(
+    Kokkos::View<Query *, DeviceType> queries ) const
+{
+    static_assert(
+        std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+        "imbalance() requires spatial predicates" );
+    return computeImbalance(
+        Details::DistributedSearchTreeImpl<DeviceType>::countQueriesPerRank(
+            *this, queries ) );
+}
+
+template <typename DeviceType>
+template <typename Query>
+double DistributedSearchTree<DeviceType>::shareWork(
+    Kokkos::View<Query *, DeviceType> queries, double max_imbalance )
+{
+    static_assert(
+        std::is_same<typename Query::Tag, Details::SpatialPredicateTag>::value,
+        "shareWork() requires spatial predicates" );
+    clearWorkSharing();
+    replicateLocalTrees(
+        Details::DistributedSearchTreeImpl<DeviceType>::countQueriesPerRank(
+            *this, queries ),
+        max_imbalance );
+    return imbalance( queries );
+}
+
+template <typename DeviceType>
+template <typename Query>
+Kokkos::View<int *, DeviceType>
+DistributedSearchTree<DeviceType>::findNearestRanks(
+    Kokkos::View<Query *, DeviceType> queries ) const
+{
+    CachingAllocatorScope allocator_scope( *_caching_allocator );
+    return Details::DistributedSearchTreeImpl<DeviceType>::findNearestRanks(
+        *this, queries );
+}
+
+template <typename DeviceType, typename Query>
+DistributedQueryRequest<DeviceType, Query>::DistributedQueryRequest(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries, int chunk_size )
+    : _tree( &tree )
+    , _queries( queries )
+    , _chunk_size( chunk_size )
+    , _step( 0 )
+    , _query_comm( tree._comm->duplicate() )
+    , _result_comm( tree._comm->duplicate() )
+{
+    DTK_REQUIRE( chunk_size > 0 );
+
+    int const n_queries = queries.extent( 0 );
+    int const n_local_chunks = ( n_queries + chunk_size - 1 ) / chunk_size;
+    Teuchos::reduceAll( *tree._comm, Teuchos::REDUCE_MAX, n_local_chunks,
+                        Teuchos::outArg( _n_chunks ) );
+    if ( _n_chunks == 0 )
+        _n_chunks = 1;
+
+    _query_exchanges.resize( _n_chunks );
+    _result_exchanges.resize( _n_chunks );
+    _indices.resize( _n_chunks );
+    _ids.resize( _n_chunks );
+    _ranks.resize( _n_chunks );
+
+    typename DistributedSearchTree<DeviceType>::CachingAllocatorScope
+        allocator_scope( *tree._caching_allocator );
+    Details::DistributedSearchTreeImpl<DeviceType>::postQueries(
+        *_tree, _query_comm, getChunk( 0 ), _query_exchanges[0] );
+}
+
+template <typename DeviceType, typename Query>
+Kokkos::View<Query *, DeviceType>
+DistributedQueryRequest<DeviceType, Query>::getChunk( int chunk ) const
+{
+    int const n_queries = _queries.extent( 0 );
+    int const first = std::min( chunk * _chunk_size, n_queries );
+    int const last = std::min( first + _chunk_size, n_queries );
+    Kokkos::View<Query *, DeviceType> queries(
+        Kokkos::ViewAllocateWithoutInitializing( _queries.label() ),
+        last - first );
+    Kokkos::deep_copy(
+        queries,
+        Kokkos::subview( _queries, Kokkos::make_pair( first, last ) ) );
+    return queries;
+}
+
+template <typename DeviceType, typename Query>
+bool DistributedQueryRequest<DeviceType, Query>::progress()
+{
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+
+    if ( done() )
+        return true;
+
+    typename DistributedSearchTree<DeviceType>::CachingAllocatorScope
+        allocator_scope( *_tree->_caching_allocator );
+    int const i = _step;
+    if ( i + 1 < _n_chunks )
+        Impl::postQueries( *_tree, _query_comm, getChunk( i + 1 ),
+                           _query_exchanges[i + 1] );
+    if ( i < _n_chunks )
+        Impl::postResults( *_tree, _result_comm, _query_exchanges[i],
+                           _result_exchanges[i] );
+    if ( i > 0 )
+        Impl::receiveResults( _result_exchanges[i - 1], _indices[i - 1],
+                              _ids[i - 1], _ranks[i - 1] );
+    ++_step;
+
+    return done();
+}
+
+template <typename DeviceType, typename Query>
+void DistributedQueryRequest<DeviceType, Query>::wait(
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+
+    while ( !progress() )
+        ;
+
+    typename DistributedSearchTree<DeviceType>::CachingAllocatorScope
+        allocator_scope( *_tree->_caching_allocator );
+
+    int n_results = 0;
+    for ( int c = 0; c < _n_chunks; ++c )
+        n_results += _ids[c].extent( 0 );
+    reallocWithoutInitializing( indices, n_results );
+    reallocWithoutInitializing( ranks, n_results );
+    Details::TemporaryViews<DeviceType> temporaries;
+    auto ids = temporaries.template view<int *>( "query_ids", n_results );
+
+    // Concatenate the results of all the chunks and make the query ids
+    // relative to the whole batch.
+    int position = 0;
+    for ( int c = 0; c < _n_chunks; ++c )
+    {
+        auto const chunk_indices = _indices[c];
+        auto const chunk_ids = _ids[c];
+        auto const chunk_ranks = _ranks[c];
+        int const first_query = c * _chunk_size;
+        int const n = chunk_ids.extent( 0 );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "concatenate_results" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) {
+                indices( position + i ) = chunk_indices( i );
+                ids( position + i ) = first_query + chunk_ids( i );
+                ranks( position + i ) = chunk_ranks( i );
+            } );
+        Kokkos::fence();
+        position += n;
+    }
+
+    if ( Details::isDeterministic() )
+        Impl::sortResultsByRankAndIndex( indices, ranks, ids );
+    Impl::countResults( _queries.extent( 0 ), ids, offset );
+    Impl::groupResultsByQuery( offset, ids, indices, ranks );
+}
+
 } // namespace DataTransferKit
 
 #endif
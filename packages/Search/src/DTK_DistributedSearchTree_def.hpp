@@ -13,53 +13,709 @@
 #define DTK_DISTRIBUTED_SEARCH_TREE_DEF_HPP
 
 #include <DTK_Box.hpp>
-#include <DTK_DetailsUtils.hpp> // accumulate
+#include <DTK_DetailsUtils.hpp>
+#include <DTK_Tuning.hpp>
 
 #include <Teuchos_Array.hpp>
 #include <Teuchos_CommHelpers.hpp>
 
+#include <algorithm> // fill, max, max_element, sort, stable_sort
+#include <cmath>     // ceil, log2
+#include <map>
+#include <numeric>   // accumulate, iota, partial_sum
+#include <vector>
+
 namespace DataTransferKit
 {
 
 template <typename DeviceType>
 DistributedSearchTree<DeviceType>::DistributedSearchTree(
     Teuchos::RCP<Teuchos::Comm<int> const> comm,
-    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, int ranks_per_group )
     : _comm( comm )
     , _bottom_tree( bounding_boxes )
 {
+    buildTopTree( ranks_per_group );
+}
+
+template <typename DeviceType>
+DistributedSearchTree<DeviceType>::DistributedSearchTree(
+    Teuchos::RCP<Teuchos::Comm<int> const> comm,
+    Kokkos::View<Point const *, DeviceType> points, int ranks_per_group )
+    : _comm( comm )
+    , _bottom_tree( points )
+{
+    buildTopTree( ranks_per_group );
+}
+
+template <typename DeviceType>
+DistributedSearchTree<DeviceType>::DistributedSearchTree(
+    Teuchos::RCP<Teuchos::Comm<int> const> comm,
+    Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType>
+        coordinates,
+    int ranks_per_group )
+    : _comm( comm )
+    , _bottom_tree( coordinates )
+{
+    buildTopTree( ranks_per_group );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::buildTopTree( int ranks_per_group )
+{
+    ScopedTimer timer( "tree construction" );
+
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+
+    DTK_REQUIRE( ranks_per_group >= 0 );
+
+    // The tuned settings are shared by all the processes of the tree.
+    if ( Tuning::enabled() )
+        Tuning::setComm( _comm );
+
     int const comm_rank = _comm->getRank();
     int const comm_size = _comm->getSize();
+    int const max_upper_nodes = 1 << upper_levels_depth;
+
+    _ranks_per_group = ( ranks_per_group == 0 || ranks_per_group > comm_size )
+                           ? comm_size
+                           : ranks_per_group;
+    if ( _ranks_per_group == comm_size )
+    {
+        _group_comm = _comm;
+    }
+    else
+    {
+        _group_comm = _comm->split( comm_rank / _ranks_per_group, comm_rank );
+        bool const is_leader = ( comm_rank % _ranks_per_group == 0 );
+        auto leaders_comm = _comm->split( is_leader ? 0 : 1, comm_rank );
+        if ( is_leader )
+            _leaders_comm = leaders_comm;
+    }
+
+    Kokkos::View<int *, DeviceType> parents( "parents" );
+    _bottom_tree_upper_nodes =
+        Details::cutHierarchy( _bottom_tree, upper_levels_depth, parents );
+    auto const upper_nodes_bounds =
+        Impl::getNodesBounds( _bottom_tree, _bottom_tree_upper_nodes );
+    auto const upper_nodes_sizes = Impl::countObjectsInSubtrees(
+        _bottom_tree, _bottom_tree_upper_nodes, parents );
+    int const n_upper_nodes = _bottom_tree_upper_nodes.extent( 0 );
+    DTK_CHECK( n_upper_nodes <= max_upper_nodes );
 
-    Kokkos::View<Box *, DeviceType> boxes(
-        Kokkos::ViewAllocateWithoutInitializing( "rank_bounding_boxes" ),
-        comm_size );
     // FIXME: I am not sure how to do the MPI allgather with Teuchos for data
-    // living on the device so I copied to the host.
-    auto boxes_host = Kokkos::create_mirror_view( boxes );
-    boxes_host( comm_rank ) = _bottom_tree.bounds();
+    // living on the device so I copied to the host.  Every process sends the
+    // same number of entries, the ones past its upper nodes hold no object.
+    std::vector<Box> local_bounds( max_upper_nodes );
+    _bottom_tree_upper_nodes_sizes.assign( max_upper_nodes, 0 );
+    auto upper_nodes_bounds_host =
+        Kokkos::create_mirror_view( upper_nodes_bounds );
+    Kokkos::deep_copy( upper_nodes_bounds_host, upper_nodes_bounds );
+    auto upper_nodes_sizes_host =
+        Kokkos::create_mirror_view( upper_nodes_sizes );
+    Kokkos::deep_copy( upper_nodes_sizes_host, upper_nodes_sizes );
+    for ( int i = 0; i < n_upper_nodes; ++i )
+    {
+        local_bounds[i] = upper_nodes_bounds_host( i );
+        _bottom_tree_upper_nodes_sizes[i] = upper_nodes_sizes_host( i );
+    }
+
+    std::vector<Box> leaf_bounds;
+    std::vector<int> leaf_ranks;
+    std::vector<int> leaf_n_ranks;
+    std::vector<int> leaf_sizes;
+    gatherTopTreeLeaves( local_bounds, _bottom_tree_upper_nodes_sizes,
+                         leaf_bounds, leaf_ranks, leaf_n_ranks, leaf_sizes );
+    int const n_leaves = leaf_bounds.size();
+
+    _top_tree_leaf_bounds = Kokkos::View<Box *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "top_tree_leaf_bounds" ),
+        n_leaves );
+    _top_tree_leaf_ranks = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "top_tree_leaf_ranks" ),
+        n_leaves );
+    _top_tree_leaf_n_ranks = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "top_tree_leaf_n_ranks" ),
+        n_leaves );
+    _top_tree_leaf_sizes = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "top_tree_leaf_sizes" ),
+        n_leaves );
+    auto leaf_bounds_host = Kokkos::create_mirror_view( _top_tree_leaf_bounds );
+    auto leaf_ranks_host = Kokkos::create_mirror_view( _top_tree_leaf_ranks );
+    auto leaf_n_ranks_host =
+        Kokkos::create_mirror_view( _top_tree_leaf_n_ranks );
+    auto leaf_sizes_host = Kokkos::create_mirror_view( _top_tree_leaf_sizes );
+    SizeType total_size = 0;
+    for ( int i = 0; i < n_leaves; ++i )
+    {
+        leaf_bounds_host( i ) = leaf_bounds[i];
+        leaf_ranks_host( i ) = leaf_ranks[i];
+        leaf_n_ranks_host( i ) = leaf_n_ranks[i];
+        leaf_sizes_host( i ) = leaf_sizes[i];
+        total_size += leaf_sizes[i];
+    }
+    Kokkos::deep_copy( _top_tree_leaf_bounds, leaf_bounds_host );
+    Kokkos::deep_copy( _top_tree_leaf_ranks, leaf_ranks_host );
+    Kokkos::deep_copy( _top_tree_leaf_n_ranks, leaf_n_ranks_host );
+    Kokkos::deep_copy( _top_tree_leaf_sizes, leaf_sizes_host );
+
+    _top_tree_leaf_offsets.clear();
+    if ( _ranks_per_group == comm_size )
+    {
+        _top_tree_leaf_offsets.assign( comm_size + 1, 0 );
+        for ( int i = 0; i < n_leaves; ++i )
+            ++_top_tree_leaf_offsets[leaf_ranks[i] + 1];
+        std::partial_sum( _top_tree_leaf_offsets.begin(),
+                          _top_tree_leaf_offsets.end(),
+                          _top_tree_leaf_offsets.begin() );
+    }
+
+    _top_tree = BVH<DeviceType>( _top_tree_leaf_bounds );
+    _top_tree_size = total_size;
+    updateHostTopTree();
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::updateHostTopTree()
+{
+    int const n_leaves = _top_tree_leaf_bounds.extent( 0 );
+    if ( Details::RunsOnHost<DeviceType>::value ||
+         n_leaves > max_host_top_tree_leaves )
+    {
+        _host_top_tree = BVH<HostDeviceType>();
+        return;
+    }
+    // The hierarchy is rebuilt rather than refitted, there are so few leaves
+    // that it costs about the same.
+    _host_top_tree = BVH<HostDeviceType>(
+        Details::copyToDevice( _top_tree_leaf_bounds, HostDeviceType{} ) );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::gatherTopTreeLeaves(
+    std::vector<Box> const &local_bounds, std::vector<int> const &local_sizes,
+    std::vector<Box> &leaf_bounds, std::vector<int> &leaf_ranks,
+    std::vector<int> &leaf_n_ranks, std::vector<int> &leaf_sizes ) const
+{
+    int const comm_size = _comm->getSize();
+    int const max_upper_nodes = 1 << upper_levels_depth;
+    int const group_size = _group_comm->getSize();
+    int const group = _comm->getRank() / _ranks_per_group;
+    int const n_groups =
+        ( comm_size + _ranks_per_group - 1 ) / _ranks_per_group;
+
+    DTK_REQUIRE( (int)local_bounds.size() == max_upper_nodes );
+    DTK_REQUIRE( (int)local_sizes.size() == max_upper_nodes );
+
+    Teuchos::Array<double> bounds( 6 * max_upper_nodes * group_size );
+    Teuchos::gatherAll(
+        *_group_comm, 6 * max_upper_nodes,
+        reinterpret_cast<double const *>( local_bounds.data() ),
+        6 * max_upper_nodes * group_size, bounds.getRawPtr() );
+    Teuchos::Array<int> sizes( max_upper_nodes * group_size );
+    Teuchos::gatherAll( *_group_comm, max_upper_nodes, local_sizes.data(),
+                        max_upper_nodes * group_size, sizes.getRawPtr() );
+
+    // Summarize the other groups with the bounds and the number of objects of
+    // all their local trees.
+    std::vector<Box> groups_bounds( n_groups );
+    std::vector<int> groups_sizes( n_groups, 0 );
+    if ( n_groups > 1 )
+    {
+        Box group_bounds;
+        int group_n_objects = 0;
+        for ( int i = 0; i < max_upper_nodes * group_size; ++i )
+            if ( sizes[i] > 0 )
+            {
+                Details::expand( group_bounds, reinterpret_cast<Box const &>(
+                                                   bounds[6 * i] ) );
+                group_n_objects += sizes[i];
+            }
+        if ( !_leaders_comm.is_null() )
+        {
+            Teuchos::gatherAll(
+                *_leaders_comm, 6,
+                reinterpret_cast<double const *>( &group_bounds ),
+                6 * n_groups,
+                reinterpret_cast<double *>( groups_bounds.data() ) );
+            Teuchos::gatherAll( *_leaders_comm, 1, &group_n_objects,
+                                n_groups, groups_sizes.data() );
+        }
+        Teuchos::broadcast(
+            *_group_comm, 0, 6 * n_groups,
+            reinterpret_cast<double *>( groups_bounds.data() ) );
+        Teuchos::broadcast( *_group_comm, 0, n_groups, groups_sizes.data() );
+    }
+
+    leaf_bounds.clear();
+    leaf_ranks.clear();
+    leaf_n_ranks.clear();
+    leaf_sizes.clear();
+    for ( int g = 0; g < n_groups; ++g )
+    {
+        int const first_rank = g * _ranks_per_group;
+        if ( g == group )
+        {
+            for ( int i = 0; i < max_upper_nodes * group_size; ++i )
+                if ( sizes[i] > 0 )
+                {
+                    leaf_bounds.push_back(
+                        reinterpret_cast<Box const &>( bounds[6 * i] ) );
+                    leaf_ranks.push_back( first_rank + i / max_upper_nodes );
+                    leaf_n_ranks.push_back( 1 );
+                    leaf_sizes.push_back( sizes[i] );
+                }
+        }
+        else if ( groups_sizes[g] > 0 )
+        {
+            leaf_bounds.push_back( groups_bounds[g] );
+            leaf_ranks.push_back( first_rank );
+            leaf_n_ranks.push_back(
+                std::min( _ranks_per_group, comm_size - first_rank ) );
+            leaf_sizes.push_back( groups_sizes[g] );
+        }
+    }
+}
+
+template <typename DeviceType>
+double DistributedSearchTree<DeviceType>::refit(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    double const quality = refitTrees( bounding_boxes );
+    if ( _halo_width >= 0. )
+        buildHalo( _halo_width );
+    return quality;
+}
+
+template <typename DeviceType>
+double DistributedSearchTree<DeviceType>::refitTrees(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    ScopedTimer timer( "refit" );
+
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+
+    int const comm_rank = _comm->getRank();
+    int const comm_size = _comm->getSize();
+    int const max_upper_nodes = 1 << upper_levels_depth;
+
+    // The copies of the local objects held by the helpers would be stale and
+    // so would the edges of the structured grid and the bins of the hash
+    // grid.
+    clearWorkSharing();
+    _structured_grid = StructuredGrid<DeviceType>();
+    _hash_grid = HashGrid<DeviceType>();
+
+    double const bottom_tree_quality = _bottom_tree.refit( bounding_boxes );
+
+    // The topology of the local tree does not change so neither do its upper
+    // nodes, only their bounds.
+    auto const upper_nodes_bounds =
+        Impl::getNodesBounds( _bottom_tree, _bottom_tree_upper_nodes );
+    auto upper_nodes_bounds_host =
+        Kokkos::create_mirror_view( upper_nodes_bounds );
+    Kokkos::deep_copy( upper_nodes_bounds_host, upper_nodes_bounds );
+    int const n_upper_nodes = upper_nodes_bounds_host.extent( 0 );
+    std::vector<Box> local_bounds( max_upper_nodes );
+    for ( int i = 0; i < n_upper_nodes; ++i )
+        local_bounds[i] = upper_nodes_bounds_host( i );
+
+    auto boxes_host = Kokkos::create_mirror_view( _top_tree_leaf_bounds );
+
+    // With several groups, the summaries of the groups are refreshed as well
+    // so all the bounds are exchanged again.
+    if ( _ranks_per_group < comm_size )
+    {
+        double quality = 1.;
+        Teuchos::reduceAll( *_comm, Teuchos::REDUCE_MAX, bottom_tree_quality,
+                            Teuchos::outArg( quality ) );
+        quality = std::max( quality, 1. );
+
+        std::vector<Box> leaf_bounds;
+        std::vector<int> leaf_ranks;
+        std::vector<int> leaf_n_ranks;
+        std::vector<int> leaf_sizes;
+        gatherTopTreeLeaves( local_bounds, _bottom_tree_upper_nodes_sizes,
+                             leaf_bounds, leaf_ranks, leaf_n_ranks,
+                             leaf_sizes );
+        DTK_CHECK( leaf_bounds.size() == boxes_host.extent( 0 ) );
+        for ( int i = 0; i < (int)leaf_bounds.size(); ++i )
+            boxes_host( i ) = leaf_bounds[i];
+        Kokkos::deep_copy( _top_tree_leaf_bounds, boxes_host );
 
-    Teuchos::Array<double> bounds( 6 * comm_size );
+        _top_tree.refit( _top_tree_leaf_bounds );
+        updateHostTopTree();
+
+        return quality;
+    }
+
+    Kokkos::deep_copy( boxes_host, _top_tree_leaf_bounds );
+    int const first = _top_tree_leaf_offsets[comm_rank];
+    bool changed = false;
+    for ( int i = 0; i < n_upper_nodes; ++i )
+    {
+        if ( !Details::equals( boxes_host( first + i ), local_bounds[i] ) )
+            changed = true;
+        boxes_host( first + i ) = local_bounds[i];
+    }
+
+    // Let all processes know whose bounds changed and how much the local
+    // trees degraded in a single collective.
+    double const local_status[2] = {changed ? 1. : 0., bottom_tree_quality};
+    Teuchos::Array<double> status( 2 * comm_size );
+    Teuchos::gatherAll( *_comm, 2, local_status, 2 * comm_size,
+                        status.getRawPtr() );
+    double quality = 1.;
+    int n_changed = 0;
+    for ( int i = 0; i < comm_size; ++i )
+    {
+        if ( status[2 * i] != 0. )
+            ++n_changed;
+        quality = std::max( quality, status[2 * i + 1] );
+    }
+
+    if ( n_changed == 0 )
+        return quality;
+
+    // Each broadcast costs about as much latency as gathering all the bounds,
+    // so only send the changed ones individually when there are few of them.
+    if ( n_changed <= std::log2( comm_size ) )
+    {
+        for ( int i = 0; i < comm_size; ++i )
+            if ( status[2 * i] != 0. )
+                Teuchos::broadcast(
+                    *_comm, i,
+                    6 * ( _top_tree_leaf_offsets[i + 1] -
+                          _top_tree_leaf_offsets[i] ),
+                    reinterpret_cast<double *>(
+                        &boxes_host( _top_tree_leaf_offsets[i] ) ) );
+    }
+    else
+    {
+        Teuchos::Array<double> bounds( 6 * max_upper_nodes * comm_size );
+        Teuchos::gatherAll( *_comm, 6 * max_upper_nodes,
+                            reinterpret_cast<double *>( local_bounds.data() ),
+                            6 * max_upper_nodes * comm_size,
+                            bounds.getRawPtr() );
+        for ( int i = 0; i < comm_size; ++i )
+            for ( int j = _top_tree_leaf_offsets[i];
+                  j < _top_tree_leaf_offsets[i + 1]; ++j )
+                boxes_host( j ) = reinterpret_cast<Box const &>(
+                    bounds[6 * ( i * max_upper_nodes + j -
+                                 _top_tree_leaf_offsets[i] )] );
+    }
+    Kokkos::deep_copy( _top_tree_leaf_bounds, boxes_host );
+
+    _top_tree.refit( _top_tree_leaf_bounds );
+    updateHostTopTree();
+
+    return quality;
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::buildHalo( double halo_width )
+{
+    ScopedTimer timer( "halo" );
+
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    DTK_REQUIRE( halo_width >= 0. );
+
+    int const comm_rank = _comm->getRank();
+    int const comm_size = _comm->getSize();
+
+    _halo_width = halo_width;
+    _halo_bounds = _bottom_tree.bounds();
+    if ( Details::isValid( _halo_bounds ) )
+        for ( int d = 0; d < 3; ++d )
+        {
+            _halo_bounds.minCorner()[d] -= halo_width;
+            _halo_bounds.maxCorner()[d] += halo_width;
+        }
+
+    // Find the local objects that lie within the halo of the other processes.
+    Teuchos::Array<double> halo_bounds( 6 * comm_size );
     Teuchos::gatherAll( *_comm, 6,
-                        reinterpret_cast<double *>( &boxes_host( comm_rank ) ),
-                        6 * comm_size, bounds.getRawPtr() );
+                        reinterpret_cast<double const *>( &_halo_bounds ),
+                        6 * comm_size, halo_bounds.getRawPtr() );
+    Kokkos::View<Overlap *, DeviceType> queries(
+        Kokkos::ViewAllocateWithoutInitializing( "queries" ), comm_size );
+    auto queries_host = Kokkos::create_mirror_view( queries );
+    for ( int i = 0; i < comm_size; ++i )
+        queries_host( i ) =
+            overlap( i == comm_rank ? Box()
+                                    : reinterpret_cast<Box const &>(
+                                          halo_bounds[6 * i] ) );
+    Kokkos::deep_copy( queries, queries_host );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    _bottom_tree.query( queries, indices, offset );
+
+    // The boxes of the leaves are sorted by index so that the local objects
+    // come first in the extended tree, in their original order.
+    int const n_objects = _bottom_tree.size();
+    Kokkos::View<Box *, DeviceType> leaf_boxes( "boxes" );
+    Kokkos::View<int *, DeviceType> leaf_indices( "indices" );
+    Impl::getLeaves( _bottom_tree, leaf_boxes, leaf_indices );
+    Kokkos::View<Box *, DeviceType> boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "boxes" ), n_objects );
+    Kokkos::parallel_for( DTK_MARK_REGION( "sort_boxes_by_index" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_objects ),
+                          KOKKOS_LAMBDA( int i ) {
+                              boxes( leaf_indices( i ) ) = leaf_boxes( i );
+                          } );
+    Kokkos::fence();
+
+    int const n_exports = lastElement( offset );
+    Kokkos::View<Box *, DeviceType> export_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "boxes" ), n_exports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "pack_halo_boxes" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_exports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              export_boxes( i ) = boxes( indices( i ) );
+                          } );
+    Kokkos::fence();
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    Teuchos::Array<int> export_ranks( n_exports );
     for ( int i = 0; i < comm_size; ++i )
-        boxes_host( i ) = reinterpret_cast<Box const &>( bounds[6 * i] );
-    Kokkos::deep_copy( boxes, boxes_host );
-
-    _top_tree = BVH<DeviceType>( boxes );
-
-    _bottom_tree_sizes = Kokkos::View<SizeType *, DeviceType>(
-        Kokkos::ViewAllocateWithoutInitializing( "leave_count_in_local_trees" ),
-        comm_size );
-    auto bottom_tree_sizes_host =
-        Kokkos::create_mirror_view( _bottom_tree_sizes );
-    auto const bottom_tree_size = _bottom_tree.size();
-    Teuchos::gatherAll( *comm, 1, &bottom_tree_size, comm_size,
-                        bottom_tree_sizes_host.data() );
-    Kokkos::deep_copy( _bottom_tree_sizes, bottom_tree_sizes_host );
-
-    _top_tree_size = accumulate( _bottom_tree_sizes, 0 );
+        std::fill( export_ranks.begin() + offset_host( i ),
+                   export_ranks.begin() + offset_host( i + 1 ), i );
+
+    Details::Distributor distributor( _comm );
+    int const n_imports = distributor.createFromSends( export_ranks() );
+    Kokkos::View<Box *, DeviceType> import_boxes( "boxes", n_imports );
+    Kokkos::View<int *, DeviceType> import_indices( "indices", n_imports );
+    Impl::sendAcrossNetwork( distributor, export_boxes, import_boxes );
+    Impl::sendAcrossNetwork( distributor, indices, import_indices );
+    auto const import_ranks = Impl::getImportRanks( distributor );
+
+    // Local objects first, then the halo.
+    auto const local = Kokkos::make_pair( 0, n_objects );
+    auto const halo = Kokkos::make_pair( n_objects, n_objects + n_imports );
+    Kokkos::View<Box *, DeviceType> extended_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "boxes" ),
+        n_objects + n_imports );
+    Kokkos::deep_copy( Kokkos::subview( extended_boxes, local ), boxes );
+    Kokkos::deep_copy( Kokkos::subview( extended_boxes, halo ), import_boxes );
+    _extended_ranks = Kokkos::View<int *, DeviceType>( "extended_ranks",
+                                                       n_objects + n_imports );
+    _extended_indices = Kokkos::View<int *, DeviceType>(
+        "extended_indices", n_objects + n_imports );
+    Kokkos::deep_copy( Kokkos::subview( _extended_ranks, local ), comm_rank );
+    Kokkos::deep_copy( Kokkos::subview( _extended_ranks, halo ),
+                       import_ranks );
+    iota( Kokkos::subview( _extended_indices, local ) );
+    Kokkos::deep_copy( Kokkos::subview( _extended_indices, halo ),
+                       import_indices );
+    _extended_tree = BVH<DeviceType>( extended_boxes );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::clearWorkSharing()
+{
+    _helpers_offset = Kokkos::View<int *, DeviceType>( "helpers_offset" );
+    _helpers = Kokkos::View<int *, DeviceType>( "helpers" );
+    _helped_ranks = Kokkos::View<int *, DeviceType>( "helped_ranks" );
+    _replica_tree = BVH<DeviceType>();
+    _replica_indices = Kokkos::View<int *, DeviceType>( "replica_indices" );
+}
+
+template <typename DeviceType>
+double DistributedSearchTree<DeviceType>::computeImbalance(
+    std::vector<int> const &loads )
+{
+    double const total = std::accumulate( loads.begin(), loads.end(), 0. );
+    if ( total == 0. )
+        return 1.;
+    return *std::max_element( loads.begin(), loads.end() ) * loads.size() /
+           total;
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::replicateLocalTrees(
+    std::vector<int> const &loads, double max_imbalance )
+{
+    using Impl = Details::DistributedSearchTreeImpl<DeviceType>;
+
+    DTK_REQUIRE( max_imbalance >= 1. );
+
+    int const comm_rank = _comm->getRank();
+    int const comm_size = _comm->getSize();
+    DTK_REQUIRE( (int)loads.size() == comm_size );
+
+    double const mean =
+        std::accumulate( loads.begin(), loads.end(), 0. ) / comm_size;
+    if ( mean == 0. )
+        return;
+
+    // All the processes make the same decisions from the same loads.  The
+    // most loaded processes pick their helpers first, among the processes
+    // that receive no more than the average, least loaded first.  Each
+    // helper serves a single process.
+    std::vector<int> ranks( comm_size );
+    std::iota( ranks.begin(), ranks.end(), 0 );
+    std::stable_sort( ranks.begin(), ranks.end(), [&loads]( int i, int j ) {
+        return loads[i] > loads[j];
+    } );
+    std::vector<int> idle_ranks;
+    for ( auto it = ranks.rbegin(); it != ranks.rend() && loads[*it] <= mean;
+          ++it )
+        idle_ranks.push_back( *it );
+
+    std::vector<std::vector<int>> helpers( comm_size );
+    std::vector<int> helped_ranks( comm_size, -1 );
+    int n_helpers = 0;
+    for ( int r : ranks )
+    {
+        if ( loads[r] <= max_imbalance * mean )
+            break;
+        int const n_wanted =
+            static_cast<int>( std::ceil( loads[r] / mean ) ) - 1;
+        for ( int h = 0; h < n_wanted && n_helpers < (int)idle_ranks.size();
+              ++h )
+        {
+            int const helper = idle_ranks[n_helpers++];
+            helpers[r].push_back( helper );
+            helped_ranks[helper] = r;
+        }
+    }
+    if ( n_helpers == 0 )
+        return;
+
+    _helpers_offset =
+        Kokkos::View<int *, DeviceType>( "helpers_offset", comm_size + 1 );
+    _helpers = Kokkos::View<int *, DeviceType>( "helpers", n_helpers );
+    _helped_ranks =
+        Kokkos::View<int *, DeviceType>( "helped_ranks", comm_size );
+    auto helpers_offset_host = Kokkos::create_mirror_view( _helpers_offset );
+    auto helpers_host = Kokkos::create_mirror_view( _helpers );
+    auto helped_ranks_host = Kokkos::create_mirror_view( _helped_ranks );
+    helpers_offset_host( 0 ) = 0;
+    for ( int r = 0; r < comm_size; ++r )
+    {
+        int const first = helpers_offset_host( r );
+        for ( int h = 0; h < (int)helpers[r].size(); ++h )
+            helpers_host( first + h ) = helpers[r][h];
+        helpers_offset_host( r + 1 ) = first + helpers[r].size();
+        helped_ranks_host( r ) = helped_ranks[r];
+    }
+    Kokkos::deep_copy( _helpers_offset, helpers_offset_host );
+    Kokkos::deep_copy( _helpers, helpers_host );
+    Kokkos::deep_copy( _helped_ranks, helped_ranks_host );
+
+    // Send a copy of the local objects to each helper.
+    Kokkos::View<Box *, DeviceType> boxes( "boxes" );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Impl::getLeaves( _bottom_tree, boxes, indices );
+    int const n_objects = boxes.extent( 0 );
+    auto const &my_helpers = helpers[comm_rank];
+    int const n_exports = n_objects * my_helpers.size();
+    Teuchos::Array<int> export_ranks( n_exports );
+    Kokkos::View<Box *, DeviceType> export_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "boxes" ), n_exports );
+    Kokkos::View<int *, DeviceType> export_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "indices" ), n_exports );
+    for ( int h = 0; h < (int)my_helpers.size(); ++h )
+    {
+        auto const range =
+            Kokkos::make_pair( h * n_objects, ( h + 1 ) * n_objects );
+        std::fill( export_ranks.begin() + range.first,
+                   export_ranks.begin() + range.second, my_helpers[h] );
+        Kokkos::deep_copy( Kokkos::subview( export_boxes, range ), boxes );
+        Kokkos::deep_copy( Kokkos::subview( export_indices, range ), indices );
+    }
+
+    Details::Distributor distributor( _comm );
+    int const n_imports = distributor.createFromSends( export_ranks() );
+    Kokkos::View<Box *, DeviceType> import_boxes( "replica_boxes", n_imports );
+    _replica_indices =
+        Kokkos::View<int *, DeviceType>( "replica_indices", n_imports );
+    Impl::sendAcrossNetwork( distributor, export_boxes, import_boxes );
+    Impl::sendAcrossNetwork( distributor, export_indices, _replica_indices );
+    _replica_tree = BVH<DeviceType>( import_boxes );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::setReplicaGroup( int replica_group )
+{
+    int const comm_size = _comm->getSize();
+
+    int const local[2] = {replica_group,
+                          static_cast<int>( _bottom_tree.size() )};
+    std::vector<int> all( 2 * comm_size );
+    Teuchos::gatherAll( *_comm, 2, local, 2 * comm_size, all.data() );
+
+    // Number the groups with more than one member in the order of their
+    // first member.  All the processes make the same decisions.
+    std::map<int, std::vector<int>> members;
+    for ( int r = 0; r < comm_size; ++r )
+        if ( all[2 * r] >= 0 )
+            members[all[2 * r]].push_back( r );
+    std::vector<std::vector<int>> groups;
+    for ( auto const &group : members )
+        if ( group.second.size() > 1 )
+            groups.push_back( group.second );
+    std::sort( groups.begin(), groups.end() );
+
+    if ( groups.empty() )
+    {
+        _replica_groups = Kokkos::View<int *, DeviceType>( "replica_groups" );
+        _replica_group_offset =
+            Kokkos::View<int *, DeviceType>( "replica_group_offset" );
+        _replica_group_ranks =
+            Kokkos::View<int *, DeviceType>( "replica_group_ranks" );
+        return;
+    }
+
+    int const n_groups = groups.size();
+    int n_members = 0;
+    for ( auto const &group : groups )
+        n_members += group.size();
+    _replica_groups =
+        Kokkos::View<int *, DeviceType>( "replica_groups", comm_size );
+    _replica_group_offset =
+        Kokkos::View<int *, DeviceType>( "replica_group_offset", n_groups + 1 );
+    _replica_group_ranks =
+        Kokkos::View<int *, DeviceType>( "replica_group_ranks", n_members );
+    auto groups_host = Kokkos::create_mirror_view( _replica_groups );
+    auto offset_host = Kokkos::create_mirror_view( _replica_group_offset );
+    auto ranks_host = Kokkos::create_mirror_view( _replica_group_ranks );
+    Kokkos::deep_copy( groups_host, -1 );
+    offset_host( 0 ) = 0;
+    for ( int g = 0; g < n_groups; ++g )
+    {
+        int const first = offset_host( g );
+        for ( int m = 0; m < (int)groups[g].size(); ++m )
+        {
+            int const r = groups[g][m];
+            // The replicas must hold the same objects.
+            DTK_REQUIRE( all[2 * r + 1] == all[2 * groups[g][0] + 1] );
+            ranks_host( first + m ) = r;
+            groups_host( r ) = g;
+        }
+        offset_host( g + 1 ) = first + groups[g].size();
+    }
+    Kokkos::deep_copy( _replica_groups, groups_host );
+    Kokkos::deep_copy( _replica_group_offset, offset_host );
+    Kokkos::deep_copy( _replica_group_ranks, ranks_host );
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::setStructuredGrid(
+    StructuredGrid<DeviceType> const &grid )
+{
+    DTK_REQUIRE( grid.size() == _bottom_tree.size() );
+    _structured_grid = grid;
+}
+
+template <typename DeviceType>
+void DistributedSearchTree<DeviceType>::setHashGrid(
+    HashGrid<DeviceType> const &grid )
+{
+    DTK_REQUIRE( grid.size() == _bottom_tree.size() );
+    _hash_grid = grid;
 }
 
 } // namespace DataTransferKit
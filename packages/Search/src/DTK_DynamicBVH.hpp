@@ -0,0 +1,315 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DYNAMIC_BVH_HPP
+#define DTK_DYNAMIC_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>       // expand
+#include <DTK_DetailsTreeConstruction.hpp> // assignMortonCodes, sortObjects
+#include <DTK_DetailsUtils.hpp>            // iota, selectIndices
+#include <DTK_LinearBVH.hpp>
+
+#include <Kokkos_View.hpp>
+
+#include <utility> // forward, make_pair
+
+namespace DataTransferKit
+{
+
+/** Hierarchy over objects that are inserted and removed in batches, e.g.
+ *  the particles that enter and leave the domain of a particle method at
+ *  every step.  Each object is kept in a slot of an array of bounding boxes
+ *  and its identifier, which is what the queries report, is the position of
+ *  that slot.  It does not change until the object is removed.
+ *
+ *  The hierarchy is built over all the slots.  Removing an object leaves an
+ *  empty box in its slot, which nothing intersects and which is infinitely
+ *  far from any point, and the slot is recycled by a later insertion.  The
+ *  new objects go to the free slots whose former objects were at the same
+ *  place along the Z-order curve, so that refitting the hierarchy is all
+ *  there is to do.  The hierarchy is only rebuilt when the surface area
+ *  heuristic cost of the refitted one exceeds max_sah_ratio times the one of
+ *  the hierarchy as it was built, or when there are not enough free slots
+ *  for the insertion, in which case the array of slots grows.
+ */
+template <typename DeviceType>
+class DynamicBVH
+{
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+
+    DynamicBVH() = default; // build an empty tree
+    DynamicBVH( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                double max_sah_ratio = 2. );
+
+    /** Add the objects to the hierarchy and return their identifiers, in the
+     *  order of the bounding boxes.
+     */
+    Kokkos::View<int *, DeviceType>
+    insert( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+
+    /** Remove the objects with the given identifiers from the hierarchy.
+     *
+     *  @pre The identifiers are distinct and the objects are in the
+     *  hierarchy.
+     */
+    void remove( Kokkos::View<int const *, DeviceType> ids );
+
+    /** Update the bounding boxes of the objects with the given identifiers
+     *  after they moved.
+     */
+    void update( Kokkos::View<int const *, DeviceType> ids,
+                 Kokkos::View<Box const *, DeviceType> bounding_boxes );
+
+    /** Rebuild the hierarchy from scratch, e.g. after many updates.  The
+     *  identifiers are unchanged.
+     */
+    void rebuild();
+
+    /** Same as BoundingVolumeHierarchy::query(), with the identifiers of the
+     *  objects in place of their indices.
+     */
+    template <typename... Args>
+    void query( Args &&... args ) const
+    {
+        _tree.query( std::forward<Args>( args )... );
+    }
+
+    Box bounds() const { return _tree.bounds(); }
+
+    //! Number of objects in the hierarchy.
+    SizeType size() const { return _n_objects; }
+
+    bool empty() const { return size() == 0; }
+
+    //! Number of slots, i.e. one more than the largest identifier.
+    SizeType capacity() const { return _bounding_boxes.extent( 0 ); }
+
+    //! Number of slots that the insertions may use without growing the array.
+    SizeType numberOfFreeSlots() const { return _free_slots.extent( 0 ); }
+
+  private:
+    void refitOrRebuild();
+
+    // Bounding box of the object in each slot, or an empty box if the slot is
+    // free.
+    Kokkos::View<Box *, DeviceType> _bounding_boxes;
+    // Bounding box of the object that is or was last in each slot.  The
+    // hierarchy is built over them so that the free slots keep their place.
+    Kokkos::View<Box *, DeviceType> _locations;
+    Kokkos::View<int *, DeviceType> _free_slots;
+    SizeType _n_objects = 0;
+    double _max_sah_ratio = 2.;
+    BVH<DeviceType> _tree;
+};
+
+namespace Details
+{
+// Append the values of w to the ones of v.
+template <typename T, typename DeviceType>
+Kokkos::View<T *, DeviceType>
+concatenate( Kokkos::View<T *, DeviceType> v,
+             Kokkos::View<T const *, DeviceType> w )
+{
+    int const n = v.extent( 0 );
+    int const m = w.extent( 0 );
+    Kokkos::View<T *, DeviceType> u(
+        Kokkos::ViewAllocateWithoutInitializing( v.label() ), n + m );
+    Kokkos::deep_copy( Kokkos::subview( u, std::make_pair( 0, n ) ), v );
+    Kokkos::deep_copy( Kokkos::subview( u, std::make_pair( n, n + m ) ), w );
+    return u;
+}
+} // namespace Details
+
+template <typename DeviceType>
+DynamicBVH<DeviceType>::DynamicBVH(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, double max_sah_ratio )
+    : _bounding_boxes( Kokkos::ViewAllocateWithoutInitializing( "slots" ),
+                       bounding_boxes.extent( 0 ) )
+    , _locations( Kokkos::ViewAllocateWithoutInitializing( "locations" ),
+                  bounding_boxes.extent( 0 ) )
+    , _free_slots( "free_slots", 0 )
+    , _n_objects( bounding_boxes.extent( 0 ) )
+    , _max_sah_ratio( max_sah_ratio )
+{
+    DTK_REQUIRE( max_sah_ratio >= 1. );
+    Kokkos::deep_copy( _bounding_boxes, bounding_boxes );
+    Kokkos::deep_copy( _locations, bounding_boxes );
+    rebuild();
+}
+
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType> DynamicBVH<DeviceType>::insert(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_new = bounding_boxes.extent( 0 );
+    int const n_free = _free_slots.extent( 0 );
+    Kokkos::View<int *, DeviceType> ids(
+        Kokkos::ViewAllocateWithoutInitializing( "ids" ), n_new );
+    if ( n_new == 0 )
+        return ids;
+
+    // Without enough free slots, the new objects are appended and the
+    // hierarchy rebuilt, which the insertion would likely call for anyway.
+    if ( n_new > n_free )
+    {
+        iota( ids, static_cast<int>( capacity() ) );
+        _bounding_boxes =
+            Details::concatenate<Box, DeviceType>( _bounding_boxes,
+                                                   bounding_boxes );
+        _locations = Details::concatenate<Box, DeviceType>( _locations,
+                                                            bounding_boxes );
+        _n_objects += n_new;
+        rebuild();
+        return ids;
+    }
+
+    // Sort the free slots by the former position of their objects along the
+    // Z-order curve, and the new objects as well.
+    auto const free_slots = _free_slots;
+    auto const locations = _locations;
+    auto const slots = _bounding_boxes;
+    Kokkos::View<Box *, DeviceType> free_locations(
+        Kokkos::ViewAllocateWithoutInitializing( "free_locations" ), n_free );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "gather_locations_of_free_slots" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_free ),
+        KOKKOS_LAMBDA( int i ) {
+            free_locations( i ) = locations( free_slots( i ) );
+        } );
+    Kokkos::fence();
+
+    using TreeConstruction = Details::TreeConstruction<DeviceType>;
+    Box scene_bounding_box;
+    TreeConstruction::calculateBoundingBoxOfTheScene( free_locations,
+                                                      scene_bounding_box );
+    Box new_bounding_box;
+    TreeConstruction::calculateBoundingBoxOfTheScene( bounding_boxes,
+                                                      new_bounding_box );
+    Details::expand( scene_bounding_box, new_bounding_box );
+
+    Kokkos::View<unsigned int *, DeviceType> free_codes(
+        Kokkos::ViewAllocateWithoutInitializing( "morton" ), n_free );
+    TreeConstruction::assignMortonCodes( free_locations, free_codes,
+                                         scene_bounding_box );
+    auto const free_permute = TreeConstruction::sortObjects( free_codes );
+    Kokkos::View<unsigned int *, DeviceType> new_codes(
+        Kokkos::ViewAllocateWithoutInitializing( "morton" ), n_new );
+    TreeConstruction::assignMortonCodes( bounding_boxes, new_codes,
+                                         scene_bounding_box );
+    auto const new_permute = TreeConstruction::sortObjects( new_codes );
+
+    // Match the ith new object along the curve with the free slot of the same
+    // rank relative to the number of free slots.  There are at least as many
+    // free slots as new objects, so that no two of them share a slot.
+    Kokkos::View<int *, DeviceType> used( "used", n_free );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "put_new_objects_in_free_slots" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_new ),
+        KOKKOS_LAMBDA( int i ) {
+            int const j = free_permute(
+                static_cast<long long>( i ) * n_free / n_new );
+            int const k = new_permute( i );
+            int const slot = free_slots( j );
+            ids( k ) = slot;
+            slots( slot ) = bounding_boxes( k );
+            locations( slot ) = bounding_boxes( k );
+            used( j ) = 1;
+        } );
+    Kokkos::fence();
+
+    auto const unused = selectIndices<DeviceType>(
+        "unused", n_free, KOKKOS_LAMBDA( int i ) { return used( i ) == 0; } );
+    Kokkos::View<int *, DeviceType> remaining_slots(
+        Kokkos::ViewAllocateWithoutInitializing( "free_slots" ),
+        n_free - n_new );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "keep_unused_free_slots" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_free - n_new ),
+        KOKKOS_LAMBDA( int i ) {
+            remaining_slots( i ) = free_slots( unused( i ) );
+        } );
+    Kokkos::fence();
+    _free_slots = remaining_slots;
+
+    _n_objects += n_new;
+    refitOrRebuild();
+    return ids;
+}
+
+template <typename DeviceType>
+void DynamicBVH<DeviceType>::remove( Kokkos::View<int const *, DeviceType> ids )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_removed = ids.extent( 0 );
+    DTK_REQUIRE( static_cast<SizeType>( n_removed ) <= _n_objects );
+    if ( n_removed == 0 )
+        return;
+
+    auto const slots = _bounding_boxes;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "empty_slots_of_removed_objects" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_removed ),
+        KOKKOS_LAMBDA( int i ) { slots( ids( i ) ) = Box(); } );
+    Kokkos::fence();
+    _free_slots = Details::concatenate<int, DeviceType>( _free_slots, ids );
+
+    _n_objects -= n_removed;
+    refitOrRebuild();
+}
+
+template <typename DeviceType>
+void DynamicBVH<DeviceType>::update(
+    Kokkos::View<int const *, DeviceType> ids,
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    DTK_REQUIRE( ids.extent( 0 ) == bounding_boxes.extent( 0 ) );
+    if ( ids.extent( 0 ) == 0 )
+        return;
+
+    auto const slots = _bounding_boxes;
+    auto const locations = _locations;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "update_slots_of_moved_objects" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, ids.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            slots( ids( i ) ) = bounding_boxes( i );
+            locations( ids( i ) ) = bounding_boxes( i );
+        } );
+    Kokkos::fence();
+
+    refitOrRebuild();
+}
+
+template <typename DeviceType>
+void DynamicBVH<DeviceType>::rebuild()
+{
+    // The free slots are placed where their last object was and then emptied
+    // by the refit.
+    _tree = BVH<DeviceType>( _locations );
+    _tree.refit( _bounding_boxes );
+}
+
+template <typename DeviceType>
+void DynamicBVH<DeviceType>::refitOrRebuild()
+{
+    if ( _tree.refit( _bounding_boxes ) > _max_sah_ratio )
+        rebuild();
+}
+
+} // namespace DataTransferKit
+
+#endif
@@ -0,0 +1,635 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_HASH_GRID_HPP
+#define DTK_HASH_GRID_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsCachingAllocator.hpp> // TemporaryViews
+#include <DTK_DetailsContainers.hpp>       // UnmanagedStaticVector
+#include <DTK_DetailsNode.hpp>
+#include <DTK_DetailsPriorityQueue.hpp>
+#include <DTK_DetailsTreeConstruction.hpp> // calculateBoundingBoxOfTheScene
+#include <DTK_DetailsUtils.hpp> // exclusivePrefixSum, lastElement, etc.
+#include <DTK_KokkosHelpers.hpp>
+#include <DTK_Point.hpp>
+#include <DTK_Predicates.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Kokkos_Array.hpp>
+#include <Kokkos_Pair.hpp>
+#include <Kokkos_View.hpp>
+
+#include <cmath>   // ceil, floor, pow
+#include <cstddef> // size_t
+#include <type_traits>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/** Cells of the grid as seen from the kernels.  The objects are binned by the
+ * centroid of their bounding box and sorted by cell, so that the objects of
+ * cell (i, j, k) are those from cell_offset(c) to cell_offset(c + 1) - 1 with
+ * c = i + n_i * (j + n_j * k).  An object sticks out of its cell by at most
+ * max_half_extent along any axis, which is zero for points.
+ */
+template <typename DeviceType>
+struct HashGridCells
+{
+    KOKKOS_INLINE_FUNCTION int size() const { return indices.extent_int( 0 ); }
+
+    // Position of the cell that contains x along axis d, clamped to the grid.
+    KOKKOS_INLINE_FUNCTION int cellCoordinate( double x, int d ) const
+    {
+        double const position = std::floor( ( x - origin[d] ) * inv_cell_size );
+        if ( !( position > 0. ) )
+            return 0;
+        if ( position >= n_cells[d] )
+            return n_cells[d] - 1;
+        return static_cast<int>( position );
+    }
+
+    KOKKOS_INLINE_FUNCTION int cellIndex( int i, int j, int k ) const
+    {
+        return i + n_cells[0] * ( j + n_cells[1] * k );
+    }
+
+    // Count the objects that satisfy the spatial predicate and, unless out is
+    // null, write their indices there.  Only the cells that may hold the
+    // centroid of such an object are visited.
+    template <typename Query>
+    KOKKOS_INLINE_FUNCTION int search( Query const &query, int *out ) const
+    {
+        bool const first_hit = StopsAtFirstHit<Query>::value;
+        Box range;
+        expand( range, query._geometry );
+        int first[3];
+        int last[3];
+        for ( int d = 0; d < 3; ++d )
+        {
+            first[d] =
+                cellCoordinate( range.minCorner()[d] - max_half_extent, d );
+            last[d] =
+                cellCoordinate( range.maxCorner()[d] + max_half_extent, d );
+        }
+        int count = 0;
+        Node leaf;
+        for ( int k = first[2]; k <= last[2]; ++k )
+            for ( int j = first[1]; j <= last[1]; ++j )
+                for ( int i = first[0]; i <= last[0]; ++i )
+                {
+                    int const c = cellIndex( i, j, k );
+                    for ( int p = cell_offset( c ); p < cell_offset( c + 1 );
+                          ++p )
+                    {
+                        leaf.bounding_box = boxes( p );
+                        if ( !query( &leaf ) )
+                            continue;
+                        if ( out != nullptr )
+                            out[count] = indices( p );
+                        ++count;
+                        if ( first_hit )
+                            return count;
+                    }
+                }
+        return count;
+    }
+
+    // Find the k nearest objects among those strictly closer than the maximum
+    // distance and write them, by increasing distance, into the buffer which
+    // must hold min(k, size()) entries.  Return how many were found.  The
+    // cells are visited in shells of growing size around the cell of the
+    // query until no object outside of them can be closer than the kth
+    // neighbor found so far.
+    template <typename Geometry>
+    KOKKOS_INLINE_FUNCTION int nearest( Nearest<Geometry> const &query,
+                                        Kokkos::pair<int, double> *buffer,
+                                        int buffer_size ) const
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+        using PairIndexDistance = Kokkos::pair<int, double>;
+        struct CompareDistance
+        {
+            KOKKOS_INLINE_FUNCTION bool
+            operator()( PairIndexDistance const &lhs,
+                        PairIndexDistance const &rhs ) const
+            {
+                return lhs.second < rhs.second;
+            }
+        };
+
+        int const n_neighbors = min( query._k, buffer_size );
+        if ( n_neighbors < 1 )
+            return 0;
+
+        // The farthest object found so far is on top.
+        std::size_t const heap_capacity = n_neighbors;
+        PriorityQueue<PairIndexDistance, CompareDistance,
+                      UnmanagedStaticVector<PairIndexDistance>>
+            heap( UnmanagedStaticVector<PairIndexDistance>( buffer,
+                                                            heap_capacity ) );
+        // Objects farther than that radius can safely be discarded.
+        double radius = query._max_distance;
+        auto const &geometry = query._geometry;
+        auto const visitCell = [this, &heap, &radius, &geometry,
+                                heap_capacity]( int i, int j, int k ) {
+            int const c = cellIndex( i, j, k );
+            for ( int p = cell_offset( c ); p < cell_offset( c + 1 ); ++p )
+            {
+                double const object_distance =
+                    distance( geometry, boxes( p ) );
+                if ( !( object_distance < radius ) )
+                    continue;
+                auto const object =
+                    Kokkos::make_pair( indices( p ), object_distance );
+                if ( heap.size() < heap_capacity )
+                {
+                    heap.push( object );
+                    if ( heap.size() == heap_capacity )
+                        radius = heap.top().second;
+                }
+                else
+                {
+                    heap.popPush( object );
+                    radius = heap.top().second;
+                }
+            }
+        };
+
+        double const infinity = KokkosHelpers::ArithTraits<double>::infinity();
+        Box range;
+        expand( range, geometry );
+        int center[3];
+        for ( int d = 0; d < 3; ++d )
+            center[d] = cellCoordinate(
+                0.5 * ( range.minCorner()[d] + range.maxCorner()[d] ), d );
+        for ( int r = 0;; ++r )
+        {
+            // Cells within r of the center along every axis have been
+            // visited once this shell is done.  The objects binned elsewhere
+            // are at least gap - max_half_extent away from the query.
+            int first[3];
+            int last[3];
+            double gap = infinity;
+            for ( int d = 0; d < 3; ++d )
+            {
+                first[d] = max( center[d] - r, 0 );
+                last[d] = min( center[d] + r, n_cells[d] - 1 );
+                if ( center[d] - r > 0 )
+                    gap = min( gap, range.minCorner()[d] -
+                                        ( origin[d] + ( center[d] - r ) *
+                                                          cell_size ) );
+                if ( center[d] + r < n_cells[d] - 1 )
+                    gap = min( gap, origin[d] +
+                                        ( center[d] + r + 1 ) * cell_size -
+                                        range.maxCorner()[d] );
+            }
+            for ( int k = first[2]; k <= last[2]; ++k )
+                for ( int j = first[1]; j <= last[1]; ++j )
+                {
+                    bool const inside =
+                        ( k - center[2] < r && center[2] - k < r &&
+                          j - center[1] < r && center[1] - j < r );
+                    if ( !inside )
+                    {
+                        for ( int i = first[0]; i <= last[0]; ++i )
+                            visitCell( i, j, k );
+                        continue;
+                    }
+                    // Only the two ends of the row belong to the shell.
+                    if ( center[0] - r >= 0 )
+                        visitCell( center[0] - r, j, k );
+                    if ( center[0] + r < n_cells[0] )
+                        visitCell( center[0] + r, j, k );
+                }
+            if ( gap == infinity || radius <= gap - max_half_extent )
+                break;
+        }
+
+        // Sort the objects found in place.
+        // NOTE: Messing with the underlying container invalidates the state
+        // of the PriorityQueue, which is not used past this point.
+        sortHeap( heap.data(), heap.data() + heap.size(), heap.valueComp() );
+        return heap.size();
+    }
+
+    Point origin;
+    double cell_size = 0.;
+    double inv_cell_size = 0.;
+    Kokkos::Array<int, 3> n_cells = {{0, 0, 0}};
+    double max_half_extent = 0.;
+    Kokkos::View<int const *, DeviceType> cell_offset;
+    Kokkos::View<int const *, DeviceType> indices;
+    Kokkos::View<Box const *, DeviceType> boxes;
+};
+
+// Bin the objects into the cells of a grid over their bounds.
+template <typename DeviceType, typename Geometry>
+HashGridCells<DeviceType>
+makeHashGridCells( Kokkos::View<Geometry const *, DeviceType> objects,
+                   Box const &bounds, double cell_size )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    int const n = objects.extent( 0 );
+    HashGridCells<DeviceType> cells;
+
+    double max_half_extent = 0.;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "hash_grid_find_largest_object" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        KOKKOS_LAMBDA( int i, double &partial_max ) {
+            Box box;
+            expand( box, objects( i ) );
+            for ( int d = 0; d < 3; ++d )
+            {
+                double const half_extent =
+                    0.5 * ( box.maxCorner()[d] - box.minCorner()[d] );
+                if ( half_extent > partial_max )
+                    partial_max = half_extent;
+            }
+        },
+        Kokkos::Experimental::Max<double>( max_half_extent ) );
+
+    // Aim at a couple of objects per cell unless the caller knows better,
+    // e.g. the radius of the queries.  The size is then increased as needed
+    // so that there are no more than a few cells per object.
+    double extent[3];
+    int n_dims = 0;
+    double volume = 1.;
+    for ( int d = 0; d < 3; ++d )
+    {
+        extent[d] = bounds.maxCorner()[d] - bounds.minCorner()[d];
+        if ( extent[d] > 0. )
+        {
+            ++n_dims;
+            volume *= extent[d];
+        }
+    }
+    double const objects_per_cell = 2.;
+    if ( !( cell_size > 0. ) )
+        cell_size =
+            ( n_dims > 0 )
+                ? std::pow( objects_per_cell * volume / n, 1. / n_dims )
+                : 1.;
+    double const max_cells = 8. * n;
+    double n_cells[3];
+    while ( true )
+    {
+        double total = 1.;
+        for ( int d = 0; d < 3; ++d )
+        {
+            n_cells[d] =
+                ( extent[d] > 0. ) ? std::ceil( extent[d] / cell_size ) : 1.;
+            if ( n_cells[d] < 1. )
+                n_cells[d] = 1.;
+            total *= n_cells[d];
+        }
+        if ( total <= max_cells )
+            break;
+        cell_size *= 2.;
+    }
+    for ( int d = 0; d < 3; ++d )
+    {
+        cells.origin[d] = bounds.minCorner()[d];
+        cells.n_cells[d] = static_cast<int>( n_cells[d] );
+    }
+    cells.cell_size = cell_size;
+    cells.inv_cell_size = 1. / cell_size;
+    cells.max_half_extent = max_half_extent;
+    int const n_total_cells =
+        cells.n_cells[0] * cells.n_cells[1] * cells.n_cells[2];
+
+    // Counting sort of the objects by cell.  The objects of a cell end up in
+    // no particular order.
+    TemporaryViews<DeviceType> temporaries;
+    auto object_cells = temporaries.template view<int *>( "object_cells", n );
+    auto ranks = temporaries.template view<int *>( "ranks_in_cells", n );
+    Kokkos::View<int *, DeviceType> cell_offset( "cell_offset",
+                                                 n_total_cells + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "hash_grid_count_objects_per_cell" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            Box box;
+            expand( box, objects( i ) );
+            Point const centroid = return_centroid( box );
+            int const c =
+                cells.cellIndex( cells.cellCoordinate( centroid[0], 0 ),
+                                 cells.cellCoordinate( centroid[1], 1 ),
+                                 cells.cellCoordinate( centroid[2], 2 ) );
+            object_cells( i ) = c;
+            ranks( i ) = Kokkos::atomic_fetch_add( &cell_offset( c ), 1 );
+        } );
+    exclusivePrefixSum( cell_offset );
+
+    Kokkos::View<int *, DeviceType> indices(
+        Kokkos::ViewAllocateWithoutInitializing( "indices" ), n );
+    Kokkos::View<Box *, DeviceType> boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "boxes" ), n );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "hash_grid_sort_objects_by_cell" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            int const p = cell_offset( object_cells( i ) ) + ranks( i );
+            Box box;
+            expand( box, objects( i ) );
+            indices( p ) = i;
+            boxes( p ) = box;
+        } );
+    Kokkos::fence();
+
+    cells.cell_offset = cell_offset;
+    cells.indices = indices;
+    cells.boxes = boxes;
+    return cells;
+}
+} // namespace Details
+
+/** \brief Search structure that bins the objects into a uniform grid
+ *
+ *  The objects are sorted by the cell that contains the centroid of their
+ *  bounding box with a counting sort, there is no hierarchy to build or to
+ *  traverse.  Spatial queries test the objects of the cells that overlap the
+ *  bounding box of their geometry, enlarged by the half extent of the largest
+ *  object.  Nearest queries test the cells in shells of growing size around
+ *  their geometry until the k nearest objects are found.  The results are
+ *  the same as those of BoundingVolumeHierarchy::query() but this pays off
+ *  over the hierarchy for point clouds of uniform density with fixed-radius
+ *  or small-k queries.  It does not for clustered objects or objects of
+ *  widely different sizes.
+ */
+template <typename DeviceType>
+class HashGrid
+{
+  public:
+    using SizeType = typename Kokkos::View<int *, DeviceType>::size_type;
+
+    HashGrid() = default;
+
+    /** The cells are cubes of the given size, enlarged if needed so that
+     *  there are no more than eight cells per object.  For fixed-radius
+     *  queries, the radius is a good choice.  With no size, the cells hold
+     *  about two objects each on average.
+     */
+    explicit HashGrid( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                       double cell_size = 0. );
+    explicit HashGrid( Kokkos::View<Point const *, DeviceType> points,
+                       double cell_size = 0. );
+
+    SizeType size() const { return _cells.size(); }
+
+    bool empty() const { return size() == 0; }
+
+    Box bounds() const { return _bounds; }
+
+    double cellSize() const { return _cells.cell_size; }
+
+    /** Same as BoundingVolumeHierarchy::query() for spatial or nearest
+     *  predicates.  The geometry of spatial predicates must have a bounding
+     *  box, i.e. rays are not supported.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+    /** Same as above for nearest predicates and also return the distances to
+     *  the objects found.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances ) const;
+
+  private:
+    template <typename Geometry>
+    void build( Kokkos::View<Geometry const *, DeviceType> objects,
+                double cell_size );
+
+    template <typename Query>
+    void queryDispatch( Details::SpatialPredicateTag,
+                        Kokkos::View<Query *, DeviceType> queries,
+                        Kokkos::View<int *, DeviceType> &indices,
+                        Kokkos::View<int *, DeviceType> &offset,
+                        Kokkos::View<double *, DeviceType> * ) const;
+
+    template <typename Query>
+    void queryDispatch( Details::NearestPredicateTag,
+                        Kokkos::View<Query *, DeviceType> queries,
+                        Kokkos::View<int *, DeviceType> &indices,
+                        Kokkos::View<int *, DeviceType> &offset,
+                        Kokkos::View<double *, DeviceType> *distances ) const;
+
+    Details::HashGridCells<DeviceType> _cells;
+    Box _bounds;
+};
+
+namespace Details
+{
+template <typename DeviceType, typename Query>
+void hashGridSpatialQueries( HashGridCells<DeviceType> const &cells,
+                             Kokkos::View<Query *, DeviceType> queries,
+                             Kokkos::View<int *, DeviceType> &indices,
+                             Kokkos::View<int *, DeviceType> &offset )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    int const n_queries = queries.extent( 0 );
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "hash_grid_count" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              offset( q ) =
+                                  cells.search( queries( q ), nullptr );
+                          } );
+    Kokkos::fence();
+    int const n_results = exclusivePrefixSum( offset );
+
+    if ( !ReportsResults<Query>::value )
+    {
+        Kokkos::realloc( indices, 0 );
+        return;
+    }
+    reallocWithoutInitializing( indices, n_results );
+    Kokkos::parallel_for( DTK_MARK_REGION( "hash_grid_fill" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              cells.search( queries( q ),
+                                            indices.data() + offset( q ) );
+                          } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType, typename Query>
+void hashGridNearestQueries(
+    HashGridCells<DeviceType> const &cells,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> *distances_ptr )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using PairIndexDistance = Kokkos::pair<int, double>;
+
+    int const n_queries = queries.extent( 0 );
+    int const n_objects = cells.size();
+
+    // The objects found are written, sorted, at the beginning of the space
+    // reserved for each query and then compacted.
+    TemporaryViews<DeviceType> temporaries;
+    auto buffer_offset =
+        temporaries.template view<int *>( "buffer_offset", n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "scan_queries_for_numbers_of_nearest_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const k = queries( q )._k;
+            buffer_offset( q ) =
+                ( k < 0 ) ? 0 : ( k < n_objects ? k : n_objects );
+        } );
+    int const n_buffered = exclusivePrefixSum( buffer_offset );
+    auto buffer = temporaries.template view<PairIndexDistance *>(
+        "buffer", n_buffered );
+
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "hash_grid_nearest" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const first = buffer_offset( q );
+            int const buffer_size = buffer_offset( q + 1 ) - first;
+            offset( q ) = ( buffer_size > 0 )
+                              ? cells.nearest( queries( q ),
+                                               buffer.data() + first,
+                                               buffer_size )
+                              : 0;
+        } );
+    int const n_results = exclusivePrefixSum( offset );
+
+    reallocWithoutInitializing( indices, n_results );
+    Kokkos::View<double *, DeviceType> distances;
+    if ( distances_ptr )
+    {
+        reallocWithoutInitializing( *distances_ptr, n_results );
+        distances = *distances_ptr;
+    }
+    bool const return_distances = ( distances_ptr != nullptr );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "hash_grid_compact_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const first = buffer_offset( q );
+            for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+            {
+                auto const &result = buffer( first + i - offset( q ) );
+                indices( i ) = result.first;
+                if ( return_distances )
+                    distances( i ) = result.second;
+            }
+        } );
+    Kokkos::fence();
+}
+} // namespace Details
+
+template <typename DeviceType>
+HashGrid<DeviceType>::HashGrid(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, double cell_size )
+{
+    build( bounding_boxes, cell_size );
+}
+
+template <typename DeviceType>
+HashGrid<DeviceType>::HashGrid( Kokkos::View<Point const *, DeviceType> points,
+                                double cell_size )
+{
+    build( points, cell_size );
+}
+
+template <typename DeviceType>
+template <typename Geometry>
+void HashGrid<DeviceType>::build(
+    Kokkos::View<Geometry const *, DeviceType> objects, double cell_size )
+{
+    ScopedTimer timer( "tree construction" );
+
+    DTK_REQUIRE( cell_size >= 0. );
+
+    if ( objects.extent( 0 ) == 0 )
+        return;
+
+    Details::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+        objects, _bounds );
+    _cells = Details::makeHashGridCells( objects, _bounds, cell_size );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void HashGrid<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    queryDispatch( typename Query::Tag{}, queries, indices, offset, nullptr );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void HashGrid<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::NearestPredicateTag>::value,
+                   "Distances are only returned for nearest predicates" );
+    queryDispatch( typename Query::Tag{}, queries, indices, offset,
+                   &distances );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void HashGrid<DeviceType>::queryDispatch(
+    Details::SpatialPredicateTag, Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> * ) const
+{
+    if ( empty() )
+    {
+        Kokkos::realloc( offset, queries.extent( 0 ) + 1 );
+        Kokkos::realloc( indices, 0 );
+        return;
+    }
+    Details::hashGridSpatialQueries( _cells, queries, indices, offset );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void HashGrid<DeviceType>::queryDispatch(
+    Details::NearestPredicateTag, Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> *distances ) const
+{
+    Details::hashGridNearestQueries( _cells, queries, indices, offset,
+                                     distances );
+}
+
+} // namespace DataTransferKit
+
+#endif
@@ -0,0 +1,416 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_HETEROGENEOUS_BVH_HPP
+#define DTK_HETEROGENEOUS_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsBatchedQueries.hpp> // reversePermutation
+#include <DTK_DetailsUtils.hpp>          // lastElement, copyToDevice
+#include <DTK_LinearBVH.hpp>
+#include <DTK_Predicates.hpp>
+
+#include <Kokkos_View.hpp>
+
+#include <algorithm> // min, max
+#include <chrono>
+#include <cmath> // round
+#include <exception>
+#include <thread>
+#include <tuple> // tie
+#include <type_traits>
+
+namespace DataTransferKit
+{
+
+/** Two copies of the same hierarchy, one in each of two execution spaces, for
+ *  instance Kokkos::Cuda and Kokkos::OpenMP, that share the work of each
+ *  batch of queries.  The queries are sorted along the Z-order curve and cut
+ *  into two contiguous parts.  The first one is performed in DeviceType and
+ *  the second one in OtherDeviceType, concurrently when the two execution
+ *  spaces differ and one of them runs on a device.  The results are merged
+ *  back and reported as with BoundingVolumeHierarchy::query(), in
+ *  DeviceType.
+ *
+ *  The fraction of the queries performed in DeviceType follows the
+ *  throughput of each part, queries per second including the copies to and
+ *  from OtherDeviceType, as measured on the previous batch.  The hierarchy is
+ *  built twice, so this is meant for trees that are small relative to the
+ *  batches of queries.
+ */
+template <typename DeviceType, typename OtherDeviceType>
+class HeterogeneousBVH
+{
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+
+    HeterogeneousBVH() = default; // build an empty tree
+    HeterogeneousBVH( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+
+    /** Same as BoundingVolumeHierarchy::query() with views of results.  This
+     *  is not a const member function because the measured throughput
+     *  updates the split of the next batch.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset );
+
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances );
+
+    // Fraction of the next batch of queries to be performed in DeviceType.
+    double fraction() const { return _fraction; }
+
+    /** Set the fraction of the queries performed in DeviceType, between zero
+     *  and one.  Unless \c adaptive is false, it is only the starting point
+     *  and the fraction keeps following the measured throughput afterwards,
+     *  bounded away from zero and one so that both parts remain measured.
+     */
+    void setFraction( double fraction, bool adaptive = true );
+
+    Box bounds() const { return _tree.bounds(); }
+
+    SizeType size() const { return _tree.size(); }
+
+    bool empty() const { return _tree.empty(); }
+
+  private:
+    template <typename Query>
+    void queryDispatch( Details::SpatialPredicateTag,
+                        Kokkos::View<Query *, DeviceType> queries,
+                        Kokkos::View<int *, DeviceType> &indices,
+                        Kokkos::View<int *, DeviceType> &offset,
+                        Kokkos::View<double *, DeviceType> &distances );
+
+    template <typename Query>
+    void queryDispatch( Details::NearestPredicateTag,
+                        Kokkos::View<Query *, DeviceType> queries,
+                        Kokkos::View<int *, DeviceType> &indices,
+                        Kokkos::View<int *, DeviceType> &offset,
+                        Kokkos::View<double *, DeviceType> &distances );
+
+    // Perform the queries of each part with performQueries( tree, queries,
+    // indices, offset, distances ) and merge the results, the distances
+    // being ignored for spatial queries.
+    template <typename Query, typename PerformQueries>
+    void queryParts( Kokkos::View<Query *, DeviceType> queries,
+                     Kokkos::View<int *, DeviceType> &indices,
+                     Kokkos::View<int *, DeviceType> &offset,
+                     Kokkos::View<double *, DeviceType> &distances,
+                     bool with_distances,
+                     PerformQueries const &perform_queries );
+
+    void updateFraction( int n_first, double first_seconds, int n_other,
+                         double other_seconds );
+
+    static double constexpr min_fraction = 0.05;
+
+    BVH<DeviceType> _tree;
+    BVH<OtherDeviceType> _other_tree;
+    double _fraction = 0.5;
+    bool _adaptive = true;
+};
+
+namespace Details
+{
+// Offsets of the results of the queries of the first part followed by those
+// of the second part.
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType>
+concatenateOffsets( Kokkos::View<int const *, DeviceType> first_offset,
+                    Kokkos::View<int const *, DeviceType> second_offset )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    int const n_first = first_offset.extent_int( 0 ) - 1;
+    int const n_queries = n_first + second_offset.extent_int( 0 ) - 1;
+    int const n_first_results = lastElement( first_offset );
+    Kokkos::View<int *, DeviceType> offset(
+        Kokkos::ViewAllocateWithoutInitializing( first_offset.label() ),
+        n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "concatenate_offsets" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries + 1 ),
+        KOKKOS_LAMBDA( int i ) {
+            offset( i ) = ( i <= n_first )
+                              ? first_offset( i )
+                              : n_first_results + second_offset( i - n_first );
+        } );
+    Kokkos::fence();
+    return offset;
+}
+
+template <typename T, typename DeviceType>
+Kokkos::View<T *, DeviceType>
+concatenate( Kokkos::View<T *, DeviceType> first,
+             Kokkos::View<T *, DeviceType> second )
+{
+    int const n_first = first.extent( 0 );
+    int const n = n_first + second.extent( 0 );
+    Kokkos::View<T *, DeviceType> v(
+        Kokkos::ViewAllocateWithoutInitializing( first.label() ), n );
+    Kokkos::deep_copy( Kokkos::subview( v, Kokkos::make_pair( 0, n_first ) ),
+                       first );
+    Kokkos::deep_copy( Kokkos::subview( v, Kokkos::make_pair( n_first, n ) ),
+                       second );
+    return v;
+}
+} // namespace Details
+
+template <typename DeviceType, typename OtherDeviceType>
+double constexpr HeterogeneousBVH<DeviceType, OtherDeviceType>::min_fraction;
+
+template <typename DeviceType, typename OtherDeviceType>
+HeterogeneousBVH<DeviceType, OtherDeviceType>::HeterogeneousBVH(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+    : _tree( bounding_boxes )
+    , _other_tree( Details::copyToDevice( bounding_boxes, OtherDeviceType{} ) )
+{
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::setFraction(
+    double fraction, bool adaptive )
+{
+    DTK_REQUIRE( fraction >= 0. && fraction <= 1. );
+    _fraction = fraction;
+    _adaptive = adaptive;
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::updateFraction(
+    int n_first, double first_seconds, int n_other, double other_seconds )
+{
+    if ( !_adaptive || n_first == 0 || n_other == 0 || first_seconds <= 0. ||
+         other_seconds <= 0. )
+        return;
+    double const first_rate = n_first / first_seconds;
+    double const other_rate = n_other / other_seconds;
+    _fraction = std::min(
+        std::max( first_rate / ( first_rate + other_rate ), min_fraction ),
+        1. - min_fraction );
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+template <typename Query>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "nearest predicates also report distances" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    queryDispatch( typename Query::Tag{}, queries, indices, offset,
+                   distances );
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+template <typename Query>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances )
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::NearestPredicateTag>::value,
+                   "distances are only reported for nearest predicates" );
+    queryDispatch( typename Query::Tag{}, queries, indices, offset,
+                   distances );
+}
+
+namespace Details
+{
+struct PerformSpatialQueries
+{
+    template <typename Tree, typename Query, typename Device>
+    void operator()( Tree const &tree, Kokkos::View<Query *, Device> queries,
+                     Kokkos::View<int *, Device> &indices,
+                     Kokkos::View<int *, Device> &offset,
+                     Kokkos::View<double *, Device> & ) const
+    {
+        tree.query( queries, indices, offset );
+    }
+};
+
+struct PerformNearestQueries
+{
+    template <typename Tree, typename Query, typename Device>
+    void operator()( Tree const &tree, Kokkos::View<Query *, Device> queries,
+                     Kokkos::View<int *, Device> &indices,
+                     Kokkos::View<int *, Device> &offset,
+                     Kokkos::View<double *, Device> &distances ) const
+    {
+        tree.query( queries, indices, offset, distances );
+    }
+};
+} // namespace Details
+
+template <typename DeviceType, typename OtherDeviceType>
+template <typename Query>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::queryDispatch(
+    Details::SpatialPredicateTag, Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances )
+{
+    queryParts( queries, indices, offset, distances, false,
+                Details::PerformSpatialQueries{} );
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+template <typename Query>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::queryDispatch(
+    Details::NearestPredicateTag, Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances )
+{
+    queryParts( queries, indices, offset, distances, true,
+                Details::PerformNearestQueries{} );
+}
+
+template <typename DeviceType, typename OtherDeviceType>
+template <typename Query, typename PerformQueries>
+void HeterogeneousBVH<DeviceType, OtherDeviceType>::queryParts(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances, bool with_distances,
+    PerformQueries const &perform_queries )
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Nearby queries end up in the same part so that each part keeps the
+    // coherence of the traversals.
+    QueryOrdering<DeviceType, Query> const ordering( queries, bounds() );
+    int const n_queries = queries.extent( 0 );
+    int const n_first = std::min(
+        static_cast<int>( std::round( _fraction * n_queries ) ), n_queries );
+    int const n_other = n_queries - n_first;
+
+    Kokkos::View<Query *, DeviceType> first_queries =
+        Kokkos::subview( ordering._queries, Kokkos::make_pair( 0, n_first ) );
+    Kokkos::View<int *, DeviceType> first_indices( indices.label() );
+    Kokkos::View<int *, DeviceType> first_offset( offset.label() );
+    Kokkos::View<double *, DeviceType> first_distances( distances.label() );
+    double first_seconds = 0.;
+    auto const perform_first = [&]() {
+        auto const start = Clock::now();
+        perform_queries( _tree, first_queries, first_indices, first_offset,
+                         first_distances );
+        Kokkos::fence();
+        first_seconds =
+            std::chrono::duration<double>( Clock::now() - start ).count();
+    };
+
+    // The results of the other part are copied back to DeviceType as soon as
+    // they are ready.
+    Kokkos::View<int *, DeviceType> other_indices( indices.label() );
+    Kokkos::View<int *, DeviceType> other_offset( offset.label() );
+    Kokkos::View<double *, DeviceType> other_distances( distances.label() );
+    double other_seconds = 0.;
+    auto const perform_other = [&]() {
+        auto const start = Clock::now();
+        auto const other_queries = Details::copyToDevice(
+            Kokkos::subview( ordering._queries,
+                             Kokkos::make_pair( n_first, n_queries ) ),
+            OtherDeviceType{} );
+        Kokkos::View<int *, OtherDeviceType> indices_part( indices.label() );
+        Kokkos::View<int *, OtherDeviceType> offset_part( offset.label() );
+        Kokkos::View<double *, OtherDeviceType> distances_part(
+            distances.label() );
+        perform_queries( _other_tree, other_queries, indices_part,
+                         offset_part, distances_part );
+        other_indices = Details::copyToDevice( indices_part, DeviceType{} );
+        other_offset = Details::copyToDevice( offset_part, DeviceType{} );
+        if ( with_distances )
+            other_distances =
+                Details::copyToDevice( distances_part, DeviceType{} );
+        Kokkos::fence();
+        other_seconds =
+            std::chrono::duration<double>( Clock::now() - start ).count();
+    };
+
+    // Kokkos only supports launching host kernels from the thread that
+    // initialized it, so the part performed on a device is the one handed
+    // over to another thread.  Two host execution spaces would compete for
+    // the same cores and are not run concurrently.
+    bool const first_on_host = Details::RunsOnHost<DeviceType>::value;
+    bool const other_on_host = Details::RunsOnHost<OtherDeviceType>::value;
+    if ( n_first > 0 && n_other > 0 && first_on_host != other_on_host )
+    {
+        std::exception_ptr error;
+        std::thread worker( [&]() {
+            try
+            {
+                if ( first_on_host )
+                    perform_other();
+                else
+                    perform_first();
+            }
+            catch ( ... )
+            {
+                error = std::current_exception();
+            }
+        } );
+        try
+        {
+            if ( first_on_host )
+                perform_first();
+            else
+                perform_other();
+        }
+        catch ( ... )
+        {
+            worker.join();
+            throw;
+        }
+        worker.join();
+        if ( error )
+            std::rethrow_exception( error );
+    }
+    else
+    {
+        perform_first();
+        perform_other();
+    }
+    updateFraction( n_first, first_seconds, n_other, other_seconds );
+
+    // Concatenate the results of both parts, in the order of the sorted
+    // queries, and restore the original order of the queries.
+    auto const merged_offset =
+        Details::concatenateOffsets<DeviceType>( first_offset, other_offset );
+    auto const merged_indices =
+        Details::concatenate( first_indices, other_indices );
+    if ( with_distances )
+        std::tie( offset, indices, distances ) =
+            Details::BatchedQueries<DeviceType>::reversePermutation(
+                ordering._permute, merged_offset, merged_indices,
+                Details::concatenate( first_distances, other_distances ) );
+    else
+        std::tie( offset, indices ) =
+            Details::BatchedQueries<DeviceType>::reversePermutation(
+                ordering._permute, merged_offset, merged_indices );
+}
+
+} // namespace DataTransferKit
+
+#endif
@@ -17,195 +17,779 @@
 #include <DTK_Box.hpp>
 #include <DTK_DetailsAlgorithms.hpp>
 #include <DTK_DetailsBatchedQueries.hpp>
+#include <DTK_DetailsCachingAllocator.hpp>
 #include <DTK_DetailsNode.hpp>
 #include <DTK_DetailsTreeTraversal.hpp>
 #include <DTK_DetailsUtils.hpp>
+#include <DTK_Point.hpp>
 #include <DTK_Predicates.hpp>
+#include <DTK_QueryWorkspace.hpp>
+#include <DTK_Reducers.hpp>
+#include <DTK_Sphere.hpp>
+#include <DTK_Tuning.hpp>
 
 #include <Kokkos_ArithTraits.hpp>
 #include <Kokkos_Array.hpp>
+#include <Kokkos_Timer.hpp>
 #include <Kokkos_View.hpp>
 
+#include <string>
+#include <type_traits>
+#include <utility> // forward
+#include <vector>
+
 namespace DataTransferKit
 {
 
-template <typename DeviceType>
+/** Tags to select the size of the Morton codes used to sort the objects along
+ * the Z-order space-filling curve when building the hierarchy.  30-bit codes
+ * (10 bits per dimension) are used by default.  63-bit codes (21 bits per
+ * dimension) resolve objects that are tightly clustered relative to the extent
+ * of the scene and would otherwise end up with duplicate codes.
+ */
+struct MortonCode32Tag
+{
+};
+struct MortonCode64Tag
+{
+};
+/** Same as above with the objects sorted along the Hilbert curve instead,
+ * see HilbertCurveTag.
+ */
+struct HilbertCode32Tag
+{
+};
+struct HilbertCode64Tag
+{
+};
+
+/** Strategies to lay out the results of spatial queries, passed as the last
+ * argument of BoundingVolumeHierarchy::query().  With CountThenFill, a first
+ * traversal only counts the results of each query, the offsets are computed
+ * with a prefix sum, and a second traversal writes the indices at their final
+ * location.  With AdaptiveBuffer, the number of results per query is
+ * estimated by traversing a sample of the queries.  The results are written
+ * into a buffer of that size per query during a single traversal and only the
+ * queries that did not fit are traversed again.  With AutoTuned, both
+ * strategies are timed in the first calls and the fastest one is used from
+ * then on, for each execution space and class of numbers of queries (see
+ * Tuning).
+ */
+struct CountThenFill
+{
+};
+struct AdaptiveBuffer
+{
+    explicit AdaptiveBuffer( int sample_size = 256 )
+        : _sample_size( sample_size )
+    {
+    }
+    int _sample_size;
+};
+struct AutoTuned
+{
+};
+
+/** Queries sorted along a space-filling curve, the Z-order curve unless
+ * another one is selected, together with the permutation that restores their
+ * original order.  query() sorts the queries it is given on each call along
+ * the Z-order curve, relative to the bounds of the tree, so that nearby
+ * threads traverse similar paths.  When the same queries are performed
+ * repeatedly, or against several trees, or along the Hilbert curve, an
+ * ordering can be computed once and passed to query() in place of the view
+ * of queries.  The results are still reported in the original order.  Any
+ * scene bounding box yields correct results but the ordering works best when
+ * the box encloses the queries and the tree, e.g. the bounds() of one of the
+ * trees.  The queries may also be made on demand by a functor rather than
+ * read from a view, so that only the sorted queries are ever stored.
+ */
+template <typename DeviceType, typename Query>
+struct QueryOrdering
+{
+    QueryOrdering( Kokkos::View<Query *, DeviceType> queries,
+                   Box const &scene_bounding_box )
+        : QueryOrdering( queries, scene_bounding_box, ZOrderCurveTag{} )
+    {
+    }
+    // Queries sorted along another space-filling curve, e.g. with
+    // HilbertCurveTag.
+    template <typename Curve>
+    QueryOrdering( Kokkos::View<Query *, DeviceType> queries,
+                   Box const &scene_bounding_box, Curve curve )
+        : _permute( Details::BatchedQueries<DeviceType>::sortQueriesAlongCurve(
+              scene_bounding_box, queries, curve ) )
+        , _queries( Details::BatchedQueries<DeviceType>::applyPermutation(
+              _permute, queries ) )
+    {
+    }
+    // Queries made by generator( i ), for i < n_queries, e.g. nearest
+    // predicates from the coordinates of points.  The generator is called on
+    // the device, twice for each query, and must return the same query both
+    // times.  This spares the view of queries in their original order and
+    // the copy that sorts it.
+    template <typename Generator>
+    QueryOrdering( Generator const &generator, size_t n_queries,
+                   Box const &scene_bounding_box )
+        : QueryOrdering( generator, n_queries, scene_bounding_box,
+                         ZOrderCurveTag{} )
+    {
+    }
+    template <typename Generator, typename Curve>
+    QueryOrdering( Generator const &generator, size_t n_queries,
+                   Box const &scene_bounding_box, Curve curve )
+        : _permute( Details::BatchedQueries<DeviceType>::sortQueriesAlongCurve(
+              scene_bounding_box, generator, n_queries, curve ) )
+        , _queries( Details::BatchedQueries<DeviceType>::
+                        template makePermutedQueries<Query>( _permute,
+                                                             generator ) )
+    {
+    }
+    // Queries that are already sorted, along with the original index of each
+    // of them.
+    QueryOrdering( Kokkos::View<size_t *, DeviceType> permute,
+                   Kokkos::View<Query *, DeviceType> sorted_queries )
+        : _permute( permute )
+        , _queries( sorted_queries )
+    {
+    }
+    Kokkos::View<size_t *, DeviceType> _permute;
+    Kokkos::View<Query *, DeviceType> _queries;
+};
+
+/** Measures of the quality of a hierarchy, see
+ * BoundingVolumeHierarchy::computeStatistics().  They do not depend on the
+ * queries and help to tell a tree of poor quality from a costly workload.
+ */
+struct TreeStatistics
+{
+    // Number of leaves at each depth, the root being at depth zero.
+    std::vector<int> depth_histogram;
+    // Same as what refit() compares, i.e. normalized by the surface area of
+    // the root.
+    double sah_cost = 0.;
+    // Sum over the internal nodes of the volume of the intersection of the
+    // bounding boxes of their two children.  The tree separates the objects
+    // better as it gets smaller.
+    double sibling_overlap_volume = 0.;
+    // Volume of the bounding boxes of the leaves.
+    double min_leaf_volume = 0.;
+    double max_leaf_volume = 0.;
+    double mean_leaf_volume = 0.;
+    double total_leaf_volume = 0.;
+};
+
+/** The Coordinate template parameter selects the precision of the bounding
+ * boxes stored in the nodes of the hierarchy.  The hierarchy is always built
+ * in double precision.  With single precision, the boxes are then rounded
+ * outward, which halves the memory footprint of the nodes and the bandwidth
+ * needed to traverse the tree.  Spatial queries may then return a few extra
+ * objects whose boxes do not quite satisfy the predicate and nearest queries
+ * report distances to the rounded leaf boxes, with a relative error of the
+ * order of single precision epsilon.  No object that satisfies a predicate is
+ * ever missed, so the results are exact after a double precision refinement
+ * step on the candidates.
+ */
+template <typename DeviceType, typename Coordinate = double>
 class BoundingVolumeHierarchy
 {
+    static_assert( std::is_same<Coordinate, double>::value ||
+                       std::is_same<Coordinate, float>::value,
+                   "Coordinate must be either double or float" );
+
   public:
     using TreeType = BoundingVolumeHierarchy;
+    using node_type = BasicNode<typename std::conditional<
+        std::is_same<Coordinate, float>::value, Details::FloatBox,
+        Box>::type>;
 
     BoundingVolumeHierarchy() = default; // build an empty tree
     BoundingVolumeHierarchy(
         Kokkos::View<Box const *, DeviceType> bounding_boxes );
+    // The number of treelet restructuring passes (zero by default) trades
+    // construction time for a hierarchy of better quality according to the
+    // surface area heuristic.  This pays off when the tree is queried many
+    // times.
+    BoundingVolumeHierarchy(
+        Kokkos::View<Box const *, DeviceType> bounding_boxes, MortonCode32Tag,
+        int treelet_restructuring_passes = 0 );
+    BoundingVolumeHierarchy(
+        Kokkos::View<Box const *, DeviceType> bounding_boxes, MortonCode64Tag,
+        int treelet_restructuring_passes = 0 );
+    BoundingVolumeHierarchy(
+        Kokkos::View<Box const *, DeviceType> bounding_boxes, HilbertCode32Tag,
+        int treelet_restructuring_passes = 0 );
+    BoundingVolumeHierarchy(
+        Kokkos::View<Box const *, DeviceType> bounding_boxes, HilbertCode64Tag,
+        int treelet_restructuring_passes = 0 );
+    // Objects may also be given as points or spheres rather than as their
+    // bounding boxes.  This spares the caller a temporary allocation for the
+    // boxes.  Leaf nodes store the smallest box that encloses each object.
+    BoundingVolumeHierarchy( Kokkos::View<Point const *, DeviceType> points );
+    BoundingVolumeHierarchy(
+        Kokkos::View<Sphere const *, DeviceType> spheres );
+    // Points may even be given by their coordinates, one point per row and at
+    // most three columns, which spares the copy into an array of points.  The
+    // missing coordinates of points in lower dimension are zero.
+    BoundingVolumeHierarchy(
+        Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType>
+            coordinates );
+
+    /** Build many independent hierarchies at once, sharing the kernel launches
+     * among all of them.  This pays off when the trees are small and the
+     * construction is dominated by the launch overhead.
+     *
+     * @param bounding_boxes Bounding boxes of the objects of all the trees,
+     * tree after tree.
+     *
+     * @param offsets The objects of the ith tree are the bounding boxes from
+     * offsets( i ) to offsets( i + 1 ) - 1.  The first entry is zero and the
+     * last one is the total number of objects.
+     *
+     * @return One hierarchy per tree.  Each one is the same as if it had been
+     * built on its own from its objects with 30-bit Morton codes, except
+     * possibly for how objects with identical codes are split.  Object
+     * indices are relative to the first object of the tree.  The nodes of all
+     * the trees are stored in a single allocation.
+     */
+    static std::vector<BoundingVolumeHierarchy>
+    buildForest( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                 Kokkos::View<int const *, DeviceType> offsets );
 
     // Views are passed by reference here because internally Kokkos::realloc()
-    // is called.
+    // is called.  The offset view holds int by default.  A View of
+    // std::int64_t may be passed instead when the total number of results
+    // exceeds the range of int.  The indices of the objects remain int.
+    // Alternatively, a callback can be passed instead of the indices and
+    // offset views.  It is then invoked, on the device, for each pair of query
+    // and object found as callback( query_index, object_index ) for spatial
+    // queries and callback( query_index, object_index, distance ) for nearest
+    // queries, and no result is stored.  The calls happen concurrently and in
+    // no particular order across queries.  A QueryWorkspace may also be
+    // passed in place of the views, for queries that are repeated, so that
+    // the results are written into its buffers and nothing is reallocated
+    // unless the results outgrow them.  Queries that are made on demand from
+    // the data of the caller, rather than read from a view, are passed as a
+    // QueryOrdering built from a generator.
     template <typename Query, typename... Args>
     void query( Kokkos::View<Query *, DeviceType> queries,
                 Args &&... args ) const;
 
+    template <typename Query, typename... Args>
+    void query( QueryOrdering<DeviceType, Query> const &ordering,
+                Args &&... args ) const;
+
+    // The kernels of the traversals are launched on the given instance of the
+    // execution space and only that instance is fenced, so that independent
+    // work may proceed concurrently on other instances.  Without an instance,
+    // the default one is used.  The queries are still sorted along the
+    // Z-order curve on the default instance unless an ordering is passed.
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    template <typename Query, typename... Args>
+    void query( ExecutionSpace const &space,
+                Kokkos::View<Query *, DeviceType> queries,
+                Args &&... args ) const;
+
+    template <typename Query, typename... Args>
+    void query( ExecutionSpace const &space,
+                QueryOrdering<DeviceType, Query> const &ordering,
+                Args &&... args ) const;
+
+    /** Reduce the values of the objects that satisfy each predicate, e.g.
+     * to count the neighbors within a radius or to sum the weighted values
+     * of the sources of a kernel smoothing, without storing the results of
+     * the queries.  The values are combined during the traversal and a
+     * single one is written per query, so that the indices and offset are
+     * never allocated.  Nearest queries reduce the values of their k nearest
+     * neighbors.
+     *
+     * @param values Value of each object, in the order in which the objects
+     * were passed to the constructor, as values( index ).  Any View or
+     * functor callable on the device that way can be used.
+     * @param reducer Combines the values, e.g. SumReducer, MinReducer or
+     * MaxReducer.
+     * @param results Value of the ith query, set to the identity of the
+     * reduction when no object satisfies it.
+     */
+    template <typename Query, typename Values, typename Reducer>
+    void reduce(
+        Kokkos::View<Query *, DeviceType> queries, Values const &values,
+        Reducer const &reducer,
+        Kokkos::View<typename Reducer::value_type *, DeviceType> &results )
+        const;
+
+    /** Find the pairs of objects, one from each tree, whose bounding boxes
+     * intersect.  This gives the same results as querying this tree with one
+     * Overlap predicate per object of the other tree, but both hierarchies are
+     * traversed together so that the tests against the upper levels of this
+     * tree are shared among nearby objects of the other one.  This pays off
+     * when both trees are large.
+     *
+     * The indices of the objects of this tree that intersect the ith object
+     * of the other tree are stored from offset( i ) to offset( i + 1 ) - 1, in
+     * no particular order.  Alternatively, callback( other_index, index ) is
+     * invoked on the device for each pair.
+     */
+    /** Find the k nearest objects of every object of the tree, or the
+     * objects within the given radius of it.  The results are the same as
+     * query() with one Nearest or Within predicate per object, centered on
+     * the centroid of its bounding box, and are stored in the order of the
+     * objects.  Each object finds itself.  The queries are made directly
+     * from the leaves, which are already sorted along the Z-order curve, so
+     * that no Morton code is computed nor sorted again.  The remaining
+     * arguments are those of query(), i.e. the indices and offset views,
+     * along with the distances for nearest queries, or a callback.
+     */
+    template <typename... Args>
+    void querySelfNearest( int k, Args &&... args ) const;
+
+    /** Find the object closest to each point according to the exact
+     * distance to the objects rather than to their bounding boxes, e.g. to
+     * project points onto the triangles of a surface mesh (see
+     * SurfaceProjection).  The boxes prune the traversal and the exact
+     * distance is only computed at the leaves.
+     *
+     * @param primitive_distance Callable on the device as
+     * primitive_distance( point, index ) to return the distance from the
+     * point to the object of that index.  It must not be less than the
+     * distance to the bounding box of the object.
+     * @param indices Index of the object closest to the ith point, or -1 if
+     * the tree is empty.
+     * @param distances Distance from the ith point to that object.
+     */
+    template <typename PrimitiveDistance>
+    void queryNearestPrimitive(
+        Kokkos::View<Point const *, DeviceType> points,
+        PrimitiveDistance const &primitive_distance,
+        Kokkos::View<int *, DeviceType> &indices,
+        Kokkos::View<double *, DeviceType> &distances ) const;
+
+    template <typename... Args>
+    void querySelfWithin( double radius, Args &&... args ) const;
+
+    template <typename OtherCoordinate>
+    void join(
+        BoundingVolumeHierarchy<DeviceType, OtherCoordinate> const &other,
+        Kokkos::View<int *, DeviceType> &indices,
+        Kokkos::View<int *, DeviceType> &offset ) const;
+
+    template <typename OtherCoordinate, typename Callback>
+    void join(
+        BoundingVolumeHierarchy<DeviceType, OtherCoordinate> const &other,
+        Callback const &callback ) const;
+
+    /** Update the bounding boxes of the nodes after the objects moved,
+     * keeping the topology of the hierarchy unchanged.
+     *
+     * @param bounding_boxes New bounding boxes of the objects, in the same
+     * order and in the same number as those used to construct the tree.
+     *
+     * @return The surface area heuristic (SAH) cost of the refitted hierarchy
+     * relative to the one of the hierarchy as it was constructed.  The quality
+     * of the tree degrades as this ratio grows above one.  It is up to the
+     * caller to decide when it is worth rebuilding the tree from scratch.
+     */
+    double refit( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+
+    /** Measure the quality of the hierarchy.  The nodes are copied to the
+     * host and walked there, so this is only meant for diagnostics.
+     */
+    TreeStatistics computeStatistics() const;
+
+    /** Perform the queries without reporting any result and count what the
+     * traversal goes through for each of them instead, see
+     * TraversalStatistics.  The counting is only compiled into the traversals
+     * that this instantiates, so that query() does not pay for it.
+     *
+     * @param statistics Statistics of the ith query, in the order of the
+     * queries.
+     */
+    template <typename Query>
+    void queryStatistics(
+        Kokkos::View<Query *, DeviceType> queries,
+        Kokkos::View<TraversalStatistics *, DeviceType> &statistics ) const;
+
     KOKKOS_INLINE_FUNCTION
     Box bounds() const
     {
         if ( empty() )
             return Box();
-        return ( size() > 1 ? _internal_nodes : _leaf_nodes )[0].bounding_box;
+        return Details::toBox( _internal_and_leaf_nodes[0].bounding_box );
     }
 
     using SizeType = typename Kokkos::View<int *, DeviceType>::size_type;
     KOKKOS_INLINE_FUNCTION
-    SizeType size() const { return _leaf_nodes.extent( 0 ); }
+    SizeType size() const
+    {
+        // n leaf nodes and n - 1 internal nodes
+        return ( _internal_and_leaf_nodes.extent( 0 ) + 1 ) / 2;
+    }
 
     KOKKOS_INLINE_FUNCTION
     bool empty() const { return size() == 0; }
 
   private:
-    friend struct Details::TreeTraversal<DeviceType>;
+    friend struct Details::TreeTraversal<DeviceType, Coordinate>;
+
+    // The objects are either a view of geometries or the coordinates of
+    // points wrapped into Details::PointCoordinates.  They are sorted along
+    // the Z-order curve unless the Hilbert curve is selected.
+    template <typename MortonCodeType, typename Primitives,
+              typename Curve = ZOrderCurveTag>
+    void build( Primitives const &objects, int treelet_restructuring_passes,
+                Curve curve = Curve{} );
 
-    Kokkos::View<Node *, DeviceType> _leaf_nodes;
-    Kokkos::View<Node *, DeviceType> _internal_nodes;
+    // The hierarchy is built and refitted in double precision.  These return
+    // the nodes in double precision, either the nodes of the tree themselves
+    // or a copy of them, and store them back into the tree.
+    static Kokkos::View<Node *, DeviceType>
+    makeDoublePrecisionNodes( Kokkos::View<Node *, DeviceType> nodes,
+                              bool copy );
+    static Kokkos::View<Node *, DeviceType> makeDoublePrecisionNodes(
+        Kokkos::View<BasicNode<Details::FloatBox> *, DeviceType> nodes,
+        bool copy );
+    static void storeNodes( Kokkos::View<Node const *, DeviceType>,
+                            Kokkos::View<Node *, DeviceType> );
+    static void storeNodes(
+        Kokkos::View<Node const *, DeviceType> double_precision_nodes,
+        Kokkos::View<BasicNode<Details::FloatBox> *, DeviceType> nodes );
+
+    // The n - 1 internal nodes are stored first, followed by the n leaf nodes.
+    // The root is at position 0, whether the tree is made of a single leaf or
+    // not.
+    Kokkos::View<node_type *, DeviceType> _internal_and_leaf_nodes;
+    // SAH cost of the hierarchy before its first refit.  It is only computed
+    // if needed.
+    double _reference_sah_cost = -1.;
 };
 
-template <typename DeviceType>
-using BVH = typename BoundingVolumeHierarchy<DeviceType>::TreeType;
+template <typename DeviceType, typename Coordinate = double>
+using BVH = typename BoundingVolumeHierarchy<DeviceType, Coordinate>::TreeType;
 
-template <typename DeviceType, typename Query>
+namespace Details
+{
+// Queries made by make_query( centroid ) from the centroid of the bounding
+// box of every leaf of the tree, in the order of the leaves.
+template <typename Query, typename DeviceType, typename Coordinate,
+          typename MakeQuery>
+QueryOrdering<DeviceType, Query> makeSelfQueryOrdering(
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    MakeQuery const &make_query )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    int const n = bvh.size();
+    Kokkos::View<size_t *, DeviceType> permute(
+        Kokkos::ViewAllocateWithoutInitializing( "permute" ), n );
+    Kokkos::View<Query *, DeviceType> queries(
+        Kokkos::ViewAllocateWithoutInitializing( "queries" ), n );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "make_self_queries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        KOKKOS_LAMBDA( int i ) {
+            auto const leaf = Traversal::getRoot( bvh ) + ( n - 1 ) + i;
+            permute( i ) = Traversal::getIndex( leaf );
+            queries( i ) =
+                make_query( return_centroid( toBox( leaf->bounding_box ) ) );
+        } );
+    Kokkos::fence();
+    return QueryOrdering<DeviceType, Query>( permute, queries );
+}
+
+// The heaps in which TreeTraversal::nearestQuery() keeps the nearest leaf
+// nodes found so far are placed in scratch memory when the number k of
+// neighbors is small enough, one heap per thread and team_size threads per
+// team.  Otherwise, they are carved out of a buffer in global memory.
+template <typename ExecutionSpace>
+struct NearestQueryHeapTraits
+{
+    static int constexpr team_size = 1;
+    static int constexpr max_k_in_scratch = 32;
+};
+
+#if defined( KOKKOS_ENABLE_CUDA )
+template <>
+struct NearestQueryHeapTraits<Kokkos::Cuda>
+{
+    static int constexpr team_size = 64;
+    static int constexpr max_k_in_scratch = 32;
+};
+#endif
+
+template <typename ExecutionSpace, typename DeviceType, typename Query>
+int findLargestNumberOfNearestNeighbors(
+    ExecutionSpace const &space, Kokkos::View<Query *, DeviceType> queries )
+{
+    int max_k = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "find_largest_number_of_nearest_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i, int &partial_max ) {
+            if ( queries( i )._k > partial_max )
+                partial_max = queries( i )._k;
+        },
+        Kokkos::Experimental::Max<int>( max_k ) );
+    return max_k;
+}
+
+// Perform the nearest queries on the given execution space instance.
+// insert( i, j, index, distance ) is called with the jth nearest neighbor of
+// the ith query.  max_k is the largest number of neighbors requested by any
+// of the queries.
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Insert>
+void traverseNearestQueries(
+    ExecutionSpace const &space, std::string const &label,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Kokkos::View<Query *, DeviceType> queries, int max_k,
+    Insert const &insert )
+{
+    using Traits = NearestQueryHeapTraits<ExecutionSpace>;
+    using PairIndexDistance = Kokkos::pair<int, double>;
+
+    int const n_queries = queries.extent( 0 );
+
+    // The traversal keeps the nearest neighbor alone by itself.
+    if ( max_k <= 1 )
+    {
+        using Buffer = Kokkos::View<PairIndexDistance *, DeviceType,
+                                    Kokkos::MemoryUnmanaged>;
+        Kokkos::parallel_for(
+            label, Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+            KOKKOS_LAMBDA( int i ) {
+                TreeTraversal<DeviceType, Coordinate>::query(
+                    bvh, queries( i ),
+                    [&insert, i]( int index, double distance ) {
+                        insert( i, 0, index, distance );
+                    },
+                    Buffer() );
+            } );
+        space.fence();
+        return;
+    }
+
+    if ( max_k <= Traits::max_k_in_scratch )
+    {
+        using TeamPolicy = Kokkos::TeamPolicy<ExecutionSpace>;
+        using ScratchBuffer =
+            Kokkos::View<PairIndexDistance *,
+                         typename ExecutionSpace::scratch_memory_space,
+                         Kokkos::MemoryUnmanaged>;
+        int const team_size = Traits::team_size;
+        int const n_teams = ( n_queries + team_size - 1 ) / team_size;
+        size_t const scratch_size =
+            ScratchBuffer::shmem_size( team_size * max_k );
+        Kokkos::parallel_for(
+            label,
+            TeamPolicy( space, n_teams, team_size )
+                .set_scratch_size( 0, Kokkos::PerTeam( scratch_size ) ),
+            KOKKOS_LAMBDA( typename TeamPolicy::member_type const &thread ) {
+                ScratchBuffer heaps( thread.team_shmem(), team_size * max_k );
+                int const i =
+                    thread.league_rank() * team_size + thread.team_rank();
+                if ( i >= n_queries )
+                    return;
+                int const first = thread.team_rank() * max_k;
+                int j = 0;
+                TreeTraversal<DeviceType, Coordinate>::query(
+                    bvh, queries( i ),
+                    [&insert, i, &j]( int index, double distance ) {
+                        insert( i, j++, index, distance );
+                    },
+                    Kokkos::subview( heaps,
+                                     Kokkos::make_pair(
+                                         first, first + queries( i )._k ) ) );
+            } );
+        space.fence();
+        return;
+    }
+
+    // It is not possible to anticipate how much memory to allocate since the
+    // number of nearest neighbors k is only known at runtime.
+    TemporaryViews<DeviceType> temporaries;
+    auto buffer_offset =
+        temporaries.template view<int *>( "buffer_offset", n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "scan_queries_for_numbers_of_nearest_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) { buffer_offset( i ) = queries( i )._k; } );
+    int const n_buffered = exclusivePrefixSum( space, buffer_offset );
+
+    auto buffer = temporaries.template view<PairIndexDistance *>(
+        "buffer", n_buffered );
+
+    Kokkos::parallel_for(
+        label, Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int j = 0;
+            TreeTraversal<DeviceType, Coordinate>::query(
+                bvh, queries( i ),
+                [&insert, i, &j]( int index, double distance ) {
+                    insert( i, j++, index, distance );
+                },
+                Kokkos::subview( buffer, Kokkos::make_pair(
+                                             buffer_offset( i ),
+                                             buffer_offset( i + 1 ) ) ) );
+        } );
+    space.fence();
+}
+
+// Same as above when the number of neighbors is known at compile time.  Each
+// thread keeps its own heap, so that no memory is set aside for them.
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Geometry, int K, typename Insert>
+void traverseNearestQueries(
+    ExecutionSpace const &space, std::string const &label,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Kokkos::View<NearestK<Geometry, K> *, DeviceType> queries, int,
+    Insert const &insert )
+{
+    Kokkos::parallel_for(
+        label,
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            int j = 0;
+            TreeTraversal<DeviceType, Coordinate>::query(
+                bvh, queries( i ),
+                [&insert, i, &j]( int index, double distance ) {
+                    insert( i, j++, index, distance );
+                } );
+        } );
+    space.fence();
+}
+} // namespace Details
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
 void queryDispatch(
-    Details::NearestPredicateTag, BoundingVolumeHierarchy<DeviceType> const bvh,
-    Kokkos::View<Query *, DeviceType> queries,
+    Details::NearestPredicateTag, ExecutionSpace const &space,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    QueryOrdering<DeviceType, Query> const &ordering,
     Kokkos::View<int *, DeviceType> &indices,
-    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<Offset *, DeviceType> &offset,
     Kokkos::View<double *, DeviceType> *distances_ptr = nullptr )
 {
-    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
 
     auto const n_queries = queries.extent( 0 );
 
-    auto const permute =
-        Details::BatchedQueries<DeviceType>::sortQueriesAlongZOrderCurve(
-            bvh.bounds(), queries );
+    // The count of every query and a zero in the trailing entry are written
+    // below, there is no need to fill the offsets beforehand.
+    Details::reallocResults<DeviceType>( offset, n_queries + 1 );
 
-    queries = Details::BatchedQueries<DeviceType>::applyPermutation( permute,
-                                                                     queries );
+    int max_k = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "scan_queries_for_numbers_of_nearest_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i, int &partial_max ) {
+            int const k = queries( i )._k;
+            offset( permute( i ) ) = k;
+            if ( i == 0 )
+                offset( n_queries ) = 0;
+            if ( k > partial_max )
+                partial_max = k;
+        },
+        Kokkos::Experimental::Max<int>( max_k ) );
 
-    reallocWithoutInitializing( offset, n_queries + 1 );
-    Kokkos::deep_copy( offset, 0 );
+    double const infinity = KokkosHelpers::ArithTraits<double>::infinity();
+    int any_max_distance = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "scan_queries_for_maximum_distances" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i, int &partial_any ) {
+            if ( queries( i )._max_distance != infinity )
+                partial_any = 1;
+        },
+        Kokkos::Experimental::Max<int>( any_max_distance ) );
 
-    Kokkos::parallel_for(
-        DTK_MARK_REGION( "scan_queries_for_numbers_of_nearest_neighbors" ),
-        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-        KOKKOS_LAMBDA( int i ) { offset( permute( i ) ) = queries( i )._k; } );
-    Kokkos::fence();
+    Offset const n_results = exclusivePrefixSum( space, offset );
 
-    exclusivePrefixSum( offset );
-    int const n_results = lastElement( offset );
+    // Each query finds exactly k neighbors unless it asks for more than there
+    // are leaves in the tree or it is limited to a maximum distance.  When
+    // none does, the offsets are final and the entries need neither be
+    // initialized nor compacted afterwards.
+    bool const all_queries_fulfilled =
+        static_cast<size_t>( max_k ) <= bvh.size() && any_max_distance == 0;
 
-    reallocWithoutInitializing( indices, n_results );
+    Details::reallocResults<DeviceType>( indices, n_results );
     int const invalid_index = -1;
-    Kokkos::deep_copy( indices, invalid_index );
+    if ( !all_queries_fulfilled )
+        Kokkos::deep_copy( indices, invalid_index );
     if ( distances_ptr )
     {
         Kokkos::View<double *, DeviceType> &distances = *distances_ptr;
-        reallocWithoutInitializing( distances, n_results );
+        Details::reallocResults<DeviceType>( distances, n_results );
         double const invalid_distance = -Kokkos::ArithTraits<double>::max();
-        Kokkos::deep_copy( distances, invalid_distance );
-
-        // Allocate buffer over which to perform heap operations in
-        // TreeTraversal::nearestQuery() to store nearest leaf nodes found so
-        // far.  It is not possible to anticipate how much memory to allocate
-        // since the number of nearest neighbors k is only known at runtime.
-        Kokkos::View<Kokkos::pair<int, double> *, DeviceType> buffer(
-            Kokkos::ViewAllocateWithoutInitializing( "buffer" ), n_results );
+        if ( !all_queries_fulfilled )
+            Kokkos::deep_copy( distances, invalid_distance );
 
-        Kokkos::parallel_for(
+        Details::traverseNearestQueries(
+            space,
             DTK_MARK_REGION( "perform_nearest_queries_and_return_distances" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int i ) {
-                int count = 0;
-                Details::TreeTraversal<DeviceType>::query(
-                    bvh, queries( i ),
-                    [indices, offset, distances, permute, i,
-                     &count]( int index, double distance ) {
-                        indices( offset( permute( i ) ) + count ) = index;
-                        distances( offset( permute( i ) ) + count ) = distance;
-                        count++;
-                    },
-                    Kokkos::subview(
-                        buffer,
-                        Kokkos::make_pair( offset( permute( i ) ),
-                                           offset( permute( i ) + 1 ) ) ) );
+            bvh, queries, max_k,
+            KOKKOS_LAMBDA( int i, int j, int index, double distance ) {
+                indices( offset( permute( i ) ) + j ) = index;
+                distances( offset( permute( i ) ) + j ) = distance;
             } );
-        Kokkos::fence();
     }
     else
     {
-        Kokkos::View<Kokkos::pair<int, double> *, DeviceType> buffer(
-            Kokkos::ViewAllocateWithoutInitializing( "buffer" ), n_results );
-
-        Kokkos::parallel_for(
-            DTK_MARK_REGION( "perform_nearest_queries" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int i ) {
-                int count = 0;
-                Details::TreeTraversal<DeviceType>::query(
-                    bvh, queries( i ),
-                    [indices, offset, permute, i, &count]( int index, double ) {
-                        indices( offset( permute( i ) ) + count++ ) = index;
-                    },
-                    Kokkos::subview(
-                        buffer,
-                        Kokkos::make_pair( offset( permute( i ) ),
-                                           offset( permute( i ) + 1 ) ) ) );
+        Details::traverseNearestQueries(
+            space, DTK_MARK_REGION( "perform_nearest_queries" ), bvh, queries,
+            max_k,
+            KOKKOS_LAMBDA( int i, int j, int index, double ) {
+                indices( offset( permute( i ) ) + j ) = index;
             } );
-        Kokkos::fence();
     }
+
+    if ( all_queries_fulfilled )
+        return;
+
     // Find out if they are any invalid entries in the indices (i.e. at least
-    // one query asked for more neighbors that they are leaves in the tree) and
-    // eliminate them if necessary.
+    // one query asked for more neighbors that they are leaves in the tree or
+    // within its maximum distance) and eliminate them if necessary.
     auto tmp_offset = cloneWithoutInitializingNorCopying( offset );
     Kokkos::deep_copy( tmp_offset, 0 );
-    Kokkos::parallel_for( DTK_MARK_REGION( "count_invalid_indices" ),
-                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-                          KOKKOS_LAMBDA( int q ) {
-                              for ( int i = offset( q ); i < offset( q + 1 );
-                                    ++i )
-                                  if ( indices( i ) == invalid_index )
-                                  {
-                                      tmp_offset( q ) = offset( q + 1 ) - i;
-                                      break;
-                                  }
-                          } );
-    Kokkos::fence();
-    exclusivePrefixSum( tmp_offset );
-    int const n_invalid_indices = lastElement( tmp_offset );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_invalid_indices" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            for ( Offset i = offset( q ); i < offset( q + 1 ); ++i )
+                if ( indices( i ) == invalid_index )
+                {
+                    tmp_offset( q ) = offset( q + 1 ) - i;
+                    break;
+                }
+        } );
+    Offset const n_invalid_indices = exclusivePrefixSum( space, tmp_offset );
     if ( n_invalid_indices > 0 )
     {
         Kokkos::parallel_for(
             DTK_MARK_REGION( "subtract_invalid_entries_from_offset" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries + 1 ),
+            Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries + 1 ),
             KOKKOS_LAMBDA( int q ) {
                 tmp_offset( q ) = offset( q ) - tmp_offset( q );
             } );
-        Kokkos::fence();
+        space.fence();
 
-        int const n_valid_indices = n_results - n_invalid_indices;
+        Offset const n_valid_indices = n_results - n_invalid_indices;
         Kokkos::View<int *, DeviceType> tmp_indices(
             Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
             n_valid_indices );
 
         Kokkos::parallel_for(
             DTK_MARK_REGION( "copy_valid_indices" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+            Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
             KOKKOS_LAMBDA( int q ) {
-                for ( int i = 0; i < tmp_offset( q + 1 ) - tmp_offset( q );
+                for ( Offset i = 0; i < tmp_offset( q + 1 ) - tmp_offset( q );
                       ++i )
                 {
                     tmp_indices( tmp_offset( q ) + i ) =
                         indices( offset( q ) + i );
                 }
             } );
-        Kokkos::fence();
+        space.fence();
         indices = tmp_indices;
         if ( distances_ptr )
         {
@@ -215,22 +799,100 @@ void queryDispatch(
                 n_valid_indices );
             Kokkos::parallel_for(
                 DTK_MARK_REGION( "copy_valid_distances" ),
-                Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
                 KOKKOS_LAMBDA( int q ) {
-                    for ( int i = 0; i < tmp_offset( q + 1 ) - tmp_offset( q );
-                          ++i )
+                    for ( Offset i = 0;
+                          i < tmp_offset( q + 1 ) - tmp_offset( q ); ++i )
                     {
                         tmp_distances( tmp_offset( q ) + i ) =
                             distances( offset( q ) + i );
                     }
                 } );
-            Kokkos::fence();
+            space.fence();
             distances = tmp_distances;
         }
         offset = tmp_offset;
     }
 }
 
+namespace Details
+{
+// Number of spatial queries traversed together by spatialQueryPacket().
+// Packets only pay off on the host, where the tests of the lanes against a
+// node get vectorized.  On the device, each thread traverses the tree for a
+// single query.
+template <typename ExecutionSpace>
+struct SpatialQueryPacketSize
+{
+    static int constexpr value = 8;
+};
+
+#if defined( KOKKOS_ENABLE_CUDA )
+template <>
+struct SpatialQueryPacketSize<Kokkos::Cuda>
+{
+    static int constexpr value = 1;
+};
+#endif
+
+// Perform the spatial queries on the given execution space instance.
+// insert( i, j, index ) is called with the jth result of the ith query and
+// count( i, n ) with the total number n of results of the ith query.
+// Count-only queries never call insert().
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Insert, typename Count>
+void traverseSpatialQueries(
+    ExecutionSpace const &space, std::string const &label,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Kokkos::View<Query *, DeviceType> queries, Insert const &insert,
+    Count const &count )
+{
+    // Packets do not preserve the order in which the results of rays and
+    // segments are reported.
+    int constexpr packet_size =
+        ReportsInEntryOrder<Query>::value
+            ? 1
+            : SpatialQueryPacketSize<ExecutionSpace>::value;
+
+    int const n_queries = queries.extent( 0 );
+    if ( packet_size > 1 )
+    {
+        int const n_packets = ( n_queries + packet_size - 1 ) / packet_size;
+        Kokkos::parallel_for(
+            label, Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_packets ),
+            KOKKOS_LAMBDA( int p ) {
+                int const first = p * packet_size;
+                int const n_lanes =
+                    KokkosHelpers::min( packet_size, n_queries - first );
+                int n_results[packet_size] = {};
+                spatialQueryPacket<packet_size>(
+                    bvh, queries, first, n_lanes,
+                    [first, &insert, &n_results]( int lane, int index ) {
+                        if ( ReportsResults<Query>::value )
+                            insert( first + lane, n_results[lane], index );
+                        n_results[lane]++;
+                    } );
+                for ( int lane = 0; lane < n_lanes; ++lane )
+                    count( first + lane, n_results[lane] );
+            } );
+    }
+    else
+    {
+        Kokkos::parallel_for(
+            label, Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+            KOKKOS_LAMBDA( int i ) {
+                int n_results = 0;
+                count( i, TreeTraversal<DeviceType, Coordinate>::query(
+                              bvh, queries( i ),
+                              [i, &insert, &n_results]( int index ) {
+                                  insert( i, n_results++, index );
+                              } ) );
+            } );
+    }
+    space.fence();
+}
+} // namespace Details
+
 // The buffer_size argument let the user provide an upper bound for the number
 // of results per query.  If the guess is accurate, it avoid performing the tree
 // traversals twice (the 1st one to count the number of results per query, the
@@ -239,168 +901,743 @@ void queryDispatch(
 // The default value zero disable the buffer optimization.  The sign of the
 // integer is used to specify the policy in the case the size insufficient.  If
 // it is positive, the code falls back to the default behavior and performs a
-// second pass.  If it is negative, it throws an exception.
-template <typename DeviceType, typename Query>
-void queryDispatch( Details::SpatialPredicateTag,
-                    BoundingVolumeHierarchy<DeviceType> const bvh,
-                    Kokkos::View<Query *, DeviceType> queries,
+// second pass, but only for the queries that overflowed the buffer.  If it is
+// negative, it throws an exception.
+// The offsets are of the value type of the offset view, e.g. std::int64_t
+// when the total number of results may exceed the range of int.  The buffer
+// positions and the number of results are computed in that type as well.
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
+void queryDispatch( Details::SpatialPredicateTag, ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
                     Kokkos::View<int *, DeviceType> &indices,
-                    Kokkos::View<int *, DeviceType> &offset,
+                    Kokkos::View<Offset *, DeviceType> &offset,
                     int buffer_size = 0 )
 {
-    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
 
     auto const n_queries = queries.extent( 0 );
 
-    auto const permute =
-        Details::BatchedQueries<DeviceType>::sortQueriesAlongZOrderCurve(
-            bvh.bounds(), queries );
-
-    queries = Details::BatchedQueries<DeviceType>::applyPermutation( permute,
-                                                                     queries );
-
-    // Initialize view
-    // [ 0 0 0 .... 0 0 ]
-    //                ^
-    //                N
-    reallocWithoutInitializing( offset, n_queries + 1 );
-    Kokkos::deep_copy( offset, 0 );
+    // The count of every query and a zero in the trailing entry are stored
+    // during the first pass, there is no need to fill the offsets beforehand.
+    Details::reallocResults<DeviceType>( offset, n_queries + 1 );
 
-    // Not proud of that one but that will do for now :/
-    auto const throw_if_buffer_optimization_fails = [&buffer_size]() {
-        if ( buffer_size < 0 )
-        {
-            buffer_size = -buffer_size;
-            return true;
-        }
-        else
-            return false;
-    }();
+    bool const throw_if_buffer_optimization_fails = ( buffer_size < 0 );
+    if ( buffer_size < 0 )
+        buffer_size = -buffer_size;
+    // there is nothing to buffer for count-only queries
+    if ( !Details::ReportsResults<Query>::value )
+        buffer_size = 0;
 
-    // Say we found exactly two object for each query:
+    // Say we found exactly two object for each query, the first pass leaves:
     // [ 2 2 2 .... 2 0 ]
     //   ^            ^
     //   0th          Nth element in the view
+    auto const store_count = KOKKOS_LAMBDA( int i, int n )
+    {
+        offset( permute( i ) ) = n;
+        if ( i == 0 )
+            offset( n_queries ) = 0;
+    };
     if ( buffer_size > 0 )
     {
-        reallocWithoutInitializing( indices, n_queries * buffer_size );
+        Details::reallocResults<DeviceType>( indices,
+                                             n_queries * buffer_size );
         // NOTE I considered filling with invalid indices but it is unecessary
         // work
 
-        Kokkos::parallel_for(
+        Details::traverseSpatialQueries(
+            space,
             DTK_MARK_REGION(
                 "first_pass_at_the_search_with_buffer_optimization" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int i ) {
-                int count = 0;
-                offset( permute( i ) ) =
-                    Details::TreeTraversal<DeviceType>::query(
-                        bvh, queries( i ),
-                        [indices, offset, permute, buffer_size, i,
-                         &count]( int index ) {
-                            if ( count < buffer_size )
-                                indices( permute( i ) * buffer_size +
-                                         count++ ) = index;
-                        } );
-            } );
+            bvh, queries,
+            KOKKOS_LAMBDA( int i, int j, int index ) {
+                if ( j < buffer_size )
+                    indices( static_cast<Offset>( permute( i ) ) * buffer_size +
+                             j ) = index;
+            },
+            store_count );
     }
     else
-        Kokkos::parallel_for(
+        Details::traverseSpatialQueries(
+            space,
             DTK_MARK_REGION(
                 "first_pass_at_the_search_count_the_number_of_indices" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int i ) {
-                offset( permute( i ) ) =
-                    Details::TreeTraversal<DeviceType>::query(
-                        bvh, queries( i ), []( int ) {} );
-            } );
-    Kokkos::fence();
+            bvh, queries, KOKKOS_LAMBDA( int, int, int ) {}, store_count );
 
     // NOTE max() internally calls Kokkos::parallel_reduce.  Only pay for it if
-    // actually trying buffer optimization.  In principle, any strictly
-    // positive value can be assigned otherwise.
-    auto const max_results_per_query =
-        ( buffer_size > 0 )
-            ? max( offset )
-            : std::numeric_limits<typename std::remove_reference<decltype(
-                  offset )>::type::value_type>::max();
+    // actually trying buffer optimization.  The trailing entry is left out.
+    Offset max_results_per_query = 0;
+    if ( buffer_size > 0 && n_queries > 0 )
+    {
+        auto const counts = Kokkos::subview(
+            offset, Kokkos::make_pair( 0, static_cast<int>( n_queries ) ) );
+        max_results_per_query = max( space, counts );
+    }
 
     // Then we would get:
     // [ 0 2 4 .... 2N-2 2N ]
     //                    ^
     //                    N
-    exclusivePrefixSum( offset );
-
-    // Let us extract the last element in the view which is the total count of
-    // objects which where found to meet the query predicates:
+    //
+    // The scan also returns the last element in the view which is the total
+    // count of objects which where found to meet the query predicates:
     //
     // [ 2N ]
-    int const n_results = lastElement( offset );
+    Offset const n_results = exclusivePrefixSum( space, offset );
 
-    if ( max_results_per_query > buffer_size )
+    if ( !Details::ReportsResults<Query>::value )
     {
-        // FIXME can definitely do better about error message
-        DTK_INSIST( !throw_if_buffer_optimization_fails );
+        // count-only queries, the offsets are all there is to it
+        Details::reallocResults<DeviceType>( indices, 0 );
+        return;
+    }
 
+    if ( buffer_size == 0 )
+    {
         // We allocate the memory and fill
         //
         // [ A0 A1 B0 B1 C0 C1 ... X0 X1 ]
         //   ^     ^     ^         ^     ^
         //   0     2     4         2N-2  2N
-        reallocWithoutInitializing( indices, n_results );
-        Kokkos::parallel_for(
-            DTK_MARK_REGION( "second_pass" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int i ) {
-                int count = 0;
-                Details::TreeTraversal<DeviceType>::query(
-                    bvh, queries( i ),
-                    [indices, offset, permute, i, &count]( int index ) {
-                        indices( offset( permute( i ) ) + count++ ) = index;
-                    } );
-            } );
-        Kokkos::fence();
+        Details::reallocResults<DeviceType>( indices, n_results );
+        Details::traverseSpatialQueries(
+            space, DTK_MARK_REGION( "second_pass" ), bvh, queries,
+            KOKKOS_LAMBDA( int i, int j, int index ) {
+                indices( offset( permute( i ) ) + j ) = index;
+            },
+            KOKKOS_LAMBDA( int, int ) {} );
+        return;
     }
+
+    // FIXME can definitely do better about error message
+    DTK_INSIST( !throw_if_buffer_optimization_fails ||
+                max_results_per_query <= static_cast<Offset>( buffer_size ) );
+
     // do not copy if by some miracle each query exactly yielded as many results
     // as the buffer size
-    else if ( n_results != static_cast<int>( n_queries ) * buffer_size )
+    if ( n_results == static_cast<Offset>( n_queries ) * buffer_size )
+        return;
+
+    // Copy the results of the queries that fit in the buffer and flag the
+    // other ones.
+    Kokkos::View<int *, DeviceType> tmp_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ), n_results );
+    Details::TemporaryViews<DeviceType> temporaries;
+    auto overflowed =
+        temporaries.template view<int *>( "overflowed", n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "copy_valid_indices" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int const q = permute( i );
+            Offset const n = offset( q + 1 ) - offset( q );
+            bool const fits = ( n <= static_cast<Offset>( buffer_size ) );
+            overflowed( i ) = fits ? 0 : 1;
+            if ( fits )
+                for ( Offset j = 0; j < n; ++j )
+                    tmp_indices( offset( q ) + j ) =
+                        indices( static_cast<Offset>( q ) * buffer_size + j );
+        } );
+    space.fence();
+    indices = tmp_indices;
+
+    if ( max_results_per_query <= static_cast<Offset>( buffer_size ) )
+        return;
+
+    // Traverse the tree again, but only for the queries that overflowed the
+    // buffer.  They are gathered in the same order so that they remain sorted
+    // along the Z-order curve.
+    int const n_overflowed = exclusivePrefixSum( space, overflowed );
+    auto overflowed_queries = temporaries.template view<Query *>(
+        "overflowed_queries", n_overflowed );
+    auto overflowed_permute = temporaries.template view<int *>(
+        "overflowed_permute", n_overflowed );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "gather_overflowed_queries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int const k = overflowed( i );
+            if ( overflowed( i + 1 ) != k )
+            {
+                overflowed_queries( k ) = queries( i );
+                overflowed_permute( k ) = permute( i );
+            }
+        } );
+    space.fence();
+
+    Details::traverseSpatialQueries(
+        space, DTK_MARK_REGION( "second_pass_for_overflowed_queries" ), bvh,
+        overflowed_queries,
+        KOKKOS_LAMBDA( int k, int j, int index ) {
+            indices( offset( overflowed_permute( k ) ) + j ) = index;
+        },
+        KOKKOS_LAMBDA( int, int ) {} );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
+void queryDispatch( Details::SpatialPredicateTag tag,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    Kokkos::View<int *, DeviceType> &indices,
+                    Kokkos::View<Offset *, DeviceType> &offset, CountThenFill )
+{
+    queryDispatch( tag, space, bvh, ordering, indices, offset, 0 );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
+void queryDispatch( Details::SpatialPredicateTag tag,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    Kokkos::View<int *, DeviceType> &indices,
+                    Kokkos::View<Offset *, DeviceType> &offset,
+                    AdaptiveBuffer const &strategy )
+{
+    DTK_REQUIRE( strategy._sample_size > 0 );
+
+    // Traverse the tree for queries evenly spaced in the input and use the
+    // largest number of results among them as buffer size.
+    auto const queries = ordering._queries;
+    int const n_queries = queries.extent( 0 );
+    int const n_samples =
+        KokkosHelpers::min( n_queries, strategy._sample_size );
+    int buffer_size = 0;
+    if ( n_samples > 0 )
     {
-        Kokkos::View<int *, DeviceType> tmp_indices(
-            Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
-            n_results );
+        int const stride = n_queries / n_samples;
+        Details::TemporaryViews<DeviceType> temporaries;
+        auto samples =
+            temporaries.template view<Query *>( "samples", n_samples );
         Kokkos::parallel_for(
-            DTK_MARK_REGION( "copy_valid_indices" ),
-            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
-            KOKKOS_LAMBDA( int q ) {
-                for ( int i = 0; i < offset( q + 1 ) - offset( q ); ++i )
-                {
-                    tmp_indices( offset( q ) + i ) =
-                        indices( q * buffer_size + i );
-                }
-            } );
-        Kokkos::fence();
-        indices = tmp_indices;
+            DTK_MARK_REGION( "sample_queries" ),
+            Kokkos::RangePolicy<ExecutionSpace>( space, 0, n_samples ),
+            KOKKOS_LAMBDA( int k ) { samples( k ) = queries( k * stride ); } );
+
+        auto counts = temporaries.template view<int *>( "counts", n_samples );
+        Details::traverseSpatialQueries(
+            space,
+            DTK_MARK_REGION( "estimate_the_number_of_results_per_query" ),
+            bvh, samples, KOKKOS_LAMBDA( int, int, int ) {},
+            KOKKOS_LAMBDA( int k, int n ) { counts( k ) = n; } );
+        buffer_size = max( space, counts );
     }
+
+    // A null buffer size would disable the buffer optimization.
+    queryDispatch( tag, space, bvh, ordering, indices, offset,
+                   KokkosHelpers::max( buffer_size, 1 ) );
 }
 
-template <typename DeviceType, typename Query>
+// The buffer pays off when the queries have similar numbers of results, which
+// depends on the data and cannot be told from the number of queries alone.
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
+void queryDispatch( Details::SpatialPredicateTag tag,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    Kokkos::View<int *, DeviceType> &indices,
+                    Kokkos::View<Offset *, DeviceType> &offset, AutoTuned )
+{
+    enum : int
+    {
+        count_then_fill,
+        adaptive_buffer
+    };
+    auto const key =
+        Tuning::key( "spatial_query_strategy", ExecutionSpace::name(),
+                     ordering._queries.extent( 0 ) );
+    int const strategy =
+        Tuning::select( key, {count_then_fill, adaptive_buffer} );
+
+    Kokkos::Timer timer;
+    if ( strategy == adaptive_buffer )
+        queryDispatch( tag, space, bvh, ordering, indices, offset,
+                       AdaptiveBuffer() );
+    else
+        queryDispatch( tag, space, bvh, ordering, indices, offset,
+                       CountThenFill() );
+    space.fence();
+    Tuning::report( key, strategy, timer.seconds() );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Offset>
 void queryDispatch( Details::NearestPredicateTag tag,
-                    BoundingVolumeHierarchy<DeviceType> const bvh,
-                    Kokkos::View<Query *, DeviceType> queries,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
                     Kokkos::View<int *, DeviceType> &indices,
-                    Kokkos::View<int *, DeviceType> &offset,
+                    Kokkos::View<Offset *, DeviceType> &offset,
                     Kokkos::View<double *, DeviceType> &distances )
 {
-    queryDispatch( tag, bvh, queries, indices, offset, &distances );
+    queryDispatch( tag, space, bvh, ordering, indices, offset, &distances );
+}
+
+// The results go to the views of the workspace, whose buffers are picked up
+// by reallocResults().  The remaining arguments select the strategy of the
+// spatial queries.
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename... Args>
+void queryDispatch( Details::SpatialPredicateTag tag,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    QueryWorkspace<DeviceType> &workspace, Args &&... args )
+{
+    Details::QueryWorkspaceScope<DeviceType> workspace_scope( workspace );
+    queryDispatch( tag, space, bvh, ordering, workspace.indices,
+                   workspace.offset, std::forward<Args>( args )... );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query>
+void queryDispatch( Details::NearestPredicateTag tag,
+                    ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    QueryWorkspace<DeviceType> &workspace )
+{
+    Details::QueryWorkspaceScope<DeviceType> workspace_scope( workspace );
+    queryDispatch( tag, space, bvh, ordering, workspace.indices,
+                   workspace.offset, &workspace.distances );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Callback>
+void queryDispatch( Details::SpatialPredicateTag, ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    Callback const &callback )
+{
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
+
+    Details::traverseSpatialQueries(
+        space, DTK_MARK_REGION( "perform_spatial_queries_with_callback" ), bvh,
+        queries,
+        KOKKOS_LAMBDA( int i, int, int index ) {
+            callback( permute( i ), index );
+        },
+        KOKKOS_LAMBDA( int, int ) {} );
+}
+
+template <typename ExecutionSpace, typename DeviceType, typename Coordinate,
+          typename Query, typename Callback>
+void queryDispatch( Details::NearestPredicateTag, ExecutionSpace const &space,
+                    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+                    QueryOrdering<DeviceType, Query> const &ordering,
+                    Callback const &callback )
+{
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
+
+    Details::traverseNearestQueries(
+        space, DTK_MARK_REGION( "perform_nearest_queries_with_callback" ), bvh,
+        queries,
+        Details::findLargestNumberOfNearestNeighbors( space, queries ),
+        KOKKOS_LAMBDA( int i, int, int index, double distance ) {
+            callback( permute( i ), index, distance );
+        } );
+}
+
+// Every query is answered by a single thread, which then combines the values
+// of its results directly into its own slot.
+template <typename DeviceType, typename Coordinate, typename Query,
+          typename Values, typename Reducer>
+void reduceDispatch(
+    Details::SpatialPredicateTag,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    QueryOrdering<DeviceType, Query> const &ordering, Values const &values,
+    Reducer const &reducer,
+    Kokkos::View<typename Reducer::value_type *, DeviceType> results )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
+
+    Details::traverseSpatialQueries(
+        ExecutionSpace{}, DTK_MARK_REGION( "perform_spatial_reductions" ), bvh,
+        queries,
+        KOKKOS_LAMBDA( int i, int, int index ) {
+            reducer.join( results( permute( i ) ), values( index ) );
+        },
+        KOKKOS_LAMBDA( int, int ) {} );
+}
+
+template <typename DeviceType, typename Coordinate, typename Query,
+          typename Values, typename Reducer>
+void reduceDispatch(
+    Details::NearestPredicateTag,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    QueryOrdering<DeviceType, Query> const &ordering, Values const &values,
+    Reducer const &reducer,
+    Kokkos::View<typename Reducer::value_type *, DeviceType> results )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
+
+    ExecutionSpace const space{};
+    Details::traverseNearestQueries(
+        space, DTK_MARK_REGION( "perform_nearest_reductions" ), bvh, queries,
+        Details::findLargestNumberOfNearestNeighbors( space, queries ),
+        KOKKOS_LAMBDA( int i, int, int index, double ) {
+            reducer.join( results( permute( i ) ), values( index ) );
+        } );
+}
+
+template <typename DeviceType, typename Coordinate, typename PrimitiveDistance>
+void traverseNearestPrimitiveQueries(
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    Kokkos::View<Point const *, DeviceType> points,
+    PrimitiveDistance const &primitive_distance,
+    Kokkos::View<int *, DeviceType> indices,
+    Kokkos::View<double *, DeviceType> distances )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "perform_nearest_primitive_queries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, points.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            indices( i ) = -1;
+            distances( i ) = KokkosHelpers::ArithTraits<double>::infinity();
+            Details::nearestPrimitiveQuery(
+                bvh, points( i ), primitive_distance,
+                [&indices, &distances, i]( int index, double distance ) {
+                    indices( i ) = index;
+                    distances( i ) = distance;
+                } );
+        } );
+    Kokkos::fence();
+}
+
+// The queries are traversed in their original order since the counts do not
+// depend on it.
+template <typename DeviceType, typename Coordinate, typename Query>
+void queryStatisticsDispatch(
+    Details::SpatialPredicateTag,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<TraversalStatistics *, DeviceType> statistics )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "collect_spatial_query_statistics" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            TraversalStatistics &query_statistics = statistics( i );
+            query_statistics.nodes_visited = 0;
+            query_statistics.leaves_tested = 0;
+            query_statistics.stack_high_water_mark = 0;
+            Details::TreeTraversal<DeviceType, Coordinate>::query(
+                bvh, queries( i ), []( int ) {},
+                Details::TraversalCounters{&query_statistics} );
+        } );
+    Kokkos::fence();
+}
+
+// The heaps are always carved out of a buffer in global memory.
+template <typename DeviceType, typename Coordinate, typename Query>
+void queryStatisticsDispatch(
+    Details::NearestPredicateTag,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const bvh,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<TraversalStatistics *, DeviceType> statistics )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using PairIndexDistance = Kokkos::pair<int, double>;
+
+    int const n_queries = queries.extent( 0 );
+    Details::TemporaryViews<DeviceType> temporaries;
+    auto buffer_offset =
+        temporaries.template view<int *>( "buffer_offset", n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "scan_queries_for_numbers_of_nearest_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) { buffer_offset( i ) = queries( i )._k; } );
+    int const n_buffered = exclusivePrefixSum( buffer_offset );
+    auto buffer = temporaries.template view<PairIndexDistance *>(
+        "buffer", n_buffered );
+
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "collect_nearest_query_statistics" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            TraversalStatistics &query_statistics = statistics( i );
+            query_statistics.nodes_visited = 0;
+            query_statistics.leaves_tested = 0;
+            query_statistics.stack_high_water_mark = 0;
+            Details::TreeTraversal<DeviceType, Coordinate>::query(
+                bvh, queries( i ), []( int, double ) {},
+                Kokkos::subview( buffer, Kokkos::make_pair(
+                                             buffer_offset( i ),
+                                             buffer_offset( i + 1 ) ) ),
+                Details::TraversalCounters{&query_statistics} );
+        } );
+    Kokkos::fence();
+}
+
+namespace Details
+{
+// Cut the hierarchy at the given depth and return the positions of the nodes
+// found there along with those of the leaves above it.  The subtrees rooted at
+// these nodes partition the leaves.  The position of the parent of each node
+// is written into parents, except for the root whose entry is left
+// untouched.
+template <typename DeviceType, typename Coordinate>
+Kokkos::View<int *, DeviceType>
+cutHierarchy( BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+              int depth, Kokkos::View<int *, DeviceType> &parents )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    using Node = typename Traversal::Node;
+
+    DTK_REQUIRE( depth >= 0 );
+
+    int const n_leaves = bvh.size();
+    int const n_nodes = n_leaves > 0 ? 2 * n_leaves - 1 : 0;
+    reallocWithoutInitializing( parents, n_nodes );
+    if ( bvh.empty() )
+        return Kokkos::View<int *, DeviceType>( "roots", 0 );
+
+    Node const *nodes = Traversal::getRoot( bvh );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_parents" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_leaves - 1 ),
+        KOKKOS_LAMBDA( int i ) {
+            parents( nodes[i].children.first ) = i;
+            parents( nodes[i].children.second ) = i;
+        } );
+    Kokkos::fence();
+
+    Kokkos::View<int *, DeviceType> offset( "offset", n_nodes + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "flag_roots_of_the_subtrees" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i ) {
+            int node_depth = 0;
+            for ( int node = i; node != 0 && node_depth <= depth;
+                  node = parents( node ) )
+                ++node_depth;
+            bool const is_leaf = Traversal::isLeaf( nodes + i );
+            offset( i ) = ( node_depth == depth ||
+                            ( node_depth < depth && is_leaf ) )
+                              ? 1
+                              : 0;
+        } );
+    Kokkos::fence();
+    int const n_roots = exclusivePrefixSum( offset );
+
+    Kokkos::View<int *, DeviceType> roots(
+        Kokkos::ViewAllocateWithoutInitializing( "roots" ), n_roots );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "gather_roots_of_the_subtrees" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i ) {
+            if ( offset( i + 1 ) != offset( i ) )
+                roots( offset( i ) ) = i;
+        } );
+    Kokkos::fence();
+
+    return roots;
+}
+
+// Perform a spatial join of the two hierarchies and call
+// insert( other_index, index ) for each pair of objects whose bounding boxes
+// intersect.  The other tree is cut into subtrees of about
+// leaves_per_subtree leaves and the subtrees are processed in parallel.
+template <typename DeviceType, typename Coordinate, typename OtherCoordinate,
+          typename Insert>
+void traverseSpatialJoin(
+    std::string const &label,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    BoundingVolumeHierarchy<DeviceType, OtherCoordinate> const &other,
+    Insert const &insert )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using OtherTraversal = TreeTraversal<DeviceType, OtherCoordinate>;
+    using OtherNode = typename OtherTraversal::Node;
+
+    if ( bvh.empty() || other.empty() )
+        return;
+
+    int const n_leaves = other.size();
+    int const leaves_per_subtree = 32;
+    int max_depth = 0;
+    while ( ( n_leaves >> ( max_depth + 1 ) ) >= leaves_per_subtree )
+        ++max_depth;
+
+    Kokkos::View<int *, DeviceType> parents( "parents" );
+    auto const subtrees = cutHierarchy( other, max_depth, parents );
+    OtherNode const *nodes = OtherTraversal::getRoot( other );
+
+    Kokkos::parallel_for(
+        label, Kokkos::RangePolicy<ExecutionSpace>( 0, subtrees.extent( 0 ) ),
+        KOKKOS_LAMBDA( int k ) {
+            spatialJoin( bvh, other, nodes + subtrees( k ), insert );
+        } );
+    Kokkos::fence();
+}
+} // namespace Details
+
+template <typename DeviceType, typename Coordinate>
+template <typename OtherCoordinate>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::join(
+    BoundingVolumeHierarchy<DeviceType, OtherCoordinate> const &other,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    reallocWithoutInitializing( offset, other.size() + 1 );
+    Kokkos::deep_copy( offset, 0 );
+
+    Details::traverseSpatialJoin(
+        DTK_MARK_REGION( "spatial_join_count_the_number_of_indices" ), *this,
+        other, KOKKOS_LAMBDA( int i, int ) {
+            Kokkos::atomic_increment( &offset( i ) );
+        } );
+
+    int const n_indices = exclusivePrefixSum( offset );
+
+    reallocWithoutInitializing( indices, n_indices );
+    auto cursor = clone( offset );
+    Details::traverseSpatialJoin(
+        DTK_MARK_REGION( "spatial_join_fill_the_indices" ), *this, other,
+        KOKKOS_LAMBDA( int i, int index ) {
+            indices( Kokkos::atomic_fetch_add( &cursor( i ), 1 ) ) = index;
+        } );
 }
 
-template <typename DeviceType>
+template <typename DeviceType, typename Coordinate>
+template <typename OtherCoordinate, typename Callback>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::join(
+    BoundingVolumeHierarchy<DeviceType, OtherCoordinate> const &other,
+    Callback const &callback ) const
+{
+    Details::traverseSpatialJoin(
+        DTK_MARK_REGION( "spatial_join_with_callback" ), *this, other,
+        KOKKOS_LAMBDA( int i, int index ) { callback( i, index ); } );
+}
+
+template <typename DeviceType, typename Coordinate>
 template <typename Query, typename... Args>
-void BoundingVolumeHierarchy<DeviceType>::query(
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::query(
     Kokkos::View<Query *, DeviceType> queries, Args &&... args ) const
 {
+    query( ExecutionSpace{}, queries, std::forward<Args>( args )... );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename Query, typename... Args>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::query(
+    QueryOrdering<DeviceType, Query> const &ordering, Args &&... args ) const
+{
+    query( ExecutionSpace{}, ordering, std::forward<Args>( args )... );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename Query, typename... Args>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::query(
+    ExecutionSpace const &space, Kokkos::View<Query *, DeviceType> queries,
+    Args &&... args ) const
+{
+    query( space, QueryOrdering<DeviceType, Query>( queries, bounds() ),
+           std::forward<Args>( args )... );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename Query, typename... Args>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::query(
+    ExecutionSpace const &space,
+    QueryOrdering<DeviceType, Query> const &ordering, Args &&... args ) const
+{
+    using Tag = typename Query::Tag;
+    queryDispatch( Tag{}, space, *this, ordering,
+                   std::forward<Args>( args )... );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename Query, typename Values, typename Reducer>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::reduce(
+    Kokkos::View<Query *, DeviceType> queries, Values const &values,
+    Reducer const &reducer,
+    Kokkos::View<typename Reducer::value_type *, DeviceType> &results ) const
+{
+    static_assert( Details::ReportsResults<Query>::value,
+                   "Count-only predicates report no object to reduce" );
+
+    int const n_queries = queries.extent( 0 );
+    reallocWithoutInitializing( results, n_queries );
+    Kokkos::parallel_for( DTK_MARK_REGION( "initialize_reductions" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int i ) {
+                              reducer.init( results( i ) );
+                          } );
+    Kokkos::fence();
+
+    using Tag = typename Query::Tag;
+    reduceDispatch( Tag{}, *this,
+                    QueryOrdering<DeviceType, Query>( queries, bounds() ),
+                    values, reducer, results );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename PrimitiveDistance>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::queryNearestPrimitive(
+    Kokkos::View<Point const *, DeviceType> points,
+    PrimitiveDistance const &primitive_distance,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    int const n_points = points.extent( 0 );
+    reallocWithoutInitializing( indices, n_points );
+    reallocWithoutInitializing( distances, n_points );
+    traverseNearestPrimitiveQueries( *this, points, primitive_distance,
+                                     indices, distances );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename Query>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::queryStatistics(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<TraversalStatistics *, DeviceType> &statistics ) const
+{
+    reallocWithoutInitializing( statistics, queries.extent( 0 ) );
+
     using Tag = typename Query::Tag;
-    queryDispatch( Tag{}, *this, queries, std::forward<Args>( args )... );
+    queryStatisticsDispatch( Tag{}, *this, queries, statistics );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename... Args>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::querySelfNearest(
+    int k, Args &&... args ) const
+{
+    DTK_REQUIRE( k >= 0 );
+    query( Details::makeSelfQueryOrdering<Nearest<Point>>(
+               *this, KOKKOS_LAMBDA( Point const &centroid ) {
+                   return nearest( centroid, k );
+               } ),
+           std::forward<Args>( args )... );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename... Args>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::querySelfWithin(
+    double radius, Args &&... args ) const
+{
+    DTK_REQUIRE( radius >= 0. );
+    query( Details::makeSelfQueryOrdering<Within>(
+               *this, KOKKOS_LAMBDA( Point const &centroid ) {
+                   return within( centroid, radius );
+               } ),
+           std::forward<Args>( args )... );
 }
 
 } // namespace DataTransferKit
@@ -14,68 +14,429 @@
 
 #include "DTK_ConfigDefs.hpp"
 
+#include <DTK_DBC.hpp>
 #include <DTK_DetailsAlgorithms.hpp>
 #include <DTK_DetailsTreeConstruction.hpp>
 #include <DTK_KokkosHelpers.hpp>
+#include <DTK_Statistics.hpp>
 
 #include <Kokkos_ArithTraits.hpp>
 
+#include <algorithm> // min, max
+#include <cstdint>   // uint64_t
+#include <utility>   // pair
+#include <vector>
+
 namespace DataTransferKit
 {
-template <typename DeviceType>
-BoundingVolumeHierarchy<DeviceType>::BoundingVolumeHierarchy(
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
     Kokkos::View<Box const *, DeviceType> bounding_boxes )
-    : _leaf_nodes( Kokkos::ViewAllocateWithoutInitializing( "leaf_nodes" ),
-                   bounding_boxes.extent( 0 ) )
-    , _internal_nodes(
-          Kokkos::ViewAllocateWithoutInitializing( "internal_nodes" ),
-          bounding_boxes.extent( 0 ) > 0 ? bounding_boxes.extent( 0 ) - 1 : 0 )
+    : BoundingVolumeHierarchy( bounding_boxes, MortonCode32Tag{} )
+{
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, MortonCode32Tag,
+    int treelet_restructuring_passes )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          bounding_boxes.extent( 0 ) > 0 ? 2 * bounding_boxes.extent( 0 ) - 1
+                                         : 0 )
+{
+    build<unsigned int>( bounding_boxes, treelet_restructuring_passes );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, MortonCode64Tag,
+    int treelet_restructuring_passes )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          bounding_boxes.extent( 0 ) > 0 ? 2 * bounding_boxes.extent( 0 ) - 1
+                                         : 0 )
+{
+    build<std::uint64_t>( bounding_boxes, treelet_restructuring_passes );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, HilbertCode32Tag,
+    int treelet_restructuring_passes )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          bounding_boxes.extent( 0 ) > 0 ? 2 * bounding_boxes.extent( 0 ) - 1
+                                         : 0 )
+{
+    build<unsigned int>( bounding_boxes, treelet_restructuring_passes,
+                         HilbertCurveTag{} );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes, HilbertCode64Tag,
+    int treelet_restructuring_passes )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          bounding_boxes.extent( 0 ) > 0 ? 2 * bounding_boxes.extent( 0 ) - 1
+                                         : 0 )
+{
+    build<std::uint64_t>( bounding_boxes, treelet_restructuring_passes,
+                          HilbertCurveTag{} );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Point const *, DeviceType> points )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          points.extent( 0 ) > 0 ? 2 * points.extent( 0 ) - 1 : 0 )
+{
+    build<unsigned int>( points, 0 );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<Sphere const *, DeviceType> spheres )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          spheres.extent( 0 ) > 0 ? 2 * spheres.extent( 0 ) - 1 : 0 )
+{
+    build<unsigned int>( spheres, 0 );
+}
+
+template <typename DeviceType, typename Coordinate>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::BoundingVolumeHierarchy(
+    Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType>
+        coordinates )
+    : _internal_and_leaf_nodes(
+          Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+          coordinates.extent( 0 ) > 0 ? 2 * coordinates.extent( 0 ) - 1 : 0 )
+{
+    DTK_REQUIRE( coordinates.extent( 0 ) == 0 ||
+                 ( coordinates.extent( 1 ) >= 1 &&
+                   coordinates.extent( 1 ) <= 3 ) );
+    build<unsigned int>( Details::PointCoordinates<DeviceType>{coordinates},
+                         0 );
+}
+
+template <typename DeviceType, typename Coordinate>
+template <typename MortonCodeType, typename Primitives, typename Curve>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::build(
+    Primitives const &objects, int treelet_restructuring_passes, Curve curve )
 {
+    ScopedTimer timer( "tree construction" );
+
+    DTK_REQUIRE( treelet_restructuring_passes >= 0 );
+
     if ( empty() )
     {
         return;
     }
 
+    int const n = objects.extent( 0 );
+    auto internal_and_leaf_nodes =
+        makeDoublePrecisionNodes( _internal_and_leaf_nodes, false );
+    // internal nodes come first, followed by the leaf nodes
+    auto leaf_nodes = Kokkos::subview( internal_and_leaf_nodes,
+                                       Kokkos::make_pair( n - 1, 2 * n - 1 ) );
+
     if ( size() == 1 )
     {
         Kokkos::View<size_t *, DeviceType> permutation_indices( "permute", 1 );
         Details::TreeConstruction<DeviceType>::initializeLeafNodes(
-            permutation_indices, bounding_boxes, _leaf_nodes );
+            permutation_indices, objects, leaf_nodes );
+        storeNodes( internal_and_leaf_nodes, _internal_and_leaf_nodes );
         return;
     }
 
     // determine the bounding box of the scene
     Details::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
-        bounding_boxes, _internal_nodes[0].bounding_box );
+        objects, internal_and_leaf_nodes[0].bounding_box );
 
     // calculate morton code of all objects
-    int const n = bounding_boxes.extent( 0 );
-    Kokkos::View<unsigned int *, DeviceType> morton_indices(
+    Kokkos::View<MortonCodeType *, DeviceType> morton_indices(
         Kokkos::ViewAllocateWithoutInitializing( "morton" ), n );
     Details::TreeConstruction<DeviceType>::assignMortonCodes(
-        bounding_boxes, morton_indices, _internal_nodes[0].bounding_box );
+        objects, morton_indices, internal_and_leaf_nodes[0].bounding_box,
+        curve );
 
-    // sort them along the Z-order space-filling curve
+    // sort them along the space-filling curve
     auto permutation_indices =
         Details::TreeConstruction<DeviceType>::sortObjects( morton_indices );
 
     Details::TreeConstruction<DeviceType>::initializeLeafNodes(
-        permutation_indices, bounding_boxes, _leaf_nodes );
+        permutation_indices, objects, leaf_nodes );
+
+    // generate bounding volume hierarchy along with the bounding box of each
+    // internal node in a single pass from the leaves toward the root
+    Details::TreeConstruction<DeviceType>::generateHierarchyBottomUp(
+        morton_indices, internal_and_leaf_nodes );
+
+    // optionally improve the quality of the hierarchy
+    // NOTE parent positions are only needed for the restructuring and are
+    // discarded afterwards
+    if ( treelet_restructuring_passes > 0 )
+    {
+        Kokkos::View<int *, DeviceType> parents(
+            Kokkos::ViewAllocateWithoutInitializing( "parents" ), 2 * n - 1 );
+        Details::TreeConstruction<DeviceType>::computeParents(
+            internal_and_leaf_nodes, parents );
+        for ( int pass = 0; pass < treelet_restructuring_passes; ++pass )
+            Details::TreeConstruction<DeviceType>::restructureTreelets(
+                internal_and_leaf_nodes, parents );
+    }
+
+    storeNodes( internal_and_leaf_nodes, _internal_and_leaf_nodes );
+}
+
+template <typename DeviceType, typename Coordinate>
+std::vector<BoundingVolumeHierarchy<DeviceType, Coordinate>>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::buildForest(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<int const *, DeviceType> offsets )
+{
+    DTK_REQUIRE( offsets.extent( 0 ) > 0 );
+    int const n = bounding_boxes.extent( 0 );
+    int const n_trees = offsets.extent( 0 ) - 1;
+
+    auto offsets_host = Kokkos::create_mirror_view( offsets );
+    Kokkos::deep_copy( offsets_host, offsets );
+    DTK_REQUIRE( offsets_host( 0 ) == 0 );
+    DTK_REQUIRE( offsets_host( n_trees ) == n );
+
+    // position of the root of each tree in the array that holds the nodes of
+    // all of them
+    Kokkos::View<int *, DeviceType> node_offsets(
+        Kokkos::ViewAllocateWithoutInitializing( "node_offsets" ),
+        n_trees + 1 );
+    auto node_offsets_host = Kokkos::create_mirror_view( node_offsets );
+    node_offsets_host( 0 ) = 0;
+    for ( int i = 0; i < n_trees; ++i )
+    {
+        int const n_objects = offsets_host( i + 1 ) - offsets_host( i );
+        DTK_REQUIRE( n_objects >= 0 );
+        node_offsets_host( i + 1 ) =
+            node_offsets_host( i ) + ( n_objects > 0 ? 2 * n_objects - 1 : 0 );
+    }
+    Kokkos::deep_copy( node_offsets, node_offsets_host );
+
+    Kokkos::View<node_type *, DeviceType> nodes(
+        Kokkos::ViewAllocateWithoutInitializing( "internal_and_leaf_nodes" ),
+        node_offsets_host( n_trees ) );
+
+    if ( n > 0 )
+    {
+        // Build a single hierarchy over all the objects.  Because the index
+        // of the tree makes up the most significant bits of the Morton codes,
+        // the objects of each tree are contiguous once sorted and form a
+        // subtree of that hierarchy.
+        Kokkos::View<std::uint64_t *, DeviceType> morton_indices(
+            Kokkos::ViewAllocateWithoutInitializing( "morton" ), n );
+        Details::TreeConstruction<DeviceType>::assignSegmentedMortonCodes(
+            bounding_boxes, offsets, morton_indices );
+
+        auto permutation_indices =
+            Details::TreeConstruction<DeviceType>::sortObjects(
+                morton_indices );
+
+        Kokkos::View<Node *, DeviceType> forest_nodes(
+            Kokkos::ViewAllocateWithoutInitializing( "forest_nodes" ),
+            2 * n - 1 );
+        auto leaf_nodes = Kokkos::subview(
+            forest_nodes, Kokkos::make_pair( n - 1, 2 * n - 1 ) );
+        Details::TreeConstruction<DeviceType>::initializeLeafNodes(
+            permutation_indices, bounding_boxes, leaf_nodes );
 
-    // generate bounding volume hierarchy
-    Details::TreeConstruction<DeviceType>::generateHierarchy(
-        morton_indices, _leaf_nodes, _internal_nodes );
+        if ( n > 1 )
+        {
+            Details::TreeConstruction<DeviceType>::
+                calculateBoundingBoxOfTheScene( bounding_boxes,
+                                                forest_nodes[0].bounding_box );
+
+            Kokkos::View<int *, DeviceType> parents(
+                Kokkos::ViewAllocateWithoutInitializing( "parents" ),
+                2 * n - 1 );
+            Details::TreeConstruction<DeviceType>::generateHierarchy(
+                morton_indices, forest_nodes, parents );
+            Details::TreeConstruction<DeviceType>::calculateBoundingBoxes(
+                forest_nodes, parents );
+        }
+
+        auto internal_and_leaf_nodes = makeDoublePrecisionNodes( nodes, false );
+        Details::TreeConstruction<DeviceType>::splitForest(
+            morton_indices, offsets, forest_nodes, node_offsets,
+            internal_and_leaf_nodes );
+        storeNodes( internal_and_leaf_nodes, nodes );
+    }
+
+    std::vector<BoundingVolumeHierarchy> trees( n_trees );
+    for ( int i = 0; i < n_trees; ++i )
+        trees[i]._internal_and_leaf_nodes = Kokkos::subview(
+            nodes, Kokkos::make_pair( node_offsets_host( i ),
+                                      node_offsets_host( i + 1 ) ) );
+    return trees;
+}
+
+template <typename DeviceType, typename Coordinate>
+double BoundingVolumeHierarchy<DeviceType, Coordinate>::refit(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    ScopedTimer timer( "refit" );
+
+    DTK_REQUIRE( bounding_boxes.extent( 0 ) == size() );
+
+    if ( empty() )
+    {
+        return 1.;
+    }
+
+    int const n = size();
+    auto internal_and_leaf_nodes =
+        makeDoublePrecisionNodes( _internal_and_leaf_nodes, true );
+    auto leaf_nodes = Kokkos::subview( internal_and_leaf_nodes,
+                                       Kokkos::make_pair( n - 1, 2 * n - 1 ) );
+
+    if ( _reference_sah_cost < 0. )
+        _reference_sah_cost =
+            Details::TreeConstruction<DeviceType>::computeSAHCost(
+                internal_and_leaf_nodes );
+
+    Details::TreeConstruction<DeviceType>::refitLeafNodes( bounding_boxes,
+                                                           leaf_nodes );
+
+    if ( size() == 1 )
+    {
+        storeNodes( internal_and_leaf_nodes, _internal_and_leaf_nodes );
+        return 1.;
+    }
+
+    Details::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+        bounding_boxes, internal_and_leaf_nodes[0].bounding_box );
+
+    Kokkos::View<int *, DeviceType> parents(
+        Kokkos::ViewAllocateWithoutInitializing( "parents" ), 2 * n - 1 );
+    Details::TreeConstruction<DeviceType>::computeParents(
+        internal_and_leaf_nodes, parents );
 
-    // calculate bounding box for each internal node by walking the hierarchy
-    // toward the root
     Details::TreeConstruction<DeviceType>::calculateBoundingBoxes(
-        _leaf_nodes, _internal_nodes );
+        internal_and_leaf_nodes, parents );
+
+    storeNodes( internal_and_leaf_nodes, _internal_and_leaf_nodes );
+
+    return Details::TreeConstruction<DeviceType>::computeSAHCost(
+               internal_and_leaf_nodes ) /
+           _reference_sah_cost;
+}
+
+template <typename DeviceType, typename Coordinate>
+TreeStatistics
+BoundingVolumeHierarchy<DeviceType, Coordinate>::computeStatistics() const
+{
+    TreeStatistics statistics;
+    if ( empty() )
+        return statistics;
+
+    auto const nodes =
+        makeDoublePrecisionNodes( _internal_and_leaf_nodes, false );
+    statistics.sah_cost =
+        Details::TreeConstruction<DeviceType>::computeSAHCost( nodes );
+
+    auto const nodes_host =
+        Kokkos::create_mirror_view_and_copy( Kokkos::HostSpace(), nodes );
+
+    int const n = size();
+    statistics.min_leaf_volume = Kokkos::ArithTraits<double>::max();
+    // Depth-first walk from the root with the depth of the nodes left to
+    // visit.
+    std::vector<std::pair<int, int>> stack = {{0, 0}};
+    while ( !stack.empty() )
+    {
+        int const node = stack.back().first;
+        int const depth = stack.back().second;
+        stack.pop_back();
+        auto const &children = nodes_host( node ).children;
+        if ( children.first == -1 )
+        {
+            if ( static_cast<int>( statistics.depth_histogram.size() ) <=
+                 depth )
+                statistics.depth_histogram.resize( depth + 1, 0 );
+            ++statistics.depth_histogram[depth];
+            double const leaf_volume =
+                Details::volume( nodes_host( node ).bounding_box );
+            statistics.min_leaf_volume =
+                std::min( statistics.min_leaf_volume, leaf_volume );
+            statistics.max_leaf_volume =
+                std::max( statistics.max_leaf_volume, leaf_volume );
+            statistics.total_leaf_volume += leaf_volume;
+        }
+        else
+        {
+            Box const &left = nodes_host( children.first ).bounding_box;
+            Box const &right = nodes_host( children.second ).bounding_box;
+            Box overlap;
+            for ( int d = 0; d < 3; ++d )
+            {
+                overlap.minCorner()[d] =
+                    std::max( left.minCorner()[d], right.minCorner()[d] );
+                overlap.maxCorner()[d] =
+                    std::min( left.maxCorner()[d], right.maxCorner()[d] );
+            }
+            statistics.sibling_overlap_volume += Details::volume( overlap );
+            stack.emplace_back( children.first, depth + 1 );
+            stack.emplace_back( children.second, depth + 1 );
+        }
+    }
+    statistics.mean_leaf_volume = statistics.total_leaf_volume / n;
+
+    return statistics;
+}
+
+template <typename DeviceType, typename Coordinate>
+Kokkos::View<Node *, DeviceType>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::makeDoublePrecisionNodes(
+    Kokkos::View<Node *, DeviceType> nodes, bool )
+{
+    return nodes;
+}
+
+template <typename DeviceType, typename Coordinate>
+Kokkos::View<Node *, DeviceType>
+BoundingVolumeHierarchy<DeviceType, Coordinate>::makeDoublePrecisionNodes(
+    Kokkos::View<BasicNode<Details::FloatBox> *, DeviceType> nodes,
+    bool copy )
+{
+    Kokkos::View<Node *, DeviceType> double_precision_nodes(
+        Kokkos::ViewAllocateWithoutInitializing( "double_precision_nodes" ),
+        nodes.extent( 0 ) );
+    if ( copy )
+        Details::TreeConstruction<DeviceType>::widenNodes(
+            nodes, double_precision_nodes );
+    return double_precision_nodes;
+}
+
+template <typename DeviceType, typename Coordinate>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::storeNodes(
+    Kokkos::View<Node const *, DeviceType>, Kokkos::View<Node *, DeviceType> )
+{
+    // nothing to do, the nodes were built in place
+}
+
+template <typename DeviceType, typename Coordinate>
+void BoundingVolumeHierarchy<DeviceType, Coordinate>::storeNodes(
+    Kokkos::View<Node const *, DeviceType> double_precision_nodes,
+    Kokkos::View<BasicNode<Details::FloatBox> *, DeviceType> nodes )
+{
+    Details::TreeConstruction<DeviceType>::roundNodesOutward(
+        double_precision_nodes, nodes );
 }
 
 } // namespace DataTransferKit
 
 // Explicit instantiation macro
 #define DTK_LINEAR_BVH_INSTANT( NODE )                                         \
-    template class BoundingVolumeHierarchy<typename NODE::device_type>;
+    template class BoundingVolumeHierarchy<typename NODE::device_type>;        \
+    template class BoundingVolumeHierarchy<typename NODE::device_type, float>;
 
 #endif
@@ -0,0 +1,442 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_QUANTIZED_BVH_HPP
+#define DTK_QUANTIZED_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsStack.hpp>
+#include <DTK_DetailsStackTraversal.hpp>
+#include <DTK_DetailsTreeConstruction.hpp> // computeParents
+#include <DTK_DetailsTreeTraversal.hpp>
+#include <DTK_LinearBVH.hpp>
+
+#include <Kokkos_Pair.hpp>
+#include <Kokkos_View.hpp>
+
+#include <cmath>   // floor, ceil
+#include <cstdint> // uint8_t, uint16_t
+#include <limits>
+#include <type_traits>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/** Coordinates stored as one of the levels evenly spaced between the lower
+ *  and upper bounds of the box of the parent node.  Lower corners are rounded
+ *  down and upper corners up, so that the boxes decoded from the levels
+ *  always enclose the original ones.
+ */
+template <typename T>
+struct Quantization
+{
+    static_assert( std::is_same<T, std::uint8_t>::value ||
+                       std::is_same<T, std::uint16_t>::value,
+                   "coordinates are quantized to either 8 or 16 bits" );
+
+    static int constexpr levels = std::numeric_limits<T>::max();
+
+    // The last level is exactly the upper bound, whatever the rounding of
+    // the spacing between levels.
+    KOKKOS_INLINE_FUNCTION
+    static double dequantize( int q, double lower, double upper )
+    {
+        return q == levels ? upper : lower + q * ( ( upper - lower ) / levels );
+    }
+
+    // Largest level that does not exceed x.
+    KOKKOS_INLINE_FUNCTION
+    static int quantizeDown( double x, double lower, double upper )
+    {
+        double const extent = upper - lower;
+        if ( !( extent > 0. ) )
+            return 0;
+        double const r = std::floor( ( x - lower ) / extent * levels );
+        int q = !( r > 0. ) ? 0 : ( r < levels ? (int)r : levels );
+        while ( q > 0 && dequantize( q, lower, upper ) > x )
+            --q;
+        return q;
+    }
+
+    // Smallest level that is not less than x.
+    KOKKOS_INLINE_FUNCTION
+    static int quantizeUp( double x, double lower, double upper )
+    {
+        double const extent = upper - lower;
+        if ( !( extent > 0. ) )
+            return levels;
+        double const r = std::ceil( ( x - lower ) / extent * levels );
+        int q = !( r < levels ) ? levels : ( r > 0. ? (int)r : 0 );
+        while ( q < levels && dequantize( q, lower, upper ) < x )
+            ++q;
+        return q;
+    }
+};
+
+/** Binary node that stores the boxes of its two children quantized relative
+ *  to its own box, as decoded from its parent.  Children are either other
+ *  internal nodes, given by their position, or leaves, given by -1 - their
+ *  position.  With 16-bit coordinates, a node fits in a 32-byte sector.
+ */
+template <typename T>
+struct QuantizedNode
+{
+    KOKKOS_INLINE_FUNCTION
+    Box childBox( int c, Box const &box ) const
+    {
+        Box child;
+        for ( int d = 0; d < 3; ++d )
+        {
+            child.minCorner()[d] = Quantization<T>::dequantize(
+                min_corner[c][d], box.minCorner()[d], box.maxCorner()[d] );
+            child.maxCorner()[d] = Quantization<T>::dequantize(
+                max_corner[c][d], box.minCorner()[d], box.maxCorner()[d] );
+        }
+        return child;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void setChildBox( int c, Box const &child, Box const &box )
+    {
+        for ( int d = 0; d < 3; ++d )
+        {
+            min_corner[c][d] = Quantization<T>::quantizeDown(
+                child.minCorner()[d], box.minCorner()[d], box.maxCorner()[d] );
+            max_corner[c][d] = Quantization<T>::quantizeUp(
+                child.maxCorner()[d], box.minCorner()[d], box.maxCorner()[d] );
+        }
+    }
+
+    T min_corner[2][3];
+    T max_corner[2][3];
+    int children[2];
+};
+
+static_assert( sizeof( QuantizedNode<std::uint16_t> ) <= 32,
+               "quantized nodes fit in a 32-byte sector" );
+
+// Internal node along with its decoded box and its distance to the query.
+struct QuantizedTraversalEntry
+{
+    int node;
+    double distance;
+    Box box;
+};
+
+template <typename DeviceType, typename T>
+struct QuantizedTreeTraversal
+{
+    // Only the leaves whose quantized box satisfies the predicate have their
+    // exact box loaded.
+    template <typename Predicate, typename Insert>
+    KOKKOS_FUNCTION int spatialQuery( Predicate const &pred,
+                                      Insert const &insert ) const
+    {
+        Node leaf;
+        if ( _nodes.extent( 0 ) == 0 )
+        {
+            leaf.bounding_box = _leaf_boxes( 0 );
+            if ( !pred( &leaf ) )
+                return 0;
+            insert( _leaf_indices( 0 ) );
+            return 1;
+        }
+
+        int count = 0;
+        Stack<Kokkos::pair<int, Box>> stack;
+        stack.emplace( 0, _bounds );
+        while ( !stack.empty() )
+        {
+            QuantizedNode<T> const &node = _nodes( stack.top().first );
+            Box const box = stack.top().second;
+            stack.pop();
+            for ( int c = 0; c < 2; ++c )
+            {
+                Node child;
+                child.bounding_box = node.childBox( c, box );
+                if ( !pred( &child ) )
+                    continue;
+                int const index = node.children[c];
+                if ( index < 0 )
+                {
+                    leaf.bounding_box = _leaf_boxes( -1 - index );
+                    if ( pred( &leaf ) )
+                    {
+                        insert( _leaf_indices( -1 - index ) );
+                        ++count;
+                    }
+                }
+                else
+                {
+                    stack.emplace( index, child.bounding_box );
+                }
+            }
+        }
+        return count;
+    }
+
+    // See stackTraversalQuery().  The distances to the quantized boxes are
+    // only used to prune the hierarchy.  The objects are reported with their
+    // distance to their exact box.
+    KOKKOS_FUNCTION int nearestQuery( Point const &point, int k,
+                                      double max_distance_squared,
+                                      Kokkos::pair<int, double> *buffer ) const
+    {
+        NearestHeap heap(
+            UnmanagedStaticVector<Kokkos::pair<int, double>>( buffer, k ) );
+        double radius = max_distance_squared;
+        if ( _nodes.extent( 0 ) == 0 )
+        {
+            double const distance = distanceSquared( point, _leaf_boxes( 0 ) );
+            if ( distance < radius )
+                insertNearest( heap, radius, k, _leaf_indices( 0 ), distance );
+            return sortNearest( heap );
+        }
+
+        Stack<QuantizedTraversalEntry> stack;
+        stack.push( {0, 0., _bounds} );
+        while ( !stack.empty() )
+        {
+            QuantizedTraversalEntry const entry = stack.top();
+            stack.pop();
+            if ( !( entry.distance < radius ) )
+                continue;
+
+            QuantizedNode<T> const &node = _nodes( entry.node );
+            QuantizedTraversalEntry children[2];
+            int n_internal = 0;
+            for ( int c = 0; c < 2; ++c )
+            {
+                Box const child_box = node.childBox( c, entry.box );
+                double const distance = distanceSquared( point, child_box );
+                if ( !( distance < radius ) )
+                    continue;
+                int const index = node.children[c];
+                if ( index < 0 )
+                {
+                    double const leaf_distance =
+                        distanceSquared( point, _leaf_boxes( -1 - index ) );
+                    if ( leaf_distance < radius )
+                        insertNearest( heap, radius, k,
+                                       _leaf_indices( -1 - index ),
+                                       leaf_distance );
+                }
+                else
+                {
+                    children[n_internal++] = {index, distance, child_box};
+                }
+            }
+            // Make sure that the closest child ends on top of the stack.
+            if ( n_internal == 2 &&
+                 children[0].distance < children[1].distance )
+            {
+                stack.push( children[1] );
+                stack.push( children[0] );
+            }
+            else
+            {
+                for ( int j = 0; j < n_internal; ++j )
+                    stack.push( children[j] );
+            }
+        }
+        return sortNearest( heap );
+    }
+
+    Kokkos::View<QuantizedNode<T> const *, DeviceType> _nodes;
+    Kokkos::View<Box const *, DeviceType> _leaf_boxes;
+    Kokkos::View<int const *, DeviceType> _leaf_indices;
+    Box _bounds;
+};
+} // namespace Details
+
+/** Hierarchy with the same topology as a BoundingVolumeHierarchy whose
+ *  internal nodes store the boxes of their two children with 8- or 16-bit
+ *  coordinates relative to their own box.  A node then takes 20 or 32 bytes
+ *  instead of the 60 bytes of a node with double precision boxes, which
+ *  relieves the traversal when it is bound by the bandwidth to load them.
+ *  The boxes are decoded on the fly during the traversal, which keeps the
+ *  box of the current node on an explicit stack.
+ *
+ *  The quantized boxes enclose the exact ones, so that no object is ever
+ *  missed.  The exact boxes of the leaves are kept aside and only loaded for
+ *  the candidates that satisfy the predicate against their quantized box, so
+ *  that the results are the same as those of the binary hierarchy.
+ */
+template <typename DeviceType, typename QuantizedType = std::uint16_t>
+class QuantizedBVH
+{
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+
+    QuantizedBVH() = default; // build an empty tree
+    QuantizedBVH( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+    QuantizedBVH( BVH<DeviceType> const &bvh );
+
+    /** Same as BoundingVolumeHierarchy::query() with views of results.  The
+     *  spatial predicates may not be modified by FirstHit or CountOnly, and
+     *  the objects intersected by rays or segments are reported in no
+     *  particular order.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances ) const;
+
+    Box bounds() const { return _bounds; }
+
+    SizeType size() const { return _leaf_indices.extent( 0 ); }
+
+    bool empty() const { return size() == 0; }
+
+  private:
+    using Node = Details::QuantizedNode<QuantizedType>;
+    using Traversal =
+        Details::QuantizedTreeTraversal<DeviceType, QuantizedType>;
+
+    Traversal traversal() const
+    {
+        return {_internal_nodes, _leaf_boxes, _leaf_indices, _bounds};
+    }
+
+    Kokkos::View<Node *, DeviceType> _internal_nodes;
+    // Exact boxes and indices of the objects in the order of the leaves.
+    Kokkos::View<Box *, DeviceType> _leaf_boxes;
+    Kokkos::View<int *, DeviceType> _leaf_indices;
+    Box _bounds;
+};
+
+template <typename DeviceType, typename QuantizedType>
+QuantizedBVH<DeviceType, QuantizedType>::QuantizedBVH(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+    : QuantizedBVH( BVH<DeviceType>( bounding_boxes ) )
+{
+}
+
+template <typename DeviceType, typename QuantizedType>
+QuantizedBVH<DeviceType, QuantizedType>::QuantizedBVH(
+    BVH<DeviceType> const &bvh )
+    : _internal_nodes( Kokkos::ViewAllocateWithoutInitializing(
+                           "quantized_internal_nodes" ),
+                       bvh.size() > 1 ? bvh.size() - 1 : 0 )
+    , _leaf_boxes( Kokkos::ViewAllocateWithoutInitializing( "leaf_boxes" ),
+                   bvh.size() )
+    , _leaf_indices( Kokkos::ViewAllocateWithoutInitializing( "leaf_indices" ),
+                     bvh.size() )
+    , _bounds( bvh.bounds() )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using BinaryTraversal = Details::TreeTraversal<DeviceType>;
+    int const n = bvh.size();
+    if ( n == 0 )
+        return;
+
+    auto leaf_boxes = _leaf_boxes;
+    auto leaf_indices = _leaf_indices;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "quantized_bvh:copy_leaves" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        KOKKOS_LAMBDA( int i ) {
+            auto const leaf = BinaryTraversal::getRoot( bvh ) + ( n - 1 ) + i;
+            leaf_boxes( i ) = leaf->bounding_box;
+            leaf_indices( i ) = BinaryTraversal::getIndex( leaf );
+        } );
+    Kokkos::fence();
+    if ( n == 1 )
+        return;
+
+    Kokkos::View<::DataTransferKit::Node const *, DeviceType> binary_nodes(
+        BinaryTraversal::getRoot( bvh ), 2 * n - 1 );
+    Kokkos::View<int *, DeviceType> parents(
+        Kokkos::ViewAllocateWithoutInitializing( "parents" ), 2 * n - 1 );
+    Details::TreeConstruction<DeviceType>::computeParents( binary_nodes,
+                                                           parents );
+
+    // The box of every internal node is decoded the same way as during the
+    // traversal, from the root down to the node, before the boxes of its
+    // children are quantized relative to it.
+    // The traversal stack holds at most one node per level on top of the
+    // current one and has the default capacity of 64.
+    int constexpr max_depth = 64;
+    auto internal_nodes = _internal_nodes;
+    Box const bounds = _bounds;
+    int depth = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "quantized_bvh:quantize_boxes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n - 1 ),
+        KOKKOS_LAMBDA( int i, int &max_depth_found ) {
+            int path[max_depth];
+            int length = 0;
+            for ( int node = i; node != 0 && length < max_depth;
+                  node = parents( node ) )
+                path[length++] = node;
+            if ( length > max_depth_found )
+                max_depth_found = length;
+
+            Box box = bounds;
+            for ( int j = length - 1; j >= 0; --j )
+            {
+                Node node;
+                node.setChildBox( 0, binary_nodes( path[j] ).bounding_box,
+                                  box );
+                box = node.childBox( 0, box );
+            }
+
+            Node &node = internal_nodes( i );
+            auto const children = binary_nodes( i ).children;
+            int const c[2] = {children.first, children.second};
+            for ( int j = 0; j < 2; ++j )
+            {
+                node.setChildBox( j, binary_nodes( c[j] ).bounding_box, box );
+                node.children[j] =
+                    ( c[j] < n - 1 ) ? c[j] : -1 - ( c[j] - n + 1 );
+            }
+        },
+        Kokkos::Experimental::Max<int>( depth ) );
+    DTK_INSIST( depth + 1 < max_depth );
+}
+
+template <typename DeviceType, typename QuantizedType>
+template <typename Query>
+void QuantizedBVH<DeviceType, QuantizedType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    Details::stackTraversalQuery( traversal(), bounds(), size(), queries,
+                                  indices, offset );
+}
+
+template <typename DeviceType, typename QuantizedType>
+template <typename Query>
+void QuantizedBVH<DeviceType, QuantizedType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    Details::stackTraversalQuery( traversal(), bounds(), size(), queries,
+                                  indices, offset, distances );
+}
+
+} // namespace DataTransferKit
+
+#endif
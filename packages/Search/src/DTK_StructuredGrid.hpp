@@ -0,0 +1,390 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_STRUCTURED_GRID_HPP
+#define DTK_STRUCTURED_GRID_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsNode.hpp>
+#include <DTK_DetailsUtils.hpp> // exclusivePrefixSum, lastElement, etc.
+#include <DTK_Predicates.hpp>
+
+#include <Kokkos_Array.hpp>
+#include <Kokkos_View.hpp>
+
+#include <algorithm> // sort, unique, lower_bound
+#include <cmath>     // floor
+#include <type_traits>
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/** Edges of a grid along one axis.  The cells that overlap an interval are
+ * found with a binary search over the edges or, when the spacing is uniform,
+ * by guessing their position and correcting the guess against the actual
+ * edges so that rounding never changes the result.
+ */
+template <typename DeviceType>
+struct StructuredGridAxis
+{
+    KOKKOS_INLINE_FUNCTION int size() const
+    {
+        return edges.extent_int( 0 ) > 0 ? edges.extent_int( 0 ) - 1 : 0;
+    }
+
+    // Guess the position of x among the cells assuming uniform spacing,
+    // clamped to [0, size()].
+    KOKKOS_INLINE_FUNCTION int guess( double x ) const
+    {
+        int const n = size();
+        double const position = std::floor( ( x - origin ) * inv_spacing );
+        if ( !( position > 0. ) )
+            return 0;
+        if ( position >= n )
+            return n;
+        return static_cast<int>( position );
+    }
+
+    // First cell whose upper edge is no less than x, or size() if none.
+    KOKKOS_INLINE_FUNCTION int firstCell( double x ) const
+    {
+        int const n = size();
+        if ( uniform )
+        {
+            int i = guess( x );
+            while ( i > 0 && edges( i ) >= x )
+                --i;
+            while ( i < n && edges( i + 1 ) < x )
+                ++i;
+            return i;
+        }
+        int first = 0;
+        int last = n;
+        while ( first < last )
+        {
+            int const middle = ( first + last ) / 2;
+            if ( edges( middle + 1 ) < x )
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first;
+    }
+
+    // One past the last cell whose lower edge is no greater than x.
+    KOKKOS_INLINE_FUNCTION int lastCell( double x ) const
+    {
+        int const n = size();
+        if ( uniform )
+        {
+            int i = guess( x );
+            while ( i > 0 && edges( i - 1 ) > x )
+                --i;
+            while ( i < n && edges( i ) <= x )
+                ++i;
+            return i;
+        }
+        int first = 0;
+        int last = n;
+        while ( first < last )
+        {
+            int const middle = ( first + last ) / 2;
+            if ( edges( middle ) <= x )
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first;
+    }
+
+    Kokkos::View<double const *, DeviceType> edges;
+    double origin = 0.;
+    double inv_spacing = 0.;
+    bool uniform = false;
+};
+
+// Cells of the grid as seen from the kernels.  Cell (i, j, k) is stored at
+// position i + n_i * (j + n_j * k).
+template <typename DeviceType>
+struct StructuredGridCells
+{
+    KOKKOS_INLINE_FUNCTION int size() const
+    {
+        return axes[0].size() * axes[1].size() * axes[2].size();
+    }
+
+    KOKKOS_INLINE_FUNCTION Box cellBox( int i, int j, int k ) const
+    {
+        return {{{axes[0].edges( i ), axes[1].edges( j ), axes[2].edges( k )}},
+                {{axes[0].edges( i + 1 ), axes[1].edges( j + 1 ),
+                  axes[2].edges( k + 1 )}}};
+    }
+
+    KOKKOS_INLINE_FUNCTION int index( int position ) const
+    {
+        return indices.extent( 0 ) > 0 ? indices( position ) : position;
+    }
+
+    // Count the cells that satisfy the predicate and, unless out is null,
+    // write their indices there.
+    template <typename Query>
+    KOKKOS_INLINE_FUNCTION int search( Query const &query, int *out ) const
+    {
+        bool const first_hit = StopsAtFirstHit<Query>::value;
+        Box range;
+        expand( range, query._geometry );
+        int first[3];
+        int last[3];
+        for ( int d = 0; d < 3; ++d )
+        {
+            first[d] = axes[d].firstCell( range.minCorner()[d] );
+            last[d] = axes[d].lastCell( range.maxCorner()[d] );
+        }
+        int const n_i = axes[0].size();
+        int const n_j = axes[1].size();
+        int count = 0;
+        Node cell;
+        for ( int k = first[2]; k < last[2]; ++k )
+            for ( int j = first[1]; j < last[1]; ++j )
+                for ( int i = first[0]; i < last[0]; ++i )
+                {
+                    cell.bounding_box = cellBox( i, j, k );
+                    if ( !query( &cell ) )
+                        continue;
+                    if ( out != nullptr )
+                        out[count] = index( i + n_i * ( j + n_j * k ) );
+                    ++count;
+                    if ( first_hit )
+                        return count;
+                }
+        return count;
+    }
+
+    Kokkos::Array<StructuredGridAxis<DeviceType>, 3> axes;
+    Kokkos::View<int const *, DeviceType> indices;
+};
+} // namespace Details
+
+/** \brief Search structure over the cells of a rectilinear grid
+ *
+ *  The cells are the products of the intervals between consecutive edges
+ *  along each axis and are numbered with the first index running fastest.
+ *  Spatial queries return the same objects as
+ *  BoundingVolumeHierarchy::query() would on the boxes of the cells but the
+ *  cells that may satisfy a predicate are located directly from its bounding
+ *  box, with a binary search along each axis, or in constant time along the
+ *  axes with a uniform spacing.  There is no hierarchy to build or to
+ *  traverse.  Nearest queries are not supported.
+ */
+template <typename DeviceType>
+class StructuredGrid
+{
+  public:
+    using SizeType = typename Kokkos::View<int *, DeviceType>::size_type;
+
+    StructuredGrid() = default;
+
+    /** The edges must be sorted in increasing order along each axis.  Object
+     *  \c indices(c) is the cell at position \c c, or \c c itself if no
+     *  indices are given.
+     */
+    StructuredGrid( Kokkos::View<double const *, DeviceType> x_edges,
+                    Kokkos::View<double const *, DeviceType> y_edges,
+                    Kokkos::View<double const *, DeviceType> z_edges,
+                    Kokkos::View<int const *, DeviceType> indices =
+                        Kokkos::View<int const *, DeviceType>() );
+
+    /** Recognize boxes that tile a rectilinear grid, i.e. that are exactly
+     *  the cells of some grid, in any order.  An empty grid is returned
+     *  otherwise.
+     */
+    static StructuredGrid
+    fromBoxes( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+
+    SizeType size() const { return _cells.size(); }
+
+    bool empty() const { return size() == 0; }
+
+    Box bounds() const { return _bounds; }
+
+    /** Same as BoundingVolumeHierarchy::query() for spatial predicates. */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+  private:
+    Details::StructuredGridCells<DeviceType> _cells;
+    Box _bounds;
+};
+
+template <typename DeviceType>
+StructuredGrid<DeviceType>::StructuredGrid(
+    Kokkos::View<double const *, DeviceType> x_edges,
+    Kokkos::View<double const *, DeviceType> y_edges,
+    Kokkos::View<double const *, DeviceType> z_edges,
+    Kokkos::View<int const *, DeviceType> indices )
+{
+    Kokkos::View<double const *, DeviceType> const edges[3] = {
+        x_edges, y_edges, z_edges};
+    for ( int d = 0; d < 3; ++d )
+    {
+        auto &axis = _cells.axes[d];
+        axis.edges = edges[d];
+        int const n = axis.size();
+        if ( n == 0 )
+            continue;
+        auto edges_host = Kokkos::create_mirror_view( edges[d] );
+        Kokkos::deep_copy( edges_host, edges[d] );
+        double const origin = edges_host( 0 );
+        double const spacing = ( edges_host( n ) - origin ) / n;
+        // The guess is corrected against the actual edges so any spacing
+        // that puts it within a cell or so of the right one will do.
+        bool uniform = ( spacing > 0. );
+        for ( int i = 0; i <= n && uniform; ++i )
+        {
+            double const deviation = edges_host( i ) - ( origin + i * spacing );
+            uniform = ( deviation < 0.25 * spacing &&
+                        deviation > -0.25 * spacing );
+        }
+        axis.origin = origin;
+        axis.inv_spacing = uniform ? 1. / spacing : 0.;
+        axis.uniform = uniform;
+        _bounds.minCorner()[d] = origin;
+        _bounds.maxCorner()[d] = edges_host( n );
+    }
+    if ( size() == 0 )
+        _bounds = Box();
+    DTK_REQUIRE( indices.extent( 0 ) == 0 || indices.extent( 0 ) == size() );
+    _cells.indices = indices;
+}
+
+template <typename DeviceType>
+StructuredGrid<DeviceType> StructuredGrid<DeviceType>::fromBoxes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+{
+    int const n = bounding_boxes.extent( 0 );
+    if ( n == 0 )
+        return StructuredGrid();
+    auto boxes = Kokkos::create_mirror_view( bounding_boxes );
+    Kokkos::deep_copy( boxes, bounding_boxes );
+
+    // The edges along each axis are the distinct corner coordinates.
+    std::vector<double> edges[3];
+    int n_cells = 1;
+    for ( int d = 0; d < 3; ++d )
+    {
+        for ( int b = 0; b < n; ++b )
+        {
+            edges[d].push_back( boxes( b ).minCorner()[d] );
+            edges[d].push_back( boxes( b ).maxCorner()[d] );
+        }
+        std::sort( edges[d].begin(), edges[d].end() );
+        edges[d].erase( std::unique( edges[d].begin(), edges[d].end() ),
+                        edges[d].end() );
+        n_cells *= static_cast<int>( edges[d].size() ) - 1;
+        if ( n_cells > n )
+            return StructuredGrid();
+    }
+    if ( n_cells != n )
+        return StructuredGrid();
+
+    // Each box must span exactly one interval along each axis and occupy a
+    // cell of its own.
+    int const n_i = edges[0].size() - 1;
+    int const n_j = edges[1].size() - 1;
+    Kokkos::View<int *, DeviceType> indices(
+        Kokkos::ViewAllocateWithoutInitializing( "indices" ), n );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, -1 );
+    for ( int b = 0; b < n; ++b )
+    {
+        int cell[3];
+        for ( int d = 0; d < 3; ++d )
+        {
+            double const lower = boxes( b ).minCorner()[d];
+            cell[d] = std::lower_bound( edges[d].begin(), edges[d].end(),
+                                        lower ) -
+                      edges[d].begin();
+            if ( cell[d] + 1 >= static_cast<int>( edges[d].size() ) ||
+                 edges[d][cell[d] + 1] != boxes( b ).maxCorner()[d] )
+                return StructuredGrid();
+        }
+        int const position = cell[0] + n_i * ( cell[1] + n_j * cell[2] );
+        if ( indices_host( position ) != -1 )
+            return StructuredGrid();
+        indices_host( position ) = b;
+    }
+    Kokkos::deep_copy( indices, indices_host );
+
+    Kokkos::View<double *, DeviceType> edges_views[3];
+    for ( int d = 0; d < 3; ++d )
+    {
+        int const n_edges = edges[d].size();
+        edges_views[d] = Kokkos::View<double *, DeviceType>(
+            Kokkos::ViewAllocateWithoutInitializing( "edges" ), n_edges );
+        auto edges_host = Kokkos::create_mirror_view( edges_views[d] );
+        for ( int i = 0; i < n_edges; ++i )
+            edges_host( i ) = edges[d][i];
+        Kokkos::deep_copy( edges_views[d], edges_host );
+    }
+    return StructuredGrid( edges_views[0], edges_views[1], edges_views[2],
+                           indices );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void StructuredGrid<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "StructuredGrid only supports spatial predicates" );
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    auto const cells = _cells;
+    int const n_queries = queries.extent( 0 );
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "structured_grid_count" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              offset( q ) =
+                                  cells.search( queries( q ), nullptr );
+                          } );
+    Kokkos::fence();
+    int const n_results = exclusivePrefixSum( offset );
+
+    if ( !Details::ReportsResults<Query>::value )
+    {
+        Kokkos::realloc( indices, 0 );
+        return;
+    }
+    reallocWithoutInitializing( indices, n_results );
+    Kokkos::parallel_for( DTK_MARK_REGION( "structured_grid_fill" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              cells.search( queries( q ),
+                                            indices.data() + offset( q ) );
+                          } );
+    Kokkos::fence();
+}
+
+} // namespace DataTransferKit
+
+#endif
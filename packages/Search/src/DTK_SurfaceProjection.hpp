@@ -0,0 +1,137 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_SURFACE_PROJECTION_HPP
+#define DTK_SURFACE_PROJECTION_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DetailsAlgorithms.hpp> // closestPoint, distance, expand
+#include <DTK_LinearBVH.hpp>
+#include <DTK_Point.hpp>
+#include <DTK_Triangle.hpp>
+
+#include <Kokkos_View.hpp>
+
+namespace DataTransferKit
+{
+
+/** Distance from a point to the triangles of a surface mesh, to be passed to
+ *  BoundingVolumeHierarchy::queryNearestPrimitive().
+ */
+template <typename DeviceType>
+struct TriangleDistance
+{
+    KOKKOS_INLINE_FUNCTION double operator()( Point const &point,
+                                              int index ) const
+    {
+        return Details::distance( point, _triangles( index ) );
+    }
+
+    Kokkos::View<Triangle const *, DeviceType> _triangles;
+};
+
+namespace Details
+{
+template <typename DeviceType>
+Kokkos::View<Box *, DeviceType>
+computeBoundingBoxes( Kokkos::View<Triangle const *, DeviceType> triangles )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    int const n_triangles = triangles.extent( 0 );
+    Kokkos::View<Box *, DeviceType> bounding_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "bounding_boxes" ),
+        n_triangles );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_bounding_boxes_of_the_triangles" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_triangles ),
+        KOKKOS_LAMBDA( int i ) {
+            Box box;
+            expand( box, triangles( i ) );
+            bounding_boxes( i ) = box;
+        } );
+    Kokkos::fence();
+    return bounding_boxes;
+}
+} // namespace Details
+
+/** Closest point projection of points onto a surface mesh made of
+ *  triangles.  The hierarchy of the bounding boxes of the triangles is built
+ *  once and the exact distance to the triangles is only computed for the
+ *  ones that the boxes do not rule out.  Quadrilateral faces are split into
+ *  two triangles.
+ */
+template <typename DeviceType>
+class SurfaceProjection
+{
+  public:
+    /** The view of triangles is kept and must not be modified while the
+     *  object is in use.
+     */
+    SurfaceProjection( Kokkos::View<Triangle const *, DeviceType> triangles )
+        : _triangles( triangles )
+        , _bvh( Details::computeBoundingBoxes( triangles ) )
+    {
+    }
+
+    /** Project each point onto the closest triangle.
+     *
+     *  @param triangle_indices Index of the triangle closest to the ith
+     *  point, or -1 if there is no triangle.
+     *  @param projections Closest point to the ith point on that triangle.
+     *  @param barycentric_coordinates Barycentric coordinates of the
+     *  projection with respect to the vertices a, b and c of the triangle.
+     */
+    void project(
+        Kokkos::View<Point const *, DeviceType> points,
+        Kokkos::View<int *, DeviceType> &triangle_indices,
+        Kokkos::View<Point *, DeviceType> &projections,
+        Kokkos::View<double * [3], DeviceType> &barycentric_coordinates ) const
+    {
+        using ExecutionSpace = typename DeviceType::execution_space;
+
+        auto const triangles = _triangles;
+        Kokkos::View<double *, DeviceType> distances( "distances" );
+        _bvh.queryNearestPrimitive(
+            points, TriangleDistance<DeviceType>{triangles}, triangle_indices,
+            distances );
+
+        int const n_points = points.extent( 0 );
+        reallocWithoutInitializing( projections, n_points );
+        reallocWithoutInitializing( barycentric_coordinates, n_points );
+        auto const indices = triangle_indices;
+        auto const projected = projections;
+        auto const coordinates = barycentric_coordinates;
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "project_onto_the_triangles" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_points ),
+            KOKKOS_LAMBDA( int i ) {
+                double barycentric[3] = {0., 0., 0.};
+                Point projection = points( i );
+                if ( indices( i ) != -1 )
+                    projection = Details::closestPoint(
+                        points( i ), triangles( indices( i ) ), barycentric );
+                projected( i ) = projection;
+                for ( int j = 0; j < 3; ++j )
+                    coordinates( i, j ) = barycentric[j];
+            } );
+        Kokkos::fence();
+    }
+
+  private:
+    Kokkos::View<Triangle const *, DeviceType> _triangles;
+    BoundingVolumeHierarchy<DeviceType> _bvh;
+};
+
+} // namespace DataTransferKit
+
+#endif
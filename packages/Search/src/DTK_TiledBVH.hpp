@@ -0,0 +1,439 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_TILED_BVH_HPP
+#define DTK_TILED_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsTreeConstruction.hpp> // calculateBoundingBoxOfTheScene
+#include <DTK_DetailsUtils.hpp>            // exclusivePrefixSum, firstTouch
+#include <DTK_LinearBVH.hpp>
+#include <DTK_Predicates.hpp>
+
+#include <Kokkos_View.hpp>
+
+#include <algorithm> // min
+#include <type_traits>
+#include <utility> // swap
+#include <vector>
+
+namespace DataTransferKit
+{
+
+/** Hierarchy over objects that are too many to fit in the memory of the
+ *  device at once.  The bounding boxes stay in host memory, possibly an
+ *  unmanaged view of a mapped file, and are cut into tiles of consecutive
+ *  objects.  Only a top-level tree over the bounds of the tiles is kept on
+ *  the device.  Each batch of queries streams the tiles that it may find
+ *  objects in: their boxes are copied to the device, a hierarchy is built
+ *  over them and queried, and both are released before the next tile.
+ *  Streaming the boxes moves less than half the data that streaming the
+ *  nodes of prebuilt hierarchies would, and the construction on the device
+ *  is cheap compared to the copy.
+ *
+ *  The device holds at most the objects of one tile next to the queries and
+ *  their results.  The results are the same as those of a hierarchy over
+ *  all the objects, with indices into the whole array of boxes.  The tiles
+ *  work best when they group nearby objects, e.g. when the objects are the
+ *  cells of a mesh numbered with some locality.
+ */
+template <typename DeviceType>
+class TiledBVH
+{
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+    using HostBoxes = Kokkos::View<Box const *, Kokkos::HostSpace>;
+
+    TiledBVH() = default; // build an empty tree
+    TiledBVH( HostBoxes bounding_boxes, int tile_size );
+
+    /** Same as BoundingVolumeHierarchy::query() with views of results.  The
+     *  spatial predicates may not be modified by FirstHit or CountOnly.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances ) const;
+
+    Box bounds() const { return _top_tree.bounds(); }
+
+    SizeType size() const { return _bounding_boxes.extent( 0 ); }
+
+    bool empty() const { return size() == 0; }
+
+    int numberOfTiles() const { return _tile_bounds.size(); }
+
+    // Hierarchy over the objects of the ith tile, built on the device.  The
+    // indices it reports start from zero at the first object of the tile.
+    BVH<DeviceType> buildTile( int i ) const;
+
+    // Index of the first object of the ith tile.
+    int firstObjectOfTile( int i ) const { return i * _tile_size; }
+
+  private:
+    HostBoxes _bounding_boxes;
+    int _tile_size = 0;
+    std::vector<Box> _tile_bounds;
+    BVH<DeviceType> _top_tree;
+};
+
+template <typename DeviceType>
+TiledBVH<DeviceType>::TiledBVH( HostBoxes bounding_boxes, int tile_size )
+    : _bounding_boxes( bounding_boxes )
+    , _tile_size( tile_size )
+{
+    DTK_REQUIRE( tile_size > 0 );
+    using HostDeviceType =
+        Kokkos::Device<Kokkos::DefaultHostExecutionSpace, Kokkos::HostSpace>;
+
+    int const n = bounding_boxes.extent( 0 );
+    int const n_tiles = ( n + tile_size - 1 ) / tile_size;
+    _tile_bounds.resize( n_tiles );
+    for ( int i = 0; i < n_tiles; ++i )
+    {
+        int const begin = firstObjectOfTile( i );
+        int const end = std::min( n, firstObjectOfTile( i + 1 ) );
+        Details::TreeConstruction<HostDeviceType>::
+            calculateBoundingBoxOfTheScene(
+                Kokkos::subview( bounding_boxes,
+                                 Kokkos::make_pair( begin, end ) ),
+                _tile_bounds[i] );
+    }
+
+    Kokkos::View<Box *, DeviceType> tile_bounds(
+        Kokkos::ViewAllocateWithoutInitializing( "tile_bounds" ), n_tiles );
+    auto tile_bounds_host = Kokkos::create_mirror_view( tile_bounds );
+    for ( int i = 0; i < n_tiles; ++i )
+        tile_bounds_host( i ) = _tile_bounds[i];
+    Kokkos::deep_copy( tile_bounds, tile_bounds_host );
+    _top_tree = BVH<DeviceType>( tile_bounds );
+}
+
+template <typename DeviceType>
+BVH<DeviceType> TiledBVH<DeviceType>::buildTile( int i ) const
+{
+    DTK_REQUIRE( i >= 0 && i < numberOfTiles() );
+    int const begin = firstObjectOfTile( i );
+    int const end = std::min<int>( size(), firstObjectOfTile( i + 1 ) );
+    Kokkos::View<Box *, DeviceType> boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "tile_boxes" ), end - begin );
+    Details::firstTouch( boxes );
+    Kokkos::deep_copy(
+        boxes,
+        Kokkos::subview( _bounding_boxes, Kokkos::make_pair( begin, end ) ) );
+    return BVH<DeviceType>( boxes );
+}
+
+namespace Details
+{
+// Whether the tiles satisfy any of the spatial queries, found with the
+// top-level tree.
+template <typename DeviceType, typename Query>
+std::vector<int>
+findTouchedTiles( BVH<DeviceType> const &top_tree,
+                  QueryOrdering<DeviceType, Query> const &ordering )
+{
+    Kokkos::View<int *, DeviceType> touched( "touched_tiles",
+                                             top_tree.size() );
+    top_tree.query( ordering,
+                    KOKKOS_LAMBDA( int, int tile ) { touched( tile ) = 1; } );
+    auto touched_host = Kokkos::create_mirror_view( touched );
+    Kokkos::deep_copy( touched_host, touched );
+    return std::vector<int>( touched_host.data(),
+                             touched_host.data() + touched_host.extent( 0 ) );
+}
+
+// Add to the count of each query the number of objects it found in a tile.
+template <typename DeviceType>
+void addCounts( Kokkos::View<int const *, DeviceType> tile_offset,
+                Kokkos::View<int *, DeviceType> counts )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "add_counts_of_tile" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, tile_offset.extent( 0 ) - 1 ),
+        KOKKOS_LAMBDA( int q ) {
+            counts( q ) += tile_offset( q + 1 ) - tile_offset( q );
+        } );
+    Kokkos::fence();
+}
+
+// Append the objects found in a tile after those of the previous tiles,
+// cursor( q ) being the position of the next result of the qth query.
+template <typename DeviceType>
+void appendResults( int first_object,
+                    Kokkos::View<int const *, DeviceType> tile_indices,
+                    Kokkos::View<int const *, DeviceType> tile_offset,
+                    Kokkos::View<int *, DeviceType> cursor,
+                    Kokkos::View<int *, DeviceType> indices )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "append_results_of_tile" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, cursor.extent( 0 ) ),
+        KOKKOS_LAMBDA( int q ) {
+            for ( int j = tile_offset( q ); j < tile_offset( q + 1 ); ++j )
+                indices( cursor( q )++ ) = first_object + tile_indices( j );
+        } );
+    Kokkos::fence();
+}
+
+// Restrict the sorted queries to the neighbors closer than the kth one found
+// so far, if any, and tell whether any of them may find one in the box.
+template <typename DeviceType, typename Query>
+bool limitNearestQueries( QueryOrdering<DeviceType, Query> const &ordering,
+                          Kokkos::View<int const *, DeviceType> best_offset,
+                          Kokkos::View<int const *, DeviceType> counts,
+                          Kokkos::View<double const *, DeviceType> distances,
+                          Box const &box,
+                          Kokkos::View<Query *, DeviceType> limited_queries )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const permute = ordering._permute;
+    auto const queries = ordering._queries;
+    int any = 0;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "limit_nearest_queries_to_closest_found" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i, int &partial_any ) {
+            int const q = permute( i );
+            int const capacity = best_offset( q + 1 ) - best_offset( q );
+            Query query = queries( i );
+            if ( counts( q ) == capacity )
+                query._max_distance =
+                    ( capacity > 0 ) ? distances( best_offset( q + 1 ) - 1 )
+                                     : 0.;
+            limited_queries( i ) = query;
+            if ( distance( query._geometry, box ) < query._max_distance )
+                partial_any = 1;
+        },
+        Kokkos::Experimental::Max<int>( any ) );
+    return any != 0;
+}
+
+// Merge the neighbors found in a tile, sorted by distance, with the nearest
+// ones found so far, keeping at most the capacity of each query.
+template <typename DeviceType>
+void mergeNearestResults(
+    int first_object, Kokkos::View<int const *, DeviceType> tile_indices,
+    Kokkos::View<int const *, DeviceType> tile_offset,
+    Kokkos::View<double const *, DeviceType> tile_distances,
+    Kokkos::View<int const *, DeviceType> best_offset,
+    Kokkos::View<int *, DeviceType> counts,
+    Kokkos::View<int const *, DeviceType> indices,
+    Kokkos::View<double const *, DeviceType> distances,
+    Kokkos::View<int *, DeviceType> merged_indices,
+    Kokkos::View<double *, DeviceType> merged_distances )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "merge_nearest_results_of_tile" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, counts.extent( 0 ) ),
+        KOKKOS_LAMBDA( int q ) {
+            int const begin = best_offset( q );
+            int const capacity = best_offset( q + 1 ) - begin;
+            int a = begin;
+            int const a_end = begin + counts( q );
+            int b = tile_offset( q );
+            int const b_end = tile_offset( q + 1 );
+            int m = 0;
+            for ( ; m < capacity && ( a < a_end || b < b_end ); ++m )
+            {
+                if ( b == b_end ||
+                     ( a < a_end && distances( a ) <= tile_distances( b ) ) )
+                {
+                    merged_indices( begin + m ) = indices( a );
+                    merged_distances( begin + m ) = distances( a++ );
+                }
+                else
+                {
+                    merged_indices( begin + m ) =
+                        first_object + tile_indices( b );
+                    merged_distances( begin + m ) = tile_distances( b++ );
+                }
+            }
+            counts( q ) = m;
+        } );
+    Kokkos::fence();
+}
+
+// Gather the results of each query into contiguous entries.
+template <typename DeviceType, typename T>
+void compactResults( Kokkos::View<int const *, DeviceType> best_offset,
+                     Kokkos::View<int const *, DeviceType> offset,
+                     Kokkos::View<T const *, DeviceType> best,
+                     Kokkos::View<T *, DeviceType> results )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compact_nearest_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, offset.extent( 0 ) - 1 ),
+        KOKKOS_LAMBDA( int q ) {
+            for ( int j = 0; j < offset( q + 1 ) - offset( q ); ++j )
+                results( offset( q ) + j ) = best( best_offset( q ) + j );
+        } );
+    Kokkos::fence();
+}
+
+// Number of neighbors kept for each query while the tiles are streamed.
+template <typename DeviceType, typename Query>
+void nearestCapacities( Kokkos::View<Query *, DeviceType> queries, int size,
+                        Kokkos::View<int *, DeviceType> capacities )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "nearest_capacities" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, queries.extent( 0 ) ),
+        KOKKOS_LAMBDA( int q ) {
+            capacities( q ) = ( queries( q )._k < size ) ? queries( q )._k
+                                                            : size;
+        } );
+    Kokkos::fence();
+}
+} // namespace Details
+
+template <typename DeviceType>
+template <typename Query>
+void TiledBVH<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "nearest predicates also report distances" );
+    static_assert( !Details::StopsAtFirstHit<Query>::value &&
+                       Details::ReportsResults<Query>::value,
+                   "the results of FirstHit or CountOnly may not be merged "
+                   "across tiles" );
+
+    int const n_queries = queries.extent( 0 );
+    Kokkos::View<int *, DeviceType> counts( offset.label(), n_queries + 1 );
+    reallocWithoutInitializing( indices, 0 );
+
+    // The queries are sorted once for all the tiles.
+    QueryOrdering<DeviceType, Query> const ordering( queries, bounds() );
+    std::vector<int> touched;
+    if ( !empty() )
+        touched = Details::findTouchedTiles( _top_tree, ordering );
+
+    // The results of each tile are gathered once all the tiles are done, so
+    // that the tiles are only streamed once.
+    std::vector<int> tiles;
+    std::vector<Kokkos::View<int *, DeviceType>> tile_indices;
+    std::vector<Kokkos::View<int *, DeviceType>> tile_offset;
+    for ( int i = 0; i < numberOfTiles(); ++i )
+    {
+        if ( !touched[i] )
+            continue;
+        tiles.push_back( i );
+        tile_indices.emplace_back( indices.label() );
+        tile_offset.emplace_back( offset.label() );
+        buildTile( i ).query( ordering, tile_indices.back(),
+                              tile_offset.back() );
+        Details::addCounts<DeviceType>( tile_offset.back(), counts );
+    }
+
+    int const n_indices = exclusivePrefixSum( counts );
+    offset = counts;
+    reallocWithoutInitializing( indices, n_indices );
+    Kokkos::View<int *, DeviceType> cursor(
+        Kokkos::ViewAllocateWithoutInitializing( "cursor" ), n_queries );
+    Kokkos::deep_copy( cursor, Kokkos::subview( offset, Kokkos::make_pair(
+                                                            0, n_queries ) ) );
+    for ( int t = 0; t < (int)tiles.size(); ++t )
+        Details::appendResults<DeviceType>( firstObjectOfTile( tiles[t] ),
+                                            tile_indices[t], tile_offset[t],
+                                            cursor, indices );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void TiledBVH<DeviceType>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::NearestPredicateTag>::value,
+                   "distances are only reported for nearest predicates" );
+
+    // The nearest neighbors found so far are kept sorted by distance, in
+    // room for as many of them as each query asks for.  The queries that
+    // found them all only look further for closer ones.
+    int const n_queries = queries.extent( 0 );
+    Kokkos::View<int *, DeviceType> best_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "best_offset" ),
+        n_queries + 1 );
+    Details::nearestCapacities( queries, size(), best_offset );
+    int const n_best = exclusivePrefixSum( best_offset );
+    Kokkos::View<int *, DeviceType> counts( "counts", n_queries );
+    Kokkos::View<int *, DeviceType> best_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "best_indices" ), n_best );
+    Kokkos::View<double *, DeviceType> best_distances(
+        Kokkos::ViewAllocateWithoutInitializing( "best_distances" ), n_best );
+    Kokkos::View<int *, DeviceType> merged_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "merged_indices" ), n_best );
+    Kokkos::View<double *, DeviceType> merged_distances(
+        Kokkos::ViewAllocateWithoutInitializing( "merged_distances" ),
+        n_best );
+
+    QueryOrdering<DeviceType, Query> const ordering( queries, bounds() );
+    Kokkos::View<Query *, DeviceType> limited_queries(
+        Kokkos::ViewAllocateWithoutInitializing( "limited_queries" ),
+        n_queries );
+    for ( int i = 0; i < numberOfTiles(); ++i )
+    {
+        if ( !Details::limitNearestQueries<DeviceType, Query>(
+                 ordering, best_offset, counts, best_distances,
+                 _tile_bounds[i], limited_queries ) )
+            continue;
+        Kokkos::View<int *, DeviceType> tile_indices( indices.label() );
+        Kokkos::View<int *, DeviceType> tile_offset( offset.label() );
+        Kokkos::View<double *, DeviceType> tile_distances( distances.label() );
+        buildTile( i ).query(
+            QueryOrdering<DeviceType, Query>( ordering._permute,
+                                              limited_queries ),
+            tile_indices, tile_offset, tile_distances );
+        Details::mergeNearestResults<DeviceType>(
+            firstObjectOfTile( i ), tile_indices, tile_offset, tile_distances,
+            best_offset, counts, best_indices, best_distances, merged_indices,
+            merged_distances );
+        std::swap( best_indices, merged_indices );
+        std::swap( best_distances, merged_distances );
+    }
+
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::deep_copy(
+        Kokkos::subview( offset, Kokkos::make_pair( 0, n_queries ) ), counts );
+    int const n_results = exclusivePrefixSum( offset );
+    reallocWithoutInitializing( indices, n_results );
+    reallocWithoutInitializing( distances, n_results );
+    Details::compactResults<DeviceType, int>( best_offset, offset,
+                                              best_indices, indices );
+    Details::compactResults<DeviceType, double>( best_offset, offset,
+                                                 best_distances, distances );
+}
+
+} // namespace DataTransferKit
+
+#endif
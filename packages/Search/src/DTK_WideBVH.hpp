@@ -0,0 +1,418 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_WIDE_BVH_HPP
+#define DTK_WIDE_BVH_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DBC.hpp>
+#include <DTK_DetailsAlgorithms.hpp>
+#include <DTK_DetailsContainers.hpp>
+#include <DTK_DetailsStack.hpp>
+#include <DTK_DetailsStackTraversal.hpp>
+#include <DTK_DetailsUtils.hpp> // firstTouch
+#include <DTK_LinearBVH.hpp>
+#include <DTK_Predicates.hpp>
+
+#include <Kokkos_ArithTraits.hpp>
+#include <Kokkos_Pair.hpp>
+#include <Kokkos_View.hpp>
+
+#include <algorithm> // max
+#include <type_traits>
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/** Node with up to Width children, whose bounding boxes are stored one array
+ *  per coordinate so that a query is tested against all of them at once.
+ *  Children are either other wide nodes, given by their position, or
+ *  objects, given by -1 - their index.  The unused slots have inverted boxes
+ *  that nothing intersects and that are infinitely far from any point.
+ */
+template <int Width>
+struct WideNode
+{
+    KOKKOS_INLINE_FUNCTION
+    Box childBox( int c ) const
+    {
+        Box box;
+        for ( int d = 0; d < 3; ++d )
+        {
+            box.minCorner()[d] = min_corner[d][c];
+            box.maxCorner()[d] = max_corner[d][c];
+        }
+        return box;
+    }
+
+    double min_corner[3][Width];
+    double max_corner[3][Width];
+    int children[Width];
+    int n_children;
+};
+
+// The wide hierarchy is traversed depth-first with an explicit stack, which
+// holds at most Width - 1 nodes per level on top of the current one.
+template <int Width>
+struct WideTraversalStackCapacity
+{
+    static int constexpr value = 64 * Width;
+};
+
+template <typename DeviceType, int Width>
+struct WideTreeTraversal
+{
+    Kokkos::View<WideNode<Width> const *, DeviceType> _nodes;
+
+    // Test the predicate against the boxes of all the children of the node.
+    template <typename Predicate>
+    KOKKOS_INLINE_FUNCTION static void
+    testChildren( Predicate const &pred, WideNode<Width> const &node,
+                  bool hits[Width] )
+    {
+        for ( int c = 0; c < Width; ++c )
+        {
+            Node child;
+            child.bounding_box = node.childBox( c );
+            hits[c] = pred( &child );
+        }
+    }
+
+    KOKKOS_INLINE_FUNCTION static void
+    testChildren( Intersects<Box> const &pred, WideNode<Width> const &node,
+                  bool hits[Width] )
+    {
+        Box const &box = pred._geometry;
+        for ( int c = 0; c < Width; ++c )
+            hits[c] = true;
+        for ( int d = 0; d < 3; ++d )
+            for ( int c = 0; c < Width; ++c )
+                hits[c] = hits[c] &&
+                          !( box.minCorner()[d] > node.max_corner[d][c] ||
+                             box.maxCorner()[d] < node.min_corner[d][c] );
+    }
+
+    // Same squared distance as distanceSquared( point, box ) for each child.
+    KOKKOS_INLINE_FUNCTION static void
+    childDistancesSquared( Point const &point, WideNode<Width> const &node,
+                           double distances[Width] )
+    {
+        using KokkosHelpers::max;
+        for ( int c = 0; c < Width; ++c )
+            distances[c] = 0.;
+        for ( int d = 0; d < 3; ++d )
+            for ( int c = 0; c < Width; ++c )
+            {
+                double const tmp =
+                    max( max( node.min_corner[d][c] - point[d], 0. ),
+                         point[d] - node.max_corner[d][c] );
+                distances[c] += tmp * tmp;
+            }
+    }
+
+    template <typename Predicate, typename Insert>
+    KOKKOS_FUNCTION int spatialQuery( Predicate const &pred,
+                                      Insert const &insert ) const
+    {
+        int count = 0;
+        Stack<int, StaticVector<int, WideTraversalStackCapacity<Width>::value>>
+            stack;
+        stack.push( 0 );
+        while ( !stack.empty() )
+        {
+            WideNode<Width> const &node = _nodes( stack.top() );
+            stack.pop();
+            bool hits[Width];
+            testChildren( pred, node, hits );
+            for ( int c = 0; c < node.n_children; ++c )
+            {
+                if ( !hits[c] )
+                    continue;
+                int const child = node.children[c];
+                if ( child < 0 )
+                {
+                    insert( -1 - child );
+                    ++count;
+                }
+                else
+                {
+                    stack.push( child );
+                }
+            }
+        }
+        return count;
+    }
+
+    // See stackTraversalQuery()
+    KOKKOS_FUNCTION int nearestQuery( Point const &point, int k,
+                                      double max_distance_squared,
+                                      Kokkos::pair<int, double> *buffer ) const
+    {
+        using PairIndexDistance = Kokkos::pair<int, double>;
+        NearestHeap heap(
+            UnmanagedStaticVector<PairIndexDistance>( buffer, k ) );
+        double radius = max_distance_squared;
+
+        Stack<PairIndexDistance,
+              StaticVector<PairIndexDistance,
+                           WideTraversalStackCapacity<Width>::value>>
+            stack;
+        stack.emplace( 0, 0. );
+        while ( !stack.empty() )
+        {
+            int const node_index = stack.top().first;
+            double const node_distance = stack.top().second;
+            stack.pop();
+            if ( !( node_distance < radius ) )
+                continue;
+
+            WideNode<Width> const &node = _nodes( node_index );
+            double distances[Width];
+            childDistancesSquared( point, node, distances );
+
+            // Insert the leaves right away and sort the internal children by
+            // decreasing distance so that the closest one ends on top of the
+            // stack.
+            int internal[Width];
+            int n_internal = 0;
+            for ( int c = 0; c < node.n_children; ++c )
+            {
+                if ( !( distances[c] < radius ) )
+                    continue;
+                int const child = node.children[c];
+                if ( child < 0 )
+                {
+                    insertNearest( heap, radius, k, -1 - child, distances[c] );
+                }
+                else
+                {
+                    int j = n_internal++;
+                    for ( ; j > 0 && distances[internal[j - 1]] < distances[c];
+                          --j )
+                        internal[j] = internal[j - 1];
+                    internal[j] = c;
+                }
+            }
+            for ( int j = 0; j < n_internal; ++j )
+                stack.emplace( node.children[internal[j]],
+                               distances[internal[j]] );
+        }
+        return sortNearest( heap );
+    }
+};
+} // namespace Details
+
+/** Hierarchy whose nodes have up to Width children, obtained by collapsing a
+ *  binary BoundingVolumeHierarchy.  Each internal node of the wide hierarchy
+ *  replaces the small binary subtree made of the Width largest descendants
+ *  of a binary node, and stores the boxes of its children in structure of
+ *  arrays layout.  A query is then tested against all the children of a node
+ *  in a single pass that the compiler can vectorize, and the tree is about
+ *  log2( Width ) times shallower, with as many fewer dependent loads.  This
+ *  pays off on CPUs with wide vector units.  On GPUs, the binary hierarchy
+ *  and its stackless traversal remain the better choice; see WideBVHOnHost.
+ *
+ *  The collapse is done on the host.  The results are the same as those of
+ *  the binary hierarchy.
+ */
+template <typename DeviceType, int Width = 8>
+class WideBVH
+{
+    static_assert( Width >= 2, "wide nodes have at least two children" );
+
+  public:
+    using SizeType = typename BVH<DeviceType>::SizeType;
+
+    WideBVH() = default; // build an empty tree
+    WideBVH( Kokkos::View<Box const *, DeviceType> bounding_boxes );
+    WideBVH( BVH<DeviceType> const &bvh );
+
+    /** Same as BoundingVolumeHierarchy::query() with views of results.  The
+     *  spatial predicates may not be modified by FirstHit or CountOnly, and
+     *  the objects intersected by rays or segments are reported in no
+     *  particular order.
+     */
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset ) const;
+
+    template <typename Query>
+    void query( Kokkos::View<Query *, DeviceType> queries,
+                Kokkos::View<int *, DeviceType> &indices,
+                Kokkos::View<int *, DeviceType> &offset,
+                Kokkos::View<double *, DeviceType> &distances ) const;
+
+    Box bounds() const { return _bounds; }
+
+    SizeType size() const { return _size; }
+
+    bool empty() const { return size() == 0; }
+
+    // Number of wide nodes, the root being at position 0.
+    int numberOfNodes() const { return _nodes.extent( 0 ); }
+
+  private:
+    using Traversal = Details::WideTreeTraversal<DeviceType, Width>;
+
+    Kokkos::View<Details::WideNode<Width> *, DeviceType> _nodes;
+    SizeType _size = 0;
+    Box _bounds;
+};
+
+/** Wide hierarchy when the queries are executed on the host and binary
+ *  hierarchy otherwise.  Both are constructed from the bounding boxes of the
+ *  objects and queried the same way.
+ */
+template <typename DeviceType>
+using WideBVHOnHost = typename std::conditional<
+    std::is_same<typename DeviceType::execution_space::memory_space,
+                 Kokkos::HostSpace>::value,
+    WideBVH<DeviceType>, BVH<DeviceType>>::type;
+
+template <typename DeviceType, int Width>
+WideBVH<DeviceType, Width>::WideBVH(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes )
+    : WideBVH( BVH<DeviceType>( bounding_boxes ) )
+{
+}
+
+template <typename DeviceType, int Width>
+WideBVH<DeviceType, Width>::WideBVH( BVH<DeviceType> const &bvh )
+    : _size( bvh.size() )
+    , _bounds( bvh.bounds() )
+{
+    if ( bvh.empty() )
+        return;
+
+    // The binary nodes are copied to the host, internal nodes first and then
+    // the leaves, the root being at position 0 even if it is a leaf.
+    int const n = bvh.size();
+    Kokkos::View<Node const *, DeviceType, Kokkos::MemoryUnmanaged>
+        binary_nodes( Details::TreeTraversal<DeviceType>::getRoot( bvh ),
+                      n > 1 ? 2 * n - 1 : 1 );
+    Kokkos::View<Node *, Kokkos::HostSpace> binary_nodes_host(
+        Kokkos::ViewAllocateWithoutInitializing( "binary_nodes" ),
+        binary_nodes.extent( 0 ) );
+    Kokkos::deep_copy( binary_nodes_host, binary_nodes );
+    auto const is_leaf = [&binary_nodes_host]( int i ) {
+        return binary_nodes_host( i ).children.first == -1;
+    };
+
+    // Every wide node replaces a binary node, whose descendant with the
+    // largest surface area is expanded until there are Width of them.  The
+    // wide nodes are numbered breadth-first.
+    double const infinity = KokkosHelpers::ArithTraits<double>::infinity();
+    std::vector<Details::WideNode<Width>> wide_nodes;
+    std::vector<int> binary_node_of_wide_node = {0};
+    std::vector<int> depth = {1};
+    int max_depth = 1;
+    for ( int w = 0; w < (int)binary_node_of_wide_node.size(); ++w )
+    {
+        std::vector<int> children = {binary_node_of_wide_node[w]};
+        while ( (int)children.size() < Width )
+        {
+            int largest = -1;
+            for ( int c = 0; c < (int)children.size(); ++c )
+                if ( !is_leaf( children[c] ) &&
+                     ( largest == -1 ||
+                       Details::surfaceArea(
+                           binary_nodes_host( children[c] ).bounding_box ) >
+                           Details::surfaceArea(
+                               binary_nodes_host( children[largest] )
+                                   .bounding_box ) ) )
+                    largest = c;
+            if ( largest == -1 )
+                break;
+            auto const expanded = binary_nodes_host( children[largest] );
+            children[largest] = expanded.children.first;
+            children.push_back( expanded.children.second );
+        }
+
+        Details::WideNode<Width> node;
+        node.n_children = children.size();
+        for ( int c = 0; c < Width; ++c )
+        {
+            node.children[c] = -1;
+            for ( int d = 0; d < 3; ++d )
+            {
+                node.min_corner[d][c] = infinity;
+                node.max_corner[d][c] = -infinity;
+            }
+        }
+        for ( int c = 0; c < node.n_children; ++c )
+        {
+            Node const &child = binary_nodes_host( children[c] );
+            for ( int d = 0; d < 3; ++d )
+            {
+                node.min_corner[d][c] = child.bounding_box.minCorner()[d];
+                node.max_corner[d][c] = child.bounding_box.maxCorner()[d];
+            }
+            if ( is_leaf( children[c] ) )
+            {
+                node.children[c] = -1 - child.children.second;
+            }
+            else
+            {
+                node.children[c] = binary_node_of_wide_node.size();
+                binary_node_of_wide_node.push_back( children[c] );
+                depth.push_back( depth[w] + 1 );
+                max_depth = std::max( max_depth, depth[w] + 1 );
+            }
+        }
+        wide_nodes.push_back( node );
+    }
+    DTK_INSIST( ( Width - 1 ) * max_depth + 1 <=
+                Details::WideTraversalStackCapacity<Width>::value );
+
+    _nodes = Kokkos::View<Details::WideNode<Width> *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( "wide_nodes" ),
+        wide_nodes.size() );
+    // The nodes are filled on the host, by a single thread.  When the mirror
+    // is the view itself, this keeps the pages of the nodes from all landing
+    // on the socket of that thread.
+    Details::firstTouch( _nodes );
+    auto nodes_host = Kokkos::create_mirror_view( _nodes );
+    for ( int w = 0; w < (int)wide_nodes.size(); ++w )
+        nodes_host( w ) = wide_nodes[w];
+    Kokkos::deep_copy( _nodes, nodes_host );
+}
+
+template <typename DeviceType, int Width>
+template <typename Query>
+void WideBVH<DeviceType, Width>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset ) const
+{
+    Details::stackTraversalQuery( Traversal{_nodes}, bounds(), size(),
+                                  queries, indices, offset );
+}
+
+template <typename DeviceType, int Width>
+template <typename Query>
+void WideBVH<DeviceType, Width>::query(
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<double *, DeviceType> &distances ) const
+{
+    Details::stackTraversalQuery( Traversal{_nodes}, bounds(), size(),
+                                  queries, indices, offset, distances );
+}
+
+} // namespace DataTransferKit
+
+#endif
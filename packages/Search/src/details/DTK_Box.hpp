@@ -65,6 +65,29 @@ struct Box
                           -Kokkos::ArithTraits<double>::max(),
                           -Kokkos::ArithTraits<double>::max()}};
 };
+
+namespace Details
+{
+/**
+ * Axis-aligned bounding box with single precision corners.  It is only meant
+ * to be stored in the nodes of a hierarchy.  It is always constructed from a
+ * double precision box by rounding its corners outward (see
+ * Details::roundOutward()) so that it encloses the original box and no
+ * object is missed when traversing the tree.
+ */
+struct FloatBox
+{
+    KOKKOS_INLINE_FUNCTION
+    FloatBox() = default;
+
+    float _min_corner[3] = {Kokkos::ArithTraits<float>::max(),
+                            Kokkos::ArithTraits<float>::max(),
+                            Kokkos::ArithTraits<float>::max()};
+    float _max_corner[3] = {-Kokkos::ArithTraits<float>::max(),
+                            -Kokkos::ArithTraits<float>::max(),
+                            -Kokkos::ArithTraits<float>::max()};
+};
+} // namespace Details
 } // namespace DataTransferKit
 
 #endif
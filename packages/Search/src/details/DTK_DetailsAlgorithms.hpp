@@ -12,12 +12,18 @@
 #define DTK_DETAILS_ALGORITHMS_HPP
 
 #include <DTK_Box.hpp>
-#include <DTK_KokkosHelpers.hpp> // isFinite, min, max
+#include <DTK_KokkosHelpers.hpp> // isFinite, min, max, roundDown, roundUp
+#include <DTK_Periodic.hpp>
 #include <DTK_Point.hpp>
+#include <DTK_Ray.hpp>
+#include <DTK_Segment.hpp>
 #include <DTK_Sphere.hpp>
+#include <DTK_Triangle.hpp>
 
 #include <Kokkos_Macros.hpp>
 
+#include <cmath> // floor, sqrt
+
 namespace DataTransferKit
 {
 namespace Details
@@ -69,9 +75,11 @@ bool isValid( Sphere const &s )
            ( s.radius() >= 0. );
 }
 
-// distance point-point
+// squared distance point-point
+// NOTE compares like the distance itself without the square root, which is
+// all the nearest neighbor search needs while traversing the hierarchy
 KOKKOS_INLINE_FUNCTION
-double distance( Point const &a, Point const &b )
+double distanceSquared( Point const &a, Point const &b )
 {
     double distance_squared = 0.0;
     for ( int d = 0; d < 3; ++d )
@@ -79,12 +87,12 @@ double distance( Point const &a, Point const &b )
         double tmp = b[d] - a[d];
         distance_squared += tmp * tmp;
     }
-    return std::sqrt( distance_squared );
+    return distance_squared;
 }
 
-// distance point-box
+// squared distance point-box
 KOKKOS_INLINE_FUNCTION
-double distance( Point const &point, Box const &box )
+double distanceSquared( Point const &point, Box const &box )
 {
     Point projected_point;
     for ( int d = 0; d < 3; ++d )
@@ -96,7 +104,21 @@ double distance( Point const &point, Box const &box )
         else
             projected_point[d] = point[d];
     }
-    return distance( point, projected_point );
+    return distanceSquared( point, projected_point );
+}
+
+// distance point-point
+KOKKOS_INLINE_FUNCTION
+double distance( Point const &a, Point const &b )
+{
+    return std::sqrt( distanceSquared( a, b ) );
+}
+
+// distance point-box
+KOKKOS_INLINE_FUNCTION
+double distance( Point const &point, Box const &box )
+{
+    return std::sqrt( distanceSquared( point, box ) );
 }
 
 // distance point-sphere
@@ -151,6 +173,15 @@ void expand( Box &box, Sphere const &sphere )
     }
 }
 
+// expand an axis-aligned bounding box to include a triangle
+KOKKOS_INLINE_FUNCTION
+void expand( Box &box, Triangle const &triangle )
+{
+    expand( box, triangle.a() );
+    expand( box, triangle.b() );
+    expand( box, triangle.c() );
+}
+
 // check if two axis-aligned bounding boxes intersect
 KOKKOS_INLINE_FUNCTION
 bool intersects( Box const &box, Box const &other )
@@ -169,6 +200,94 @@ bool intersects( Sphere const &sphere, Box const &box )
     return distance( sphere.centroid(), box ) <= sphere.radius();
 }
 
+// parameter t at which the line origin + t * direction enters an
+// axis-aligned bounding box for t in [0, t_max], i.e. zero if the origin is
+// inside the box, or infinity if the line misses it on that interval
+KOKKOS_INLINE_FUNCTION
+double entryParameter( Point const &origin, Point const &direction,
+                       double t_max, Box const &box )
+{
+    double const infinity = KokkosHelpers::ArithTraits<double>::infinity();
+    double t_min = 0.;
+    for ( int d = 0; d < 3; ++d )
+    {
+        if ( direction[d] == 0. )
+        {
+            // parallel to the slab, i.e. either inside of it all along or
+            // never
+            if ( origin[d] < box.minCorner()[d] ||
+                 origin[d] > box.maxCorner()[d] )
+                return infinity;
+            continue;
+        }
+        double t_near = ( box.minCorner()[d] - origin[d] ) / direction[d];
+        double t_far = ( box.maxCorner()[d] - origin[d] ) / direction[d];
+        if ( t_near > t_far )
+        {
+            double const tmp = t_near;
+            t_near = t_far;
+            t_far = tmp;
+        }
+        t_min = KokkosHelpers::max( t_min, t_near );
+        t_max = KokkosHelpers::min( t_max, t_far );
+        if ( t_min > t_max )
+            return infinity;
+    }
+    return t_min;
+}
+
+KOKKOS_INLINE_FUNCTION
+double norm( Point const &v )
+{
+    double norm_squared = 0.;
+    for ( int d = 0; d < 3; ++d )
+        norm_squared += v[d] * v[d];
+    return std::sqrt( norm_squared );
+}
+
+// distance from the origin of a ray to the point where it enters an
+// axis-aligned bounding box or infinity if it misses the box
+KOKKOS_INLINE_FUNCTION
+double entryDistance( Ray const &ray, Box const &box )
+{
+    double const t =
+        entryParameter( ray.origin(), ray.direction(),
+                        KokkosHelpers::ArithTraits<double>::infinity(), box );
+    return t * norm( ray.direction() );
+}
+
+// distance from the start of a segment to the point where it enters an
+// axis-aligned bounding box or infinity if it misses the box
+KOKKOS_INLINE_FUNCTION
+double entryDistance( Segment const &segment, Box const &box )
+{
+    Point direction;
+    for ( int d = 0; d < 3; ++d )
+        direction[d] = segment.end()[d] - segment.start()[d];
+    double const t = entryParameter( segment.start(), direction, 1., box );
+    // a degenerate segment is a point, which is either inside of the box or
+    // misses it
+    if ( t == KokkosHelpers::ArithTraits<double>::infinity() )
+        return t;
+    return t * norm( direction );
+}
+
+// check if a ray intersects with an axis-aligned bounding box
+KOKKOS_INLINE_FUNCTION
+bool intersects( Ray const &ray, Box const &box )
+{
+    return entryDistance( ray, box ) !=
+           KokkosHelpers::ArithTraits<double>::infinity();
+}
+
+// check if a segment intersects with an axis-aligned bounding box
+KOKKOS_INLINE_FUNCTION
+bool intersects( Segment const &segment, Box const &box )
+{
+    return entryDistance( segment, box ) !=
+           KokkosHelpers::ArithTraits<double>::infinity();
+}
+
 // calculate the centroid of a box
 KOKKOS_INLINE_FUNCTION
 void centroid( Box const &box, Point &c )
@@ -177,6 +296,196 @@ void centroid( Box const &box, Point &c )
         c[d] = 0.5 * ( box.minCorner()[d] + box.maxCorner()[d] );
 }
 
+// calculate the surface area of a box
+KOKKOS_INLINE_FUNCTION
+double surfaceArea( Box const &box )
+{
+    double const dx = box.maxCorner()[0] - box.minCorner()[0];
+    double const dy = box.maxCorner()[1] - box.minCorner()[1];
+    double const dz = box.maxCorner()[2] - box.minCorner()[2];
+    return 2. * ( dx * dy + dy * dz + dz * dx );
+}
+
+// calculate the volume of a box, zero if it is empty
+KOKKOS_INLINE_FUNCTION
+double volume( Box const &box )
+{
+    double v = 1.;
+    for ( int d = 0; d < 3; ++d )
+    {
+        double const extent = box.maxCorner()[d] - box.minCorner()[d];
+        if ( !( extent > 0. ) )
+            return 0.;
+        v *= extent;
+    }
+    return v;
+}
+
+// round the corners of a box outward to single precision so that the
+// resulting box encloses the original one
+KOKKOS_INLINE_FUNCTION
+FloatBox roundOutward( Box const &box )
+{
+    using KokkosHelpers::roundDown;
+    using KokkosHelpers::roundUp;
+    FloatBox float_box;
+    for ( int d = 0; d < 3; ++d )
+    {
+        float_box._min_corner[d] = roundDown( box.minCorner()[d] );
+        float_box._max_corner[d] = roundUp( box.maxCorner()[d] );
+    }
+    return float_box;
+}
+
+// convert a box back to double precision (no rounding involved)
+KOKKOS_INLINE_FUNCTION
+Box toBox( FloatBox const &float_box )
+{
+    Box box;
+    for ( int d = 0; d < 3; ++d )
+    {
+        box.minCorner()[d] = float_box._min_corner[d];
+        box.maxCorner()[d] = float_box._max_corner[d];
+    }
+    return box;
+}
+
+KOKKOS_INLINE_FUNCTION
+Box toBox( Box const &box ) { return box; }
+
+// Queries are always expressed in double precision.  The overloads below
+// allow to test them against the single precision boxes stored in the nodes.
+KOKKOS_INLINE_FUNCTION
+double distance( Point const &point, FloatBox const &box )
+{
+    return distance( point, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+double distanceSquared( Point const &point, FloatBox const &box )
+{
+    return distanceSquared( point, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Box const &box, FloatBox const &other )
+{
+    return intersects( box, toBox( other ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Sphere const &sphere, FloatBox const &box )
+{
+    return intersects( sphere, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+double entryDistance( Ray const &ray, FloatBox const &box )
+{
+    return entryDistance( ray, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+double entryDistance( Segment const &segment, FloatBox const &box )
+{
+    return entryDistance( segment, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Ray const &ray, FloatBox const &box )
+{
+    return intersects( ray, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Segment const &segment, FloatBox const &box )
+{
+    return intersects( segment, toBox( box ) );
+}
+
+// Distance from x to the closest image of the interval [a, b] along a
+// direction of period L, or to the interval itself if L is zero.
+KOKKOS_INLINE_FUNCTION
+double periodicGap( double x, double a, double b, double L )
+{
+    if ( !( L > 0. ) )
+        return x < a ? a - x : ( x > b ? x - b : 0. );
+    if ( b - a >= L )
+        return 0.;
+    // position of x past a, brought back into [0, L)
+    double const y = x - a - std::floor( ( x - a ) / L ) * L;
+    return y <= b - a ? 0. : KokkosHelpers::min( y - ( b - a ), L - y );
+}
+
+// squared distance from a point to the closest image of a box
+KOKKOS_INLINE_FUNCTION
+double distanceSquared( Periodic<Point> const &point, Box const &box )
+{
+    double distance_squared = 0.;
+    for ( int d = 0; d < 3; ++d )
+    {
+        double const gap =
+            periodicGap( point.geometry()[d], box.minCorner()[d],
+                         box.maxCorner()[d], point.period()[d] );
+        distance_squared += gap * gap;
+    }
+    return distance_squared;
+}
+
+KOKKOS_INLINE_FUNCTION
+double distance( Periodic<Point> const &point, Box const &box )
+{
+    return std::sqrt( distanceSquared( point, box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Periodic<Sphere> const &sphere, Box const &box )
+{
+    return distance( periodic( sphere.geometry().centroid(), sphere.period() ),
+                     box ) <= sphere.geometry().radius();
+}
+
+// The images of a box of width w intersect the box [a, b] along a direction
+// if and only if the images of its lower corner are in [a - w, b].
+KOKKOS_INLINE_FUNCTION
+bool intersects( Periodic<Box> const &box, Box const &other )
+{
+    for ( int d = 0; d < 3; ++d )
+    {
+        double const min_corner = box.geometry().minCorner()[d];
+        double const width = box.geometry().maxCorner()[d] - min_corner;
+        if ( width < 0. ||
+             periodicGap( min_corner, other.minCorner()[d] - width,
+                          other.maxCorner()[d], box.period()[d] ) > 0. )
+            return false;
+    }
+    return true;
+}
+
+KOKKOS_INLINE_FUNCTION
+double distance( Periodic<Point> const &point, FloatBox const &box )
+{
+    return distance( point, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+double distanceSquared( Periodic<Point> const &point, FloatBox const &box )
+{
+    return distanceSquared( point, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Periodic<Sphere> const &sphere, FloatBox const &box )
+{
+    return intersects( sphere, toBox( box ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+bool intersects( Periodic<Box> const &box, FloatBox const &other )
+{
+    return intersects( box, toBox( other ) );
+}
+
 KOKKOS_INLINE_FUNCTION
 Point return_centroid( Point const &point ) { return point; }
 
@@ -192,6 +501,109 @@ Point return_centroid( Box const &box )
 KOKKOS_INLINE_FUNCTION
 Point return_centroid( Sphere const &sphere ) { return sphere.centroid(); }
 
+// periodic geometries are sorted by the position of the geometry itself
+template <typename Geometry>
+KOKKOS_INLINE_FUNCTION Point
+return_centroid( Periodic<Geometry> const &geometry )
+{
+    return return_centroid( geometry.geometry() );
+}
+
+// rays are sorted along the Z-order curve by their origin
+KOKKOS_INLINE_FUNCTION
+Point return_centroid( Ray const &ray ) { return ray.origin(); }
+
+KOKKOS_INLINE_FUNCTION
+Point return_centroid( Segment const &segment )
+{
+    Point c;
+    for ( int d = 0; d < 3; ++d )
+        c[d] = 0.5 * ( segment.start()[d] + segment.end()[d] );
+    return c;
+}
+
+// Closest point to the given one on a triangle, together with its
+// barycentric coordinates with respect to the vertices a, b and c.  The
+// regions of the plane of the triangle are tested in turn, vertices then
+// edges then the interior, as in Ericson, Real-Time Collision Detection,
+// section 5.1.5.
+KOKKOS_INLINE_FUNCTION
+Point closestPoint( Point const &point, Triangle const &triangle,
+                    double barycentric[3] )
+{
+    Point const &a = triangle.a();
+    Point const &b = triangle.b();
+    Point const &c = triangle.c();
+    auto const dot = []( Point const &u, Point const &v ) {
+        return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    };
+    auto const sub = []( Point const &u, Point const &v ) {
+        return Point{{u[0] - v[0], u[1] - v[1], u[2] - v[2]}};
+    };
+    Point const ab = sub( b, a );
+    Point const ac = sub( c, a );
+    Point const ap = sub( point, a );
+    Point const bp = sub( point, b );
+    Point const cp = sub( point, c );
+    double const d1 = dot( ab, ap );
+    double const d2 = dot( ac, ap );
+    double const d3 = dot( ab, bp );
+    double const d4 = dot( ac, bp );
+    double const d5 = dot( ab, cp );
+    double const d6 = dot( ac, cp );
+    double const va = d3 * d6 - d5 * d4;
+    double const vb = d5 * d2 - d1 * d6;
+    double const vc = d1 * d4 - d3 * d2;
+
+    double u = 0.;
+    double v = 0.;
+    double w = 0.;
+    if ( d1 <= 0. && d2 <= 0. )
+        u = 1.;
+    else if ( d3 >= 0. && d4 <= d3 )
+        v = 1.;
+    else if ( d6 >= 0. && d5 <= d6 )
+        w = 1.;
+    else if ( vc <= 0. && d1 >= 0. && d3 <= 0. )
+    {
+        v = d1 / ( d1 - d3 );
+        u = 1. - v;
+    }
+    else if ( vb <= 0. && d2 >= 0. && d6 <= 0. )
+    {
+        w = d2 / ( d2 - d6 );
+        u = 1. - w;
+    }
+    else if ( va <= 0. && d4 - d3 >= 0. && d5 - d6 >= 0. )
+    {
+        w = ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) );
+        v = 1. - w;
+    }
+    else
+    {
+        double const denominator = va + vb + vc;
+        v = vb / denominator;
+        w = vc / denominator;
+        u = 1. - v - w;
+    }
+    barycentric[0] = u;
+    barycentric[1] = v;
+    barycentric[2] = w;
+
+    Point closest;
+    for ( int d = 0; d < 3; ++d )
+        closest[d] = u * a[d] + v * b[d] + w * c[d];
+    return closest;
+}
+
+// distance from a point to a triangle
+KOKKOS_INLINE_FUNCTION
+double distance( Point const &point, Triangle const &triangle )
+{
+    double barycentric[3];
+    return distance( point, closestPoint( point, triangle, barycentric ) );
+}
+
 } // namespace Details
 } // namespace DataTransferKit
 
@@ -14,7 +14,7 @@
 
 #include <DTK_Box.hpp>
 #include <DTK_DetailsAlgorithms.hpp>       // return_centroid
-#include <DTK_DetailsTreeConstruction.hpp> // morton3D
+#include <DTK_DetailsTreeConstruction.hpp> // curveCode
 #include <DTK_DetailsUtils.hpp> // iota, exclusivePrefixSum, lastElement
 
 #include <Kokkos_Core.hpp>
@@ -47,14 +47,42 @@ struct BatchedQueries
     // queries.  We found that it was slighly more performant to add a level of
     // indirection when recording results rather than using that function at
     // the end.  We decided to keep reversePermutation around for now.
+    //
+    // The Morton codes of the queries are sorted with the algorithm selected
+    // by the tag, see TreeConstruction::sortObjects().
 
-    template <typename Query>
+    template <typename Query, typename SortTag = RadixSortTag>
     static Kokkos::View<size_t *, DeviceType>
     sortQueriesAlongZOrderCurve( Box const &scene_bounding_box,
-                                 Kokkos::View<Query *, DeviceType> queries )
+                                 Kokkos::View<Query *, DeviceType> queries,
+                                 SortTag tag = SortTag{} )
     {
-        auto const n_queries = queries.extent( 0 );
+        return sortQueriesAlongCurve( scene_bounding_box, queries,
+                                      ZOrderCurveTag{}, tag );
+    }
 
+    // Same as above along the selected space-filling curve, see
+    // HilbertCurveTag.
+    template <typename Query, typename Curve, typename SortTag = RadixSortTag>
+    static Kokkos::View<size_t *, DeviceType>
+    sortQueriesAlongCurve( Box const &scene_bounding_box,
+                           Kokkos::View<Query *, DeviceType> queries,
+                           Curve curve, SortTag tag = SortTag{} )
+    {
+        return sortQueriesAlongCurve( scene_bounding_box, queries,
+                                      queries.extent( 0 ), curve, tag );
+    }
+
+    // Same as above with the ith query given by queries( i ), for i <
+    // n_queries, e.g. a functor that makes the queries on demand from the
+    // coordinates of points so that they need not be stored.
+    template <typename Queries, typename Curve,
+              typename SortTag = RadixSortTag>
+    static Kokkos::View<size_t *, DeviceType>
+    sortQueriesAlongCurve( Box const &scene_bounding_box,
+                           Queries const &queries, size_t n_queries, Curve,
+                           SortTag tag = SortTag{} )
+    {
         Kokkos::View<unsigned int *, DeviceType> morton_codes(
             Kokkos::ViewAllocateWithoutInitializing( "morton" ), n_queries );
         Kokkos::parallel_for(
@@ -68,12 +96,12 @@ struct BatchedQueries
                     double const b = scene_bounding_box.maxCorner()[d];
                     xyz[d] = ( a != b ? ( xyz[d] - a ) / ( b - a ) : 0 );
                 }
-                morton_codes( i ) = TreeConstruction<DeviceType>::morton3D(
-                    xyz[0], xyz[1], xyz[2] );
+                morton_codes( i ) = TreeConstruction<DeviceType>::curveCode(
+                    Curve{}, xyz[0], xyz[1], xyz[2] );
             } );
         Kokkos::fence();
 
-        return TreeConstruction<DeviceType>::sortObjects( morton_codes );
+        return TreeConstruction<DeviceType>::sortObjects( morton_codes, tag );
     }
 
     template <typename T>
@@ -94,6 +122,27 @@ struct BatchedQueries
         return w;
     }
 
+    // Queries sorted by the permutation, the ith one being
+    // queries( permute( i ) ).  They are made on demand as in
+    // sortQueriesAlongCurve() and only stored once sorted.
+    template <typename Query, typename Queries>
+    static Kokkos::View<Query *, DeviceType>
+    makePermutedQueries( Kokkos::View<size_t const *, DeviceType> permute,
+                         Queries const &queries )
+    {
+        auto const n = permute.extent( 0 );
+
+        Kokkos::View<Query *, DeviceType> w(
+            Kokkos::ViewAllocateWithoutInitializing( "queries" ), n );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "make_permuted_queries" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i ) { w( i ) = queries( permute( i ) ); } );
+        Kokkos::fence();
+
+        return w;
+    }
+
     static Kokkos::View<int *, DeviceType>
     permuteOffset( Kokkos::View<size_t const *, DeviceType> permute,
                    Kokkos::View<int const *, DeviceType> offset )
@@ -0,0 +1,189 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#ifndef DTK_DETAILS_CACHING_ALLOCATOR_HPP
+#define DTK_DETAILS_CACHING_ALLOCATOR_HPP
+
+#include <Kokkos_Core.hpp>
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+/** Blocks of memory that are kept for reuse once released instead of being
+ *  freed, so that the temporaries of repeated calls do not go through
+ *  kokkos_malloc() and kokkos_free() each time.  On CUDA, the latter
+ *  synchronize the device.  The blocks are sized to powers of two so that a
+ *  block is reused for any request larger than half its capacity.  The cache
+ *  grows to the largest set of temporaries used at once and is only freed
+ *  by release() or on destruction, which must happen before Kokkos is
+ *  finalized.
+ */
+template <typename MemorySpace>
+class CachingAllocator
+{
+  public:
+    CachingAllocator() = default;
+    ~CachingAllocator() { release(); }
+
+    CachingAllocator( CachingAllocator const & ) = delete;
+    CachingAllocator &operator=( CachingAllocator const & ) = delete;
+
+    // Return a block of at least the given size and its actual capacity.
+    std::pair<void *, std::size_t> allocate( std::string const &label,
+                                             std::size_t size )
+    {
+        std::size_t capacity = min_capacity;
+        while ( capacity < size )
+            capacity *= 2;
+        std::lock_guard<std::mutex> lock( _mutex );
+        auto &blocks = _free_blocks[capacity];
+        if ( !blocks.empty() )
+        {
+            void *ptr = blocks.back();
+            blocks.pop_back();
+            return std::make_pair( ptr, capacity );
+        }
+        void *ptr = Kokkos::kokkos_malloc<MemorySpace>( label, capacity );
+        _cached_size += capacity;
+        return std::make_pair( ptr, capacity );
+    }
+
+    // Give back a block obtained from allocate().
+    void deallocate( void *ptr, std::size_t capacity )
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        _free_blocks[capacity].push_back( ptr );
+    }
+
+    // Free the blocks that are not in use.
+    void release()
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        for ( auto &blocks : _free_blocks )
+        {
+            for ( void *ptr : blocks.second )
+                Kokkos::kokkos_free<MemorySpace>( ptr );
+            _cached_size -= blocks.first * blocks.second.size();
+            blocks.second.clear();
+        }
+    }
+
+    // Total capacity of the blocks held, in use or not.
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock( _mutex );
+        return _cached_size;
+    }
+
+    // Allocator that the temporaries of the calling thread are drawn from,
+    // if any (see CachingAllocatorScope).
+    static CachingAllocator *&current()
+    {
+        static thread_local CachingAllocator *allocator = nullptr;
+        return allocator;
+    }
+
+  private:
+    static std::size_t constexpr min_capacity = 256;
+    mutable std::mutex _mutex;
+    std::map<std::size_t, std::vector<void *>> _free_blocks;
+    std::size_t _cached_size = 0;
+};
+
+/** Draw the temporaries of the calling thread from the given allocator
+ *  until the scope is left.
+ */
+template <typename MemorySpace>
+class CachingAllocatorScope
+{
+  public:
+    explicit CachingAllocatorScope( CachingAllocator<MemorySpace> &allocator )
+        : _previous( CachingAllocator<MemorySpace>::current() )
+    {
+        CachingAllocator<MemorySpace>::current() = &allocator;
+    }
+    ~CachingAllocatorScope()
+    {
+        CachingAllocator<MemorySpace>::current() = _previous;
+    }
+
+    CachingAllocatorScope( CachingAllocatorScope const & ) = delete;
+    CachingAllocatorScope &operator=( CachingAllocatorScope const & ) = delete;
+
+  private:
+    CachingAllocator<MemorySpace> *_previous;
+};
+
+/** Uninitialized views that live no longer than this object.  They are
+ *  drawn from the current allocator of the thread if there is one, and
+ *  given back to it on destruction, or allocated as usual otherwise.  The
+ *  views must not be kept past the lifetime of this object, which means
+ *  that it is only meant for the temporaries of a function, not for the
+ *  views it returns.  DeviceType may also be a memory space.
+ */
+template <typename DeviceType>
+class TemporaryViews
+{
+  public:
+    using MemorySpace = typename DeviceType::memory_space;
+
+    TemporaryViews()
+        : _allocator( CachingAllocator<MemorySpace>::current() )
+    {
+    }
+    ~TemporaryViews()
+    {
+        for ( auto const &block : _blocks )
+            _allocator->deallocate( block.first, block.second );
+    }
+
+    TemporaryViews( TemporaryViews const & ) = delete;
+    TemporaryViews &operator=( TemporaryViews const & ) = delete;
+
+    // Rank-1 or rank-2 view, i.e. n1 is ignored for the former.
+    template <typename DataType>
+    Kokkos::View<DataType, DeviceType>
+    view( std::string const &label, std::size_t n0, std::size_t n1 = 1 )
+    {
+        using ViewType = Kokkos::View<DataType, DeviceType>;
+        static_assert( ViewType::rank == 1 || ViewType::rank == 2,
+                       "TemporaryViews only provides rank-1 or rank-2 views" );
+        std::size_t const n = ( ViewType::rank == 1 ) ? n0 : n0 * n1;
+        if ( _allocator == nullptr )
+            return ViewType( Kokkos::ViewAllocateWithoutInitializing( label ),
+                             n0, n1 );
+        if ( n == 0 )
+            return ViewType( label, n0, n1 );
+        auto const block = _allocator->allocate(
+            label, n * sizeof( typename ViewType::value_type ) );
+        _blocks.push_back( block );
+        return ViewType(
+            static_cast<typename ViewType::pointer_type>( block.first ), n0,
+            n1 );
+    }
+
+  private:
+    CachingAllocator<MemorySpace> *_allocator;
+    std::vector<std::pair<void *, std::size_t>> _blocks;
+};
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
@@ -11,17 +11,27 @@
 #ifndef DTK_DETAILS_DISTRIBUTED_SEARCH_TREE_IMPL_HPP
 #define DTK_DETAILS_DISTRIBUTED_SEARCH_TREE_IMPL_HPP
 
+#include <DTK_DetailsCachingAllocator.hpp>
+#include <DTK_DetailsDistributor.hpp>
 #include <DTK_DetailsPriorityQueue.hpp>
+#include <DTK_DetailsRadixSort.hpp>
 #include <DTK_DetailsTeuchosSerializationTraits.hpp>
 #include <DTK_DetailsUtils.hpp>
 #include <DTK_LinearBVH.hpp>
 #include <DTK_Predicates.hpp>
+#include <DTK_Statistics.hpp>
+#include <DTK_Tuning.hpp>
 
+#include <Kokkos_ArithTraits.hpp>
 #include <Kokkos_Atomic.hpp>
 #include <Kokkos_Sort.hpp>
-#include <Tpetra_Distributor.hpp>
+#include <Kokkos_Timer.hpp>
+#include <Teuchos_CommHelpers.hpp>
 
-#include <numeric> // accumulate
+#include <cstdint>
+#include <cstdlib> // getenv
+#include <string>
+#include <vector>
 
 namespace DataTransferKit
 {
@@ -32,6 +42,111 @@ class DistributedSearchTree;
 namespace Details
 {
 
+// Packets exchanged when forwarding queries and when communicating results
+// back.  Packing the fields together saves a round of communication per
+// field.  Ranks are not sent since they can be inferred from the
+// communication plan.
+template <typename Query>
+struct QueryPacket
+{
+    Query query;
+    int id;
+};
+
+struct ResultPacket
+{
+    int index;
+    int id;
+};
+
+// Results of a given query are sent back after a header that holds the id
+// of the query and the number of results.
+struct ResultCountPacket
+{
+    int id;
+    int count;
+};
+
+// Partial reduction of a query over the local objects of a process.
+template <typename Value>
+struct ReductionPacket
+{
+    Value value;
+    int id;
+};
+
+// Results of the nearest queries answered with the halo carry the rank that
+// owns the object since it cannot be inferred from the communication plan.
+// A negative index marks a query that could not be resolved.
+struct HaloResultPacket
+{
+    int index;
+    int rank;
+    int id;
+    double distance;
+};
+
+// Exchange whose messages have been posted but not waited for yet.  The
+// buffers are staged through the host and must stay alive until then.  The
+// exports are stored grouped by destination, as they were sent.
+template <typename DeviceType, typename Packet>
+struct PendingExchange
+{
+    Teuchos::RCP<Distributor> distributor;
+    Kokkos::View<Packet *, Kokkos::HostSpace> exports_host;
+    typename Kokkos::View<Packet *, DeviceType>::HostMirror imports_host;
+    Kokkos::View<Packet *, DeviceType> imports;
+};
+
+} // namespace Details
+} // namespace DataTransferKit
+
+namespace Teuchos
+{
+
+template <typename Ordinal, typename Query>
+class SerializationTraits<Ordinal, DataTransferKit::Details::QueryPacket<Query>>
+    : public DirectSerializationTraits<
+          Ordinal, DataTransferKit::Details::QueryPacket<Query>>
+{
+};
+
+template <typename Ordinal>
+class SerializationTraits<Ordinal, DataTransferKit::Details::ResultPacket>
+    : public DirectSerializationTraits<Ordinal,
+                                       DataTransferKit::Details::ResultPacket>
+{
+};
+
+template <typename Ordinal>
+class SerializationTraits<Ordinal, DataTransferKit::Details::ResultCountPacket>
+    : public DirectSerializationTraits<
+          Ordinal, DataTransferKit::Details::ResultCountPacket>
+{
+};
+
+template <typename Ordinal, typename Value>
+class SerializationTraits<Ordinal,
+                          DataTransferKit::Details::ReductionPacket<Value>>
+    : public DirectSerializationTraits<
+          Ordinal, DataTransferKit::Details::ReductionPacket<Value>>
+{
+};
+
+template <typename Ordinal>
+class SerializationTraits<Ordinal, DataTransferKit::Details::HaloResultPacket>
+    : public DirectSerializationTraits<
+          Ordinal, DataTransferKit::Details::HaloResultPacket>
+{
+};
+
+} // namespace Teuchos
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
 template <typename DeviceType>
 struct DistributedSearchTreeImpl
 {
@@ -46,6 +161,60 @@ struct DistributedSearchTreeImpl
                                Kokkos::View<int *, DeviceType> &ranks,
                                Details::SpatialPredicateTag );
 
+    // Spatial queries whose results stay on the processes that own the
+    // matching objects (see DistributedSearchTree::queryOnOwners()).
+    template <typename Query>
+    static void
+    performQueriesOnOwners( DistributedSearchTree<DeviceType> const &tree,
+                            Kokkos::View<Query *, DeviceType> queries,
+                            Kokkos::View<Query *, DeviceType> &fwd_queries,
+                            Kokkos::View<int *, DeviceType> &indices,
+                            Kokkos::View<int *, DeviceType> &offset,
+                            Kokkos::View<int *, DeviceType> &ids,
+                            Kokkos::View<int *, DeviceType> &ranks );
+
+    // Spatial queries reduced over the objects that satisfy them (see
+    // DistributedSearchTree::reduce()).
+    template <typename Query, typename Values, typename Reducer>
+    static void performReductions(
+        DistributedSearchTree<DeviceType> const &tree,
+        Kokkos::View<Query *, DeviceType> queries, Values const &values,
+        Reducer const &reducer,
+        Kokkos::View<typename Reducer::value_type *, DeviceType> &results );
+
+    // Pairs of objects of the two trees whose bounding boxes intersect (see
+    // DistributedSearchTree::join()).
+    static void performJoin( DistributedSearchTree<DeviceType> const &tree,
+                             DistributedSearchTree<DeviceType> const &other,
+                             Kokkos::View<int *, DeviceType> &indices,
+                             Kokkos::View<int *, DeviceType> &offset,
+                             Kokkos::View<int *, DeviceType> &ranks );
+
+    // Queries against the top tree.
+    template <typename Query>
+    static void queryTopTree( DistributedSearchTree<DeviceType> const &tree,
+                              Kokkos::View<Query *, DeviceType> queries,
+                              Kokkos::View<int *, DeviceType> &indices,
+                              Kokkos::View<int *, DeviceType> &offset );
+
+    // Same as queryTopTree() without the timer.  The copy of the top tree in
+    // host memory is queried if there is one.
+    template <typename Query>
+    static void
+    performTopTreeQueries( DistributedSearchTree<DeviceType> const &tree,
+                           Kokkos::View<Query *, DeviceType> queries,
+                           Kokkos::View<int *, DeviceType> &indices,
+                           Kokkos::View<int *, DeviceType> &offset );
+
+    // Spatial queries against the local objects, with the structured grid if
+    // there is one and the local tree otherwise.
+    template <typename Query>
+    static void
+    queryLocalObjects( DistributedSearchTree<DeviceType> const &tree,
+                       Kokkos::View<Query *, DeviceType> queries,
+                       Kokkos::View<int *, DeviceType> &indices,
+                       Kokkos::View<int *, DeviceType> &offset );
+
     // nearest neighbors queries
     template <typename Query>
     static void queryDispatch(
@@ -56,20 +225,154 @@ struct DistributedSearchTreeImpl
         Kokkos::View<int *, DeviceType> &ranks, Details::NearestPredicateTag,
         Kokkos::View<double *, DeviceType> *distances_ptr = nullptr );
 
+    // Nearest queries performed on the local tree of all the processes that
+    // may hold one of the k nearest neighbors, in two passes (see
+    // queryDispatch()).
+    template <typename Query>
+    static void performTwoPassNearestQueries(
+        DistributedSearchTree<DeviceType> const &tree,
+        Kokkos::View<Query *, DeviceType> queries,
+        Kokkos::View<int *, DeviceType> &indices,
+        Kokkos::View<int *, DeviceType> &offset,
+        Kokkos::View<int *, DeviceType> &ranks,
+        Kokkos::View<double *, DeviceType> &distances );
+
+    // Nearest queries answered in a single pass with the halo when possible,
+    // falling back on the two-pass algorithm for the other ones.
+    template <typename Query>
+    static void performHaloNearestQueries(
+        DistributedSearchTree<DeviceType> const &tree,
+        Kokkos::View<Query *, DeviceType> queries,
+        Kokkos::View<int *, DeviceType> &indices,
+        Kokkos::View<int *, DeviceType> &offset,
+        Kokkos::View<int *, DeviceType> &ranks,
+        Kokkos::View<double *, DeviceType> &distances );
+
+    // Send each query to the process that owns the closest leaf of the top
+    // tree and find its k nearest neighbors among the local and halo objects
+    // there.  A query is resolved if the box that encloses its geometry,
+    // grown by the distance to the kth neighbor, lies within the region
+    // covered by the halo.  On exit, indices, ranks, distances and ids hold
+    // the results of the resolved queries, in no particular order, and
+    // unresolved(q) is nonzero for the other ones.
+    template <typename Query>
+    static void
+    performHaloQueries( DistributedSearchTree<DeviceType> const &tree,
+                        Kokkos::View<Query *, DeviceType> queries,
+                        Kokkos::View<int *, DeviceType> &indices,
+                        Kokkos::View<int *, DeviceType> &ranks,
+                        Kokkos::View<double *, DeviceType> &distances,
+                        Kokkos::View<int *, DeviceType> &ids,
+                        Kokkos::View<int *, DeviceType> &unresolved );
+
+    // Bounding boxes of the given nodes of the tree.
+    static Kokkos::View<Box *, DeviceType>
+    getNodesBounds( BVH<DeviceType> const &tree,
+                    Kokkos::View<int const *, DeviceType> nodes );
+
+    // Number of objects in each of the subtrees rooted at the given nodes.
+    // The subtrees must partition the leaves of the tree, as the ones given
+    // by cutHierarchy() do, and parents is the one computed there.
+    static Kokkos::View<int *, DeviceType>
+    countObjectsInSubtrees( BVH<DeviceType> const &tree,
+                            Kokkos::View<int const *, DeviceType> roots,
+                            Kokkos::View<int const *, DeviceType> parents );
+
+    // Rank that owns the leaf of the top tree nearest to each query (see
+    // DistributedSearchTree::findNearestRanks()).
+    template <typename Query>
+    static Kokkos::View<int *, DeviceType>
+    findNearestRanks( DistributedSearchTree<DeviceType> const &tree,
+                      Kokkos::View<Query *, DeviceType> queries );
+
+    // Objects of the tree, i.e. the bounding boxes of its leaves along with
+    // the indices they were given at construction.
+    static void getLeaves( BVH<DeviceType> const &tree,
+                           Kokkos::View<Box *, DeviceType> &boxes,
+                           Kokkos::View<int *, DeviceType> &indices );
+
+    // Number of (query, rank) pairs each process would receive for the given
+    // spatial queries, taking work sharing into account.  This must be called
+    // as a collective.
+    template <typename Query>
+    static std::vector<int>
+    countQueriesPerRank( DistributedSearchTree<DeviceType> const &tree,
+                         Kokkos::View<Query *, DeviceType> queries );
+
+    // On entry, indices and offset hold the ranks that queries are to be
+    // forwarded to.  The pairs bound for a process that has helpers are dealt
+    // between it and its helpers according to the query index.  On exit,
+    // indices and offset hold the pairs that go to the owners and
+    // helper_indices and helper_offset the ones that go to the helpers.
+    static void shareQueries( DistributedSearchTree<DeviceType> const &tree,
+                              Kokkos::View<int *, DeviceType> &indices,
+                              Kokkos::View<int *, DeviceType> &offset,
+                              Kokkos::View<int *, DeviceType> &helper_indices,
+                              Kokkos::View<int *, DeviceType> &helper_offset );
+
+    // Forward the queries to the helpers given by indices and offset and
+    // perform them on the copies of the local trees they hold.  On exit,
+    // indices, ranks and ids hold the results as if they came from the
+    // owners, in no particular order.
+    template <typename Query>
+    static void
+    performQueriesOnReplicas( DistributedSearchTree<DeviceType> const &tree,
+                              Kokkos::View<Query *, DeviceType> queries,
+                              Kokkos::View<int *, DeviceType> &indices,
+                              Kokkos::View<int *, DeviceType> offset,
+                              Kokkos::View<int *, DeviceType> &ranks,
+                              Kokkos::View<int *, DeviceType> &ids );
+
+    // On entry, indices and offset hold leaves of the top tree.  On exit, they
+    // hold the ranks that own them, without duplicates.  The summary of
+    // another group maps to all the ranks in that group.  With replica
+    // groups, a single member of each group is kept (see pickReplicas()).
+    static void
+    mapTopTreeLeavesToRanks( DistributedSearchTree<DeviceType> const &tree,
+                             Kokkos::View<int *, DeviceType> &indices,
+                             Kokkos::View<int *, DeviceType> &offset );
+
+    // On entry, indices and offset hold the ranks that queries are to be
+    // forwarded to.  On exit, each rank that belongs to a replica group is
+    // replaced by the member of the group that answers the query, i.e. the
+    // calling process if it is one of them and otherwise a member chosen from
+    // the calling rank and the query index, without duplicates.
+    static void pickReplicas( DistributedSearchTree<DeviceType> const &tree,
+                              Kokkos::View<int *, DeviceType> &indices,
+                              Kokkos::View<int *, DeviceType> &offset );
+
     template <typename Query>
     static void deviseStrategy( Kokkos::View<Query *, DeviceType> queries,
                                 DistributedSearchTree<DeviceType> const &tree,
                                 Kokkos::View<int *, DeviceType> &indices,
-                                Kokkos::View<int *, DeviceType> &offset,
-                                Kokkos::View<double *, DeviceType> & );
+                                Kokkos::View<int *, DeviceType> &offset );
 
+    // On entry, indices and offset hold the ranks that were searched in the
+    // 1st pass.  On exit, they hold the ranks that may have a closer neighbor
+    // than the farthest one found so far and that were not searched yet, and
+    // bounded_queries holds the queries capped at that distance for these
+    // ranks, so that they only return the neighbors that are closer.
     template <typename Query>
     static void
     reassessStrategy( Kokkos::View<Query *, DeviceType> queries,
                       DistributedSearchTree<DeviceType> const &tree,
+                      Kokkos::View<int *, DeviceType> results_offset,
+                      Kokkos::View<double *, DeviceType> distances,
                       Kokkos::View<int *, DeviceType> &indices,
                       Kokkos::View<int *, DeviceType> &offset,
-                      Kokkos::View<double *, DeviceType> &distances );
+                      Kokkos::View<Query *, DeviceType> &bounded_queries );
+
+    // Forward the queries to the ranks given by indices and offset, perform
+    // them on the bottom trees and communicate the results back.  On exit,
+    // the results are grouped by query.
+    template <typename Query>
+    static void
+    performNearestQueries( DistributedSearchTree<DeviceType> const &tree,
+                           Kokkos::View<Query *, DeviceType> queries,
+                           Kokkos::View<int *, DeviceType> &indices,
+                           Kokkos::View<int *, DeviceType> &offset,
+                           Kokkos::View<int *, DeviceType> &ranks,
+                           Kokkos::View<double *, DeviceType> &distances );
 
     template <typename Query>
     static void forwardQueries( Teuchos::RCP<Teuchos::Comm<int> const> comm,
@@ -88,30 +391,131 @@ struct DistributedSearchTreeImpl
         Kokkos::View<int *, DeviceType> &ids,
         Kokkos::View<double *, DeviceType> *distances_ptr = nullptr );
 
+    // Stages of the pipelined spatial queries (see DistributedQueryRequest).
+    // Forward a chunk of queries to the ranks they may have results on
+    // without waiting for the messages to arrive.
+    template <typename Query>
+    static void
+    postQueries( DistributedSearchTree<DeviceType> const &tree,
+                 Teuchos::RCP<Teuchos::Comm<int> const> comm,
+                 Kokkos::View<Query *, DeviceType> queries,
+                 PendingExchange<DeviceType, QueryPacket<Query>> &exchange );
+
+    // Wait for a chunk of forwarded queries, perform them on the bottom tree
+    // and send the results back without waiting for them to arrive.
+    template <typename Query>
+    static void postResults(
+        DistributedSearchTree<DeviceType> const &tree,
+        Teuchos::RCP<Teuchos::Comm<int> const> comm,
+        PendingExchange<DeviceType, QueryPacket<Query>> &query_exchange,
+        PendingExchange<DeviceType, ResultPacket> &result_exchange );
+
+    // Wait for the results of a chunk of queries.  The ids are relative to
+    // the chunk.
+    static void
+    receiveResults( PendingExchange<DeviceType, ResultPacket> &exchange,
+                    Kokkos::View<int *, DeviceType> &indices,
+                    Kokkos::View<int *, DeviceType> &ids,
+                    Kokkos::View<int *, DeviceType> &ranks );
+
+    // Only keep the k nearest results for each query.  They are written in
+    // ascending order of distance.
     template <typename Query>
     static void filterResults( Kokkos::View<Query *, DeviceType> queries,
-                               Kokkos::View<double *, DeviceType> distances,
+                               Kokkos::View<double *, DeviceType> &distances,
                                Kokkos::View<int *, DeviceType> &indices,
                                Kokkos::View<int *, DeviceType> &offset,
                                Kokkos::View<int *, DeviceType> &ranks );
 
+    // Append the results in other_* to the ones passed by reference, query by
+    // query.
+    static void
+    mergeResults( Kokkos::View<int *, DeviceType> &indices,
+                  Kokkos::View<int *, DeviceType> &offset,
+                  Kokkos::View<int *, DeviceType> &ranks,
+                  Kokkos::View<double *, DeviceType> &distances,
+                  Kokkos::View<int *, DeviceType> other_indices,
+                  Kokkos::View<int *, DeviceType> other_offset,
+                  Kokkos::View<int *, DeviceType> other_ranks,
+                  Kokkos::View<double *, DeviceType> other_distances );
+
     template <typename View, typename... OtherViews>
     static void sortResults( View keys, OtherViews... other_views );
 
+    // Same as sortResults() but entries with equal keys keep their relative
+    // order.  The keys must be integers.
+    template <typename View, typename... OtherViews>
+    static void sortResultsStably( View keys, OtherViews... other_views );
+
+    // Order the results by rank of the process that owns the object, then by
+    // index of the object, so that, once grouped by query, they do not depend
+    // on the order in which they were received.
+    template <typename... OtherViews>
+    static void
+    sortResultsByRankAndIndex( Kokkos::View<int *, DeviceType> indices,
+                               Kokkos::View<int *, DeviceType> ranks,
+                               OtherViews... other_views );
+
+    // Same as sortResults() for query ids but in linear time.  offset must
+    // have been computed by countResults() from the same keys.  The results
+    // of a given query come in no particular order, unless the results are
+    // deterministic (see isDeterministic()), in which case they keep their
+    // relative order.
+    template <typename... OtherViews>
+    static void groupResultsByQuery( Kokkos::View<int *, DeviceType> offset,
+                                     Kokkos::View<int *, DeviceType> keys,
+                                     OtherViews... other_views );
+
+    // Rank of the process that sent each import, in the order the
+    // distributor lays them out.
+    static Kokkos::View<int *, DeviceType>
+    getImportRanks( Distributor const &distributor );
+
+    // Append n entries equal to rank.
+    static Kokkos::View<int *, DeviceType>
+    appendRank( Kokkos::View<int *, DeviceType> ranks, int n, int rank );
+
     static void countResults( int n_queries,
                               Kokkos::View<int *, DeviceType> query_ids,
                               Kokkos::View<int *, DeviceType> &offset );
 
-    // NOTE: Would love to pass the distributor as a const reference but
-    // unfortunately the methods for executing the communication plan (e.g.
-    // doPostsAndWaits() in this case) are not declared with the const
-    // qualifier in Tpetra.
+    // NOTE: The distributor is passed by non-const reference because posting
+    // messages keeps track of the pending requests.
     template <typename View>
     static typename std::enable_if<Kokkos::is_view<View>::value>::type
-    sendAcrossNetwork( Tpetra::Distributor &distributor, View exports,
+    sendAcrossNetwork( Distributor &distributor, View exports,
                        typename View::non_const_type imports );
+
+    // Non-blocking counterpart of sendAcrossNetwork() that also sets up the
+    // communication plan.
+    template <typename Packet>
+    static void
+    postAcrossNetwork( Teuchos::RCP<Teuchos::Comm<int> const> comm,
+                       Teuchos::ArrayView<int const> export_ranks,
+                       Kokkos::View<Packet *, DeviceType> exports,
+                       PendingExchange<DeviceType, Packet> &exchange );
+
+    template <typename Packet>
+    static void
+    waitAcrossNetwork( PendingExchange<DeviceType, Packet> &exchange );
 };
 
+/** Whether the results of the queries are reproducible from one run to the
+ * next.  The results of a spatial query are then ordered by rank and index of
+ * the objects and the results of the sorts do not depend on the order in
+ * which the entries come in, at the price of a few more sorts.  This is off
+ * by default.  Set the environment variable DTK_DETERMINISTIC_RESULTS to 1 to
+ * turn it on.  It must be set the same way on all the processes.
+ */
+inline bool isDeterministic()
+{
+    static bool const is_deterministic = []() {
+        char const *env = std::getenv( "DTK_DETERMINISTIC_RESULTS" );
+        return env != nullptr && std::string( env ) != "0";
+    }();
+    return is_deterministic;
+}
+
 template <typename View>
 inline Kokkos::View<typename View::traits::data_type, Kokkos::LayoutRight,
                     typename View::traits::host_mirror_space>
@@ -153,21 +557,53 @@ create_layout_right_mirror_view(
     return src;
 }
 
+// Copy the exports into a contiguous send buffer of the same size, grouped
+// by destination as the distributor expects them.  Each export is made of
+// num_packets consecutive values.
+template <typename ExecutionSpace, typename T, typename MemorySpace>
+void groupExportsByDestination(
+    Distributor const &distributor,
+    Kokkos::View<T const *, MemorySpace, Kokkos::MemoryUnmanaged> exports,
+    Kokkos::View<T *, MemorySpace> buffer, int num_packets )
+{
+    auto const permute = distributor.getPermutation();
+    int const n = exports.extent_int( 0 );
+    DTK_REQUIRE( buffer.extent_int( 0 ) == n );
+    if ( permute.size() == 0 )
+    {
+        Kokkos::deep_copy( buffer, exports );
+        return;
+    }
+    TemporaryViews<MemorySpace> temporaries;
+    auto permute_copy =
+        temporaries.template view<int *>( "permute", permute.size() );
+    Kokkos::deep_copy(
+        permute_copy,
+        Kokkos::View<int const *, Kokkos::HostSpace, Kokkos::MemoryUnmanaged>(
+            permute.getRawPtr(), permute.size() ) );
+    Kokkos::parallel_for( DTK_MARK_REGION( "group_exports_by_destination" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              int const e = i / num_packets;
+                              buffer( permute_copy( e ) * num_packets +
+                                      i % num_packets ) = exports( i );
+                          } );
+    Kokkos::fence();
+}
+
 template <typename DeviceType>
 template <typename View>
 typename std::enable_if<Kokkos::is_view<View>::value>::type
 DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
-    Tpetra::Distributor &distributor, View exports,
+    Distributor &distributor, View exports,
     typename View::non_const_type imports )
 {
+    ScopedTimer timer( "communication" );
+
     DTK_REQUIRE( ( exports.dimension_0() ==
-                   std::accumulate( std::begin( distributor.getLengthsTo() ),
-                                    std::end( distributor.getLengthsTo() ),
-                                    size_t( 0 ) ) ) &&
+                   distributor.getTotalSendLength() ) &&
                  ( imports.dimension_0() ==
-                   std::accumulate( std::begin( distributor.getLengthsFrom() ),
-                                    std::end( distributor.getLengthsFrom() ),
-                                    size_t( 0 ) ) ) &&
+                   distributor.getTotalReceiveLength() ) &&
                  ( exports.dimension_1() == imports.dimension_1() ) &&
                  ( exports.dimension_2() == imports.dimension_2() ) &&
                  ( exports.dimension_3() == imports.dimension_3() ) &&
@@ -181,67 +617,171 @@ DistributedSearchTreeImpl<DeviceType>::sendAcrossNetwork(
                              exports.dimension_5() * exports.dimension_6() *
                              exports.dimension_7();
 
+    using ValueType = typename View::non_const_value_type;
+
+    // Post the device buffers directly when possible instead of staging them
+    // through the host.  This is restricted to contiguous views and to
+    // exchanges that are not node-aware since these copy the values on the
+    // host between their steps.
+    using MemorySpace = typename View::traits::memory_space;
+    bool const is_contiguous =
+        std::is_same<typename View::traits::array_layout,
+                     Kokkos::LayoutRight>::value ||
+        ( View::rank == 1 &&
+          !std::is_same<typename View::traits::array_layout,
+                        Kokkos::LayoutStride>::value );
+    bool const is_device_memory = !std::is_same<
+        MemorySpace,
+        typename View::traits::host_mirror_space::memory_space>::value;
+    if ( is_device_memory && is_contiguous && isCudaAwareMPI() &&
+         !distributor.isNodeAware() )
+    {
+        TemporaryViews<MemorySpace> temporaries;
+        auto send_buffer = temporaries.template view<ValueType *>(
+            "send_buffer", exports.size() );
+        groupExportsByDestination<typename View::traits::execution_space>(
+            distributor,
+            Kokkos::View<ValueType const *, MemorySpace,
+                         Kokkos::MemoryUnmanaged>( exports.data(),
+                                                   exports.size() ),
+            send_buffer, num_packets );
+        distributor.doPostsAndWaits( send_buffer.data(), num_packets,
+                                     imports.data() );
+        return;
+    }
+
     auto exports_host = create_layout_right_mirror_view( exports );
     Kokkos::deep_copy( exports_host, exports );
 
     auto imports_host = create_layout_right_mirror_view( imports );
 
-    distributor.doPostsAndWaits(
-        Teuchos::ArrayView<typename View::const_value_type>(
-            exports_host.data(), exports_host.size() ),
-        num_packets,
-        Teuchos::ArrayView<typename View::non_const_value_type>(
-            imports_host.data(), imports_host.size() ) );
+    TemporaryViews<Kokkos::HostSpace> temporaries;
+    auto send_buffer = temporaries.template view<ValueType *>(
+        "send_buffer", exports_host.size() );
+    groupExportsByDestination<Kokkos::DefaultHostExecutionSpace>(
+        distributor,
+        Kokkos::View<ValueType const *, Kokkos::HostSpace,
+                     Kokkos::MemoryUnmanaged>( exports_host.data(),
+                                               exports_host.size() ),
+        send_buffer, num_packets );
+    distributor.doPostsAndWaits( send_buffer.data(), num_packets,
+                                 imports_host.data() );
 
     Kokkos::deep_copy( imports, imports_host );
 }
 
+template <typename DeviceType>
+template <typename Packet>
+void DistributedSearchTreeImpl<DeviceType>::postAcrossNetwork(
+    Teuchos::RCP<Teuchos::Comm<int> const> comm,
+    Teuchos::ArrayView<int const> export_ranks,
+    Kokkos::View<Packet *, DeviceType> exports,
+    PendingExchange<DeviceType, Packet> &exchange )
+{
+    DTK_REQUIRE( exports.extent( 0 ) == size_t( export_ranks.size() ) );
+
+    exchange.distributor = Teuchos::rcp( new Distributor( comm ) );
+    int const n_imports =
+        exchange.distributor->createFromSends( export_ranks );
+
+    auto exports_host = Kokkos::create_mirror_view( exports );
+    Kokkos::deep_copy( exports_host, exports );
+    exchange.exports_host = Kokkos::View<Packet *, Kokkos::HostSpace>(
+        Kokkos::ViewAllocateWithoutInitializing( "send_buffer" ),
+        exports_host.size() );
+    groupExportsByDestination<Kokkos::DefaultHostExecutionSpace>(
+        *exchange.distributor,
+        Kokkos::View<Packet const *, Kokkos::HostSpace,
+                     Kokkos::MemoryUnmanaged>( exports_host.data(),
+                                               exports_host.size() ),
+        exchange.exports_host, 1 );
+    exchange.imports =
+        Kokkos::View<Packet *, DeviceType>( exports.label(), n_imports );
+    exchange.imports_host = Kokkos::create_mirror_view( exchange.imports );
+
+    exchange.distributor->doPosts( exchange.exports_host.data(), 1,
+                                   exchange.imports_host.data() );
+}
+
+template <typename DeviceType>
+template <typename Packet>
+void DistributedSearchTreeImpl<DeviceType>::waitAcrossNetwork(
+    PendingExchange<DeviceType, Packet> &exchange )
+{
+    DTK_REQUIRE( !exchange.distributor.is_null() );
+
+    exchange.distributor->doWaits();
+    Kokkos::deep_copy( exchange.imports, exchange.imports_host );
+}
+
 template <typename DeviceType>
 template <typename Query>
 void DistributedSearchTreeImpl<DeviceType>::deviseStrategy(
     Kokkos::View<Query *, DeviceType> queries,
     DistributedSearchTree<DeviceType> const &tree,
     Kokkos::View<int *, DeviceType> &indices,
-    Kokkos::View<int *, DeviceType> &offset,
-    Kokkos::View<double *, DeviceType> & )
+    Kokkos::View<int *, DeviceType> &offset )
 {
-    auto const &top_tree = tree._top_tree;
-    auto const &bottom_tree_sizes = tree._bottom_tree_sizes;
-
-    // Find the k nearest local trees.
-    top_tree.query( queries, indices, offset );
+    auto const &top_tree_leaf_sizes = tree._top_tree_leaf_sizes;
+    auto const &top_tree_leaf_ranks = tree._top_tree_leaf_ranks;
+    auto const &top_tree_leaf_n_ranks = tree._top_tree_leaf_n_ranks;
+    auto const &replica_groups = tree._replica_groups;
+    auto const &replica_group_offset = tree._replica_group_offset;
+    auto const &replica_group_ranks = tree._replica_group_ranks;
+    bool const has_replicas = ( replica_groups.extent( 0 ) > 0 );
+
+    // Find the k nearest upper nodes of the local trees.
+    queryTopTree( tree, queries, indices, offset );
+
+    // The leaves of the replicas of a process hold the same objects so only
+    // those of the first member of each replica group are counted.
+    auto const is_counted = KOKKOS_LAMBDA( int leaf )
+    {
+        if ( !has_replicas || top_tree_leaf_n_ranks( leaf ) > 1 )
+            return true;
+        int const r = top_tree_leaf_ranks( leaf );
+        int const g = replica_groups( r );
+        return g < 0 || replica_group_ranks( replica_group_offset( g ) ) == r;
+    };
 
-    // Accumulate total leave count in the local trees until it reaches k which
-    // is the number of neighbors queried for.  Stop if local trees get
+    // Accumulate total leave count in the subtrees until it reaches k which
+    // is the number of neighbors queried for.  Stop if subtrees get
     // empty because it means that they are no more leaves and there is no point
-    // on forwarding queries to leafless trees.
+    // on forwarding queries to leafless trees.  The upper nodes of a given
+    // local tree root disjoint subtrees so their counts add up.
     auto const n_queries = queries.extent( 0 );
-    Kokkos::View<int *, DeviceType> new_offset( offset.label(), n_queries + 1 );
-    Kokkos::deep_copy( new_offset, 0 );
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "bottom_trees_with_required_cumulated_leaves_count" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
         KOKKOS_LAMBDA( int i ) {
             int leaves_count = 0;
+            int n_trees = 0;
             int const n_nearest_neighbors = queries( i )._k;
             for ( int j = offset( i ); j < offset( i + 1 ); ++j )
             {
-                int const bottom_tree_size = bottom_tree_sizes( indices( j ) );
+                int const bottom_tree_size =
+                    top_tree_leaf_sizes( indices( j ) );
                 if ( ( bottom_tree_size == 0 ) ||
                      ( leaves_count >= n_nearest_neighbors ) )
                     break;
-                leaves_count += bottom_tree_size;
-                ++new_offset( i );
+                if ( is_counted( indices( j ) ) )
+                    leaves_count += bottom_tree_size;
+                ++n_trees;
             }
+            new_offset( i ) = n_trees;
         } );
     Kokkos::fence();
 
-    exclusivePrefixSum( new_offset );
+    int const n_indices = exclusivePrefixSum( new_offset );
 
     // Truncate results so that queries will only be forwarded to as many local
     // trees as necessary to find k neighbors.
-    Kokkos::View<int *, DeviceType> new_indices( indices.label(),
-                                                 lastElement( new_offset ) );
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_indices );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "truncate_before_forwarding" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
@@ -253,6 +793,8 @@ void DistributedSearchTreeImpl<DeviceType>::deviseStrategy(
 
     offset = new_offset;
     indices = new_indices;
+
+    mapTopTreeLeavesToRanks( tree, indices, offset );
 }
 
 template <typename DeviceType>
@@ -260,117 +802,149 @@ template <typename Query>
 void DistributedSearchTreeImpl<DeviceType>::reassessStrategy(
     Kokkos::View<Query *, DeviceType> queries,
     DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<int *, DeviceType> results_offset,
+    Kokkos::View<double *, DeviceType> distances,
     Kokkos::View<int *, DeviceType> &indices,
     Kokkos::View<int *, DeviceType> &offset,
-    Kokkos::View<double *, DeviceType> &distances )
+    Kokkos::View<Query *, DeviceType> &bounded_queries )
 {
-    auto const &top_tree = tree._top_tree;
     auto const n_queries = queries.extent( 0 );
 
-    // Determine distance to the farthest neighbor found so far.
-    Kokkos::View<double *, DeviceType> farthest_distances( "distances",
-                                                           n_queries );
-    Kokkos::deep_copy( farthest_distances, 0. );
+    // Determine distance to the farthest neighbor found so far.  If fewer
+    // than k were found, any object closer than the maximum distance of the
+    // query may be missing.
+    Kokkos::View<double *, DeviceType> farthest_distances(
+        Kokkos::ViewAllocateWithoutInitializing( "distances" ), n_queries );
     // NOTE: in principle distances( j ) are arranged in ascending order for
     // offset( i ) <= j < offset( i + 1 ) so max() is not necessary.
-    Kokkos::parallel_for( DTK_MARK_REGION( "most_distant_neighbor_so_far" ),
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "most_distant_neighbor_so_far" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            double farthest_distance = 0.;
+            for ( int j = results_offset( i ); j < results_offset( i + 1 );
+                  ++j )
+                farthest_distance =
+                    KokkosHelpers::max( farthest_distance, distances( j ) );
+            if ( results_offset( i + 1 ) - results_offset( i ) <
+                 queries( i )._k )
+                farthest_distance = queries( i )._max_distance;
+            farthest_distances( i ) = farthest_distance;
+        } );
+    Kokkos::fence();
+
+    // Identify what ranks may have leaves that are within that distance.
+    // The bottom trees are then only searched for the neighbors that are
+    // strictly closer than that, which are the only ones that can make it
+    // into the k nearest.  Most of the ranks find none.
+    Kokkos::View<Within *, DeviceType> within_queries(
+        Kokkos::ViewAllocateWithoutInitializing( "queries" ), n_queries );
+    bounded_queries = Kokkos::View<Query *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( queries.label() ),
+        n_queries );
+    auto const new_queries = bounded_queries;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "bottom_trees_within_that_distance" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            within_queries( i ) =
+                within( queries( i )._geometry, farthest_distances( i ) );
+            new_queries( i ) = queries( i );
+            new_queries( i )._max_distance = farthest_distances( i );
+        } );
+    Kokkos::fence();
+
+    Kokkos::View<int *, DeviceType> searched_ranks = indices;
+    Kokkos::View<int *, DeviceType> searched_offset = offset;
+    queryTopTree( tree, within_queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+
+    // Discard the ranks that were already searched.  There are usually only
+    // a handful of them per query so a linear search is good enough.
+    auto const is_new = KOKKOS_LAMBDA( int i, int j )
+    {
+        for ( int k = searched_offset( i ); k < searched_offset( i + 1 ); ++k )
+            if ( searched_ranks( k ) == indices( j ) )
+                return false;
+        return true;
+    };
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_ranks_not_searched_yet" ),
                           Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
                           KOKKOS_LAMBDA( int i ) {
+                              int n_new = 0;
                               for ( int j = offset( i ); j < offset( i + 1 );
                                     ++j )
-                                  farthest_distances( i ) = KokkosHelpers::max(
-                                      farthest_distances( i ), distances( j ) );
+                                  if ( is_new( i, j ) )
+                                      ++n_new;
+                              new_offset( i ) = n_new;
                           } );
     Kokkos::fence();
 
-    // Identify what ranks may have leaves that are within that distance.
-    Kokkos::View<Within *, DeviceType> within_queries( "queries", n_queries );
+    int const n_indices = exclusivePrefixSum( new_offset );
+
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_indices );
     Kokkos::parallel_for(
-        DTK_MARK_REGION( "bottom_trees_within_that_distance" ),
+        DTK_MARK_REGION( "ranks_not_searched_yet" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
         KOKKOS_LAMBDA( int i ) {
-            within_queries( i ) =
-                within( queries( i )._geometry, farthest_distances( i ) );
+            int count = 0;
+            for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                if ( is_new( i, j ) )
+                    new_indices( new_offset( i ) + count++ ) = indices( j );
         } );
     Kokkos::fence();
 
-    top_tree.query( within_queries, indices, offset );
-    // NOTE: in principle, we could perform within queries on the bottom_tree
-    // rather than nearest queries.
+    offset = new_offset;
+    indices = new_indices;
 }
 
 template <typename DeviceType>
 template <typename Query>
-void DistributedSearchTreeImpl<DeviceType>::queryDispatch(
+void DistributedSearchTreeImpl<DeviceType>::performNearestQueries(
     DistributedSearchTree<DeviceType> const &tree,
     Kokkos::View<Query *, DeviceType> queries,
     Kokkos::View<int *, DeviceType> &indices,
     Kokkos::View<int *, DeviceType> &offset,
-    Kokkos::View<int *, DeviceType> &ranks, Details::NearestPredicateTag,
-    Kokkos::View<double *, DeviceType> *distances_ptr )
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<double *, DeviceType> &distances )
 {
     auto const &bottom_tree = tree._bottom_tree;
     auto comm = tree._comm;
 
-    Kokkos::View<double *, DeviceType> distances( "distances" );
-    if ( distances_ptr )
-        distances = *distances_ptr;
+    ////////////////////////////////////////////////////////////////////////////
+    // Forward queries
+    ////////////////////////////////////////////////////////////////////////////
+    Kokkos::View<int *, DeviceType> ids( "query_ids" );
+    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
+    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+    ////////////////////////////////////////////////////////////////////////////
 
-    // "Strategy" is used to determine what ranks to forward queries to.  In
-    // the 1st pass, the queries are sent to as many ranks as necessary to
-    // guarantee that all k neighbors queried for are found.  In the 2nd pass,
-    // queries are sent again to all ranks that may have a neighbor closer to
-    // the farthest neighbor identified in the 1st pass.
-    //
-    // The current implementation discards the results after the 1st pass and
-    // recompute everything instead of just searching for potential better
-    // neighbors and updating the list.
-
-    // NOTE: compiler would not deduce __range for the braced-init-list but I
-    // got it to work with the static_cast to function pointers.
-    using Strategy = void ( * )( Kokkos::View<Query *, DeviceType>,
-                                 DistributedSearchTree<DeviceType> const &,
-                                 Kokkos::View<int *, DeviceType> &,
-                                 Kokkos::View<int *, DeviceType> &,
-                                 Kokkos::View<double *, DeviceType> & );
-    for ( auto implementStrategy :
-          {static_cast<Strategy>(
-               DistributedSearchTreeImpl<DeviceType>::deviseStrategy ),
-           static_cast<Strategy>(
-               DistributedSearchTreeImpl<DeviceType>::reassessStrategy )} )
+    ////////////////////////////////////////////////////////////////////////////
+    // Perform queries that have been received
+    ////////////////////////////////////////////////////////////////////////////
     {
-        implementStrategy( queries, tree, indices, offset, distances );
-
-        ////////////////////////////////////////////////////////////////////////////
-        // Forward queries
-        ////////////////////////////////////////////////////////////////////////////
-        Kokkos::View<int *, DeviceType> ids( "query_ids" );
-        Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
-        forwardQueries( comm, queries, indices, offset, fwd_queries, ids,
-                        ranks );
-        ////////////////////////////////////////////////////////////////////////////
-
-        ////////////////////////////////////////////////////////////////////////////
-        // Perform queries that have been received
-        ////////////////////////////////////////////////////////////////////////////
-        bottom_tree.query( fwd_queries, indices, offset, distances );
-        ////////////////////////////////////////////////////////////////////////////
-
-        ////////////////////////////////////////////////////////////////////////////
-        // Communicate results back
-        ////////////////////////////////////////////////////////////////////////////
-        communicateResultsBack( comm, indices, offset, ranks, ids, &distances );
-        ////////////////////////////////////////////////////////////////////////////
-
-        ////////////////////////////////////////////////////////////////////////////
-        // Merge results
-        ////////////////////////////////////////////////////////////////////////////
-        int const n_queries = queries.extent_int( 0 );
-        countResults( n_queries, ids, offset );
-        sortResults( ids, indices, ranks, distances );
-        filterResults( queries, distances, indices, offset, ranks );
-        ////////////////////////////////////////////////////////////////////////////
+        ScopedTimer timer( "local query" );
+        if ( !tree._hash_grid.empty() )
+            tree._hash_grid.query( fwd_queries, indices, offset, distances );
+        else
+            bottom_tree.query( fwd_queries, indices, offset, distances );
     }
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Communicate results back
+    ////////////////////////////////////////////////////////////////////////////
+    communicateResultsBack( comm, indices, offset, ranks, ids, &distances );
+    ////////////////////////////////////////////////////////////////////////////
+
+    int const n_queries = queries.extent_int( 0 );
+    countResults( n_queries, ids, offset );
+    groupResultsByQuery( offset, ids, indices, ranks, distances );
 }
 
 template <typename DeviceType>
@@ -380,48 +954,1056 @@ void DistributedSearchTreeImpl<DeviceType>::queryDispatch(
     Kokkos::View<Query *, DeviceType> queries,
     Kokkos::View<int *, DeviceType> &indices,
     Kokkos::View<int *, DeviceType> &offset,
-    Kokkos::View<int *, DeviceType> &ranks, Details::SpatialPredicateTag )
+    Kokkos::View<int *, DeviceType> &ranks, Details::NearestPredicateTag,
+    Kokkos::View<double *, DeviceType> *distances_ptr )
 {
-    auto const &top_tree = tree._top_tree;
-    auto const &bottom_tree = tree._bottom_tree;
-    auto comm = tree._comm;
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    if ( distances_ptr )
+        distances = *distances_ptr;
+
+    if ( tree._halo_width < 0. )
+        performTwoPassNearestQueries( tree, queries, indices, offset, ranks,
+                                      distances );
+    else
+        performHaloNearestQueries( tree, queries, indices, offset, ranks,
+                                   distances );
+
+    if ( distances_ptr )
+        *distances_ptr = distances;
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performTwoPassNearestQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<double *, DeviceType> &distances )
+{
+    // "Strategy" is used to determine what ranks to forward queries to.  In
+    // the 1st pass, the queries are sent to as many ranks as necessary to
+    // guarantee that all k neighbors queried for are found.  In the 2nd pass,
+    // queries are only sent to the ranks that were not searched yet and that
+    // may have a neighbor closer to the farthest neighbor identified in the
+    // 1st pass.  Results from both passes are then merged.
 
     ////////////////////////////////////////////////////////////////////////////
+    // 1st pass
     ////////////////////////////////////////////////////////////////////////////
-    top_tree.query( queries, indices, offset );
+    deviseStrategy( queries, tree, indices, offset );
+    Kokkos::View<int *, DeviceType> searched_ranks = indices;
+    Kokkos::View<int *, DeviceType> searched_offset = offset;
+    performNearestQueries( tree, queries, indices, offset, ranks, distances );
+    filterResults( queries, distances, indices, offset, ranks );
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
-    // Forward queries
+    // 2nd pass
     ////////////////////////////////////////////////////////////////////////////
-    Kokkos::View<int *, DeviceType> ids( "query_ids" );
-    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
-    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+    Kokkos::View<int *, DeviceType> other_indices = searched_ranks;
+    Kokkos::View<int *, DeviceType> other_offset = searched_offset;
+    Kokkos::View<int *, DeviceType> other_ranks( ranks.label() );
+    Kokkos::View<double *, DeviceType> other_distances( distances.label() );
+    Kokkos::View<Query *, DeviceType> bounded_queries( queries.label() );
+    reassessStrategy( queries, tree, offset, distances, other_indices,
+                      other_offset, bounded_queries );
+    performNearestQueries( tree, bounded_queries, other_indices, other_offset,
+                           other_ranks, other_distances );
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
-    // Perform queries that have been received
+    // Merge results
     ////////////////////////////////////////////////////////////////////////////
-    bottom_tree.query( fwd_queries, indices, offset );
+    mergeResults( indices, offset, ranks, distances, other_indices,
+                  other_offset, other_ranks, other_distances );
+    filterResults( queries, distances, indices, offset, ranks );
     ////////////////////////////////////////////////////////////////////////////
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performHaloNearestQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<double *, DeviceType> &distances )
+{
+    Kokkos::View<int *, DeviceType> ids( "query_ids" );
+    Kokkos::View<int *, DeviceType> unresolved( "unresolved" );
+    performHaloQueries( tree, queries, indices, ranks, distances, ids,
+                        unresolved );
 
     ////////////////////////////////////////////////////////////////////////////
-    // Communicate results back
+    // Fall back on the two-pass algorithm for the unresolved queries
     ////////////////////////////////////////////////////////////////////////////
-    communicateResultsBack( comm, indices, offset, ranks, ids );
+    int const n_queries = queries.extent_int( 0 );
+    Kokkos::View<int *, DeviceType> unresolved_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "unresolved_offset" ),
+        n_queries + 1 );
+    Kokkos::deep_copy(
+        Kokkos::subview( unresolved_offset, Kokkos::make_pair( 0, n_queries ) ),
+        unresolved );
+    int const n_unresolved = exclusivePrefixSum( unresolved_offset );
+    Kokkos::View<Query *, DeviceType> unresolved_queries(
+        Kokkos::ViewAllocateWithoutInitializing( queries.label() ),
+        n_unresolved );
+    Kokkos::View<int *, DeviceType> unresolved_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "unresolved_ids" ),
+        n_unresolved );
+    Kokkos::parallel_for( DTK_MARK_REGION( "extract_unresolved_queries" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              if ( unresolved( q ) )
+                              {
+                                  int const j = unresolved_offset( q );
+                                  unresolved_queries( j ) = queries( q );
+                                  unresolved_ids( j ) = q;
+                              }
+                          } );
+    Kokkos::fence();
+
+    Kokkos::View<int *, DeviceType> other_indices( indices.label() );
+    Kokkos::View<int *, DeviceType> other_offset( offset.label() );
+    Kokkos::View<int *, DeviceType> other_ranks( ranks.label() );
+    Kokkos::View<double *, DeviceType> other_distances( distances.label() );
+    performTwoPassNearestQueries( tree, unresolved_queries, other_indices,
+                                  other_offset, other_ranks,
+                                  other_distances );
+
+    Kokkos::View<int *, DeviceType> other_ids(
+        Kokkos::ViewAllocateWithoutInitializing( ids.label() ),
+        other_indices.extent( 0 ) );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "expand_unresolved_ids" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_unresolved ),
+        KOKKOS_LAMBDA( int j ) {
+            for ( int i = other_offset( j ); i < other_offset( j + 1 ); ++i )
+                other_ids( i ) = unresolved_ids( j );
+        } );
+    Kokkos::fence();
     ////////////////////////////////////////////////////////////////////////////
 
     ////////////////////////////////////////////////////////////////////////////
     // Merge results
     ////////////////////////////////////////////////////////////////////////////
-    int const n_queries = queries.extent_int( 0 );
+    indices = concatenate( indices, other_indices );
+    ranks = concatenate( ranks, other_ranks );
+    distances = concatenate( distances, other_distances );
+    ids = concatenate( ids, other_ids );
     countResults( n_queries, ids, offset );
-    sortResults( ids, indices, ranks );
+    groupResultsByQuery( offset, ids, indices, ranks, distances );
+    filterResults( queries, distances, indices, offset, ranks );
     ////////////////////////////////////////////////////////////////////////////
 }
 
-// FIXME: for some reason Kokkos::BinSort::sort() was not const.
-// If https://github.com/kokkos/kokkos/pull/1310 makes it into master in
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performHaloQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<double *, DeviceType> &distances,
+    Kokkos::View<int *, DeviceType> &ids,
+    Kokkos::View<int *, DeviceType> &unresolved )
+{
+    auto comm = tree._comm;
+    int const n_queries = queries.extent_int( 0 );
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Find the process that owns the closest leaf of the top tree
+    ////////////////////////////////////////////////////////////////////////////
+    Kokkos::View<Query *, DeviceType> closest_leaf_queries(
+        Kokkos::ViewAllocateWithoutInitializing( queries.label() ),
+        n_queries );
+    Kokkos::parallel_for( DTK_MARK_REGION( "query_closest_leaf" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              closest_leaf_queries( q ) = queries( q );
+                              closest_leaf_queries( q )._k = 1;
+                          } );
+    Kokkos::fence();
+    Kokkos::View<int *, DeviceType> leaves( "leaves" );
+    Kokkos::View<int *, DeviceType> leaves_offset( "leaves_offset" );
+    queryTopTree( tree, closest_leaf_queries, leaves, leaves_offset );
+
+    // Queries with no leaf to go to, i.e. when the tree is empty, are left to
+    // the fallback.
+    Kokkos::View<int *, DeviceType> offset(
+        Kokkos::ViewAllocateWithoutInitializing( "offset" ), n_queries + 1 );
+    reallocWithoutInitializing( unresolved, n_queries );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_closest_leaves" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              bool const found =
+                                  leaves_offset( q + 1 ) > leaves_offset( q );
+                              offset( q ) = found ? 1 : 0;
+                              unresolved( q ) = found ? 0 : 1;
+                          } );
+    Kokkos::fence();
+    int const n_destinations = exclusivePrefixSum( offset );
+    auto const leaf_ranks = tree._top_tree_leaf_ranks;
+    Kokkos::View<int *, DeviceType> destinations(
+        Kokkos::ViewAllocateWithoutInitializing( "destinations" ),
+        n_destinations );
+    Kokkos::parallel_for( DTK_MARK_REGION( "map_closest_leaves_to_ranks" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              if ( offset( q + 1 ) > offset( q ) )
+                              {
+                                  int const leaf = leaves( leaves_offset( q ) );
+                                  destinations( offset( q ) ) =
+                                      leaf_ranks( leaf );
+                              }
+                          } );
+    Kokkos::fence();
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Forward queries and perform them on the local and halo objects
+    ////////////////////////////////////////////////////////////////////////////
+    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
+    Kokkos::View<int *, DeviceType> fwd_ids( "fwd_ids" );
+    Kokkos::View<int *, DeviceType> fwd_ranks( "fwd_ranks" );
+    forwardQueries( comm, queries, destinations, offset, fwd_queries, fwd_ids,
+                    fwd_ranks );
+
+    Kokkos::View<int *, DeviceType> fwd_indices( "fwd_indices" );
+    Kokkos::View<int *, DeviceType> fwd_offset( "fwd_offset" );
+    Kokkos::View<double *, DeviceType> fwd_distances( "fwd_distances" );
+    tree._extended_tree.query( fwd_queries, fwd_indices, fwd_offset,
+                               fwd_distances );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Communicate results back, or a marker for the unresolved queries
+    ////////////////////////////////////////////////////////////////////////////
+    int const n_fwd_queries = fwd_queries.extent_int( 0 );
+    Box const halo_bounds = tree._halo_bounds;
+    Kokkos::View<int *, DeviceType> export_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "export_offset" ),
+        n_fwd_queries + 1 );
+    Kokkos::View<int *, DeviceType> resolved(
+        Kokkos::ViewAllocateWithoutInitializing( "resolved" ), n_fwd_queries );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "check_halo_covers_neighbors" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const n_found = fwd_offset( q + 1 ) - fwd_offset( q );
+            double radius = 0.;
+            for ( int i = fwd_offset( q ); i < fwd_offset( q + 1 ); ++i )
+                radius = KokkosHelpers::max( radius, fwd_distances( i ) );
+            // with fewer than k neighbors, the halo must hold every object
+            // closer than the maximum distance
+            if ( n_found < fwd_queries( q )._k )
+                radius = fwd_queries( q )._max_distance;
+            Box box;
+            expand( box, fwd_queries( q )._geometry );
+            bool covered = true;
+            for ( int d = 0; d < 3; ++d )
+                covered = covered &&
+                          ( box.minCorner()[d] - radius >=
+                            halo_bounds.minCorner()[d] ) &&
+                          ( box.maxCorner()[d] + radius <=
+                            halo_bounds.maxCorner()[d] );
+            resolved( q ) = covered ? 1 : 0;
+            export_offset( q ) = covered ? n_found : 1;
+        } );
+    Kokkos::fence();
+    int const n_exports = exclusivePrefixSum( export_offset );
+
+    auto const extended_indices = tree._extended_indices;
+    auto const extended_ranks = tree._extended_ranks;
+    Kokkos::View<int *, DeviceType> export_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "export_ranks" ), n_exports );
+    Kokkos::View<HaloResultPacket *, DeviceType> exports(
+        Kokkos::ViewAllocateWithoutInitializing( "results" ), n_exports );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "fill_buffer" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int count = export_offset( q );
+            if ( !resolved( q ) )
+            {
+                export_ranks( count ) = fwd_ranks( q );
+                exports( count ).index = -1;
+                exports( count ).rank = -1;
+                exports( count ).id = fwd_ids( q );
+                exports( count ).distance = 0.;
+                return;
+            }
+            for ( int i = fwd_offset( q ); i < fwd_offset( q + 1 );
+                  ++i, ++count )
+            {
+                int const j = fwd_indices( i );
+                export_ranks( count ) = fwd_ranks( q );
+                exports( count ).index = extended_indices( j );
+                exports( count ).rank = extended_ranks( j );
+                exports( count ).id = fwd_ids( q );
+                exports( count ).distance = fwd_distances( i );
+            }
+        } );
+    Kokkos::fence();
+
+    Distributor distributor( comm );
+    int const n_imports = distributor.createFromSends(
+        Teuchos::ArrayView<int>( export_ranks.data(), n_exports ) );
+    Kokkos::View<HaloResultPacket *, DeviceType> imports(
+        Kokkos::ViewAllocateWithoutInitializing( "results" ), n_imports );
+    sendAcrossNetwork( distributor, exports, imports );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Unpack the results of the resolved queries
+    ////////////////////////////////////////////////////////////////////////////
+    Kokkos::View<int *, DeviceType> import_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "import_offset" ),
+        n_imports + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "flag_unresolved_queries" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              bool const is_resolved =
+                                  ( imports( i ).index >= 0 );
+                              if ( !is_resolved )
+                                  unresolved( imports( i ).id ) = 1;
+                              import_offset( i ) = is_resolved ? 1 : 0;
+                          } );
+    Kokkos::fence();
+    int const n_results = exclusivePrefixSum( import_offset );
+
+    reallocWithoutInitializing( indices, n_results );
+    reallocWithoutInitializing( ranks, n_results );
+    reallocWithoutInitializing( distances, n_results );
+    reallocWithoutInitializing( ids, n_results );
+    Kokkos::parallel_for( DTK_MARK_REGION( "unpack_buffer" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              if ( imports( i ).index < 0 )
+                                  return;
+                              int const j = import_offset( i );
+                              indices( j ) = imports( i ).index;
+                              ranks( j ) = imports( i ).rank;
+                              distances( j ) = imports( i ).distance;
+                              ids( j ) = imports( i ).id;
+                          } );
+    Kokkos::fence();
+    ////////////////////////////////////////////////////////////////////////////
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performQueriesOnOwners(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<Query *, DeviceType> &fwd_queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ids,
+    Kokkos::View<int *, DeviceType> &ranks )
+{
+    queryTopTree( tree, queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+    forwardQueries( tree._comm, queries, indices, offset, fwd_queries, ids,
+                    ranks );
+    queryLocalObjects( tree, fwd_queries, indices, offset );
+}
+
+template <typename DeviceType>
+template <typename Query, typename Values, typename Reducer>
+void DistributedSearchTreeImpl<DeviceType>::performReductions(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries, Values const &values,
+    Reducer const &reducer,
+    Kokkos::View<typename Reducer::value_type *, DeviceType> &results )
+{
+    using Value = typename Reducer::value_type;
+
+    auto comm = tree._comm;
+    int const comm_rank = comm->getRank();
+    int const n_queries = queries.extent( 0 );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    queryTopTree( tree, queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
+    Kokkos::View<int *, DeviceType> ids( "query_ids" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+
+    Kokkos::View<Value *, DeviceType> partial_results( "partial_results" );
+    {
+        ScopedTimer timer( "local reduction" );
+        tree._bottom_tree.reduce( fwd_queries, values, reducer,
+                                  partial_results );
+    }
+
+    // A single value per query and process is sent back.  The values of the
+    // queries that originate from this process bypass the distributor and are
+    // appended after the ones that were received.
+    ScopedTimer timer( "return results" );
+    int const n_fwd_queries = fwd_queries.extent( 0 );
+    TemporaryViews<DeviceType> temporaries;
+    auto export_offset =
+        temporaries.template view<int *>( "export_offset", n_fwd_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_exported_reductions" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            export_offset( q ) = ( ranks( q ) == comm_rank ) ? 0 : 1;
+        } );
+    Kokkos::fence();
+    int const n_exports = exclusivePrefixSum( export_offset );
+    int const n_local = n_fwd_queries - n_exports;
+
+    auto export_ranks =
+        temporaries.template view<int *>( "export_ranks", n_exports );
+    auto exports = temporaries.template view<ReductionPacket<Value> *>(
+        "exports", n_exports );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "fill_reductions_buffer" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            if ( export_offset( q + 1 ) > export_offset( q ) )
+            {
+                int const e = export_offset( q );
+                export_ranks( e ) = ranks( q );
+                exports( e ).value = partial_results( q );
+                exports( e ).id = ids( q );
+            }
+        } );
+    Kokkos::fence();
+
+    Distributor distributor( comm );
+    int const n_imports = distributor.createFromSends(
+        Teuchos::ArrayView<int>( export_ranks.data(), n_exports ) );
+    auto imports = temporaries.template view<ReductionPacket<Value> *>(
+        "imports", n_imports );
+    sendAcrossNetwork( distributor, exports, imports );
+
+    Kokkos::View<Value *, DeviceType> import_values(
+        Kokkos::ViewAllocateWithoutInitializing( "partial_results" ),
+        n_imports + n_local );
+    Kokkos::View<int *, DeviceType> import_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "query_ids" ),
+        n_imports + n_local );
+    Kokkos::parallel_for( DTK_MARK_REGION( "unpack_reductions" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              import_values( i ) = imports( i ).value;
+                              import_ids( i ) = imports( i ).id;
+                          } );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "append_local_reductions" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            if ( export_offset( q + 1 ) == export_offset( q ) )
+            {
+                int const l = n_imports + q - export_offset( q );
+                import_values( l ) = partial_results( q );
+                import_ids( l ) = ids( q );
+            }
+        } );
+    Kokkos::fence();
+
+    // Combine the partial values of each query.
+    countResults( n_queries, import_ids, offset );
+    groupResultsByQuery( offset, import_ids, import_values );
+    reallocWithoutInitializing( results, n_queries );
+    Kokkos::parallel_for( DTK_MARK_REGION( "combine_reductions" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int i ) {
+                              Value value;
+                              reducer.init( value );
+                              for ( int j = offset( i ); j < offset( i + 1 );
+                                    ++j )
+                                  reducer.join( value, import_values( j ) );
+                              results( i ) = value;
+                          } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::performJoin(
+    DistributedSearchTree<DeviceType> const &tree,
+    DistributedSearchTree<DeviceType> const &other,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks )
+{
+    auto comm = tree._comm;
+    DTK_REQUIRE( other._comm->getSize() == comm->getSize() );
+
+    // The local objects of the other tree, ordered by index, are the queries.
+    Kokkos::View<Box *, DeviceType> boxes( "boxes" );
+    Kokkos::View<int *, DeviceType> box_indices( "box_indices" );
+    getLeaves( other._bottom_tree, boxes, box_indices );
+    int const n_queries = boxes.extent( 0 );
+    Kokkos::View<Overlap *, DeviceType> queries(
+        Kokkos::ViewAllocateWithoutInitializing( "queries" ), n_queries );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "make_join_queries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            queries( box_indices( i ) ) = overlap( boxes( i ) );
+        } );
+    Kokkos::fence();
+
+    // Leaves of the top tree that intersect the local bounds of the other
+    // tree.  Only these are tested against the local objects, with a join
+    // rather than by traversing the top tree once per object.
+    Kokkos::View<Overlap *, DeviceType> bounds_query( "bounds_query", 1 );
+    auto bounds_query_host = Kokkos::create_mirror_view( bounds_query );
+    bounds_query_host( 0 ) = overlap( other._bottom_tree.bounds() );
+    Kokkos::deep_copy( bounds_query, bounds_query_host );
+    Kokkos::View<int *, DeviceType> interface_leaves( "interface_leaves" );
+    queryTopTree( tree, bounds_query, interface_leaves, offset );
+    int const n_interface_leaves = interface_leaves.extent( 0 );
+    Kokkos::View<Box *, DeviceType> interface_bounds(
+        Kokkos::ViewAllocateWithoutInitializing( "interface_bounds" ),
+        n_interface_leaves );
+    auto const leaf_bounds = tree._top_tree_leaf_bounds;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "gather_interface_leaves" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_interface_leaves ),
+        KOKKOS_LAMBDA( int i ) {
+            interface_bounds( i ) = leaf_bounds( interface_leaves( i ) );
+        } );
+    Kokkos::fence();
+    BVH<DeviceType>( interface_bounds )
+        .join( other._bottom_tree, indices, offset );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "map_to_top_tree_leaves" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, indices.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            indices( i ) = interface_leaves( indices( i ) );
+        } );
+    Kokkos::fence();
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+
+    // Send each object to the processes whose local domains it intersects.
+    Kokkos::View<int *, DeviceType> ids( "query_ids" );
+    Kokkos::View<Overlap *, DeviceType> fwd_queries( "fwd_queries" );
+    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+
+    // Join the local tree with the objects received.
+    int const n_fwd_queries = fwd_queries.extent( 0 );
+    Kokkos::View<Box *, DeviceType> fwd_boxes(
+        Kokkos::ViewAllocateWithoutInitializing( "fwd_boxes" ),
+        n_fwd_queries );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "extract_forwarded_boxes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            fwd_boxes( i ) = fwd_queries( i )._geometry;
+        } );
+    Kokkos::fence();
+    {
+        ScopedTimer timer( "local join" );
+        tree._bottom_tree.join( BVH<DeviceType>( fwd_boxes ), indices, offset );
+    }
+
+    communicateResultsBack( comm, indices, offset, ranks, ids );
+
+    if ( isDeterministic() )
+        sortResultsByRankAndIndex( indices, ranks, ids );
+    countResults( n_queries, ids, offset );
+    groupResultsByQuery( offset, ids, indices, ranks );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::queryTopTree(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    ScopedTimer timer( "top tree query" );
+
+    performTopTreeQueries( tree, queries, indices, offset );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performTopTreeQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    if ( tree._host_top_tree.empty() )
+    {
+        tree._top_tree.query( queries, indices, offset );
+        return;
+    }
+
+    using HostDeviceType =
+        typename DistributedSearchTree<DeviceType>::HostDeviceType;
+    Kokkos::View<int *, HostDeviceType> indices_host( "indices" );
+    Kokkos::View<int *, HostDeviceType> offset_host( "offset" );
+    tree._host_top_tree.query(
+        Details::copyToDevice( queries, HostDeviceType{} ), indices_host,
+        offset_host );
+    indices = Details::copyToDevice( indices_host, DeviceType{} );
+    offset = Details::copyToDevice( offset_host, DeviceType{} );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::queryLocalObjects(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    ScopedTimer timer( "local query" );
+
+    if ( !tree._structured_grid.empty() )
+        tree._structured_grid.query( queries, indices, offset );
+    else if ( !tree._hash_grid.empty() )
+        tree._hash_grid.query( queries, indices, offset );
+    else
+        tree._bottom_tree.query( queries, indices, offset );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::queryDispatch(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks, Details::SpatialPredicateTag )
+{
+    auto comm = tree._comm;
+
+    ////////////////////////////////////////////////////////////////////////////
+    ////////////////////////////////////////////////////////////////////////////
+    queryTopTree( tree, queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+    bool const share_work = ( tree._helpers_offset.extent( 0 ) > 0 );
+    Kokkos::View<int *, DeviceType> helper_indices( "helper_indices" );
+    Kokkos::View<int *, DeviceType> helper_offset( "helper_offset" );
+    if ( share_work )
+        shareQueries( tree, indices, offset, helper_indices, helper_offset );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Forward queries
+    ////////////////////////////////////////////////////////////////////////////
+    Kokkos::View<int *, DeviceType> ids( "query_ids" );
+    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
+    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Perform queries that have been received
+    ////////////////////////////////////////////////////////////////////////////
+    queryLocalObjects( tree, fwd_queries, indices, offset );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Communicate results back
+    ////////////////////////////////////////////////////////////////////////////
+    communicateResultsBack( comm, indices, offset, ranks, ids );
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Queries dealt to the helpers of overloaded processes
+    ////////////////////////////////////////////////////////////////////////////
+    if ( share_work )
+    {
+        Kokkos::View<int *, DeviceType> helper_ranks( "ranks" );
+        Kokkos::View<int *, DeviceType> helper_ids( "query_ids" );
+        performQueriesOnReplicas( tree, queries, helper_indices, helper_offset,
+                                  helper_ranks, helper_ids );
+        indices = concatenate( indices, helper_indices );
+        ranks = concatenate( ranks, helper_ranks );
+        ids = concatenate( ids, helper_ids );
+    }
+    ////////////////////////////////////////////////////////////////////////////
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Merge results
+    ////////////////////////////////////////////////////////////////////////////
+    int const n_queries = queries.extent_int( 0 );
+    if ( isDeterministic() )
+        sortResultsByRankAndIndex( indices, ranks, ids );
+    countResults( n_queries, ids, offset );
+    groupResultsByQuery( offset, ids, indices, ranks );
+    ////////////////////////////////////////////////////////////////////////////
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::postQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Teuchos::RCP<Teuchos::Comm<int> const> comm,
+    Kokkos::View<Query *, DeviceType> queries,
+    PendingExchange<DeviceType, QueryPacket<Query>> &exchange )
+{
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    queryTopTree( tree, queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+
+    int const n_queries = queries.extent( 0 );
+    int const n_exports = indices.extent( 0 );
+    Kokkos::View<QueryPacket<Query> *, DeviceType> exports(
+        Kokkos::ViewAllocateWithoutInitializing( queries.label() ), n_exports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "post_queries_fill_buffer" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              for ( int i = offset( q ); i < offset( q + 1 );
+                                    ++i )
+                              {
+                                  exports( i ).query = queries( q );
+                                  exports( i ).id = q;
+                              }
+                          } );
+    Kokkos::fence();
+
+    postAcrossNetwork(
+        comm, Teuchos::ArrayView<int const>( indices.data(), n_exports ),
+        exports, exchange );
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::postResults(
+    DistributedSearchTree<DeviceType> const &tree,
+    Teuchos::RCP<Teuchos::Comm<int> const> comm,
+    PendingExchange<DeviceType, QueryPacket<Query>> &query_exchange,
+    PendingExchange<DeviceType, ResultPacket> &result_exchange )
+{
+    waitAcrossNetwork( query_exchange );
+
+    auto const imports = query_exchange.imports;
+    int const n_imports = imports.extent( 0 );
+    Kokkos::View<Query *, DeviceType> fwd_queries(
+        Kokkos::ViewAllocateWithoutInitializing( "fwd_queries" ), n_imports );
+    Kokkos::View<int *, DeviceType> fwd_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "fwd_ids" ), n_imports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "post_results_unpack_queries" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              fwd_queries( i ) = imports( i ).query;
+                              fwd_ids( i ) = imports( i ).id;
+                          } );
+    Kokkos::fence();
+    auto const fwd_ranks = getImportRanks( *query_exchange.distributor );
+    query_exchange = PendingExchange<DeviceType, QueryPacket<Query>>();
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    queryLocalObjects( tree, fwd_queries, indices, offset );
+
+    int const n_exports = offset( n_imports );
+    Kokkos::View<int *, DeviceType> export_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "export_ranks" ), n_exports );
+    Kokkos::View<ResultPacket *, DeviceType> exports(
+        Kokkos::ViewAllocateWithoutInitializing( "results" ), n_exports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "post_results_fill_buffer" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int q ) {
+                              for ( int i = offset( q ); i < offset( q + 1 );
+                                    ++i )
+                              {
+                                  export_ranks( i ) = fwd_ranks( q );
+                                  exports( i ).index = indices( i );
+                                  exports( i ).id = fwd_ids( q );
+                              }
+                          } );
+    Kokkos::fence();
+
+    postAcrossNetwork(
+        comm, Teuchos::ArrayView<int const>( export_ranks.data(), n_exports ),
+        exports, result_exchange );
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::receiveResults(
+    PendingExchange<DeviceType, ResultPacket> &exchange,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &ids,
+    Kokkos::View<int *, DeviceType> &ranks )
+{
+    waitAcrossNetwork( exchange );
+
+    auto const imports = exchange.imports;
+    int const n_imports = imports.extent( 0 );
+    Kokkos::View<int *, DeviceType> import_indices(
+        Kokkos::ViewAllocateWithoutInitializing( "indices" ), n_imports );
+    Kokkos::View<int *, DeviceType> import_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "query_ids" ), n_imports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "receive_results_unpack_buffer" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              import_indices( i ) = imports( i ).index;
+                              import_ids( i ) = imports( i ).id;
+                          } );
+    Kokkos::fence();
+
+    indices = import_indices;
+    ids = import_ids;
+    ranks = getImportRanks( *exchange.distributor );
+    exchange = PendingExchange<DeviceType, ResultPacket>();
+}
+
+// Entries of a followed by the ones of b.
+template <typename View>
+View concatenate( View const &a, View const &b )
+{
+    int const n_a = a.extent( 0 );
+    int const n_b = b.extent( 0 );
+    View c( Kokkos::ViewAllocateWithoutInitializing( a.label() ), n_a + n_b );
+    Kokkos::deep_copy( Kokkos::subview( c, Kokkos::make_pair( 0, n_a ) ), a );
+    Kokkos::deep_copy(
+        Kokkos::subview( c, Kokkos::make_pair( n_a, n_a + n_b ) ), b );
+    return c;
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::getLeaves(
+    BVH<DeviceType> const &tree, Kokkos::View<Box *, DeviceType> &boxes,
+    Kokkos::View<int *, DeviceType> &indices )
+{
+    using Traversal = TreeTraversal<DeviceType>;
+    using Node = typename Traversal::Node;
+
+    int const n = tree.size();
+    reallocWithoutInitializing( boxes, n );
+    reallocWithoutInitializing( indices, n );
+    if ( n == 0 )
+        return;
+
+    // leaf nodes are stored after the n - 1 internal nodes
+    Node const *leaves = Traversal::getRoot( tree ) + n - 1;
+    Kokkos::parallel_for( DTK_MARK_REGION( "get_leaves" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              boxes( i ) = leaves[i].bounding_box;
+                              indices( i ) = Traversal::getIndex( leaves + i );
+                          } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+template <typename Query>
+std::vector<int> DistributedSearchTreeImpl<DeviceType>::countQueriesPerRank(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries )
+{
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    queryTopTree( tree, queries, indices, offset );
+    mapTopTreeLeavesToRanks( tree, indices, offset );
+    Kokkos::View<int *, DeviceType> helper_indices( "helper_indices" );
+    Kokkos::View<int *, DeviceType> helper_offset( "helper_offset" );
+    if ( tree._helpers_offset.extent( 0 ) > 0 )
+        shareQueries( tree, indices, offset, helper_indices, helper_offset );
+
+    int const comm_size = tree._comm->getSize();
+    std::vector<int> local_loads( comm_size, 0 );
+    int const n_pairs = indices.extent( 0 );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    for ( int i = 0; i < n_pairs; ++i )
+        ++local_loads[indices_host( i )];
+    auto helper_indices_host = Kokkos::create_mirror_view( helper_indices );
+    Kokkos::deep_copy( helper_indices_host, helper_indices );
+    for ( int i = 0; i < helper_indices_host.extent_int( 0 ); ++i )
+        ++local_loads[helper_indices_host( i )];
+
+    std::vector<int> loads( comm_size );
+    Teuchos::reduceAll( *tree._comm, Teuchos::REDUCE_SUM, comm_size,
+                        local_loads.data(), loads.data() );
+    return loads;
+}
+
+template <typename DeviceType>
+template <typename Query>
+Kokkos::View<int *, DeviceType>
+DistributedSearchTreeImpl<DeviceType>::findNearestRanks(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries )
+{
+    ScopedTimer timer( "top tree query" );
+
+    int const n_queries = queries.extent( 0 );
+    Kokkos::View<int *, DeviceType> ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "ranks" ), n_queries );
+    if ( tree._top_tree.empty() )
+    {
+        Kokkos::deep_copy( ranks, tree._comm->getRank() );
+        return ranks;
+    }
+
+    using TopTreeQuery = NearestK<Point, 1>;
+    auto const make_top_tree_query = KOKKOS_LAMBDA( int i )
+    {
+        return TopTreeQuery(
+            Details::return_centroid( queries( i )._geometry ) );
+    };
+
+    // The summary of another group is owned by all of its ranks, among
+    // which the queries are dealt.
+    auto const leaf_ranks = tree._top_tree_leaf_ranks;
+    auto const leaf_n_ranks = tree._top_tree_leaf_n_ranks;
+    if ( !tree._host_top_tree.empty() )
+    {
+        Kokkos::View<TopTreeQuery *, DeviceType> top_tree_queries(
+            Kokkos::ViewAllocateWithoutInitializing( "top_tree_queries" ),
+            n_queries );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "make_nearest_rank_queries" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+            KOKKOS_LAMBDA( int i ) {
+                top_tree_queries( i ) = make_top_tree_query( i );
+            } );
+        Kokkos::fence();
+
+        // The tree is not empty so each query has exactly one leaf.
+        Kokkos::View<int *, DeviceType> leaves( "leaves" );
+        Kokkos::View<int *, DeviceType> offset( "offset" );
+        performTopTreeQueries( tree, top_tree_queries, leaves, offset );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "nearest_ranks_from_leaves" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+            KOKKOS_LAMBDA( int i ) {
+                int const leaf = leaves( i );
+                ranks( i ) = leaf_ranks( leaf ) + i % leaf_n_ranks( leaf );
+            } );
+        Kokkos::fence();
+        return ranks;
+    }
+    // The queries are made on demand from the centroids, so only their
+    // sorted copy is stored.
+    tree._top_tree.query( QueryOrdering<DeviceType, TopTreeQuery>(
+                              make_top_tree_query, n_queries,
+                              tree._top_tree.bounds() ),
+                          KOKKOS_LAMBDA( int i, int leaf, double ) {
+                              ranks( i ) =
+                                  leaf_ranks( leaf ) + i % leaf_n_ranks( leaf );
+                          } );
+    return ranks;
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::shareQueries(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &helper_indices,
+    Kokkos::View<int *, DeviceType> &helper_offset )
+{
+    auto const helpers_offset = tree._helpers_offset;
+    auto const helpers = tree._helpers;
+
+    int const n_queries = offset.extent_int( 0 ) - 1;
+    Kokkos::View<int *, DeviceType> owner_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
+    reallocWithoutInitializing( helper_offset, n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_queries_dealt_to_helpers" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int n_owners = 0;
+            int n_helped = 0;
+            for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+            {
+                int const r = indices( i );
+                int const n_helpers =
+                    helpers_offset( r + 1 ) - helpers_offset( r );
+                if ( q % ( n_helpers + 1 ) == 0 )
+                    ++n_owners;
+                else
+                    ++n_helped;
+            }
+            owner_offset( q ) = n_owners;
+            helper_offset( q ) = n_helped;
+        } );
+    Kokkos::fence();
+
+    auto const n_dealt = exclusivePrefixSums( owner_offset, helper_offset );
+    int const n_owner_indices = n_dealt[0];
+    int const n_helper_indices = n_dealt[1];
+
+    Kokkos::View<int *, DeviceType> owner_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_owner_indices );
+    reallocWithoutInitializing( helper_indices, n_helper_indices );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "deal_queries_to_helpers" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int owner_count = owner_offset( q );
+            int helper_count = helper_offset( q );
+            for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+            {
+                int const r = indices( i );
+                int const n_helpers =
+                    helpers_offset( r + 1 ) - helpers_offset( r );
+                int const slot = q % ( n_helpers + 1 );
+                if ( slot == 0 )
+                    owner_indices( owner_count++ ) = r;
+                else
+                    helper_indices( helper_count++ ) =
+                        helpers( helpers_offset( r ) + slot - 1 );
+            }
+        } );
+    Kokkos::fence();
+
+    indices = owner_indices;
+    offset = owner_offset;
+}
+
+template <typename DeviceType>
+template <typename Query>
+void DistributedSearchTreeImpl<DeviceType>::performQueriesOnReplicas(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<Query *, DeviceType> queries,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> offset,
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<int *, DeviceType> &ids )
+{
+    auto comm = tree._comm;
+
+    Kokkos::View<Query *, DeviceType> fwd_queries( "fwd_queries" );
+    forwardQueries( comm, queries, indices, offset, fwd_queries, ids, ranks );
+
+    tree._replica_tree.query( fwd_queries, indices, offset );
+
+    // Report the indices of the objects on their owner.
+    auto const replica_indices = tree._replica_indices;
+    int const n_results = indices.extent( 0 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "map_replica_indices" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_results ),
+                          KOKKOS_LAMBDA( int i ) {
+                              indices( i ) = replica_indices( indices( i ) );
+                          } );
+    Kokkos::fence();
+
+    communicateResultsBack( comm, indices, offset, ranks, ids );
+
+    // The results came from the helpers, report their owners instead.
+    auto const helped_ranks = tree._helped_ranks;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "map_helpers_to_owners" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, ranks.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) { ranks( i ) = helped_ranks( ranks( i ) ); } );
+    Kokkos::fence();
+}
+
+// FIXME: for some reason Kokkos::BinSort::sort() was not const.
+// If https://github.com/kokkos/kokkos/pull/1310 makes it into master in
 // Trilinos, we might want to pass bin_sort by const reference.
 template <typename BinSort>
 void applyPermutations( BinSort & )
@@ -444,6 +2026,14 @@ template <typename View, typename... OtherViews>
 void DistributedSearchTreeImpl<DeviceType>::sortResults(
     View keys, OtherViews... other_views )
 {
+    if ( isDeterministic() )
+    {
+        sortResultsStably( keys, other_views... );
+        return;
+    }
+
+    ScopedTimer timer( "sort results" );
+
     auto const n = keys.extent( 0 );
     // If they were no queries, min_val and max_val values won't change after
     // the parallel reduce (they are initialized to +infty and -infty
@@ -460,11 +2050,369 @@ void DistributedSearchTreeImpl<DeviceType>::sortResults(
                      Kokkos::Impl::min_max_functor<View>( keys ), reducer );
     if ( result.min_val == result.max_val )
         return;
+
+    // Fewer bins cost less to scan but leave longer bins to be sorted.
+    int keys_per_bin = 2;
+    std::string key;
+    if ( Tuning::enabled() )
+    {
+        key = Tuning::key( "sort_results_keys_per_bin", ExecutionSpace::name(),
+                           n );
+        keys_per_bin = Tuning::select( key, {2, 8, 32} );
+    }
+    Kokkos::Timer timer;
+    int const n_bins =
+        KokkosHelpers::max( 1, static_cast<int>( n ) / keys_per_bin );
     Kokkos::BinSort<View, Comp> bin_sort(
-        keys, Comp( n / 2, result.min_val, result.max_val ), true );
+        keys, Comp( n_bins, result.min_val, result.max_val ), true );
     bin_sort.create_permute_vector();
     applyPermutations( bin_sort, other_views... );
     Kokkos::fence();
+    if ( Tuning::enabled() )
+        Tuning::report( key, keys_per_bin, timer.seconds() );
+}
+
+// Move the entries of each view from the positions given by permute.
+template <typename ExecutionSpace, typename Permute>
+void gather( Permute const & )
+{
+    // do nothing
+}
+
+template <typename ExecutionSpace, typename Permute, typename View,
+          typename... OtherViews>
+void gather( Permute const &permute, View view, OtherViews... other_views )
+{
+    DTK_REQUIRE( permute.extent( 0 ) == view.extent( 0 ) );
+    int const n = view.extent( 0 );
+    using ValueType = typename View::non_const_value_type;
+    using DeviceType = typename View::device_type;
+    TemporaryViews<DeviceType> temporaries;
+    auto gathered = temporaries.template view<ValueType *>( view.label(), n );
+    Kokkos::parallel_for( DTK_MARK_REGION( "apply_permutation" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              gathered( i ) = view( permute( i ) );
+                          } );
+    Kokkos::fence();
+    Kokkos::deep_copy( view, gathered );
+    gather<ExecutionSpace>( permute, other_views... );
+}
+
+template <typename DeviceType>
+template <typename View, typename... OtherViews>
+void DistributedSearchTreeImpl<DeviceType>::sortResultsStably(
+    View keys, OtherViews... other_views )
+{
+    ScopedTimer timer( "sort results" );
+
+    using Value = typename View::non_const_value_type;
+    static_assert( std::is_integral<Value>::value,
+                   "The keys of a stable sort must be integers" );
+    using Key = typename std::make_unsigned<Value>::type;
+
+    int const n = keys.extent( 0 );
+    Value min_val = Kokkos::ArithTraits<Value>::max();
+    Kokkos::Experimental::Min<Value> reducer( min_val );
+    Kokkos::parallel_reduce( DTK_MARK_REGION( "min_key" ),
+                             Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                             KOKKOS_LAMBDA( int i, Value &update ) {
+                                 if ( keys( i ) < update )
+                                     update = keys( i );
+                             },
+                             reducer );
+
+    // Shift the keys so that they are nonnegative.  The difference is
+    // computed on unsigned integers so that it cannot overflow.
+    TemporaryViews<DeviceType> temporaries;
+    auto unsigned_keys = temporaries.template view<Key *>( "keys", n );
+    Kokkos::parallel_for( DTK_MARK_REGION( "shift_keys" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              unsigned_keys( i ) =
+                                  static_cast<Key>( keys( i ) ) -
+                                  static_cast<Key>( min_val );
+                          } );
+    Kokkos::fence();
+
+    auto const permute = RadixSort<DeviceType>::sort( unsigned_keys );
+    gather<ExecutionSpace>( permute, other_views... );
+}
+
+template <typename DeviceType>
+template <typename... OtherViews>
+void DistributedSearchTreeImpl<DeviceType>::sortResultsByRankAndIndex(
+    Kokkos::View<int *, DeviceType> indices,
+    Kokkos::View<int *, DeviceType> ranks, OtherViews... other_views )
+{
+    ScopedTimer timer( "sort results" );
+
+    DTK_REQUIRE( ranks.extent( 0 ) == indices.extent( 0 ) );
+
+    int const n = indices.extent( 0 );
+    TemporaryViews<DeviceType> temporaries;
+    auto keys = temporaries.template view<std::uint64_t *>( "keys", n );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "combine_ranks_and_indices" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            keys( i ) = ( static_cast<std::uint64_t>( ranks( i ) ) << 32 ) |
+                        static_cast<std::uint32_t>( indices( i ) );
+        } );
+    Kokkos::fence();
+
+    auto const permute = RadixSort<DeviceType>::sort( keys );
+    gather<ExecutionSpace>( permute, indices, ranks, other_views... );
+}
+
+// Move the entries of each view to the positions given by permute.
+template <typename ExecutionSpace, typename Permute>
+void scatter( Permute const & )
+{
+    // do nothing
+}
+
+template <typename ExecutionSpace, typename Permute, typename View,
+          typename... OtherViews>
+void scatter( Permute const &permute, View view, OtherViews... other_views )
+{
+    DTK_REQUIRE( permute.extent( 0 ) == view.extent( 0 ) );
+    int const n = view.extent( 0 );
+    using ValueType = typename View::non_const_value_type;
+    using DeviceType = typename View::device_type;
+    TemporaryViews<DeviceType> temporaries;
+    auto scattered = temporaries.template view<ValueType *>( view.label(), n );
+    Kokkos::parallel_for( DTK_MARK_REGION( "apply_permutation" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              scattered( permute( i ) ) = view( i );
+                          } );
+    Kokkos::fence();
+    Kokkos::deep_copy( view, scattered );
+    scatter<ExecutionSpace>( permute, other_views... );
+}
+
+template <typename DeviceType>
+template <typename... OtherViews>
+void DistributedSearchTreeImpl<DeviceType>::groupResultsByQuery(
+    Kokkos::View<int *, DeviceType> offset,
+    Kokkos::View<int *, DeviceType> keys, OtherViews... other_views )
+{
+    ScopedTimer timer( "sort results" );
+
+    int const n = keys.extent( 0 );
+    DTK_REQUIRE( lastElement( offset ) == n );
+
+    // The ids are sorted in ascending order so the offsets still hold.
+    if ( isDeterministic() )
+    {
+        sortResultsStably( keys, other_views... );
+        return;
+    }
+
+    // Counting sort: the results of a given query are written from its
+    // offset on, in no particular order.
+    TemporaryViews<DeviceType> temporaries;
+    auto cursor =
+        temporaries.template view<int *>( "cursor", offset.extent( 0 ) );
+    Kokkos::deep_copy( cursor, offset );
+    auto permute = temporaries.template view<int *>( "permute", n );
+    Kokkos::parallel_for( DTK_MARK_REGION( "compute_permutation" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              permute( i ) = Kokkos::atomic_fetch_add(
+                                  &cursor( keys( i ) ), 1 );
+                          } );
+    Kokkos::fence();
+
+    scatter<ExecutionSpace>( permute, other_views... );
+}
+
+template <typename DeviceType>
+Kokkos::View<Box *, DeviceType>
+DistributedSearchTreeImpl<DeviceType>::getNodesBounds(
+    BVH<DeviceType> const &tree, Kokkos::View<int const *, DeviceType> nodes )
+{
+    using Node = typename TreeTraversal<DeviceType>::Node;
+    Node const *root = TreeTraversal<DeviceType>::getRoot( tree );
+
+    int const n = nodes.extent( 0 );
+    Kokkos::View<Box *, DeviceType> bounds(
+        Kokkos::ViewAllocateWithoutInitializing( "bounds" ), n );
+    Kokkos::parallel_for( DTK_MARK_REGION( "get_bounds_of_the_nodes" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                          KOKKOS_LAMBDA( int i ) {
+                              bounds( i ) = root[nodes( i )].bounding_box;
+                          } );
+    Kokkos::fence();
+    return bounds;
+}
+
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType>
+DistributedSearchTreeImpl<DeviceType>::countObjectsInSubtrees(
+    BVH<DeviceType> const &tree, Kokkos::View<int const *, DeviceType> roots,
+    Kokkos::View<int const *, DeviceType> parents )
+{
+    int const n_roots = roots.extent( 0 );
+    Kokkos::View<int *, DeviceType> sizes( "sizes", n_roots );
+    if ( tree.empty() )
+        return sizes;
+
+    int const n_leaves = tree.size();
+    Kokkos::View<int *, DeviceType> subtree(
+        Kokkos::ViewAllocateWithoutInitializing( "subtree" ),
+        2 * n_leaves - 1 );
+    Kokkos::deep_copy( subtree, -1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "flag_roots_of_the_subtrees" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_roots ),
+        KOKKOS_LAMBDA( int k ) { subtree( roots( k ) ) = k; } );
+    Kokkos::fence();
+
+    // The leaves are stored after the n - 1 internal nodes.  Walk up from
+    // each of them until reaching the root of its subtree.
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_objects_in_subtrees" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_leaves ),
+                          KOKKOS_LAMBDA( int i ) {
+                              int node = n_leaves - 1 + i;
+                              while ( subtree( node ) == -1 )
+                                  node = parents( node );
+                              Kokkos::atomic_increment(
+                                  &sizes( subtree( node ) ) );
+                          } );
+    Kokkos::fence();
+    return sizes;
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::mapTopTreeLeavesToRanks(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    ScopedTimer timer( "top tree query" );
+
+    auto const leaf_ranks = tree._top_tree_leaf_ranks;
+    auto const leaf_n_ranks = tree._top_tree_leaf_n_ranks;
+    int const n_queries = offset.extent_int( 0 ) - 1;
+
+    // Only keep the first leaf found for each rank.  The ranks of two leaves
+    // are either the same or do not overlap at all.  There are usually only a
+    // handful of leaves per query so a linear search is good enough.
+    auto const is_first = KOKKOS_LAMBDA( int i, int j )
+    {
+        for ( int k = offset( i ); k < j; ++k )
+            if ( leaf_ranks( indices( k ) ) == leaf_ranks( indices( j ) ) )
+                return false;
+        return true;
+    };
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_distinct_ranks" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int i ) {
+                              int n_ranks = 0;
+                              for ( int j = offset( i ); j < offset( i + 1 );
+                                    ++j )
+                                  if ( is_first( i, j ) )
+                                      n_ranks += leaf_n_ranks( indices( j ) );
+                              new_offset( i ) = n_ranks;
+                          } );
+    Kokkos::fence();
+
+    int const n_indices = exclusivePrefixSum( new_offset );
+
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_indices );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "map_top_tree_leaves_to_ranks" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int count = 0;
+            for ( int j = offset( i ); j < offset( i + 1 ); ++j )
+                if ( is_first( i, j ) )
+                    for ( int r = 0; r < leaf_n_ranks( indices( j ) ); ++r )
+                        new_indices( new_offset( i ) + count++ ) =
+                            leaf_ranks( indices( j ) ) + r;
+        } );
+    Kokkos::fence();
+
+    offset = new_offset;
+    indices = new_indices;
+
+    if ( tree._replica_groups.extent( 0 ) > 0 )
+        pickReplicas( tree, indices, offset );
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::pickReplicas(
+    DistributedSearchTree<DeviceType> const &tree,
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset )
+{
+    auto const replica_groups = tree._replica_groups;
+    auto const group_offset = tree._replica_group_offset;
+    auto const group_ranks = tree._replica_group_ranks;
+    int const comm_rank = tree._comm->getRank();
+    int const n_queries = offset.extent_int( 0 ) - 1;
+
+    // The choice only depends on the group, the calling rank, and the query
+    // so that all the members of a group found for a query end up on the
+    // same process, which is also the one picked in a later pass.
+    auto const pick = KOKKOS_LAMBDA( int i, int r )
+    {
+        int const g = replica_groups( r );
+        if ( g < 0 )
+            return r;
+        if ( replica_groups( comm_rank ) == g )
+            return comm_rank;
+        int const first = group_offset( g );
+        int const n_members = group_offset( g + 1 ) - first;
+        return group_ranks( first + ( comm_rank + i ) % n_members );
+    };
+    auto const is_first = KOKKOS_LAMBDA( int i, int j )
+    {
+        for ( int k = offset( i ); k < j; ++k )
+            if ( pick( i, indices( k ) ) == pick( i, indices( j ) ) )
+                return false;
+        return true;
+    };
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_picked_replicas" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int i ) {
+                              int n_picked = 0;
+                              for ( int j = offset( i ); j < offset( i + 1 );
+                                    ++j )
+                                  if ( is_first( i, j ) )
+                                      ++n_picked;
+                              new_offset( i ) = n_picked;
+                          } );
+    Kokkos::fence();
+
+    int const n_indices = exclusivePrefixSum( new_offset );
+
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_indices );
+    Kokkos::parallel_for( DTK_MARK_REGION( "pick_replicas" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int i ) {
+                              int count = new_offset( i );
+                              for ( int j = offset( i ); j < offset( i + 1 );
+                                    ++j )
+                                  if ( is_first( i, j ) )
+                                      new_indices( count++ ) =
+                                          pick( i, indices( j ) );
+                          } );
+    Kokkos::fence();
+
+    offset = new_offset;
+    indices = new_indices;
 }
 
 template <typename DeviceType>
@@ -472,9 +2420,11 @@ void DistributedSearchTreeImpl<DeviceType>::countResults(
     int n_queries, Kokkos::View<int *, DeviceType> query_ids,
     Kokkos::View<int *, DeviceType> &offset )
 {
+    ScopedTimer timer( "sort results" );
+
     int const nnz = query_ids.extent( 0 );
 
-    Kokkos::realloc( offset, n_queries + 1 );
+    reallocWithoutInitializing( offset, n_queries + 1 );
     Kokkos::deep_copy( offset, 0 );
 
     Kokkos::parallel_for(
@@ -484,7 +2434,31 @@ void DistributedSearchTreeImpl<DeviceType>::countResults(
         } );
     Kokkos::fence();
 
-    exclusivePrefixSum( offset );
+    // The total is the number of results, there is no need to read it back.
+    Kokkos::parallel_scan(
+        DTK_MARK_REGION( "offset_of_the_results_per_query" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries + 1 ),
+        Details::ExclusiveScanFunctor<int, DeviceType>( offset, offset ) );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType>
+DistributedSearchTreeImpl<DeviceType>::getImportRanks(
+    Distributor const &distributor )
+{
+    auto const procs_from = distributor.getProcsFrom();
+    auto const lengths_from = distributor.getLengthsFrom();
+    int const n_imports = distributor.getTotalReceiveLength();
+    Kokkos::View<int *, DeviceType> import_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( "import_ranks" ), n_imports );
+    auto import_ranks_host = Kokkos::create_mirror_view( import_ranks );
+    int count = 0;
+    for ( int i = 0; i < procs_from.size(); ++i )
+        for ( size_t j = 0; j < lengths_from[i]; ++j )
+            import_ranks_host( count++ ) = procs_from[i];
+    Kokkos::deep_copy( import_ranks, import_ranks_host );
+    return import_ranks;
 }
 
 template <typename DeviceType>
@@ -498,54 +2472,105 @@ void DistributedSearchTreeImpl<DeviceType>::forwardQueries(
     Kokkos::View<int *, DeviceType> &fwd_ids,
     Kokkos::View<int *, DeviceType> &fwd_ranks )
 {
-    int const comm_rank = comm->getRank();
+    ScopedTimer timer( "forward queries" );
 
-    Tpetra::Distributor distributor( comm );
+    Distributor distributor( comm );
 
+    int const comm_rank = comm->getRank();
     int const n_queries = queries.extent( 0 );
-    int const n_exports = offset( n_queries );
-    int const n_imports = distributor.createFromSends(
-        Teuchos::ArrayView<int>( indices.data(), n_exports ) );
 
-    Kokkos::View<Query *, DeviceType> exports( queries.label(), n_exports );
-    Kokkos::parallel_for( DTK_MARK_REGION( "forward_queries_fill_buffer" ),
+    // Queries that are to be performed on this process bypass the
+    // distributor and are appended after the ones that were received.
+    TemporaryViews<DeviceType> temporaries;
+    auto export_offset =
+        temporaries.template view<int *>( "export_offset", n_queries + 1 );
+    auto local_offset =
+        temporaries.template view<int *>( "local_offset", n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "forward_queries_count_local" ),
                           Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
                           KOKKOS_LAMBDA( int q ) {
+                              int n_local = 0;
                               for ( int i = offset( q ); i < offset( q + 1 );
                                     ++i )
-                              {
-                                  exports( i ) = queries( q );
-                              }
+                                  if ( indices( i ) == comm_rank )
+                                      ++n_local;
+                              local_offset( q ) = n_local;
+                              export_offset( q ) =
+                                  offset( q + 1 ) - offset( q ) - n_local;
                           } );
     Kokkos::fence();
 
-    Kokkos::View<int *, DeviceType> export_ranks( "export_ranks", n_exports );
-    Kokkos::deep_copy( export_ranks, comm_rank );
-
-    Kokkos::View<int *, DeviceType> import_ranks( "import_ranks", n_imports );
-    sendAcrossNetwork( distributor, export_ranks, import_ranks );
+    auto const n_forwarded = exclusivePrefixSums( export_offset, local_offset );
+    int const n_exports = n_forwarded[0];
+    int const n_local = n_forwarded[1];
 
-    Kokkos::View<int *, DeviceType> export_ids( "export_ids", n_exports );
-    Kokkos::parallel_for( DTK_MARK_REGION( "forward_queries_fill_ids" ),
+    auto export_ranks =
+        temporaries.template view<int *>( "export_ranks", n_exports );
+    Kokkos::parallel_for( DTK_MARK_REGION( "forward_queries_export_ranks" ),
                           Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
                           KOKKOS_LAMBDA( int q ) {
+                              int count = export_offset( q );
                               for ( int i = offset( q ); i < offset( q + 1 );
                                     ++i )
-                              {
-                                  export_ids( i ) = q;
-                              }
+                                  if ( indices( i ) != comm_rank )
+                                      export_ranks( count++ ) = indices( i );
                           } );
     Kokkos::fence();
-    Kokkos::View<int *, DeviceType> import_ids( "import_ids", n_imports );
-    sendAcrossNetwork( distributor, export_ids, import_ids );
 
-    // Send queries across the network
-    Kokkos::View<Query *, DeviceType> imports( queries.label(), n_imports );
+    int const n_imports = distributor.createFromSends(
+        Teuchos::ArrayView<int>( export_ranks.data(), n_exports ) );
+    addCount( "forwarded queries", n_exports );
+
+    Kokkos::View<Query *, DeviceType> import_queries(
+        Kokkos::ViewAllocateWithoutInitializing( queries.label() ),
+        n_imports + n_local );
+    Kokkos::View<int *, DeviceType> import_ids(
+        Kokkos::ViewAllocateWithoutInitializing( "import_ids" ),
+        n_imports + n_local );
+
+    // Send the queries along with their ids across the network in a single
+    // message.
+    auto exports = temporaries.template view<QueryPacket<Query> *>(
+        queries.label(), n_exports );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "forward_queries_fill_buffer" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int count = export_offset( q );
+            int local_count = n_imports + local_offset( q );
+            for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+            {
+                if ( indices( i ) == comm_rank )
+                {
+                    import_queries( local_count ) = queries( q );
+                    import_ids( local_count ) = q;
+                    ++local_count;
+                }
+                else
+                {
+                    exports( count ).query = queries( q );
+                    exports( count ).id = q;
+                    ++count;
+                }
+            }
+        } );
+    Kokkos::fence();
+
+    auto imports = temporaries.template view<QueryPacket<Query> *>(
+        queries.label(), n_imports );
     sendAcrossNetwork( distributor, exports, imports );
 
-    fwd_queries = imports;
+    Kokkos::parallel_for( DTK_MARK_REGION( "forward_queries_unpack_buffer" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_imports ),
+                          KOKKOS_LAMBDA( int i ) {
+                              import_queries( i ) = imports( i ).query;
+                              import_ids( i ) = imports( i ).id;
+                          } );
+    Kokkos::fence();
+
+    fwd_queries = import_queries;
     fwd_ids = import_ids;
-    fwd_ranks = import_ranks;
+    fwd_ranks = appendRank( getImportRanks( distributor ), n_local, comm_rank );
 }
 
 template <typename DeviceType>
@@ -557,80 +2582,221 @@ void DistributedSearchTreeImpl<DeviceType>::communicateResultsBack(
     Kokkos::View<int *, DeviceType> &ids,
     Kokkos::View<double *, DeviceType> *distances_ptr )
 {
-    int const comm_rank = comm->getRank();
+    ScopedTimer timer( "return results" );
 
+    int const comm_rank = comm->getRank();
     int const n_fwd_queries = offset.extent_int( 0 ) - 1;
-    int const n_exports = offset( n_fwd_queries );
-    Kokkos::View<int *, DeviceType> export_ranks( ranks.label(), n_exports );
+
+    // Results of the queries that originate from this process bypass the
+    // distributor and are appended after the ones that were received.  The
+    // other ones are sent as a header per query that found something, with
+    // the id of the query and its number of results, followed by the bare
+    // results.  This saves sending the id along with every result.
+    TemporaryViews<DeviceType> temporaries;
+    auto export_offset =
+        temporaries.template view<int *>( "export_offset", n_fwd_queries + 1 );
+    auto local_offset =
+        temporaries.template view<int *>( "local_offset", n_fwd_queries + 1 );
+    auto header_offset =
+        temporaries.template view<int *>( "header_offset", n_fwd_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_local_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const n_results = offset( q + 1 ) - offset( q );
+            bool const is_local = ( ranks( q ) == comm_rank );
+            local_offset( q ) = is_local ? n_results : 0;
+            export_offset( q ) = is_local ? 0 : n_results;
+            header_offset( q ) = ( !is_local && n_results > 0 ) ? 1 : 0;
+        } );
+    Kokkos::fence();
+
+    auto const n_returned =
+        exclusivePrefixSums( export_offset, local_offset, header_offset );
+    int const n_exports = n_returned[0];
+    int const n_local = n_returned[1];
+    int const n_header_exports = n_returned[2];
+
+    auto export_ranks = temporaries.template view<int *>( ranks.label(),
+                                                         n_exports );
+    auto header_export_ranks =
+        temporaries.template view<int *>( ranks.label(), n_header_exports );
+    auto header_exports = temporaries.template view<ResultCountPacket *>(
+        "headers", n_header_exports );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "setup_communication_plan" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
         KOKKOS_LAMBDA( int q ) {
-            for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+            for ( int i = export_offset( q ); i < export_offset( q + 1 ); ++i )
             {
                 export_ranks( i ) = ranks( q );
             }
+            if ( header_offset( q + 1 ) > header_offset( q ) )
+            {
+                int const h = header_offset( q );
+                header_export_ranks( h ) = ranks( q );
+                header_exports( h ).id = ids( q );
+                header_exports( h ).count =
+                    export_offset( q + 1 ) - export_offset( q );
+            }
         } );
     Kokkos::fence();
 
-    Tpetra::Distributor distributor( comm );
-    int const n_imports = distributor.createFromSends(
-        Teuchos::ArrayView<int>( export_ranks.data(), n_exports ) );
-
-    // export_ranks already has adequate size since it was used as a buffer to
-    // make the new communication plan.
-    Kokkos::deep_copy( export_ranks, comm_rank );
+    Distributor header_distributor( comm );
+    int const n_header_imports = header_distributor.createFromSends(
+        Teuchos::ArrayView<int>( header_export_ranks.data(),
+                                 n_header_exports ) );
+    auto header_imports = temporaries.template view<ResultCountPacket *>(
+        "headers", n_header_imports );
+    sendAcrossNetwork( header_distributor, header_exports, header_imports );
+    auto const header_import_ranks = getImportRanks( header_distributor );
+
+    // Both plans lay out the imports by rank of the sender and, for a given
+    // sender, by query so the results follow the order of the headers.
+    // Knowing how many results come from each process spares the collective
+    // that would otherwise set up the plan.
+    auto header_import_offset = temporaries.template view<int *>(
+        "header_import_offset", n_header_imports + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "count_imported_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_header_imports ),
+        KOKKOS_LAMBDA( int h ) {
+            header_import_offset( h ) = header_imports( h ).count;
+        } );
+    Kokkos::fence();
+    int const n_imports = exclusivePrefixSum( header_import_offset );
+
+    Kokkos::View<int *, DeviceType> import_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_imports + n_local );
+    Kokkos::View<int *, DeviceType> import_ids(
+        Kokkos::ViewAllocateWithoutInitializing( ids.label() ),
+        n_imports + n_local );
+    Kokkos::View<int *, DeviceType> import_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( ranks.label() ),
+        n_imports + n_local );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "expand_headers" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_header_imports ),
+        KOKKOS_LAMBDA( int h ) {
+            for ( int i = header_import_offset( h );
+                  i < header_import_offset( h + 1 ); ++i )
+            {
+                import_ids( i ) = header_imports( h ).id;
+                import_ranks( i ) = header_import_ranks( h );
+            }
+        } );
+    Kokkos::fence();
 
-    Kokkos::View<int *, DeviceType> export_ids( ids.label(), n_exports );
+    auto export_ranks_host = Kokkos::create_mirror_view( export_ranks );
+    Kokkos::deep_copy( export_ranks_host, export_ranks );
+    auto import_ranks_host = Kokkos::create_mirror_view( import_ranks );
+    Kokkos::deep_copy( import_ranks_host, import_ranks );
+    Distributor distributor( comm );
+    distributor.createFromSendsAndRecvs(
+        Teuchos::ArrayView<int const>( export_ranks_host.data(), n_exports ),
+        Teuchos::ArrayView<int const>( import_ranks_host.data(),
+                                       n_imports ) );
+
+    // Sort out local and remote results.
+    auto export_indices =
+        temporaries.template view<int *>( indices.label(), n_exports );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "fill_buffer" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
         KOKKOS_LAMBDA( int q ) {
+            int count = export_offset( q );
+            int local_count = n_imports + local_offset( q );
+            bool const is_local = ( ranks( q ) == comm_rank );
             for ( int i = offset( q ); i < offset( q + 1 ); ++i )
             {
-                export_ids( i ) = ids( q );
+                if ( is_local )
+                {
+                    import_indices( local_count ) = indices( i );
+                    import_ids( local_count ) = ids( q );
+                    import_ranks( local_count ) = comm_rank;
+                    ++local_count;
+                }
+                else
+                {
+                    export_indices( count ) = indices( i );
+                    ++count;
+                }
             }
         } );
     Kokkos::fence();
-    Kokkos::View<int *, DeviceType> export_indices = indices;
-
-    Kokkos::View<int *, DeviceType> import_indices( indices.label(),
-                                                    n_imports );
-    Kokkos::View<int *, DeviceType> import_ranks( ranks.label(), n_imports );
-    Kokkos::View<int *, DeviceType> import_ids( ids.label(), n_imports );
-    sendAcrossNetwork( distributor, export_indices, import_indices );
-    sendAcrossNetwork( distributor, export_ranks, import_ranks );
-    sendAcrossNetwork( distributor, export_ids, import_ids );
-
-    ids = import_ids;
-    ranks = import_ranks;
-    indices = import_indices;
+    sendAcrossNetwork(
+        distributor, export_indices,
+        Kokkos::subview( import_indices, Kokkos::make_pair( 0, n_imports ) ) );
 
     if ( distances_ptr )
     {
         Kokkos::View<double *, DeviceType> &distances = *distances_ptr;
-        Kokkos::View<double *, DeviceType> export_distances = distances;
-        Kokkos::View<double *, DeviceType> import_distances( distances.label(),
-                                                             n_imports );
-        sendAcrossNetwork( distributor, export_distances, import_distances );
+        Kokkos::View<double *, DeviceType> import_distances(
+            Kokkos::ViewAllocateWithoutInitializing( distances.label() ),
+            n_imports + n_local );
+        auto export_distances =
+            temporaries.template view<double *>( distances.label(), n_exports );
+        Kokkos::parallel_for(
+            DTK_MARK_REGION( "fill_buffer" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n_fwd_queries ),
+            KOKKOS_LAMBDA( int q ) {
+                int count = export_offset( q );
+                int local_count = n_imports + local_offset( q );
+                bool const is_local = ( ranks( q ) == comm_rank );
+                for ( int i = offset( q ); i < offset( q + 1 ); ++i )
+                {
+                    if ( is_local )
+                        import_distances( local_count++ ) = distances( i );
+                    else
+                        export_distances( count++ ) = distances( i );
+                }
+            } );
+        Kokkos::fence();
+        sendAcrossNetwork(
+            distributor, export_distances,
+            Kokkos::subview( import_distances,
+                             Kokkos::make_pair( 0, n_imports ) ) );
         distances = import_distances;
     }
+
+    ids = import_ids;
+    ranks = import_ranks;
+    indices = import_indices;
+}
+
+template <typename DeviceType>
+Kokkos::View<int *, DeviceType>
+DistributedSearchTreeImpl<DeviceType>::appendRank(
+    Kokkos::View<int *, DeviceType> ranks, int n, int rank )
+{
+    int const n_ranks = ranks.extent( 0 );
+    Kokkos::View<int *, DeviceType> new_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( ranks.label() ), n_ranks + n );
+    Kokkos::deep_copy(
+        Kokkos::subview( new_ranks, Kokkos::make_pair( 0, n_ranks ) ), ranks );
+    Kokkos::deep_copy( Kokkos::subview( new_ranks, Kokkos::make_pair(
+                                                       n_ranks, n_ranks + n ) ),
+                       rank );
+    return new_ranks;
 }
 
 template <typename DeviceType>
 template <typename Query>
 void DistributedSearchTreeImpl<DeviceType>::filterResults(
     Kokkos::View<Query *, DeviceType> queries,
-    Kokkos::View<double *, DeviceType> distances,
+    Kokkos::View<double *, DeviceType> &distances,
     Kokkos::View<int *, DeviceType> &indices,
     Kokkos::View<int *, DeviceType> &offset,
     Kokkos::View<int *, DeviceType> &ranks )
 {
+    ScopedTimer timer( "sort results" );
+
     int const n_queries = queries.extent_int( 0 );
     // truncated views are prefixed with an underscore
-    Kokkos::View<int *, DeviceType> new_offset( offset.label(), n_queries + 1 );
-    Kokkos::deep_copy( new_offset, 0 );
-
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
     Kokkos::parallel_for( DTK_MARK_REGION( "discard_results" ),
                           Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
                           KOKKOS_LAMBDA( int q ) {
@@ -640,13 +2806,17 @@ void DistributedSearchTreeImpl<DeviceType>::filterResults(
                           } );
     Kokkos::fence();
 
-    exclusivePrefixSum( new_offset );
+    int const n_truncated_results = exclusivePrefixSum( new_offset );
 
-    int const n_truncated_results = lastElement( new_offset );
-    Kokkos::View<int *, DeviceType> new_indices( indices.label(),
-                                                 n_truncated_results );
-    Kokkos::View<int *, DeviceType> new_ranks( ranks.label(),
-                                               n_truncated_results );
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ),
+        n_truncated_results );
+    Kokkos::View<int *, DeviceType> new_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( ranks.label() ),
+        n_truncated_results );
+    Kokkos::View<double *, DeviceType> new_distances(
+        Kokkos::ViewAllocateWithoutInitializing( distances.label() ),
+        n_truncated_results );
 
     using PairIndexDistance = Kokkos::pair<Kokkos::Array<int, 2>, double>;
     struct CompareDistance
@@ -654,8 +2824,14 @@ void DistributedSearchTreeImpl<DeviceType>::filterResults(
         KOKKOS_INLINE_FUNCTION bool operator()( PairIndexDistance const &lhs,
                                                 PairIndexDistance const &rhs )
         {
-            // reverse order (larger distance means lower priority)
-            return lhs.second > rhs.second;
+            // reverse order (larger distance means lower priority).  Ties
+            // are broken by rank, then by index, so that the neighbors do
+            // not depend on the order in which the results came in.
+            if ( lhs.second != rhs.second )
+                return lhs.second > rhs.second;
+            if ( lhs.first[1] != rhs.first[1] )
+                return lhs.first[1] > rhs.first[1];
+            return lhs.first[0] > rhs.first[0];
         }
     };
     using PriorityQueue =
@@ -665,6 +2841,25 @@ void DistributedSearchTreeImpl<DeviceType>::filterResults(
         DTK_MARK_REGION( "truncate_results" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
         KOKKOS_LAMBDA( int q ) {
+            // The nearest neighbor alone is found with a single scan.
+            if ( queries( q )._k == 1 )
+            {
+                if ( offset( q + 1 ) == offset( q ) )
+                    return;
+                int nearest = offset( q );
+                for ( int i = offset( q ) + 1; i < offset( q + 1 ); ++i )
+                    if ( distances( i ) < distances( nearest ) ||
+                         ( distances( i ) == distances( nearest ) &&
+                           ( ranks( i ) < ranks( nearest ) ||
+                             ( ranks( i ) == ranks( nearest ) &&
+                               indices( i ) < indices( nearest ) ) ) ) )
+                        nearest = i;
+                new_indices( new_offset( q ) ) = indices( nearest );
+                new_ranks( new_offset( q ) ) = ranks( nearest );
+                new_distances( new_offset( q ) ) = distances( nearest );
+                return;
+            }
+
             PriorityQueue queue;
             for ( int i = offset( q ); i < offset( q + 1 ); ++i )
                 queue.emplace(
@@ -676,6 +2871,7 @@ void DistributedSearchTreeImpl<DeviceType>::filterResults(
             {
                 new_indices( new_offset( q ) + count ) = queue.top().first[0];
                 new_ranks( new_offset( q ) + count ) = queue.top().first[1];
+                new_distances( new_offset( q ) + count ) = queue.top().second;
                 queue.pop();
                 ++count;
             }
@@ -683,7 +2879,70 @@ void DistributedSearchTreeImpl<DeviceType>::filterResults(
     Kokkos::fence();
     indices = new_indices;
     ranks = new_ranks;
+    distances = new_distances;
+    offset = new_offset;
+}
+
+template <typename DeviceType>
+void DistributedSearchTreeImpl<DeviceType>::mergeResults(
+    Kokkos::View<int *, DeviceType> &indices,
+    Kokkos::View<int *, DeviceType> &offset,
+    Kokkos::View<int *, DeviceType> &ranks,
+    Kokkos::View<double *, DeviceType> &distances,
+    Kokkos::View<int *, DeviceType> other_indices,
+    Kokkos::View<int *, DeviceType> other_offset,
+    Kokkos::View<int *, DeviceType> other_ranks,
+    Kokkos::View<double *, DeviceType> other_distances )
+{
+    DTK_REQUIRE( offset.extent( 0 ) == other_offset.extent( 0 ) );
+
+    int const n_queries = offset.extent_int( 0 ) - 1;
+    Kokkos::View<int *, DeviceType> new_offset(
+        Kokkos::ViewAllocateWithoutInitializing( offset.label() ),
+        n_queries + 1 );
+    Kokkos::parallel_for( DTK_MARK_REGION( "count_merged_results" ),
+                          Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+                          KOKKOS_LAMBDA( int q ) {
+                              new_offset( q ) =
+                                  offset( q + 1 ) - offset( q ) +
+                                  other_offset( q + 1 ) - other_offset( q );
+                          } );
+    Kokkos::fence();
+
+    int const n_results = exclusivePrefixSum( new_offset );
+
+    Kokkos::View<int *, DeviceType> new_indices(
+        Kokkos::ViewAllocateWithoutInitializing( indices.label() ), n_results );
+    Kokkos::View<int *, DeviceType> new_ranks(
+        Kokkos::ViewAllocateWithoutInitializing( ranks.label() ), n_results );
+    Kokkos::View<double *, DeviceType> new_distances(
+        Kokkos::ViewAllocateWithoutInitializing( distances.label() ),
+        n_results );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "merge_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int count = new_offset( q );
+            for ( int i = offset( q ); i < offset( q + 1 ); ++i, ++count )
+            {
+                new_indices( count ) = indices( i );
+                new_ranks( count ) = ranks( i );
+                new_distances( count ) = distances( i );
+            }
+            for ( int i = other_offset( q ); i < other_offset( q + 1 );
+                  ++i, ++count )
+            {
+                new_indices( count ) = other_indices( i );
+                new_ranks( count ) = other_ranks( i );
+                new_distances( count ) = other_distances( i );
+            }
+        } );
+    Kokkos::fence();
+
+    indices = new_indices;
     offset = new_offset;
+    ranks = new_ranks;
+    distances = new_distances;
 }
 
 } // namespace Details
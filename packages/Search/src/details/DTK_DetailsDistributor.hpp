@@ -0,0 +1,510 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_DISTRIBUTOR_HPP
+#define DTK_DETAILS_DISTRIBUTOR_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Teuchos_ArrayView.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_DefaultMpiComm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <mpi.h>
+#if defined( OPEN_MPI ) && OPEN_MPI
+#include <mpi-ext.h> // MPIX_Query_cuda_support
+#endif
+
+#include <algorithm> // is_sorted, sort
+#include <cstdlib>   // getenv
+#include <cstring>   // memcpy
+#include <map>
+#include <numeric> // accumulate, iota, partial_sum
+#include <string>
+#include <utility> // make_pair
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+/** Determine whether the exchanges should be aggregated by node (see
+ * Distributor).  This is off by default.  Set the environment variable
+ * DTK_NODE_AWARE_EXCHANGE to 1 to turn it on.
+ */
+inline bool isNodeAwareExchange()
+{
+    static bool const is_node_aware = []() {
+        char const *env = std::getenv( "DTK_NODE_AWARE_EXCHANGE" );
+        return env != nullptr && std::string( env ) != "0";
+    }();
+    return is_node_aware;
+}
+
+/** Determine whether the MPI library can be handed pointers to device memory
+ * directly (CUDA-aware MPI).  Open MPI is queried at runtime when it supports
+ * it.  Otherwise, or to override the answer, set the environment variable
+ * DTK_CUDA_AWARE_MPI to 1 (or to 0 to force staging through the host).
+ */
+inline bool isCudaAwareMPI()
+{
+    static bool const is_cuda_aware = []() {
+        char const *env = std::getenv( "DTK_CUDA_AWARE_MPI" );
+        if ( env != nullptr )
+            return std::string( env ) != "0";
+#if defined( MPIX_CUDA_AWARE_SUPPORT ) && MPIX_CUDA_AWARE_SUPPORT
+        return MPIX_Query_cuda_support() == 1;
+#else
+        return false;
+#endif
+    }();
+    return is_cuda_aware;
+}
+
+/** Communication plan built directly on top of MPI.  It covers the subset of
+ *  the Tpetra::Distributor interface that DTK relies on, with the same
+ *  semantics: imports are laid out by increasing rank of the process they
+ *  come from and, for a given process, in the order they were exported.
+ *
+ *  The receive counts are discovered with a single MPI_Alltoall and each
+ *  (export, import) pair is described by a contiguous MPI datatype so that
+ *  messages are not limited to INT_MAX bytes.  Exports do not need to be
+ *  grouped by destination.  When they are not, the caller is responsible for
+ *  packing them into a send buffer according to getPermutation() before
+ *  posting, which lets that copy happen in the memory space where the
+ *  exports live.
+ *
+ *  With many processes per node, most messages are small and go from every
+ *  process to every other one.  The node-aware exchange instead routes the
+ *  values in three steps: within the node of the sender to the process in
+ *  charge of the node of the destination, in a single message between these
+ *  two nodes, and within the node of the destination to their destination.
+ *  Each pair of nodes then exchanges at most one message.  The semantics of
+ *  the plan, i.e. the layout of the imports, are the same either way.
+ */
+class Distributor
+{
+  public:
+    Distributor( Teuchos::RCP<Teuchos::Comm<int> const> comm )
+        : Distributor( comm, isNodeAwareExchange() )
+    {
+    }
+
+    //! Same as above but choose whether the exchange is node-aware.
+    Distributor( Teuchos::RCP<Teuchos::Comm<int> const> comm, bool node_aware )
+        : _comm( Teuchos::getRawMpiComm( *comm ) )
+        , _node_aware( node_aware )
+    {
+    }
+
+    /** Build the plan given the rank of the process each export goes to.
+     *  This must be called as a collective.
+     *
+     *  \return The number of imports.
+     */
+    size_t createFromSends( Teuchos::ArrayView<int const> destination_ranks )
+    {
+        ScopedTimer timer( "communication" );
+
+        int comm_size;
+        MPI_Comm_size( ( *_comm )(), &comm_size );
+
+        std::vector<int> const send_counts = countRanks( destination_ranks );
+        std::vector<int> receive_counts( comm_size );
+        _stages.clear();
+        if ( _node_aware )
+            receive_counts = setUpNodeAwareStages( destination_ranks );
+        else
+            MPI_Alltoall( send_counts.data(), 1, MPI_INT,
+                          receive_counts.data(), 1, MPI_INT, ( *_comm )() );
+
+        setUp( destination_ranks, send_counts, receive_counts );
+
+        return _total_receive_length;
+    }
+
+    /** Same as above when the receiving side already knows the rank of the
+     *  process each import comes from, which spares the collective.  Only the
+     *  number of imports from each process matters.  The exchange is never
+     *  node-aware since setting up the routes would require collectives.
+     *
+     *  \return The number of imports.
+     */
+    size_t
+    createFromSendsAndRecvs( Teuchos::ArrayView<int const> destination_ranks,
+                             Teuchos::ArrayView<int const> source_ranks )
+    {
+        _stages.clear();
+        setUp( destination_ranks, countRanks( destination_ranks ),
+               countRanks( source_ranks ) );
+
+        return _total_receive_length;
+    }
+
+    /** Same as above when both sides already know how many values they
+     *  exchange with each process, given as (rank, count) segments by
+     *  increasing rank, e.g. those of another plan.  The exports must be
+     *  grouped by destination in the order of the segments so the plan has
+     *  no permutation.  Nothing is counted or sorted.
+     *
+     *  \return The number of imports.
+     */
+    size_t createFromLengths( Teuchos::ArrayView<int const> procs_to,
+                              Teuchos::ArrayView<size_t const> lengths_to,
+                              Teuchos::ArrayView<int const> procs_from,
+                              Teuchos::ArrayView<size_t const> lengths_from )
+    {
+        DTK_REQUIRE( procs_to.size() == lengths_to.size() );
+        DTK_REQUIRE( procs_from.size() == lengths_from.size() );
+        DTK_REQUIRE( std::is_sorted( procs_to.begin(), procs_to.end() ) );
+        DTK_REQUIRE( std::is_sorted( procs_from.begin(), procs_from.end() ) );
+
+        _stages.clear();
+        _procs_to.assign( procs_to.begin(), procs_to.end() );
+        _lengths_to.assign( lengths_to.begin(), lengths_to.end() );
+        _procs_from.assign( procs_from.begin(), procs_from.end() );
+        _lengths_from.assign( lengths_from.begin(), lengths_from.end() );
+        _total_send_length = std::accumulate(
+            lengths_to.begin(), lengths_to.end(), size_t( 0 ) );
+        _total_receive_length = std::accumulate(
+            lengths_from.begin(), lengths_from.end(), size_t( 0 ) );
+        _permute.clear();
+
+        return _total_receive_length;
+    }
+
+    /** Post the receives and the sends.  Each export and each import is made
+     *  of num_packets consecutive packets.  The exports must be grouped by
+     *  destination (see getPermutation()).  Both buffers may be in device
+     *  memory if the MPI library supports it, unless the exchange is
+     *  node-aware.  They must not be touched before doWaits() returns.
+     *  NOTE: The node-aware exchange is complete when doPosts() returns.
+     */
+    template <typename Packet>
+    void doPosts( Packet const *exports, size_t num_packets, Packet *imports )
+    {
+        DTK_REQUIRE( _requests.empty() );
+
+        if ( isNodeAware() )
+        {
+            forwardThroughNodes( reinterpret_cast<char const *>( exports ),
+                                 num_packets * sizeof( Packet ),
+                                 reinterpret_cast<char *>( imports ) );
+            return;
+        }
+
+        MPI_Type_contiguous( num_packets * sizeof( Packet ), MPI_BYTE,
+                             &_datatype );
+        MPI_Type_commit( &_datatype );
+
+        addCount( "messages sent", _procs_to.size() );
+        addCount( "bytes sent",
+                  _total_send_length * num_packets * sizeof( Packet ) );
+
+        _requests.resize( _procs_from.size() + _procs_to.size() );
+        size_t offset = 0;
+        for ( size_t i = 0; i < _procs_from.size(); ++i )
+        {
+            MPI_Irecv( imports + offset * num_packets, _lengths_from[i],
+                       _datatype, _procs_from[i], tag, ( *_comm )(),
+                       &_requests[i] );
+            offset += _lengths_from[i];
+        }
+        offset = 0;
+        for ( size_t i = 0; i < _procs_to.size(); ++i )
+        {
+            MPI_Isend( const_cast<Packet *>( exports ) + offset * num_packets,
+                       _lengths_to[i], _datatype, _procs_to[i], tag,
+                       ( *_comm )(), &_requests[_procs_from.size() + i] );
+            offset += _lengths_to[i];
+        }
+    }
+
+    //! Wait for the messages posted by doPosts() to complete.
+    void doWaits()
+    {
+        if ( _requests.empty() )
+            return;
+        MPI_Waitall( _requests.size(), _requests.data(), MPI_STATUSES_IGNORE );
+        _requests.clear();
+        MPI_Type_free( &_datatype );
+    }
+
+    template <typename Packet>
+    void doPostsAndWaits( Packet const *exports, size_t num_packets,
+                          Packet *imports )
+    {
+        doPosts( exports, num_packets, imports );
+        doWaits();
+    }
+
+    /** Position of each export in the send buffer, or an empty view if the
+     *  exports are already grouped by destination.
+     */
+    Teuchos::ArrayView<int const> getPermutation() const { return _permute; }
+
+    Teuchos::ArrayView<int const> getProcsTo() const { return _procs_to; }
+    Teuchos::ArrayView<size_t const> getLengthsTo() const
+    {
+        return _lengths_to;
+    }
+    Teuchos::ArrayView<int const> getProcsFrom() const { return _procs_from; }
+    Teuchos::ArrayView<size_t const> getLengthsFrom() const
+    {
+        return _lengths_from;
+    }
+    size_t getTotalSendLength() const { return _total_send_length; }
+    size_t getTotalReceiveLength() const { return _total_receive_length; }
+
+    //! Whether the values are routed through the nodes (see above).
+    bool isNodeAware() const { return !_stages.empty(); }
+
+  private:
+    struct StageTag
+    {
+    };
+
+    Distributor( StageTag,
+                 Teuchos::RCP<Teuchos::OpaqueWrapper<MPI_Comm> const> comm )
+        : _comm( comm )
+        , _node_aware( false )
+    {
+    }
+
+    // One step of the node-aware exchange.  The values to send are taken
+    // from the values received at the previous step, in the order given by
+    // gather.
+    struct Stage
+    {
+        Teuchos::RCP<Distributor> distributor;
+        std::vector<int> gather;
+    };
+
+    // Route the exports through the nodes and return the number of imports
+    // from each process.  The route of every export is followed once here
+    // with its origin, so that the layout of the imports can be restored
+    // after the last step.
+    std::vector<int>
+    setUpNodeAwareStages( Teuchos::ArrayView<int const> destination_ranks )
+    {
+        MPI_Comm const comm = ( *_comm )();
+        int comm_rank;
+        MPI_Comm_rank( comm, &comm_rank );
+        int comm_size;
+        MPI_Comm_size( comm, &comm_size );
+
+        // Identify each node by the lowest rank of its processes.
+        MPI_Comm node_comm;
+        MPI_Comm_split_type( comm, MPI_COMM_TYPE_SHARED, comm_rank,
+                             MPI_INFO_NULL, &node_comm );
+        int leader = comm_rank;
+        MPI_Bcast( &leader, 1, MPI_INT, 0, node_comm );
+        MPI_Comm_free( &node_comm );
+        std::vector<int> leaders( comm_size );
+        MPI_Allgather( &leader, 1, MPI_INT, leaders.data(), 1, MPI_INT,
+                       comm );
+
+        std::map<int, std::vector<int>> processes_by_leader;
+        for ( int rank = 0; rank < comm_size; ++rank )
+            processes_by_leader[leaders[rank]].push_back( rank );
+        std::vector<std::vector<int>> node_processes;
+        std::vector<int> nodes( comm_size );
+        for ( auto const &processes : processes_by_leader )
+        {
+            for ( int rank : processes.second )
+                nodes[rank] = node_processes.size();
+            node_processes.push_back( processes.second );
+        }
+
+        // The values going from node a to node b are gathered on the process
+        // of a in charge of b before they are sent to the process of b in
+        // charge of a.
+        auto const next_hop = [&]( int step, int origin,
+                                   int destination ) -> int {
+            int const a = nodes[origin];
+            int const b = nodes[destination];
+            if ( step == 2 || a == b )
+                return destination;
+            if ( step == 0 )
+                return node_processes[a][b % node_processes[a].size()];
+            return node_processes[b][a % node_processes[b].size()];
+        };
+
+        // Origin rank, position among the exports of the origin, and
+        // destination rank of the values held by this process.
+        int const n_exports = destination_ranks.size();
+        std::vector<int> routes( 3 * n_exports );
+        for ( int i = 0; i < n_exports; ++i )
+        {
+            routes[3 * i] = comm_rank;
+            routes[3 * i + 1] = i;
+            routes[3 * i + 2] = destination_ranks[i];
+        }
+        for ( int step = 0; step < 3; ++step )
+        {
+            int const n_values = routes.size() / 3;
+            std::vector<int> hops( n_values );
+            for ( int i = 0; i < n_values; ++i )
+                hops[i] = next_hop( step, routes[3 * i], routes[3 * i + 2] );
+
+            Stage stage;
+            stage.distributor =
+                Teuchos::rcp( new Distributor( StageTag(), _comm ) );
+            int const n_received = stage.distributor->createFromSends(
+                Teuchos::ArrayView<int const>( hops.data(), hops.size() ) );
+            auto const permute = stage.distributor->getPermutation();
+            stage.gather.resize( n_values );
+            for ( int i = 0; i < n_values; ++i )
+                stage.gather[permute.empty() ? i : permute[i]] = i;
+
+            std::vector<int> send_buffer( 3 * n_values );
+            for ( int i = 0; i < n_values; ++i )
+                std::copy( &routes[3 * stage.gather[i]],
+                           &routes[3 * stage.gather[i]] + 3,
+                           &send_buffer[3 * i] );
+            routes.resize( 3 * n_received );
+            stage.distributor->doPostsAndWaits( send_buffer.data(), 3,
+                                                routes.data() );
+            _stages.push_back( stage );
+        }
+
+        // The imports are sorted by origin and, for a given origin, by
+        // position among its exports.
+        int const n_imports = routes.size() / 3;
+        std::vector<int> order( n_imports );
+        std::iota( order.begin(), order.end(), 0 );
+        std::sort( order.begin(), order.end(), [&]( int i, int j ) {
+            return std::make_pair( routes[3 * i], routes[3 * i + 1] ) <
+                   std::make_pair( routes[3 * j], routes[3 * j + 1] );
+        } );
+        _import_positions.resize( n_imports );
+        std::vector<int> receive_counts( comm_size, 0 );
+        for ( int i = 0; i < n_imports; ++i )
+        {
+            _import_positions[order[i]] = i;
+            ++receive_counts[routes[3 * i]];
+        }
+        return receive_counts;
+    }
+
+    // Exchange values of packet_size bytes through the stages of the
+    // node-aware exchange.
+    void forwardThroughNodes( char const *exports, size_t packet_size,
+                              char *imports )
+    {
+        // The exports are grouped by destination in the send buffer but the
+        // routes follow the order they were exported in.
+        std::vector<char> values( _total_send_length * packet_size );
+        for ( size_t i = 0; i < _total_send_length; ++i )
+            std::memcpy( &values[i * packet_size],
+                         exports +
+                             ( _permute.empty() ? i : _permute[i] ) *
+                                 packet_size,
+                         packet_size );
+
+        for ( auto const &stage : _stages )
+        {
+            std::vector<char> send_buffer( values.size() );
+            for ( size_t i = 0; i < stage.gather.size(); ++i )
+                std::memcpy( &send_buffer[i * packet_size],
+                             &values[stage.gather[i] * packet_size],
+                             packet_size );
+            values.resize( stage.distributor->getTotalReceiveLength() *
+                           packet_size );
+            stage.distributor->doPostsAndWaits(
+                send_buffer.data(), packet_size, values.data() );
+        }
+
+        for ( size_t i = 0; i < _import_positions.size(); ++i )
+            std::memcpy( imports + _import_positions[i] * packet_size,
+                         &values[i * packet_size], packet_size );
+    }
+
+    std::vector<int> countRanks( Teuchos::ArrayView<int const> ranks ) const
+    {
+        int comm_size;
+        MPI_Comm_size( ( *_comm )(), &comm_size );
+
+        std::vector<int> counts( comm_size, 0 );
+        for ( int rank : ranks )
+        {
+            DTK_REQUIRE( rank >= 0 && rank < comm_size );
+            ++counts[rank];
+        }
+        return counts;
+    }
+
+    void setUp( Teuchos::ArrayView<int const> destination_ranks,
+                std::vector<int> const &send_counts,
+                std::vector<int> const &receive_counts )
+    {
+        int const comm_size = send_counts.size();
+
+        _procs_to.clear();
+        _lengths_to.clear();
+        _procs_from.clear();
+        _lengths_from.clear();
+        for ( int rank = 0; rank < comm_size; ++rank )
+        {
+            if ( send_counts[rank] > 0 )
+            {
+                _procs_to.push_back( rank );
+                _lengths_to.push_back( send_counts[rank] );
+            }
+            if ( receive_counts[rank] > 0 )
+            {
+                _procs_from.push_back( rank );
+                _lengths_from.push_back( receive_counts[rank] );
+            }
+        }
+        _total_send_length = destination_ranks.size();
+        _total_receive_length =
+            std::accumulate( receive_counts.begin(), receive_counts.end(), 0 );
+
+        // Position of each export in the send buffer, where the exports are
+        // grouped by destination in increasing rank order.  A stable counting
+        // sort keeps the exports to a given process in their original order.
+        _permute.clear();
+        if ( !std::is_sorted( destination_ranks.begin(),
+                              destination_ranks.end() ) )
+        {
+            std::vector<int> offset( comm_size + 1, 0 );
+            std::partial_sum( send_counts.begin(), send_counts.end(),
+                              offset.begin() + 1 );
+            _permute.resize( destination_ranks.size() );
+            for ( int i = 0; i < destination_ranks.size(); ++i )
+                _permute[i] = offset[destination_ranks[i]]++;
+        }
+    }
+
+    static int constexpr tag = 1729;
+    Teuchos::RCP<Teuchos::OpaqueWrapper<MPI_Comm> const> _comm;
+    bool _node_aware;
+    std::vector<int> _procs_to;
+    std::vector<size_t> _lengths_to;
+    std::vector<int> _procs_from;
+    std::vector<size_t> _lengths_from;
+    size_t _total_send_length = 0;
+    size_t _total_receive_length = 0;
+    std::vector<int> _permute;
+    std::vector<Stage> _stages;
+    std::vector<int> _import_positions;
+    std::vector<MPI_Request> _requests;
+    MPI_Datatype _datatype;
+};
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
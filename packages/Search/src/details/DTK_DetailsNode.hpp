@@ -17,15 +17,35 @@
 
 namespace DataTransferKit
 {
-struct Node
+/**
+ * Nodes of the hierarchy are stored contiguously in a single array and refer
+ * to each other by their position in that array rather than by address.  This
+ * keeps the node small and makes the tree relocatable (it can be deep copied
+ * between memory spaces without any fix-up).
+ *
+ * For an internal node, the pair holds the positions of its left and right
+ * children.  For a leaf node, the first element is -1 and the second one is
+ * the index of the object it bounds.
+ *
+ * The rope is the position of the node to visit next when the subtree rooted
+ * at this node has been processed during a depth-first traversal and allows
+ * to traverse the tree without a stack.  It is -1 when there is no such node.
+ *
+ * The bounding volume is a double precision Box unless the hierarchy was
+ * built with single precision coordinates.
+ */
+template <typename BoundingVolume>
+struct BasicNode
 {
     KOKKOS_INLINE_FUNCTION
-    Node() = default;
+    BasicNode() = default;
 
-    Node *parent = nullptr;
-    Kokkos::pair<Node *, Node *> children = {nullptr, nullptr};
-    Box bounding_box;
+    Kokkos::pair<int, int> children = {-1, -1};
+    int rope = -1;
+    BoundingVolume bounding_box;
 };
+
+using Node = BasicNode<Box>;
 } // namespace DataTransferKit
 
 #endif
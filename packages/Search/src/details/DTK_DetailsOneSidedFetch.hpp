@@ -0,0 +1,215 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_ONE_SIDED_FETCH_HPP
+#define DTK_DETAILS_ONE_SIDED_FETCH_HPP
+
+#include <DTK_DBC.hpp>
+#include <DTK_Statistics.hpp>
+
+#include <Teuchos_ArrayView.hpp>
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_DefaultMpiComm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <mpi.h>
+
+#include <cstdlib> // getenv
+#include <cstring> // memcpy
+#include <map>
+#include <string>
+#include <vector>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+/** Whether the values are fetched with one-sided communication (see
+ *  OneSidedFetch) instead of a Distributor.  This is off by default.  Set the
+ *  environment variable DTK_ONE_SIDED_FETCH to 1 to turn it on.  It must be
+ *  set the same way on all the processes.
+ */
+inline bool isOneSidedFetch()
+{
+    static bool const is_one_sided = []() {
+        char const *env = std::getenv( "DTK_ONE_SIDED_FETCH" );
+        return env != nullptr && std::string( env ) != "0";
+    }();
+    return is_one_sided;
+}
+
+/** Read values owned by other processes with MPI one-sided communication.
+ *  Each process exposes its values in a window and reads the ones it needs
+ *  with a single MPI_Get per process it reads from, through an indexed
+ *  datatype built once from the requested indices.  A fetch is a single
+ *  fence epoch: there is no handshake and no receive to match, and the
+ *  owners of the values do not need to know who reads them.
+ *
+ *  The windows live as long as the object, one per size of the values that
+ *  have been fetched.  Creating a window and freeing it are collectives, so
+ *  all the processes must fetch values of the same size in the same order
+ *  and destroy the object together.
+ */
+class OneSidedFetch
+{
+  public:
+    /** The i-th value to read is the one at indices[i] on process ranks[i].
+     *  The first n_exposed local values are exposed to the other processes.
+     */
+    OneSidedFetch( Teuchos::RCP<Teuchos::Comm<int> const> comm,
+                   Teuchos::ArrayView<int const> ranks,
+                   Teuchos::ArrayView<int const> indices, size_t n_exposed )
+        : _comm( Teuchos::getRawMpiComm( *comm ) )
+        , _n_exposed( n_exposed )
+    {
+        DTK_REQUIRE( ranks.size() == indices.size() );
+
+        int comm_size;
+        MPI_Comm_size( ( *_comm )(), &comm_size );
+
+        // Group the requests by rank with a stable counting sort.
+        std::vector<int> counts( comm_size, 0 );
+        for ( int rank : ranks )
+        {
+            DTK_REQUIRE( rank >= 0 && rank < comm_size );
+            ++counts[rank];
+        }
+        std::vector<int> offset( comm_size + 1, 0 );
+        for ( int rank = 0; rank < comm_size; ++rank )
+        {
+            offset[rank + 1] = offset[rank] + counts[rank];
+            if ( counts[rank] > 0 )
+            {
+                _procs.push_back( rank );
+                _lengths.push_back( counts[rank] );
+            }
+        }
+        _positions.resize( ranks.size() );
+        _indices.resize( ranks.size() );
+        for ( int i = 0; i < ranks.size(); ++i )
+        {
+            int const k = offset[ranks[i]]++;
+            _positions[k] = i;
+            _indices[k] = indices[i];
+        }
+    }
+
+    OneSidedFetch( OneSidedFetch const & ) = delete;
+    OneSidedFetch &operator=( OneSidedFetch const & ) = delete;
+
+    ~OneSidedFetch()
+    {
+        int finalized;
+        MPI_Finalized( &finalized );
+        if ( finalized )
+            return;
+        for ( auto &window : _windows )
+        {
+            for ( auto &datatype : window.second.datatypes )
+                MPI_Type_free( &datatype );
+            MPI_Win_free( &window.second.win );
+        }
+    }
+
+    //! Number of local values that the other processes may read.
+    size_t getNumberOfExposedValues() const { return _n_exposed; }
+
+    //! Number of values read, i.e. the number of requests.
+    size_t getNumberOfRequests() const { return _positions.size(); }
+
+    /** Read the requested values.  The exposed values and the values read are
+     *  made of packet_size bytes each and stored contiguously, the latter in
+     *  the order of the requests.  This must be called as a collective.
+     */
+    void fetch( void const *exposed, size_t packet_size, void *values )
+    {
+        ScopedTimer timer( "communication" );
+
+        Window &window = getWindow( packet_size );
+        if ( _n_exposed > 0 )
+            std::memcpy( window.base, exposed, _n_exposed * packet_size );
+
+        addCount( "messages sent", _procs.size() );
+        addCount( "bytes sent", _positions.size() * packet_size );
+
+        std::vector<char> buffer( _positions.size() * packet_size );
+        MPI_Win_fence( MPI_MODE_NOPRECEDE, window.win );
+        size_t offset = 0;
+        for ( size_t i = 0; i < _procs.size(); ++i )
+        {
+            MPI_Get( buffer.data() + offset * packet_size,
+                     _lengths[i] * packet_size, MPI_BYTE, _procs[i], 0, 1,
+                     window.datatypes[i], window.win );
+            offset += _lengths[i];
+        }
+        MPI_Win_fence( MPI_MODE_NOSUCCEED, window.win );
+
+        char *out = static_cast<char *>( values );
+        for ( size_t k = 0; k < _positions.size(); ++k )
+            std::memcpy( out + _positions[k] * packet_size,
+                         buffer.data() + k * packet_size, packet_size );
+    }
+
+  private:
+    struct Window
+    {
+        MPI_Win win;
+        char *base;
+        // Where the values requested from each process are in its window.
+        std::vector<MPI_Datatype> datatypes;
+    };
+
+    Window &getWindow( size_t packet_size )
+    {
+        auto it = _windows.find( packet_size );
+        if ( it != _windows.end() )
+            return it->second;
+
+        Window &window = _windows[packet_size];
+        MPI_Win_allocate( _n_exposed * packet_size, 1, MPI_INFO_NULL,
+                          ( *_comm )(), &window.base, &window.win );
+
+        size_t offset = 0;
+        for ( size_t i = 0; i < _procs.size(); ++i )
+        {
+            std::vector<MPI_Aint> displacements( _lengths[i] );
+            for ( int j = 0; j < _lengths[i]; ++j )
+                displacements[j] =
+                    static_cast<MPI_Aint>( _indices[offset + j] ) *
+                    packet_size;
+            MPI_Datatype datatype;
+            MPI_Type_create_hindexed_block( _lengths[i], packet_size,
+                                            displacements.data(), MPI_BYTE,
+                                            &datatype );
+            MPI_Type_commit( &datatype );
+            window.datatypes.push_back( datatype );
+            offset += _lengths[i];
+        }
+        return window;
+    }
+
+    Teuchos::RCP<Teuchos::OpaqueWrapper<MPI_Comm> const> _comm;
+    size_t _n_exposed;
+    // Processes to read from and number of values read from each of them.
+    std::vector<int> _procs;
+    std::vector<int> _lengths;
+    // The requests grouped by process: their position in the values read
+    // and the index of the value on the process.
+    std::vector<int> _positions;
+    std::vector<int> _indices;
+    std::map<size_t, Window> _windows;
+};
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
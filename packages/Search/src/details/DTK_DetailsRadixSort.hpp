@@ -0,0 +1,156 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_RADIX_SORT_HPP
+#define DTK_DETAILS_RADIX_SORT_HPP
+
+#include <DTK_DetailsUtils.hpp> // iota, exclusivePrefixSum
+
+#include <Kokkos_Macros.hpp>
+#include <Kokkos_Parallel.hpp>
+#include <Kokkos_Parallel_Reduce.hpp>
+#include <Kokkos_View.hpp>
+
+#include <type_traits>
+#include <utility> // swap
+
+namespace DataTransferKit
+{
+namespace Details
+{
+
+/** Tags to select the algorithm used to sort the Morton codes.  BinSort
+ * relies on Kokkos::BinSort with as many bins as half the number of codes and
+ * suffers from poor load balance when the codes are clustered, which is the
+ * usual case on locally refined meshes.  RadixSort is a least significant
+ * digit radix sort whose cost only depends on the number of codes and on the
+ * number of bits that actually differ between them.
+ */
+struct BinSortTag
+{
+};
+struct RadixSortTag
+{
+};
+
+template <typename DeviceType>
+struct RadixSort
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    // Number of bits of the key processed at each pass.
+    static int constexpr radix_bits = 4;
+    static int constexpr radix = 1 << radix_bits;
+    // The keys are split into blocks of that many consecutive entries whose
+    // digits are counted and scattered sequentially by a single thread, which
+    // keeps the sort stable.
+    static int constexpr block_size = 256;
+
+    /** Sort the keys in ascending order.  Equal keys keep their relative
+     * order.
+     *
+     * @return The permutation indices, i.e. the position of each sorted key
+     * in the original view.
+     */
+    template <typename KeyType>
+    static Kokkos::View<size_t *, DeviceType>
+    sort( Kokkos::View<KeyType *, DeviceType> keys )
+    {
+        static_assert( std::is_unsigned<KeyType>::value,
+                       "RadixSort only handles unsigned integer keys" );
+
+        int const n = keys.extent( 0 );
+
+        Kokkos::View<size_t *, DeviceType> permute(
+            Kokkos::ViewAllocateWithoutInitializing( "permute" ), n );
+        iota( permute );
+        if ( n < 2 )
+            return permute;
+
+        // Digits that are the same for all the keys do not need to be sorted.
+        KeyType varying_bits = 0;
+        Kokkos::parallel_reduce(
+            DTK_MARK_REGION( "find_bits_that_differ_between_keys" ),
+            Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+            KOKKOS_LAMBDA( int i, KeyType &partial_bits ) {
+                partial_bits |= keys( i ) ^ keys( 0 );
+            },
+            Kokkos::Experimental::BOr<KeyType>( varying_bits ) );
+
+        int const n_blocks = ( n + block_size - 1 ) / block_size;
+        // Counts are stored digit by digit so that the exclusive scan yields
+        // the position of the first key of each block for a given digit.
+        Kokkos::View<int *, DeviceType> digit_offset( "digit_offset",
+                                                      radix * n_blocks + 1 );
+
+        auto keys_in = keys;
+        auto keys_out = cloneWithoutInitializingNorCopying( keys );
+        auto permute_in = permute;
+        auto permute_out = cloneWithoutInitializingNorCopying( permute );
+
+        for ( int shift = 0; shift < static_cast<int>( 8 * sizeof( KeyType ) );
+              shift += radix_bits )
+        {
+            if ( ( ( varying_bits >> shift ) & ( radix - 1 ) ) == 0 )
+                continue;
+
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "count_digits" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_blocks ),
+                KOKKOS_LAMBDA( int b ) {
+                    int count[radix] = {};
+                    int const first = b * block_size;
+                    int const last =
+                        ( first + block_size < n ) ? first + block_size : n;
+                    for ( int i = first; i < last; ++i )
+                        ++count[( keys_in( i ) >> shift ) & ( radix - 1 )];
+                    for ( int d = 0; d < radix; ++d )
+                        digit_offset( d * n_blocks + b ) = count[d];
+                } );
+            Kokkos::fence();
+
+            exclusivePrefixSum( digit_offset );
+
+            Kokkos::parallel_for(
+                DTK_MARK_REGION( "scatter_keys" ),
+                Kokkos::RangePolicy<ExecutionSpace>( 0, n_blocks ),
+                KOKKOS_LAMBDA( int b ) {
+                    int position[radix];
+                    for ( int d = 0; d < radix; ++d )
+                        position[d] = digit_offset( d * n_blocks + b );
+                    int const first = b * block_size;
+                    int const last =
+                        ( first + block_size < n ) ? first + block_size : n;
+                    for ( int i = first; i < last; ++i )
+                    {
+                        int const j = position[( keys_in( i ) >> shift ) &
+                                               ( radix - 1 )]++;
+                        keys_out( j ) = keys_in( i );
+                        permute_out( j ) = permute_in( i );
+                    }
+                } );
+            Kokkos::fence();
+
+            std::swap( keys_in, keys_out );
+            std::swap( permute_in, permute_out );
+        }
+
+        if ( keys_in.data() != keys.data() )
+            Kokkos::deep_copy( keys, keys_in );
+
+        return permute_in;
+    }
+};
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
@@ -42,6 +42,10 @@ class Stack
     // Capacity
     KOKKOS_INLINE_FUNCTION bool empty() const { return _c.empty(); }
     KOKKOS_INLINE_FUNCTION size_type size() const { return _c.size(); }
+    KOKKOS_INLINE_FUNCTION size_type capacity() const
+    {
+        return _c.capacity();
+    }
 
     // Element access
     KOKKOS_INLINE_FUNCTION reference &top() { return _c.back(); }
@@ -0,0 +1,218 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_DETAILS_STACK_TRAVERSAL_HPP
+#define DTK_DETAILS_STACK_TRAVERSAL_HPP
+
+#include "DTK_ConfigDefs.hpp"
+
+#include <DTK_Box.hpp>
+#include <DTK_DetailsContainers.hpp>
+#include <DTK_DetailsPriorityQueue.hpp>
+#include <DTK_DetailsTreeTraversal.hpp> // CompareNearestDistance
+#include <DTK_DetailsUtils.hpp>         // exclusivePrefixSum, lastElement
+#include <DTK_LinearBVH.hpp>            // QueryOrdering
+#include <DTK_Predicates.hpp>
+
+#include <Kokkos_Pair.hpp>
+#include <Kokkos_View.hpp>
+
+#include <cmath> // sqrt
+#include <type_traits>
+
+namespace DataTransferKit
+{
+namespace Details
+{
+/** Queries against the hierarchies that store their nodes in a layout of
+ *  their own, e.g. WideBVH or QuantizedBVH, and traverse them with an
+ *  explicit stack.  Their traversal is an object, copied to the device, with
+ *  the member functions
+ *
+ *    template <typename Predicate, typename Insert>
+ *    int spatialQuery( Predicate const &pred, Insert const &insert ) const;
+ *
+ *  that calls insert( index ) for every object that satisfies the predicate
+ *  and returns their number, and
+ *
+ *    int nearestQuery( Point const &point, int k,
+ *                      double max_distance_squared,
+ *                      Kokkos::pair<int, double> *buffer ) const;
+ *
+ *  that writes the k nearest objects along with their squared distance into
+ *  the buffer, sorted by increasing distance, and returns their number.
+ */
+using NearestHeap =
+    PriorityQueue<Kokkos::pair<int, double>, CompareNearestDistance,
+                  UnmanagedStaticVector<Kokkos::pair<int, double>>>;
+
+// Insert into the heap of the k nearest objects found so far one that is
+// closer than the radius, and tighten the radius once there are k of them.
+KOKKOS_INLINE_FUNCTION
+void insertNearest( NearestHeap &heap, double &radius, int k, int index,
+                    double distance )
+{
+    if ( (int)heap.size() < k )
+    {
+        heap.push( Kokkos::make_pair( index, distance ) );
+        if ( (int)heap.size() == k )
+            radius = heap.top().second;
+    }
+    else
+    {
+        heap.popPush( Kokkos::make_pair( index, distance ) );
+        radius = heap.top().second;
+    }
+}
+
+// Sort the nearest objects found in the buffer of the heap and return how
+// many there are.
+// NOTE: Messing with the underlying container invalidates the state of the
+// PriorityQueue, which is not used anymore.
+KOKKOS_INLINE_FUNCTION
+int sortNearest( NearestHeap &heap )
+{
+    sortHeap( heap.data(), heap.data() + heap.size(), heap.valueComp() );
+    return heap.size();
+}
+
+// Same as BoundingVolumeHierarchy::query() with views of results for spatial
+// predicates that are not modified by FirstHit or CountOnly, over size
+// objects within bounds.  The objects are counted during a first traversal
+// and stored during a second one.
+template <typename DeviceType, typename Traversal, typename Query>
+void stackTraversalQuery( Traversal const &traversal, Box const &bounds,
+                          int size, Kokkos::View<Query *, DeviceType> queries,
+                          Kokkos::View<int *, DeviceType> &indices,
+                          Kokkos::View<int *, DeviceType> &offset )
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "nearest predicates also report distances" );
+    static_assert( !Details::StopsAtFirstHit<Query>::value &&
+                       Details::ReportsResults<Query>::value,
+                   "FirstHit and CountOnly are not supported" );
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    int const n_queries = queries.extent( 0 );
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::deep_copy( offset, 0 );
+    if ( size == 0 )
+    {
+        reallocWithoutInitializing( indices, 0 );
+        return;
+    }
+
+    QueryOrdering<DeviceType, Query> const ordering( queries, bounds );
+    auto const permute = ordering._permute;
+    auto const sorted_queries = ordering._queries;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "stack_traversal:count_spatial_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            offset( permute( i ) ) =
+                traversal.spatialQuery( sorted_queries( i ), []( int ) {} );
+        } );
+    Kokkos::fence();
+
+    reallocWithoutInitializing( indices, exclusivePrefixSum( offset ) );
+
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "stack_traversal:fill_spatial_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int position = offset( permute( i ) );
+            traversal.spatialQuery( sorted_queries( i ),
+                                    [&position, indices]( int index ) {
+                                        indices( position++ ) = index;
+                                    } );
+        } );
+    Kokkos::fence();
+}
+
+// Same as above with the distances for nearest predicates.
+template <typename DeviceType, typename Traversal, typename Query>
+void stackTraversalQuery( Traversal const &traversal, Box const &bounds,
+                          int size, Kokkos::View<Query *, DeviceType> queries,
+                          Kokkos::View<int *, DeviceType> &indices,
+                          Kokkos::View<int *, DeviceType> &offset,
+                          Kokkos::View<double *, DeviceType> &distances )
+{
+    static_assert( std::is_same<typename Query::Tag,
+                                Details::NearestPredicateTag>::value,
+                   "distances are only reported for nearest predicates" );
+    using ExecutionSpace = typename DeviceType::execution_space;
+
+    int const n_queries = queries.extent( 0 );
+    reallocWithoutInitializing( offset, n_queries + 1 );
+    Kokkos::deep_copy( offset, 0 );
+    if ( size == 0 )
+    {
+        reallocWithoutInitializing( indices, 0 );
+        reallocWithoutInitializing( distances, 0 );
+        return;
+    }
+
+    // Room for as many neighbors as each query asks for, up to the number of
+    // objects.  The queries that find fewer of them are compacted afterwards.
+    Kokkos::View<int *, DeviceType> best_offset(
+        Kokkos::ViewAllocateWithoutInitializing( "best_offset" ),
+        n_queries + 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "stack_traversal:nearest_capacities" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            int const k = queries( q )._k;
+            best_offset( q ) = ( k < 0 ? 0 : ( k < size ? k : size ) );
+        } );
+    Kokkos::fence();
+    int const n_best = exclusivePrefixSum( best_offset );
+    Kokkos::View<Kokkos::pair<int, double> *, DeviceType> best(
+        Kokkos::ViewAllocateWithoutInitializing( "best" ), n_best );
+
+    QueryOrdering<DeviceType, Query> const ordering( queries, bounds );
+    auto const permute = ordering._permute;
+    auto const sorted_queries = ordering._queries;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "stack_traversal:nearest_queries" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            int const q = permute( i );
+            int const k = best_offset( q + 1 ) - best_offset( q );
+            if ( k == 0 )
+                return;
+            auto const &query = sorted_queries( i );
+            offset( q ) = traversal.nearestQuery(
+                query._geometry, k, squareMaxDistance( query._max_distance ),
+                best.data() + best_offset( q ) );
+        } );
+    Kokkos::fence();
+
+    int const n_results = exclusivePrefixSum( offset );
+    reallocWithoutInitializing( indices, n_results );
+    reallocWithoutInitializing( distances, n_results );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "stack_traversal:compact_nearest_results" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_queries ),
+        KOKKOS_LAMBDA( int q ) {
+            for ( int j = 0; j < offset( q + 1 ) - offset( q ); ++j )
+            {
+                auto const &neighbor = best( best_offset( q ) + j );
+                indices( offset( q ) + j ) = neighbor.first;
+                distances( offset( q ) + j ) = std::sqrt( neighbor.second );
+            }
+        } );
+    Kokkos::fence();
+}
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
@@ -16,16 +16,65 @@
 
 #include <DTK_Box.hpp>
 #include <DTK_DetailsNode.hpp>
+#include <DTK_DetailsRadixSort.hpp> // RadixSortTag, BinSortTag
 #include <DTK_KokkosHelpers.hpp> // clz, min. max
+#include <DTK_Point.hpp>
+#include <DTK_Sphere.hpp>
 
 #include <Kokkos_Macros.hpp>
 #include <Kokkos_Pair.hpp>
 #include <Kokkos_View.hpp>
 
+#include <cstddef> // size_t
+#include <cstdint> // uint64_t
+
 namespace DataTransferKit
 {
+/** Tags to select the space-filling curve along which objects and queries
+ * are sorted.  Both curves visit the octants of the scene recursively, so
+ * that the common prefix of two codes describes the smallest octant that
+ * holds both points.  Unlike the Z-order curve, which jumps across the scene
+ * between octants, the Hilbert curve always moves to an adjacent one.
+ * Consecutive objects or queries are therefore closer to each other, at the
+ * price of a few more operations per code.
+ */
+struct ZOrderCurveTag
+{
+};
+struct HilbertCurveTag
+{
+};
+
 namespace Details
 {
+/**
+ * Points given by their coordinates in a (n_points, dim) view, with dim at
+ * most three.  The missing coordinates of points in lower dimension are zero.
+ * This lets the hierarchy be built directly from the coordinates of the user
+ * rather than from a copy of them as an array of points.
+ */
+template <typename DeviceType>
+struct PointCoordinates
+{
+    using execution_space = typename DeviceType::execution_space;
+
+    // Number of points, so that it stands in for a view of points.
+    KOKKOS_INLINE_FUNCTION
+    std::size_t extent( int ) const { return coordinates.extent( 0 ); }
+
+    KOKKOS_INLINE_FUNCTION
+    Point operator()( int i ) const
+    {
+        int const dim = coordinates.extent_int( 1 );
+        Point p = {{0., 0., 0.}};
+        for ( int d = 0; d < dim; ++d )
+            p[d] = coordinates( i, d );
+        return p;
+    }
+
+    Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType> coordinates;
+};
+
 /**
  * This structure contains all the functions used to build the BVH. All the
  * functions are static.
@@ -36,35 +85,227 @@ struct TreeConstruction
   public:
     using ExecutionSpace = typename DeviceType::execution_space;
 
+    // The objects may be given as boxes, points, or spheres, or as the
+    // coordinates of points.  The leaf nodes are assigned the smallest
+    // axis-aligned box that encloses their object.
     static void calculateBoundingBoxOfTheScene(
         Kokkos::View<Box const *, DeviceType> bounding_boxes,
         Box &scene_bounding_box );
 
+    static void calculateBoundingBoxOfTheScene(
+        Kokkos::View<Point const *, DeviceType> points,
+        Box &scene_bounding_box );
+
+    static void calculateBoundingBoxOfTheScene(
+        Kokkos::View<Sphere const *, DeviceType> spheres,
+        Box &scene_bounding_box );
+
+    static void
+    calculateBoundingBoxOfTheScene( PointCoordinates<DeviceType> const &points,
+                                    Box &scene_bounding_box );
+
     // to assign the Morton code for a given object, we use the centroid point
     // of its bounding box, and express it relative to the bounding box of the
     // scene.
     static void
     assignMortonCodes( Kokkos::View<Box const *, DeviceType> bounding_boxes,
                        Kokkos::View<unsigned int *, DeviceType> morton_codes,
-                       Box const &scene_bounding_box );
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                       Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( Kokkos::View<Point const *, DeviceType> points,
+                       Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( Kokkos::View<Point const *, DeviceType> points,
+                       Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( Kokkos::View<Sphere const *, DeviceType> spheres,
+                       Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( Kokkos::View<Sphere const *, DeviceType> spheres,
+                       Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( PointCoordinates<DeviceType> const &points,
+                       Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    static void
+    assignMortonCodes( PointCoordinates<DeviceType> const &points,
+                       Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box,
+                       ZOrderCurveTag = ZOrderCurveTag{} );
+
+    // The centroids are sorted along the Z-order curve unless another curve
+    // is selected.
+    static void
+    assignMortonCodes( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                       Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box, HilbertCurveTag );
+
+    static void
+    assignMortonCodes( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                       Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                       Box const &scene_bounding_box, HilbertCurveTag );
 
     // NOTE returns the permutation indices **and** sorts the morton codes
+    // The radix sort is used unless BinSortTag is passed as second argument.
     static Kokkos::View<size_t *, DeviceType>
     sortObjects( Kokkos::View<unsigned int *, DeviceType> morton_codes );
 
+    static Kokkos::View<size_t *, DeviceType>
+    sortObjects( Kokkos::View<std::uint64_t *, DeviceType> morton_codes );
+
+    static Kokkos::View<size_t *, DeviceType>
+    sortObjects( Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                 RadixSortTag );
+
+    static Kokkos::View<size_t *, DeviceType>
+    sortObjects( Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                 RadixSortTag );
+
+    static Kokkos::View<size_t *, DeviceType>
+    sortObjects( Kokkos::View<unsigned int *, DeviceType> morton_codes,
+                 BinSortTag );
+
+    static Kokkos::View<size_t *, DeviceType>
+    sortObjects( Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                 BinSortTag );
+
     static void
     initializeLeafNodes( Kokkos::View<size_t const *, DeviceType> indices,
                          Kokkos::View<Box const *, DeviceType> bounding_boxes,
                          Kokkos::View<Node *, DeviceType> leaf_nodes );
 
-    static Node *generateHierarchy(
+    static void
+    initializeLeafNodes( Kokkos::View<size_t const *, DeviceType> indices,
+                         Kokkos::View<Point const *, DeviceType> points,
+                         Kokkos::View<Node *, DeviceType> leaf_nodes );
+
+    static void
+    initializeLeafNodes( Kokkos::View<size_t const *, DeviceType> indices,
+                         Kokkos::View<Sphere const *, DeviceType> spheres,
+                         Kokkos::View<Node *, DeviceType> leaf_nodes );
+
+    static void
+    initializeLeafNodes( Kokkos::View<size_t const *, DeviceType> indices,
+                         PointCoordinates<DeviceType> const &points,
+                         Kokkos::View<Node *, DeviceType> leaf_nodes );
+
+    // The n - 1 internal nodes are stored first in the array, followed by the
+    // n leaf nodes.  The root of the hierarchy is always at position 0.
+    // Position of the parent of each node is written into parents, except for
+    // the root whose entry is left untouched.  The ropes are computed as well.
+    static void generateHierarchy(
         Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
-        Kokkos::View<Node *, DeviceType> leaf_nodes,
-        Kokkos::View<Node *, DeviceType> internal_nodes );
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents );
 
+    static void generateHierarchy(
+        Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents );
+
+    static void calculateBoundingBoxes(
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int const *, DeviceType> parents );
+
+    // Same hierarchy as generateHierarchy() followed by
+    // calculateBoundingBoxes(), built in a single pass from the leaves toward
+    // the root and without recording the parents.  The leaf nodes must have
+    // been initialized.  Requires at least two objects.
+    static void generateHierarchyBottomUp(
+        Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes );
+
+    static void generateHierarchyBottomUp(
+        Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes );
+
+    // Optional refinement pass to run after the bounding boxes have been
+    // computed.  Walks the hierarchy toward the root and, for every internal
+    // node, looks for the topology of the small treelet rooted there that
+    // minimizes the surface area heuristic (SAH) cost.  See "Fast Parallel
+    // Construction of High-Quality Bounding Volume Hierarchies" by Karras and
+    // Aila.  Parents and ropes are updated accordingly.
+    static void restructureTreelets(
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents );
+
+    // Compute the ropes from the parent-child relationships.  Unlike the
+    // ropes computed in generateHierarchy(), this does not assume that the
+    // leaves are ordered from left to right.
+    static void
+    computeRopes( Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+                  Kokkos::View<int const *, DeviceType> parents );
+
+    // Used to refit an existing hierarchy.  Leaf nodes are assigned the new
+    // bounding box of the object they already point to.
+    static void
+    refitLeafNodes( Kokkos::View<Box const *, DeviceType> bounding_boxes,
+                    Kokkos::View<Node *, DeviceType> leaf_nodes );
+
+    // Recover the positions of the parents from the parent-child
+    // relationships.  The entry of the root is left untouched.
+    static void computeParents(
+        Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents );
+
+    // Copy the nodes, rounding their bounding boxes outward to single
+    // precision.
+    static void roundNodesOutward(
+        Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<BasicNode<FloatBox> *, DeviceType> float_nodes );
+
+    // Copy single precision nodes back into double precision nodes.
+    static void
+    widenNodes( Kokkos::View<BasicNode<FloatBox> const *, DeviceType> nodes,
+                Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes );
+
+    // Used to build several independent hierarchies at once.  The objects of
+    // the ith tree are the bounding boxes from offsets( i ) to
+    // offsets( i + 1 ) - 1.  The 30-bit Morton code of each object is computed
+    // relative to the bounding box of its own tree and prefixed by the index
+    // of that tree, so that sorting the codes groups the objects tree by tree.
+    static void assignSegmentedMortonCodes(
+        Kokkos::View<Box const *, DeviceType> bounding_boxes,
+        Kokkos::View<int const *, DeviceType> offsets,
+        Kokkos::View<std::uint64_t *, DeviceType> morton_codes );
+
+    // The hierarchy generated from the sorted segmented Morton codes contains
+    // a subtree for each tree.  Copy it to internal_and_leaf_nodes, starting
+    // at position node_offsets( i ), with positions and object indices
+    // relative to the tree as if it had been built on its own.
     static void
-    calculateBoundingBoxes( Kokkos::View<Node *, DeviceType> leaf_nodes,
-                            Kokkos::View<Node *, DeviceType> internal_nodes );
+    splitForest( Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+                 Kokkos::View<int const *, DeviceType> offsets,
+                 Kokkos::View<Node const *, DeviceType> forest_nodes,
+                 Kokkos::View<int const *, DeviceType> node_offsets,
+                 Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes );
+
+    // Expected cost of traversing the hierarchy according to the surface area
+    // heuristic, normalized by the surface area of the root.
+    static double computeSAHCost(
+        Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes );
 
     KOKKOS_INLINE_FUNCTION
     static int
@@ -88,6 +329,27 @@ struct TreeConstruction
         return clz( morton_codes[i] ^ morton_codes[j] );
     }
 
+    KOKKOS_INLINE_FUNCTION
+    static int
+    commonPrefix( Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+                  int i, int j )
+    {
+        using KokkosHelpers::clz;
+        using KokkosHelpers::clz64;
+
+        int const n = morton_codes.extent( 0 );
+        if ( j < 0 || j > n - 1 )
+            return -1;
+
+        // see above for the 32-bit version
+        if ( morton_codes[i] == morton_codes[j] )
+        {
+            // clz64( k[i] ^ k[j] ) == 64
+            return 64 + clz( i ^ j );
+        }
+        return clz64( morton_codes[i] ^ morton_codes[j] );
+    }
+
     // Expands a 10-bit integer into 30 bits
     // by inserting 2 zeros after each bit.
     KOKKOS_INLINE_FUNCTION
@@ -123,14 +385,250 @@ struct TreeConstruction
         return xx * 4 + yy * 2 + zz;
     }
 
+    // Expands a 21-bit integer into 63 bits
+    // by inserting 2 zeros after each bit.
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t expandBits64( std::uint64_t v )
+    {
+        v &= 0x1fffffull;
+        v = ( v | v << 32 ) & 0x1f00000000ffffull;
+        v = ( v | v << 16 ) & 0x1f0000ff0000ffull;
+        v = ( v | v << 8 ) & 0x100f00f00f00f00full;
+        v = ( v | v << 4 ) & 0x10c30c30c30c30c3ull;
+        v = ( v | v << 2 ) & 0x1249249249249249ull;
+        return v;
+    }
+
+    // Calculates a 63-bit Morton code for the
+    // given 3D point located within the unit cube [0,1].
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t morton3D64( double x, double y, double z )
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+
+        // The interval [0,1] is subdivided into 2097152 bins (in each
+        // direction).  This allows to discriminate objects that would share
+        // the same 30-bit Morton code, at the price of twice the storage.
+        x = min( max( x * 2097152.0, 0.0 ), 2097151.0 );
+        y = min( max( y * 2097152.0, 0.0 ), 2097151.0 );
+        z = min( max( z * 2097152.0, 0.0 ), 2097151.0 );
+        std::uint64_t xx = expandBits64( (std::uint64_t)x );
+        std::uint64_t yy = expandBits64( (std::uint64_t)y );
+        std::uint64_t zz = expandBits64( (std::uint64_t)z );
+        return xx * 4 + yy * 2 + zz;
+    }
+
+    // Expands a 16-bit integer into 32 bits
+    // by inserting 1 zero after each bit.
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int expandBits2D( unsigned int v )
+    {
+        v &= 0x0000ffffu;
+        v = ( v | v << 8 ) & 0x00ff00ffu;
+        v = ( v | v << 4 ) & 0x0f0f0f0fu;
+        v = ( v | v << 2 ) & 0x33333333u;
+        v = ( v | v << 1 ) & 0x55555555u;
+        return v;
+    }
+
+    // Calculates a 32-bit Morton code for the given 2D point located within
+    // the unit square [0,1].  The codes of the objects of a scene that is flat
+    // along one axis, e.g. the mesh of a 2D problem, are computed from the
+    // other two coordinates so that each of them gets 16 bits instead of 10.
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int morton2D( double x, double y )
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+
+        x = min( max( x * 65536.0, 0.0 ), 65535.0 );
+        y = min( max( y * 65536.0, 0.0 ), 65535.0 );
+        unsigned int xx = expandBits2D( (unsigned int)x );
+        unsigned int yy = expandBits2D( (unsigned int)y );
+        return xx * 2 + yy;
+    }
+
+    // Expands a 32-bit integer into 64 bits
+    // by inserting 1 zero after each bit.
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t expandBits2D64( std::uint64_t v )
+    {
+        v &= 0xffffffffull;
+        v = ( v | v << 16 ) & 0x0000ffff0000ffffull;
+        v = ( v | v << 8 ) & 0x00ff00ff00ff00ffull;
+        v = ( v | v << 4 ) & 0x0f0f0f0f0f0f0f0full;
+        v = ( v | v << 2 ) & 0x3333333333333333ull;
+        v = ( v | v << 1 ) & 0x5555555555555555ull;
+        return v;
+    }
+
+    // Calculates a 64-bit Morton code for the
+    // given 2D point located within the unit square [0,1].
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t morton2D64( double x, double y )
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+
+        x = min( max( x * 4294967296.0, 0.0 ), 4294967295.0 );
+        y = min( max( y * 4294967296.0, 0.0 ), 4294967295.0 );
+        std::uint64_t xx = expandBits2D64( (std::uint64_t)x );
+        std::uint64_t yy = expandBits2D64( (std::uint64_t)y );
+        return xx * 2 + yy;
+    }
+
+    // Transforms the coordinates of a cell of the grid with 2^bits cells in
+    // each direction into the "transpose" of its index along the Hilbert
+    // curve.  Interleaving their bits, most significant first and starting
+    // with the first coordinate, yields the index.  See "Programming the
+    // Hilbert curve" by Skilling.
+    template <typename UnsignedInt>
+    KOKKOS_INLINE_FUNCTION static void hilbertTranspose( UnsignedInt ( &x )[3],
+                                                         int bits )
+    {
+        UnsignedInt const m = UnsignedInt( 1 ) << ( bits - 1 );
+        // inverse undo
+        for ( UnsignedInt q = m; q > 1; q >>= 1 )
+        {
+            UnsignedInt const p = q - 1;
+            for ( int i = 0; i < 3; ++i )
+            {
+                if ( x[i] & q )
+                {
+                    x[0] ^= p; // invert
+                }
+                else
+                {
+                    UnsignedInt const t = ( x[0] ^ x[i] ) & p; // exchange
+                    x[0] ^= t;
+                    x[i] ^= t;
+                }
+            }
+        }
+        // Gray encode
+        for ( int i = 1; i < 3; ++i )
+            x[i] ^= x[i - 1];
+        UnsignedInt t = 0;
+        for ( UnsignedInt q = m; q > 1; q >>= 1 )
+            if ( x[2] & q )
+                t ^= q - 1;
+        for ( int i = 0; i < 3; ++i )
+            x[i] ^= t;
+    }
+
+    // Calculates the 30-bit index along the Hilbert curve of the given 3D
+    // point located within the unit cube [0,1], on the same grid as
+    // morton3D().
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int hilbert3D( double x, double y, double z )
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+
+        x = min( max( x * 1024.0, 0.0 ), 1023.0 );
+        y = min( max( y * 1024.0, 0.0 ), 1023.0 );
+        z = min( max( z * 1024.0, 0.0 ), 1023.0 );
+        unsigned int xyz[3] = {(unsigned int)x, (unsigned int)y,
+                               (unsigned int)z};
+        hilbertTranspose( xyz, 10 );
+        return expandBits( xyz[0] ) * 4 + expandBits( xyz[1] ) * 2 +
+               expandBits( xyz[2] );
+    }
+
+    // Calculates the 63-bit index along the Hilbert curve of the given 3D
+    // point located within the unit cube [0,1], on the same grid as
+    // morton3D64().
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t hilbert3D64( double x, double y, double z )
+    {
+        using KokkosHelpers::max;
+        using KokkosHelpers::min;
+
+        x = min( max( x * 2097152.0, 0.0 ), 2097151.0 );
+        y = min( max( y * 2097152.0, 0.0 ), 2097151.0 );
+        z = min( max( z * 2097152.0, 0.0 ), 2097151.0 );
+        std::uint64_t xyz[3] = {(std::uint64_t)x, (std::uint64_t)y,
+                                (std::uint64_t)z};
+        hilbertTranspose( xyz, 21 );
+        return expandBits64( xyz[0] ) * 4 + expandBits64( xyz[1] ) * 2 +
+               expandBits64( xyz[2] );
+    }
+
+    // Code of the given 3D point located within the unit cube [0,1] along
+    // the selected space-filling curve.
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int curveCode( ZOrderCurveTag, double x, double y,
+                                   double z )
+    {
+        return morton3D( x, y, z );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int curveCode( HilbertCurveTag, double x, double y,
+                                   double z )
+    {
+        return hilbert3D( x, y, z );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t curveCode64( ZOrderCurveTag, double x, double y,
+                                      double z )
+    {
+        return morton3D64( x, y, z );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t curveCode64( HilbertCurveTag, double x, double y,
+                                      double z )
+    {
+        return hilbert3D64( x, y, z );
+    }
+
+    // Code of the given 2D point located within the unit square [0,1], for
+    // scenes that are flat along one axis.  The Hilbert curve keeps its 3D
+    // grid.
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int curveCode( ZOrderCurveTag, double x, double y )
+    {
+        return morton2D( x, y );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static unsigned int curveCode( HilbertCurveTag, double x, double y )
+    {
+        return hilbert3D( x, y, 0. );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t curveCode64( ZOrderCurveTag, double x, double y )
+    {
+        return morton2D64( x, y );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static std::uint64_t curveCode64( HilbertCurveTag, double x, double y )
+    {
+        return hilbert3D64( x, y, 0. );
+    }
+
     KOKKOS_FUNCTION
     static int
     findSplit( Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
                int first, int last );
 
+    KOKKOS_FUNCTION
+    static int
+    findSplit( Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+               int first, int last );
+
     KOKKOS_FUNCTION
     static Kokkos::pair<int, int> determineRange(
         Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes, int i );
+
+    KOKKOS_FUNCTION
+    static Kokkos::pair<int, int> determineRange(
+        Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes, int i );
 };
 } // namespace Details
 } // namespace DataTransferKit
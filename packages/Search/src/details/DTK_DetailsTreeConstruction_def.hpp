@@ -24,18 +24,20 @@
 #include <Kokkos_Sort.hpp>
 
 #include <cassert>
+#include <cstdint> // uint64_t
 
 namespace DataTransferKit
 {
 namespace Details
 {
 
-template <typename DeviceType>
+// The objects are either a view of geometries or the coordinates of points
+// (see PointCoordinates).
+template <typename Primitives>
 class CalculateBoundingBoxOfTheSceneFunctor
 {
   public:
-    CalculateBoundingBoxOfTheSceneFunctor(
-        Kokkos::View<Box const *, DeviceType> bounding_boxes )
+    CalculateBoundingBoxOfTheSceneFunctor( Primitives const &bounding_boxes )
         : _bounding_boxes( bounding_boxes )
     {
     }
@@ -56,16 +58,17 @@ class CalculateBoundingBoxOfTheSceneFunctor
     }
 
   private:
-    Kokkos::View<Box const *, DeviceType> _bounding_boxes;
+    Primitives _bounding_boxes;
 };
 
-template <typename DeviceType>
+template <typename DeviceType, typename MortonCodeType, typename Primitives,
+          typename Curve = ZOrderCurveTag>
 class AssignMortonCodesFunctor
 {
   public:
     AssignMortonCodesFunctor(
-        Kokkos::View<Box const *, DeviceType> bounding_boxes,
-        Kokkos::View<unsigned int *, DeviceType> morton_codes,
+        Primitives const &bounding_boxes,
+        Kokkos::View<MortonCodeType *, DeviceType> morton_codes,
         Box const &scene_bounding_box )
         : _bounding_boxes( bounding_boxes )
         , _morton_codes( morton_codes )
@@ -76,37 +79,79 @@ class AssignMortonCodesFunctor
     KOKKOS_INLINE_FUNCTION
     void operator()( int const i ) const
     {
-        Point xyz;
+        Point xyz = return_centroid( _bounding_boxes( i ) );
         double a, b;
-        centroid( _bounding_boxes[i], xyz );
+        int flat_axis = -1;
+        int n_flat_axes = 0;
         // scale coordinates with respect to bounding box of the scene
         for ( int d = 0; d < 3; ++d )
         {
             a = _scene_bounding_box.minCorner()[d];
             b = _scene_bounding_box.maxCorner()[d];
             xyz[d] = ( a != b ? ( xyz[d] - a ) / ( b - a ) : 0 );
+            if ( a == b )
+            {
+                flat_axis = d;
+                ++n_flat_axes;
+            }
         }
-        _morton_codes[i] =
-            TreeConstruction<DeviceType>::morton3D( xyz[0], xyz[1], xyz[2] );
+        // the codes of a scene that is flat along one axis are computed from
+        // the other two coordinates only
+        if ( n_flat_axes == 1 )
+            assign( _morton_codes[i], xyz[( flat_axis + 1 ) % 3],
+                    xyz[( flat_axis + 2 ) % 3] );
+        else
+            assign( _morton_codes[i], xyz );
     }
 
   private:
-    Kokkos::View<Box const *, DeviceType> _bounding_boxes;
-    Kokkos::View<unsigned int *, DeviceType> _morton_codes;
+    KOKKOS_INLINE_FUNCTION
+    static void assign( unsigned int &code, Point const &xyz )
+    {
+        code = TreeConstruction<DeviceType>::curveCode( Curve{}, xyz[0],
+                                                        xyz[1], xyz[2] );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static void assign( std::uint64_t &code, Point const &xyz )
+    {
+        code = TreeConstruction<DeviceType>::curveCode64( Curve{}, xyz[0],
+                                                          xyz[1], xyz[2] );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static void assign( unsigned int &code, double x, double y )
+    {
+        code = TreeConstruction<DeviceType>::curveCode( Curve{}, x, y );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    static void assign( std::uint64_t &code, double x, double y )
+    {
+        code = TreeConstruction<DeviceType>::curveCode64( Curve{}, x, y );
+    }
+
+    Primitives _bounding_boxes;
+    Kokkos::View<MortonCodeType *, DeviceType> _morton_codes;
     Box const &_scene_bounding_box;
 };
 
-template <typename DeviceType>
+template <typename DeviceType, typename MortonCodeType>
 class GenerateHierarchyFunctor
 {
   public:
     GenerateHierarchyFunctor(
-        Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
-        Kokkos::View<Node *, DeviceType> leaf_nodes,
-        Kokkos::View<Node *, DeviceType> internal_nodes )
+        Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes,
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents,
+        Kokkos::View<int *, DeviceType> range_first,
+        Kokkos::View<int *, DeviceType> escapes )
         : _sorted_morton_codes( sorted_morton_codes )
-        , _leaf_nodes( leaf_nodes )
-        , _internal_nodes( internal_nodes )
+        , _internal_and_leaf_nodes( internal_and_leaf_nodes )
+        , _parents( parents )
+        , _range_first( range_first )
+        , _escapes( escapes )
+        , _leaf_nodes_shift( sorted_morton_codes.extent( 0 ) - 1 )
     {
     }
 
@@ -131,44 +176,86 @@ class GenerateHierarchyFunctor
 
         // Select childA.
 
-        Node *childA;
+        int childA = split;
         if ( split == first )
-            childA = &_leaf_nodes[split];
-        else
-            childA = &_internal_nodes[split];
+            childA += _leaf_nodes_shift;
 
         // Select childB.
 
-        Node *childB;
+        int childB = split + 1;
         if ( split + 1 == last )
-            childB = &_leaf_nodes[split + 1];
-        else
-            childB = &_internal_nodes[split + 1];
+            childB += _leaf_nodes_shift;
 
         // Record parent-child relationships.
 
-        _internal_nodes[i].children.first = childA;
-        _internal_nodes[i].children.second = childB;
-        childA->parent = &_internal_nodes[i];
-        childB->parent = &_internal_nodes[i];
+        _internal_and_leaf_nodes( i ).children = {childA, childB};
+        _parents( childA ) = i;
+        _parents( childB ) = i;
+
+        // Record what is needed to compute the ropes.  Every split position
+        // is owned by exactly one internal node.
+
+        _range_first( i ) = first;
+        _escapes( split ) = childA;
+    }
+
+  private:
+    Kokkos::View<MortonCodeType *, DeviceType> _sorted_morton_codes;
+    Kokkos::View<Node *, DeviceType> _internal_and_leaf_nodes;
+    Kokkos::View<int *, DeviceType> _parents;
+    Kokkos::View<int *, DeviceType> _range_first;
+    Kokkos::View<int *, DeviceType> _escapes;
+    int _leaf_nodes_shift;
+};
+
+// The rope of a node points to the next node to visit once its subtree has
+// been processed (or skipped) when traversing the hierarchy depth-first,
+// right child first.  This is the left child of the internal node that splits
+// the objects right before the first object that the node covers.  The rope is
+// -1 when the node covers the first object, i.e. when the traversal is over.
+template <typename DeviceType>
+class ComputeRopesFunctor
+{
+  public:
+    ComputeRopesFunctor(
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int const *, DeviceType> range_first,
+        Kokkos::View<int const *, DeviceType> escapes )
+        : _internal_and_leaf_nodes( internal_and_leaf_nodes )
+        , _range_first( range_first )
+        , _escapes( escapes )
+        , _leaf_nodes_shift( range_first.extent( 0 ) )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        int const first = ( i < _leaf_nodes_shift ? _range_first( i )
+                                                  : i - _leaf_nodes_shift );
+        _internal_and_leaf_nodes( i ).rope =
+            ( first == 0 ? -1 : _escapes( first - 1 ) );
     }
 
   private:
-    Kokkos::View<unsigned int *, DeviceType> _sorted_morton_codes;
-    Kokkos::View<Node *, DeviceType> _leaf_nodes;
-    Kokkos::View<Node *, DeviceType> _internal_nodes;
+    Kokkos::View<Node *, DeviceType> _internal_and_leaf_nodes;
+    Kokkos::View<int const *, DeviceType> _range_first;
+    Kokkos::View<int const *, DeviceType> _escapes;
+    int _leaf_nodes_shift;
 };
 
 template <typename DeviceType>
 class CalculateBoundingBoxesFunctor
 {
   public:
-    CalculateBoundingBoxesFunctor( Kokkos::View<Node *, DeviceType> leaf_nodes,
-                                   Node *root )
-        : _leaf_nodes( leaf_nodes )
-        , _root( root )
+    CalculateBoundingBoxesFunctor(
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int const *, DeviceType> parents )
+        : _internal_and_leaf_nodes( internal_and_leaf_nodes )
+        , _parents( parents )
+        , _leaf_nodes_shift( ( internal_and_leaf_nodes.extent( 0 ) - 1 ) / 2 )
         , _flags( Kokkos::ViewAllocateWithoutInitializing( "flags" ),
-                  leaf_nodes.extent( 0 ) - 1 )
+                  _leaf_nodes_shift )
     {
         // Initialize flags to zero
         Kokkos::deep_copy( _flags, 0 );
@@ -177,71 +264,521 @@ class CalculateBoundingBoxesFunctor
     KOKKOS_INLINE_FUNCTION
     void operator()( int const i ) const
     {
-        Node *node = _leaf_nodes( i ).parent;
-        // Walk toward the root but do not actually process it because its
-        // bounding box has already been computed (bounding box of the scene)
-        while ( node != _root )
+        int node = _parents( i + _leaf_nodes_shift );
+        // Walk toward the root (at position 0) but do not actually process it
+        // because its bounding box has already been computed (bounding box of
+        // the scene)
+        while ( node != 0 )
         {
             // Use an atomic flag per internal node to terminate the first
             // thread that enters it, while letting the second one through.
             // This ensures that every node gets processed only once, and not
             // before both of its children are processed.
-            if ( Kokkos::atomic_compare_exchange_strong(
-                     &_flags( node - _root ), 0, 1 ) )
+            if ( Kokkos::atomic_compare_exchange_strong( &_flags( node ), 0,
+                                                         1 ) )
                 break;
 
             // Internal node bounding boxes are unitialized hence the
             // assignment operator below.
-            node->bounding_box = node->children.first->bounding_box;
-            expand( node->bounding_box, node->children.second->bounding_box );
+            Node &internal_node = _internal_and_leaf_nodes( node );
+            internal_node.bounding_box =
+                _internal_and_leaf_nodes( internal_node.children.first )
+                    .bounding_box;
+            expand( internal_node.bounding_box,
+                    _internal_and_leaf_nodes( internal_node.children.second )
+                        .bounding_box );
 
-            node = node->parent;
+            node = _parents( node );
         }
         // NOTE: could check that bounding box of the root node is indeed the
         // union of the two children.
     }
 
   private:
-    Kokkos::View<Node *, DeviceType> _leaf_nodes;
-    Node *_root;
+    Kokkos::View<Node *, DeviceType> _internal_and_leaf_nodes;
+    Kokkos::View<int const *, DeviceType> _parents;
+    int _leaf_nodes_shift;
     // Use int instead of bool because CAS (Compare And Swap) on CUDA does not
     // support boolean
     Kokkos::View<int *, DeviceType> _flags;
 };
 
+// Fused construction of the hierarchy and of the bounding boxes from "Fast and
+// Simple Agglomerative LBVH Construction" by Apetrei.  Each thread starts from
+// a leaf and climbs toward the root.  A node that covers the objects from
+// first to last is merged with the neighbor that shares the longest common
+// prefix with it, i.e. its parent splits the objects either between last and
+// last + 1 or between first - 1 and first.  The first thread to reach the
+// parent records its end of the range and stops, the second one knows the
+// whole range of the parent and keeps going.  Internal nodes are numbered as
+// in GenerateHierarchyFunctor so that both builders yield the same nodes.
+template <typename DeviceType, typename MortonCodeType>
+class GenerateHierarchyBottomUpFunctor
+{
+  public:
+    GenerateHierarchyBottomUpFunctor(
+        Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes,
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> range_first,
+        Kokkos::View<int *, DeviceType> escapes )
+        : _sorted_morton_codes( sorted_morton_codes )
+        , _internal_and_leaf_nodes( internal_and_leaf_nodes )
+        , _range_first( range_first )
+        , _escapes( escapes )
+        , _leaf_nodes_shift( sorted_morton_codes.extent( 0 ) - 1 )
+        , _other_ends( Kokkos::ViewAllocateWithoutInitializing( "other_ends" ),
+                       _leaf_nodes_shift )
+    {
+        // Initialize to -1 to mark the internal nodes that were not reached
+        Kokkos::deep_copy( _other_ends, -1 );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        int first = i;
+        int last = i;
+        int node = i + _leaf_nodes_shift;
+        Kokkos::pair<int, int> children = {-1, -1};
+        Box bounding_box = _internal_and_leaf_nodes( node ).bounding_box;
+        while ( true )
+        {
+            if ( first == 0 && last == _leaf_nodes_shift )
+            {
+                // The root is always at position 0.
+                _range_first( 0 ) = 0;
+                _internal_and_leaf_nodes( 0 ).children = children;
+                _internal_and_leaf_nodes( 0 ).bounding_box = bounding_box;
+                break;
+            }
+
+            bool const is_left_child = delta( last ) > delta( first - 1 );
+            int const split = ( is_left_child ? last : first - 1 );
+
+            // Now that the node knows on which side of its parent it lies, it
+            // can be stored.  Leaf nodes are already in place.
+            if ( children.first != -1 )
+            {
+                node = ( is_left_child ? split : split + 1 );
+                _range_first( node ) = first;
+                _internal_and_leaf_nodes( node ).children = children;
+                _internal_and_leaf_nodes( node ).bounding_box = bounding_box;
+            }
+            Kokkos::memory_fence();
+
+            // The left child provides the first object of the parent range
+            // and the right child the last one.
+            int const other_end = Kokkos::atomic_exchange(
+                &_other_ends( split ), is_left_child ? first : last );
+            if ( other_end == -1 )
+                break;
+            Kokkos::memory_fence();
+
+            int sibling;
+            if ( is_left_child )
+            {
+                last = other_end;
+                sibling = ( split + 1 == last ? last + _leaf_nodes_shift
+                                              : split + 1 );
+                children = {node, sibling};
+            }
+            else
+            {
+                first = other_end;
+                sibling =
+                    ( split == first ? split + _leaf_nodes_shift : split );
+                children = {sibling, node};
+            }
+            expand( bounding_box,
+                    _internal_and_leaf_nodes( sibling ).bounding_box );
+            _escapes( split ) = children.first;
+        }
+    }
+
+  private:
+    // Length of the common prefix of the objects on each side of the ith
+    // split, or -1 past either end of the range of objects.
+    KOKKOS_INLINE_FUNCTION
+    int delta( int const i ) const
+    {
+        if ( i < 0 || i >= _leaf_nodes_shift )
+            return -1;
+        return TreeConstruction<DeviceType>::commonPrefix( _sorted_morton_codes,
+                                                           i, i + 1 );
+    }
+
+    Kokkos::View<MortonCodeType *, DeviceType> _sorted_morton_codes;
+    Kokkos::View<Node *, DeviceType> _internal_and_leaf_nodes;
+    Kokkos::View<int *, DeviceType> _range_first;
+    Kokkos::View<int *, DeviceType> _escapes;
+    int _leaf_nodes_shift;
+    Kokkos::View<int *, DeviceType> _other_ends;
+};
+
+// Relative costs of traversing an internal node and of testing a leaf node in
+// the surface area heuristic, as suggested by Karras and Aila.  They are used
+// both to restructure the treelets and to evaluate the resulting hierarchy.
+constexpr double SAH_INTERNAL_NODE_COST = 1.2;
+constexpr double SAH_LEAF_COST = 1.;
+
+// Treelet restructuring from "Fast Parallel Construction of High-Quality
+// Bounding Volume Hierarchies" by Karras and Aila.  Same bottom-up traversal
+// as in CalculateBoundingBoxesFunctor.  When a thread reaches an internal node,
+// the subtrees below have already been optimized.  A treelet is formed by
+// repeatedly expanding the treelet leaf with the largest surface area, and
+// the optimal topology of that treelet is found by dynamic programming over
+// all subsets of its leaves.
 template <typename DeviceType>
-void TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
-    Kokkos::View<Box const *, DeviceType> bounding_boxes,
-    Box &scene_bounding_box )
+class RestructureTreeletsFunctor
 {
-    auto const n = bounding_boxes.extent( 0 );
+  public:
+    static constexpr int TREELET_SIZE = 7;
+
+    RestructureTreeletsFunctor(
+        Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+        Kokkos::View<int *, DeviceType> parents )
+        : _internal_and_leaf_nodes( internal_and_leaf_nodes )
+        , _parents( parents )
+        , _leaf_nodes_shift( ( internal_and_leaf_nodes.extent( 0 ) - 1 ) / 2 )
+        , _flags( Kokkos::ViewAllocateWithoutInitializing( "flags" ),
+                  _leaf_nodes_shift )
+        , _costs( Kokkos::ViewAllocateWithoutInitializing( "costs" ),
+                  internal_and_leaf_nodes.extent( 0 ) )
+    {
+        // Initialize flags to zero
+        Kokkos::deep_copy( _flags, 0 );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int const i ) const
+    {
+        int const leaf = i + _leaf_nodes_shift;
+        _costs( leaf ) =
+            SAH_LEAF_COST *
+            surfaceArea( _internal_and_leaf_nodes( leaf ).bounding_box );
+        int node = _parents( leaf );
+        while ( true )
+        {
+            // Make sure that the updates of the subtree that was processed by
+            // this thread are visible to the one that will process the node.
+            Kokkos::memory_fence();
+            if ( Kokkos::atomic_compare_exchange_strong( &_flags( node ), 0,
+                                                         1 ) )
+                break;
+
+            restructure( node );
+
+            if ( node == 0 )
+                break;
+            node = _parents( node );
+        }
+    }
+
+  private:
+    KOKKOS_INLINE_FUNCTION
+    bool isLeaf( int node ) const
+    {
+        return _internal_and_leaf_nodes( node ).children.first == -1;
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void restructure( int const root ) const
+    {
+        Node const &root_node = _internal_and_leaf_nodes( root );
+
+        // Form the treelet.
+        int leaves[TREELET_SIZE];
+        int internals[TREELET_SIZE - 1];
+        int n_leaves = 2;
+        int n_internals = 1;
+        leaves[0] = root_node.children.first;
+        leaves[1] = root_node.children.second;
+        internals[0] = root;
+        while ( n_leaves < TREELET_SIZE )
+        {
+            int largest = -1;
+            double largest_area = -1.;
+            for ( int k = 0; k < n_leaves; ++k )
+                if ( !isLeaf( leaves[k] ) )
+                {
+                    double const area = surfaceArea(
+                        _internal_and_leaf_nodes( leaves[k] ).bounding_box );
+                    if ( area > largest_area )
+                    {
+                        largest = k;
+                        largest_area = area;
+                    }
+                }
+            if ( largest == -1 )
+                break;
+            Node const &expanded = _internal_and_leaf_nodes( leaves[largest] );
+            internals[n_internals++] = leaves[largest];
+            leaves[largest] = expanded.children.first;
+            leaves[n_leaves++] = expanded.children.second;
+        }
+
+        // Find the optimal partitioning of every subset of the treelet leaves.
+        // Subsets are represented by bit masks and a subset is always
+        // processed after all its proper subsets.
+        int const n_subsets = 1 << n_leaves;
+        double costs[1 << TREELET_SIZE];
+        unsigned char partitions[1 << TREELET_SIZE];
+        for ( int k = 0; k < n_leaves; ++k )
+            costs[1 << k] = _costs( leaves[k] );
+        for ( int s = 1; s < n_subsets; ++s )
+        {
+            if ( ( s & ( s - 1 ) ) == 0 )
+                continue;
+            double best_cost = KokkosHelpers::ArithTraits<double>::infinity();
+            int best_partition = 0;
+            for ( int p = ( s - 1 ) & s; p > 0; p = ( p - 1 ) & s )
+            {
+                double const cost = costs[p] + costs[s ^ p];
+                if ( cost < best_cost )
+                {
+                    best_cost = cost;
+                    best_partition = p;
+                }
+            }
+            costs[s] =
+                SAH_INTERNAL_NODE_COST *
+                    surfaceArea( boundingBox( leaves, s ) ) +
+                best_cost;
+            partitions[s] = best_partition;
+        }
+
+        // Keep the current topology unless it can be improved.
+        int const all = n_subsets - 1;
+        double const current_cost =
+            SAH_INTERNAL_NODE_COST * surfaceArea( root_node.bounding_box ) +
+            _costs( root_node.children.first ) +
+            _costs( root_node.children.second );
+        if ( !( costs[all] < current_cost ) )
+        {
+            _costs( root ) = current_cost;
+            return;
+        }
+
+        // Reuse the internal nodes of the treelet to build the optimal
+        // topology.
+        int stack[TREELET_SIZE];
+        int stack_nodes[TREELET_SIZE];
+        int top = 0;
+        int next_internal = 1;
+        stack[top] = all;
+        stack_nodes[top] = root;
+        ++top;
+        while ( top > 0 )
+        {
+            --top;
+            int const s = stack[top];
+            int const node = stack_nodes[top];
+            int const subsets[2] = {partitions[s], s ^ partitions[s]};
+            int children[2];
+            for ( int c = 0; c < 2; ++c )
+            {
+                if ( ( subsets[c] & ( subsets[c] - 1 ) ) == 0 )
+                {
+                    int k = 0;
+                    while ( subsets[c] != ( 1 << k ) )
+                        ++k;
+                    children[c] = leaves[k];
+                }
+                else
+                {
+                    children[c] = internals[next_internal++];
+                    stack[top] = subsets[c];
+                    stack_nodes[top] = children[c];
+                    ++top;
+                }
+                _parents( children[c] ) = node;
+            }
+            _internal_and_leaf_nodes( node ).children = {children[0],
+                                                         children[1]};
+            _internal_and_leaf_nodes( node ).bounding_box =
+                boundingBox( leaves, s );
+            _costs( node ) = costs[s];
+        }
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Box boundingBox( int const *leaves, int subset ) const
+    {
+        Box box;
+        for ( int k = 0; subset != 0; ++k, subset >>= 1 )
+            if ( subset & 1 )
+                expand( box,
+                        _internal_and_leaf_nodes( leaves[k] ).bounding_box );
+        return box;
+    }
+
+    Kokkos::View<Node *, DeviceType> _internal_and_leaf_nodes;
+    Kokkos::View<int *, DeviceType> _parents;
+    int _leaf_nodes_shift;
+    Kokkos::View<int *, DeviceType> _flags;
+    Kokkos::View<double *, DeviceType> _costs;
+};
+
+template <typename Primitives>
+void calculateBoundingBoxOfTheSceneImpl( Primitives const &objects,
+                                         Box &scene_bounding_box )
+{
+    using ExecutionSpace = typename Primitives::execution_space;
+    auto const n = objects.extent( 0 );
     Kokkos::parallel_reduce(
         DTK_MARK_REGION( "calculate_bounding_box_of_the_scene" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-        CalculateBoundingBoxOfTheSceneFunctor<DeviceType>( bounding_boxes ),
+        CalculateBoundingBoxOfTheSceneFunctor<Primitives>( objects ),
         scene_bounding_box );
     Kokkos::fence();
 }
 
 template <typename DeviceType>
-void TreeConstruction<DeviceType>::assignMortonCodes(
+void TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
     Kokkos::View<Box const *, DeviceType> bounding_boxes,
-    Kokkos::View<unsigned int *, DeviceType> morton_codes,
-    Box const &scene_bounding_box )
+    Box &scene_bounding_box )
+{
+    calculateBoundingBoxOfTheSceneImpl( bounding_boxes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+    Kokkos::View<Point const *, DeviceType> points, Box &scene_bounding_box )
+{
+    calculateBoundingBoxOfTheSceneImpl( points, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+    Kokkos::View<Sphere const *, DeviceType> spheres,
+    Box &scene_bounding_box )
 {
+    calculateBoundingBoxOfTheSceneImpl( spheres, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+    PointCoordinates<DeviceType> const &points, Box &scene_bounding_box )
+{
+    calculateBoundingBoxOfTheSceneImpl( points, scene_bounding_box );
+}
+
+template <typename DeviceType, typename MortonCodeType, typename Primitives,
+          typename Curve = ZOrderCurveTag>
+void assignMortonCodesImpl(
+    Primitives const &bounding_boxes,
+    Kokkos::View<MortonCodeType *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, Curve = Curve{} )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
     auto const n = morton_codes.extent( 0 );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "assign_morton_codes" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-        AssignMortonCodesFunctor<DeviceType>( bounding_boxes, morton_codes,
-                                              scene_bounding_box ) );
+        AssignMortonCodesFunctor<DeviceType, MortonCodeType, Primitives,
+                                 Curve>( bounding_boxes, morton_codes,
+                                         scene_bounding_box ) );
     Kokkos::fence();
 }
 
 template <typename DeviceType>
-Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
-    Kokkos::View<unsigned int *, DeviceType> morton_codes )
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<unsigned int *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
 {
+    assignMortonCodesImpl( bounding_boxes, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( bounding_boxes, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Point const *, DeviceType> points,
+    Kokkos::View<unsigned int *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( points, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Point const *, DeviceType> points,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( points, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Sphere const *, DeviceType> spheres,
+    Kokkos::View<unsigned int *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( spheres, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Sphere const *, DeviceType> spheres,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( spheres, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    PointCoordinates<DeviceType> const &points,
+    Kokkos::View<unsigned int *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( points, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    PointCoordinates<DeviceType> const &points,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, ZOrderCurveTag )
+{
+    assignMortonCodesImpl( points, morton_codes, scene_bounding_box );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<unsigned int *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, HilbertCurveTag tag )
+{
+    assignMortonCodesImpl( bounding_boxes, morton_codes, scene_bounding_box,
+                           tag );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignMortonCodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes,
+    Box const &scene_bounding_box, HilbertCurveTag tag )
+{
+    assignMortonCodesImpl( bounding_boxes, morton_codes, scene_bounding_box,
+                           tag );
+}
+
+template <typename DeviceType, typename MortonCodeType>
+Kokkos::View<size_t *, DeviceType>
+sortObjectsImpl( Kokkos::View<MortonCodeType *, DeviceType> morton_codes,
+                 BinSortTag )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
     int const n = morton_codes.extent( 0 );
 
     using MortonCodeViewType = decltype( morton_codes );
@@ -265,10 +802,8 @@ Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
 
     // Passing the SizeType template argument to Kokkos::BinSort because it
     // defaults to the memory space size type which is different on the host and
-    // on cuda (size_t versus unsigned int respectively).  size_t feels like a
-    // better choice here because its size is guaranteed to coincide with the
-    // pointer size which is a good thing for converting with reinterpret_cast
-    // (when leaf indices are encoded into the pointer to one of their children)
+    // on cuda (size_t versus unsigned int respectively).  The permutation
+    // indices are narrowed to int when stored in the leaf nodes.
     Kokkos::BinSort<MortonCodeViewType, CompType, DeviceType, size_t> bin_sort(
         morton_codes, CompType( n / 2, result.min_val, result.max_val ), true );
     bin_sort.create_permute_vector();
@@ -278,69 +813,511 @@ Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
     return bin_sort.get_permute_vector();
 }
 
+template <typename DeviceType, typename MortonCodeType>
+Kokkos::View<size_t *, DeviceType>
+sortObjectsImpl( Kokkos::View<MortonCodeType *, DeviceType> morton_codes,
+                 RadixSortTag )
+{
+    return RadixSort<DeviceType>::sort( morton_codes );
+}
+
 template <typename DeviceType>
-void TreeConstruction<DeviceType>::initializeLeafNodes(
-    Kokkos::View<size_t const *, DeviceType> indices,
-    Kokkos::View<Box const *, DeviceType> bounding_boxes,
-    Kokkos::View<Node *, DeviceType> leaf_nodes )
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<unsigned int *, DeviceType> morton_codes )
+{
+    return sortObjectsImpl( morton_codes, RadixSortTag{} );
+}
+
+template <typename DeviceType>
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes )
+{
+    return sortObjectsImpl( morton_codes, RadixSortTag{} );
+}
+
+template <typename DeviceType>
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<unsigned int *, DeviceType> morton_codes, RadixSortTag tag )
+{
+    return sortObjectsImpl( morton_codes, tag );
+}
+
+template <typename DeviceType>
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes, RadixSortTag tag )
+{
+    return sortObjectsImpl( morton_codes, tag );
+}
+
+template <typename DeviceType>
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<unsigned int *, DeviceType> morton_codes, BinSortTag tag )
+{
+    return sortObjectsImpl( morton_codes, tag );
+}
+
+template <typename DeviceType>
+Kokkos::View<size_t *, DeviceType> TreeConstruction<DeviceType>::sortObjects(
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes, BinSortTag tag )
 {
+    return sortObjectsImpl( morton_codes, tag );
+}
+
+template <typename DeviceType, typename Primitives>
+void initializeLeafNodesImpl( Kokkos::View<size_t const *, DeviceType> indices,
+                              Primitives const &objects,
+                              Kokkos::View<Node *, DeviceType> leaf_nodes )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
     auto const n = leaf_nodes.extent( 0 );
     DTK_REQUIRE( indices.extent( 0 ) == n );
-    DTK_REQUIRE( bounding_boxes.extent( 0 ) == n );
-    static_assert( sizeof( typename decltype( indices )::value_type ) ==
-                       sizeof( Node * ),
-                   "Encoding leaf index in pointer to child is not safe if the "
-                   "index and pointer types do not have the same size" );
+    DTK_REQUIRE( objects.extent( 0 ) == n );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "initialize_leaf_nodes" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
-            leaf_nodes( i ).bounding_box = bounding_boxes( indices( i ) );
-            leaf_nodes( i ).children = {
-                nullptr, reinterpret_cast<Node *>( indices( i ) )};
+            Box bounding_box;
+            expand( bounding_box, objects( indices( i ) ) );
+            leaf_nodes( i ).bounding_box = bounding_box;
+            leaf_nodes( i ).children = {-1, static_cast<int>( indices( i ) )};
+            leaf_nodes( i ).rope = -1;
         } );
     Kokkos::fence();
 }
 
 template <typename DeviceType>
-Node *TreeConstruction<DeviceType>::generateHierarchy(
-    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
-    Kokkos::View<Node *, DeviceType> leaf_nodes,
-    Kokkos::View<Node *, DeviceType> internal_nodes )
+void TreeConstruction<DeviceType>::initializeLeafNodes(
+    Kokkos::View<size_t const *, DeviceType> indices,
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<Node *, DeviceType> leaf_nodes )
+{
+    initializeLeafNodesImpl( indices, bounding_boxes, leaf_nodes );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::initializeLeafNodes(
+    Kokkos::View<size_t const *, DeviceType> indices,
+    Kokkos::View<Point const *, DeviceType> points,
+    Kokkos::View<Node *, DeviceType> leaf_nodes )
+{
+    initializeLeafNodesImpl( indices, points, leaf_nodes );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::initializeLeafNodes(
+    Kokkos::View<size_t const *, DeviceType> indices,
+    Kokkos::View<Sphere const *, DeviceType> spheres,
+    Kokkos::View<Node *, DeviceType> leaf_nodes )
 {
+    initializeLeafNodesImpl( indices, spheres, leaf_nodes );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::initializeLeafNodes(
+    Kokkos::View<size_t const *, DeviceType> indices,
+    PointCoordinates<DeviceType> const &points,
+    Kokkos::View<Node *, DeviceType> leaf_nodes )
+{
+    initializeLeafNodesImpl( indices, points, leaf_nodes );
+}
+
+template <typename DeviceType, typename MortonCodeType>
+void generateHierarchyImpl(
+    Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int *, DeviceType> parents )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
     auto const n = sorted_morton_codes.extent( 0 );
+    DTK_REQUIRE( internal_and_leaf_nodes.extent( 0 ) == 2 * n - 1 );
+    DTK_REQUIRE( parents.extent( 0 ) == 2 * n - 1 );
+    Kokkos::View<int *, DeviceType> range_first(
+        Kokkos::ViewAllocateWithoutInitializing( "range_first" ), n - 1 );
+    Kokkos::View<int *, DeviceType> escapes(
+        Kokkos::ViewAllocateWithoutInitializing( "escapes" ), n - 1 );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "generate_hierarchy" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n - 1 ),
-        GenerateHierarchyFunctor<DeviceType>( sorted_morton_codes, leaf_nodes,
-                                              internal_nodes ) );
+        GenerateHierarchyFunctor<DeviceType, MortonCodeType>(
+            sorted_morton_codes, internal_and_leaf_nodes, parents,
+            range_first, escapes ) );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_ropes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, 2 * n - 1 ),
+        ComputeRopesFunctor<DeviceType>( internal_and_leaf_nodes, range_first,
+                                         escapes ) );
     Kokkos::fence();
-    // returns a pointer to the root node of the tree
-    return internal_nodes.data();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::generateHierarchy(
+    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int *, DeviceType> parents )
+{
+    generateHierarchyImpl( sorted_morton_codes, internal_and_leaf_nodes,
+                           parents );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::generateHierarchy(
+    Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int *, DeviceType> parents )
+{
+    generateHierarchyImpl( sorted_morton_codes, internal_and_leaf_nodes,
+                           parents );
+}
+
+template <typename DeviceType, typename MortonCodeType>
+void generateHierarchyBottomUpImpl(
+    Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    auto const n = sorted_morton_codes.extent( 0 );
+    DTK_REQUIRE( n > 1 );
+    DTK_REQUIRE( internal_and_leaf_nodes.extent( 0 ) == 2 * n - 1 );
+    Kokkos::View<int *, DeviceType> range_first(
+        Kokkos::ViewAllocateWithoutInitializing( "range_first" ), n - 1 );
+    Kokkos::View<int *, DeviceType> escapes(
+        Kokkos::ViewAllocateWithoutInitializing( "escapes" ), n - 1 );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "generate_hierarchy_bottom_up" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        GenerateHierarchyBottomUpFunctor<DeviceType, MortonCodeType>(
+            sorted_morton_codes, internal_and_leaf_nodes, range_first,
+            escapes ) );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_ropes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, 2 * n - 1 ),
+        ComputeRopesFunctor<DeviceType>( internal_and_leaf_nodes, range_first,
+                                         escapes ) );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::generateHierarchyBottomUp(
+    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes )
+{
+    generateHierarchyBottomUpImpl( sorted_morton_codes,
+                                   internal_and_leaf_nodes );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::generateHierarchyBottomUp(
+    Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes )
+{
+    generateHierarchyBottomUpImpl( sorted_morton_codes,
+                                   internal_and_leaf_nodes );
 }
 
 template <typename DeviceType>
 void TreeConstruction<DeviceType>::calculateBoundingBoxes(
-    Kokkos::View<Node *, DeviceType> leaf_nodes,
-    Kokkos::View<Node *, DeviceType> internal_nodes )
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int const *, DeviceType> parents )
 {
-    auto const n = leaf_nodes.extent( 0 );
-    Node *root = internal_nodes.data();
+    auto const n = ( internal_and_leaf_nodes.extent( 0 ) + 1 ) / 2;
+    DTK_REQUIRE( parents.extent( 0 ) == 2 * n - 1 );
     Kokkos::parallel_for(
         DTK_MARK_REGION( "calculate_bounding_boxes" ),
         Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-        CalculateBoundingBoxesFunctor<DeviceType>( leaf_nodes, root ) );
+        CalculateBoundingBoxesFunctor<DeviceType>( internal_and_leaf_nodes,
+                                                   parents ) );
     Kokkos::fence();
 }
 
 template <typename DeviceType>
-int TreeConstruction<DeviceType>::findSplit(
-    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes, int first,
-    int last )
+void TreeConstruction<DeviceType>::restructureTreelets(
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int *, DeviceType> parents )
+{
+    auto const n = ( internal_and_leaf_nodes.extent( 0 ) + 1 ) / 2;
+    DTK_REQUIRE( parents.extent( 0 ) == internal_and_leaf_nodes.extent( 0 ) );
+    if ( n < 3 )
+        return;
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "restructure_treelets" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        RestructureTreeletsFunctor<DeviceType>( internal_and_leaf_nodes,
+                                                parents ) );
+    Kokkos::fence();
+    computeRopes( internal_and_leaf_nodes, parents );
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::computeRopes(
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int const *, DeviceType> parents )
 {
+    auto const n_nodes = internal_and_leaf_nodes.extent( 0 );
+    DTK_REQUIRE( parents.extent( 0 ) == n_nodes );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_ropes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i ) {
+            // Walk toward the root until reaching a node that is the right
+            // child of its parent.  Its left sibling is the next node to visit.
+            int node = i;
+            int rope = -1;
+            while ( node != 0 )
+            {
+                int const parent = parents( node );
+                auto const &children =
+                    internal_and_leaf_nodes( parent ).children;
+                if ( children.second == node )
+                {
+                    rope = children.first;
+                    break;
+                }
+                node = parent;
+            }
+            internal_and_leaf_nodes( i ).rope = rope;
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::refitLeafNodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<Node *, DeviceType> leaf_nodes )
+{
+    auto const n = leaf_nodes.extent( 0 );
+    DTK_REQUIRE( bounding_boxes.extent( 0 ) == n );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "refit_leaf_nodes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            leaf_nodes( i ).bounding_box =
+                bounding_boxes( leaf_nodes( i ).children.second );
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::computeParents(
+    Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<int *, DeviceType> parents )
+{
+    auto const n_nodes = internal_and_leaf_nodes.extent( 0 );
+    DTK_REQUIRE( parents.extent( 0 ) == n_nodes );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "compute_parents" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, ( n_nodes - 1 ) / 2 ),
+        KOKKOS_LAMBDA( int i ) {
+            auto const &children = internal_and_leaf_nodes( i ).children;
+            parents( children.first ) = i;
+            parents( children.second ) = i;
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::roundNodesOutward(
+    Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes,
+    Kokkos::View<BasicNode<FloatBox> *, DeviceType> float_nodes )
+{
+    auto const n_nodes = internal_and_leaf_nodes.extent( 0 );
+    DTK_REQUIRE( float_nodes.extent( 0 ) == n_nodes );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "round_bounding_boxes_outward" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i ) {
+            Node const &node = internal_and_leaf_nodes( i );
+            float_nodes( i ).children = node.children;
+            float_nodes( i ).rope = node.rope;
+            float_nodes( i ).bounding_box = roundOutward( node.bounding_box );
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::widenNodes(
+    Kokkos::View<BasicNode<FloatBox> const *, DeviceType> float_nodes,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes )
+{
+    auto const n_nodes = float_nodes.extent( 0 );
+    DTK_REQUIRE( internal_and_leaf_nodes.extent( 0 ) == n_nodes );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "convert_bounding_boxes_to_double_precision" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i ) {
+            BasicNode<FloatBox> const &float_node = float_nodes( i );
+            internal_and_leaf_nodes( i ).children = float_node.children;
+            internal_and_leaf_nodes( i ).rope = float_node.rope;
+            internal_and_leaf_nodes( i ).bounding_box =
+                toBox( float_node.bounding_box );
+        } );
+    Kokkos::fence();
+}
+
+// Return the index s of the segment such that offsets( s ) <= i <
+// offsets( s + 1 ).
+template <typename DeviceType>
+KOKKOS_INLINE_FUNCTION int
+findSegment( Kokkos::View<int const *, DeviceType> offsets, int i )
+{
+    int first = 0;
+    int last = offsets.extent( 0 ) - 1;
+    while ( last - first > 1 )
+    {
+        int const middle = ( first + last ) / 2;
+        if ( offsets( middle ) <= i )
+            first = middle;
+        else
+            last = middle;
+    }
+    return first;
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::assignSegmentedMortonCodes(
+    Kokkos::View<Box const *, DeviceType> bounding_boxes,
+    Kokkos::View<int const *, DeviceType> offsets,
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes )
+{
+    auto const n = bounding_boxes.extent( 0 );
+    DTK_REQUIRE( morton_codes.extent( 0 ) == n );
+    DTK_REQUIRE( offsets.extent( 0 ) > 0 );
+    int const n_segments = offsets.extent( 0 ) - 1;
+
+    Kokkos::View<Box *, DeviceType> segment_bounding_boxes(
+        "segment_bounding_boxes", n_segments );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "calculate_bounding_boxes_of_the_segments" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            Box &segment_box =
+                segment_bounding_boxes( findSegment( offsets, i ) );
+            Box const &box = bounding_boxes( i );
+            for ( int d = 0; d < 3; ++d )
+            {
+                Kokkos::atomic_fetch_min( &segment_box.minCorner()[d],
+                                          box.minCorner()[d] );
+                Kokkos::atomic_fetch_max( &segment_box.maxCorner()[d],
+                                          box.maxCorner()[d] );
+            }
+        } );
+    Kokkos::fence();
+
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "assign_segmented_morton_codes" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n ), KOKKOS_LAMBDA( int i ) {
+            int const segment = findSegment( offsets, i );
+            Box const &segment_box = segment_bounding_boxes( segment );
+            Point xyz;
+            centroid( bounding_boxes( i ), xyz );
+            for ( int d = 0; d < 3; ++d )
+            {
+                double const a = segment_box.minCorner()[d];
+                double const b = segment_box.maxCorner()[d];
+                xyz[d] = ( a != b ? ( xyz[d] - a ) / ( b - a ) : 0 );
+            }
+            morton_codes( i ) =
+                ( static_cast<std::uint64_t>( segment ) << 32 ) |
+                morton3D( xyz[0], xyz[1], xyz[2] );
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+void TreeConstruction<DeviceType>::splitForest(
+    Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes,
+    Kokkos::View<int const *, DeviceType> offsets,
+    Kokkos::View<Node const *, DeviceType> forest_nodes,
+    Kokkos::View<int const *, DeviceType> node_offsets,
+    Kokkos::View<Node *, DeviceType> internal_and_leaf_nodes )
+{
+    int const n = sorted_morton_codes.extent( 0 );
+    DTK_REQUIRE( forest_nodes.extent( 0 ) == ( n > 0 ? 2 * n - 1 : 0 ) );
+    DTK_REQUIRE( node_offsets.extent( 0 ) == offsets.extent( 0 ) );
+    Kokkos::parallel_for(
+        DTK_MARK_REGION( "split_forest" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, forest_nodes.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) {
+            // Range of objects covered by the node
+            int first = i - ( n - 1 );
+            int last = first;
+            if ( i < n - 1 )
+            {
+                auto const range = determineRange( sorted_morton_codes, i );
+                first = range.first;
+                last = range.second;
+            }
+            // Nodes that cover objects of several trees are discarded.
+            int const segment = sorted_morton_codes( first ) >> 32;
+            if ( static_cast<int>( sorted_morton_codes( last ) >> 32 ) !=
+                 segment )
+                return;
+
+            // Internal nodes are numbered after one end of the range of
+            // objects they cover.  Within a tree, the root is the only node
+            // whose number matches either the first or the last object of the
+            // tree.  The root goes first and the other internal nodes keep
+            // their relative positions.
+            int const begin = offsets( segment );
+            int const end = offsets( segment + 1 );
+            auto const position = [n, begin, end]( int node ) -> int {
+                if ( node >= n - 1 )
+                    return ( end - begin - 1 ) + ( node - ( n - 1 ) - begin );
+                return ( node == end - 1 ) ? 0 : node - begin;
+            };
+
+            Node const &forest_node = forest_nodes( i );
+            Node &node = internal_and_leaf_nodes( node_offsets( segment ) +
+                                                  position( i ) );
+            node.bounding_box = forest_node.bounding_box;
+            node.rope = ( first == begin ) ? -1 : position( forest_node.rope );
+            if ( i < n - 1 )
+                node.children = {position( forest_node.children.first ),
+                                 position( forest_node.children.second )};
+            else
+                node.children = {-1, forest_node.children.second - begin};
+        } );
+    Kokkos::fence();
+}
+
+template <typename DeviceType>
+double TreeConstruction<DeviceType>::computeSAHCost(
+    Kokkos::View<Node const *, DeviceType> internal_and_leaf_nodes )
+{
+    auto const n_nodes = internal_and_leaf_nodes.extent( 0 );
+    if ( n_nodes < 3 )
+        return 1.;
+    int const n_internal_nodes = ( n_nodes - 1 ) / 2;
+    double cost = 0.;
+    Kokkos::parallel_reduce(
+        DTK_MARK_REGION( "compute_sah_cost" ),
+        Kokkos::RangePolicy<ExecutionSpace>( 0, n_nodes ),
+        KOKKOS_LAMBDA( int i, double &partial_cost ) {
+            double relative_cost = SAH_LEAF_COST;
+            if ( i < n_internal_nodes )
+                relative_cost = SAH_INTERNAL_NODE_COST;
+            partial_cost +=
+                relative_cost *
+                surfaceArea( internal_and_leaf_nodes( i ).bounding_box );
+        },
+        cost );
+    auto root = Kokkos::subview( internal_and_leaf_nodes, 0 );
+    auto root_host = Kokkos::create_mirror_view( root );
+    Kokkos::deep_copy( root_host, root );
+    double const root_area = surfaceArea( root_host().bounding_box );
+    return ( root_area > 0. ? cost / root_area : 1. );
+}
+
+template <typename DeviceType, typename MortonCodeType>
+KOKKOS_INLINE_FUNCTION int
+findSplitImpl( Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes,
+               int first, int last )
+{
+    auto const delta = [sorted_morton_codes]( int a, int b ) {
+        return TreeConstruction<DeviceType>::commonPrefix( sorted_morton_codes,
+                                                           a, b );
+    };
+
     // Calculate the number of highest bits that are the same
     // for all objects, using the count-leading-zeros intrinsic.
 
-    int common_prefix = commonPrefix( sorted_morton_codes, first, last );
+    int common_prefix = delta( first, last );
 
     // Use binary search to find where the next bit differs.
     // Specifically, we are looking for the highest object that
@@ -356,8 +1333,7 @@ int TreeConstruction<DeviceType>::findSplit(
 
         if ( new_split < last )
         {
-            if ( commonPrefix( sorted_morton_codes, first, new_split ) >
-                 common_prefix )
+            if ( delta( first, new_split ) > common_prefix )
                 split = new_split; // accept proposal
         }
     } while ( step > 1 );
@@ -365,24 +1341,27 @@ int TreeConstruction<DeviceType>::findSplit(
     return split;
 }
 
-template <typename DeviceType>
-Kokkos::pair<int, int> TreeConstruction<DeviceType>::determineRange(
-    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes, int i )
+template <typename DeviceType, typename MortonCodeType>
+KOKKOS_INLINE_FUNCTION Kokkos::pair<int, int> determineRangeImpl(
+    Kokkos::View<MortonCodeType *, DeviceType> sorted_morton_codes, int i )
 {
     using KokkosHelpers::max;
     using KokkosHelpers::min;
     using KokkosHelpers::sgn;
 
+    auto const delta = [sorted_morton_codes]( int a, int b ) {
+        return TreeConstruction<DeviceType>::commonPrefix( sorted_morton_codes,
+                                                           a, b );
+    };
+
     // determine direction of the range (+1 or -1)
-    int direction = sgn( commonPrefix( sorted_morton_codes, i, i + 1 ) -
-                         commonPrefix( sorted_morton_codes, i, i - 1 ) );
+    int direction = sgn( delta( i, i + 1 ) - delta( i, i - 1 ) );
     assert( direction == +1 || direction == -1 );
 
     // compute upper bound for the length of the range
     int max_step = 2;
-    int common_prefix = commonPrefix( sorted_morton_codes, i, i - direction );
-    while ( commonPrefix( sorted_morton_codes, i, i + direction * max_step ) >
-            common_prefix )
+    int common_prefix = delta( i, i - direction );
+    while ( delta( i, i + direction * max_step ) > common_prefix )
     {
         max_step = max_step << 1;
     }
@@ -393,14 +1372,43 @@ Kokkos::pair<int, int> TreeConstruction<DeviceType>::determineRange(
     do
     {
         step = step >> 1;
-        if ( commonPrefix( sorted_morton_codes, i,
-                           i + ( split + step ) * direction ) > common_prefix )
+        if ( delta( i, i + ( split + step ) * direction ) > common_prefix )
             split += step;
     } while ( step > 1 );
     int j = i + split * direction;
 
     return {min( i, j ), max( i, j )};
 }
+
+template <typename DeviceType>
+int TreeConstruction<DeviceType>::findSplit(
+    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes, int first,
+    int last )
+{
+    return findSplitImpl( sorted_morton_codes, first, last );
+}
+
+template <typename DeviceType>
+int TreeConstruction<DeviceType>::findSplit(
+    Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes, int first,
+    int last )
+{
+    return findSplitImpl( sorted_morton_codes, first, last );
+}
+
+template <typename DeviceType>
+Kokkos::pair<int, int> TreeConstruction<DeviceType>::determineRange(
+    Kokkos::View<unsigned int *, DeviceType> sorted_morton_codes, int i )
+{
+    return determineRangeImpl( sorted_morton_codes, i );
+}
+
+template <typename DeviceType>
+Kokkos::pair<int, int> TreeConstruction<DeviceType>::determineRange(
+    Kokkos::View<std::uint64_t *, DeviceType> sorted_morton_codes, int i )
+{
+    return determineRangeImpl( sorted_morton_codes, i );
+}
 } // namespace Details
 } // namespace DataTransferKit
 
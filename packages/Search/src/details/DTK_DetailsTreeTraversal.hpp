@@ -22,21 +22,63 @@
 namespace DataTransferKit
 {
 
-template <typename DeviceType>
+/** What the traversal of the hierarchy for a single query went through, see
+ * BoundingVolumeHierarchy::queryStatistics().  The nodes visited are the ones
+ * whose bounding box was tested against the predicate, the leaves tested are
+ * the leaves among them, and the stack high-water mark is the largest number
+ * of nodes that were left to visit at once.  It is zero for the stackless
+ * traversal of the spatial queries.
+ */
+struct TraversalStatistics
+{
+    int nodes_visited = 0;
+    int leaves_tested = 0;
+    int stack_high_water_mark = 0;
+};
+
+template <typename DeviceType, typename Coordinate>
 class BoundingVolumeHierarchy;
 
 namespace Details
 {
-template <typename DeviceType>
+// The traversals report what they go through to a statistics policy.  By
+// default, nothing is counted and the calls compile away.
+struct NoTraversalStatistics
+{
+    KOKKOS_INLINE_FUNCTION void visit( bool ) const {}
+    KOKKOS_INLINE_FUNCTION void updateStackSize( int ) const {}
+};
+
+// Count into the statistics of a query.
+struct TraversalCounters
+{
+    KOKKOS_INLINE_FUNCTION void visit( bool is_leaf ) const
+    {
+        ++_statistics->nodes_visited;
+        if ( is_leaf )
+            ++_statistics->leaves_tested;
+    }
+    KOKKOS_INLINE_FUNCTION void updateStackSize( int size ) const
+    {
+        if ( size > _statistics->stack_high_water_mark )
+            _statistics->stack_high_water_mark = size;
+    }
+
+    TraversalStatistics *_statistics;
+};
+
+template <typename DeviceType, typename Coordinate = double>
 struct TreeTraversal
 {
   public:
     using ExecutionSpace = typename DeviceType::execution_space;
+    using Tree = BoundingVolumeHierarchy<DeviceType, Coordinate>;
+    using Node = typename Tree::node_type;
 
     template <typename Predicate, typename... Args>
-    KOKKOS_INLINE_FUNCTION static int
-    query( BoundingVolumeHierarchy<DeviceType> const &bvh,
-           Predicate const &pred, Args &&... args )
+    KOKKOS_INLINE_FUNCTION static int query( Tree const &bvh,
+                                             Predicate const &pred,
+                                             Args &&... args )
     {
         using Tag = typename Predicate::Tag;
         return queryDispatch( Tag{}, bvh, pred, std::forward<Args>( args )... );
@@ -48,141 +90,517 @@ struct TreeTraversal
     KOKKOS_INLINE_FUNCTION
     static bool isLeaf( Node const *node )
     {
-        return ( node->children.first == nullptr );
+        return ( node->children.first == -1 );
     }
 
     /**
      * Return the index of the leaf node.
      */
     KOKKOS_INLINE_FUNCTION
-    static size_t getIndex( Node const *leaf )
-    {
-        static_assert( sizeof( size_t ) == sizeof( Node * ),
-                       "Conversion is a bad idea if these sizes do not match" );
-        return reinterpret_cast<size_t>( leaf->children.second );
-    }
+    static int getIndex( Node const *leaf ) { return leaf->children.second; }
 
     /**
      * Return the root node of the BVH.
      */
     KOKKOS_INLINE_FUNCTION
-    static Node const *getRoot( BoundingVolumeHierarchy<DeviceType> const &bvh )
+    static Node const *getRoot( Tree const &bvh )
     {
         if ( bvh.empty() )
             return nullptr;
-        return ( bvh.size() > 1 ? bvh._internal_nodes : bvh._leaf_nodes )
-            .data();
+        return bvh._internal_and_leaf_nodes.data();
+    }
+
+    /**
+     * Return the left child of an internal node.
+     */
+    KOKKOS_INLINE_FUNCTION
+    static Node const *getLeftChild( Tree const &bvh, Node const *node )
+    {
+        return bvh._internal_and_leaf_nodes.data() + node->children.first;
+    }
+
+    /**
+     * Return the right child of an internal node.
+     */
+    KOKKOS_INLINE_FUNCTION
+    static Node const *getRightChild( Tree const &bvh, Node const *node )
+    {
+        return bvh._internal_and_leaf_nodes.data() + node->children.second;
+    }
+
+    /**
+     * Return the node to visit after the subtree rooted at the given node or
+     * nullptr if the traversal is complete.
+     */
+    KOKKOS_INLINE_FUNCTION
+    static Node const *getRope( Tree const &bvh, Node const *node )
+    {
+        return ( node->rope == -1 )
+                   ? nullptr
+                   : bvh._internal_and_leaf_nodes.data() + node->rope;
     }
 };
 
 // There are two (related) families of search: one using a spatial predicate and
 // one using nearest neighbours query (see boost::geometry::queries
 // documentation).
-template <typename DeviceType, typename Predicate, typename Insert>
+template <typename DeviceType, typename Coordinate, typename Predicate,
+          typename Insert, typename Statistics = NoTraversalStatistics>
 KOKKOS_FUNCTION int
-spatialQuery( BoundingVolumeHierarchy<DeviceType> const &bvh,
-              Predicate const &predicate, Insert const &insert )
+spatialQuery( BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+              Predicate const &predicate, Insert const &insert,
+              Statistics const &statistics = Statistics() )
 {
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    using Node = typename Traversal::Node;
+
     if ( bvh.empty() )
         return 0;
 
-    if ( bvh.size() == 1 )
+    // Stackless traversal.  Descend into the right child when the node
+    // satisfies the predicate and follow the rope otherwise (or after a leaf
+    // has been processed).
+    Node const *node = Traversal::getRoot( bvh );
+    int count = 0;
+
+    do
     {
-        Node const *leaf = TreeTraversal<DeviceType>::getRoot( bvh );
-        if ( predicate( leaf ) )
+        statistics.visit( Traversal::isLeaf( node ) );
+        if ( predicate( node ) )
         {
-            int const leaf_index = TreeTraversal<DeviceType>::getIndex( leaf );
-            insert( leaf_index );
-            return 1;
+            if ( Traversal::isLeaf( node ) )
+            {
+                if ( ReportsResults<Predicate>::value )
+                    insert( Traversal::getIndex( node ) );
+                count++;
+                if ( StopsAtFirstHit<Predicate>::value )
+                    break;
+                node = Traversal::getRope( bvh, node );
+            }
+            else
+            {
+                node = Traversal::getRightChild( bvh, node );
+            }
         }
         else
-            return 0;
-    }
+        {
+            node = Traversal::getRope( bvh, node );
+        }
+    } while ( node != nullptr );
+
+    return count;
+}
 
-    Stack<Node const *> stack;
+// Traverse the hierarchy for a ray or a segment and pass the objects that it
+// intersects to insert() by increasing distance from its origin to the point
+// where it enters their bounding boxes.  The traversal is best first: the
+// nodes left to visit are kept in a priority queue with the one that the ray
+// enters first on top.  A node encloses its descendants, which the ray
+// therefore enters no earlier, so that once a leaf is on top no object is
+// left that the ray enters before it.  With FirstHit, the traversal stops at
+// the closest object, i.e. the others are never visited.
+template <typename DeviceType, typename Coordinate, typename Predicate,
+          typename Insert, typename Statistics = NoTraversalStatistics>
+KOKKOS_FUNCTION int orderedSpatialQuery(
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Predicate const &predicate, Insert const &insert,
+    Statistics const &statistics = Statistics() )
+{
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    using Node = typename Traversal::Node;
 
-    stack.emplace( TreeTraversal<DeviceType>::getRoot( bvh ) );
-    int count = 0;
+    if ( bvh.empty() )
+        return 0;
 
-    while ( !stack.empty() )
+    auto const &geometry = predicate._geometry;
+    double const infinity = KokkosHelpers::ArithTraits<double>::infinity();
+
+    using PairNodePtrDistance = Kokkos::pair<Node const *, double>;
+    struct CompareDistance
     {
-        Node const *node = stack.top();
-        stack.pop();
+        KOKKOS_INLINE_FUNCTION bool
+        operator()( PairNodePtrDistance const &lhs,
+                    PairNodePtrDistance const &rhs ) const
+        {
+            return lhs.second > rhs.second;
+        }
+    };
+    // The queue holds the frontier of the traversal, which does not grow much
+    // past the depth of the tree since the ray visits the nodes roughly in
+    // order along its path.
+    PriorityQueue<PairNodePtrDistance, CompareDistance> queue;
 
-        if ( TreeTraversal<DeviceType>::isLeaf( node ) )
+    Node const *root = Traversal::getRoot( bvh );
+    double const root_distance = entryDistance( geometry, root->bounding_box );
+    statistics.visit( Traversal::isLeaf( root ) );
+    if ( root_distance == infinity )
+        return 0;
+    queue.emplace( root, root_distance );
+    statistics.updateStackSize( queue.size() );
+    int count = 0;
+
+    while ( !queue.empty() )
+    {
+        Node const *node = queue.top().first;
+        if ( Traversal::isLeaf( node ) )
         {
-            insert( TreeTraversal<DeviceType>::getIndex( node ) );
+            queue.pop();
+            insert( Traversal::getIndex( node ) );
             count++;
+            if ( StopsAtFirstHit<Predicate>::value )
+                break;
         }
         else
         {
-            for ( Node const *child :
-                  {node->children.first, node->children.second} )
+            // Replace the node on top of the queue with the children that the
+            // ray enters.
+            Node const *left_child = Traversal::getLeftChild( bvh, node );
+            double const left_child_distance =
+                entryDistance( geometry, left_child->bounding_box );
+            Node const *right_child = Traversal::getRightChild( bvh, node );
+            double const right_child_distance =
+                entryDistance( geometry, right_child->bounding_box );
+            statistics.visit( Traversal::isLeaf( left_child ) );
+            statistics.visit( Traversal::isLeaf( right_child ) );
+            if ( left_child_distance != infinity )
+            {
+                queue.popPush( left_child, left_child_distance );
+                if ( right_child_distance != infinity )
+                    queue.emplace( right_child, right_child_distance );
+            }
+            else if ( right_child_distance != infinity )
+            {
+                queue.popPush( right_child, right_child_distance );
+            }
+            else
+            {
+                queue.pop();
+            }
+            statistics.updateStackSize( queue.size() );
+        }
+    }
+
+    return count;
+}
+
+// Traverse the hierarchy for a packet of spatial predicates at once.  All the
+// lanes follow the same path: the traversal descends into a node as long as
+// at least one lane satisfies its predicate and follows the rope otherwise.
+// The bounding box of a node encloses the ones of its descendants, so a lane
+// that does not satisfy its predicate for a node does not satisfy it in the
+// subtree either and there is no need to keep track of which lanes were
+// active when entering a subtree.  The lanes are tested in a loop of fixed
+// length without early exit that the compiler can vectorize, and the
+// traversal is coherent when neighboring lanes hold queries that are close
+// along the Z-order curve.  The predicates of the lanes past n_lanes are
+// copies of the last one and are never active.  Unlike spatialQuery(), every
+// object found is passed to insert(), regardless of ReportsResults.
+template <int PacketSize, typename DeviceType, typename Coordinate,
+          typename Predicates, typename Insert>
+KOKKOS_FUNCTION void
+spatialQueryPacket( BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+                    Predicates const &predicates, int first, int n_lanes,
+                    Insert const &insert )
+{
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    using Node = typename Traversal::Node;
+    using Predicate = typename Predicates::non_const_value_type;
+
+    if ( bvh.empty() )
+        return;
+
+    Predicate packet[PacketSize];
+    bool active[PacketSize];
+    for ( int lane = 0; lane < PacketSize; ++lane )
+    {
+        int const i = first + KokkosHelpers::min( lane, n_lanes - 1 );
+        packet[lane] = predicates( i );
+        active[lane] = ( lane < n_lanes );
+    }
+
+    Node const *node = Traversal::getRoot( bvh );
+
+    do
+    {
+        bool mask[PacketSize];
+        bool any = false;
+        for ( int lane = 0; lane < PacketSize; ++lane )
+        {
+            mask[lane] = packet[lane]( node ) & active[lane];
+            any |= mask[lane];
+        }
+        if ( any )
+        {
+            if ( Traversal::isLeaf( node ) )
             {
-                if ( predicate( child ) )
+                int const index = Traversal::getIndex( node );
+                // lanes that stop at their first hit are deactivated and the
+                // traversal ends when no lane is left
+                bool remaining = false;
+                for ( int lane = 0; lane < n_lanes; ++lane )
                 {
-                    stack.push( child );
+                    if ( mask[lane] )
+                    {
+                        insert( lane, index );
+                        if ( StopsAtFirstHit<Predicate>::value )
+                            active[lane] = false;
+                    }
+                    remaining |= active[lane];
                 }
+                if ( !remaining )
+                    break;
+                node = Traversal::getRope( bvh, node );
+            }
+            else
+            {
+                node = Traversal::getRightChild( bvh, node );
             }
         }
-    }
+        else
+        {
+            node = Traversal::getRope( bvh, node );
+        }
+    } while ( node != nullptr );
+}
+
+// Find the leaves of the subtree of the query hierarchy rooted at query_node
+// that intersect leaves of the source hierarchy and pass each pair of object
+// indices to insert( query_index, source_index ).  The source hierarchy is
+// traversed once for the whole subtree, pruning with the bounding box of its
+// root, and the subtree is traversed for each source leaf found.  Both
+// traversals are stackless.  The one over the subtree ends when the rope
+// leads out of it, i.e. to the node that follows query_node.
+template <typename DeviceType, typename SourceCoordinate,
+          typename QueryCoordinate, typename Insert>
+KOKKOS_FUNCTION int spatialJoin(
+    BoundingVolumeHierarchy<DeviceType, SourceCoordinate> const &source,
+    BoundingVolumeHierarchy<DeviceType, QueryCoordinate> const &queries,
+    typename TreeTraversal<DeviceType, QueryCoordinate>::Node const
+        *query_node,
+    Insert const &insert )
+{
+    using SourceTraversal = TreeTraversal<DeviceType, SourceCoordinate>;
+    using QueryTraversal = TreeTraversal<DeviceType, QueryCoordinate>;
+    using SourceNode = typename SourceTraversal::Node;
+    using QueryNode = typename QueryTraversal::Node;
+
+    if ( source.empty() )
+        return 0;
+
+    Box const query_box = toBox( query_node->bounding_box );
+    QueryNode const *query_end = QueryTraversal::getRope( queries, query_node );
+    SourceNode const *node = SourceTraversal::getRoot( source );
+    int count = 0;
+
+    do
+    {
+        if ( intersects( query_box, node->bounding_box ) )
+        {
+            if ( SourceTraversal::isLeaf( node ) )
+            {
+                Box const source_box = toBox( node->bounding_box );
+                int const source_index = SourceTraversal::getIndex( node );
+                QueryNode const *query = query_node;
+                do
+                {
+                    if ( intersects( source_box, query->bounding_box ) )
+                    {
+                        if ( QueryTraversal::isLeaf( query ) )
+                        {
+                            insert( QueryTraversal::getIndex( query ),
+                                    source_index );
+                            count++;
+                            query = QueryTraversal::getRope( queries, query );
+                        }
+                        else
+                        {
+                            query =
+                                QueryTraversal::getRightChild( queries, query );
+                        }
+                    }
+                    else
+                    {
+                        query = QueryTraversal::getRope( queries, query );
+                    }
+                } while ( query != query_end );
+                node = SourceTraversal::getRope( source, node );
+            }
+            else
+            {
+                node = SourceTraversal::getRightChild( source, node );
+            }
+        }
+        else
+        {
+            node = SourceTraversal::getRope( source, node );
+        }
+    } while ( node != nullptr );
+
     return count;
 }
 
-// query k nearest neighbours
-template <typename DeviceType, typename Distance, typename Insert,
-          typename Buffer>
-KOKKOS_FUNCTION int
-nearestQuery( BoundingVolumeHierarchy<DeviceType> const &bvh,
-              Distance const &distance, std::size_t k, Insert const &insert,
-              Buffer const &buffer )
+// Order the leaves found by a nearest query with the farthest one on top of
+// the heap.
+struct CompareNearestDistance
+{
+    template <typename PairIndexDistance>
+    KOKKOS_INLINE_FUNCTION bool
+    operator()( PairIndexDistance const &lhs,
+                PairIndexDistance const &rhs ) const
+    {
+        return lhs.second < rhs.second;
+    }
+};
+
+// Heap of capacity one, with the part of the interface of PriorityQueue that
+// nearestQueryWithHeap() uses, for the nearest neighbor alone.  It only holds
+// the closest leaf found so far, which a closer one simply replaces, so that
+// there is nothing to sift nor any memory to set aside.
+class NearestNeighborHeap
+{
+  public:
+    using value_type = Kokkos::pair<int, double>;
+    using size_type = std::size_t;
+
+    KOKKOS_INLINE_FUNCTION bool empty() const { return !_found; }
+    KOKKOS_INLINE_FUNCTION size_type size() const { return _found ? 1 : 0; }
+    KOKKOS_INLINE_FUNCTION value_type const &top() const { return _nearest; }
+    KOKKOS_INLINE_FUNCTION void push( value_type const &value )
+    {
+        assert( !_found );
+        _nearest = value;
+        _found = true;
+    }
+    KOKKOS_INLINE_FUNCTION void popPush( value_type const &value )
+    {
+        assert( _found );
+        _nearest = value;
+    }
+    KOKKOS_INLINE_FUNCTION value_type *data() { return &_nearest; }
+    KOKKOS_INLINE_FUNCTION CompareNearestDistance valueComp() const
+    {
+        return CompareNearestDistance();
+    }
+
+  private:
+    value_type _nearest;
+    bool _found = false;
+};
+
+// Heap in which the K nearest neighbors found so far are kept when K is known
+// at compile time.
+template <int K>
+struct NearestHeapOfFixedCapacity
+{
+    using type =
+        PriorityQueue<Kokkos::pair<int, double>, CompareNearestDistance,
+                      StaticVector<Kokkos::pair<int, double>, K>>;
+};
+
+template <>
+struct NearestHeapOfFixedCapacity<1>
+{
+    using type = NearestNeighborHeap;
+};
+
+// The nearest neighbors are searched for by comparing squared distances,
+// which order the nodes and prune them against the radius just as well,
+// without taking a square root for every node that gets visited.
+template <typename Geometry>
+struct NodeDistanceSquared
+{
+    template <typename Node>
+    KOKKOS_INLINE_FUNCTION double operator()( Node const *node ) const
+    {
+        return distanceSquared( _geometry, node->bounding_box );
+    }
+
+    Geometry _geometry;
+};
+
+// Take the square root only when the results are reported.
+template <typename Insert>
+struct InsertWithDistance
+{
+    KOKKOS_INLINE_FUNCTION void operator()( int index,
+                                            double distance_squared ) const
+    {
+        _insert( index, std::sqrt( distance_squared ) );
+    }
+
+    Insert const &_insert;
+};
+
+// Square the maximum distance of a nearest query, unless it is negative and
+// no node may be closer.
+KOKKOS_INLINE_FUNCTION
+double squareMaxDistance( double max_distance )
 {
+    return max_distance < 0. ? max_distance : max_distance * max_distance;
+}
+
+// query k nearest neighbours among those closer than max_distance, the
+// nearest ones found so far being kept in the heap given as argument, which
+// must have room for k of them
+// NOTE distance may be any function of the nodes that orders them like the
+// distance does, e.g. its square, as long as max_distance is expressed
+// accordingly.  It is also what gets passed to insert().
+template <typename DeviceType, typename Coordinate, typename Distance,
+          typename Insert, typename Heap,
+          typename Statistics = NoTraversalStatistics>
+KOKKOS_FUNCTION int nearestQueryWithHeap(
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Distance const &distance, std::size_t k, double max_distance,
+    Insert const &insert, Heap &heap,
+    Statistics const &statistics = Statistics() )
+{
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+    using Node = typename Traversal::Node;
+
     if ( bvh.empty() || k < 1 )
         return 0;
 
     if ( bvh.size() == 1 )
     {
-        Node const *leaf = TreeTraversal<DeviceType>::getRoot( bvh );
-        int const leaf_index = TreeTraversal<DeviceType>::getIndex( leaf );
+        Node const *leaf = Traversal::getRoot( bvh );
+        int const leaf_index = Traversal::getIndex( leaf );
         double const leaf_distance = distance( leaf );
+        statistics.visit( true );
+        if ( !( leaf_distance < max_distance ) )
+            return 0;
         insert( leaf_index, leaf_distance );
         return 1;
     }
 
     // Nodes with a distance that exceed that radius can safely be discarded.
-    // Initialize the radius to infinity and tighten it once k neighbors have
-    // been found.
-    double radius = KokkosHelpers::ArithTraits<double>::infinity();
+    // Initialize the radius to the maximum distance, i.e. infinity unless the
+    // caller knows better, and tighten it once k neighbors have been found.
+    double radius = max_distance;
 
-    using PairIndexDistance = Kokkos::pair<int, double>;
-    static_assert(
-        std::is_same<typename Buffer::value_type, PairIndexDistance>::value,
-        "Type of the elements stored in the buffer passed as argument to "
-        "TreeTraversal::nearestQuery is not right" );
-    struct CompareDistance
-    {
-        KOKKOS_INLINE_FUNCTION bool
-        operator()( PairIndexDistance const &lhs,
-                    PairIndexDistance const &rhs ) const
+    assert( heap.empty() );
+    auto const insertLeaf = [&heap, &radius, k]( int leaf_index,
+                                                 double leaf_distance ) {
+        if ( heap.size() < k )
+        {
+            // Insert leaf node and update radius if it was the kth one.
+            heap.push( Kokkos::make_pair( leaf_index, leaf_distance ) );
+            if ( heap.size() == k )
+                radius = heap.top().second;
+        }
+        else
         {
-            return lhs.second < rhs.second;
+            // Replace top element in the heap and update radius.
+            heap.popPush( Kokkos::make_pair( leaf_index, leaf_distance ) );
+            radius = heap.top().second;
         }
     };
-    // Use a priority queue for convenience to store the results and preserve
-    // the heap structure internally at all time.  There is no memory
-    // allocation, elements are stored in the buffer passed as an argument.
-    // The farthest leaf node is on top.
-    assert( k == buffer.size() );
-    PriorityQueue<PairIndexDistance, CompareDistance,
-                  UnmanagedStaticVector<PairIndexDistance>>
-        heap( UnmanagedStaticVector<PairIndexDistance>( buffer.data(),
-                                                        buffer.size() ) );
 
     using PairNodePtrDistance = Kokkos::pair<Node const *, double>;
     Stack<PairNodePtrDistance> stack;
     // Do not bother computing the distance to the root node since it is
     // immediately popped out of the stack and processed.
-    stack.emplace( TreeTraversal<DeviceType>::getRoot( bvh ), 0. );
+    stack.emplace( Traversal::getRoot( bvh ), 0. );
+    statistics.updateStackSize( stack.size() );
 
     while ( !stack.empty() )
     {
@@ -192,34 +610,53 @@ nearestQuery( BoundingVolumeHierarchy<DeviceType> const &bvh,
 
         if ( node_distance < radius )
         {
-            if ( TreeTraversal<DeviceType>::isLeaf( node ) )
+            if ( Traversal::isLeaf( node ) )
             {
-                int const leaf_index =
-                    TreeTraversal<DeviceType>::getIndex( node );
-                double const leaf_distance = node_distance;
-                if ( heap.size() < k )
-                {
-                    // Insert leaf node and update radius if it was the kth one.
-                    heap.push( Kokkos::make_pair( leaf_index, leaf_distance ) );
-                    if ( heap.size() == k )
-                        radius = heap.top().second;
-                }
-                else
+                insertLeaf( Traversal::getIndex( node ), node_distance );
+            }
+            else if ( stack.size() + 2 > stack.capacity() )
+            {
+                // There is no room left on the stack for the children, which
+                // only happens in trees deeper than its capacity, e.g. for
+                // points along a curve with dense clusters.  Visit the
+                // subtree through the ropes instead, which needs no memory
+                // but does not visit the closest child first.
+                Node const *subtree_end = Traversal::getRope( bvh, node );
+                Node const *current = Traversal::getRightChild( bvh, node );
+                while ( current != subtree_end )
                 {
-                    // Replace top element in the heap and update radius.
-                    heap.popPush(
-                        Kokkos::make_pair( leaf_index, leaf_distance ) );
-                    radius = heap.top().second;
+                    double const current_distance = distance( current );
+                    statistics.visit( Traversal::isLeaf( current ) );
+                    if ( current_distance < radius )
+                    {
+                        if ( Traversal::isLeaf( current ) )
+                        {
+                            insertLeaf( Traversal::getIndex( current ),
+                                        current_distance );
+                            current = Traversal::getRope( bvh, current );
+                        }
+                        else
+                        {
+                            current =
+                                Traversal::getRightChild( bvh, current );
+                        }
+                    }
+                    else
+                    {
+                        current = Traversal::getRope( bvh, current );
+                    }
                 }
             }
             else
             {
                 // Insert children into the stack and make sure that the
                 // closest one ends on top.
-                Node const *left_child = node->children.first;
+                Node const *left_child = Traversal::getLeftChild( bvh, node );
                 double const left_child_distance = distance( left_child );
-                Node const *right_child = node->children.second;
+                Node const *right_child = Traversal::getRightChild( bvh, node );
                 double const right_child_distance = distance( right_child );
+                statistics.visit( Traversal::isLeaf( left_child ) );
+                statistics.visit( Traversal::isLeaf( right_child ) );
                 if ( left_child_distance < right_child_distance )
                 {
                     // NOTE not really sure why but it performed better with
@@ -239,6 +676,7 @@ nearestQuery( BoundingVolumeHierarchy<DeviceType> const &bvh,
                         stack.emplace( left_child, left_child_distance );
                     stack.emplace( right_child, right_child_distance );
                 }
+                statistics.updateStackSize( stack.size() );
             }
         }
     }
@@ -255,28 +693,143 @@ nearestQuery( BoundingVolumeHierarchy<DeviceType> const &bvh,
     return heap.size();
 }
 
-template <typename DeviceType, typename Predicate, typename Insert>
-KOKKOS_INLINE_FUNCTION int
-queryDispatch( SpatialPredicateTag,
-               BoundingVolumeHierarchy<DeviceType> const &bvh,
-               Predicate const &pred, Insert const &insert )
+// query k nearest neighbours among those closer than max_distance
+template <typename DeviceType, typename Coordinate, typename Distance,
+          typename Insert, typename Buffer,
+          typename Statistics = NoTraversalStatistics>
+KOKKOS_FUNCTION int
+nearestQuery( BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+              Distance const &distance, std::size_t k, double max_distance,
+              Insert const &insert, Buffer const &buffer,
+              Statistics const &statistics = Statistics() )
+{
+    using PairIndexDistance = Kokkos::pair<int, double>;
+    static_assert(
+        std::is_same<typename Buffer::value_type, PairIndexDistance>::value,
+        "Type of the elements stored in the buffer passed as argument to "
+        "TreeTraversal::nearestQuery is not right" );
+    // Use a priority queue for convenience to store the results and preserve
+    // the heap structure internally at all time.  There is no memory
+    // allocation, elements are stored in the buffer passed as an argument.
+    // The farthest leaf node is on top.
+    assert( k == buffer.size() );
+    PriorityQueue<PairIndexDistance, CompareNearestDistance,
+                  UnmanagedStaticVector<PairIndexDistance>>
+        heap( UnmanagedStaticVector<PairIndexDistance>( buffer.data(),
+                                                        buffer.size() ) );
+    return nearestQueryWithHeap( bvh, distance, k, max_distance, insert,
+                                 heap, statistics );
+}
+
+template <typename DeviceType, typename Coordinate, typename Predicate,
+          typename Insert, typename Statistics = NoTraversalStatistics>
+KOKKOS_INLINE_FUNCTION
+    typename std::enable_if<!ReportsInEntryOrder<Predicate>::value, int>::type
+    queryDispatch( SpatialPredicateTag,
+                   BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+                   Predicate const &pred, Insert const &insert,
+                   Statistics const &statistics = Statistics() )
 {
-    return spatialQuery( bvh, pred, insert );
+    return spatialQuery( bvh, pred, insert, statistics );
 }
 
-template <typename DeviceType, typename Predicate, typename Insert,
-          typename Buffer>
+template <typename DeviceType, typename Coordinate, typename Predicate,
+          typename Insert, typename Statistics = NoTraversalStatistics>
+KOKKOS_INLINE_FUNCTION
+    typename std::enable_if<ReportsInEntryOrder<Predicate>::value, int>::type
+    queryDispatch( SpatialPredicateTag,
+                   BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+                   Predicate const &pred, Insert const &insert,
+                   Statistics const &statistics = Statistics() )
+{
+    return orderedSpatialQuery( bvh, pred, insert, statistics );
+}
+
+template <typename DeviceType, typename Coordinate, typename Predicate,
+          typename Insert, typename Buffer,
+          typename Statistics = NoTraversalStatistics>
 KOKKOS_INLINE_FUNCTION int queryDispatch(
-    NearestPredicateTag, BoundingVolumeHierarchy<DeviceType> const &bvh,
-    Predicate const &pred, Insert const &insert, Buffer const &buffer )
+    NearestPredicateTag,
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Predicate const &pred, Insert const &insert, Buffer const &buffer,
+    Statistics const &statistics = Statistics() )
 {
-    auto const geometry = pred._geometry;
+    using Geometry = typename std::decay<decltype( pred._geometry )>::type;
     auto const k = pred._k;
-    return nearestQuery( bvh,
-                         [geometry]( Node const *node ) {
-                             return distance( geometry, node->bounding_box );
-                         },
-                         k, insert, buffer );
+    NodeDistanceSquared<Geometry> const node_distance{pred._geometry};
+    InsertWithDistance<Insert> const insert_with_distance{insert};
+    double const max_distance = squareMaxDistance( pred._max_distance );
+    // The nearest neighbor alone, e.g. for nearest neighbor interpolation,
+    // needs neither the buffer nor a heap.
+    if ( k == 1 )
+    {
+        NearestNeighborHeap heap;
+        return nearestQueryWithHeap( bvh, node_distance, 1, max_distance,
+                                     insert_with_distance, heap, statistics );
+    }
+    return nearestQuery( bvh, node_distance, k, max_distance,
+                         insert_with_distance, buffer, statistics );
+}
+
+// The number of neighbors is known at compile time, so that the heap has a
+// fixed capacity and is kept by the thread itself instead of in a buffer.
+template <typename DeviceType, typename Coordinate, typename Geometry, int K,
+          typename Insert>
+KOKKOS_INLINE_FUNCTION int
+queryDispatch( NearestPredicateTag,
+               BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+               NearestK<Geometry, K> const &pred, Insert const &insert )
+{
+    typename NearestHeapOfFixedCapacity<K>::type heap;
+    return nearestQueryWithHeap(
+        bvh, NodeDistanceSquared<Geometry>{pred._geometry}, K,
+        squareMaxDistance( pred._max_distance ),
+        InsertWithDistance<Insert>{insert}, heap );
+}
+
+// Distance from a point to the nodes that measures the distance to the
+// objects themselves at the leaves instead of to their bounding boxes.  The
+// latter bounds the former from below, so that the boxes of the internal
+// nodes still prune the traversal.  Squared, as in NodeDistanceSquared.
+template <typename DeviceType, typename Coordinate, typename PrimitiveDistance>
+struct NodePrimitiveDistanceSquared
+{
+    using Traversal = TreeTraversal<DeviceType, Coordinate>;
+
+    KOKKOS_INLINE_FUNCTION double
+    operator()( typename Traversal::Node const *node ) const
+    {
+        if ( Traversal::isLeaf( node ) )
+        {
+            double const primitive_distance =
+                _primitive_distance( _point, Traversal::getIndex( node ) );
+            return primitive_distance * primitive_distance;
+        }
+        return distanceSquared( _point, node->bounding_box );
+    }
+
+    Point _point;
+    PrimitiveDistance _primitive_distance;
+};
+
+// Find the object closest to the point according to
+// primitive_distance( point, index ) and pass its index and distance to
+// insert().
+template <typename DeviceType, typename Coordinate, typename PrimitiveDistance,
+          typename Insert>
+KOKKOS_FUNCTION int nearestPrimitiveQuery(
+    BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Point const &point, PrimitiveDistance const &primitive_distance,
+    Insert const &insert )
+{
+    NearestNeighborHeap heap;
+    return nearestQueryWithHeap(
+        bvh,
+        NodePrimitiveDistanceSquared<DeviceType, Coordinate,
+                                     PrimitiveDistance>{point,
+                                                        primitive_distance},
+        1, KokkosHelpers::ArithTraits<double>::infinity(),
+        InsertWithDistance<Insert>{insert}, heap );
 }
 
 } // namespace Details
@@ -18,13 +18,20 @@
 #include <Kokkos_Sort.hpp> // min_max_functor
 #include <Kokkos_View.hpp>
 
+#include <array>
+#include <cstdlib> // getenv
+#include <string>
+#include <type_traits>
+
 namespace DataTransferKit
 {
 
 namespace Details
 {
 // NOTE: This functor is used in exclusivePrefixSum( src, dst ).  We were
-// getting a compile error on CUDA when using a KOKKOS_LAMBDA.
+// getting a compile error on CUDA when using a KOKKOS_LAMBDA.  The last input
+// element is left out of the sum so that the total of the scan is the last
+// output element, whatever the trailing entry of an offset view holds.
 template <typename T, typename DeviceType>
 class ExclusiveScanFunctor
 {
@@ -33,6 +40,7 @@ class ExclusiveScanFunctor
                           Kokkos::View<T *, DeviceType> const &out )
         : _in( in )
         , _out( out )
+        , _last( static_cast<int>( in.extent( 0 ) ) - 1 )
     {
     }
     KOKKOS_INLINE_FUNCTION void operator()( int i, T &update,
@@ -41,29 +49,178 @@ class ExclusiveScanFunctor
         T const in_i = _in( i );
         if ( final_pass )
             _out( i ) = update;
-        update += in_i;
+        if ( i != _last )
+            update += in_i;
     }
 
   private:
     Kokkos::View<T *, DeviceType> _in;
     Kokkos::View<T *, DeviceType> _out;
+    int _last;
+};
+
+// NOTE: This functor is used in exclusivePrefixSums() for the same reason.
+// The N views are scanned together and their sums carried in a single value,
+// which leaves out their last elements as above.
+template <typename T, typename DeviceType, int N>
+class ExclusiveScansFunctor
+{
+  public:
+    struct value_type
+    {
+        T sums[N];
+    };
+
+    ExclusiveScansFunctor(
+        Kokkos::Array<Kokkos::View<T *, DeviceType>, N> const &views )
+        : _views( views )
+        , _last( static_cast<int>( views[0].extent( 0 ) ) - 1 )
+    {
+    }
+    KOKKOS_INLINE_FUNCTION void init( value_type &update ) const
+    {
+        for ( int k = 0; k < N; ++k )
+            update.sums[k] = 0;
+    }
+    KOKKOS_INLINE_FUNCTION void join( volatile value_type &update,
+                                      volatile value_type const &input ) const
+    {
+        for ( int k = 0; k < N; ++k )
+            update.sums[k] += input.sums[k];
+    }
+    KOKKOS_INLINE_FUNCTION void operator()( int i, value_type &update,
+                                            bool final_pass ) const
+    {
+        for ( int k = 0; k < N; ++k )
+        {
+            T const in_i = _views[k]( i );
+            if ( final_pass )
+                _views[k]( i ) = update.sums[k];
+            if ( i != _last )
+                update.sums[k] += in_i;
+        }
+    }
+
+  private:
+    Kokkos::Array<Kokkos::View<T *, DeviceType>, N> _views;
+    int _last;
+};
+
+// NOTE: This functor is used in selectIndices() for the same reason.  The
+// indices are only written if the view is not empty.
+template <typename Predicate, typename DeviceType>
+class SelectIndicesFunctor
+{
+  public:
+    SelectIndicesFunctor( Predicate const &predicate,
+                          Kokkos::View<int *, DeviceType> const &indices )
+        : _predicate( predicate )
+        , _indices( indices )
+    {
+    }
+    KOKKOS_INLINE_FUNCTION void operator()( int i, int &update,
+                                            bool final_pass ) const
+    {
+        if ( !_predicate( i ) )
+            return;
+        if ( final_pass && _indices.extent( 0 ) > 0 )
+            _indices( update ) = i;
+        ++update;
+    }
+
+  private:
+    Predicate _predicate;
+    Kokkos::View<int *, DeviceType> _indices;
+};
+
+// Whether the kernels of the execution space run on the host.
+template <typename DeviceType>
+struct RunsOnHost
+    : std::integral_constant<
+          bool, Kokkos::Impl::MemorySpaceAccess<
+                    Kokkos::HostSpace,
+                    typename DeviceType::memory_space>::accessible>
+{
 };
+
+/** Whether the pages of the views that are filled by a copy are first touched
+ *  in parallel (see firstTouch()).  This is off by default.  Set the
+ *  environment variable DTK_NUMA_FIRST_TOUCH to 1 to turn it on.  It only
+ *  pays off when the host threads are bound to their cores, e.g. with
+ *  OMP_PROC_BIND=spread.
+ */
+inline bool isNumaFirstTouch()
+{
+    static bool const is_first_touch = []() {
+        char const *env = std::getenv( "DTK_NUMA_FIRST_TOUCH" );
+        return env != nullptr && std::string( env ) != "0";
+    }();
+    return is_first_touch;
+}
+
+/** Value-initialize the entries of a 1D view allocated without initializing
+ *  with the same static partition of the range of its entries as the kernels
+ *  that go over them, so that the operating system places each page of the
+ *  view on the NUMA node of the thread that uses it the most.  Otherwise, a
+ *  view filled by a copy, which is performed by a single thread, has all its
+ *  pages on the socket of that thread.  This does nothing unless the view
+ *  lives on the host and isNumaFirstTouch() is on.
+ */
+template <typename View>
+void firstTouch( View const &v )
+{
+    using DeviceType = typename View::device_type;
+    using ExecutionSpace = typename DeviceType::execution_space;
+    using ValueType = typename View::non_const_value_type;
+    static_assert( View::rank == 1, "firstTouch() requires a 1D view" );
+    if ( !RunsOnHost<DeviceType>::value || !isNumaFirstTouch() )
+        return;
+    Kokkos::parallel_for(
+        "first_touch", Kokkos::RangePolicy<ExecutionSpace>( 0, v.extent( 0 ) ),
+        KOKKOS_LAMBDA( int i ) { v( i ) = ValueType(); } );
+}
+
+// Copy of a 1D view in the memory space of OtherDeviceType.
+template <typename View, typename OtherDeviceType>
+Kokkos::View<typename View::non_const_data_type, OtherDeviceType>
+copyToDevice( View const &v, OtherDeviceType const & )
+{
+    Kokkos::View<typename View::non_const_data_type, OtherDeviceType> w(
+        Kokkos::ViewAllocateWithoutInitializing( v.label() ), v.extent( 0 ) );
+    firstTouch( w );
+    Kokkos::deep_copy( w, v );
+    return w;
+}
 } // namespace Details
 
 /** \brief Computes an exclusive scan.
  *
+ *  \param[in] space Execution space instance that performs the scan
  *  \param[in] src Input view with range of elements to sum
  *  \param[out] dst Output view; may be equal to \p src
  *
  *  When \p dst is not provided or if \p src and \p dst are the same view, the
  *  scan is performed in-place.  "Exclusive" means that the i-th input element
- *  is not included in the i-th sum.
+ *  is not included in the i-th sum.  Only \p space is fenced afterwards.  When
+ *  it is not provided, the scan is performed by the default instance of the
+ *  execution space of \p dst.
+ *
+ *  Returns the last element of \p dst on the host, i.e. the sum of all the
+ *  elements of \p src but the last one.  It comes with the scan so that the
+ *  usual count, scan, and allocate sequence does not need to read the last
+ *  element of an offset view back with lastElement().  The trailing entry of
+ *  the counts, which is overwritten with the total, need not be initialized.
  *
  *  \pre \p src and \p dst must be of rank 1 and have the same size.
  */
-template <typename ST, typename... SP, typename DT, typename... DP>
-void exclusivePrefixSum( Kokkos::View<ST, SP...> const &src,
-                         Kokkos::View<DT, DP...> const &dst )
+template <typename ExecutionSpace, typename ST, typename... SP, typename DT,
+          typename... DP>
+typename std::enable_if<
+    Kokkos::is_execution_space<ExecutionSpace>::value,
+    typename Kokkos::ViewTraits<DT, DP...>::non_const_value_type>::type
+exclusivePrefixSum( ExecutionSpace const &space,
+                    Kokkos::View<ST, SP...> const &src,
+                    Kokkos::View<DT, DP...> const &dst )
 {
     static_assert(
         std::is_same<typename Kokkos::ViewTraits<DT, DP...>::value_type,
@@ -77,28 +234,94 @@ void exclusivePrefixSum( Kokkos::View<ST, SP...> const &src,
                          unsigned( 1 ) ),
                    "exclusivePrefixSum requires Views of rank 1" );
 
-    using ExecutionSpace =
-        typename Kokkos::ViewTraits<DT, DP...>::execution_space;
+    static_assert(
+        Kokkos::Impl::SpaceAccessibility<
+            ExecutionSpace, typename Kokkos::ViewTraits<
+                                DT, DP...>::memory_space>::accessible,
+        "exclusivePrefixSum requires a destination accessible from the "
+        "execution space" );
+
     using ValueType = typename Kokkos::ViewTraits<DT, DP...>::value_type;
+    using DeviceType =
+        typename Kokkos::ViewTraits<DT, DP...>::execution_space;
 
     auto const n = src.extent( 0 );
     DTK_REQUIRE( n == dst.extent( 0 ) );
+    ValueType total = 0;
     Kokkos::parallel_scan(
-        "exclusive_scan", Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-        Details::ExclusiveScanFunctor<ValueType, ExecutionSpace>( src, dst ) );
-    Kokkos::fence();
+        "exclusive_scan", Kokkos::RangePolicy<ExecutionSpace>( space, 0, n ),
+        Details::ExclusiveScanFunctor<ValueType, DeviceType>( src, dst ),
+        total );
+    space.fence();
+    return total;
+}
+
+template <typename ST, typename... SP, typename DT, typename... DP>
+typename Kokkos::ViewTraits<DT, DP...>::non_const_value_type
+exclusivePrefixSum( Kokkos::View<ST, SP...> const &src,
+                    Kokkos::View<DT, DP...> const &dst )
+{
+    using ExecutionSpace =
+        typename Kokkos::ViewTraits<DT, DP...>::execution_space;
+    return exclusivePrefixSum( ExecutionSpace{}, src, dst );
 }
 
 /** \brief In-place exclusive scan.
  *
  *  \param[in,out] v View with range of elements to sum
  *
- *  Calls \c exclusivePrefixSum(v, v)
+ *  Calls \c exclusivePrefixSum(v, v), or \c exclusivePrefixSum(space, v, v)
+ *  when given an execution space instance, and returns its last element.
  */
 template <typename T, typename... P>
-inline void exclusivePrefixSum( Kokkos::View<T, P...> const &v )
+inline typename Kokkos::ViewTraits<T, P...>::non_const_value_type
+exclusivePrefixSum( Kokkos::View<T, P...> const &v )
 {
-    exclusivePrefixSum( v, v );
+    return exclusivePrefixSum( v, v );
+}
+
+template <typename ExecutionSpace, typename T, typename... P>
+inline typename std::enable_if<
+    Kokkos::is_execution_space<ExecutionSpace>::value,
+    typename Kokkos::ViewTraits<T, P...>::non_const_value_type>::type
+exclusivePrefixSum( ExecutionSpace const &space,
+                    Kokkos::View<T, P...> const &v )
+{
+    return exclusivePrefixSum( space, v, v );
+}
+
+/** \brief In-place exclusive scans of several views at once.
+ *
+ *  Same as calling exclusivePrefixSum() on each of the views but they are
+ *  scanned together and their last elements are read back to the host with a
+ *  single synchronization.  They are returned in the order of the views.
+ *
+ *  \pre The views are of rank 1, of the same type, and have the same size.
+ */
+template <typename T, typename... P, typename... Views>
+std::array<T, 1 + sizeof...( Views )>
+exclusivePrefixSums( Kokkos::View<T *, P...> const &v, Views const &... views )
+{
+    using ViewType = Kokkos::View<T *, P...>;
+    using ExecutionSpace = typename ViewType::execution_space;
+    using DeviceType = typename ViewType::device_type;
+    int constexpr n_views = 1 + sizeof...( Views );
+
+    auto const n = v.extent( 0 );
+    Kokkos::Array<Kokkos::View<T *, DeviceType>, n_views> all_views = {
+        {v, views...}};
+    for ( int k = 0; k < n_views; ++k )
+        DTK_REQUIRE( all_views[k].extent( 0 ) == n );
+    using Functor = Details::ExclusiveScansFunctor<T, DeviceType, n_views>;
+    typename Functor::value_type total;
+    Kokkos::parallel_scan( "exclusive_scans",
+                           Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+                           Functor( all_views ), total );
+    ExecutionSpace().fence();
+    std::array<T, n_views> sums;
+    for ( int k = 0; k < n_views; ++k )
+        sums[k] = total.sums[k];
+    return sums;
 }
 
 /** \brief Get a copy of the last element.
@@ -198,7 +421,9 @@ typename ViewType::non_const_value_type min( ViewType const &v )
     Kokkos::Experimental::Min<typename ViewType::non_const_value_type> reducer(
         result );
     Kokkos::parallel_reduce( Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-                             KOKKOS_LAMBDA( int i, int &update ) {
+                             KOKKOS_LAMBDA(
+                                 int i, typename ViewType::non_const_value_type
+                                            &update ) {
                                  if ( v( i ) < update )
                                      update = v( i );
                              },
@@ -208,27 +433,39 @@ typename ViewType::non_const_value_type min( ViewType const &v )
 
 /** \brief Returns the greatest element in the view
  *
+ *  \param[in] space (optional) Execution space instance that performs the
+ *  reduction
  *  \param[in] v Input view
  */
-template <typename ViewType>
-typename ViewType::non_const_value_type max( ViewType const &v )
+template <typename ExecutionSpace, typename ViewType>
+typename std::enable_if<Kokkos::is_execution_space<ExecutionSpace>::value,
+                        typename ViewType::non_const_value_type>::type
+max( ExecutionSpace const &space, ViewType const &v )
 {
     static_assert( ViewType::rank == 1, "max requires a View of rank 1" );
-    using ExecutionSpace = typename ViewType::execution_space;
     auto const n = v.extent( 0 );
     DTK_REQUIRE( n > 0 );
     typename ViewType::non_const_value_type result;
     Kokkos::Experimental::Max<typename ViewType::non_const_value_type> reducer(
         result );
-    Kokkos::parallel_reduce( Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
-                             KOKKOS_LAMBDA( int i, int &update ) {
-                                 if ( v( i ) > update )
-                                     update = v( i );
-                             },
-                             reducer );
+    Kokkos::parallel_reduce(
+        Kokkos::RangePolicy<ExecutionSpace>( space, 0, n ),
+        KOKKOS_LAMBDA( int i,
+                       typename ViewType::non_const_value_type &update ) {
+            if ( v( i ) > update )
+                update = v( i );
+        },
+        reducer );
     return result;
 }
 
+template <typename ViewType>
+typename ViewType::non_const_value_type max( ViewType const &v )
+{
+    using ExecutionSpace = typename ViewType::execution_space;
+    return max( ExecutionSpace{}, v );
+}
+
 /** \brief Accumulate values in a view
  *
  *  \param[in] v Input view
@@ -307,6 +544,44 @@ void adjacentDifference( SrcViewType const &src, DstViewType const &dst )
     Kokkos::fence();
 }
 
+/** \brief Stream compaction.
+ *
+ *  \param[in] label Label of the returned view
+ *  \param[in] n Number of candidate indices
+ *  \param[in] predicate Called on the device as \c predicate(i) for each index
+ *  i in [0, n) and returns whether to keep it
+ *
+ *  Returns the kept indices in increasing order.  This replaces the usual
+ *  sequence of a kernel that flags the indices, an exclusive scan of the
+ *  flags, and a kernel that writes the indices at their offset: a first scan
+ *  counts the indices, which is the only value read back on the host, and a
+ *  second one writes them.  No view of offsets is needed but the predicate
+ *  is evaluated twice.
+ */
+template <typename DeviceType, typename Predicate>
+Kokkos::View<int *, DeviceType> selectIndices( std::string const &label, int n,
+                                               Predicate const &predicate )
+{
+    using ExecutionSpace = typename DeviceType::execution_space;
+    Kokkos::View<int *, DeviceType> indices( label, 0 );
+    int n_selected = 0;
+    Kokkos::parallel_scan(
+        "count_selected_indices", Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        Details::SelectIndicesFunctor<Predicate, DeviceType>( predicate,
+                                                              indices ),
+        n_selected );
+    if ( n_selected == 0 )
+        return indices;
+    indices = Kokkos::View<int *, DeviceType>(
+        Kokkos::ViewAllocateWithoutInitializing( label ), n_selected );
+    Kokkos::parallel_scan(
+        "select_indices", Kokkos::RangePolicy<ExecutionSpace>( 0, n ),
+        Details::SelectIndicesFunctor<Predicate, DeviceType>( predicate,
+                                                              indices ) );
+    Kokkos::fence();
+    return indices;
+}
+
 // FIXME split this into one for STL-like algorithms and another one for view
 // utility helpers
 
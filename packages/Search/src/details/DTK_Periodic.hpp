@@ -0,0 +1,62 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_PERIODIC_HPP
+#define DTK_PERIODIC_HPP
+
+#include <DTK_Point.hpp>
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+
+/** A geometry in a domain that is periodic along some of the directions,
+ * with the given period along them and a zero period along the others.  It
+ * stands for all its images, i.e. its translations by multiples of the
+ * period, so that the objects it is tested against need not be replicated
+ * near the boundaries of the domain.  Distances are measured to the closest
+ * image.  The objects must be smaller than the period.
+ */
+template <typename Geometry>
+struct Periodic
+{
+    KOKKOS_INLINE_FUNCTION
+    Periodic() = default;
+
+    KOKKOS_INLINE_FUNCTION
+    Periodic( Geometry const &geometry, Point const &period )
+        : _geometry( geometry )
+        , _period( period )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Geometry &geometry() { return _geometry; }
+
+    KOKKOS_INLINE_FUNCTION
+    Geometry const &geometry() const { return _geometry; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &period() const { return _period; }
+
+    Geometry _geometry;
+    Point _period = {{0., 0., 0.}};
+};
+
+template <typename Geometry>
+KOKKOS_INLINE_FUNCTION Periodic<Geometry> periodic( Geometry const &geometry,
+                                                    Point const &period )
+{
+    return Periodic<Geometry>( geometry, period );
+}
+} // namespace DataTransferKit
+
+#endif
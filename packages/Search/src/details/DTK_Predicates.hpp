@@ -14,6 +14,8 @@
 #include <DTK_DetailsAlgorithms.hpp>
 #include <DTK_DetailsNode.hpp>
 
+#include <type_traits>
+
 namespace DataTransferKit
 {
 namespace Details
@@ -26,6 +28,10 @@ struct SpatialPredicateTag
 };
 } // namespace Details
 
+/** The k objects nearest to the geometry among those strictly closer than
+ * the maximum distance, i.e. there may be fewer than k of them.  The search
+ * never visits the parts of the hierarchy beyond that distance.
+ */
 template <typename Geometry>
 struct Nearest
 {
@@ -35,14 +41,40 @@ struct Nearest
     Nearest() = default;
 
     KOKKOS_INLINE_FUNCTION
-    Nearest( Geometry const &geometry, int k )
+    Nearest( Geometry const &geometry, int k,
+             double max_distance =
+                 KokkosHelpers::ArithTraits<double>::infinity() )
         : _geometry( geometry )
         , _k( k )
+        , _max_distance( max_distance )
     {
     }
 
     Geometry _geometry;
     int _k = 0;
+    double _max_distance = KokkosHelpers::ArithTraits<double>::infinity();
+};
+
+/** Same as Nearest with a number of neighbors K known at compile time, e.g.
+ * one for the nearest neighbor or the size of the basis of a moving least
+ * squares interpolation.  The neighbors found so far are then kept by each
+ * thread in a heap of fixed capacity, which the compiler can keep in
+ * registers, and query() needs no memory for them.
+ */
+template <typename Geometry, int K>
+struct NearestK : Nearest<Geometry>
+{
+    static_assert( K > 0, "NearestK must search for at least one neighbor" );
+
+    KOKKOS_INLINE_FUNCTION NearestK() { this->_k = K; }
+
+    KOKKOS_INLINE_FUNCTION
+    NearestK( Geometry const &geometry,
+              double max_distance =
+                  KokkosHelpers::ArithTraits<double>::infinity() )
+        : Nearest<Geometry>( geometry, K, max_distance )
+    {
+    }
 };
 
 template <typename Geometry>
@@ -57,8 +89,8 @@ struct Intersects
     {
     }
 
-    KOKKOS_INLINE_FUNCTION
-    bool operator()( Node const *node ) const
+    template <typename NodeType>
+    KOKKOS_INLINE_FUNCTION bool operator()( NodeType const *node ) const
     {
         return Details::intersects( _geometry, node->bounding_box );
     }
@@ -69,11 +101,125 @@ struct Intersects
 using Within = Intersects<Sphere>;
 using Overlap = Intersects<Box>;
 
+/** Spatial predicates in a periodic domain (see Periodic).  The nearest
+ * predicates are periodic when their geometry is, e.g.
+ * nearest( periodic( point, period ), k ).
+ */
+using PeriodicWithin = Intersects<Periodic<Sphere>>;
+using PeriodicOverlap = Intersects<Periodic<Box>>;
+
+/** The objects whose bounding boxes a ray or a segment intersects are
+ * reported by increasing distance from its origin to the point where it
+ * enters the boxes, e.g. in the order in which a particle moving along the
+ * segment crosses the cells.
+ */
+using RayIntersects = Intersects<Ray>;
+using SegmentIntersects = Intersects<Segment>;
+
+/** Modifiers for spatial predicates.  With FirstHit, the traversal stops as
+ * soon as one object satisfying the predicate has been found.  Which one is
+ * unspecified, except for rays and segments for which it is the closest one.
+ * With CountOnly, the objects are counted but not reported,
+ * i.e. the offsets are computed as usual and the indices are left empty.
+ * Combining both tells whether any object satisfies the predicate.
+ */
+template <typename Predicate>
+struct FirstHit : Predicate
+{
+    KOKKOS_INLINE_FUNCTION FirstHit() = default;
+
+    KOKKOS_INLINE_FUNCTION FirstHit( Predicate const &predicate )
+        : Predicate( predicate )
+    {
+    }
+};
+
+template <typename Predicate>
+struct CountOnly : Predicate
+{
+    KOKKOS_INLINE_FUNCTION CountOnly() = default;
+
+    KOKKOS_INLINE_FUNCTION CountOnly( Predicate const &predicate )
+        : Predicate( predicate )
+    {
+    }
+};
+
+namespace Details
+{
+template <typename Predicate>
+struct StopsAtFirstHit : std::false_type
+{
+};
+
+template <typename Predicate>
+struct StopsAtFirstHit<FirstHit<Predicate>> : std::true_type
+{
+};
+
+template <typename Predicate>
+struct StopsAtFirstHit<CountOnly<Predicate>> : StopsAtFirstHit<Predicate>
+{
+};
+
+template <typename Predicate>
+struct ReportsResults : std::true_type
+{
+};
+
+template <typename Predicate>
+struct ReportsResults<CountOnly<Predicate>> : std::false_type
+{
+};
+
+template <typename Predicate>
+struct ReportsResults<FirstHit<Predicate>> : ReportsResults<Predicate>
+{
+};
+
+// Whether the results are reported by increasing entry distance.  Counting
+// them does not need that order.
+template <typename Predicate>
+struct ReportsInEntryOrder : std::false_type
+{
+};
+
+template <>
+struct ReportsInEntryOrder<Intersects<Ray>> : std::true_type
+{
+};
+
+template <>
+struct ReportsInEntryOrder<Intersects<Segment>> : std::true_type
+{
+};
+
+template <typename Predicate>
+struct ReportsInEntryOrder<FirstHit<Predicate>>
+    : ReportsInEntryOrder<Predicate>
+{
+};
+
+template <typename Predicate>
+struct ReportsInEntryOrder<CountOnly<Predicate>> : std::false_type
+{
+};
+} // namespace Details
+
 template <typename Geometry>
-KOKKOS_INLINE_FUNCTION Nearest<Geometry> nearest( Geometry const &geometry,
-                                                  int k = 1 )
+KOKKOS_INLINE_FUNCTION Nearest<Geometry>
+nearest( Geometry const &geometry, int k = 1,
+         double max_distance = KokkosHelpers::ArithTraits<double>::infinity() )
 {
-    return Nearest<Geometry>( geometry, k );
+    return Nearest<Geometry>( geometry, k, max_distance );
+}
+
+template <int K, typename Geometry>
+KOKKOS_INLINE_FUNCTION NearestK<Geometry, K>
+nearestK( Geometry const &geometry,
+          double max_distance = KokkosHelpers::ArithTraits<double>::infinity() )
+{
+    return NearestK<Geometry, K>( geometry, max_distance );
 }
 
 KOKKOS_INLINE_FUNCTION
@@ -82,6 +228,52 @@ Within within( Point const &p, double r ) { return Within( {p, r} ); }
 KOKKOS_INLINE_FUNCTION
 Overlap overlap( Box const &b ) { return Overlap( b ); }
 
+KOKKOS_INLINE_FUNCTION
+PeriodicWithin within( Point const &p, double r, Point const &period )
+{
+    return PeriodicWithin( periodic( Sphere( p, r ), period ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+PeriodicOverlap overlap( Box const &b, Point const &period )
+{
+    return PeriodicOverlap( periodic( b, period ) );
+}
+
+KOKKOS_INLINE_FUNCTION
+RayIntersects intersects( Ray const &r ) { return RayIntersects( r ); }
+
+KOKKOS_INLINE_FUNCTION
+SegmentIntersects intersects( Segment const &s )
+{
+    return SegmentIntersects( s );
+}
+
+template <typename Predicate>
+KOKKOS_INLINE_FUNCTION FirstHit<Predicate> firstHit( Predicate const &pred )
+{
+    static_assert( std::is_same<typename Predicate::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "firstHit() only applies to spatial predicates" );
+    return FirstHit<Predicate>( pred );
+}
+
+template <typename Predicate>
+KOKKOS_INLINE_FUNCTION CountOnly<Predicate> countOnly( Predicate const &pred )
+{
+    static_assert( std::is_same<typename Predicate::Tag,
+                                Details::SpatialPredicateTag>::value,
+                   "countOnly() only applies to spatial predicates" );
+    return CountOnly<Predicate>( pred );
+}
+
+template <typename Predicate>
+KOKKOS_INLINE_FUNCTION CountOnly<FirstHit<Predicate>>
+anyHit( Predicate const &pred )
+{
+    return countOnly( firstHit( pred ) );
+}
+
 } // namespace DataTransferKit
 
 #endif
@@ -0,0 +1,183 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#ifndef DTK_QUERY_WORKSPACE_HPP
+#define DTK_QUERY_WORKSPACE_HPP
+
+#include <DTK_DetailsCachingAllocator.hpp>
+#include <DTK_DetailsUtils.hpp> // reallocWithoutInitializing
+
+#include <Kokkos_View.hpp>
+
+#include <algorithm> // max
+#include <cstddef>
+#include <string>
+#include <utility> // make_pair
+
+namespace DataTransferKit
+{
+
+/** Storage kept from one query to the next, passed to
+ * BoundingVolumeHierarchy::query() in place of the indices, offset, and
+ * distances views.  The results are views of the first entries of buffers
+ * that only grow, so that a query that yields no more results than a previous
+ * one does not allocate them again, and the temporaries of the queries are
+ * drawn from a caching allocator that belongs to the workspace.  Repeated
+ * queries of similar sizes then allocate nothing, provided that the queries
+ * are passed already sorted along a QueryOrdering.
+ *
+ * The results are overwritten by the next query performed with the same
+ * workspace.  A workspace must not be used by two queries at once.
+ */
+template <typename DeviceType>
+class QueryWorkspace
+{
+  public:
+    using MemorySpace = typename DeviceType::memory_space;
+
+    QueryWorkspace() = default;
+    QueryWorkspace( QueryWorkspace const & ) = delete;
+    QueryWorkspace &operator=( QueryWorkspace const & ) = delete;
+
+    // Results of the last query, in the same format as the views passed to
+    // query().  The distances are only written by nearest queries.
+    Kokkos::View<int *, DeviceType> indices;
+    Kokkos::View<int *, DeviceType> offset;
+    Kokkos::View<double *, DeviceType> distances;
+
+    //! Total capacity in bytes of the buffers and of the cached temporaries.
+    std::size_t size() const
+    {
+        return ( _indices_buffer.extent( 0 ) + _offset_buffer.extent( 0 ) ) *
+                   sizeof( int ) +
+               _distances_buffer.extent( 0 ) * sizeof( double ) +
+               _allocator.size();
+    }
+
+    //! Free the buffers and the temporaries that are not in use.
+    void release()
+    {
+        indices = Kokkos::View<int *, DeviceType>();
+        offset = Kokkos::View<int *, DeviceType>();
+        distances = Kokkos::View<double *, DeviceType>();
+        _indices_buffer = Kokkos::View<int *, DeviceType>();
+        _offset_buffer = Kokkos::View<int *, DeviceType>();
+        _distances_buffer = Kokkos::View<double *, DeviceType>();
+        _allocator.release();
+    }
+
+    // Workspace that the queries of the calling thread write their results
+    // into, if any (see Details::QueryWorkspaceScope).
+    static QueryWorkspace *&current()
+    {
+        static thread_local QueryWorkspace *workspace = nullptr;
+        return workspace;
+    }
+
+    // Make v the first n entries of its buffer, growing the buffer if needed.
+    // Return false if v is not one of the results of the workspace.
+    bool resize( Kokkos::View<int *, DeviceType> &v, std::size_t n )
+    {
+        if ( &v == &indices )
+            v = take( _indices_buffer, n );
+        else if ( &v == &offset )
+            v = take( _offset_buffer, n );
+        else
+            return false;
+        return true;
+    }
+
+    bool resize( Kokkos::View<double *, DeviceType> &v, std::size_t n )
+    {
+        if ( &v != &distances )
+            return false;
+        v = take( _distances_buffer, n );
+        return true;
+    }
+
+    template <typename View>
+    bool resize( View &, std::size_t )
+    {
+        return false;
+    }
+
+    Details::CachingAllocator<MemorySpace> &getAllocator()
+    {
+        return _allocator;
+    }
+
+  private:
+    // The buffers grow geometrically so that queries whose number of results
+    // slowly increases only reallocate them a few times.
+    template <typename T>
+    static Kokkos::View<T *, DeviceType>
+    take( Kokkos::View<T *, DeviceType> &buffer, std::size_t n )
+    {
+        if ( buffer.extent( 0 ) < n )
+            buffer = Kokkos::View<T *, DeviceType>(
+                Kokkos::ViewAllocateWithoutInitializing( "query_results" ),
+                std::max( n, 2 * buffer.extent( 0 ) ) );
+        return Kokkos::subview( buffer,
+                                std::make_pair( std::size_t( 0 ), n ) );
+    }
+
+    Kokkos::View<int *, DeviceType> _indices_buffer;
+    Kokkos::View<int *, DeviceType> _offset_buffer;
+    Kokkos::View<double *, DeviceType> _distances_buffer;
+    Details::CachingAllocator<MemorySpace> _allocator;
+};
+
+namespace Details
+{
+
+/** Write the results of the queries of the calling thread into the given
+ * workspace and draw their temporaries from its allocator while this object
+ * is alive.
+ */
+template <typename DeviceType>
+class QueryWorkspaceScope
+{
+  public:
+    explicit QueryWorkspaceScope( QueryWorkspace<DeviceType> &workspace )
+        : _previous( QueryWorkspace<DeviceType>::current() )
+        , _allocator_scope( workspace.getAllocator() )
+    {
+        QueryWorkspace<DeviceType>::current() = &workspace;
+    }
+
+    ~QueryWorkspaceScope()
+    {
+        QueryWorkspace<DeviceType>::current() = _previous;
+    }
+
+    QueryWorkspaceScope( QueryWorkspaceScope const & ) = delete;
+    QueryWorkspaceScope &operator=( QueryWorkspaceScope const & ) = delete;
+
+  private:
+    QueryWorkspace<DeviceType> *_previous;
+    CachingAllocatorScope<typename DeviceType::memory_space> _allocator_scope;
+};
+
+// Reallocate one of the results of a query.  The results of the current
+// workspace, if any, reuse its buffers.  The previous values are lost either
+// way.
+template <typename DeviceType, typename View>
+void reallocResults( View &v, std::size_t n )
+{
+    auto *workspace = QueryWorkspace<DeviceType>::current();
+    if ( workspace == nullptr || !workspace->resize( v, n ) )
+        reallocWithoutInitializing( v, n );
+}
+
+} // namespace Details
+} // namespace DataTransferKit
+
+#endif
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#ifndef DTK_RAY_HPP
+#define DTK_RAY_HPP
+
+#include <DTK_Point.hpp>
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+
+/** Half-line starting at the origin and extending along the direction, which
+ *  need not be normalized but must not vanish.
+ */
+struct Ray
+{
+    KOKKOS_INLINE_FUNCTION
+    Ray() = default;
+
+    KOKKOS_INLINE_FUNCTION
+    Ray( Point const &origin, Point const &direction )
+        : _origin( origin )
+        , _direction( direction )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &origin() { return _origin; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &origin() const { return _origin; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &direction() { return _direction; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &direction() const { return _direction; }
+
+    Point _origin = {{0., 0., 0.}};
+    Point _direction = {{1., 0., 0.}};
+};
+} // namespace DataTransferKit
+
+#endif
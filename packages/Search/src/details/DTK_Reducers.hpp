@@ -0,0 +1,84 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#ifndef DTK_REDUCERS_HPP
+#define DTK_REDUCERS_HPP
+
+#include <Kokkos_ArithTraits.hpp>
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+
+/** Reducers for the reduction queries, e.g.
+ * BoundingVolumeHierarchy::reduce().  The values of the objects that satisfy
+ * a predicate are combined with join() into a value that init() has set to
+ * the identity of the reduction.  join() must be associative and commutative
+ * since the objects are not visited in any particular order and partial
+ * values may be combined across processes.  Any type that provides the same
+ * interface can be used instead.
+ */
+template <typename T>
+struct SumReducer
+{
+    using value_type = T;
+
+    KOKKOS_INLINE_FUNCTION void init( value_type &value ) const { value = 0; }
+
+    KOKKOS_INLINE_FUNCTION void join( value_type &update,
+                                      value_type const &value ) const
+    {
+        update += value;
+    }
+};
+
+template <typename T>
+struct MinReducer
+{
+    using value_type = T;
+
+    KOKKOS_INLINE_FUNCTION void init( value_type &value ) const
+    {
+        value = Kokkos::ArithTraits<T>::max();
+    }
+
+    KOKKOS_INLINE_FUNCTION void join( value_type &update,
+                                      value_type const &value ) const
+    {
+        if ( value < update )
+            update = value;
+    }
+};
+
+template <typename T>
+struct MaxReducer
+{
+    using value_type = T;
+
+    KOKKOS_INLINE_FUNCTION void init( value_type &value ) const
+    {
+        // ArithTraits<T>::min() is the smallest positive value for floating
+        // point types.
+        value = Kokkos::ArithTraits<T>::is_integer
+                    ? Kokkos::ArithTraits<T>::min()
+                    : -Kokkos::ArithTraits<T>::max();
+    }
+
+    KOKKOS_INLINE_FUNCTION void join( value_type &update,
+                                      value_type const &value ) const
+    {
+        if ( update < value )
+            update = value;
+    }
+};
+
+} // namespace DataTransferKit
+
+#endif
@@ -0,0 +1,52 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#ifndef DTK_SEGMENT_HPP
+#define DTK_SEGMENT_HPP
+
+#include <DTK_Point.hpp>
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+
+/** Line segment between two end points, oriented from the first to the
+ *  second one, e.g. the step of a particle.
+ */
+struct Segment
+{
+    KOKKOS_INLINE_FUNCTION
+    Segment() = default;
+
+    KOKKOS_INLINE_FUNCTION
+    Segment( Point const &start, Point const &end )
+        : _start( start )
+        , _end( end )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &start() { return _start; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &start() const { return _start; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &end() { return _end; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &end() const { return _end; }
+
+    Point _start = {{0., 0., 0.}};
+    Point _end = {{0., 0., 0.}};
+};
+} // namespace DataTransferKit
+
+#endif
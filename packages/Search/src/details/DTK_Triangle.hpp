@@ -0,0 +1,60 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#ifndef DTK_TRIANGLE_HPP
+#define DTK_TRIANGLE_HPP
+
+#include <DTK_Point.hpp>
+#include <Kokkos_Macros.hpp>
+
+namespace DataTransferKit
+{
+
+/** Triangle given by its three vertices, e.g. a face of a surface mesh.
+ *  Quadrilateral faces are split into two triangles.
+ */
+struct Triangle
+{
+    KOKKOS_INLINE_FUNCTION
+    Triangle() = default;
+
+    KOKKOS_INLINE_FUNCTION
+    Triangle( Point const &a, Point const &b, Point const &c )
+        : _a( a )
+        , _b( b )
+        , _c( c )
+    {
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &a() { return _a; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &a() const { return _a; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &b() { return _b; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &b() const { return _b; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point &c() { return _c; }
+
+    KOKKOS_INLINE_FUNCTION
+    Point const &c() const { return _c; }
+
+    Point _a = {{0., 0., 0.}};
+    Point _b = {{0., 0., 0.}};
+    Point _c = {{0., 0., 0.}};
+};
+} // namespace DataTransferKit
+
+#endif
@@ -22,16 +22,20 @@
 #include <Teuchos_LocalTestingHelpers.hpp>
 #include <Teuchos_RCP.hpp>
 
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <utility>
 #include <vector>
 
 // The `out` and `success` parameters come from the Teuchos unit testing macros
 // expansion.
-template <typename Query, typename DeviceType>
-void checkResults( DataTransferKit::BVH<DeviceType> const &bvh,
-                   Kokkos::View<Query *, DeviceType> const &queries,
-                   std::vector<int> const &indices_ref,
-                   std::vector<int> const &offset_ref, bool &success,
-                   Teuchos::FancyOStream &out )
+template <typename Query, typename DeviceType, typename Coordinate>
+void checkResults(
+    DataTransferKit::BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Kokkos::View<Query *, DeviceType> const &queries,
+    std::vector<int> const &indices_ref, std::vector<int> const &offset_ref,
+    bool &success, Teuchos::FancyOStream &out )
 {
     Kokkos::View<int *, DeviceType> indices( "indices" );
     Kokkos::View<int *, DeviceType> offset( "offset" );
@@ -49,13 +53,13 @@ void checkResults( DataTransferKit::BVH<DeviceType> const &bvh,
 // Same as above except that we get the distances out of the queries and
 // compare them to the reference solution passed as argument.  Templated type
 // `Query` is pretty much a nearest predicate in this case.
-template <typename Query, typename DeviceType>
-void checkResults( DataTransferKit::BVH<DeviceType> const &bvh,
-                   Kokkos::View<Query *, DeviceType> const &queries,
-                   std::vector<int> const &indices_ref,
-                   std::vector<int> const &offset_ref,
-                   std::vector<double> const &distances_ref, bool &success,
-                   Teuchos::FancyOStream &out )
+template <typename Query, typename DeviceType, typename Coordinate>
+void checkResults(
+    DataTransferKit::BoundingVolumeHierarchy<DeviceType, Coordinate> const &bvh,
+    Kokkos::View<Query *, DeviceType> const &queries,
+    std::vector<int> const &indices_ref, std::vector<int> const &offset_ref,
+    std::vector<double> const &distances_ref, bool &success,
+    Teuchos::FancyOStream &out )
 {
     Kokkos::View<int *, DeviceType> indices( "indices" );
     Kokkos::View<int *, DeviceType> offset( "offset" );
@@ -189,6 +193,26 @@ makeNearestQueries(
     return queries;
 }
 
+// Same as above except that the neighbors are only searched for closer than
+// the maximum distance stored last in the tuples.
+template <typename DeviceType>
+Kokkos::View<DataTransferKit::Nearest<DataTransferKit::Point> *, DeviceType>
+makeLimitedNearestQueries(
+    std::vector<std::tuple<DataTransferKit::Point, int, double>> const
+        &points )
+{
+    int const n = points.size();
+    Kokkos::View<DataTransferKit::Nearest<DataTransferKit::Point> *, DeviceType>
+        queries( "nearest_queries", n );
+    auto queries_host = Kokkos::create_mirror_view( queries );
+    for ( int i = 0; i < n; ++i )
+        queries_host( i ) = DataTransferKit::nearest(
+            std::get<0>( points[i] ), std::get<1>( points[i] ),
+            std::get<2>( points[i] ) );
+    Kokkos::deep_copy( queries, queries_host );
+    return queries;
+}
+
 template <typename DeviceType>
 Kokkos::View<DataTransferKit::Within *, DeviceType> makeWithinQueries(
     std::vector<std::pair<DataTransferKit::Point, double>> const &points )
@@ -229,4 +253,141 @@ void validateResults( std::tuple<InputView1, InputView1> const &reference,
                                              offset( i + 1 ) ) );
 }
 
+// Results of each query sorted so that they can be compared regardless of the
+// order in which the objects were found.
+template <typename DeviceType>
+std::vector<int> sortedResults( Kokkos::View<int *, DeviceType> indices,
+                                Kokkos::View<int *, DeviceType> offset )
+{
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    std::vector<int> results( indices_host.data(),
+                              indices_host.data() + indices_host.extent( 0 ) );
+    for ( int q = 0; q + 1 < (int)offset_host.extent( 0 ); ++q )
+        std::sort( results.begin() + offset_host( q ),
+                   results.begin() + offset_host( q + 1 ) );
+    return results;
+}
+
+// Compare the results of another search structure to those of the BVH.  The
+// tree is not const for the structures whose queries are not, Tree is deduced
+// as a const type otherwise.
+template <typename Tree, typename DeviceType, typename Query>
+void checkSameSpatialResults( Tree &tree,
+                              DataTransferKit::BVH<DeviceType> const &bvh,
+                              Kokkos::View<Query *, DeviceType> const &queries,
+                              bool &success, Teuchos::FancyOStream &out )
+{
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    tree.query( queries, indices, offset );
+    Kokkos::View<int *, DeviceType> indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> offset_ref( "offset_ref" );
+    bvh.query( queries, indices_ref, offset_ref );
+
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    auto offset_ref_host = Kokkos::create_mirror_view( offset_ref );
+    Kokkos::deep_copy( offset_ref_host, offset_ref );
+    TEST_COMPARE_ARRAYS( offset_host, offset_ref_host );
+    TEST_COMPARE_ARRAYS( sortedResults( indices, offset ),
+                         sortedResults( indices_ref, offset_ref ) );
+}
+
+// Unless some objects are at the same distance from a query, e.g. several
+// boxes that contain it, they come in the same order either way.  Otherwise
+// only the distances are compared.
+template <typename Tree, typename DeviceType, typename Query>
+void checkSameNearestResults( Tree &tree,
+                              DataTransferKit::BVH<DeviceType> const &bvh,
+                              Kokkos::View<Query *, DeviceType> const &queries,
+                              bool compare_indices, bool &success,
+                              Teuchos::FancyOStream &out )
+{
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    tree.query( queries, indices, offset, distances );
+    Kokkos::View<int *, DeviceType> indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> offset_ref( "offset_ref" );
+    Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+    bvh.query( queries, indices_ref, offset_ref, distances_ref );
+
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    auto offset_ref_host = Kokkos::create_mirror_view( offset_ref );
+    Kokkos::deep_copy( offset_ref_host, offset_ref );
+    TEST_COMPARE_ARRAYS( offset_host, offset_ref_host );
+    if ( compare_indices )
+    {
+        auto indices_host = Kokkos::create_mirror_view( indices );
+        Kokkos::deep_copy( indices_host, indices );
+        auto indices_ref_host = Kokkos::create_mirror_view( indices_ref );
+        Kokkos::deep_copy( indices_ref_host, indices_ref );
+        TEST_COMPARE_ARRAYS( indices_host, indices_ref_host );
+    }
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    auto distances_ref_host = Kokkos::create_mirror_view( distances_ref );
+    Kokkos::deep_copy( distances_ref_host, distances_ref );
+    TEST_COMPARE_FLOATING_ARRAYS( distances_host, distances_ref_host, 1e-14 );
+}
+
+template <typename Tree, typename DeviceType, typename Query>
+void checkSameNearestResults( Tree &tree,
+                              DataTransferKit::BVH<DeviceType> const &bvh,
+                              Kokkos::View<Query *, DeviceType> const &queries,
+                              bool &success, Teuchos::FancyOStream &out )
+{
+    checkSameNearestResults( tree, bvh, queries, true, success, out );
+}
+
+// Compare the results of the spatial and nearest queries of all kinds around
+// random points.
+template <typename Tree, typename DeviceType>
+void checkSameAsBVH( Tree &tree,
+                     DataTransferKit::BVH<DeviceType> const &bvh,
+                     bool &success, Teuchos::FancyOStream &out )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    TEST_EQUALITY( tree.size(), bvh.size() );
+    TEST_ASSERT(
+        DataTransferKit::Details::equals( tree.bounds(), bvh.bounds() ) );
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( -1., 11. );
+    std::vector<Box> overlap_boxes;
+    std::vector<std::pair<Point, double>> within_points;
+    std::vector<std::pair<Point, int>> nearest_points;
+    std::vector<std::tuple<Point, int, double>> limited_points;
+    for ( int q = 0; q < 300; ++q )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        overlap_boxes.push_back( {p, {{p[0] + 1., p[1] + 1., p[2] + 1.}}} );
+        within_points.emplace_back( p, 0.1 * ( q % 11 ) );
+        nearest_points.emplace_back( p, q % 7 );
+        limited_points.emplace_back( p, 5, 0.1 * ( q % 5 ) );
+    }
+    // more neighbors than there are objects
+    nearest_points.emplace_back( Point{{-1., -1., -1.}}, bvh.size() + 3 );
+
+    checkSameSpatialResults( tree, bvh,
+                             makeOverlapQueries<DeviceType>( overlap_boxes ),
+                             success, out );
+    checkSameSpatialResults( tree, bvh,
+                             makeWithinQueries<DeviceType>( within_points ),
+                             success, out );
+    checkSameNearestResults( tree, bvh,
+                             makeNearestQueries<DeviceType>( nearest_points ),
+                             success, out );
+    checkSameNearestResults(
+        tree, bvh, makeLimitedNearestQueries<DeviceType>( limited_points ),
+        success, out );
+}
+
 #endif
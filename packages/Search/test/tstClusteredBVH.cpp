@@ -0,0 +1,75 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_LinearBVH.hpp>
+#include <DTK_ClusteredBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <random>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( ClusteredBVH, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    // many objects, fewer than fit in one cluster, and a single one
+    for ( int n : {500, 5, 1} )
+    {
+        // the objects are points, i.e. their boxes are degenerate
+        Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+        auto boxes_host = Kokkos::create_mirror_view( boxes );
+        for ( int i = 0; i < n; ++i )
+        {
+            Point p = {{distribution( generator ), distribution( generator ),
+                        distribution( generator )}};
+            boxes_host( i ) = {p, p};
+        }
+        Kokkos::deep_copy( boxes, boxes_host );
+        DataTransferKit::BVH<DeviceType> const bvh( boxes );
+
+        for ( int leaf_size : {1, 4, 16} )
+        {
+            DataTransferKit::ClusteredBVH<DeviceType> const tree( boxes,
+                                                                  leaf_size );
+            checkSameAsBVH( tree, bvh, success, out );
+            TEST_EQUALITY( tree.numberOfClusters(),
+                           ( n + leaf_size - 1 ) / leaf_size );
+        }
+    }
+
+    // nothing in the tree
+    DataTransferKit::BVH<DeviceType> const empty_bvh;
+    DataTransferKit::ClusteredBVH<DeviceType> const empty_tree(
+        Kokkos::View<Box *, DeviceType>( "boxes", 0 ) );
+    TEST_ASSERT( empty_tree.empty() );
+    TEST_EQUALITY( empty_tree.numberOfClusters(), 0 );
+    checkSameAsBVH( empty_tree, empty_bvh, success, out );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( ClusteredBVH, same_as_bvh,           \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -12,6 +12,8 @@
 
 #include <Teuchos_UnitTestHarness.hpp>
 
+#include <vector>
+
 namespace dtk = DataTransferKit::Details;
 
 TEUCHOS_UNIT_TEST( DetailsAlgorithms, distance )
@@ -42,6 +44,22 @@ TEUCHOS_UNIT_TEST( DetailsAlgorithms, distance )
                    std::sqrt( 3. ) - 1. );
 }
 
+TEUCHOS_UNIT_TEST( DetailsAlgorithms, distance_squared )
+{
+    TEST_EQUALITY(
+        dtk::distanceSquared( {{1.0, 2.0, 3.0}}, {{1.0, 1.0, 1.0}} ), 5.0 );
+
+    DataTransferKit::Box box = {{{0.0, 0.0, 0.0}}, {{1.0, 1.0, 1.0}}};
+    TEST_EQUALITY( dtk::distanceSquared( {{0.5, 0.5, 0.5}}, box ), 0.0 );
+    TEST_EQUALITY( dtk::distanceSquared( {{2.0, 0.75, -1.0}}, box ), 2.0 );
+    TEST_EQUALITY( dtk::distanceSquared( {{-1.0, 2.0, 2.0}}, box ), 3.0 );
+
+    // the square root of the squared distance is exactly the distance
+    DataTransferKit::Point const point = {{.3, -1.7, 2.9}};
+    TEST_EQUALITY( std::sqrt( dtk::distanceSquared( point, box ) ),
+                   dtk::distance( point, box ) );
+}
+
 TEUCHOS_UNIT_TEST( DetailsAlgorithms, overlaps )
 {
     DataTransferKit::Box box;
@@ -94,6 +112,97 @@ TEUCHOS_UNIT_TEST( DetailsAlgorithms, intersects )
     TEST_ASSERT( !dtk::intersects( sphere, {{{1., 2., 3.}}, {{4., 5., 6.}}} ) );
 }
 
+TEUCHOS_UNIT_TEST( DetailsAlgorithms, periodic )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+    using DataTransferKit::Sphere;
+    using DataTransferKit::periodic;
+
+    // unit cube in a domain of period 2 along x
+    Box box = {{{0., 0., 0.}}, {{1., 1., 1.}}};
+    Point const period = {{2., 0., 0.}};
+
+    // the closest image of the box is the one translated by the period, on
+    // either side, or the box itself
+    TEST_FLOATING_EQUALITY(
+        dtk::distance( periodic( Point{{1.9, .5, .5}}, period ), box ), .1,
+        1e-14 );
+    TEST_FLOATING_EQUALITY(
+        dtk::distance( periodic( Point{{-.25, .5, .5}}, period ), box ), .25,
+        1e-14 );
+    TEST_FLOATING_EQUALITY(
+        dtk::distance( periodic( Point{{3.5, .5, .5}}, period ), box ), .5,
+        1e-14 );
+    TEST_EQUALITY(
+        dtk::distance( periodic( Point{{4.5, .5, .5}}, period ), box ), 0. );
+    // the other directions are not periodic
+    TEST_FLOATING_EQUALITY(
+        dtk::distanceSquared( periodic( Point{{1.9, 3., .5}}, period ), box ),
+        4.01, 1e-14 );
+    // without period, same as the distance to the box itself
+    TEST_EQUALITY( dtk::distance( periodic( Point{{1.9, 3., .5}},
+                                            Point{{0., 0., 0.}} ),
+                                  box ),
+                   dtk::distance( Point{{1.9, 3., .5}}, box ) );
+
+    TEST_ASSERT( !dtk::intersects( Sphere{{{1.95, .5, .5}}, .1}, box ) );
+    TEST_ASSERT( dtk::intersects(
+        periodic( Sphere{{{1.95, .5, .5}}, .1}, period ), box ) );
+    TEST_ASSERT( !dtk::intersects(
+        periodic( Sphere{{{1.5, .5, .5}}, .1}, period ), box ) );
+
+    TEST_ASSERT( !dtk::intersects(
+        periodic( Box{{{1.8, 0., 0.}}, {{1.9, 1., 1.}}}, period ), box ) );
+    TEST_ASSERT( dtk::intersects(
+        periodic( Box{{{1.8, 0., 0.}}, {{2.1, 1., 1.}}}, period ), box ) );
+    TEST_ASSERT( dtk::intersects(
+        periodic( Box{{{-3., .5, .5}}, {{-2.5, .5, .5}}}, period ), box ) );
+    TEST_ASSERT( !dtk::intersects(
+        periodic( Box{{{1.8, 2., 0.}}, {{2.1, 3., 1.}}}, period ), box ) );
+}
+
+TEUCHOS_UNIT_TEST( DetailsAlgorithms, ray_and_segment )
+{
+    double const infinity =
+        DataTransferKit::KokkosHelpers::ArithTraits<double>::infinity();
+    DataTransferKit::Box const box = {{{0., 0., 0.}}, {{1., 1., 1.}}};
+
+    // the distance is measured along the ray even if the direction is not
+    // normalized
+    DataTransferKit::Ray ray( {{-1., 0.5, 0.5}}, {{2., 0., 0.}} );
+    TEST_EQUALITY( dtk::entryDistance( ray, box ), 1. );
+    TEST_ASSERT( dtk::intersects( ray, box ) );
+    // zero if the origin is inside the box
+    ray = DataTransferKit::Ray( {{0.5, 0.5, 0.5}}, {{1., 1., 1.}} );
+    TEST_EQUALITY( dtk::entryDistance( ray, box ), 0. );
+    // pointing away from the box
+    ray = DataTransferKit::Ray( {{-1., 0.5, 0.5}}, {{-1., 0., 0.}} );
+    TEST_EQUALITY( dtk::entryDistance( ray, box ), infinity );
+    TEST_ASSERT( !dtk::intersects( ray, box ) );
+    // parallel to a face, inside or outside of the slab
+    ray = DataTransferKit::Ray( {{-1., 1., 0.5}}, {{1., 0., 0.}} );
+    TEST_EQUALITY( dtk::entryDistance( ray, box ), 1. );
+    ray = DataTransferKit::Ray( {{-1., 1.5, 0.5}}, {{1., 0., 0.}} );
+    TEST_ASSERT( !dtk::intersects( ray, box ) );
+    // through a corner of the box
+    ray = DataTransferKit::Ray( {{2., 2., 2.}}, {{-1., -1., -1.}} );
+    TEST_EQUALITY( dtk::entryDistance( ray, box ), std::sqrt( 3. ) );
+
+    // the segment stops short of or reaches into the box
+    DataTransferKit::Segment segment( {{-1., 0.5, 0.5}}, {{-0.5, 0.5, 0.5}} );
+    TEST_ASSERT( !dtk::intersects( segment, box ) );
+    segment = DataTransferKit::Segment( {{-1., 0.5, 0.5}}, {{0.5, 0.5, 0.5}} );
+    TEST_EQUALITY( dtk::entryDistance( segment, box ), 1. );
+    segment = DataTransferKit::Segment( {{2., 0.5, 0.5}}, {{1., 0.5, 0.5}} );
+    TEST_EQUALITY( dtk::entryDistance( segment, box ), 1. );
+    // degenerate segments are points
+    segment = DataTransferKit::Segment( {{0.5, 0.5, 0.5}}, {{0.5, 0.5, 0.5}} );
+    TEST_EQUALITY( dtk::entryDistance( segment, box ), 0. );
+    segment = DataTransferKit::Segment( {{2., 0.5, 0.5}}, {{2., 0.5, 0.5}} );
+    TEST_EQUALITY( dtk::entryDistance( segment, box ), infinity );
+}
+
 TEUCHOS_UNIT_TEST( DetailsAlgorithms, equals )
 {
     // points
@@ -153,6 +262,36 @@ TEUCHOS_UNIT_TEST( DetailsAlgorithms, centroid )
     TEST_EQUALITY( centroid[2], 15.0 );
 }
 
+TEUCHOS_UNIT_TEST( DetailsAlgorithms, closest_point_on_triangle )
+{
+    DataTransferKit::Triangle const triangle( {{0., 0., 0.}}, {{1., 0., 0.}},
+                                              {{0., 1., 0.}} );
+    auto const check = [&]( DataTransferKit::Point const &point,
+                            DataTransferKit::Point const &closest,
+                            std::vector<double> const &barycentric ) {
+        double coordinates[3];
+        TEST_ASSERT( dtk::equals(
+            dtk::closestPoint( point, triangle, coordinates ), closest ) );
+        TEST_COMPARE_ARRAYS( std::vector<double>( coordinates,
+                                                  coordinates + 3 ),
+                             barycentric );
+    };
+
+    // above the interior
+    check( {{.25, .25, 1.}}, {{.25, .25, 0.}}, {.5, .25, .25} );
+    // closest to a vertex
+    check( {{-1., -1., 0.}}, {{0., 0., 0.}}, {1., 0., 0.} );
+    check( {{2., -1., 3.}}, {{1., 0., 0.}}, {0., 1., 0.} );
+    check( {{-1., 2., 0.}}, {{0., 1., 0.}}, {0., 0., 1.} );
+    // closest to an edge
+    check( {{.5, -1., 0.}}, {{.5, 0., 0.}}, {.5, .5, 0.} );
+    check( {{1., 1., 0.}}, {{.5, .5, 0.}}, {0., .5, .5} );
+    check( {{-1., .5, -2.}}, {{0., .5, 0.}}, {.5, 0., .5} );
+
+    TEST_EQUALITY( dtk::distance( {{.25, .25, 1.}}, triangle ), 1. );
+    TEST_EQUALITY( dtk::distance( {{.5, -1., 0.}}, triangle ), 1. );
+}
+
 TEUCHOS_UNIT_TEST( DetailsAlgorithms, is_valid )
 {
     using DataTransferKit::Box;
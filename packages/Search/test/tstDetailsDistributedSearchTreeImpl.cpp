@@ -140,6 +140,134 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl, recv_from,
     TEST_COMPARE_ARRAYS( imports, recv_from );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
+                                   unsorted_exports, DeviceType )
+{
+    // Exports need not be grouped by destination.  Imports come sorted by
+    // rank of the sender and, for a given sender, in the order they were
+    // exported.
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+
+    int const n_exports = 2 * comm_size;
+    std::vector<int> export_ranks( n_exports );
+    Kokkos::View<int *, DeviceType> exports( "exports", n_exports );
+    auto exports_host = Kokkos::create_mirror_view( exports );
+    for ( int i = 0; i < n_exports; ++i )
+    {
+        export_ranks[i] = comm_size - 1 - i % comm_size;
+        exports_host( i ) = 1000 * comm_rank + i;
+    }
+    Kokkos::deep_copy( exports, exports_host );
+
+    DataTransferKit::Details::Distributor distributor( comm );
+    int const n_imports = distributor.createFromSends(
+        Teuchos::ArrayView<int const>( export_ranks ) );
+    TEST_EQUALITY( n_imports, n_exports );
+    TEST_EQUALITY( distributor.getPermutation().size() == 0, comm_size == 1 );
+
+    Kokkos::View<int *, DeviceType> imports( "imports", n_imports );
+    DataTransferKit::Details::DistributedSearchTreeImpl<
+        DeviceType>::sendAcrossNetwork( distributor, exports, imports );
+    auto const import_ranks = DataTransferKit::Details::
+        DistributedSearchTreeImpl<DeviceType>::getImportRanks( distributor );
+
+    auto imports_host = Kokkos::create_mirror_view( imports );
+    Kokkos::deep_copy( imports_host, imports );
+    auto import_ranks_host = Kokkos::create_mirror_view( import_ranks );
+    Kokkos::deep_copy( import_ranks_host, import_ranks );
+    std::vector<int> imports_ref;
+    std::vector<int> import_ranks_ref;
+    for ( int r = 0; r < comm_size; ++r )
+        for ( int i = comm_size - 1 - comm_rank; i < n_exports; i += comm_size )
+        {
+            imports_ref.push_back( 1000 * r + i );
+            import_ranks_ref.push_back( r );
+        }
+    TEST_COMPARE_ARRAYS( std::vector<int>( imports_host.data(),
+                                           imports_host.data() + n_imports ),
+                         imports_ref );
+    TEST_COMPARE_ARRAYS(
+        std::vector<int>( import_ranks_host.data(),
+                          import_ranks_host.data() + n_imports ),
+        import_ranks_ref );
+
+    // Same plan when the ranks to receive from are known beforehand.
+    DataTransferKit::Details::Distributor other_distributor( comm );
+    TEST_EQUALITY( other_distributor.createFromSendsAndRecvs(
+                       Teuchos::ArrayView<int const>( export_ranks ),
+                       Teuchos::ArrayView<int const>( import_ranks_ref ) ),
+                   size_t( n_imports ) );
+    Kokkos::deep_copy( imports, -1 );
+    DataTransferKit::Details::DistributedSearchTreeImpl<
+        DeviceType>::sendAcrossNetwork( other_distributor, exports, imports );
+    Kokkos::deep_copy( imports_host, imports );
+    TEST_COMPARE_ARRAYS( std::vector<int>( imports_host.data(),
+                                           imports_host.data() + n_imports ),
+                         imports_ref );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
+                                   node_aware_exchange, DeviceType )
+{
+    // Routing the values through the nodes does not change the layout of the
+    // imports.
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = comm->getRank();
+    int const comm_size = comm->getSize();
+
+    // Send i % 3 values to each rank i, interleaved.
+    std::vector<int> export_ranks;
+    for ( int k = 0; k < 2; ++k )
+        for ( int i = 0; i < comm_size; ++i )
+            if ( k < i % 3 )
+                export_ranks.push_back( ( comm_rank + i ) % comm_size );
+    int const n_exports = export_ranks.size();
+    Kokkos::View<int *, DeviceType> exports( "exports", n_exports );
+    auto exports_host = Kokkos::create_mirror_view( exports );
+    for ( int i = 0; i < n_exports; ++i )
+        exports_host( i ) = 1000 * comm_rank + i;
+    Kokkos::deep_copy( exports, exports_host );
+
+    DataTransferKit::Details::Distributor distributor( comm, false );
+    int const n_imports = distributor.createFromSends(
+        Teuchos::ArrayView<int const>( export_ranks ) );
+    DataTransferKit::Details::Distributor node_aware_distributor( comm, true );
+    TEST_EQUALITY( node_aware_distributor.createFromSends(
+                       Teuchos::ArrayView<int const>( export_ranks ) ),
+                   size_t( n_imports ) );
+    TEST_ASSERT( node_aware_distributor.isNodeAware() );
+    TEST_COMPARE_ARRAYS( node_aware_distributor.getProcsFrom(),
+                         distributor.getProcsFrom() );
+    TEST_COMPARE_ARRAYS( node_aware_distributor.getLengthsFrom(),
+                         distributor.getLengthsFrom() );
+
+    Kokkos::View<int *, DeviceType> imports_ref( "imports_ref", n_imports );
+    DataTransferKit::Details::DistributedSearchTreeImpl<
+        DeviceType>::sendAcrossNetwork( distributor, exports, imports_ref );
+    auto imports_ref_host = Kokkos::create_mirror_view( imports_ref );
+    Kokkos::deep_copy( imports_ref_host, imports_ref );
+
+    // The plan can be reused.
+    Kokkos::View<int *, DeviceType> imports( "imports", n_imports );
+    auto imports_host = Kokkos::create_mirror_view( imports );
+    for ( int i = 0; i < 2; ++i )
+    {
+        Kokkos::deep_copy( imports, -1 );
+        DataTransferKit::Details::DistributedSearchTreeImpl<DeviceType>::
+            sendAcrossNetwork( node_aware_distributor, exports, imports );
+        Kokkos::deep_copy( imports_host, imports );
+        TEST_COMPARE_ARRAYS(
+            std::vector<int>( imports_host.data(),
+                              imports_host.data() + n_imports ),
+            std::vector<int>( imports_ref_host.data(),
+                              imports_ref_host.data() + n_imports ) );
+    }
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
                                    sort_results, DeviceType )
 {
@@ -208,6 +336,106 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
                 DataTransferKit::DataTransferKitException );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
+                                   sort_results_stably, DeviceType )
+{
+    std::vector<int> ids_ = {1, 0, 1, 0, 1, 0};
+    std::vector<int> indices_ = {5, 2, 3, 2, 3, 0};
+    std::vector<int> ranks_ = {0, 1, 1, 0, 0, 1};
+    // Ordered by query, then by rank, then by index.
+    std::vector<int> sorted_ids = {0, 0, 0, 1, 1, 1};
+    std::vector<int> sorted_indices = {2, 0, 2, 3, 5, 3};
+    std::vector<int> sorted_ranks = {0, 1, 1, 0, 0, 1};
+    int const n = 6;
+
+    Kokkos::View<int *, DeviceType> ids( "query_ids", n );
+    auto ids_host = Kokkos::create_mirror_view( ids );
+    Kokkos::View<int *, DeviceType> indices( "indices", n );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::View<int *, DeviceType> ranks( "ranks", n );
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    for ( int i = 0; i < n; ++i )
+    {
+        ids_host( i ) = ids_[i];
+        indices_host( i ) = indices_[i];
+        ranks_host( i ) = ranks_[i];
+    }
+    Kokkos::deep_copy( ids, ids_host );
+    Kokkos::deep_copy( indices, indices_host );
+    Kokkos::deep_copy( ranks, ranks_host );
+
+    using Impl =
+        DataTransferKit::Details::DistributedSearchTreeImpl<DeviceType>;
+    Impl::sortResultsByRankAndIndex( indices, ranks, ids );
+    Kokkos::View<int *, DeviceType> keys( "keys", n );
+    Kokkos::deep_copy( keys, ids );
+    Impl::sortResultsStably( keys, ids, indices, ranks );
+
+    Kokkos::deep_copy( ids_host, ids );
+    TEST_COMPARE_ARRAYS( ids_host, sorted_ids );
+    Kokkos::deep_copy( indices_host, indices );
+    TEST_COMPARE_ARRAYS( indices_host, sorted_indices );
+    Kokkos::deep_copy( ranks_host, ranks );
+    TEST_COMPARE_ARRAYS( ranks_host, sorted_ranks );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
+                                   group_results_by_query, DeviceType )
+{
+    std::vector<int> ids_ = {3, 2, 1, 0, 3, 2, 1, 3, 2, 3};
+    std::vector<int> offset_ref = {0, 1, 3, 6, 10};
+    int const n = 10;
+    int const m = 4;
+    std::vector<std::set<int>> grouped_results = {
+        {3},
+        {6, 2},
+        {8, 5, 1},
+        {9, 7, 4, 0},
+    };
+
+    Kokkos::View<int *, DeviceType> ids( "query_ids", n );
+    auto ids_host = Kokkos::create_mirror_view( ids );
+    for ( int i = 0; i < n; ++i )
+        ids_host( i ) = ids_[i];
+    Kokkos::deep_copy( ids, ids_host );
+
+    Kokkos::View<int *, DeviceType> results( "results", n );
+    DataTransferKit::iota( results );
+    Kokkos::View<double *, DeviceType> distances( "distances", n );
+    DataTransferKit::iota( distances, 10. );
+
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    DataTransferKit::Details::DistributedSearchTreeImpl<
+        DeviceType>::countResults( m, ids, offset );
+    DataTransferKit::Details::DistributedSearchTreeImpl<
+        DeviceType>::groupResultsByQuery( offset, ids, results, distances );
+
+    // COMMENT: ids are untouched
+    Kokkos::deep_copy( ids_host, ids );
+    TEST_COMPARE_ARRAYS( ids_host, ids_ );
+
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    TEST_COMPARE_ARRAYS( offset_host, offset_ref );
+
+    auto results_host = Kokkos::create_mirror_view( results );
+    Kokkos::deep_copy( results_host, results );
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    for ( int q = 0; q < m; ++q )
+        for ( int i = offset_ref[q]; i < offset_ref[q + 1]; ++i )
+        {
+            TEST_EQUALITY( grouped_results[q].count( results_host[i] ), 1 );
+            TEST_EQUALITY( distances_host[i], results_host[i] + 10. );
+        }
+
+    Kokkos::View<int *, DeviceType> not_sized_properly( "", m );
+    TEST_THROW( DataTransferKit::Details::DistributedSearchTreeImpl<
+                    DeviceType>::groupResultsByQuery( offset,
+                                                      not_sized_properly ),
+                DataTransferKit::DataTransferKitException );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsDistributedSearchTreeImpl,
                                    count_results, DeviceType )
 {
@@ -328,8 +556,19 @@ TEUCHOS_UNIT_TEST( DetailsDistributedSearchTreeImpl,
     using DeviceType##NODE = typename NODE::device_type;                       \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
                                           recv_from, DeviceType##NODE )        \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
+                                          unsorted_exports, DeviceType##NODE ) \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
+                                          node_aware_exchange,                 \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
                                           sort_results, DeviceType##NODE )     \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
+                                          sort_results_stably,                 \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
+                                          group_results_by_query,              \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsDistributedSearchTreeImpl,    \
                                           count_results, DeviceType##NODE )
 
@@ -17,8 +17,13 @@
 #include <Teuchos_UnitTestHarness.hpp>
 
 #include <algorithm>
+#include <array>
 #include <bitset>
+#include <cstdlib> // abs
+#include <cstdint>
 #include <functional>
+#include <numeric>
+#include <random>
 #include <sstream>
 #include <vector>
 
@@ -73,6 +78,56 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, morton_codes, DeviceType )
     TEST_COMPARE_ARRAYS( morton_codes_host, ref );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, morton_codes_2d, DeviceType )
+{
+    // the scene is flat along the z axis so that the codes are computed from
+    // the x and y coordinates only, with 16 bits (respectively 32 bits) each
+    std::vector<DataTransferKit::Point> points = {
+        {{0.0, 0.0, 0.5}},
+        {{0.5 / 1024.0, 0.0, 0.5}},
+        {{0.25, 0.75, 0.5}},
+        {{1.0, 1.0, 0.5}},
+    };
+    int const n = points.size();
+    std::vector<std::array<unsigned int, 2>> anchors = {
+        {{0, 0}}, {{32, 0}}, {{16384, 49152}}, {{65535, 65535}}};
+    std::vector<std::array<std::uint64_t, 2>> anchors_64 = {
+        {{0, 0}},
+        {{2097152, 0}},
+        {{1073741824, 3221225472}},
+        {{4294967295, 4294967295}}};
+    using TreeConstruction = dtk::TreeConstruction<DeviceType>;
+    std::vector<unsigned int> ref( n );
+    std::vector<std::uint64_t> ref_64( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        ref[i] = 2 * TreeConstruction::expandBits2D( anchors[i][0] ) +
+                 TreeConstruction::expandBits2D( anchors[i][1] );
+        ref_64[i] = 2 * TreeConstruction::expandBits2D64( anchors_64[i][0] ) +
+                    TreeConstruction::expandBits2D64( anchors_64[i][1] );
+    }
+    // the first two points would share the same 3D code
+    TEST_INEQUALITY( ref[0], ref[1] );
+
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {points[i], points[i]};
+    Kokkos::deep_copy( boxes, boxes_host );
+    DataTransferKit::Box const scene = {{{0., 0., 0.5}}, {{1., 1., 0.5}}};
+
+    Kokkos::View<unsigned int *, DeviceType> codes( "codes", n );
+    TreeConstruction::assignMortonCodes( boxes, codes, scene );
+    Kokkos::View<std::uint64_t *, DeviceType> codes_64( "codes_64", n );
+    TreeConstruction::assignMortonCodes( boxes, codes_64, scene );
+    auto codes_host = Kokkos::create_mirror_view( codes );
+    Kokkos::deep_copy( codes_host, codes );
+    TEST_COMPARE_ARRAYS( codes_host, ref );
+    auto codes_64_host = Kokkos::create_mirror_view( codes_64 );
+    Kokkos::deep_copy( codes_64_host, codes_64 );
+    TEST_COMPARE_ARRAYS( codes_64_host, ref_64 );
+}
+
 template <typename DeviceType>
 class FillK
 {
@@ -122,6 +177,65 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, indirect_sort, DeviceType )
     TEST_COMPARE_ARRAYS( ids_host, ref );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, morton_codes_64, DeviceType )
+{
+    std::vector<DataTransferKit::Point> points = {
+        {{0.0, 0.0, 0.0}},          {{0.25, 0.75, 0.25}}, {{0.75, 0.25, 0.25}},
+        {{0.75, 0.75, 0.25}},       {{1.33, 2.33, 3.33}}, {{1.66, 2.66, 3.66}},
+        {{1024.0, 1024.0, 1024.0}},
+    };
+    int const n = points.size();
+    // 2097152 bins in each direction instead of 1024
+    std::vector<std::array<std::uint64_t, 3>> anchors = {
+        {{0, 0, 0}},
+        {{512, 1536, 512}},
+        {{1536, 512, 512}},
+        {{1536, 1536, 512}},
+        {{2723, 4771, 6819}},
+        {{3399, 5447, 7495}},
+        {{2097151, 2097151, 2097151}}};
+    auto fun = []( std::array<std::uint64_t, 3> const &anchor ) {
+        std::uint64_t i = std::get<0>( anchor );
+        std::uint64_t j = std::get<1>( anchor );
+        std::uint64_t k = std::get<2>( anchor );
+        return 4 * dtk::TreeConstruction<DeviceType>::expandBits64( i ) +
+               2 * dtk::TreeConstruction<DeviceType>::expandBits64( j ) +
+               dtk::TreeConstruction<DeviceType>::expandBits64( k );
+    };
+    std::vector<std::uint64_t> ref( n );
+    for ( int i = 0; i < n; ++i )
+        ref[i] = fun( anchors[i] );
+    // the 21 bits of the anchor are interleaved into a 63 bit code
+    TEST_EQUALITY( ref[n - 1], ( 1ull << 63 ) - 1 );
+
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    for ( int i = 0; i < n; ++i )
+        dtk::expand( boxes[i], points[i] );
+
+    Kokkos::View<DataTransferKit::Box *, DeviceType> scene( "scene", 1 );
+    dtk::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+        boxes, scene[0] );
+
+    Kokkos::View<std::uint64_t *, DeviceType> morton_codes( "morton_codes",
+                                                            n );
+    dtk::TreeConstruction<DeviceType>::assignMortonCodes( boxes, morton_codes,
+                                                          scene[0] );
+    auto morton_codes_host = Kokkos::create_mirror_view( morton_codes );
+    Kokkos::deep_copy( morton_codes_host, morton_codes );
+    TEST_COMPARE_ARRAYS( morton_codes_host, ref );
+
+    // the permutation must be the same as the one obtained with 30-bit codes
+    // when these are unique
+    auto ids = dtk::TreeConstruction<DeviceType>::sortObjects( morton_codes );
+    auto ids_host = Kokkos::create_mirror_view( ids );
+    Kokkos::deep_copy( ids_host, ids );
+    std::vector<size_t> ids_ref = {0, 1, 2, 3, 4, 5, 6};
+    TEST_COMPARE_ARRAYS( ids_host, ids_ref );
+    Kokkos::deep_copy( morton_codes_host, morton_codes );
+    TEST_ASSERT( std::is_sorted( morton_codes_host.data(),
+                                 morton_codes_host.data() + n ) );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, number_of_leading_zero_bits,
                                    DeviceType )
 {
@@ -146,6 +260,14 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, number_of_leading_zero_bits,
     TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz( 4 ^ 1 ), 29 );
     TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz( 4 ^ 2 ), 29 );
     TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz( 4 ^ 3 ), 29 );
+    // 64 bit integers
+    TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz64( 0 ), 64 );
+    TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz64( 1 ), 63 );
+    TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz64( 9 ), 60 );
+    TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz64( 1ull << 32 ), 31 );
+    TEST_EQUALITY( DataTransferKit::KokkosHelpers::clz64( 1ull << 63 ), 0 );
+    TEST_EQUALITY(
+        DataTransferKit::KokkosHelpers::clz64( ( 1ull << 40 ) ^ 1ull ), 23 );
 }
 
 template <typename DeviceType>
@@ -199,6 +321,74 @@ class ComputeResults
     Kokkos::View<int *, DeviceType> _results;
 };
 
+template <typename DeviceType, typename MortonCodeType>
+void checkSortingAlgorithmsAgree( Teuchos::FancyOStream &out, bool &success,
+                                  std::vector<MortonCodeType> const &codes )
+{
+    int const n = codes.size();
+
+    Kokkos::View<MortonCodeType *, DeviceType> radix_codes( "radix_codes", n );
+    Kokkos::deep_copy( radix_codes,
+                       Kokkos::View<MortonCodeType const *, Kokkos::HostSpace,
+                                    Kokkos::MemoryUnmanaged>( codes.data(),
+                                                              n ) );
+    auto bin_codes = DataTransferKit::clone( radix_codes );
+
+    auto radix_ids = dtk::TreeConstruction<DeviceType>::sortObjects(
+        radix_codes, dtk::RadixSortTag{} );
+    auto bin_ids = dtk::TreeConstruction<DeviceType>::sortObjects(
+        bin_codes, dtk::BinSortTag{} );
+
+    auto radix_codes_host = Kokkos::create_mirror_view( radix_codes );
+    Kokkos::deep_copy( radix_codes_host, radix_codes );
+    auto bin_codes_host = Kokkos::create_mirror_view( bin_codes );
+    Kokkos::deep_copy( bin_codes_host, bin_codes );
+    TEST_COMPARE_ARRAYS( radix_codes_host, bin_codes_host );
+
+    // the radix sort is stable
+    auto radix_ids_host = Kokkos::create_mirror_view( radix_ids );
+    Kokkos::deep_copy( radix_ids_host, radix_ids );
+    std::vector<size_t> ids_ref( n );
+    std::iota( ids_ref.begin(), ids_ref.end(), 0 );
+    std::stable_sort( ids_ref.begin(), ids_ref.end(),
+                      [&codes]( size_t i, size_t j ) {
+                          return codes[i] < codes[j];
+                      } );
+    TEST_COMPARE_ARRAYS( radix_ids_host, ids_ref );
+
+    // the permutation returned by the bin sort only differs in the order of
+    // duplicate codes
+    auto bin_ids_host = Kokkos::create_mirror_view( bin_ids );
+    Kokkos::deep_copy( bin_ids_host, bin_ids );
+    for ( int i = 0; i < n; ++i )
+        TEST_EQUALITY( codes[bin_ids_host( i )], radix_codes_host( i ) );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, radix_sort, DeviceType )
+{
+    // clustered codes with many duplicates and a few outliers, spread over
+    // several blocks of the radix sort
+    std::default_random_engine generator;
+    std::uniform_int_distribution<unsigned int> cluster( 1000, 1100 );
+    int const n = 3000;
+
+    std::vector<unsigned int> codes( n );
+    for ( int i = 0; i < n; ++i )
+        codes[i] = ( i % 100 == 0 ) ? ( 1u << 29 ) - i : cluster( generator );
+    checkSortingAlgorithmsAgree<DeviceType>( out, success, codes );
+
+    std::vector<std::uint64_t> codes_64( n );
+    for ( int i = 0; i < n; ++i )
+        codes_64[i] = ( std::uint64_t{codes[i]} << 33 ) + codes[n - 1 - i];
+    checkSortingAlgorithmsAgree<DeviceType>( out, success, codes_64 );
+
+    // trivial cases
+    checkSortingAlgorithmsAgree<DeviceType>( out, success,
+                                             std::vector<unsigned int>{42} );
+    checkSortingAlgorithmsAgree<DeviceType>(
+        out, success, std::vector<unsigned int>( 1000, 7 ) );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, common_prefix, DeviceType )
 {
     using ExecutionSpace = typename DeviceType::execution_space;
@@ -281,41 +471,328 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, example_tree_construction,
     std::cout << "ref=" << ref.str() << "\n";
 
     // hierarchy generation
-    Kokkos::View<DataTransferKit::Node *, DeviceType> leaf_nodes( "leaf_nodes",
-                                                                  n );
-    Kokkos::View<DataTransferKit::Node *, DeviceType> internal_nodes(
-        "internal_nodes", n - 1 );
-    std::function<void( DataTransferKit::Node *, std::ostream & )>
-        traverseRecursive;
-    traverseRecursive = [&leaf_nodes, &internal_nodes, &traverseRecursive](
-                            DataTransferKit::Node *node, std::ostream &os ) {
-        if ( std::any_of( leaf_nodes.data(), leaf_nodes.data() + n,
-                          [node]( DataTransferKit::Node const &leaf_node ) {
-                              return std::addressof( leaf_node ) == node;
-                          } ) )
+    // internal nodes are stored first, followed by the leaf nodes
+    Kokkos::View<DataTransferKit::Node *, DeviceType> internal_and_leaf_nodes(
+        "internal_and_leaf_nodes", 2 * n - 1 );
+    Kokkos::View<int *, DeviceType> parents( "parents", 2 * n - 1 );
+    DataTransferKit::Node const *nodes = internal_and_leaf_nodes.data();
+    std::function<void( int, std::ostream & )> traverseRecursive;
+    traverseRecursive = [nodes, &parents, &traverseRecursive, &success,
+                         &out]( int node, std::ostream &os ) {
+        if ( node >= n - 1 )
         {
-            os << "L" << node - leaf_nodes.data();
+            // leaf nodes were default constructed
+            TEST_EQUALITY( nodes[node].children.first, -1 );
+            os << "L" << node - ( n - 1 );
         }
         else
         {
-            os << "I" << node - internal_nodes.data();
-            for ( DataTransferKit::Node *child :
-                  {node->children.first, node->children.second} )
+            os << "I" << node;
+            for ( int child :
+                  {nodes[node].children.first, nodes[node].children.second} )
+            {
+                TEST_EQUALITY( parents[child], node );
                 traverseRecursive( child, os );
+            }
         }
     };
 
     dtk::TreeConstruction<DeviceType>::generateHierarchy(
-        sorted_morton_codes, leaf_nodes, internal_nodes );
-
-    DataTransferKit::Node *root = internal_nodes.data();
-    TEST_ASSERT( root->parent == nullptr );
+        sorted_morton_codes, internal_and_leaf_nodes, parents );
 
     std::ostringstream sol;
-    traverseRecursive( root, sol );
+    // root is always at position 0
+    traverseRecursive( 0, sol );
     std::cout << "sol=" << sol.str() << "\n";
 
     TEST_EQUALITY( sol.str().compare( ref.str() ), 0 );
+
+    // stackless traversal following the ropes must visit all the nodes, right
+    // child first
+    std::ostringstream ref_ropes;
+    ref_ropes << "I0"
+              << "I4"
+              << "I5"
+              << "L7"
+              << "I6"
+              << "L6"
+              << "L5"
+              << "L4"
+              << "I3"
+              << "I2"
+              << "L3"
+              << "L2"
+              << "I1"
+              << "L1"
+              << "L0";
+    std::ostringstream sol_ropes;
+    for ( int node = 0; node != -1; )
+    {
+        if ( node >= n - 1 )
+        {
+            sol_ropes << "L" << node - ( n - 1 );
+            node = nodes[node].rope;
+        }
+        else
+        {
+            sol_ropes << "I" << node;
+            node = nodes[node].children.second;
+        }
+    }
+    std::cout << "sol_ropes=" << sol_ropes.str() << "\n";
+
+    TEST_EQUALITY( sol_ropes.str().compare( ref_ropes.str() ), 0 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, treelet_restructuring,
+                                   DeviceType )
+{
+    // random points scattered on a thin plate
+    int const n = 200;
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 1. );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        DataTransferKit::Point p = {{10. * distribution( generator ),
+                                     10. * distribution( generator ),
+                                     .01 * distribution( generator )}};
+        boxes_host( i ) = {p, p};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    // same steps as in the BoundingVolumeHierarchy constructor
+    Kokkos::View<DataTransferKit::Node *, DeviceType> internal_and_leaf_nodes(
+        "internal_and_leaf_nodes", 2 * n - 1 );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> scene( "scene", 1 );
+    dtk::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+        boxes, scene[0] );
+    Kokkos::View<unsigned int *, DeviceType> morton_codes( "morton_codes", n );
+    dtk::TreeConstruction<DeviceType>::assignMortonCodes( boxes, morton_codes,
+                                                          scene[0] );
+    auto permutation_indices =
+        dtk::TreeConstruction<DeviceType>::sortObjects( morton_codes );
+    dtk::TreeConstruction<DeviceType>::initializeLeafNodes(
+        permutation_indices, boxes,
+        Kokkos::subview( internal_and_leaf_nodes,
+                         Kokkos::make_pair( n - 1, 2 * n - 1 ) ) );
+    Kokkos::View<int *, DeviceType> parents( "parents", 2 * n - 1 );
+    dtk::TreeConstruction<DeviceType>::generateHierarchy(
+        morton_codes, internal_and_leaf_nodes, parents );
+    internal_and_leaf_nodes[0].bounding_box = scene[0];
+    dtk::TreeConstruction<DeviceType>::calculateBoundingBoxes(
+        internal_and_leaf_nodes, parents );
+
+    double const cost_before =
+        dtk::TreeConstruction<DeviceType>::computeSAHCost(
+            internal_and_leaf_nodes );
+    dtk::TreeConstruction<DeviceType>::restructureTreelets(
+        internal_and_leaf_nodes, parents );
+    double const cost_after = dtk::TreeConstruction<DeviceType>::computeSAHCost(
+        internal_and_leaf_nodes );
+    TEST_COMPARE( cost_after, <=, cost_before );
+
+    // check that the hierarchy is still sound and that following the ropes
+    // visits every leaf exactly once
+    auto nodes = Kokkos::create_mirror_view( internal_and_leaf_nodes );
+    Kokkos::deep_copy( nodes, internal_and_leaf_nodes );
+    auto parents_host = Kokkos::create_mirror_view( parents );
+    Kokkos::deep_copy( parents_host, parents );
+    TEST_ASSERT( dtk::equals( nodes[0].bounding_box, scene[0] ) );
+    std::vector<int> leaves;
+    for ( int node = 0; node != -1; )
+    {
+        if ( nodes[node].children.first == -1 )
+        {
+            leaves.push_back( nodes[node].children.second );
+            node = nodes[node].rope;
+        }
+        else
+        {
+            DataTransferKit::Box box;
+            for ( int child :
+                  {nodes[node].children.first, nodes[node].children.second} )
+            {
+                TEST_EQUALITY( parents_host[child], node );
+                dtk::expand( box, nodes[child].bounding_box );
+            }
+            TEST_ASSERT( dtk::equals( box, nodes[node].bounding_box ) );
+            node = nodes[node].children.second;
+        }
+    }
+    std::sort( leaves.begin(), leaves.end() );
+    std::vector<int> leaves_ref( n );
+    std::iota( leaves_ref.begin(), leaves_ref.end(), 0 );
+    TEST_COMPARE_ARRAYS( leaves, leaves_ref );
+}
+
+template <typename DeviceType, typename MortonCodeType>
+void checkBottomUpConstruction(
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes, bool &success,
+    Teuchos::FancyOStream &out )
+{
+    int const n = boxes.extent( 0 );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> scene( "scene", 1 );
+    dtk::TreeConstruction<DeviceType>::calculateBoundingBoxOfTheScene(
+        boxes, scene[0] );
+    Kokkos::View<MortonCodeType *, DeviceType> morton_codes( "morton_codes",
+                                                             n );
+    dtk::TreeConstruction<DeviceType>::assignMortonCodes( boxes, morton_codes,
+                                                          scene[0] );
+    auto permutation_indices =
+        dtk::TreeConstruction<DeviceType>::sortObjects( morton_codes );
+
+    Kokkos::View<DataTransferKit::Node *, DeviceType> nodes_ref(
+        "nodes_ref", 2 * n - 1 );
+    dtk::TreeConstruction<DeviceType>::initializeLeafNodes(
+        permutation_indices, boxes,
+        Kokkos::subview( nodes_ref, Kokkos::make_pair( n - 1, 2 * n - 1 ) ) );
+    Kokkos::View<DataTransferKit::Node *, DeviceType> nodes( "nodes",
+                                                             2 * n - 1 );
+    Kokkos::deep_copy( nodes, nodes_ref );
+
+    Kokkos::View<int *, DeviceType> parents( "parents", 2 * n - 1 );
+    dtk::TreeConstruction<DeviceType>::generateHierarchy(
+        morton_codes, nodes_ref, parents );
+    nodes_ref[0].bounding_box = scene[0];
+    dtk::TreeConstruction<DeviceType>::calculateBoundingBoxes( nodes_ref,
+                                                               parents );
+
+    dtk::TreeConstruction<DeviceType>::generateHierarchyBottomUp(
+        morton_codes, nodes );
+
+    auto nodes_host = Kokkos::create_mirror_view( nodes );
+    Kokkos::deep_copy( nodes_host, nodes );
+    auto nodes_ref_host = Kokkos::create_mirror_view( nodes_ref );
+    Kokkos::deep_copy( nodes_ref_host, nodes_ref );
+    for ( int i = 0; i < 2 * n - 1; ++i )
+    {
+        TEST_EQUALITY( nodes_host( i ).children.first,
+                       nodes_ref_host( i ).children.first );
+        TEST_EQUALITY( nodes_host( i ).children.second,
+                       nodes_ref_host( i ).children.second );
+        TEST_EQUALITY( nodes_host( i ).rope, nodes_ref_host( i ).rope );
+        TEST_ASSERT( dtk::equals( nodes_host( i ).bounding_box,
+                                  nodes_ref_host( i ).bounding_box ) );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, bottom_up_construction,
+                                   DeviceType )
+{
+    // the hierarchy built in a single pass from the leaves must be exactly
+    // the same as the one built top-down, including when some objects share
+    // the same Morton code
+    int const n = 300;
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 1. );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        DataTransferKit::Point p = {{distribution( generator ),
+                                     distribution( generator ),
+                                     distribution( generator )}};
+        if ( i % 10 == 9 )
+            p = boxes_host( i - 1 ).minCorner();
+        boxes_host( i ) = {p, {{p[0] + .01, p[1] + .01, p[2] + .01}}};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+    checkBottomUpConstruction<DeviceType, unsigned int>( boxes, success, out );
+    checkBottomUpConstruction<DeviceType, std::uint64_t>( boxes, success,
+                                                          out );
+
+    // only two objects
+    Kokkos::View<DataTransferKit::Box *, DeviceType> two_boxes( "two_boxes",
+                                                                2 );
+    Kokkos::deep_copy( two_boxes,
+                       Kokkos::subview( boxes, Kokkos::make_pair( 0, 2 ) ) );
+    checkBottomUpConstruction<DeviceType, unsigned int>( two_boxes, success,
+                                                         out );
+}
+
+// The cells of the 8x8x8 grid must be visited one after the other by the
+// Hilbert curve, each one adjacent to the previous one.
+template <typename CodeType, typename Code>
+void checkHilbertCurve( Code const &code, int shift, bool &success,
+                        Teuchos::FancyOStream &out )
+{
+    std::vector<std::array<int, 3>> cells( 512, {{-8, -8, -8}} );
+    for ( int i = 0; i < 8; ++i )
+        for ( int j = 0; j < 8; ++j )
+            for ( int k = 0; k < 8; ++k )
+            {
+                CodeType const c =
+                    code( ( i + .5 ) / 8, ( j + .5 ) / 8, ( k + .5 ) / 8 ) >>
+                    shift;
+                TEST_COMPARE( c, <, 512u );
+                if ( c < 512 )
+                    cells[c] = {{i, j, k}};
+            }
+    TEST_EQUALITY( cells[0][0] + cells[0][1] + cells[0][2], 0 );
+    for ( int c = 0; c + 1 < 512; ++c )
+    {
+        int distance = 0;
+        for ( int d = 0; d < 3; ++d )
+            distance += std::abs( cells[c + 1][d] - cells[c][d] );
+        TEST_EQUALITY( distance, 1 );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, hilbert_codes, DeviceType )
+{
+    using TreeConstruction = dtk::TreeConstruction<DeviceType>;
+    checkHilbertCurve<unsigned int>(
+        []( double x, double y, double z ) {
+            return TreeConstruction::hilbert3D( x, y, z );
+        },
+        30 - 9, success, out );
+    checkHilbertCurve<std::uint64_t>(
+        []( double x, double y, double z ) {
+            return TreeConstruction::hilbert3D64( x, y, z );
+        },
+        63 - 9, success, out );
+
+    // the objects are assigned the code of their centroid, the first one
+    // spans the unit cube so that the scene is the unit cube
+    int const n = 100;
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 1. );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    boxes_host( 0 ) = {{{0., 0., 0.}}, {{1., 1., 1.}}};
+    for ( int i = 1; i < n; ++i )
+    {
+        DataTransferKit::Point p = {{distribution( generator ),
+                                     distribution( generator ),
+                                     distribution( generator )}};
+        boxes_host( i ) = {p, p};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+    DataTransferKit::Box const scene = {{{0., 0., 0.}}, {{1., 1., 1.}}};
+
+    Kokkos::View<unsigned int *, DeviceType> codes( "codes", n );
+    TreeConstruction::assignMortonCodes( boxes, codes, scene,
+                                         DataTransferKit::HilbertCurveTag{} );
+    Kokkos::View<std::uint64_t *, DeviceType> codes_64( "codes_64", n );
+    TreeConstruction::assignMortonCodes( boxes, codes_64, scene,
+                                         DataTransferKit::HilbertCurveTag{} );
+    std::vector<unsigned int> ref( n );
+    std::vector<std::uint64_t> ref_64( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        DataTransferKit::Point c;
+        dtk::centroid( boxes_host( i ), c );
+        ref[i] = TreeConstruction::hilbert3D( c[0], c[1], c[2] );
+        ref_64[i] = TreeConstruction::hilbert3D64( c[0], c[1], c[2] );
+    }
+    auto codes_host = Kokkos::create_mirror_view( codes );
+    Kokkos::deep_copy( codes_host, codes );
+    TEST_COMPARE_ARRAYS( codes_host, ref );
+    auto codes_64_host = Kokkos::create_mirror_view( codes_64 );
+    Kokkos::deep_copy( codes_64_host, codes_64 );
+    TEST_COMPARE_ARRAYS( codes_64_host, ref_64 );
 }
 
 // Include the test macros.
@@ -326,14 +803,26 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsBVH, example_tree_construction,
     using DeviceType##NODE = typename NODE::device_type;                       \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, morton_codes,            \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, morton_codes_64,         \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, morton_codes_2d,         \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, hilbert_codes,           \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         DetailsBVH, number_of_leading_zero_bits, DeviceType##NODE )            \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, indirect_sort,           \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, radix_sort,              \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, common_prefix,           \
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
-        DetailsBVH, example_tree_construction, DeviceType##NODE )
+        DetailsBVH, example_tree_construction, DeviceType##NODE )              \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsBVH, treelet_restructuring,   \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        DetailsBVH, bottom_up_construction, DeviceType##NODE )
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
 
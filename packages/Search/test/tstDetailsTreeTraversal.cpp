@@ -155,6 +155,7 @@ TEUCHOS_UNIT_TEST( ContainerAdaptors, stack )
     dtk::Stack<int> stack;
     TEST_ASSERT( stack.empty() );
     TEST_EQUALITY( stack.size(), 0 );
+    TEST_EQUALITY( stack.capacity(), 64 );
     // insert element
     stack.push( 2 );
     TEST_ASSERT( !stack.empty() );
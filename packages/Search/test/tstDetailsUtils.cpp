@@ -9,6 +9,7 @@
  * SPDX-License-Identifier: BSD-3-Clause                                    *
  ****************************************************************************/
 
+#include <DTK_DetailsCachingAllocator.hpp>
 #include <DTK_DetailsUtils.hpp>
 
 #include <Teuchos_UnitTestHarness.hpp>
@@ -48,7 +49,7 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, prefix_sum, DeviceType )
         x_host( i ) = x_ref[i];
     Kokkos::deep_copy( x, x_host );
     Kokkos::View<int *, DeviceType> y( "y", n );
-    DataTransferKit::exclusivePrefixSum( x, y );
+    TEST_EQUALITY( DataTransferKit::exclusivePrefixSum( x, y ), n - 1 );
     std::vector<int> y_ref( n );
     std::iota( y_ref.begin(), y_ref.end(), 0 );
     auto y_host = Kokkos::create_mirror_view( y );
@@ -60,6 +61,15 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, prefix_sum, DeviceType )
     DataTransferKit::exclusivePrefixSum( x, x );
     Kokkos::deep_copy( x_host, x );
     TEST_COMPARE_ARRAYS( x_host, y_ref );
+    // the last element, e.g. the trailing entry of an offset view, is left
+    // out of the returned sum
+    for ( int i = 0; i < n; ++i )
+        x_host( i ) = 1;
+    x_host( n - 1 ) = 42;
+    Kokkos::deep_copy( x, x_host );
+    TEST_EQUALITY( DataTransferKit::exclusivePrefixSum( x ), n - 1 );
+    Kokkos::deep_copy( x_host, x );
+    TEST_COMPARE_ARRAYS( x_host, y_ref );
     int const m = 11;
     TEST_INEQUALITY( n, m );
     Kokkos::View<int *, DeviceType> z( "z", m );
@@ -106,6 +116,27 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, last_element, DeviceType )
     TEST_FLOATING_EQUALITY( DataTransferKit::lastElement( u ), 3.14, 1e-14 );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, select_indices, DeviceType )
+{
+    int const n = 10;
+    Kokkos::View<int *, DeviceType> x( "x", n );
+    auto x_host = Kokkos::create_mirror_view( x );
+    for ( int i = 0; i < n; ++i )
+        x_host( i ) = ( i * 7 ) % 4;
+    Kokkos::deep_copy( x, x_host );
+
+    auto const indices = DataTransferKit::selectIndices<DeviceType>(
+        "indices", n, KOKKOS_LAMBDA( int i ) { return x( i ) == 1; } );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    std::vector<int> indices_ref = {3, 7};
+    TEST_COMPARE_ARRAYS( indices_host, indices_ref );
+
+    auto const none = DataTransferKit::selectIndices<DeviceType>(
+        "none", n, KOKKOS_LAMBDA( int i ) { return x( i ) > 3; } );
+    TEST_EQUALITY( none.extent_int( 0 ), 0 );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, minmax, DeviceType )
 {
     Kokkos::View<double[4], DeviceType> v( "v" );
@@ -209,6 +240,54 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, min_and_max, DeviceType )
     TEST_EQUALITY( 8, DataTransferKit::max( w ) );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, caching_allocator,
+                                   DeviceType )
+{
+    using MemorySpace = typename DeviceType::memory_space;
+    using DataTransferKit::Details::CachingAllocator;
+    using DataTransferKit::Details::CachingAllocatorScope;
+    using DataTransferKit::Details::TemporaryViews;
+
+    // Without a current allocator, the views are allocated as usual.
+    {
+        TemporaryViews<DeviceType> temporaries;
+        auto v = temporaries.template view<int *>( "v", 10 );
+        TEST_EQUALITY( v.extent( 0 ), 10 );
+        Kokkos::deep_copy( v, 3 );
+        TEST_EQUALITY( DataTransferKit::lastElement( v ), 3 );
+    }
+
+    CachingAllocator<MemorySpace> allocator;
+    CachingAllocatorScope<MemorySpace> scope( allocator );
+    int const *data = nullptr;
+    {
+        TemporaryViews<DeviceType> temporaries;
+        auto v = temporaries.template view<int *>( "v", 100 );
+        auto w = temporaries.template view<double **>( "w", 10, 3 );
+        TEST_EQUALITY( w.extent( 0 ), 10 );
+        TEST_EQUALITY( w.extent( 1 ), 3 );
+        TEST_INEQUALITY( (void *)v.data(), (void *)w.data() );
+        Kokkos::deep_copy( v, 5 );
+        TEST_EQUALITY( DataTransferKit::lastElement( v ), 5 );
+        auto empty = temporaries.template view<int *>( "empty", 0 );
+        TEST_EQUALITY( empty.extent( 0 ), 0 );
+        data = v.data();
+    }
+    std::size_t const size = allocator.size();
+    TEST_ASSERT( size >= 100 * sizeof( int ) + 30 * sizeof( double ) );
+
+    // The blocks are reused by requests of similar sizes.
+    {
+        TemporaryViews<DeviceType> temporaries;
+        auto v = temporaries.template view<int *>( "v", 90 );
+        TEST_EQUALITY( v.data(), data );
+    }
+    TEST_EQUALITY( allocator.size(), size );
+
+    allocator.release();
+    TEST_EQUALITY( allocator.size(), 0 );
+}
+
 // Include the test macros.
 #include "DataTransferKitSearch_ETIHelperMacros.h"
 
@@ -221,6 +300,8 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, min_and_max, DeviceType )
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, last_element,          \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, select_indices,        \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, minmax,                \
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, accumulate,            \
@@ -228,6 +309,8 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DetailsUtils, min_and_max, DeviceType )
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, adjacent_difference,   \
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, min_and_max,           \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DetailsUtils, caching_allocator,     \
                                           DeviceType##NODE )
 
 // Demangle the types
@@ -17,12 +17,41 @@
 #include <boost/geometry.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <random>
+#include <set>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "Search_UnitTestHelpers.hpp"
 
+// Sort the results of each query as (rank, index) pairs so that they can be
+// compared regardless of the order in which the ranks answered.
+template <typename DeviceType>
+std::vector<std::vector<std::pair<int, int>>>
+sortedResults( Kokkos::View<int *, DeviceType> indices,
+               Kokkos::View<int *, DeviceType> offset,
+               Kokkos::View<int *, DeviceType> ranks )
+{
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    Kokkos::deep_copy( ranks_host, ranks );
+    std::vector<std::vector<std::pair<int, int>>> results;
+    for ( int i = 0; i < offset_host.extent_int( 0 ) - 1; ++i )
+    {
+        results.emplace_back();
+        for ( int j = offset_host( i ); j < offset_host( i + 1 ); ++j )
+            results.back().emplace_back( ranks_host( j ), indices_host( j ) );
+        std::sort( results.back().begin(), results.back().end() );
+    }
+    return results;
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, hello_world,
                                    DeviceType )
 {
@@ -315,6 +344,634 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, one_leaf_per_rank,
                           {{{0., 0., 0.}}, comm_rank * comm_size},
                       } ),
                       {}, {0, 0}, {}, success, out );
+
+    // only the leaves closer than the maximum distance are found, here the
+    // ones of the first two ranks
+    int const n_within = std::min( comm_size, 2 );
+    checkResults( tree,
+                  makeLimitedNearestQueries<DeviceType>( {
+                      std::make_tuple( DataTransferKit::Point{{-.5, .5, .5}},
+                                       comm_size, 2. ),
+                  } ),
+                  std::vector<int>( n_within, 0 ), {0, n_within},
+                  n_within > 1 ? std::vector<int>{0, 1} : std::vector<int>{0},
+                  success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, refit, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 2;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    boxes_host( 0 ) = {{{(double)comm_rank, 0., 0.}},
+                       {{(double)comm_rank + .5, 1., 1.}}};
+    boxes_host( 1 ) = {{{(double)comm_rank + .5, 0., 0.}},
+                       {{(double)comm_rank + 1., 1., 1.}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+
+    // rank 0 translates its objects while the others swap theirs which leaves
+    // their local bounds unchanged
+    if ( comm_rank == 0 )
+        for ( int i = 0; i < n; ++i )
+        {
+            boxes_host( i ).minCorner()[2] += 10.;
+            boxes_host( i ).maxCorner()[2] += 10.;
+        }
+    else
+        std::swap( boxes_host( 0 ), boxes_host( 1 ) );
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    TEST_FLOATING_EQUALITY( tree.refit( boxes ), 1., 1e-14 );
+    TEST_EQUALITY( (int)tree.size(), n * comm_size );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        tree.bounds(), {{{0., 0., comm_size > 1 ? 0. : 10.}},
+                        {{(double)comm_size, 1., 11.}}} ) );
+
+    double const z = ( comm_rank == 0 ? 10.5 : .5 );
+    checkResults( tree,
+                  makeOverlapQueries<DeviceType>( {
+                      {{{(double)comm_rank + .25, .5, z}},
+                       {{(double)comm_rank + .25, .5, z}}},
+                      {{{.25, .5, .5}}, {{.25, .5, .5}}},
+                  } ),
+                  {comm_rank == 0 ? 0 : 1}, {0, 1, 1}, {comm_rank}, success,
+                  out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree,
+                                   disconnected_local_domains, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    // each rank owns two clusters of objects far from each other so that the
+    // bounds of the local tree are mostly empty
+    //
+    // y = 10  0   1   2   3
+    //         |   |   |   |
+    // y = 0   0   1   2   3
+    //       rank 0 ... rank 3
+    int const n = 20;
+    std::vector<DataTransferKit::Box> boxes;
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .01 * ( i / 2 );
+        double const y = ( i % 2 == 0 ) ? 0. : 10.;
+        boxes.push_back( {{{x, y, 0.}}, {{x, y, 0.}}} );
+    }
+    auto const tree = makeDistributedSearchTree<DeviceType>( comm, boxes );
+
+    TEST_EQUALITY( (int)tree.size(), n * comm_size );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        tree.bounds(),
+        {{{0., 0., 0.}}, {{comm_size - 1 + .01 * ( n / 2 - 1 ), 10., 0.}}} ) );
+
+    // nothing in between the clusters
+    checkResults( tree,
+                  makeOverlapQueries<DeviceType>( {
+                      {{{-1., 4., -1.}}, {{(double)comm_size, 6., 1.}}},
+                      {{{comm_rank - .001, 9.9, -1.}},
+                       {{comm_rank + .001, 10.1, 1.}}},
+                  } ),
+                  {1}, {0, 0, 1}, {comm_rank}, success, out );
+
+    checkResults( tree,
+                  makeNearestQueries<DeviceType>( {
+                      {{{(double)comm_rank, 6., 0.}}, 1},
+                  } ),
+                  {1}, {0, 1}, {comm_rank}, {4.}, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, groups_of_ranks,
+                                   DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 20;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .05 * i;
+        double const y = ( i % 2 == 0 ) ? 0. : 10.;
+        boxes_host( i ) = {{{x, y, 0.}}, {{x, y, 0.}}};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    auto const overlap_queries = makeOverlapQueries<DeviceType>( {
+        {{{comm_rank - .5, -1., -1.}}, {{comm_rank + 1.5, 1., 1.}}},
+        {{{-1., 4., -1.}}, {{(double)comm_size, 6., 1.}}},
+        {{{comm_size - comm_rank - .3, 9., -1.}},
+         {{comm_size - comm_rank + .3, 11., 1.}}},
+    } );
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{comm_rank + .5123, 5.37, 0.}}, 3},
+        {{{comm_size - comm_rank + .0123, 9., 0.}}, 25},
+    } );
+
+
+    DataTransferKit::DistributedSearchTree<DeviceType> reference_tree( comm,
+                                                                       boxes );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    reference_tree.query( overlap_queries, indices, offset, ranks );
+    auto const overlap_reference = sortedResults( indices, offset, ranks );
+    reference_tree.query( nearest_queries, indices, offset, ranks );
+    auto const nearest_reference = sortedResults( indices, offset, ranks );
+
+    for ( int ranks_per_group : {1, 2, 3} )
+    {
+        DataTransferKit::DistributedSearchTree<DeviceType> tree(
+            comm, boxes, ranks_per_group );
+        TEST_EQUALITY( tree.size(), reference_tree.size() );
+        TEST_ASSERT( DataTransferKit::Details::equals(
+            tree.bounds(), reference_tree.bounds() ) );
+
+        tree.query( overlap_queries, indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) ==
+                     overlap_reference );
+        tree.query( nearest_queries, indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) ==
+                     nearest_reference );
+
+        // move all the objects and check that the summaries of the groups
+        // follow
+        for ( int i = 0; i < n; ++i )
+        {
+            boxes_host( i ).minCorner()[2] += 1.;
+            boxes_host( i ).maxCorner()[2] += 1.;
+        }
+        Kokkos::deep_copy( boxes, boxes_host );
+        tree.refit( boxes );
+        tree.query( makeOverlapQueries<DeviceType>( {
+                        {{{-1., -1., .5}}, {{comm_size + 1., 11., 1.5}}},
+                    } ),
+                    indices, offset, ranks );
+        auto offset_host = Kokkos::create_mirror_view( offset );
+        Kokkos::deep_copy( offset_host, offset );
+        TEST_EQUALITY( offset_host( 1 ), n * comm_size );
+        for ( int i = 0; i < n; ++i )
+        {
+            boxes_host( i ).minCorner()[2] -= 1.;
+            boxes_host( i ).maxCorner()[2] -= 1.;
+        }
+        Kokkos::deep_copy( boxes, boxes_host );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, query_async,
+                                   DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .1 * i;
+        boxes_host( i ) = {{{x, 0., 0.}}, {{x + .05, 1., 1.}}};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+
+    // a different number of queries on each process so that some of them
+    // run out of chunks before the others
+    std::vector<DataTransferKit::Box> boxes_to_query;
+    for ( int i = 0; i < 3 + 2 * comm_rank; ++i )
+    {
+        double const x = ( comm_rank + 1.3 * i ) - .2;
+        boxes_to_query.push_back( {{{x, .5, .5}}, {{x + .45, .6, .6}}} );
+    }
+    auto const queries = makeOverlapQueries<DeviceType>( boxes_to_query );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    tree.query( queries, indices, offset, ranks );
+    auto const reference = sortedResults( indices, offset, ranks );
+
+    for ( int chunk_size : {1, 2, 100} )
+    {
+        auto request = tree.queryAsync( queries, chunk_size );
+        int n_steps = 1;
+        while ( !request.progress() )
+            ++n_steps;
+        TEST_ASSERT( request.done() );
+        int const n_chunks = ( 3 + 2 * ( comm_size - 1 ) + chunk_size - 1 ) /
+                             chunk_size;
+        TEST_EQUALITY( n_steps, n_chunks + 1 );
+        request.wait( indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+
+        // wait() also completes a request that was not advanced
+        tree.queryAsync( queries, chunk_size ).wait( indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, query_on_owners,
+                                   DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    auto const tree = makeDistributedSearchTree<DeviceType>(
+        comm,
+        {
+            {{{(double)comm_rank, 0., 0.}}, {{(double)comm_rank + 1., 1., 1.}}},
+        } );
+
+    // query the box on this process and the one on the next process
+    double const x = comm_rank + .5;
+    double const y = ( comm_rank + 1 ) % comm_size + .5;
+    auto const queries = makeOverlapQueries<DeviceType>( {
+        {{{x, .5, .5}}, {{x, .5, .5}}},
+        {{{y, .5, .5}}, {{y, .5, .5}}},
+    } );
+
+    Kokkos::View<DataTransferKit::Overlap *, DeviceType> fwd_queries(
+        "fwd_queries" );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ids( "ids" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    tree.queryOnOwners( queries, fwd_queries, indices, offset, ids, ranks );
+
+    // the results stay here: the local box satisfies both queries received
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    auto ids_host = Kokkos::create_mirror_view( ids );
+    Kokkos::deep_copy( ids_host, ids );
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    Kokkos::deep_copy( ranks_host, ranks );
+    TEST_EQUALITY( fwd_queries.extent( 0 ), 2 );
+    TEST_COMPARE_ARRAYS( std::vector<int>( indices_host.data(),
+                                           indices_host.data() +
+                                               indices_host.extent( 0 ) ),
+                         std::vector<int>( {0, 0} ) );
+    TEST_COMPARE_ARRAYS( std::vector<int>( offset_host.data(),
+                                           offset_host.data() +
+                                               offset_host.extent( 0 ) ),
+                         std::vector<int>( {0, 1, 2} ) );
+    std::set<std::pair<int, int>> senders;
+    for ( int i = 0; i < ids_host.extent_int( 0 ); ++i )
+        senders.emplace( ranks_host( i ), ids_host( i ) );
+    std::set<std::pair<int, int>> const expected = {
+        {comm_rank, 0}, {( comm_rank + comm_size - 1 ) % comm_size, 1}};
+    TEST_ASSERT( senders == expected );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, share_work,
+                                   DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .1 * i;
+        boxes_host( i ) = {{{x, 0., 0.}}, {{x + .05, 1., 1.}}};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+
+    // every process sends most of its queries to rank 0
+    std::vector<DataTransferKit::Box> boxes_to_query;
+    for ( int i = 0; i < 5; ++i )
+        boxes_to_query.push_back(
+            {{{.1 * i, .5, .5}}, {{.1 * i + .12, .6, .6}}} );
+    boxes_to_query.push_back(
+        {{{comm_rank + .5, .5, .5}}, {{comm_rank + .6, .6, .6}}} );
+    auto const queries = makeOverlapQueries<DeviceType>( boxes_to_query );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    tree.query( queries, indices, offset, ranks );
+    auto const reference = sortedResults( indices, offset, ranks );
+
+    // rank 0 receives 5 * comm_size + 1 queries and the others a single one
+    double const imbalance = tree.imbalance( queries );
+    TEST_FLOATING_EQUALITY( imbalance, ( 5. * comm_size + 1. ) / 6., 1e-14 );
+
+    double const imbalance_after_sharing = tree.shareWork( queries, 1.5 );
+    if ( comm_size > 1 )
+        TEST_COMPARE( imbalance_after_sharing, <, imbalance );
+    else
+        TEST_EQUALITY( imbalance_after_sharing, 1. );
+    TEST_FLOATING_EQUALITY( tree.imbalance( queries ), imbalance_after_sharing,
+                            1e-14 );
+    tree.query( queries, indices, offset, ranks );
+    TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+
+    // refit() discards work sharing
+    tree.refit( boxes );
+    TEST_FLOATING_EQUALITY( tree.imbalance( queries ), imbalance, 1e-14 );
+    tree.query( queries, indices, offset, ranks );
+    TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, join, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    // Both trees cover the slab 0 < x < comm_size, with different thin boxes
+    // and different partitions: the other tree is shifted by half a process
+    // so that its local domains straddle two local domains of this tree.
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    Kokkos::View<DataTransferKit::Box *, DeviceType> other_boxes(
+        "other_boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    auto other_boxes_host = Kokkos::create_mirror_view( other_boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .1 * i;
+        boxes_host( i ) = {{{x, 0., 0.}}, {{x + .05, 1., 1.}}};
+        double const y =
+            std::fmod( comm_rank + .5 + .1 * i + .03, (double)comm_size );
+        other_boxes_host( i ) = {{{y, .5, .5}}, {{y + .1, .6, .6}}};
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+    Kokkos::deep_copy( other_boxes, other_boxes_host );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+    DataTransferKit::DistributedSearchTree<DeviceType> other( comm,
+                                                              other_boxes );
+
+    // the join gives the same results as querying the tree with the local
+    // boxes of the other tree
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    std::vector<DataTransferKit::Box> const local_other_boxes(
+        other_boxes_host.data(), other_boxes_host.data() + n );
+    tree.query( makeOverlapQueries<DeviceType>( local_other_boxes ), indices,
+                offset, ranks );
+    auto const reference = sortedResults( indices, offset, ranks );
+
+    tree.join( other, indices, offset, ranks );
+    TEST_EQUALITY( offset.extent_int( 0 ), n + 1 );
+    TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+
+    // every box of the other tree overlaps one or two boxes of this tree
+    for ( auto const &results : reference )
+        TEST_COMPARE( results.size(), >=, 1 );
+
+    // and an empty tree has no pairs
+    auto const empty_tree = makeDistributedSearchTree<DeviceType>( comm, {} );
+    empty_tree.join( other, indices, offset, ranks );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    TEST_EQUALITY( offset.extent_int( 0 ), n + 1 );
+    tree.join( empty_tree, indices, offset, ranks );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    TEST_EQUALITY( offset.extent( 0 ), 1 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, reduce, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    Kokkos::View<double *, DeviceType> values( "values", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    auto values_host = Kokkos::create_mirror_view( values );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = comm_rank + .1 * i;
+        boxes_host( i ) = {{{x, 0., 0.}}, {{x + .05, 1., 1.}}};
+        values_host( i ) = comm_rank * n + i;
+    }
+    Kokkos::deep_copy( boxes, boxes_host );
+    Kokkos::deep_copy( values, values_host );
+    Kokkos::View<int *, DeviceType> ones( "ones", n );
+    Kokkos::deep_copy( ones, 1 );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+
+    // everything, across the boundary with the next process, and nothing
+    double const x = ( comm_rank + 1 ) % comm_size;
+    auto const queries = makeOverlapQueries<DeviceType>( {
+        {{{0., 0., 0.}}, {{(double)comm_size, 1., 1.}}},
+        {{{x - .25, .5, .5}}, {{x + .25, .5, .5}}},
+        {{{-1., -1., -1.}}, {{-.5, -.5, -.5}}},
+    } );
+
+    // compare with the reductions of the results of query()
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    tree.query( queries, indices, offset, ranks );
+    auto const results = sortedResults( indices, offset, ranks );
+    std::vector<int> counts_ref;
+    std::vector<double> sums_ref;
+    std::vector<double> minima_ref;
+    for ( auto const &query_results : results )
+    {
+        counts_ref.push_back( query_results.size() );
+        sums_ref.push_back( 0. );
+        minima_ref.push_back( Kokkos::ArithTraits<double>::max() );
+        for ( auto const &result : query_results )
+        {
+            double const value = result.first * n + result.second;
+            sums_ref.back() += value;
+            minima_ref.back() = std::min( minima_ref.back(), value );
+        }
+    }
+    TEST_EQUALITY( counts_ref[0], n * comm_size );
+    TEST_EQUALITY( counts_ref[2], 0 );
+
+    Kokkos::View<int *, DeviceType> counts( "counts" );
+    tree.reduce( queries, ones, DataTransferKit::SumReducer<int>(), counts );
+    auto counts_host = Kokkos::create_mirror_view( counts );
+    Kokkos::deep_copy( counts_host, counts );
+    TEST_COMPARE_ARRAYS( counts_host, counts_ref );
+
+    Kokkos::View<double *, DeviceType> sums( "sums" );
+    tree.reduce( queries, values, DataTransferKit::SumReducer<double>(),
+                 sums );
+    auto sums_host = Kokkos::create_mirror_view( sums );
+    Kokkos::deep_copy( sums_host, sums );
+    TEST_COMPARE_FLOATING_ARRAYS( sums_host, sums_ref, 1e-14 );
+
+    Kokkos::View<double *, DeviceType> minima( "minima" );
+    tree.reduce( queries, values, DataTransferKit::MinReducer<double>(),
+                 minima );
+    auto minima_host = Kokkos::create_mirror_view( minima );
+    Kokkos::deep_copy( minima_host, minima );
+    TEST_COMPARE_ARRAYS( minima_host, minima_ref );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, halo, DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> points( "points", n );
+    auto points_host = Kokkos::create_mirror_view( points );
+    for ( int i = 0; i < n; ++i )
+        points_host( i ) = {{comm_rank + .1 * i, 0., 0.}};
+    Kokkos::deep_copy( points, points_host );
+
+    // The first query is well inside the local domain, the second one needs
+    // the halo of the next rank, and the last one lies far away and has more
+    // neighbors than most halos hold.
+    auto const queries = makeNearestQueries<DeviceType>( {
+        {{{comm_rank + .5123, .37, 0.}}, 3},
+        {{{comm_rank + .97, 0., 0.}}, 4},
+        {{{comm_size - comm_rank + .0123, 9., 0.}}, 25},
+    } );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> reference_tree( comm,
+                                                                       points );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    reference_tree.query( queries, indices, offset, ranks );
+    auto const reference = sortedResults( indices, offset, ranks );
+
+    for ( double halo_width : {0., .5} )
+    {
+        DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, points );
+        tree.buildHalo( halo_width );
+        tree.query( queries, indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+
+        // refit() rebuilds the halo
+        Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+        auto boxes_host = Kokkos::create_mirror_view( boxes );
+        for ( int i = 0; i < n; ++i )
+            boxes_host( i ) = {points_host( i ), points_host( i )};
+        Kokkos::deep_copy( boxes, boxes_host );
+        tree.refit( boxes );
+        tree.query( queries, indices, offset, ranks );
+        TEST_ASSERT( sortedResults( indices, offset, ranks ) == reference );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, replica_groups,
+                                   DeviceType )
+{
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    // Consecutive pairs of ranks hold the same points, the last rank is alone
+    // if the size of the communicator is odd.
+    int const n_blocks = ( comm_size + 1 ) / 2;
+    int const block = comm_rank / 2;
+    int const next_block = ( block + 1 ) % n_blocks;
+    auto const members = [comm_size]( int b ) {
+        return std::min( 2, comm_size - 2 * b );
+    };
+    int const n = 5;
+    Kokkos::View<DataTransferKit::Point *, DeviceType> points( "points", n );
+    auto points_host = Kokkos::create_mirror_view( points );
+    for ( int i = 0; i < n; ++i )
+        points_host( i ) = {{block + .1 * i, 0., 0.}};
+    Kokkos::deep_copy( points, points_host );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, points );
+
+    // query the points of this block and the ones of the next block
+    std::vector<DataTransferKit::Box> boxes_to_query = {
+        {{{block + .15, -.5, -.5}}, {{block + .35, .5, .5}}},
+        {{{next_block + .15, -.5, -.5}}, {{next_block + .35, .5, .5}}},
+    };
+    auto const spatial_queries =
+        makeOverlapQueries<DeviceType>( boxes_to_query );
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{block + .21, 0., 0.}}, 3},
+        {{{next_block + .21, 0., 0.}}, 3},
+    } );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+
+    // every replica answers
+    tree.query( spatial_queries, indices, offset, ranks );
+    auto results = sortedResults( indices, offset, ranks );
+    TEST_EQUALITY( (int)results[0].size(), 2 * members( block ) );
+    TEST_EQUALITY( (int)results[1].size(), 2 * members( next_block ) );
+
+    tree.setReplicaGroup( block );
+
+    // a single replica answers, this process if it is one of them
+    for ( int pass = 0; pass < 2; ++pass )
+    {
+        if ( pass == 0 )
+            tree.query( spatial_queries, indices, offset, ranks );
+        else
+            tree.query( nearest_queries, indices, offset, ranks );
+        results = sortedResults( indices, offset, ranks );
+        std::vector<int> const expected_indices[2] = {{2, 3}, {1, 2, 3}};
+        for ( int q = 0; q < 2; ++q )
+        {
+            std::vector<int> result_indices;
+            std::set<int> result_ranks;
+            for ( auto const &result : results[q] )
+            {
+                result_ranks.insert( result.first );
+                result_indices.push_back( result.second );
+            }
+            std::sort( result_indices.begin(), result_indices.end() );
+            TEST_EQUALITY( result_ranks.size(), 1u );
+            TEST_COMPARE_ARRAYS( result_indices, expected_indices[pass] );
+            int const b = ( q == 0 ) ? block : next_block;
+            if ( !result_ranks.empty() )
+            {
+                TEST_EQUALITY( *result_ranks.begin() / 2, b );
+                if ( b == block )
+                    TEST_EQUALITY( *result_ranks.begin(), comm_rank );
+            }
+        }
+    }
+
+    // the groups are dropped with negative ids
+    tree.setReplicaGroup( -1 );
+    tree.query( spatial_queries, indices, offset, ranks );
+    results = sortedResults( indices, offset, ranks );
+    TEST_EQUALITY( (int)results[0].size(), 2 * members( block ) );
 }
 
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree,
@@ -369,6 +1026,16 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree,
                 {{{(double)( comm_size - 1 - comm_rank ) + .75, 0., 0.}}, 1},
             } ),
             {0}, {0, 1}, {comm_size - 1}, success, out );
+
+    // except on rank 0, the nearest neighbor lives on a rank that is only
+    // searched in the 2nd pass, check that distances are merged as well
+    checkResults(
+        tree,
+        makeNearestQueries<DeviceType>( {
+            {{{(double)( comm_size - 1 - comm_rank ) + .75, 0., 0.}}, 1},
+        } ),
+        {0}, {0, 1}, {comm_rank > 0 ? comm_size - comm_rank : comm_size - 1},
+        {comm_rank > 0 ? .25 : .75}, success, out );
 }
 
 std::vector<std::array<double, 3>>
@@ -549,6 +1216,26 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DistributedSearchTree, boost_comparison,
         DistributedSearchTree, unique_leaf_on_rank_0, DeviceType##NODE )       \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         DistributedSearchTree, one_leaf_per_rank, DeviceType##NODE )           \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, refit,        \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        DistributedSearchTree, disconnected_local_domains, DeviceType##NODE )  \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree,               \
+                                          groups_of_ranks, DeviceType##NODE )  \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, query_async,  \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        DistributedSearchTree, query_on_owners, DeviceType##NODE )             \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, share_work,   \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, join,         \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, reduce,       \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree, halo,         \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        DistributedSearchTree, replica_groups, DeviceType##NODE )              \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DistributedSearchTree,               \
                                           non_approximate_nearest_neighbors,   \
                                           DeviceType##NODE )                   \
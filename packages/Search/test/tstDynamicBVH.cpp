@@ -0,0 +1,194 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_DynamicBVH.hpp>
+#include <DTK_LinearBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Search_UnitTestHelpers.hpp"
+
+template <typename DeviceType, typename T>
+Kokkos::View<T *, DeviceType> toView( std::vector<T> const &v )
+{
+    Kokkos::View<T *, DeviceType> w( "w", v.size() );
+    auto w_host = Kokkos::create_mirror_view( w );
+    for ( int i = 0; i < (int)v.size(); ++i )
+        w_host( i ) = v[i];
+    Kokkos::deep_copy( w, w_host );
+    return w;
+}
+
+template <typename DeviceType>
+std::vector<int> toVector( Kokkos::View<int *, DeviceType> v )
+{
+    auto v_host = Kokkos::create_mirror_view( v );
+    Kokkos::deep_copy( v_host, v );
+    return std::vector<int>( v_host.data(), v_host.data() + v.extent( 0 ) );
+}
+
+// Compare the results of the queries with the ones of a hierarchy built over
+// the objects alone, whose indices are brought back to the identifiers.  The
+// results of the spatial queries are sorted so that they can be compared
+// regardless of the order in which the objects were found.
+template <typename DeviceType, typename Query>
+void checkSameResults( DataTransferKit::DynamicBVH<DeviceType> const &tree,
+                       std::map<int, DataTransferKit::Box> const &objects,
+                       Kokkos::View<Query *, DeviceType> const &queries,
+                       bool sort, bool &success, Teuchos::FancyOStream &out )
+{
+    std::vector<DataTransferKit::Box> boxes;
+    std::vector<int> ids;
+    for ( auto const &object : objects )
+    {
+        ids.push_back( object.first );
+        boxes.push_back( object.second );
+    }
+    auto const bvh = makeBvh<DeviceType>( boxes );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    tree.query( queries, indices, offset );
+    Kokkos::View<int *, DeviceType> indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> offset_ref( "offset_ref" );
+    bvh.query( queries, indices_ref, offset_ref );
+
+    auto const offset_host = toVector( offset );
+    TEST_COMPARE_ARRAYS( offset_host, toVector( offset_ref ) );
+    auto results = toVector( indices );
+    auto results_ref = toVector( indices_ref );
+    for ( auto &i : results_ref )
+        i = ids[i];
+    if ( sort )
+        for ( int q = 0; q + 1 < (int)offset_host.size(); ++q )
+        {
+            std::sort( results.begin() + offset_host[q],
+                       results.begin() + offset_host[q + 1] );
+            std::sort( results_ref.begin() + offset_host[q],
+                       results_ref.begin() + offset_host[q + 1] );
+        }
+    TEST_COMPARE_ARRAYS( results, results_ref );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( DynamicBVH, insert_and_remove, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    // points along the x-axis
+    std::map<int, Box> objects;
+    for ( int i = 0; i < 10; ++i )
+        objects[i] = {{{(double)i, 0., 0.}}, {{(double)i, 0., 0.}}};
+    std::vector<Box> boxes;
+    for ( auto const &object : objects )
+        boxes.push_back( object.second );
+    DataTransferKit::DynamicBVH<DeviceType> tree(
+        toView<DeviceType>( boxes ) );
+    TEST_EQUALITY( tree.size(), 10 );
+    TEST_EQUALITY( tree.capacity(), 10 );
+
+    std::vector<Box> overlap_boxes;
+    std::vector<std::pair<Point, int>> nearest_points;
+    for ( int q = 0; q < 15; ++q )
+    {
+        // none of the queries is as far from two of the objects
+        double const x = -4. + 1.37 * q + 0.11;
+        overlap_boxes.push_back( {{{x - 1., -1., -1.}}, {{x + 1., 1., 1.}}} );
+        nearest_points.emplace_back( Point{{x, 0.05, 0.}}, 1 + q % 4 );
+    }
+    auto const overlap_queries =
+        makeOverlapQueries<DeviceType>( overlap_boxes );
+    auto const nearest_queries =
+        makeNearestQueries<DeviceType>( nearest_points );
+
+    std::vector<int> removed = {2, 5, 7};
+    tree.remove( toView<DeviceType>( removed ) );
+    for ( int id : removed )
+        objects.erase( id );
+    TEST_EQUALITY( tree.size(), 7 );
+    TEST_EQUALITY( tree.capacity(), 10 );
+    TEST_EQUALITY( tree.numberOfFreeSlots(), 3 );
+    checkSameResults( tree, objects, overlap_queries, true, success, out );
+    checkSameResults( tree, objects, nearest_queries, false, success, out );
+
+    // fewer objects than free slots, which they are put in
+    std::vector<Box> inserted = {{{{2.5, 0., 0.}}, {{2.5, 0., 0.}}},
+                                 {{{7.5, 0., 0.}}, {{7.5, 0., 0.}}}};
+    auto ids = toVector( tree.insert( toView<DeviceType>( inserted ) ) );
+    TEST_EQUALITY( ids.size(), inserted.size() );
+    TEST_INEQUALITY( ids[0], ids[1] );
+    for ( int i = 0; i < (int)ids.size(); ++i )
+    {
+        TEST_ASSERT( std::find( removed.begin(), removed.end(), ids[i] ) !=
+                     removed.end() );
+        objects[ids[i]] = inserted[i];
+    }
+    TEST_EQUALITY( tree.size(), 9 );
+    TEST_EQUALITY( tree.capacity(), 10 );
+    TEST_EQUALITY( tree.numberOfFreeSlots(), 1 );
+    checkSameResults( tree, objects, overlap_queries, true, success, out );
+    checkSameResults( tree, objects, nearest_queries, false, success, out );
+
+    // more objects than free slots, which are appended
+    inserted = {{{{11., 0., 0.}}, {{11., 0., 0.}}},
+                {{{-3., 0., 0.}}, {{-3., 0., 0.}}},
+                {{{12., 0., 0.}}, {{12., 0., 0.}}}};
+    ids = toVector( tree.insert( toView<DeviceType>( inserted ) ) );
+    TEST_COMPARE_ARRAYS( ids, std::vector<int>( {10, 11, 12} ) );
+    for ( int i = 0; i < (int)ids.size(); ++i )
+        objects[ids[i]] = inserted[i];
+    TEST_EQUALITY( tree.size(), 12 );
+    TEST_EQUALITY( tree.capacity(), 13 );
+    checkSameResults( tree, objects, overlap_queries, true, success, out );
+    checkSameResults( tree, objects, nearest_queries, false, success, out );
+
+    // objects that moved keep their identifiers
+    std::vector<int> moved = {0, 11};
+    std::vector<Box> moved_boxes = {{{{-1.5, 0., 0.}}, {{-1.5, 0., 0.}}},
+                                    {{{13.5, 0., 0.}}, {{13.5, 0., 0.}}}};
+    tree.update( toView<DeviceType>( moved ),
+                 toView<DeviceType>( moved_boxes ) );
+    for ( int i = 0; i < (int)moved.size(); ++i )
+        objects[moved[i]] = moved_boxes[i];
+    TEST_EQUALITY( tree.size(), 12 );
+    checkSameResults( tree, objects, overlap_queries, true, success, out );
+    checkSameResults( tree, objects, nearest_queries, false, success, out );
+
+    // nothing left in the tree
+    removed.clear();
+    for ( auto const &object : objects )
+        removed.push_back( object.first );
+    tree.remove( toView<DeviceType>( removed ) );
+    objects.clear();
+    TEST_ASSERT( tree.empty() );
+    checkSameResults( tree, objects, overlap_queries, true, success, out );
+    checkSameResults( tree, objects, nearest_queries, false, success, out );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( DynamicBVH, insert_and_remove,       \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -0,0 +1,273 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_DistributedSearchTree.hpp>
+#include <DTK_HashGrid.hpp>
+#include <DTK_LinearBVH.hpp>
+
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( HashGrid, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    // Points uniformly distributed in a slab and boxes of various sizes
+    // around them.
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 1. );
+    int const n = 1000;
+    Kokkos::View<Point *, DeviceType> points( "points", n );
+    Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+    auto points_host = Kokkos::create_mirror_view( points );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+    {
+        Point const p = {{10. * distribution( generator ),
+                          10. * distribution( generator ),
+                          2. * distribution( generator )}};
+        double const h = 0.2 * distribution( generator );
+        points_host( i ) = p;
+        boxes_host( i ) = {{{p[0] - h, p[1] - h, p[2]}},
+                           {{p[0] + h, p[1] + h, p[2] + 2. * h}}};
+    }
+    Kokkos::deep_copy( points, points_host );
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    // Queries inside and outside of the objects bounds.
+    std::vector<Box> overlap_boxes = {
+        {{{-5., -5., -5.}}, {{15., 15., 15.}}},
+        {{{20., 20., 20.}}, {{21., 21., 21.}}},
+    };
+    std::vector<std::pair<Point, double>> within_points = {
+        {{{-1., -1., -1.}}, 0.5}};
+    std::vector<std::pair<Point, int>> nearest_points = {
+        {{{-3., 5., 1.}}, 3}, {{{5., 5., 1.}}, n + 10}};
+    std::vector<std::tuple<Point, int, double>> limited_nearest_points = {
+        std::make_tuple( Point{{5., 5., 1.}}, 20, 0.3 ),
+        std::make_tuple( Point{{30., 5., 1.}}, 5, 1. )};
+    for ( int q = 0; q < 200; ++q )
+    {
+        Point const p = {{12. * distribution( generator ) - 1.,
+                          12. * distribution( generator ) - 1.,
+                          4. * distribution( generator ) - 1.}};
+        overlap_boxes.push_back( {p, {{p[0] + 0.5, p[1] + 0.3, p[2] + 0.1}}} );
+        within_points.emplace_back( p, 0.4 );
+        nearest_points.emplace_back( p, 1 + q % 10 );
+        limited_nearest_points.emplace_back( p, 1 + q % 10, 0.5 );
+    }
+    auto const overlap_queries =
+        makeOverlapQueries<DeviceType>( overlap_boxes );
+    auto const within_queries = makeWithinQueries<DeviceType>( within_points );
+    auto const nearest_queries =
+        makeNearestQueries<DeviceType>( nearest_points );
+    auto const limited_nearest_queries =
+        makeLimitedNearestQueries<DeviceType>( limited_nearest_points );
+
+    DataTransferKit::BVH<DeviceType> const point_bvh( points );
+    DataTransferKit::BVH<DeviceType> const box_bvh( boxes );
+    // Cells sized automatically, after the radius of the queries, or much
+    // smaller than the objects.
+    for ( double cell_size : {0., 0.4, 0.01} )
+    {
+        DataTransferKit::HashGrid<DeviceType> const point_grid( points,
+                                                                cell_size );
+        TEST_EQUALITY( point_grid.size(), point_bvh.size() );
+        TEST_ASSERT( DataTransferKit::Details::equals( point_grid.bounds(),
+                                                       point_bvh.bounds() ) );
+        TEST_ASSERT( point_grid.cellSize() >= cell_size );
+        checkSameSpatialResults( point_grid, point_bvh, overlap_queries,
+                                 success, out );
+        checkSameSpatialResults( point_grid, point_bvh, within_queries,
+                                 success, out );
+        checkSameNearestResults( point_grid, point_bvh, nearest_queries, true,
+                                 success, out );
+        checkSameNearestResults( point_grid, point_bvh,
+                                 limited_nearest_queries, true, success, out );
+
+        DataTransferKit::HashGrid<DeviceType> const box_grid( boxes,
+                                                              cell_size );
+        TEST_EQUALITY( box_grid.size(), box_bvh.size() );
+        checkSameSpatialResults( box_grid, box_bvh, overlap_queries, success,
+                                 out );
+        checkSameSpatialResults( box_grid, box_bvh, within_queries, success,
+                                 out );
+        checkSameNearestResults( box_grid, box_bvh, nearest_queries, false,
+                                 success, out );
+    }
+
+    // No objects at all.
+    DataTransferKit::HashGrid<DeviceType> const empty_grid;
+    TEST_ASSERT( empty_grid.empty() );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    empty_grid.query( overlap_queries, indices, offset );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    TEST_EQUALITY( offset.extent( 0 ), overlap_queries.extent( 0 ) + 1 );
+    empty_grid.query( nearest_queries, indices, offset );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    TEST_EQUALITY( offset.extent( 0 ), nearest_queries.extent( 0 ) + 1 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( HashGrid, distributed_search_tree,
+                                   DeviceType )
+{
+    using DataTransferKit::Point;
+
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+
+    // Each process owns a regular lattice of points in a slab, slightly
+    // perturbed so that the distances are all different.
+    std::default_random_engine generator( comm_rank );
+    std::uniform_real_distribution<double> distribution( -0.1, 0.1 );
+    std::vector<Point> local_points;
+    for ( int k = 0; k < 4; ++k )
+        for ( int j = 0; j < 4; ++j )
+            for ( int i = 0; i < 4; ++i )
+                local_points.push_back(
+                    {{4. * comm_rank + i + distribution( generator ),
+                      j + distribution( generator ),
+                      k + distribution( generator )}} );
+    int const n = local_points.size();
+    Kokkos::View<Point *, DeviceType> points( "points", n );
+    auto points_host = Kokkos::create_mirror_view( points );
+    for ( int i = 0; i < n; ++i )
+        points_host( i ) = local_points[i];
+    Kokkos::deep_copy( points, points_host );
+
+    // Queries around the points, straddling the next process.
+    std::vector<std::pair<Point, double>> within_points;
+    std::vector<std::pair<Point, int>> nearest_points;
+    for ( int i = 0; i < 4; ++i )
+    {
+        Point const p = {{4. * comm_rank + i + 0.7, 1.3, 2.1}};
+        within_points.emplace_back( p, 1.2 );
+        nearest_points.emplace_back( p, 5 );
+    }
+    auto const within_queries = makeWithinQueries<DeviceType>( within_points );
+    auto const nearest_queries =
+        makeNearestQueries<DeviceType>( nearest_points );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, points );
+    Kokkos::View<int *, DeviceType> within_indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> within_offset_ref( "offset_ref" );
+    Kokkos::View<int *, DeviceType> within_ranks_ref( "ranks_ref" );
+    tree.query( within_queries, within_indices_ref, within_offset_ref,
+                within_ranks_ref );
+    Kokkos::View<int *, DeviceType> nearest_indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> nearest_offset_ref( "offset_ref" );
+    Kokkos::View<int *, DeviceType> nearest_ranks_ref( "ranks_ref" );
+    Kokkos::View<double *, DeviceType> nearest_distances_ref(
+        "distances_ref" );
+    tree.query( nearest_queries, nearest_indices_ref, nearest_offset_ref,
+                nearest_ranks_ref, nearest_distances_ref );
+
+    tree.setHashGrid( DataTransferKit::HashGrid<DeviceType>( points ) );
+    Kokkos::View<int *, DeviceType> within_indices( "indices" );
+    Kokkos::View<int *, DeviceType> within_offset( "offset" );
+    Kokkos::View<int *, DeviceType> within_ranks( "ranks" );
+    tree.query( within_queries, within_indices, within_offset, within_ranks );
+    Kokkos::View<int *, DeviceType> nearest_indices( "indices" );
+    Kokkos::View<int *, DeviceType> nearest_offset( "offset" );
+    Kokkos::View<int *, DeviceType> nearest_ranks( "ranks" );
+    Kokkos::View<double *, DeviceType> nearest_distances( "distances" );
+    tree.query( nearest_queries, nearest_indices, nearest_offset,
+                nearest_ranks, nearest_distances );
+
+    // The spatial results are grouped by query in the same order either way.
+    auto within_offset_host = Kokkos::create_mirror_view( within_offset );
+    Kokkos::deep_copy( within_offset_host, within_offset );
+    auto within_offset_ref_host =
+        Kokkos::create_mirror_view( within_offset_ref );
+    Kokkos::deep_copy( within_offset_ref_host, within_offset_ref );
+    TEST_COMPARE_ARRAYS( within_offset_host, within_offset_ref_host );
+    auto within_indices_host = Kokkos::create_mirror_view( within_indices );
+    Kokkos::deep_copy( within_indices_host, within_indices );
+    auto within_ranks_host = Kokkos::create_mirror_view( within_ranks );
+    Kokkos::deep_copy( within_ranks_host, within_ranks );
+    auto within_indices_ref_host =
+        Kokkos::create_mirror_view( within_indices_ref );
+    Kokkos::deep_copy( within_indices_ref_host, within_indices_ref );
+    auto within_ranks_ref_host = Kokkos::create_mirror_view( within_ranks_ref );
+    Kokkos::deep_copy( within_ranks_ref_host, within_ranks_ref );
+    for ( int q = 0; q < (int)within_points.size(); ++q )
+    {
+        std::vector<std::pair<int, int>> results;
+        std::vector<std::pair<int, int>> results_ref;
+        for ( int i = within_offset_host( q ); i < within_offset_host( q + 1 );
+              ++i )
+        {
+            results.emplace_back( within_ranks_host( i ),
+                                  within_indices_host( i ) );
+            results_ref.emplace_back( within_ranks_ref_host( i ),
+                                      within_indices_ref_host( i ) );
+        }
+        std::sort( results.begin(), results.end() );
+        std::sort( results_ref.begin(), results_ref.end() );
+        TEST_ASSERT( results == results_ref );
+    }
+
+    // The nearest neighbors come sorted by distance either way.
+    auto nearest_offset_host = Kokkos::create_mirror_view( nearest_offset );
+    Kokkos::deep_copy( nearest_offset_host, nearest_offset );
+    auto nearest_offset_ref_host =
+        Kokkos::create_mirror_view( nearest_offset_ref );
+    Kokkos::deep_copy( nearest_offset_ref_host, nearest_offset_ref );
+    TEST_COMPARE_ARRAYS( nearest_offset_host, nearest_offset_ref_host );
+    auto nearest_indices_host = Kokkos::create_mirror_view( nearest_indices );
+    Kokkos::deep_copy( nearest_indices_host, nearest_indices );
+    auto nearest_indices_ref_host =
+        Kokkos::create_mirror_view( nearest_indices_ref );
+    Kokkos::deep_copy( nearest_indices_ref_host, nearest_indices_ref );
+    TEST_COMPARE_ARRAYS( nearest_indices_host, nearest_indices_ref_host );
+    auto nearest_ranks_host = Kokkos::create_mirror_view( nearest_ranks );
+    Kokkos::deep_copy( nearest_ranks_host, nearest_ranks );
+    auto nearest_ranks_ref_host =
+        Kokkos::create_mirror_view( nearest_ranks_ref );
+    Kokkos::deep_copy( nearest_ranks_ref_host, nearest_ranks_ref );
+    TEST_COMPARE_ARRAYS( nearest_ranks_host, nearest_ranks_ref_host );
+    auto nearest_distances_host =
+        Kokkos::create_mirror_view( nearest_distances );
+    Kokkos::deep_copy( nearest_distances_host, nearest_distances );
+    auto nearest_distances_ref_host =
+        Kokkos::create_mirror_view( nearest_distances_ref );
+    Kokkos::deep_copy( nearest_distances_ref_host, nearest_distances_ref );
+    TEST_COMPARE_FLOATING_ARRAYS( nearest_distances_host,
+                                  nearest_distances_ref_host, 1e-14 );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( HashGrid, same_as_bvh,               \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( HashGrid, distributed_search_tree,   \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -0,0 +1,115 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_HeterogeneousBVH.hpp>
+#include <DTK_LinearBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <random>
+#include <vector>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( HeterogeneousBVH, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+    using OtherDeviceType =
+        Kokkos::Device<Kokkos::DefaultHostExecutionSpace, Kokkos::HostSpace>;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    int const n = 500;
+    std::vector<Box> object_boxes;
+    for ( int i = 0; i < n; ++i )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        object_boxes.push_back( {p, {{p[0] + 0.5, p[1] + 0.5, p[2] + 0.5}}} );
+    }
+    Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = object_boxes[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::BVH<DeviceType> const bvh( boxes );
+    DataTransferKit::HeterogeneousBVH<DeviceType, OtherDeviceType> tree(
+        boxes );
+    TEST_EQUALITY( tree.size(), bvh.size() );
+    TEST_ASSERT(
+        DataTransferKit::Details::equals( tree.bounds(), bvh.bounds() ) );
+
+    std::vector<Box> overlap_boxes;
+    std::vector<std::pair<Point, int>> nearest_points;
+    for ( int q = 0; q < 300; ++q )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        overlap_boxes.push_back( {p, {{p[0] + 1., p[1] + 1., p[2] + 1.}}} );
+        nearest_points.emplace_back( p, q % 7 );
+    }
+    auto const overlap_queries =
+        makeOverlapQueries<DeviceType>( overlap_boxes );
+    auto const nearest_queries =
+        makeNearestQueries<DeviceType>( nearest_points );
+
+    // All the queries in either space or split between the two.
+    for ( double fraction : {0., 1., 0.3} )
+    {
+        tree.setFraction( fraction, false );
+        checkSameSpatialResults( tree, bvh, overlap_queries, success, out );
+        checkSameSpatialResults( tree, bvh, nearest_queries, success, out );
+        TEST_EQUALITY( tree.fraction(), fraction );
+    }
+
+    // The distances are merged along with the indices.
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    tree.query( nearest_queries, indices, offset, distances );
+    Kokkos::View<int *, DeviceType> indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> offset_ref( "offset_ref" );
+    Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+    bvh.query( nearest_queries, indices_ref, offset_ref, distances_ref );
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    auto distances_ref_host = Kokkos::create_mirror_view( distances_ref );
+    Kokkos::deep_copy( distances_ref_host, distances_ref );
+    TEST_COMPARE_FLOATING_ARRAYS( distances_host, distances_ref_host, 1e-14 );
+
+    // The split follows the measured throughput but keeps both parts busy.
+    tree.setFraction( 0.5 );
+    checkSameSpatialResults( tree, bvh, overlap_queries, success, out );
+    TEST_ASSERT( tree.fraction() >= 0.05 && tree.fraction() <= 0.95 );
+    checkSameSpatialResults( tree, bvh, overlap_queries, success, out );
+
+    // No queries at all.
+    checkSameSpatialResults(
+        tree, bvh, makeOverlapQueries<DeviceType>( std::vector<Box>() ),
+        success, out );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( HeterogeneousBVH, same_as_bvh,       \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
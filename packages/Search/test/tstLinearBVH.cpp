@@ -10,15 +10,20 @@
  ****************************************************************************/
 
 #include <DTK_LinearBVH.hpp>
+#include <DTK_SurfaceProjection.hpp>
 
 #include <Teuchos_UnitTestHarness.hpp>
 
 #include "DTK_BoostRTreeHelpers.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <numeric>
 #include <random>
 #include <tuple>
+#include <utility>
 
 #include "Search_UnitTestHelpers.hpp"
 
@@ -238,6 +243,358 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, duplicated_leaves, DeviceType )
     TEST_EQUALITY( true, true );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, morton_codes_64, DeviceType )
+{
+    // The points near the origin are too close to each other with respect to
+    // the extent of the scene to be discriminated by 30-bit Morton codes.
+    std::vector<DataTransferKit::Box> b = {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1e-3, 0., 0.}}, {{1e-3, 0., 0.}}},
+        {{{0., 1e-3, 0.}}, {{0., 1e-3, 0.}}},
+        {{{0., 0., 1e-3}}, {{0., 0., 1e-3}}},
+        {{{1e3, 1e3, 1e3}}, {{1e3, 1e3, 1e3}}},
+    };
+    int const n = b.size();
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = b[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::BVH<DeviceType> const bvh(
+        boxes, DataTransferKit::MortonCode64Tag{} );
+
+    TEST_ASSERT( !bvh.empty() );
+    TEST_EQUALITY( bvh.size(), n );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        bvh.bounds(), {{{0., 0., 0.}}, {{1e3, 1e3, 1e3}}} ) );
+
+    checkResults( bvh,
+                  makeNearestQueries<DeviceType>( {
+                      {{{0., 0., 0.}}, 1},
+                      {{{1e-3, 0., 0.}}, 1},
+                      {{{0., 1e-3, 0.}}, 1},
+                      {{{0., 0., 1e-3}}, 1},
+                      {{{1e3, 1e3, 1e3}}, 1},
+                  } ),
+                  {0, 1, 2, 3, 4}, {0, 1, 2, 3, 4, 5}, {0., 0., 0., 0., 0.},
+                  success, out );
+
+    checkResults( bvh,
+                  makeWithinQueries<DeviceType>( {
+                      {{{1e-3, 0., 0.}}, 1e-4},
+                      {{{5e2, 5e2, 5e2}}, 1.},
+                  } ),
+                  {1}, {0, 1, 1}, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, hilbert_codes, DeviceType )
+{
+    // sorting the objects along the Hilbert curve rather than the Z-order
+    // curve changes the hierarchy but not the results
+    std::vector<DataTransferKit::Box> b;
+    std::vector<std::pair<DataTransferKit::Point, int>> nearest;
+    for ( int i = 0; i < 4; ++i )
+        for ( int j = 0; j < 4; ++j )
+            for ( int k = 0; k < 4; ++k )
+            {
+                b.push_back( {{{i * 2., j * 2., k * 2.}},
+                              {{i * 2. + 1., j * 2. + 1., k * 2. + 1.}}} );
+                nearest.push_back(
+                    {{{i * 2. + .5, j * 2. + .5, k * 2. + .5}}, 1} );
+            }
+    int const n = b.size();
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = b[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    std::vector<int> indices_ref( n );
+    std::iota( indices_ref.begin(), indices_ref.end(), 0 );
+    std::vector<int> offset_ref( n + 1 );
+    std::iota( offset_ref.begin(), offset_ref.end(), 0 );
+    std::vector<double> distances_ref( n, 0. );
+
+    DataTransferKit::BVH<DeviceType> const bvh(
+        boxes, DataTransferKit::HilbertCode32Tag{} );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        bvh.bounds(), {{{0., 0., 0.}}, {{7., 7., 7.}}} ) );
+    checkResults( bvh, makeNearestQueries<DeviceType>( nearest ), indices_ref,
+                  offset_ref, distances_ref, success, out );
+    checkResults( bvh,
+                  makeWithinQueries<DeviceType>( {
+                      {{{1.5, 1.5, 1.5}}, .5},
+                      {{{7., 7., 7.}}, .5},
+                      {{{3.2, 2.5, 2.5}}, .5},
+                  } ),
+                  {63, 21}, {0, 0, 1, 2}, success, out );
+
+    DataTransferKit::BVH<DeviceType> const bvh_64(
+        boxes, DataTransferKit::HilbertCode64Tag{} );
+    checkResults( bvh_64, makeNearestQueries<DeviceType>( nearest ),
+                  indices_ref, offset_ref, distances_ref, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, refit, DeviceType )
+{
+    int const n = 4;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{(double)i, 0., 0.}}, {{(double)i + .5, 1., 1.}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::BVH<DeviceType> bvh( boxes );
+
+    // translate all the boxes, the quality of the hierarchy is unchanged
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{(double)i, 0., 10.}}, {{(double)i + .5, 1., 11.}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    TEST_FLOATING_EQUALITY( bvh.refit( boxes ), 1., 1e-14 );
+    TEST_EQUALITY( bvh.size(), n );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        bvh.bounds(), {{{0., 0., 10.}}, {{3.5, 1., 11.}}} ) );
+
+    checkResults( bvh,
+                  makeOverlapQueries<DeviceType>( {
+                      {{{0., 0., 0.}}, {{4., 1., 1.}}},
+                      {{{1.25, .5, 10.5}}, {{2.25, .5, 10.5}}},
+                  } ),
+                  {2, 1}, {0, 0, 2}, success, out );
+
+    checkResults( bvh,
+                  makeNearestQueries<DeviceType>( {
+                      {{{3.25, .5, 10.5}}, 1},
+                  } ),
+                  {3}, {0, 1}, {0.}, success, out );
+
+    // swap the two objects at the ends, the hierarchy is now of poor quality
+    std::swap( boxes_host( 0 ), boxes_host( n - 1 ) );
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    TEST_COMPARE( bvh.refit( boxes ), >, 1. );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        bvh.bounds(), {{{0., 0., 10.}}, {{3.5, 1., 11.}}} ) );
+
+    checkResults( bvh,
+                  makeNearestQueries<DeviceType>( {
+                      {{{3.25, .5, 10.5}}, 1},
+                  } ),
+                  {0}, {0, 1}, {0.}, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, statistics, DeviceType )
+{
+    int const n = 4;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{(double)i, 0., 0.}}, {{(double)i + .5, 1., 1.}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::BVH<DeviceType> bvh( boxes );
+
+    // the row of boxes is split in two pairs that do not overlap
+    auto const statistics = bvh.computeStatistics();
+    TEST_COMPARE_ARRAYS( statistics.depth_histogram,
+                         std::vector<int>( {0, 0, 4} ) );
+    // ( 1.2 * ( 16 + 8 + 8 ) + 4 * 4 ) / 16
+    TEST_FLOATING_EQUALITY( statistics.sah_cost, 3.4, 1e-14 );
+    TEST_EQUALITY( statistics.sibling_overlap_volume, 0. );
+    TEST_FLOATING_EQUALITY( statistics.min_leaf_volume, .5, 1e-14 );
+    TEST_FLOATING_EQUALITY( statistics.max_leaf_volume, .5, 1e-14 );
+    TEST_FLOATING_EQUALITY( statistics.mean_leaf_volume, .5, 1e-14 );
+    TEST_FLOATING_EQUALITY( statistics.total_leaf_volume, 2., 1e-14 );
+
+    // the point only gets to the leaves of one pair
+    Kokkos::View<DataTransferKit::TraversalStatistics *, DeviceType>
+        query_statistics( "query_statistics" );
+    bvh.queryStatistics( makeOverlapQueries<DeviceType>( {
+                             {{{1.25, .5, .5}}, {{1.25, .5, .5}}},
+                         } ),
+                         query_statistics );
+    auto query_statistics_host = Kokkos::create_mirror_view_and_copy(
+        Kokkos::HostSpace(), query_statistics );
+    TEST_EQUALITY( query_statistics_host.extent( 0 ), 1u );
+    TEST_EQUALITY( query_statistics_host( 0 ).nodes_visited, 5 );
+    TEST_EQUALITY( query_statistics_host( 0 ).leaves_tested, 2 );
+    TEST_EQUALITY( query_statistics_host( 0 ).stack_high_water_mark, 0 );
+
+    // the stack holds the far child of the root and both leaves of the near
+    // one
+    bvh.queryStatistics( makeNearestQueries<DeviceType>( {
+                             {{{3.25, .5, .5}}, 1},
+                         } ),
+                         query_statistics );
+    query_statistics_host = Kokkos::create_mirror_view_and_copy(
+        Kokkos::HostSpace(), query_statistics );
+    TEST_EQUALITY( query_statistics_host( 0 ).nodes_visited, 4 );
+    TEST_EQUALITY( query_statistics_host( 0 ).leaves_tested, 2 );
+    TEST_EQUALITY( query_statistics_host( 0 ).stack_high_water_mark, 3 );
+
+    // identical boxes overlap entirely
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{0., 0., 0.}}, {{1., 1., 1.}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+    auto const duplicated_statistics =
+        DataTransferKit::BVH<DeviceType>( boxes ).computeStatistics();
+    TEST_FLOATING_EQUALITY( duplicated_statistics.sibling_overlap_volume,
+                            3., 1e-14 );
+    TEST_EQUALITY( std::accumulate(
+                       duplicated_statistics.depth_histogram.begin(),
+                       duplicated_statistics.depth_histogram.end(), 0 ),
+                   n );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, forest, DeviceType )
+{
+    std::vector<std::vector<DataTransferKit::Box>> boxes_per_tree = {
+        {
+            {{{0., 0., 0.}}, {{0., 0., 0.}}},
+            {{{1., 0., 0.}}, {{1., 0., 0.}}},
+            {{{2., 0., 0.}}, {{2., 0., 0.}}},
+            {{{3., 0., 0.}}, {{3., 0., 0.}}},
+        },
+        {},
+        {
+            {{{10., 10., 10.}}, {{11., 11., 11.}}},
+        },
+        {
+            {{{0., 1., 0.}}, {{1., 2., 1.}}},
+            {{{2., 0., 0.}}, {{3., 1., 1.}}},
+            {{{0., 0., .5}}, {{1., 1., 1.5}}},
+        },
+    };
+    int const n_trees = boxes_per_tree.size();
+
+    std::vector<DataTransferKit::Box> all_boxes;
+    std::vector<int> offsets = {0};
+    for ( auto const &boxes : boxes_per_tree )
+    {
+        all_boxes.insert( all_boxes.end(), boxes.begin(), boxes.end() );
+        offsets.push_back( all_boxes.size() );
+    }
+    Kokkos::View<DataTransferKit::Box *, DeviceType> bounding_boxes(
+        "bounding_boxes", all_boxes.size() );
+    Kokkos::deep_copy( bounding_boxes,
+                       Kokkos::View<DataTransferKit::Box *, Kokkos::HostSpace,
+                                    Kokkos::MemoryUnmanaged>(
+                           all_boxes.data(), all_boxes.size() ) );
+    Kokkos::View<int *, DeviceType> offsets_view( "offsets", n_trees + 1 );
+    Kokkos::deep_copy( offsets_view,
+                       Kokkos::View<int *, Kokkos::HostSpace,
+                                    Kokkos::MemoryUnmanaged>( offsets.data(),
+                                                              n_trees + 1 ) );
+
+    auto const forest = DataTransferKit::BVH<DeviceType>::buildForest(
+        bounding_boxes, offsets_view );
+    TEST_EQUALITY( static_cast<int>( forest.size() ), n_trees );
+
+    auto const spatial_queries = makeOverlapQueries<DeviceType>( {
+        {{{0., 0., 0.}}, {{11., 11., 11.}}},
+        {{{1.5, 0., 0.}}, {{2.5, 1., 1.}}},
+        {},
+    } );
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{0., 0., 0.}}, 2},
+        {{{2.6, 0.2, 0.}}, 1},
+        {{{5., 5., 5.}}, 5},
+    } );
+
+    // each tree must behave exactly as if it had been built on its own
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    for ( int i = 0; i < n_trees; ++i )
+    {
+        auto const &tree = forest[i];
+        auto const bvh = makeBvh<DeviceType>( boxes_per_tree[i] );
+        TEST_EQUALITY( tree.size(), bvh.size() );
+        TEST_ASSERT(
+            DataTransferKit::Details::equals( tree.bounds(), bvh.bounds() ) );
+
+        ViewType indices_ref( "indices_ref" );
+        ViewType offset_ref( "offset_ref" );
+        ViewType indices( "indices" );
+        ViewType offset( "offset" );
+
+        bvh.query( spatial_queries, indices_ref, offset_ref );
+        tree.query( spatial_queries, indices, offset );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+
+        Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+        Kokkos::View<double *, DeviceType> distances( "distances" );
+        bvh.query( nearest_queries, indices_ref, offset_ref, distances_ref );
+        tree.query( nearest_queries, indices, offset, distances );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+        TEST_COMPARE_ARRAYS( distances, distances_ref );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, single_precision, DeviceType )
+{
+    // None of the coordinates below is exactly representable in single
+    // precision.  Neighboring boxes share a face and the queries are placed
+    // right on the faces of the boxes.
+    int const n = 10;
+    Kokkos::View<DataTransferKit::Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{.1 * i, 0., 0.}}, {{.1 * ( i + 1 ), .1, .1}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    DataTransferKit::BVH<DeviceType, float> bvh( boxes );
+
+    TEST_ASSERT( !bvh.empty() );
+    TEST_EQUALITY( bvh.size(), n );
+
+    // The corners are rounded outward so the bounds enclose all the objects.
+    auto const bounds = bvh.bounds();
+    for ( int d = 0; d < 3; ++d )
+        TEST_COMPARE( bounds.minCorner()[d], <=, 0. );
+    TEST_COMPARE( bounds.maxCorner()[0], >=, .1 * n );
+    TEST_COMPARE( bounds.maxCorner()[1], >=, .1 );
+    TEST_COMPARE( bounds.maxCorner()[2], >=, .1 );
+
+    checkResults( bvh,
+                  makeOverlapQueries<DeviceType>( {
+                      {{{.1 * n, .05, .05}}, {{.1 * n, .05, .05}}},
+                      {{{.35, .1, .05}}, {{.35, .1, .05}}},
+                      {{{.35, .1 + 1e-3, .05}}, {{.35, .1 + 1e-3, .05}}},
+                  } ),
+                  {n - 1, 3}, {0, 1, 2, 2}, success, out );
+
+    checkResults( bvh,
+                  makeWithinQueries<DeviceType>( {
+                      {{{.45, .15, .05}}, .05},
+                  } ),
+                  {4}, {0, 1}, success, out );
+
+    checkResults( bvh,
+                  makeNearestQueries<DeviceType>( {
+                      {{{.55, .05, .05}}, 1},
+                  } ),
+                  {5}, {0, 1}, {0.}, success, out );
+
+    // translate all the boxes and check that the refitted hierarchy is still
+    // conservative
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = {{{.1 * i, 0., .3}}, {{.1 * ( i + 1 ), .1, .4}}};
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    TEST_FLOATING_EQUALITY( bvh.refit( boxes ), 1., 1e-6 );
+    TEST_COMPARE( bvh.bounds().minCorner()[2], <=, .3 );
+    TEST_COMPARE( bvh.bounds().maxCorner()[2], >=, .4 );
+
+    checkResults( bvh,
+                  makeOverlapQueries<DeviceType>( {
+                      {{{.75, .05, .4}}, {{.75, .05, .4}}},
+                  } ),
+                  {7}, {0, 1}, success, out );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, buffer_optimization, DeviceType )
 {
     auto const bvh = makeBvh<DeviceType>( {
@@ -297,6 +654,544 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, buffer_optimization, DeviceType )
     // passing null size skips the buffer optimization and never throws
     TEST_NOTHROW( bvh.query( queries, indices, offset, 0 ) );
     checkResultsAreFine();
+
+    // same thing, spelled out
+    TEST_NOTHROW( bvh.query( queries, indices, offset,
+                             DataTransferKit::CountThenFill{} ) );
+    checkResultsAreFine();
+
+    // buffer size estimated from the first query alone, which has no result,
+    // so that the second query overflows the buffer
+    TEST_NOTHROW( bvh.query( queries, indices, offset,
+                             DataTransferKit::AdaptiveBuffer( 1 ) ) );
+    checkResultsAreFine();
+
+    // buffer size estimated from all the queries
+    TEST_NOTHROW( bvh.query( queries, indices, offset,
+                             DataTransferKit::AdaptiveBuffer() ) );
+    checkResultsAreFine();
+
+    // the strategies are timed in turn, then the fastest one is used
+    for ( int i = 0; i < 3; ++i )
+    {
+        TEST_NOTHROW( bvh.query( queries, indices, offset,
+                                 DataTransferKit::AutoTuned{} ) );
+        checkResultsAreFine();
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, int64_offsets, DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+    } );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<std::int64_t *, DeviceType> offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    auto checkResults = [&indices, &offset, &success, &out](
+                            std::vector<int> const &indices_ref,
+                            std::vector<std::int64_t> const &offset_ref ) {
+        auto indices_host = Kokkos::create_mirror_view( indices );
+        Kokkos::deep_copy( indices_host, indices );
+        auto offset_host = Kokkos::create_mirror_view( offset );
+        Kokkos::deep_copy( offset_host, offset );
+        TEST_COMPARE_ARRAYS( indices_host, indices_ref );
+        TEST_COMPARE_ARRAYS( offset_host, offset_ref );
+    };
+
+    // same results as with int offsets whatever the layout strategy
+    auto const spatial_queries = makeOverlapQueries<DeviceType>( {
+        {},
+        {{{0., 0., 0.}}, {{3., 3., 3.}}},
+        {{{1.5, 0., 0.}}, {{2.5, 0., 0.}}},
+    } );
+    bvh.query( spatial_queries, indices, offset );
+    checkResults( {3, 2, 1, 0, 2}, {0, 0, 4, 5} );
+    bvh.query( spatial_queries, indices, offset, +1 );
+    checkResults( {3, 2, 1, 0, 2}, {0, 0, 4, 5} );
+    bvh.query( spatial_queries, indices, offset,
+               DataTransferKit::AdaptiveBuffer() );
+    checkResults( {3, 2, 1, 0, 2}, {0, 0, 4, 5} );
+
+    // the entries of the nearest queries that found fewer than k neighbors
+    // are compacted as well
+    bvh.query( makeLimitedNearestQueries<DeviceType>( {
+                   std::make_tuple( DataTransferKit::Point{{0., 0., 0.}}, 3,
+                                    1.5 ),
+                   std::make_tuple( DataTransferKit::Point{{2.2, 0., 0.}}, 2,
+                                    10. ),
+               } ),
+               indices, offset, distances );
+    checkResults( {0, 1, 2, 3}, {0, 2, 4} );
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    std::vector<double> distances_ref = {0., 1., .2, .8};
+    TEST_COMPARE_FLOATING_ARRAYS( distances_host, distances_ref, 1e-14 );
+}
+
+template <typename DeviceType>
+struct CountAndSumIndices
+{
+    Kokkos::View<int *, DeviceType> _counts;
+    Kokkos::View<int *, DeviceType> _sums;
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int query, int index ) const
+    {
+        Kokkos::atomic_add( &_counts( query ), 1 );
+        Kokkos::atomic_add( &_sums( query ), index );
+    }
+
+    KOKKOS_INLINE_FUNCTION
+    void operator()( int query, int index, double ) const
+    {
+        ( *this )( query, index );
+    }
+};
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, callback, DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+    } );
+
+    int const n_queries = 3;
+    CountAndSumIndices<DeviceType> callback{
+        Kokkos::View<int *, DeviceType>( "counts", n_queries ),
+        Kokkos::View<int *, DeviceType>( "sums", n_queries )};
+    auto counts_host = Kokkos::create_mirror_view( callback._counts );
+    auto sums_host = Kokkos::create_mirror_view( callback._sums );
+
+    bvh.query( makeOverlapQueries<DeviceType>( {
+                   {{{0., 0., 0.}}, {{3., 3., 3.}}},
+                   {},
+                   {{{1.5, 0., 0.}}, {{2.5, 0., 0.}}},
+               } ),
+               callback );
+    Kokkos::deep_copy( counts_host, callback._counts );
+    Kokkos::deep_copy( sums_host, callback._sums );
+    TEST_COMPARE_ARRAYS( counts_host, std::vector<int>( {4, 0, 1} ) );
+    TEST_COMPARE_ARRAYS( sums_host, std::vector<int>( {6, 0, 2} ) );
+
+    Kokkos::deep_copy( callback._counts, 0 );
+    Kokkos::deep_copy( callback._sums, 0 );
+    bvh.query( makeNearestQueries<DeviceType>( {
+                   {{{0., 0., 0.}}, 2},
+                   {{{2.9, 0., 0.}}, 1},
+                   {{{10., 0., 0.}}, 10},
+               } ),
+               callback );
+    Kokkos::deep_copy( counts_host, callback._counts );
+    Kokkos::deep_copy( sums_host, callback._sums );
+    TEST_COMPARE_ARRAYS( counts_host, std::vector<int>( {2, 1, 4} ) );
+    TEST_COMPARE_ARRAYS( sums_host, std::vector<int>( {1, 3, 6} ) );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, query_workspace, DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+    } );
+
+    auto const spatial_queries = makeOverlapQueries<DeviceType>( {
+        {{{0., 0., 0.}}, {{3., 3., 3.}}},
+        {},
+        {{{1.5, 0., 0.}}, {{2.5, 0., 0.}}},
+    } );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    bvh.query( spatial_queries, indices, offset );
+
+    // Same results as with the views, with or without a strategy.
+    DataTransferKit::QueryWorkspace<DeviceType> workspace;
+    bvh.query( spatial_queries, workspace );
+    TEST_COMPARE_ARRAYS( workspace.indices, indices );
+    TEST_COMPARE_ARRAYS( workspace.offset, offset );
+    bvh.query( spatial_queries, workspace,
+               DataTransferKit::AdaptiveBuffer( 1 ) );
+    TEST_COMPARE_ARRAYS( workspace.indices, indices );
+    TEST_COMPARE_ARRAYS( workspace.offset, offset );
+
+    // The buffers are reused as long as the results fit.
+    bvh.query( spatial_queries, workspace );
+    int const *indices_data = workspace.indices.data();
+    int const *offset_data = workspace.offset.data();
+    auto const size = workspace.size();
+    bvh.query( spatial_queries, workspace );
+    TEST_EQUALITY( workspace.indices.data(), indices_data );
+    TEST_EQUALITY( workspace.offset.data(), offset_data );
+    TEST_EQUALITY( workspace.size(), size );
+    TEST_COMPARE_ARRAYS( workspace.indices, indices );
+
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{0., 0., 0.}}, 2},
+        {{{2.9, 0., 0.}}, 1},
+    } );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.query( nearest_queries, indices, offset, distances );
+    bvh.query( nearest_queries, workspace );
+    TEST_COMPARE_ARRAYS( workspace.indices, indices );
+    TEST_COMPARE_ARRAYS( workspace.offset, offset );
+    TEST_COMPARE_ARRAYS( workspace.distances, distances );
+    TEST_EQUALITY( workspace.indices.data(), indices_data );
+
+    workspace.release();
+    TEST_EQUALITY( workspace.size(), 0 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, reduce, DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+    } );
+
+    Kokkos::View<int *, DeviceType> ones( "ones", 4 );
+    Kokkos::deep_copy( ones, 1 );
+    Kokkos::View<double *, DeviceType> weights( "weights", 4 );
+    auto weights_host = Kokkos::create_mirror_view( weights );
+    for ( int i = 0; i < 4; ++i )
+        weights_host( i ) = 10. - i;
+    Kokkos::deep_copy( weights, weights_host );
+
+    auto const queries = makeWithinQueries<DeviceType>( {
+        {{{0., 0., 0.}}, 1.5},
+        {{{10., 0., 0.}}, 1.},
+        {{{2., 0., 0.}}, 5.},
+    } );
+
+    Kokkos::View<int *, DeviceType> counts( "counts" );
+    bvh.reduce( queries, ones, DataTransferKit::SumReducer<int>(), counts );
+    auto counts_host = Kokkos::create_mirror_view( counts );
+    Kokkos::deep_copy( counts_host, counts );
+    TEST_COMPARE_ARRAYS( counts_host, std::vector<int>( {2, 0, 4} ) );
+
+    Kokkos::View<double *, DeviceType> sums( "sums" );
+    bvh.reduce( queries, weights, DataTransferKit::SumReducer<double>(),
+                sums );
+    auto sums_host = Kokkos::create_mirror_view( sums );
+    Kokkos::deep_copy( sums_host, sums );
+    TEST_COMPARE_FLOATING_ARRAYS( sums_host,
+                                  std::vector<double>( {19., 0., 34.} ),
+                                  1e-14 );
+
+    // the identity of the reduction is left when nothing is found
+    Kokkos::View<double *, DeviceType> minima( "minima" );
+    bvh.reduce( queries, weights, DataTransferKit::MinReducer<double>(),
+                minima );
+    auto minima_host = Kokkos::create_mirror_view( minima );
+    Kokkos::deep_copy( minima_host, minima );
+    TEST_EQUALITY( minima_host( 0 ), 9. );
+    TEST_EQUALITY( minima_host( 1 ), Kokkos::ArithTraits<double>::max() );
+    TEST_EQUALITY( minima_host( 2 ), 7. );
+
+    // nearest queries reduce over their k nearest neighbors
+    Kokkos::View<double *, DeviceType> maxima( "maxima" );
+    bvh.reduce( makeNearestQueries<DeviceType>( {
+                    {{{0., 0., 0.}}, 2},
+                    {{{2.9, 0., 0.}}, 1},
+                    {{{10., 0., 0.}}, 10},
+                } ),
+                weights, DataTransferKit::MaxReducer<double>(), maxima );
+    auto maxima_host = Kokkos::create_mirror_view( maxima );
+    Kokkos::deep_copy( maxima_host, maxima );
+    TEST_COMPARE_FLOATING_ARRAYS( maxima_host,
+                                  std::vector<double>( {10., 7., 10.} ),
+                                  1e-14 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, query_ordering, DeviceType )
+{
+    std::vector<DataTransferKit::Box> boxes;
+    for ( int i = 0; i < 10; ++i )
+        boxes.push_back( {{{(double)i, 0., 0.}}, {{(double)i, 0., 0.}}} );
+    auto const bvh = makeBvh<DeviceType>( boxes );
+    for ( auto &box : boxes )
+        box.minCorner()[1] = box.maxCorner()[1] = 1.;
+    auto const other_bvh = makeBvh<DeviceType>( boxes );
+
+    auto const spatial_queries = makeOverlapQueries<DeviceType>( {
+        {{{7.5, -1., -1.}}, {{9.5, 2., 1.}}},
+        {},
+        {{{0., -1., -1.}}, {{2., 0.5, 1.}}},
+    } );
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{8., 0., 0.}}, 3},
+        {{{0.2, 1., 0.}}, 1},
+        {{{4.6, 0.5, 0.}}, 2},
+    } );
+
+    // the same ordering can be reused for both trees and yields the same
+    // results as letting query() sort the queries itself
+    using NearestQuery = DataTransferKit::Nearest<DataTransferKit::Point>;
+    DataTransferKit::QueryOrdering<DeviceType, DataTransferKit::Overlap>
+        spatial_ordering( spatial_queries, bvh.bounds() );
+    DataTransferKit::QueryOrdering<DeviceType, NearestQuery> nearest_ordering(
+        nearest_queries, bvh.bounds() );
+
+    // the queries may also be made on demand, here from the points and the
+    // numbers of neighbors of the ones above
+    DataTransferKit::QueryOrdering<DeviceType, NearestQuery>
+        generated_ordering(
+            KOKKOS_LAMBDA( int i ) {
+                return DataTransferKit::nearest(
+                    nearest_queries( i )._geometry, nearest_queries( i )._k );
+            },
+            nearest_queries.extent( 0 ), bvh.bounds() );
+
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    for ( auto const &tree : {bvh, other_bvh} )
+    {
+        ViewType indices_ref( "indices_ref" );
+        ViewType offset_ref( "offset_ref" );
+        ViewType indices( "indices" );
+        ViewType offset( "offset" );
+
+        tree.query( spatial_queries, indices_ref, offset_ref );
+        tree.query( spatial_ordering, indices, offset );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+
+        Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+        Kokkos::View<double *, DeviceType> distances( "distances" );
+        tree.query( nearest_queries, indices_ref, offset_ref, distances_ref );
+        tree.query( nearest_ordering, indices, offset, distances );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+        TEST_COMPARE_ARRAYS( distances, distances_ref );
+        tree.query( generated_ordering, indices, offset, distances );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+        TEST_COMPARE_ARRAYS( distances, distances_ref );
+
+        // same results on an explicit instance of the execution space
+        using ExecutionSpace = typename DeviceType::execution_space;
+        ExecutionSpace const space;
+        tree.query( space, nearest_ordering, indices, offset, distances );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+        TEST_COMPARE_ARRAYS( distances, distances_ref );
+        tree.query( space, spatial_queries, indices_ref, offset_ref );
+        tree.query( space, spatial_ordering, indices, offset,
+                    DataTransferKit::AdaptiveBuffer() );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+    }
+}
+
+template <int K, typename DeviceType>
+void checkSameAsNearestK( DataTransferKit::BVH<DeviceType> const &bvh,
+                          std::vector<DataTransferKit::Point> const &points,
+                          bool &success, Teuchos::FancyOStream &out )
+{
+    int const n = points.size();
+    using FixedQuery = DataTransferKit::NearestK<DataTransferKit::Point, K>;
+    Kokkos::View<FixedQuery *, DeviceType> queries( "queries", n );
+    auto queries_host = Kokkos::create_mirror_view( queries );
+    std::vector<std::pair<DataTransferKit::Point, int>> nearest_points;
+    for ( int i = 0; i < n; ++i )
+    {
+        queries_host( i ) = DataTransferKit::nearestK<K>( points[i] );
+        nearest_points.emplace_back( points[i], K );
+    }
+    Kokkos::deep_copy( queries, queries_host );
+
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    ViewType indices_ref( "indices_ref" );
+    ViewType offset_ref( "offset_ref" );
+    ViewType indices( "indices" );
+    ViewType offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.query( makeNearestQueries<DeviceType>( nearest_points ), indices_ref,
+               offset_ref, distances_ref );
+    bvh.query( queries, indices, offset, distances );
+    TEST_COMPARE_ARRAYS( indices, indices_ref );
+    TEST_COMPARE_ARRAYS( offset, offset_ref );
+    TEST_COMPARE_ARRAYS( distances, distances_ref );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, fixed_number_of_neighbors,
+                                   DeviceType )
+{
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    auto random_point = [&distribution, &generator]() {
+        return DataTransferKit::Point{{distribution( generator ),
+                                       distribution( generator ),
+                                       distribution( generator )}};
+    };
+    std::vector<DataTransferKit::Box> boxes;
+    for ( int i = 0; i < 200; ++i )
+    {
+        auto const p = random_point();
+        boxes.push_back( {p, p} );
+    }
+    std::vector<DataTransferKit::Point> points;
+    for ( int i = 0; i < 100; ++i )
+        points.push_back( random_point() );
+
+    // same results as Nearest with the same number of neighbors
+    auto const bvh = makeBvh<DeviceType>( boxes );
+    checkSameAsNearestK<1>( bvh, points, success, out );
+    checkSameAsNearestK<4>( bvh, points, success, out );
+    checkSameAsNearestK<10>( bvh, points, success, out );
+
+    // the nearest neighbor alone is the closest object by brute force
+    std::vector<std::pair<DataTransferKit::Point, int>> nearest_points;
+    std::vector<double> nearest_distances;
+    for ( auto const &p : points )
+    {
+        nearest_points.emplace_back( p, 1 );
+        double d = DataTransferKit::Details::distance( p, boxes[0] );
+        for ( auto const &box : boxes )
+            d = std::min( d, DataTransferKit::Details::distance( p, box ) );
+        nearest_distances.push_back( d );
+    }
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.query( makeNearestQueries<DeviceType>( nearest_points ), indices,
+               offset, distances );
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    TEST_COMPARE_FLOATING_ARRAYS( distances_host, nearest_distances, 1e-14 );
+
+    // more neighbors than there are objects, down to a single leaf
+    boxes.resize( 3 );
+    checkSameAsNearestK<4>( makeBvh<DeviceType>( boxes ), points, success,
+                            out );
+    boxes.resize( 1 );
+    checkSameAsNearestK<4>( makeBvh<DeviceType>( boxes ), points, success,
+                            out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, self_queries, DeviceType )
+{
+    std::vector<DataTransferKit::Box> boxes;
+    std::vector<std::pair<DataTransferKit::Point, int>> nearest_points;
+    std::vector<std::pair<DataTransferKit::Point, double>> within_points;
+    for ( int i = 0; i < 4; ++i )
+        for ( int j = 0; j < 4; ++j )
+            for ( int k = 0; k < 3; ++k )
+            {
+                DataTransferKit::Point p = {{(double)i, 2. * j, 0.5 * k}};
+                boxes.push_back( {p, p} );
+                nearest_points.emplace_back( p, 5 );
+                within_points.emplace_back( p, 1.1 );
+            }
+    auto const bvh = makeBvh<DeviceType>( boxes );
+
+    // same results as one query per object, in the order of the objects
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    ViewType indices_ref( "indices_ref" );
+    ViewType offset_ref( "offset_ref" );
+    ViewType indices( "indices" );
+    ViewType offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.query( makeNearestQueries<DeviceType>( nearest_points ), indices_ref,
+               offset_ref, distances_ref );
+    bvh.querySelfNearest( 5, indices, offset, distances );
+    TEST_COMPARE_ARRAYS( indices, indices_ref );
+    TEST_COMPARE_ARRAYS( offset, offset_ref );
+    TEST_COMPARE_ARRAYS( distances, distances_ref );
+
+    bvh.query( makeWithinQueries<DeviceType>( within_points ), indices_ref,
+               offset_ref );
+    bvh.querySelfWithin( 1.1, indices, offset );
+    TEST_COMPARE_ARRAYS( indices, indices_ref );
+    TEST_COMPARE_ARRAYS( offset, offset_ref );
+
+    // every object finds itself, even with a radius of zero
+    bvh.querySelfWithin( 0., indices, offset );
+    std::vector<int> all( boxes.size() );
+    std::iota( all.begin(), all.end(), 0 );
+    std::vector<int> all_offset( boxes.size() + 1 );
+    std::iota( all_offset.begin(), all_offset.end(), 0 );
+    TEST_COMPARE_ARRAYS( indices, all );
+    TEST_COMPARE_ARRAYS( offset, all_offset );
+
+    // nothing to search for in an empty tree
+    DataTransferKit::BVH<DeviceType> const empty_bvh;
+    empty_bvh.querySelfNearest( 1, indices, offset, distances );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    TEST_EQUALITY( offset.extent( 0 ), 1 );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, predicate_modifiers,
+                                   DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+    } );
+
+    auto const queries = makeOverlapQueries<DeviceType>( {
+        {{{0., 0., 0.}}, {{3., 3., 3.}}},
+        {},
+        {{{1.5, 0., 0.}}, {{3.5, 0., 0.}}},
+    } );
+    int const n_queries = queries.extent( 0 );
+
+    using DataTransferKit::Overlap;
+    using FirstHit = DataTransferKit::FirstHit<Overlap>;
+    using CountOnly = DataTransferKit::CountOnly<Overlap>;
+    using AnyHit = DataTransferKit::CountOnly<FirstHit>;
+    Kokkos::View<FirstHit *, DeviceType> first_hit( "first_hit", n_queries );
+    Kokkos::View<CountOnly *, DeviceType> count_only( "count_only", n_queries );
+    Kokkos::View<AnyHit *, DeviceType> any_hit( "any_hit", n_queries );
+    Kokkos::parallel_for(
+        Kokkos::RangePolicy<typename DeviceType::execution_space>( 0,
+                                                                   n_queries ),
+        KOKKOS_LAMBDA( int i ) {
+            first_hit( i ) = DataTransferKit::firstHit( queries( i ) );
+            count_only( i ) = DataTransferKit::countOnly( queries( i ) );
+            any_hit( i ) = DataTransferKit::anyHit( queries( i ) );
+        } );
+    Kokkos::fence();
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+
+    // which object is found first is unspecified
+    bvh.query( first_hit, indices, offset );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    TEST_COMPARE_ARRAYS( offset_host, std::vector<int>( {0, 1, 1, 2} ) );
+    TEST_COMPARE( indices_host( 0 ), >=, 0 );
+    TEST_COMPARE( indices_host( 0 ), <, 4 );
+    TEST_COMPARE( indices_host( 1 ), >=, 2 );
+    TEST_COMPARE( indices_host( 1 ), <, 4 );
+
+    bvh.query( count_only, indices, offset );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    TEST_COMPARE_ARRAYS( offset_host, std::vector<int>( {0, 4, 4, 6} ) );
+
+    // the buffer size is ignored
+    bvh.query( any_hit, indices, offset, 2 );
+    TEST_EQUALITY( indices.extent( 0 ), 0 );
+    offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    TEST_COMPARE_ARRAYS( offset_host, std::vector<int>( {0, 1, 1, 2} ) );
 }
 
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, not_exceeding_stack_capacity,
@@ -332,6 +1227,60 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, not_exceeding_stack_capacity,
     TEST_EQUALITY( DataTransferKit::lastElement( offset ), n );
 }
 
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, deeper_than_stack_capacity,
+                                   DeviceType )
+{
+    // Points that differ from the origin by a single bit of their 64-bit
+    // Morton code, i.e. one level of the tree per bit, and a cluster of
+    // copies of the origin at the bottom.  The tree is deeper than the stack
+    // of the nearest query which is 64.
+    std::vector<DataTransferKit::Box> boxes;
+    int const n_copies = 1024;
+    for ( int i = 0; i < n_copies; ++i )
+        boxes.push_back( {{{0., 0., 0.}}, {{0., 0., 0.}}} );
+    for ( int level = 0; level < 21; ++level )
+        for ( int d = 0; d < 3; ++d )
+        {
+            DataTransferKit::Point p = {{0., 0., 0.}};
+            p[d] = std::ldexp( 1., -( level + 1 ) );
+            boxes.push_back( {p, p} );
+        }
+    boxes.push_back( {{{1., 1., 1.}}, {{1., 1., 1.}}} );
+    int const n = boxes.size();
+    Kokkos::View<DataTransferKit::Box *, DeviceType> bounding_boxes( "boxes",
+                                                                     n );
+    auto bounding_boxes_host = Kokkos::create_mirror_view( bounding_boxes );
+    for ( int i = 0; i < n; ++i )
+        bounding_boxes_host( i ) = boxes[i];
+    Kokkos::deep_copy( bounding_boxes, bounding_boxes_host );
+    DataTransferKit::BVH<DeviceType> const bvh(
+        bounding_boxes, DataTransferKit::MortonCode64Tag{} );
+
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.query( makeNearestQueries<DeviceType>( {
+                   {{{0., 0., 0.}}, n},
+               } ),
+               indices, offset, distances );
+    TEST_EQUALITY( DataTransferKit::lastElement( offset ), n );
+
+    // Every object is found once and they come sorted by distance.
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto distances_host = Kokkos::create_mirror_view( distances );
+    Kokkos::deep_copy( distances_host, distances );
+    std::vector<int> found( indices_host.data(), indices_host.data() + n );
+    std::sort( found.begin(), found.end() );
+    std::vector<int> all( n );
+    std::iota( all.begin(), all.end(), 0 );
+    TEST_COMPARE_ARRAYS( found, all );
+    TEST_ASSERT( std::is_sorted( distances_host.data(),
+                                 distances_host.data() + n ) );
+    TEST_EQUALITY( distances_host( n_copies - 1 ), 0. );
+    TEST_EQUALITY( distances_host( n - 1 ), std::sqrt( 3. ) );
+}
+
 TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, miscellaneous, DeviceType )
 {
     auto const bvh = makeBvh<DeviceType>( {
@@ -769,6 +1718,383 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, rtree, DeviceType )
     rtree_results = BoostRTreeHelpers::performQueries( rtree, within_queries );
 
     validateResults( rtree_results, bvh_results, success, out );
+
+    // same with a hierarchy refined by treelet restructuring
+    DataTransferKit::BVH<DeviceType> restructured_bvh(
+        bounding_boxes, DataTransferKit::MortonCode32Tag{}, 2 );
+
+    restructured_bvh.query( within_queries, indices_within, offset_within );
+    bvh_results = std::make_tuple( offset_within, indices_within );
+
+    validateResults( rtree_results, bvh_results, success, out );
+
+    rtree_results = BoostRTreeHelpers::performQueries( rtree, nearest_queries );
+
+    restructured_bvh.query( nearest_queries, indices_nearest, offset_nearest );
+    bvh_results = std::make_tuple( offset_nearest, indices_nearest );
+
+    validateResults( rtree_results, bvh_results, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, spatial_join, DeviceType )
+{
+    double const Lx = 10.;
+    double const Ly = 10.;
+    double const Lz = 10.;
+    auto const cloud = make_stuctured_cloud( Lx, Ly, Lz, 11, 11, 11 );
+    std::vector<DataTransferKit::Box> source_boxes;
+    for ( auto const &point : cloud )
+    {
+        double const x = std::get<0>( point );
+        double const y = std::get<1>( point );
+        double const z = std::get<2>( point );
+        source_boxes.push_back( {{{x, y, z}}, {{x, y, z}}} );
+    }
+    auto const bvh = makeBvh<DeviceType>( source_boxes );
+
+    // enough boxes for the other tree to be split into several subtrees
+    std::vector<DataTransferKit::Box> other_boxes;
+    for ( auto const &point : make_random_cloud( Lx, Ly, Lz, 300 ) )
+    {
+        double const x = std::get<0>( point );
+        double const y = std::get<1>( point );
+        double const z = std::get<2>( point );
+        other_boxes.push_back( {{{x - .8, y - .8, z - .8}},
+                                {{x + .8, y + .8, z + .8}}} );
+    }
+
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    for ( auto const &boxes :
+          {other_boxes, std::vector<DataTransferKit::Box>( 1, other_boxes[0] ),
+           std::vector<DataTransferKit::Box>()} )
+    {
+        auto const other = makeBvh<DeviceType>( boxes );
+
+        ViewType indices_ref( "indices_ref" );
+        ViewType offset_ref( "offset_ref" );
+        bvh.query( makeOverlapQueries<DeviceType>( boxes ), indices_ref,
+                   offset_ref );
+
+        ViewType indices( "indices" );
+        ViewType offset( "offset" );
+        bvh.join( other, indices, offset );
+
+        auto indices_ref_host = Kokkos::create_mirror_view( indices_ref );
+        Kokkos::deep_copy( indices_ref_host, indices_ref );
+        auto offset_ref_host = Kokkos::create_mirror_view( offset_ref );
+        Kokkos::deep_copy( offset_ref_host, offset_ref );
+        auto indices_host = Kokkos::create_mirror_view( indices );
+        Kokkos::deep_copy( indices_host, indices );
+        auto offset_host = Kokkos::create_mirror_view( offset );
+        Kokkos::deep_copy( offset_host, offset );
+        validateResults( std::make_tuple( offset_ref_host, indices_ref_host ),
+                         std::make_tuple( offset_host, indices_host ),
+                         success, out );
+    }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, point_and_sphere_leaves,
+                                   DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+    using DataTransferKit::Sphere;
+
+    int const n = 50;
+    Kokkos::View<Point *, DeviceType> points( "points", n );
+    Kokkos::View<Sphere *, DeviceType> spheres( "spheres", n );
+    Kokkos::View<double **, DeviceType> coordinates( "coordinates", n, 3 );
+    auto points_host = Kokkos::create_mirror_view( points );
+    auto spheres_host = Kokkos::create_mirror_view( spheres );
+    auto coordinates_host = Kokkos::create_mirror_view( coordinates );
+    std::vector<Box> point_boxes( n );
+    std::vector<Box> sphere_boxes( n );
+    for ( int i = 0; i < n; ++i )
+    {
+        double const x = i % 5;
+        double const y = ( i / 5 ) % 5;
+        double const z = i / 25;
+        double const r = .1 * ( i % 3 );
+        points_host( i ) = {{x, y, z}};
+        spheres_host( i ) = {points_host( i ), r};
+        for ( int d = 0; d < 3; ++d )
+            coordinates_host( i, d ) = points_host( i )[d];
+        point_boxes[i] = {{{x, y, z}}, {{x, y, z}}};
+        sphere_boxes[i] = {{{x - r, y - r, z - r}}, {{x + r, y + r, z + r}}};
+    }
+    Kokkos::deep_copy( points, points_host );
+    Kokkos::deep_copy( spheres, spheres_host );
+    Kokkos::deep_copy( coordinates, coordinates_host );
+    Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType> const
+        strided_coordinates( coordinates );
+
+    // the objects are enclosed in the same boxes as if the caller had
+    // computed them
+    auto const overlap_queries = makeOverlapQueries<DeviceType>( {
+        {{{-1., -1., -1.}}, {{1.5, 1.5, .5}}},
+        {{{1.95, 1.95, .05}}, {{3.05, 3.05, .95}}},
+        {{{10., 10., 10.}}, {{11., 11., 11.}}},
+    } );
+    auto const nearest_queries = makeNearestQueries<DeviceType>( {
+        {{{.2, .3, .4}}, 4},
+        {{{2.5, 2.5, 1.5}}, 10},
+    } );
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    for ( auto const &trees :
+          {std::make_pair( DataTransferKit::BVH<DeviceType>( points ),
+                           makeBvh<DeviceType>( point_boxes ) ),
+           std::make_pair( DataTransferKit::BVH<DeviceType>( spheres ),
+                           makeBvh<DeviceType>( sphere_boxes ) ),
+           std::make_pair(
+               DataTransferKit::BVH<DeviceType>( strided_coordinates ),
+               makeBvh<DeviceType>( point_boxes ) )} )
+    {
+        auto const &bvh = trees.first;
+        auto const &bvh_ref = trees.second;
+        TEST_EQUALITY( bvh.size(), n );
+        TEST_ASSERT( DataTransferKit::Details::equals( bvh.bounds(),
+                                                       bvh_ref.bounds() ) );
+
+        ViewType indices_ref( "indices_ref" );
+        ViewType offset_ref( "offset_ref" );
+        ViewType indices( "indices" );
+        ViewType offset( "offset" );
+
+        bvh_ref.query( overlap_queries, indices_ref, offset_ref );
+        bvh.query( overlap_queries, indices, offset );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+
+        Kokkos::View<double *, DeviceType> distances_ref( "distances_ref" );
+        Kokkos::View<double *, DeviceType> distances( "distances" );
+        bvh_ref.query( nearest_queries, indices_ref, offset_ref,
+                       distances_ref );
+        bvh.query( nearest_queries, indices, offset, distances );
+        TEST_COMPARE_ARRAYS( indices, indices_ref );
+        TEST_COMPARE_ARRAYS( offset, offset_ref );
+        TEST_COMPARE_ARRAYS( distances, distances_ref );
+    }
+
+    // points in lower dimension lie in the plane z = 0
+    Kokkos::View<double const **, Kokkos::LayoutStride, DeviceType> const
+        planar_coordinates = Kokkos::subview(
+            strided_coordinates, Kokkos::ALL, Kokkos::make_pair( 0, 2 ) );
+    DataTransferKit::BVH<DeviceType> const planar_bvh( planar_coordinates );
+    TEST_EQUALITY( planar_bvh.size(), n );
+    TEST_ASSERT( DataTransferKit::Details::equals(
+        planar_bvh.bounds(), {{{0., 0., 0.}}, {{4., 4., 0.}}} ) );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, nearest_within_maximum_distance,
+                                   DeviceType )
+{
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+        {{{1., 0., 0.}}, {{1., 0., 0.}}},
+        {{{2., 0., 0.}}, {{2., 0., 0.}}},
+        {{{3., 0., 0.}}, {{3., 0., 0.}}},
+        {{{4., 0., 0.}}, {{4., 0., 0.}}},
+    } );
+
+    // fewer than k neighbors within the distance, none at all, or k of them
+    checkResults( bvh,
+                  makeLimitedNearestQueries<DeviceType>( {
+                      std::make_tuple( DataTransferKit::Point{{0., 0., 0.}},
+                                       3, 1.5 ),
+                      std::make_tuple( DataTransferKit::Point{{10., 0., 0.}},
+                                       2, 1. ),
+                      std::make_tuple( DataTransferKit::Point{{2.2, 0., 0.}},
+                                       4, 10. ),
+                  } ),
+                  {0, 1, 2, 3, 1, 4}, {0, 2, 2, 6}, {0., 1., .2, .8, 1.2, 1.8},
+                  success, out );
+
+    // neighbors exactly at the maximum distance are discarded
+    checkResults( bvh,
+                  makeLimitedNearestQueries<DeviceType>( {
+                      std::make_tuple( DataTransferKit::Point{{0., 0., 0.}},
+                                       3, 1. ),
+                  } ),
+                  {0}, {0, 1}, {0.}, success, out );
+
+    // same with a single leaf
+    auto const leaf = makeBvh<DeviceType>( {
+        {{{0., 0., 0.}}, {{0., 0., 0.}}},
+    } );
+    checkResults( leaf,
+                  makeLimitedNearestQueries<DeviceType>( {
+                      std::make_tuple( DataTransferKit::Point{{1., 0., 0.}},
+                                       1, .5 ),
+                      std::make_tuple( DataTransferKit::Point{{1., 0., 0.}},
+                                       1, 2. ),
+                  } ),
+                  {0}, {0, 0, 1}, {1.}, success, out );
+}
+
+template <typename DeviceType, typename Query>
+Kokkos::View<Query *, DeviceType> makeQueries( std::vector<Query> const &q )
+{
+    int const n = q.size();
+    Kokkos::View<Query *, DeviceType> queries( "queries", n );
+    auto queries_host = Kokkos::create_mirror_view( queries );
+    for ( int i = 0; i < n; ++i )
+        queries_host( i ) = q[i];
+    Kokkos::deep_copy( queries, queries_host );
+    return queries;
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, ray_and_segment, DeviceType )
+{
+    using DataTransferKit::Ray;
+    using DataTransferKit::Segment;
+
+    // a row of unit cubes along the x-axis, numbered out of order
+    std::vector<int> const position = {3, 0, 4, 1, 2};
+    std::vector<DataTransferKit::Box> boxes;
+    for ( int x : position )
+        boxes.push_back( {{{1. * x, 0., 0.}}, {{x + 1., 1., 1.}}} );
+    auto const bvh = makeBvh<DeviceType>( boxes );
+
+    // the cubes are reported in the order in which the rays cross them
+    std::vector<Ray> const rays = {
+        Ray( {{-1., 0.5, 0.5}}, {{1., 0., 0.}} ),
+        Ray( {{10., 0.5, 0.5}}, {{-2., 0., 0.}} ),
+        Ray( {{-1., 2., 0.5}}, {{1., 0., 0.}} ),
+    };
+    std::vector<DataTransferKit::RayIntersects> ray_queries;
+    std::vector<DataTransferKit::FirstHit<DataTransferKit::RayIntersects>>
+        closest_ray_queries;
+    for ( auto const &ray : rays )
+    {
+        ray_queries.push_back( DataTransferKit::intersects( ray ) );
+        closest_ray_queries.push_back(
+            DataTransferKit::firstHit( DataTransferKit::intersects( ray ) ) );
+    }
+
+    using ViewType = Kokkos::View<int *, DeviceType>;
+    ViewType indices( "indices" );
+    ViewType offset( "offset" );
+    bvh.query( makeQueries<DeviceType>( ray_queries ), indices, offset );
+    TEST_COMPARE_ARRAYS( indices,
+                         std::vector<int>( {1, 3, 4, 0, 2, 2, 0, 4, 3, 1} ) );
+    TEST_COMPARE_ARRAYS( offset, std::vector<int>( {0, 5, 10, 10} ) );
+
+    // the same order with the buffer optimization
+    bvh.query( makeQueries<DeviceType>( ray_queries ), indices, offset, 2 );
+    TEST_COMPARE_ARRAYS( indices,
+                         std::vector<int>( {1, 3, 4, 0, 2, 2, 0, 4, 3, 1} ) );
+    TEST_COMPARE_ARRAYS( offset, std::vector<int>( {0, 5, 10, 10} ) );
+
+    // only the closest cube
+    bvh.query( makeQueries<DeviceType>( closest_ray_queries ), indices,
+               offset );
+    TEST_COMPARE_ARRAYS( indices, std::vector<int>( {1, 2} ) );
+    TEST_COMPARE_ARRAYS( offset, std::vector<int>( {0, 1, 2, 2} ) );
+
+    // segments end inside of the row, or start in a cube
+    std::vector<DataTransferKit::SegmentIntersects> const segment_queries = {
+        DataTransferKit::intersects(
+            Segment( {{1.5, 0.5, 0.5}}, {{3.5, 0.5, 0.5}} ) ),
+        DataTransferKit::intersects(
+            Segment( {{4.5, 0.5, 0.5}}, {{2.5, 0.5, 0.5}} ) ),
+        DataTransferKit::intersects(
+            Segment( {{-2., 0.5, 0.5}}, {{-1., 0.5, 0.5}} ) ),
+    };
+    bvh.query( makeQueries<DeviceType>( segment_queries ), indices, offset );
+    TEST_COMPARE_ARRAYS( indices, std::vector<int>( {3, 4, 0, 2, 0, 4} ) );
+    TEST_COMPARE_ARRAYS( offset, std::vector<int>( {0, 3, 6, 6} ) );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, nearest_primitive, DeviceType )
+{
+    using DataTransferKit::Point;
+    using DataTransferKit::Triangle;
+
+    // the unit square split in two triangles and a copy of the first one
+    // above it
+    auto const triangles = makeQueries<DeviceType>( std::vector<Triangle>{
+        Triangle( {{0., 0., 0.}}, {{1., 0., 0.}}, {{0., 1., 0.}} ),
+        Triangle( {{1., 0., 0.}}, {{1., 1., 0.}}, {{0., 1., 0.}} ),
+        Triangle( {{0., 0., 5.}}, {{1., 0., 5.}}, {{0., 1., 5.}} ),
+    } );
+    // the bounding boxes of the first two triangles are the same, only the
+    // exact distance tells them apart
+    auto const points = makeQueries<DeviceType>( std::vector<Point>{
+        {{.75, .75, 1.}}, {{.2, .2, 4.5}}, {{.1, .2, -1.}}} );
+
+    DataTransferKit::BVH<DeviceType> const bvh(
+        DataTransferKit::Details::computeBoundingBoxes<DeviceType>(
+            triangles ) );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<double *, DeviceType> distances( "distances" );
+    bvh.queryNearestPrimitive(
+        points, DataTransferKit::TriangleDistance<DeviceType>{triangles},
+        indices, distances );
+    TEST_COMPARE_ARRAYS( indices, std::vector<int>( {1, 2, 0} ) );
+    auto distances_host =
+        Kokkos::create_mirror_view_and_copy( Kokkos::HostSpace(), distances );
+    TEST_COMPARE_FLOATING_ARRAYS( distances_host,
+                                  std::vector<double>( {1., .5, 1.} ), 1e-14 );
+
+    DataTransferKit::SurfaceProjection<DeviceType> const surface( triangles );
+    Kokkos::View<Point *, DeviceType> projections( "projections" );
+    Kokkos::View<double * [3], DeviceType> barycentric_coordinates(
+        "barycentric_coordinates" );
+    surface.project( points, indices, projections, barycentric_coordinates );
+    TEST_COMPARE_ARRAYS( indices, std::vector<int>( {1, 2, 0} ) );
+    auto projections_host = Kokkos::create_mirror_view_and_copy(
+        Kokkos::HostSpace(), projections );
+    auto barycentric_coordinates_host = Kokkos::create_mirror_view_and_copy(
+        Kokkos::HostSpace(), barycentric_coordinates );
+    std::vector<Point> const projections_ref = {
+        {{.75, .75, 0.}}, {{.2, .2, 5.}}, {{.1, .2, 0.}}};
+    std::vector<std::vector<double>> const barycentric_coordinates_ref = {
+        {.25, .5, .25}, {.6, .2, .2}, {.7, .1, .2}};
+    for ( int i = 0; i < 3; ++i )
+        for ( int d = 0; d < 3; ++d )
+        {
+            TEST_COMPARE(
+                std::abs( projections_host( i )[d] - projections_ref[i][d] ),
+                <, 1e-14 );
+            TEST_COMPARE( std::abs( barycentric_coordinates_host( i, d ) -
+                                    barycentric_coordinates_ref[i][d] ),
+                          <, 1e-14 );
+        }
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, periodic, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+    using DataTransferKit::periodic;
+
+    auto const bvh = makeBvh<DeviceType>( {
+        {{{.05, 0., 0.}}, {{.05, 0., 0.}}},
+        {{{.5, 0., 0.}}, {{.5, 0., 0.}}},
+        {{{.9, 0., 0.}}, {{.9, 0., 0.}}},
+    } );
+    // the domain is periodic along x with period 1 and the objects are not
+    // replicated near its boundaries
+    Point const period = {{1., 0., 0.}};
+
+    using Nearest = DataTransferKit::Nearest<DataTransferKit::Periodic<Point>>;
+    checkResults( bvh,
+                  makeQueries<DeviceType, Nearest>( {DataTransferKit::nearest(
+                      periodic( Point{{.99, 0., 0.}}, period ), 2 )} ),
+                  {0, 2}, {0, 2}, {.06, .09}, success, out );
+
+    checkResults( bvh,
+                  makeQueries<DeviceType, DataTransferKit::PeriodicWithin>(
+                      {DataTransferKit::within( {{.99, 0., 0.}}, .07, period ),
+                       DataTransferKit::within( {{.99, 0., 0.}}, .07,
+                                                {{0., 0., 0.}} )} ),
+                  {0}, {0, 1, 1}, success, out );
+
+    checkResults( bvh,
+                  makeQueries<DeviceType, DataTransferKit::PeriodicOverlap>(
+                      {DataTransferKit::overlap(
+                          {{{.95, -1., -1.}}, {{1.06, 1., 1.}}}, period )} ),
+                  {0}, {0, 1}, success, out );
 }
 
 // Include the test macros.
@@ -785,15 +2111,56 @@ TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( LinearBVH, rtree, DeviceType )
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, duplicated_leaves,        \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, morton_codes_64,          \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, hilbert_codes,            \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, refit, DeviceType##NODE ) \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, statistics,               \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, forest,                   \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, single_precision,         \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, buffer_optimization,      \
                                           DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, int64_offsets,            \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, callback,                 \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, query_workspace,          \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, reduce,                   \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, query_ordering,           \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        LinearBVH, fixed_number_of_neighbors, DeviceType##NODE )               \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, self_queries,             \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, predicate_modifiers,      \
+                                          DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
         LinearBVH, not_exceeding_stack_capacity, DeviceType##NODE )            \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        LinearBVH, deeper_than_stack_capacity, DeviceType##NODE )              \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, miscellaneous,            \
                                           DeviceType##NODE )                   \
     TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, structured_grid,          \
                                           DeviceType##NODE )                   \
-    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, rtree, DeviceType##NODE )
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, rtree, DeviceType##NODE ) \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, spatial_join,             \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, point_and_sphere_leaves,  \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, ray_and_segment,          \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, nearest_primitive,        \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT(                                      \
+        LinearBVH, nearest_within_maximum_distance, DeviceType##NODE )         \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( LinearBVH, periodic,                 \
+                                          DeviceType##NODE )
 
 // Demangle the types
 DTK_ETI_MANGLING_TYPEDEFS()
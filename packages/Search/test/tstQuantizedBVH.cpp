@@ -0,0 +1,77 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_LinearBVH.hpp>
+#include <DTK_QuantizedBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <cstdint>
+#include <random>
+
+#include "Search_UnitTestHelpers.hpp"
+
+template <typename DeviceType, typename QuantizedType>
+void checkQuantizedSameAsBVH( bool &success, Teuchos::FancyOStream &out )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+    using Tree = DataTransferKit::QuantizedBVH<DeviceType, QuantizedType>;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    // many objects, a few of them, and a single one
+    for ( int n : {500, 5, 1} )
+    {
+        Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+        auto boxes_host = Kokkos::create_mirror_view( boxes );
+        for ( int i = 0; i < n; ++i )
+        {
+            Point p = {{distribution( generator ), distribution( generator ),
+                        distribution( generator )}};
+            // some of the boxes are flat or reduced to a point
+            double const h = 0.1 * ( i % 3 );
+            boxes_host( i ) = {p, {{p[0] + h, p[1] + 0.1, p[2] + h}}};
+        }
+        Kokkos::deep_copy( boxes, boxes_host );
+        DataTransferKit::BVH<DeviceType> const bvh( boxes );
+
+        Tree const tree( bvh );
+        checkSameAsBVH( tree, bvh, success, out );
+    }
+
+    // nothing in the tree
+    DataTransferKit::BVH<DeviceType> const empty_bvh;
+    Tree const empty_tree( empty_bvh );
+    TEST_ASSERT( empty_tree.empty() );
+    checkSameAsBVH( empty_tree, empty_bvh, success, out );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( QuantizedBVH, same_as_bvh, DeviceType )
+{
+    checkQuantizedSameAsBVH<DeviceType, std::uint8_t>( success, out );
+    checkQuantizedSameAsBVH<DeviceType, std::uint16_t>( success, out );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( QuantizedBVH, same_as_bvh,           \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
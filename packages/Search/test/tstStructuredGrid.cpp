@@ -0,0 +1,208 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_LinearBVH.hpp>
+#include <DTK_StructuredGrid.hpp>
+
+#include <Teuchos_DefaultComm.hpp>
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( StructuredGrid, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    // Uniform spacing along the first two axes, except for edges that are
+    // slightly off because of rounding, and stretched cells along the last.
+    std::vector<double> edges[3];
+    for ( int i = 0; i <= 7; ++i )
+        edges[0].push_back( 0.1 * i );
+    for ( int j = 0; j <= 5; ++j )
+        edges[1].push_back( -1. + 0.3 * j );
+    for ( int k = 0; k <= 6; ++k )
+        edges[2].push_back( 0.05 * k * k );
+
+    // The boxes of the cells are shuffled so that the grid has to recover
+    // their positions.
+    std::vector<Box> cells;
+    for ( int k = 0; k + 1 < (int)edges[2].size(); ++k )
+        for ( int j = 0; j + 1 < (int)edges[1].size(); ++j )
+            for ( int i = 0; i + 1 < (int)edges[0].size(); ++i )
+                cells.push_back(
+                    {{{edges[0][i], edges[1][j], edges[2][k]}},
+                     {{edges[0][i + 1], edges[1][j + 1], edges[2][k + 1]}}} );
+    std::default_random_engine generator;
+    std::shuffle( cells.begin(), cells.end(), generator );
+    int const n = cells.size();
+    Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = cells[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    auto const grid = DataTransferKit::StructuredGrid<DeviceType>::fromBoxes(
+        Kokkos::View<Box const *, DeviceType>( boxes ) );
+    DataTransferKit::BVH<DeviceType> const bvh( boxes );
+    TEST_EQUALITY( grid.size(), bvh.size() );
+    TEST_ASSERT( DataTransferKit::Details::equals( grid.bounds(),
+                                                   bvh.bounds() ) );
+
+    // Queries inside and outside of the grid, on the edges, and degenerate
+    // ones.
+    std::uniform_real_distribution<double> distribution( -1.5, 2. );
+    std::vector<Box> overlap_boxes = {
+        {{{0.1, -0.7, 0.2}}, {{0.1, -0.7, 0.2}}},
+        {{{-5., -5., -5.}}, {{5., 5., 5.}}},
+        {{{3., 3., 3.}}, {{4., 4., 4.}}},
+        {{{0.3, 0.2, 0.45}}, {{0.3, 0.5, 1.25}}},
+    };
+    std::vector<std::pair<Point, double>> within_points = {
+        {{{0.2, -0.4, 0.8}}, 0.}, {{{0.7, 0.5, 1.8}}, 0.25}};
+    for ( int q = 0; q < 200; ++q )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        Point r = {{p[0] + 0.3, p[1] + 0.1, p[2] + 0.5}};
+        overlap_boxes.push_back( {p, r} );
+        within_points.push_back( {p, 0.2} );
+    }
+    checkSameSpatialResults( grid, bvh,
+                             makeOverlapQueries<DeviceType>( overlap_boxes ),
+                             success, out );
+    checkSameSpatialResults( grid, bvh,
+                             makeWithinQueries<DeviceType>( within_points ),
+                             success, out );
+
+    // Boxes that overlap or leave holes are not recognized.
+    cells.back().maxCorner()[0] += 0.05;
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = cells[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+    TEST_ASSERT( DataTransferKit::StructuredGrid<DeviceType>::fromBoxes(
+                     Kokkos::View<Box const *, DeviceType>( boxes ) )
+                     .empty() );
+    Kokkos::View<Box *, DeviceType> fewer_boxes( "boxes", n - 1 );
+    auto fewer_boxes_host = Kokkos::create_mirror_view( fewer_boxes );
+    for ( int i = 0; i < n - 1; ++i )
+        fewer_boxes_host( i ) = cells[i];
+    Kokkos::deep_copy( fewer_boxes, fewer_boxes_host );
+    TEST_ASSERT( DataTransferKit::StructuredGrid<DeviceType>::fromBoxes(
+                     Kokkos::View<Box const *, DeviceType>( fewer_boxes ) )
+                     .empty() );
+}
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( StructuredGrid, distributed_search_tree,
+                                   DeviceType )
+{
+    using DataTransferKit::Box;
+
+    Teuchos::RCP<const Teuchos::Comm<int>> comm =
+        Teuchos::DefaultComm<int>::getComm();
+    int const comm_rank = Teuchos::rank( *comm );
+    int const comm_size = Teuchos::size( *comm );
+
+    // Each process owns a 4x3x2 block of unit cells in a slab.
+    std::vector<Box> cells;
+    for ( int k = 0; k < 2; ++k )
+        for ( int j = 0; j < 3; ++j )
+            for ( int i = 0; i < 4; ++i )
+            {
+                double const x = 4. * comm_rank + i;
+                cells.push_back( {{{x, 1. * j, 1. * k}},
+                                  {{x + 1., j + 1., k + 1.}}} );
+            }
+    int const n = cells.size();
+    Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+    auto boxes_host = Kokkos::create_mirror_view( boxes );
+    for ( int i = 0; i < n; ++i )
+        boxes_host( i ) = cells[i];
+    Kokkos::deep_copy( boxes, boxes_host );
+
+    // One query per cell around its center, straddling the next process.
+    std::vector<Box> query_boxes;
+    for ( int i = 0; i < 4; ++i )
+    {
+        double const x = 4. * comm_rank + i + 0.5;
+        query_boxes.push_back( {{{x, 1.5, 0.5}}, {{x + 1., 1.5, 0.5}}} );
+    }
+    auto queries = makeOverlapQueries<DeviceType>( query_boxes );
+
+    DataTransferKit::DistributedSearchTree<DeviceType> tree( comm, boxes );
+    Kokkos::View<int *, DeviceType> indices_ref( "indices_ref" );
+    Kokkos::View<int *, DeviceType> offset_ref( "offset_ref" );
+    Kokkos::View<int *, DeviceType> ranks_ref( "ranks_ref" );
+    tree.query( queries, indices_ref, offset_ref, ranks_ref );
+
+    auto const grid = DataTransferKit::StructuredGrid<DeviceType>::fromBoxes(
+        Kokkos::View<Box const *, DeviceType>( boxes ) );
+    TEST_EQUALITY( (int)grid.size(), n );
+    tree.setStructuredGrid( grid );
+    Kokkos::View<int *, DeviceType> indices( "indices" );
+    Kokkos::View<int *, DeviceType> offset( "offset" );
+    Kokkos::View<int *, DeviceType> ranks( "ranks" );
+    tree.query( queries, indices, offset, ranks );
+
+    // The results are grouped by query in the same order either way.
+    auto offset_host = Kokkos::create_mirror_view( offset );
+    Kokkos::deep_copy( offset_host, offset );
+    auto offset_ref_host = Kokkos::create_mirror_view( offset_ref );
+    Kokkos::deep_copy( offset_ref_host, offset_ref );
+    TEST_COMPARE_ARRAYS( offset_host, offset_ref_host );
+    auto indices_host = Kokkos::create_mirror_view( indices );
+    Kokkos::deep_copy( indices_host, indices );
+    auto ranks_host = Kokkos::create_mirror_view( ranks );
+    Kokkos::deep_copy( ranks_host, ranks );
+    auto indices_ref_host = Kokkos::create_mirror_view( indices_ref );
+    Kokkos::deep_copy( indices_ref_host, indices_ref );
+    auto ranks_ref_host = Kokkos::create_mirror_view( ranks_ref );
+    Kokkos::deep_copy( ranks_ref_host, ranks_ref );
+    for ( int q = 0; q < (int)query_boxes.size(); ++q )
+    {
+        std::vector<std::pair<int, int>> results;
+        std::vector<std::pair<int, int>> results_ref;
+        for ( int i = offset_host( q ); i < offset_host( q + 1 ); ++i )
+        {
+            results.emplace_back( ranks_host( i ), indices_host( i ) );
+            results_ref.emplace_back( ranks_ref_host( i ),
+                                      indices_ref_host( i ) );
+        }
+        std::sort( results.begin(), results.end() );
+        std::sort( results_ref.begin(), results_ref.end() );
+        TEST_ASSERT( results == results_ref );
+        // Two cells per query except on the last process.
+        bool const last = ( comm_rank == comm_size - 1 && q == 3 );
+        TEST_EQUALITY( (int)results.size(), last ? 1 : 2 );
+    }
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( StructuredGrid, same_as_bvh,         \
+                                          DeviceType##NODE )                   \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( StructuredGrid,                      \
+                                          distributed_search_tree,             \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
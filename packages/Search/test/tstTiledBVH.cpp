@@ -0,0 +1,112 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_LinearBVH.hpp>
+#include <DTK_TiledBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( TiledBVH, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    int const n = 500;
+    Kokkos::View<Box *, Kokkos::HostSpace> boxes_host( "boxes", n );
+    for ( int i = 0; i < n; ++i )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        boxes_host( i ) = {p, {{p[0] + 0.1, p[1] + 0.1, p[2] + 0.1}}};
+    }
+    Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+    Kokkos::deep_copy( boxes, boxes_host );
+    DataTransferKit::BVH<DeviceType> const bvh( boxes );
+
+    std::vector<Box> overlap_boxes;
+    std::vector<std::pair<Point, double>> within_points;
+    std::vector<std::pair<Point, int>> nearest_points;
+    std::vector<std::tuple<Point, int, double>> limited_points;
+    for ( int q = 0; q < 300; ++q )
+    {
+        Point p = {{distribution( generator ), distribution( generator ),
+                    distribution( generator )}};
+        overlap_boxes.push_back( {p, {{p[0] + 1., p[1] + 1., p[2] + 1.}}} );
+        within_points.emplace_back( p, 0.1 * ( q % 11 ) );
+        nearest_points.emplace_back( p, q % 7 );
+        limited_points.emplace_back( p, 5, 0.1 * ( q % 5 ) );
+    }
+    // more neighbors than there are objects
+    nearest_points.emplace_back( Point{{-1., -1., -1.}}, n + 3 );
+
+    // a single tile, tiles of many objects, or of only a few
+    for ( int tile_size : {1000, 128, 64, 7} )
+    {
+        DataTransferKit::TiledBVH<DeviceType> const tree( boxes_host,
+                                                          tile_size );
+        TEST_EQUALITY( tree.size(), bvh.size() );
+        TEST_EQUALITY( tree.numberOfTiles(),
+                       ( n + tile_size - 1 ) / tile_size );
+        TEST_ASSERT(
+            DataTransferKit::Details::equals( tree.bounds(), bvh.bounds() ) );
+
+        checkSameSpatialResults(
+            tree, bvh, makeOverlapQueries<DeviceType>( overlap_boxes ),
+            success, out );
+        checkSameSpatialResults(
+            tree, bvh, makeWithinQueries<DeviceType>( within_points ),
+            success, out );
+        checkSameNearestResults(
+            tree, bvh, makeNearestQueries<DeviceType>( nearest_points ),
+            success, out );
+        checkSameNearestResults(
+            tree, bvh, makeLimitedNearestQueries<DeviceType>( limited_points ),
+            success, out );
+    }
+
+    // nothing in the tree
+    DataTransferKit::TiledBVH<DeviceType> const empty_tree(
+        Kokkos::View<Box *, Kokkos::HostSpace>( "boxes", 0 ), 16 );
+    TEST_ASSERT( empty_tree.empty() );
+    TEST_EQUALITY( empty_tree.numberOfTiles(), 0 );
+    DataTransferKit::BVH<DeviceType> const empty_bvh;
+    checkSameSpatialResults( empty_tree, empty_bvh,
+                             makeOverlapQueries<DeviceType>( overlap_boxes ),
+                             success, out );
+    checkSameNearestResults( empty_tree, empty_bvh,
+                             makeNearestQueries<DeviceType>( nearest_points ),
+                             success, out );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( TiledBVH, same_as_bvh,               \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -0,0 +1,85 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_LinearBVH.hpp>
+#include <DTK_WideBVH.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <random>
+#include <type_traits>
+
+#include "Search_UnitTestHelpers.hpp"
+
+TEUCHOS_UNIT_TEST_TEMPLATE_1_DECL( WideBVH, same_as_bvh, DeviceType )
+{
+    using DataTransferKit::Box;
+    using DataTransferKit::Point;
+
+    std::default_random_engine generator;
+    std::uniform_real_distribution<double> distribution( 0., 10. );
+    // many objects, fewer than fit in one wide node, and a single one
+    for ( int n : {500, 5, 1} )
+    {
+        Kokkos::View<Box *, DeviceType> boxes( "boxes", n );
+        auto boxes_host = Kokkos::create_mirror_view( boxes );
+        for ( int i = 0; i < n; ++i )
+        {
+            Point p = {{distribution( generator ), distribution( generator ),
+                        distribution( generator )}};
+            boxes_host( i ) = {p, {{p[0] + 0.1, p[1] + 0.1, p[2] + 0.1}}};
+        }
+        Kokkos::deep_copy( boxes, boxes_host );
+        DataTransferKit::BVH<DeviceType> const bvh( boxes );
+
+        DataTransferKit::WideBVH<DeviceType> const tree( boxes );
+        checkSameAsBVH( tree, bvh, success, out );
+        if ( n <= 8 )
+            TEST_EQUALITY( tree.numberOfNodes(), 1 );
+
+        DataTransferKit::WideBVH<DeviceType, 4> const narrower_tree( bvh );
+        checkSameAsBVH( narrower_tree, bvh, success, out );
+        TEST_COMPARE( narrower_tree.numberOfNodes(), >=,
+                      tree.numberOfNodes() );
+    }
+
+    // nothing in the tree
+    DataTransferKit::BVH<DeviceType> const empty_bvh;
+    DataTransferKit::WideBVH<DeviceType> const empty_tree( empty_bvh );
+    TEST_ASSERT( empty_tree.empty() );
+    TEST_EQUALITY( empty_tree.numberOfNodes(), 0 );
+    checkSameAsBVH( empty_tree, empty_bvh, success, out );
+
+    // the wide hierarchy is only preferred on the host
+    using WideBVHOnHost = DataTransferKit::WideBVHOnHost<DeviceType>;
+    bool const on_host =
+        std::is_same<typename DeviceType::memory_space,
+                     Kokkos::HostSpace>::value;
+    TEST_EQUALITY(
+        ( std::is_same<WideBVHOnHost,
+                       DataTransferKit::WideBVH<DeviceType>>::value ),
+        on_host );
+}
+
+// Include the test macros.
+#include "DataTransferKitSearch_ETIHelperMacros.h"
+
+// Create the test group
+#define UNIT_TEST_GROUP( NODE )                                                \
+    using DeviceType##NODE = typename NODE::device_type;                       \
+    TEUCHOS_UNIT_TEST_TEMPLATE_1_INSTANT( WideBVH, same_as_bvh,                \
+                                          DeviceType##NODE )
+
+// Demangle the types
+DTK_ETI_MANGLING_TYPEDEFS()
+
+// Instantiate the tests
+DTK_INSTANTIATE_N( UNIT_TEST_GROUP )
@@ -14,8 +14,9 @@
 
 #include <Kokkos_Macros.hpp>
 
-#include <cmath>   // isfinite
-#include <cstdint> // uint32_t
+#include <cmath>   // isfinite, nextafter
+#include <cstdint> // uint32_t, uint64_t
+#include <limits>
 #include <type_traits>
 
 namespace DataTransferKit
@@ -95,6 +96,29 @@ int clz( uint32_t x )
 #endif
 }
 
+/** Count the number of consecutive leading zero bits in 64 bit integer
+ * @param x
+ *
+ * NOTE: This is not an overload of clz() on purpose.  Integer literals (e.g.
+ * clz( 0 )) would be ambiguous otherwise.
+ */
+KOKKOS_INLINE_FUNCTION
+int clz64( uint64_t x )
+{
+#if defined( __CUDA_ARCH__ )
+    return __clzll( static_cast<long long int>( x ) );
+#elif defined( KOKKOS_COMPILER_GNU ) || ( KOKKOS_COMPILER_CLANG >= 500 )
+    return ( x == 0 ) ? 64 : __builtin_clzll( x );
+#else
+    // Split the 64 bit integer into its upper and lower halves and rely on the
+    // 32 bit implementation above.
+    uint32_t const upper = static_cast<uint32_t>( x >> 32 );
+    if ( upper != 0 )
+        return clz( upper );
+    return 32 + clz( static_cast<uint32_t>( x ) );
+#endif
+}
+
 /** Determine whether the given floating point argument @param x has finite
  * value.
  *
@@ -112,6 +136,44 @@ KOKKOS_INLINE_FUNCTION bool isFinite( FloatingPoint x )
 #endif
 }
 
+/** Convert @param x to single precision, rounding toward negative infinity.
+ * The result is never greater than @param x.
+ */
+KOKKOS_INLINE_FUNCTION
+float roundDown( double x )
+{
+#ifdef __CUDA_ARCH__
+    return __double2float_rd( x );
+#else
+    using Limits = std::numeric_limits<float>;
+    if ( x > Limits::max() )
+        return Limits::max();
+    if ( x < -Limits::max() )
+        return -Limits::infinity();
+    float const y = static_cast<float>( x );
+    return ( y > x ) ? std::nextafter( y, -Limits::infinity() ) : y;
+#endif
+}
+
+/** Convert @param x to single precision, rounding toward positive infinity.
+ * The result is never less than @param x.
+ */
+KOKKOS_INLINE_FUNCTION
+float roundUp( double x )
+{
+#ifdef __CUDA_ARCH__
+    return __double2float_ru( x );
+#else
+    using Limits = std::numeric_limits<float>;
+    if ( x > Limits::max() )
+        return Limits::infinity();
+    if ( x < -Limits::max() )
+        return -Limits::max();
+    float const y = static_cast<float>( x );
+    return ( y < x ) ? std::nextafter( y, Limits::infinity() ) : y;
+#endif
+}
+
 } // namespace KokkosHelpers
 } // namespace DataTransferKit
 
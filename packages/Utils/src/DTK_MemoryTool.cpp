@@ -0,0 +1,192 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief Kokkos Tools library reporting the memory high-water mark of each
+ * region.
+ *
+ * The library is loaded by Kokkos at initialization when the environment
+ * variable KOKKOS_PROFILE_LIBRARY points to it.  It follows the allocations
+ * and deallocations of Views in each memory space and the regions pushed by
+ * ScopedTimer, i.e. the phases recorded in the DTK statistics.  For each
+ * nested region, e.g. "apply operator/search/local query", it reports the
+ * high-water mark reached while the region was active, how much the memory
+ * grew above its level when the region was entered, and the allocation that
+ * brought it to the high-water mark.  The report is written when Kokkos is
+ * finalized, to the file $DTK_MEMORY_TOOL_OUTPUT.<rank> if that variable is
+ * set or to the standard error of the first rank otherwise.
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{ // anonymous
+
+// Must match the layout of Kokkos::Profiling::SpaceHandle.
+struct SpaceHandle
+{
+    char name[64];
+};
+
+struct Frame
+{
+    std::string path;
+    std::map<std::string, std::uint64_t> entry;
+    std::map<std::string, std::uint64_t> peak;
+    std::map<std::string, std::pair<std::string, std::uint64_t>> culprit;
+};
+
+struct Summary
+{
+    int calls = 0;
+    std::uint64_t peak = 0;
+    std::uint64_t growth = 0;
+    std::pair<std::string, std::uint64_t> culprit;
+};
+
+std::mutex mutex;
+std::map<std::string, std::uint64_t> current;
+std::map<std::string, std::uint64_t> overall_peak;
+std::vector<Frame> regions;
+// Keyed by region and memory space.
+std::map<std::pair<std::string, std::string>, Summary> summaries;
+
+// Rank set by the usual MPI launchers, if any.
+int getRank()
+{
+    for ( char const *variable : {"OMPI_COMM_WORLD_RANK", "PMI_RANK",
+                                  "PMIX_RANK", "MV2_COMM_WORLD_RANK",
+                                  "SLURM_PROCID"} )
+        if ( char const *value = std::getenv( variable ) )
+            return std::atoi( value );
+    return 0;
+}
+
+void write( std::ostream &os )
+{
+    auto const megabytes = []( std::uint64_t bytes ) {
+        return static_cast<double>( bytes ) / ( 1024. * 1024. );
+    };
+    os << std::left << std::setw( 48 ) << "region" << std::setw( 16 )
+       << "space" << std::right << std::setw( 8 ) << "calls"
+       << std::setw( 12 ) << "peak [MB]" << std::setw( 12 ) << "growth [MB]"
+       << "  allocation at peak\n";
+    os << std::fixed << std::setprecision( 3 );
+    for ( auto const &space : overall_peak )
+        os << std::left << std::setw( 48 ) << "(whole run)" << std::setw( 16 )
+           << space.first << std::right << std::setw( 8 ) << 1
+           << std::setw( 12 ) << megabytes( space.second ) << std::setw( 12 )
+           << megabytes( space.second ) << "\n";
+    for ( auto const &summary : summaries )
+    {
+        auto const &s = summary.second;
+        os << std::left << std::setw( 48 ) << summary.first.first
+           << std::setw( 16 ) << summary.first.second << std::right
+           << std::setw( 8 ) << s.calls << std::setw( 12 )
+           << megabytes( s.peak ) << std::setw( 12 ) << megabytes( s.growth );
+        if ( !s.culprit.first.empty() )
+            os << "  \"" << s.culprit.first << "\" ("
+               << megabytes( s.culprit.second ) << " MB)";
+        os << "\n";
+    }
+}
+
+} // namespace
+
+extern "C" void kokkosp_init_library( int const, std::uint64_t const,
+                                      std::uint32_t const, void * )
+{
+}
+
+extern "C" void kokkosp_finalize_library()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    int const rank = getRank();
+    if ( char const *prefix = std::getenv( "DTK_MEMORY_TOOL_OUTPUT" ) )
+    {
+        std::ofstream file( std::string( prefix ) + "." +
+                            std::to_string( rank ) );
+        write( file );
+    }
+    else if ( rank == 0 )
+        write( std::cerr );
+}
+
+extern "C" void kokkosp_push_profile_region( char const *name )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    Frame frame;
+    frame.path = regions.empty() ? name : regions.back().path + "/" + name;
+    frame.entry = current;
+    frame.peak = current;
+    regions.push_back( frame );
+}
+
+extern "C" void kokkosp_pop_profile_region()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    if ( regions.empty() )
+        return;
+    auto const &frame = regions.back();
+    for ( auto const &space : frame.peak )
+    {
+        auto &s = summaries[std::make_pair( frame.path, space.first )];
+        ++s.calls;
+        auto const entry = frame.entry.find( space.first );
+        std::uint64_t const growth =
+            space.second -
+            ( entry != frame.entry.end() ? entry->second : 0 );
+        s.growth = std::max( s.growth, growth );
+        if ( space.second > s.peak )
+        {
+            s.peak = space.second;
+            auto const culprit = frame.culprit.find( space.first );
+            s.culprit = culprit != frame.culprit.end()
+                            ? culprit->second
+                            : std::pair<std::string, std::uint64_t>();
+        }
+    }
+    regions.pop_back();
+}
+
+extern "C" void kokkosp_allocate_data( SpaceHandle const handle,
+                                       char const *name, void const *,
+                                       std::uint64_t const size )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    std::string const space = handle.name;
+    std::uint64_t const bytes = ( current[space] += size );
+    overall_peak[space] = std::max( overall_peak[space], bytes );
+    for ( auto &frame : regions )
+        if ( bytes > frame.peak[space] )
+        {
+            frame.peak[space] = bytes;
+            frame.culprit[space] = std::make_pair( std::string( name ), size );
+        }
+}
+
+extern "C" void kokkosp_deallocate_data( SpaceHandle const handle,
+                                         char const *, void const *,
+                                         std::uint64_t const size )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    auto &bytes = current[handle.name];
+    bytes = bytes > size ? bytes - size : 0;
+}
@@ -0,0 +1,124 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#include "DTK_Statistics.hpp"
+
+#include <Kokkos_Core.hpp>
+
+#include <limits>
+#include <sstream>
+
+namespace DataTransferKit
+{
+namespace
+{ // anonymous
+
+// Each thread records its own statistics, e.g. a map applied asynchronously
+// does not record into the statistics of the thread that launched it.
+thread_local Statistics *current_statistics = nullptr;
+thread_local ScopedTimer *current_timer = nullptr;
+
+void writeJSONString( std::ostream &os, std::string const &str )
+{
+    os << '"';
+    for ( char const c : str )
+    {
+        if ( c == '"' || c == '\\' )
+            os << '\\';
+        os << c;
+    }
+    os << '"';
+}
+
+} // namespace
+
+void Statistics::addTime( std::string const &phase, double seconds )
+{
+    _times[phase] += seconds;
+}
+
+void Statistics::addCount( std::string const &counter, long long value )
+{
+    _counts[counter] += value;
+}
+
+void Statistics::clear()
+{
+    _times.clear();
+    _counts.clear();
+}
+
+std::string Statistics::toJSON() const
+{
+    std::ostringstream os;
+    os.precision( std::numeric_limits<double>::max_digits10 );
+    os << "{\"times\": {";
+    for ( auto it = _times.begin(); it != _times.end(); ++it )
+    {
+        if ( it != _times.begin() )
+            os << ", ";
+        writeJSONString( os, it->first );
+        os << ": " << it->second;
+    }
+    os << "}, \"counts\": {";
+    for ( auto it = _counts.begin(); it != _counts.end(); ++it )
+    {
+        if ( it != _counts.begin() )
+            os << ", ";
+        writeJSONString( os, it->first );
+        os << ": " << it->second;
+    }
+    os << "}}";
+    return os.str();
+}
+
+Statistics *Statistics::current() { return current_statistics; }
+
+StatisticsScope::StatisticsScope( Statistics &stats )
+    : _previous( current_statistics )
+{
+    current_statistics = &stats;
+}
+
+StatisticsScope::~StatisticsScope() { current_statistics = _previous; }
+
+ScopedTimer::ScopedTimer( std::string const &phase )
+    : _phase( phase )
+    , _parent( current_timer )
+    , _start( std::chrono::steady_clock::now() )
+{
+    current_timer = this;
+#if defined( KOKKOS_ENABLE_PROFILING )
+    Kokkos::Profiling::pushRegion( _phase );
+#endif
+}
+
+ScopedTimer::~ScopedTimer()
+{
+#if defined( KOKKOS_ENABLE_PROFILING )
+    Kokkos::Profiling::popRegion();
+#endif
+    current_timer = _parent;
+
+    std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - _start;
+    if ( _parent )
+        _parent->_nested_time += elapsed.count();
+    if ( current_statistics )
+        current_statistics->addTime( _phase, elapsed.count() - _nested_time );
+}
+
+void addCount( std::string const &counter, long long value )
+{
+    if ( current_statistics )
+        current_statistics->addCount( counter, value );
+}
+
+} // namespace DataTransferKit
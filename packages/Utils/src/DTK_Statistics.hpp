@@ -0,0 +1,102 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief Timers and counters of the phases of DTK operations.
+ */
+#ifndef DTK_STATISTICS_HPP
+#define DTK_STATISTICS_HPP
+
+#include <chrono>
+#include <map>
+#include <string>
+
+namespace DataTransferKit
+{
+
+/*! Time spent in each phase of an operation, e.g. the search or the
+ *  communication, and counters such as the number of bytes sent.
+ *
+ *  The statistics are local to the process.  Timers are exclusive: the time
+ *  spent in a nested phase is only attributed to the innermost phase.
+ */
+class Statistics
+{
+  public:
+    void addTime( std::string const &phase, double seconds );
+
+    void addCount( std::string const &counter, long long value );
+
+    //! Time in seconds spent in each phase.
+    std::map<std::string, double> const &getTimes() const { return _times; }
+
+    std::map<std::string, long long> const &getCounts() const
+    {
+        return _counts;
+    }
+
+    void clear();
+
+    //! Write the timers and the counters as a JSON object.
+    std::string toJSON() const;
+
+    //! Statistics recorded by the calling thread or nullptr if none are.
+    static Statistics *current();
+
+  private:
+    std::map<std::string, double> _times;
+    std::map<std::string, long long> _counts;
+};
+
+/*! Record the statistics of the calling thread into stats until the scope is
+ *  left.
+ */
+class StatisticsScope
+{
+  public:
+    explicit StatisticsScope( Statistics &stats );
+    ~StatisticsScope();
+
+    StatisticsScope( StatisticsScope const & ) = delete;
+    StatisticsScope &operator=( StatisticsScope const & ) = delete;
+
+  private:
+    Statistics *_previous;
+};
+
+/*! Time a phase until the scope is left.  The phase is also marked as a
+ *  region for the Kokkos profiling tools, e.g. the memory tool built along
+ *  with DTK (see DTK_MemoryTool.cpp) reports the memory high-water mark of
+ *  each phase.  Nothing is recorded if the thread does not record
+ *  statistics.
+ */
+class ScopedTimer
+{
+  public:
+    explicit ScopedTimer( std::string const &phase );
+    ~ScopedTimer();
+
+    ScopedTimer( ScopedTimer const & ) = delete;
+    ScopedTimer &operator=( ScopedTimer const & ) = delete;
+
+  private:
+    std::string _phase;
+    ScopedTimer *_parent;
+    std::chrono::steady_clock::time_point _start;
+    double _nested_time = 0.;
+};
+
+//! Add value to a counter of the statistics of the calling thread, if any.
+void addCount( std::string const &counter, long long value );
+
+} // namespace DataTransferKit
+
+#endif // DTK_STATISTICS_HPP
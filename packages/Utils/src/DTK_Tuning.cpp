@@ -0,0 +1,169 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+#include "DTK_Tuning.hpp"
+#include "DTK_DBC.hpp"
+
+#include <algorithm> // find
+#include <cstdlib>   // getenv
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace DataTransferKit
+{
+namespace
+{ // anonymous
+
+struct Trials
+{
+    std::vector<int> candidates;
+    std::map<int, double> seconds;
+};
+
+std::mutex mutex;
+bool loaded = false;
+std::map<std::string, int> settings;
+std::map<std::string, Trials> trials;
+int rank = 0;
+
+char const *tuningFile() { return std::getenv( "DTK_TUNING_FILE" ); }
+
+void loadSettings( std::string const &filename )
+{
+    std::ifstream file( filename );
+    std::string line;
+    while ( std::getline( file, line ) )
+    {
+        std::istringstream is( line );
+        std::string knob;
+        std::string space;
+        std::size_t size_class;
+        int value;
+        if ( is >> knob >> space >> size_class >> value && knob[0] != '#' )
+            settings[knob + ' ' + space + ' ' +
+                     std::to_string( size_class )] = value;
+    }
+}
+
+void saveSettings( std::string const &filename )
+{
+    std::ofstream file( filename );
+    for ( auto const &setting : settings )
+        file << setting.first << ' ' << setting.second << '\n';
+}
+
+} // namespace
+
+std::string Tuning::key( std::string const &knob,
+                         std::string const &execution_space,
+                         std::size_t size )
+{
+    DTK_REQUIRE( !knob.empty() && !execution_space.empty() );
+    std::size_t size_class = 0;
+    while ( size > 0 )
+    {
+        size >>= 1;
+        ++size_class;
+    }
+    return knob + ' ' + execution_space + ' ' + std::to_string( size_class );
+}
+
+int Tuning::select( std::string const &key,
+                    std::vector<int> const &candidates )
+{
+    DTK_REQUIRE( !candidates.empty() );
+    std::lock_guard<std::mutex> lock( mutex );
+    if ( !loaded )
+    {
+        loaded = true;
+        if ( char const *filename = tuningFile() )
+            loadSettings( filename );
+    }
+
+    auto const setting = settings.find( key );
+    if ( setting != settings.end() )
+        return setting->second;
+    // A single candidate needs no trial.
+    if ( candidates.size() == 1 )
+        return candidates[0];
+
+    auto &trial = trials[key];
+    if ( trial.candidates.empty() )
+        trial.candidates = candidates;
+    for ( int const candidate : trial.candidates )
+        if ( trial.seconds.count( candidate ) == 0 )
+            return candidate;
+    return trial.candidates[0];
+}
+
+void Tuning::report( std::string const &key, int value, double seconds )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    auto const it = trials.find( key );
+    if ( it == trials.end() )
+        return;
+    auto &trial = it->second;
+    if ( std::find( trial.candidates.begin(), trial.candidates.end(),
+                    value ) == trial.candidates.end() )
+        return;
+    // Several calls may be timed with the same candidate when they are made
+    // concurrently, the fastest one counts.
+    auto const timed = trial.seconds.find( value );
+    if ( timed == trial.seconds.end() || seconds < timed->second )
+        trial.seconds[value] = seconds;
+    if ( trial.seconds.size() < trial.candidates.size() )
+        return;
+
+    int winner = trial.candidates[0];
+    for ( auto const &candidate_seconds : trial.seconds )
+        if ( candidate_seconds.second < trial.seconds[winner] )
+            winner = candidate_seconds.first;
+    settings[key] = winner;
+    trials.erase( it );
+    if ( char const *filename = tuningFile() )
+        if ( rank == 0 )
+            saveSettings( filename );
+}
+
+void Tuning::setComm( Teuchos::RCP<Teuchos::Comm<int> const> const &comm )
+{
+    DTK_REQUIRE( !comm.is_null() );
+    std::lock_guard<std::mutex> lock( mutex );
+    rank = comm->getRank();
+}
+
+bool Tuning::enabled()
+{
+    static bool const value = ( tuningFile() != nullptr );
+    return value;
+}
+
+void Tuning::load( std::string const &filename )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    loadSettings( filename );
+}
+
+void Tuning::save( std::string const &filename )
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    saveSettings( filename );
+}
+
+void Tuning::clear()
+{
+    std::lock_guard<std::mutex> lock( mutex );
+    settings.clear();
+    trials.clear();
+}
+
+} // namespace DataTransferKit
@@ -0,0 +1,84 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+/*!
+ * \file
+ * \brief Settings of the performance knobs picked by timing the candidates.
+ */
+#ifndef DTK_TUNING_HPP
+#define DTK_TUNING_HPP
+
+#include <Teuchos_Comm.hpp>
+#include <Teuchos_RCP.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace DataTransferKit
+{
+
+/*! Values of the knobs that only affect the performance, e.g. a team size,
+ *  found by timing each candidate value once in the first calls.
+ *
+ *  A knob is tuned separately for each execution space and for each class of
+ *  problem sizes, i.e. the sizes with the same number of binary digits.  The
+ *  calls of a class use the candidates in turn until they have all been
+ *  timed, and the fastest one from then on.
+ *
+ *  The winners are kept for the duration of the process.  If the environment
+ *  variable DTK_TUNING_FILE is set, they are also read from that file when
+ *  the first knob is selected, and the file is rewritten by the rank 0 of
+ *  the communicator given to setComm() whenever a knob is tuned, so that
+ *  later runs skip the trials.  Every line
+ *  of the file holds the knob, the execution space, the size class and the
+ *  value, e.g. "sort_results_keys_per_bin Cuda 20 8", and can be edited by
+ *  hand.  The setting of the file is used even if it is not a candidate.
+ */
+class Tuning
+{
+  public:
+    //! Identify the knob for the given execution space and problem size.
+    static std::string key( std::string const &knob,
+                            std::string const &execution_space,
+                            std::size_t size );
+
+    /*! Value to use for the next call, i.e. the winner if the knob has been
+     *  tuned and a candidate that has not been timed yet otherwise.
+     */
+    static int select( std::string const &key,
+                       std::vector<int> const &candidates );
+
+    /*! Report how long a call with the value returned by select() took,
+     *  including the synchronization of the execution space.
+     */
+    static void report( std::string const &key, int value, double seconds );
+
+    /*! Communicator of the processes that share the file, only its rank 0
+     *  writes it.  A process that has not been given one writes the file.
+     */
+    static void setComm( Teuchos::RCP<Teuchos::Comm<int> const> const &comm );
+
+    //! Whether the internal knobs are tuned, i.e. DTK_TUNING_FILE is set.
+    static bool enabled();
+
+    //! Add the settings of the file, which override the ones already tuned.
+    static void load( std::string const &filename );
+
+    //! Write the settings of the knobs that have been tuned.
+    static void save( std::string const &filename );
+
+    //! Forget the settings and the trials in progress.
+    static void clear();
+};
+
+} // namespace DataTransferKit
+
+#endif // DTK_TUNING_HPP
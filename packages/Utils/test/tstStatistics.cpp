@@ -0,0 +1,80 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_Statistics.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEUCHOS_UNIT_TEST( Statistics, counters )
+{
+    using DataTransferKit::Statistics;
+    using DataTransferKit::StatisticsScope;
+
+    // Nothing is recorded outside of a scope.
+    TEST_ASSERT( Statistics::current() == nullptr );
+    DataTransferKit::addCount( "ignored", 1 );
+
+    Statistics stats;
+    {
+        StatisticsScope scope( stats );
+        TEST_EQUALITY( Statistics::current(), &stats );
+        DataTransferKit::addCount( "bytes sent", 8 );
+        DataTransferKit::addCount( "bytes sent", 16 );
+
+        // Nested scopes record into their own statistics.
+        Statistics other_stats;
+        {
+            StatisticsScope other_scope( other_stats );
+            DataTransferKit::addCount( "messages sent", 2 );
+        }
+        TEST_EQUALITY( Statistics::current(), &stats );
+        TEST_EQUALITY( other_stats.getCounts().at( "messages sent" ), 2 );
+
+        // Threads do not share statistics.
+        std::thread( []() { DataTransferKit::addCount( "bytes sent", 32 ); } )
+            .join();
+    }
+    TEST_ASSERT( Statistics::current() == nullptr );
+
+    TEST_EQUALITY( stats.getCounts().size(), 1u );
+    TEST_EQUALITY( stats.getCounts().at( "bytes sent" ), 24 );
+    TEST_EQUALITY( stats.toJSON(), "{\"times\": {}, \"counts\": {\"bytes "
+                                   "sent\": 24}}" );
+
+    stats.clear();
+    TEST_ASSERT( stats.getCounts().empty() );
+}
+
+TEUCHOS_UNIT_TEST( Statistics, exclusive_timers )
+{
+    using DataTransferKit::ScopedTimer;
+
+    DataTransferKit::Statistics stats;
+    {
+        DataTransferKit::StatisticsScope scope( stats );
+        ScopedTimer outer_timer( "outer" );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+        {
+            ScopedTimer inner_timer( "inner" );
+            std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        }
+    }
+
+    // The time spent in the inner phase is not attributed to the outer one.
+    auto const &times = stats.getTimes();
+    TEST_EQUALITY( times.size(), 2u );
+    TEST_COMPARE( times.at( "inner" ), >=, 0.05 );
+    TEST_COMPARE( times.at( "outer" ), >=, 0.01 );
+    TEST_COMPARE( times.at( "outer" ), <, times.at( "inner" ) );
+}
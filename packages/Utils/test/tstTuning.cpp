@@ -0,0 +1,91 @@
+/****************************************************************************
+ * Copyright (c) 2012-2018 by the DataTransferKit authors                   *
+ * All rights reserved.                                                     *
+ *                                                                          *
+ * This file is part of the DataTransferKit library. DataTransferKit is     *
+ * distributed under a BSD 3-clause license. For the licensing terms see    *
+ * the LICENSE file in the top-level directory.                             *
+ *                                                                          *
+ * SPDX-License-Identifier: BSD-3-Clause                                    *
+ ****************************************************************************/
+
+#include <DTK_Tuning.hpp>
+
+#include <Teuchos_UnitTestHarness.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+TEUCHOS_UNIT_TEST( Tuning, size_classes )
+{
+    using DataTransferKit::Tuning;
+
+    TEST_EQUALITY( Tuning::key( "knob", "Serial", 0 ), "knob Serial 0" );
+    TEST_EQUALITY( Tuning::key( "knob", "Serial", 1 ), "knob Serial 1" );
+    TEST_EQUALITY( Tuning::key( "knob", "Serial", 1000 ),
+                   Tuning::key( "knob", "Serial", 1023 ) );
+    TEST_INEQUALITY( Tuning::key( "knob", "Serial", 1023 ),
+                     Tuning::key( "knob", "Serial", 1024 ) );
+    TEST_INEQUALITY( Tuning::key( "knob", "Serial", 1000 ),
+                     Tuning::key( "knob", "OpenMP", 1000 ) );
+}
+
+TEUCHOS_UNIT_TEST( Tuning, select_the_fastest_candidate )
+{
+    using DataTransferKit::Tuning;
+    Tuning::clear();
+
+    auto const key = Tuning::key( "team_size", "Serial", 100 );
+    std::vector<int> const candidates = {8, 16, 32};
+
+    // The candidates are timed in turn, the fastest one is kept.
+    TEST_EQUALITY( Tuning::select( key, candidates ), 8 );
+    Tuning::report( key, 8, 3. );
+    TEST_EQUALITY( Tuning::select( key, candidates ), 16 );
+    Tuning::report( key, 16, 1. );
+    TEST_EQUALITY( Tuning::select( key, candidates ), 32 );
+    Tuning::report( key, 32, 2. );
+    for ( int i = 0; i < 3; ++i )
+        TEST_EQUALITY( Tuning::select( key, candidates ), 16 );
+
+    // Other size classes are tuned separately, a single candidate is not.
+    auto const other_key = Tuning::key( "team_size", "Serial", 1000 );
+    TEST_EQUALITY( Tuning::select( other_key, candidates ), 8 );
+    TEST_EQUALITY( Tuning::select( other_key, {4} ), 4 );
+    Tuning::report( other_key, 4, 1. );
+    TEST_EQUALITY( Tuning::select( other_key, candidates ), 8 );
+
+    Tuning::clear();
+    TEST_EQUALITY( Tuning::select( key, candidates ), 8 );
+    Tuning::clear();
+}
+
+TEUCHOS_UNIT_TEST( Tuning, save_and_load )
+{
+    using DataTransferKit::Tuning;
+    Tuning::clear();
+
+    auto const key = Tuning::key( "keys_per_bin", "Serial", 100 );
+    std::vector<int> const candidates = {2, 8};
+    Tuning::select( key, candidates );
+    Tuning::report( key, 2, 2. );
+    Tuning::select( key, candidates );
+    Tuning::report( key, 8, 1. );
+
+    std::string const filename = "tuning_save_and_load.txt";
+    Tuning::save( filename );
+    Tuning::clear();
+    Tuning::load( filename );
+    TEST_EQUALITY( Tuning::select( key, candidates ), 8 );
+
+    // Settings edited by hand are used even if they are not candidates.
+    {
+        std::ofstream file( filename );
+        file << "# knob space class value\n" << key << " 32\n";
+    }
+    Tuning::load( filename );
+    TEST_EQUALITY( Tuning::select( key, candidates ), 32 );
+
+    std::remove( filename.c_str() );
+    Tuning::clear();
+}